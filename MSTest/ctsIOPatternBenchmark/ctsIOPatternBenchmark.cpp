@@ -0,0 +1,425 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <sdkddkver.h>
+// cpp headers
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <memory>
+#include <new>
+// OS headers
+#include <Windows.h>
+// ctl headers
+#include <ctTimer.hpp>
+// project headers
+#include "ctsIOTask.hpp"
+#include "ctsConfig.h"
+#include "ctsIOPattern.h"
+#include "ctsIOPatternState.hpp"
+
+///
+/// Socketless microbenchmark of the ctsIoPattern state machine
+/// - drives InitiateIo / CompleteIo with the same Fakes as the ctsIOPattern unit tests
+/// - every task is completed inline with all of its bytes, as if the IO completed immediately,
+///   so the cost measured is the pattern engine (plus a memcpy modeling the NIC filling each recv buffer)
+/// - rate limit delays (ctsTask::m_timeOffsetMilliseconds) are computed but never waited on
+///
+/// usage: ctsIOPatternBenchmark.exe [milliseconds to run each case - default 500]
+///
+
+///
+/// counts every allocation made through the global operator new
+///
+static std::atomic<long long> g_allocationCount{0};
+
+void* __cdecl operator new(size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* const allocation = malloc(size == 0 ? 1 : size))
+    {
+        return allocation;
+    }
+    throw std::bad_alloc();
+}
+
+void* __cdecl operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void __cdecl operator delete(void* allocation) noexcept
+{
+    free(allocation);
+}
+
+void __cdecl operator delete[](void* allocation) noexcept
+{
+    free(allocation);
+}
+
+void __cdecl operator delete(void* allocation, size_t) noexcept
+{
+    free(allocation);
+}
+
+void __cdecl operator delete[](void* allocation, size_t) noexcept
+{
+    free(allocation);
+}
+
+///
+/// statics to return in the Fakes
+///
+ctsTraffic::ctsSignedLongLong g_tcpBytesPerSecond = 0LL;
+ctsTraffic::ctsUnsignedLong s_MaxBufferSize = 0UL;
+ctsTraffic::ctsUnsignedLong s_BufferSize = 0UL;
+ctsTraffic::ctsUnsignedLongLong g_transferSize = 0ULL;
+bool s_IsListening = false;
+ctsTraffic::ctsConfig::MediaStreamSettings s_MediaStreamSettings;
+
+///
+/// Fakes
+///
+namespace ctsTraffic::ctsConfig
+{
+    ctsConfigSettings* g_configSettings;
+
+    void PrintConnectionResults(unsigned long) noexcept
+    {
+    }
+    void PrintConnectionResults(const ctl::ctSockaddr&, const ctl::ctSockaddr&, unsigned long, const ctsTcpStatistics&) noexcept
+    {
+    }
+    void PrintConnectionResults(const ctl::ctSockaddr&, const ctl::ctSockaddr&, unsigned long, const ctsUdpStatistics&) noexcept
+    {
+    }
+    void PrintDebug(_In_z_ _Printf_format_string_ PCWSTR, ...) noexcept
+    {
+    }
+    void PrintException(const std::exception&) noexcept
+    {
+    }
+    void PrintJitterUpdate(const JitterFrameEntry&, const JitterFrameEntry&) noexcept
+    {
+    }
+    void PrintJitterSummary(const JitterSummaryEntry&) noexcept
+    {
+    }
+    void PrintErrorInfo(_In_z_ _Printf_format_string_ PCWSTR, ...) noexcept
+    {
+    }
+
+    bool IsListening() noexcept
+    {
+        return s_IsListening;
+    }
+
+    const MediaStreamSettings& GetMediaStream() noexcept
+    {
+        return s_MediaStreamSettings;
+    }
+
+    ctsSignedLongLong GetTcpBytesPerSecond() noexcept
+    {
+        return g_tcpBytesPerSecond;
+    }
+    ctsUnsignedLong GetMaxBufferSize() noexcept
+    {
+        return s_MaxBufferSize;
+    }
+    ctsUnsignedLong GetMinBufferSize() noexcept
+    {
+        return s_BufferSize;
+    }
+    ctsUnsignedLong GetBufferSize() noexcept
+    {
+        return s_BufferSize;
+    }
+    ctsUnsignedLongLong GetTransferSize() noexcept
+    {
+        return g_transferSize;
+    }
+
+    float GetStatusTimeStamp() noexcept
+    {
+        return static_cast<float>(ctl::ctTimer::SnapQpcInMillis() - g_configSettings->StartTimeMilliseconds) / 1000.0f;
+    }
+    bool ShutdownCalled() noexcept
+    {
+        return false;
+    }
+    unsigned long ConsoleVerbosity() noexcept
+    {
+        return 0;
+    }
+}
+
+///
+/// End of Fakes
+///
+
+using namespace ctsTraffic;
+
+namespace
+{
+    // the shared send buffers are sized once from GetMaxBufferSize() : must cover the largest case
+    constexpr unsigned long c_bufferSizes[]{ 1024UL, 64UL * 1024UL, 1024UL * 1024UL };
+    constexpr unsigned long c_largestBufferSize = 1024UL * 1024UL;
+    // each connection transfers this much before its protocol completes (then a new connection is started)
+    constexpr unsigned long long c_transferPerConnection = 64ULL * 1024ULL * 1024ULL;
+    // 1 Gbps : the rate limit cases never wait, this only drives the quantum math
+    constexpr long long c_rateLimitBytesPerSecond = 125000000LL;
+
+    enum class VerifyMode
+    {
+        Connection,
+        Data,
+        Checksum
+    };
+
+    enum class RateLimitMode
+    {
+        Off,
+        Quantum,
+        Paced
+    };
+
+    struct BenchmarkResult
+    {
+        long long m_io = 0;
+        long long m_connections = 0;
+        long long m_failedConnections = 0;
+        long long m_bytes = 0;
+        long long m_qpc = 0;
+        long long m_allocations = 0;
+    };
+
+    PCWSTR PrintPattern(ctsConfig::IoPatternType pattern) noexcept
+    {
+        switch (pattern)
+        {
+            case ctsConfig::IoPatternType::Push: return L"Push";
+            case ctsConfig::IoPatternType::Pull: return L"Pull";
+            case ctsConfig::IoPatternType::PushPull: return L"PushPull";
+            case ctsConfig::IoPatternType::Duplex: return L"Duplex";
+            default: return L"Unknown";
+        }
+    }
+
+    PCWSTR PrintVerify(VerifyMode verify) noexcept
+    {
+        switch (verify)
+        {
+            case VerifyMode::Connection: return L"connection";
+            case VerifyMode::Data: return L"data";
+            case VerifyMode::Checksum: return L"checksum";
+        }
+        return L"Unknown";
+    }
+
+    PCWSTR PrintRateLimit(RateLimitMode rateLimit) noexcept
+    {
+        switch (rateLimit)
+        {
+            case RateLimitMode::Off: return L"off";
+            case RateLimitMode::Quantum: return L"quantum";
+            case RateLimitMode::Paced: return L"paced";
+        }
+        return L"Unknown";
+    }
+
+    //
+    // completes the task as if the IO completed immediately with every byte requested:
+    // - recvs are filled with what the peer would have sent so buffer verification succeeds
+    // - the final recv after the protocol completes returns the zero-byte FIN
+    //
+    unsigned long SimulateIo(const ctsTask& task) noexcept
+    {
+        switch (task.m_ioAction)
+        {
+            case ctsTaskAction::Send:
+                return task.m_bufferLength;
+
+            case ctsTaskAction::Recv:
+                if (ctsTask::BufferType::CompletionMessage == task.m_bufferType)
+                {
+                    memcpy_s(task.m_buffer, task.m_bufferLength, c_completionMessage, c_completionMessageSize);
+                    return c_completionMessageSize;
+                }
+                if (ctsTask::BufferType::TcpConnectionId == task.m_bufferType)
+                {
+                    return task.m_bufferLength;
+                }
+                if (!task.m_trackIo)
+                {
+                    return 0UL;
+                }
+                // the shared send buffer holds the pattern starting at every pattern offset
+                memcpy_s(
+                    task.m_buffer + task.m_bufferOffset,
+                    task.m_bufferLength,
+                    ctsIoPattern::AccessSharedBuffer() + task.m_expectedPatternOffset,
+                    task.m_bufferLength);
+                return task.m_bufferLength;
+
+            case ctsTaskAction::GracefulShutdown:
+            case ctsTaskAction::HardShutdown:
+            default:
+                return 0UL;
+        }
+    }
+
+    // runs one connection's pattern to completion : returns false if the pattern failed
+    bool RunConnection(BenchmarkResult& result)
+    {
+        const std::shared_ptr<ctsIoPattern> pattern(ctsIoPattern::MakeIoPattern());
+        for (;;)
+        {
+            const ctsTask task = pattern->InitiateIo();
+            if (ctsTaskAction::None == task.m_ioAction)
+            {
+                // every IO is completed inline : there is never another IO outstanding to wait on
+                return false;
+            }
+
+            const auto transferred = SimulateIo(task);
+            ++result.m_io;
+            result.m_bytes += transferred;
+
+            switch (pattern->CompleteIo(task, transferred, NO_ERROR))
+            {
+                case ctsIoStatus::ContinueIo:
+                    break;
+                case ctsIoStatus::CompletedIo:
+                    return true;
+                case ctsIoStatus::FailedIo:
+                default:
+                    return false;
+            }
+        }
+    }
+
+    BenchmarkResult RunCase(long long milliseconds)
+    {
+        BenchmarkResult result;
+
+        // one untimed connection to warm up the process-wide buffers and the recycled recv buffers
+        BenchmarkResult warmup;
+        (void)RunConnection(warmup);
+
+        const long long endQpc = ctl::ctTimer::SnapQpc() + ctl::ctTimer::ConvertMillisToQpc(milliseconds);
+        const long long startAllocations = g_allocationCount.load();
+        const long long startQpc = ctl::ctTimer::SnapQpc();
+        long long currentQpc = startQpc;
+        while (currentQpc < endQpc)
+        {
+            ++result.m_connections;
+            if (!RunConnection(result))
+            {
+                ++result.m_failedConnections;
+            }
+            currentQpc = ctl::ctTimer::SnapQpc();
+        }
+        result.m_qpc = currentQpc - startQpc;
+        result.m_allocations = g_allocationCount.load() - startAllocations;
+        return result;
+    }
+
+    void SetCase(bool listening, ctsConfig::IoPatternType pattern, VerifyMode verify, RateLimitMode rateLimit, unsigned long bufferSize) noexcept
+    {
+        ctsConfig::g_configSettings->IoPattern = pattern;
+        ctsConfig::g_configSettings->ShouldVerifyBuffers = VerifyMode::Data == verify;
+        ctsConfig::g_configSettings->ShouldVerifyChecksums = VerifyMode::Checksum == verify;
+        ctsConfig::g_configSettings->RateLimitPacing = RateLimitMode::Paced == rateLimit;
+        ctsConfig::g_configSettings->PushBytes = bufferSize;
+        ctsConfig::g_configSettings->PullBytes = bufferSize;
+
+        g_tcpBytesPerSecond = RateLimitMode::Off == rateLimit ? 0LL : c_rateLimitBytesPerSecond;
+        s_BufferSize = bufferSize;
+        s_IsListening = listening;
+    }
+}
+
+int __cdecl wmain(int argc, _In_reads_z_(argc) const wchar_t** argv)
+{
+    const long long milliseconds = argc > 1 ? _wtoi64(argv[1]) : 500LL;
+    if (milliseconds <= 0)
+    {
+        fwprintf(stderr, L"usage: ctsIOPatternBenchmark.exe [milliseconds to run each case]\n");
+        return 1;
+    }
+
+    ctsConfig::g_configSettings = new ctsConfig::ctsConfigSettings;
+    ctsConfig::g_configSettings->Protocol = ctsConfig::ProtocolType::TCP;
+    ctsConfig::g_configSettings->TcpShutdown = ctsConfig::TcpShutdownType::GracefulShutdown;
+    ctsConfig::g_configSettings->UseSharedBuffer = false;
+    ctsConfig::g_configSettings->PrePostRecvs = 1;
+    ctsConfig::g_configSettings->PrePostSends = 1;
+    ctsConfig::g_configSettings->ConnectionLimit = 1;
+    ctsConfig::g_configSettings->StartTimeMilliseconds = ctl::ctTimer::SnapQpcInMillis();
+    s_MaxBufferSize = c_largestBufferSize;
+    g_transferSize = c_transferPerConnection;
+
+    constexpr ctsConfig::IoPatternType patterns[]{
+        ctsConfig::IoPatternType::Push,
+        ctsConfig::IoPatternType::Pull,
+        ctsConfig::IoPatternType::PushPull,
+        ctsConfig::IoPatternType::Duplex };
+    constexpr VerifyMode verifyModes[]{ VerifyMode::Connection, VerifyMode::Data, VerifyMode::Checksum };
+    constexpr RateLimitMode rateLimitModes[]{ RateLimitMode::Off, RateLimitMode::Quantum, RateLimitMode::Paced };
+
+    const double qpf = static_cast<double>(ctl::ctTimer::SnapQpf());
+    long long failedConnections = 0;
+
+    wprintf(L"Role,Pattern,Verify,RateLimit,BufferSize,IO,Connections,Failed,ns/IO,Allocations/IO,MB/sec\n");
+    for (const auto listening : { false, true })
+    {
+        for (const auto pattern : patterns)
+        {
+            for (const auto verify : verifyModes)
+            {
+                for (const auto rateLimit : rateLimitModes)
+                {
+                    for (const auto bufferSize : c_bufferSizes)
+                    {
+                        SetCase(listening, pattern, verify, rateLimit, bufferSize);
+                        const auto result = RunCase(milliseconds);
+                        failedConnections += result.m_failedConnections;
+
+                        const double seconds = static_cast<double>(result.m_qpc) / qpf;
+                        const double io = result.m_io > 0 ? static_cast<double>(result.m_io) : 1.0;
+                        wprintf(
+                            L"%ws,%ws,%ws,%ws,%lu,%lld,%lld,%lld,%.1f,%.3f,%.1f\n",
+                            listening ? L"Server" : L"Client",
+                            PrintPattern(pattern),
+                            PrintVerify(verify),
+                            PrintRateLimit(rateLimit),
+                            bufferSize,
+                            result.m_io,
+                            result.m_connections,
+                            result.m_failedConnections,
+                            seconds * 1.0e9 / io,
+                            static_cast<double>(result.m_allocations) / io,
+                            seconds > 0.0 ? static_cast<double>(result.m_bytes) / seconds / (1024.0 * 1024.0) : 0.0);
+                    }
+                }
+            }
+        }
+    }
+
+    delete ctsConfig::g_configSettings;
+    // a failed connection means the simulated IO no longer matches what the pattern expects
+    return failedConnections > 0 ? 1 : 0;
+}
@@ -1199,5 +1199,29 @@ namespace ctsUnitTest
             Assert::IsTrue(m_ioPatternState->IsCompleted());
             Assert::AreEqual(static_cast<uint64_t>(0), m_ioPatternState->GetRemainingTransfer());
         }
+
+        TEST_METHOD(TestCompletedMessages)
+        {
+            ctsConfig::g_configSettings->MessageSize = 100;
+            this->InitGracefulShutdownTest(1000);
+
+            bool endedMidMessage{};
+            // each send is a single message
+            Assert::AreEqual(1UL, static_cast<unsigned long>(m_ioPatternState->CompletedMessages(ctsTaskAction::Send, 100, endedMidMessage)));
+            Assert::IsFalse(endedMidMessage);
+            // a recv coalescing 2 and a half messages
+            Assert::AreEqual(2UL, static_cast<unsigned long>(m_ioPatternState->CompletedMessages(ctsTaskAction::Recv, 250, endedMidMessage)));
+            Assert::IsTrue(endedMidMessage);
+            // completing the remainder of the split message is counted with the recv which received its last byte
+            Assert::AreEqual(0UL, static_cast<unsigned long>(m_ioPatternState->CompletedMessages(ctsTaskAction::Recv, 25, endedMidMessage)));
+            Assert::IsTrue(endedMidMessage);
+            Assert::AreEqual(1UL, static_cast<unsigned long>(m_ioPatternState->CompletedMessages(ctsTaskAction::Recv, 25, endedMidMessage)));
+            Assert::IsFalse(endedMidMessage);
+            // sends and recvs are tracked independently
+            Assert::AreEqual(1UL, static_cast<unsigned long>(m_ioPatternState->CompletedMessages(ctsTaskAction::Send, 100, endedMidMessage)));
+            Assert::IsFalse(endedMidMessage);
+
+            ctsConfig::g_configSettings->MessageSize = 0;
+        }
     };
 }
\ No newline at end of file
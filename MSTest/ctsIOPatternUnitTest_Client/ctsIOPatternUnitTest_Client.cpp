@@ -15,6 +15,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "CppUnitTest.h"
 // cpp headers
 #include <memory>
+#include <vector>
 // OS headers
 #include <Windows.h>
 // ctl headers
@@ -108,6 +109,9 @@ namespace ctsTraffic::ctsConfig
     void PrintJitterUpdate(const JitterFrameEntry&, const JitterFrameEntry&) noexcept
     {
     }
+    void PrintJitterSummary(const JitterSummaryEntry&) noexcept
+    {
+    }
     void PrintErrorInfo(_In_z_ _Printf_format_string_ PCWSTR, ...) noexcept
     {
     }
@@ -1602,6 +1606,110 @@ namespace ctsUnitTest
             Logger::WriteMessage(ToString<ctsTraffic::ctsTask>(test_task).c_str());
             Assert::AreEqual(ctsIoStatus::CompletedIo, test_pattern->CompleteIo(test_task, 0, 0));
         }
+        TEST_METHOD(PullClient_VerifyingBuffersNotUsingSharedBuffer_CorruptedByte)
+        {
+            ctsConfig::g_configSettings->IoPattern = ctsConfig::IoPatternType::Pull;
+            ctsConfig::g_configSettings->Protocol = ctsConfig::ProtocolType::TCP;
+            ctsConfig::g_configSettings->TcpShutdown = ctsConfig::TcpShutdownType::GracefulShutdown;
+            ctsConfig::g_configSettings->UseSharedBuffer = false;
+            ctsConfig::g_configSettings->ShouldVerifyBuffers = true;
+            ctsConfig::g_configSettings->PrePostRecvs = 1;
+            ctsConfig::g_configSettings->PrePostSends = 1;
+            g_tcpBytesPerSecond = 0LL;
+            s_MaxBufferSize = 1024;
+            s_BufferSize = 1024;
+            g_transferSize = 1024 * 10;
+            s_IsListening = false;
+
+            std::shared_ptr<ctsIoPattern> test_pattern(ctsIoPattern::MakeIoPattern());
+
+            ctsTask test_task = test_pattern->InitiateIo();
+            Assert::AreEqual(ctsStatistics::c_connectionIdLength, test_task.m_bufferLength);
+            Assert::AreEqual(ctsTaskAction::Recv, test_task.m_ioAction);
+            Assert::AreEqual(ctsIoStatus::ContinueIo, test_pattern->CompleteIo(test_task, ctsStatistics::c_connectionIdLength, 0));
+
+            for (unsigned long io_count = 0; io_count < 2; ++io_count)
+            {
+                test_task = test_pattern->InitiateIo();
+                Assert::AreEqual(1024UL, test_task.m_bufferLength);
+                Assert::AreEqual(ctsTaskAction::Recv, test_task.m_ioAction);
+                // "recv" the correct bytes
+                ::memcpy(test_task.m_buffer, ctsIoPattern::AccessSharedBuffer() + test_task.m_expectedPatternOffset, test_task.m_bufferLength);
+                Assert::AreEqual(ctsIoStatus::ContinueIo, test_pattern->CompleteIo(test_task, 1024, 0));
+            }
+
+            // "recv" the correct bytes except one near the end of the buffer
+            test_task = test_pattern->InitiateIo();
+            Assert::AreEqual(ctsTaskAction::Recv, test_task.m_ioAction);
+            ::memcpy(test_task.m_buffer, ctsIoPattern::AccessSharedBuffer() + test_task.m_expectedPatternOffset, test_task.m_bufferLength);
+            test_task.m_buffer[test_task.m_bufferLength - 3] = static_cast<char>(~test_task.m_buffer[test_task.m_bufferLength - 3]);
+            Assert::AreEqual(ctsIoStatus::FailedIo, test_pattern->CompleteIo(test_task, 1024, 0));
+        }
+        TEST_METHOD(PullClient_SeededPayload_CorruptedByte)
+        {
+            ctsConfig::g_configSettings->IoPattern = ctsConfig::IoPatternType::Pull;
+            ctsConfig::g_configSettings->Protocol = ctsConfig::ProtocolType::TCP;
+            ctsConfig::g_configSettings->TcpShutdown = ctsConfig::TcpShutdownType::GracefulShutdown;
+            ctsConfig::g_configSettings->UseSharedBuffer = false;
+            ctsConfig::g_configSettings->ShouldVerifyBuffers = true;
+            ctsConfig::g_configSettings->SeededPayload = true;
+            ctsConfig::g_configSettings->PrePostRecvs = 1;
+            ctsConfig::g_configSettings->PrePostSends = 1;
+            g_tcpBytesPerSecond = 0LL;
+            s_MaxBufferSize = 1024;
+            s_BufferSize = 1024;
+            g_transferSize = 1024 * 3;
+
+            // the server sends the payload seeded from its connection ID
+            s_IsListening = true;
+            std::shared_ptr<ctsIoPattern> server_pattern(ctsIoPattern::MakeIoPattern());
+
+            ctsTask test_task = server_pattern->InitiateIo();
+            Assert::AreEqual(ctsStatistics::c_connectionIdLength, test_task.m_bufferLength);
+            Assert::AreEqual(ctsTaskAction::Send, test_task.m_ioAction);
+            const std::vector<char> connection_id(test_task.m_buffer, test_task.m_buffer + test_task.m_bufferLength);
+            Assert::AreEqual(ctsIoStatus::ContinueIo, server_pattern->CompleteIo(test_task, ctsStatistics::c_connectionIdLength, 0));
+
+            std::vector<char> payload;
+            for (unsigned long io_count = 0; io_count < 3; ++io_count)
+            {
+                test_task = server_pattern->InitiateIo();
+                Assert::AreEqual(1024UL, test_task.m_bufferLength);
+                Assert::AreEqual(ctsTaskAction::Send, test_task.m_ioAction);
+                payload.insert(payload.end(), test_task.m_buffer + test_task.m_bufferOffset, test_task.m_buffer + test_task.m_bufferOffset + test_task.m_bufferLength);
+                Assert::AreEqual(ctsIoStatus::ContinueIo, server_pattern->CompleteIo(test_task, 1024, 0));
+            }
+            // the connection's payload is not the shared buffer pattern
+            Assert::AreNotEqual(0, ::memcmp(payload.data(), ctsIoPattern::AccessSharedBuffer(), 1024));
+
+            // the client regenerates the server's payload from the same connection ID to verify it
+            s_IsListening = false;
+            std::shared_ptr<ctsIoPattern> test_pattern(ctsIoPattern::MakeIoPattern());
+
+            test_task = test_pattern->InitiateIo();
+            Assert::AreEqual(ctsStatistics::c_connectionIdLength, test_task.m_bufferLength);
+            Assert::AreEqual(ctsTaskAction::Recv, test_task.m_ioAction);
+            ::memcpy(test_task.m_buffer, connection_id.data(), connection_id.size());
+            Assert::AreEqual(ctsIoStatus::ContinueIo, test_pattern->CompleteIo(test_task, ctsStatistics::c_connectionIdLength, 0));
+
+            for (unsigned long io_count = 0; io_count < 2; ++io_count)
+            {
+                test_task = test_pattern->InitiateIo();
+                Assert::AreEqual(1024UL, test_task.m_bufferLength);
+                Assert::AreEqual(ctsTaskAction::Recv, test_task.m_ioAction);
+                ::memcpy(test_task.m_buffer, payload.data() + io_count * 1024, test_task.m_bufferLength);
+                Assert::AreEqual(ctsIoStatus::ContinueIo, test_pattern->CompleteIo(test_task, 1024, 0));
+            }
+
+            // "recv" the correct bytes except one near the end of the buffer
+            test_task = test_pattern->InitiateIo();
+            Assert::AreEqual(ctsTaskAction::Recv, test_task.m_ioAction);
+            ::memcpy(test_task.m_buffer, payload.data() + 2 * 1024, test_task.m_bufferLength);
+            test_task.m_buffer[test_task.m_bufferLength - 3] = static_cast<char>(~test_task.m_buffer[test_task.m_bufferLength - 3]);
+            Assert::AreEqual(ctsIoStatus::FailedIo, test_pattern->CompleteIo(test_task, 1024, 0));
+
+            ctsConfig::g_configSettings->SeededPayload = false;
+        }
         TEST_METHOD(PullClient_VerifyingBuffersNotUsingSharedBuffer_SmallRecvs_Graceful)
         {
             ctsConfig::g_configSettings->IoPattern = ctsConfig::IoPatternType::Pull;
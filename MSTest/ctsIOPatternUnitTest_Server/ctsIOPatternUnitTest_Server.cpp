@@ -103,6 +103,9 @@ namespace ctsTraffic::ctsConfig
     void PrintJitterUpdate(const JitterFrameEntry&, const JitterFrameEntry&) noexcept
     {
     }
+    void PrintJitterSummary(const JitterSummaryEntry&) noexcept
+    {
+    }
     void PrintErrorInfo(_In_z_ _Printf_format_string_ PCWSTR, ...) noexcept
     {
     }
@@ -164,6 +164,41 @@ namespace ctsUnitTest
 
             const ctsMediaStreamMessage round_trip(ctsMediaStreamMessage::Extract(test_task.m_buffer, test_task.m_bufferLength));
             Assert::AreEqual(MediaStreamAction::START, round_trip.m_action);
+            Assert::AreEqual('\0', round_trip.m_streamId[0]);
+        }
+
+        TEST_METHOD(ConstructMultiplexedStart)
+        {
+            static const char* stream_id = "00000000-0000-0000-0000-000000000001";
+            Assert::AreEqual(ctsStatistics::c_connectionIdLength - 1, static_cast<unsigned long>(::strlen(stream_id)));
+
+            char start_buffer[c_udpDatagramMultiplexedStartLength];
+            const ctsTask test_task(ctsMediaStreamMessage::ConstructMultiplexedStart(start_buffer, stream_id));
+            Assert::AreEqual(c_udpDatagramMultiplexedStartLength, test_task.m_bufferLength);
+            Assert::IsTrue(ctsMediaStreamMessage::IsMultiplexedStart(test_task.m_buffer, test_task.m_bufferLength));
+
+            const ctsMediaStreamMessage round_trip(ctsMediaStreamMessage::Extract(test_task.m_buffer, test_task.m_bufferLength));
+            Assert::AreEqual(MediaStreamAction::START, round_trip.m_action);
+            Assert::AreEqual(0, ::strcmp(stream_id, round_trip.m_streamId.data()));
+        }
+
+        TEST_METHOD(RejectMultiplexedStartWithoutTerminatedId)
+        {
+            static const char* stream_id = "00000000-0000-0000-0000-000000000001";
+            char start_buffer[c_udpDatagramMultiplexedStartLength];
+            const ctsTask test_task(ctsMediaStreamMessage::ConstructMultiplexedStart(start_buffer, stream_id));
+
+            // overwrite the terminating NUL
+            start_buffer[c_udpDatagramMultiplexedStartLength - 1] = 'X';
+            Assert::IsFalse(ctsMediaStreamMessage::IsMultiplexedStart(test_task.m_buffer, test_task.m_bufferLength));
+            Assert::ExpectException<wil::ResultException>([&]() {
+                (void)ctsMediaStreamMessage::Extract(test_task.m_buffer, test_task.m_bufferLength); });
+
+            // an empty ID is not a stream
+            start_buffer[c_udpDatagramMultiplexedStartLength - 1] = '\0';
+            start_buffer[c_udpDatagramStartStringLength] = '\0';
+            Assert::ExpectException<wil::ResultException>([&]() {
+                (void)ctsMediaStreamMessage::Extract(test_task.m_buffer, test_task.m_bufferLength); });
         }
 
     private:
@@ -115,6 +115,11 @@ namespace ctsTraffic
         Logger::WriteMessage(L"ctsIOPattern::ctsIOPattern\n");
     }
 
+    ctsIoPattern::~ctsIoPattern() noexcept
+    {
+        Logger::WriteMessage(L"ctsIOPattern::~ctsIOPattern\n");
+    }
+
     ctsTask ctsIoPattern::InitiateIo() noexcept
     {
         Logger::WriteMessage(L"ctsIOPattern::initiate_io\n");
@@ -238,7 +243,7 @@ namespace ctsTraffic
     }
 
     // one callout fake to ctsMediaStreamServerImpl
-    void ctsMediaStreamServerImpl::RemoveSocket(const ctl::ctSockaddr&)
+    void ctsMediaStreamServerImpl::RemoveSocket(const ctl::ctSockaddr&, const char*)
     {
     }
 }
@@ -89,6 +89,10 @@ namespace ctsTraffic::ctsConfig
     {
         return 0;
     }
+    ctsLoadProfileSetpoint UpdateLoadProfile() noexcept
+    {
+        return {};
+    }
 }
 
 ///
@@ -136,6 +140,17 @@ public:
                 [&](const std::weak_ptr<ctsSocketState>& weak_ptr) { return weak_ptr.expired(); }),
             std::end(m_stateObjects));
     }
+    void remove_object(const ctsSocketState* state_object) noexcept
+    {
+        const auto hold_lock = m_lock.lock();
+
+        m_stateObjects.erase(
+            std::remove_if(
+                std::begin(m_stateObjects),
+                std::end(m_stateObjects),
+                [&](const std::weak_ptr<ctsSocketState>& weak_ptr) { return weak_ptr.lock().get() == state_object; }),
+            std::end(m_stateObjects));
+    }
     void reset() noexcept
     {
         const auto hold_lock = m_lock.lock();
@@ -146,18 +161,53 @@ public:
     /// Interact with states of contained ctsSocketState objects
     void complete_state(DWORD error_code)
     {
-        const auto hold_lock = m_lock.lock();
+        // completing states calls back into the broker, which can be adding objects to this pool under its own lock
+        // - must not hold our lock while completing them
+        std::vector<std::shared_ptr<ctsSocketState>> state_objects;
+        {
+            const auto hold_lock = m_lock.lock();
 
-        for (auto& socket_state : m_stateObjects)
+            for (auto& socket_state : m_stateObjects)
+            {
+                auto shared_state(socket_state.lock());
+                Assert::IsNotNull(shared_state.get());
+                if (shared_state)
+                {
+                    state_objects.push_back(std::move(shared_state));
+                }
+            }
+        }
+
+        for (const auto& shared_state : state_objects)
         {
-            auto shared_state(socket_state.lock());
-            Assert::IsNotNull(shared_state.get());
-            if (shared_state)
+            shared_state->CompleteState(error_code);
+        }
+    }
+    // the broker deletes closed objects as soon as they close : only those not yet deleted can be checked
+    // - the broker can release its reference while we check : our reference can be the last one
+    //   so must not hold our lock when these are released
+    void validate_remaining_in_state(ctsSocketState::InternalState state)
+    {
+        std::vector<std::shared_ptr<ctsSocketState>> state_objects;
+        {
+            const auto hold_lock = m_lock.lock();
+
+            for (auto& socket_state : m_stateObjects)
             {
-                shared_state->CompleteState(error_code);
+                auto shared_state(socket_state.lock());
+                if (shared_state)
+                {
+                    state_objects.push_back(std::move(shared_state));
+                }
             }
         }
+
+        for (const auto& shared_state : state_objects)
+        {
+            Assert::AreEqual(state, shared_state->GetCurrentState());
+        }
     }
+
     void validate_expected_count(size_t count)
     {
         const auto hold_lock = m_lock.lock();
@@ -217,6 +267,14 @@ void ctsSocketState::Start() noexcept
     g_socketPool->add_object(this->shared_from_this());
 }
 
+void ctsSocketState::Reset() noexcept
+{
+    Assert::AreEqual(InternalState::Closed, m_state);
+    // no longer tracked until the broker Start()'s this object again
+    g_socketPool->remove_object(this);
+    m_state = InternalState::Creating;
+}
+
 void ctsSocketState::CompleteState(DWORD error_code) noexcept
 {
     if (NO_ERROR == error_code)
@@ -227,18 +285,19 @@ void ctsSocketState::CompleteState(DWORD error_code) noexcept
 
 // Skipping Connecting, since that state doesn't affect ctsSocketBroker
 
+            // updating the state before notifying the broker, as does ctsSocketState
             case InternalState::Creating:
             {
+                m_state = InternalState::InitiatingIo;
                 auto parent = m_broker.lock();
                 parent->InitiatingIo();
-                m_state = InternalState::InitiatingIo;
                 break;
             }
             case InternalState::InitiatingIo:
             {
+                m_state = InternalState::Closed;
                 auto parent = m_broker.lock();
                 parent->Closing(true);
-                m_state = InternalState::Closed;
                 break;
             }
 
@@ -250,9 +309,10 @@ void ctsSocketState::CompleteState(DWORD error_code) noexcept
     else
     {
      // move straight to Closed
-        auto parent = m_broker.lock();
-        parent->Closing(InternalState::InitiatingIo == m_state);
+        const bool was_active = InternalState::InitiatingIo == m_state;
         m_state = InternalState::Closed;
+        auto parent = m_broker.lock();
+        parent->Closing(was_active);
     }
 }
 
@@ -319,7 +379,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Closing sockets");
             g_socketPool->complete_state(NO_ERROR);
-            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -352,7 +412,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Closing sockets");
             g_socketPool->complete_state(NO_ERROR);
-            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -386,7 +446,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Closing sockets");
             g_socketPool->complete_state(NO_ERROR);
-            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -419,7 +479,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Closing sockets");
             g_socketPool->complete_state(NO_ERROR);
-            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -453,9 +513,10 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Closing sockets");
             g_socketPool->complete_state(NO_ERROR);
-            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Closed);
 
             Assert::IsFalse(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
+            // the broker refills as soon as the sockets close
+            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Creating);
             // let the timer fire
             Sleep(ctsSocketBroker::m_timerCallbackTimeoutMs);
             g_socketPool->validate_expected_count(1);
@@ -486,9 +547,10 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Closing sockets");
             g_socketPool->complete_state(NO_ERROR);
-            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Closed);
 
             Assert::IsFalse(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
+            // the broker refills as soon as the sockets close
+            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Creating);
             // let the timer fire
             Sleep(ctsSocketBroker::m_timerCallbackTimeoutMs);
             // should create the next socket to accept on the next Timer callback
@@ -517,7 +579,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Connecting sockets");
             g_socketPool->complete_state(WSAECONNREFUSED);
-            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -546,7 +608,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Connecting sockets");
             g_socketPool->complete_state(WSAECONNREFUSED);
-            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -576,7 +638,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Connecting sockets");
             g_socketPool->complete_state(WSAECONNREFUSED);
-            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -605,7 +667,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Connecting sockets");
             g_socketPool->complete_state(WSAECONNREFUSED);
-            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -639,7 +701,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Failing IO on sockets");
             g_socketPool->complete_state(WSAENOBUFS);
-            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -672,7 +734,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Failing IO on sockets");
             g_socketPool->complete_state(WSAENOBUFS);
-            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -706,7 +768,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Failing IO on sockets");
             g_socketPool->complete_state(WSAENOBUFS);
-            g_socketPool->validate_expected_count(1, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -739,7 +801,7 @@ namespace ctsUnitTest
 
             Logger::WriteMessage(L"Failing IO on sockets");
             g_socketPool->complete_state(WSAENOBUFS);
-            g_socketPool->validate_expected_count(100, ctsSocketState::InternalState::Closed);
+            g_socketPool->validate_remaining_in_state(ctsSocketState::InternalState::Closed);
 
             Assert::IsTrue(test_broker->Wait(ctsSocketBroker::m_timerCallbackTimeoutMs * 2));
             // let the timer fire
@@ -34,12 +34,30 @@ namespace ctsTraffic {
         Logger::WriteMessage(L"ctsIOPattern::MakeIOPattern\n");
         return nullptr;
     }
+    shared_ptr<ctsIoPattern> ctsIoPattern::MakeProbePattern()
+    {
+        Logger::WriteMessage(L"ctsIOPattern::MakeProbePattern\n");
+        return nullptr;
+    }
 
 	wsIOResult ctsSetLingertoResetSocket(SOCKET) noexcept
 	{
 		return wsIOResult();
 	}
 
+	namespace ctsLocalPorts {
+		void Release(unsigned short, bool) noexcept
+		{
+		}
+	}
+
+	namespace ctsSocketPool {
+		bool Recycle(SOCKET, std::shared_ptr<ctl::ctThreadIocp>, const ctl::ctSockaddr&) noexcept
+		{
+			return false;
+		}
+	}
+
 	namespace ctsConfig {
         ctsConfigSettings* g_configSettings;
 
@@ -111,6 +129,10 @@ namespace ctsTraffic {
         {
             return 0;
         }
+        std::shared_ptr<ctl::ctThreadIocp> CreateSocketThreadIocp(SOCKET socket)
+        {
+            return std::make_shared<ctl::ctThreadIocp>(socket, nullptr);
+        }
     }
 
     /// ctsSocketBroker stubs - when ctsSocketState calls out to update the broker
@@ -271,5 +293,55 @@ namespace ctsUnitTest {
 
             Assert::AreEqual(3L, ctl::ctMemoryGuardRead(&s_CallbackCount));
         }
+
+        TEST_METHOD(ResetAndRestart)
+        {
+            // the same object should walk all states again after being Reset
+            ResetStatics(0, 0, 0);
+
+            std::shared_ptr<ctsSocketState> test(std::make_shared<ctsSocketState>(std::weak_ptr<ctsSocketBroker>()));
+            test->Start();
+
+            do {
+                ::Sleep(100);
+            } while (ctsSocketState::InternalState::Closed != test->GetCurrentState());
+
+            Assert::AreEqual(3L, ctl::ctMemoryGuardRead(&s_CallbackCount));
+
+            test->Reset();
+            Assert::IsTrue(ctsSocketState::InternalState::Creating == test->GetCurrentState());
+
+            ResetStatics(0, 0, 1);
+            test->Start();
+
+            do {
+                ::Sleep(100);
+            } while (ctsSocketState::InternalState::Closed != test->GetCurrentState());
+
+            Assert::AreEqual(3L, ctl::ctMemoryGuardRead(&s_CallbackCount));
+        }
+
+        TEST_METHOD(InlineStateTransitions)
+        {
+            // connect and IO should run inline on the thread which completed the prior state
+            // - starting the connection and closing it are still queued to the threadpool
+            ResetStatics(0, 0, 0);
+            auto& transitionDetails = ctsConfig::g_configSettings->StateTransitionDetails;
+            const auto priorInline = transitionDetails.m_inlineTransitions.GetValue();
+            const auto priorQueued = transitionDetails.m_queuedTransitions.GetValue();
+            ctsConfig::g_configSettings->InlineStateTransitions = true;
+
+            std::shared_ptr<ctsSocketState> test(std::make_shared<ctsSocketState>(std::weak_ptr<ctsSocketBroker>()));
+            test->Start();
+
+            do {
+                ::Sleep(100);
+            } while (ctsSocketState::InternalState::Closed != test->GetCurrentState());
+
+            ctsConfig::g_configSettings->InlineStateTransitions = false;
+            Assert::AreEqual(3L, ctl::ctMemoryGuardRead(&s_CallbackCount));
+            Assert::AreEqual(2LL, transitionDetails.m_inlineTransitions.GetValue() - priorInline);
+            Assert::AreEqual(2LL, transitionDetails.m_queuedTransitions.GetValue() - priorQueued);
+        }
     };
 }
\ No newline at end of file
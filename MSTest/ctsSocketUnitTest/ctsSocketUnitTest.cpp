@@ -51,6 +51,11 @@ namespace ctsTraffic
         Logger::WriteMessage(L"ctsIOPattern::MakeIOPattern\n");
         return nullptr;
     }
+    shared_ptr<ctsIoPattern> ctsIoPattern::MakeProbePattern()
+    {
+        Logger::WriteMessage(L"ctsIOPattern::MakeProbePattern\n");
+        return nullptr;
+    }
 
     [[nodiscard]] wil::cs_leave_scope_exit ctsIoPattern::AcquireIoPatternLock() const noexcept
     {
@@ -67,6 +72,21 @@ namespace ctsTraffic
         return wsIOResult();
     }
 
+    namespace ctsLocalPorts
+    {
+        void Release(unsigned short, bool) noexcept
+        {
+        }
+    }
+
+    namespace ctsSocketPool
+    {
+        bool Recycle(SOCKET, std::shared_ptr<ctl::ctThreadIocp>, const ctl::ctSockaddr&) noexcept
+        {
+            return false;
+        }
+    }
+
     namespace ctsConfig
     {
         ctsConfigSettings* g_configSettings;
@@ -135,6 +155,10 @@ namespace ctsTraffic
         {
             return 0;
         }
+        std::shared_ptr<ctl::ctThreadIocp> CreateSocketThreadIocp(SOCKET socket)
+        {
+            return std::make_shared<ctl::ctThreadIocp>(socket, nullptr);
+        }
     }
 }
 ///
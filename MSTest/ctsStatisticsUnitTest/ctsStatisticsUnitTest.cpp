@@ -119,5 +119,235 @@ namespace ctsUnitTest
             ctsUdpStatistics udp_stats;
             ctsConnectionStatistics conn_stats;
         }
+
+        TEST_METHOD(ConnectionIdFormat)
+        {
+            char first_id[ctsStatistics::c_connectionIdLength];
+            char second_id[ctsStatistics::c_connectionIdLength];
+            ctsStatistics::FormatConnectionId(first_id);
+            ctsStatistics::FormatConnectionId(second_id);
+
+            for (const auto* connection_id : { first_id, second_id })
+            {
+                Assert::AreEqual(static_cast<size_t>(ctsStatistics::c_connectionIdLength - 1), strlen(connection_id));
+                // must parse as a UUID to stay compatible with the UuidToStringA form
+                UUID parsed_id;
+                Assert::AreEqual(RPC_S_OK, UuidFromStringA(reinterpret_cast<RPC_CSTR>(const_cast<char*>(connection_id)), &parsed_id));
+            }
+
+            // the per-process prefix is shared : the counter makes each ID unique
+            Assert::AreEqual(0, memcmp(first_id, second_id, 21));
+            Assert::AreNotEqual(0, strcmp(first_id, second_id));
+        }
+
+        TEST_METHOD(ShardedStatsTracking)
+        {
+            ctsShardedStatsTracking sharded_stats;
+            Assert::AreEqual(0LL, sharded_stats.GetValue());
+
+            sharded_stats.Add(100);
+            sharded_stats.Increment();
+            Assert::AreEqual(101LL, sharded_stats.GetValue());
+            Assert::AreEqual(101LL, sharded_stats.ReadValueDifference());
+            Assert::AreEqual(101LL, sharded_stats.SnapValueDifference());
+            Assert::AreEqual(0LL, sharded_stats.ReadValueDifference());
+
+            sharded_stats.Add(50);
+            Assert::AreEqual(151LL, sharded_stats.GetValue());
+            Assert::AreEqual(50LL, sharded_stats.SnapValueDifference());
+        }
+
+        TEST_METHOD(TcpStatusStatisticsSnapView)
+        {
+            ctsTcpStatusStatistics status_stats;
+            status_stats.m_bytesSent.Add(1000);
+            status_stats.m_bytesRecv.Add(2000);
+
+            const ctsTcpStatistics read_view(status_stats.SnapView(false));
+            Assert::AreEqual(1000LL, read_view.m_bytesSent.GetValue());
+            Assert::AreEqual(2000LL, read_view.m_bytesRecv.GetValue());
+
+            const ctsTcpStatistics snap_view(status_stats.SnapView(true));
+            Assert::AreEqual(1000LL, snap_view.m_bytesSent.GetValue());
+            Assert::AreEqual(2000LL, snap_view.m_bytesRecv.GetValue());
+
+            status_stats.m_bytesSent.Add(10);
+            const ctsTcpStatistics delta_view(status_stats.SnapView(true));
+            Assert::AreEqual(10LL, delta_view.m_bytesSent.GetValue());
+            Assert::AreEqual(0LL, delta_view.m_bytesRecv.GetValue());
+            // totals are still available for the summary
+            Assert::AreEqual(1010LL, status_stats.m_bytesSent.GetValue());
+        }
+
+        TEST_METHOD(TcpStatusStatisticsRioCompletionsPerDequeue)
+        {
+            ctsTcpStatusStatistics status_stats;
+            Assert::AreEqual(0.0, status_stats.SnapRioCompletionsPerDequeue(true));
+
+            status_stats.m_rioCompletions.Add(30);
+            status_stats.m_rioDequeues.Add(3);
+            Assert::AreEqual(10.0, status_stats.SnapRioCompletionsPerDequeue(false));
+            Assert::AreEqual(10.0, status_stats.SnapRioCompletionsPerDequeue(true));
+
+            status_stats.m_rioCompletions.Add(5);
+            status_stats.m_rioDequeues.Add(2);
+            Assert::AreEqual(2.5, status_stats.SnapRioCompletionsPerDequeue(true));
+        }
+
+        TEST_METHOD(LatencySnapshotBuckets)
+        {
+            // small durations have their own bucket
+            for (long long ticks = 0; ticks < 16; ++ticks)
+            {
+                Assert::AreEqual(ticks, ctsLatencySnapshot::BucketValue(ctsLatencySnapshot::BucketIndex(ticks)));
+            }
+            // every bucket counts durations within 1/16th of its value
+            for (long long ticks = 16; ticks < 0x100000; ticks += 7)
+            {
+                const auto bucketValue = ctsLatencySnapshot::BucketValue(ctsLatencySnapshot::BucketIndex(ticks));
+                Assert::IsTrue(bucketValue >= ticks);
+                Assert::IsTrue(bucketValue - ticks <= ticks / 16);
+            }
+            // buckets are contiguous and durations are clamped to the last bucket
+            Assert::AreEqual(ctsLatencySnapshot::BucketIndex(31) + 1, ctsLatencySnapshot::BucketIndex(32));
+            Assert::AreEqual(ctsLatencySnapshot::c_bucketCount - 1, ctsLatencySnapshot::BucketIndex(MAXLONGLONG));
+            Assert::AreEqual(0ul, ctsLatencySnapshot::BucketIndex(-1));
+        }
+
+        TEST_METHOD(LatencyHistogramSnapView)
+        {
+            // the histogram is too large to put on the test stack
+            const auto histogram = std::make_unique<ctsLatencyHistogram>();
+            for (long long ticks = 1; ticks <= 100; ++ticks)
+            {
+                histogram->Record(ticks);
+            }
+            histogram->Record(10000);
+
+            const auto snap_view = histogram->SnapView(true);
+            Assert::AreEqual(101LL, snap_view.GetCount());
+            Assert::AreEqual(1LL, snap_view.GetPercentile(0.5));
+            Assert::AreEqual(ctsLatencySnapshot::BucketValue(ctsLatencySnapshot::BucketIndex(51)), snap_view.GetPercentile(50.0));
+            Assert::AreEqual(ctsLatencySnapshot::BucketValue(ctsLatencySnapshot::BucketIndex(100)), snap_view.GetPercentile(99.0));
+            Assert::AreEqual(ctsLatencySnapshot::BucketValue(ctsLatencySnapshot::BucketIndex(10000)), snap_view.GetPercentile(100.0));
+            Assert::AreEqual(ctsLatencySnapshot::BucketValue(ctsLatencySnapshot::BucketIndex(10000)), snap_view.GetMaximum());
+
+            // the next view only has the durations recorded since the last snap
+            histogram->Record(5);
+            const auto delta_view = histogram->SnapView(true);
+            Assert::AreEqual(1LL, delta_view.GetCount());
+            Assert::AreEqual(5LL, delta_view.GetMaximum());
+            // totals are still available for the summary
+            Assert::AreEqual(102LL, histogram->GetTotal().GetCount());
+        }
+
+        TEST_METHOD(TcpInfoStatisticsSamples)
+        {
+            ctsTcpInfoStatistics connection_stats;
+            Assert::AreEqual(0UL, connection_stats.m_rttMicroseconds.GetMinimum());
+            Assert::AreEqual(0ULL, connection_stats.m_rttMicroseconds.GetAverage(connection_stats.m_sampleCount));
+
+            TCP_INFO_v0 tcp_info{};
+            tcp_info.RttUs = 100;
+            tcp_info.Cwnd = 1000;
+            tcp_info.BytesInFlight = 500;
+            tcp_info.BytesRetrans = 10;
+            connection_stats.AddSample(tcp_info);
+            tcp_info.RttUs = 300;
+            tcp_info.Cwnd = 3000;
+            tcp_info.BytesInFlight = 0;
+            tcp_info.BytesRetrans = 20;
+            connection_stats.AddSample(tcp_info);
+
+            Assert::AreEqual(2ULL, connection_stats.m_sampleCount);
+            Assert::AreEqual(100UL, connection_stats.m_rttMicroseconds.GetMinimum());
+            Assert::AreEqual(200ULL, connection_stats.m_rttMicroseconds.GetAverage(connection_stats.m_sampleCount));
+            Assert::AreEqual(300UL, connection_stats.m_rttMicroseconds.m_maximum);
+            Assert::AreEqual(0UL, connection_stats.m_bytesInFlight.GetMinimum());
+            Assert::AreEqual(3000UL, connection_stats.m_congestionWindow.m_maximum);
+            // retransmit counters are cumulative : only the latest sample is kept
+            Assert::AreEqual(20ULL, connection_stats.m_bytesRetransmitted);
+
+            ctsTcpStatusStatistics status_stats;
+            status_stats.MergeTcpInfo(connection_stats);
+            status_stats.MergeTcpInfo(connection_stats);
+            const auto summary = status_stats.GetTcpInfo();
+            Assert::AreEqual(4ULL, summary.m_sampleCount);
+            Assert::AreEqual(100UL, summary.m_rttMicroseconds.GetMinimum());
+            Assert::AreEqual(200ULL, summary.m_rttMicroseconds.GetAverage(summary.m_sampleCount));
+            Assert::AreEqual(40ULL, summary.m_bytesRetransmitted);
+        }
+
+        TEST_METHOD(ConnectionSamplesStalls)
+        {
+            ctsConnectionSamples samples;
+            Assert::AreEqual(0LL, samples.GetMinimumBytes());
+            Assert::AreEqual(0LL, samples.GetSampleCount());
+
+            samples.AddBytes(0, 100);
+            samples.AddBytes(0, 100);
+            // the partial interval in progress is not counted
+            Assert::AreEqual(0LL, samples.m_intervalCount);
+
+            // intervals 1 and 2 had no bytes
+            samples.AddBytes(3, 50);
+            Assert::AreEqual(3LL, samples.m_intervalCount);
+            Assert::AreEqual(0LL, samples.GetMinimumBytes());
+            Assert::AreEqual(200LL, samples.m_maximumBytes);
+            Assert::AreEqual(2LL, samples.m_stallCount);
+            Assert::AreEqual(2LL, samples.m_longestStall);
+
+            samples.AddBytes(4, 10);
+            Assert::AreEqual(4LL, samples.GetSampleCount());
+            Assert::AreEqual(200LL, samples.GetSample(0));
+            Assert::AreEqual(0LL, samples.GetSample(1));
+            Assert::AreEqual(0LL, samples.GetSample(2));
+            Assert::AreEqual(50LL, samples.GetSample(3));
+            Assert::AreEqual(0LL, samples.m_currentStall);
+        }
+
+        TEST_METHOD(ConnectionSamplesRingWraps)
+        {
+            ctsConnectionSamples samples;
+            for (long long interval = 0; interval < ctsConnectionSamples::c_ringSize + 5; ++interval)
+            {
+                samples.AddBytes(interval, interval + 1);
+            }
+            // only the most recent intervals are held, oldest first
+            Assert::AreEqual(ctsConnectionSamples::c_ringSize + 4, samples.m_intervalCount);
+            Assert::AreEqual(ctsConnectionSamples::c_ringSize, samples.GetSampleCount());
+            Assert::AreEqual(5LL, samples.GetSample(0));
+            Assert::AreEqual(ctsConnectionSamples::c_ringSize + 4, samples.GetSample(ctsConnectionSamples::c_ringSize - 1));
+            Assert::AreEqual(1LL, samples.GetMinimumBytes());
+            Assert::AreEqual(0LL, samples.m_stallCount);
+
+            // a stall longer than the ring only leaves zeros in the ring, but is fully counted
+            samples.AddBytes(ctsConnectionSamples::c_ringSize * 3, 1);
+            const long long stalled = ctsConnectionSamples::c_ringSize * 3 - (ctsConnectionSamples::c_ringSize + 4) - 1;
+            Assert::AreEqual(ctsConnectionSamples::c_ringSize * 3, samples.m_intervalCount);
+            Assert::AreEqual(stalled, samples.m_stallCount);
+            Assert::AreEqual(stalled, samples.m_longestStall);
+            Assert::AreEqual(0LL, samples.GetMinimumBytes());
+            Assert::AreEqual(0LL, samples.GetSample(0));
+            Assert::AreEqual(0LL, samples.GetSample(ctsConnectionSamples::c_ringSize - 1));
+        }
+
+        TEST_METHOD(UdpStatusStatisticsSnapView)
+        {
+            ctsUdpStatusStatistics status_stats;
+            status_stats.m_bitsReceived.Add(800);
+            status_stats.m_successfulFrames.Increment();
+            status_stats.m_droppedFrames.Add(2);
+
+            const ctsUdpStatistics snap_view(status_stats.SnapView(true));
+            Assert::AreEqual(100LL, snap_view.GetBytesReceived());
+            Assert::AreEqual(1LL, snap_view.m_successfulFrames.GetValue());
+            Assert::AreEqual(2LL, snap_view.m_droppedFrames.GetValue());
+            Assert::AreEqual(0LL, snap_view.m_duplicateFrames.GetValue());
+
+            const ctsUdpStatistics delta_view(status_stats.SnapView(true));
+            Assert::AreEqual(0LL, delta_view.GetBytesReceived());
+            Assert::AreEqual(100LL, status_stats.GetBytesReceived());
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,252 @@
+#
+#
+# Copyright (c) Microsoft Corporation
+# All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+#
+# See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+#
+#
+
+<#
+.SYNOPSIS
+Runs a matrix of ctsTraffic client configurations back to back, writes the results as JSON,
+and optionally compares them against a baseline results file to detect regressions.
+
+.DESCRIPTION
+Each configuration in the matrix is run (WarmupRuns + Repetitions) times; warmup runs are discarded.
+Every run writes a csv status file (-StatusFilename) which is parsed for the per-TimeSlice send and
+recv rates and, with -LatencyPercentiles, the IO latency percentiles. The first WarmUpMs of each run are
+excluded from the samples, and the mean of the remaining TimeSlices is one sample for that run.
+
+A configuration regresses against the baseline when its mean throughput dropped (or its mean latency
+rose) by more than ThresholdPercent AND Welch's t statistic of the two sets of samples exceeds
+TCritical - a difference within the run-to-run noise is not reported.
+
+The script exits with 1 when any configuration regressed or any run failed, 0 otherwise.
+
+.EXAMPLE
+# on the server
+ctsTraffic.exe -listen:* -pattern:push -transfer:0xffffffffffffffff
+# on the client
+.\ctsTraffic_benchmark.ps1 -Matrix .\ctsTraffic_benchmark_matrix.json -Target server01 -ResultsFile .\new.json -Baseline .\baseline.json
+
+.EXAMPLE
+# both sides on this machine - the listener for each configuration is started and stopped by the script
+.\ctsTraffic_benchmark.ps1 -Matrix .\ctsTraffic_benchmark_matrix.json -Target localhost -StartServer -ResultsFile .\baseline.json
+#>
+
+param(
+    [Parameter(Mandatory = $true)] [string] $Matrix,
+    [Parameter(Mandatory = $true)] [string] $Target,
+    [Parameter(Mandatory = $true)] [string] $ResultsFile,
+    [string] $Baseline = "",
+    [string] $CtsTraffic = ".\ctsTraffic.exe",
+    [switch] $StartServer
+)
+
+Set-StrictMode -Version Latest
+$ErrorActionPreference = "Stop"
+
+function Get-MatrixValue($object, [string] $name, $default) {
+    if ($null -ne $object -and $object.PSObject.Properties.Name -contains $name) {
+        return $object.$name
+    }
+    return $default
+}
+
+function Get-Mean([double[]] $values) {
+    if ($values.Count -eq 0) { return 0.0 }
+    return ($values | Measure-Object -Average).Average
+}
+
+function Get-StandardDeviation([double[]] $values) {
+    if ($values.Count -lt 2) { return 0.0 }
+    $mean = Get-Mean $values
+    $sumOfSquares = 0.0
+    foreach ($value in $values) { $sumOfSquares += ($value - $mean) * ($value - $mean) }
+    return [Math]::Sqrt($sumOfSquares / ($values.Count - 1))
+}
+
+# Welch's t statistic - tolerates the two sets of samples having different variances and counts
+function Get-WelchT([double[]] $baseline, [double[]] $current) {
+    if ($baseline.Count -lt 2 -or $current.Count -lt 2) { return [double]::PositiveInfinity }
+    $baselineSd = Get-StandardDeviation $baseline
+    $currentSd = Get-StandardDeviation $current
+    $standardError = [Math]::Sqrt(($baselineSd * $baselineSd / $baseline.Count) + ($currentSd * $currentSd / $current.Count))
+    if ($standardError -eq 0.0) { return [double]::PositiveInfinity }
+    return [Math]::Abs((Get-Mean $current) - (Get-Mean $baseline)) / $standardError
+}
+
+# returns the TimeSlice rows of a csv status file, skipping anything written before the csv header
+function Read-StatusFile([string] $path) {
+    $lines = Get-Content -Path $path
+    $headerIndex = -1
+    for ($i = 0; $i -lt $lines.Count; ++$i) {
+        if ($lines[$i].StartsWith("TimeSlice,")) { $headerIndex = $i; break }
+    }
+    if ($headerIndex -lt 0) { return @() }
+    return @($lines[$headerIndex..($lines.Count - 1)] | ConvertFrom-Csv)
+}
+
+function Invoke-Run($configuration, [int] $timeLimitMs, [int] $warmUpMs, [string] $percentiles, [string] $statusFile) {
+    Remove-Item -Path $statusFile -ErrorAction SilentlyContinue
+
+    $server = $null
+    if ($StartServer) {
+        $serverArguments = "-listen:* -ConsoleVerbosity:0 " + (Get-MatrixValue $configuration "serverArguments" "")
+        $server = Start-Process -FilePath $CtsTraffic -ArgumentList $serverArguments -PassThru -WindowStyle Hidden
+        Start-Sleep -Milliseconds 1000
+    }
+
+    try {
+        # latency percentiles are only collected for TCP - a configuration can set "latencyPercentiles": "" to not request them
+        $clientArguments = "-target:$Target -ConsoleVerbosity:0 -TimeLimit:$timeLimitMs -StatusUpdate:1000 -StatusFilename:$statusFile "
+        if ($percentiles -ne "") {
+            $clientArguments += "-LatencyPercentiles:$percentiles "
+        }
+        $clientArguments += $configuration.arguments
+        $client = Start-Process -FilePath $CtsTraffic -ArgumentList $clientArguments -PassThru -Wait -NoNewWindow
+        $exitCode = $client.ExitCode
+    }
+    finally {
+        if ($null -ne $server -and -not $server.HasExited) {
+            Stop-Process -Id $server.Id -Force
+        }
+    }
+
+    $rows = @(Read-StatusFile $statusFile | Where-Object { [double]$_.TimeSlice * 1000.0 -gt $warmUpMs })
+    $firstPercentile = "p" + ($percentiles -split ",")[0] + "us"
+    $lastPercentile = "p" + ($percentiles -split ",")[-1] + "us"
+
+    $run = [ordered]@{
+        exitCode = $exitCode
+        timeSlices = $rows.Count
+        bytesPerSecond = 0.0
+        latencyLowUs = 0.0
+        latencyHighUs = 0.0
+    }
+    if ($rows.Count -gt 0) {
+        # UDP status files report Bits/Sec for the received stream instead of SendBps and RecvBps
+        $bitsColumn = $rows[0].PSObject.Properties.Name -contains "Bits/Sec"
+        if ($bitsColumn) {
+            $run.bytesPerSecond = Get-Mean @($rows | ForEach-Object { [double]$_."Bits/Sec" / 8.0 })
+        }
+        else {
+            $run.bytesPerSecond = Get-Mean @($rows | ForEach-Object { [double]$_.SendBps + [double]$_.RecvBps })
+        }
+        # the latency columns are only present when the client ran TCP IO with -LatencyPercentiles
+        if ($percentiles -ne "" -and $rows[0].PSObject.Properties.Name -contains $lastPercentile) {
+            $run.latencyLowUs = Get-Mean @($rows | ForEach-Object { [double]$_.$firstPercentile })
+            $run.latencyHighUs = Get-Mean @($rows | ForEach-Object { [double]$_.$lastPercentile })
+        }
+    }
+    return $run
+}
+
+$matrixJson = Get-Content -Path $Matrix -Raw | ConvertFrom-Json
+$defaults = Get-MatrixValue $matrixJson "defaults" $null
+$repetitions = [int](Get-MatrixValue $defaults "repetitions" 5)
+$warmupRuns = [int](Get-MatrixValue $defaults "warmupRuns" 1)
+$timeLimitMs = [int](Get-MatrixValue $defaults "timeLimitMs" 30000)
+$warmUpMs = [int](Get-MatrixValue $defaults "warmUpMs" 5000)
+$percentiles = [string](Get-MatrixValue $defaults "latencyPercentiles" "50,99")
+$thresholdPercent = [double](Get-MatrixValue $defaults "thresholdPercent" 5.0)
+$tCritical = [double](Get-MatrixValue $defaults "tCritical" 2.0)
+
+$statusFile = Join-Path ([System.IO.Path]::GetTempPath()) "ctsTraffic_benchmark_status.csv"
+$anyFailure = $false
+
+$results = [ordered]@{
+    timestamp = (Get-Date).ToUniversalTime().ToString("o")
+    computer = $env:COMPUTERNAME
+    osVersion = [Environment]::OSVersion.Version.ToString()
+    ctsTrafficVersion = (Get-Item -Path $CtsTraffic).VersionInfo.FileVersion
+    target = $Target
+    configurations = @()
+}
+
+foreach ($configuration in $matrixJson.configurations) {
+    $configRepetitions = [int](Get-MatrixValue $configuration "repetitions" $repetitions)
+    $configTimeLimitMs = [int](Get-MatrixValue $configuration "timeLimitMs" $timeLimitMs)
+    $configWarmUpMs = [int](Get-MatrixValue $configuration "warmUpMs" $warmUpMs)
+    $configPercentiles = [string](Get-MatrixValue $configuration "latencyPercentiles" $percentiles)
+
+    for ($i = 0; $i -lt $warmupRuns; ++$i) {
+        Write-Host "[$($configuration.name)] warmup run $($i + 1) of $warmupRuns"
+        $null = Invoke-Run $configuration $configTimeLimitMs $configWarmUpMs $configPercentiles $statusFile
+    }
+
+    $runs = @()
+    for ($i = 0; $i -lt $configRepetitions; ++$i) {
+        Write-Host "[$($configuration.name)] run $($i + 1) of $configRepetitions"
+        $run = Invoke-Run $configuration $configTimeLimitMs $configWarmUpMs $configPercentiles $statusFile
+        if ($run.exitCode -ne 0 -or $run.timeSlices -eq 0) {
+            Write-Host "[$($configuration.name)] run $($i + 1) failed : exit code $($run.exitCode), $($run.timeSlices) TimeSlices"
+            $anyFailure = $true
+        }
+        $runs += [pscustomobject]$run
+    }
+
+    $bytesPerSecond = [double[]]@($runs | ForEach-Object { $_.bytesPerSecond })
+    $latencyHighUs = [double[]]@($runs | ForEach-Object { $_.latencyHighUs })
+    $results.configurations += [ordered]@{
+        name = $configuration.name
+        arguments = $configuration.arguments
+        runs = $runs
+        bytesPerSecond = [ordered]@{ mean = (Get-Mean $bytesPerSecond); stddev = (Get-StandardDeviation $bytesPerSecond); samples = $bytesPerSecond }
+        latencyHighUs = [ordered]@{ mean = (Get-Mean $latencyHighUs); stddev = (Get-StandardDeviation $latencyHighUs); samples = $latencyHighUs }
+    }
+}
+
+Remove-Item -Path $statusFile -ErrorAction SilentlyContinue
+$results | ConvertTo-Json -Depth 6 | Set-Content -Path $ResultsFile
+Write-Host "Results written to $ResultsFile"
+
+$anyRegression = $false
+if ($Baseline -ne "") {
+    $baselineJson = Get-Content -Path $Baseline -Raw | ConvertFrom-Json
+    Write-Host ""
+    Write-Host ("{0,-32} {1,16} {2,16} {3,9} {4,8}  {5}" -f "Configuration", "Baseline", "Current", "Change%", "t", "Result")
+
+    foreach ($current in $results.configurations) {
+        $prior = @($baselineJson.configurations | Where-Object { $_.name -eq $current.name })
+        if ($prior.Count -eq 0) {
+            Write-Host ("{0,-32} not in the baseline" -f $current.name)
+            continue
+        }
+        $prior = $prior[0]
+
+        # throughput regresses when it drops, latency regresses when it rises
+        $comparisons = @(
+            @{ metric = "bytes/sec"; baseline = [double[]]@($prior.bytesPerSecond.samples); current = $current.bytesPerSecond.samples; higherIsBetter = $true },
+            @{ metric = "p" + ($percentiles -split ",")[-1] + " us"; baseline = [double[]]@($prior.latencyHighUs.samples); current = $current.latencyHighUs.samples; higherIsBetter = $false }
+        )
+        foreach ($comparison in $comparisons) {
+            $baselineMean = Get-Mean $comparison.baseline
+            $currentMean = Get-Mean $comparison.current
+            if ($baselineMean -eq 0.0) { continue }
+
+            $changePercent = ($currentMean - $baselineMean) / $baselineMean * 100.0
+            $t = Get-WelchT $comparison.baseline $comparison.current
+            $worse = if ($comparison.higherIsBetter) { -$changePercent } else { $changePercent }
+            $result = "ok"
+            if ($worse -gt $thresholdPercent -and $t -gt $tCritical) {
+                $result = "REGRESSION"
+                $anyRegression = $true
+            }
+            elseif (-$worse -gt $thresholdPercent -and $t -gt $tCritical) {
+                $result = "improved"
+            }
+            Write-Host ("{0,-32} {1,16:N0} {2,16:N0} {3,9:N2} {4,8:N2}  {5}" -f "$($current.name) $($comparison.metric)", $baselineMean, $currentMean, $changePercent, $t, $result)
+        }
+    }
+}
+
+if ($anyRegression -or $anyFailure) {
+    exit 1
+}
+exit 0
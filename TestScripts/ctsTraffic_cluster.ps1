@@ -0,0 +1,367 @@
+#
+#
+# Copyright (c) Microsoft Corporation
+# All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+#
+# See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+#
+#
+
+
+<#
+.SYNOPSIS
+Runs ctsTraffic clients on many machines as one test: a controller pushes the client arguments to N agents,
+starts them at the same instant, and prints merged status and summary lines for the whole cluster.
+
+.DESCRIPTION
+Each client machine runs this script with -Agent, listening for a controller on a control TCP connection.
+The controller connects to every agent and exchanges one JSON message per line with each:
+
+  time   : the controller samples each agent's clock (keeping the sample with the lowest round trip)
+           to compute the agent's clock offset, so skewed clocks do not skew the start
+  start  : the client arguments and the instant to start, converted to the agent's clock
+  status : each row of the agent's csv -StatusFilename, streamed back as ctsTraffic writes it
+  done   : the agent's exit code, its console output, and its -HistogramFilename buckets
+
+Since every agent starts at the same instant, the TimeSlice of every agent's status rows (seconds since it started)
+line up: the controller prints one merged line per TimeSlice once every running agent has reported it,
+summing SendBps, RecvBps, In-Flight, Completed, NetError and DataError across the cluster.
+
+When -LatencyPercentiles is in the arguments, the agents also write -HistogramFilename. The controller adds the counts
+of equal buckets from every agent, so the cluster-wide latency percentiles are exact, not averages of percentiles.
+
+The controller exits with 1 when any agent failed, was lost, or ctsTraffic exited with an error; 0 otherwise.
+
+.EXAMPLE
+# on every client machine
+.\ctsTraffic_cluster.ps1 -Agent -CtsTraffic C:\tools\ctsTraffic.exe
+# on the controller
+.\ctsTraffic_cluster.ps1 -Agents client01,client02,client03:4500 -Arguments "-target:server01 -pattern:push -connections:64 -TimeLimit:60000 -LatencyPercentiles:50,99,99.9" -ResultsFile .\cluster.json
+#>
+
+[CmdletBinding(DefaultParameterSetName = "Controller")]
+param(
+    [Parameter(ParameterSetName = "Agent", Mandatory = $true)] [switch] $Agent,
+    [Parameter(ParameterSetName = "Controller", Mandatory = $true)] [string[]] $Agents,
+    [Parameter(ParameterSetName = "Controller", Mandatory = $true)] [string] $Arguments,
+    [Parameter(ParameterSetName = "Controller")] [int] $StartDelayMs = 5000,
+    [Parameter(ParameterSetName = "Controller")] [int] $StatusUpdateMs = 1000,
+    [Parameter(ParameterSetName = "Controller")] [string] $ResultsFile = "",
+    [int] $Port = 4445,
+    [string] $CtsTraffic = ".\ctsTraffic.exe"
+)
+
+Set-StrictMode -Version Latest
+$ErrorActionPreference = "Stop"
+
+$statusColumns = @("SendBps", "RecvBps", "In-Flight", "Completed", "NetError", "DataError")
+
+function Send-Message([System.IO.StreamWriter] $writer, $message) {
+    $writer.WriteLine(($message | ConvertTo-Json -Depth 6 -Compress))
+    $writer.Flush()
+}
+
+function Receive-Message([System.IO.StreamReader] $reader) {
+    $line = $reader.ReadLine()
+    if ($null -eq $line) { throw "the control connection was closed" }
+    return $line | ConvertFrom-Json
+}
+
+# returns the complete lines appended to a file ctsTraffic is still writing
+# - $state.pending holds a trailing partial line until the rest of it is written
+function Read-NewLines([System.IO.StreamReader] $reader, $state) {
+    $text = $state.pending + $reader.ReadToEnd()
+    $lines = $text -split "`r?`n"
+    $state.pending = $lines[-1]
+    if ($lines.Count -le 1) { return @() }
+    return @($lines[0..($lines.Count - 2)] | Where-Object { $_ -ne "" })
+}
+
+function Open-SharedReader([string] $path) {
+    $stream = [System.IO.FileStream]::new($path, [System.IO.FileMode]::Open, [System.IO.FileAccess]::Read, [System.IO.FileShare]::ReadWrite -bor [System.IO.FileShare]::Delete)
+    return [System.IO.StreamReader]::new($stream)
+}
+
+# the highest bucket the percentile [0.0 - 100.0] of durations are at or below - matching ctsLatencySnapshot::GetPercentile
+function Get-HistogramPercentile($buckets, [double] $percentile) {
+    $count = 0L
+    foreach ($bucket in $buckets) { $count += $bucket.Value }
+    if ($count -eq 0) { return 0 }
+    $threshold = [Math]::Max(1L, [long][Math]::Ceiling($percentile / 100.0 * $count))
+    $cumulative = 0L
+    foreach ($bucket in $buckets) {
+        $cumulative += $bucket.Value
+        if ($cumulative -ge $threshold) { return $bucket.Key }
+    }
+    return $buckets[-1].Key
+}
+
+function Invoke-AgentSession([System.Net.Sockets.TcpClient] $controller) {
+    $stream = $controller.GetStream()
+    $reader = [System.IO.StreamReader]::new($stream)
+    $writer = [System.IO.StreamWriter]::new($stream)
+
+    $message = Receive-Message $reader
+    while ($message.type -eq "time") {
+        Send-Message $writer @{ type = "time"; agentUtcTicks = [DateTime]::UtcNow.Ticks }
+        $message = Receive-Message $reader
+    }
+    if ($message.type -ne "start") { throw "unexpected control message '$($message.type)'" }
+
+    $tempPath = [System.IO.Path]::GetTempPath()
+    $statusFile = Join-Path $tempPath "ctsTraffic_cluster_status.csv"
+    $histogramFile = Join-Path $tempPath "ctsTraffic_cluster_histogram.csv"
+    $outputFile = Join-Path $tempPath "ctsTraffic_cluster_output.txt"
+    Remove-Item -Path $statusFile, $histogramFile, $outputFile -ErrorAction SilentlyContinue
+
+    $clientArguments = "$($message.arguments) -StatusUpdate:$($message.statusUpdateMs) -StatusFilename:$statusFile"
+    if ($message.arguments -match "-LatencyPercentiles:") {
+        $clientArguments += " -HistogramFilename:$histogramFile"
+    }
+
+    $waitMs = [long](($message.startAtUtcTicks - [DateTime]::UtcNow.Ticks) / [TimeSpan]::TicksPerMillisecond)
+    if ($waitMs -gt 0) { Start-Sleep -Milliseconds $waitMs }
+    Write-Host "Starting at $([DateTime]::UtcNow.ToString('o')) : $CtsTraffic $clientArguments"
+    $client = Start-Process -FilePath $CtsTraffic -ArgumentList $clientArguments -PassThru -NoNewWindow -RedirectStandardOutput $outputFile
+
+    try {
+        $statusReader = $null
+        $statusState = @{ pending = "" }
+        $header = $null
+        while ($true) {
+            $exited = $client.WaitForExit(250)
+            if ($null -eq $statusReader -and (Test-Path -Path $statusFile)) {
+                $statusReader = Open-SharedReader $statusFile
+            }
+            if ($null -ne $statusReader) {
+                foreach ($line in (Read-NewLines $statusReader $statusState)) {
+                    # anything before the csv header (the legend) is skipped
+                    if ($null -eq $header) {
+                        if ($line.StartsWith("TimeSlice,")) { $header = $line -split "," }
+                        continue
+                    }
+                    $values = $line -split ","
+                    $row = [ordered]@{}
+                    for ($i = 0; $i -lt [Math]::Min($header.Count, $values.Count); ++$i) { $row[$header[$i]] = $values[$i] }
+                    Send-Message $writer @{ type = "status"; row = $row }
+                }
+            }
+            if ($exited) { break }
+        }
+        if ($null -ne $statusReader) { $statusReader.Dispose() }
+
+        $histogram = @()
+        if (Test-Path -Path $histogramFile) {
+            $histogram = @(Get-Content -Path $histogramFile | ConvertFrom-Csv | ForEach-Object {
+                @{ histogram = $_.Histogram; bucketUs = [long]$_.BucketMaxMicroseconds; count = [long]$_.Count }
+            })
+        }
+        $output = if (Test-Path -Path $outputFile) { Get-Content -Path $outputFile -Raw } else { "" }
+        Send-Message $writer @{ type = "done"; exitCode = $client.ExitCode; output = $output; histogram = $histogram }
+    }
+    finally {
+        if (-not $client.HasExited) {
+            # the controller went away mid-run
+            Stop-Process -Id $client.Id -Force
+        }
+    }
+}
+
+if ($Agent) {
+    $listener = [System.Net.Sockets.TcpListener]::new([System.Net.IPAddress]::IPv6Any, $Port)
+    $listener.Server.DualMode = $true
+    $listener.Start()
+    Write-Host "Agent listening on port $Port"
+    while ($true) {
+        $controller = $listener.AcceptTcpClient()
+        Write-Host "Controller connected from $($controller.Client.RemoteEndPoint)"
+        try {
+            Invoke-AgentSession $controller
+        }
+        catch {
+            Write-Host "Session failed : $_"
+        }
+        finally {
+            $controller.Dispose()
+        }
+    }
+}
+
+#
+# Controller
+#
+$sessions = @()
+foreach ($agentName in $Agents) {
+    $hostName = $agentName
+    $agentPort = $Port
+    if ($agentName -match "^(.+):(\d+)$") {
+        $hostName = $Matches[1]
+        $agentPort = [int]$Matches[2]
+    }
+    $connection = [System.Net.Sockets.TcpClient]::new()
+    $connection.Connect($hostName, $agentPort)
+    $stream = $connection.GetStream()
+    $sessions += [pscustomobject]@{
+        name = $agentName
+        connection = $connection
+        reader = [System.IO.StreamReader]::new($stream)
+        writer = [System.IO.StreamWriter]::new($stream)
+        offsetTicks = 0L
+        pendingRead = $null
+        rows = @{}
+        lastTimeSlice = -1.0
+        done = $null
+    }
+}
+
+# clock offsets : the agent's clock minus the controller's, from the sample with the lowest round trip
+foreach ($session in $sessions) {
+    $bestRoundTrip = [long]::MaxValue
+    for ($i = 0; $i -lt 5; ++$i) {
+        $sent = [DateTime]::UtcNow.Ticks
+        Send-Message $session.writer @{ type = "time" }
+        $reply = Receive-Message $session.reader
+        $received = [DateTime]::UtcNow.Ticks
+        if ($received - $sent -lt $bestRoundTrip) {
+            $bestRoundTrip = $received - $sent
+            $session.offsetTicks = [long]$reply.agentUtcTicks - ($sent + ($received - $sent) / 2)
+        }
+    }
+    Write-Host ("{0} : clock offset {1:N3} ms (round trip {2:N3} ms)" -f $session.name, ($session.offsetTicks / 10000.0), ($bestRoundTrip / 10000.0))
+}
+
+$startAt = [DateTime]::UtcNow.Ticks + [long]$StartDelayMs * [TimeSpan]::TicksPerMillisecond
+foreach ($session in $sessions) {
+    Send-Message $session.writer @{ type = "start"; arguments = $Arguments; statusUpdateMs = $StatusUpdateMs; startAtUtcTicks = $startAt + $session.offsetTicks }
+}
+Write-Host "Starting $($sessions.Count) agents at $([DateTime]::new($startAt, [DateTimeKind]::Utc).ToString('o'))"
+Write-Host ""
+Write-Host ("{0,10} {1,16} {2,16} {3,10} {4,10} {5,9} {6,9} {7,7}" -f "TimeSlice", "SendBps", "RecvBps", "In-Flight", "Completed", "NetError", "DataError", "Agents")
+
+$merged = @()
+$printedThrough = -1.0
+$anyFailure = $false
+while (@($sessions | Where-Object { $null -eq $_.done }).Count -gt 0) {
+    $anyProgress = $false
+    foreach ($session in @($sessions | Where-Object { $null -eq $_.done })) {
+        if ($null -eq $session.pendingRead) {
+            $session.pendingRead = $session.reader.ReadLineAsync()
+        }
+        if (-not $session.pendingRead.IsCompleted) { continue }
+
+        $anyProgress = $true
+        $line = $null
+        try { $line = $session.pendingRead.Result } catch { $line = $null }
+        $session.pendingRead = $null
+        if ($null -eq $line) {
+            Write-Host "$($session.name) : the control connection was lost"
+            $session.done = [pscustomobject]@{ exitCode = -1; output = ""; histogram = @() }
+            $anyFailure = $true
+            continue
+        }
+
+        $message = $line | ConvertFrom-Json
+        if ($message.type -eq "status") {
+            $timeSlice = [double]$message.row.TimeSlice
+            $session.rows[$timeSlice] = $message.row
+            $session.lastTimeSlice = $timeSlice
+        }
+        elseif ($message.type -eq "done") {
+            $session.done = $message
+            if ($message.exitCode -ne 0) { $anyFailure = $true }
+        }
+    }
+
+    # a TimeSlice is printed once every agent still running has reported it
+    $running = @($sessions | Where-Object { $null -eq $_.done })
+    $allTimeSlices = @($sessions | ForEach-Object { $_.rows.Keys } | Sort-Object -Unique | Where-Object { $_ -gt $printedThrough })
+    foreach ($timeSlice in $allTimeSlices) {
+        if (@($running | Where-Object { $_.lastTimeSlice -lt $timeSlice }).Count -gt 0) { break }
+
+        $line = [ordered]@{ TimeSlice = $timeSlice }
+        foreach ($column in $statusColumns) { $line[$column] = 0.0 }
+        $reporting = 0
+        foreach ($session in $sessions) {
+            if (-not $session.rows.ContainsKey($timeSlice)) { continue }
+            ++$reporting
+            foreach ($column in $statusColumns) {
+                if ($session.rows[$timeSlice].PSObject.Properties.Name -contains $column) {
+                    $line[$column] += [double]$session.rows[$timeSlice].$column
+                }
+            }
+        }
+        $line["Agents"] = $reporting
+        $merged += [pscustomobject]$line
+        $printedThrough = $timeSlice
+        Write-Host ("{0,10:N3} {1,16:N0} {2,16:N0} {3,10:N0} {4,10:N0} {5,9:N0} {6,9:N0} {7,7}" -f `
+            $timeSlice, $line.SendBps, $line.RecvBps, $line["In-Flight"], $line.Completed, $line.NetError, $line.DataError, $reporting)
+    }
+
+    if (-not $anyProgress) { Start-Sleep -Milliseconds 50 }
+}
+
+Write-Host ""
+foreach ($session in $sessions) {
+    Write-Host "$($session.name) : exit code $($session.done.exitCode)"
+    $session.connection.Dispose()
+}
+
+# cluster-wide throughput is the mean of the merged TimeSlices in which every agent reported
+$fullSlices = @($merged | Where-Object { $_.Agents -eq $sessions.Count })
+$sendBps = if ($fullSlices.Count -gt 0) { ($fullSlices | Measure-Object -Property SendBps -Average).Average } else { 0.0 }
+$recvBps = if ($fullSlices.Count -gt 0) { ($fullSlices | Measure-Object -Property RecvBps -Average).Average } else { 0.0 }
+Write-Host ""
+Write-Host ("  Cluster Send Rate : {0:N0} bytes/sec" -f $sendBps)
+Write-Host ("  Cluster Recv Rate : {0:N0} bytes/sec" -f $recvBps)
+Write-Host ("  Cluster Completed : {0:N0} connections ({1:N0} network errors, {2:N0} data errors)" -f `
+    ($merged | Measure-Object -Property Completed -Sum).Sum, ($merged | Measure-Object -Property NetError -Sum).Sum, ($merged | Measure-Object -Property DataError -Sum).Sum)
+
+$percentiles = @(50.0, 90.0, 99.0)
+if ($Arguments -match "-LatencyPercentiles:([0-9.,]+)") {
+    $percentiles = @($Matches[1] -split "," | ForEach-Object { [double]$_ })
+}
+$histograms = [ordered]@{}
+foreach ($session in $sessions) {
+    foreach ($bucket in @($session.done.histogram)) {
+        if (-not $histograms.Contains($bucket.histogram)) { $histograms[$bucket.histogram] = @{} }
+        $buckets = $histograms[$bucket.histogram]
+        $buckets[[long]$bucket.bucketUs] = [long]($buckets[[long]$bucket.bucketUs]) + [long]$bucket.count
+    }
+}
+$latency = [ordered]@{}
+foreach ($name in $histograms.Keys) {
+    $sorted = @($histograms[$name].GetEnumerator() | Sort-Object -Property Key)
+    $latency[$name] = [ordered]@{}
+    $text = ""
+    foreach ($percentile in $percentiles) {
+        $value = Get-HistogramPercentile $sorted $percentile
+        $latency[$name]["p$percentile"] = $value
+        $text += "p$percentile [$value]  "
+    }
+    $latency[$name]["max"] = $sorted[-1].Key
+    $count = ($sorted | Measure-Object -Property Value -Sum).Sum
+    Write-Host ("  Cluster {0} Latency (us) : {1}Max [{2}]  ({3} samples)" -f $name, $text, $sorted[-1].Key, $count)
+}
+
+if ($ResultsFile -ne "") {
+    $results = [ordered]@{
+        timestamp = (Get-Date).ToUniversalTime().ToString("o")
+        arguments = $Arguments
+        agents = @($sessions | ForEach-Object { [ordered]@{ name = $_.name; exitCode = $_.done.exitCode; clockOffsetMs = $_.offsetTicks / 10000.0; output = $_.done.output } })
+        sendBytesPerSecond = $sendBps
+        recvBytesPerSecond = $recvBps
+        latencyUs = $latency
+        timeSlices = $merged
+    }
+    $results | ConvertTo-Json -Depth 6 | Set-Content -Path $ResultsFile
+    Write-Host "Results written to $ResultsFile"
+}
+
+if ($anyFailure) {
+    exit 1
+}
+exit 0
@@ -13,21 +13,76 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <execution>
 #include <tuple>
 #include <numeric>
 #include <cmath>
+#include <type_traits>
+#include <vector>
 
 namespace ctl
 {
+    ///
+    /// ctSampledVariance
+    /// - the count, mean and sum of squared differences from the mean of Welford's online algorithm
+    /// - two partial results are merged with Chan's pairwise update, so a range can be reduced in parallel
+    ///
+    struct ctSampledVariance
+    {
+        uint64_t m_count = 0;
+        double m_mean = 0.0;
+        double m_sumOfSquares = 0.0;
+
+        void add(double value) noexcept
+        {
+            ++m_count;
+            const double delta = value - m_mean;
+            m_mean += delta / static_cast<double>(m_count);
+            m_sumOfSquares += delta * (value - m_mean);
+        }
+
+        [[nodiscard]] static ctSampledVariance combine(const ctSampledVariance& lhs, const ctSampledVariance& rhs) noexcept
+        {
+            if (lhs.m_count == 0)
+            {
+                return rhs;
+            }
+            if (rhs.m_count == 0)
+            {
+                return lhs;
+            }
+
+            const auto count = lhs.m_count + rhs.m_count;
+            const double delta = rhs.m_mean - lhs.m_mean;
+            const double rhsWeight = static_cast<double>(rhs.m_count) / static_cast<double>(count);
+            return ctSampledVariance{
+                count,
+                lhs.m_mean + delta * rhsWeight,
+                lhs.m_sumOfSquares + rhs.m_sumOfSquares + delta * delta * static_cast<double>(lhs.m_count) * rhsWeight};
+        }
+
+        [[nodiscard]] double standard_deviation() const noexcept
+        {
+            if (m_count < 2)
+            {
+                return 0.0;
+            }
+            return std::sqrt(m_sumOfSquares / (static_cast<double>(m_count) - 1.0));
+        }
+    };
+
     ///
     /// calculating a sampled standard deviation and mean
+    /// - a single pass over the data, reduced in parallel
     ///
     /// Returns a tuple of doubles recording the results:
     ///   get<0> : the mean value
     ///   get<1> : the standard deviation
     ///
-    template <typename BidirectionalIterator>
-    std::tuple<double, double> SampledStandardDeviation(const BidirectionalIterator& begin, const BidirectionalIterator& end)
+    template <typename RandomAccessIterator>
+    std::tuple<double, double> SampledStandardDeviation(const RandomAccessIterator& begin, const RandomAccessIterator& end)
     {
         const auto size = end - begin;
         if (size == 0)
@@ -43,18 +98,16 @@ namespace ctl
                 static_cast<double>(0));
         }
 
-        const double sum = std::accumulate(begin, end, 0.0);
-        const double mean = sum / static_cast<double>(size);
-        // ReSharper disable once CppUseAuto
-        double accum = 0.0;
-        for (auto iter = begin; iter != end; ++iter)
-        {
-            auto& value = *iter;
-            accum += (static_cast<double>(value) - mean) * (static_cast<double>(value) - mean);
-        }
-
-        const auto stdev = std::sqrt(static_cast<double>(accum / (static_cast<double>(size) - 1.0)));
-        return std::make_tuple(mean, stdev);
+        const auto variance = std::transform_reduce(
+            std::execution::par_unseq,
+            begin,
+            end,
+            ctSampledVariance{},
+            ctSampledVariance::combine,
+            [](const auto& value) noexcept {
+                return ctSampledVariance{1, static_cast<double>(value), 0.0};
+            });
+        return std::make_tuple(variance.m_mean, variance.standard_deviation());
     }
 
     ///
@@ -179,4 +232,258 @@ namespace ctl
             median,
             higherQuartile);
     }
+
+    ///
+    /// calculating the same interquartile range as ctInterquartileRange without sorting the input
+    /// - each median is found by selection (nth_element), so the cost is linear rather than N log N
+    ///
+    /// ** Reorders the input **
+    ///
+    /// Returns a tuple of doubles recording the results:
+    ///   get<0> : quartile 1 (median of the lower half - at the 25% mark)
+    ///   get<1> : quartile 2 (the median value - at the 50% mark)
+    ///   get<2> : quartile 3 (median of the upper half - at the 75% mark)
+    ///
+    template <typename RandomAccessIterator>
+    std::tuple<double, double, double> ctSelectInterquartileRange(const RandomAccessIterator& begin, const RandomAccessIterator& end)
+    {
+        const auto size = end - begin;
+        if (size < 3)
+        {
+            return std::make_tuple(
+                static_cast<double>(0),
+                static_cast<double>(0),
+                static_cast<double>(0));
+        }
+
+        if (size == 3)
+        {
+            std::sort(begin, end);
+            return std::make_tuple(
+                static_cast<double>(*begin),
+                static_cast<double>(*(begin + 1)),
+                static_cast<double>(*(begin + 2)));
+        }
+
+        // selects the median of [selectBegin, selectEnd), leaving the value at the midpoint in its sorted position
+        // with the lesser values before it and the greater values after it
+        const auto selectMedian = [](const RandomAccessIterator& selectBegin, const RandomAccessIterator& selectEnd) -> double {
+            const auto selectSize = selectEnd - selectBegin;
+            const auto selectMiddle = selectBegin + selectSize / 2;
+            std::nth_element(selectBegin, selectMiddle, selectEnd);
+            if (selectSize % 2 == 1)
+            {
+                return static_cast<double>(*selectMiddle);
+            }
+
+            // an even count: the average with the greatest value before the midpoint
+            // - halving each first cannot overflow, and rounds the same as halving the sum
+            const double lhsValue{ static_cast<double>(*std::max_element(selectBegin, selectMiddle)) };
+            const double rhsValue{ static_cast<double>(*selectMiddle) };
+            return lhsValue / 2.0 + rhsValue / 2.0;
+        };
+
+        // once the median is selected, the lower half is [begin, middle)
+        // and the upper half is [middle, end) - excluding the median itself with an odd count, as ctInterquartileRange does
+        const auto middle = begin + size / 2;
+        const double median = selectMedian(begin, end);
+        const double lowerQuartile = selectMedian(begin, middle);
+        const double higherQuartile = selectMedian(size % 2 == 1 ? middle + 1 : middle, end);
+
+        return std::make_tuple(
+            lowerQuartile,
+            median,
+            higherQuartile);
+    }
+
+    ///
+    /// ctLogLinearHistogram
+    /// - a bounded-memory streaming summary of unsigned integer samples
+    /// - values below 2^c_subBucketBits are counted exactly; larger values are counted in
+    ///   c_subBucketCount linear buckets per power of two, bounding the relative error of a quantile to 1/c_subBucketCount
+    /// - buckets are only allocated up to the largest value seen, and never more than c_maxBucketCount
+    ///
+    /// min, max, mean and standard deviation are tracked exactly as samples are added
+    ///
+    template <typename T>
+    class ctLogLinearHistogram
+    {
+    public:
+        static_assert(std::is_integral_v<T> && std::is_unsigned_v<T>, "ctLogLinearHistogram requires an unsigned integral type");
+
+        static constexpr uint32_t c_subBucketBits = 5;
+        static constexpr uint32_t c_subBucketCount = 1ul << c_subBucketBits;
+        static constexpr uint32_t c_maxBucketCount = (sizeof(T) * 8 - c_subBucketBits + 1) * c_subBucketCount;
+        static constexpr size_t c_summarySize = 10;
+
+        void add(T value)
+        {
+            const auto bucket = BucketIndex(value);
+            if (bucket >= m_buckets.size())
+            {
+                m_buckets.resize(bucket + 1);
+            }
+            ++m_buckets[bucket];
+
+            if (m_count == 0)
+            {
+                m_min = value;
+                m_max = value;
+            }
+            else
+            {
+                m_min = (std::min)(m_min, value);
+                m_max = (std::max)(m_max, value);
+            }
+
+            // Welford's online algorithm for the mean and variance
+            ++m_count;
+            const double delta = static_cast<double>(value) - m_mean;
+            m_mean += delta / static_cast<double>(m_count);
+            m_sumOfSquares += delta * (static_cast<double>(value) - m_mean);
+        }
+
+        void clear() noexcept
+        {
+            m_buckets.clear();
+            m_count = 0;
+            m_min = 0;
+            m_max = 0;
+            m_mean = 0.0;
+            m_sumOfSquares = 0.0;
+        }
+
+        [[nodiscard]] uint64_t count() const noexcept
+        {
+            return m_count;
+        }
+
+        [[nodiscard]] T minimum() const noexcept
+        {
+            return m_min;
+        }
+
+        [[nodiscard]] T maximum() const noexcept
+        {
+            return m_max;
+        }
+
+        [[nodiscard]] double mean() const noexcept
+        {
+            return m_mean;
+        }
+
+        // the sampled standard deviation, matching SampledStandardDeviation
+        [[nodiscard]] double standard_deviation() const noexcept
+        {
+            if (m_count < 2)
+            {
+                return 0.0;
+            }
+            return std::sqrt(m_sumOfSquares / (static_cast<double>(m_count) - 1.0));
+        }
+
+        // percentile is in the range [0.0, 1.0]
+        // - returns the midpoint of the bucket holding that rank, within the observed min and max
+        [[nodiscard]] T quantile(double percentile) const noexcept
+        {
+            if (m_count == 0)
+            {
+                return 0;
+            }
+            if (percentile <= 0.0)
+            {
+                return m_min;
+            }
+            if (percentile >= 1.0)
+            {
+                return m_max;
+            }
+
+            const auto rank = (std::max)(static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(m_count))), uint64_t{1});
+            uint64_t seen = 0;
+            for (uint32_t bucket = 0; bucket < m_buckets.size(); ++bucket)
+            {
+                seen += m_buckets[bucket];
+                if (seen >= rank)
+                {
+                    const T lowest = BucketLowerBound(bucket);
+                    const T midpoint = lowest + (BucketWidth(bucket) - 1) / 2;
+                    return (std::min)((std::max)(midpoint, m_min), m_max);
+                }
+            }
+            return m_max;
+        }
+
+        // the summary vector must already be sized to c_summarySize
+        // - it's formatted as:
+        // [0] == count
+        // [1] == min
+        // [2] == max
+        // [3] == mean
+        // [4] == standard deviation
+        // [5] == 25th percentile
+        // [6] == median
+        // [7] == 75th percentile
+        // [8] == 95th percentile
+        // [9] == 99th percentile
+        void write_summary(std::vector<T>& summary) const noexcept
+        {
+            summary[0] = static_cast<T>(m_count);
+            summary[1] = m_min;
+            summary[2] = m_max;
+            summary[3] = static_cast<T>(m_mean);
+            summary[4] = static_cast<T>(standard_deviation());
+            summary[5] = quantile(0.25);
+            summary[6] = quantile(0.50);
+            summary[7] = quantile(0.75);
+            summary[8] = quantile(0.95);
+            summary[9] = quantile(0.99);
+        }
+
+    private:
+        std::vector<uint64_t> m_buckets;
+        uint64_t m_count = 0;
+        T m_min = 0;
+        T m_max = 0;
+        double m_mean = 0.0;
+        double m_sumOfSquares = 0.0;
+
+        static uint32_t BucketIndex(T value) noexcept
+        {
+            if (value < c_subBucketCount)
+            {
+                return static_cast<uint32_t>(value);
+            }
+
+            uint32_t highestBit = c_subBucketBits;
+            while (highestBit + 1 < sizeof(T) * 8 && (value >> (highestBit + 1)) != 0)
+            {
+                ++highestBit;
+            }
+            // the top c_subBucketBits + 1 bits of the value select the sub-bucket within that power of two
+            const auto shift = highestBit - c_subBucketBits;
+            const auto subBucket = static_cast<uint32_t>(value >> shift) - c_subBucketCount;
+            return (shift + 1) * c_subBucketCount + subBucket;
+        }
+
+        static T BucketLowerBound(uint32_t bucket) noexcept
+        {
+            if (bucket < c_subBucketCount)
+            {
+                return static_cast<T>(bucket);
+            }
+            const auto shift = bucket / c_subBucketCount - 1;
+            return static_cast<T>(static_cast<T>(c_subBucketCount + bucket % c_subBucketCount) << shift);
+        }
+
+        static T BucketWidth(uint32_t bucket) noexcept
+        {
+            if (bucket < c_subBucketCount)
+            {
+                return 1;
+            }
+            return static_cast<T>(T{1} << (bucket / c_subBucketCount - 1));
+        }
+    };
 }
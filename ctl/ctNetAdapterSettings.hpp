@@ -0,0 +1,266 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <optional>
+#include <string>
+#include <vector>
+// os headers
+#include <Windows.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include "ctWmiInitialize.hpp"
+
+namespace ctl
+{
+    ///
+    /// The RSS, offload, and driver settings of a network adapter, read from the ROOT\StandardCimv2 MSFT_NetAdapter* classes
+    /// - settings which the adapter (or this version of Windows) doesn't expose are left unset or empty
+    ///
+    /// Recorded with the results of a run so runs on different hosts can be compared
+    ///
+    struct ctNetAdapterSettings
+    {
+        std::wstring m_interfaceDescription;
+        std::wstring m_interfaceAlias;
+        std::wstring m_driverVersion;
+        ULONG64 m_linkSpeedBitsPerSecond = 0;
+
+        std::optional<bool> m_rssEnabled;
+        std::optional<unsigned long> m_rssReceiveQueues;
+        std::optional<unsigned long> m_rssBaseProcessor;
+        std::optional<unsigned long> m_rssMaxProcessors;
+        std::optional<bool> m_lsoIpv4Enabled;
+        std::optional<bool> m_lsoIpv6Enabled;
+        std::optional<bool> m_usoIpv4Enabled;
+        std::optional<bool> m_usoIpv6Enabled;
+        std::optional<bool> m_rscIpv4Enabled;
+        std::optional<bool> m_rscIpv6Enabled;
+        // the display values of the advanced properties
+        std::wstring m_interruptModeration;
+        std::wstring m_receiveBuffers;
+        std::wstring m_transmitBuffers;
+        std::wstring m_jumboPacket;
+
+        // one line per group of settings, each starting with linePrefix
+        [[nodiscard]] std::wstring format(PCWSTR linePrefix) const
+        {
+            const auto formatBool = [](const std::optional<bool>& value) -> PCWSTR {
+                return !value.has_value() ? L"n/a" : *value ? L"on" : L"off";
+            };
+            const auto formatUlong = [](const std::optional<unsigned long>& value) {
+                return value.has_value() ? std::to_wstring(*value) : std::wstring(L"n/a");
+            };
+            const auto formatString = [](const std::wstring& value) -> PCWSTR {
+                return value.empty() ? L"n/a" : value.c_str();
+            };
+
+            std::wstring formatted;
+            formatted.append(wil::str_printf<std::wstring>(
+                L"%wsAdapter: %ws [%ws], driver %ws, link speed %llu Mbps\n",
+                linePrefix,
+                m_interfaceDescription.c_str(),
+                formatString(m_interfaceAlias),
+                formatString(m_driverVersion),
+                m_linkSpeedBitsPerSecond / 1000000ULL));
+            formatted.append(wil::str_printf<std::wstring>(
+                L"%ws  RSS %ws, receive queues %ws, base processor %ws, max processors %ws\n",
+                linePrefix,
+                formatBool(m_rssEnabled),
+                formatUlong(m_rssReceiveQueues).c_str(),
+                formatUlong(m_rssBaseProcessor).c_str(),
+                formatUlong(m_rssMaxProcessors).c_str()));
+            formatted.append(wil::str_printf<std::wstring>(
+                L"%ws  LSO IPv4 %ws IPv6 %ws, USO IPv4 %ws IPv6 %ws, RSC IPv4 %ws IPv6 %ws\n",
+                linePrefix,
+                formatBool(m_lsoIpv4Enabled),
+                formatBool(m_lsoIpv6Enabled),
+                formatBool(m_usoIpv4Enabled),
+                formatBool(m_usoIpv6Enabled),
+                formatBool(m_rscIpv4Enabled),
+                formatBool(m_rscIpv6Enabled)));
+            formatted.append(wil::str_printf<std::wstring>(
+                L"%ws  interrupt moderation %ws, receive buffers %ws, transmit buffers %ws, jumbo packet %ws\n",
+                linePrefix,
+                formatString(m_interruptModeration),
+                formatString(m_receiveBuffers),
+                formatString(m_transmitBuffers),
+                formatString(m_jumboPacket)));
+            return formatted;
+        }
+
+        // the settings known to limit throughput, one description for each found
+        [[nodiscard]] std::vector<std::wstring> find_limiting_settings() const
+        {
+            std::vector<std::wstring> warnings;
+            if (m_rssEnabled.has_value() && !*m_rssEnabled)
+            {
+                warnings.emplace_back(L"RSS is disabled: all receives are indicated on a single processor");
+            }
+            else if (m_rssReceiveQueues.has_value() && *m_rssReceiveQueues == 1)
+            {
+                warnings.emplace_back(L"RSS is limited to a single receive queue: all receives are indicated on a single processor");
+            }
+            if (m_rssMaxProcessors.has_value() && *m_rssMaxProcessors == 1)
+            {
+                warnings.emplace_back(L"RSS is limited to a single processor");
+            }
+            if (m_lsoIpv4Enabled.has_value() && !*m_lsoIpv4Enabled ||
+                m_lsoIpv6Enabled.has_value() && !*m_lsoIpv6Enabled)
+            {
+                warnings.emplace_back(L"LSO is disabled: TCP sends are segmented by the host");
+            }
+            if (m_rscIpv4Enabled.has_value() && !*m_rscIpv4Enabled ||
+                m_rscIpv6Enabled.has_value() && !*m_rscIpv6Enabled)
+            {
+                warnings.emplace_back(L"RSC is disabled: TCP receives are indicated per segment");
+            }
+            return warnings;
+        }
+    };
+
+    namespace Detail
+    {
+        // WQL string literals escape backslashes and single-quotes with a backslash
+        inline std::wstring ctEscapeWqlString(const std::wstring& value)
+        {
+            std::wstring escaped;
+            escaped.reserve(value.size());
+            for (const auto character : value)
+            {
+                if (L'\\' == character || L'\'' == character)
+                {
+                    escaped.push_back(L'\\');
+                }
+                escaped.push_back(character);
+            }
+            return escaped;
+        }
+
+        // invokes the functor for each instance returned by the query
+        // - a class which doesn't exist on this version of Windows returns no instances
+        template <typename T>
+        void ctForEachWmiInstance(const ctWmiService& wmiService, const std::wstring& query, T&& functor) noexcept
+        try
+        {
+            ctWmiEnumerate enumInstances(wmiService);
+            enumInstances.query(query.c_str());
+            for (const auto& instance : enumInstances)
+            {
+                functor(instance);
+            }
+        }
+        catch (...)
+        {
+        }
+
+        // the property's value, or nullopt if it's not set or not of the expected type
+        template <typename T>
+        std::optional<T> ctReadWmiProperty(const ctWmiInstance& instance, PCWSTR propertyName) noexcept
+        try
+        {
+            T value{};
+            if (instance.get(propertyName, &value))
+            {
+                return value;
+            }
+            return std::nullopt;
+        }
+        catch (...)
+        {
+            return std::nullopt;
+        }
+    }
+
+    // Reads the settings of the adapter with this interface description (IP_ADAPTER_ADDRESSES::Description)
+    // - COM must be initialized on the calling thread and wmiService connected to ROOT\StandardCimv2
+    inline ctNetAdapterSettings ctReadNetAdapterSettings(const ctWmiService& wmiService, const std::wstring& interfaceDescription)
+    {
+        ctNetAdapterSettings settings;
+        settings.m_interfaceDescription = interfaceDescription;
+        const auto whereClause = L" WHERE InterfaceDescription = '" + Detail::ctEscapeWqlString(interfaceDescription) + L"'";
+
+        Detail::ctForEachWmiInstance(wmiService, L"SELECT * FROM MSFT_NetAdapter" + whereClause, [&](const ctWmiInstance& instance) {
+            settings.m_interfaceAlias = Detail::ctReadWmiProperty<std::wstring>(instance, L"Name").value_or(L"");
+            settings.m_driverVersion = Detail::ctReadWmiProperty<std::wstring>(instance, L"DriverVersionString").value_or(L"");
+            settings.m_linkSpeedBitsPerSecond = Detail::ctReadWmiProperty<ULONG64>(instance, L"ReceiveLinkSpeed").value_or(0);
+        });
+        Detail::ctForEachWmiInstance(wmiService, L"SELECT * FROM MSFT_NetAdapterRssSettingData" + whereClause, [&](const ctWmiInstance& instance) {
+            settings.m_rssEnabled = Detail::ctReadWmiProperty<bool>(instance, L"Enabled");
+            settings.m_rssReceiveQueues = Detail::ctReadWmiProperty<unsigned long>(instance, L"NumberOfReceiveQueues");
+            settings.m_rssBaseProcessor = Detail::ctReadWmiProperty<unsigned long>(instance, L"BaseProcessorNumber");
+            settings.m_rssMaxProcessors = Detail::ctReadWmiProperty<unsigned long>(instance, L"MaxProcessors");
+        });
+        Detail::ctForEachWmiInstance(wmiService, L"SELECT * FROM MSFT_NetAdapterLsoSettingData" + whereClause, [&](const ctWmiInstance& instance) {
+            settings.m_lsoIpv4Enabled = Detail::ctReadWmiProperty<bool>(instance, L"IPv4Enabled");
+            settings.m_lsoIpv6Enabled = Detail::ctReadWmiProperty<bool>(instance, L"IPv6Enabled");
+        });
+        // USO is only exposed from Windows Server 2022 and Windows 11
+        Detail::ctForEachWmiInstance(wmiService, L"SELECT * FROM MSFT_NetAdapterUsoSettingData" + whereClause, [&](const ctWmiInstance& instance) {
+            settings.m_usoIpv4Enabled = Detail::ctReadWmiProperty<bool>(instance, L"IPv4Enabled");
+            settings.m_usoIpv6Enabled = Detail::ctReadWmiProperty<bool>(instance, L"IPv6Enabled");
+        });
+        Detail::ctForEachWmiInstance(wmiService, L"SELECT * FROM MSFT_NetAdapterRscSettingData" + whereClause, [&](const ctWmiInstance& instance) {
+            settings.m_rscIpv4Enabled = Detail::ctReadWmiProperty<bool>(instance, L"IPv4Enabled");
+            settings.m_rscIpv6Enabled = Detail::ctReadWmiProperty<bool>(instance, L"IPv6Enabled");
+        });
+        Detail::ctForEachWmiInstance(wmiService, L"SELECT * FROM MSFT_NetAdapterAdvancedPropertySettingData" + whereClause, [&](const ctWmiInstance& instance) {
+            const auto keyword = Detail::ctReadWmiProperty<std::wstring>(instance, L"RegistryKeyword").value_or(L"");
+            std::wstring* const setting =
+                keyword == L"*InterruptModeration" ? &settings.m_interruptModeration :
+                keyword == L"*ReceiveBuffers" ? &settings.m_receiveBuffers :
+                keyword == L"*TransmitBuffers" ? &settings.m_transmitBuffers :
+                keyword == L"*JumboPacket" ? &settings.m_jumboPacket :
+                nullptr;
+            if (setting)
+            {
+                *setting = Detail::ctReadWmiProperty<std::wstring>(instance, L"DisplayValue").value_or(L"");
+            }
+        });
+        return settings;
+    }
+
+    struct ctPowerPlan
+    {
+        // the (localized) name of the plan, empty if it couldn't be read
+        std::wstring m_name;
+        // the High performance or Ultimate Performance plans : processors are not parked or throttled to save power
+        bool m_isHighPerformance = false;
+    };
+
+    // Reads the active power plan
+    // - COM must be initialized on the calling thread
+    inline ctPowerPlan ctReadActivePowerPlan() noexcept
+    try
+    {
+        const ctWmiService wmiService(L"ROOT\\cimv2\\power");
+        ctPowerPlan powerPlan;
+        Detail::ctForEachWmiInstance(wmiService, L"SELECT * FROM Win32_PowerPlan WHERE IsActive = TRUE", [&](const ctWmiInstance& instance) {
+            powerPlan.m_name = Detail::ctReadWmiProperty<std::wstring>(instance, L"ElementName").value_or(L"");
+            // the InstanceID is of the form Microsoft:PowerPlan\{guid} - the names are localized, the guids are not
+            const auto instanceId = Detail::ctReadWmiProperty<std::wstring>(instance, L"InstanceID").value_or(L"");
+            powerPlan.m_isHighPerformance =
+                instanceId.find(L"8c5e7fda-e8bf-4a96-9a85-a6e23a8c635c") != std::wstring::npos ||
+                instanceId.find(L"e9a42b02-d5df-448d-aa00-03f14749eb61") != std::wstring::npos;
+        });
+        return powerPlan;
+    }
+    catch (...)
+    {
+        return {};
+    }
+} // namespace ctl
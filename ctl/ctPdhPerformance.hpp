@@ -0,0 +1,970 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <Pdh.h>
+#include <PdhMsg.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+#include <wil/win32_helpers.h>
+// ctl headers
+#include <ctString.hpp>
+// ctWmiPerformance.hpp defines the counter classes and collection types shared by both collectors
+#include <ctWmiPerformance.hpp>
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// Concepts for this class:
+/// - The same counters exposed by ctWmiPerformance, read in-process through the PDH APIs instead of WMI refreshers
+///   so there's no COM activation, no WMI provider start-up, and no out-of-process hop on every sample
+/// - ctPdhPerformanceCounter exposes one counter within one performance object
+/// - Counters are named by their ctWmiEnumClassName and WMI property name, so callers can switch between the two collectors,
+///   and are added to the PDH query by their English names so they resolve on every display language
+/// - Every instance of an object is identified by its instance name, just as the WMI 'Name' key field
+/// - Counters are 'snapped' every interval given to start_all_counters: PDH computes rates from the two most recent samples,
+///   so sub-second intervals report the same per-second values
+///
+/// ctPdhPerformanceCounter is created through ctCreatePdhPerfCounter
+/// - the template type matches the data type of the counter data for that counter name
+///
+/// Methods exposed publicly off of ctPdhPerformanceCounter:
+/// - add_filter() : allows the caller to only capture instances which match the property/value combination for that object
+///                  properties other than "Name" are read from a counter of the same object (e.g. "IDProcess")
+/// - reference_range() : takes an Instance Name by which to return values
+/// -- returns begin/end iterators to reference the data
+/// - instance_names() : returns the names of all the instances which were captured
+///
+/// ctPdhPerformance owns the PDH query: every interval it collects the query, and each counter then reads
+/// - its formatted values for every instance, adding those which were not filtered out
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ctl
+{
+    using unique_pdh_query = wil::unique_any<PDH_HQUERY, decltype(&::PdhCloseQuery), ::PdhCloseQuery>;
+
+    namespace details
+    {
+        // PDH_STATUS values are HRESULT-formatted
+        inline void ThrowIfPdhFailed(PDH_STATUS status, _In_ PCSTR function, _In_ PCWSTR counterPath)
+        {
+            THROW_HR_IF_MSG(
+                static_cast<HRESULT>(status),
+                status != ERROR_SUCCESS,
+                "%hs(%ws)", function, counterPath);
+        }
+
+        // the PDH format and value for each counter data type
+        template <typename T>
+        struct ctPdhFormat;
+
+        template <>
+        struct ctPdhFormat<ULONG>
+        {
+            // performance counters can exceed 100% across multiple processors (as WMI returns them)
+            static constexpr DWORD c_format = PDH_FMT_LONG | PDH_FMT_NOCAP100;
+            static ULONG read(const PDH_FMT_COUNTERVALUE& value) noexcept
+            {
+                return static_cast<ULONG>(value.longValue);
+            }
+        };
+
+        template <>
+        struct ctPdhFormat<ULONGLONG>
+        {
+            static constexpr DWORD c_format = PDH_FMT_LARGE | PDH_FMT_NOCAP100;
+            static ULONGLONG read(const PDH_FMT_COUNTERVALUE& value) noexcept
+            {
+                return static_cast<ULONGLONG>(value.largeValue);
+            }
+        };
+
+        inline bool ctPdhValidData(const PDH_FMT_COUNTERVALUE& value) noexcept
+        {
+            // rate counters have no value until the second sample is collected
+            return value.CStatus == PDH_CSTATUS_VALID_DATA || value.CStatus == PDH_CSTATUS_NEW_DATA;
+        }
+
+        // one formatted value for one instance of a counter
+        struct ctPdhInstanceValue
+        {
+            std::wstring m_instanceName;
+            PDH_FMT_COUNTERVALUE m_value{};
+        };
+
+        // reads the formatted value of every instance of the counter from the last collected sample
+        // - instances sharing a name (e.g. processes) are named as WMI names them: name, name#1, name#2, ...
+        inline std::vector<ctPdhInstanceValue> ctPdhReadInstances(PDH_HCOUNTER counter, DWORD format, bool instanced)
+        {
+            std::vector<ctPdhInstanceValue> instances;
+            if (!instanced)
+            {
+                ctPdhInstanceValue instance;
+                if (ERROR_SUCCESS == PdhGetFormattedCounterValue(counter, format, nullptr, &instance.m_value))
+                {
+                    instances.emplace_back(std::move(instance));
+                }
+                return instances;
+            }
+
+            DWORD bufferSize = 0;
+            DWORD itemCount = 0;
+            auto status = PdhGetFormattedCounterArrayW(counter, format, &bufferSize, &itemCount, nullptr);
+            if (status != PDH_MORE_DATA)
+            {
+                // a rate counter before its second sample, or an object which currently has no instances
+                return instances;
+            }
+
+            // the buffer holds the array of items followed by the instance name strings
+            std::vector<BYTE> buffer(bufferSize);
+            status = PdhGetFormattedCounterArrayW(counter, format, &bufferSize, &itemCount, reinterpret_cast<PPDH_FMT_COUNTERVALUE_ITEM_W>(buffer.data()));
+            if (status != ERROR_SUCCESS)
+            {
+                return instances;
+            }
+
+            const auto* const items = reinterpret_cast<const PDH_FMT_COUNTERVALUE_ITEM_W*>(buffer.data());
+            instances.reserve(itemCount);
+            for (DWORD item = 0; item < itemCount; ++item)
+            {
+                ctPdhInstanceValue instance;
+                instance.m_instanceName = items[item].szName;
+                instance.m_value = items[item].FmtValue;
+
+                const auto duplicates = std::count_if(
+                    std::begin(instances),
+                    std::end(instances),
+                    [&](const ctPdhInstanceValue& existing) {
+                        return ctString::ctOrdinalStartsWithCaseInsensative(existing.m_instanceName, instance.m_instanceName) &&
+                            (existing.m_instanceName.size() == instance.m_instanceName.size() ||
+                             existing.m_instanceName[instance.m_instanceName.size()] == L'#');
+                    });
+                if (duplicates > 0)
+                {
+                    instance.m_instanceName += wil::str_printf<std::wstring>(L"#%Iu", static_cast<size_t>(duplicates));
+                }
+                instances.emplace_back(std::move(instance));
+            }
+            return instances;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Stucture to track the performance data for each instance being tracked
+        /// - keeps the same layout for each ctWmiPerformanceCollectionType as ctWmiPerformanceCounterData
+        ///
+        /// typename T : the data type of the counter to be stored
+        ///
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        template <typename T>
+        class ctPdhPerformanceCounterData
+        {
+        private:
+            mutable wil::critical_section m_guardData{500};
+            const ctWmiPerformanceCollectionType m_collectionType = ctWmiPerformanceCollectionType::Detailed;
+            const std::wstring m_instanceName;
+            std::vector<T> m_counterData;
+            ULONGLONG m_counterSum = 0;
+            ctLogLinearHistogram<T> m_counterHistogram;
+
+        public:
+            ctPdhPerformanceCounterData(const ctWmiPerformanceCollectionType collectionType, std::wstring instanceName) :
+                m_collectionType(collectionType),
+                m_instanceName(std::move(instanceName))
+            {
+            }
+            ~ctPdhPerformanceCounterData() noexcept = default;
+
+            // instance_name == nullptr means match everything
+            bool match(_In_opt_ PCWSTR instanceName) const
+            {
+                if (!instanceName)
+                {
+                    return true;
+                }
+                return ctString::ctOrdinalEqualsCaseInsensative(instanceName, m_instanceName);
+            }
+
+            const std::wstring& instance_name() const noexcept
+            {
+                return m_instanceName;
+            }
+
+            void add(const T& instanceData)
+            {
+                const auto lock = m_guardData.lock();
+                switch (m_collectionType)
+                {
+                    case ctWmiPerformanceCollectionType::Detailed:
+                        m_counterData.push_back(instanceData);
+                        break;
+
+                    case ctWmiPerformanceCollectionType::MeanOnly:
+                        // vector is formatted as:
+                        // [0] == count
+                        // [1] == min
+                        // [2] == max
+                        // [3] == mean
+                        if (m_counterData.empty())
+                        {
+                            m_counterData.push_back(1);
+                            m_counterData.push_back(instanceData);
+                            m_counterData.push_back(instanceData);
+                            m_counterData.push_back(0);
+                        }
+                        else
+                        {
+                            ++m_counterData[0];
+                            if (instanceData < m_counterData[1])
+                            {
+                                m_counterData[1] = instanceData;
+                            }
+                            if (instanceData > m_counterData[2])
+                            {
+                                m_counterData[2] = instanceData;
+                            }
+                        }
+
+                        m_counterSum += instanceData;
+                        break;
+
+                    case ctWmiPerformanceCollectionType::FirstLast:
+                        // [0] == count
+                        // [1] == first
+                        // [2] == last
+                        if (m_counterData.empty())
+                        {
+                            m_counterData.push_back(1);
+                            m_counterData.push_back(instanceData);
+                            m_counterData.push_back(instanceData);
+                        }
+                        else
+                        {
+                            ++m_counterData[0];
+                            m_counterData[2] = instanceData;
+                        }
+                        break;
+
+                    case ctWmiPerformanceCollectionType::Histogram:
+                        // the summary is written when accessed: see ctLogLinearHistogram::write_summary
+                        if (m_counterData.empty())
+                        {
+                            m_counterData.resize(ctLogLinearHistogram<T>::c_summarySize);
+                        }
+                        m_counterHistogram.add(instanceData);
+                        break;
+
+                    default:
+                        FAIL_FAST_MSG(
+                            "Unknown ctWmiPerformanceCollectionType (%u)",
+                            static_cast<unsigned>(m_collectionType));
+                }
+            }
+
+            typename std::vector<T>::const_iterator begin() noexcept
+            {
+                const auto lock = m_guardData.lock();
+                // when accessing data, calculate the mean
+                if (ctWmiPerformanceCollectionType::MeanOnly == m_collectionType && !m_counterData.empty())
+                {
+                    m_counterData[3] = static_cast<T>(m_counterSum / m_counterData[0]);
+                }
+                else if (ctWmiPerformanceCollectionType::Histogram == m_collectionType && !m_counterData.empty())
+                {
+                    m_counterHistogram.write_summary(m_counterData);
+                }
+                return m_counterData.cbegin();
+            }
+            typename std::vector<T>::const_iterator end() const noexcept
+            {
+                const auto lock = m_guardData.lock();
+                return m_counterData.cend();
+            }
+
+            void clear() noexcept
+            {
+                const auto lock = m_guardData.lock();
+                m_counterData.clear();
+                m_counterSum = 0;
+                m_counterHistogram.clear();
+            }
+
+            ctPdhPerformanceCounterData(const ctPdhPerformanceCounterData&) = delete;
+            ctPdhPerformanceCounterData& operator=(const ctPdhPerformanceCounterData&) = delete;
+            ctPdhPerformanceCounterData(ctPdhPerformanceCounterData&&) = delete;
+            ctPdhPerformanceCounterData& operator=(ctPdhPerformanceCounterData&&) = delete;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// the English PDH object and counter names for the ctWmiEnumClassName classes and their WMI property names
+        ///
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        struct ctPdhObjectName
+        {
+            const ctWmiEnumClassName m_className;
+            const wchar_t* m_objectName;
+            // objects with instances are read with a (*) wildcard
+            const bool m_instanced;
+        };
+
+        struct ctPdhCounterName
+        {
+            const ctWmiEnumClassName m_className;
+            const wchar_t* m_propertyName;
+            const wchar_t* m_counterName;
+        };
+
+        inline const ctPdhObjectName c_pdhObjectNames[]{
+            { ctWmiEnumClassName::Process, L"Process", true },
+            { ctWmiEnumClassName::Processor, L"Processor Information", true },
+            { ctWmiEnumClassName::Memory, L"Memory", false },
+            { ctWmiEnumClassName::NetworkAdapter, L"Network Adapter", true },
+            { ctWmiEnumClassName::NetworkInterface, L"Network Interface", true },
+            { ctWmiEnumClassName::TcpipDiagnostics, L"TCPIP Performance Diagnostics", false },
+            { ctWmiEnumClassName::TcpipIpv4, L"IPv4", false },
+            { ctWmiEnumClassName::TcpipIpv6, L"IPv6", false },
+            { ctWmiEnumClassName::TcpipTcpv4, L"TCPv4", false },
+            { ctWmiEnumClassName::TcpipTcpv6, L"TCPv6", false },
+            { ctWmiEnumClassName::TcpipUdpv4, L"UDPv4", false },
+            { ctWmiEnumClassName::TcpipUdpv6, L"UDPv6", false },
+            { ctWmiEnumClassName::WinsockBsp, L"Microsoft Winsock BSP", false }
+        };
+
+        inline const ctPdhCounterName c_pdhCounterNames[]{
+            { ctWmiEnumClassName::Process, L"IDProcess", L"ID Process" },
+            { ctWmiEnumClassName::Process, L"PercentPrivilegedTime", L"% Privileged Time" },
+            { ctWmiEnumClassName::Process, L"PercentProcessorTime", L"% Processor Time" },
+            { ctWmiEnumClassName::Process, L"PercentUserTime", L"% User Time" },
+            { ctWmiEnumClassName::Process, L"PrivateBytes", L"Private Bytes" },
+            { ctWmiEnumClassName::Process, L"VirtualBytes", L"Virtual Bytes" },
+            { ctWmiEnumClassName::Process, L"WorkingSet", L"Working Set" },
+
+            { ctWmiEnumClassName::Processor, L"DPCsQueuedPersec", L"DPCs Queued/sec" },
+            { ctWmiEnumClassName::Processor, L"InterruptsPersec", L"Interrupts/sec" },
+            { ctWmiEnumClassName::Processor, L"PercentDPCTime", L"% DPC Time" },
+            { ctWmiEnumClassName::Processor, L"PercentInterruptTime", L"% Interrupt Time" },
+            { ctWmiEnumClassName::Processor, L"PercentofMaximumFrequency", L"% of Maximum Frequency" },
+            { ctWmiEnumClassName::Processor, L"PercentPrivilegedTime", L"% Privileged Time" },
+            { ctWmiEnumClassName::Processor, L"PercentProcessorTime", L"% Processor Time" },
+            { ctWmiEnumClassName::Processor, L"PercentUserTime", L"% User Time" },
+
+            { ctWmiEnumClassName::Memory, L"PoolNonpagedBytes", L"Pool Nonpaged Bytes" },
+            { ctWmiEnumClassName::Memory, L"PoolPagedBytes", L"Pool Paged Bytes" },
+
+            { ctWmiEnumClassName::NetworkAdapter, L"BytesTotalPersec", L"Bytes Total/sec" },
+            { ctWmiEnumClassName::NetworkAdapter, L"OffloadedConnections", L"Offloaded Connections" },
+            { ctWmiEnumClassName::NetworkAdapter, L"PacketsOutboundDiscarded", L"Packets Outbound Discarded" },
+            { ctWmiEnumClassName::NetworkAdapter, L"PacketsOutboundErrors", L"Packets Outbound Errors" },
+            { ctWmiEnumClassName::NetworkAdapter, L"PacketsPersec", L"Packets/sec" },
+            { ctWmiEnumClassName::NetworkAdapter, L"PacketsReceivedDiscarded", L"Packets Received Discarded" },
+            { ctWmiEnumClassName::NetworkAdapter, L"PacketsReceivedErrors", L"Packets Received Errors" },
+            { ctWmiEnumClassName::NetworkAdapter, L"TCPActiveRSCConnections", L"TCP Active RSC Connections" },
+
+            { ctWmiEnumClassName::NetworkInterface, L"BytesTotalPerSec", L"Bytes Total/sec" },
+            { ctWmiEnumClassName::NetworkInterface, L"PacketsOutboundDiscarded", L"Packets Outbound Discarded" },
+            { ctWmiEnumClassName::NetworkInterface, L"PacketsOutboundErrors", L"Packets Outbound Errors" },
+            { ctWmiEnumClassName::NetworkInterface, L"PacketsReceivedDiscarded", L"Packets Received Discarded" },
+            { ctWmiEnumClassName::NetworkInterface, L"PacketsReceivedErrors", L"Packets Received Errors" },
+            { ctWmiEnumClassName::NetworkInterface, L"PacketsReceivedUnknown", L"Packets Received Unknown" },
+
+            { ctWmiEnumClassName::TcpipIpv4, L"DatagramsOutboundDiscarded", L"Datagrams Outbound Discarded" },
+            { ctWmiEnumClassName::TcpipIpv4, L"DatagramsOutboundNoRoute", L"Datagrams Outbound No Route" },
+            { ctWmiEnumClassName::TcpipIpv4, L"DatagramsReceivedAddressErrors", L"Datagrams Received Address Errors" },
+            { ctWmiEnumClassName::TcpipIpv4, L"DatagramsReceivedDiscarded", L"Datagrams Received Discarded" },
+            { ctWmiEnumClassName::TcpipIpv4, L"DatagramsReceivedHeaderErrors", L"Datagrams Received Header Errors" },
+            { ctWmiEnumClassName::TcpipIpv4, L"DatagramsReceivedUnknownProtocol", L"Datagrams Received Unknown Protocol" },
+            { ctWmiEnumClassName::TcpipIpv4, L"FragmentReassemblyFailures", L"Fragment Reassembly Failures" },
+            { ctWmiEnumClassName::TcpipIpv4, L"FragmentationFailures", L"Fragmentation Failures" },
+
+            { ctWmiEnumClassName::TcpipIpv6, L"DatagramsOutboundDiscarded", L"Datagrams Outbound Discarded" },
+            { ctWmiEnumClassName::TcpipIpv6, L"DatagramsOutboundNoRoute", L"Datagrams Outbound No Route" },
+            { ctWmiEnumClassName::TcpipIpv6, L"DatagramsReceivedAddressErrors", L"Datagrams Received Address Errors" },
+            { ctWmiEnumClassName::TcpipIpv6, L"DatagramsReceivedDiscarded", L"Datagrams Received Discarded" },
+            { ctWmiEnumClassName::TcpipIpv6, L"DatagramsReceivedHeaderErrors", L"Datagrams Received Header Errors" },
+            { ctWmiEnumClassName::TcpipIpv6, L"DatagramsReceivedUnknownProtocol", L"Datagrams Received Unknown Protocol" },
+            { ctWmiEnumClassName::TcpipIpv6, L"FragmentReassemblyFailures", L"Fragment Reassembly Failures" },
+            { ctWmiEnumClassName::TcpipIpv6, L"FragmentationFailures", L"Fragmentation Failures" },
+
+            { ctWmiEnumClassName::TcpipTcpv4, L"ConnectionFailures", L"Connection Failures" },
+            { ctWmiEnumClassName::TcpipTcpv4, L"ConnectionsEstablished", L"Connections Established" },
+            { ctWmiEnumClassName::TcpipTcpv4, L"ConnectionsReset", L"Connections Reset" },
+            { ctWmiEnumClassName::TcpipTcpv4, L"SegmentsRetransmittedPersec", L"Segments Retransmitted/sec" },
+
+            { ctWmiEnumClassName::TcpipTcpv6, L"ConnectionFailures", L"Connection Failures" },
+            { ctWmiEnumClassName::TcpipTcpv6, L"ConnectionsEstablished", L"Connections Established" },
+            { ctWmiEnumClassName::TcpipTcpv6, L"ConnectionsReset", L"Connections Reset" },
+            { ctWmiEnumClassName::TcpipTcpv6, L"SegmentsRetransmittedPersec", L"Segments Retransmitted/sec" },
+
+            { ctWmiEnumClassName::TcpipUdpv4, L"DatagramsNoPortPersec", L"Datagrams No Port/sec" },
+            { ctWmiEnumClassName::TcpipUdpv4, L"DatagramsPersec", L"Datagrams/sec" },
+            { ctWmiEnumClassName::TcpipUdpv4, L"DatagramsReceivedErrors", L"Datagrams Received Errors" },
+
+            { ctWmiEnumClassName::TcpipUdpv6, L"DatagramsNoPortPersec", L"Datagrams No Port/sec" },
+            { ctWmiEnumClassName::TcpipUdpv6, L"DatagramsPersec", L"Datagrams/sec" },
+            { ctWmiEnumClassName::TcpipUdpv6, L"DatagramsReceivedErrors", L"Datagrams Received Errors" },
+
+            { ctWmiEnumClassName::WinsockBsp, L"DroppedDatagrams", L"Dropped Datagrams" },
+            { ctWmiEnumClassName::WinsockBsp, L"DroppedDatagramsPersec", L"Dropped Datagrams/sec" },
+            { ctWmiEnumClassName::WinsockBsp, L"RejectedConnections", L"Rejected Connections" },
+            { ctWmiEnumClassName::WinsockBsp, L"RejectedConnectionsPersec", L"Rejected Connections/sec" }
+        };
+
+        // returns the English counter path for the WMI property name of the class
+        // - e.g. \Processor Information(*)\% Processor Time
+        inline std::wstring ctPdhCounterPath(ctWmiEnumClassName className, _In_ PCWSTR propertyName, _Out_ bool* instanced)
+        {
+            const auto* const foundObject = std::find_if(
+                std::begin(c_pdhObjectNames),
+                std::end(c_pdhObjectNames),
+                [&](const ctPdhObjectName& object) { return object.m_className == className; });
+            THROW_HR_IF_MSG(
+                HRESULT_FROM_WIN32(ERROR_INVALID_DATA),
+                foundObject == std::end(c_pdhObjectNames),
+                "Unknown PDH Performance Counter Class (%u)",
+                static_cast<unsigned>(className));
+
+            const auto* const foundCounter = std::find_if(
+                std::begin(c_pdhCounterNames),
+                std::end(c_pdhCounterNames),
+                [&](const ctPdhCounterName& counter) {
+                    return counter.m_className == className && ctString::ctOrdinalEqualsCaseInsensative(counter.m_propertyName, propertyName);
+                });
+            THROW_HR_IF_MSG(
+                HRESULT_FROM_WIN32(ERROR_INVALID_DATA),
+                foundCounter == std::end(c_pdhCounterNames),
+                "CounterName (%ws) does not have a PDH counter in the requested class (%u)",
+                propertyName, static_cast<unsigned>(className));
+
+            *instanced = foundObject->m_instanced;
+            return foundObject->m_instanced ?
+                wil::str_printf<std::wstring>(L"\\%ws(*)\\%ws", foundObject->m_objectName, foundCounter->m_counterName) :
+                wil::str_printf<std::wstring>(L"\\%ws\\%ws", foundObject->m_objectName, foundCounter->m_counterName);
+        }
+
+        typedef std::function<void(CallbackAction action)> ctPdhPerformanceCallback;
+    } // namespace details
+
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// class ctPdhPerformanceCounter
+    /// - tracks one counter for every instance of its performance object
+    /// - exposes the same add_filter() and reference_range() as ctWmiPerformanceCounter
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctPdhPerformance;
+    template <typename T>
+    class ctPdhPerformanceCounter
+    {
+    public:
+        // iterates across *time-slices* captured from ctPdhPerformance
+        // ReSharper disable once CppInconsistentNaming
+        typedef typename std::vector<T>::const_iterator iterator;
+
+        ctPdhPerformanceCounter(ctWmiEnumClassName className, _In_ PCWSTR counterName, const ctWmiPerformanceCollectionType collectionType) :
+            m_className(className),
+            m_collectionType(collectionType),
+            m_counterPath(details::ctPdhCounterPath(className, counterName, &m_instanced))
+        {
+        }
+        ~ctPdhPerformanceCounter() noexcept = default;
+
+        ctPdhPerformanceCounter(const ctPdhPerformanceCounter&) = delete;
+        ctPdhPerformanceCounter& operator=(const ctPdhPerformanceCounter&) = delete;
+        ctPdhPerformanceCounter(ctPdhPerformanceCounter&&) = delete;
+        ctPdhPerformanceCounter& operator=(ctPdhPerformanceCounter&&) = delete;
+
+        ///
+        /// *not* thread-safe: caller must guarantee sequential access to add_filter()
+        /// - must be called before adding this counter to a ctPdhPerformance
+        ///
+        template <typename V>
+        void add_filter(_In_ PCWSTR counterName, V propertyValue)
+        {
+            FAIL_FAST_IF_MSG(
+                !m_dataStopped || m_counter != nullptr,
+                "ctPdhPerformanceCounter: add_filter must be called before the counter is added to a ctPdhPerformance class");
+
+            InstanceFilter filter;
+            if constexpr (std::is_integral_v<V>)
+            {
+                bool instanced{};
+                filter.m_counterPath = details::ctPdhCounterPath(m_className, counterName, &instanced);
+                filter.m_value = static_cast<ULONGLONG>(propertyValue);
+            }
+            else
+            {
+                THROW_HR_IF_MSG(
+                    HRESULT_FROM_WIN32(ERROR_INVALID_DATA),
+                    !ctString::ctOrdinalEqualsCaseInsensative(counterName, L"Name"),
+                    "ctPdhPerformanceCounter: only the Name property can be filtered by a string value (%ws)",
+                    counterName);
+                filter.m_instanceName = propertyValue;
+            }
+            m_instanceFilter.emplace_back(std::move(filter));
+        }
+
+        ///
+        /// returns a begin/end pair of interator that exposes data for each time-slice
+        /// - static classes will have a null instance name
+        ///
+        std::pair<iterator, iterator> reference_range(_In_opt_ PCWSTR instanceName = nullptr)
+        {
+            FAIL_FAST_IF_MSG(
+                !m_dataStopped,
+                "ctPdhPerformanceCounter: must call stop_all_counters on the ctPdhPerformance class containing this counter");
+
+            const auto lock = m_guardCounterData.lock();
+            const auto foundInstance = std::find_if(
+                std::begin(m_counterData),
+                std::end(m_counterData),
+                [&](const auto& instance) { return instance->match(instanceName); });
+            if (std::end(m_counterData) == foundInstance)
+            {
+                // nothing matching that instance name
+                return std::pair<iterator, iterator>(m_noData.cbegin(), m_noData.cend());
+            }
+
+            return std::pair<iterator, iterator>((*foundInstance)->begin(), (*foundInstance)->end());
+        }
+
+        ///
+        /// returns the names of every instance which captured data
+        ///
+        std::vector<std::wstring> instance_names() const
+        {
+            FAIL_FAST_IF_MSG(
+                !m_dataStopped,
+                "ctPdhPerformanceCounter: must call stop_all_counters on the ctPdhPerformance class containing this counter");
+
+            std::vector<std::wstring> names;
+            const auto lock = m_guardCounterData.lock();
+            for (const auto& instance : m_counterData)
+            {
+                names.push_back(instance->instance_name());
+            }
+            return names;
+        }
+
+    private:
+        //
+        // private stucture to track the 'filter' which instances to track
+        // - either the instance name, or the value of another counter of the same instance
+        //
+        struct InstanceFilter
+        {
+            std::wstring m_instanceName;
+            std::wstring m_counterPath;
+            ULONGLONG m_value = 0;
+            PDH_HCOUNTER m_counter = nullptr;
+        };
+
+        const ctWmiEnumClassName m_className;
+        const ctWmiPerformanceCollectionType m_collectionType;
+        bool m_instanced = false;
+        const std::wstring m_counterPath;
+        PDH_HCOUNTER m_counter = nullptr;
+        std::vector<InstanceFilter> m_instanceFilter;
+        // Must lock access to counter_data
+        mutable wil::critical_section m_guardCounterData{500};
+        std::vector<std::unique_ptr<details::ctPdhPerformanceCounterData<T>>> m_counterData;
+        const std::vector<T> m_noData;
+        bool m_dataStopped = true;
+
+        // ctPdhPerformance needs private access to add the counter to its query and to invoke register_callback
+        friend class ctPdhPerformance;
+
+        void add_to_query(PDH_HQUERY query)
+        {
+            details::ThrowIfPdhFailed(
+                PdhAddEnglishCounterW(query, m_counterPath.c_str(), 0, &m_counter),
+                "PdhAddEnglishCounter",
+                m_counterPath.c_str());
+
+            for (auto& filter : m_instanceFilter)
+            {
+                if (!filter.m_counterPath.empty())
+                {
+                    details::ThrowIfPdhFailed(
+                        PdhAddEnglishCounterW(query, filter.m_counterPath.c_str(), 0, &filter.m_counter),
+                        "PdhAddEnglishCounter",
+                        filter.m_counterPath.c_str());
+                }
+            }
+        }
+
+        // invoked after each PdhCollectQueryData to add data matching any/all filters
+        void update_counter_data()
+        {
+            const auto instances = details::ctPdhReadInstances(m_counter, details::ctPdhFormat<T>::c_format, m_instanced);
+
+            // the values of the counters used to filter on, read from the same sample
+            // - the instance arrays of counters in the same object and query are returned in the same order
+            std::vector<std::vector<details::ctPdhInstanceValue>> filterValues;
+            for (const auto& filter : m_instanceFilter)
+            {
+                filterValues.emplace_back(
+                    filter.m_counter ?
+                    details::ctPdhReadInstances(filter.m_counter, PDH_FMT_LARGE, m_instanced) :
+                    std::vector<details::ctPdhInstanceValue>());
+            }
+
+            for (size_t instance = 0; instance < instances.size(); ++instance)
+            {
+                const auto& instanceValue = instances[instance];
+                if (!details::ctPdhValidData(instanceValue.m_value))
+                {
+                    continue;
+                }
+
+                // add the counter data for this instance if:
+                // - have no filters [not filtering instances at all]
+                // - matches at least one filter
+                bool fAddData = m_instanceFilter.empty();
+                for (size_t filter = 0; !fAddData && filter < m_instanceFilter.size(); ++filter)
+                {
+                    const auto& instanceFilter = m_instanceFilter[filter];
+                    if (!instanceFilter.m_counter)
+                    {
+                        fAddData = ctString::ctOrdinalEqualsCaseInsensative(instanceFilter.m_instanceName, instanceValue.m_instanceName);
+                    }
+                    else if (instance < filterValues[filter].size())
+                    {
+                        const auto& filterValue = filterValues[filter][instance];
+                        fAddData =
+                            filterValue.m_instanceName == instanceValue.m_instanceName &&
+                            details::ctPdhValidData(filterValue.m_value) &&
+                            static_cast<ULONGLONG>(filterValue.m_value.largeValue) == instanceFilter.m_value;
+                    }
+                }
+
+                if (fAddData)
+                {
+                    const auto lock = m_guardCounterData.lock();
+                    auto trackedInstance = std::find_if(
+                        std::begin(m_counterData),
+                        std::end(m_counterData),
+                        [&](const auto& counterData) { return counterData->match(instanceValue.m_instanceName.c_str()); });
+
+                    // if this instance of this counter is new [new unique instance for this counter]
+                    // - we must add a new ctPdhPerformanceCounterData to our counter_data vector
+                    if (trackedInstance == std::end(m_counterData))
+                    {
+                        m_counterData.push_back(std::make_unique<details::ctPdhPerformanceCounterData<T>>(m_collectionType, instanceValue.m_instanceName));
+                        trackedInstance = std::end(m_counterData) - 1;
+                    }
+                    (*trackedInstance)->add(details::ctPdhFormat<T>::read(instanceValue.m_value));
+                }
+            }
+        }
+
+        details::ctPdhPerformanceCallback register_callback()
+        {
+            // the callback function must be no-except - it can't leak an exception to the caller
+            // as it shouldn't break calling all other callbacks if one happens to fail an update
+            return [this](const details::CallbackAction updateData) noexcept {
+                try
+                {
+                    switch (updateData)
+                    {
+                        case details::CallbackAction::Start:
+                            m_dataStopped = false;
+                            break;
+
+                        case details::CallbackAction::Stop:
+                            m_dataStopped = true;
+                            break;
+
+                        case details::CallbackAction::Update:
+                            update_counter_data();
+                            break;
+
+                        case details::CallbackAction::Clear:
+                        {
+                            FAIL_FAST_IF_MSG(
+                                !m_dataStopped,
+                                "ctPdhPerformanceCounter: must call stop_all_counters on the ctPdhPerformance class containing this counter");
+
+                            const auto lock = m_guardCounterData.lock();
+                            for (auto& counterData : m_counterData)
+                            {
+                                counterData->clear();
+                            }
+                            break;
+                        }
+                    }
+                }
+                CATCH_LOG()
+                    // if failed to update the counter data this pass
+                    // will try again the next timer callback
+            };
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctPdhPerformance
+    ///
+    /// class to register for and collect performance counters through one PDH query
+    /// - captures counter data into the ctPdhPerformanceCounter objects passed through add_counter()
+    ///
+    /// CAUTION:
+    /// - do not access the ctPdhPerformanceCounter instances while between calling start() and stop()
+    /// - any iterators returned can be invalidated when more data is added on the next cycle
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctPdhPerformance final
+    {
+    public:
+        ctPdhPerformance()
+        {
+            m_lockedData = std::make_unique<LockedData>();
+            details::ThrowIfPdhFailed(PdhOpenQueryW(nullptr, 0, m_query.addressof()), "PdhOpenQuery", L"");
+        }
+
+        ~ctPdhPerformance() noexcept
+        {
+            // when being destroyed, don't invoke callbacks
+            // the counters might be destroyed and we don't hold a ref on them
+            if (m_lockedData)
+            {
+                auto lock = m_lockedData->m_lock.lock();
+                m_lockedData->m_countersStarted = false;
+            }
+            m_timer.reset();
+        }
+
+        template <typename T>
+        void add_counter(const std::shared_ptr<ctPdhPerformanceCounter<T>>& perfCounterObject)
+        {
+            perfCounterObject->add_to_query(m_query.get());
+            m_callbacks.push_back(perfCounterObject->register_callback());
+        }
+
+        void start_all_counters(unsigned interval)
+        {
+            if (!m_timer)
+            {
+                m_timer.reset(CreateThreadpoolTimer(TimerCallback, this, nullptr));
+                THROW_LAST_ERROR_IF(!m_timer);
+            }
+
+            // collect the first sample now: rate counters are calculated from the prior sample on each timer
+            // - so each counter's first data point is one interval from now
+            (void)PdhCollectQueryData(m_query.get());
+
+            for (auto& callback : m_callbacks)
+            {
+                callback(details::CallbackAction::Start);
+            }
+
+            {
+                auto lock = m_lockedData->m_lock.lock();
+                m_lockedData->m_countersStarted = true;
+                m_timerInterval = interval;
+                FILETIME relativeTimeout = wil::filetime::from_int64(-1 * wil::filetime_duration::one_millisecond * m_timerInterval);
+                SetThreadpoolTimer(m_timer.get(), &relativeTimeout, 0, 0);
+            }
+        }
+        // no-throw / no-fail
+        void stop_all_counters() noexcept
+        {
+            {
+                auto lock = m_lockedData->m_lock.lock();
+                m_lockedData->m_countersStarted = false;
+            }
+
+            m_timer.reset();
+
+            for (auto& callback : m_callbacks)
+            {
+                callback(details::CallbackAction::Stop);
+            }
+        }
+
+        // no-throw / no-fail
+        void clear_counter_data() noexcept
+        {
+            for (auto& callback : m_callbacks)
+            {
+                callback(details::CallbackAction::Clear);
+            }
+        }
+
+        ctPdhPerformance(const ctPdhPerformance&) = delete;
+        ctPdhPerformance& operator=(const ctPdhPerformance&) = delete;
+        ctPdhPerformance& operator=(ctPdhPerformance&& rhs) noexcept = delete;
+
+        // movable
+        ctPdhPerformance(ctPdhPerformance&& rhs) noexcept = default;
+
+    private:
+        unique_pdh_query m_query;
+        // for each interval, callback each of the registered counters
+        std::vector<details::ctPdhPerformanceCallback> m_callbacks;
+        // timer to fire to indicate when to collect the data
+        // declare last to guarantee will be destroyed first
+        unsigned long m_timerInterval{};
+        wil::unique_threadpool_timer m_timer;
+
+        // must dynamically allocate this as the critical_section isn't movable
+        // and the ctPdhPerformance objects must be movable
+        struct LockedData
+        {
+            wil::critical_section m_lock{500};
+            bool m_countersStarted = false;
+        };
+        std::unique_ptr<LockedData> m_lockedData;
+
+        static void NTAPI TimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER) noexcept
+        {
+            auto* pThis = static_cast<ctPdhPerformance*>(pContext);
+            // best-effort to update the caller with the data from this time-slice
+            if (ERROR_SUCCESS == PdhCollectQueryData(pThis->m_query.get()))
+            {
+                for (const auto& callback : pThis->m_callbacks)
+                {
+                    callback(details::CallbackAction::Update);
+                }
+            }
+
+            auto lock = pThis->m_lockedData->m_lock.lock();
+            if (pThis->m_lockedData->m_countersStarted)
+            {
+                FILETIME relativeTimeout = wil::filetime::from_int64(-1 * wil::filetime_duration::one_millisecond * pThis->m_timerInterval);
+                SetThreadpoolTimer(pThis->m_timer.get(), &relativeTimeout, 0, 0);
+            }
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctPdhPerformanceSampler
+    ///
+    /// the same counters as ctPdhPerformanceCounter, collected through one PDH query when the caller asks
+    /// - for callers aligning the counters to their own intervals instead of a ctPdhPerformance timer
+    /// - only the values of the last collect are kept: nothing is accumulated across samples
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctPdhPerformanceSampler final
+    {
+    public:
+        ctPdhPerformanceSampler()
+        {
+            details::ThrowIfPdhFailed(PdhOpenQueryW(nullptr, 0, m_query.addressof()), "PdhOpenQuery", L"");
+        }
+        ~ctPdhPerformanceSampler() noexcept = default;
+
+        // counters are named by their ctWmiEnumClassName and WMI property name, as with ctCreatePdhPerfCounter
+        // - instanceName == nullptr sums the values of every instance
+        // - returns the index to pass to value()
+        size_t add_counter(ctWmiEnumClassName className, _In_ PCWSTR counterName, _In_opt_ PCWSTR instanceName = nullptr)
+        {
+            Counter counter;
+            counter.m_counterPath = details::ctPdhCounterPath(className, counterName, &counter.m_instanced);
+            if (instanceName)
+            {
+                counter.m_instanceName = instanceName;
+            }
+            details::ThrowIfPdhFailed(
+                PdhAddEnglishCounterW(m_query.get(), counter.m_counterPath.c_str(), 0, &counter.m_counter),
+                "PdhAddEnglishCounter",
+                counter.m_counterPath.c_str());
+
+            m_counters.emplace_back(std::move(counter));
+            return m_counters.size() - 1;
+        }
+
+        // collects every counter: rate counters report the rate since the prior collect
+        // - call once after adding all counters to take the first sample the rates are calculated from
+        // - returns false if the query could not be collected, leaving the prior values
+        bool collect() noexcept
+        try
+        {
+            if (PdhCollectQueryData(m_query.get()) != ERROR_SUCCESS)
+            {
+                return false;
+            }
+
+            for (auto& counter : m_counters)
+            {
+                double value = 0.0;
+                for (const auto& instance : details::ctPdhReadInstances(counter.m_counter, c_format, counter.m_instanced))
+                {
+                    if (details::ctPdhValidData(instance.m_value) &&
+                        (counter.m_instanceName.empty() || ctString::ctOrdinalEqualsCaseInsensative(counter.m_instanceName, instance.m_instanceName)))
+                    {
+                        value += instance.m_value.doubleValue;
+                    }
+                }
+                counter.m_value = value;
+            }
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+
+        // the value from the last collect : zero until the second collect for rate counters
+        [[nodiscard]] double value(size_t counter) const noexcept
+        {
+            return counter < m_counters.size() ? m_counters[counter].m_value : 0.0;
+        }
+
+        ctPdhPerformanceSampler(const ctPdhPerformanceSampler&) = delete;
+        ctPdhPerformanceSampler& operator=(const ctPdhPerformanceSampler&) = delete;
+        ctPdhPerformanceSampler(ctPdhPerformanceSampler&&) = delete;
+        ctPdhPerformanceSampler& operator=(ctPdhPerformanceSampler&&) = delete;
+
+    private:
+        // performance counters can exceed 100% across multiple processors (as WMI returns them)
+        static constexpr DWORD c_format = PDH_FMT_DOUBLE | PDH_FMT_NOCAP100;
+
+        struct Counter
+        {
+            std::wstring m_counterPath;
+            std::wstring m_instanceName;
+            PDH_HCOUNTER m_counter = nullptr;
+            bool m_instanced = false;
+            double m_value = 0.0;
+        };
+
+        unique_pdh_query m_query;
+        std::vector<Counter> m_counters;
+    };
+
+    template <typename T>
+    std::shared_ptr<ctPdhPerformanceCounter<T>> ctCreatePdhPerfCounter(
+        ctWmiEnumClassName className, _In_ PCWSTR counterName, ctWmiPerformanceCollectionType collectionType = ctWmiPerformanceCollectionType::Detailed)
+    {
+        return std::make_shared<ctPdhPerformanceCounter<T>>(className, counterName, collectionType);
+    }
+} // ctl namespace
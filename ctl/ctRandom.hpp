@@ -17,6 +17,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // cpp headers
 #include <random>
 #include <memory>
+#include <cstdint>
 
 namespace ctl
 {
@@ -104,6 +105,58 @@ namespace ctl
         lhs.swap(rhs);
     }
 
+    /// A small-state generator (xoshiro256**) complementing ctRandomTwister for hot paths
+    ///
+    /// This generator makes the same assumptions as ctRandomTwister, with these differences:
+    ///   - The state is only 32 bytes, kept inline (no heap allocation)
+    ///   - Instances are not thread-safe: they are intended to be declared thread_local,
+    ///     so threads never share (or contend on) the generator state
+    ///
+    /// It meets the UniformRandomBitGenerator requirements, so can be used with any STL <random> distribution
+    class ctRandomFast
+    {
+    public:
+        typedef uint64_t result_type;
+
+        /// Constructs the generator with an explicitly specified seed,
+        /// expanding it into the full state with splitmix64
+        explicit ctRandomFast(uint64_t seed) noexcept;
+
+        /// Seeds itself randomly with std::random_device
+        ctRandomFast();
+
+        /// Generates a new random integer in the range [lowerInclusiveBound, upperInclusiveBound].
+        /// Each integer in the range is equally likely to be chosen.
+        template <class IntegerT>
+        IntegerT uniform_int(IntegerT lowerInclusiveBound, IntegerT upperInclusiveBound) noexcept;
+
+        // UniformRandomBitGenerator requirements
+        // - parenthesized to not expand the min and max macros from Windows.h
+        static constexpr result_type (min)() noexcept
+        {
+            return 0ULL;
+        }
+        static constexpr result_type (max)() noexcept
+        {
+            return UINT64_MAX;
+        }
+        result_type operator()() noexcept;
+
+        ~ctRandomFast() = default;
+        ctRandomFast(const ctRandomFast&) = default;
+        ctRandomFast& operator=(const ctRandomFast&) = default;
+        ctRandomFast(ctRandomFast&&) = default;
+        ctRandomFast& operator=(ctRandomFast&&) = default;
+
+    private:
+        static uint64_t rotate_left(uint64_t value, int count) noexcept
+        {
+            return (value << count) | (value >> (64 - count));
+        }
+
+        uint64_t m_state[4]{};
+    };
+
 
     // Implementation
 
@@ -149,4 +202,45 @@ namespace ctl
     {
         m_engine->seed(seed);
     }
+
+    inline ctRandomFast::ctRandomFast(uint64_t seed) noexcept
+    {
+        for (auto& state : m_state)
+        {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t mixed = seed;
+            mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebULL;
+            state = mixed ^ (mixed >> 31);
+        }
+    }
+
+    inline ctRandomFast::ctRandomFast() :
+        ctRandomFast([] {
+            std::random_device randomDevice;
+            return static_cast<uint64_t>(randomDevice()) << 32 | static_cast<uint64_t>(randomDevice());
+        }())
+    {
+    }
+
+    inline ctRandomFast::result_type ctRandomFast::operator()() noexcept
+    {
+        const uint64_t result = rotate_left(m_state[1] * 5, 7) * 9;
+        const uint64_t shifted = m_state[1] << 17;
+
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= shifted;
+        m_state[3] = rotate_left(m_state[3], 45);
+
+        return result;
+    }
+
+    template <class IntegerT>
+    IntegerT ctRandomFast::uniform_int(IntegerT lowerInclusiveBound, IntegerT upperInclusiveBound) noexcept
+    {
+        return std::uniform_int_distribution<IntegerT>(lowerInclusiveBound, upperInclusiveBound)(*this);
+    }
 } // namespace ctl
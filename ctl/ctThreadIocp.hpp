@@ -16,8 +16,13 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
-#include <utility>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 // os headers
 #include <excpt.h>
 #include <Windows.h>
@@ -42,28 +47,351 @@ namespace ctl
     // - to allow the callback function to find the callback
     //   associated with that completed OVERLAPPED* 
     //
-    struct ctThreadIocpCallbackInfo
+    // the callback is constructed in-place in callback_storage (no heap allocation)
+    // - callbacks larger than c_callbackStorageSize (or over-aligned) are heap-allocated instead,
+    //   with callback_storage holding the pointer : callers on hot paths can static_assert stored_in_place
+    // - these objects are cached in a per-ctThreadIocp freelist and reused across IO requests
+    //
+    struct alignas(MEMORY_ALLOCATION_ALIGNMENT) ctThreadIocpCallbackInfo
     {
+        // sized for the per-IO callbacks of ctsTraffic : a 96-byte ctsTask captured with up to two shared_ptrs and a length
+        static constexpr size_t c_callbackStorageSize = 144;
+
+        // true when the callback is constructed in callback_storage, false when set_callback must heap-allocate it
+        template <typename Callback>
+        static constexpr bool stored_in_place =
+            sizeof(std::decay_t<Callback>) <= c_callbackStorageSize &&
+            alignof(std::decay_t<Callback>) <= alignof(std::max_align_t);
+
         OVERLAPPED ov{};
-        PVOID padding{}; // required padding before the std::function for the below static_assert alignment/sizing to be correct
-        ctThreadIocpCallback_t callback;
+        SLIST_ENTRY list_entry{};
+        void (*invoke_callback)(void* _callback, OVERLAPPED* _overlapped) = nullptr;
+        void (*destroy_callback)(void* _callback) noexcept = nullptr;
+        alignas(std::max_align_t) unsigned char callback_storage[c_callbackStorageSize]{};
 
-        // ReSharper disable once CppPossiblyUninitializedMember
-        explicit ctThreadIocpCallbackInfo(ctThreadIocpCallback_t&& _callback) noexcept
-            : callback(std::move(_callback))
+        ctThreadIocpCallbackInfo() noexcept = default;
+        ~ctThreadIocpCallbackInfo() noexcept
         {
-            ::ZeroMemory(&ov, sizeof ov);
+            reset();
         }
-        ~ctThreadIocpCallbackInfo() noexcept = default;
         // non-copyable
         ctThreadIocpCallbackInfo(const ctThreadIocpCallbackInfo&) = delete;
         ctThreadIocpCallbackInfo& operator=(const ctThreadIocpCallbackInfo&) = delete;
         ctThreadIocpCallbackInfo(ctThreadIocpCallbackInfo&&) = delete;
         ctThreadIocpCallbackInfo& operator=(ctThreadIocpCallbackInfo&&) = delete;
+
+        // can throw if constructing the callback throws - invoke_callback/destroy_callback are only set once constructed
+        template <typename Callback>
+        void set_callback(Callback&& _callback)
+        {
+            using CallbackType = std::decay_t<Callback>;
+            if constexpr (stored_in_place<Callback>)
+            {
+                new (callback_storage) CallbackType(std::forward<Callback>(_callback));
+                invoke_callback = [](void* _callback, OVERLAPPED* _overlapped) {
+                    (*static_cast<CallbackType*>(_callback))(_overlapped);
+                };
+                destroy_callback = [](void* _callback) noexcept {
+                    static_cast<CallbackType*>(_callback)->~CallbackType();
+                };
+            }
+            else
+            {
+                // too large to construct in place : callback_storage holds the heap-allocated callback
+                static_assert(sizeof(CallbackType*) <= c_callbackStorageSize);
+                new (callback_storage) CallbackType*(new CallbackType(std::forward<Callback>(_callback)));
+                invoke_callback = [](void* _callback, OVERLAPPED* _overlapped) {
+                    (**static_cast<CallbackType**>(_callback))(_overlapped);
+                };
+                destroy_callback = [](void* _callback) noexcept {
+                    delete *static_cast<CallbackType**>(_callback);
+                };
+            }
+        }
+
+        void invoke()
+        {
+            invoke_callback(callback_storage, &ov);
+        }
+
+        // destroys the captured callback so no references are held while the object sits in the freelist
+        void reset() noexcept
+        {
+            if (destroy_callback)
+            {
+                destroy_callback(callback_storage);
+            }
+            invoke_callback = nullptr;
+            destroy_callback = nullptr;
+        }
     };
 
     // asserting at compile time, as we assume this when we reinterpret_cast in the callback
-    static_assert(sizeof(ctThreadIocpCallbackInfo) == sizeof(OVERLAPPED) + sizeof(PVOID) + sizeof(ctThreadIocpCallback_t));
+    static_assert(offsetof(ctThreadIocpCallbackInfo, ov) == 0);
+
+    //
+    // lock-free freelist of ctThreadIocpCallbackInfo objects
+    // - owned by a ctThreadIocp (allocated separately so the ctThreadIocp can be moved)
+    // - bounded by c_maxCachedRequests so a burst of IO doesn't pin memory for the life of the handle
+    //
+    class ctThreadIocpCallbackPool
+    {
+    public:
+        static constexpr USHORT c_maxCachedRequests = 64;
+
+        ctThreadIocpCallbackPool() noexcept
+        {
+            InitializeSListHead(&free_list);
+        }
+        ~ctThreadIocpCallbackPool() noexcept
+        {
+            auto* list_entry = InterlockedFlushSList(&free_list);
+            while (list_entry)
+            {
+                auto* const next_entry = list_entry->Next;
+                delete CONTAINING_RECORD(list_entry, ctThreadIocpCallbackInfo, list_entry);
+                list_entry = next_entry;
+            }
+        }
+        ctThreadIocpCallbackPool(const ctThreadIocpCallbackPool&) = delete;
+        ctThreadIocpCallbackPool& operator=(const ctThreadIocpCallbackPool&) = delete;
+        ctThreadIocpCallbackPool(ctThreadIocpCallbackPool&&) = delete;
+        ctThreadIocpCallbackPool& operator=(ctThreadIocpCallbackPool&&) = delete;
+
+        // can throw std::bad_alloc if the freelist is empty
+        ctThreadIocpCallbackInfo* acquire()
+        {
+            auto* const list_entry = InterlockedPopEntrySList(&free_list);
+            if (list_entry)
+            {
+                return CONTAINING_RECORD(list_entry, ctThreadIocpCallbackInfo, list_entry);
+            }
+            // ReSharper disable once CppNonReclaimedResourceAcquisition
+            return new ctThreadIocpCallbackInfo;
+        }
+
+        void release(_In_ ctThreadIocpCallbackInfo* _request) noexcept
+        {
+            _request->reset();
+            // the depth check is racy but only used as a soft bound
+            if (QueryDepthSList(&free_list) >= c_maxCachedRequests)
+            {
+                delete _request;
+                return;
+            }
+            InterlockedPushEntrySList(&free_list, &_request->list_entry);
+        }
+
+        // with a ctThreadIocpEngine every IO in flight holds a reference, as the ctThreadIocp can be destroyed from one of its callbacks
+        // - the owning ctThreadIocp holds the initial reference
+        void add_reference() noexcept
+        {
+            InterlockedIncrement(&references);
+        }
+
+        void release_reference() noexcept
+        {
+            if (0 == InterlockedDecrement(&references))
+            {
+                delete this;
+            }
+        }
+
+        // waits for the callbacks of every IO in flight, as WaitForThreadpoolIoCallbacks does for the thread pool
+        // - the owner's reference remains, and the reference of the running callback when called from one of this pool's callbacks
+        void wait_for_callbacks() noexcept
+        {
+            const long remaining = running_pool == this ? 2 : 1;
+            for (unsigned long spin = 0; ReadAcquire(&references) > remaining; ++spin)
+            {
+                if (spin < 64)
+                {
+                    YieldProcessor();
+                }
+                else
+                {
+                    Sleep(spin < 1024 ? 0 : 1);
+                }
+            }
+        }
+
+        // set by the ctThreadIocpEngine thread while it invokes a callback of this pool
+        static inline thread_local const ctThreadIocpCallbackPool* running_pool = nullptr;
+
+    private:
+        SLIST_HEADER free_list{};
+        long references = 1;
+    };
+
+    //
+    // invokes the callback of a completed request and returns the request to its pool
+    //
+    inline void ctThreadIocpInvokeCallback(_In_ ctThreadIocpCallbackPool* _pool, _In_ OVERLAPPED* _overlapped) noexcept
+    {
+        // this code may look really odd 
+        // the Win32 TP APIs eat stack overflow exceptions and reuses the thread for the next TP request
+        // it is *not* expected that callers can/will harden their callback functions to be resilient to running out of stack at any momemnt
+        // since we *do* hit this in stress, and we face ugly lock-related breaks since an SEH was swallowed while a callback held a lock, 
+        // we're working really hard to break and never let TP swalling SEH exceptions
+        EXCEPTION_POINTERS* exr = nullptr;
+        __try
+        {
+            auto* _request = reinterpret_cast<ctThreadIocpCallbackInfo*>(_overlapped);
+            _request->invoke();
+            _pool->release(_request);
+        }
+        // ReSharper disable once CppAssignedValueIsNeverUsed (exr is used in the except handler)
+        __except (exr = GetExceptionInformation(), EXCEPTION_EXECUTE_HANDLER)
+        {
+            __try
+            {
+                RaiseFailFastException(exr->ExceptionRecord, exr->ContextRecord, 0);
+            }
+#pragma warning(suppress: 6320) // not hiding exceptions: RaiseFailFastException is fatal - this creates a break to help debugging in some scenarios
+            __except (EXCEPTION_EXECUTE_HANDLER)
+            {
+                __debugbreak();
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctThreadIocpEngine
+    ///
+    /// an alternative to the system thread pool for completing ctThreadIocp requests
+    /// - a fixed set of threads (one per processor, affinitized to that processor), each owning its own IO completion port
+    /// - each thread dequeues completions in batches with GetQueuedCompletionStatusEx
+    /// - handles are associated with the completion ports round-robin as ctThreadIocp objects are constructed
+    ///
+    /// Completions are invoked exactly like the thread pool path, and the ctThreadIocp d'tor likewise waits for their callbacks
+    /// - the callback pool is kept alive by a reference for each IO in flight
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctThreadIocpEngine
+    {
+    public:
+        static constexpr ULONG c_completionBatchSize = 64;
+
+        // can throw wil::ResultException
+        ctThreadIocpEngine()
+        {
+            try
+            {
+                const auto groupCount = GetActiveProcessorGroupCount();
+                for (WORD group = 0; group < groupCount; ++group)
+                {
+                    const auto processorCount = GetActiveProcessorCount(group);
+                    for (DWORD number = 0; number < processorCount; ++number)
+                    {
+                        auto& worker = workers.emplace_back(std::make_unique<Worker>());
+                        worker->port.reset(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1));
+                        if (!worker->port)
+                        {
+                            THROW_WIN32_MSG(GetLastError(), "CreateIoCompletionPort");
+                        }
+
+                        worker->thread.reset(CreateThread(nullptr, 0, WorkerThread, worker.get(), CREATE_SUSPENDED, nullptr));
+                        if (!worker->thread)
+                        {
+                            THROW_WIN32_MSG(GetLastError(), "CreateThread");
+                        }
+                        GROUP_AFFINITY affinity{};
+                        affinity.Group = group;
+                        affinity.Mask = KAFFINITY{1} << number;
+                        if (!SetThreadGroupAffinity(worker->thread.get(), &affinity, nullptr))
+                        {
+                            THROW_WIN32_MSG(GetLastError(), "SetThreadGroupAffinity");
+                        }
+                        ResumeThread(worker->thread.get());
+                    }
+                }
+            }
+            catch (...)
+            {
+                stop();
+                throw;
+            }
+        }
+
+        ~ctThreadIocpEngine() noexcept
+        {
+            stop();
+        }
+
+        ctThreadIocpEngine(const ctThreadIocpEngine&) = delete;
+        ctThreadIocpEngine& operator=(const ctThreadIocpEngine&) = delete;
+        ctThreadIocpEngine(ctThreadIocpEngine&&) = delete;
+        ctThreadIocpEngine& operator=(ctThreadIocpEngine&&) = delete;
+
+        // the completion port the next handle should be associated with
+        [[nodiscard]] HANDLE next_port() noexcept
+        {
+            const auto next_worker = static_cast<size_t>(InterlockedIncrement(&port_index)) % workers.size();
+            return workers[next_worker]->port.get();
+        }
+
+        [[nodiscard]] size_t thread_count() const noexcept
+        {
+            return workers.size();
+        }
+
+    private:
+        struct Worker
+        {
+            wil::unique_handle port;
+            wil::unique_handle thread;
+        };
+        std::vector<std::unique_ptr<Worker>> workers;
+        unsigned long port_index = 0;
+
+        // a null completion key is only posted to stop the worker
+        static DWORD WINAPI WorkerThread(LPVOID _context) noexcept
+        {
+            const auto* const worker = static_cast<Worker*>(_context);
+            OVERLAPPED_ENTRY completions[c_completionBatchSize];
+            bool stopping = false;
+            while (!stopping)
+            {
+                ULONG completionCount = 0;
+                if (!GetQueuedCompletionStatusEx(worker->port.get(), completions, c_completionBatchSize, &completionCount, INFINITE, FALSE))
+                {
+                    return GetLastError();
+                }
+
+                for (ULONG completion = 0; completion < completionCount; ++completion)
+                {
+                    if (0 == completions[completion].lpCompletionKey)
+                    {
+                        stopping = true;
+                        continue;
+                    }
+
+                    auto* const callback_pool = reinterpret_cast<ctThreadIocpCallbackPool*>(completions[completion].lpCompletionKey);
+                    ctThreadIocpCallbackPool::running_pool = callback_pool;
+                    ctThreadIocpInvokeCallback(callback_pool, completions[completion].lpOverlapped);
+                    ctThreadIocpCallbackPool::running_pool = nullptr;
+                    callback_pool->release_reference();
+                }
+            }
+            return NO_ERROR;
+        }
+
+        void stop() noexcept
+        {
+            for (const auto& worker : workers)
+            {
+                if (worker->thread)
+                {
+                    // resume in case construction failed before the thread was started
+                    ResumeThread(worker->thread.get());
+                    PostQueuedCompletionStatus(worker->port.get(), 0, 0, nullptr);
+                    WaitForSingleObject(worker->thread.get(), INFINITE);
+                }
+            }
+            workers.clear();
+        }
+    };
 
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -103,37 +431,59 @@ namespace ctl
         // These c'tors can fail under low resources
         // - wil::ResultException (from the ThreadPool APIs)
         //
-        explicit ctThreadIocp(HANDLE _handle, _In_opt_ PTP_CALLBACK_ENVIRON _ptp_env = nullptr)
+        explicit ctThreadIocp(HANDLE _handle, _In_opt_ PTP_CALLBACK_ENVIRON _ptp_env = nullptr) :
+            callback_pool(std::make_unique<ctThreadIocpCallbackPool>())
         {
-            ptp_io = CreateThreadpoolIo(_handle, IoCompletionCallback, nullptr, _ptp_env);
+            ptp_io = CreateThreadpoolIo(_handle, IoCompletionCallback, callback_pool.get(), _ptp_env);
             if (!ptp_io)
             {
                 THROW_WIN32_MSG(GetLastError(), "CreateThreadpoolIo");
             }
         }
 
-        explicit ctThreadIocp(SOCKET _socket, _In_opt_ PTP_CALLBACK_ENVIRON _ptp_env = nullptr)
+        explicit ctThreadIocp(SOCKET _socket, _In_opt_ PTP_CALLBACK_ENVIRON _ptp_env = nullptr) :
+            callback_pool(std::make_unique<ctThreadIocpCallbackPool>())
         {
-            ptp_io = CreateThreadpoolIo(reinterpret_cast<HANDLE>(_socket), IoCompletionCallback, nullptr, _ptp_env);
+            ptp_io = CreateThreadpoolIo(reinterpret_cast<HANDLE>(_socket), IoCompletionCallback, callback_pool.get(), _ptp_env);
             if (!ptp_io)
             {
                 THROW_WIN32_MSG(GetLastError(), "CreateThreadpoolIo");
             }
         }
 
+        // completes IO on one of the ctThreadIocpEngine threads instead of the system thread pool
+        ctThreadIocp(SOCKET _socket, ctThreadIocpEngine& _engine) :
+            callback_pool(std::make_unique<ctThreadIocpCallbackPool>())
+        {
+            if (!CreateIoCompletionPort(reinterpret_cast<HANDLE>(_socket), _engine.next_port(), reinterpret_cast<ULONG_PTR>(callback_pool.get()), 0))
+            {
+                THROW_WIN32_MSG(GetLastError(), "CreateIoCompletionPort");
+            }
+        }
+
         ~ctThreadIocp()
         {
             // could have been moved out of
             if (ptp_io)
             {
                 // wait for all callbacks
+                // - must complete before callback_pool is destroyed, as callbacks return their objects to it
                 WaitForThreadpoolIoCallbacks(ptp_io, FALSE);
                 CloseThreadpoolIo(ptp_io);
             }
+            else if (callback_pool)
+            {
+                // associated with a ctThreadIocpEngine : wait for all callbacks just as above
+                // - callers rely on this to tear down, as their callbacks capture raw pointers to the objects owning this
+                callback_pool->wait_for_callbacks();
+                // the running callback (if destroyed from one) releases the last reference once it returns
+                callback_pool.release()->release_reference();
+            }
         }
 
         ctThreadIocp(ctThreadIocp&& rhs) noexcept
-            : ptp_io(rhs.ptp_io)
+            : ptp_io(rhs.ptp_io),
+              callback_pool(std::move(rhs.callback_pool))
         {
             // null out the moved-from object's TP ptr since this object now has ownership
             rhs.ptp_io = nullptr;
@@ -141,6 +491,7 @@ namespace ctl
         ctThreadIocp& operator=(ctThreadIocp&& rhs) noexcept
         {
             ptp_io = rhs.ptp_io;
+            callback_pool = std::move(rhs.callback_pool);
             // null out the moved-from object's TP ptr since this object now has ownership
             rhs.ptp_io = nullptr;
             return *this;
@@ -166,16 +517,35 @@ namespace ctl
         // - each call will return a unique OVERLAPPED*
         // - the callback will be given the OVERLAPPED* matching the IO that completed
         //
-        OVERLAPPED* new_request(std::function<void(OVERLAPPED*)> _callback) const
+        // The callback is constructed in-place within a pooled ctThreadIocpCallbackInfo
+        // - steady-state IO does not allocate: objects are returned to the freelist once the callback completes
+        // - a callback type larger than ctThreadIocpCallbackInfo::c_callbackStorageSize is heap-allocated with each request
+        //
+        template <typename Callback>
+        OVERLAPPED* new_request(Callback&& _callback) const
         {
             // this can fail by throwing std::bad_alloc
-            // ReSharper disable CppNonReclaimedResourceAcquisition
-            auto* new_callback = new ctThreadIocpCallbackInfo(std::move(_callback));
-            // ReSharper restore CppNonReclaimedResourceAcquisition
+            auto* new_callback = callback_pool->acquire();
+            try
+            {
+                new_callback->set_callback(std::forward<Callback>(_callback));
+            }
+            catch (...)
+            {
+                callback_pool->release(new_callback);
+                throw;
+            }
 
             // once creating a new request succeeds, start the IO
             // - all below calls are no-fail calls
-            StartThreadpoolIo(ptp_io);
+            if (ptp_io)
+            {
+                StartThreadpoolIo(ptp_io);
+            }
+            else
+            {
+                callback_pool->add_reference();
+            }
             ::ZeroMemory(&new_callback->ov, sizeof OVERLAPPED);
             return &new_callback->ov;
         }
@@ -190,9 +560,15 @@ namespace ctl
         //
         void cancel_request(OVERLAPPED* pOverlapped) const noexcept
         {
-            CancelThreadpoolIo(ptp_io);
-            const auto* const old_request = reinterpret_cast<ctThreadIocpCallbackInfo*>(pOverlapped);
-            delete old_request;
+            callback_pool->release(reinterpret_cast<ctThreadIocpCallbackInfo*>(pOverlapped));
+            if (ptp_io)
+            {
+                CancelThreadpoolIo(ptp_io);
+            }
+            else
+            {
+                callback_pool->release_reference();
+            }
         }
 
         //
@@ -205,40 +581,17 @@ namespace ctl
 
     private:
         PTP_IO ptp_io = nullptr;
+        std::unique_ptr<ctThreadIocpCallbackPool> callback_pool;
 
         static void CALLBACK IoCompletionCallback(
             PTP_CALLBACK_INSTANCE /*_instance*/,
-            PVOID /*_context*/,
+            PVOID _context,
             PVOID _overlapped,
             ULONG /*_ioresult*/,
             ULONG_PTR /*_numberofbytestransferred*/,
-            PTP_IO /*_io*/)
-        {
-            // this code may look really odd 
-            // the Win32 TP APIs eat stack overflow exceptions and reuses the thread for the next TP request
-            // it is *not* expected that callers can/will harden their callback functions to be resilient to running out of stack at any momemnt
-            // since we *do* hit this in stress, and we face ugly lock-related breaks since an SEH was swallowed while a callback held a lock, 
-            // we're working really hard to break and never let TP swalling SEH exceptions
-            EXCEPTION_POINTERS* exr = nullptr;
-            __try
-            {
-                auto* _request = static_cast<ctThreadIocpCallbackInfo*>(_overlapped);
-                _request->callback(static_cast<OVERLAPPED*>(_overlapped));
-                delete _request;
-            }
-            // ReSharper disable once CppAssignedValueIsNeverUsed (exr is used in the except handler)
-            __except (exr = GetExceptionInformation(), EXCEPTION_EXECUTE_HANDLER)
-            {
-                __try
-                {
-                    RaiseFailFastException(exr->ExceptionRecord, exr->ContextRecord, 0);
-                }
-#pragma warning(suppress: 6320) // not hiding exceptions: RaiseFailFastException is fatal - this creates a break to help debugging in some scenarios
-                __except (EXCEPTION_EXECUTE_HANDLER)
-                {
-                    __debugbreak();
-                }
-            }
+            PTP_IO /*_io*/) noexcept
+        {
+            ctThreadIocpInvokeCallback(static_cast<ctThreadIocpCallbackPool*>(_context), static_cast<OVERLAPPED*>(_overlapped));
         }
     };
 } // namespace
@@ -99,24 +99,80 @@ namespace ctl
         namespace Details
         {
             ///
-            /// InitOnce the QPF value as it won't change after the OS has booted
-            /// - hiding within an unnamed namesapce
+            /// The QPF value won't change after the OS has booted
+            /// - calibrating the conversions once so converting QPC ticks doesn't need QPF * 1000 / QPF math on every call
             ///
-            // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
-            static INIT_ONCE g_qpfInitOnce = INIT_ONCE_STATIC_INIT;
-            static LARGE_INTEGER g_qpf;
+            struct QpcCalibration
+            {
+                long long m_qpf = 0;
+                // non-zero when the QPF is a whole number of ticks per millisecond (e.g. 10MHz)
+                // - converting to milliseconds is then a single divide
+                long long m_ticksPerMillisecond = 0;
+            };
 
-            static BOOL CALLBACK QpfInitOnceCallback(_In_ PINIT_ONCE, _In_ PVOID, _In_ PVOID*) noexcept
+            inline const QpcCalibration& GetQpcCalibration() noexcept
             {
-                QueryPerformanceFrequency(&g_qpf);
-                return TRUE;
+                static const QpcCalibration s_calibration = [] {
+                    LARGE_INTEGER qpf;
+                    QueryPerformanceFrequency(&qpf);
+
+                    QpcCalibration calibration;
+                    calibration.m_qpf = qpf.QuadPart;
+                    if (0 == qpf.QuadPart % 1000LL)
+                    {
+                        calibration.m_ticksPerMillisecond = qpf.QuadPart / 1000LL;
+                    }
+                    return calibration;
+                }();
+                return s_calibration;
             }
         }
 
         inline long long SnapQpf() noexcept
         {
-            InitOnceExecuteOnce(&Details::g_qpfInitOnce, Details::QpfInitOnceCallback, nullptr, nullptr);
-            return Details::g_qpf.QuadPart;
+            return Details::GetQpcCalibration().m_qpf;
+        }
+
+        ///
+        /// Raw QPC ticks - the cheapest timestamp to take when measuring latency
+        /// - convert the difference between two ticks with ConvertQpcToMicroseconds or ConvertQpcToMillis
+        ///
+        inline long long SnapQpc() noexcept
+        {
+            LARGE_INTEGER qpc;
+            QueryPerformanceCounter(&qpc);
+            return qpc.QuadPart;
+        }
+
+        inline long long ConvertQpcToMillis(long long qpc) noexcept
+        {
+            const auto& calibration = Details::GetQpcCalibration();
+            if (calibration.m_ticksPerMillisecond != 0)
+            {
+                return qpc / calibration.m_ticksPerMillisecond;
+            }
+            // splitting the seconds from the remainder to not overflow multiplying by 1000
+            return qpc / calibration.m_qpf * 1000LL + qpc % calibration.m_qpf * 1000LL / calibration.m_qpf;
+        }
+
+        inline long long ConvertQpcToMicroseconds(long long qpc) noexcept
+        {
+            const auto& calibration = Details::GetQpcCalibration();
+            return qpc / calibration.m_qpf * 1000000LL + qpc % calibration.m_qpf * 1000000LL / calibration.m_qpf;
+        }
+
+        inline long long ConvertMicrosecondsToQpc(long long microseconds) noexcept
+        {
+            const auto& calibration = Details::GetQpcCalibration();
+            return microseconds / 1000000LL * calibration.m_qpf + microseconds % 1000000LL * calibration.m_qpf / 1000000LL;
+        }
+
+        inline long long ConvertMillisToQpc(long long milliseconds) noexcept
+        {
+            const auto& calibration = Details::GetQpcCalibration();
+            return calibration.m_ticksPerMillisecond != 0 ?
+                milliseconds * calibration.m_ticksPerMillisecond :
+                milliseconds * calibration.m_qpf / 1000LL;
         }
 
 #ifdef CTSTRAFFIC_UNIT_TESTS
@@ -127,11 +183,7 @@ namespace ctl
 #else
         inline long long SnapQpcInMillis() noexcept
         {
-            InitOnceExecuteOnce(&Details::g_qpfInitOnce, Details::QpfInitOnceCallback, nullptr, nullptr);
-            LARGE_INTEGER qpc;
-            QueryPerformanceCounter(&qpc);
-            // multiplying by 1000 as (qpc / qpf) == seconds
-            return static_cast<long long>(qpc.QuadPart * 1000LL / Details::g_qpf.QuadPart);
+            return ConvertQpcToMillis(SnapQpc());
         }
 #endif
 
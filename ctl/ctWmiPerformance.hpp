@@ -30,6 +30,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <wil/resource.h>
 #include <wil/win32_helpers.h>
 // ctl headers
+#include <ctMath.hpp>
 #include <ctString.hpp>
 #include <ctWmiInitialize.hpp>
 
@@ -87,7 +88,9 @@ namespace ctl
     {
         Detailed,
         MeanOnly,
-        FirstLast
+        FirstLast,
+        // bounded memory: a log-linear histogram per instance, summarized when accessed
+        Histogram
     };
 
     inline bool operator ==(const wil::unique_variant& rhs, const wil::unique_variant& lhs) noexcept
@@ -478,6 +481,7 @@ namespace ctl
             const std::wstring m_counterName;
             std::vector<T> m_counterData;
             ULONGLONG m_counterSum = 0;
+            ctLogLinearHistogram<T> m_counterHistogram;
 
             void add_data(const T& instanceData)
             {
@@ -535,6 +539,15 @@ namespace ctl
                         }
                         break;
 
+                    case ctWmiPerformanceCollectionType::Histogram:
+                        // the summary is written when accessed: see ctLogLinearHistogram::write_summary
+                        if (m_counterData.empty())
+                        {
+                            m_counterData.resize(ctLogLinearHistogram<T>::c_summarySize);
+                        }
+                        m_counterHistogram.add(instanceData);
+                        break;
+
                     default:
                         FAIL_FAST_MSG(
                             "Unknown ctWmiPerformanceCollectionType (%u)",
@@ -550,6 +563,10 @@ namespace ctl
                 {
                     m_counterData[3] = static_cast<T>(m_counterSum / m_counterData[0]);
                 }
+                else if (ctWmiPerformanceCollectionType::Histogram == m_collectionType && !m_counterData.empty())
+                {
+                    m_counterHistogram.write_summary(m_counterData);
+                }
                 return m_counterData.cbegin();
             }
 
@@ -646,6 +663,7 @@ namespace ctl
                 const auto lock = m_guardData.lock();
                 m_counterData.clear();
                 m_counterSum = 0;
+                m_counterHistogram.clear();
             }
 
             // non-copyable
@@ -15,6 +15,8 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <algorithm>
+#include <execution>
 #include <string>
 #include <vector>
 #include <set>
@@ -31,6 +33,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <wil/resource.h>
 #include <wil/win32_helpers.h>
 // ctl headers
+#include <ctMath.hpp>
 #include <ctSockaddr.hpp>
 
 namespace ctsPerf
@@ -378,7 +381,7 @@ namespace ctsPerf
                 TCP_ESTATS_SND_CONG_ROD_v0 rod{};
                 if (0 == GetPerConnectionDynamicEstats<TcpConnectionEstatsSndCong>(tcpRow, &rod))
                 {
-                    m_conjestionWindows.push_back(rod.CurCwnd);
+                    m_conjestionWindows.add(rod.CurCwnd);
                     m_bytesSentInReceiverLimited = rod.SndLimBytesRwin;
                     m_bytesSentInSenderLimited = rod.SndLimBytesSnd;
                     m_bytesSentInCongestionLimited = rod.SndLimBytesCwnd;
@@ -389,7 +392,8 @@ namespace ctsPerf
             }
 
         private:
-            std::vector<ULONG> m_conjestionWindows;
+            // histograms keep memory bounded for long-lived connections
+            ctl::ctLogLinearHistogram<ULONG> m_conjestionWindows;
 
             SIZE_T m_bytesSentInReceiverLimited = 0;
             SIZE_T m_bytesSentInSenderLimited = 0;
@@ -437,8 +441,8 @@ namespace ctsPerf
                 TCP_ESTATS_PATH_ROD_v0 rod{};
                 if (0 == GetPerConnectionDynamicEstats<TcpConnectionEstatsPath>(tcpRow, &rod))
                 {
-                    m_retransmitTimer.push_back(rod.CurRto);
-                    m_roundTripTime.push_back(rod.SmoothedRtt);
+                    m_retransmitTimer.add(rod.CurRto);
+                    m_roundTripTime.add(rod.SmoothedRtt);
                     m_bytesRetrans = rod.BytesRetrans;
                     m_dupAcksRcvd = rod.DupAcksIn;
                     m_sacksRcvd = rod.SacksRcvd;
@@ -448,8 +452,8 @@ namespace ctsPerf
             }
 
         private:
-            std::vector<ULONG> m_retransmitTimer;
-            std::vector<ULONG> m_roundTripTime;
+            ctl::ctLogLinearHistogram<ULONG> m_retransmitTimer;
+            ctl::ctLogLinearHistogram<ULONG> m_roundTripTime;
             ULONG m_bytesRetrans = 0;
             ULONG m_dupAcksRcvd = 0;
             ULONG m_sacksRcvd = 0;
@@ -472,19 +476,8 @@ namespace ctsPerf
                 formattedString += wil::str_printf<std::wstring>(L"%lu,", m_minReceiveWindow);
                 formattedString += wil::str_printf<std::wstring>(L"%lu,", m_maxReceiveWindow);
 
-                ULONG calculatedMin = ULONG_MAX;
-                ULONG calculatedMax = 0;
-                for (const auto& value : m_receiveWindow)
-                {
-                    if (value < calculatedMin)
-                    {
-                        calculatedMin = value;
-                    }
-                    if (value > calculatedMax)
-                    {
-                        calculatedMax = value;
-                    }
-                }
+                const ULONG calculatedMin = m_receiveWindow.count() > 0 ? m_receiveWindow.minimum() : ULONG_MAX;
+                const ULONG calculatedMax = m_receiveWindow.maximum();
                 formattedString += wil::str_printf<std::wstring>(L"%lu,", calculatedMin);
                 formattedString += wil::str_printf<std::wstring>(L"%lu", calculatedMax);
 
@@ -507,14 +500,14 @@ namespace ctsPerf
                 TCP_ESTATS_REC_ROD_v0 rod{};
                 if (0 == GetPerConnectionDynamicEstats<TcpConnectionEstatsRec>(tcpRow, &rod))
                 {
-                    m_receiveWindow.push_back(rod.CurRwinSent);
+                    m_receiveWindow.add(rod.CurRwinSent);
                     m_minReceiveWindow = rod.MinRwinSent;
                     m_maxReceiveWindow = rod.MaxRwinSent;
                 }
             }
 
         private:
-            std::vector<ULONG> m_receiveWindow;
+            ctl::ctLogLinearHistogram<ULONG> m_receiveWindow;
             ULONG m_minReceiveWindow = 0;
             ULONG m_maxReceiveWindow = 0;
         };
@@ -534,19 +527,8 @@ namespace ctsPerf
                 formattedString += wil::str_printf<std::wstring>(L"%lu,", m_minReceiveWindow);
                 formattedString += wil::str_printf<std::wstring>(L"%lu,", m_maxReceiveWindow);
 
-                ULONG calculatedMin = ULONG_MAX;
-                ULONG calculatedMax = 0;
-                for (const auto& value : m_receiveWindow)
-                {
-                    if (value < calculatedMin)
-                    {
-                        calculatedMin = value;
-                    }
-                    if (value > calculatedMax)
-                    {
-                        calculatedMax = value;
-                    }
-                }
+                const ULONG calculatedMin = m_receiveWindow.count() > 0 ? m_receiveWindow.minimum() : ULONG_MAX;
+                const ULONG calculatedMax = m_receiveWindow.maximum();
 
                 formattedString += wil::str_printf<std::wstring>(L"%lu,", calculatedMin);
                 formattedString += wil::str_printf<std::wstring>(L"%lu", calculatedMax);
@@ -569,14 +551,14 @@ namespace ctsPerf
                 TCP_ESTATS_OBS_REC_ROD_v0 rod{};
                 if (0 == GetPerConnectionDynamicEstats<TcpConnectionEstatsObsRec>(tcpRow, &rod))
                 {
-                    m_receiveWindow.push_back(rod.CurRwinRcvd);
+                    m_receiveWindow.add(rod.CurRwinRcvd);
                     m_minReceiveWindow = rod.MinRwinRcvd;
                     m_maxReceiveWindow = rod.MaxRwinRcvd;
                 }
             }
 
         private:
-            std::vector<ULONG> m_receiveWindow;
+            ctl::ctLogLinearHistogram<ULONG> m_receiveWindow;
             ULONG m_minReceiveWindow = 0;
             ULONG m_maxReceiveWindow = 0;
         };
@@ -777,10 +759,21 @@ namespace ctsPerf
         };
     } // namespace
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsEstats
+    /// - every second walks the IPv4 and IPv6 TCP tables, tracking ESTATS for each connection
+    /// - new connections are enabled for ESTATS serially, then every tracked connection is queried in parallel
+    /// - connections no longer in the table are written to the csv files and removed
+    /// - sampleRate tracks only 1 of every sampleRate connections, chosen by a hash of their address tuple
+    ///   so the same connections are tracked on every pass
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     class ctsEstats
     {
     public:
-        ctsEstats() :
+        explicit ctsEstats(ULONG sampleRate = 1) :
+            m_sampleRate(sampleRate == 0 ? 1 : sampleRate),
             m_pathInfoWriter(L"EstatsPathInfo.csv"),
             m_receiveWindowWriter(L"EstatsReceiveWindow.csv"),
             m_senderCongestionWriter(L"EstatsSenderCongestion.csv"),
@@ -887,6 +880,7 @@ namespace ctsPerf
         wil::unique_threadpool_timer m_timer;
         wil::critical_section m_timerLock{500};
         bool m_timersStopping = false;
+        const ULONG m_sampleRate;
 
         std::set<Details::EstatsDataPoint<TcpConnectionEstatsSynOpts>> m_synOptsData;
         std::set<Details::EstatsDataPoint<TcpConnectionEstatsData>> m_byteTrackingData;
@@ -902,6 +896,22 @@ namespace ctsPerf
         // since updates are always serialized on a timer, just reuse the same buffer
         const ULONG c_StartingTableSize = 4096;
         std::vector<char> m_tcpTable;
+
+        // the data points for each connection being updated this pass
+        // - std::set nodes are stable, so the pointers remain valid until RemoveStaleDataPoints
+        template <typename Mibtype>
+        struct TrackedConnection
+        {
+            Mibtype* m_tableEntry;
+            const Details::EstatsDataPoint<TcpConnectionEstatsSynOpts>* m_synOpts;
+            const Details::EstatsDataPoint<TcpConnectionEstatsData>* m_byteTracking;
+            const Details::EstatsDataPoint<TcpConnectionEstatsPath>* m_pathInfo;
+            const Details::EstatsDataPoint<TcpConnectionEstatsRec>* m_localReceiveWindow;
+            const Details::EstatsDataPoint<TcpConnectionEstatsObsRec>* m_remoteReceiveWindow;
+            const Details::EstatsDataPoint<TcpConnectionEstatsSndCong>* m_senderCongestion;
+        };
+        std::vector<TrackedConnection<MIB_TCPROW>> m_ipv4Connections;
+        std::vector<TrackedConnection<MIB_TCP6ROW>> m_ipv6Connections;
         ULONG m_tableCounter = 0;
         const DWORD OneSecondTimeoutMs = 1000;
         FILETIME m_timerInterval = wil::filetime::from_int64(-1 * wil::filetime_duration::one_millisecond * OneSecondTimeoutMs);
@@ -940,8 +950,10 @@ namespace ctsPerf
             try
             {
                 // IPv4
+                // - must finish querying these connections before the table buffer is reused for IPv6
                 RefreshIPv4Data();
                 auto* const pIpv4TcpTable = reinterpret_cast<PMIB_TCPTABLE>(&m_tcpTable[0]);
+                m_ipv4Connections.clear();
                 for (unsigned count = 0; count < pIpv4TcpTable->dwNumEntries; ++count)
                 {
                     auto* const tableEntry = &pIpv4TcpTable->table[count];
@@ -951,15 +963,14 @@ namespace ctsPerf
                     {
                         continue;
                     }
+                    if (!IsSampled(tableEntry))
+                    {
+                        continue;
+                    }
 
                     try
                     {
-                        UpdateDataPoints(m_synOptsData, tableEntry);
-                        UpdateDataPoints(m_byteTrackingData, tableEntry);
-                        UpdateDataPoints(m_pathInfoData, tableEntry);
-                        UpdateDataPoints(m_localReceiveWindowData, tableEntry);
-                        UpdateDataPoints(m_remoteReceiveWindowData, tableEntry);
-                        UpdateDataPoints(m_senderCongestionData, tableEntry);
+                        TrackConnection(m_ipv4Connections, tableEntry);
                     }
                     catch (...)
                     {
@@ -970,10 +981,12 @@ namespace ctsPerf
                         }
                     }
                 }
+                UpdateConnections(m_ipv4Connections);
 
                 // IPv6
                 RefreshIPv6Data();
                 auto* const pIpv6TcpTable = reinterpret_cast<PMIB_TCP6TABLE>(&m_tcpTable[0]);
+                m_ipv6Connections.clear();
                 for (unsigned count = 0; count < pIpv6TcpTable->dwNumEntries; ++count)
                 {
                     auto* const tableEntry = &pIpv6TcpTable->table[count];
@@ -983,15 +996,14 @@ namespace ctsPerf
                     {
                         continue;
                     }
+                    if (!IsSampled(tableEntry))
+                    {
+                        continue;
+                    }
 
                     try
                     {
-                        UpdateDataPoints(m_synOptsData, tableEntry);
-                        UpdateDataPoints(m_byteTrackingData, tableEntry);
-                        UpdateDataPoints(m_pathInfoData, tableEntry);
-                        UpdateDataPoints(m_localReceiveWindowData, tableEntry);
-                        UpdateDataPoints(m_remoteReceiveWindowData, tableEntry);
-                        UpdateDataPoints(m_senderCongestionData, tableEntry);
+                        TrackConnection(m_ipv6Connections, tableEntry);
                     }
                     catch (...)
                     {
@@ -1002,6 +1014,7 @@ namespace ctsPerf
                         }
                     }
                 }
+                UpdateConnections(m_ipv6Connections);
 
                 RemoveStaleDataPoints();
             }
@@ -1080,8 +1093,41 @@ namespace ctsPerf
             }
         }
 
+        // a cheap hash of the address tuple: the same connection is always either sampled or not
+        [[nodiscard]] bool IsSampled(const MIB_TCPROW* tableEntry) const noexcept
+        {
+            if (m_sampleRate == 1)
+            {
+                return true;
+            }
+            ULONGLONG hash = tableEntry->dwLocalAddr;
+            hash = hash * 31 + tableEntry->dwLocalPort;
+            hash = hash * 31 + tableEntry->dwRemoteAddr;
+            hash = hash * 31 + tableEntry->dwRemotePort;
+            return hash % m_sampleRate == 0;
+        }
+        [[nodiscard]] bool IsSampled(const MIB_TCP6ROW* tableEntry) const noexcept
+        {
+            if (m_sampleRate == 1)
+            {
+                return true;
+            }
+            ULONGLONG hash = 0;
+            for (const auto byte : tableEntry->LocalAddr.u.Byte)
+            {
+                hash = hash * 31 + byte;
+            }
+            hash = hash * 31 + tableEntry->dwLocalPort;
+            for (const auto byte : tableEntry->RemoteAddr.u.Byte)
+            {
+                hash = hash * 31 + byte;
+            }
+            hash = hash * 31 + tableEntry->dwRemotePort;
+            return hash % m_sampleRate == 0;
+        }
+
         template <TCP_ESTATS_TYPE TcpType, typename Mibtype>
-        void UpdateDataPoints(std::set<Details::EstatsDataPoint<TcpType>>& data, Mibtype tableEntry)
+        const Details::EstatsDataPoint<TcpType>* TrackDataPoint(std::set<Details::EstatsDataPoint<TcpType>>& data, Mibtype tableEntry)
         {
             const auto emplaceResults = data.emplace(tableEntry);
             // first == iterator inserted
@@ -1090,7 +1136,46 @@ namespace ctsPerf
             {
                 emplaceResults.first->StartTracking(tableEntry);
             }
-            emplaceResults.first->UpdateData(tableEntry, m_tableCounter);
+            return &*emplaceResults.first;
+        }
+
+        // serially adds new connections to each data set, enabling ESTATS for them
+        template <typename Mibtype>
+        void TrackConnection(std::vector<TrackedConnection<Mibtype>>& connections, Mibtype* tableEntry)
+        {
+            TrackedConnection<Mibtype> connection{};
+            connection.m_tableEntry = tableEntry;
+            connection.m_synOpts = TrackDataPoint(m_synOptsData, tableEntry);
+            connection.m_byteTracking = TrackDataPoint(m_byteTrackingData, tableEntry);
+            connection.m_pathInfo = TrackDataPoint(m_pathInfoData, tableEntry);
+            connection.m_localReceiveWindow = TrackDataPoint(m_localReceiveWindowData, tableEntry);
+            connection.m_remoteReceiveWindow = TrackDataPoint(m_remoteReceiveWindowData, tableEntry);
+            connection.m_senderCongestion = TrackDataPoint(m_senderCongestionData, tableEntry);
+            connections.push_back(connection);
+        }
+
+        // queries ESTATS for every tracked connection in parallel
+        // - each connection only updates its own data points (the containers are not modified)
+        template <typename Mibtype>
+        void UpdateConnections(const std::vector<TrackedConnection<Mibtype>>& connections) const noexcept
+        {
+            const auto tableCounter = m_tableCounter;
+            std::for_each(
+                std::execution::par,
+                std::begin(connections),
+                std::end(connections),
+                [tableCounter](const TrackedConnection<Mibtype>& connection) noexcept {
+                    try
+                    {
+                        connection.m_synOpts->UpdateData(connection.m_tableEntry, tableCounter);
+                        connection.m_byteTracking->UpdateData(connection.m_tableEntry, tableCounter);
+                        connection.m_pathInfo->UpdateData(connection.m_tableEntry, tableCounter);
+                        connection.m_localReceiveWindow->UpdateData(connection.m_tableEntry, tableCounter);
+                        connection.m_remoteReceiveWindow->UpdateData(connection.m_tableEntry, tableCounter);
+                        connection.m_senderCongestion->UpdateData(connection.m_tableEntry, tableCounter);
+                    }
+                    CATCH_LOG()
+                });
         }
 
         void RemoveStaleDataPoints()
@@ -1098,16 +1183,16 @@ namespace ctsPerf
             // walk the set of synOptsData. If an address wasn't found to have been updated
             // with the latest data, then we'll remove that tuple (local address + remote address)
             // from all the data sets and finish printing their rows
-            auto foundInstance = std::find_if(
-                std::begin(m_synOptsData),
-                std::end(m_synOptsData),
-                [&](const Details::EstatsDataPoint<TcpConnectionEstatsSynOpts>& dataPoint) noexcept
-            {
-                return dataPoint.LastestCounter() != m_tableCounter;
-            });
-
+            // - a single pass: the set is ordered, so erasing returns the next instance to check
+            auto foundInstance = std::begin(m_synOptsData);
             while (foundInstance != std::end(m_synOptsData))
             {
+                if (foundInstance->LastestCounter() == m_tableCounter)
+                {
+                    ++foundInstance;
+                    continue;
+                }
+
                 const ctl::ctSockaddr localAddr(foundInstance->LocalAddr());
                 const ctl::ctSockaddr remoteAddr(foundInstance->RemoteAddr());
 
@@ -1155,11 +1240,14 @@ namespace ctsPerf
                         byteTrackingInstance->PrintData());
                 }
 
-                m_synOptsData.erase(synOptsInstance);
                 if (fByteTrackingInstanceFound)
                 {
                     m_byteTrackingData.erase(byteTrackingInstance);
                 }
+                if (fPathInfoInstanceFound)
+                {
+                    m_pathInfoData.erase(pathInfoInstance);
+                }
                 if (fLocalReceiveWindowInstanceFound)
                 {
                     m_localReceiveWindowData.erase(localReceiveWindowInstance);
@@ -1174,13 +1262,7 @@ namespace ctsPerf
                 }
 
                 // update the while loop variable
-                foundInstance = std::find_if(
-                    std::begin(m_synOptsData),
-                    std::end(m_synOptsData),
-                    [&](const Details::EstatsDataPoint<TcpConnectionEstatsSynOpts>& dataPoint) noexcept
-                {
-                    return dataPoint.LastestCounter() != m_tableCounter;
-                });
+                foundInstance = m_synOptsData.erase(synOptsInstance);
             } // while loop
         }
     };
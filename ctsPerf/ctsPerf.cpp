@@ -26,8 +26,9 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <wil/resource.h>
 // ctl headers
 #include <ctString.hpp>
-#include <ctWmiInitialize.hpp>
-#include <ctWmiPerformance.hpp>
+#include <ctPdhPerformance.hpp>
+#include <ctNetAdapterAddresses.hpp>
+#include <ctNetAdapterSettings.hpp>
 // project headers
 #include "ctsWriteDetails.h"
 #include "ctsEstats.h"
@@ -36,7 +37,6 @@ using namespace std;
 using namespace ctl;
 
 HANDLE g_break = nullptr;
-const ctWmiService* g_wmi = nullptr;
 
 BOOL WINAPI BreakHandlerRoutine(DWORD) noexcept
 {
@@ -49,8 +49,14 @@ static const PCWSTR c_usageStatement =
     L"ctsPerf.exe usage::\n"
     L" #### <time to run (in seconds)>  [default is 60 seconds]\n"
 	L" -Networking [will enable performance and reliability related Network counters]\n"
+    L"             [and prints the RSS, offload and driver settings of the adapters and the power plan]\n"
 	L" -Estats [will enable ESTATS tracking for all TCP connections]\n"
+    L" -EstatsSample:#### [will only track ESTATS for 1 of every #### TCP connections, for hosts with many connections]\n"
 	L" -MeanOnly  [will save memory by not storing every data point, only a sum and mean\n"
+    L" -Histogram  [will bound memory by not storing every data point, only a histogram of the data points\n"
+    L"              reports the same columns as the default plus the 95th and 99th percentiles]\n"
+    L" -Utf8  [will write the csv files as UTF-8 instead of UTF-16, halving their size]\n"
+    L" -Interval:#### <time between samples (in milliseconds)>  [default is 1000 milliseconds, minimum is 100]\n"
     L"\n"
     L" [optionally the specific interface description can be specified\n"
     L"  by default *all* interface counters are collected]\n"
@@ -75,20 +81,27 @@ static const PCWSTR c_usageStatement =
     L"\n"
     L"> ctsPerf.exe -pid:2048\n"
     L"  -- will capture processor and memory + process counters for process id 2048 for 60 seconds"
+    L"\n"
+    L"> ctsPerf.exe -Networking -Interval:250\n"
+    L"  -- will capture processor, memory, and networking counters 4 times per second for 60 seconds"
     L"\n";
 
 // 0 is a possible process ID
 constexpr DWORD c_uninitializedProcessId = 0xffffffff;
+// PDH rate counters are calculated across two samples - shorter intervals measure mostly timer jitter
+constexpr DWORD c_minimumSampleIntervalMs = 100;
+
+void PrintHostConfiguration(const std::wstring& trackInterfaceDescription) noexcept;
 
-ctWmiPerformance InstantiateProcessorCounters();
-ctWmiPerformance InstantiateMemoryCounters();
-ctWmiPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInterfaceDescription);
-ctWmiPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackInterfaceDescription);
-ctWmiPerformance InstantiateIPCounters();
-ctWmiPerformance InstantiateTCPCounters();
-ctWmiPerformance InstantiateUDPCounters();
-ctWmiPerformance InstantiatePerProcessByNameCounters(const std::wstring& trackProcess);
-ctWmiPerformance InstantiatePerProcessByPIDCounters(DWORD processId);
+ctPdhPerformance InstantiateProcessorCounters();
+ctPdhPerformance InstantiateMemoryCounters();
+ctPdhPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInterfaceDescription);
+ctPdhPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackInterfaceDescription);
+ctPdhPerformance InstantiateIPCounters();
+ctPdhPerformance InstantiateTCPCounters();
+ctPdhPerformance InstantiateUDPCounters();
+ctPdhPerformance InstantiatePerProcessByNameCounters(const std::wstring& trackProcess);
+ctPdhPerformance InstantiatePerProcessByPIDCounters(DWORD processId);
 
 void DeleteProcessorCounters() noexcept;
 void DeleteMemoryCounters() noexcept;
@@ -125,6 +138,10 @@ PCWSTR g_networkingFilename = L"ctsNetworking.csv";
 PCWSTR g_processFilename = L"ctsPerProcess.csv";
 
 bool g_meanOnly = false;
+bool g_histogram = false;
+bool g_utf8 = false;
+// the collection type for counters which are summarized over the run (rather than first/last)
+ctWmiPerformanceCollectionType g_collectionType = ctWmiPerformanceCollectionType::Detailed;
 
 int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
 {
@@ -154,11 +171,13 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
 
     auto trackNetworking = false;
     auto trackEstats = false;
+    ULONG estatsSampleRate = 1;
 
     wstring trackInterfaceDescription;
     wstring trackProcess;
     auto processId = c_uninitializedProcessId;
     DWORD timeToRunMs = 60000; // default to 60 seconds
+    DWORD sampleIntervalMs = 1000; // default to 1 sample per second
 
     for (DWORD argCount = argc; argCount > 1; --argCount)
     {
@@ -208,6 +227,24 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
                 }
             }
 
+        }
+        else if (ctString::ctOrdinalStartsWithCaseInsensative(argv[argCount - 1], L"-EstatsSample:"))
+        {
+            wstring sampleString(argv[argCount - 1]);
+
+            // strip off the "-EstatsSample:" preface to the string
+            const auto endOfToken = find(sampleString.begin(), sampleString.end(), L':');
+            sampleString.erase(sampleString.begin(), endOfToken + 1);
+
+            estatsSampleRate = ::wcstoul(sampleString.c_str(), nullptr, 10);
+            if (estatsSampleRate == 0 || estatsSampleRate == ULONG_MAX)
+            {
+                wprintf(L"Incorrect option: %ws\n", argv[argCount - 1]);
+                wprintf(c_usageStatement);
+                return 1;
+            }
+            trackEstats = true;
+
         }
         else if (ctString::ctOrdinalStartsWithCaseInsensative(argv[argCount - 1], L"-estats"))
         {
@@ -227,11 +264,38 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
             const auto endOfToken = find(trackInterfaceDescription.begin(), trackInterfaceDescription.end(), L':');
             trackInterfaceDescription.erase(trackInterfaceDescription.begin(), endOfToken + 1);
 
+        }
+        else if (ctString::ctOrdinalStartsWithCaseInsensative(argv[argCount - 1], L"-Interval:"))
+        {
+            wstring intervalString(argv[argCount - 1]);
+
+            // strip off the "-Interval:" preface to the string
+            const auto endOfToken = find(intervalString.begin(), intervalString.end(), L':');
+            intervalString.erase(intervalString.begin(), endOfToken + 1);
+
+            sampleIntervalMs = ::wcstoul(intervalString.c_str(), nullptr, 10);
+            if (sampleIntervalMs < c_minimumSampleIntervalMs || sampleIntervalMs == ULONG_MAX)
+            {
+                wprintf(L"Incorrect option: %ws\n", argv[argCount - 1]);
+                wprintf(c_usageStatement);
+                return 1;
+            }
+
         }
         else if (ctString::ctOrdinalStartsWithCaseInsensative(argv[argCount - 1], L"-MeanOnly"))
         {
             g_meanOnly = true;
 
+        }
+        else if (ctString::ctOrdinalStartsWithCaseInsensative(argv[argCount - 1], L"-Histogram"))
+        {
+            g_histogram = true;
+
+        }
+        else if (ctString::ctOrdinalStartsWithCaseInsensative(argv[argCount - 1], L"-Utf8"))
+        {
+            g_utf8 = true;
+
         }
         else
         {
@@ -252,6 +316,21 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
         }
     }
 
+    if (g_meanOnly && g_histogram)
+    {
+        wprintf(L"ERROR: -MeanOnly and -Histogram cannot both be specified\n");
+        wprintf(c_usageStatement);
+        return 1;
+    }
+    if (g_meanOnly)
+    {
+        g_collectionType = ctWmiPerformanceCollectionType::MeanOnly;
+    }
+    else if (g_histogram)
+    {
+        g_collectionType = ctWmiPerformanceCollectionType::Histogram;
+    }
+
     const auto trackPerProcess = !trackProcess.empty() || processId != c_uninitializedProcessId;
 
     if (timeToRunMs <= 5000)
@@ -263,7 +342,7 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
 
     try
     {
-        ctsPerf::ctsEstats estats;
+        ctsPerf::ctsEstats estats(estatsSampleRate);
         if (trackEstats)
         {
             if (estats.start())
@@ -277,32 +356,34 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
             }
         }
 
-        wprintf(L"Instantiating WMI Performance objects (this can take a few seconds)\n");
-        const auto coInit = wil::CoInitializeEx();
-        const ctWmiService wmi(L"root\\cimv2");
-        g_wmi = &wmi;
+        if (trackNetworking)
+        {
+            PrintHostConfiguration(trackInterfaceDescription);
+        }
+
+        wprintf(L"Instantiating Performance Counters\n");
 
         auto deleteAllCounters = wil::scope_exit([&]() noexcept { DeleteAllCounters(); });
 
-        ctsPerf::ctsWriteDetails cpuwriter(g_fileName);
-        cpuwriter.CreateFile(g_meanOnly);
+        ctsPerf::ctsWriteDetails cpuwriter(g_fileName, g_utf8);
+        cpuwriter.CreateFile(g_meanOnly, g_histogram);
 
-        ctsPerf::ctsWriteDetails networkWriter(g_networkingFilename);
+        ctsPerf::ctsWriteDetails networkWriter(g_networkingFilename, g_utf8);
         if (trackNetworking)
         {
-            networkWriter.CreateFile(g_meanOnly);
+            networkWriter.CreateFile(g_meanOnly, g_histogram);
         }
 
-        ctsPerf::ctsWriteDetails processWriter(g_processFilename);
+        ctsPerf::ctsWriteDetails processWriter(g_processFilename, g_utf8);
         if (trackPerProcess)
         {
-            processWriter.CreateFile(g_meanOnly);
+            processWriter.CreateFile(g_meanOnly, g_histogram);
         }
 
         wprintf(L".");
 
         // create a perf counter objects to maintain these counters
-        std::vector<ctWmiPerformance> performanceVector;
+        std::vector<ctPdhPerformance> performanceVector;
 
         performanceVector.emplace_back(InstantiateProcessorCounters());
         performanceVector.emplace_back(InstantiateMemoryCounters());
@@ -329,7 +410,7 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
         wprintf(L"\nStarting counters : will run for %lu seconds\n (hit ctrl-c to exit early) ...\n\n", static_cast<DWORD>(timeToRunMs / 1000UL));
         for (auto& perfObject : performanceVector)
         {
-            perfObject.start_all_counters(1000);
+            perfObject.start_all_counters(sampleIntervalMs);
         }
 
         ::WaitForSingleObject(g_break, timeToRunMs);
@@ -374,65 +455,120 @@ int __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
 }
 
 
+/****************************************************************************************************/
+/*                                     Host Configuration                                           */
+/****************************************************************************************************/
+// the RSS, offload and driver settings of the tracked adapters (all adapters which are up by default)
+// and the active power plan, so the counters can be compared across hosts
+void PrintHostConfiguration(const std::wstring& trackInterfaceDescription) noexcept
+try
+{
+    vector<wstring> interfaceDescriptions;
+    if (!trackInterfaceDescription.empty())
+    {
+        interfaceDescriptions.emplace_back(trackInterfaceDescription);
+    }
+    else
+    {
+        const ctNetAdapterAddresses adapterAddresses;
+        for (const auto& adapter : adapterAddresses)
+        {
+            if (IfOperStatusUp == adapter.OperStatus && adapter.IfType != IF_TYPE_SOFTWARE_LOOPBACK)
+            {
+                interfaceDescriptions.emplace_back(adapter.Description);
+            }
+        }
+    }
+
+    const auto com = wil::CoInitializeEx();
+    const ctWmiService wmiService(L"ROOT\\StandardCimv2");
+    wprintf(L"Host Configuration\n");
+    vector<wstring> warnings;
+    for (const auto& interfaceDescription : interfaceDescriptions)
+    {
+        const auto adapterSettings = ctReadNetAdapterSettings(wmiService, interfaceDescription);
+        wprintf(L"%ws", adapterSettings.format(L"  ").c_str());
+        for (const auto& warning : adapterSettings.find_limiting_settings())
+        {
+            warnings.emplace_back(interfaceDescription + L" : " + warning);
+        }
+    }
+
+    const auto powerPlan = ctReadActivePowerPlan();
+    if (!powerPlan.m_name.empty())
+    {
+        wprintf(L"  Power plan: %ws\n", powerPlan.m_name.c_str());
+        if (!powerPlan.m_isHighPerformance)
+        {
+            warnings.emplace_back(L"the power plan is not High performance : processors can be parked or run below their rated frequency");
+        }
+    }
+
+    for (const auto& warning : warnings)
+    {
+        wprintf(L"  WARNING: %ws\n", warning.c_str());
+    }
+    wprintf(L"\n");
+}
+catch (...)
+{
+    // informational only - the counters are still collected
+    wprintf(L"The host configuration could not be read\n");
+}
+
 /****************************************************************************************************/
 /*                                         Processor                                                */
 /****************************************************************************************************/
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_processorTime;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_processorPercentOfMax;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_processorPercentDpcTime;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_processorDpcsQueuedPerSecond;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_processorPercentPrivilegedTime;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_processorPercentUserTime;
-ctWmiPerformance InstantiateProcessorCounters()
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_processorTime;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_processorPercentOfMax;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_processorPercentDpcTime;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_processorDpcsQueuedPerSecond;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_processorPercentPrivilegedTime;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_processorPercentUserTime;
+ctPdhPerformance InstantiateProcessorCounters()
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
     // create objects for system counters we care about
-    g_processorTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_processorTime = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Processor,
         L"PercentProcessorTime",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_processorTime);
     wprintf(L".");
 
-    g_processorPercentOfMax = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_processorPercentOfMax = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::Processor,
         L"PercentofMaximumFrequency",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_processorPercentOfMax);
     wprintf(L".");
 
-	g_processorPercentDpcTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+	g_processorPercentDpcTime = ctCreatePdhPerfCounter<ULONGLONG>(
 		ctWmiEnumClassName::Processor,
 		L"PercentDPCTime",
-		g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+		g_collectionType);
 	performanceCounter.add_counter(g_processorPercentDpcTime);
 	wprintf(L".");
 
-	g_processorDpcsQueuedPerSecond = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+	g_processorDpcsQueuedPerSecond = ctCreatePdhPerfCounter<ULONG>(
 		ctWmiEnumClassName::Processor,
 		L"DPCsQueuedPersec",
-		g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+		g_collectionType);
 	performanceCounter.add_counter(g_processorDpcsQueuedPerSecond);
 	wprintf(L".");
 
-	g_processorPercentPrivilegedTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+	g_processorPercentPrivilegedTime = ctCreatePdhPerfCounter<ULONGLONG>(
 		ctWmiEnumClassName::Processor,
 		L"PercentPrivilegedTime",
-		g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+		g_collectionType);
 	performanceCounter.add_counter(g_processorPercentPrivilegedTime);
 	wprintf(L".");
 
-	g_processorPercentUserTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+	g_processorPercentUserTime = ctCreatePdhPerfCounter<ULONGLONG>(
 		ctWmiEnumClassName::Processor,
 		L"PercentUserTime",
-		g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+		g_collectionType);
 	performanceCounter.add_counter(g_processorPercentUserTime);
 	wprintf(L".");
 
@@ -449,17 +585,14 @@ void DeleteProcessorCounters() noexcept
 }
 void ProcessProcessorCounters(ctsPerf::ctsWriteDetails& writer)
 {
-    ctWmiEnumerate enumProcessors(*g_wmi);
-    enumProcessors.query(L"SELECT * FROM Win32_PerfFormattedData_Counters_ProcessorInformation");
-    if (enumProcessors.begin() == enumProcessors.end()) {
-        throw exception("Unable to find any processors to report on - querying Win32_PerfFormattedData_Counters_ProcessorInformation returned nothing");
+    const auto processorNames = g_processorTime->instance_names();
+    if (processorNames.empty()) {
+        throw exception("Unable to find any processors to report on - the Processor Information counters returned nothing");
     }
 	vector<ULONGLONG> ullData;
 	vector<ULONG> ulData;
 
-	for (const auto& processor : enumProcessors) {
-		wstring name;
-		processor.get(L"Name", &name);
+	for (const auto& name : processorNames) {
 
 		// processor name strings look like "0,1" when there are more than one cores
 		// need to replace the comma so the csv will print correctly
@@ -577,24 +710,22 @@ void ProcessProcessorCounters(ctsPerf::ctsWriteDetails& writer)
 /****************************************************************************************************/
 /*                                            Memory                                                */
 /****************************************************************************************************/
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_pagedPoolBytes;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_nonPagedPoolBytes;
-ctWmiPerformance InstantiateMemoryCounters()
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_pagedPoolBytes;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_nonPagedPoolBytes;
+ctPdhPerformance InstantiateMemoryCounters()
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
-    g_pagedPoolBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    ctPdhPerformance performanceCounter;
+    g_pagedPoolBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Memory,
         L"PoolPagedBytes",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_pagedPoolBytes);
     wprintf(L".");
 
-    g_nonPagedPoolBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_nonPagedPoolBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Memory,
         L"PoolNonpagedBytes",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_nonPagedPoolBytes);
     wprintf(L".");
 
@@ -641,31 +772,29 @@ void ProcessMemoryCounters(ctsPerf::ctsWriteDetails& writer)
 /****************************************************************************************************/
 /*                                     NetworkAdapter                                               */
 /****************************************************************************************************/
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterTotalBytes;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterOffloadedConnections;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsOutboundDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsOutboundErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsReceivedDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsReceivedErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsPerSecond;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkAdapterActiveRscConnections;
-ctWmiPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInterfaceDescription)
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterTotalBytes;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterOffloadedConnections;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsOutboundDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsOutboundErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsReceivedDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsReceivedErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterPacketsPerSecond;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkAdapterActiveRscConnections;
+ctPdhPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInterfaceDescription)
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
-    g_networkAdapterTotalBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterTotalBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"BytesTotalPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     if (!trackInterfaceDescription.empty()) {
         g_networkAdapterTotalBytes->add_filter(L"Name", trackInterfaceDescription.c_str());
     }
     performanceCounter.add_counter(g_networkAdapterTotalBytes);
     wprintf(L".");
 
-    g_networkAdapterOffloadedConnections = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterOffloadedConnections = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"OffloadedConnections",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -675,8 +804,7 @@ ctWmiPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInte
     performanceCounter.add_counter(g_networkAdapterOffloadedConnections);
     wprintf(L".");
 
-    g_networkAdapterPacketsOutboundDiscarded = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterPacketsOutboundDiscarded = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"PacketsOutboundDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -686,8 +814,7 @@ ctWmiPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInte
     performanceCounter.add_counter(g_networkAdapterPacketsOutboundDiscarded);
     wprintf(L".");
 
-    g_networkAdapterPacketsOutboundErrors = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterPacketsOutboundErrors = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"PacketsOutboundErrors",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -697,8 +824,7 @@ ctWmiPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInte
     performanceCounter.add_counter(g_networkAdapterPacketsOutboundErrors);
     wprintf(L".");
 
-    g_networkAdapterPacketsReceivedDiscarded = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterPacketsReceivedDiscarded = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"PacketsReceivedDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -708,8 +834,7 @@ ctWmiPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInte
     performanceCounter.add_counter(g_networkAdapterPacketsReceivedDiscarded);
     wprintf(L".");
 
-    g_networkAdapterPacketsReceivedErrors = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterPacketsReceivedErrors = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"PacketsReceivedErrors",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -719,19 +844,17 @@ ctWmiPerformance InstantiateNetworkAdapterCounters(const std::wstring& trackInte
     performanceCounter.add_counter(g_networkAdapterPacketsReceivedErrors);
     wprintf(L".");
 
-    g_networkAdapterPacketsPerSecond = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterPacketsPerSecond = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"PacketsPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     if (!trackInterfaceDescription.empty()) {
         g_networkAdapterPacketsPerSecond->add_filter(L"Name", trackInterfaceDescription.c_str());
     }
     performanceCounter.add_counter(g_networkAdapterPacketsPerSecond);
     wprintf(L".");
 
-    g_networkAdapterActiveRscConnections = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkAdapterActiveRscConnections = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkAdapter,
         L"TCPActiveRSCConnections",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -760,17 +883,14 @@ void ProcessNetworkAdapterCounters(ctsPerf::ctsWriteDetails& writer)
 
     // there is no great way to find the 'Name' for each network interface tracked
     // - it is not guaranteed to match anything from NetAdapter or NetIPInteface
-    // - making a single query directly here to at least get the names
-    ctWmiEnumerate enumAdapter(*g_wmi);
-    enumAdapter.query(L"SELECT * FROM Win32_PerfFormattedData_Tcpip_NetworkAdapter");
-    if (enumAdapter.begin() == enumAdapter.end()) {
-        throw exception("Unable to find an adapter to report on - querying Win32_PerfFormattedData_Tcpip_NetworkAdapter returned nothing");
+    // - using the instance names captured by the counters to at least get the names
+    const auto adapterNames = g_networkAdapterPacketsPerSecond->instance_names();
+    if (adapterNames.empty()) {
+        throw exception("Unable to find an adapter to report on - the Network Adapter counters returned nothing");
     }
 
 	writer.WriteRow(L"NetworkAdapter");
-    for (const auto& adapter : enumAdapter) {
-        wstring name;
-        adapter.get(L"Name", &name);
+    for (const auto& name : adapterNames) {
 
         auto networkRange = g_networkAdapterPacketsPerSecond->reference_range(name.c_str());
         ullData.assign(networkRange.first, networkRange.second);
@@ -868,29 +988,27 @@ void ProcessNetworkAdapterCounters(ctsPerf::ctsWriteDetails& writer)
 /****************************************************************************************************/
 /*                                     NetworkInterface                                             */
 /****************************************************************************************************/
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkInterfaceTotalBytes;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsOutboundDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsOutboundErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsReceivedDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsReceivedErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsReceivedUnknown;
-ctWmiPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackInterfaceDescription)
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkInterfaceTotalBytes;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsOutboundDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsOutboundErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsReceivedDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsReceivedErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_networkInterfacePacketsReceivedUnknown;
+ctPdhPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackInterfaceDescription)
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
-    g_networkInterfaceTotalBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkInterfaceTotalBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkInterface,
         L"BytesTotalPerSec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     if (!trackInterfaceDescription.empty()) {
         g_networkInterfaceTotalBytes->add_filter(L"Name", trackInterfaceDescription.c_str());
     }
     performanceCounter.add_counter(g_networkInterfaceTotalBytes);
     wprintf(L".");
 
-    g_networkInterfacePacketsOutboundDiscarded = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkInterfacePacketsOutboundDiscarded = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkInterface,
         L"PacketsOutboundDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -900,8 +1018,7 @@ ctWmiPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackIn
     performanceCounter.add_counter(g_networkInterfacePacketsOutboundDiscarded);
     wprintf(L".");
 
-    g_networkInterfacePacketsOutboundErrors = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkInterfacePacketsOutboundErrors = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkInterface,
         L"PacketsOutboundErrors",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -911,8 +1028,7 @@ ctWmiPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackIn
     performanceCounter.add_counter(g_networkInterfacePacketsOutboundErrors);
     wprintf(L".");
 
-    g_networkInterfacePacketsReceivedDiscarded = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkInterfacePacketsReceivedDiscarded = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkInterface,
         L"PacketsReceivedDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -922,8 +1038,7 @@ ctWmiPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackIn
     performanceCounter.add_counter(g_networkInterfacePacketsReceivedDiscarded);
     wprintf(L".");
 
-    g_networkInterfacePacketsReceivedErrors = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkInterfacePacketsReceivedErrors = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkInterface,
         L"PacketsReceivedErrors",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -933,8 +1048,7 @@ ctWmiPerformance InstantiateNetworkInterfaceCounters(const std::wstring& trackIn
     performanceCounter.add_counter(g_networkInterfacePacketsReceivedErrors);
     wprintf(L".");
 
-    g_networkInterfacePacketsReceivedUnknown = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_networkInterfacePacketsReceivedUnknown = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::NetworkInterface,
         L"PacketsReceivedUnknown",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -961,17 +1075,14 @@ void ProcessNetworkInterfaceCounters(ctsPerf::ctsWriteDetails& writer)
 
     // there is no great way to find the 'Name' for each network interface tracked
     // - it is not guaranteed to match anything from NetAdapter or NetIPInterface
-    // - making a single query directly here to at least get the names
-    ctWmiEnumerate enumAdapter(*g_wmi);
-    enumAdapter.query(L"SELECT * FROM Win32_PerfFormattedData_Tcpip_NetworkInterface");
-    if (enumAdapter.begin() == enumAdapter.end()) {
-        throw exception("Unable to find an adapter to report on - querying Win32_PerfFormattedData_Tcpip_NetworkInterface returned nothing");
+    // - using the instance names captured by the counters to at least get the names
+    const auto interfaceNames = g_networkInterfaceTotalBytes->instance_names();
+    if (interfaceNames.empty()) {
+        throw exception("Unable to find an adapter to report on - the Network Interface counters returned nothing");
     }
 
 	writer.WriteRow(L"NetworkInterface");
-    for (const auto& adapter : enumAdapter) {
-        wstring name;
-        adapter.get(L"Name", &name);
+    for (const auto& name : interfaceNames) {
 
         const auto byte_range = g_networkInterfaceTotalBytes->reference_range(name.c_str());
         ullData.assign(byte_range.first, byte_range.second);
@@ -1044,149 +1155,133 @@ void ProcessNetworkInterfaceCounters(ctsPerf::ctsWriteDetails& writer)
 /*                                        TCPIP IPv4                                                */
 /*                                        TCPIP IPv6                                                */
 /****************************************************************************************************/
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4OutboundDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4OutboundNoRoute;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedAddressErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedHeaderErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedUnknownProtocol;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4FragmentReassemblyFailures;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv4FragmentationFailures;
-
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6OutboundDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6OutboundNoRoute;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedAddressErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedDiscarded;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedHeaderErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedUnknownProtocol;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6FragmentReassemblyFailures;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipIpv6FragmentationFailures;
-ctWmiPerformance InstantiateIPCounters()
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4OutboundDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4OutboundNoRoute;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedAddressErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedHeaderErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4ReceivedUnknownProtocol;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4FragmentReassemblyFailures;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv4FragmentationFailures;
+
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6OutboundDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6OutboundNoRoute;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedAddressErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedDiscarded;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedHeaderErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6ReceivedUnknownProtocol;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6FragmentReassemblyFailures;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipIpv6FragmentationFailures;
+ctPdhPerformance InstantiateIPCounters()
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
-    g_tcpipIpv4OutboundDiscarded = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4OutboundDiscarded = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"DatagramsOutboundDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4OutboundDiscarded);
     wprintf(L".");
 
-    g_tcpipIpv4OutboundNoRoute = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4OutboundNoRoute = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"DatagramsOutboundNoRoute",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4OutboundNoRoute);
     wprintf(L".");
 
-    g_tcpipIpv4ReceivedAddressErrors = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4ReceivedAddressErrors = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"DatagramsReceivedAddressErrors",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4ReceivedAddressErrors);
     wprintf(L".");
 
-    g_tcpipIpv4ReceivedDiscarded = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4ReceivedDiscarded = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"DatagramsReceivedDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4ReceivedDiscarded);
     wprintf(L".");
 
-    g_tcpipIpv4ReceivedHeaderErrors = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4ReceivedHeaderErrors = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"DatagramsReceivedHeaderErrors",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4ReceivedHeaderErrors);
     wprintf(L".");
 
-    g_tcpipIpv4ReceivedUnknownProtocol = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4ReceivedUnknownProtocol = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"DatagramsReceivedUnknownProtocol",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4ReceivedUnknownProtocol);
     wprintf(L".");
 
-    g_tcpipIpv4FragmentReassemblyFailures = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4FragmentReassemblyFailures = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"FragmentReassemblyFailures",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4FragmentReassemblyFailures);
     wprintf(L".");
 
-    g_tcpipIpv4FragmentationFailures = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv4FragmentationFailures = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv4,
         L"FragmentationFailures",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv4FragmentationFailures);
     wprintf(L".");
 
-    g_tcpipIpv6OutboundDiscarded = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6OutboundDiscarded = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"DatagramsOutboundDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv6OutboundDiscarded);
     wprintf(L".");
 
-    g_tcpipIpv6OutboundNoRoute = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6OutboundNoRoute = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"DatagramsOutboundNoRoute",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv6OutboundNoRoute);
     wprintf(L".");
 
-    g_tcpipIpv6ReceivedAddressErrors = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6ReceivedAddressErrors = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"DatagramsReceivedAddressErrors",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv6ReceivedAddressErrors);
     wprintf(L".");
 
-    g_tcpipIpv6ReceivedDiscarded = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6ReceivedDiscarded = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"DatagramsReceivedDiscarded",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv6ReceivedDiscarded);
     wprintf(L".");
 
-    g_tcpipIpv6ReceivedHeaderErrors = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6ReceivedHeaderErrors = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"DatagramsReceivedHeaderErrors",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv6ReceivedHeaderErrors);
     wprintf(L".");
 
-    g_tcpipIpv6ReceivedUnknownProtocol = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6ReceivedUnknownProtocol = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"DatagramsReceivedUnknownProtocol",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv6ReceivedUnknownProtocol);
     wprintf(L".");
 
-    g_tcpipIpv6FragmentReassemblyFailures = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6FragmentReassemblyFailures = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"FragmentReassemblyFailures",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipIpv6FragmentReassemblyFailures);
     wprintf(L".");
 
-    g_tcpipIpv6FragmentationFailures = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipIpv6FragmentationFailures = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipIpv6,
         L"FragmentationFailures",
         ctWmiPerformanceCollectionType::FirstLast);
@@ -1341,79 +1436,71 @@ void ProcessIPCounters(ctsPerf::ctsWriteDetails& writer)
 /*                                        TCPIP TCPv4                                                */
 /*                                        TCPIP TCPv6                                                */
 /****************************************************************************************************/
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipTcpv4ConnectionsEstablished;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipTcpv6ConnectionsEstablished;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipTcpv4ConnectionFailures;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipTcpv6ConnectionFailures;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipTcpv4ConnectionsReset;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipTcpv6ConnectionsReset;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_winsockBspRejectedConnections;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_winsockBspRejectedConnectionsPerSec;
-ctWmiPerformance InstantiateTCPCounters()
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipTcpv4ConnectionsEstablished;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipTcpv6ConnectionsEstablished;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipTcpv4ConnectionFailures;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipTcpv6ConnectionFailures;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipTcpv4ConnectionsReset;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipTcpv6ConnectionsReset;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_winsockBspRejectedConnections;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_winsockBspRejectedConnectionsPerSec;
+ctPdhPerformance InstantiateTCPCounters()
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
-    g_tcpipTcpv4ConnectionsEstablished = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipTcpv4ConnectionsEstablished = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipTcpv4,
         L"ConnectionsEstablished",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_tcpipTcpv4ConnectionsEstablished);
     wprintf(L".");
 
-    g_tcpipTcpv6ConnectionsEstablished = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipTcpv6ConnectionsEstablished = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipTcpv6,
         L"ConnectionsEstablished",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_tcpipTcpv6ConnectionsEstablished);
     wprintf(L".");
 
-    g_tcpipTcpv4ConnectionFailures = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipTcpv4ConnectionFailures = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipTcpv4,
         L"ConnectionFailures",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipTcpv4ConnectionFailures);
     wprintf(L".");
 
-    g_tcpipTcpv6ConnectionFailures = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipTcpv6ConnectionFailures = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipTcpv6,
         L"ConnectionFailures",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipTcpv6ConnectionFailures);
     wprintf(L".");
 
-    g_tcpipTcpv4ConnectionsReset = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipTcpv4ConnectionsReset = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipTcpv4,
         L"ConnectionsReset",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipTcpv4ConnectionsReset);
     wprintf(L".");
 
-    g_tcpipTcpv6ConnectionsReset = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipTcpv6ConnectionsReset = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipTcpv6,
         L"ConnectionsReset",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipTcpv6ConnectionsReset);
     wprintf(L".");
 
-    g_winsockBspRejectedConnections = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_winsockBspRejectedConnections = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::WinsockBsp,
         L"RejectedConnections",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_winsockBspRejectedConnections);
     wprintf(L".");
 
-    g_winsockBspRejectedConnectionsPerSec = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_winsockBspRejectedConnectionsPerSec = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::WinsockBsp,
         L"RejectedConnectionsPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_winsockBspRejectedConnectionsPerSec);
     wprintf(L".");
 
@@ -1521,79 +1608,71 @@ void ProcessTCPCounters(ctsPerf::ctsWriteDetails& writer)
 /*                                        TCPIP UDPv4                                                */
 /*                                        TCPIP UDPv6                                                */
 /****************************************************************************************************/
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipUdpv4NoportPerSec;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipUdpv4ReceivedErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipUdpv4DatagramsPerSec;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipUdpv6NoportPerSec;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipUdpv6ReceivedErrors;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_tcpipUdpv6DatagramsPerSec;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_winsockBspDroppedDatagrams;
-shared_ptr<ctWmiPerformanceCounter<ULONG>> g_winsockBspDroppedDatagramsPerSecond;
-ctWmiPerformance InstantiateUDPCounters()
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipUdpv4NoportPerSec;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipUdpv4ReceivedErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipUdpv4DatagramsPerSec;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipUdpv6NoportPerSec;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipUdpv6ReceivedErrors;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_tcpipUdpv6DatagramsPerSec;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_winsockBspDroppedDatagrams;
+shared_ptr<ctPdhPerformanceCounter<ULONG>> g_winsockBspDroppedDatagramsPerSecond;
+ctPdhPerformance InstantiateUDPCounters()
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
-    g_tcpipUdpv4NoportPerSec = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipUdpv4NoportPerSec = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipUdpv4,
         L"DatagramsNoPortPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_tcpipUdpv4NoportPerSec);
     wprintf(L".");
 
-    g_tcpipUdpv4ReceivedErrors = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipUdpv4ReceivedErrors = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipUdpv4,
         L"DatagramsReceivedErrors",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipUdpv4ReceivedErrors);
     wprintf(L".");
 
-    g_tcpipUdpv4DatagramsPerSec = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipUdpv4DatagramsPerSec = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipUdpv4,
         L"DatagramsPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_tcpipUdpv4DatagramsPerSec);
     wprintf(L".");
 
-    g_tcpipUdpv6NoportPerSec = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipUdpv6NoportPerSec = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipUdpv6,
         L"DatagramsNoPortPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_tcpipUdpv6NoportPerSec);
     wprintf(L".");
 
-    g_tcpipUdpv6ReceivedErrors = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipUdpv6ReceivedErrors = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipUdpv6,
         L"DatagramsReceivedErrors",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_tcpipUdpv6ReceivedErrors);
     wprintf(L".");
 
-    g_tcpipUdpv6DatagramsPerSec = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_tcpipUdpv6DatagramsPerSec = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::TcpipUdpv6,
         L"DatagramsPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_tcpipUdpv6DatagramsPerSec);
     wprintf(L".");
 
-    g_winsockBspDroppedDatagrams = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_winsockBspDroppedDatagrams = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::WinsockBsp,
         L"DroppedDatagrams",
         ctWmiPerformanceCollectionType::FirstLast);
     performanceCounter.add_counter(g_winsockBspDroppedDatagrams);
     wprintf(L".");
 
-    g_winsockBspDroppedDatagramsPerSecond = ctCreatePerfCounter<ULONG>(
-        *g_wmi,
+    g_winsockBspDroppedDatagramsPerSecond = ctCreatePdhPerfCounter<ULONG>(
         ctWmiEnumClassName::WinsockBsp,
         L"DroppedDatagramsPersec",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     performanceCounter.add_counter(g_winsockBspDroppedDatagramsPerSecond);
     wprintf(L".");
 
@@ -1717,128 +1796,116 @@ void ProcessUDPCounters(ctsPerf::ctsWriteDetails& writer)
 }
 
 
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_perProcessPrivilegedTime;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_perProcessProcessorTime;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_perProcessUserTime;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_perProcessPrivateBytes;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_perProcessVirtualBytes;
-shared_ptr<ctWmiPerformanceCounter<ULONGLONG>> g_perProcessWorkingSet;
-ctWmiPerformance InstantiatePerProcessByNameCounters(const std::wstring& trackProcess)
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_perProcessPrivilegedTime;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_perProcessProcessorTime;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_perProcessUserTime;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_perProcessPrivateBytes;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_perProcessVirtualBytes;
+shared_ptr<ctPdhPerformanceCounter<ULONGLONG>> g_perProcessWorkingSet;
+ctPdhPerformance InstantiatePerProcessByNameCounters(const std::wstring& trackProcess)
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
     // PercentPrivilegedTime, PercentProcessorTime, PercentUserTime, PrivateBytes, VirtualBytes, WorkingSet
-    g_perProcessPrivilegedTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessPrivilegedTime = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PercentPrivilegedTime",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessPrivilegedTime->add_filter(L"Name", trackProcess.c_str());
     performanceCounter.add_counter(g_perProcessPrivilegedTime);
     wprintf(L".");
 
-    g_perProcessProcessorTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessProcessorTime = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PercentProcessorTime",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessProcessorTime->add_filter(L"Name", trackProcess.c_str());
     performanceCounter.add_counter(g_perProcessProcessorTime);
     wprintf(L".");
 
-    g_perProcessUserTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessUserTime = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PercentUserTime",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessUserTime->add_filter(L"Name", trackProcess.c_str());
     performanceCounter.add_counter(g_perProcessUserTime);
     wprintf(L".");
 
-    g_perProcessPrivateBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessPrivateBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PrivateBytes",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessPrivateBytes->add_filter(L"Name", trackProcess.c_str());
     performanceCounter.add_counter(g_perProcessPrivateBytes);
     wprintf(L".");
 
-    g_perProcessVirtualBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessVirtualBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"VirtualBytes",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessVirtualBytes->add_filter(L"Name", trackProcess.c_str());
     performanceCounter.add_counter(g_perProcessVirtualBytes);
     wprintf(L".");
 
-    g_perProcessWorkingSet = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessWorkingSet = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"WorkingSet",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessWorkingSet->add_filter(L"Name", trackProcess.c_str());
     performanceCounter.add_counter(g_perProcessWorkingSet);
     wprintf(L".");
 
     return performanceCounter;
 }
-ctWmiPerformance InstantiatePerProcessByPIDCounters(const DWORD processId)
+ctPdhPerformance InstantiatePerProcessByPIDCounters(const DWORD processId)
 {
-    ctWmiPerformance performanceCounter(*g_wmi);
+    ctPdhPerformance performanceCounter;
 
     // PercentPrivilegedTime, PercentProcessorTime, PercentUserTime, PrivateBytes, VirtualBytes, WorkingSet
-    g_perProcessPrivilegedTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessPrivilegedTime = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PercentPrivilegedTime",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessPrivilegedTime->add_filter(L"IDProcess", processId);
     performanceCounter.add_counter(g_perProcessPrivilegedTime);
     wprintf(L".");
 
-    g_perProcessProcessorTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessProcessorTime = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PercentProcessorTime",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessProcessorTime->add_filter(L"IDProcess", processId);
     performanceCounter.add_counter(g_perProcessProcessorTime);
     wprintf(L".");
 
-    g_perProcessUserTime = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessUserTime = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PercentUserTime",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessUserTime->add_filter(L"IDProcess", processId);
     performanceCounter.add_counter(g_perProcessUserTime);
     wprintf(L".");
 
-    g_perProcessPrivateBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessPrivateBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"PrivateBytes",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessPrivateBytes->add_filter(L"IDProcess", processId);
     performanceCounter.add_counter(g_perProcessPrivateBytes);
     wprintf(L".");
 
-    g_perProcessVirtualBytes = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessVirtualBytes = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"VirtualBytes",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessVirtualBytes->add_filter(L"IDProcess", processId);
     performanceCounter.add_counter(g_perProcessVirtualBytes);
     wprintf(L".");
 
-    g_perProcessWorkingSet = ctCreatePerfCounter<ULONGLONG>(
-        *g_wmi,
+    g_perProcessWorkingSet = ctCreatePdhPerfCounter<ULONGLONG>(
         ctWmiEnumClassName::Process,
         L"WorkingSet",
-        g_meanOnly ? ctWmiPerformanceCollectionType::MeanOnly : ctWmiPerformanceCollectionType::Detailed);
+        g_collectionType);
     g_perProcessWorkingSet->add_filter(L"IDProcess", processId);
     performanceCounter.add_counter(g_perProcessWorkingSet);
     wprintf(L".");
@@ -26,8 +26,10 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 namespace ctsPerf {
 
-    void ctsWriteDetails::CreateFile(bool meanOnly)
+    void ctsWriteDetails::CreateFile(bool meanOnly, bool histogram)
     {
+        m_histogram = histogram;
+
         m_fileHandle.reset(::CreateFileW(
             m_fileName.c_str(),
             GENERIC_WRITE,
@@ -37,23 +39,21 @@ namespace ctsPerf {
             FILE_ATTRIBUTE_NORMAL,
             nullptr));
         THROW_LAST_ERROR_IF_NULL(m_fileHandle.get());
+        m_buffer.reserve(c_flushThreshold + 1024);
 
-        // write the UTF16 Byte order mark
-        constexpr WCHAR bomUtf16 = 0xFEFF;
-        DWORD length = sizeof(WCHAR);
-        DWORD written;
-        THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), &bomUtf16, length, &written, nullptr));
+        // write the Byte order mark: converted to the UTF8 BOM when writing UTF8
+        m_buffer.push_back(static_cast<WCHAR>(0xFEFF));
 
         if (meanOnly) {
-            constexpr WCHAR meanHeader[] = L"PerfCounter(CounterName),SampleCount,Min,Max,Mean\r\n";
-            length = sizeof meanHeader;
-            THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), meanHeader, length, &written, nullptr));
+            m_buffer.append(L"PerfCounter(CounterName),SampleCount,Min,Max,Mean\r\n");
+        }
+        else if (histogram)
+        {
+            m_buffer.append(L"PerfCounter(CounterName),SampleCount,Min,Max,-1Std,Mean,+1Std,-1IQR,Median,+1IQR,95th,99th\r\n");
         }
         else
         {
-            constexpr WCHAR detailedHeader[] = L"PerfCounter(CounterName),SampleCount,Min,Max,-1Std,Mean,+1Std,-1IQR,Median,+1IQR\r\n";
-            length = sizeof detailedHeader;
-            THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), detailedHeader, length, &written, nullptr));
+            m_buffer.append(L"PerfCounter(CounterName),SampleCount,Min,Max,-1Std,Mean,+1Std,-1IQR,Median,+1IQR\r\n");
         }
     }
     void ctsWriteDetails::CreateFile(const std::wstring& bannerText)
@@ -67,61 +67,95 @@ namespace ctsPerf {
             FILE_ATTRIBUTE_NORMAL,
             nullptr));
         THROW_LAST_ERROR_IF_NULL(m_fileHandle.get());
+        m_buffer.reserve(c_flushThreshold + 1024);
 
-        // write the UTF16 Byte order mark
-        constexpr WCHAR bomUtf16 = 0xFEFF;
-        constexpr DWORD bomLength{ sizeof(WCHAR) };
-        DWORD written{};
-        THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), &bomUtf16, bomLength, &written, nullptr));
-
-        const DWORD bannerLength{ static_cast<DWORD>(bannerText.length() * sizeof(WCHAR)) };
-        THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), bannerText.c_str(), bannerLength, &written, nullptr));
+        // write the Byte order mark: converted to the UTF8 BOM when writing UTF8
+        m_buffer.push_back(static_cast<WCHAR>(0xFEFF));
+        m_buffer.append(bannerText);
 
         EndRow();
     }
 
-    void ctsWriteDetails::WriteRow(const std::wstring& text) const noexcept
+    void ctsWriteDetails::WriteRow(const std::wstring& text) noexcept
+    try
     {
-        const DWORD length{ static_cast<DWORD>(text.length() * sizeof(WCHAR)) };
-        DWORD written{};
-        if (!::WriteFile(m_fileHandle.get(), text.c_str(), length, &written, nullptr)) {
-            const auto gle = ::GetLastError();
-            wprintf(L"\t[ctsWriteDetails::write_row] WriteFile failed (%u)\n", gle);
-        }
-
+        m_buffer.append(text);
         EndRow();
     }
+    CATCH_LOG()
 
-    void ctsWriteDetails::WriteEmptyRow() const noexcept
+    void ctsWriteDetails::WriteEmptyRow() noexcept
     {
         EndRow();
     }
 
-    void ctsWriteDetails::StartRow(PCWSTR className, PCWSTR counterName) const noexcept
+    void ctsWriteDetails::StartRow(PCWSTR className, PCWSTR counterName) noexcept
     try
     {
-        auto formattedString(wil::str_printf<std::wstring>(
-            L"%ws (%ws)", className, counterName));
         // since writing to csv, can't embed a comma in the data
-        ctl::ctString::ctReplaceAll(formattedString, L",", L"-");
+        const auto appendWithoutCommas = [this](PCWSTR text) {
+            for (; *text != L'\0'; ++text) {
+                m_buffer.push_back(*text == L',' ? L'-' : *text);
+            }
+        };
+
+        appendWithoutCommas(className);
+        m_buffer.append(L" (");
+        appendWithoutCommas(counterName);
+        m_buffer.push_back(L')');
+    }
+    CATCH_LOG()
 
-        const DWORD length{ static_cast<DWORD>(formattedString.length() * sizeof(WCHAR)) };
-        DWORD written{};
-        if (!::WriteFile(m_fileHandle.get(), formattedString.c_str(), length, &written, nullptr)) {
-            const auto gle = ::GetLastError();
-            wprintf(L"\t[ctsWriteDetails::start_row] WriteFile failed (%u)\n", gle);
+    void ctsWriteDetails::EndRow() noexcept
+    try
+    {
+        m_buffer.append(L"\r\n");
+        if (m_buffer.size() >= c_flushThreshold) {
+            Flush();
         }
     }
     CATCH_LOG()
 
-    void ctsWriteDetails::EndRow() const noexcept
+    void ctsWriteDetails::Flush() noexcept
+    try
     {
-        constexpr WCHAR endOfLine[2]{ L'\r', L'\n' };
-        constexpr DWORD endOfLineLength{ sizeof endOfLine };
+        if (!m_fileHandle || m_buffer.empty()) {
+            return;
+        }
+
+        const void* writeBuffer = m_buffer.c_str();
+        DWORD length = static_cast<DWORD>(m_buffer.length() * sizeof(WCHAR));
+        if (m_utf8) {
+            const auto bytesRequired = ::WideCharToMultiByte(
+                CP_UTF8, 0,
+                m_buffer.c_str(), static_cast<int>(m_buffer.length()),
+                nullptr, 0,
+                nullptr, nullptr);
+            m_utf8Buffer.resize(bytesRequired);
+            const auto bytesConverted = ::WideCharToMultiByte(
+                CP_UTF8, 0,
+                m_buffer.c_str(), static_cast<int>(m_buffer.length()),
+                m_utf8Buffer.data(), static_cast<int>(m_utf8Buffer.size()),
+                nullptr, nullptr);
+            if (bytesConverted == 0) {
+                const auto gle = ::GetLastError();
+                wprintf(L"\t[ctsWriteDetails::flush] WideCharToMultiByte failed (%u)\n", gle);
+                m_buffer.clear();
+                return;
+            }
+
+            writeBuffer = m_utf8Buffer.c_str();
+            length = static_cast<DWORD>(bytesConverted);
+        }
+
         DWORD written{};
-        if (!::WriteFile(m_fileHandle.get(), endOfLine, endOfLineLength, &written, nullptr)) {
+        if (!::WriteFile(m_fileHandle.get(), writeBuffer, length, &written, nullptr)) {
             const auto gle = ::GetLastError();
-            wprintf(L"\t[ctsWriteDetails::end_row] WriteFile failed (%u)\n", gle);
+            wprintf(L"\t[ctsWriteDetails::flush] WriteFile failed (%u)\n", gle);
         }
+
+        // keeps the capacity for the next rows
+        m_buffer.clear();
     }
+    CATCH_LOG()
 }
@@ -14,7 +14,11 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <algorithm>
+#include <charconv>
+#include <execution>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <tuple>
 // os headers
@@ -30,104 +34,162 @@ namespace ctsPerf {
     namespace Details {
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
         ///
-        /// write( ... )
-        /// - overloads for ULONG and ULONGLONG data types
-        /// - overloads for 1, 2, or 3 data points
+        /// Append( ... )
+        /// - appends each value as a new csv column, formatted directly into the caller's buffer
+        /// - integral types are written as-is, doubles with 3 decimal places
         ///
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        inline std::wstring Write(ULONGLONG firstValue)
-        {
-            return wil::str_printf<std::wstring>(L",%llu", firstValue);
-        }
-        inline std::wstring Write(ULONG firstValue)
-        {
-            return wil::str_printf<std::wstring>(L",%lu", firstValue);
-        }
-        inline std::wstring Write(double firstValue)
-        {
-            return wil::str_printf<std::wstring>(L",%.3f", firstValue);
-        }
-        inline std::wstring Write(ULONGLONG firstValue, ULONGLONG secondValue)
-        {
-            return wil::str_printf<std::wstring>(L",%llu,%llu", firstValue, secondValue);
-        }
-        inline std::wstring Write(ULONG firstValue, ULONG secondValue)
-        {
-            return wil::str_printf<std::wstring>(L",%lu,%lu", firstValue, secondValue);
-        }
-        inline std::wstring Write(double firstValue, double secondValue)
-        {
-            return wil::str_printf<std::wstring>(L",%.3f,%.3f", firstValue, secondValue);
-        }
-        inline std::wstring Write(ULONGLONG firstValue, ULONGLONG secondValue, ULONGLONG thirdValue)
-        {
-            return wil::str_printf<std::wstring>(L",%llu,%llu,%llu", firstValue, secondValue, thirdValue);
-        }
-        inline std::wstring Write(ULONG firstValue, ULONG secondValue, ULONG thirdValue)
+        template <typename T>
+        void AppendValue(std::wstring& buffer, T value)
         {
-            return wil::str_printf<std::wstring>(L",%lu,%lu,%lu", firstValue, secondValue, thirdValue);
+            // large enough for any double formatted as %.3f (DBL_MAX has 309 integral digits)
+            char text[320];
+            std::to_chars_result result{};
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                result = std::to_chars(text, text + sizeof text, value, std::chars_format::fixed, 3);
+            }
+            else
+            {
+                result = std::to_chars(text, text + sizeof text, value);
+            }
+
+            buffer.push_back(L',');
+            if (result.ec == std::errc{}) {
+                buffer.append(text, result.ptr);
+            }
         }
-        inline std::wstring Write(double firstValue, double secondValue, double thirdValue)
+
+        template <typename... Values>
+        void Append(std::wstring& buffer, Values... values)
         {
-            return wil::str_printf<std::wstring>(L",%.3f,%.3f,%.3f", firstValue, secondValue, thirdValue);
+            (AppendValue(buffer, values), ...);
         }
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsWriteDetails
+    /// - writes csv rows into an in-memory buffer, written to the file in large blocks
+    ///   once c_flushThreshold characters are pending, and when destroyed
+    /// - files are UTF-16 by default, or UTF-8 if requested at construction (half the size for this ASCII data)
+    /// - not thread-safe: callers must serialize writes to the same instance
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     class ctsWriteDetails {
     private:
-        void StartRow(PCWSTR className, PCWSTR counterName) const noexcept;
-        void EndRow() const noexcept;
+        static constexpr size_t c_flushThreshold = 64 * 1024;
+
+        void StartRow(PCWSTR className, PCWSTR counterName) noexcept;
+        void EndRow() noexcept;
+        void Flush() noexcept;
 
         std::wstring m_fileName;
         wil::unique_hfile m_fileHandle;
+        // the pending text, and the reusable conversion buffer when writing UTF-8
+        std::wstring m_buffer;
+        std::string m_utf8Buffer;
+        bool m_utf8 = false;
+        bool m_histogram = false;
 
     public:
         template <typename T>
         static std::wstring PrintMeanStdDev(const std::vector<T>& data)
         {
             auto stdTuple = ctl::SampledStandardDeviation(data.begin(), data.end());
-            return Details::Write(std::get<0>(stdTuple), std::get<1>(stdTuple)); // Mean,StdDev
+            std::wstring formattedData;
+            Details::Append(formattedData, std::get<0>(stdTuple), std::get<1>(stdTuple)); // Mean,StdDev
+            return formattedData;
         }
 
         template <typename T>
-        static std::wstring PrintDetails(std::vector<T>& data)
+        static std::wstring PrintMeanStdDev(const ctl::ctLogLinearHistogram<T>& data)
+        {
+            std::wstring formattedData;
+            Details::Append(formattedData, data.mean(), data.standard_deviation()); // Mean,StdDev
+            return formattedData;
+        }
+
+        //
+        // The vector *will* be reordered (this is why it's non-const).
+        // - the min, max, mean and standard deviation are reduced in parallel, and the quartiles are selected
+        //   without sorting the data
+        //
+        template <typename T>
+        static void AppendDetails(std::wstring& buffer, std::vector<T>& data)
         {
             if (data.empty()) {
-                return std::wstring();
+                return;
             }
 
-            // sort the data for IQR calculations
-            sort(data.begin(), data.end());
+            const auto minMax = std::minmax_element(std::execution::par_unseq, data.cbegin(), data.cend());
+            const T minValue = *minMax.first;
+            const T maxValue = *minMax.second;
+            auto stdTuple = ctl::SampledStandardDeviation(data.cbegin(), data.cend());
+            // reorders the data
+            auto interquartileTuple = ctl::ctSelectInterquartileRange(data.begin(), data.end());
+
+            Details::Append(buffer, static_cast<DWORD>(data.size()));  // SampleCount
+            Details::Append(buffer, minValue, maxValue); // Min,Max
+            Details::Append(buffer, std::get<0>(stdTuple) - std::get<1>(stdTuple),  std::get<0>(stdTuple), std::get<0>(stdTuple) + std::get<1>(stdTuple)); // -1Std,Mean,+1Std
+            Details::Append(buffer, std::get<0>(interquartileTuple), std::get<1>(interquartileTuple), std::get<2>(interquartileTuple)); // -1IQR,Median,+1IQR
+        }
 
-            auto stdTuple = ctl::SampledStandardDeviation(data.begin(), data.end());
-            auto interquartileTuple = ctl::ctInterquartileRange(data.begin(), data.end());
+        //
+        // formats the summary captured from ctWmiPerformanceCollectionType::Histogram
+        // - see ctl::ctLogLinearHistogram::write_summary for the layout
+        //
+        template <typename T>
+        static void AppendHistogram(std::wstring& buffer, const std::vector<T>& data)
+        {
+            if (data.size() < ctl::ctLogLinearHistogram<T>::c_summarySize) {
+                return;
+            }
 
-            auto formattedData = Details::Write(static_cast<DWORD>(data.size()));  // SampleCount
-            formattedData += Details::Write(*data.begin(), *data.rbegin()); // Min,Max
-            formattedData += Details::Write(std::get<0>(stdTuple) - std::get<1>(stdTuple),  std::get<0>(stdTuple), std::get<0>(stdTuple) + std::get<1>(stdTuple)); // -1Std,Mean,+1Std
-            formattedData += Details::Write(std::get<0>(interquartileTuple), std::get<1>(interquartileTuple), std::get<2>(interquartileTuple)); // -1IQR,Median,+1IQR
-            return formattedData;
+            const auto mean = static_cast<double>(data[3]);
+            const auto stdDev = static_cast<double>(data[4]);
+
+            Details::Append(buffer, static_cast<DWORD>(data[0]));  // SampleCount
+            Details::Append(buffer, data[1], data[2]); // Min,Max
+            Details::Append(buffer, mean - stdDev, mean, mean + stdDev); // -1Std,Mean,+1Std
+            Details::Append(buffer, data[5], data[6], data[7]); // -1IQR,Median,+1IQR
+            Details::Append(buffer, data[8], data[9]); // 95th,99th
         }
 
-        explicit ctsWriteDetails(PCWSTR file_name) : m_fileName(file_name)
+        explicit ctsWriteDetails(PCWSTR file_name, bool utf8 = false) : m_fileName(file_name), m_utf8(utf8)
         {
         }
-        ~ctsWriteDetails() noexcept = default;
+        ~ctsWriteDetails() noexcept
+        {
+            Flush();
+        }
 
         ctsWriteDetails(const ctsWriteDetails&) = delete;
         ctsWriteDetails& operator=(const ctsWriteDetails&) = delete;
 
         ctsWriteDetails(ctsWriteDetails&& rhs) noexcept = default;
-        ctsWriteDetails& operator=(ctsWriteDetails&& rhs) noexcept = default;
+        ctsWriteDetails& operator=(ctsWriteDetails&& rhs) noexcept
+        {
+            // write out anything pending to our file before taking on the rhs file
+            Flush();
+            m_fileName = std::move(rhs.m_fileName);
+            m_fileHandle = std::move(rhs.m_fileHandle);
+            m_buffer = std::move(rhs.m_buffer);
+            m_utf8Buffer = std::move(rhs.m_utf8Buffer);
+            m_utf8 = rhs.m_utf8;
+            m_histogram = rhs.m_histogram;
+            return *this;
+        }
 
-        void CreateFile(bool meanOnly = false);
+        void CreateFile(bool meanOnly = false, bool histogram = false);
         void CreateFile(const std::wstring& bannerText);
 
-        void WriteRow(const std::wstring& text) const noexcept;
-		void WriteEmptyRow() const noexcept;
+        void WriteRow(const std::wstring& text) noexcept;
+		void WriteEmptyRow() noexcept;
 
         //
-        // The vector *will* be sorted before being returned (this is why it's non-const).
+        // The vector *will* be reordered before being returned (this is why it's non-const).
+        // - if the file was created for histograms, the vector holds a histogram summary instead of every data point
         //
         template <typename T>
         void WriteDetails(PCWSTR className, PCWSTR counterName, std::vector<T>& data)
@@ -137,12 +199,11 @@ namespace ctsPerf {
             }
 
             StartRow(className, counterName);
-
-            const std::wstring formattedData(PrintDetails(data));
-            const auto length = static_cast<DWORD>(formattedData.length() * sizeof(wchar_t));
-            DWORD written{};
-            THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), formattedData.c_str(), length, &written, nullptr));
-
+            if (m_histogram) {
+                AppendHistogram(m_buffer, data);
+            } else {
+                AppendDetails(m_buffer, data);
+            }
             EndRow();
         }
 
@@ -157,11 +218,7 @@ namespace ctsPerf {
             // [0] == count
             // [1] == first
             // [2] == last
-            const std::wstring difference = Details::Write(data[0], data[2] - data[1]);
-            const auto length = static_cast<DWORD>(difference.length() * sizeof(wchar_t));
-            DWORD written{};
-            THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), difference.c_str(), length, &written, nullptr));
-
+            Details::Append(m_buffer, data[0], data[2] - data[1]);
             EndRow();
         }
 
@@ -178,11 +235,7 @@ namespace ctsPerf {
             // [1] == min
             // [2] == max
             // [3] == mean
-            const std::wstring meanString = Details::Write(data[0], data[1]) + Details::Write(data[2], data[3]);
-            const auto length = static_cast<DWORD>(meanString.length() * sizeof(wchar_t));
-            DWORD written{};
-            THROW_LAST_ERROR_IF(!::WriteFile(m_fileHandle.get(), meanString.c_str(), length, &written, nullptr));
-
+            Details::Append(m_buffer, data[0], data[1], data[2], data[3]);
             EndRow();
         }
     };
@@ -23,12 +23,14 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // wil headers
 #include <wil/stl.h>
 #include <wil/resource.h>
+#include <wil/win32_helpers.h>
 // ctl headers
 #include <ctSocketExtensions.hpp>
 #include <ctThreadIocp.hpp>
 #include <ctSockaddr.hpp>
 // project headers
 #include "ctsSocket.h"
+#include "ctsSocketPool.h"
 
 using ctsTraffic::ctsConfig::g_configSettings;
 
@@ -61,17 +63,32 @@ namespace ctsTraffic
     // - if the callback is called and the counter reflects no request arrived yet,
     // --- the new connection is added to a queue and AcceptEx is not reposted
     //
+    // The number of AcceptEx requests kept posted on each listener adapts within -PrePostAccepts:[low,high]
+    // - when every posted request completed within the adapt period, connections are arriving faster than
+    //   they are being reposted (SYNs are queueing in the kernel backlog) : the posted count doubles
+    // - when fewer than a quarter of them completed within the adapt period, it halves
+    //   by canceling the AcceptEx requests above the new count (those objects are kept idle to be reposted later)
+    //
+    // With -AcceptQueues, the AcceptEx requests on each listening socket are split across accept queues
+    // - each queue has its own lock, its own AcceptEx requests posted (and adapted) on every listener,
+    //   and its own queues of accepted connections and pended requests
+    // - callers are served by their current processor's queue first, taking connections queued on other queues
+    //   before their request is pended; a completion with no request pended on its own queue hands its connection
+    //   to a request pended on another queue when that queue's lock is free
+    //
     namespace details
     {
         //
-        // constant defining how many acceptex requests we want maintained per listener
+        // how often the posted AcceptEx count is checked to shrink when idle
+        // - growing is evaluated as each AcceptEx completes
         //
-        constexpr unsigned c_pendedAcceptRequests = 100;
+        constexpr DWORD c_adaptPeriodMilliseconds = 1000;
 
         //
         // necessary forward declarations of internal classes
         //
         struct ctsAcceptExImpl;
+        struct ctsAcceptQueue;
         class ctsAcceptSocketInfo;
 
         static void ctsAcceptExIoCompletionCallback(OVERLAPPED*, _In_ ctsAcceptSocketInfo* acceptInfo) noexcept;
@@ -84,21 +101,27 @@ namespace ctsTraffic
         struct ctsAcceptedConnection
         {
             wil::unique_socket m_acceptSocket;
+            // -SocketReuse : the completion port association of a recycled accept socket, and the listening address keying the pool
+            std::shared_ptr<ctl::ctThreadIocp> m_acceptIocp;
+            ctl::ctSockaddr m_listenAddr;
             ctl::ctSockaddr m_localAddr;
             ctl::ctSockaddr m_remoteAddr;
             DWORD m_lastError = 0;
+            // -ConnectData:on : the connection ID the client sent with ConnectEx
+            char m_connectionId[ctsStatistics::c_connectionIdLength]{};
         };
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         ///
-        /// Struct to track listening sockets
+        /// Struct to own listening sockets
         /// - must have a unique IOCP class for each listener
+        /// - shared by every accept queue : each tracks its own AcceptEx requests in a ctsListenSocketInfo
         ///
         ////////////////////////////////////////////////////////////////////////////////////////////////////
-        struct ctsListenSocketInfo
+        struct ctsListeningSocket
         {
             // c'tor throws a wil::ResultException or bad_alloc on failure
-            explicit ctsListenSocketInfo(ctl::ctSockaddr addr) : m_sockaddr(std::move(addr))
+            explicit ctsListeningSocket(ctl::ctSockaddr addr) : m_sockaddr(std::move(addr))
             {
                 wil::unique_socket tempsocket(
                     ctsConfig::CreateSocket(addr.family(), SOCK_STREAM, IPPROTO_TCP, g_configSettings->SocketFlags));
@@ -125,22 +148,67 @@ namespace ctsTraffic
                 m_listenSocket = std::move(tempsocket);
             }
 
-            ~ctsListenSocketInfo() noexcept
+            // must be destroyed before the ctsListenSocketInfo objects tracking AcceptEx requests on this socket
+            ~ctsListeningSocket() noexcept
             {
                 // close the socket then wait for all IO to stop
                 m_listenSocket.reset();
                 m_iocp.reset();
             }
 
+            ctsListeningSocket(const ctsListeningSocket&) = delete;
+            ctsListeningSocket& operator=(const ctsListeningSocket&) = delete;
+            ctsListeningSocket(ctsListeningSocket&&) = delete;
+            ctsListeningSocket& operator=(ctsListeningSocket&&) = delete;
+
+            wil::unique_socket m_listenSocket;
+            ctl::ctSockaddr m_sockaddr;
+            std::unique_ptr<ctl::ctThreadIocp> m_iocp;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Struct to track the AcceptEx requests one accept queue posts on a listening socket
+        ///
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        struct ctsListenSocketInfo
+        {
+            ctsListenSocketInfo(const ctsListeningSocket& listener, _In_ ctsAcceptQueue* acceptQueue) noexcept :
+                m_listenSocket(listener.m_listenSocket.get()),
+                m_sockaddr(listener.m_sockaddr),
+                m_iocp(listener.m_iocp.get()),
+                m_acceptQueue(acceptQueue)
+            {
+            }
+
+            ~ctsListenSocketInfo() noexcept = default;
+
             ctsListenSocketInfo(const ctsListenSocketInfo&) = delete;
             ctsListenSocketInfo& operator=(const ctsListenSocketInfo&) = delete;
             ctsListenSocketInfo(ctsListenSocketInfo&&) = delete;
             ctsListenSocketInfo& operator=(ctsListenSocketInfo&&) = delete;
 
-            wil::unique_socket m_listenSocket;
-            ctl::ctSockaddr m_sockaddr;
-            std::unique_ptr<ctl::ctThreadIocp> m_iocp;
+            // the listening socket and its IOCP are owned by ctsListeningSocket
+            const SOCKET m_listenSocket;
+            const ctl::ctSockaddr m_sockaddr;
+            ctl::ctThreadIocp* const m_iocp;
+            // the accept queue whose lock guards the below, and to which accepted connections are handed
+            ctsAcceptQueue* const m_acceptQueue;
             std::vector<std::shared_ptr<ctsAcceptSocketInfo>> m_acceptSockets;
+
+            // the below are guarded by ctsAcceptQueue::m_lock
+            // the number of AcceptEx requests to keep posted, and how many completed in the current adapt period
+            unsigned long m_postedTarget = 0;
+            unsigned long m_completedThisPeriod = 0;
+            // AcceptEx requests canceled to shrink the posted count which have not yet completed
+            unsigned long m_retiringCount = 0;
+            // objects in m_acceptSockets with no AcceptEx posted, to be reposted when the posted count grows
+            std::vector<ctsAcceptSocketInfo*> m_idleAcceptSockets;
+
+            [[nodiscard]] unsigned long GetPostedCount() const noexcept
+            {
+                return static_cast<unsigned long>(m_acceptSockets.size() - m_idleAcceptSockets.size()) - m_retiringCount;
+            }
         };
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -161,8 +229,28 @@ namespace ctsTraffic
 
             ~ctsAcceptSocketInfo() noexcept = default;
 
-            // attempts to post a new AcceptEx - internally tracks if succeeds or fails
-            void InitatiateAcceptEx();
+            // attempts to post a new AcceptEx - returns false if it could not be posted
+            // - can throw wil::ResultException creating the accept socket
+            bool InitatiateAcceptEx();
+
+            // cancels the posted AcceptEx so it's not reposted when it completes - returns false if none is posted
+            // - if the AcceptEx already completed, the accepted connection is still returned
+            // - the caller must hold ctsAcceptQueue::m_lock, which also guards m_retiring
+            bool Retire() noexcept;
+
+            // returns if Retire() was called for the last AcceptEx : resetting so this object can be reposted later
+            // - the caller must hold ctsAcceptQueue::m_lock
+            bool TakeRetired() noexcept
+            {
+                const auto retired = m_retiring;
+                m_retiring = false;
+                return retired;
+            }
+
+            [[nodiscard]] std::shared_ptr<ctsListenSocketInfo> GetListener() const noexcept
+            {
+                return m_listeningSocketInfo.lock();
+            }
 
             // returns a ctsAcceptedConnection struct describing the result of an AcceptEx call
             // - must be called only after the previous AcceptEx call has completed its OVERLAPPED call
@@ -176,23 +264,36 @@ namespace ctsTraffic
 
         private:
             static const size_t c_singleOutputBufferSize = sizeof(SOCKADDR_INET) + 16;
+            // -ConnectData:on : the AcceptEx receives the connection ID ahead of the addresses
+            static DWORD GetReceiveDataLength() noexcept
+            {
+                return g_configSettings->ExchangeConnectionIdOnConnect ? ctsStatistics::c_connectionIdLength : 0;
+            }
 
             // the lock to guard access to the SOCKET
             wil::critical_section m_lock{ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
             wil::unique_socket m_acceptSocket;
+            // -SocketReuse : set when m_acceptSocket was recycled, already associated with this ctThreadIocp
+            std::shared_ptr<ctl::ctThreadIocp> m_acceptIocp;
             // the raw (non-owning) OVERLAPPED* for the AcceptEx request
             OVERLAPPED* m_pOverlapped = nullptr;
+            // the QPC when the AcceptEx was posted - zero when not tracking connection latency
+            long long m_acceptPostedQpc = 0LL;
+            // the bytes received when the AcceptEx completed inline
+            DWORD m_bytesReceived = 0;
+            // guarded by ctsAcceptQueue::m_lock
+            bool m_retiring = false;
             // a weak reference back to the parent listening object
             const std::weak_ptr<ctsListenSocketInfo> m_listeningSocketInfo;
-            // the buffer to supply to AcceptEx to capture the address information
-            char m_outputBuffer[c_singleOutputBufferSize * 2]{};
+            // the buffer to supply to AcceptEx to capture the received connection ID (if any) and the address information
+            char m_outputBuffer[ctsStatistics::c_connectionIdLength + c_singleOutputBufferSize * 2]{};
         };
 
         //
-        // Impl object to carry around the real member data of ctsAcceptEx
-        // - the shared_ptr to the Impl allows an instance of ctsAcceptEx to be copyable
+        // An accept queue : the AcceptEx requests it posts on every listener, with the connections they accepted
+        // and the requests for connections pended on it, all guarded by its own lock
         //
-        struct ctsAcceptExImpl
+        struct ctsAcceptQueue
         {
             // must guard access to internal containers
             wil::critical_section m_lock{ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
@@ -201,9 +302,32 @@ namespace ctsTraffic
             std::queue<ctsAcceptedConnection> m_acceptedConnections;
             bool m_shuttingDown = false;
 
+            ctsAcceptQueue() = default;
+            ~ctsAcceptQueue() noexcept = default;
+
+            // non-copyable
+            ctsAcceptQueue(const ctsAcceptQueue&) = delete;
+            ctsAcceptQueue& operator=(const ctsAcceptQueue&) = delete;
+            ctsAcceptQueue(ctsAcceptQueue&&) = delete;
+            ctsAcceptQueue& operator=(ctsAcceptQueue&&) = delete;
+        };
+
+        //
+        // Impl object to carry around the real member data of ctsAcceptEx
+        // - the shared_ptr to the Impl allows an instance of ctsAcceptEx to be copyable
+        //
+        struct ctsAcceptExImpl
+        {
+            // the accept queues are declared first : the listening sockets must be closed before the queues are destroyed
+            std::vector<std::unique_ptr<ctsAcceptQueue>> m_acceptQueues;
+            std::vector<std::unique_ptr<ctsListeningSocket>> m_listeningSockets;
+            // periodically shrinks the posted AcceptEx count when idle - only created when adapting within a range
+            wil::unique_threadpool_timer m_adaptTimer;
+
             //
             // ctsAcceptExImpl constructor
-            // - start listening on all addresses specified tracked in ctsListenSocketInfo objects
+            // - start listening on all addresses specified tracked in ctsListeningSocket objects
+            // - each accept queue tracks its AcceptEx requests on each listener in a ctsListenSocketInfo object
             // - create ctsAcceptSocketInfo object to manage attempts to accept new connections
             // --- one object per accept socket
             //
@@ -211,68 +335,260 @@ namespace ctsTraffic
 
             void Start()
             {
-                // swap in the listen vector only if fully created
-                // - if anything fails, this temp vector will go out of scope and safely be destroyed
-                std::vector<std::shared_ptr<ctsListenSocketInfo>> tempListeners;
+                // swap in the queues and listeners only if fully created
+                // - if anything fails, these temp vectors will go out of scope and safely be destroyed
+                // - the listening sockets are destroyed first, closing them and waiting for their AcceptEx callbacks
+                std::vector<std::unique_ptr<ctsAcceptQueue>> tempAcceptQueues;
+                std::vector<std::unique_ptr<ctsListeningSocket>> tempListeningSockets;
+
+                const auto queueCount = g_configSettings->AcceptQueueCount > 0 ? g_configSettings->AcceptQueueCount : 1;
+                for (unsigned long queueCounter = 0; queueCounter < queueCount; ++queueCounter)
+                {
+                    tempAcceptQueues.push_back(std::make_unique<ctsAcceptQueue>());
+                }
 
                 // listen to each address
                 for (const auto& addr : g_configSettings->ListenAddresses)
                 {
-                    // Make the structures for the listener and its accept sockets
-                    std::shared_ptr<ctsListenSocketInfo> listenSocketInfo(std::make_shared<ctsListenSocketInfo>(addr));
+                    tempListeningSockets.push_back(std::make_unique<ctsListeningSocket>(addr));
+                    const auto& listeningSocket = *tempListeningSockets.back();
                     PRINT_DEBUG_INFO(L"\t\tListening to %ws\n", addr.WriteCompleteAddress().c_str());
-                    //
-                    // Add PendedAcceptRequests pended acceptex objects per listener
-                    //
-                    for (unsigned acceptCounter = 0; acceptCounter < c_pendedAcceptRequests; ++acceptCounter)
+
+                    for (const auto& acceptQueue : tempAcceptQueues)
                     {
-                        std::shared_ptr<ctsAcceptSocketInfo> acceptSocketInfo = std::make_shared<ctsAcceptSocketInfo>(listenSocketInfo);
-                        listenSocketInfo->m_acceptSockets.push_back(acceptSocketInfo);
-                        // post AcceptEx on this socket
-                        acceptSocketInfo->InitatiateAcceptEx();
+                        // Make the structures for this queue's AcceptEx requests on the listener and its accept sockets
+                        std::shared_ptr<ctsListenSocketInfo> listenSocketInfo(std::make_shared<ctsListenSocketInfo>(listeningSocket, acceptQueue.get()));
+                        //
+                        // start with the low end of -PrePostAccepts pended acceptex objects per listener
+                        //
+                        // - AcceptEx requests can complete while the rest are posted: their callbacks wait on the lock
+                        // - the lock is released before the listener is destroyed on failure, as that waits for those callbacks
+                        const auto lock = acceptQueue->m_lock.lock();
+                        acceptQueue->m_listeners.push_back(listenSocketInfo);
+                        listenSocketInfo->m_postedTarget = g_configSettings->PrePostAcceptsLow;
+                        for (unsigned long acceptCounter = 0; acceptCounter < listenSocketInfo->m_postedTarget; ++acceptCounter)
+                        {
+                            std::shared_ptr<ctsAcceptSocketInfo> acceptSocketInfo = std::make_shared<ctsAcceptSocketInfo>(listenSocketInfo);
+                            listenSocketInfo->m_acceptSockets.push_back(acceptSocketInfo);
+                            // post AcceptEx on this socket
+                            if (!acceptSocketInfo->InitatiateAcceptEx())
+                            {
+                                listenSocketInfo->m_idleAcceptSockets.push_back(acceptSocketInfo.get());
+                            }
+                        }
                     }
-
-                    // all successful - save this listen socket
-                    tempListeners.push_back(listenSocketInfo);
                 }
 
-                if (tempListeners.empty())
+                if (tempListeningSockets.empty())
                 {
                     throw std::exception("ctsAcceptEx invoked with no listening addresses specified");
                 }
 
-                // everything succeeded - safely save the listen queue
-                m_listeners.swap(tempListeners);
+                // everything succeeded - safely save the queues and listeners
+                m_acceptQueues.swap(tempAcceptQueues);
+                m_listeningSockets.swap(tempListeningSockets);
+
+                if (g_configSettings->PrePostAcceptsHigh > g_configSettings->PrePostAcceptsLow)
+                {
+                    m_adaptTimer.reset(CreateThreadpoolTimer(AdaptTimerCallback, this, g_configSettings->pTpEnvironment));
+                    THROW_LAST_ERROR_IF_MSG(!m_adaptTimer, "CreateThreadpoolTimer (ctsAcceptEx)");
+                    FILETIME relativeTimeout = wil::filetime::from_int64(-1 * wil::filetime_duration::one_millisecond * c_adaptPeriodMilliseconds);
+                    SetThreadpoolTimer(m_adaptTimer.get(), &relativeTimeout, c_adaptPeriodMilliseconds, 0);
+                }
+            }
+
+            // the accept queue of the current processor
+            [[nodiscard]] size_t CurrentQueueIndex() const noexcept
+            {
+                if (m_acceptQueues.size() == 1)
+                {
+                    return 0;
+                }
+                PROCESSOR_NUMBER processor{};
+                GetCurrentProcessorNumberEx(&processor);
+                return (processor.Group * 64ull + processor.Number) % m_acceptQueues.size();
+            }
+
+            //
+            // called under the lock of acceptQueue, which has no request pended, as an AcceptEx completes
+            // - takes a request pended on another queue whose lock isn't held right now
+            //   (never waiting on another queue's lock while holding this one)
+            //
+            bool TakePendedRequestFromOtherQueue(const ctsAcceptQueue& acceptQueue, std::weak_ptr<ctsSocket>& weakSocket) const noexcept
+            {
+                for (const auto& otherQueue : m_acceptQueues)
+                {
+                    if (otherQueue.get() == &acceptQueue)
+                    {
+                        continue;
+                    }
+
+                    const auto otherLock = otherQueue->m_lock.try_lock();
+                    if (otherLock && !otherQueue->m_shuttingDown && !otherQueue->m_pendedAcceptRequests.empty())
+                    {
+                        weakSocket = otherQueue->m_pendedAcceptRequests.front();
+                        otherQueue->m_pendedAcceptRequests.pop();
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            //
+            // called under the accept queue's lock as each AcceptEx completes, after the accepted connection was handled
+            // - doubles the posted count if every posted request completed within this adapt period
+            // - reposts the AcceptEx on this object, unless it was retired or the posted count is now lower
+            //
+            static void RepostAcceptEx(_In_ ctsAcceptSocketInfo* acceptInfo, bool retired) noexcept
+            {
+                const auto listenSocketInfo = acceptInfo->GetListener();
+                if (!listenSocketInfo)
+                {
+                    return;
+                }
+
+                if (retired)
+                {
+                    --listenSocketInfo->m_retiringCount;
+                    listenSocketInfo->m_idleAcceptSockets.push_back(acceptInfo);
+                    return;
+                }
+
+                ++listenSocketInfo->m_completedThisPeriod;
+                if (listenSocketInfo->m_completedThisPeriod >= listenSocketInfo->m_postedTarget &&
+                    listenSocketInfo->m_postedTarget < g_configSettings->PrePostAcceptsHigh)
+                {
+                    listenSocketInfo->m_postedTarget = listenSocketInfo->m_postedTarget * 2 < g_configSettings->PrePostAcceptsHigh ?
+                        listenSocketInfo->m_postedTarget * 2 :
+                        g_configSettings->PrePostAcceptsHigh;
+                    // a new period starts at the new count
+                    listenSocketInfo->m_completedThisPeriod = 0;
+                    PRINT_DEBUG_INFO(L"\t\tctsAcceptEx : growing to %lu AcceptEx requests posted\n", listenSocketInfo->m_postedTarget);
+                }
+
+                // this object's AcceptEx completed : it's still counted as posted until reposted or made idle
+                if (listenSocketInfo->GetPostedCount() > listenSocketInfo->m_postedTarget || !PostAcceptEx(acceptInfo))
+                {
+                    listenSocketInfo->m_idleAcceptSockets.push_back(acceptInfo);
+                }
+
+                // post more AcceptEx requests if the count grew - reusing idle objects first
+                while (listenSocketInfo->GetPostedCount() < listenSocketInfo->m_postedTarget)
+                {
+                    ctsAcceptSocketInfo* nextAcceptInfo = nullptr;
+                    if (!listenSocketInfo->m_idleAcceptSockets.empty())
+                    {
+                        nextAcceptInfo = listenSocketInfo->m_idleAcceptSockets.back();
+                        listenSocketInfo->m_idleAcceptSockets.pop_back();
+                    }
+                    else
+                    {
+                        try
+                        {
+                            listenSocketInfo->m_acceptSockets.push_back(std::make_shared<ctsAcceptSocketInfo>(listenSocketInfo));
+                        }
+                        catch (...)
+                        {
+                            ctsConfig::PrintThrownException();
+                            break;
+                        }
+                        nextAcceptInfo = listenSocketInfo->m_acceptSockets.back().get();
+                    }
+
+                    if (!PostAcceptEx(nextAcceptInfo))
+                    {
+                        listenSocketInfo->m_idleAcceptSockets.push_back(nextAcceptInfo);
+                        break;
+                    }
+                }
+            }
+
+            static bool PostAcceptEx(_In_ ctsAcceptSocketInfo* acceptInfo) noexcept
+            {
+                try
+                {
+                    return acceptInfo->InitatiateAcceptEx();
+                }
+                catch (...)
+                {
+                    ctsConfig::PrintThrownException();
+                    return false;
+                }
+            }
+
+            // halves the posted count of listeners which completed fewer than a quarter of their posted requests this period
+            static void NTAPI AdaptTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER) noexcept
+            {
+                auto* const pThis = static_cast<ctsAcceptExImpl*>(pContext);
+                for (const auto& acceptQueue : pThis->m_acceptQueues)
+                {
+                    const auto lock = acceptQueue->m_lock.lock();
+                    if (acceptQueue->m_shuttingDown)
+                    {
+                        return;
+                    }
+
+                    for (const auto& listenSocketInfo : acceptQueue->m_listeners)
+                    {
+                        if (listenSocketInfo->m_completedThisPeriod < listenSocketInfo->m_postedTarget / 4 &&
+                            listenSocketInfo->m_postedTarget > g_configSettings->PrePostAcceptsLow)
+                        {
+                            listenSocketInfo->m_postedTarget = listenSocketInfo->m_postedTarget / 2 > g_configSettings->PrePostAcceptsLow ?
+                                listenSocketInfo->m_postedTarget / 2 :
+                                g_configSettings->PrePostAcceptsLow;
+                            PRINT_DEBUG_INFO(L"\t\tctsAcceptEx : shrinking to %lu AcceptEx requests posted\n", listenSocketInfo->m_postedTarget);
+
+                            for (const auto& acceptSocketInfo : listenSocketInfo->m_acceptSockets)
+                            {
+                                if (listenSocketInfo->GetPostedCount() <= listenSocketInfo->m_postedTarget)
+                                {
+                                    break;
+                                }
+                                if (acceptSocketInfo->Retire())
+                                {
+                                    ++listenSocketInfo->m_retiringCount;
+                                }
+                            }
+                        }
+                        listenSocketInfo->m_completedThisPeriod = 0;
+                    }
+                }
             }
 
             ~ctsAcceptExImpl() noexcept
             {
+                // stop adapting before the listeners are torn down
+                m_adaptTimer.reset();
+
                 // remove anything pended under lock since the IOCP callbacks still might be invoked
+                for (const auto& acceptQueue : m_acceptQueues)
                 {
-                    const auto lock = m_lock.lock();
-                    m_shuttingDown = true;
+                    const auto lock = acceptQueue->m_lock.lock();
+                    acceptQueue->m_shuttingDown = true;
 
                     // close out all caller requests for new accepted sockets
-                    while (!m_pendedAcceptRequests.empty())
+                    while (!acceptQueue->m_pendedAcceptRequests.empty())
                     {
-                        auto weakSocket = m_pendedAcceptRequests.front();
+                        auto weakSocket = acceptQueue->m_pendedAcceptRequests.front();
                         auto sharedSocket(weakSocket.lock());
                         if (sharedSocket)
                         {
                             sharedSocket->CompleteState(WSAECONNABORTED);
                         }
 
-                        m_pendedAcceptRequests.pop();
+                        acceptQueue->m_pendedAcceptRequests.pop();
                     }
 
-                    while (!m_acceptedConnections.empty())
+                    while (!acceptQueue->m_acceptedConnections.empty())
                     {
-                        m_acceptedConnections.pop();
+                        acceptQueue->m_acceptedConnections.pop();
                     }
                 }
+                g_configSettings->TcpStatusDetails.m_acceptExQueued.SetValue(0);
 
-                // now stop the listeners and accepted sockets
-                m_listeners.clear();
+                // now stop the listeners, then the accepted sockets
+                m_listeningSockets.clear();
+                m_acceptQueues.clear();
             }
 
             // non-copyable
@@ -289,52 +605,75 @@ namespace ctsTraffic
         ///
         ///
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        void ctsAcceptSocketInfo::InitatiateAcceptEx()
+        bool ctsAcceptSocketInfo::InitatiateAcceptEx()
         {
             const auto listeningSocketObject = m_listeningSocketInfo.lock();
             if (!listeningSocketObject)
             {
-                return;
+                return false;
             }
 
             const auto lock = m_lock.lock();
 
             if (m_acceptSocket.get() != INVALID_SOCKET)
             {
-                return;
+                // already posted
+                return true;
             }
 
-            wil::unique_socket newAcceptedSocket(
-                ctsConfig::CreateSocket(
-                    listeningSocketObject->m_sockaddr.family(),
-                    SOCK_STREAM,
-                    IPPROTO_TCP,
-                    g_configSettings->SocketFlags));
-
-            // since not inheriting from the listening socket, must explicity set options on the accept socket
-            // - passing the listening address since that will be the local address of this accepted socket
-            auto error = ctsConfig::SetPreBindOptions(newAcceptedSocket.get(), listeningSocketObject->m_sockaddr);
-            if (error != 0)
+            wil::unique_socket newAcceptedSocket;
+            m_acceptIocp.reset();
+            if (g_configSettings->ReuseSockets)
             {
-                THROW_WIN32_MSG(error, "SetPreBindOptions (ctsAcceptEx)");
+                // a recycled socket keeps the options set when it was created
+                auto recycled = ctsSocketPool::Acquire(listeningSocketObject->m_sockaddr);
+                newAcceptedSocket = std::move(recycled.m_socket);
+                m_acceptIocp = std::move(recycled.m_tpIocp);
             }
-            error = ctsConfig::SetPreConnectOptions(newAcceptedSocket.get());
-            if (error != 0)
+
+            int error = 0;
+            if (!newAcceptedSocket)
             {
-                THROW_WIN32_MSG(error, "SetPreConnectOptions (ctsAcceptEx)");
+                newAcceptedSocket.reset(
+                    ctsConfig::CreateSocket(
+                        listeningSocketObject->m_sockaddr.family(),
+                        SOCK_STREAM,
+                        IPPROTO_TCP,
+                        g_configSettings->SocketFlags));
+
+                // since not inheriting from the listening socket, must explicity set options on the accept socket
+                // - passing the listening address since that will be the local address of this accepted socket
+                error = ctsConfig::SetPreBindOptions(newAcceptedSocket.get(), listeningSocketObject->m_sockaddr);
+                if (error != 0)
+                {
+                    THROW_WIN32_MSG(error, "SetPreBindOptions (ctsAcceptEx)");
+                }
+                error = ctsConfig::SetPreConnectOptions(newAcceptedSocket.get());
+                if (error != 0)
+                {
+                    THROW_WIN32_MSG(error, "SetPreConnectOptions (ctsAcceptEx)");
+                }
             }
 
             m_pOverlapped = listeningSocketObject->m_iocp->new_request(
                 [this](OVERLAPPED* pCallbackOverlapped) noexcept { ctsAcceptExIoCompletionCallback(pCallbackOverlapped, this); });
 
-            ::ZeroMemory(m_outputBuffer, c_singleOutputBufferSize * 2);
-            DWORD bytesReceived{};
+            ::ZeroMemory(m_outputBuffer, sizeof m_outputBuffer);
+            m_acceptPostedQpc = 0LL;
+            if (!g_configSettings->LatencyPercentiles.empty())
+            {
+                m_acceptPostedQpc = ctl::ctTimer::SnapQpc();
+            }
+            m_bytesReceived = 0;
+            // store the socket before posting: an inline completion hands it off from the callback
+            m_acceptSocket = std::move(newAcceptedSocket);
+            g_configSettings->TcpStatusDetails.m_acceptExPosted.Increment();
             if (!ctl::ctAcceptEx(
-                listeningSocketObject->m_listenSocket.get(),
-                newAcceptedSocket.get(),
+                listeningSocketObject->m_listenSocket,
+                m_acceptSocket.get(),
                 m_outputBuffer,
-                0, c_singleOutputBufferSize, c_singleOutputBufferSize,
-                &bytesReceived,
+                GetReceiveDataLength(), c_singleOutputBufferSize, c_singleOutputBufferSize,
+                &m_bytesReceived,
                 m_pOverlapped))
             {
                 error = WSAGetLastError();
@@ -343,8 +682,10 @@ namespace ctsTraffic
                     // a real failure - must abort the IO
                     listeningSocketObject->m_iocp->cancel_request(m_pOverlapped);
                     m_pOverlapped = nullptr;
+                    m_acceptSocket.reset();
+                    g_configSettings->TcpStatusDetails.m_acceptExPosted.Decrement();
                     ctsConfig::PrintErrorIfFailed("AcceptEx", error);
-                    return;
+                    return false;
                 }
             }
             else if (g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp)
@@ -356,8 +697,27 @@ namespace ctsTraffic
                 ctsAcceptExIoCompletionCallback(nullptr, this);
             }
 
-            // no failures - store the socket
-            m_acceptSocket = std::move(newAcceptedSocket);
+            return true;
+        }
+
+        bool ctsAcceptSocketInfo::Retire() noexcept
+        {
+            const auto listeningSocketObject = m_listeningSocketInfo.lock();
+            if (!listeningSocketObject)
+            {
+                return false;
+            }
+
+            const auto lock = m_lock.lock();
+            if (m_retiring || m_acceptSocket.get() == INVALID_SOCKET || !m_pOverlapped)
+            {
+                return false;
+            }
+
+            m_retiring = true;
+            // the AcceptEx completes with ERROR_OPERATION_ABORTED through the IOCP callback
+            CancelIoEx(reinterpret_cast<HANDLE>(listeningSocketObject->m_listenSocket), m_pOverlapped);
+            return true;
         }
 
         ctsAcceptedConnection ctsAcceptSocketInfo::GetAcceptedSocket() noexcept
@@ -372,7 +732,7 @@ namespace ctsTraffic
                 // return empty/failed details object
                 return returnDetails;
             }
-            const auto listeningSocket = listeningSocketObject->m_listenSocket.get();
+            const auto listeningSocket = listeningSocketObject->m_listenSocket;
 
             const auto lock = m_lock.lock();
 
@@ -395,6 +755,24 @@ namespace ctsTraffic
                     // return empty/failed details object
                     return returnDetails;
                 }
+                m_bytesReceived = transferred;
+            }
+
+            // AcceptEx completes with the first data received : the rest of the connection ID could still be in flight
+            const auto receiveDataLength = GetReceiveDataLength();
+            if (m_bytesReceived < receiveDataLength)
+            {
+                const auto bytesRemaining = static_cast<int>(receiveDataLength - m_bytesReceived);
+                if (0 == m_bytesReceived ||
+                    recv(m_acceptSocket.get(), m_outputBuffer + m_bytesReceived, bytesRemaining, MSG_WAITALL) != bytesRemaining)
+                {
+                    // the client closed the connection without sending the connection ID
+                    returnDetails.m_lastError = WSAECONNABORTED;
+                    ctsConfig::PrintErrorIfFailed("AcceptEx (ConnectData)", returnDetails.m_lastError);
+                    m_acceptSocket.reset();
+                    // return empty/failed details object
+                    return returnDetails;
+                }
             }
 
             // if successful, update the socket context
@@ -417,7 +795,7 @@ namespace ctsTraffic
 
             ctl::ctGetAcceptExSockaddrs(
                 m_outputBuffer,
-                0,
+                receiveDataLength,
                 c_singleOutputBufferSize,
                 c_singleOutputBufferSize,
                 reinterpret_cast<sockaddr**>(&localAddr),
@@ -425,11 +803,24 @@ namespace ctsTraffic
                 reinterpret_cast<sockaddr**>(&remoteAddr),
                 &remoteAddrLen);
 
+            if (m_acceptPostedQpc != 0)
+            {
+                const auto completedQpc = ctl::ctTimer::SnapQpc();
+                g_configSettings->TcpStatusDetails.m_connectionLatency.Record(completedQpc - m_acceptPostedQpc);
+                m_acceptPostedQpc = 0LL;
+            }
+
             // transfer ownership of the SOCKET to the caller
             returnDetails.m_acceptSocket = std::move(m_acceptSocket);
+            returnDetails.m_acceptIocp = std::move(m_acceptIocp);
+            returnDetails.m_listenAddr = listeningSocketObject->m_sockaddr;
             returnDetails.m_lastError = 0;
             returnDetails.m_localAddr.set(localAddr);
             returnDetails.m_remoteAddr.set(remoteAddr);
+            if (receiveDataLength > 0)
+            {
+                memcpy_s(returnDetails.m_connectionId, sizeof returnDetails.m_connectionId, m_outputBuffer, receiveDataLength);
+            }
 
             return returnDetails;
         }
@@ -456,21 +847,39 @@ namespace ctsTraffic
             try
         {
             ctsAcceptedConnection acceptedSocket = acceptInfo->GetAcceptedSocket();
+            g_configSettings->TcpStatusDetails.m_acceptExPosted.Decrement();
+
+            const auto listenSocketInfo = acceptInfo->GetListener();
+            if (!listenSocketInfo)
+            {
+                return;
+            }
+            auto& acceptQueue = *listenSocketInfo->m_acceptQueue;
 
-            const auto lock = g_acceptExImpl.m_lock.lock();
-            if (g_acceptExImpl.m_shuttingDown)
+            const auto lock = acceptQueue.m_lock.lock();
+            if (acceptQueue.m_shuttingDown)
             {
                 return;
             }
 
-            if (!g_acceptExImpl.m_pendedAcceptRequests.empty())
+            std::weak_ptr<ctsSocket> weakSocket;
+            const auto retired = acceptInfo->TakeRetired();
+            if (retired && acceptedSocket.m_lastError != 0)
+            {
+                // this AcceptEx was canceled to shrink the posted count - there's no connection to hand off
+            }
+            else if (!acceptQueue.m_pendedAcceptRequests.empty() ||
+                g_acceptExImpl.TakePendedRequestFromOtherQueue(acceptQueue, weakSocket))
             {
                 //
                 // we have unfulfilled requests for more connections
                 // return a previously accepted socket
                 //
-                const auto weakSocket = g_acceptExImpl.m_pendedAcceptRequests.front();
-                g_acceptExImpl.m_pendedAcceptRequests.pop();
+                if (!acceptQueue.m_pendedAcceptRequests.empty())
+                {
+                    weakSocket = acceptQueue.m_pendedAcceptRequests.front();
+                    acceptQueue.m_pendedAcceptRequests.pop();
+                }
 
                 auto sharedSocket(weakSocket.lock());
                 if (sharedSocket)
@@ -487,8 +896,17 @@ namespace ctsTraffic
                             sharedSocket->SetLocalSockaddr(localAddr);
                         }
 
+                        if (g_configSettings->ExchangeConnectionIdOnConnect)
+                        {
+                            sharedSocket->SetConnectDataId(acceptedSocket.m_connectionId);
+                        }
+
                         // socket ownership was successfully transfered
                         sharedSocket->SetSocket(acceptedSocket.m_acceptSocket.release());
+                        if (g_configSettings->ReuseSockets)
+                        {
+                            sharedSocket->SetRecyclable(acceptedSocket.m_listenAddr, std::move(acceptedSocket.m_acceptIocp));
+                        }
                         sharedSocket->SetRemoteSockaddr(acceptedSocket.m_remoteAddr);
                         sharedSocket->CompleteState(0);
 
@@ -511,13 +929,14 @@ namespace ctsTraffic
                 // else, we have no requests for another connection,
                 // - queue this one for when a request comes in
                 //
-                g_acceptExImpl.m_acceptedConnections.push(std::move(acceptedSocket));
+                acceptQueue.m_acceptedConnections.push(std::move(acceptedSocket));
+                g_configSettings->TcpStatusDetails.m_acceptExQueued.Increment();
             }
 
             //
-            // always attempt another AcceptEx
+            // attempt another AcceptEx unless the posted count is shrinking
             //
-            acceptInfo->InitatiateAcceptEx();
+            ctsAcceptExImpl::RepostAcceptEx(acceptInfo, retired);
         }
         catch (...)
         {
@@ -552,15 +971,36 @@ namespace ctsTraffic
         }
 
         details::ctsAcceptedConnection acceptedConnection;
+        bool connectionAccepted = false;
+
+        const auto& acceptQueues = details::g_acceptExImpl.m_acceptQueues;
+        const auto homeQueueIndex = details::g_acceptExImpl.CurrentQueueIndex();
+        if (acceptQueues.size() > 1)
+        {
+            // take a connection already accepted on any queue, starting with this processor's queue
+            for (size_t queueOffset = 0; queueOffset < acceptQueues.size() && !connectionAccepted; ++queueOffset)
+            {
+                auto& acceptQueue = *acceptQueues[(homeQueueIndex + queueOffset) % acceptQueues.size()];
+                const auto lock = acceptQueue.m_lock.lock();
+                if (!acceptQueue.m_acceptedConnections.empty())
+                {
+                    acceptedConnection = std::move(acceptQueue.m_acceptedConnections.front());
+                    acceptQueue.m_acceptedConnections.pop();
+                    connectionAccepted = true;
+                }
+            }
+        }
 
         // scoped to the auto-release CS object
+        if (!connectionAccepted)
         {
-            const auto lock = details::g_acceptExImpl.m_lock.lock();
+            auto& acceptQueue = *acceptQueues[homeQueueIndex];
+            const auto lock = acceptQueue.m_lock.lock();
             // guard access to internal queues
-            if (details::g_acceptExImpl.m_acceptedConnections.empty())
+            if (acceptQueue.m_acceptedConnections.empty())
             {
                 // no accepted connections yet -- save the weak_ptr, *not* the shared_ptr
-                try { details::g_acceptExImpl.m_pendedAcceptRequests.push(weakSocket); }
+                try { acceptQueue.m_pendedAcceptRequests.push(weakSocket); }
                 catch (...)
                 {
                     // fail the caller if can't save this request
@@ -570,12 +1010,18 @@ namespace ctsTraffic
             else
             {
                 // pull the next connection off the queue
-                acceptedConnection = std::move(details::g_acceptExImpl.m_acceptedConnections.front());
-                details::g_acceptExImpl.m_acceptedConnections.pop();
-                error = acceptedConnection.m_lastError;
+                acceptedConnection = std::move(acceptQueue.m_acceptedConnections.front());
+                acceptQueue.m_acceptedConnections.pop();
+                connectionAccepted = true;
             }
         }
 
+        if (connectionAccepted)
+        {
+            g_configSettings->TcpStatusDetails.m_acceptExQueued.Decrement();
+            error = acceptedConnection.m_lastError;
+        }
+
         //
         // complete this socket state if something failed
         //
@@ -600,8 +1046,17 @@ namespace ctsTraffic
                 sharedSocket->SetLocalSockaddr(localAddr);
             }
 
+            if (g_configSettings->ExchangeConnectionIdOnConnect)
+            {
+                sharedSocket->SetConnectDataId(acceptedConnection.m_connectionId);
+            }
+
             // transfering ownership to the ctsSocket
             sharedSocket->SetSocket(acceptedConnection.m_acceptSocket.release());
+            if (g_configSettings->ReuseSockets)
+            {
+                sharedSocket->SetRecyclable(acceptedConnection.m_listenAddr, std::move(acceptedConnection.m_acceptIocp));
+            }
             sharedSocket->SetRemoteSockaddr(acceptedConnection.m_remoteAddr);
             sharedSocket->CompleteState(0);
 
@@ -0,0 +1,416 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// parent header
+#include "ctsBinaryLog.h"
+// cpp headers
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+// os headers
+#include <Windows.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include <ctSockaddr.hpp>
+#include <ctString.hpp>
+// project headers
+#include "ctsIOPattern.h"
+
+namespace ctsTraffic
+{
+    ctsBinaryLogger::ctsBinaryLogger(_In_ PCWSTR fileName, ctsBinaryLogRecordType recordType) :
+        m_recordSize(ctsBinaryLogRecordType::Jitter == recordType ? sizeof(ctsBinaryJitterRecord) : sizeof(ctsBinaryConnectionRecord))
+    {
+        // the file must be opened for read access to be mapped
+        m_file.reset(CreateFileW(
+            fileName,
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ, // allow others to read the file while we write to it
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        THROW_LAST_ERROR_IF_MSG(!m_file, "CreateFile(%ws)", fileName);
+
+        char* const firstView = MapView(0);
+        THROW_LAST_ERROR_IF_NULL_MSG(firstView, "MapViewOfFile(%ws)", fileName);
+
+        ctsBinaryLogHeader header;
+        header.m_recordType = recordType;
+        header.m_recordSize = m_recordSize;
+        memcpy(firstView, &header, sizeof header);
+    }
+
+    ctsBinaryLogger::~ctsBinaryLogger() noexcept
+    {
+        // all writers have completed by the time the loggers are destroyed
+        // - records reserved to views which could not be mapped were counted as dropped
+        unsigned long long fileEnd = m_nextRecord.load() * m_recordSize;
+        for (size_t viewIndex = 0; viewIndex < c_maxViews; ++viewIndex)
+        {
+            char* const view = m_views[viewIndex].load();
+            if (!view)
+            {
+                const unsigned long long mappedEnd = viewIndex * c_viewSize;
+                fileEnd = mappedEnd < fileEnd ? mappedEnd : fileEnd;
+                break;
+            }
+            FlushViewOfFile(view, 0);
+            UnmapViewOfFile(view);
+        }
+
+        // the file was extended a full view at a time : trim the unwritten tail
+        FILE_END_OF_FILE_INFO endOfFile{};
+        endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(fileEnd);
+        SetFileInformationByHandle(m_file.get(), FileEndOfFileInfo, &endOfFile, sizeof endOfFile);
+    }
+
+    void ctsBinaryLogger::WriteRecordImpl(_In_reads_bytes_(recordSize) const void* record, unsigned long recordSize) noexcept
+    {
+        FAIL_FAST_IF_MSG(
+            recordSize != m_recordSize,
+            "ctsBinaryLogger was given a record of %lu bytes - this log was created for %lu byte records", recordSize, m_recordSize);
+
+        const unsigned long long recordOffset = m_nextRecord.fetch_add(1) * m_recordSize;
+        const auto viewIndex = static_cast<size_t>(recordOffset / c_viewSize);
+        if (viewIndex >= c_maxViews)
+        {
+            m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        char* view = m_views[viewIndex].load(std::memory_order_acquire);
+        if (!view)
+        {
+            view = MapView(viewIndex);
+            if (!view)
+            {
+                m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        // record sizes divide the view size evenly : a record never spans 2 views
+        memcpy(view + recordOffset % c_viewSize, record, recordSize);
+    }
+
+    char* ctsBinaryLogger::MapView(size_t viewIndex) noexcept
+    {
+        const auto lock = m_viewLock.lock_exclusive();
+        // records are reserved in order, but a writer can race ahead of the writer mapping the prior view
+        // - always map views in order so the file never has a gap and the d'tor can truncate to what was mapped
+        char* view = nullptr;
+        for (size_t mapIndex = 0; mapIndex <= viewIndex; ++mapIndex)
+        {
+            view = m_views[mapIndex].load(std::memory_order_acquire);
+            if (view)
+            {
+                continue;
+            }
+            if (m_growFailed.load())
+            {
+                return nullptr;
+            }
+
+            // extending the mapping object to the end of this view extends the file
+            ULARGE_INTEGER mappingSize{};
+            mappingSize.QuadPart = (mapIndex + 1) * c_viewSize;
+            const wil::unique_handle mapping(CreateFileMappingW(m_file.get(), nullptr, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, nullptr));
+            if (!mapping)
+            {
+                m_growFailed = true;
+                return nullptr;
+            }
+
+            // the view keeps a reference on the mapping object : it doesn't need to stay open
+            ULARGE_INTEGER viewOffset{};
+            viewOffset.QuadPart = mapIndex * c_viewSize;
+            view = static_cast<char*>(MapViewOfFile(mapping.get(), FILE_MAP_WRITE, viewOffset.HighPart, viewOffset.LowPart, static_cast<SIZE_T>(c_viewSize)));
+            if (!view)
+            {
+                m_growFailed = true;
+                return nullptr;
+            }
+
+            m_views[mapIndex].store(view, std::memory_order_release);
+        }
+        return view;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsConvertBinaryLog
+    ///
+    /// reads the records sequentially and writes the same lines the csv loggers write
+    /// - written synchronously through a local buffer: the async text loggers can drop messages
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    namespace
+    {
+        constexpr unsigned long c_convertBufferSize = 0x100000; // 1MB
+
+        class ctsCsvFileWriter
+        {
+        public:
+            explicit ctsCsvFileWriter(PCWSTR fileName)
+            {
+                m_file.reset(CreateFileW(
+                    fileName,
+                    GENERIC_WRITE,
+                    FILE_SHARE_READ,
+                    nullptr,
+                    CREATE_ALWAYS,
+                    FILE_ATTRIBUTE_NORMAL,
+                    nullptr));
+                THROW_LAST_ERROR_IF_MSG(!m_file, "CreateFile(%ws)", fileName);
+
+                m_text.reserve(c_convertBufferSize / sizeof(wchar_t));
+                // the text loggers write UTF16 with a BOM
+                constexpr WCHAR bom_utf16 = 0xFEFF;
+                m_text.push_back(bom_utf16);
+            }
+
+            ~ctsCsvFileWriter() noexcept = default;
+
+            void Write(const std::wstring& line)
+            {
+                m_text.append(line);
+                if (m_text.size() * sizeof(wchar_t) >= c_convertBufferSize)
+                {
+                    Flush();
+                }
+            }
+
+            void Flush()
+            {
+                DWORD bytesWritten{};
+                THROW_IF_WIN32_BOOL_FALSE_MSG(
+                    WriteFile(m_file.get(), m_text.c_str(), static_cast<DWORD>(m_text.size() * sizeof(wchar_t)), &bytesWritten, nullptr),
+                    "WriteFile (csv conversion)");
+                m_text.clear();
+            }
+
+            ctsCsvFileWriter(const ctsCsvFileWriter&) = delete;
+            ctsCsvFileWriter& operator=(const ctsCsvFileWriter&) = delete;
+            ctsCsvFileWriter(ctsCsvFileWriter&&) = delete;
+            ctsCsvFileWriter& operator=(ctsCsvFileWriter&&) = delete;
+
+        private:
+            wil::unique_hfile m_file;
+            std::wstring m_text;
+        };
+
+        std::wstring FormatJitterRecord(const ctsBinaryJitterRecord& record)
+        {
+            return wil::str_printf<std::wstring>(
+                L"%lld,%lld,%lld,%lld,%lld,%.3f,%.3f,%.3f\r\n",
+                record.m_sequenceNumber,
+                record.m_senderQpc,
+                record.m_senderQpf,
+                record.m_receiverQpc,
+                record.m_receiverQpf,
+                record.m_estimatedTimeInFlightMs,
+                record.m_jitterMs,
+                static_cast<double>(record.m_receiveDelayMicroseconds) / 1000.0);
+        }
+
+        std::wstring FormatConnectionRecord(const ctsBinaryConnectionRecord& record)
+        {
+            std::wstring errorString;
+            if (0 == record.m_error)
+            {
+                errorString = L"Succeeded";
+            }
+            else if (ctsIoPattern::IsProtocolError(record.m_error))
+            {
+                errorString = ctsIoPattern::BuildProtocolErrorString(record.m_error);
+            }
+            else
+            {
+                errorString = wil::str_printf<std::wstring>(
+                    L"%lu: %ws",
+                    record.m_error,
+                    ctl::ctString::ctFormatMessage(record.m_error).c_str());
+                // remove any commas from the formatted string - since that will mess up csv files
+                ctl::ctString::ctReplaceAll(errorString, L",", L" ");
+            }
+
+            // the identifier is always null-terminated when written - don't trust the file
+            char connectionIdentifier[sizeof record.m_connectionIdentifier + 1]{};
+            memcpy(connectionIdentifier, record.m_connectionIdentifier, sizeof record.m_connectionIdentifier);
+
+            const ctl::ctSockaddr localAddr(&record.m_localAddress);
+            const ctl::ctSockaddr remoteAddr(&record.m_remoteAddress);
+            if (IPPROTO_UDP == record.m_protocol)
+            {
+                // csv format : "TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId"
+                return wil::str_printf<std::wstring>(
+                    L"%.3f,%ws,%ws,%llu,%llu,%llu,%llu,%llu,%ws,%hs\r\n",
+                    record.m_timeSliceSeconds,
+                    localAddr.WriteCompleteAddress().c_str(),
+                    remoteAddr.WriteCompleteAddress().c_str(),
+                    record.m_udp.m_bitsPerSecond,
+                    record.m_udp.m_successfulFrames,
+                    record.m_udp.m_droppedFrames,
+                    record.m_udp.m_duplicateFrames,
+                    record.m_udp.m_errorFrames,
+                    errorString.c_str(),
+                    connectionIdentifier);
+            }
+
+            // csv format : L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId"
+            const auto& tcp = record.m_tcp;
+            std::wstring tcpInfoString;
+            if (tcp.m_tcpInfoSampleCount > 0)
+            {
+                tcpInfoString = wil::str_printf<std::wstring>(
+                    L",%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu",
+                    tcp.m_minRttUs,
+                    tcp.m_avgRttUs,
+                    tcp.m_maxRttUs,
+                    tcp.m_minCwnd,
+                    tcp.m_avgCwnd,
+                    tcp.m_maxCwnd,
+                    tcp.m_avgBytesInFlight,
+                    tcp.m_maxBytesInFlight,
+                    tcp.m_bytesRetransmitted,
+                    tcp.m_fastRetransmits,
+                    tcp.m_timeoutEpisodes);
+            }
+            else if (record.m_tcpInfoEnabled)
+            {
+                // keeping the csv columns aligned for connections which never transmitted data
+                tcpInfoString = L",,,,,,,,,,,";
+            }
+
+            return wil::str_printf<std::wstring>(
+                L"%.3f,%ws,%ws,%lld,%lld,%lld,%lld,%lld,%ws,%hs%ws\r\n",
+                record.m_timeSliceSeconds,
+                localAddr.WriteCompleteAddress().c_str(),
+                remoteAddr.WriteCompleteAddress().c_str(),
+                tcp.m_bytesSent,
+                tcp.m_timeMs > 0LL ? tcp.m_bytesSent * 1000LL / tcp.m_timeMs : 0LL,
+                tcp.m_bytesRecv,
+                tcp.m_timeMs > 0LL ? tcp.m_bytesRecv * 1000LL / tcp.m_timeMs : 0LL,
+                tcp.m_timeMs,
+                errorString.c_str(),
+                connectionIdentifier,
+                tcpInfoString.c_str());
+        }
+
+        PCWSTR ConnectionCsvHeader(const ctsBinaryConnectionRecord& firstRecord) noexcept
+        {
+            if (IPPROTO_UDP == firstRecord.m_protocol)
+            {
+                return L"TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId\r\n";
+            }
+            return firstRecord.m_tcpInfoEnabled ?
+                L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId,"
+                L"MinRttUs,AvgRttUs,MaxRttUs,MinCwnd,AvgCwnd,MaxCwnd,AvgBytesInFlight,MaxBytesInFlight,BytesRetrans,FastRetrans,TimeoutEpisodes\r\n" :
+                L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId\r\n";
+        }
+    }
+
+    void ctsConvertBinaryLog(_In_ PCWSTR fileName)
+    {
+        const wil::unique_hfile binaryFile(CreateFileW(
+            fileName,
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr));
+        THROW_LAST_ERROR_IF_MSG(!binaryFile, "CreateFile(%ws)", fileName);
+
+        ctsBinaryLogHeader header;
+        DWORD bytesRead{};
+        THROW_IF_WIN32_BOOL_FALSE_MSG(ReadFile(binaryFile.get(), &header, sizeof header, &bytesRead, nullptr), "ReadFile(%ws)", fileName);
+        if (bytesRead != sizeof header ||
+            header.m_signature != ctsBinaryLogHeader::c_signature ||
+            header.m_version != ctsBinaryLogHeader::c_version)
+        {
+            throw std::invalid_argument("-ConvertLog requires a binary log written by ctsTraffic (.ctsb)");
+        }
+        if (!(ctsBinaryLogRecordType::Jitter == header.m_recordType && sizeof(ctsBinaryJitterRecord) == header.m_recordSize) &&
+            !(ctsBinaryLogRecordType::Connection == header.m_recordType && sizeof(ctsBinaryConnectionRecord) == header.m_recordSize))
+        {
+            throw std::invalid_argument("-ConvertLog was given a binary log with an unknown record type");
+        }
+
+        // records follow the header, which is padded to the record size
+        LARGE_INTEGER firstRecord{};
+        firstRecord.QuadPart = header.m_recordSize;
+        THROW_IF_WIN32_BOOL_FALSE_MSG(SetFilePointerEx(binaryFile.get(), firstRecord, nullptr, FILE_BEGIN), "SetFilePointerEx(%ws)", fileName);
+
+        std::wstring csvFileName(fileName);
+        const auto extension = csvFileName.find_last_of(L'.');
+        if (extension != std::wstring::npos && csvFileName.find_first_of(L"\\/", extension) == std::wstring::npos)
+        {
+            csvFileName.resize(extension);
+        }
+        csvFileName.append(L".csv");
+        ctsCsvFileWriter csvFile(csvFileName.c_str());
+
+        if (ctsBinaryLogRecordType::Jitter == header.m_recordType)
+        {
+            csvFile.Write(L"SequenceNumber,SenderQpc,SenderQpf,ReceiverQpc,ReceiverQpf,RelativeInFlightTimeMs,PrevToCurrentInFlightTimeJitter,ReceiveDelayMs\r\n");
+        }
+
+        // a multiple of every record size
+        std::vector<char> readBuffer(c_convertBufferSize);
+        bool firstConnectionRecord = true;
+        for (;;)
+        {
+            THROW_IF_WIN32_BOOL_FALSE_MSG(
+                ReadFile(binaryFile.get(), readBuffer.data(), c_convertBufferSize, &bytesRead, nullptr),
+                "ReadFile(%ws)", fileName);
+            if (0 == bytesRead)
+            {
+                break;
+            }
+
+            // a partial trailing record is from a file which was not closed cleanly : ignore it
+            for (DWORD offset = 0; offset + header.m_recordSize <= bytesRead; offset += header.m_recordSize)
+            {
+                if (ctsBinaryLogRecordType::Jitter == header.m_recordType)
+                {
+                    ctsBinaryJitterRecord record{};
+                    memcpy(&record, readBuffer.data() + offset, sizeof record);
+                    csvFile.Write(FormatJitterRecord(record));
+                }
+                else
+                {
+                    ctsBinaryConnectionRecord record{};
+                    memcpy(&record, readBuffer.data() + offset, sizeof record);
+                    // a reserved record which was never written (the process did not exit cleanly)
+                    if (0 == record.m_protocol)
+                    {
+                        continue;
+                    }
+                    if (firstConnectionRecord)
+                    {
+                        csvFile.Write(ConnectionCsvHeader(record));
+                        firstConnectionRecord = false;
+                    }
+                    csvFile.Write(FormatConnectionRecord(record));
+                }
+            }
+        }
+
+        csvFile.Flush();
+    }
+}
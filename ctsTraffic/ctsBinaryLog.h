@@ -0,0 +1,176 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <atomic>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+#include <ws2ipdef.h>
+// wil headers
+#include <wil/resource.h>
+
+// ** NOTE ** should not include any local project cts headers - to avoid circular references
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsBinaryLog
+    ///
+    /// Fixed-size binary records written in place into a memory-mapped file
+    /// - used for -ConnectionFilename and -JitterFilename when given the .ctsb extension
+    /// - writers reserve the next record with a single interlocked increment and copy it into the mapped view
+    ///   so no text is formatted and no WriteFile is issued on the IO threads
+    /// - the file is mapped in 64MB views as it grows, and is truncated to the records written when closed
+    /// - ctsTraffic.exe -ConvertLog:<filename>.ctsb writes the csv file the text loggers would have written
+    ///
+    /// File layout: a ctsBinaryLogHeader padded to the record size, followed by the records
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    enum class ctsBinaryLogRecordType : unsigned long
+    {
+        Jitter = 1,
+        Connection = 2
+    };
+
+    struct ctsBinaryLogHeader
+    {
+        static constexpr unsigned long c_signature = 0x42535443; // "CTSB"
+        static constexpr unsigned long c_version = 1;
+
+        unsigned long m_signature = c_signature;
+        unsigned long m_version = c_version;
+        ctsBinaryLogRecordType m_recordType = ctsBinaryLogRecordType::Jitter;
+        unsigned long m_recordSize = 0;
+    };
+
+    // one per received MediaStream frame : the values written with PrintJitterUpdate
+    struct ctsBinaryJitterRecord
+    {
+        long long m_sequenceNumber;
+        long long m_senderQpc;
+        long long m_senderQpf;
+        long long m_receiverQpc;
+        long long m_receiverQpf;
+        double m_estimatedTimeInFlightMs;
+        double m_jitterMs;
+        unsigned long m_bytesReceived;
+        // the time from the stack's receive timestamp to the receive completing (0 without -UdpRecvTimestamps)
+        unsigned long m_receiveDelayMicroseconds;
+    };
+    static_assert(sizeof(ctsBinaryJitterRecord) == 64, "binary log records must be a power of 2 to never span mapped views");
+
+    // one per completed connection : the values written with PrintConnectionResults
+    struct ctsBinaryConnectionRecord
+    {
+        struct TcpResults
+        {
+            long long m_bytesSent;
+            long long m_bytesRecv;
+            long long m_timeMs;
+            // the SIO_TCP_INFO values are only written with -TcpInfo
+            unsigned long long m_tcpInfoSampleCount;
+            unsigned long long m_minRttUs;
+            unsigned long long m_avgRttUs;
+            unsigned long long m_maxRttUs;
+            unsigned long long m_minCwnd;
+            unsigned long long m_avgCwnd;
+            unsigned long long m_maxCwnd;
+            unsigned long long m_avgBytesInFlight;
+            unsigned long long m_maxBytesInFlight;
+            unsigned long long m_bytesRetransmitted;
+            unsigned long long m_fastRetransmits;
+            unsigned long long m_timeoutEpisodes;
+        };
+        struct UdpResults
+        {
+            long long m_bitsPerSecond;
+            long long m_successfulFrames;
+            long long m_droppedFrames;
+            long long m_duplicateFrames;
+            long long m_errorFrames;
+        };
+
+        double m_timeSliceSeconds;
+        SOCKADDR_INET m_localAddress;
+        SOCKADDR_INET m_remoteAddress;
+        unsigned long m_error;
+        // IPPROTO_TCP or IPPROTO_UDP
+        unsigned short m_protocol;
+        // non-zero when the TCP_INFO columns are written (-TcpInfo)
+        unsigned char m_tcpInfoEnabled;
+        unsigned char m_reserved1;
+        union
+        {
+            TcpResults m_tcp;
+            UdpResults m_udp;
+        };
+        char m_connectionIdentifier[40];
+        char m_reserved2[24];
+    };
+    static_assert(sizeof(ctsBinaryConnectionRecord) == 256, "binary log records must be a power of 2 to never span mapped views");
+
+    class ctsBinaryLogger
+    {
+    public:
+        // can throw wil::ResultException
+        ctsBinaryLogger(_In_ PCWSTR fileName, ctsBinaryLogRecordType recordType);
+        ~ctsBinaryLogger() noexcept;
+
+        void WriteRecord(const ctsBinaryJitterRecord& record) noexcept
+        {
+            WriteRecordImpl(&record, sizeof record);
+        }
+        void WriteRecord(const ctsBinaryConnectionRecord& record) noexcept
+        {
+            WriteRecordImpl(&record, sizeof record);
+        }
+
+        // records are only dropped if the file cannot be grown (e.g. the disk is full)
+        [[nodiscard]] unsigned long long GetDroppedRecordCount() const noexcept
+        {
+            return m_droppedRecords.load(std::memory_order_relaxed);
+        }
+
+        ctsBinaryLogger(const ctsBinaryLogger&) = delete;
+        ctsBinaryLogger& operator=(const ctsBinaryLogger&) = delete;
+        ctsBinaryLogger(ctsBinaryLogger&&) = delete;
+        ctsBinaryLogger& operator=(ctsBinaryLogger&&) = delete;
+
+    private:
+        // a multiple of the allocation granularity and of every record size
+        static constexpr unsigned long long c_viewSize = 0x4000000; // 64MB
+        static constexpr size_t c_maxViews = 4096; // 256GB
+
+        wil::unique_hfile m_file;
+        const unsigned long m_recordSize;
+        // record 0 is the header
+        std::atomic<unsigned long long> m_nextRecord{1};
+        std::atomic<unsigned long long> m_droppedRecords{0};
+        std::atomic<bool> m_growFailed{false};
+
+        // views are only mapped under the exclusive lock : once set they never change until the d'tor
+        wil::srwlock m_viewLock;
+        std::atomic<char*> m_views[c_maxViews]{};
+
+        void WriteRecordImpl(_In_reads_bytes_(recordSize) const void* record, unsigned long recordSize) noexcept;
+        char* MapView(size_t viewIndex) noexcept;
+    };
+
+    // writes <filename>.csv next to the binary log, in the format of the csv text loggers
+    // - can throw wil::ResultException, std::invalid_argument, or std::bad_alloc
+    void ctsConvertBinaryLog(_In_ PCWSTR fileName);
+}
@@ -0,0 +1,425 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// declaration header
+#include "ctsCheckpoint.h"
+// cpp headers
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+// ctl headers
+#include <ctTimer.hpp>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// project headers
+#include "ctsConfig.h"
+#include "ctsStatistics.hpp"
+
+namespace ctsTraffic
+{
+    namespace
+    {
+        constexpr unsigned long c_histogramCount = static_cast<unsigned long>(ctsCheckpointHistogram::Probe);
+        constexpr unsigned long c_maxBuckets = c_histogramCount * ctsLatencySnapshot::c_bucketCount;
+        constexpr unsigned long c_maxRecordSize =
+            sizeof(ctsCheckpointRecordHeader) + sizeof(ctsCheckpointTotals) + c_maxBuckets * sizeof(ctsCheckpointBucket);
+
+        void AppendBuckets(std::vector<ctsCheckpointBucket>& buckets, ctsCheckpointHistogram histogram, const ctsLatencyHistogram& latency) noexcept
+        {
+            const auto snapshot = latency.GetTotal();
+            for (unsigned long index = 0; index < ctsLatencySnapshot::c_bucketCount; ++index)
+            {
+                if (snapshot.m_counts[index] != 0)
+                {
+                    // the vector was reserved for every bucket : this never allocates
+                    buckets.push_back({histogram, static_cast<unsigned short>(index), 0, snapshot.m_counts[index]});
+                }
+            }
+        }
+
+        long long ConvertTicksToMicroseconds(long long ticks, long long qpf) noexcept
+        {
+            return ticks / qpf * 1000000LL + ticks % qpf * 1000000LL / qpf;
+        }
+    }
+
+    ctsCheckpointWriter::ctsCheckpointWriter(_In_z_ PCWSTR fileName)
+    {
+        m_buckets.reserve(c_maxBuckets);
+
+        // the file must be opened for read access to be mapped
+        wil::unique_hfile file(CreateFileW(
+            fileName,
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ, // allow -RebuildSummary to read the file while we write to it
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        THROW_LAST_ERROR_IF_MSG(!file, "CreateFile(%ws)", fileName);
+
+        m_file = file.get();
+        if (!Map(c_growSize))
+        {
+            const auto gle = GetLastError();
+            m_file = INVALID_HANDLE_VALUE;
+            THROW_WIN32_MSG(gle, "MapViewOfFile(%ws)", fileName);
+        }
+        file.release();
+
+        ctsCheckpointHeader header;
+        header.m_processId = GetCurrentProcessId();
+        header.m_qpf = ctl::ctTimer::SnapQpf();
+        header.m_protocol = ctsConfig::ProtocolType::TCP == ctsConfig::g_configSettings->Protocol ? IPPROTO_TCP : IPPROTO_UDP;
+        header.m_listening = ctsConfig::IsListening() ? 1 : 0;
+        memcpy(m_view, &header, sizeof header);
+        FlushViewOfFile(m_view, sizeof header);
+    }
+
+    ctsCheckpointWriter::~ctsCheckpointWriter() noexcept
+    {
+        if (m_view)
+        {
+            FlushViewOfFile(m_view, 0);
+            UnmapViewOfFile(m_view);
+        }
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+
+        // the file was extended c_growSize at a time : trim the unwritten tail
+        FILE_END_OF_FILE_INFO endOfFile{};
+        endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(m_written);
+        SetFileInformationByHandle(m_file, FileEndOfFileInfo, &endOfFile, sizeof endOfFile);
+        CloseHandle(m_file);
+    }
+
+    bool ctsCheckpointWriter::Map(unsigned long long capacity) noexcept
+    {
+        // the view is remapped over the whole file as it grows: a record never spans 2 views
+        if (m_view)
+        {
+            UnmapViewOfFile(m_view);
+            m_view = nullptr;
+        }
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+
+        // extending the mapping object extends the file
+        ULARGE_INTEGER mappingSize{};
+        mappingSize.QuadPart = capacity;
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, nullptr);
+        if (!m_mapping)
+        {
+            return false;
+        }
+
+        m_view = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(capacity)));
+        if (!m_view)
+        {
+            const auto gle = GetLastError();
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+            SetLastError(gle);
+            return false;
+        }
+
+        m_capacity = capacity;
+        return true;
+    }
+
+    void ctsCheckpointWriter::Update() noexcept
+    {
+        if (m_failed)
+        {
+            return;
+        }
+
+        const auto& settings = *ctsConfig::g_configSettings;
+        const bool isTcp = ctsConfig::ProtocolType::TCP == settings.Protocol;
+
+        ctsCheckpointTotals totals{};
+        totals.m_elapsedMilliseconds = ctl::ctTimer::SnapQpcInMillis() - settings.StartTimeMilliseconds;
+        totals.m_activeConnections = settings.ConnectionStatusDetails.m_activeConnectionCount.GetValue();
+        totals.m_peakActiveConnections = settings.ConnectionStatusDetails.m_peakActiveConnectionCount.GetValue();
+        totals.m_successfulConnections = settings.ConnectionStatusDetails.m_successfulCompletionCount.GetValue();
+        totals.m_connectionErrors = settings.ConnectionStatusDetails.m_connectionErrorCount.GetValue();
+        totals.m_protocolErrors = settings.ConnectionStatusDetails.m_protocolErrorCount.GetValue();
+
+        m_buckets.clear();
+        if (isTcp)
+        {
+            totals.m_bytesSent = settings.TcpStatusDetails.m_bytesSent.GetValue();
+            totals.m_bytesReceived = settings.TcpStatusDetails.m_bytesRecv.GetValue();
+            totals.m_transactions = settings.TcpStatusDetails.m_transactions.GetValue();
+
+            // only the buckets which counted a duration are written : a histogram of a steady run is a few dozen buckets
+            AppendBuckets(m_buckets, ctsCheckpointHistogram::Io, settings.TcpStatusDetails.m_ioLatency);
+            AppendBuckets(m_buckets, ctsCheckpointHistogram::Connection, settings.TcpStatusDetails.m_connectionLatency);
+            AppendBuckets(m_buckets, ctsCheckpointHistogram::FirstByte, settings.TcpStatusDetails.m_firstByteLatency);
+            AppendBuckets(m_buckets, ctsCheckpointHistogram::Transaction, settings.TcpStatusDetails.m_transactionLatency);
+            AppendBuckets(m_buckets, ctsCheckpointHistogram::Probe, settings.TcpStatusDetails.m_probeLatency);
+        }
+        else
+        {
+            totals.m_bitsReceived = settings.UdpStatusDetails.m_bitsReceived.GetValue();
+            totals.m_successfulFrames = settings.UdpStatusDetails.m_successfulFrames.GetValue();
+            totals.m_droppedFrames = settings.UdpStatusDetails.m_droppedFrames.GetValue();
+            totals.m_duplicateFrames = settings.UdpStatusDetails.m_duplicateFrames.GetValue();
+            totals.m_errorFrames = settings.UdpStatusDetails.m_errorFrames.GetValue();
+            totals.m_sendCalls = settings.UdpStatusDetails.m_sendCalls.GetValue();
+            totals.m_pendedSends = settings.UdpStatusDetails.m_pendedSends.GetValue();
+        }
+
+        const auto bodySize = sizeof totals + m_buckets.size() * sizeof(ctsCheckpointBucket);
+        const auto recordSize = sizeof(ctsCheckpointRecordHeader) + bodySize;
+        if (m_written + recordSize > m_capacity)
+        {
+            const auto required = m_written + recordSize;
+            if (!Map((required + c_growSize - 1) / c_growSize * c_growSize))
+            {
+                m_failed = true;
+                ctsConfig::PrintErrorInfo(
+                    L"-CheckpointFilename failed to grow the checkpoint file (%lu) - no further checkpoints will be written",
+                    GetLastError());
+                return;
+            }
+        }
+
+        char* const record = m_view + m_written;
+        char* const body = record + sizeof(ctsCheckpointRecordHeader);
+        memcpy(body, &totals, sizeof totals);
+        if (!m_buckets.empty())
+        {
+            memcpy(body + sizeof totals, m_buckets.data(), m_buckets.size() * sizeof(ctsCheckpointBucket));
+        }
+
+        // the signature is written last so a reader of the running file never accepts a partial record
+        auto* const recordHeader = reinterpret_cast<ctsCheckpointRecordHeader*>(record);
+        recordHeader->m_size = static_cast<unsigned long>(recordSize);
+        recordHeader->m_sequence = m_sequence;
+        recordHeader->m_checksum = ctsCheckpointChecksum(body, bodySize);
+        recordHeader->m_bucketCount = static_cast<unsigned long>(m_buckets.size());
+        recordHeader->m_reserved = 0;
+        MemoryBarrier();
+        recordHeader->m_signature = ctsCheckpointRecordHeader::c_signature;
+
+        // the pages of the mapped view survive the process crashing : flushing them to disk survives the machine crashing
+        // - only the pages of this record are written, the records before it were flushed with their own update
+        FlushViewOfFile(record, recordSize);
+        FlushFileBuffers(m_file);
+
+        m_written += recordSize;
+        ++m_sequence;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsRebuildSummary
+    ///
+    /// reads the records sequentially, keeping the last one which is complete
+    /// - a record which fails validation ends the file: everything after it was written after the tear
+    /// - printed synchronously with wprintf: ctsConfig is not started for -RebuildSummary
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsRebuildSummary(_In_ PCWSTR fileName)
+    {
+        // share write access : the summary can be rebuilt from the file of a run which is still writing it
+        const wil::unique_hfile checkpointFile(CreateFileW(
+            fileName,
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr));
+        THROW_LAST_ERROR_IF_MSG(!checkpointFile, "CreateFile(%ws)", fileName);
+
+        ctsCheckpointHeader header;
+        DWORD bytesRead{};
+        THROW_IF_WIN32_BOOL_FALSE_MSG(ReadFile(checkpointFile.get(), &header, sizeof header, &bytesRead, nullptr), "ReadFile(%ws)", fileName);
+        if (bytesRead != sizeof header ||
+            header.m_signature != ctsCheckpointHeader::c_signature ||
+            header.m_version != ctsCheckpointHeader::c_version ||
+            header.m_headerSize != sizeof header ||
+            header.m_qpf <= 0)
+        {
+            throw std::invalid_argument("-RebuildSummary requires a checkpoint file written by ctsTraffic (-CheckpointFilename)");
+        }
+
+        std::vector<char> record;
+        std::vector<char> latestRecord;
+        unsigned long long latestSequence = 0;
+        record.reserve(c_maxRecordSize);
+        latestRecord.reserve(c_maxRecordSize);
+        for (unsigned long long sequence = 0;; ++sequence)
+        {
+            ctsCheckpointRecordHeader recordHeader{};
+            THROW_IF_WIN32_BOOL_FALSE_MSG(
+                ReadFile(checkpointFile.get(), &recordHeader, sizeof recordHeader, &bytesRead, nullptr),
+                "ReadFile(%ws)", fileName);
+            if (bytesRead != sizeof recordHeader ||
+                recordHeader.m_signature != ctsCheckpointRecordHeader::c_signature ||
+                recordHeader.m_sequence != sequence ||
+                recordHeader.m_bucketCount > c_maxBuckets ||
+                recordHeader.m_size != sizeof recordHeader + sizeof(ctsCheckpointTotals) + recordHeader.m_bucketCount * sizeof(ctsCheckpointBucket))
+            {
+                break;
+            }
+
+            record.resize(recordHeader.m_size - sizeof recordHeader);
+            THROW_IF_WIN32_BOOL_FALSE_MSG(
+                ReadFile(checkpointFile.get(), record.data(), static_cast<DWORD>(record.size()), &bytesRead, nullptr),
+                "ReadFile(%ws)", fileName);
+            if (bytesRead != record.size() ||
+                ctsCheckpointChecksum(record.data(), record.size()) != recordHeader.m_checksum)
+            {
+                break;
+            }
+
+            latestRecord.swap(record);
+            latestSequence = sequence;
+        }
+        if (latestRecord.empty())
+        {
+            throw std::invalid_argument("-RebuildSummary found no complete checkpoint in the file");
+        }
+
+        ctsCheckpointTotals totals{};
+        memcpy(&totals, latestRecord.data(), sizeof totals);
+
+        // indexed by ctsCheckpointHistogram - 1
+        std::vector<ctsLatencySnapshot> histograms(c_histogramCount);
+        const auto bucketCount = (latestRecord.size() - sizeof totals) / sizeof(ctsCheckpointBucket);
+        for (size_t index = 0; index < bucketCount; ++index)
+        {
+            ctsCheckpointBucket bucket{};
+            memcpy(&bucket, latestRecord.data() + sizeof totals + index * sizeof bucket, sizeof bucket);
+            const auto histogram = static_cast<unsigned long>(bucket.m_histogram);
+            if (histogram < 1 || histogram > c_histogramCount || bucket.m_bucket >= ctsLatencySnapshot::c_bucketCount)
+            {
+                throw std::invalid_argument("-RebuildSummary was given a checkpoint with an unknown histogram bucket");
+            }
+            histograms[histogram - 1].m_counts[bucket.m_bucket] = bucket.m_count;
+        }
+
+        wprintf(
+            L"\n"
+            L"  Rebuilt from checkpoint %llu of %ws (written %lld ms into the run by process %lu)\n",
+            latestSequence + 1,
+            fileName,
+            totals.m_elapsedMilliseconds,
+            header.m_processId);
+        wprintf(
+            L"\n\n"
+            L"  Historic Connection Statistics (all connections over the complete lifetime)  \n"
+            L"-------------------------------------------------------------------------------\n"
+            L"  SuccessfulConnections [%lld]   NetworkErrors [%lld]   ProtocolErrors [%lld]\n"
+            L"  ActiveConnections [%lld]   PeakActiveConnections [%lld]\n",
+            totals.m_successfulConnections,
+            totals.m_connectionErrors,
+            totals.m_protocolErrors,
+            totals.m_activeConnections,
+            totals.m_peakActiveConnections);
+
+        if (IPPROTO_TCP == header.m_protocol)
+        {
+            wprintf(
+                L"\n"
+                L"  Total Bytes Recv : %lld\n"
+                L"  Total Bytes Sent : %lld\n",
+                totals.m_bytesReceived,
+                totals.m_bytesSent);
+            if (totals.m_transactions > 0)
+            {
+                wprintf(L"  Total Transactions : %lld\n", totals.m_transactions);
+            }
+
+            static constexpr PCWSTR c_histogramNames[c_histogramCount]{ L"IO", L"Connection", L"First Byte", L"Transaction", L"Probe" };
+            static constexpr double c_percentiles[]{ 50.0, 90.0, 99.0, 99.9 };
+            for (unsigned long histogram = 0; histogram < c_histogramCount; ++histogram)
+            {
+                const auto& latencyData = histograms[histogram];
+                if (0 == latencyData.GetCount())
+                {
+                    continue;
+                }
+
+                // the buckets count QPC ticks of the process which wrote them
+                std::wstring percentileString;
+                for (const auto percentile : c_percentiles)
+                {
+                    percentileString.append(
+                        wil::str_printf<std::wstring>(
+                            L"p%g [%lld]  ",
+                            percentile,
+                            ConvertTicksToMicroseconds(latencyData.GetPercentile(percentile), header.m_qpf)));
+                }
+                wprintf(
+                    L"  %ws Latency (us) : Min [%lld]  %wsMax [%lld]  (%lld samples)\n",
+                    c_histogramNames[histogram],
+                    ConvertTicksToMicroseconds(latencyData.GetPercentile(0.0), header.m_qpf),
+                    percentileString.c_str(),
+                    ConvertTicksToMicroseconds(latencyData.GetMaximum(), header.m_qpf),
+                    latencyData.GetCount());
+            }
+        }
+        else if (!header.m_listening)
+        {
+            const auto totalFrames =
+                totals.m_successfulFrames +
+                totals.m_droppedFrames +
+                totals.m_duplicateFrames +
+                totals.m_errorFrames;
+            const auto framePercent = [totalFrames](long long frames) noexcept {
+                return totalFrames > 0 ? static_cast<double>(frames) / static_cast<double>(totalFrames) * 100.0 : 0.0;
+            };
+            wprintf(
+                L"\n"
+                L"  Total Bytes Recv : %lld\n"
+                L"  Total Successful Frames : %lld (%f)\n"
+                L"  Total Dropped Frames : %lld (%f)\n"
+                L"  Total Duplicate Frames : %lld (%f)\n"
+                L"  Total Error Frames : %lld (%f)\n",
+                totals.m_bitsReceived / 8LL,
+                totals.m_successfulFrames,
+                framePercent(totals.m_successfulFrames),
+                totals.m_droppedFrames,
+                framePercent(totals.m_droppedFrames),
+                totals.m_duplicateFrames,
+                framePercent(totals.m_duplicateFrames),
+                totals.m_errorFrames,
+                framePercent(totals.m_errorFrames));
+        }
+        else
+        {
+            wprintf(
+                L"\n"
+                L"  Total Send Calls : %lld\n"
+                L"  Total Sends Pended (send buffer full) : %lld (%f)\n",
+                totals.m_sendCalls,
+                totals.m_pendedSends,
+                totals.m_sendCalls > 0 ? static_cast<double>(totals.m_pendedSends) / static_cast<double>(totals.m_sendCalls) * 100.0 : 0.0);
+        }
+
+        wprintf(L"  Total Time : %lld ms.\n", totals.m_elapsedMilliseconds);
+    }
+}
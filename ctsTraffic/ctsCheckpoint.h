@@ -0,0 +1,176 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// cpp headers
+#include <cstddef>
+#include <vector>
+// os headers
+#include <Windows.h>
+
+// ** NOTE ** should not include any local project cts headers - external tools read checkpoint files with this header
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsCheckpoint
+    ///
+    /// The layout of the file written with -CheckpointFilename:<filename>
+    /// - a ctsCheckpointHeader, followed by one record appended every -CheckpointInterval
+    /// - each record is a ctsCheckpointRecordHeader, the ctsCheckpointTotals of the run so far,
+    ///   and m_bucketCount ctsCheckpointBucket entries: only the non-zero buckets of each histogram
+    /// - every record holds the complete totals since the start of the run: the latest valid record is the summary
+    /// - a record is valid when its signature, size, sequence and checksum match:
+    ///   a record torn by a crash or a power loss fails its checksum, and reading stops there
+    /// - histogram buckets count QPC ticks: convert them with the m_qpf of the writer
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    struct ctsCheckpointHeader
+    {
+        static constexpr unsigned long c_signature = 0x4B535443; // "CTSK"
+        static constexpr unsigned long c_version = 1;
+
+        unsigned long m_signature = c_signature;
+        unsigned long m_version = c_version;
+        unsigned long m_headerSize = sizeof(ctsCheckpointHeader);
+        unsigned long m_processId = 0;
+        long long m_qpf = 0;
+        // IPPROTO_TCP or IPPROTO_UDP
+        unsigned long m_protocol = 0;
+        unsigned long m_listening = 0;
+    };
+    static_assert(sizeof(ctsCheckpointHeader) % 8 == 0, "records must follow the header 8-byte aligned");
+
+    struct ctsCheckpointRecordHeader
+    {
+        static constexpr unsigned long c_signature = 0x52535443; // "CTSR"
+
+        unsigned long m_signature;
+        // the bytes of the record, including this header
+        unsigned long m_size;
+        // 0 for the first record, incremented for each record which follows
+        unsigned long long m_sequence;
+        // ctsCheckpointChecksum of the m_size - sizeof(ctsCheckpointRecordHeader) bytes after this header
+        unsigned long long m_checksum;
+        unsigned long m_bucketCount;
+        unsigned long m_reserved;
+    };
+    static_assert(sizeof(ctsCheckpointRecordHeader) % 8 == 0, "the totals must follow the record header 8-byte aligned");
+
+    struct ctsCheckpointTotals
+    {
+        // milliseconds since the run started
+        long long m_elapsedMilliseconds;
+
+        long long m_activeConnections;
+        long long m_peakActiveConnections;
+        long long m_successfulConnections;
+        long long m_connectionErrors;
+        long long m_protocolErrors;
+
+        // TCP
+        long long m_bytesSent;
+        long long m_bytesReceived;
+        long long m_transactions;
+
+        // UDP (MediaStream clients)
+        long long m_bitsReceived;
+        long long m_successfulFrames;
+        long long m_droppedFrames;
+        long long m_duplicateFrames;
+        long long m_errorFrames;
+        // UDP (MediaStream servers)
+        long long m_sendCalls;
+        long long m_pendedSends;
+    };
+
+    enum class ctsCheckpointHistogram : unsigned short
+    {
+        Io = 1,
+        Connection,
+        FirstByte,
+        Transaction,
+        Probe
+    };
+
+    struct ctsCheckpointBucket
+    {
+        ctsCheckpointHistogram m_histogram;
+        // the index of the log-linear bucket (see ctsLatencySnapshot)
+        unsigned short m_bucket;
+        unsigned long m_reserved;
+        long long m_count;
+    };
+    static_assert(sizeof(ctsCheckpointBucket) == 16, "the bucket layout is part of the file format");
+
+    // FNV-1a : cheap enough to compute over every record, and catches the zeroed or stale pages of a torn write
+    inline unsigned long long ctsCheckpointChecksum(_In_reads_bytes_(byteCount) const void* bytes, size_t byteCount) noexcept
+    {
+        unsigned long long checksum = 0xcbf29ce484222325ull;
+        const auto* const data = static_cast<const unsigned char*>(bytes);
+        for (size_t index = 0; index < byteCount; ++index)
+        {
+            checksum ^= data[index];
+            checksum *= 0x100000001b3ull;
+        }
+        return checksum;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsCheckpointWriter
+    ///
+    /// Creates the checkpoint file and appends the ctsConfigSettings totals and histograms to it with each Update
+    /// - throws if the file cannot be created
+    /// - records are written through a mapped view, then only their pages are flushed to disk
+    /// - the file is grown in c_growSize steps and truncated to the records written when closed
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsCheckpointWriter
+    {
+    public:
+        explicit ctsCheckpointWriter(_In_z_ PCWSTR fileName);
+        ~ctsCheckpointWriter() noexcept;
+
+        // called from the status timer; must not be called concurrently
+        void Update() noexcept;
+
+        ctsCheckpointWriter(const ctsCheckpointWriter&) = delete;
+        ctsCheckpointWriter& operator=(const ctsCheckpointWriter&) = delete;
+        ctsCheckpointWriter(ctsCheckpointWriter&&) = delete;
+        ctsCheckpointWriter& operator=(ctsCheckpointWriter&&) = delete;
+
+    private:
+        static constexpr unsigned long long c_growSize = 0x400000; // 4MB
+
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+        char* m_view = nullptr;
+        unsigned long long m_capacity = 0;
+        unsigned long long m_written = sizeof(ctsCheckpointHeader);
+        unsigned long long m_sequence = 0;
+        // once the file could not be grown no further records are written : the records already written stay valid
+        bool m_failed = false;
+        // reserved for every bucket of every histogram, so Update never allocates
+        std::vector<ctsCheckpointBucket> m_buckets;
+
+        bool Map(unsigned long long capacity) noexcept;
+    };
+
+    // prints the summary of the run from the latest valid record of a checkpoint file
+    // - can throw wil::ResultException, std::invalid_argument, or std::bad_alloc
+    void ctsRebuildSummary(_In_ PCWSTR fileName);
+}
@@ -17,11 +17,16 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <optional>
 // os headers
 #include <Windows.h>
 #include <WinSock2.h>
 #include <mstcpip.h>
 #include <iphlpapi.h>
+#include <Psapi.h>
 // multimedia timer
 #include <mmsystem.h>
 // wil headers
@@ -33,17 +38,25 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <ctNetAdapterAddresses.hpp>
 #include <ctSocketExtensions.hpp>
 #include <ctTimer.hpp>
+#include <ctMemoryGuard.hpp>
+#include <ctThreadIocp.hpp>
 #include <ctRandom.hpp>
 #include <ctWmiInitialize.hpp>
+#include <ctNetAdapterSettings.hpp>
 // project headers
 #include "ctsConfig.h"
 #include "ctsLogger.hpp"
+#include "ctsBinaryLog.h"
+#include "ctsTraceLogging.h"
+#include "ctsThreadStatistics.h"
+#include "ctsHostCounters.h"
 #include "ctsIOPattern.h"
 #include "ctsPrintStatus.hpp"
 // project functors
 #include "ctsTCPFunctions.h"
 #include "ctsMediaStreamClient.h"
 #include "ctsMediaStreamServer.h"
+#include "ctsMediaStreamProtocol.hpp"
 
 using namespace std;
 using namespace ctl;
@@ -56,6 +69,7 @@ namespace ctsTraffic::ctsConfig
     ///
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     ctsConfigSettings* g_configSettings;
+    ctsFrozenSettings g_frozenSettings;
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     ///
@@ -74,14 +88,41 @@ namespace ctsTraffic::ctsConfig
     constexpr unsigned long c_defaultBufferSize = 0x10000; // 64kbyte
     constexpr unsigned long c_defaultAcceptLimit = 10;
     constexpr unsigned long c_defaultAcceptExLimit = 100;
+    constexpr unsigned long c_defaultPrePostAcceptsLow = 100;
+    constexpr unsigned long c_defaultPrePostAcceptsHigh = 1000;
     constexpr unsigned long c_defaultTcpConnectionLimit = 8;
     constexpr unsigned long c_defaultUdpConnectionLimit = 1;
+    // -Pattern:Blast : clients default to this many sockets per processor
+    constexpr unsigned long c_defaultBlastConnectionsPerProcessor = 2;
+    // -Pattern:Blast : the default datagram fits a 1500 byte MTU behind either an IPv4 or an IPv6 and UDP header
+    constexpr unsigned long c_defaultBlastDatagramSize = 1400;
+    // -Pattern:Blast : the default sends each stream keeps in flight
+    constexpr unsigned long c_defaultBlastPrePostSends = 64;
+    // -Probes : the default milliseconds each probe connection waits after an echo before its next ping
+    constexpr unsigned long c_defaultProbeIntervalMilliseconds = 100;
+    // -CheckpointFilename : the default milliseconds between the checkpoints appended to the file
+    constexpr unsigned long c_defaultCheckpointIntervalMilliseconds = 60000;
+    // -CheckpointInterval : every checkpoint is flushed to disk, so they are kept at least a second apart
+    constexpr unsigned long c_minimumCheckpointIntervalMilliseconds = 1000;
+    // -Sweep : the default milliseconds each point of the grid is measured for
+    constexpr unsigned long c_defaultSweepStepMilliseconds = 5000;
     constexpr unsigned long c_defaultConnectionThrottleLimit = 1000;
     constexpr unsigned long c_defaultThreadpoolFactor = 2;
 
     static PTP_POOL g_threadPool = nullptr;
     static TP_CALLBACK_ENVIRON g_threadPoolEnvironment;
     static unsigned long g_threadPoolThreadCount = 0;
+    // with -NumaThreadpools:on, socket IO completes on a threadpool (indexed by node number)
+    // whose threads are affinitized to the processors of that NUMA node
+    struct ctsNumaThreadpool
+    {
+        PTP_POOL m_threadPool = nullptr;
+        TP_CALLBACK_ENVIRON m_environment{};
+    };
+    static vector<ctsNumaThreadpool> g_numaThreadpools;
+    // with -CompletionEngine:dedicated, socket IO completes on dedicated threads draining their own completion ports
+    // - like the threadpools, the engine remains for the lifetime of the process
+    static ctThreadIocpEngine* g_completionEngine = nullptr;
 
     static const wchar_t* g_createFunctionName = nullptr;
     static const wchar_t* g_connectFunctionName = nullptr;
@@ -99,6 +140,11 @@ namespace ctsTraffic::ctsConfig
 
     constexpr unsigned long c_defaultPushBytes = 0x100000;
     constexpr unsigned long c_defaultPullBytes = 0x100000;
+    constexpr unsigned long c_defaultRequestBytes = 64;
+    constexpr unsigned long c_defaultResponseBytes = 64;
+    constexpr unsigned long c_defaultPipelineDepth = 1;
+    constexpr unsigned long c_defaultHeartbeatBytes = 16;
+    constexpr unsigned long c_defaultHeartbeatIntervalMilliseconds = 1000;
 
     static ctsUnsignedLong g_timePeriodRefCount{};
 
@@ -109,7 +155,8 @@ namespace ctsTraffic::ctsConfig
     static ctNetAdapterAddresses* g_netAdapterAddresses = nullptr;
 
     static MediaStreamSettings g_mediaStreamSettings;
-    static ctRandomTwister g_randomTwister;
+    // thread-local so building tasks on every thread neither contends on (nor races) a shared generator
+    static thread_local ctRandomFast t_randomGenerator;
 
     // default to 5 seconds
     constexpr unsigned long c_defaultStatusUpdateFrequency = 5000;
@@ -118,10 +165,218 @@ namespace ctsTraffic::ctsConfig
     static shared_ptr<ctsLogger> g_statusLogger;
     static shared_ptr<ctsLogger> g_errorLogger;
     static shared_ptr<ctsLogger> g_jitterLogger;
+    static shared_ptr<ctsLogger> g_jitterSummaryLogger;
+    static shared_ptr<ctsLogger> g_histogramLogger;
+    // set instead of the connection and jitter loggers when given a .ctsb filename
+    static unique_ptr<ctsBinaryLogger> g_binaryConnectionLogger;
+    static unique_ptr<ctsBinaryLogger> g_binaryJitterLogger;
+    // -HostCounters : sampled by PrintStatusUpdate under the g_statusUpdateLock
+    static unique_ptr<ctsHostCounters> g_hostCounters;
 
     static bool g_breakOnError = false;
     static bool g_shutdownCalled = false;
 
+    // the totals at the -WarmUp and -CoolDown boundaries
+    // - each is written once from the status timer, and only read by the summary after the timer is stopped
+    struct SteadyStateSnapshot
+    {
+        bool m_taken = false;
+        long long m_timeMilliseconds = 0;
+        long long m_bytesSent = 0;
+        long long m_bytesRecv = 0;
+        long long m_transactions = 0;
+        long long m_successfulFrames = 0;
+        long long m_droppedFrames = 0;
+        long long m_successfulConnections = 0;
+        long long m_connectionErrors = 0;
+        long long m_protocolErrors = 0;
+        ctsLatencySnapshot m_ioLatency;
+        ctsLatencySnapshot m_transactionLatency;
+    };
+    static SteadyStateSnapshot g_steadyStateStart;
+    static SteadyStateSnapshot g_steadyStateEnd;
+
+    // -ConnectionLogSamples : a connection from the interval, kept to be written in full with the interval's outcomes
+    struct ConnectionAggregateSample
+    {
+        float m_timeSlice;
+        ctSockaddr m_localAddr;
+        ctSockaddr m_remoteAddr;
+        unsigned long m_error;
+        // neither is set for connections which failed before being given addresses
+        optional<ctsTcpStatistics> m_tcpStatistics;
+        optional<ctsUdpStatistics> m_udpStatistics;
+
+        ConnectionAggregateSample(float timeSlice, unsigned long error) noexcept :
+            m_timeSlice(timeSlice), m_error(error)
+        {
+        }
+        ConnectionAggregateSample(float timeSlice, const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsTcpStatistics& stats) noexcept :
+            m_timeSlice(timeSlice), m_localAddr(localAddr), m_remoteAddr(remoteAddr), m_error(error), m_tcpStatistics(stats)
+        {
+        }
+        ConnectionAggregateSample(float timeSlice, const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsUdpStatistics& stats) noexcept :
+            m_timeSlice(timeSlice), m_localAddr(localAddr), m_remoteAddr(remoteAddr), m_error(error), m_udpStatistics(stats)
+        {
+        }
+    };
+
+    // -ConnectionLog:aggregate : the connection outcomes since the last status update
+    // - connections only count themselves in under g_connectionAggregateLock, all formatting is left to the status update
+    struct ConnectionAggregate
+    {
+        // log2 buckets : bucket 0 counts zero, bucket N counts [2^(N-1), 2^N)
+        static constexpr size_t c_bucketCount = 64;
+
+        long long m_established = 0;
+        long long m_completed = 0;
+        long long m_succeeded = 0;
+        long long m_networkErrors = 0;
+        long long m_protocolErrors = 0;
+        map<unsigned long, long long> m_errors;
+        array<long long, c_bucketCount> m_timeMsBuckets{};
+        array<long long, c_bucketCount> m_bytesBuckets{};
+        // a uniform reservoir sample of the completed connections : each is kept with the same probability
+        vector<unique_ptr<ConnectionAggregateSample>> m_samples;
+
+        static size_t BucketIndex(long long value) noexcept
+        {
+            if (value <= 0)
+            {
+                return 0;
+            }
+            // _BitScanReverse64 is not available to 32-bit builds
+            const auto unsignedValue = static_cast<unsigned long long>(value);
+            unsigned long magnitude;
+            const auto highBits = static_cast<unsigned long>(unsignedValue >> 32);
+            if (highBits != 0)
+            {
+                _BitScanReverse(&magnitude, highBits);
+                magnitude += 32;
+            }
+            else
+            {
+                _BitScanReverse(&magnitude, static_cast<unsigned long>(unsignedValue));
+            }
+            return magnitude + 1;
+        }
+
+        // the highest value counted in the bucket
+        static unsigned long long BucketUpperBound(size_t bucket) noexcept
+        {
+            return 0 == bucket ? 0ULL : (1ULL << bucket) - 1;
+        }
+    };
+    static wil::critical_section g_connectionAggregateLock{ ctsConfigSettings::c_CriticalSectionSpinlock };
+    static ConnectionAggregate g_connectionAggregate;
+
+    // -RateSearch : a binary search over the -RateLimit range for the highest rate sustained without errors
+    // - each step runs for RateSearchStepMilliseconds, split into c_rateSearchTicksPerStep status timer ticks:
+    //   the first tick lets connections settle at the new rate, the remaining ticks are measured
+    // - a step is stable when no connection failed, the connections sent at least c_rateSearchMinimumAchievedRatio
+    //   of the rate they were given, and (with -LatencyPercentiles) the highest percentile stayed within
+    //   c_rateSearchMaxLatencyRatio of the lowest seen at a stable rate
+    // - every connection reads g_rateSearchBytesPerSecond as its rate limit : all other state is only accessed
+    //   from the status timer, and read by the summary after the timer is stopped
+    constexpr unsigned long c_rateSearchTicksPerStep = 4UL;
+    constexpr unsigned long c_rateSearchMaxSteps = 16UL;
+    constexpr double c_rateSearchResolution = 0.02;
+    constexpr double c_rateSearchMinimumAchievedRatio = 0.95;
+    constexpr double c_rateSearchMaxLatencyRatio = 2.0;
+    static long long g_rateSearchBytesPerSecond = 0LL;
+    static long long g_rateSearchStableRate = 0LL;
+    static long long g_rateSearchUnstableRate = 0LL;
+    static double g_rateSearchStableThroughput = 0.0;
+    static long long g_rateSearchLowestLatency = 0LL;
+    static unsigned long g_rateSearchSteps = 0UL;
+    static unsigned long g_rateSearchTicks = 0UL;
+    static bool g_rateSearchComplete = false;
+    static SteadyStateSnapshot g_rateSearchStepStart;
+
+    // -Sweep : each point of a grid of -Buffer, -PrePostRecvs, -PrePostSends, -RecvBufValue and -SendBufValue values
+    // is measured in turn, for SweepStepMilliseconds split into c_sweepTicksPerStep status timer ticks like -RateSearch
+    // - the buffer size is read by every IO, so a new -Buffer applies to the established connections at once
+    // - the other values are read as a connection is created : a point changing them is only measured once the
+    //   connections of the prior points were replaced (each completed its -Transfer), waiting up to c_sweepMaxWaitSteps steps
+    // - -Buffer is the innermost axis of the grid, so most points change only the buffer size
+    // - the best point had no failed connections and came within c_sweepThroughputTolerance of the highest throughput,
+    //   at the fewest CPU cycles per byte
+    // - every IO reads g_sweepBufferSize and every new connection reads SweepPoint before the values of that point :
+    //   all other state is only accessed from the status timer, and read by the summary after the timer is stopped
+    enum class SweepParameter
+    {
+        Buffer,
+        PrePostRecvs,
+        PrePostSends,
+        RecvBufValue,
+        SendBufValue
+    };
+    struct SweepAxis
+    {
+        SweepParameter m_parameter = SweepParameter::Buffer;
+        vector<unsigned long> m_values;
+    };
+    struct SweepPointResult
+    {
+        // the value of each axis, in the order of g_sweepAxes
+        vector<unsigned long> m_values;
+        double m_bytesPerSecond = 0.0;
+        double m_cyclesPerByte = 0.0;
+        long long m_errors = 0;
+        bool m_measured = false;
+        bool m_skipped = false;
+    };
+    constexpr unsigned long c_sweepTicksPerStep = 4UL;
+    constexpr unsigned long c_sweepMaxWaitSteps = 8UL;
+    constexpr size_t c_sweepMaxPoints = 256;
+    constexpr double c_sweepThroughputTolerance = 0.02;
+    static vector<SweepAxis> g_sweepAxes;
+    static vector<SweepPointResult> g_sweepPoints;
+    static long g_sweepBufferSize = 0;
+    static size_t g_sweepCurrentPoint = 0;
+    static unsigned long g_sweepTicks = 0UL;
+    static unsigned long g_sweepWaitTicks = 0UL;
+    static bool g_sweepComplete = false;
+    static SteadyStateSnapshot g_sweepStepStart;
+    static ctsCpuSnapshot g_sweepStepStartCpu;
+
+    // the number of addresses each -Target resolved to, in the order given : -TargetWeights are given per -Target
+    static vector<size_t> g_targetAddressCounts;
+
+    // -LoadProfile : each segment holds the connection target and the rate limit for its duration
+    // - a value is constant, ramps linearly from m_from to m_to across the segment,
+    //   or alternates between m_from and m_to every half of m_periodMilliseconds
+    struct LoadProfileValue
+    {
+        long long m_from = 0;
+        long long m_to = 0;
+        long long m_periodMilliseconds = 0;
+        bool m_ramp = false;
+    };
+    struct LoadProfileSegment
+    {
+        long long m_durationMilliseconds = 0;
+        LoadProfileValue m_connections;
+        LoadProfileValue m_bytesPerSecond;
+    };
+    static vector<LoadProfileSegment> g_loadProfile;
+    static long long g_loadProfileDurationMilliseconds = 0LL;
+    // the setpoint last published from the ctsSocketBroker timer : every connection reads the rate before each send
+    static long long g_loadProfileConnections = 0LL;
+    static long long g_loadProfileBytesPerSecond = 0LL;
+
+    // -Converge : the run stops once the throughput (and, with -LatencyPercentiles, the latency) of the last
+    // ConvergenceWindow status intervals is known to within ConvergenceTolerancePercent at 95% confidence
+    // - the interval samples are only accessed from the status timer, and read by the summary after the timer is stopped
+    static vector<double> g_convergenceThroughput;
+    static vector<double> g_convergenceLatency;
+    static SteadyStateSnapshot g_convergencePrior;
+    static long long g_convergedMilliseconds = 0LL;
+    static double g_convergedThroughput = 0.0;
+    static double g_convergedThroughputHalfWidth = 0.0;
+    static double g_convergedLatency = 0.0;
+    static double g_convergedLatencyHalfWidth = 0.0;
+
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///
@@ -149,6 +404,8 @@ namespace ctsTraffic::ctsConfig
         g_previousPrintTimeslice = 0LL;
         g_printTimesliceCount = 0LL;
 
+        ctsTraceLoggingRegister();
+
         return TRUE;
     }
     static void ctsConfigInitOnce() noexcept
@@ -195,6 +452,95 @@ namespace ctsTraffic::ctsConfig
         PRINT_DEBUG_INFO(L"Not using SO_REUSE_UNICASTPORT as AutoReusePortRangeNumberOfPorts is not supported or not configured");
     }
 
+    // -HostConfiguration : written with the settings so results can be compared across hosts
+    static wstring g_hostConfiguration;
+    static vector<wstring> g_hostConfigurationWarnings;
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// records the RSS, offload and driver settings of the adapters in use, and the power plan
+    /// - must be called once the addresses have been parsed
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void CaptureHostConfiguration() noexcept
+        try
+    {
+        const ctNetAdapterAddresses adapterAddresses;
+        vector<wstring> interfaceDescriptions;
+        const auto addInterface = [&](const IP_ADAPTER_ADDRESSES& adapter) {
+            if (find(begin(interfaceDescriptions), end(interfaceDescriptions), adapter.Description) == end(interfaceDescriptions))
+            {
+                interfaceDescriptions.emplace_back(adapter.Description);
+            }
+        };
+
+        // the adapters routing to the targets, and those holding the bound or listening addresses
+        for (const auto& targetAddress : g_configSettings->TargetAddresses)
+        {
+            NET_IFINDEX interfaceIndex{};
+            if (NO_ERROR == GetBestInterfaceEx(targetAddress.sockaddr(), &interfaceIndex))
+            {
+                const auto foundInterface = find_if(adapterAddresses.begin(), adapterAddresses.end(), [interfaceIndex](const IP_ADAPTER_ADDRESSES& adapter) {
+                    return adapter.IfIndex == interfaceIndex || adapter.Ipv6IfIndex == interfaceIndex;
+                });
+                if (foundInterface != adapterAddresses.end())
+                {
+                    addInterface(*foundInterface);
+                }
+            }
+        }
+        for (const auto* addresses : { &g_configSettings->BindAddresses, &g_configSettings->ListenAddresses })
+        {
+            for (const auto& address : *addresses)
+            {
+                const auto foundInterface = find_if(adapterAddresses.begin(), adapterAddresses.end(), ctNetAdapterMatchingAddrPredicate(address));
+                if (foundInterface != adapterAddresses.end())
+                {
+                    addInterface(*foundInterface);
+                }
+            }
+        }
+        // the wildcard address (or a target only reached over loopback) could use any adapter which is up
+        if (interfaceDescriptions.empty())
+        {
+            for (const auto& adapter : adapterAddresses)
+            {
+                if (IfOperStatusUp == adapter.OperStatus && adapter.IfType != IF_TYPE_SOFTWARE_LOOPBACK)
+                {
+                    addInterface(adapter);
+                }
+            }
+        }
+
+        const auto com = wil::CoInitializeEx();
+        const ctWmiService wmiService(L"ROOT\\StandardCimv2");
+        for (const auto& interfaceDescription : interfaceDescriptions)
+        {
+            const auto adapterSettings = ctReadNetAdapterSettings(wmiService, interfaceDescription);
+            g_hostConfiguration.append(adapterSettings.format(L"\t"));
+            for (const auto& warning : adapterSettings.find_limiting_settings())
+            {
+                g_hostConfigurationWarnings.emplace_back(interfaceDescription + L" : " + warning);
+            }
+        }
+
+        const auto powerPlan = ctReadActivePowerPlan();
+        if (!powerPlan.m_name.empty())
+        {
+            g_hostConfiguration.append(wil::str_printf<std::wstring>(L"\tPower plan: %ws\n", powerPlan.m_name.c_str()));
+            if (!powerPlan.m_isHighPerformance)
+            {
+                g_hostConfigurationWarnings.emplace_back(
+                    L"the power plan is not High performance : processors can be parked or run below their rated frequency");
+            }
+        }
+    }
+    catch (...)
+    {
+        // the host configuration is informational, the run continues without it
+        PRINT_DEBUG_INFO(L"The host configuration could not be read");
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
     /// parses the input argument to determine if it matches the expected parameter
@@ -446,6 +792,16 @@ namespace ctsTraffic::ctsConfig
         {
             throw invalid_argument("-conn (MediaStream has its own internal connection handler)");
         }
+
+        if (g_configSettings->MemoryTransport)
+        {
+            if (connectSpecifed)
+            {
+                throw invalid_argument("-conn (-io:memory has its own in-process connection handler)");
+            }
+            g_configSettings->ConnectFunction = ctsMemoryConnect;
+            g_connectFunctionName = L"Memory (in-process)";
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////
@@ -509,787 +865,735 @@ namespace ctsTraffic::ctsConfig
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the IO (read/write) function to use
-    /// -- only applicable to TCP
+    /// Parses for whether the connection ID is exchanged within connection establishment
+    /// -- only applicable to TCP with -conn:ConnectEx (clients) and -acc:AcceptEx (servers)
     ///
-    /// -io:blocking
-    /// -io:nonblocking
-    /// -io:event
-    /// -io:iocp (*default)
-    /// -io:wsapoll
-    /// -io:rioiocp
+    /// -ConnectData:on
+    /// -ConnectData:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForIoFunction(vector<const wchar_t*>& args)
+    static void ParseForConnectData(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-io");
+            const auto* const value = ParseArgument(parameter, L"-ConnectData");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (g_configSettings->Protocol != ProtocolType::TCP)
-            {
-                throw invalid_argument("-io (only applicable to TCP)");
-            }
-
-            const auto* const value = ParseArgument(*foundArgument, L"-io");
-            if (ctString::ctOrdinalEqualsCaseInsensative(L"iocp", value))
-            {
-                g_configSettings->IoFunction = ctsSendRecvIocp;
-                g_configSettings->Options |= HandleInlineIocp;
-                g_ioFunctionName = L"Iocp (WSASend/WSARecv using IOCP)";
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"readwritefile", value))
-            {
-                g_configSettings->IoFunction = ctsReadWriteIocp;
-                g_ioFunctionName = L"ReadWriteFile (ReadFile/WriteFile using IOCP)";
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"rioiocp", value))
+            const auto* const value = ParseArgument(*foundArgument, L"-ConnectData");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                g_configSettings->IoFunction = ctsRioIocp;
-                WI_SetFlag(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO);
-                g_ioFunctionName = L"RioIocp (RIO using IOCP notifications)";
+                if (g_configSettings->Protocol != ProtocolType::TCP)
+                {
+                    throw invalid_argument("-ConnectData (only applicable to TCP)");
+                }
+                if (IsListening() ? g_configSettings->AcceptFunction != ctsAcceptEx : g_configSettings->ConnectFunction != ctsConnectEx)
+                {
+                    throw invalid_argument("-ConnectData (requires -conn:ConnectEx for clients and -acc:AcceptEx for servers)");
+                }
+                g_configSettings->ExchangeConnectionIdOnConnect = true;
             }
-            else
+            else if (!ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
             {
-                throw invalid_argument("-io");
+                throw invalid_argument("-ConnectData");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
-
         }
-        else
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for whether closed sockets are recycled with DisconnectEx(TF_REUSE_SOCKET)
+    /// -- only applicable to TCP with -conn:ConnectEx (clients) and -acc:AcceptEx (servers)
+    ///
+    /// -SocketReuse:on
+    /// -SocketReuse:off (*default)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForSocketReuse(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-SocketReuse");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
         {
-            if (ProtocolType::TCP == g_configSettings->Protocol)
-            {
-                // Default for TCP is WSASend/WSARecv using IOCP
-                g_configSettings->IoFunction = ctsSendRecvIocp;
-                g_configSettings->Options |= HandleInlineIocp;
-                g_ioFunctionName = L"Iocp (WSASend/WSARecv using IOCP)";
-            }
-            else
+            const auto* const value = ParseArgument(*foundArgument, L"-SocketReuse");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                if (IsListening())
+                if (g_configSettings->Protocol != ProtocolType::TCP || g_configSettings->MemoryTransport)
                 {
-                    g_configSettings->IoFunction = ctsMediaStreamServerIo;
-                    // server also has a closing function to remove the closed socket
-                    g_configSettings->ClosingFunction = ctsMediaStreamServerClose;
-                    g_ioFunctionName = L"MediaStream Server";
+                    throw invalid_argument("-SocketReuse (only applicable to TCP sockets)");
                 }
-                else
+                if (IsListening() ? g_configSettings->AcceptFunction != ctsAcceptEx : g_configSettings->ConnectFunction != ctsConnectEx)
                 {
-                    constexpr int udpRecvBuff = 1048576;
-                    g_configSettings->IoFunction = ctsMediaStreamClient;
-                    g_configSettings->Options |= SetRecvBuf;
-                    g_configSettings->RecvBufValue = udpRecvBuff;
-                    g_configSettings->Options |= HandleInlineIocp;
-                    g_configSettings->Options |= EnableCircularQueueing;
-                    g_ioFunctionName = L"MediaStream Client";
+                    throw invalid_argument("-SocketReuse (requires -conn:ConnectEx for clients and -acc:AcceptEx for servers)");
+                }
+                if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+                {
+                    throw invalid_argument("-SocketReuse (not supported with -io:rioiocp or -io:riopoll)");
+                }
+                if (g_configSettings->LocalPortLow != 0 || g_configSettings->PortReservationSize > 0)
+                {
+                    // a recycled socket stays bound to its port
+                    throw invalid_argument("-SocketReuse (not supported with -LocalPort or -PortReservation)");
                 }
+                g_configSettings->ReuseSockets = true;
+            }
+            else if (!ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                throw invalid_argument("-SocketReuse");
             }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
         }
     }
+
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the InlineCompletions setting to use
+    /// Parses for whether client sockets are created and bound before the run starts
+    /// -- only applicable to TCP clients using ephemeral ports
     ///
-    /// -InlineCompletions:on
-    /// -InlineCompletions:off
+    /// -PrecreateSockets:on
+    /// -PrecreateSockets:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForInlineCompletions(vector<const wchar_t*>& args)
+    static void ParseForPrecreateSockets(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-inlinecompletions");
+            const auto* const value = ParseArgument(parameter, L"-PrecreateSockets");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            const auto* const value = ParseArgument(*foundArgument, L"-inlinecompletions");
+            const auto* const value = ParseArgument(*foundArgument, L"-PrecreateSockets");
             if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                g_configSettings->Options |= HandleInlineIocp;
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
-            {
-                g_configSettings->Options &= ~HandleInlineIocp;
+                if (g_configSettings->Protocol != ProtocolType::TCP || g_configSettings->MemoryTransport)
+                {
+                    throw invalid_argument("-PrecreateSockets (only applicable to TCP sockets)");
+                }
+                if (IsListening() || g_configSettings->CreateFunction != ctsWSASocket)
+                {
+                    throw invalid_argument("-PrecreateSockets (only applicable to clients)");
+                }
+                if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+                {
+                    throw invalid_argument("-PrecreateSockets (not supported with -io:rioiocp or -io:riopoll)");
+                }
+                if (g_configSettings->LocalPortLow != 0 || g_configSettings->PortReservationSize > 0)
+                {
+                    // each connection must be given the next port of the range when it starts
+                    throw invalid_argument("-PrecreateSockets (not supported with -LocalPort or -PortReservation)");
+                }
+                g_configSettings->PrecreateSockets = true;
             }
-            else
+            else if (!ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
             {
-                throw invalid_argument("-inlinecompletions");
+                throw invalid_argument("-PrecreateSockets");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
     }
+
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the MsgWaitAll setting to use
+    /// Parses for the number of back-to-back -Transfer transfers made over each TCP connection
+    /// -- only applicable to -Pattern:Push, Pull, PushPull and Duplex
+    /// -- clients and servers must both be given the same number
     ///
-    /// -MsgWaitAll:on
-    /// -MsgWaitAll:off
+    /// -PersistentTransfers:#### (*default : 1)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForMsgWaitAll(vector<const wchar_t*>& args)
+    static void ParseForPersistentTransfers(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-msgwaitall");
+            const auto* const value = ParseArgument(parameter, L"-PersistentTransfers");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            const auto* const value = ParseArgument(*foundArgument, L"-msgwaitall");
-            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            if (g_configSettings->Protocol != ProtocolType::TCP)
             {
-                g_configSettings->Options |= MsgWaitAll;
+                throw invalid_argument("-PersistentTransfers (only applicable to TCP)");
             }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            if (g_configSettings->IoPattern != IoPatternType::Push &&
+                g_configSettings->IoPattern != IoPatternType::Pull &&
+                g_configSettings->IoPattern != IoPatternType::PushPull &&
+                g_configSettings->IoPattern != IoPatternType::Duplex)
             {
-                g_configSettings->Options &= ~MsgWaitAll;
+                throw invalid_argument("-PersistentTransfers (only applicable to -Pattern:Push, Pull, PushPull or Duplex)");
             }
-            else
+            if (!g_configSettings->RelayAddresses.empty())
             {
-                throw invalid_argument("-msgwaitall");
+                // relayed connections are forwarded without running the IO pattern
+                throw invalid_argument("-PersistentTransfers (not supported with -Relay)");
+            }
+            g_configSettings->PersistentTransfers = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-PersistentTransfers"));
+            if (0 == g_configSettings->PersistentTransfers)
+            {
+                throw invalid_argument("-PersistentTransfers (must be at least 1)");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
-        {
-            // default to enable msgwaitall
-            g_configSettings->Options |= MsgWaitAll;
-        }
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the L4 Protocol to limit to usage
+    /// Parses for the probe connections pinging round trips alongside the bulk connections
+    /// -- only applicable to TCP -Pattern:Push, Pull, PushPull and Duplex
+    /// -- clients keep this many probe connections open : servers also listen on the -ProbePort
     ///
-    /// -Protocol:tcp
-    /// -Protocol:udp
+    /// -Probes:####
+    /// -ProbePort:#### (*default : -Port + 1)
+    /// -ProbeInterval:#### (*default : 100 ms)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForProtocol(vector<const wchar_t*>& args)
+    static void ParseForProbes(vector<const wchar_t*>& args)
     {
-        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-Protocol");
+        const auto foundProbes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-Probes");
             return value != nullptr;
             });
-        if (foundArgument != end(args))
+        if (foundProbes != end(args))
         {
-            const auto* const value = ParseArgument(*foundArgument, L"-Protocol");
-            if (ctString::ctOrdinalEqualsCaseInsensative(L"tcp", value))
+            g_configSettings->ProbeConnections = ConvertToIntegral<unsigned long>(ParseArgument(*foundProbes, L"-Probes"));
+            if (0 == g_configSettings->ProbeConnections)
             {
-                g_configSettings->Protocol = ProtocolType::TCP;
+                throw invalid_argument("-Probes (must be at least 1)");
             }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"udp", value))
+            // always remove the arg from our vector
+            args.erase(foundProbes);
+        }
+
+        const auto foundPort = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ProbePort");
+            return value != nullptr;
+            });
+        if (foundPort != end(args))
+        {
+            if (0 == g_configSettings->ProbeConnections)
             {
-                g_configSettings->Protocol = ProtocolType::UDP;
+                throw invalid_argument("-ProbePort (only applicable with -Probes)");
             }
-            else
+            g_configSettings->ProbePort = ConvertToIntegral<WORD>(ParseArgument(*foundPort, L"-ProbePort"));
+            if (0 == g_configSettings->ProbePort)
             {
-                throw invalid_argument("-Protocol");
+                throw invalid_argument("-ProbePort");
             }
             // always remove the arg from our vector
-            args.erase(foundArgument);
+            args.erase(foundPort);
+        }
+
+        const auto foundInterval = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ProbeInterval");
+            return value != nullptr;
+            });
+        if (foundInterval != end(args))
+        {
+            if (0 == g_configSettings->ProbeConnections)
+            {
+                throw invalid_argument("-ProbeInterval (only applicable with -Probes)");
+            }
+            if (IsListening())
+            {
+                throw invalid_argument("-ProbeInterval (only applicable to clients : servers echo each ping as it arrives)");
+            }
+            g_configSettings->ProbeIntervalMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundInterval, L"-ProbeInterval"));
+            // always remove the arg from our vector
+            args.erase(foundInterval);
         }
         else
         {
-            // default to TCP
-            g_configSettings->Protocol = ProtocolType::TCP;
+            g_configSettings->ProbeIntervalMilliseconds = c_defaultProbeIntervalMilliseconds;
         }
-    }
 
-    //////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    /// Parses for socket Options
-    /// - allows for more than one option to be set
-    /// -Options:<keepalive,tcpfastpath [-Options:<...>] [-Options:<...>]
-    ///
-    //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForOptions(vector<const wchar_t*>& args)
-    {
-        for (;;)
+        if (0 == g_configSettings->ProbeConnections)
         {
-            // loop until cannot fine -Options
-            const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-                const auto* const value = ParseArgument(parameter, L"-Options");
-                return value != nullptr;
-                });
+            return;
+        }
 
-            if (foundArgument != end(args))
-            {
-                const auto* const value = ParseArgument(*foundArgument, L"-Options");
-                if (ctString::ctOrdinalEqualsCaseInsensative(L"keepalive", value))
-                {
-                    if (ProtocolType::TCP == g_configSettings->Protocol)
-                    {
-                        g_configSettings->Options |= Keepalive;
-                    }
-                    else
-                    {
-                        throw invalid_argument("-Options (keepalive only allowed with TCP sockets)");
-                    }
-                }
-                else if (ctString::ctOrdinalEqualsCaseInsensative(L"tcpfastpath", value))
-                {
-                    if (ProtocolType::TCP == g_configSettings->Protocol)
-                    {
-                        g_configSettings->Options |= LoopbackFastPath;
-                    }
-                    else
-                    {
-                        throw invalid_argument("-Options (tcpfastpath only allowed with TCP sockets)");
-                    }
-                }
-                else
-                {
-                    throw invalid_argument("-Options");
-                }
+        if (g_configSettings->Protocol != ProtocolType::TCP || g_configSettings->MemoryTransport)
+        {
+            throw invalid_argument("-Probes (only applicable to TCP sockets)");
+        }
+        if (g_configSettings->IoPattern != IoPatternType::Push &&
+            g_configSettings->IoPattern != IoPatternType::Pull &&
+            g_configSettings->IoPattern != IoPatternType::PushPull &&
+            g_configSettings->IoPattern != IoPatternType::Duplex)
+        {
+            // probes measure the latency the bulk transfers add : -Pattern:RequestResponse and Heartbeat already measure round trips
+            throw invalid_argument("-Probes (only applicable to -Pattern:Push, Pull, PushPull or Duplex)");
+        }
+        if (!g_configSettings->RelayAddresses.empty())
+        {
+            // relayed connections are forwarded without running the IO pattern
+            throw invalid_argument("-Probes (not supported with -Relay)");
+        }
+        if (g_configSettings->PersistentTransfers > 1)
+        {
+            throw invalid_argument("-Probes (not supported with -PersistentTransfers)");
+        }
 
-                // always remove the arg from our vector
-                args.erase(foundArgument);
-            }
-            else
+        if (0 == g_configSettings->ProbePort)
+        {
+            if (0xffff == g_configSettings->Port)
             {
-                // didn't find -Options
-                break;
+                throw invalid_argument("-ProbePort (must be given when -Port is 65535)");
             }
+            g_configSettings->ProbePort = static_cast<WORD>(g_configSettings->Port + 1);
         }
-    }
 
-    //////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    /// Parses the optional -KeepAliveValue:####
-    ///
-    //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForKeepAlive(vector<const wchar_t*>& args)
-    {
-        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-keepalivevalue");
-            return value != nullptr;
-            });
-        if (foundArgument != end(args))
+        // servers accept the probe connections on each of their listening addresses
+        // - the -ProbePort is how the server tells a probe connection from a bulk connection
+        const auto& addresses = IsListening() ? g_configSettings->ListenAddresses : g_configSettings->TargetAddresses;
+        for (const auto& addr : addresses)
         {
-            if (ProtocolType::TCP == g_configSettings->Protocol)
+            if (addr.port() == g_configSettings->ProbePort)
             {
-                g_configSettings->KeepAliveValue = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-keepalivevalue"));
-                if (0 == g_configSettings->KeepAliveValue)
-                {
-                    throw invalid_argument("Invalid KeepAliveValue");
-                }
+                throw invalid_argument("-ProbePort (must differ from the port of every -Listen and -Target address)");
             }
-            else
+        }
+        if (IsListening())
+        {
+            vector<ctSockaddr> probeAddresses(g_configSettings->ListenAddresses);
+            for (auto& addr : probeAddresses)
             {
-                throw invalid_argument("-KeepAliveValue is only allowed with TCP sockets");
+                addr.SetPort(g_configSettings->ProbePort);
             }
-            // always remove the arg from our vector
-            args.erase(foundArgument);
+            g_configSettings->ListenAddresses.insert(end(g_configSettings->ListenAddresses), begin(probeAddresses), end(probeAddresses));
         }
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the wire-Protocol to use
-    /// --- these only apply to TCP
+    /// Parses for the upstream addresses servers relay their accepted connections to
+    /// -- only applicable to TCP servers
+    /// Supports specifying the parameter multiple times, as -target
     ///
-    /// -pattern:push
-    /// -pattern:pull
-    /// -pattern:pushpull
-    /// -pattern:duplex
+    /// -Relay:<addr>
+    /// -RelayPort:#### (*default : -Port)
+    /// -RelayBuffers:#### (*default : 2)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForIoPattern(vector<const wchar_t*>& args)
+    static void ParseForRelay(vector<const wchar_t*>& args)
     {
-        auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-pattern");
-            return value != nullptr;
-            });
-        if (foundArgument != end(args))
-        {
-            if (g_configSettings->Protocol != ProtocolType::TCP)
-            {
-                throw invalid_argument("-pattern (only applicable to TCP)");
-            }
-
-            const auto* const value = ParseArgument(*foundArgument, L"-pattern");
-            if (ctString::ctOrdinalEqualsCaseInsensative(L"push", value))
-            {
-                g_configSettings->IoPattern = IoPatternType::Push;
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"pull", value))
-            {
-                g_configSettings->IoPattern = IoPatternType::Pull;
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"pushpull", value))
-            {
-                g_configSettings->IoPattern = IoPatternType::PushPull;
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"flood", value) || ctString::ctOrdinalEqualsCaseInsensative(L"duplex", value))
-            {
-                // the old name for this was 'flood'
-                g_configSettings->IoPattern = IoPatternType::Duplex;
-            }
-            else
-            {
-                throw invalid_argument("-pattern");
-            }
-
-            // always remove the arg from our vector
-            args.erase(foundArgument);
-        }
-        else
+        auto foundRelay = begin(args);
+        while (foundRelay != end(args))
         {
-            if (g_configSettings->Protocol == ProtocolType::UDP)
-            {
-                g_configSettings->IoPattern = IoPatternType::MediaStream;
-            }
-            else
+            foundRelay = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+                const auto* const value = ParseArgument(parameter, L"-Relay");
+                return value != nullptr;
+                });
+            if (foundRelay != end(args))
             {
-                // default the TCP pattern to Push
-                g_configSettings->IoPattern = IoPatternType::Push;
+                const auto* const value = ParseArgument(*foundRelay, L"-Relay");
+                vector<ctSockaddr> tempAddresses(ctSockaddr::ResolveName(value));
+                if (tempAddresses.empty())
+                {
+                    throw invalid_argument("-Relay value did not resolve to an IP address");
+                }
+                g_configSettings->RelayAddresses.insert(end(g_configSettings->RelayAddresses), begin(tempAddresses), end(tempAddresses));
+                // always remove the arg from our vector
+                args.erase(foundRelay);
+                // found_relay is now invalidated since we just erased what it's pointing to
+                // - reset it to begin() since we know it's not end()
+                foundRelay = args.begin();
             }
         }
 
-        // Now look for options tightly coupled to Protocol
-        const auto foundPushbytes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-pushbytes");
+        auto relayPort = g_configSettings->Port;
+        const auto foundPort = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-RelayPort");
             return value != nullptr;
             });
-        if (foundPushbytes != end(args))
+        if (foundPort != end(args))
         {
-            if (g_configSettings->IoPattern != IoPatternType::PushPull)
+            if (g_configSettings->RelayAddresses.empty())
             {
-                throw invalid_argument("-PushBytes can only be set with -Pattern:PushPull");
+                throw invalid_argument("-RelayPort (only applicable with -Relay)");
             }
-            g_configSettings->PushBytes = ConvertToIntegral<unsigned long>(ParseArgument(*foundPushbytes, L"-pushbytes"));
-            // always remove the arg from our vector
-            args.erase(foundPushbytes);
-        }
-        else
-        {
-            g_configSettings->PushBytes = c_defaultPushBytes;
-        }
-
-        const auto foundPullbytes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-pullbytes");
-            return value != nullptr;
-            });
-        if (foundPullbytes != end(args))
-        {
-            if (g_configSettings->IoPattern != IoPatternType::PushPull)
+            relayPort = ConvertToIntegral<WORD>(ParseArgument(*foundPort, L"-RelayPort"));
+            if (0 == relayPort)
             {
-                throw invalid_argument("-PullBytes can only be set with -Pattern:PushPull");
+                throw invalid_argument("-RelayPort");
             }
-            g_configSettings->PullBytes = ConvertToIntegral<unsigned long>(ParseArgument(*foundPullbytes, L"-pullbytes"));
             // always remove the arg from our vector
-            args.erase(foundPullbytes);
-        }
-        else
-        {
-            g_configSettings->PullBytes = c_defaultPullBytes;
+            args.erase(foundPort);
         }
 
-        //
-        // Options for the UDP protocol
-        //
-
-        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-BitsPerSecond");
+        const auto foundBuffers = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-RelayBuffers");
             return value != nullptr;
             });
-        if (foundArgument != end(args))
+        if (foundBuffers != end(args))
         {
-            if (g_configSettings->Protocol != ProtocolType::UDP)
+            if (g_configSettings->RelayAddresses.empty())
             {
-                throw invalid_argument("-BitsPerSecond requires -Protocol:UDP");
+                throw invalid_argument("-RelayBuffers (only applicable with -Relay)");
             }
-            g_mediaStreamSettings.BitsPerSecond = ConvertToIntegral<long long>(ParseArgument(*foundArgument, L"-BitsPerSecond"));
-            // bitspersecond must align on a byte-boundary
-            if (g_mediaStreamSettings.BitsPerSecond % 8 != 0)
+            g_configSettings->RelayBufferCount = ConvertToIntegral<unsigned long>(ParseArgument(*foundBuffers, L"-RelayBuffers"));
+            if (0 == g_configSettings->RelayBufferCount)
             {
-                g_mediaStreamSettings.BitsPerSecond -= g_mediaStreamSettings.BitsPerSecond % 8;
+                throw invalid_argument("-RelayBuffers");
             }
             // always remove the arg from our vector
-            args.erase(foundArgument);
+            args.erase(foundBuffers);
         }
 
-        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-FrameRate");
-            return value != nullptr;
-            });
-        if (foundArgument != end(args))
+        if (g_configSettings->RelayAddresses.empty())
         {
-            if (g_configSettings->Protocol != ProtocolType::UDP)
-            {
-                throw invalid_argument("-FrameRate requires -Protocol:UDP");
-            }
-            g_mediaStreamSettings.FramesPerSecond = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-FrameRate"));
-            // always remove the arg from our vector
-            args.erase(foundArgument);
+            return;
         }
 
-        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-BufferDepth");
-            return value != nullptr;
-            });
-        if (foundArgument != end(args))
+        if (g_configSettings->Protocol != ProtocolType::TCP || g_configSettings->MemoryTransport)
         {
-            if (g_configSettings->Protocol != ProtocolType::UDP)
-            {
-                throw invalid_argument("-BufferDepth requires -Protocol:UDP");
-            }
-            g_mediaStreamSettings.BufferDepthSeconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-BufferDepth"));
-            // always remove the arg from our vector
-            args.erase(foundArgument);
+            throw invalid_argument("-Relay (only applicable to TCP sockets)");
         }
-        else
+        if (!IsListening())
         {
-            // default buffer depth to 1
-            g_mediaStreamSettings.BufferDepthSeconds = 1;
+            throw invalid_argument("-Relay (only applicable to servers : requires -Listen)");
         }
-
-        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-StreamLength");
-            return value != nullptr;
-            });
-        if (foundArgument != end(args))
+        if (g_configSettings->IoFunction != ctsSendRecvIocp || (g_configSettings->Options & TransmitPackets))
         {
-            if (g_configSettings->Protocol != ProtocolType::UDP)
-            {
-                throw invalid_argument("-StreamLength requires -Protocol:UDP");
-            }
-            g_mediaStreamSettings.StreamLengthSeconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-StreamLength"));
-            // always remove the arg from our vector
-            args.erase(foundArgument);
+            // the relay posts its own WSASend and WSARecv calls on both connections
+            throw invalid_argument("-Relay (only supported with -io:iocp)");
+        }
+        if (g_configSettings->ExchangeConnectionIdOnConnect)
+        {
+            // the bytes AcceptEx received would not be forwarded
+            throw invalid_argument("-Relay cannot be used with -ConnectData");
         }
 
-        // validate and resolve the UDP protocol options
-        if (ProtocolType::UDP == g_configSettings->Protocol)
+        for (auto& addr : g_configSettings->RelayAddresses)
         {
-            if (0 == g_mediaStreamSettings.BitsPerSecond)
-            {
-                throw invalid_argument("-BitsPerSecond is required");
-            }
-            if (0 == g_mediaStreamSettings.FramesPerSecond)
-            {
-                throw invalid_argument("-FrameRate is required");
-            }
-            if (0 == g_mediaStreamSettings.StreamLengthSeconds)
+            if (addr.port() == 0x0000)
             {
-                throw invalid_argument("-StreamLength is required");
+                addr.SetPort(relayPort);
             }
-
-            // finally calculate the total stream length after all settings are captured from the user
-            g_transferSizeLow = g_mediaStreamSettings.CalculateTransferSize();
         }
+        g_configSettings->IoFunction = ctsRelayIocp;
+        g_ioFunctionName = L"Relay (WSASend/WSARecv forwarding between each accepted connection and its upstream connection using IOCP)";
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for IP address or machine name target to use
-    /// Can be comma-delimited if more than one
-    ///
-    /// 3 different parameters read address/name settings:
-    /// Supports specifying the parameter multiple times:
-    ///   e.g. -target:machinea -target:machineb
+    /// Parses for whether MediaStream clients multiplex their streams over shared UDP sockets
+    /// -- only applicable to MediaStream clients
     ///
-    /// -listen: (address to listen on)
-    ///   - specifying * == listen to all addresses
-    /// -target: (address to connect to)
-    /// -bind:   (address to bind before connecting)
-    ///   - specifying * == bind to all addresses (default)
+    /// -MultiplexStreams:on
+    /// -MultiplexStreams:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForAddress(vector<const wchar_t*>& args)
+    static void ParseForMultiplexStreams(vector<const wchar_t*>& args)
     {
-        // -listen:<addr> 
-        auto foundListen = begin(args);
-        while (foundListen != end(args))
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-MultiplexStreams");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
         {
-            foundListen = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-                const auto* const value = ParseArgument(parameter, L"-listen");
-                return value != nullptr;
-                });
-            if (foundListen != end(args))
+            const auto* const value = ParseArgument(*foundArgument, L"-MultiplexStreams");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                const auto* const value = ParseArgument(*foundListen, L"-listen");
-                if (ctString::ctOrdinalEqualsCaseInsensative(L"*", value))
+                if (IoPatternType::MediaStream != g_configSettings->IoPattern || IsListening())
                 {
-                    // add both v4 and v6
-                    ctSockaddr listenAddr(AF_INET, ctSockaddr::AddressType::Any);
-                    g_configSettings->ListenAddresses.push_back(listenAddr);
-                    listenAddr.set(AF_INET6, ctSockaddr::AddressType::Any);
-                    g_configSettings->ListenAddresses.push_back(listenAddr);
+                    throw invalid_argument("-MultiplexStreams (only applicable to MediaStream clients)");
                 }
-                else
+                if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
                 {
-                    vector<ctSockaddr> tempAddresses(ctSockaddr::ResolveName(value));
-                    if (tempAddresses.empty())
-                    {
-                        throw invalid_argument("-listen value did not resolve to an IP address");
-                    }
-                    g_configSettings->ListenAddresses.insert(end(g_configSettings->ListenAddresses), begin(tempAddresses), end(tempAddresses));
+                    throw invalid_argument("-MultiplexStreams (not supported with -io:rioiocp or -io:riopoll)");
                 }
-                // always remove the arg from our vector
-                args.erase(foundListen);
-                // found_listen is now invalidated since we just erased what it's pointing to
-                // - reset it to begin() since we know it's not end()
-                foundListen = args.begin();
-            }
-        }
-
-        // -target:<addr> 
-        auto foundTarget = begin(args);
-        while (foundTarget != end(args))
-        {
-            foundTarget = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-                const auto* const value = ParseArgument(parameter, L"-target");
-                return value != nullptr;
-                });
-            if (foundTarget != end(args))
-            {
-                if (!g_configSettings->ListenAddresses.empty())
+                if (g_configSettings->UdpRecvOffload)
                 {
-                    throw invalid_argument("cannot specify both -Listen and -Target");
+                    throw invalid_argument("-MultiplexStreams (not supported with -UdpRecvOffload)");
                 }
-                const auto* const value = ParseArgument(*foundTarget, L"-target");
-                vector<ctSockaddr> tempAddresses(ctSockaddr::ResolveName(value));
-                if (tempAddresses.empty())
+                if (g_configSettings->UdpRecvTimestamps)
                 {
-                    throw invalid_argument("-target value did not resolve to an IP address");
+                    throw invalid_argument("-MultiplexStreams (not supported with -UdpRecvTimestamps)");
                 }
-                g_configSettings->TargetAddresses.insert(end(g_configSettings->TargetAddresses), begin(tempAddresses), end(tempAddresses));
-                // always remove the arg from our vector
-                args.erase(foundTarget);
-                // found_target is now invalidated since we just erased what it's pointing to
-                // - reset it to begin() since we know it's not end()
-                foundTarget = args.begin();
+                if (g_configSettings->LocalPortLow != 0 || g_configSettings->PortReservationSize > 0)
+                {
+                    throw invalid_argument("-MultiplexStreams (not supported with -LocalPort or -PortReservation)");
+                }
+
+                g_configSettings->MultiplexMediaStreams = true;
+                g_configSettings->ConnectFunction = ctsMediaStreamClientMultiplexedConnect;
+                g_connectFunctionName = L"MediaStream Client Connect (multiplexed)";
+                g_configSettings->ClosingFunction = ctsMediaStreamClientMultiplexedClose;
+                // every datagram of the shared sockets completes on their threadpool, to be handed to its stream
+                g_configSettings->Options &= ~HandleInlineIocp;
+            }
+            else if (!ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                throw invalid_argument("-MultiplexStreams");
             }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
         }
+    }
 
-        // -bind:<addr> 
-        auto foundBind = begin(args);
-        while (foundBind != end(args))
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the IO (read/write) function to use
+    /// -- only applicable to TCP
+    ///
+    /// -io:blocking
+    /// -io:nonblocking
+    /// -io:event
+    /// -io:iocp (*default)
+    /// -io:readwritefile
+    /// -io:transmitpackets
+    /// -io:notifications
+    /// -io:wsapoll
+    /// -io:rioiocp
+    /// -io:riopoll
+    /// -io:tls
+    /// -io:coroutine
+    /// -io:xdp (UDP servers only)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForIoFunction(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-io");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
         {
-            foundBind = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-                const auto* const value = ParseArgument(parameter, L"-bind");
-                return value != nullptr;
-                });
-            if (foundBind != end(args))
+            const auto* const value = ParseArgument(*foundArgument, L"-io");
+            if (ProtocolType::UDP == g_configSettings->Protocol && ctString::ctOrdinalEqualsCaseInsensative(L"xdp", value))
             {
-                const auto* const value = ParseArgument(*foundBind, L"-bind");
-                // check for a comma-delimited list of IP Addresses
-                if (ctString::ctOrdinalEqualsCaseInsensative(L"*", value))
+                // only the server's sends bypass the host stack : clients still receive through Winsock
+                if (!IsListening())
                 {
-                    // add both v4 and v6
-                    ctSockaddr bindAddr(AF_INET, ctSockaddr::AddressType::Any);
-                    g_configSettings->BindAddresses.push_back(bindAddr);
-                    bindAddr.set(AF_INET6, ctSockaddr::AddressType::Any);
-                    g_configSettings->BindAddresses.push_back(bindAddr);
+                    throw invalid_argument("-io:xdp (only applicable to UDP servers)");
                 }
-                else
+                if (!ctsXdpIsSupported())
                 {
-                    vector<ctSockaddr> tempAddresses(ctSockaddr::ResolveName(value));
-                    if (tempAddresses.empty())
+                    throw invalid_argument("-io:xdp (ctsTraffic was not built with the XDP for Windows headers)");
+                }
+                for (const auto& addr : g_configSettings->ListenAddresses)
+                {
+                    // the headers of each datagram are written with the address and MAC of the interface sending it
+                    if (addr.IsAddressAny())
                     {
-                        throw invalid_argument("-bind value did not resolve to an IP address");
+                        throw invalid_argument("-io:xdp (requires -listen with the address of the interface to send from)");
                     }
-                    g_configSettings->BindAddresses.insert(end(g_configSettings->BindAddresses), begin(tempAddresses), end(tempAddresses));
                 }
-                // always remove the arg from our vector
-                args.erase(foundBind);
-                // found_bind is now invalidated since we just erased what it's pointing to
-                // - reset it to begin() since we know it's not end()
-                foundBind = args.begin();
-            }
-        }
-
-        if (!g_configSettings->ListenAddresses.empty() && !g_configSettings->TargetAddresses.empty())
-        {
-            throw invalid_argument("cannot specify both -target and -listen");
-        }
-        if (!g_configSettings->ListenAddresses.empty() && !g_configSettings->BindAddresses.empty())
-        {
-            throw invalid_argument("cannot specify both -bind and -listen");
-        }
-        if (g_configSettings->ListenAddresses.empty() && g_configSettings->TargetAddresses.empty())
-        {
-            throw invalid_argument("must specify either -target or -listen");
-        }
-
-        // default bind addresses if not listening and did not exclusively want to bind
-        if (g_configSettings->ListenAddresses.empty() && g_configSettings->BindAddresses.empty())
-        {
-            ctSockaddr defaultAddr(AF_INET, ctSockaddr::AddressType::Any);
-            g_configSettings->BindAddresses.push_back(defaultAddr);
-            defaultAddr.set(AF_INET6, ctSockaddr::AddressType::Any);
-            g_configSettings->BindAddresses.push_back(defaultAddr);
-        }
 
-        if (!g_configSettings->TargetAddresses.empty())
-        {
-            //
-            // guarantee that bindaddress and targetaddress families can match
-            // - can't allow a bind address to be chosen if there are no TargetAddresses with the same family
-            //
-            ctsUnsignedLong bindV4 = 0;
-            ctsUnsignedLong bindV6 = 0;
-            ctsUnsignedLong targetV4 = 0;
-            ctsUnsignedLong targetV6 = 0;
-            for (const auto& addr : g_configSettings->BindAddresses)
+                g_configSettings->XdpSend = true;
+                g_configSettings->IoFunction = ctsMediaStreamServerIo;
+                // server also has a closing function to remove the closed socket
+                g_configSettings->ClosingFunction = ctsMediaStreamServerClose;
+                g_ioFunctionName = L"MediaStream Server (AF_XDP sockets writing directly into the NIC TX rings)";
+            }
+            else if (ProtocolType::UDP == g_configSettings->Protocol)
             {
-                if (addr.family() == AF_INET)
+                // MediaStream only supports registered i/o and XDP beyond its default Winsock functions
+                const bool rioPoll = ctString::ctOrdinalEqualsCaseInsensative(L"riopoll", value) || ctString::ctOrdinalEqualsCaseInsensative(L"rio-poll", value);
+                if (!rioPoll && !ctString::ctOrdinalEqualsCaseInsensative(L"rioiocp", value))
                 {
-                    ++bindV4;
+                    throw invalid_argument("-io (UDP only supports rioiocp, riopoll and xdp)");
+                }
+
+                g_configSettings->RioPollCompletions = rioPoll;
+                WI_SetFlag(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO);
+                if (IsListening())
+                {
+                    g_configSettings->IoFunction = ctsMediaStreamServerIo;
+                    // server also has a closing function to remove the closed socket
+                    g_configSettings->ClosingFunction = ctsMediaStreamServerClose;
+                    g_ioFunctionName = rioPoll ?
+                        L"MediaStream Server (RIOSendEx polling the completion queue)" :
+                        L"MediaStream Server (RIOSendEx using IOCP notifications)";
                 }
                 else
                 {
-                    ++bindV6;
+                    constexpr int udpRecvBuff = 1048576;
+                    g_configSettings->IoFunction = ctsRioIocp;
+                    g_configSettings->Options |= SetRecvBuf;
+                    g_configSettings->RecvBufValue = udpRecvBuff;
+                    g_ioFunctionName = rioPoll ?
+                        L"MediaStream Client (RIO polling the completion queue)" :
+                        L"MediaStream Client (RIO using IOCP notifications)";
                 }
             }
-            for (const auto& addr : g_configSettings->TargetAddresses)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"iocp", value))
             {
-                if (addr.family() == AF_INET)
-                {
-                    ++targetV4;
-                }
-                else
+                g_configSettings->IoFunction = ctsSendRecvIocp;
+                g_configSettings->Options |= HandleInlineIocp;
+                g_ioFunctionName = L"Iocp (WSASend/WSARecv using IOCP)";
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"readwritefile", value))
+            {
+                g_configSettings->IoFunction = ctsReadWriteIocp;
+                g_ioFunctionName = L"ReadWriteFile (ReadFile/WriteFile using IOCP)";
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"transmitpackets", value))
+            {
+                // receives are unchanged from -io:iocp : only sends are made through TransmitPackets
+                g_configSettings->IoFunction = ctsSendRecvIocp;
+                g_configSettings->Options |= HandleInlineIocp;
+                g_configSettings->Options |= TransmitPackets;
+                g_ioFunctionName = L"TransmitPackets (TransmitPackets/WSARecv using IOCP)";
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"notifications", value))
+            {
+                // IO is attempted directly on non-blocking sockets, waiting on readiness notifications when it would block
+                g_configSettings->IoFunction = ctsSocketNotifications;
+                g_configSettings->Options |= NonBlockingIo;
+                g_ioFunctionName = L"Notifications (non-blocking send/recv using ProcessSocketNotifications)";
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"memory", value))
+            {
+                if (IsListening())
                 {
-                    ++targetV6;
+                    throw invalid_argument("-io:memory (the server side of each connection runs within the client)");
                 }
+                // no Winsock underneath : the connection is 'created' and 'connected' in-process
+                g_configSettings->IoFunction = ctsMemoryIo;
+                g_configSettings->CreateFunction = ctsMemorySocket;
+                g_configSettings->MemoryTransport = true;
+                g_createFunctionName = L"Memory (no socket)";
+                g_ioFunctionName = L"Memory (client and server IO patterns paired in-process over in-memory channels)";
             }
-            //
-            // if either bind or target has zero of either family, remove those addrs from the other vector
-            //
-            if (0 == bindV4)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"rioiocp", value))
             {
-                g_configSettings->TargetAddresses.erase(
-                    remove_if(
-                        begin(g_configSettings->TargetAddresses),
-                        end(g_configSettings->TargetAddresses),
-                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET; }),
-                    end(g_configSettings->TargetAddresses)
-                );
+                g_configSettings->IoFunction = ctsRioIocp;
+                WI_SetFlag(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO);
+                g_ioFunctionName = L"RioIocp (RIO using IOCP notifications)";
             }
-            else if (0 == targetV4)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"riopoll", value) || ctString::ctOrdinalEqualsCaseInsensative(L"rio-poll", value))
             {
-                g_configSettings->BindAddresses.erase(
-                    remove_if(
-                        begin(g_configSettings->BindAddresses),
-                        end(g_configSettings->BindAddresses),
-                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET; }),
-                    end(g_configSettings->BindAddresses)
-                );
+                g_configSettings->IoFunction = ctsRioIocp;
+                g_configSettings->RioPollCompletions = true;
+                WI_SetFlag(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO);
+                g_ioFunctionName = L"RioPoll (RIO polling the completion queue)";
             }
-
-            if (0 == bindV6)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"tls", value))
             {
-                g_configSettings->TargetAddresses.erase(
-                    remove_if(
-                        begin(g_configSettings->TargetAddresses),
-                        end(g_configSettings->TargetAddresses),
-                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET6; }),
-                    end(g_configSettings->TargetAddresses)
-                );
+                // every completion is queued to the threadpool : records are decrypted as their recvs complete
+                g_configSettings->IoFunction = ctsTlsIocp;
+                g_ioFunctionName = L"Tls (Schannel TLS records over WSASend/WSARecv using IOCP)";
             }
-            else if (0 == targetV6)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"coroutine", value))
             {
-                g_configSettings->BindAddresses.erase(
-                    remove_if(
-                        begin(g_configSettings->BindAddresses),
-                        end(g_configSettings->BindAddresses),
-                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET6; }),
-                    end(g_configSettings->BindAddresses)
-                );
+                g_configSettings->IoFunction = ctsSendRecvCoroutine;
+                g_configSettings->Options |= HandleInlineIocp;
+                g_ioFunctionName = L"Coroutine (WSASend/WSARecv using IOCP, each connection driven by one coroutine)";
             }
-            //
-            // now if either are of size zero, the user specified addresses which didn't align
-            //
-            if (g_configSettings->BindAddresses.empty() || g_configSettings->TargetAddresses.empty())
+            else
             {
-                throw invalid_argument("-bind addresses and target addresses must match families");
+                throw invalid_argument("-io");
             }
-        }
-    }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
 
-    //////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    /// Parses for the Port # to listen to/connect to
-    ///
-    /// -Port:##
-    ///
-    //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForPort(vector<const wchar_t*>& args)
-    {
-        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-Port");
-            return value != nullptr;
-            });
-        if (foundArgument != end(args))
+        }
+        else
         {
-            g_configSettings->Port = ConvertToIntegral<WORD>(ParseArgument(*foundArgument, L"-Port"));
-            if (0 == g_configSettings->Port)
+            if (ProtocolType::TCP == g_configSettings->Protocol)
             {
-                throw invalid_argument("-Port");
+                // Default for TCP is WSASend/WSARecv using IOCP
+                g_configSettings->IoFunction = ctsSendRecvIocp;
+                g_configSettings->Options |= HandleInlineIocp;
+                g_ioFunctionName = L"Iocp (WSASend/WSARecv using IOCP)";
             }
-            // always remove the arg from our vector
-            args.erase(foundArgument);
-        }
-    }
-
+            else
+            {
+                if (IsListening())
+                {
+                    g_configSettings->IoFunction = ctsMediaStreamServerIo;
+                    // server also has a closing function to remove the closed socket
+                    g_configSettings->ClosingFunction = ctsMediaStreamServerClose;
+                    g_ioFunctionName = L"MediaStream Server";
+                }
+                else
+                {
+                    constexpr int udpRecvBuff = 1048576;
+                    g_configSettings->IoFunction = ctsMediaStreamClient;
+                    g_configSettings->Options |= SetRecvBuf;
+                    g_configSettings->RecvBufValue = udpRecvBuff;
+                    g_configSettings->Options |= HandleInlineIocp;
+                    g_configSettings->Options |= EnableCircularQueueing;
+                    g_ioFunctionName = L"MediaStream Client";
+                }
+            }
+        }
+    }
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the connection limit [max number of connections to maintain]
+    /// Parses for the CPU efficiency reporting
     ///
-    /// -connections:####
+    /// -CpuEfficiency:off (*default)
+    /// -CpuEfficiency:on
+    /// -CpuEfficiency:detailed
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForConnections(vector<const wchar_t*>& args)
+    static void ParseForCpuEfficiency(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-connections");
+            const auto* const value = ParseArgument(parameter, L"-CpuEfficiency");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (IsListening())
+            const auto* const value = ParseArgument(*foundArgument, L"-CpuEfficiency");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                throw invalid_argument("-Connections is only supported when running as a client");
+                g_configSettings->PrintCpuEfficiency = true;
             }
-            g_configSettings->ConnectionLimit = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-connections"));
-            if (0 == g_configSettings->ConnectionLimit)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"detailed", value))
             {
-                throw invalid_argument("-connections");
+                g_configSettings->PrintCpuEfficiency = true;
+                g_configSettings->PrintCpuTimes = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->PrintCpuEfficiency = false;
+                g_configSettings->PrintCpuTimes = false;
+            }
+            else
+            {
+                throw invalid_argument("-CpuEfficiency");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
     }
+
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the server limit [max number of connections before the server exits]
+    /// Parses for the InlineCompletions setting to use
     ///
-    /// -ServerExitLimit:####
+    /// -InlineCompletions:on
+    /// -InlineCompletions:off
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForServerExitLimit(vector<const wchar_t*>& args)
+    static void ParseForInlineCompletions(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-ServerExitLimit");
+            const auto* const value = ParseArgument(parameter, L"-inlinecompletions");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (!IsListening())
+            const auto* const value = ParseArgument(*foundArgument, L"-inlinecompletions");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                throw invalid_argument("-ServerExitLimit is only supported when running as a client");
+                g_configSettings->Options |= HandleInlineIocp;
             }
-            g_configSettings->ServerExitLimit = ConvertToIntegral<ULONGLONG>(ParseArgument(*foundArgument, L"-ServerExitLimit"));
-            if (0 == g_configSettings->ServerExitLimit)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
             {
-                // zero indicates no exit
-                g_configSettings->ServerExitLimit = MAXULONGLONG;
+                g_configSettings->Options &= ~HandleInlineIocp;
+            }
+            else
+            {
+                throw invalid_argument("-inlinecompletions");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
@@ -1297,589 +1601,721 @@ namespace ctsTraffic::ctsConfig
     }
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the connection limit [max number of connections to maintain]
+    /// Parses for the number of sends and recvs, or the microseconds, a connection may complete inline
+    /// before yielding its thread to the threadpool
+    /// -- only applicable to TCP with -IO:iocp and -InlineCompletions:on
     ///
-    /// -throttleconnections:####
+    /// -InlineCompletionBudget:#### (*default 0 : never yield)
+    /// -InlineCompletionBudget:####us
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForThrottleConnections(vector<const wchar_t*>& args)
+    static void ParseForInlineCompletionBudget(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-throttleconnections");
+            const auto* const value = ParseArgument(parameter, L"-InlineCompletionBudget");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (IsListening())
+            if (g_configSettings->Protocol != ProtocolType::TCP ||
+                g_configSettings->IoFunction != ctsSendRecvIocp ||
+                !(g_configSettings->Options & HandleInlineIocp))
             {
-                throw invalid_argument("-ThrottleConnections is only supported when running as a client");
+                throw invalid_argument("-InlineCompletionBudget (only applicable to TCP with -IO:iocp and -InlineCompletions:on)");
             }
-            g_configSettings->ConnectionThrottleLimit = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-throttleconnections"));
-            if (0 == g_configSettings->ConnectionThrottleLimit)
+
+            wstring value(ParseArgument(*foundArgument, L"-InlineCompletionBudget"));
+            if (ctString::ctOrdinalEndsWithCaseInsensative(value, L"us"))
             {
-                // zero means no limit
-                g_configSettings->ConnectionThrottleLimit = MAXUINT32;
+                value.resize(value.size() - 2);
+                g_configSettings->InlineCompletionBudgetMicroseconds = ConvertToIntegral<unsigned long>(value);
+                if (0 == g_configSettings->InlineCompletionBudgetMicroseconds)
+                {
+                    throw invalid_argument("-InlineCompletionBudget (the microseconds must be greater than zero)");
+                }
+            }
+            else
+            {
+                g_configSettings->InlineCompletionBudget = ConvertToIntegral<unsigned long>(value);
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
     }
-
-    template <typename T>
-    void ReadRangeValues(_In_z_ const wchar_t* value, T& outLow, T& outHigh)
-    {
-        // a range was specified
-        // - find the ',' the '[', and the ']'
-        const auto valueLength = wcslen(value);
-        const auto* const valueEnd = value + valueLength;
-        if (valueLength < 5 || value[0] != L'[' || value[valueLength - 1] != L']')
-        {
-            throw invalid_argument("range value [###,###]");
-        }
-        const auto* const commaDelimiter = find(value, valueEnd, L',');
-        if (!(valueEnd > commaDelimiter + 1))
-        {
-            throw invalid_argument("range value [###,###]");
-        }
-
-        // null-terminate the first number at the delimiter to do a string -> int conversion
-        *const_cast<wchar_t*>(commaDelimiter) = L'\0';
-        const auto* const valueLow = value + 1; // move past the '['
-        outLow = ConvertToIntegral<T>(valueLow);
-
-        // null-terminate for the 2nd number over the last ']' to doa string -> int conversion
-        const_cast<wchar_t*>(value)[valueLength - 1] = L'\0';
-        const auto* const valueHigh = commaDelimiter + 1;
-        outHigh = ConvertToIntegral<T>(valueHigh);
-
-        // validate buffer values
-        if (outHigh < outLow)
-        {
-            throw invalid_argument("range value [###,###]");
-        }
-    }
-
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the buffer size to push down per IO
+    /// Parses for running the connect and initiate-IO states of a connection on the thread
+    /// which completed the prior state, instead of queueing each to the threadpool
     ///
-    /// -buffer:####
-    ///        :[low,high]
+    /// -InlineStateTransitions:<on,off> (*default off)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForBuffer(vector<const wchar_t*>& args)
+    static void ParseForInlineStateTransitions(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-buffer");
+            const auto* const value = ParseArgument(parameter, L"-InlineStateTransitions");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (g_configSettings->Protocol != ProtocolType::TCP)
+            const auto* const value = ParseArgument(*foundArgument, L"-InlineStateTransitions");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                throw invalid_argument("-buffer (only applicable to TCP)");
+                g_configSettings->InlineStateTransitions = true;
             }
-
-            const auto* const value = ParseArgument(*foundArgument, L"-buffer");
-            if (value[0] == L'[')
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
             {
-                ReadRangeValues(value, g_bufferSizeLow, g_bufferSizeHigh);
+                g_configSettings->InlineStateTransitions = false;
             }
             else
             {
-                // singe values are written to s_BufferSizeLow, with s_BufferSizeHigh left at zero
-                g_bufferSizeLow = ConvertToIntegral<unsigned long>(value);
-            }
-            if (0 == g_bufferSizeLow)
-            {
-                throw invalid_argument("-buffer");
+                throw invalid_argument("-InlineStateTransitions");
             }
-
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
-        else
-        {
-            g_bufferSizeLow = c_defaultBufferSize;
-            g_bufferSizeHigh = 0;
-        }
     }
-
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the total transfer size in bytes per connection
+    /// Parses for the Schannel settings of -io:tls sessions
     ///
-    /// -transfer:####
-    ///          :[low,high]
+    /// -TlsCertificate:<subject>
+    /// -TlsProtocol:<1.2,1.3>
+    /// -TlsCipher:<aes128,aes256,chacha20>
+    /// -TlsResumption:<on,off> (*default on)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForTransfer(vector<const wchar_t*>& args)
+    static void ParseForTls(vector<const wchar_t*>& args)
     {
-        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-transfer");
+        const bool tlsIo = g_configSettings->IoFunction == ctsTlsIocp;
+
+        auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-TlsCertificate");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (g_configSettings->Protocol != ProtocolType::TCP)
+            if (!tlsIo)
             {
-                throw invalid_argument("-transfer (only applicable to TCP)");
+                throw invalid_argument("-TlsCertificate (only applicable with -io:tls)");
+            }
+            g_configSettings->TlsCertificateName = ParseArgument(*foundArgument, L"-TlsCertificate");
+            if (0 == wcslen(g_configSettings->TlsCertificateName))
+            {
+                throw invalid_argument("-TlsCertificate");
             }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+        if (tlsIo && IsListening() && !g_configSettings->TlsCertificateName)
+        {
+            throw invalid_argument("-io:tls requires -TlsCertificate on the server");
+        }
 
-            const auto* const value = ParseArgument(*foundArgument, L"-transfer");
-            if (value[0] == L'[')
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-TlsProtocol");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (!tlsIo)
             {
-                ReadRangeValues(value, g_transferSizeLow, g_transferSizeHigh);
+                throw invalid_argument("-TlsProtocol (only applicable with -io:tls)");
             }
-            else
+            const auto* const value = ParseArgument(*foundArgument, L"-TlsProtocol");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"1.2", value))
             {
-                // singe values are written to s_TransferSizeLow, with s_TransferSizeHigh left at zero
-                g_transferSizeLow = ConvertToIntegral<unsigned long long>(value);
+                g_configSettings->TlsProtocol = TlsProtocolType::Tls12;
             }
-            if (0 == g_transferSizeLow)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"1.3", value))
             {
-                throw invalid_argument("-transfer");
+                g_configSettings->TlsProtocol = TlsProtocolType::Tls13;
+            }
+            else
+            {
+                throw invalid_argument("-TlsProtocol");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
-    }
 
-    //////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    /// Parses for the LocalPort # to bind for local connect
-    /// 
-    /// -LocalPort:##
-    ///
-    //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForLocalport(vector<const wchar_t*>& args)
-    {
-        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-LocalPort");
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-TlsCipher");
             return value != nullptr;
             });
-
         if (foundArgument != end(args))
         {
-            const auto* const value = ParseArgument(*foundArgument, L"-LocalPort");
-            if (value[0] == L'[')
+            if (!tlsIo)
             {
-                ReadRangeValues(value, g_configSettings->LocalPortLow, g_configSettings->LocalPortHigh);
+                throw invalid_argument("-TlsCipher (only applicable with -io:tls)");
             }
-            else
+            const auto* const value = ParseArgument(*foundArgument, L"-TlsCipher");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"aes128", value))
             {
-                // single value are written to localport_low with localport_high left at zero
-                g_configSettings->LocalPortHigh = 0;
-                g_configSettings->LocalPortLow = ConvertToIntegral<unsigned short>(value);
+                g_configSettings->TlsCipher = TlsCipherType::Aes128;
             }
-            if (0 == g_configSettings->LocalPortLow)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"aes256", value))
             {
-                throw invalid_argument("-LocalPort");
+                g_configSettings->TlsCipher = TlsCipherType::Aes256;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"chacha20", value))
+            {
+                g_configSettings->TlsCipher = TlsCipherType::ChaCha20;
+            }
+            else
+            {
+                throw invalid_argument("-TlsCipher");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
-    }
 
-    //////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    /// Parses for an explicitly specified interface index for outgoing connections
-    /// 
-    /// -IfIndex:##
-    ///
-    //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForIfIndex(vector<const wchar_t*>& args)
-    {
-        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-IfIndex");
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-TlsResumption");
             return value != nullptr;
             });
-
         if (foundArgument != end(args))
         {
-            const auto* const value = ParseArgument(*foundArgument, L"-IfIndex");
-            g_configSettings->OutgoingIfIndex = ConvertToIntegral<unsigned long>(value);
-
-            if (0 == g_configSettings->OutgoingIfIndex)
+            if (!tlsIo)
             {
-                throw invalid_argument("-IfIndex");
+                throw invalid_argument("-TlsResumption (only applicable with -io:tls)");
+            }
+            const auto* const value = ParseArgument(*foundArgument, L"-TlsResumption");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->TlsResumption = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->TlsResumption = false;
+            }
+            else
+            {
+                throw invalid_argument("-TlsResumption");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
-    }
 
+        if (tlsIo && g_configSettings->Options & HandleInlineIocp)
+        {
+            throw invalid_argument("-InlineCompletions:on (not supported with -io:tls)");
+        }
+    }
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for Tcp throttling parameters
+    /// Parses for what completes OVERLAPPED socket IO (not applicable to RIO)
     ///
-    /// -RateLimit:####
-    ///           :[low,high]
-    /// -RateLimitPeriod:####
+    /// -CompletionEngine:threadpool (*default)
+    /// -CompletionEngine:dedicated
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForRatelimit(vector<const wchar_t*>& args)
+    static void ParseForCompletionEngine(vector<const wchar_t*>& args)
     {
-        const auto foundRatelimit = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-RateLimit");
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-completionengine");
             return value != nullptr;
             });
-        if (foundRatelimit != end(args))
+        if (foundArgument != end(args))
         {
-            if (g_configSettings->Protocol != ProtocolType::TCP)
+            const auto* const value = ParseArgument(*foundArgument, L"-completionengine");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"dedicated", value))
             {
-                throw invalid_argument("-RateLimit (only applicable to TCP)");
+                g_configSettings->UseDedicatedCompletionThreads = true;
             }
-            const auto* const value = ParseArgument(*foundRatelimit, L"-RateLimit");
-            if (value[0] == L'[')
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"threadpool", value))
             {
-                ReadRangeValues(value, g_rateLimitLow, g_rateLimitLow);
+                g_configSettings->UseDedicatedCompletionThreads = false;
             }
             else
             {
-                // singe values are written to s_BufferSizeLow, with s_BufferSizeHigh left at zero
-                g_rateLimitLow = ConvertToIntegral<long long>(ParseArgument(*foundRatelimit, L"-RateLimit"));
-            }
-            if (0LL == g_rateLimitLow)
-            {
-                throw invalid_argument("-RateLimit");
+                throw invalid_argument("-CompletionEngine");
             }
             // always remove the arg from our vector
-            args.erase(foundRatelimit);
+            args.erase(foundArgument);
         }
 
-        const auto foundRatelimitPeriod = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-RateLimitPeriod");
-            return value != nullptr;
-            });
-        if (foundRatelimitPeriod != end(args))
+        if (g_configSettings->UseDedicatedCompletionThreads)
         {
-            if (g_configSettings->Protocol != ProtocolType::TCP)
+            if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
             {
-                throw invalid_argument("-RateLimitPeriod (only applicable to TCP)");
+                throw invalid_argument("-CompletionEngine:dedicated (not supported with -io:rioiocp or -io:riopoll)");
             }
-            if (0LL == g_rateLimitLow)
+            if (g_configSettings->UseNumaThreadpools)
             {
-                throw invalid_argument("-RateLimitPeriod requires specifying -RateLimit");
+                throw invalid_argument("-CompletionEngine:dedicated (cannot be combined with -NumaThreadpools:on)");
             }
-            g_configSettings->TcpBytesPerSecondPeriod = ConvertToIntegral<long long>(ParseArgument(*foundRatelimitPeriod, L"-RateLimitPeriod"));
-            // always remove the arg from our vector
-            args.erase(foundRatelimitPeriod);
+            g_completionEngine = new ctThreadIocpEngine; // can throw
         }
     }
-
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the total # of iterations
+    /// Parses for the MsgWaitAll setting to use
     ///
-    /// -Iterations:####
+    /// -MsgWaitAll:on
+    /// -MsgWaitAll:off
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForIterations(vector<const wchar_t*>& args)
+    static void ParseForMsgWaitAll(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-Iterations");
+            const auto* const value = ParseArgument(parameter, L"-msgwaitall");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (IsListening())
+            const auto* const value = ParseArgument(*foundArgument, L"-msgwaitall");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                throw invalid_argument("-Iterations is only supported when running as a client");
+                g_configSettings->Options |= MsgWaitAll;
             }
-            g_configSettings->Iterations = ConvertToIntegral<ULONGLONG>(ParseArgument(*foundArgument, L"-Iterations"));
-            if (0 == g_configSettings->Iterations)
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
             {
-                g_configSettings->Iterations = MAXULONGLONG;
+                g_configSettings->Options &= ~MsgWaitAll;
+            }
+            else
+            {
+                throw invalid_argument("-msgwaitall");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
+        {
+            // default to enable msgwaitall
+            g_configSettings->Options |= MsgWaitAll;
+        }
     }
-
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the verbosity level
+    /// Parses for whether receives should first wait on a zero-byte WSARecv
+    /// -- only applicable to TCP with -IO:iocp or -IO:coroutine
     ///
-    /// -ConsoleVerbosity:## <0-6>
-    /// -StatusUpdate:####
+    /// -ZeroByteRecv:on
+    /// -ZeroByteRecv:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForLogging(vector<const wchar_t*>& args)
+    static void ParseForZeroByteRecv(vector<const wchar_t*>& args)
     {
-        const auto foundVerbosity = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-ConsoleVerbosity");
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-zerobyterecv");
             return value != nullptr;
             });
-        if (foundVerbosity != end(args))
+        if (foundArgument != end(args))
         {
-            g_consoleVerbosity = ConvertToIntegral<unsigned long>(ParseArgument(*foundVerbosity, L"-ConsoleVerbosity"));
-            if (g_consoleVerbosity > 6)
+            const auto* const value = ParseArgument(*foundArgument, L"-zerobyterecv");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                throw invalid_argument("-ConsoleVerbosity");
+                if (g_configSettings->Protocol != ProtocolType::TCP ||
+                    (g_configSettings->IoFunction != ctsSendRecvIocp && g_configSettings->IoFunction != ctsSendRecvCoroutine))
+                {
+                    throw invalid_argument("-ZeroByteRecv (only applicable to TCP with -IO:iocp or -IO:coroutine)");
+                }
+                g_configSettings->Options |= ZeroByteRecv;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->Options &= ~ZeroByteRecv;
+            }
+            else
+            {
+                throw invalid_argument("-zerobyterecv");
             }
             // always remove the arg from our vector
-            args.erase(foundVerbosity);
+            args.erase(foundArgument);
         }
-
-        const auto foundStatusUpdate = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-StatusUpdate");
+    }
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the number of WSABUFs each send and recv is posted with
+    /// -- only applicable to TCP with -IO:iocp or -IO:coroutine (RIO requests only accept a single RIO_BUF)
+    ///
+    /// -BufferSegments:#### (*default 1)
+    /// -BufferSegmentHeader:#### (*default 0 : the buffer is split evenly across all segments)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForBufferSegments(vector<const wchar_t*>& args)
+    {
+        auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-BufferSegments");
             return value != nullptr;
             });
-        if (foundStatusUpdate != end(args))
+        if (foundArgument != end(args))
         {
-            g_configSettings->StatusUpdateFrequencyMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundStatusUpdate, L"-StatusUpdate"));
-            if (0 == g_configSettings->StatusUpdateFrequencyMilliseconds)
+            if (g_configSettings->Protocol != ProtocolType::TCP ||
+                (g_configSettings->IoFunction != ctsSendRecvIocp && g_configSettings->IoFunction != ctsSendRecvCoroutine))
             {
-                throw invalid_argument("-StatusUpdate");
+                throw invalid_argument("-BufferSegments (only applicable to TCP with -IO:iocp or -IO:coroutine)");
+            }
+
+            g_configSettings->BufferSegments = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-BufferSegments"));
+            if (0 == g_configSettings->BufferSegments || g_configSettings->BufferSegments > c_maxTaskBufferSegments)
+            {
+                throw invalid_argument("-BufferSegments (must be between 1 and 64)");
             }
             // always remove the arg from our vector
-            args.erase(foundStatusUpdate);
+            args.erase(foundArgument);
         }
 
-        wstring connectionFilename;
-        wstring errorFilename;
-        wstring statusFilename;
-        wstring jitterFilename;
-
-        const auto foundConnectionFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-ConnectionFilename");
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-BufferSegmentHeader");
             return value != nullptr;
             });
-        if (foundConnectionFilename != end(args))
+        if (foundArgument != end(args))
         {
-            connectionFilename = ParseArgument(*foundConnectionFilename, L"-ConnectionFilename");
+            if (g_configSettings->BufferSegments < 2)
+            {
+                throw invalid_argument("-BufferSegmentHeader (requires -BufferSegments of 2 or more)");
+            }
+
+            g_configSettings->BufferSegmentHeaderLength = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-BufferSegmentHeader"));
             // always remove the arg from our vector
-            args.erase(foundConnectionFilename);
+            args.erase(foundArgument);
         }
-
-        const auto foundErrorFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-ErrorFilename");
+    }
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the small-message packet rate options
+    /// -- only applicable to TCP
+    ///
+    /// -MessageSize:#### (*default 0 : sends are sized by -Buffer)
+    /// - every send is one message of this many bytes; recvs are still posted with -Buffer
+    ///   so the message boundaries each recv completes show how the sends were coalesced
+    /// -AckFrequency:### (*default 0 : the system default delayed-ACK frequency)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForMessageSize(vector<const wchar_t*>& args)
+    {
+        auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-MessageSize");
             return value != nullptr;
             });
-        if (foundErrorFilename != end(args))
+        if (foundArgument != end(args))
         {
-            errorFilename = ParseArgument(*foundErrorFilename, L"-ErrorFilename");
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-MessageSize is only applicable to TCP");
+            }
+            if (g_configSettings->IoPattern != IoPatternType::Push &&
+                g_configSettings->IoPattern != IoPatternType::Pull &&
+                g_configSettings->IoPattern != IoPatternType::PushPull &&
+                g_configSettings->IoPattern != IoPatternType::Duplex)
+            {
+                throw invalid_argument("-MessageSize is only applicable to -Pattern:Push, Pull, PushPull or Duplex");
+            }
+            if (g_configSettings->IoFunction == ctsRioIocp)
+            {
+                // the pre-registered RIO send buffers are sized and counted from -Buffer
+                throw invalid_argument("-MessageSize cannot be used with -IO:RIO");
+            }
+            if (g_configSettings->ShouldVerifyChecksums)
+            {
+                // each checksum covers a full send buffer
+                throw invalid_argument("-MessageSize cannot be used with -verify:checksum");
+            }
+            if (g_configSettings->BufferSegments > 1)
+            {
+                throw invalid_argument("-MessageSize cannot be used with -BufferSegments");
+            }
+
+            g_configSettings->MessageSize = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-MessageSize"));
+            if (0 == g_configSettings->MessageSize || g_configSettings->MessageSize > GetMaxBufferSize())
+            {
+                throw invalid_argument("-MessageSize (must be between 1 and the -Buffer size)");
+            }
             // always remove the arg from our vector
-            args.erase(foundErrorFilename);
+            args.erase(foundArgument);
         }
 
-        const auto foundStatusFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-StatusFilename");
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-AckFrequency");
             return value != nullptr;
             });
-        if (foundStatusFilename != end(args))
+        if (foundArgument != end(args))
         {
-            statusFilename = ParseArgument(*foundStatusFilename, L"-StatusFilename");
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-AckFrequency is only applicable to TCP");
+            }
+
+            g_configSettings->AckFrequency = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-AckFrequency"));
+            if (0 == g_configSettings->AckFrequency || g_configSettings->AckFrequency > 255)
+            {
+                throw invalid_argument("-AckFrequency (must be between 1 and 255)");
+            }
             // always remove the arg from our vector
-            args.erase(foundStatusFilename);
+            args.erase(foundArgument);
         }
-
-        const auto foundJitterFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-JitterFilename");
+    }
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for how the process-wide shared send and recv buffers are allocated
+    ///
+    /// -LargePages:on
+    /// -LargePages:off (*default)
+    /// -NumaLocalBuffers:on
+    /// -NumaLocalBuffers:off (*default)
+    /// -PayloadFile:<filename>
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForSharedBufferAllocation(vector<const wchar_t*>& args)
+    {
+        const auto foundPayloadFile = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-payloadfile");
             return value != nullptr;
             });
-        if (foundJitterFilename != end(args))
-        {
-            jitterFilename = ParseArgument(*foundJitterFilename, L"-JitterFilename");
-            // always remove the arg from our vector
-            args.erase(foundJitterFilename);
-        }
-
-        // since CSV files each have their own header, we cannot allow the same CSV filename to be used
-        // for different loggers, as opposed to txt files, which can be shared across different loggers
-
-        if (!connectionFilename.empty())
+        if (foundPayloadFile != end(args))
         {
-            if (ctString::ctOrdinalEndsWithCaseInsensative(connectionFilename, L".csv"))
+            if (g_configSettings->Protocol != ProtocolType::TCP)
             {
-                g_connectionLogger = make_shared<ctsTextLogger>(connectionFilename.c_str(), StatusFormatting::Csv);
+                throw invalid_argument("-PayloadFile is only applicable to TCP");
             }
-            else
+            if (g_configSettings->ShouldVerifyChecksums)
             {
-                g_connectionLogger = make_shared<ctsTextLogger>(connectionFilename.c_str(), StatusFormatting::ClearText);
+                throw invalid_argument("-PayloadFile cannot be used with -verify:checksum (the file does not carry the checksums)");
             }
-        }
 
-        if (!errorFilename.empty())
-        {
-            if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, errorFilename))
+            g_configSettings->PayloadFilename = ParseArgument(*foundPayloadFile, L"-payloadfile");
+            WIN32_FILE_ATTRIBUTE_DATA fileAttributes{};
+            if (!GetFileAttributesExW(g_configSettings->PayloadFilename, GetFileExInfoStandard, &fileAttributes))
             {
-                if (g_connectionLogger->IsCsvFormat())
-                {
-                    throw invalid_argument("The error logfile cannot be of csv format");
-                }
-                g_errorLogger = g_connectionLogger;
+                THROW_WIN32_MSG(GetLastError(), "GetFileAttributesEx(-PayloadFile)");
             }
-            else
+
+            // the payload repeats the file truncated to whole allocation granules, so the file can be mapped back-to-back
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+            constexpr ULONGLONG maximumPayloadSize = 0x40000000; // 1GB
+            ULARGE_INTEGER fileSize;
+            fileSize.LowPart = fileAttributes.nFileSizeLow;
+            fileSize.HighPart = fileAttributes.nFileSizeHigh;
+            auto payloadSize = fileSize.QuadPart < maximumPayloadSize ? fileSize.QuadPart : maximumPayloadSize;
+            payloadSize -= payloadSize % systemInfo.dwAllocationGranularity;
+            if (0 == payloadSize || payloadSize < GetMaxBufferSize())
             {
-                if (ctString::ctOrdinalEndsWithCaseInsensative(errorFilename, L".csv"))
-                {
-                    throw invalid_argument("The error logfile cannot be of csv format");
-                }
-                g_errorLogger = make_shared<ctsTextLogger>(errorFilename.c_str(), StatusFormatting::ClearText);
+                throw invalid_argument("-PayloadFile must be at least as large as the largest -buffer (and at least 64KB)");
             }
+            g_configSettings->PayloadPatternSize = static_cast<unsigned long>(payloadSize);
+
+            // always remove the arg from our vector
+            args.erase(foundPayloadFile);
         }
 
-        if (!statusFilename.empty())
+        auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-largepages");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
         {
-            if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, statusFilename))
+            const auto* const value = ParseArgument(*foundArgument, L"-largepages");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                if (g_connectionLogger->IsCsvFormat())
-                {
-                    throw invalid_argument("The same csv filename cannot be used for different loggers");
-                }
-                g_statusLogger = g_connectionLogger;
+                g_configSettings->UseLargePages = true;
             }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(errorFilename, statusFilename))
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
             {
-                if (g_errorLogger->IsCsvFormat())
-                {
-                    throw invalid_argument("The same csv filename cannot be used for different loggers");
-                }
-                g_statusLogger = g_errorLogger;
+                g_configSettings->UseLargePages = false;
             }
             else
             {
-                if (ctString::ctOrdinalEndsWithCaseInsensative(statusFilename, L".csv"))
-                {
-                    g_statusLogger = make_shared<ctsTextLogger>(statusFilename.c_str(), StatusFormatting::Csv);
-                }
-                else
-                {
-                    g_statusLogger = make_shared<ctsTextLogger>(statusFilename.c_str(), StatusFormatting::ClearText);
-                }
+                throw invalid_argument("-largepages");
             }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
         }
 
-        if (!jitterFilename.empty())
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-numalocalbuffers");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
         {
-            if (ctString::ctOrdinalEndsWithCaseInsensative(jitterFilename, L".csv"))
+            const auto* const value = ParseArgument(*foundArgument, L"-numalocalbuffers");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
             {
-                if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, jitterFilename) ||
-                    ctString::ctOrdinalEqualsCaseInsensative(errorFilename, jitterFilename) ||
-                    ctString::ctOrdinalEqualsCaseInsensative(statusFilename, jitterFilename))
-                {
-                    throw invalid_argument("The same csv filename cannot be used for different loggers");
-                }
-                g_jitterLogger = make_shared<ctsTextLogger>(jitterFilename.c_str(), StatusFormatting::Csv);
+                g_configSettings->UseNumaLocalBuffers = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->UseNumaLocalBuffers = false;
             }
             else
             {
-                throw invalid_argument("Jitter can only be logged using a csv format");
+                throw invalid_argument("-numalocalbuffers");
             }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
         }
     }
-
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Sets error policy
+    /// Parses for whether the MediaStream server should use UDP Send Offload
+    /// -- only applicable to UDP servers
     ///
-    /// -OnError:<log,break>
+    /// -UdpSendOffload:on
+    /// -UdpSendOffload:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForError(vector<const wchar_t*>& args)
+    static void ParseForUdpSendOffload(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-OnError");
+            const auto* const value = ParseArgument(parameter, L"-UdpSendOffload");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            const auto* const value = ParseArgument(*foundArgument, L"-OnError");
-            if (ctString::ctOrdinalEqualsCaseInsensative(L"log", value))
+            if (ProtocolType::UDP != g_configSettings->Protocol || g_configSettings->ListenAddresses.empty())
             {
-                g_breakOnError = false;
+                throw invalid_argument("-UdpSendOffload (only applicable to UDP servers)");
             }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"break", value))
+            if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
             {
-                g_breakOnError = true;
+                throw invalid_argument("-UdpSendOffload (not supported with -io:rioiocp or -io:riopoll)");
+            }
+            if (g_configSettings->XdpSend)
+            {
+                throw invalid_argument("-UdpSendOffload (not supported with -io:xdp)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-UdpSendOffload");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->UdpSendOffload = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->UdpSendOffload = false;
             }
             else
             {
-                throw invalid_argument("-OnError");
+                throw invalid_argument("-UdpSendOffload");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
     }
-
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Sets optional prepostrecvs value
+    /// Parses for whether the MediaStream server sends each datagram as one contiguous buffer,
+    /// formatting its header in a cache-aligned send slab instead of gathering it from separate buffers
+    /// -- only applicable to UDP servers
     ///
-    /// -PrePostRecvs:#####
+    /// -ContiguousDatagrams:on
+    /// -ContiguousDatagrams:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForPrepostrecvs(vector<const wchar_t*>& args)
+    static void ParseForContiguousDatagrams(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-PrePostRecvs");
+            const auto* const value = ParseArgument(parameter, L"-ContiguousDatagrams");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            g_configSettings->PrePostRecvs = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-PrePostRecvs"));
-            if (0 == g_configSettings->PrePostRecvs)
+            if (ProtocolType::UDP != g_configSettings->Protocol || g_configSettings->ListenAddresses.empty())
             {
-                throw invalid_argument("-PrePostRecvs");
+                throw invalid_argument("-ContiguousDatagrams (only applicable to UDP servers)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-ContiguousDatagrams");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->ContiguousDatagrams = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->ContiguousDatagrams = false;
+            }
+            else
+            {
+                throw invalid_argument("-ContiguousDatagrams");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
-        else
-        {
-            g_configSettings->PrePostRecvs = ProtocolType::TCP == g_configSettings->Protocol ? 1 : 2;
-        }
     }
-
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Sets optional prepostsends value
+    /// Parses for whether UDP sockets should coalesce received datagrams (UDP Receive Offload)
+    /// -- only applicable to UDP
     ///
-    /// -PrePostSends:#####
+    /// -UdpRecvOffload:on
+    /// -UdpRecvOffload:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForPrepostsends(vector<const wchar_t*>& args)
+    static void ParseForUdpRecvOffload(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-PrePostSends");
+            const auto* const value = ParseArgument(parameter, L"-UdpRecvOffload");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            g_configSettings->PrePostSends = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-PrePostSends"));
-            // always remove the arg from our vector
-            args.erase(foundArgument);
-        }
-        else
-        {
-            g_configSettings->PrePostSends = 1;
+            if (ProtocolType::UDP != g_configSettings->Protocol)
+            {
+                throw invalid_argument("-UdpRecvOffload (only applicable to UDP)");
+            }
             if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
             {
-                // 0 PrePostSends == rely on ISB
-                g_configSettings->PrePostSends = 0;
+                throw invalid_argument("-UdpRecvOffload (not supported with -io:rioiocp or -io:riopoll)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-UdpRecvOffload");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->UdpRecvOffload = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->UdpRecvOffload = false;
+            }
+            else
+            {
+                throw invalid_argument("-UdpRecvOffload");
             }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
         }
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Sets optional SO_RCVBUF value
+    /// Parses for whether MediaStream clients should timestamp received datagrams in the stack (SIO_TIMESTAMPING)
+    /// -- only applicable to MediaStream clients
     ///
-    /// -RecvBufValue:#####
+    /// -UdpRecvTimestamps:on
+    /// -UdpRecvTimestamps:off (*default)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForRecvbufvalue(vector<const wchar_t*>& args)
+    static void ParseForUdpRecvTimestamps(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-RecvBufValue");
+            const auto* const value = ParseArgument(parameter, L"-UdpRecvTimestamps");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            g_configSettings->RecvBufValue = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-RecvBufValue"));
-            g_configSettings->Options |= SetRecvBuf;
+            if (IoPatternType::MediaStream != g_configSettings->IoPattern || IsListening())
+            {
+                throw invalid_argument("-UdpRecvTimestamps (only applicable to MediaStream clients)");
+            }
+            if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+            {
+                throw invalid_argument("-UdpRecvTimestamps (not supported with -io:rioiocp or -io:riopoll)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-UdpRecvTimestamps");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->UdpRecvTimestamps = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->UdpRecvTimestamps = false;
+            }
+            else
+            {
+                throw invalid_argument("-UdpRecvTimestamps");
+            }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
@@ -1887,21 +2323,47 @@ namespace ctsTraffic::ctsConfig
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Sets optional SO_SNDBUF value
+    /// Parses for the number of RIO completion queues to create
+    /// -- only applicable to -io:rioiocp and -io:riopoll
+    /// -- with -io:riopoll, each completion queue always has its own polling thread
     ///
-    /// -SendBufValue:#####
+    /// -RioCompletionQueues:shared (*default)
+    /// -RioCompletionQueues:processor
+    /// -RioCompletionQueues:####
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForSendbufvalue(vector<const wchar_t*>& args)
+    static void ParseForRioCompletionQueues(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-SendBufValue");
+            const auto* const value = ParseArgument(parameter, L"-RioCompletionQueues");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            g_configSettings->SendBufValue = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-SendBufValue"));
-            g_configSettings->Options |= SetSendBuf;
+            if (WI_IsFlagClear(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+            {
+                throw invalid_argument("-RioCompletionQueues (only applicable to -io:rioiocp and -io:riopoll)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-RioCompletionQueues");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"shared", value))
+            {
+                g_configSettings->RioCompletionQueueCount = 0;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"processor", value))
+            {
+                SYSTEM_INFO systemInfo;
+                GetSystemInfo(&systemInfo);
+                g_configSettings->RioCompletionQueueCount = systemInfo.dwNumberOfProcessors;
+            }
+            else
+            {
+                g_configSettings->RioCompletionQueueCount = ConvertToIntegral<unsigned long>(value);
+                if (0 == g_configSettings->RioCompletionQueueCount)
+                {
+                    throw invalid_argument("-RioCompletionQueues");
+                }
+            }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
@@ -1909,35 +2371,30 @@ namespace ctsTraffic::ctsConfig
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Sets an IP Compartment (routing domain)
+    /// Parses for the number of RSS queues of the sending interface to bind an AF_XDP socket to
+    /// -- only applicable to -io:xdp
     ///
-    /// -Compartment:<ifalias>
+    /// -XdpQueues:#### (*default 1)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForCompartment(vector<const wchar_t*>& args)
+    static void ParseForXdpQueues(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-Compartment");
+            const auto* const value = ParseArgument(parameter, L"-XdpQueues");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            // delay-load IPHLPAPI.DLL
-            const auto* const value = ParseArgument(*foundArgument, L"-Compartment");
-            g_netAdapterAddresses = new ctNetAdapterAddresses(AF_UNSPEC, GAA_FLAG_INCLUDE_ALL_COMPARTMENTS);
-            const auto foundInterface = find_if(
-                g_netAdapterAddresses->begin(),
-                g_netAdapterAddresses->end(),
-                [&value](const IP_ADAPTER_ADDRESSES& adapterAddress) {
-                    return ctString::ctOrdinalEqualsCaseInsensative(value, adapterAddress.FriendlyName);
-                });
-            THROW_HR_IF_MSG(
-                HRESULT_FROM_WIN32(ERROR_NOT_FOUND),
-                foundInterface == g_netAdapterAddresses->end(),
-                "GetAdaptersAddresses could not find the interface alias '%ws'",
-                value);
+            if (!g_configSettings->XdpSend)
+            {
+                throw invalid_argument("-XdpQueues (only applicable to -io:xdp)");
+            }
 
-            g_compartmentId = foundInterface->CompartmentId;
+            g_configSettings->XdpQueueCount = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-XdpQueues"));
+            if (0 == g_configSettings->XdpQueueCount)
+            {
+                throw invalid_argument("-XdpQueues");
+            }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
@@ -1945,67 +2402,26 @@ namespace ctsTraffic::ctsConfig
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Sets a threadpool environment for TP APIs to consume
-    ///
-    /// Configuring for max threads == number of processors * 2
-    ///
-    /// currently not exposing this as a command-line parameter
-    ///
-    //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForThreadpool(vector<const wchar_t*>&)
-    {
-        SYSTEM_INFO systemInfo;
-        GetSystemInfo(&systemInfo);
-        g_threadPoolThreadCount = systemInfo.dwNumberOfProcessors * c_defaultThreadpoolFactor;
-
-        g_threadPool = CreateThreadpool(nullptr);
-        if (!g_threadPool)
-        {
-            THROW_WIN32_MSG(GetLastError(), "CreateThreadPool");
-        }
-        SetThreadpoolThreadMaximum(g_threadPool, g_threadPoolThreadCount);
-
-        InitializeThreadpoolEnvironment(&g_threadPoolEnvironment);
-        SetThreadpoolCallbackPool(&g_threadPoolEnvironment, g_threadPool);
-
-        g_configSettings->pTpEnvironment = &g_threadPoolEnvironment;
-    }
-
-    //////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    /// Parses for whether to verify buffer contents on receiver
-    ///
-    /// -verify:<connection,data>
-    /// (the old options were <always,never>)
+    /// Parses for the number of consecutive empty polls a RIO polling thread spins before yielding
+    /// -- only applicable to -io:riopoll
     ///
-    /// Note this controls if using a SharedBuffer across all IO or unique buffers
-    /// - if not validating data, won't waste memory creating buffers for every connection
-    /// - if validating data, must create buffers for every connection
+    /// -RioPollSpin:#### (*default 1000; 0 never yields)
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForShouldVerifyBuffers(vector<const wchar_t*>& args)
+    static void ParseForRioPollSpin(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-verify");
+            const auto* const value = ParseArgument(parameter, L"-RioPollSpin");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            const auto* const value = ParseArgument(*foundArgument, L"-verify");
-            if (ctString::ctOrdinalEqualsCaseInsensative(L"always", value) || ctString::ctOrdinalEqualsCaseInsensative(L"data", value))
-            {
-                g_configSettings->ShouldVerifyBuffers = true;
-                g_configSettings->UseSharedBuffer = false;
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"never", value) || ctString::ctOrdinalEqualsCaseInsensative(L"connection", value))
+            if (!g_configSettings->RioPollCompletions)
             {
-                g_configSettings->ShouldVerifyBuffers = false;
-                g_configSettings->UseSharedBuffer = true;
-            }
-            else
-            {
-                throw invalid_argument("-verify");
+                throw invalid_argument("-RioPollSpin (only applicable to -io:riopoll)");
             }
+
+            g_configSettings->RioPollSpinCount = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-RioPollSpin"));
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
@@ -2013,787 +2429,6267 @@ namespace ctsTraffic::ctsConfig
 
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for how the client should close the connection with the server
+    /// Parses for the number of RIORESULTs to dequeue from a RIO completion queue at once
+    /// -- only applicable to -io:rioiocp and -io:riopoll
     ///
-    /// -shutdown:<graceful,rude>
+    /// -RioDequeueBatch:adaptive (*default)
+    /// -RioDequeueBatch:####
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForShutdown(vector<const wchar_t*>& args)
+    static void ParseForRioDequeueBatch(vector<const wchar_t*>& args)
     {
-        if (IsListening())
-        {
-            g_configSettings->TcpShutdown = TcpShutdownType::ServerSideShutdown;
-        }
-
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-shutdown");
+            const auto* const value = ParseArgument(parameter, L"-RioDequeueBatch");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            if (IsListening())
+            if (WI_IsFlagClear(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
             {
-                throw invalid_argument("-shutdown is a client-only option");
+                throw invalid_argument("-RioDequeueBatch (only applicable to -io:rioiocp and -io:riopoll)");
             }
 
-            const auto* const value = ParseArgument(*foundArgument, L"-shutdown");
-            if (ctString::ctOrdinalEqualsCaseInsensative(L"graceful", value))
-            {
-                g_configSettings->TcpShutdown = TcpShutdownType::GracefulShutdown;
-            }
-            else if (ctString::ctOrdinalEqualsCaseInsensative(L"rude", value))
+            const auto* const value = ParseArgument(*foundArgument, L"-RioDequeueBatch");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"adaptive", value))
             {
-                g_configSettings->TcpShutdown = TcpShutdownType::HardShutdown;
+                g_configSettings->RioDequeueBatchSize = 0;
             }
             else
             {
-                throw invalid_argument("-shutdown");
+                g_configSettings->RioDequeueBatchSize = ConvertToIntegral<unsigned long>(value);
+                if (0 == g_configSettings->RioDequeueBatchSize || g_configSettings->RioDequeueBatchSize > ctsConfigSettings::c_RioMaxDequeueBatchSize)
+                {
+                    throw invalid_argument("-RioDequeueBatch");
+                }
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
     }
+
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Parses for the optional maximum time to run
+    /// Parses for the L4 Protocol to limit to usage
     ///
-    /// -TimeLimit:##
+    /// -Protocol:tcp
+    /// -Protocol:udp
     ///
     //////////////////////////////////////////////////////////////////////////////////////////
-    static void ParseForTimelimit(vector<const wchar_t*>& args)
+    static void ParseForProtocol(vector<const wchar_t*>& args)
     {
         const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
-            const auto* const value = ParseArgument(parameter, L"-timelimit");
+            const auto* const value = ParseArgument(parameter, L"-Protocol");
             return value != nullptr;
             });
         if (foundArgument != end(args))
         {
-            g_configSettings->TimeLimit = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-timelimit"));
-            if (0 == g_configSettings->Port)
+            const auto* const value = ParseArgument(*foundArgument, L"-Protocol");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"tcp", value))
             {
-                throw invalid_argument("-timelimit");
+                g_configSettings->Protocol = ProtocolType::TCP;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"udp", value))
+            {
+                g_configSettings->Protocol = ProtocolType::UDP;
+            }
+            else
+            {
+                throw invalid_argument("-Protocol");
             }
             // always remove the arg from our vector
             args.erase(foundArgument);
         }
+        else
+        {
+            // default to TCP
+            g_configSettings->Protocol = ProtocolType::TCP;
+        }
     }
 
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    //////////////////////////////////////////////////////////////////////////////////////////
     ///
-    /// Members within the ctsConfig namespace that can be accessed anywhere within ctsTraffic
+    /// Parses for socket Options
+    /// - allows for more than one option to be set
+    /// -Options:<keepalive,tcpfastpath,tcpfastopen,nodelay> [-Options:<...>] [-Options:<...>]
     ///
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
-    void PrintUsage(PrintUsageOption option)
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForOptions(vector<const wchar_t*>& args)
     {
-        ctsConfigInitOnce();
-
-        wstring usage;
-
-        switch (option)
+        for (;;)
         {
-            case PrintUsageOption::Default:
-                usage.append(L"\n\n"
-                    L"ctsTraffic is a utility to generate and validate the integrity of network traffic. It is a client / server application "
-                    L"with the ability to send and receive traffic in a variety of protocol patterns, utilizing a variety of API calling patterns. "
-                    L"The protocol is validated in bytes sent and received for every connection established. Should there be any API failure, any "
-                    L"connection lost prematurely, any protocol failure in bytes sent or received, ctsTraffic will capture and log that error information. "
-                    L"Any errors will additionally cause ctsTraffic to return a non-zero error code.\n"
-                    L"Once started, ctrl-c or ctrl-break will cleanly shutdown the client or server\n"
-                    L"\n\n"
-                    L"For issues or questions, please contact 'ctsSupport'\n"
-                    L"\n\n"
-                    L"ctsTraffic -Help:[tcp] [udp] [logging] [advanced]\n"
-                    L"\t- <default> == prints this usage statement\n"
-                    L"\t- tcp : prints usage for TCP-specific options\n"
-                    L"\t- udp : prints usage for UDP-specific options\n"
-                    L"\t- logging : prints usage for logging options\n"
-                    L"\t- advanced : prints the usage for advanced and experimental options\n"
-                    L"\n\n"
-                    L"Server-side usage:\n"
-                    L"\tctsTraffic -Listen:<addr or *> [-Port:####] [-ServerExitLimit:<####>] [-Protocol:<tcp/udp>] [-Verify:####] [Protocol-specific options]\n"
-                    L"\n"
-                    L"Client-side usage:\n"
-                    L"\tctsTraffic -Target:<addr or name> [-Port:####] [-Connections:<####>] [-Iterations:<####>] [-Protocol:<tcp/udp>] [-Verify:####] [Protocol-specific options]\n"
-                    L"\n"
-                    L"The Server-side and Client-side may have fully independent settings *except* for the following:\n"
-                    L" (these must match exactly between the client and the server)\n"
-                    L"\t-Port\n"
-                    L"\t-Protocol\n"
-                    L"\t-Verify\n"
-                    L"\t-Pattern (on TCP)\n"
-                    L"\t-Transfer (on TCP)\n"
-                    L"\t-BitsPerSecond (on UDP)\n"
-                    L"\t-FrameRate (on UDP)\n"
-                    L"\t-StreamLength (on UDP)\n"
-                    L"\n\n"
-                    L"----------------------------------------------------------------------\n"
-                    L"                    Common Server-side options                        \n"
-                    L"----------------------------------------------------------------------\n"
-                    L"-Listen:<addr or *> [-Listen:<addr> -Listen:<addr>]\n"
-                    L"   - the specific IP Address for the server-side to listen, or '*' for all IP Addresses\n"
-                    L"\t- <required>\n"
-                    L"\t  note : can specify multiple addresses by providing -Listen for each address\n"
-                    L"-ServerExitLimit:####\n"
-                    L"   - the total # of accepted connections before server gracefully exits\n"
-                    L"\t- <default> == 0  (infinite)\n"
-                    L"\n\n"
-                    L"----------------------------------------------------------------------\n"
-                    L"                    Common Client-side options                        \n"
-                    L"----------------------------------------------------------------------\n"
-                    L"-Connections:####\n"
-                    L"   - the total # of connections at any one time\n"
-                    L"\t- <default> == 8  (there will always be 8 connections doing IO)\n"
-                    L"-Iterations:####\n"
-                    L"   - the number of times to iterate across the number of '-Connections'\n"
-                    L"\t- <default> == 0  (infinite)\n"
-                    L"\t  note : the total # of connections to be made before exit == Iterations * Connections\n"
-                    L"-Target:<addr or name>\n"
-                    L"   - the server-side IP Address, FQDN, or hostname to connect\n"
-                    L"\t- <required>\n"
-                    L"\t  note : given a FQDN or hostname, each new connection will iterate across\n"
-                    L"\t       : all IPv4 and IPv6 addresses which the name resolved\n"
-                    L"\t  note : one can specify '-Target:localhost' when client and server are both local\n"
-                    L"\t  note : one can specify multiple targets by providing -Target for each address or name\n"
-                    L"\n\n"
-                    L"----------------------------------------------------------------------\n"
-                    L"                    Common options for all roles                      \n"
-                    L"----------------------------------------------------------------------\n"
-                    L"-Port:####\n"
-                    L"   - the port # the server will listen and the client will connect\n"
-                    L"\t- <default> == 4444\n"
-                    L"-Protocol:<tcp,udp>\n"
-                    L"   - the protocol used for connectivity and IO\n"
-                    L"\t- tcp : see -help:TCP for usage options\n"
-                    L"\t- udp : see -help:UDP for usage options\n"
-                    L"-Verify:<connection,data>\n"
-                    L"   - an enumeration to indicate the level of integrity verification\n"
-                    L"\t- <default> == data\n"
-                    L"\t- connection : the integrity of every connection is verified\n"
-                    L"\t             : including the precise # of bytes to send and receive\n"
-                    L"\t- data : the integrity of every received data buffer is verified against the an expected bit-pattern\n"
-                    L"\t       : this validation is a superset of 'connection' integrity validation\n"
-                    L"\n");
-                break;
+            // loop until cannot fine -Options
+            const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+                const auto* const value = ParseArgument(parameter, L"-Options");
+                return value != nullptr;
+                });
 
-            case PrintUsageOption::Tcp:
-                usage.append(L"\n"
-                    L"----------------------------------------------------------------------\n"
-                    L"                    TCP-specific usage options                        \n"
-                    L"----------------------------------------------------------------------\n"
-                    L"-Buffer:#####\n"
-                    L"   - the # of bytes in the buffer used for each send/recv IO\n"
-                    L"\t- <default> == 65536  (each send or recv will post a 64KB buffer)\n"
-                    L"\t- supports range : [low,high]  (each connection will randomly choose a buffer size from within this range)\n"
-                    L"\t  note : Buffer is note required when -Pattern:MediaStream is specified,\n"
-                    L"\t       : FrameSize is the effective buffer size in that traffic pattern\n"
-                    L"-IO:<iocp,rioiocp>\n"
-                    L"   - the API set and usage for processing the protocol pattern\n"
-                    L"\t- <default> == iocp\n"
-                    L"\t- iocp : leverages WSARecv/WSASend using IOCP for async completions\n"
-                    L"\t- rioiocp : registered i/o using an overlapped IOCP for completion notification\n"
-                    L"-Pattern:<push,pull,pushpull,duplex>\n"
-                    L"   - the protocol pattern to send & recv over the TCP connection\n"
-                    L"\t- <default> == push\n"
-                    L"\t- push : client pushes data to server\n"
-                    L"\t- pull : client pulls data from server\n"
-                    L"\t- pushpull : client/server alternates sending/receiving data\n"
-                    L"\t- duplex : client/server sends and receives concurrently throughout the entire connection\n"
-                    L"-PullBytes:#####\n"
-                    L"   - applied only with -Pattern:PushPull - the number of bytes to 'pull'\n"
-                    L"\t- <default> == 1048576 (1MB)\n"
-                    L"\t  note : pullbytes are the bytes received on the client and sent from the server\n"
-                    L"-PushBytes:#####\n"
-                    L"   - applied only with -Pattern:PushPull - the number of bytes to 'push'\n"
-                    L"\t- <default> == 1048576 (1MB)\n"
-                    L"\t  note : pushbytes are the bytes sent from the client and received on the server\n"
-                    L"-RateLimit:#####\n"
-                    L"   - rate limits the number of bytes/sec being *sent* on each individual connection\n"
-                    L"\t- <default> == 0 (no rate limits)\n"
-                    L"\t- supports range : [low,high]  (each connection will randomly choose a rate limit setting from within this range)\n"
-                    L"-Transfer:#####\n"
-                    L"   - the total bytes to transfer per TCP connection\n"
-                    L"\t- <default> == 1073741824  (each connection will transfer a sum total of 1GB)\n"
-                    L"\t- supports range : [low,high]  (each connection will randomly choose a total transfer size send across)\n"
-                    L"\t  note : specifying a range *will* create failures (used to test TCP failures paths)\n"
-                    L"-Shutdown:<graceful,rude>\n"
-                    L"   - controls how clients terminate the TCP connection - note this is a client-only option\n"
-                    L"\t- <default> == graceful\n"
-                    L"\t- graceful : client will initiate a 4-way FIN with the server and wait for the server's FIN\n"
-                    L"\t- rude : client will immediately close the connection once it receives the 'done' response from the server\n"
-                    L"         : this will deliberately tell TCP to linger for zero seconds and close the socket\n"
-                    L"         : this may reesult in a RST instead of a FIN\n"
-                    L"\n");
-                break;
+            if (foundArgument != end(args))
+            {
+                const auto* const value = ParseArgument(*foundArgument, L"-Options");
+                if (ctString::ctOrdinalEqualsCaseInsensative(L"keepalive", value))
+                {
+                    if (ProtocolType::TCP == g_configSettings->Protocol)
+                    {
+                        g_configSettings->Options |= Keepalive;
+                    }
+                    else
+                    {
+                        throw invalid_argument("-Options (keepalive only allowed with TCP sockets)");
+                    }
+                }
+                else if (ctString::ctOrdinalEqualsCaseInsensative(L"tcpfastpath", value))
+                {
+                    if (ProtocolType::TCP == g_configSettings->Protocol)
+                    {
+                        g_configSettings->Options |= LoopbackFastPath;
+                    }
+                    else
+                    {
+                        throw invalid_argument("-Options (tcpfastpath only allowed with TCP sockets)");
+                    }
+                }
+                else if (ctString::ctOrdinalEqualsCaseInsensative(L"tcpfastopen", value))
+                {
+                    if (ProtocolType::TCP == g_configSettings->Protocol)
+                    {
+                        g_configSettings->Options |= TcpFastOpen;
+                    }
+                    else
+                    {
+                        throw invalid_argument("-Options (tcpfastopen only allowed with TCP sockets)");
+                    }
+                }
+                else if (ctString::ctOrdinalEqualsCaseInsensative(L"nodelay", value))
+                {
+                    if (ProtocolType::TCP == g_configSettings->Protocol)
+                    {
+                        g_configSettings->Options |= NoDelay;
+                    }
+                    else
+                    {
+                        throw invalid_argument("-Options (nodelay only allowed with TCP sockets)");
+                    }
+                }
+                else
+                {
+                    throw invalid_argument("-Options");
+                }
 
-            case PrintUsageOption::Udp:
-                usage.append(L"\n"
-                    L"----------------------------------------------------------------------\n"
-                    L"                    UDP-specific usage options                        \n"
-                    L"                                                                      \n"
-                    L"  * UDP datagrams are streamed in a controlled pattern                \n"
-                    L"    similarly to audio/video streaming solutions                      \n"
-                    L"  * In all cases, the client-side receives and server-side sends      \n"
-                    L"    at a fixed bit-rate and frame-size                                \n"
-                    L"----------------------------------------------------------------------\n"
-                    L"-BitsPerSecond:####\n"
-                    L"   - the number of bits per second to stream split across '-FrameRate' # of frames\n"
-                    L"\t- <required>\n"
-                    L"-FrameRate:####\n"
-                    L"   - the number of frames per second being streamed\n"
-                    L"\t- <required>\n"
-                    L"\t  note : for server-side this is the specific frequency that datagrams are sent\n"
-                    L"\t       : for client-side this is the frequency that frames are processed and verified\n"
-                    L"-StreamLength:####\n"
-                    L"   - the total number of seconds to run the entire stream\n"
-                    L"\t- <required>\n"
-                    L"-BufferDepth:####\n"
-                    L"   - the number of seconds to buffer before processing the stream\n"
-                    L"\t- <default> = 1 (second)\n"
-                    L"\t  note : this affects the client-side buffering of frames\n"
-                    L"\t       : this also affects how far the client-side will peek at frames to resend if missing\n"
-                    L"\t       : the client will look ahead at 1/2 the buffer depth to request a resend if missing\n"
-                    L"\n");
+                // always remove the arg from our vector
+                args.erase(foundArgument);
+            }
+            else
+            {
+                // didn't find -Options
                 break;
+            }
+        }
+    }
 
-            case PrintUsageOption::Logging:
-                usage.append(L"\n"
-                    L"----------------------------------------------------------------------\n"
-                    L"                    Logging options                                   \n"
-                    L"----------------------------------------------------------------------\n"
-                    L"Logging in ctsTraffic:\n"
-                    L"Information available to be logged is grouped into 4 basic buckets:\n"
-                    L"  - Connection information : this will write a data point for every successful connection established\n"
-                    L"                             -ConnectionFilename specifies the file written with this data\n"
-                    L"                             the IP address and port tuples for the source and destination will be written\n"
-                    L"                             this will also write a data point at the point of every connection completion\n"
-                    L"                             information unique to the protocol that was used will be included on success\n"
-                    L"  - Error information      : this will write error strings at the point of failure of any connection\n"
-                    L"                             -ErrorFilename specifies the file written with this data\n"
-                    L"                             error information will include the specific point of failure (function that failed)\n"
-                    L"                             as well as which connection the failure occurred (based off of IP address and port)\n"
-                    L"  - Status information     : this will write out status information as applicable to the protocol being used\n"
-                    L"                             -StatusFilename specifies the file written with this data\n"
-                    L"                             the status information will be printed at a frequency set by -StatusUpdate\n"
-                    L"                             the details printed are aggregate values from all connections for that time slice\n"
-                    L"  - Jitter information     : for UDP-patterns only, the jitter logging information will write out data per-datagram\n"
-                    L"                             -JitterFilename specifies the file written with this data\n"
-                    L"                             this information is formatted specifically to calculate jitter between packets\n"
-                    L"                             it follows the same format used with the published tool ntttcp.exe:\n"
-                    L"                             [frame#],[sender.qpc],[sender.qpf],[receiver.qpc],[receiver.qpf]\n"
-                    L"                             - qpc is the result of QueryPerformanceCounter\n"
-                    L"                             - qpf is the result of QueryPerformanceFrequency\n"
-                    L"                             the algorithm to apply to this data can be found on this site under 'Performance Metrics'\n"
-                    L"                             http://msdn.microsoft.com/en-us/library/windows/hardware/dn247504.aspx \n"
-                    L"\n"
-                    L"The format in which the above data is logged is based off of the file extension of the filename specified above\n"
-                    L"  - There are 2 possible file types:\n"
-                    L"\t - txt : plain text format is used with the file extension .txt, or for an unrecognized file extension\n"
-                    L"\t         text output is formatted as one would see it printed to the console in UTF8 format\n"
-                    L"\t - csv : comma-separated value format is used with the file extension .csv\n"
-                    L"\t         information is separated into columns separated by a comma for easier post-processing\n"
-                    L"\t         the column layout of the data is specific to the type of output and protocol being used\n"
-                    L"\t         NOTE: csv formatting will only apply to status updates and jitter, not connection or error information\n"
-                    L"\n"
-                    L"\n"
-                    L"-ConsoleVerbosity:<0-5>\n"
-                    L"\t - logging verbosity for all information to be written to the console\n"
-                    L"\t   <default> == 4\n"
-                    L"\t   - 0 : off (nothing written to the console)\n"
-                    L"\t   - 1 : status updates\n"
-                    L"\t   - 2 : error information only\n"
-                    L"\t   - 3 : connection information only\n"
-                    L"\t   - 4 : connection information + error information\n"
-                    L"\t   - 5 : connection information + error information + status updates\n"
-                    // L"\t   - 6 : above + debug output\n" // Not exposing debug information to users
-                    L"-ConnectionFilename:<filename with/without path>\n"
-                    L"\t - <default> == (not written to a log file)\n"
-                    L"\t   note : the same filename can be specified for the different logging options\n"
-                    L"\t          in which case the same file will receive all the specified details\n"
-                    L"-ErrorFilename:<filename with/without path>\n"
-                    L"\t - <default> == (not written to a log file)\n"
-                    L"\t   note : the same filename can be specified for the different logging options\n"
-                    L"\t          in which case the same file will receive all the specified details\n"
-                    L"-StatusFilename:<filename with/without path>\n"
-                    L"\t - <default> == (not written to a log file)\n"
-                    L"\t   note : the same filename can be specified for the different logging options\n"
-                    L"\t          in which case the same file will receive all the specified details\n"
-                    L"-JitterFilename:<filename with/without path>\n"
-                    L"\t - <default> == (not written to a log file)\n"
-                    L"\t   note : the same filename can be specified for the different logging options\n"
-                    L"\t          in which case the same file will receive all the specified details\n"
-                    L"-StatusUpdate:####\n"
-                    L"\t - the millisecond frequency which real-time status updates are written\n"
-                    L"\t   <default> == 5000 (milliseconds)\n"
-                    L"\n");
-                break;
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses the optional -KeepAliveValue:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForKeepAlive(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-keepalivevalue");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (ProtocolType::TCP == g_configSettings->Protocol)
+            {
+                g_configSettings->KeepAliveValue = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-keepalivevalue"));
+                if (0 == g_configSettings->KeepAliveValue)
+                {
+                    throw invalid_argument("Invalid KeepAliveValue");
+                }
+            }
+            else
+            {
+                throw invalid_argument("-KeepAliveValue is only allowed with TCP sockets");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Reads the frame sizes of a -FrameTrace file : the first (or only) column of each line
+    /// - lines which don't start with a number (e.g. a header line) are skipped
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static vector<unsigned long> ReadFrameTrace(_In_z_ const wchar_t* filename)
+    {
+        const wil::unique_hfile traceFile(CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!traceFile)
+        {
+            THROW_WIN32_MSG(GetLastError(), "CreateFile(-FrameTrace %ws)", filename);
+        }
+        LARGE_INTEGER fileSize{};
+        THROW_IF_WIN32_BOOL_FALSE_MSG(GetFileSizeEx(traceFile.get(), &fileSize), "GetFileSizeEx(-FrameTrace %ws)", filename);
+        if (0 == fileSize.QuadPart)
+        {
+            throw invalid_argument("-FrameTrace (the file is empty)");
+        }
+        if (fileSize.HighPart != 0)
+        {
+            throw invalid_argument("-FrameTrace (the file must be smaller than 4GB)");
+        }
+
+        const wil::unique_handle traceMapping(CreateFileMappingW(traceFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        THROW_LAST_ERROR_IF_NULL_MSG(traceMapping.get(), "CreateFileMapping(-FrameTrace %ws)", filename);
+        const wil::unique_mapview_ptr<char> traceView(static_cast<char*>(MapViewOfFile(traceMapping.get(), FILE_MAP_READ, 0, 0, 0)));
+        THROW_LAST_ERROR_IF_NULL_MSG(traceView.get(), "MapViewOfFile(-FrameTrace %ws)", filename);
+
+        vector<unsigned long> frameSizes;
+        const char* current = traceView.get();
+        const char* const traceEnd = traceView.get() + fileSize.LowPart;
+        while (current < traceEnd)
+        {
+            while (current < traceEnd && (' ' == *current || '\t' == *current))
+            {
+                ++current;
+            }
+            if (current < traceEnd && *current >= '0' && *current <= '9')
+            {
+                unsigned long long frameSize = 0;
+                while (current < traceEnd && *current >= '0' && *current <= '9')
+                {
+                    frameSize = frameSize * 10 + static_cast<unsigned long long>(*current - '0');
+                    if (frameSize > MAXULONG32)
+                    {
+                        throw invalid_argument("-FrameTrace (a frame size exceeds the maximum allowed to be streamed (2^32))");
+                    }
+                    ++current;
+                }
+                frameSizes.push_back(static_cast<unsigned long>(frameSize));
+            }
+            // skip the rest of the line
+            while (current < traceEnd && *current != '\n')
+            {
+                ++current;
+            }
+            if (current < traceEnd)
+            {
+                ++current;
+            }
+        }
+
+        if (frameSizes.empty())
+        {
+            throw invalid_argument("-FrameTrace (no frame sizes were found in the file)");
+        }
+        return frameSizes;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for a variable-bitrate frame size profile for UDP media streams
+    /// - the sizes are relative : they are scaled so the stream still averages -BitsPerSecond
+    /// - the pattern of sizes repeats across the stream, starting with the first frame
+    ///
+    /// -GopPattern:<I, P and B frames> (e.g. IBBPBBPBBPBB)
+    /// -GopPattern:<I, P and B frames>,<I size>,<P size>,<B size> (*default sizes 10,4,1)
+    /// -FrameTrace:<filename> (a trace of frame sizes, one frame per line)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForFrameSizes(vector<const wchar_t*>& args)
+    {
+        const auto foundGopPattern = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-GopPattern");
+            return value != nullptr;
+            });
+        if (foundGopPattern != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::UDP)
+            {
+                throw invalid_argument("-GopPattern requires -Protocol:UDP");
+            }
+
+            const wstring value(ParseArgument(*foundGopPattern, L"-GopPattern"));
+            const auto sizesOffset = value.find(L',');
+            const wstring frameTypes(value.substr(0, sizesOffset));
+            unsigned long frameTypeSizes[3]{ 10, 4, 1 };
+            if (sizesOffset != wstring::npos)
+            {
+                size_t sizeOffset = sizesOffset + 1;
+                for (auto& frameTypeSize : frameTypeSizes)
+                {
+                    if (sizeOffset > value.size())
+                    {
+                        throw invalid_argument("-GopPattern (expected the I, P and B frame sizes)");
+                    }
+                    const auto nextOffset = value.find(L',', sizeOffset);
+                    frameTypeSize = ConvertToIntegral<unsigned long>(value.substr(sizeOffset, nextOffset - sizeOffset));
+                    sizeOffset = nextOffset == wstring::npos ? value.size() + 1 : nextOffset + 1;
+                }
+                if (sizeOffset <= value.size())
+                {
+                    throw invalid_argument("-GopPattern (expected only the I, P and B frame sizes)");
+                }
+            }
+
+            for (const auto frameType : frameTypes)
+            {
+                switch (frameType)
+                {
+                    case L'I':
+                    case L'i':
+                        g_mediaStreamSettings.FrameSizeWeights.push_back(frameTypeSizes[0]);
+                        break;
+                    case L'P':
+                    case L'p':
+                        g_mediaStreamSettings.FrameSizeWeights.push_back(frameTypeSizes[1]);
+                        break;
+                    case L'B':
+                    case L'b':
+                        g_mediaStreamSettings.FrameSizeWeights.push_back(frameTypeSizes[2]);
+                        break;
+                    default:
+                        throw invalid_argument("-GopPattern (frames must be I, P or B)");
+                }
+            }
+            if (g_mediaStreamSettings.FrameSizeWeights.empty())
+            {
+                throw invalid_argument("-GopPattern (no frames were specified)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundGopPattern);
+        }
+
+        const auto foundFrameTrace = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-FrameTrace");
+            return value != nullptr;
+            });
+        if (foundFrameTrace != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::UDP)
+            {
+                throw invalid_argument("-FrameTrace requires -Protocol:UDP");
+            }
+            if (!g_mediaStreamSettings.FrameSizeWeights.empty())
+            {
+                throw invalid_argument("-FrameTrace cannot be used with -GopPattern");
+            }
+
+            g_mediaStreamSettings.FrameSizeWeights = ReadFrameTrace(ParseArgument(*foundFrameTrace, L"-FrameTrace"));
+            // always remove the arg from our vector
+            args.erase(foundFrameTrace);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the wire-Protocol to use
+    /// --- these only apply to TCP
+    ///
+    /// -pattern:push
+    /// -pattern:pull
+    /// -pattern:pushpull
+    /// -pattern:duplex
+    /// -pattern:requestresponse
+    /// -pattern:heartbeat
+    /// --- this only applies to UDP
+    ///
+    /// -pattern:blast
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForIoPattern(vector<const wchar_t*>& args)
+    {
+        auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-pattern");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args) && ctString::ctOrdinalEqualsCaseInsensative(L"blast", ParseArgument(*foundArgument, L"-pattern")))
+        {
+            if (g_configSettings->Protocol != ProtocolType::UDP)
+            {
+                throw invalid_argument("-Pattern:Blast requires -Protocol:UDP");
+            }
+            // the MediaStream protocol without pacing
+            g_configSettings->IoPattern = IoPatternType::MediaStream;
+            g_configSettings->UdpBlast = true;
+
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+        else if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-pattern (only applicable to TCP)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-pattern");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"push", value))
+            {
+                g_configSettings->IoPattern = IoPatternType::Push;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"pull", value))
+            {
+                g_configSettings->IoPattern = IoPatternType::Pull;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"pushpull", value))
+            {
+                g_configSettings->IoPattern = IoPatternType::PushPull;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"flood", value) || ctString::ctOrdinalEqualsCaseInsensative(L"duplex", value))
+            {
+                // the old name for this was 'flood'
+                g_configSettings->IoPattern = IoPatternType::Duplex;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"requestresponse", value))
+            {
+                g_configSettings->IoPattern = IoPatternType::RequestResponse;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"heartbeat", value))
+            {
+                g_configSettings->IoPattern = IoPatternType::Heartbeat;
+            }
+            else
+            {
+                throw invalid_argument("-pattern");
+            }
+
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+        else
+        {
+            if (g_configSettings->Protocol == ProtocolType::UDP)
+            {
+                g_configSettings->IoPattern = IoPatternType::MediaStream;
+            }
+            else
+            {
+                // default the TCP pattern to Push
+                g_configSettings->IoPattern = IoPatternType::Push;
+            }
+        }
+
+        // Now look for options tightly coupled to Protocol
+        const auto foundPushbytes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-pushbytes");
+            return value != nullptr;
+            });
+        if (foundPushbytes != end(args))
+        {
+            if (g_configSettings->IoPattern != IoPatternType::PushPull)
+            {
+                throw invalid_argument("-PushBytes can only be set with -Pattern:PushPull");
+            }
+            g_configSettings->PushBytes = ConvertToIntegral<unsigned long>(ParseArgument(*foundPushbytes, L"-pushbytes"));
+            // always remove the arg from our vector
+            args.erase(foundPushbytes);
+        }
+        else
+        {
+            g_configSettings->PushBytes = c_defaultPushBytes;
+        }
+
+        const auto foundPullbytes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-pullbytes");
+            return value != nullptr;
+            });
+        if (foundPullbytes != end(args))
+        {
+            if (g_configSettings->IoPattern != IoPatternType::PushPull)
+            {
+                throw invalid_argument("-PullBytes can only be set with -Pattern:PushPull");
+            }
+            g_configSettings->PullBytes = ConvertToIntegral<unsigned long>(ParseArgument(*foundPullbytes, L"-pullbytes"));
+            // always remove the arg from our vector
+            args.erase(foundPullbytes);
+        }
+        else
+        {
+            g_configSettings->PullBytes = c_defaultPullBytes;
+        }
+
+        const auto foundRequestBytes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-requestbytes");
+            return value != nullptr;
+            });
+        if (foundRequestBytes != end(args))
+        {
+            if (g_configSettings->IoPattern != IoPatternType::RequestResponse)
+            {
+                throw invalid_argument("-RequestBytes can only be set with -Pattern:RequestResponse");
+            }
+            g_configSettings->RequestBytes = ConvertToIntegral<unsigned long>(ParseArgument(*foundRequestBytes, L"-requestbytes"));
+            if (0 == g_configSettings->RequestBytes)
+            {
+                throw invalid_argument("-RequestBytes must be greater than zero");
+            }
+            // always remove the arg from our vector
+            args.erase(foundRequestBytes);
+        }
+        else
+        {
+            g_configSettings->RequestBytes = c_defaultRequestBytes;
+        }
+
+        const auto foundResponseBytes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-responsebytes");
+            return value != nullptr;
+            });
+        if (foundResponseBytes != end(args))
+        {
+            if (g_configSettings->IoPattern != IoPatternType::RequestResponse)
+            {
+                throw invalid_argument("-ResponseBytes can only be set with -Pattern:RequestResponse");
+            }
+            g_configSettings->ResponseBytes = ConvertToIntegral<unsigned long>(ParseArgument(*foundResponseBytes, L"-responsebytes"));
+            if (0 == g_configSettings->ResponseBytes)
+            {
+                throw invalid_argument("-ResponseBytes must be greater than zero");
+            }
+            // always remove the arg from our vector
+            args.erase(foundResponseBytes);
+        }
+        else
+        {
+            g_configSettings->ResponseBytes = c_defaultResponseBytes;
+        }
+
+        const auto foundPipelineDepth = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-pipelinedepth");
+            return value != nullptr;
+            });
+        if (foundPipelineDepth != end(args))
+        {
+            if (g_configSettings->IoPattern != IoPatternType::RequestResponse)
+            {
+                throw invalid_argument("-PipelineDepth can only be set with -Pattern:RequestResponse");
+            }
+            g_configSettings->PipelineDepth = ConvertToIntegral<unsigned long>(ParseArgument(*foundPipelineDepth, L"-pipelinedepth"));
+            if (0 == g_configSettings->PipelineDepth)
+            {
+                throw invalid_argument("-PipelineDepth must be greater than zero");
+            }
+            // always remove the arg from our vector
+            args.erase(foundPipelineDepth);
+        }
+        else
+        {
+            g_configSettings->PipelineDepth = c_defaultPipelineDepth;
+        }
+
+        auto heartbeatBytes = c_defaultHeartbeatBytes;
+        const auto foundHeartbeatBytes = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-heartbeatbytes");
+            return value != nullptr;
+            });
+        if (foundHeartbeatBytes != end(args))
+        {
+            if (g_configSettings->IoPattern != IoPatternType::Heartbeat)
+            {
+                throw invalid_argument("-HeartbeatBytes can only be set with -Pattern:Heartbeat");
+            }
+            heartbeatBytes = ConvertToIntegral<unsigned long>(ParseArgument(*foundHeartbeatBytes, L"-heartbeatbytes"));
+            if (0 == heartbeatBytes)
+            {
+                throw invalid_argument("-HeartbeatBytes must be greater than zero");
+            }
+            // always remove the arg from our vector
+            args.erase(foundHeartbeatBytes);
+        }
+
+        const auto foundHeartbeatInterval = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-heartbeatinterval");
+            return value != nullptr;
+            });
+        if (foundHeartbeatInterval != end(args))
+        {
+            if (g_configSettings->IoPattern != IoPatternType::Heartbeat)
+            {
+                throw invalid_argument("-HeartbeatInterval can only be set with -Pattern:Heartbeat");
+            }
+            g_configSettings->HeartbeatIntervalMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundHeartbeatInterval, L"-heartbeatinterval"));
+            if (0 == g_configSettings->HeartbeatIntervalMilliseconds)
+            {
+                throw invalid_argument("-HeartbeatInterval must be greater than zero");
+            }
+            // always remove the arg from our vector
+            args.erase(foundHeartbeatInterval);
+        }
+        else if (g_configSettings->IoPattern == IoPatternType::Heartbeat)
+        {
+            g_configSettings->HeartbeatIntervalMilliseconds = c_defaultHeartbeatIntervalMilliseconds;
+        }
+
+        // a heartbeat is a request echoed back by the server, one at a time
+        if (g_configSettings->IoPattern == IoPatternType::Heartbeat)
+        {
+            g_configSettings->RequestBytes = heartbeatBytes;
+            g_configSettings->ResponseBytes = heartbeatBytes;
+            g_configSettings->PipelineDepth = 1;
+        }
+
+        //
+        // Options for the UDP protocol
+        //
+
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-BitsPerSecond");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::UDP)
+            {
+                throw invalid_argument("-BitsPerSecond requires -Protocol:UDP");
+            }
+            if (g_configSettings->UdpBlast)
+            {
+                throw invalid_argument("-BitsPerSecond cannot be used with -Pattern:Blast");
+            }
+            g_mediaStreamSettings.BitsPerSecond = ConvertToIntegral<long long>(ParseArgument(*foundArgument, L"-BitsPerSecond"));
+            // bitspersecond must align on a byte-boundary
+            if (g_mediaStreamSettings.BitsPerSecond % 8 != 0)
+            {
+                g_mediaStreamSettings.BitsPerSecond -= g_mediaStreamSettings.BitsPerSecond % 8;
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-FrameRate");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::UDP)
+            {
+                throw invalid_argument("-FrameRate requires -Protocol:UDP");
+            }
+            if (g_configSettings->UdpBlast)
+            {
+                throw invalid_argument("-FrameRate cannot be used with -Pattern:Blast");
+            }
+            g_mediaStreamSettings.FramesPerSecond = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-FrameRate"));
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-BufferDepth");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::UDP)
+            {
+                throw invalid_argument("-BufferDepth requires -Protocol:UDP");
+            }
+            if (g_configSettings->UdpBlast)
+            {
+                throw invalid_argument("-BufferDepth cannot be used with -Pattern:Blast");
+            }
+            g_mediaStreamSettings.BufferDepthSeconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-BufferDepth"));
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+        else
+        {
+            // default buffer depth to 1
+            g_mediaStreamSettings.BufferDepthSeconds = 1;
+        }
+
+        foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-StreamLength");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::UDP)
+            {
+                throw invalid_argument("-StreamLength requires -Protocol:UDP");
+            }
+            g_mediaStreamSettings.StreamLengthSeconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-StreamLength"));
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+
+        ParseForFrameSizes(args);
+
+        // validate and resolve the UDP protocol options
+        if (g_configSettings->UdpBlast)
+        {
+            if (!g_mediaStreamSettings.FrameSizeWeights.empty())
+            {
+                throw invalid_argument("-GopPattern and -FrameTrace cannot be used with -Pattern:Blast");
+            }
+            if (0 == g_mediaStreamSettings.StreamLengthSeconds)
+            {
+                throw invalid_argument("-StreamLength is required");
+            }
+            // the stream is bounded by -StreamLength : there are no frames to calculate a transfer size from
+        }
+        else if (ProtocolType::UDP == g_configSettings->Protocol)
+        {
+            if (0 == g_mediaStreamSettings.BitsPerSecond)
+            {
+                throw invalid_argument("-BitsPerSecond is required");
+            }
+            if (0 == g_mediaStreamSettings.FramesPerSecond)
+            {
+                throw invalid_argument("-FrameRate is required");
+            }
+            if (0 == g_mediaStreamSettings.StreamLengthSeconds)
+            {
+                throw invalid_argument("-StreamLength is required");
+            }
+
+            // finally calculate the total stream length after all settings are captured from the user
+            g_transferSizeLow = g_mediaStreamSettings.CalculateTransferSize();
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for IP address or machine name target to use
+    /// Can be comma-delimited if more than one
+    ///
+    /// 3 different parameters read address/name settings:
+    /// Supports specifying the parameter multiple times:
+    ///   e.g. -target:machinea -target:machineb
+    ///
+    /// -listen: (address to listen on)
+    ///   - specifying * == listen to all addresses
+    /// -target: (address to connect to)
+    /// -bind:   (address to bind before connecting)
+    ///   - specifying * == bind to all addresses (default)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForAddress(vector<const wchar_t*>& args)
+    {
+        // -listen:<addr> 
+        auto foundListen = begin(args);
+        while (foundListen != end(args))
+        {
+            foundListen = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+                const auto* const value = ParseArgument(parameter, L"-listen");
+                return value != nullptr;
+                });
+            if (foundListen != end(args))
+            {
+                const auto* const value = ParseArgument(*foundListen, L"-listen");
+                if (ctString::ctOrdinalEqualsCaseInsensative(L"*", value))
+                {
+                    // add both v4 and v6
+                    ctSockaddr listenAddr(AF_INET, ctSockaddr::AddressType::Any);
+                    g_configSettings->ListenAddresses.push_back(listenAddr);
+                    listenAddr.set(AF_INET6, ctSockaddr::AddressType::Any);
+                    g_configSettings->ListenAddresses.push_back(listenAddr);
+                }
+                else
+                {
+                    vector<ctSockaddr> tempAddresses(ctSockaddr::ResolveName(value));
+                    if (tempAddresses.empty())
+                    {
+                        throw invalid_argument("-listen value did not resolve to an IP address");
+                    }
+                    g_configSettings->ListenAddresses.insert(end(g_configSettings->ListenAddresses), begin(tempAddresses), end(tempAddresses));
+                }
+                // always remove the arg from our vector
+                args.erase(foundListen);
+                // found_listen is now invalidated since we just erased what it's pointing to
+                // - reset it to begin() since we know it's not end()
+                foundListen = args.begin();
+            }
+        }
+
+        // -target:<addr> 
+        auto foundTarget = begin(args);
+        while (foundTarget != end(args))
+        {
+            foundTarget = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+                const auto* const value = ParseArgument(parameter, L"-target");
+                return value != nullptr;
+                });
+            if (foundTarget != end(args))
+            {
+                if (!g_configSettings->ListenAddresses.empty())
+                {
+                    throw invalid_argument("cannot specify both -Listen and -Target");
+                }
+                const auto* const value = ParseArgument(*foundTarget, L"-target");
+                vector<ctSockaddr> tempAddresses(ctSockaddr::ResolveName(value));
+                if (tempAddresses.empty())
+                {
+                    throw invalid_argument("-target value did not resolve to an IP address");
+                }
+                g_configSettings->TargetAddresses.insert(end(g_configSettings->TargetAddresses), begin(tempAddresses), end(tempAddresses));
+                g_targetAddressCounts.push_back(tempAddresses.size());
+                // always remove the arg from our vector
+                args.erase(foundTarget);
+                // found_target is now invalidated since we just erased what it's pointing to
+                // - reset it to begin() since we know it's not end()
+                foundTarget = args.begin();
+            }
+        }
+
+        // -bind:<addr> 
+        auto foundBind = begin(args);
+        while (foundBind != end(args))
+        {
+            foundBind = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+                const auto* const value = ParseArgument(parameter, L"-bind");
+                return value != nullptr;
+                });
+            if (foundBind != end(args))
+            {
+                const auto* const value = ParseArgument(*foundBind, L"-bind");
+                // check for a comma-delimited list of IP Addresses
+                if (ctString::ctOrdinalEqualsCaseInsensative(L"*", value))
+                {
+                    // add both v4 and v6
+                    ctSockaddr bindAddr(AF_INET, ctSockaddr::AddressType::Any);
+                    g_configSettings->BindAddresses.push_back(bindAddr);
+                    bindAddr.set(AF_INET6, ctSockaddr::AddressType::Any);
+                    g_configSettings->BindAddresses.push_back(bindAddr);
+                }
+                else
+                {
+                    vector<ctSockaddr> tempAddresses(ctSockaddr::ResolveName(value));
+                    if (tempAddresses.empty())
+                    {
+                        throw invalid_argument("-bind value did not resolve to an IP address");
+                    }
+                    g_configSettings->BindAddresses.insert(end(g_configSettings->BindAddresses), begin(tempAddresses), end(tempAddresses));
+                }
+                // always remove the arg from our vector
+                args.erase(foundBind);
+                // found_bind is now invalidated since we just erased what it's pointing to
+                // - reset it to begin() since we know it's not end()
+                foundBind = args.begin();
+            }
+        }
+
+        if (!g_configSettings->ListenAddresses.empty() && !g_configSettings->TargetAddresses.empty())
+        {
+            throw invalid_argument("cannot specify both -target and -listen");
+        }
+        if (!g_configSettings->ListenAddresses.empty() && !g_configSettings->BindAddresses.empty())
+        {
+            throw invalid_argument("cannot specify both -bind and -listen");
+        }
+        if (g_configSettings->ListenAddresses.empty() && g_configSettings->TargetAddresses.empty())
+        {
+            throw invalid_argument("must specify either -target or -listen");
+        }
+
+        // default bind addresses if not listening and did not exclusively want to bind
+        if (g_configSettings->ListenAddresses.empty() && g_configSettings->BindAddresses.empty())
+        {
+            ctSockaddr defaultAddr(AF_INET, ctSockaddr::AddressType::Any);
+            g_configSettings->BindAddresses.push_back(defaultAddr);
+            defaultAddr.set(AF_INET6, ctSockaddr::AddressType::Any);
+            g_configSettings->BindAddresses.push_back(defaultAddr);
+        }
+
+        if (!g_configSettings->TargetAddresses.empty())
+        {
+            //
+            // guarantee that bindaddress and targetaddress families can match
+            // - can't allow a bind address to be chosen if there are no TargetAddresses with the same family
+            //
+            ctsUnsignedLong bindV4 = 0;
+            ctsUnsignedLong bindV6 = 0;
+            ctsUnsignedLong targetV4 = 0;
+            ctsUnsignedLong targetV6 = 0;
+            for (const auto& addr : g_configSettings->BindAddresses)
+            {
+                if (addr.family() == AF_INET)
+                {
+                    ++bindV4;
+                }
+                else
+                {
+                    ++bindV6;
+                }
+            }
+            for (const auto& addr : g_configSettings->TargetAddresses)
+            {
+                if (addr.family() == AF_INET)
+                {
+                    ++targetV4;
+                }
+                else
+                {
+                    ++targetV6;
+                }
+            }
+            //
+            // if either bind or target has zero of either family, remove those addrs from the other vector
+            //
+            if (0 == bindV4)
+            {
+                g_configSettings->TargetAddresses.erase(
+                    remove_if(
+                        begin(g_configSettings->TargetAddresses),
+                        end(g_configSettings->TargetAddresses),
+                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET; }),
+                    end(g_configSettings->TargetAddresses)
+                );
+            }
+            else if (0 == targetV4)
+            {
+                g_configSettings->BindAddresses.erase(
+                    remove_if(
+                        begin(g_configSettings->BindAddresses),
+                        end(g_configSettings->BindAddresses),
+                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET; }),
+                    end(g_configSettings->BindAddresses)
+                );
+            }
+
+            if (0 == bindV6)
+            {
+                g_configSettings->TargetAddresses.erase(
+                    remove_if(
+                        begin(g_configSettings->TargetAddresses),
+                        end(g_configSettings->TargetAddresses),
+                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET6; }),
+                    end(g_configSettings->TargetAddresses)
+                );
+            }
+            else if (0 == targetV6)
+            {
+                g_configSettings->BindAddresses.erase(
+                    remove_if(
+                        begin(g_configSettings->BindAddresses),
+                        end(g_configSettings->BindAddresses),
+                        [](const ctSockaddr& addr) noexcept { return addr.family() == AF_INET6; }),
+                    end(g_configSettings->BindAddresses)
+                );
+            }
+            //
+            // now if either are of size zero, the user specified addresses which didn't align
+            //
+            if (g_configSettings->BindAddresses.empty() || g_configSettings->TargetAddresses.empty())
+            {
+                throw invalid_argument("-bind addresses and target addresses must match families");
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the Port # to listen to/connect to
+    ///
+    /// -Port:##
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForPort(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-Port");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            g_configSettings->Port = ConvertToIntegral<WORD>(ParseArgument(*foundArgument, L"-Port"));
+            if (0 == g_configSettings->Port)
+            {
+                throw invalid_argument("-Port");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Reads one value of a -LoadProfile segment
+    ///
+    /// ####        : constant for the segment
+    /// ####-####   : a linear ramp across the segment
+    /// ####/####:## : alternating between both values every half of ## milliseconds
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static long long ReadLoadProfileNumber(const string& text, size_t lineNumber)
+    {
+        if (text.empty() || text.size() > 18 || text.find_first_not_of("0123456789") != string::npos)
+        {
+            throw invalid_argument("-LoadProfile (line " + to_string(lineNumber) + ": '" + text + "' is not a number)");
+        }
+        return stoll(text);
+    }
+
+    static LoadProfileValue ReadLoadProfileValue(const string& text, size_t lineNumber)
+    {
+        LoadProfileValue value;
+        const auto alternate = text.find('/');
+        const auto ramp = text.find('-');
+        if (alternate != string::npos)
+        {
+            const auto period = text.find(':', alternate);
+            if (period == string::npos)
+            {
+                throw invalid_argument("-LoadProfile (line " + to_string(lineNumber) + ": '" + text + "' requires a period - ####/####:##)");
+            }
+            value.m_from = ReadLoadProfileNumber(text.substr(0, alternate), lineNumber);
+            value.m_to = ReadLoadProfileNumber(text.substr(alternate + 1, period - alternate - 1), lineNumber);
+            value.m_periodMilliseconds = ReadLoadProfileNumber(text.substr(period + 1), lineNumber);
+            if (value.m_periodMilliseconds < 2)
+            {
+                throw invalid_argument("-LoadProfile (line " + to_string(lineNumber) + ": the period must be at least 2 milliseconds)");
+            }
+        }
+        else if (ramp != string::npos)
+        {
+            value.m_from = ReadLoadProfileNumber(text.substr(0, ramp), lineNumber);
+            value.m_to = ReadLoadProfileNumber(text.substr(ramp + 1), lineNumber);
+            value.m_ramp = true;
+        }
+        else
+        {
+            value.m_from = ReadLoadProfileNumber(text, lineNumber);
+            value.m_to = value.m_from;
+        }
+        return value;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Reads the segments of a -LoadProfile file : one segment per line
+    /// - <duration ms> <connections> <bytes/second/connection>
+    /// - '#' starts a comment, blank lines are skipped
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static vector<LoadProfileSegment> ReadLoadProfile(_In_z_ const wchar_t* filename)
+    {
+        const wil::unique_hfile profileFile(CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!profileFile)
+        {
+            THROW_WIN32_MSG(GetLastError(), "CreateFile(-LoadProfile %ws)", filename);
+        }
+        LARGE_INTEGER fileSize{};
+        THROW_IF_WIN32_BOOL_FALSE_MSG(GetFileSizeEx(profileFile.get(), &fileSize), "GetFileSizeEx(-LoadProfile %ws)", filename);
+        if (0 == fileSize.QuadPart)
+        {
+            throw invalid_argument("-LoadProfile (the file is empty)");
+        }
+        if (fileSize.QuadPart > 1024 * 1024)
+        {
+            throw invalid_argument("-LoadProfile (the file must be smaller than 1MB)");
+        }
+
+        string profileText(static_cast<size_t>(fileSize.QuadPart), '\0');
+        DWORD bytesRead{};
+        THROW_IF_WIN32_BOOL_FALSE_MSG(
+            ReadFile(profileFile.get(), profileText.data(), fileSize.LowPart, &bytesRead, nullptr),
+            "ReadFile(-LoadProfile %ws)", filename);
+        profileText.resize(bytesRead);
+
+        vector<LoadProfileSegment> segments;
+        size_t lineNumber = 0;
+        size_t lineStart = 0;
+        while (lineStart < profileText.size())
+        {
+            ++lineNumber;
+            auto lineEnd = profileText.find('\n', lineStart);
+            if (lineEnd == string::npos)
+            {
+                lineEnd = profileText.size();
+            }
+            auto line = profileText.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+
+            const auto comment = line.find('#');
+            if (comment != string::npos)
+            {
+                line.resize(comment);
+            }
+            vector<string> fields;
+            size_t fieldStart = line.find_first_not_of(" \t\r");
+            while (fieldStart != string::npos)
+            {
+                const auto fieldEnd = line.find_first_of(" \t\r", fieldStart);
+                fields.push_back(line.substr(fieldStart, fieldEnd == string::npos ? string::npos : fieldEnd - fieldStart));
+                fieldStart = fieldEnd == string::npos ? string::npos : line.find_first_not_of(" \t\r", fieldEnd);
+            }
+            if (fields.empty())
+            {
+                continue;
+            }
+            if (fields.size() != 3)
+            {
+                throw invalid_argument("-LoadProfile (line " + to_string(lineNumber) + ": expected <duration ms> <connections> <bytes/second>)");
+            }
+
+            LoadProfileSegment segment;
+            segment.m_durationMilliseconds = ReadLoadProfileNumber(fields[0], lineNumber);
+            if (0 == segment.m_durationMilliseconds)
+            {
+                throw invalid_argument("-LoadProfile (line " + to_string(lineNumber) + ": the duration must be greater than zero)");
+            }
+            segment.m_connections = ReadLoadProfileValue(fields[1], lineNumber);
+            segment.m_bytesPerSecond = ReadLoadProfileValue(fields[2], lineNumber);
+            segments.push_back(segment);
+        }
+
+        if (segments.empty())
+        {
+            throw invalid_argument("-LoadProfile (no segments were found in the file)");
+        }
+        return segments;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for a profile of connection targets and rate limits over the run
+    ///
+    /// -LoadProfile:<file>
+    ///
+    /// - must be parsed before -Connections and -RateLimit : the profile replaces both
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForLoadProfile(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-LoadProfile");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-LoadProfile is only supported with TCP (the rate of a MediaStream is set by its server)");
+            }
+            if (IsListening())
+            {
+                throw invalid_argument("-LoadProfile is only supported when running as a client");
+            }
+
+            g_loadProfile = ReadLoadProfile(ParseArgument(*foundArgument, L"-LoadProfile"));
+            long long maxConnections = 0;
+            for (const auto& segment : g_loadProfile)
+            {
+                g_loadProfileDurationMilliseconds += segment.m_durationMilliseconds;
+                maxConnections = std::max<long long>(maxConnections, std::max<long long>(segment.m_connections.m_from, segment.m_connections.m_to));
+            }
+            if (0 == maxConnections || maxConnections > MAXLONG)
+            {
+                throw invalid_argument("-LoadProfile (the connections must be greater than zero and less than 2^31 in at least one segment)");
+            }
+            if (g_loadProfileDurationMilliseconds > MAXLONG)
+            {
+                throw invalid_argument("-LoadProfile (the segments must total less than 2^31 milliseconds)");
+            }
+
+            // the connection limit is the most the profile will ever ask for
+            g_configSettings->ConnectionLimit = static_cast<unsigned long>(maxConnections);
+            g_configSettings->LoadProfile = true;
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the connection limit [max number of connections to maintain]
+    ///
+    /// -connections:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForConnections(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-connections");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (IsListening())
+            {
+                throw invalid_argument("-Connections is only supported when running as a client");
+            }
+            if (g_configSettings->LoadProfile)
+            {
+                throw invalid_argument("-Connections cannot be used with -LoadProfile (the profile sets the connections)");
+            }
+            g_configSettings->ConnectionLimit = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-connections"));
+            if (0 == g_configSettings->ConnectionLimit)
+            {
+                throw invalid_argument("-connections");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the server limit [max number of connections before the server exits]
+    ///
+    /// -ServerExitLimit:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForServerExitLimit(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ServerExitLimit");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (!IsListening())
+            {
+                throw invalid_argument("-ServerExitLimit is only supported when running as a client");
+            }
+            g_configSettings->ServerExitLimit = ConvertToIntegral<ULONGLONG>(ParseArgument(*foundArgument, L"-ServerExitLimit"));
+            if (0 == g_configSettings->ServerExitLimit)
+            {
+                // zero indicates no exit
+                g_configSettings->ServerExitLimit = MAXULONGLONG;
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the connection limit [max number of connections to maintain]
+    ///
+    /// -throttleconnections:####
+    ///                     :auto
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForThrottleConnections(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-throttleconnections");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (IsListening())
+            {
+                throw invalid_argument("-ThrottleConnections is only supported when running as a client");
+            }
+            const auto* const value = ParseArgument(*foundArgument, L"-throttleconnections");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"auto", value))
+            {
+                g_configSettings->AdaptiveConnectionThrottle = true;
+            }
+            else
+            {
+                g_configSettings->ConnectionThrottleLimit = ConvertToIntegral<unsigned long>(value);
+            }
+            if (0 == g_configSettings->ConnectionThrottleLimit)
+            {
+                // zero means no limit
+                g_configSettings->ConnectionThrottleLimit = MAXUINT32;
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    template <typename T>
+    void ReadRangeValues(_In_z_ const wchar_t* value, T& outLow, T& outHigh)
+    {
+        // a range was specified
+        // - find the ',' the '[', and the ']'
+        const auto valueLength = wcslen(value);
+        const auto* const valueEnd = value + valueLength;
+        if (valueLength < 5 || value[0] != L'[' || value[valueLength - 1] != L']')
+        {
+            throw invalid_argument("range value [###,###]");
+        }
+        const auto* const commaDelimiter = find(value, valueEnd, L',');
+        if (!(valueEnd > commaDelimiter + 1))
+        {
+            throw invalid_argument("range value [###,###]");
+        }
+
+        // null-terminate the first number at the delimiter to do a string -> int conversion
+        *const_cast<wchar_t*>(commaDelimiter) = L'\0';
+        const auto* const valueLow = value + 1; // move past the '['
+        outLow = ConvertToIntegral<T>(valueLow);
+
+        // null-terminate for the 2nd number over the last ']' to doa string -> int conversion
+        const_cast<wchar_t*>(value)[valueLength - 1] = L'\0';
+        const auto* const valueHigh = commaDelimiter + 1;
+        outHigh = ConvertToIntegral<T>(valueHigh);
+
+        // validate buffer values
+        if (outHigh < outLow)
+        {
+            throw invalid_argument("range value [###,###]");
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the buffer size to push down per IO
+    ///
+    /// -buffer:####
+    ///        :[low,high]
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForBuffer(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-buffer");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::TCP && !g_configSettings->UdpBlast)
+            {
+                throw invalid_argument("-buffer (only applicable to TCP and -Pattern:Blast)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-buffer");
+            if (value[0] == L'[')
+            {
+                ReadRangeValues(value, g_bufferSizeLow, g_bufferSizeHigh);
+            }
+            else
+            {
+                // singe values are written to s_BufferSizeLow, with s_BufferSizeHigh left at zero
+                g_bufferSizeLow = ConvertToIntegral<unsigned long>(value);
+            }
+            if (0 == g_bufferSizeLow)
+            {
+                throw invalid_argument("-buffer");
+            }
+
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+        else
+        {
+            g_bufferSizeLow = g_configSettings->UdpBlast ? c_defaultBlastDatagramSize : c_defaultBufferSize;
+            g_bufferSizeHigh = 0;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the total transfer size in bytes per connection
+    ///
+    /// -transfer:####
+    ///          :[low,high]
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForTransfer(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-transfer");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-transfer (only applicable to TCP)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-transfer");
+            if (value[0] == L'[')
+            {
+                ReadRangeValues(value, g_transferSizeLow, g_transferSizeHigh);
+            }
+            else
+            {
+                // singe values are written to s_TransferSizeLow, with s_TransferSizeHigh left at zero
+                g_transferSizeLow = ConvertToIntegral<unsigned long long>(value);
+            }
+            if (0 == g_transferSizeLow)
+            {
+                throw invalid_argument("-transfer");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the LocalPort # to bind for local connect
+    /// 
+    /// -LocalPort:##
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForLocalport(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-LocalPort");
+            return value != nullptr;
+            });
+
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-LocalPort");
+            if (value[0] == L'[')
+            {
+                ReadRangeValues(value, g_configSettings->LocalPortLow, g_configSettings->LocalPortHigh);
+            }
+            else
+            {
+                // single value are written to localport_low with localport_high left at zero
+                g_configSettings->LocalPortHigh = 0;
+                g_configSettings->LocalPortLow = ConvertToIntegral<unsigned short>(value);
+            }
+            if (0 == g_configSettings->LocalPortLow)
+            {
+                throw invalid_argument("-LocalPort");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for a runtime port reservation for outgoing connections
+    ///
+    /// -PortReservation:####
+    ///                 :on
+    ///
+    /// - must be parsed after -LocalPort : 'on' reserves the -LocalPort range
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForPortReservation(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-PortReservation");
+            return value != nullptr;
+            });
+
+        if (foundArgument != end(args))
+        {
+            if (IsListening())
+            {
+                throw invalid_argument("-PortReservation is only supported when running as a client");
+            }
+            const auto* const value = ParseArgument(*foundArgument, L"-PortReservation");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                if (0 == g_configSettings->LocalPortHigh)
+                {
+                    throw invalid_argument("-PortReservation:on requires -LocalPort:[low,high] : the range of ports to reserve");
+                }
+                g_configSettings->PortReservationSize = g_configSettings->LocalPortHigh - g_configSettings->LocalPortLow + 1UL;
+            }
+            else
+            {
+                if (g_configSettings->LocalPortLow != 0)
+                {
+                    throw invalid_argument("-PortReservation:#### cannot be used with -LocalPort (use -PortReservation:on to reserve the -LocalPort range)");
+                }
+                g_configSettings->PortReservationSize = ConvertToIntegral<unsigned long>(value);
+                if (0 == g_configSettings->PortReservationSize || g_configSettings->PortReservationSize > 0xffff)
+                {
+                    throw invalid_argument("-PortReservation");
+                }
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for an explicitly specified interface index for outgoing connections
+    /// 
+    /// -IfIndex:##
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForIfIndex(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-IfIndex");
+            return value != nullptr;
+            });
+
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-IfIndex");
+            g_configSettings->OutgoingIfIndex = ConvertToIntegral<unsigned long>(value);
+
+            if (0 == g_configSettings->OutgoingIfIndex)
+            {
+                throw invalid_argument("-IfIndex");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for Tcp throttling parameters
+    ///
+    /// -RateLimit:####
+    ///           :[low,high]
+    /// -RateLimitPeriod:####
+    /// -RateLimitPacing:<on,off>
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForRatelimit(vector<const wchar_t*>& args)
+    {
+        const auto foundRatelimit = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-RateLimit");
+            return value != nullptr;
+            });
+        if (foundRatelimit != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-RateLimit (only applicable to TCP)");
+            }
+            if (g_configSettings->LoadProfile)
+            {
+                throw invalid_argument("-RateLimit cannot be used with -LoadProfile (the profile sets the rate limit)");
+            }
+            const auto* const value = ParseArgument(*foundRatelimit, L"-RateLimit");
+            if (value[0] == L'[')
+            {
+                ReadRangeValues(value, g_rateLimitLow, g_rateLimitHigh);
+            }
+            else
+            {
+                // singe values are written to s_BufferSizeLow, with s_BufferSizeHigh left at zero
+                g_rateLimitLow = ConvertToIntegral<long long>(ParseArgument(*foundRatelimit, L"-RateLimit"));
+            }
+            if (0LL == g_rateLimitLow)
+            {
+                throw invalid_argument("-RateLimit");
+            }
+            // always remove the arg from our vector
+            args.erase(foundRatelimit);
+        }
+
+        const auto foundRatelimitPeriod = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-RateLimitPeriod");
+            return value != nullptr;
+            });
+        if (foundRatelimitPeriod != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-RateLimitPeriod (only applicable to TCP)");
+            }
+            if (0LL == g_rateLimitLow && !g_configSettings->LoadProfile)
+            {
+                throw invalid_argument("-RateLimitPeriod requires specifying -RateLimit or -LoadProfile");
+            }
+            g_configSettings->TcpBytesPerSecondPeriod = ConvertToIntegral<long long>(ParseArgument(*foundRatelimitPeriod, L"-RateLimitPeriod"));
+            // always remove the arg from our vector
+            args.erase(foundRatelimitPeriod);
+        }
+
+        const auto foundRatelimitPacing = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-RateLimitPacing");
+            return value != nullptr;
+            });
+        if (foundRatelimitPacing != end(args))
+        {
+            if (0LL == g_rateLimitLow && !g_configSettings->LoadProfile)
+            {
+                throw invalid_argument("-RateLimitPacing requires specifying -RateLimit or -LoadProfile");
+            }
+            const auto* const value = ParseArgument(*foundRatelimitPacing, L"-RateLimitPacing");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->RateLimitPacing = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->RateLimitPacing = false;
+            }
+            else
+            {
+                throw invalid_argument("-RateLimitPacing");
+            }
+            // always remove the arg from our vector
+            args.erase(foundRatelimitPacing);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the total # of iterations
+    ///
+    /// -Iterations:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForIterations(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-Iterations");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (IsListening())
+            {
+                throw invalid_argument("-Iterations is only supported when running as a client");
+            }
+            g_configSettings->Iterations = ConvertToIntegral<ULONGLONG>(ParseArgument(*foundArgument, L"-Iterations"));
+            if (0 == g_configSettings->Iterations)
+            {
+                g_configSettings->Iterations = MAXULONGLONG;
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the verbosity level
+    ///
+    /// -ConsoleVerbosity:## <0-6>
+    /// -StatusUpdate:####
+    /// -StatsSharedMemory:<name>
+    /// -WorkerStatsSharedMemory:<name> (set by the -Workers front end on the processes it starts)
+    /// -CheckpointFilename:<filename>
+    /// -CheckpointInterval:####
+    /// -ThreadStatistics:<on,off>
+    /// -HostConfiguration:<on,off>
+    /// -MemoryAccounting:<on,off>
+    /// -ConnectionLog:<full,aggregate>
+    /// -ConnectionLogSamples:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForLogging(vector<const wchar_t*>& args)
+    {
+        const auto foundVerbosity = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ConsoleVerbosity");
+            return value != nullptr;
+            });
+        if (foundVerbosity != end(args))
+        {
+            g_consoleVerbosity = ConvertToIntegral<unsigned long>(ParseArgument(*foundVerbosity, L"-ConsoleVerbosity"));
+            if (g_consoleVerbosity > 6)
+            {
+                throw invalid_argument("-ConsoleVerbosity");
+            }
+            // always remove the arg from our vector
+            args.erase(foundVerbosity);
+        }
+
+        const auto foundStatusUpdate = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-StatusUpdate");
+            return value != nullptr;
+            });
+        if (foundStatusUpdate != end(args))
+        {
+            g_configSettings->StatusUpdateFrequencyMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundStatusUpdate, L"-StatusUpdate"));
+            if (0 == g_configSettings->StatusUpdateFrequencyMilliseconds)
+            {
+                throw invalid_argument("-StatusUpdate");
+            }
+            // always remove the arg from our vector
+            args.erase(foundStatusUpdate);
+        }
+
+        const auto foundStatsSharedMemory = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-StatsSharedMemory");
+            return value != nullptr;
+            });
+        if (foundStatsSharedMemory != end(args))
+        {
+            g_configSettings->StatsSharedMemoryName = ParseArgument(*foundStatsSharedMemory, L"-StatsSharedMemory");
+            if (0 == wcslen(g_configSettings->StatsSharedMemoryName))
+            {
+                throw invalid_argument("-StatsSharedMemory");
+            }
+            // always remove the arg from our vector
+            args.erase(foundStatsSharedMemory);
+        }
+
+        // only given to the worker processes started with -Workers : the region was created by the front end
+        const auto foundWorkerStatsSharedMemory = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-WorkerStatsSharedMemory");
+            return value != nullptr;
+            });
+        if (foundWorkerStatsSharedMemory != end(args))
+        {
+            g_configSettings->WorkerStatsSharedMemoryName = ParseArgument(*foundWorkerStatsSharedMemory, L"-WorkerStatsSharedMemory");
+            if (g_configSettings->StatsSharedMemoryName || 0 == wcslen(g_configSettings->WorkerStatsSharedMemoryName))
+            {
+                throw invalid_argument("-WorkerStatsSharedMemory");
+            }
+            // always remove the arg from our vector
+            args.erase(foundWorkerStatsSharedMemory);
+        }
+
+        const auto foundCheckpointFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-CheckpointFilename");
+            return value != nullptr;
+            });
+        if (foundCheckpointFilename != end(args))
+        {
+            g_configSettings->CheckpointFilename = ParseArgument(*foundCheckpointFilename, L"-CheckpointFilename");
+            if (0 == wcslen(g_configSettings->CheckpointFilename))
+            {
+                throw invalid_argument("-CheckpointFilename");
+            }
+            g_configSettings->CheckpointIntervalMilliseconds = c_defaultCheckpointIntervalMilliseconds;
+            // always remove the arg from our vector
+            args.erase(foundCheckpointFilename);
+        }
+
+        const auto foundCheckpointInterval = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-CheckpointInterval");
+            return value != nullptr;
+            });
+        if (foundCheckpointInterval != end(args))
+        {
+            if (!g_configSettings->CheckpointFilename)
+            {
+                throw invalid_argument("-CheckpointInterval requires -CheckpointFilename");
+            }
+            g_configSettings->CheckpointIntervalMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundCheckpointInterval, L"-CheckpointInterval"));
+            if (g_configSettings->CheckpointIntervalMilliseconds < c_minimumCheckpointIntervalMilliseconds)
+            {
+                throw invalid_argument("-CheckpointInterval (must be at least 1000 milliseconds)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundCheckpointInterval);
+        }
+
+        const auto foundThreadStatistics = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ThreadStatistics");
+            return value != nullptr;
+            });
+        if (foundThreadStatistics != end(args))
+        {
+            const auto* const value = ParseArgument(*foundThreadStatistics, L"-ThreadStatistics");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->PrintThreadStatistics = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->PrintThreadStatistics = false;
+            }
+            else
+            {
+                throw invalid_argument("-ThreadStatistics");
+            }
+            // always remove the arg from our vector
+            args.erase(foundThreadStatistics);
+        }
+
+        const auto foundHostConfiguration = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-HostConfiguration");
+            return value != nullptr;
+            });
+        if (foundHostConfiguration != end(args))
+        {
+            const auto* const value = ParseArgument(*foundHostConfiguration, L"-HostConfiguration");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->RecordHostConfiguration = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->RecordHostConfiguration = false;
+            }
+            else
+            {
+                throw invalid_argument("-HostConfiguration");
+            }
+            // always remove the arg from our vector
+            args.erase(foundHostConfiguration);
+        }
+
+        const auto foundMemoryAccounting = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-MemoryAccounting");
+            return value != nullptr;
+            });
+        if (foundMemoryAccounting != end(args))
+        {
+            const auto* const value = ParseArgument(*foundMemoryAccounting, L"-MemoryAccounting");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->AccountConnectionMemory = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->AccountConnectionMemory = false;
+            }
+            else
+            {
+                throw invalid_argument("-MemoryAccounting");
+            }
+            // always remove the arg from our vector
+            args.erase(foundMemoryAccounting);
+        }
+
+        const auto foundConnectionLog = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ConnectionLog");
+            return value != nullptr;
+            });
+        if (foundConnectionLog != end(args))
+        {
+            const auto* const value = ParseArgument(*foundConnectionLog, L"-ConnectionLog");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"full", value))
+            {
+                g_configSettings->ConnectionLogAggregate = false;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"aggregate", value))
+            {
+                g_configSettings->ConnectionLogAggregate = true;
+            }
+            else
+            {
+                throw invalid_argument("-ConnectionLog");
+            }
+            // always remove the arg from our vector
+            args.erase(foundConnectionLog);
+        }
+
+        const auto foundConnectionLogSamples = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ConnectionLogSamples");
+            return value != nullptr;
+            });
+        if (foundConnectionLogSamples != end(args))
+        {
+            if (!g_configSettings->ConnectionLogAggregate)
+            {
+                throw invalid_argument("-ConnectionLogSamples requires -ConnectionLog:aggregate");
+            }
+            g_configSettings->ConnectionLogSamples = ConvertToIntegral<unsigned long>(ParseArgument(*foundConnectionLogSamples, L"-ConnectionLogSamples"));
+            // always remove the arg from our vector
+            args.erase(foundConnectionLogSamples);
+        }
+
+        wstring connectionFilename;
+        wstring errorFilename;
+        wstring statusFilename;
+        wstring jitterFilename;
+        wstring jitterSummaryFilename;
+        wstring histogramFilename;
+
+        const auto foundConnectionFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ConnectionFilename");
+            return value != nullptr;
+            });
+        if (foundConnectionFilename != end(args))
+        {
+            connectionFilename = ParseArgument(*foundConnectionFilename, L"-ConnectionFilename");
+            // always remove the arg from our vector
+            args.erase(foundConnectionFilename);
+        }
+
+        const auto foundErrorFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ErrorFilename");
+            return value != nullptr;
+            });
+        if (foundErrorFilename != end(args))
+        {
+            errorFilename = ParseArgument(*foundErrorFilename, L"-ErrorFilename");
+            // always remove the arg from our vector
+            args.erase(foundErrorFilename);
+        }
+
+        const auto foundStatusFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-StatusFilename");
+            return value != nullptr;
+            });
+        if (foundStatusFilename != end(args))
+        {
+            statusFilename = ParseArgument(*foundStatusFilename, L"-StatusFilename");
+            // always remove the arg from our vector
+            args.erase(foundStatusFilename);
+        }
+
+        const auto foundJitterFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-JitterFilename");
+            return value != nullptr;
+            });
+        if (foundJitterFilename != end(args))
+        {
+            jitterFilename = ParseArgument(*foundJitterFilename, L"-JitterFilename");
+            // always remove the arg from our vector
+            args.erase(foundJitterFilename);
+        }
+
+        const auto foundJitterSummaryFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-JitterSummaryFilename");
+            return value != nullptr;
+            });
+        if (foundJitterSummaryFilename != end(args))
+        {
+            jitterSummaryFilename = ParseArgument(*foundJitterSummaryFilename, L"-JitterSummaryFilename");
+            // always remove the arg from our vector
+            args.erase(foundJitterSummaryFilename);
+        }
+
+        const auto foundHistogramFilename = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-HistogramFilename");
+            return value != nullptr;
+            });
+        if (foundHistogramFilename != end(args))
+        {
+            histogramFilename = ParseArgument(*foundHistogramFilename, L"-HistogramFilename");
+            // always remove the arg from our vector
+            args.erase(foundHistogramFilename);
+        }
+
+        // since CSV files each have their own header, we cannot allow the same CSV filename to be used
+        // for different loggers, as opposed to txt files, which can be shared across different loggers
+        // - binary logs (.ctsb) have fixed-size records of a single type, and likewise cannot be shared
+
+        const auto isBinaryLog = [](const wstring& filename) { return ctString::ctOrdinalEndsWithCaseInsensative(filename, L".ctsb"); };
+        if (isBinaryLog(errorFilename) || isBinaryLog(statusFilename))
+        {
+            throw invalid_argument("Only the connection and jitter logfiles can be of binary (.ctsb) format");
+        }
+        if (isBinaryLog(connectionFilename) &&
+            (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, errorFilename) ||
+             ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, statusFilename) ||
+             ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, jitterFilename)))
+        {
+            throw invalid_argument("The same binary filename cannot be used for different loggers");
+        }
+
+        if (!connectionFilename.empty())
+        {
+            if (isBinaryLog(connectionFilename))
+            {
+                g_binaryConnectionLogger = make_unique<ctsBinaryLogger>(connectionFilename.c_str(), ctsBinaryLogRecordType::Connection);
+            }
+            else if (ctString::ctOrdinalEndsWithCaseInsensative(connectionFilename, L".csv"))
+            {
+                g_connectionLogger = make_shared<ctsTextLogger>(connectionFilename.c_str(), StatusFormatting::Csv);
+            }
+            else
+            {
+                g_connectionLogger = make_shared<ctsTextLogger>(connectionFilename.c_str(), StatusFormatting::ClearText);
+            }
+        }
+
+        if (!errorFilename.empty())
+        {
+            if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, errorFilename))
+            {
+                if (g_connectionLogger->IsCsvFormat())
+                {
+                    throw invalid_argument("The error logfile cannot be of csv format");
+                }
+                g_errorLogger = g_connectionLogger;
+            }
+            else
+            {
+                if (ctString::ctOrdinalEndsWithCaseInsensative(errorFilename, L".csv"))
+                {
+                    throw invalid_argument("The error logfile cannot be of csv format");
+                }
+                g_errorLogger = make_shared<ctsTextLogger>(errorFilename.c_str(), StatusFormatting::ClearText);
+            }
+        }
+
+        if (!statusFilename.empty())
+        {
+            if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, statusFilename))
+            {
+                if (g_connectionLogger->IsCsvFormat())
+                {
+                    throw invalid_argument("The same csv filename cannot be used for different loggers");
+                }
+                g_statusLogger = g_connectionLogger;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(errorFilename, statusFilename))
+            {
+                if (g_errorLogger->IsCsvFormat())
+                {
+                    throw invalid_argument("The same csv filename cannot be used for different loggers");
+                }
+                g_statusLogger = g_errorLogger;
+            }
+            else
+            {
+                if (ctString::ctOrdinalEndsWithCaseInsensative(statusFilename, L".csv"))
+                {
+                    g_statusLogger = make_shared<ctsTextLogger>(statusFilename.c_str(), StatusFormatting::Csv);
+                }
+                else
+                {
+                    g_statusLogger = make_shared<ctsTextLogger>(statusFilename.c_str(), StatusFormatting::ClearText);
+                }
+            }
+        }
+
+        if (!jitterFilename.empty())
+        {
+            if (isBinaryLog(jitterFilename))
+            {
+                g_binaryJitterLogger = make_unique<ctsBinaryLogger>(jitterFilename.c_str(), ctsBinaryLogRecordType::Jitter);
+            }
+            else if (ctString::ctOrdinalEndsWithCaseInsensative(jitterFilename, L".csv"))
+            {
+                if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, jitterFilename) ||
+                    ctString::ctOrdinalEqualsCaseInsensative(errorFilename, jitterFilename) ||
+                    ctString::ctOrdinalEqualsCaseInsensative(statusFilename, jitterFilename))
+                {
+                    throw invalid_argument("The same csv filename cannot be used for different loggers");
+                }
+                g_jitterLogger = make_shared<ctsTextLogger>(jitterFilename.c_str(), StatusFormatting::Csv);
+            }
+            else
+            {
+                throw invalid_argument("Jitter can only be logged using a csv or binary (.ctsb) format");
+            }
+        }
+
+        if (!jitterSummaryFilename.empty())
+        {
+            if (!ctString::ctOrdinalEndsWithCaseInsensative(jitterSummaryFilename, L".csv"))
+            {
+                throw invalid_argument("Jitter summaries can only be logged using a csv format");
+            }
+            if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, jitterSummaryFilename) ||
+                ctString::ctOrdinalEqualsCaseInsensative(errorFilename, jitterSummaryFilename) ||
+                ctString::ctOrdinalEqualsCaseInsensative(statusFilename, jitterSummaryFilename) ||
+                ctString::ctOrdinalEqualsCaseInsensative(jitterFilename, jitterSummaryFilename))
+            {
+                throw invalid_argument("The same csv filename cannot be used for different loggers");
+            }
+            g_jitterSummaryLogger = make_shared<ctsTextLogger>(jitterSummaryFilename.c_str(), StatusFormatting::Csv);
+        }
+
+        if (!histogramFilename.empty())
+        {
+            if (!ctString::ctOrdinalEndsWithCaseInsensative(histogramFilename, L".csv"))
+            {
+                throw invalid_argument("Latency histograms can only be logged using a csv format");
+            }
+            if (ctString::ctOrdinalEqualsCaseInsensative(connectionFilename, histogramFilename) ||
+                ctString::ctOrdinalEqualsCaseInsensative(errorFilename, histogramFilename) ||
+                ctString::ctOrdinalEqualsCaseInsensative(statusFilename, histogramFilename) ||
+                ctString::ctOrdinalEqualsCaseInsensative(jitterFilename, histogramFilename) ||
+                ctString::ctOrdinalEqualsCaseInsensative(jitterSummaryFilename, histogramFilename))
+            {
+                throw invalid_argument("The same csv filename cannot be used for different loggers");
+            }
+            g_histogramLogger = make_shared<ctsTextLogger>(histogramFilename.c_str(), StatusFormatting::Csv);
+        }
+
+        // the per-thread lines are written between the status lines, which a csv file can't hold
+        if (g_configSettings->PrintThreadStatistics && (!g_statusLogger || g_statusLogger->IsCsvFormat()))
+        {
+            throw invalid_argument("-ThreadStatistics requires a -StatusFilename that is not of csv format");
+        }
+
+        // binary records are already cheap enough to write per connection
+        if (g_configSettings->ConnectionLogAggregate && g_binaryConnectionLogger)
+        {
+            throw invalid_argument("-ConnectionLog:aggregate cannot be used with a binary (.ctsb) -ConnectionFilename");
+        }
+        // the sampled connections are written between the aggregated lines, which a csv file can't hold
+        if (g_configSettings->ConnectionLogSamples > 0 && g_connectionLogger && g_connectionLogger->IsCsvFormat())
+        {
+            throw invalid_argument("-ConnectionLogSamples requires a -ConnectionFilename that is not of csv format");
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets error policy
+    ///
+    /// -OnError:<log,break>
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForError(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-OnError");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-OnError");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"log", value))
+            {
+                g_breakOnError = false;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"break", value))
+            {
+                g_breakOnError = true;
+            }
+            else
+            {
+                throw invalid_argument("-OnError");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets the number of AcceptEx requests kept posted on each listening socket
+    /// -- only applicable to servers using -acc:AcceptEx
+    /// -- or, for MediaStream servers, the number of WSARecvFrom requests kept posted on each listening socket
+    ///
+    /// -PrePostAccepts:#####
+    ///                :[low,high] (*default [100,1000])
+    ///                (*default for MediaStream servers: the number of processors)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForPrePostAccepts(vector<const wchar_t*>& args)
+    {
+        const bool usingAcceptEx = !g_configSettings->ListenAddresses.empty() && g_configSettings->AcceptFunction == ctsAcceptEx;
+        // MediaStream servers 'accept' by receiving START datagrams on their listening sockets
+        // - keeping multiple receives posted lets STARTs be processed concurrently across the threadpool
+        const bool mediaStreamServer = !g_configSettings->ListenAddresses.empty() && IoPatternType::MediaStream == g_configSettings->IoPattern;
+        if (usingAcceptEx)
+        {
+            g_configSettings->PrePostAcceptsLow = c_defaultPrePostAcceptsLow;
+            g_configSettings->PrePostAcceptsHigh = c_defaultPrePostAcceptsHigh;
+        }
+        else if (mediaStreamServer)
+        {
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+            g_configSettings->PrePostAcceptsLow = systemInfo.dwNumberOfProcessors;
+            g_configSettings->PrePostAcceptsHigh = g_configSettings->PrePostAcceptsLow;
+        }
+
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-PrePostAccepts");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (!usingAcceptEx && !mediaStreamServer)
+            {
+                throw invalid_argument("-PrePostAccepts (only applicable to servers using -acc:AcceptEx or -pattern:mediastream)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-PrePostAccepts");
+            if (value[0] == L'[')
+            {
+                if (mediaStreamServer)
+                {
+                    throw invalid_argument("-PrePostAccepts (MediaStream servers keep a fixed number of receives posted)");
+                }
+                ReadRangeValues(value, g_configSettings->PrePostAcceptsLow, g_configSettings->PrePostAcceptsHigh);
+            }
+            else
+            {
+                // a single value keeps a fixed number of AcceptEx requests posted
+                g_configSettings->PrePostAcceptsLow = ConvertToIntegral<unsigned long>(value);
+                g_configSettings->PrePostAcceptsHigh = g_configSettings->PrePostAcceptsLow;
+            }
+            if (0 == g_configSettings->PrePostAcceptsLow)
+            {
+                throw invalid_argument("-PrePostAccepts");
+            }
+
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the number of accept queues AcceptEx requests are split across
+    /// -- only applicable to servers using -acc:AcceptEx
+    ///
+    /// -AcceptQueues:shared (*default)
+    /// -AcceptQueues:processor
+    /// -AcceptQueues:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForAcceptQueues(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-AcceptQueues");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->ListenAddresses.empty() || g_configSettings->AcceptFunction != ctsAcceptEx)
+            {
+                throw invalid_argument("-AcceptQueues (only applicable to servers using -acc:AcceptEx)");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-AcceptQueues");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"shared", value))
+            {
+                g_configSettings->AcceptQueueCount = 0;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"processor", value))
+            {
+                SYSTEM_INFO systemInfo;
+                GetSystemInfo(&systemInfo);
+                g_configSettings->AcceptQueueCount = systemInfo.dwNumberOfProcessors;
+            }
+            else
+            {
+                g_configSettings->AcceptQueueCount = ConvertToIntegral<unsigned long>(value);
+                if (0 == g_configSettings->AcceptQueueCount)
+                {
+                    throw invalid_argument("-AcceptQueues");
+                }
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets optional prepostrecvs value
+    ///
+    /// -PrePostRecvs:#####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForPrepostrecvs(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-PrePostRecvs");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            g_configSettings->PrePostRecvs = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-PrePostRecvs"));
+            if (0 == g_configSettings->PrePostRecvs)
+            {
+                throw invalid_argument("-PrePostRecvs");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+        else
+        {
+            g_configSettings->PrePostRecvs = ProtocolType::TCP == g_configSettings->Protocol ? 1 : 2;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets optional prepostsends value
+    ///
+    /// -PrePostSends:#####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForPrepostsends(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-PrePostSends");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            g_configSettings->PrePostSends = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-PrePostSends"));
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+        else if (g_configSettings->UdpBlast)
+        {
+            // the send window of each stream, including when sending with RIOSendEx
+            g_configSettings->PrePostSends = c_defaultBlastPrePostSends;
+        }
+        else
+        {
+            g_configSettings->PrePostSends = 1;
+            if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+            {
+                // 0 PrePostSends == rely on ISB
+                g_configSettings->PrePostSends = 0;
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets optional SO_RCVBUF value
+    ///
+    /// -RecvBufValue:<#####,auto>
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForRecvbufvalue(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-RecvBufValue");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-RecvBufValue");
+            if (ctString::ctOrdinalEqualsCaseInsensative(value, L"auto"))
+            {
+                if (g_configSettings->Protocol != ProtocolType::TCP)
+                {
+                    throw invalid_argument("-RecvBufValue:auto (only applicable to TCP)");
+                }
+                g_configSettings->AutoRecvBuf = true;
+            }
+            else
+            {
+                g_configSettings->RecvBufValue = ConvertToIntegral<unsigned long>(value);
+                g_configSettings->Options |= SetRecvBuf;
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets optional SO_SNDBUF value
+    ///
+    /// -SendBufValue:<#####,auto>
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForSendbufvalue(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-SendBufValue");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-SendBufValue");
+            if (ctString::ctOrdinalEqualsCaseInsensative(value, L"auto"))
+            {
+                if (g_configSettings->Protocol != ProtocolType::TCP)
+                {
+                    throw invalid_argument("-SendBufValue:auto (only applicable to TCP)");
+                }
+                g_configSettings->AutoSendBuf = true;
+            }
+            else
+            {
+                g_configSettings->SendBufValue = ConvertToIntegral<unsigned long>(value);
+                g_configSettings->Options |= SetSendBuf;
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets the optional TCP IO latency percentiles to track and print
+    ///
+    /// -LatencyPercentiles:##,##,##.#
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForLatencyPercentiles(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-LatencyPercentiles");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (ProtocolType::TCP != g_configSettings->Protocol)
+            {
+                throw invalid_argument("-LatencyPercentiles is only supported with TCP");
+            }
+
+            const auto* value = ParseArgument(*foundArgument, L"-LatencyPercentiles");
+            for (;;)
+            {
+                wchar_t* valueEnd = nullptr;
+                const auto percentile = wcstod(value, &valueEnd);
+                if (valueEnd == value || percentile <= 0.0 || percentile > 100.0)
+                {
+                    throw invalid_argument("-LatencyPercentiles (each percentile must be greater than 0 and at most 100)");
+                }
+                g_configSettings->LatencyPercentiles.push_back(percentile);
+
+                if (L'\0' == *valueEnd)
+                {
+                    break;
+                }
+                if (*valueEnd != L',')
+                {
+                    throw invalid_argument("-LatencyPercentiles");
+                }
+                value = valueEnd + 1;
+            }
+            if (g_configSettings->LatencyPercentiles.size() > ctsConfigSettings::c_MaxLatencyPercentiles)
+            {
+                throw invalid_argument("-LatencyPercentiles (at most 4 percentiles can be specified)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for how connections are spread across targets and the statistics tracked per target
+    ///
+    /// -TargetWeights:##,##,##
+    /// -TargetStatistics:<on,off>
+    ///
+    /// - must be parsed after -LatencyPercentiles : the IO latency of each target is only tracked with it
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForTargets(vector<const wchar_t*>& args)
+    {
+        const auto foundWeights = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-TargetWeights");
+            return value != nullptr;
+            });
+        if (foundWeights != end(args))
+        {
+            if (IsListening())
+            {
+                throw invalid_argument("-TargetWeights is only supported when running as a client");
+            }
+
+            // each weight applies to every address its -Target resolved to
+            vector<unsigned long> weights;
+            const auto* value = ParseArgument(*foundWeights, L"-TargetWeights");
+            for (;;)
+            {
+                wchar_t* valueEnd = nullptr;
+                const auto weight = wcstoul(value, &valueEnd, 10);
+                if (valueEnd == value || weight < 1 || weight > 100)
+                {
+                    throw invalid_argument("-TargetWeights (each weight must be between 1 and 100)");
+                }
+                weights.push_back(weight);
+
+                if (L'\0' == *valueEnd)
+                {
+                    break;
+                }
+                if (*valueEnd != L',')
+                {
+                    throw invalid_argument("-TargetWeights");
+                }
+                value = valueEnd + 1;
+            }
+            if (weights.size() != g_targetAddressCounts.size())
+            {
+                throw invalid_argument("-TargetWeights (a weight must be given for each -Target, in the order given)");
+            }
+            for (size_t target = 0; target < weights.size(); ++target)
+            {
+                g_configSettings->TargetWeights.insert(end(g_configSettings->TargetWeights), g_targetAddressCounts[target], weights[target]);
+            }
+
+            // smooth weighted round-robin : each target is chosen in proportion to its weight,
+            // spread evenly through the order instead of in runs
+            long long totalWeight = 0;
+            for (const auto weight : g_configSettings->TargetWeights)
+            {
+                totalWeight += weight;
+            }
+            vector<long long> currentWeights(g_configSettings->TargetWeights.size(), 0LL);
+            for (long long order = 0; order < totalWeight; ++order)
+            {
+                size_t chosen = 0;
+                for (size_t index = 0; index < currentWeights.size(); ++index)
+                {
+                    currentWeights[index] += g_configSettings->TargetWeights[index];
+                    if (currentWeights[index] > currentWeights[chosen])
+                    {
+                        chosen = index;
+                    }
+                }
+                currentWeights[chosen] -= totalWeight;
+                g_configSettings->TargetOrder.push_back(chosen);
+            }
+            // always remove the arg from our vector
+            args.erase(foundWeights);
+        }
+
+        const auto foundStatistics = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-TargetStatistics");
+            return value != nullptr;
+            });
+        if (foundStatistics != end(args))
+        {
+            const auto* const value = ParseArgument(*foundStatistics, L"-TargetStatistics");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                if (ProtocolType::TCP != g_configSettings->Protocol)
+                {
+                    throw invalid_argument("-TargetStatistics is only supported with TCP");
+                }
+                if (IsListening())
+                {
+                    throw invalid_argument("-TargetStatistics is only supported when running as a client");
+                }
+                if (g_configSettings->TargetAddresses.size() > ctsConfigSettings::c_MaxTargetStatistics)
+                {
+                    throw invalid_argument("-TargetStatistics (statistics can be tracked for at most 8 target addresses)");
+                }
+                for (size_t target = 0; target < g_configSettings->TargetAddresses.size(); ++target)
+                {
+                    g_configSettings->TargetStatusDetails.push_back(make_unique<ctsTargetStatistics>());
+                }
+            }
+            else if (!ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                throw invalid_argument("-TargetStatistics");
+            }
+            // always remove the arg from our vector
+            args.erase(foundStatistics);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets the optional interval to sample SIO_TCP_INFO on each TCP connection
+    ///
+    /// -TcpInfo:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForTcpInfo(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-TcpInfo");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (ProtocolType::TCP != g_configSettings->Protocol)
+            {
+                throw invalid_argument("-TcpInfo is only supported with TCP");
+            }
+
+            g_configSettings->TcpInfoIntervalMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-TcpInfo"));
+            if (0 == g_configSettings->TcpInfoIntervalMilliseconds)
+            {
+                throw invalid_argument("-TcpInfo (the sampling interval must be at least 1 millisecond)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets the optional interval to sample the throughput of each TCP connection
+    ///
+    /// -ConnectionSamples:####
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForConnectionSamples(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ConnectionSamples");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (ProtocolType::TCP != g_configSettings->Protocol)
+            {
+                throw invalid_argument("-ConnectionSamples is only supported with TCP");
+            }
+
+            g_configSettings->ConnectionSampleIntervalMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-ConnectionSamples"));
+            if (g_configSettings->ConnectionSampleIntervalMilliseconds < 10)
+            {
+                throw invalid_argument("-ConnectionSamples (the sampling interval must be at least 10 milliseconds)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for sampling the host processor, network adapter and TCP counters with each status update
+    ///
+    /// -HostCounters:off (*default)
+    /// -HostCounters:on
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForHostCounters(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-HostCounters");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-HostCounters");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                if (ProtocolType::TCP != g_configSettings->Protocol)
+                {
+                    throw invalid_argument("-HostCounters is only supported with TCP");
+                }
+                // the process starting the -Workers samples the host for all of them
+                g_configSettings->HostCounters = nullptr == g_configSettings->WorkerStatsSharedMemoryName;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->HostCounters = false;
+            }
+            else
+            {
+                throw invalid_argument("-HostCounters");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the number of worker processes to run the connections
+    /// - each worker is started with this command line and a disjoint slice of the connections and ports
+    ///   this process prints their combined status and summary
+    ///
+    /// -Workers:####
+    ///
+    /// - must be parsed after every setting it validates
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForWorkers(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-Workers");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            g_configSettings->WorkerProcesses = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-Workers"));
+            // the front end waits on every worker and the ctrl-c event together
+            if (g_configSettings->WorkerProcesses < 2 || g_configSettings->WorkerProcesses > MAXIMUM_WAIT_OBJECTS - 1)
+            {
+                throw invalid_argument("-Workers (must be between 2 and 63)");
+            }
+            if (g_configSettings->WorkerStatsSharedMemoryName)
+            {
+                throw invalid_argument("-Workers (a worker process cannot start workers)");
+            }
+            // worker N listens on, or connects to, -Port + N
+            if (static_cast<unsigned long>(g_configSettings->Port) + g_configSettings->WorkerProcesses - 1 > MAXWORD)
+            {
+                throw invalid_argument("-Workers (each worker uses the next -Port : -Port + -Workers must be a valid port)");
+            }
+            if (!IsListening() && g_configSettings->ConnectionLimit < g_configSettings->WorkerProcesses)
+            {
+                throw invalid_argument("-Workers (cannot be more than -Connections)");
+            }
+            if (IsListening() &&
+                g_configSettings->ServerExitLimit != MAXULONGLONG &&
+                g_configSettings->ServerExitLimit < g_configSettings->WorkerProcesses)
+            {
+                throw invalid_argument("-Workers (cannot be more than -ServerExitLimit)");
+            }
+            if (g_configSettings->LocalPortLow != 0 && 0 == g_configSettings->LocalPortHigh)
+            {
+                throw invalid_argument("-Workers (requires a -LocalPort range so each worker binds its own ports)");
+            }
+            // these adapt to, or measure, what a single process observes
+            if (g_configSettings->RateSearchStepMilliseconds > 0 ||
+                g_configSettings->SweepStepMilliseconds > 0 ||
+                g_configSettings->LoadProfile ||
+                g_configSettings->ConvergenceTolerancePercent > 0.0 ||
+                g_configSettings->PrintCpuEfficiency ||
+                g_configSettings->AccountConnectionMemory ||
+                g_configSettings->PrintThreadStatistics ||
+                !g_configSettings->LatencyPercentiles.empty() ||
+                g_configSettings->MessageSize > 0 ||
+                g_configSettings->MemoryTransport)
+            {
+                throw invalid_argument(
+                    "-Workers (cannot be combined with -RateSearch, -Sweep, -LoadProfile, -Converge, -CpuEfficiency, -MemoryAccounting, "
+                    "-ThreadStatistics, -LatencyPercentiles, -MessageSize or -io:memory)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets an IP Compartment (routing domain)
+    ///
+    /// -Compartment:<ifalias>
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForCompartment(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-Compartment");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            // delay-load IPHLPAPI.DLL
+            const auto* const value = ParseArgument(*foundArgument, L"-Compartment");
+            g_netAdapterAddresses = new ctNetAdapterAddresses(AF_UNSPEC, GAA_FLAG_INCLUDE_ALL_COMPARTMENTS);
+            const auto foundInterface = find_if(
+                g_netAdapterAddresses->begin(),
+                g_netAdapterAddresses->end(),
+                [&value](const IP_ADAPTER_ADDRESSES& adapterAddress) {
+                    return ctString::ctOrdinalEqualsCaseInsensative(value, adapterAddress.FriendlyName);
+                });
+            THROW_HR_IF_MSG(
+                HRESULT_FROM_WIN32(ERROR_NOT_FOUND),
+                foundInterface == g_netAdapterAddresses->end(),
+                "GetAdaptersAddresses could not find the interface alias '%ws'",
+                value);
+
+            g_compartmentId = foundInterface->CompartmentId;
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Sets a threadpool environment for TP APIs to consume
+    ///
+    /// Configuring for max threads == number of processors * 2
+    ///
+    /// currently not exposing the thread count as a command-line parameter
+    ///
+    /// -NumaThreadpools:on
+    /// -NumaThreadpools:off (*default)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    struct ctsThreadpoolAffinityContext
+    {
+        GROUP_AFFINITY m_affinity{};
+        long m_threadsRemaining = 0;
+        wil::unique_event m_allThreadsAffinitized{ wil::EventOptions::ManualReset };
+    };
+
+    // runs concurrently once on every thread of the pool : no callback returns until all threads are running one
+    // - which guarantees each thread of the (fixed-size) pool ran exactly one of these callbacks
+    static void CALLBACK AffinitizeThreadpoolThread(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) noexcept
+    {
+        auto* const affinityContext = static_cast<ctsThreadpoolAffinityContext*>(context);
+        SetThreadGroupAffinity(GetCurrentThread(), &affinityContext->m_affinity, nullptr);
+        if (0 == InterlockedDecrement(&affinityContext->m_threadsRemaining))
+        {
+            affinityContext->m_allThreadsAffinitized.SetEvent();
+        }
+        else
+        {
+            affinityContext->m_allThreadsAffinitized.wait();
+        }
+    }
+
+    static void CreateNumaThreadpools()
+    {
+        ULONG highestNumaNode = 0;
+        if (!GetNumaHighestNodeNumber(&highestNumaNode))
+        {
+            THROW_WIN32_MSG(GetLastError(), "GetNumaHighestNodeNumber");
+        }
+
+        g_numaThreadpools.resize(static_cast<size_t>(highestNumaNode) + 1);
+        for (USHORT numaNode = 0; numaNode <= highestNumaNode; ++numaNode)
+        {
+            ctsThreadpoolAffinityContext affinityContext;
+            if (!GetNumaNodeProcessorMaskEx(numaNode, &affinityContext.m_affinity))
+            {
+                THROW_WIN32_MSG(GetLastError(), "GetNumaNodeProcessorMaskEx");
+            }
+            unsigned long nodeProcessorCount = 0;
+            for (auto processorMask = affinityContext.m_affinity.Mask; processorMask != 0; processorMask &= processorMask - 1)
+            {
+                ++nodeProcessorCount;
+            }
+            if (0 == nodeProcessorCount)
+            {
+                // nodes without processors (e.g. memory-only nodes) fall back to the process-wide threadpool
+                continue;
+            }
+
+            auto& numaThreadpool = g_numaThreadpools[numaNode];
+            numaThreadpool.m_threadPool = CreateThreadpool(nullptr);
+            if (!numaThreadpool.m_threadPool)
+            {
+                THROW_WIN32_MSG(GetLastError(), "CreateThreadPool");
+            }
+            // the pool is a fixed size so every thread it will ever use is affinitized below
+            const auto nodeThreadCount = nodeProcessorCount * c_defaultThreadpoolFactor;
+            SetThreadpoolThreadMaximum(numaThreadpool.m_threadPool, nodeThreadCount);
+            if (!SetThreadpoolThreadMinimum(numaThreadpool.m_threadPool, nodeThreadCount))
+            {
+                THROW_WIN32_MSG(GetLastError(), "SetThreadpoolThreadMinimum");
+            }
+
+            InitializeThreadpoolEnvironment(&numaThreadpool.m_environment);
+            SetThreadpoolCallbackPool(&numaThreadpool.m_environment, numaThreadpool.m_threadPool);
+
+            affinityContext.m_threadsRemaining = static_cast<long>(nodeThreadCount);
+            const wil::unique_threadpool_work affinityWork(CreateThreadpoolWork(AffinitizeThreadpoolThread, &affinityContext, &numaThreadpool.m_environment));
+            if (!affinityWork)
+            {
+                THROW_WIN32_MSG(GetLastError(), "CreateThreadpoolWork");
+            }
+            for (unsigned long thread = 0; thread < nodeThreadCount; ++thread)
+            {
+                SubmitThreadpoolWork(affinityWork.get());
+            }
+            WaitForThreadpoolWorkCallbacks(affinityWork.get(), FALSE);
+        }
+    }
+
+    static void ParseForThreadpool(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-numathreadpools");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-numathreadpools");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                g_configSettings->UseNumaThreadpools = true;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                g_configSettings->UseNumaThreadpools = false;
+            }
+            else
+            {
+                throw invalid_argument("-numathreadpools");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        g_threadPoolThreadCount = systemInfo.dwNumberOfProcessors * c_defaultThreadpoolFactor;
+
+        g_threadPool = CreateThreadpool(nullptr);
+        if (!g_threadPool)
+        {
+            THROW_WIN32_MSG(GetLastError(), "CreateThreadPool");
+        }
+        SetThreadpoolThreadMaximum(g_threadPool, g_threadPoolThreadCount);
+
+        InitializeThreadpoolEnvironment(&g_threadPoolEnvironment);
+        SetThreadpoolCallbackPool(&g_threadPoolEnvironment, g_threadPool);
+
+        g_configSettings->pTpEnvironment = &g_threadPoolEnvironment;
+
+        if (g_configSettings->UseNumaThreadpools)
+        {
+            CreateNumaThreadpools();
+        }
+    }
+
+    static PTP_CALLBACK_ENVIRON GetSocketThreadpoolEnvironment(SOCKET socket) noexcept
+    {
+        if (g_numaThreadpools.empty())
+        {
+            return g_configSettings->pTpEnvironment;
+        }
+
+        // prefer the node of the processor RSS indicates this connection's packets on
+        // - falls back to the node of the current processor when not yet connected or RSS is not enabled
+        USHORT numaNode = 0;
+        SOCKET_PROCESSOR_AFFINITY rssProcessor{};
+        DWORD bytesReturned = 0;
+        if (0 == WSAIoctl(socket, SIO_QUERY_RSS_PROCESSOR_INFO, nullptr, 0, &rssProcessor, sizeof rssProcessor, &bytesReturned, nullptr, nullptr))
+        {
+            numaNode = rssProcessor.NumaNodeId;
+        }
+        else
+        {
+            PROCESSOR_NUMBER processor{};
+            GetCurrentProcessorNumberEx(&processor);
+            if (!GetNumaProcessorNodeEx(&processor, &numaNode))
+            {
+                numaNode = 0;
+            }
+        }
+
+        if (numaNode >= g_numaThreadpools.size() || !g_numaThreadpools[numaNode].m_threadPool)
+        {
+            return g_configSettings->pTpEnvironment;
+        }
+        return &g_numaThreadpools[numaNode].m_environment;
+    }
+
+    shared_ptr<ctThreadIocp> CreateSocketThreadIocp(SOCKET socket)
+    {
+        if (g_completionEngine)
+        {
+            return make_shared<ctThreadIocp>(socket, *g_completionEngine);
+        }
+        return make_shared<ctThreadIocp>(socket, GetSocketThreadpoolEnvironment(socket));
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for whether to verify buffer contents on receiver
+    ///
+    /// -verify:<connection,data,checksum>
+    /// (the old options were <always,never>)
+    ///
+    /// Note this controls if using a SharedBuffer across all IO or unique buffers
+    /// - if not validating data, won't waste memory creating buffers for every connection
+    /// - if validating data, must create buffers for every connection
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForShouldVerifyBuffers(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-verify");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-verify");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"always", value) || ctString::ctOrdinalEqualsCaseInsensative(L"data", value))
+            {
+                g_configSettings->ShouldVerifyBuffers = true;
+                g_configSettings->ShouldVerifyChecksums = false;
+                g_configSettings->UseSharedBuffer = false;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"checksum", value))
+            {
+                // received buffers are still unique per connection as the checksums are computed from them
+                g_configSettings->ShouldVerifyBuffers = false;
+                g_configSettings->ShouldVerifyChecksums = true;
+                g_configSettings->UseSharedBuffer = false;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"seeded", value))
+            {
+                // every received byte is verified, against the payload seeded from the connection ID
+                g_configSettings->ShouldVerifyBuffers = true;
+                g_configSettings->ShouldVerifyChecksums = false;
+                g_configSettings->SeededPayload = true;
+                g_configSettings->UseSharedBuffer = false;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"never", value) || ctString::ctOrdinalEqualsCaseInsensative(L"connection", value))
+            {
+                g_configSettings->ShouldVerifyBuffers = false;
+                g_configSettings->ShouldVerifyChecksums = false;
+                g_configSettings->UseSharedBuffer = true;
+            }
+            else
+            {
+                throw invalid_argument("-verify");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the lean protocol without the connection ID exchange and completion message
+    /// -- only applicable to TCP -Pattern:Push, Pull, PushPull and Duplex
+    /// -- clients and servers must both specify it
+    ///
+    /// -LeanProtocol:on
+    /// -LeanProtocol:off (*default)
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForLeanProtocol(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-LeanProtocol");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            const auto* const value = ParseArgument(*foundArgument, L"-LeanProtocol");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"on", value))
+            {
+                if (g_configSettings->Protocol != ProtocolType::TCP)
+                {
+                    throw invalid_argument("-LeanProtocol (only applicable to TCP)");
+                }
+                if (g_configSettings->IoPattern != IoPatternType::Push &&
+                    g_configSettings->IoPattern != IoPatternType::Pull &&
+                    g_configSettings->IoPattern != IoPatternType::PushPull &&
+                    g_configSettings->IoPattern != IoPatternType::Duplex)
+                {
+                    throw invalid_argument("-LeanProtocol (only applicable to -Pattern:Push, Pull, PushPull or Duplex)");
+                }
+                if (g_configSettings->TcpShutdown == TcpShutdownType::HardShutdown)
+                {
+                    // without the completion message, the server's FIN is all that confirms it received the full transfer
+                    throw invalid_argument("-LeanProtocol (requires -Shutdown:graceful)");
+                }
+                if (g_configSettings->PersistentTransfers > 1)
+                {
+                    // each transfer over the connection ends with the completion message
+                    throw invalid_argument("-LeanProtocol (not supported with -PersistentTransfers)");
+                }
+                if (g_configSettings->ProbeConnections > 0)
+                {
+                    // probe connections still exchange the connection ID and completion message
+                    throw invalid_argument("-LeanProtocol (not supported with -Probes)");
+                }
+                g_configSettings->LeanProtocol = true;
+            }
+            else if (!ctString::ctOrdinalEqualsCaseInsensative(L"off", value))
+            {
+                throw invalid_argument("-LeanProtocol");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for how the client should close the connection with the server
+    ///
+    /// -shutdown:<graceful,rude>
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForShutdown(vector<const wchar_t*>& args)
+    {
+        if (IsListening())
+        {
+            g_configSettings->TcpShutdown = TcpShutdownType::ServerSideShutdown;
+        }
+
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-shutdown");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (IsListening())
+            {
+                throw invalid_argument("-shutdown is a client-only option");
+            }
+
+            const auto* const value = ParseArgument(*foundArgument, L"-shutdown");
+            if (ctString::ctOrdinalEqualsCaseInsensative(L"graceful", value))
+            {
+                g_configSettings->TcpShutdown = TcpShutdownType::GracefulShutdown;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(L"rude", value))
+            {
+                g_configSettings->TcpShutdown = TcpShutdownType::HardShutdown;
+            }
+            else
+            {
+                throw invalid_argument("-shutdown");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the optional maximum time to run
+    ///
+    /// -TimeLimit:##
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForTimelimit(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-timelimit");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            g_configSettings->TimeLimit = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-timelimit"));
+            if (0 == g_configSettings->Port)
+            {
+                throw invalid_argument("-timelimit");
+            }
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the time excluded from the steady-state summary
+    ///
+    /// -WarmUp:####
+    /// -CoolDown:####
+    ///
+    /// - must be parsed after -TimeLimit : the cool-down is counted back from the time limit
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForSteadyState(vector<const wchar_t*>& args)
+    {
+        const auto foundWarmUp = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-WarmUp");
+            return value != nullptr;
+            });
+        if (foundWarmUp != end(args))
+        {
+            g_configSettings->WarmUpMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundWarmUp, L"-WarmUp"));
+            if (0 == g_configSettings->WarmUpMilliseconds)
+            {
+                throw invalid_argument("-WarmUp");
+            }
+            // always remove the arg from our vector
+            args.erase(foundWarmUp);
+        }
+
+        const auto foundCoolDown = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-CoolDown");
+            return value != nullptr;
+            });
+        if (foundCoolDown != end(args))
+        {
+            g_configSettings->CoolDownMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundCoolDown, L"-CoolDown"));
+            if (0 == g_configSettings->CoolDownMilliseconds)
+            {
+                throw invalid_argument("-CoolDown");
+            }
+            if (0 == g_configSettings->TimeLimit)
+            {
+                throw invalid_argument("-CoolDown requires -TimeLimit : the cool-down is the end of the time limit");
+            }
+            // always remove the arg from our vector
+            args.erase(foundCoolDown);
+        }
+
+        if (g_configSettings->TimeLimit > 0 &&
+            static_cast<unsigned long long>(g_configSettings->WarmUpMilliseconds) + g_configSettings->CoolDownMilliseconds >= g_configSettings->TimeLimit)
+        {
+            throw invalid_argument("-WarmUp and -CoolDown must leave a steady-state window within -TimeLimit");
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for stopping the run once its throughput has converged
+    ///
+    /// -Converge:##
+    /// -ConvergeWindow:##
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForConvergence(vector<const wchar_t*>& args)
+    {
+        const auto foundConverge = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-Converge");
+            return value != nullptr;
+            });
+        if (foundConverge != end(args))
+        {
+            const auto* const value = ParseArgument(*foundConverge, L"-Converge");
+            wchar_t* valueEnd = nullptr;
+            g_configSettings->ConvergenceTolerancePercent = wcstod(value, &valueEnd);
+            if (valueEnd == value || *valueEnd != L'\0' ||
+                g_configSettings->ConvergenceTolerancePercent <= 0.0 || g_configSettings->ConvergenceTolerancePercent >= 100.0)
+            {
+                throw invalid_argument("-Converge (the tolerance must be a percent greater than 0 and less than 100)");
+            }
+            if (g_configSettings->RateSearchStepMilliseconds > 0)
+            {
+                throw invalid_argument("-Converge cannot be used with -RateSearch (which ends the run itself)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundConverge);
+        }
+
+        const auto foundConvergeWindow = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-ConvergeWindow");
+            return value != nullptr;
+            });
+        if (foundConvergeWindow != end(args))
+        {
+            if (0.0 == g_configSettings->ConvergenceTolerancePercent)
+            {
+                throw invalid_argument("-ConvergeWindow requires specifying -Converge");
+            }
+            g_configSettings->ConvergenceWindow = ConvertToIntegral<unsigned long>(ParseArgument(*foundConvergeWindow, L"-ConvergeWindow"));
+            if (g_configSettings->ConvergenceWindow < 3 || g_configSettings->ConvergenceWindow > 100)
+            {
+                throw invalid_argument("-ConvergeWindow (must be between 3 and 100 status intervals)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundConvergeWindow);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for the search for the highest sustainable -RateLimit
+    ///
+    /// -RateSearch:####
+    ///
+    /// - must be parsed after -RateLimit : the range given to -RateLimit is the range searched
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForRateSearch(vector<const wchar_t*>& args)
+    {
+        const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-RateSearch");
+            return value != nullptr;
+            });
+        if (foundArgument != end(args))
+        {
+            if (g_configSettings->Protocol != ProtocolType::TCP)
+            {
+                throw invalid_argument("-RateSearch is only supported with TCP (the rate of a MediaStream is set by its server)");
+            }
+            if (IsListening())
+            {
+                throw invalid_argument("-RateSearch is only supported when running as a client");
+            }
+            if (g_configSettings->LoadProfile)
+            {
+                throw invalid_argument("-RateSearch cannot be used with -LoadProfile");
+            }
+            if (0LL == g_rateLimitHigh)
+            {
+                throw invalid_argument("-RateSearch requires -RateLimit:[low,high] : the range of rates to search");
+            }
+            // the client must be the sender for its rate limit to be measured
+            if (g_configSettings->IoPattern != IoPatternType::Push && g_configSettings->IoPattern != IoPatternType::Duplex)
+            {
+                throw invalid_argument("-RateSearch requires -Pattern:Push or -Pattern:Duplex");
+            }
+            g_configSettings->RateSearchStepMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundArgument, L"-RateSearch"));
+            if (g_configSettings->RateSearchStepMilliseconds < 1000)
+            {
+                throw invalid_argument("-RateSearch (each step must be at least 1000 milliseconds)");
+            }
+            if (g_configSettings->RateSearchStepMilliseconds < c_rateSearchTicksPerStep * g_configSettings->TcpBytesPerSecondPeriod)
+            {
+                throw invalid_argument("-RateSearch (each step must be at least 4 -RateLimitPeriod quanta)");
+            }
+
+            // start in the middle of the range
+            g_rateSearchBytesPerSecond = g_rateLimitLow + (g_rateLimitHigh - g_rateLimitLow) / 2;
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+    }
+
+    static const wchar_t* SweepParameterName(SweepParameter parameter) noexcept
+    {
+        switch (parameter)
+        {
+            case SweepParameter::Buffer:
+                return L"-Buffer";
+            case SweepParameter::PrePostRecvs:
+                return L"-PrePostRecvs";
+            case SweepParameter::PrePostSends:
+                return L"-PrePostSends";
+            case SweepParameter::RecvBufValue:
+                return L"-RecvBufValue";
+            case SweepParameter::SendBufValue:
+                return L"-SendBufValue";
+        }
+        return L"";
+    }
+
+    // e.g. -PrePostSends:2 -Buffer:65536
+    static wstring SweepPointDescription(size_t point)
+    {
+        wstring description;
+        for (size_t axis = 0; axis < g_sweepAxes.size(); ++axis)
+        {
+            if (!description.empty())
+            {
+                description.append(L" ");
+            }
+            description.append(
+                wil::str_printf<std::wstring>(
+                    L"%ws:%lu",
+                    SweepParameterName(g_sweepAxes[axis].m_parameter),
+                    g_sweepPoints[point].m_values[axis]));
+        }
+        return description;
+    }
+
+    // whether the point changes a value only read as connections are created
+    static bool SweepPointChangesNewConnections(size_t point) noexcept
+    {
+        for (size_t axis = 0; axis < g_sweepAxes.size(); ++axis)
+        {
+            if (g_sweepAxes[axis].m_parameter != SweepParameter::Buffer &&
+                g_sweepPoints[point].m_values[axis] != g_sweepPoints[point - 1].m_values[axis])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void ApplySweepPoint(size_t point) noexcept
+    {
+        for (size_t axis = 0; axis < g_sweepAxes.size(); ++axis)
+        {
+            const auto value = g_sweepPoints[point].m_values[axis];
+            switch (g_sweepAxes[axis].m_parameter)
+            {
+                case SweepParameter::Buffer:
+                    ctMemoryGuardWrite(&g_sweepBufferSize, static_cast<long>(value));
+                    break;
+                case SweepParameter::PrePostRecvs:
+                    g_configSettings->PrePostRecvs = value;
+                    break;
+                case SweepParameter::PrePostSends:
+                    g_configSettings->PrePostSends = value;
+                    break;
+                case SweepParameter::RecvBufValue:
+                    g_configSettings->RecvBufValue = value;
+                    break;
+                case SweepParameter::SendBufValue:
+                    g_configSettings->SendBufValue = value;
+                    break;
+            }
+        }
+        // published last : each new connection reads the point it is created with before the values of that point
+        ctMemoryGuardWrite(&g_configSettings->SweepPoint, static_cast<long>(point));
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Parses for a sweep of a grid of settings within the run
+    ///
+    /// -Sweep:<parameter>=####,####,... (may be given once for each parameter)
+    /// -SweepStep:####
+    ///
+    /// - must be parsed after the parameters it sweeps : the swept values replace them
+    ///
+    //////////////////////////////////////////////////////////////////////////////////////////
+    static void ParseForSweep(vector<const wchar_t*>& args)
+    {
+        for (;;)
+        {
+            const auto foundArgument = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+                const auto* const value = ParseArgument(parameter, L"-Sweep");
+                return value != nullptr;
+                });
+            if (foundArgument == end(args))
+            {
+                break;
+            }
+
+            const wstring value(ParseArgument(*foundArgument, L"-Sweep"));
+            const auto nameEnd = value.find(L'=');
+            if (wstring::npos == nameEnd || nameEnd + 1 == value.size())
+            {
+                throw invalid_argument("-Sweep (expects -Sweep:<parameter>=<value>,<value>,...)");
+            }
+            const auto name = value.substr(0, nameEnd);
+            SweepAxis axis;
+            if (ctString::ctOrdinalEqualsCaseInsensative(name.c_str(), L"Buffer"))
+            {
+                axis.m_parameter = SweepParameter::Buffer;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(name.c_str(), L"PrePostRecvs"))
+            {
+                axis.m_parameter = SweepParameter::PrePostRecvs;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(name.c_str(), L"PrePostSends"))
+            {
+                axis.m_parameter = SweepParameter::PrePostSends;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(name.c_str(), L"RecvBufValue"))
+            {
+                if (g_configSettings->AutoRecvBuf)
+                {
+                    throw invalid_argument("-Sweep (RecvBufValue can't be swept with -RecvBufValue:auto)");
+                }
+                axis.m_parameter = SweepParameter::RecvBufValue;
+                g_configSettings->Options |= SetRecvBuf;
+            }
+            else if (ctString::ctOrdinalEqualsCaseInsensative(name.c_str(), L"SendBufValue"))
+            {
+                if (g_configSettings->AutoSendBuf)
+                {
+                    throw invalid_argument("-Sweep (SendBufValue can't be swept with -SendBufValue:auto)");
+                }
+                axis.m_parameter = SweepParameter::SendBufValue;
+                g_configSettings->Options |= SetSendBuf;
+            }
+            else
+            {
+                // -IO and the other settings fixed at Startup are swept with separate runs
+                throw invalid_argument("-Sweep (the parameter must be Buffer, PrePostRecvs, PrePostSends, RecvBufValue or SendBufValue)");
+            }
+            for (const auto& existingAxis : g_sweepAxes)
+            {
+                if (existingAxis.m_parameter == axis.m_parameter)
+                {
+                    throw invalid_argument("-Sweep (each parameter can only be swept once)");
+                }
+            }
+
+            auto valueStart = nameEnd + 1;
+            for (;;)
+            {
+                const auto valueEnd = value.find(L',', valueStart);
+                axis.m_values.push_back(ConvertToIntegral<unsigned long>(value.substr(valueStart, valueEnd - valueStart)));
+                if (wstring::npos == valueEnd)
+                {
+                    break;
+                }
+                valueStart = valueEnd + 1;
+            }
+            for (const auto sweptValue : axis.m_values)
+            {
+                if (0 == sweptValue &&
+                    (SweepParameter::Buffer == axis.m_parameter || SweepParameter::PrePostRecvs == axis.m_parameter))
+                {
+                    throw invalid_argument("-Sweep (-Buffer and -PrePostRecvs values must be greater than zero)");
+                }
+                if (SweepParameter::PrePostRecvs == axis.m_parameter && sweptValue > 1 &&
+                    (g_configSettings->ShouldVerifyBuffers || g_configSettings->ShouldVerifyChecksums || g_configSettings->IoFunction == ctsTlsIocp))
+                {
+                    throw invalid_argument("-Sweep (-PrePostRecvs > 1 requires -Verify:connection and is not supported with -io:tls)");
+                }
+            }
+            g_sweepAxes.push_back(std::move(axis));
+            // always remove the arg from our vector
+            args.erase(foundArgument);
+        }
+
+        const auto foundStep = find_if(begin(args), end(args), [](const wchar_t* parameter) -> bool {
+            const auto* const value = ParseArgument(parameter, L"-SweepStep");
+            return value != nullptr;
+            });
+        if (g_sweepAxes.empty())
+        {
+            if (foundStep != end(args))
+            {
+                throw invalid_argument("-SweepStep requires specifying -Sweep");
+            }
+            return;
+        }
+
+        if (g_configSettings->Protocol != ProtocolType::TCP)
+        {
+            throw invalid_argument("-Sweep is only supported with TCP");
+        }
+        if (IsListening())
+        {
+            throw invalid_argument("-Sweep is only supported when running as a client");
+        }
+        if (g_configSettings->RateSearchStepMilliseconds > 0 || g_configSettings->LoadProfile || g_configSettings->ConvergenceTolerancePercent > 0.0)
+        {
+            throw invalid_argument("-Sweep cannot be used with -RateSearch, -LoadProfile or -Converge (which change or end the run themselves)");
+        }
+
+        g_configSettings->SweepStepMilliseconds = c_defaultSweepStepMilliseconds;
+        if (foundStep != end(args))
+        {
+            g_configSettings->SweepStepMilliseconds = ConvertToIntegral<unsigned long>(ParseArgument(*foundStep, L"-SweepStep"));
+            if (g_configSettings->SweepStepMilliseconds < 1000)
+            {
+                throw invalid_argument("-SweepStep (each point must be measured for at least 1000 milliseconds)");
+            }
+            // always remove the arg from our vector
+            args.erase(foundStep);
+        }
+
+        // the buffer size is the innermost axis : moving between most points then changes established connections at once
+        stable_partition(begin(g_sweepAxes), end(g_sweepAxes), [](const SweepAxis& axis) noexcept {
+            return axis.m_parameter != SweepParameter::Buffer;
+        });
+        size_t pointCount = 1;
+        for (const auto& axis : g_sweepAxes)
+        {
+            pointCount *= axis.m_values.size();
+            if (pointCount > c_sweepMaxPoints)
+            {
+                throw invalid_argument("-Sweep (the grid cannot have more than 256 points)");
+            }
+        }
+        g_sweepPoints.resize(pointCount);
+        for (size_t point = 0; point < pointCount; ++point)
+        {
+            // the last axis changes fastest
+            auto remainder = point;
+            g_sweepPoints[point].m_values.resize(g_sweepAxes.size());
+            for (size_t axis = g_sweepAxes.size(); axis > 0; --axis)
+            {
+                const auto& values = g_sweepAxes[axis - 1].m_values;
+                g_sweepPoints[point].m_values[axis - 1] = values[remainder % values.size()];
+                remainder /= values.size();
+            }
+        }
+
+        // buffers are sized for the largest buffer swept, and RIO sends for the smallest
+        if (SweepParameter::Buffer == g_sweepAxes.back().m_parameter)
+        {
+            const auto& bufferValues = g_sweepAxes.back().m_values;
+            g_bufferSizeLow = *min_element(begin(bufferValues), end(bufferValues));
+            g_bufferSizeHigh = *max_element(begin(bufferValues), end(bufferValues));
+            if (g_bufferSizeLow == g_bufferSizeHigh)
+            {
+                g_bufferSizeHigh = 0;
+            }
+        }
+
+        g_configSettings->SweepPointConnections.resize(pointCount, 0L);
+        ApplySweepPoint(0);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Members within the ctsConfig namespace that can be accessed anywhere within ctsTraffic
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    void PrintUsage(PrintUsageOption option)
+    {
+        ctsConfigInitOnce();
+
+        wstring usage;
+
+        switch (option)
+        {
+            case PrintUsageOption::Default:
+                usage.append(L"\n\n"
+                    L"ctsTraffic is a utility to generate and validate the integrity of network traffic. It is a client / server application "
+                    L"with the ability to send and receive traffic in a variety of protocol patterns, utilizing a variety of API calling patterns. "
+                    L"The protocol is validated in bytes sent and received for every connection established. Should there be any API failure, any "
+                    L"connection lost prematurely, any protocol failure in bytes sent or received, ctsTraffic will capture and log that error information. "
+                    L"Any errors will additionally cause ctsTraffic to return a non-zero error code.\n"
+                    L"Once started, ctrl-c or ctrl-break will cleanly shutdown the client or server\n"
+                    L"\n\n"
+                    L"For issues or questions, please contact 'ctsSupport'\n"
+                    L"\n\n"
+                    L"ctsTraffic -Help:[tcp] [udp] [logging] [advanced]\n"
+                    L"\t- <default> == prints this usage statement\n"
+                    L"\t- tcp : prints usage for TCP-specific options\n"
+                    L"\t- udp : prints usage for UDP-specific options\n"
+                    L"\t- logging : prints usage for logging options\n"
+                    L"\t- advanced : prints the usage for advanced and experimental options\n"
+                    L"\n\n"
+                    L"Server-side usage:\n"
+                    L"\tctsTraffic -Listen:<addr or *> [-Port:####] [-ServerExitLimit:<####>] [-Protocol:<tcp/udp>] [-Verify:####] [Protocol-specific options]\n"
+                    L"\n"
+                    L"Client-side usage:\n"
+                    L"\tctsTraffic -Target:<addr or name> [-Port:####] [-Connections:<####>] [-Iterations:<####>] [-Protocol:<tcp/udp>] [-Verify:####] [Protocol-specific options]\n"
+                    L"\n"
+                    L"The Server-side and Client-side may have fully independent settings *except* for the following:\n"
+                    L" (these must match exactly between the client and the server)\n"
+                    L"\t-Port\n"
+                    L"\t-Protocol\n"
+                    L"\t-Verify\n"
+                    L"\t-Pattern (on TCP)\n"
+                    L"\t-Transfer (on TCP)\n"
+                    L"\t-BitsPerSecond (on UDP)\n"
+                    L"\t-FrameRate (on UDP)\n"
+                    L"\t-StreamLength (on UDP)\n"
+                    L"\t-GopPattern (on UDP)\n"
+                    L"\t-FrameTrace (on UDP)\n"
+                    L"\n\n"
+                    L"----------------------------------------------------------------------\n"
+                    L"                    Common Server-side options                        \n"
+                    L"----------------------------------------------------------------------\n"
+                    L"-Listen:<addr or *> [-Listen:<addr> -Listen:<addr>]\n"
+                    L"   - the specific IP Address for the server-side to listen, or '*' for all IP Addresses\n"
+                    L"\t- <required>\n"
+                    L"\t  note : can specify multiple addresses by providing -Listen for each address\n"
+                    L"-ServerExitLimit:####\n"
+                    L"   - the total # of accepted connections before server gracefully exits\n"
+                    L"\t- <default> == 0  (infinite)\n"
+                    L"\n\n"
+                    L"----------------------------------------------------------------------\n"
+                    L"                    Common Client-side options                        \n"
+                    L"----------------------------------------------------------------------\n"
+                    L"-Connections:####\n"
+                    L"   - the total # of connections at any one time\n"
+                    L"\t- <default> == 8  (there will always be 8 connections doing IO)\n"
+                    L"-Iterations:####\n"
+                    L"   - the number of times to iterate across the number of '-Connections'\n"
+                    L"\t- <default> == 0  (infinite)\n"
+                    L"\t  note : the total # of connections to be made before exit == Iterations * Connections\n"
+                    L"-Target:<addr or name>\n"
+                    L"   - the server-side IP Address, FQDN, or hostname to connect\n"
+                    L"\t- <required>\n"
+                    L"\t  note : given a FQDN or hostname, each new connection will iterate across\n"
+                    L"\t       : all IPv4 and IPv6 addresses which the name resolved\n"
+                    L"\t  note : one can specify '-Target:localhost' when client and server are both local\n"
+                    L"\t  note : one can specify multiple targets by providing -Target for each address or name\n"
+                    L"-TargetWeights:##,##,##\n"
+                    L"   - spreads new connections across the -Target options in proportion to these weights,\n"
+                    L"     one weight for each -Target in the order given (applying to every address it resolved to)\n"
+                    L"\t- <default> == each address is connected to in turn (round-robin)\n"
+                    L"\t- for example, -Target:a -Target:b -TargetWeights:3,1 makes 3 connections to a for each to b\n"
+                    L"\t  note : each weight must be between 1 and 100\n"
+                    L"-TargetStatistics:<on,off>\n"
+                    L"   - tracks the throughput, failed connections and (with -LatencyPercentiles) the IO latency\n"
+                    L"     of the connections to each target address, printed in the status updates and the final summary\n"
+                    L"     to show an imbalance across the servers behind a load-balanced pool\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : TCP only, for at most 8 target addresses - numbered in the status updates as listed in the settings\n"
+                    L"\n\n"
+                    L"----------------------------------------------------------------------\n"
+                    L"                    Common options for all roles                      \n"
+                    L"----------------------------------------------------------------------\n"
+                    L"-Port:####\n"
+                    L"   - the port # the server will listen and the client will connect\n"
+                    L"\t- <default> == 4444\n"
+                    L"-Protocol:<tcp,udp>\n"
+                    L"   - the protocol used for connectivity and IO\n"
+                    L"\t- tcp : see -help:TCP for usage options\n"
+                    L"\t- udp : see -help:UDP for usage options\n"
+                    L"-Verify:<connection,data,checksum,seeded>\n"
+                    L"   - an enumeration to indicate the level of integrity verification\n"
+                    L"\t- <default> == data\n"
+                    L"\t- connection : the integrity of every connection is verified\n"
+                    L"\t             : including the precise # of bytes to send and receive\n"
+                    L"\t- data : the integrity of every received data buffer is verified against the an expected bit-pattern\n"
+                    L"\t       : this validation is a superset of 'connection' integrity validation\n"
+                    L"\t- checksum : (TCP only) every 4KB block of sent data carries a CRC32C of that block\n"
+                    L"\t           : which the receiver verifies instead of comparing every byte to the bit-pattern\n"
+                    L"\t           : note : both the client and the server must specify -Verify:checksum\n"
+                    L"\t- seeded : (TCP only) every connection sends its own payload, generated from a seed of its connection ID\n"
+                    L"\t         : instead of the bit-pattern shared by all connections, which the receiver regenerates to verify\n"
+                    L"\t         : every byte - detecting data delivered to the wrong connection (e.g. by a proxy or load balancer)\n"
+                    L"\t         : each connection sends from a small ring of -Buffer sized slots: (-PrePostSends + 1), or 8 slots\n"
+                    L"\t           when following the ideal send backlog\n"
+                    L"\t         : note : both the client and the server must specify -Verify:seeded\n"
+                    L"\t         : note : only applicable to -Pattern:Push, Pull, PushPull or Duplex; it can't be used with -IO:RIO\n"
+                    L"\n");
+                break;
+
+            case PrintUsageOption::Tcp:
+                usage.append(L"\n"
+                    L"----------------------------------------------------------------------\n"
+                    L"                    TCP-specific usage options                        \n"
+                    L"----------------------------------------------------------------------\n"
+                    L"-Buffer:#####\n"
+                    L"   - the # of bytes in the buffer used for each send/recv IO\n"
+                    L"\t- <default> == 65536  (each send or recv will post a 64KB buffer)\n"
+                    L"\t- supports range : [low,high]  (each connection will randomly choose a buffer size from within this range)\n"
+                    L"\t  note : Buffer is note required when -Pattern:MediaStream is specified,\n"
+                    L"\t       : FrameSize is the effective buffer size in that traffic pattern\n"
+                    L"-IO:<iocp,rioiocp,riopoll>\n"
+                    L"   - the API set and usage for processing the protocol pattern\n"
+                    L"\t- <default> == iocp\n"
+                    L"\t- iocp : leverages WSARecv/WSASend using IOCP for async completions\n"
+                    L"\t- rioiocp : registered i/o using an overlapped IOCP for completion notification\n"
+                    L"\t- riopoll : registered i/o with affinitized threads spinning on the completion queue\n"
+                    L"\t            (no completion notifications: lowest latency at the cost of a busy processor per queue)\n"
+                    L"\t  note : rioiocp and riopoll are also supported with -Pattern:MediaStream over UDP\n"
+                    L"\t       : the server sends with RIOSendEx, the client receives with RIOReceive and sends with RIOSendEx\n"
+                    L"\t  note : -IO:xdp is supported by -Pattern:MediaStream and -Pattern:Blast servers over UDP\n"
+                    L"\t       : every datagram is written with its Ethernet, IP and UDP headers into AF_XDP TX rings\n"
+                    L"\t         (XDP for Windows), bypassing the host stack; see -XdpQueues in -Help:Advanced\n"
+                    L"-Pattern:<push,pull,pushpull,duplex,requestresponse,heartbeat>\n"
+                    L"   - the protocol pattern to send & recv over the TCP connection\n"
+                    L"\t- <default> == push\n"
+                    L"\t- push : client pushes data to server\n"
+                    L"\t- pull : client pulls data from server\n"
+                    L"\t- pushpull : client/server alternates sending/receiving data\n"
+                    L"\t- duplex : client/server sends and receives concurrently throughout the entire connection\n"
+                    L"\t- requestresponse : client sends fixed-size requests, server replies to each with a fixed-size response\n"
+                    L"\t  note : the summary reports transactions/sec and round-trip latency percentiles for this pattern\n"
+                    L"\t- heartbeat : mostly-idle connections: client sends a small heartbeat at an interval, server echoes it\n"
+                    L"\t  note : status adds the working set per connection, committed memory and heartbeat round-trip latency\n"
+                    L"\t       : -Connections sets the number of connections to hold; combine with -TimeLimit to bound the run\n"
+                    L"\t- blast : (UDP only) the server sends datagrams as fast as its sends complete, for -StreamLength seconds\n"
+                    L"\t  note : see the UDP-specific usage options for -Pattern:Blast\n"
+                    L"-HeartbeatBytes:#####\n"
+                    L"   - applied only with -Pattern:Heartbeat - the number of bytes in each heartbeat and its echo\n"
+                    L"\t- <default> == 16\n"
+                    L"-HeartbeatInterval:#####\n"
+                    L"   - applied only with -Pattern:Heartbeat - the milliseconds between receiving an echo and sending the next heartbeat\n"
+                    L"\t- <default> == 1000\n"
+                    L"-PipelineDepth:#####\n"
+                    L"   - applied only with -Pattern:RequestResponse - the number of requests the client keeps outstanding\n"
+                    L"\t- <default> == 1 (the next request is sent only after the prior response is fully received)\n"
+                    L"-PullBytes:#####\n"
+                    L"   - applied only with -Pattern:PushPull - the number of bytes to 'pull'\n"
+                    L"\t- <default> == 1048576 (1MB)\n"
+                    L"\t  note : pullbytes are the bytes received on the client and sent from the server\n"
+                    L"-PushBytes:#####\n"
+                    L"   - applied only with -Pattern:PushPull - the number of bytes to 'push'\n"
+                    L"\t- <default> == 1048576 (1MB)\n"
+                    L"\t  note : pushbytes are the bytes sent from the client and received on the server\n"
+                    L"-RequestBytes:#####\n"
+                    L"   - applied only with -Pattern:RequestResponse - the number of bytes in each request\n"
+                    L"\t- <default> == 64\n"
+                    L"-ResponseBytes:#####\n"
+                    L"   - applied only with -Pattern:RequestResponse - the number of bytes in each response\n"
+                    L"\t- <default> == 64\n"
+                    L"-RateLimit:#####\n"
+                    L"   - rate limits the number of bytes/sec being *sent* on each individual connection\n"
+                    L"\t- <default> == 0 (no rate limits)\n"
+                    L"\t- supports range : [low,high]  (each connection will randomly choose a rate limit setting from within this range)\n"
+                    L"-Transfer:#####\n"
+                    L"   - the total bytes to transfer per TCP connection\n"
+                    L"\t- <default> == 1073741824  (each connection will transfer a sum total of 1GB)\n"
+                    L"\t- supports range : [low,high]  (each connection will randomly choose a total transfer size send across)\n"
+                    L"\t  note : specifying a range *will* create failures (used to test TCP failures paths)\n"
+                    L"-Shutdown:<graceful,rude>\n"
+                    L"   - controls how clients terminate the TCP connection - note this is a client-only option\n"
+                    L"\t- <default> == graceful\n"
+                    L"\t- graceful : client will initiate a 4-way FIN with the server and wait for the server's FIN\n"
+                    L"\t- rude : client will immediately close the connection once it receives the 'done' response from the server\n"
+                    L"         : this will deliberately tell TCP to linger for zero seconds and close the socket\n"
+                    L"         : this may reesult in a RST instead of a FIN\n"
+                    L"\n");
+                break;
+
+            case PrintUsageOption::Udp:
+                usage.append(L"\n"
+                    L"----------------------------------------------------------------------\n"
+                    L"                    UDP-specific usage options                        \n"
+                    L"                                                                      \n"
+                    L"  * UDP datagrams are streamed in a controlled pattern                \n"
+                    L"    similarly to audio/video streaming solutions                      \n"
+                    L"  * In all cases, the client-side receives and server-side sends      \n"
+                    L"    at a fixed bit-rate and frame-size                                \n"
+                    L"----------------------------------------------------------------------\n"
+                    L"-BitsPerSecond:####\n"
+                    L"   - the number of bits per second to stream split across '-FrameRate' # of frames\n"
+                    L"\t- <required>\n"
+                    L"-FrameRate:####\n"
+                    L"   - the number of frames per second being streamed\n"
+                    L"\t- <required>\n"
+                    L"\t  note : for server-side this is the specific frequency that datagrams are sent\n"
+                    L"\t       : for client-side this is the frequency that frames are processed and verified\n"
+                    L"-StreamLength:####\n"
+                    L"   - the total number of seconds to run the entire stream\n"
+                    L"\t- <required>\n"
+                    L"-BufferDepth:####\n"
+                    L"   - the number of seconds to buffer before processing the stream\n"
+                    L"\t- <default> = 1 (second)\n"
+                    L"\t  note : this affects the client-side buffering of frames\n"
+                    L"\t       : this also affects how far the client-side will peek at frames to resend if missing\n"
+                    L"\t       : the client will look ahead at 1/2 the buffer depth to request a resend if missing\n"
+                    L"-GopPattern:<I, P and B frames>[,<I size>,<P size>,<B size>]\n"
+                    L"   - streams variable-size frames modeling a video codec's group of pictures (e.g. IBBPBBPBBPBB)\n"
+                    L"     the pattern repeats across the stream, sizing each I, P and B frame relative to the others\n"
+                    L"     frame sizes are scaled so the stream still averages -BitsPerSecond\n"
+                    L"\t- <default> == not set (every frame is the same size)\n"
+                    L"\t- <default> sizes == 10,4,1\n"
+                    L"-FrameTrace:<filename>\n"
+                    L"   - streams variable-size frames replaying a trace of frame sizes: one frame per line\n"
+                    L"     (the first column of a csv file; lines not starting with a number, like a header, are skipped)\n"
+                    L"     the trace repeats across the stream; frame sizes are scaled so the stream still averages -BitsPerSecond\n"
+                    L"\t- <default> == not set (every frame is the same size)\n"
+                    L"\t  note : cannot be used with -GopPattern\n"
+                    L"-Pattern:Blast\n"
+                    L"   - measures datagrams per second, loss and reordering instead of streaming at a fixed bit-rate\n"
+                    L"     the server sends datagrams unpaced, keeping -PrePostSends sends in flight per stream (<default> == 64)\n"
+                    L"     the client counts the datagrams lost and received out of order from their sequence numbers\n"
+                    L"\t- -StreamLength is <required>; -BitsPerSecond, -FrameRate, -BufferDepth, -GopPattern and -FrameTrace are not used\n"
+                    L"\t- -Buffer:####  or  -Buffer:[low,high] sets the size of each datagram, header included\n"
+                    L"\t  <default> == 1400 (fits a 1500 byte MTU)\n"
+                    L"\t- <default> -Connections on the client == 2 per processor\n"
+                    L"\t  note : the server sends with WSASendTo, RIOSendEx (-io:rioiocp, -io:riopoll), or UDP Send Offload\n"
+                    L"\t       : with -UdpSendOffload:on each send is a burst of -Buffer sized datagrams (which requires a fixed -Buffer)\n"
+                    L"\n");
+                break;
+
+            case PrintUsageOption::Logging:
+                usage.append(L"\n"
+                    L"----------------------------------------------------------------------\n"
+                    L"                    Logging options                                   \n"
+                    L"----------------------------------------------------------------------\n"
+                    L"Logging in ctsTraffic:\n"
+                    L"Information available to be logged is grouped into 4 basic buckets:\n"
+                    L"  - Connection information : this will write a data point for every successful connection established\n"
+                    L"                             -ConnectionFilename specifies the file written with this data\n"
+                    L"                             the IP address and port tuples for the source and destination will be written\n"
+                    L"                             this will also write a data point at the point of every connection completion\n"
+                    L"                             information unique to the protocol that was used will be included on success\n"
+                    L"  - Error information      : this will write error strings at the point of failure of any connection\n"
+                    L"                             -ErrorFilename specifies the file written with this data\n"
+                    L"                             error information will include the specific point of failure (function that failed)\n"
+                    L"                             as well as which connection the failure occurred (based off of IP address and port)\n"
+                    L"  - Status information     : this will write out status information as applicable to the protocol being used\n"
+                    L"                             -StatusFilename specifies the file written with this data\n"
+                    L"                             the status information will be printed at a frequency set by -StatusUpdate\n"
+                    L"                             the details printed are aggregate values from all connections for that time slice\n"
+                    L"  - Jitter information     : for UDP-patterns only, the jitter logging information will write out data per-datagram\n"
+                    L"                             -JitterFilename specifies the file written with this data\n"
+                    L"                             -JitterSummaryFilename specifies a file written with per-second totals instead\n"
+                    L"                             this information is formatted specifically to calculate jitter between packets\n"
+                    L"                             it follows the same format used with the published tool ntttcp.exe:\n"
+                    L"                             [frame#],[sender.qpc],[sender.qpf],[receiver.qpc],[receiver.qpf]\n"
+                    L"                             - qpc is the result of QueryPerformanceCounter\n"
+                    L"                             - qpf is the result of QueryPerformanceFrequency\n"
+                    L"                             the algorithm to apply to this data can be found on this site under 'Performance Metrics'\n"
+                    L"                             http://msdn.microsoft.com/en-us/library/windows/hardware/dn247504.aspx \n"
+                    L"\n"
+                    L"The format in which the above data is logged is based off of the file extension of the filename specified above\n"
+                    L"  - There are 2 possible file types:\n"
+                    L"\t - txt : plain text format is used with the file extension .txt, or for an unrecognized file extension\n"
+                    L"\t         text output is formatted as one would see it printed to the console in UTF8 format\n"
+                    L"\t - csv : comma-separated value format is used with the file extension .csv\n"
+                    L"\t         information is separated into columns separated by a comma for easier post-processing\n"
+                    L"\t         the column layout of the data is specific to the type of output and protocol being used\n"
+                    L"\t         NOTE: csv formatting will only apply to status updates and jitter, not connection or error information\n"
+                    L"\n"
+                    L"\n"
+                    L"-ConsoleVerbosity:<0-5>\n"
+                    L"\t - logging verbosity for all information to be written to the console\n"
+                    L"\t   <default> == 4\n"
+                    L"\t   - 0 : off (nothing written to the console)\n"
+                    L"\t   - 1 : status updates\n"
+                    L"\t   - 2 : error information only\n"
+                    L"\t   - 3 : connection information only\n"
+                    L"\t   - 4 : connection information + error information\n"
+                    L"\t   - 5 : connection information + error information + status updates\n"
+                    // L"\t   - 6 : above + debug output\n" // Not exposing debug information to users
+                    L"-ConnectionFilename:<filename with/without path>\n"
+                    L"\t - <default> == (not written to a log file)\n"
+                    L"\t   note : the same filename can be specified for the different logging options\n"
+                    L"\t          in which case the same file will receive all the specified details\n"
+                    L"-ErrorFilename:<filename with/without path>\n"
+                    L"\t - <default> == (not written to a log file)\n"
+                    L"\t   note : the same filename can be specified for the different logging options\n"
+                    L"\t          in which case the same file will receive all the specified details\n"
+                    L"-StatusFilename:<filename with/without path>\n"
+                    L"\t - <default> == (not written to a log file)\n"
+                    L"\t   note : the same filename can be specified for the different logging options\n"
+                    L"\t          in which case the same file will receive all the specified details\n"
+                    L"-JitterFilename:<filename with/without path>\n"
+                    L"\t - <default> == (not written to a log file)\n"
+                    L"\t   note : the same filename can be specified for the different logging options\n"
+                    L"\t          in which case the same file will receive all the specified details\n"
+                    L"\t   note : -ConnectionFilename and -JitterFilename can be given a .ctsb extension\n"
+                    L"\t          to write fixed-size binary records instead of text, for high connection and frame rates\n"
+                    L"\t          convert these to csv after the run with: ctsTraffic.exe -ConvertLog:<filename>.ctsb\n"
+                    L"-HistogramFilename:<filename>.csv\n"
+                    L"\t - <default> == (not written to a log file)\n"
+                    L"\t - writes the IO, connection, first byte and transaction latency histograms when the run completes:\n"
+                    L"\t   one line per non-zero bucket with the highest duration (in us) it counts\n"
+                    L"\t   histograms written by different clients can be merged exactly by adding the counts of equal buckets\n"
+                    L"\t   note : requires -LatencyPercentiles (TCP only)\n"
+                    L"-JitterSummaryFilename:<filename>.csv\n"
+                    L"\t - <default> == (not written to a log file)\n"
+                    L"\t - writes one line per second of the stream instead of one per frame: for long-running streams\n"
+                    L"\t   counting the successful, dropped and duplicate frames, the datagrams received after their frame\n"
+                    L"\t   was rendered, the START requests re-sent, and the average and max jitter of the successful frames\n"
+                    L"\t   can be used with or without -JitterFilename (which is still needed for per-frame detail)\n"
+                    L"-StatusUpdate:####\n"
+                    L"\t - the millisecond frequency which real-time status updates are written\n"
+                    L"\t   <default> == 5000 (milliseconds)\n"
+                    L"-StatsSharedMemory:<name>\n"
+                    L"\t - <default> == (not written to shared memory)\n"
+                    L"\t - creates a named shared-memory region holding the running connection, TCP and UDP totals\n"
+                    L"\t   and per-processor byte counts, updated every 100ms independent of -StatusUpdate\n"
+                    L"\t   external tools read it with the ctsSharedStats layout and ctsReadSharedStats in ctsSharedStats.h\n"
+                    L"\t   note : prefix the name with Local\\ or Global\\ to choose the namespace (Global\\ requires admin)\n"
+                    L"-CheckpointFilename:<filename>\n"
+                    L"\t - <default> == (not written to a checkpoint file)\n"
+                    L"\t - appends the running connection, TCP and UDP totals and the latency histograms to the file\n"
+                    L"\t   every -CheckpointInterval, flushing only the new record to disk: for long soak runs\n"
+                    L"\t   if the run (or the machine) crashes, ctsTraffic -RebuildSummary:<filename> prints the summary\n"
+                    L"\t   from the latest complete checkpoint\n"
+                    L"-CheckpointInterval:####\n"
+                    L"\t - the millisecond frequency which checkpoints are appended to the -CheckpointFilename\n"
+                    L"\t   <default> == 60000 (milliseconds)\n"
+                    L"\t   note : must be at least 1000 milliseconds\n"
+                    L"-ThreadStatistics:<on,off>\n"
+                    L"\t - <default> == off\n"
+                    L"\t - writes a line per completion thread to the -StatusFilename with each status update:\n"
+                    L"\t   the completions, inline completions (-InlineCompletions), bytes, and time in and out of the\n"
+                    L"\t   completion callbacks, followed by the max/mean completions across threads to show imbalance\n"
+                    L"\t   note : requires -StatusFilename, which cannot be of csv format\n"
+                    L"-HostConfiguration:<on,off>\n"
+                    L"\t - <default> == on\n"
+                    L"\t - records the configuration of the host with the settings written when the run starts:\n"
+                    L"\t   the driver, RSS, LSO/USO/RSC, interrupt moderation and buffer settings of the adapters in use\n"
+                    L"\t   (routing to the targets or holding the bound addresses, else every adapter which is up)\n"
+                    L"\t   and the active power plan, with a warning for settings known to limit throughput\n"
+                    L"\t   note : 'off' skips the WMI queries made at startup\n"
+                    L"-HostCounters:<on,off>\n"
+                    L"\t - <default> == off\n"
+                    L"\t - samples the host processor, network adapter and TCP counters (the same PDH counters as ctsPerf)\n"
+                    L"\t   with each status update, adding them as columns to the console and -StatusFilename:\n"
+                    L"\t   processor, DPC and interrupt time, adapter bytes and packets/sec and TCP retransmits/sec\n"
+                    L"\t   each sample covers exactly the TimeSlice period of its row, rather than ctsPerf's own clock\n"
+                    L"\t   note : only applicable to TCP\n"
+                    L"\t   note : the counters are for the whole host : other processes' traffic is included\n"
+                    L"-MemoryAccounting:<on,off>\n"
+                    L"\t - <default> == off\n"
+                    L"\t - adds up the memory each connection held as it closes: the ctsSocket and ctsIOPattern objects,\n"
+                    L"\t   the recv buffers, the RIO registered memory leased, the allocations tracking outstanding tasks,\n"
+                    L"\t   the timers and the ctThreadIocp, printed as bytes per connection for the -IO and -Pattern used\n"
+                    L"\t - samples the process private bytes and non-paged pool with each status update, printing the peaks\n"
+                    L"\t   and writing each sample to the -StatusFilename when it is not of csv format\n"
+                    L"\t   note : the recv buffers are not counted with -Buffer:shared, as all connections share them\n"
+                    L"-ConnectionLog:<full,aggregate>\n"
+                    L"\t - <default> == full\n"
+                    L"\t - full : writes a line to the console and the -ConnectionFilename for each connection\n"
+                    L"\t - aggregate : writes one line per status update instead, formatting nothing per connection:\n"
+                    L"\t   the connections established and completed, the succeeded, network and protocol errors,\n"
+                    L"\t   the count of each error code, and histograms of the connection time (ms) and bytes\n"
+                    L"\t   each histogram is written as <highest value>:<count> for each non-zero power-of-2 bucket\n"
+                    L"\t   note : for high connection rates where formatting each connection becomes the bottleneck\n"
+                    L"\t   note : cannot be used with a binary (.ctsb) -ConnectionFilename\n"
+                    L"-ConnectionLogSamples:####\n"
+                    L"\t - <default> == 0\n"
+                    L"\t - with -ConnectionLog:aggregate, also writes the full results of up to #### connections per status update\n"
+                    L"\t   sampled uniformly across all connections completed in that update (reservoir sampling)\n"
+                    L"\t   note : requires a -ConnectionFilename that is not of csv format\n"
+                    L"\n");
+                break;
+
+            case PrintUsageOption::Advanced:
+                usage.append(L"\n"
+                    L"----------------------------------------------------------------------\n"
+                    L"                        Advanced Options                              \n"
+                    L"                                                                      \n"
+                    L"  * these options target specific scenario requirements               \n"
+                    L"----------------------------------------------------------------------\n"
+                    L"-AckFrequency:###\n"
+                    L"   - sets the number of segments TCP receives before sending a delayed ACK (SIO_TCP_SET_ACK_FREQUENCY)\n"
+                    L"\t- <default> == not set (the system default delayed-ACK frequency)\n"
+                    L"\t  note : only applicable to TCP; must be between 1 and 255 (1 acknowledges every segment)\n"
+                    L"-Acc:<accept,AcceptEx>\n"
+                    L"   - specifies the Winsock API to process accepting inbound connections\n"
+                    L"    the default is appropriate unless deliberately needing to test other APIs\n"
+                    L"\t- <default> == AcceptEx\n"
+                    L"\t- AcceptEx : uses OVERLAPPED AcceptEx with IO Completion ports\n"
+                    L"\t- accept : uses blocking calls to accept\n"
+                    L"\t         : be careful using this as it will not scale out well as each call blocks a thread\n"
+                    L"-AcceptQueues:<shared,processor,####>\n"
+                    L"   - the number of accept queues splitting the AcceptEx requests posted on each listening socket\n"
+                    L"     each queue posts its own -PrePostAccepts requests on every listener and has its own lock,\n"
+                    L"     its own accepted connections and pended requests: accepting on each processor's own queue\n"
+                    L"\t- <default> == shared\n"
+                    L"\t- shared : a single accept queue for all processors\n"
+                    L"\t- processor : one accept queue per processor\n"
+                    L"\t- #### : the given number of accept queues\n"
+                    L"\t  note : only applicable to servers using -acc:AcceptEx\n"
+                    L"\t  note : connections queued on another processor's queue are taken before a request is pended\n"
+                    L"-Bind:<IP-address or *>\n"
+                    L"   - a client-side option used to control what IP address is used for outgoing connections\n"
+                    L"\t- <default> == *  (will implicitly bind to the correct IP to connect to the target IP)\n"
+                    L"\t  note : this is typically only necessary when wanting to distribute traffic\n"
+                    L"\t         over a specific interface for multi-homed configurations\n"
+                    L"\t  note : can specify multiple addresses by providing -Bind for each address\n"
+                    L"-BufferSegments:####\n"
+                    L"   - the number of WSABUFs each send and recv is posted with (a gather or scatter list)\n"
+                    L"     over the IO's buffer, instead of a single contiguous WSABUF\n"
+                    L"\t- <default> == 1  (up to 64)\n"
+                    L"\t  note : only applicable to TCP with -IO:iocp or -IO:coroutine\n"
+                    L"-BufferSegmentHeader:####\n"
+                    L"   - the length of the first of the -BufferSegments, to model a header followed by a payload\n"
+                    L"     the remainder of the buffer is then split evenly across the remaining segments\n"
+                    L"\t- <default> == 0  (the buffer is split evenly across all segments)\n"
+                    L"-Compartment:<ifAlias>\n"
+                    L"   - specifies the interface alias of the compartment to use for all sockets\n"
+                    L"    this is most commonly appropriate for servers configured with IP Compartments\n"
+                    L"\t- <default> == using the default IP compartment\n"
+                    L"\t  note : all systems use the default compartment unless explicitly configured otherwise\n"
+                    L"\t  note : the IP addresses specified through -Bind (for clients) and -Listen (for servers)\n"
+                    L"\t         will be directly affected by this Compartment value, including specifying '*'\n"
+                    L"-CompletionEngine:<threadpool,dedicated>\n"
+                    L"   - what completes OVERLAPPED IO for -IO:iocp and -IO:readwritefile\n"
+                    L"\t- <default> == threadpool\n"
+                    L"\t- threadpool : IO completes through the system threadpool (CreateThreadpoolIo)\n"
+                    L"\t- dedicated : one thread per processor, affinitized to it, each owning its own IO completion port\n"
+                    L"\t              draining completions in batches with GetQueuedCompletionStatusEx\n"
+                    L"\t              sockets are distributed round-robin across these completion ports\n"
+                    L"-ConnectData:<on,off>\n"
+                    L"   - the client generates the connection ID and sends it as the ConnectEx send data,\n"
+                    L"     and the server receives it as the AcceptEx receive data, instead of the server sending\n"
+                    L"     the connection ID once connected : saving an IO round before the first data is sent\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : only applicable to TCP, with -conn:ConnectEx and -acc:AcceptEx\n"
+                    L"\t  note : both the client and the server must specify -ConnectData:on\n"
+                    L"\t         (servers will not accept connections from clients that do not send the connection ID)\n"
+                    L"-CpuEfficiency:<off,on,detailed>\n"
+                    L"   - samples the CPU cycles consumed by the process (QueryProcessCycleTime) to report efficiency:\n"
+                    L"     cycles per byte and cycles per IO in each TCP status update,\n"
+                    L"     and cycles per byte, per IO and per completed connection in the final summary\n"
+                    L"\t- <default> == off\n"
+                    L"\t- detailed : also reports the kernel and user time (GetProcessTimes) as a percent of all processors\n"
+                    L"\t  note : the cycles include every thread in the process, so compare runs with the same options\n"
+                    L"-Conn:<connect,ConnectEx>\n"
+                    L"   - specifies the Winsock API to establish outbound connections\n"
+                    L"    the default is appropriate unless deliberately needing to test other APIs\n"
+                    L"\t- <default> == ConnectEx  (appropriate unless explicitly wanting to test other APIs)\n"
+                    L"\t- ConnectEx : uses OVERLAPPED ConnectEx with IO Completion ports\n"
+                    L"\t- connect : uses blocking calls to connect\n"
+                    L"\t          : be careful using this as it will not scale out well as each call blocks a thread\n"
+                    L"-ContiguousDatagrams:<on,off>\n"
+                    L"   - the MediaStream server lays out each frame's datagrams in a cache-aligned send buffer kept per stream,\n"
+                    L"     writing each datagram's header in front of its data, so every datagram is sent as a single buffer\n"
+                    L"     instead of gathering the header fields and the data from separate buffers\n"
+                    L"\t- <default> == off  (each datagram is sent from 5 buffers)\n"
+                    L"\t  note : this is a UDP server-only option; with -UdpSendOffload each frame is sent as a single buffer\n"
+                    L"-IfIndex:####\n"
+                    L"   - the interface index which to use for outbound connectivity\n"
+                    L"     assigns the interface with IP_UNICAST_IF / IPV6_UNICAST_IF\n"
+                    L"\t- <default> == not set (will not restrict binding to any specific interface)\n"
+                    L"-InlineCompletions:<on,off>\n"
+                    L"   - will set the below option on all SOCKETS for OVERLAPPED I/O calls so inline successful\n"
+                    L"     completions will not be queued to the completion handler\n"
+                    L"     ::SetFileCompletionNotificationModes(FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)\n"
+                    L"\t- <default> == on for TCP 'iocp' -IO option, and is on for UDP client receivers\n"
+                    L"                 off for all other -IO options\n"
+                    L"-InlineCompletionBudget:<####,####us>\n"
+                    L"   - the sends and recvs (or with the 'us' suffix, the microseconds) a connection may complete inline\n"
+                    L"     before it yields its thread, continuing its IO from the threadpool so one fast connection\n"
+                    L"     cannot starve the other connections completing on the same thread\n"
+                    L"\t- <default> == 0  (connections complete IO inline for as long as it completes synchronously)\n"
+                    L"\t  note : only applicable to TCP with -IO:iocp and -InlineCompletions:on\n"
+                    L"-InlineStateTransitions:<on,off>\n"
+                    L"   - each connection connects, and then initiates its IO, on the thread which completed the state\n"
+                    L"     before it (when that thread holds no locks), instead of queueing each state to the threadpool\n"
+                    L"     saving the thread hops each connection makes before its first byte : most visible with short connections\n"
+                    L"     the summary reports the transitions run inline and queued, and the connections completed per second;\n"
+                    L"     with -LatencyPercentiles, the latency from completing each state to running the next\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : closing is always queued; accepted connections are completed holding the accept lock, so are queued\n"
+                    L"-IO:<readwritefile,transmitpackets,notifications,memory,tls,coroutine>\n"
+                    L"   - additional IO options beyond iocp and rioiocp\n"
+                    L"\t- readwritefile : leverages ReadFile/WriteFile using IOCP for async completions\n"
+                    L"\t- transmitpackets : sends with TransmitPackets, describing each send buffer as a batch of memory elements\n"
+                    L"\t                    using IOCP for async completions (receives are the same as iocp)\n"
+                    L"\t- notifications : non-blocking send/recv, waiting for readiness with ProcessSocketNotifications\n"
+                    L"\t                  when IO would block (requires a Windows build exporting ProcessSocketNotifications)\n"
+                    L"\t- memory : no sockets - each client connection is paired with a server IO pattern inside this process,\n"
+                    L"\t           the two exchanging their buffers over in-memory channels (TCP clients only)\n"
+                    L"\t           measures the ceiling of the ctsTraffic engine itself for the -Pattern and -Buffer given\n"
+                    L"\t  note : memory still requires a -Target, which is only displayed as the remote address\n"
+                    L"\t- tls : each TCP connection negotiates a Schannel TLS session once connected, and the -Pattern\n"
+                    L"\t        runs over its records : sent with WSASend and received with WSARecv using IOCP\n"
+                    L"\t        the summary reports the handshakes per second, the encrypted throughput,\n"
+                    L"\t        and the cycles per byte spent in EncryptMessage and DecryptMessage\n"
+                    L"\t  note : tls requires -TlsCertificate on the server, and supports only -PrePostRecvs:1\n"
+                    L"\t- coroutine : the same WSASend/WSARecv using IOCP as iocp, with each connection driven by one coroutine\n"
+                    L"\t              which posts the pattern's IO and awaits their completions, processing all completions\n"
+                    L"\t              that arrived while it ran under a single acquisition of the socket lock\n"
+                    L"-KeepAliveValue:####\n"
+                    L"   - the # of milliseconds to set KeepAlive for TCP connections\n"
+                    L"\t- <default> == not set\n"
+                    L"\t  note : This setting is a more specific setting than -Options:keepalive\n"
+                    L"\t         as -Options:keepalive will use the system default values for keep-alive timers\n"
+                    L"-LatencyPercentiles:##,##,##.#\n"
+                    L"   - tracks the latency of every TCP send and recv, from initiating the IO until it completes,\n"
+                    L"     printing the specified percentiles and the maximum in the status updates and the final summary\n"
+                    L"   - also tracks connection establishment latency, from posting ConnectEx (-Conn:ConnectEx)\n"
+                    L"     or AcceptEx (-Acc:AcceptEx) until it completes\n"
+                    L"\t- <default> == <not set> (IO and connection latency are not tracked)\n"
+                    L"\t- for example, -LatencyPercentiles:50,99,99.9\n"
+                    L"\t  note : at most 4 percentiles can be specified\n"
+                    L"\t  note : latencies are tracked in buckets within 6.25% of the latencies they count\n"
+                    L"-LargePages:<on,off>\n"
+                    L"   - allocates the process-wide send buffer (and the shared recv buffer) on large pages\n"
+                    L"     reducing TLB misses when sending or receiving at high rates\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : requires the 'Lock pages in memory' privilege (SeLockMemoryPrivilege)\n"
+                    L"\t         falls back to regular pages when large pages cannot be allocated\n"
+                    L"-LeanProtocol:<on,off>\n"
+                    L"   - removes the round trips ctsTraffic adds around each TCP transfer, for tiny transfers at high rates:\n"
+                    L"     the client sends a 20-byte header (a marker and its binary connection ID) immediately followed\n"
+                    L"     by its IO, instead of first waiting to receive the server's connection ID\n"
+                    L"     and the transfer ends with the FIN once the expected bytes were transferred,\n"
+                    L"     instead of the client waiting to receive the server's completion message\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : only applicable to TCP with -Pattern:Push, Pull, PushPull or Duplex and -Shutdown:graceful\n"
+                    L"\t  note : both the client and the server must specify -LeanProtocol:on\n"
+                    L"\t         (servers fail connections which don't start with the marker; clients without it\n"
+                    L"\t          wait for a connection ID a -LeanProtocol server never sends)\n"
+                    L"\t  note : with -ConnectData:on the connection ID is still sent with ConnectEx\n"
+                    L"-LocalPort:####\n"
+                    L"   - the local port to bind to when initiating a connection\n"
+                    L"\t- <default> == 0  (an ephemeral port will be chosen when making a connection)\n"
+                    L"\t- supports range : [low,high] each new connection will sequentially choose a port within this range\n"
+                    L"\t  note : You must provide a sufficiently large range to support the number of connections\n"
+                    L"\t  note : Be very careful when using with TCP connections, as port values will not be immediately\n"
+                    L"\t         reusable; TCP will hold an closed IP:port in a TIME_WAIT statue for a period of time\n"
+                    L"\t         only after which will it be able to be reused (TcpTimedWaitDelay, default is 2 minutes)\n"
+                    L"\t         ports from a range are only chosen again once their TIME_WAIT has passed, while others are free\n"
+                    L"-PortReservation:<####,on>\n"
+                    L"   - reserves local ports for outgoing connections with a runtime port reservation,\n"
+                    L"     split into one reservation per processor: each new connection is bound from its processor's\n"
+                    L"     reservation, the stack choosing a port that is not in use or in TIME_WAIT\n"
+                    L"\t- #### : the number of ports to reserve, where the stack chooses the range\n"
+                    L"\t- on : reserves the range given to -LocalPort:[low,high]\n"
+                    L"\t- <default> == off (ports are chosen from the ephemeral port range, or from -LocalPort)\n"
+                    L"\t  note : the ports must not be in use when the reservation is made\n");
+                usage.append(L"-MessageSize:####\n"
+                    L"   - every send is a single message of this many bytes, for measuring small-message packet rates\n"
+                    L"     recvs are still posted with -Buffer: the messages each recv completes show how TCP coalesced them\n"
+                    L"     the summary reports messages per second, send and recv calls per message, and the coalescing ratio\n"
+                    L"\t- <default> == not set (sends are sized by -Buffer)\n"
+                    L"\t  note : only applicable to TCP with -Pattern:Push, Pull, PushPull or Duplex; it must not exceed -Buffer\n"
+                    L"\t         it can't be used with -IO:RIO, -verify:checksum or -BufferSegments\n"
+                    L"\t  note : -PrePostSends then counts the messages kept in flight\n"
+                    L"\t  note : give both the client and the server the same -MessageSize\n"
+                    L"\t  note : recvs wait to fill their buffer with -MsgWaitAll:on; set -MsgWaitAll:off to see the coalescing\n"
+                    L"-MsgWaitAll:<on,off>\n"
+                    L"   - sets the MSG_WAITALL flag when calling WSARecv for receiving data over TCP connections\n"
+                    L"     this flag instructs TCP to not complete the receive request until the entire buffer is full\n"
+                    L"\t- <default> == on\n"
+                    L"\t  note : the default behavior when not specified is for TCP to indicate data up to the app per RFC\n"
+                    L"           thus apps generally only set this when they know precisely the number of bytes they are expecting\n"
+                    L"-MultiplexStreams:<on,off>\n"
+                    L"   - MediaStream clients multiplex their streams over UDP sockets shared by all streams to each server\n"
+                    L"     one socket per processor to each server, the server tags each datagram with the ID of its stream\n"
+                    L"\t- <default> == off  (each stream sends and receives on its own socket)\n"
+                    L"\t  note : the server must be a version supporting multiplexed streams\n"
+                    L"\t  note : not supported with -io:rioiocp, -io:riopoll, -UdpRecvOffload, -UdpRecvTimestamps or -LocalPort\n"
+                    L"-NumaLocalBuffers:<on,off>\n"
+                    L"   - allocates a replica of the process-wide send and shared recv buffers on each NUMA node\n"
+                    L"     each send uses the replica of the node running it, avoiding reads across the interconnect\n"
+                    L"\t- <default> == off  (one copy allocated on the node which first creates a connection)\n"
+                    L"-NumaThreadpools:<on,off>\n"
+                    L"   - creates a threadpool per NUMA node with threads affinitized to that node's processors\n"
+                    L"     each connection's IO completes on the pool of the node RSS indicates its packets on\n"
+                    L"\t- <default> == off  (all IO completes on one process-wide threadpool)\n"
+                    L"-OnError:<log,break>\n"
+                    L"   - policy to control how errors are handled at runtime\n"
+                    L"\t- <default> == log \n"
+                    L"\t- log : log error information only\n"
+                    L"\t- break : break into the debugger with error information\n"
+                    L"\t          useful when live-troubleshooting difficult failures\n"
+                    L"-Options:<keepalive,tcpfastpath,tcpfastopen,nodelay>  [-Options:<...>] [-Options:<...>]\n"
+                    L"   - additional socket options and IOCTLS available to be set on connected sockets\n"
+                    L"\t- <default> == None\n"
+                    L"\t- keepalive : only for TCP sockets - enables default timeout Keep-Alive probes\n"
+                    L"\t            : ctsTraffic servers have this enabled by default\n"
+                    L"\t- tcpfastpath : a new option for Windows 8, only for TCP sockets over loopback\n"
+                    L"\t              : the firewall must be disabled for the option to take effect\n"
+                    L"\t- tcpfastopen : only for TCP sockets - sets TCP_FASTOPEN on every socket, on both the client and the server\n"
+                    L"\t              : the connection ID sent with ConnectEx is carried within the SYN once the client\n"
+                    L"\t                holds a TFO cookie from the server, saving a round trip before the first byte\n"
+                    L"\t              : requires -ConnectData:on (with -conn:ConnectEx and -acc:AcceptEx)\n"
+                    L"\t              : with -LatencyPercentiles, compare the Connect Latency and First Byte Latency\n"
+                    L"\t- nodelay : only for TCP sockets - sets TCP_NODELAY on every socket, disabling Nagle's coalescing of small sends\n"
+                    L"\t          : compare runs with and without it using -MessageSize\n"
+                    L"-PayloadFile:<filename with/without path>\n"
+                    L"   - sends the content of this file (mapped read-only and shared by every connection)\n"
+                    L"     instead of the synthetic buffer pattern, for payloads with realistic entropy\n"
+                    L"     sends are made directly from the mapping and received data is verified against the same mapping\n"
+                    L"\t- <default> == not set (sends the synthetic buffer pattern)\n"
+                    L"\t  note : the payload repeats the file truncated to a multiple of 64KB (up to 1GB)\n"
+                    L"\t         it must be at least as large as the largest -buffer; it can't be used with -verify:checksum\n"
+                    L"\t  note : both endpoints must be given the same file to verify the received data\n"
+                    L"-PersistentTransfers:####\n"
+                    L"   - the number of back-to-back transfers of -Transfer bytes made over each TCP connection\n"
+                    L"     each transfer ends with the server's completion message, the next starting over the same\n"
+                    L"     connection (keeping its buffers and its open congestion window) instead of shutting it down\n"
+                    L"     the time of the first (cold) transfer is written with each connection's results, against\n"
+                    L"     the average of the (warm) transfers after it, and the summary compares their throughput\n"
+                    L"\t- <default> == 1\n"
+                    L"\t  note : only applicable to -Pattern:Push, Pull, PushPull and Duplex (not with -Relay)\n"
+                    L"\t  note : the client and the server must both be given the same number\n"
+                    L"-PrecreateSockets:<on,off>\n"
+                    L"   - clients create, bind and associate with the threadpool -Connections sockets before the run starts,\n"
+                    L"     across all processors, so the start of the run only measures the connects\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : only applicable to TCP clients (not with RIO, -LocalPort or -PortReservation)\n"
+                    L"\t  note : combine with -ThrottleConnections to control how many connects are issued at once\n"
+                    L"-PrePostAccepts:#####\n"
+                    L"-PrePostAccepts:[#####,#####]\n"
+                    L"   - the number of AcceptEx requests kept posted on each listening socket\n"
+                    L"     given a range, the number adapts to the rate connections are accepted: doubling when\n"
+                    L"     every posted request completed within a second, halving when idle, within [low,high]\n"
+                    L"\t- <default> == [100,1000]\n"
+                    L"\t  note : only applicable to servers using -acc:AcceptEx or -pattern:mediastream\n"
+                    L"\t  note : MediaStream servers keep this fixed number of WSARecvFrom requests posted on each\n"
+                    L"\t         listening socket to receive START messages (<default> == the number of processors)\n"
+                    L"-PrePostRecvs:#####\n"
+                    L"   - specifies the number of recv requests to issue concurrently within an IO Pattern\n"
+                    L"   - for example, with the default -pattern:pull, the client will post recv calls \n"
+                    L"\t     one after another, immediately posting a recv after the prior completed.\n"
+                    L"\t     with -pattern:pull -PrePostRecvs:2, clients will keep 2 recv calls in-flight at all times.\n"
+                    L"\t- <default> == 1 for TCP (one recv request at a time)\n"
+                    L"\t- <default> == 2 for UDP (two recv requests kept in-flight)\n"
+                    L"\t  note : with TCP patterns, -verify:connection must be specified in order to specify\n"
+                    L"\t         more than one -PrePostRecvs (UDP can always support any number)\n"
+                    L"-PrePostSends:#####\n"
+                    L"   - specifies the number of send requests to issue concurrently within an IO Pattern\n"
+                    L"   - for example, with the default -pattern:pull, the servers will post send calls \n"
+                    L"\t     one after another, immediately posting a send after the prior completed.\n"
+                    L"\t     With -pattern:pull -PrePostSends:2, servers will keep 2 send calls in-flight at all times.\n"
+                    L"   - The value of '0' has special meaning: it indicates for ctsTraffic to keep as many sends\n"
+                    L"\t     in flight as indicated by the Ideal Send Backlog (ISB) indicated by TCP. In this\n"
+                    L"\t     configuration, ctsTraffic will maintain send calls until the number of bytes being sent\n"
+                    L"\t     equals the number of byes indicates by ISB for that TCP connection.\n"
+                    L"\t- <default> == 1 for non-RIO TCP (Winsock will adjust automatically according to ISB)\n"
+                    L"\t- <default> == 0 (ISB) for RIO TCP (RIO doesn't user send buffers so callers must track ISB)\n"
+                    L"\t- <default> == 1 for UDP (one send request on each timer tick)\n"
+                    L"-Probes:####\n"
+                    L"   - clients keep this many probe connections open alongside the bulk connections, each pinging\n"
+                    L"     64 bytes the server echoes back, the next ping -ProbeInterval after each echo\n"
+                    L"   - each status line adds the round-trip latency percentiles of the pings within the TimeSlice:\n"
+                    L"     the queueing delay the bulk transfers add in the NIC and the network stack\n"
+                    L"   - servers given -Probes also listen on the -ProbePort for the probe connections\n"
+                    L"\t- <default> == 0 (no probe connections)\n"
+                    L"\t  note : only applicable to TCP -Pattern:Push, Pull, PushPull and Duplex (not with -Relay,\n"
+                    L"\t         -PersistentTransfers or -LeanProtocol)\n"
+                    L"\t  note : probe connections are replaced after 1000 pings, and are not counted by -Connections\n"
+                    L"-ProbeInterval:####\n"
+                    L"   - the milliseconds each probe connection waits after an echo before sending its next ping\n"
+                    L"\t- <default> == 100\n"
+                    L"-ProbePort:####\n"
+                    L"   - the port probe connections are made to, and servers accept them on\n"
+                    L"\t- <default> == -Port + 1\n"
+                    L"-RateLimitPacing:<on,off>\n"
+                    L"   - spreads the -RateLimit bytes/second evenly across sends instead of per -RateLimitPeriod\n"
+                    L"\t     each send is delayed until the bytes sent before it have drained at the limited rate,\n"
+                    L"\t     waiting on high-resolution (sub-millisecond) timers, to emulate a paced sender\n"
+                    L"\t- <default> == off (each -RateLimitPeriod quantum of bytes is sent as fast as possible)\n"
+                    L"\t  note : only applicable is -RateLimit is set\n"
+                    L"\t  note : high-resolution timers require Windows 10 1803 or later (falling back to millisecond timers)\n"
+                    L"-RateSearch:####\n"
+                    L"   - searches the -RateLimit:[low,high] range for the highest rate (bytes/second/connection)\n"
+                    L"     sustained without errors, instead of sending at random rates within the range\n"
+                    L"\t     every connection is moved to each rate tried, running #### milliseconds per step:\n"
+                    L"\t     a step is stable when no connection failed, the connections sent at least 95% of the rate,\n"
+                    L"\t     and with -LatencyPercentiles, the highest percentile stayed within 2x the lowest seen\n"
+                    L"\t     the run ends once the highest stable rate is found to within 2%\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : TCP clients with -Pattern:Push or Duplex only, as the client must be the sender\n"
+                    L"\t         each step must be at least 1000 ms - the first quarter of each step is not measured\n"
+                    L"-LoadProfile:<file>\n"
+                    L"   - varies the connections and the rate limit (bytes/second/connection) through the run\n"
+                    L"\t     following the segments of a text file, one per line: <duration ms> <connections> <bytes/second>\n"
+                    L"\t     each value is either a constant (####), a linear ramp across the segment (####-####),\n"
+                    L"\t     or a burst alternating between two values every half of a period (####/####:<period ms>)\n"
+                    L"\t     a rate of 0 is unlimited; '#' starts a comment\n"
+                    L"\t     for example, a 60 second ramp from 1 to 100 connections, then 30 seconds of bursts:\n"
+                    L"\t       60000 1-100 1000000\n"
+                    L"\t       30000 100 0/5000000:2000\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : TCP clients only; replaces -Connections and -RateLimit, and -TimeLimit defaults to the profile length\n"
+                    L"\t         fewer connections are reached as connections complete: use -Transfer so connections turn over\n"
+                    L"\t         the status updates print the connection and rate targets\n"
+                    L"-RateLimitPeriod:#####\n"
+                    L"   - the # of milliseconds describing the granularity by which -RateLimit bytes/second is enforced\n"
+                    L"\t     the -RateLimit bytes/second will be evenly split across -RateLimitPeriod milliseconds\n"
+                    L"\t     For example, -RateLimit:1000 -RateLimitPeriod:50 will limit send rates to 100 bytes every 20 ms\n"
+                    L"\t- <default> == 100 (-RateLimit bytes/second will be split out across 100 ms. time slices)\n"
+                    L"\t  note : only applicable to TCP connections\n"
+                    L"\t  note : only applicable is -RateLimit is set (default is not to rate limit)\n"
+                    L"-RecvBufValue:<#####,auto>\n"
+                    L"   - specifies the value to pass to the SO_RCVBUF socket option\n"
+                    L"\t     Note: this is only necessary to specify in carefully considered scenarios\n"
+                    L"\t     the default receive buffering is optimal for the majority of scenarios\n"
+                    L"\t- <default> == <not set>\n"
+                    L"\t- auto : sized per connection to twice its bandwidth-delay product, measured with SIO_TCP_INFO\n"
+                    L"\t         over the first 200 ms of IO (the larger of the bytes delivered per RTT and the cwnd)\n"
+                    L"\t         between 64KB and 16MB : the sizes chosen are written with each connection's results\n"
+                    L"\t  note : auto is only applicable to TCP (the number of -PrePostRecvs is not changed)\n"
+                    L"-Relay:<addr or name>  [-Relay:<addr or name>] [-Relay:<...>]\n"
+                    L"   - servers relay each accepted connection over a connection they make to the next -Relay address,\n"
+                    L"     forwarding bytes in both directions until each side has shutdown its sends\n"
+                    L"   - the buffer each recv completes into is the buffer sent on the other connection (no copies)\n"
+                    L"   - reports the forwarded throughput, the latency each forward added and the CPU per forwarded byte:\n"
+                    L"     a reference ceiling for proxies run between the same clients and servers\n"
+                    L"\t- <default> == <not set>\n"
+                    L"\t  note : only applicable to TCP servers with -io:iocp (not with -ConnectData)\n");
+                usage.append(L"-RelayBuffers:####\n"
+                    L"   - the buffers forwarding each direction of a relayed connection, each the -Buffer size\n"
+                    L"\t- <default> == 2 (one received into while the other is sent)\n"
+                    L"-RelayPort:####\n"
+                    L"   - the port connected to on -Relay addresses which don't specify one\n"
+                    L"\t- <default> == -Port\n"
+                    L"-RioCompletionQueues:<shared,processor,####>\n"
+                    L"   - the number of RIO completion queues to create when using -IO:rioiocp or -IO:riopoll\n"
+                    L"\t- <default> == shared\n"
+                    L"\t- shared : a single completion queue is dequeued by one thread per processor\n"
+                    L"\t- processor : one completion queue per processor, each with its own affinitized thread\n"
+                    L"\t- #### : the given number of completion queues (up to the number of processors)\n"
+                    L"\t  note : sockets are assigned across completion queues round-robin\n"
+                    L"\t  note : with -IO:riopoll each completion queue is always polled by a single affinitized thread\n"
+                    L"-RioDequeueBatch:<adaptive,####>\n"
+                    L"   - the number of completions to dequeue from a RIO completion queue at once with -IO:rioiocp or -IO:riopoll\n"
+                    L"\t- <default> == adaptive\n"
+                    L"\t- adaptive : starts at 20, doubling while the queue returns full batches and halving while mostly idle\n"
+                    L"\t- #### : always dequeue up to the given number of completions (up to 1024)\n"
+                    L"\t  note : the status output shows the average completions returned per dequeue\n"
+                    L"-RioPollSpin:####\n"
+                    L"   - the number of consecutive empty polls of the completion queue before yielding with -IO:riopoll\n"
+                    L"\t- <default> == 1000\n"
+                    L"\t- 0 : never yield the processor (purely spin)\n"
+                    L"-SendBufValue:<#####,auto>\n"
+                    L"   - specifies the value to pass to the SO_SNDBUF socket option\n"
+                    L"\t     Note: this is only necessary to specify in carefully considered scenarios\n"
+                    L"\t     the default send buffering is optimal for the majority of scenarios\n"
+                    L"\t- <default> == <not set>\n"
+                    L"\t- auto : sized per connection as -RecvBufValue:auto, the bytes of sends kept in flight\n"
+                    L"\t         then being at least that size (ideal send backlog notifications can still raise it)\n"
+                    L"\t  note : auto is only applicable to TCP\n"
+                    L"-SocketReuse:<on,off>\n"
+                    L"   - closed connections are disconnected with DisconnectEx(TF_REUSE_SOCKET) instead of closing the socket :\n"
+                    L"     the socket and its IOCP association are pooled and reused by the next ConnectEx or AcceptEx,\n"
+                    L"     saving the socket creation, bind and threadpool IO setup for each connection\n"
+                    L"\t- <default> == off\n"
+                    L"\t  note : only applicable to TCP, with -conn:ConnectEx and -acc:AcceptEx (not with RIO, -LocalPort or -PortReservation)\n"
+                    L"\t  note : only connections which completed successfully are recycled\n"
+                    L"\t  note : the endpoint which closes first holds TIME_WAIT : its DisconnectEx may not complete until TIME_WAIT ends\n"
+                    L"-TcpInfo:####\n"
+                    L"   - samples SIO_TCP_INFO on each TCP connection every #### milliseconds while it transmits data\n"
+                    L"     the RTT, congestion window, bytes in flight and retransmits are added to each connection's results\n"
+                    L"     and summarized across all connections when the run completes\n"
+                    L"\t- <default> == <not set> (TCP_INFO is not sampled)\n"
+                    L"\t  note : requires Windows 10 1703 or later\n"
+                    L"-ConnectionSamples:####\n"
+                    L"   - samples the bytes sent and received by each TCP connection within every #### milliseconds\n"
+                    L"     each connection's results add the lowest and highest interval throughput, the intervals\n"
+                    L"     without any bytes (stalls), the longest run of stalls, and the throughput of the last 32 intervals\n"
+                    L"     to find the slow or stalled connections of a large run without logging each IO\n"
+                    L"\t- <default> == <not set> (connection throughput is not sampled)\n"
+                    L"\t  note : the interval must be at least 10 milliseconds\n"
+                    L"-ThrottleConnections:####\n"
+                    L"   - gates currently pended connection attempts\n"
+                    L"\t- <default> == 1000  (there will be at most 1000 sockets trying to connect at any one time)\n"
+                    L"\t  note : zero means no throttling  (will immediately try to connect all '-Connections')\n"
+                    L"\t       : this is a client-only option\n"
+                    L"-ThrottleConnections:auto\n"
+                    L"   - adapts the pended connection attempts to find the highest sustainable connection rate\n"
+                    L"\t  starting at 8 and adjusting once per second, bounded by -Connections:\n"
+                    L"\t  doubles until the first back off, then grows by an eighth each second connections complete\n"
+                    L"\t  halves when more than 1% of connection attempts fail, or the connect latency doubles from its lowest\n"
+                    L"\t  the highest connection rate sustained without backing off is printed when the run completes\n"
+                    L"\t  note : measures the rate of new connections : combine with -Iterations or a short -Transfer\n"
+                    L"-TimeLimit:#####\n"
+                    L"   - the maximum number of milliseconds to run before the application is aborted and terminated\n"
+                    L"\t- <default> == <no time limit>\n"
+                    L"\t  note : this is to be used only to cap the maximum time to run, as this will log an error\n"
+                    L"\t         if this timelimit is exceeded; predictable results should have the scenario finish\n"
+                    L"\t         before this time limit is hit\n"
+                    L"-WarmUp:####\n"
+                    L"-CoolDown:####\n"
+                    L"   - the milliseconds at the start (-WarmUp) and at the end (-CoolDown) of the run\n"
+                    L"     to exclude from an additional steady-state summary of throughput, connections and latency\n"
+                    L"     excluding TCP slow start, the connection ramp and the teardown\n"
+                    L"\t- <default> == 0  (only the whole run is summarized)\n"
+                    L"\t  note : -CoolDown requires -TimeLimit, as the cool-down is the end of the time limit\n"
+                    L"\t         if the run completes before the cool-down, the steady-state ends when the run ends\n"
+                    L"-Converge:##\n"
+                    L"-ConvergeWindow:##\n"
+                    L"   - stops the run once its throughput has converged : when the mean throughput of the last\n"
+                    L"     -ConvergeWindow status intervals is known to within -Converge percent at 95% confidence\n"
+                    L"     with TCP -LatencyPercentiles, the highest percentile must have converged as well\n"
+                    L"     the summary reports how long the run took to converge, and the converged mean and interval\n"
+                    L"\t- <default> == off  (-ConvergeWindow: 10 status intervals)\n"
+                    L"\t- for example, -Converge:2 stops once the throughput is known to within +/- 2%\n"
+                    L"\t  note : intervals within -WarmUp are not counted; -TimeLimit still caps a run that never converges\n"
+                    L"-Sweep:<parameter>=####,####,...\n"
+                    L"-SweepStep:####\n"
+                    L"   - measures every point of a grid of settings within one run, then prints a table of the\n"
+                    L"     throughput (bytes/second sent and received) and CPU cycles per byte of each point,\n"
+                    L"     and the best point : the fewest cycles per byte within 2% of the highest throughput\n"
+                    L"     the parameters are Buffer, PrePostRecvs, PrePostSends, RecvBufValue and SendBufValue :\n"
+                    L"     give -Sweep once for each parameter swept; the swept values replace the parameter's own\n"
+                    L"\t     each point runs -SweepStep milliseconds : the first quarter of each point is not measured\n"
+                    L"\t     -Buffer applies to established connections at once; the other parameters only to new\n"
+                    L"\t     connections, so a point changing them waits for the prior connections to be replaced\n"
+                    L"\t     as each completes its -Transfer (a point is skipped after 8 -SweepStep intervals)\n"
+                    L"\t- <default> == off  (-SweepStep: 5000 milliseconds)\n"
+                    L"\t- for example, -Sweep:Buffer=4096,65536,262144 -Sweep:PrePostRecvs=1,2,4 -Verify:connection\n"
+                    L"\t  note : TCP clients only, with up to 256 points; cannot be combined with -RateSearch,\n"
+                    L"\t         -LoadProfile or -Converge. -IO is fixed at startup : compare IO models with separate runs\n"
+                    L"-TlsCertificate:<subject>\n"
+                    L"   - with -io:tls, the subject of the server's certificate, found in the local machine's\n"
+                    L"     then the current user's personal (My) certificate store\n"
+                    L"     clients give this as their target name (SNI), which Schannel keys its session cache with\n"
+                    L"\t- <default> == <not set> (required on the server)\n"
+                    L"\t  note : clients do not validate the server certificate\n"
+                    L"-TlsCipher:<aes128,aes256,chacha20>\n"
+                    L"   - with -io:tls, restricts the cipher Schannel can negotiate\n"
+                    L"\t- <default> == <not set> (the system's cipher suite order)\n"
+                    L"\t- aes128 : AES with 128-bit keys\n"
+                    L"\t- aes256 : AES with 256-bit keys\n"
+                    L"\t- chacha20 : ChaCha20-Poly1305 (requires a Windows build supporting it)\n"
+                    L"-TlsProtocol:<1.2,1.3>\n"
+                    L"   - with -io:tls, restricts the TLS version Schannel can negotiate\n"
+                    L"\t- <default> == <not set> (the system's enabled protocols)\n"
+                    L"-TlsResumption:<on,off>\n"
+                    L"   - with -io:tls, whether connections may resume a cached TLS session (an abbreviated handshake)\n"
+                    L"\t- <default> == on\n"
+                    L"\t- off : every connection negotiates a full handshake\n"
+                    L"-UdpRecvOffload:<on,off>\n"
+                    L"   - sets UDP_RECV_MAX_COALESCED_SIZE on all UDP sockets so the stack (or NIC) can coalesce\n"
+                    L"     datagrams from the same sender into a single receive (UDP Receive Offload)\n"
+                    L"     clients post receives large enough for a coalesced receive and split it back into datagrams\n"
+                    L"\t- <default> == off  (one datagram per receive)\n"
+                    L"-UdpRecvTimestamps:<on,off>\n"
+                    L"   - enables SIO_TIMESTAMPING receive timestamps on MediaStream client sockets\n"
+                    L"     jitter and time in flight are then measured from when the stack received each datagram\n"
+                    L"     instead of from when its receive completed, which also includes the time to schedule the completion\n"
+                    L"     -JitterFilename logs the difference between the two as ReceiveDelayMs\n"
+                    L"\t- <default> == off  (datagrams are timed when their receive completes)\n"
+                    L"\t  note : this is a UDP client-only option; requires Windows 10 2004 or later\n"
+                    L"\t         falls back to timing the completion when the stack does not return a timestamp\n"
+                    L"-UdpSendOffload:<on,off>\n"
+                    L"   - sends all datagrams of a MediaStream frame with a single WSASendMsg call\n"
+                    L"     using UDP Send Offload (UDP_SEND_MSG_SIZE) so the stack or NIC segments the frame\n"
+                    L"\t- <default> == off  (one WSASendTo call per datagram)\n"
+                    L"\t  note : this is a UDP server-only option; falls back to one call per datagram\n"
+                    L"\t         when the OS does not support UDP Send Offload\n"
+                    L"-Workers:####\n"
+                    L"   - runs the connections in #### worker processes, each started with this command line\n"
+                    L"     and pinned to the processors of a NUMA node (round-robin across the nodes)\n"
+                    L"     each worker runs a disjoint slice of -Connections (or -ServerExitLimit) and of the -LocalPort range,\n"
+                    L"     and worker N listens on (or connects to) -Port + N : run servers and clients with the same -Workers\n"
+                    L"     this process prints the combined status and summary of all workers\n"
+                    L"\t- <default> == off  (this process runs all connections)\n"
+                    L"\t  note : between 2 and 63 workers; the workers do not write the -*Filename logs of this process\n"
+                    L"\t         cannot be combined with -RateSearch, -Sweep, -LoadProfile, -Converge, -CpuEfficiency,\n"
+                    L"\t         -MemoryAccounting, -ThreadStatistics, -LatencyPercentiles or -io:memory\n"
+                    L"-XdpQueues:####\n"
+                    L"   - the number of RSS queues of the sending interface to bind an AF_XDP socket to with -IO:xdp\n"
+                    L"     the datagrams to each client are always sent from the same queue\n"
+                    L"\t- <default> == 1\n"
+                    L"\t  note : -IO:xdp requires -Listen with the address of the interface to send from;\n"
+                    L"\t         datagrams larger than its MTU are sent as IP fragments, and -UdpSendOffload is not supported\n"
+                    L"-ZeroByteRecv:<on,off>\n"
+                    L"   - each receive first posts a zero-byte WSARecv; only once data is indicated is a buffer\n"
+                    L"     leased from a process-wide pool and the actual WSARecv posted into it\n"
+                    L"     receive buffers then scale with the number of connections actively receiving data\n"
+                    L"     rather than with the total number of connections\n"
+                    L"\t- <default> == off  (every connection owns its receive buffers for its lifetime)\n"
+                    L"\t  note : only applicable to TCP with -IO:iocp or -IO:coroutine\n"
+                    L"\n");
+                break;
+        }
+
+        fwprintf_s(stdout, L"%ws", usage.c_str());
+    }
+
+    bool Startup(int argc, _In_reads_(argc) const wchar_t** argv)
+    {
+        ctsConfigInitOnce();
+
+        if (argc < 2)
+        {
+            PrintUsage();
+            return false;
+        }
+
+        // ignore the first argv... the exe itself
+        const wchar_t** argBegin = argv + 1;
+        const wchar_t** argEnd = argv + argc;
+        vector<const wchar_t*> args(argBegin, argEnd);
+
+        //
+        // first check of they asked for help text
+        //
+        const auto foundHelp = find_if(
+            begin(args),
+            end(args),
+            [](const wchar_t* arg) -> bool {
+                return ctString::ctOrdinalStartsWithCaseInsensative(arg, L"-Help") ||
+                    ctString::ctOrdinalEqualsCaseInsensative(arg, L"-?");
+            });
+        if (foundHelp != end(args))
+        {
+            PCWSTR const helpString = *foundHelp;
+            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Advanced"))
+            {
+                PrintUsage(PrintUsageOption::Advanced);
+                return false;
+            }
+            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Tcp"))
+            {
+                PrintUsage(PrintUsageOption::Tcp);
+                return false;
+            }
+            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Udp"))
+            {
+                PrintUsage(PrintUsageOption::Udp);
+                return false;
+            }
+            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Logging"))
+            {
+                PrintUsage(PrintUsageOption::Logging);
+                return false;
+            }
+
+            PrintUsage();
+            return false;
+        }
+
+        //
+        // create the handle for ctrl-c
+        //
+        g_configSettings->CtrlCHandle = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!g_configSettings->CtrlCHandle)
+        {
+            THROW_WIN32_MSG(GetLastError(), "CreateEvent");
+        }
+
+        //
+        // Many of the below settings must be made in a specified order - comments below help to explain this reasoning
+        // note: the IO function definitions must come after *all* other settings
+        //       since instantiations of those IO functions might reference global Settings values
+
+        //
+        // First:
+        // Establish logging settings including verbosity levels and error policies before any functional settings
+        // Create the threadpool before instantiating any other object
+        //
+        ParseForError(args);
+        ParseForLogging(args);
+        ParseForCpuEfficiency(args);
+
+        //
+        // Next: check for static machine configuration
+        // - note these are checking system settings, not user arguments
+        //
+        CheckSystemSettings();
+
+        //
+        // Next: establish the address and port # to be used
+        //
+        ParseForAddress(args);
+        ParseForPort(args);
+        ParseForLocalport(args);
+        ParseForPortReservation(args);
+        ParseForIfIndex(args);
+
+        //
+        // ensure a Port is assigned to all listening addresses and target addresses
+        //
+        for (auto& addr : g_configSettings->ListenAddresses)
+        {
+            if (addr.port() == 0x0000)
+            {
+                addr.SetPort(g_configSettings->Port);
+            }
+        }
+        for (auto& addr : g_configSettings->TargetAddresses)
+        {
+            if (addr.port() == 0x0000)
+            {
+                addr.SetPort(g_configSettings->Port);
+            }
+        }
+
+        if (g_configSettings->OutgoingIfIndex != 0 && !g_configSettings->ListenAddresses.empty())
+        {
+            throw invalid_argument("-IfIndex can only be used for outgoing connections, not listening sockets");
+        }
+
+        //
+        // Next: gather the protocol and Pattern to be used
+        // - set the threadpool value after identifying the pattern
+        ParseForProtocol(args);
+        // default to keep-alive on TCP servers
+        if (ProtocolType::TCP == g_configSettings->Protocol && !g_configSettings->ListenAddresses.empty())
+        {
+            g_configSettings->Options |= Keepalive;
+        }
+
+        ParseForIoPattern(args);
+        ParseForThreadpool(args);
+        // validate protocol & pattern combinations
+        if (ProtocolType::UDP == g_configSettings->Protocol && IoPatternType::MediaStream != g_configSettings->IoPattern)
+        {
+            throw invalid_argument("UDP only supports the MediaStream IO Pattern");
+        }
+        if (ProtocolType::TCP == g_configSettings->Protocol && IoPatternType::MediaStream == g_configSettings->IoPattern)
+        {
+            throw invalid_argument("TCP does not support the MediaStream IO Pattern");
+        }
+        // set appropriate defaults for # of connections for TCP vs. UDP
+        if (g_configSettings->UdpBlast && !IsListening())
+        {
+            // several sockets per processor, so receives can complete across every processor
+            g_configSettings->ConnectionLimit = c_defaultBlastConnectionsPerProcessor * GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+        }
+        else if (ProtocolType::UDP == g_configSettings->Protocol)
+        {
+            g_configSettings->ConnectionLimit = c_defaultUdpConnectionLimit;
+        }
+        else
+        {
+            g_configSettings->ConnectionLimit = c_defaultTcpConnectionLimit;
+        }
+
+        //
+        // Next, set the ctsStatusInformation to be used to print status updates for this protocol
+        // - this must be called after both set_logging and set_protocol
+        //
+        if (ProtocolType::TCP == g_configSettings->Protocol)
+        {
+            g_printStatusInformation = make_shared<ctsTcpStatusInformation>();
+        }
+        else
+        {
+            g_printStatusInformation = make_shared<ctsUdpStatusInformation>();
+        }
+
+        //
+        // Next: capture other various settings which do not have explicit dependencies
+        //
+        ParseForOptions(args);
+        ParseForKeepAlive(args);
+        ParseForCompartment(args);
+        ParseForLoadProfile(args);
+        ParseForConnections(args);
+        ParseForThrottleConnections(args);
+        ParseForBuffer(args);
+        ParseForTransfer(args);
+        ParseForIterations(args);
+        ParseForServerExitLimit(args);
+
+        ParseForRatelimit(args);
+        ParseForTimelimit(args);
+        if (g_configSettings->LoadProfile && 0 == g_configSettings->TimeLimit)
+        {
+            // the run lasts as long as the profile unless -TimeLimit says otherwise
+            g_configSettings->TimeLimit = static_cast<unsigned long>(g_loadProfileDurationMilliseconds);
+        }
+        ParseForSteadyState(args);
+        ParseForRateSearch(args);
+        const auto ratePerPeriod = g_rateLimitLow * g_configSettings->TcpBytesPerSecondPeriod / 1000LL;
+        if (g_configSettings->Protocol == ProtocolType::TCP && g_rateLimitLow > 0 && ratePerPeriod < 1)
+        {
+            throw invalid_argument("RateLimit * RateLimitPeriod / 1000 must be greater than zero - meaning every period should send at least 1 byte");
+        }
+        if (g_configSettings->LoadProfile && g_configSettings->TcpBytesPerSecondPeriod < 1)
+        {
+            throw invalid_argument("-RateLimitPeriod must be greater than zero with -LoadProfile");
+        }
+
+        //
+        // verify jitter logging requirements
+        //
+        const bool jitterLogged = g_jitterLogger || g_jitterSummaryLogger;
+        if (jitterLogged && g_configSettings->Protocol != ProtocolType::UDP)
+        {
+            throw invalid_argument("Jitter can only be logged using UDP");
+        }
+        if (jitterLogged && !g_configSettings->ListenAddresses.empty())
+        {
+            throw invalid_argument("Jitter can only be logged on the client");
+        }
+        if (jitterLogged && g_configSettings->ConnectionLimit != 1)
+        {
+            throw invalid_argument("Jitter can only be logged for a single UDP connection");
+        }
+
+        if (g_mediaStreamSettings.FrameSizeBytes > 0)
+        {
+            // the buffersize is now effectively the (largest) frame size
+            g_bufferSizeHigh = 0;
+            g_bufferSizeLow = g_mediaStreamSettings.MaxFrameSizeBytes;
+            if (g_bufferSizeLow < 20)
+            {
+                throw invalid_argument("The media stream frame size (buffer) must be at least 20 bytes");
+            }
+        }
+        if (g_configSettings->UdpBlast)
+        {
+            // -Buffer is the size of each datagram, header included
+            if (g_bufferSizeLow <= c_udpDatagramDataHeaderLength)
+            {
+                throw invalid_argument("-Buffer must be larger than the 26 byte datagram header with -Pattern:Blast");
+            }
+            if (max(g_bufferSizeLow, g_bufferSizeHigh) > c_udpDatagramMaximumSizeBytes)
+            {
+                throw invalid_argument("-Buffer cannot be larger than 64000 bytes with -Pattern:Blast");
+            }
+            if (!IsListening() && g_bufferSizeHigh != 0)
+            {
+                // clients receive into buffers large enough for the largest datagram
+                g_bufferSizeLow = g_bufferSizeHigh;
+                g_bufferSizeHigh = 0;
+            }
+        }
+
+        // validate localport usage
+        if (!g_configSettings->ListenAddresses.empty() && g_configSettings->LocalPortLow != 0)
+        {
+            throw invalid_argument("Cannot specify both -listen and -LocalPort. To listen on a specific port, use -Port:####");
+        }
+        if (g_configSettings->LocalPortLow != 0)
+        {
+            const USHORT numberOfPorts = g_configSettings->LocalPortHigh == 0 ? 1 : static_cast<USHORT>(g_configSettings->LocalPortHigh - g_configSettings->LocalPortLow + 1);
+            if (numberOfPorts < g_configSettings->ConnectionLimit)
+            {
+                throw invalid_argument(
+                    "Cannot specify more connections than specified local ports. "
+                    "Reduce the number of connections or increase the range of local ports.");
+            }
+        }
+
+        //
+        // Set the default buffer values as these settings are optional
+        //
+        g_configSettings->ShouldVerifyBuffers = true;
+        g_configSettings->ShouldVerifyChecksums = false;
+        g_configSettings->UseSharedBuffer = false;
+        ParseForShouldVerifyBuffers(args);
+        if (ProtocolType::UDP == g_configSettings->Protocol && g_configSettings->ShouldVerifyChecksums)
+        {
+            throw invalid_argument("-Verify:checksum is only supported with TCP");
+        }
+        if (ProtocolType::UDP == g_configSettings->Protocol && g_configSettings->SeededPayload)
+        {
+            throw invalid_argument("-Verify:seeded is only supported with TCP");
+        }
+        if (ProtocolType::UDP == g_configSettings->Protocol)
+        {
+            // UDP clients can never recv into the same shared buffer since it uses it for seq. numbers, etc
+            if (!IsListening())
+            {
+                g_configSettings->UseSharedBuffer = false;
+            }
+        }
+
+        //
+        // finally set the functions to use once all other settings are established
+        // set_ioFunction changes global options for socket operation for instance WSA_FLAG_REGISTERED_IO flag
+        // - hence it is requirement to invoke it prior to any socket operation
+        //
+        ParseForIoFunction(args);
+        ParseForRioCompletionQueues(args);
+        ParseForRioPollSpin(args);
+        ParseForRioDequeueBatch(args);
+        ParseForXdpQueues(args);
+        ParseForInlineCompletions(args);
+        ParseForInlineCompletionBudget(args);
+        ParseForInlineStateTransitions(args);
+        ParseForTls(args);
+        ParseForCompletionEngine(args);
+        ParseForMsgWaitAll(args);
+        ParseForZeroByteRecv(args);
+        ParseForBufferSegments(args);
+        ParseForMessageSize(args);
+        ParseForSharedBufferAllocation(args);
+        if (g_configSettings->SeededPayload)
+        {
+            if (g_configSettings->IoPattern != IoPatternType::Push &&
+                g_configSettings->IoPattern != IoPatternType::Pull &&
+                g_configSettings->IoPattern != IoPatternType::PushPull &&
+                g_configSettings->IoPattern != IoPatternType::Duplex)
+            {
+                throw invalid_argument("-Verify:seeded is only applicable to -Pattern:Push, Pull, PushPull or Duplex");
+            }
+            if (g_configSettings->IoFunction == ctsRioIocp)
+            {
+                // RIO can only send from registered memory : the seeded payload slots are not registered
+                throw invalid_argument("-Verify:seeded cannot be used with -IO:RIO");
+            }
+            if (g_configSettings->PayloadFilename)
+            {
+                throw invalid_argument("-Verify:seeded cannot be used with -PayloadFile");
+            }
+        }
+        ParseForUdpSendOffload(args);
+        ParseForContiguousDatagrams(args);
+        if (g_configSettings->UdpBlast && g_configSettings->UdpSendOffload)
+        {
+            // each send is a burst of equally sized datagrams
+            if (g_bufferSizeHigh != 0)
+            {
+                throw invalid_argument("-UdpSendOffload with -Pattern:Blast requires a fixed -Buffer size");
+            }
+            if (g_configSettings->ContiguousDatagrams)
+            {
+                throw invalid_argument("-ContiguousDatagrams cannot be used with -UdpSendOffload and -Pattern:Blast");
+            }
+        }
+        ParseForUdpRecvOffload(args);
+        ParseForUdpRecvTimestamps(args);
+        if (g_configSettings->UdpRecvOffload && g_configSettings->ListenAddresses.empty())
+        {
+            // clients must post receives large enough to hold a full coalesced receive
+            if (g_bufferSizeLow < ctsConfigSettings::c_UdpRecvMaxCoalescedSize)
+            {
+                g_bufferSizeLow = ctsConfigSettings::c_UdpRecvMaxCoalescedSize;
+            }
+        }
+        ParseForCreate(args);
+        ParseForConnect(args);
+        ParseForAccept(args);
+        ParseForConnectData(args);
+        if ((g_configSettings->Options & TcpFastOpen) && !g_configSettings->ExchangeConnectionIdOnConnect)
+        {
+            // the connection ID sent with ConnectEx is the data carried in the SYN
+            throw invalid_argument("-Options:TcpFastOpen requires -ConnectData:on (with -conn:ConnectEx and -acc:AcceptEx)");
+        }
+        ParseForSocketReuse(args);
+        ParseForPrecreateSockets(args);
+        ParseForRelay(args);
+        ParseForPersistentTransfers(args);
+        ParseForProbes(args);
+        ParseForMultiplexStreams(args);
+        ParseForPrePostAccepts(args);
+        ParseForAcceptQueues(args);
+        if (!g_configSettings->ListenAddresses.empty())
+        {
+            // servers 'create' connections when they accept them
+            g_configSettings->CreateFunction = g_configSettings->AcceptFunction;
+            g_configSettings->ConnectFunction = nullptr;
+        }
+
+        g_configSettings->TcpShutdown = TcpShutdownType::GracefulShutdown;
+        ParseForShutdown(args);
+        ParseForLeanProtocol(args);
+
+        ParseForPrepostrecvs(args);
+        if (ProtocolType::TCP == g_configSettings->Protocol &&
+            (g_configSettings->ShouldVerifyBuffers || g_configSettings->ShouldVerifyChecksums) &&
+            g_configSettings->PrePostRecvs > 1)
+        {
+            throw invalid_argument("-PrePostRecvs > 1 requires -Verify:connection when using TCP");
+        }
+        if (g_configSettings->IoFunction == ctsTlsIocp && g_configSettings->PrePostRecvs > 1)
+        {
+            // TLS records must be decrypted in the order they were received
+            throw invalid_argument("-PrePostRecvs > 1 (not supported with -io:tls)");
+        }
+        ParseForPrepostsends(args);
+        ParseForRecvbufvalue(args);
+        ParseForSendbufvalue(args);
+        ParseForLatencyPercentiles(args);
+        if (g_histogramLogger && g_configSettings->LatencyPercentiles.empty())
+        {
+            // IO and connection latencies are only recorded with -LatencyPercentiles
+            throw invalid_argument("-HistogramFilename requires -LatencyPercentiles");
+        }
+        ParseForTargets(args);
+        ParseForConvergence(args);
+        ParseForSweep(args);
+        ParseForTcpInfo(args);
+        ParseForConnectionSamples(args);
+        ParseForHostCounters(args);
+        if (g_configSettings->MemoryTransport)
+        {
+            // ISB notifications and SIO_TCP_INFO sampling both need a real socket
+            if (0 == g_configSettings->PrePostSends)
+            {
+                throw invalid_argument("-PrePostSends:0 (not supported with -io:memory)");
+            }
+            if (g_configSettings->TcpInfoIntervalMilliseconds > 0)
+            {
+                throw invalid_argument("-TcpInfo (not supported with -io:memory)");
+            }
+        }
+        ParseForWorkers(args);
+
+        if (!args.empty())
+        {
+            wstring errorString;
+            for (const auto& argString : args)
+            {
+                errorString.append(L" ");
+                errorString.append(argString);
+            }
+            errorString.append(L"\n");
+            PrintErrorInfoOverride(errorString.c_str());
+            throw invalid_argument(ctString::ctConvertToString(errorString).c_str());
+        }
+
+        if (ProtocolType::UDP == g_configSettings->Protocol)
+        {
+            const auto timerResult = timeBeginPeriod(1);
+            if (timerResult != TIMERR_NOERROR)
+            {
+                THROW_WIN32_MSG(timerResult, "timeBeginPeriod");
+            }
+            ++g_timePeriodRefCount;
+        }
+
+        if (g_configSettings->RecordHostConfiguration)
+        {
+            CaptureHostConfiguration();
+        }
+
+        if (g_configSettings->HostCounters)
+        {
+            // takes the first sample now : the first status update reports the rates since startup
+            g_hostCounters = make_unique<ctsHostCounters>();
+        }
+
+        // every setting has been parsed and validated : publish the values read on every IO
+        g_frozenSettings.m_options = g_configSettings->Options;
+        g_frozenSettings.m_socketFlags = g_configSettings->SocketFlags;
+        g_frozenSettings.m_protocol = g_configSettings->Protocol;
+        g_frozenSettings.m_prePostRecvs = g_configSettings->PrePostRecvs;
+        g_frozenSettings.m_prePostSends = g_configSettings->PrePostSends;
+        g_frozenSettings.m_inlineCompletionBudget = g_configSettings->InlineCompletionBudget;
+        g_frozenSettings.m_inlineCompletionBudgetQpc =
+            static_cast<long long>(g_configSettings->InlineCompletionBudgetMicroseconds) * ctTimer::SnapQpf() / 1000000LL;
+        g_frozenSettings.m_isTcp = ProtocolType::TCP == g_configSettings->Protocol;
+        g_frozenSettings.m_isUdp = ProtocolType::UDP == g_configSettings->Protocol;
+        g_frozenSettings.m_isRio = WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO);
+        g_frozenSettings.m_isVerify = g_configSettings->ShouldVerifyBuffers || g_configSettings->ShouldVerifyChecksums;
+        g_frozenSettings.m_isRateSearch = g_configSettings->RateSearchStepMilliseconds > 0;
+        g_frozenSettings.m_isBufferSweep = !g_sweepAxes.empty() && SweepParameter::Buffer == g_sweepAxes.back().m_parameter;
+        g_frozenSettings.m_isLoadProfile = g_configSettings->LoadProfile;
+        g_frozenSettings.m_isRateLimited = g_rateLimitLow > 0 || g_frozenSettings.m_isRateSearch || g_frozenSettings.m_isLoadProfile;
+        g_frozenSettings.m_isInlineIocp = g_configSettings->Options & HandleInlineIocp;
+        g_frozenSettings.m_isMsgWaitAll = g_configSettings->Options & MsgWaitAll;
+        g_frozenSettings.m_isZeroByteRecv = g_configSettings->Options & ZeroByteRecv;
+        g_frozenSettings.m_isTransmitPackets = g_configSettings->Options & TransmitPackets;
+
+        return true;
+    }
+
+    void Shutdown() noexcept
+    {
+        ctsConfigInitOnce();
+
+        const auto lock = g_shutdownLock.lock();
+        g_shutdownCalled = true;
+        if (g_configSettings->CtrlCHandle)
+        {
+            if (!SetEvent(g_configSettings->CtrlCHandle))
+            {
+                FAIL_FAST_MSG(
+                    "SetEvent(%p) failed [%u] when trying to shutdown",
+                    g_configSettings->CtrlCHandle, GetLastError());
+            }
+        }
+
+        delete g_netAdapterAddresses;
+        g_netAdapterAddresses = nullptr;
+
+        while (g_timePeriodRefCount > 0)
+        {
+            timeEndPeriod(1);
+            --g_timePeriodRefCount;
+        }
+    }
+
+    // the Legend is to explain the fields for status updates
+    // - only print if status updates are going to be provided
+    void PrintLegend() noexcept
+    {
+        ctsConfigInitOnce();
+
+        bool writeToConsole = false;
+        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        {
+            // case 0: // nothing
+            case 1: // status updates
+                // case 2: // error info
+                // case 3: // connection info
+                // case 4: // connection info + error info
+            case 5: // connection info + error info + status updates
+            case 6: // above + debug info
+            {
+                writeToConsole = true;
+            }
+        }
+
+        if (g_printStatusInformation)
+        {
+            if (writeToConsole)
+            {
+                PCWSTR const legend = g_printStatusInformation->PrintLegend(StatusFormatting::ConsoleOutput);
+                if (legend != nullptr)
+                {
+                    fwprintf(stdout, L"%ws\n", legend);
+                }
+                PCWSTR const header = g_printStatusInformation->PrintHeader(StatusFormatting::ConsoleOutput);
+                if (header != nullptr)
+                {
+                    fwprintf(stdout, L"%ws\n", header);
+                }
+            }
+
+            if (g_statusLogger)
+            {
+                g_statusLogger->LogLegend(g_printStatusInformation);
+                g_statusLogger->LogHeader(g_printStatusInformation);
+            }
+        }
+
+        if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
+        {
+            if (g_configSettings->ConnectionLogAggregate)
+            {
+                // the histograms are space-separated within their columns
+                g_connectionLogger->LogMessage(L"TimeSlice,Established,Completed,Succeeded,NetworkErrors,ProtocolErrors,Errors,TimeMs,Bytes\r\n");
+            }
+            else if (ProtocolType::UDP == g_configSettings->Protocol)
+            {
+                g_connectionLogger->LogMessage(L"TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId\r\n");
+            }
+            else
+            { // TCP
+                wstring tcpHeader(L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId");
+                if (g_configSettings->TcpInfoIntervalMilliseconds > 0)
+                {
+                    tcpHeader.append(L",MinRttUs,AvgRttUs,MaxRttUs,MinCwnd,AvgCwnd,MaxCwnd,AvgBytesInFlight,MaxBytesInFlight,BytesRetrans,FastRetrans,TimeoutEpisodes");
+                }
+                if (g_configSettings->ConnectionSampleIntervalMilliseconds > 0)
+                {
+                    // the interval samples are space-separated within the last column
+                    tcpHeader.append(L",Intervals,MinIntervalBps,MaxIntervalBps,Stalls,LongestStall,IntervalBps");
+                }
+                if (g_configSettings->AutoRecvBuf || g_configSettings->AutoSendBuf)
+                {
+                    tcpHeader.append(L",BdpRttUs,BdpBps,BdpBytes,AutoRecvBuf,AutoSendBuf");
+                }
+                if (g_configSettings->PersistentTransfers > 1)
+                {
+                    tcpHeader.append(L",Transfers,FirstTransferUs,AvgWarmTransferUs,MaxWarmTransferUs");
+                }
+                tcpHeader.append(L"\r\n");
+                g_connectionLogger->LogMessage(tcpHeader.c_str());
+            }
+        }
+
+        if (g_jitterLogger && g_jitterLogger->IsCsvFormat())
+        {
+            g_jitterLogger->LogMessage(L"SequenceNumber,SenderQpc,SenderQpf,ReceiverQpc,ReceiverQpf,RelativeInFlightTimeMs,PrevToCurrentInFlightTimeJitter,ReceiveDelayMs\r\n");
+        }
+
+        if (g_jitterSummaryLogger)
+        {
+            g_jitterSummaryLogger->LogMessage(L"Second,SuccessfulFrames,DroppedFrames,DuplicateFrames,LateDatagrams,StartRequests,AvgJitterMs,MaxJitterMs\r\n");
+        }
+
+        if (g_histogramLogger)
+        {
+            g_histogramLogger->LogMessage(L"Histogram,BucketMaxMicroseconds,Count\r\n");
+        }
+    }
+
+    // Always print to console if override
+    void PrintExceptionOverride(_In_ PCSTR exceptionText) noexcept
+    {
+        ctsConfigInitOnce();
+
+        FAIL_FAST_IF_MSG(g_breakOnError, "[ctsTraffic] >> exception - %hs\n", exceptionText);
+
+        try
+        {
+            const auto formattedString(
+                wil::str_printf<std::wstring>(
+                    L"[%.3f] %hs",
+                    GetStatusTimeStamp(),
+                    exceptionText));
+
+            fwprintf(stderr, L"%ws\n", formattedString.c_str());
+            if (g_errorLogger)
+            {
+                g_errorLogger->LogError(
+                    wil::str_printf<std::wstring>(L"%ws\r\n", formattedString.c_str()).c_str());
+            }
+        }
+        catch (...)
+        {
+            fwprintf(stderr, L"Error : failed to allocate memory\n");
+            if (g_errorLogger)
+            {
+                g_errorLogger->LogError(L"Error : failed to allocate memory\r\n");
+            }
+        }
+    }
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Print* functions
+    /// - tracks what level of -verbose was specified
+    ///   and prints to console accordingly
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    void PrintException(const wil::ResultException& e) noexcept
+    {
+        ctsConfigInitOnce();
+
+        WCHAR errorString[1024]{};
+        GetFailureLogString(errorString, 1024, e.GetFailureInfo());
+        if (!g_shutdownCalled && g_breakOnError)
+        {
+            FAIL_FAST_MSG(
+                "Fatal exception: %ws", errorString);
+        }
+
+        PrintErrorInfo(errorString);
+    }
+
+    void PrintException(const std::exception& e) noexcept
+    {
+        ctsConfigInitOnce();
+        try
+        {
+            PrintErrorInfo(ctString::ctConvertToWstring(e.what()).c_str());
+        }
+        catch (...)
+        {
+            const auto hr = wil::ResultFromCaughtException();
+            if (!g_shutdownCalled && g_breakOnError)
+            {
+                FAIL_FAST_MSG("Fatal exception: 0x%x", hr);
+            }
+
+            // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+            switch (g_consoleVerbosity) // NOLINT(hicpp-multiway-paths-covered)
+            {
+                // case 0: // nothing
+                // case 1: // status updates
+                case 2: // error info
+                // case 3: // connection info
+                case 4: // connection info + error info
+                case 5: // connection info + error info + status updates
+                case 6: // above + debug info
+                    wprintf(
+                        L"[%.3f] Exception thrown: %hs\n",
+                        GetStatusTimeStamp(),
+                        e.what());
+            }
+        }
+    }
+    DWORD PrintThrownException() noexcept
+    {
+        try
+        {
+            throw;
+        }
+        catch (const wil::ResultException& e)
+        {
+            PrintException(e);
+            return Win32FromHresult(e.GetErrorCode());
+        }
+        catch (const std::exception& e)
+        {
+            PrintException(e);
+            return WSAENOBUFS;
+        }
+        catch (...)
+        {
+            FAIL_FAST();
+        }
+    }
+    void PrintException(DWORD why, _In_ PCWSTR what, _In_ PCWSTR where) noexcept
+    {
+        try
+        {
+            const auto translation = ctString::ctFormatMessage(why);
+            const auto formattedString = wil::str_printf<std::wstring>(
+                L"[exception] %ws%ws%ws%ws [%u / 0x%x - %ws]",
+                what ? L" " : L"",
+                what ? what : L"",
+                where ? L" at " : L"",
+                where ? where : L"",
+                why,
+                why,
+                !translation.empty() ? translation.c_str() : L"unknown error");
+            PrintErrorInfo(formattedString.c_str());
+        }
+        catch (...)
+        {
+            PrintErrorInfo(L"[exception] out of memory");
+        }
+
+    }
+    // Always print to console if override
+    void PrintErrorInfoOverride(_In_ PCWSTR text) noexcept try
+    {
+        ctsConfigInitOnce();
+
+        if (g_breakOnError)
+        {
+            FAIL_FAST_MSG(ctString::ctConvertToString(text).c_str());
+        }
+
+        wprintf_s(L"%ws\n", text);
+        if (g_errorLogger)
+        {
+            g_errorLogger->LogError(
+                wil::str_printf<std::wstring>(
+                    L"[%.3f] %ws\r\n",
+                    GetStatusTimeStamp(), text).c_str());
+        }
+    }
+    catch (...)
+    {
+    }
+
+    void PrintErrorIfFailed(_In_ PCSTR what, unsigned long why) noexcept try
+    {
+        ctsConfigInitOnce();
+
+        if (!g_shutdownCalled && why != 0)
+        {
+            if (g_breakOnError)
+            {
+                FAIL_FAST_MSG("%hs failed (%u)\n", what, why);
+            }
+
+            bool writeToConsole = false;
+            // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+            switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+            {
+                // case 0: // nothing
+                // case 1: // status updates
+                case 2: // error info
+                    // case 3: // connection info
+                case 4: // connection info + error info
+                case 5: // connection info + error info + status updates
+                case 6: // above + debug info
+                {
+                    writeToConsole = true;
+                }
+            }
+
+            wstring errorString;
+            if (ctsIoPattern::IsProtocolError(why))
+            {
+                errorString = wil::str_printf<std::wstring>(
+                    L"[%.3f] Connection aborted due to the protocol error %ws",
+                    GetStatusTimeStamp(),
+                    ctsIoPattern::BuildProtocolErrorString(why));
+            }
+            else
+            {
+                errorString = wil::str_printf<std::wstring>(
+                    L"[%.3f] %hs failed (%u) %ws",
+                    GetStatusTimeStamp(),
+                    what,
+                    why,
+                    ctString::ctFormatMessage(why).c_str());
+            }
+
+            if (writeToConsole)
+            {
+                fwprintf(stderr, L"%ws\n", errorString.c_str());
+            }
+
+            if (g_errorLogger)
+            {
+                g_errorLogger->LogError(
+                    wil::str_printf<std::wstring>(L"%ws\r\n", errorString.c_str()).c_str());
+            }
+        }
+    }
+    catch (...)
+    {
+    }
+
+    static void WriteConnectionAggregate(long long currentTimeslice) noexcept;
+
+    // -MemoryAccounting : samples the process private bytes and non-paged pool
+    // - writing the sample to the -StatusFilename when it is not of csv format
+    static void SampleProcessMemory(long long currentTimeslice) noexcept
+        try
+    {
+        PROCESS_MEMORY_COUNTERS_EX memoryCounters{};
+        memoryCounters.cb = sizeof memoryCounters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof memoryCounters))
+        {
+            return;
+        }
+
+        auto& memoryDetails = g_configSettings->ConnectionMemoryDetails;
+        memoryDetails.SampleProcess(
+            static_cast<long long>(memoryCounters.PrivateUsage),
+            static_cast<long long>(memoryCounters.QuotaNonPagedPoolUsage));
+
+        if (g_statusLogger && !g_statusLogger->IsCsvFormat())
+        {
+            g_statusLogger->LogMessage(
+                wil::str_printf<std::wstring>(
+                    L"  Memory [%.3f] Private Bytes [%llu] NonPaged Pool [%llu] Active Connections [%lld] Bytes per closed connection [%lld]\r\n",
+                    static_cast<double>(currentTimeslice) / 1000.0,
+                    static_cast<unsigned long long>(memoryCounters.PrivateUsage),
+                    static_cast<unsigned long long>(memoryCounters.QuotaNonPagedPoolUsage),
+                    g_configSettings->ConnectionStatusDetails.m_activeConnectionCount.GetValue(),
+                    memoryDetails.GetBytesPerConnection()).c_str());
+        }
+    }
+    catch (...)
+    {
+    }
+
+    // -InlineCompletionBudget : the sends and recvs completed inline over the status interval,
+    // and the number of times connections used up their budget and continued on the threadpool
+    static void WriteInlineCompletionStatus(long long currentTimeslice) noexcept
+        try
+    {
+        auto& tcpDetails = g_configSettings->TcpStatusDetails;
+        const auto inlineCompletions = tcpDetails.m_inlineCompletions.SnapValueDifference();
+        const auto inlineYields = tcpDetails.m_inlineYields.SnapValueDifference();
+        if (g_statusLogger && !g_statusLogger->IsCsvFormat())
+        {
+            g_statusLogger->LogMessage(
+                wil::str_printf<std::wstring>(
+                    L"  Inline Completions [%.3f] Inline [%lld] Yielded [%lld] Inline per yield [%.1f]\r\n",
+                    static_cast<double>(currentTimeslice) / 1000.0,
+                    inlineCompletions,
+                    inlineYields,
+                    inlineYields > 0 ? static_cast<double>(inlineCompletions) / static_cast<double>(inlineYields) : 0.0).c_str());
+        }
+    }
+    catch (...)
+    {
+    }
+
+    // -Pattern:Blast : the datagrams sent and received per second over the status interval,
+    // and those the clients found missing or out of order
+    static void WriteBlastStatus(long long currentTimeslice) noexcept
+        try
+    {
+        auto& udpDetails = g_configSettings->UdpStatusDetails;
+        const auto datagramsSent = udpDetails.m_blastDatagramsSent.SnapValueDifference();
+        const auto datagramsReceived = udpDetails.m_blastDatagramsReceived.SnapValueDifference();
+        const auto datagramsExpected = udpDetails.m_blastDatagramsExpected.SnapValueDifference();
+        const auto datagramsReordered = udpDetails.m_blastDatagramsReordered.SnapValueDifference();
+        const long long elapsedMilliseconds = currentTimeslice - static_cast<long long>(g_previousPrintTimeslice);
+        if (g_statusLogger && !g_statusLogger->IsCsvFormat() && elapsedMilliseconds > 0)
+        {
+            g_statusLogger->LogMessage(
+                wil::str_printf<std::wstring>(
+                    L"  Blast [%.3f] Sent [%lld/sec] Received [%lld/sec] Lost [%lld] Reordered [%lld]\r\n",
+                    static_cast<double>(currentTimeslice) / 1000.0,
+                    datagramsSent * 1000LL / elapsedMilliseconds,
+                    datagramsReceived * 1000LL / elapsedMilliseconds,
+                    // reordered datagrams arrive after being counted as expected : the loss is only final at the end of the stream
+                    datagramsExpected > datagramsReceived ? datagramsExpected - datagramsReceived : 0LL,
+                    datagramsReordered).c_str());
+        }
+    }
+    catch (...)
+    {
+    }
+
+    void PrintStatusUpdate() noexcept
+    {
+        if (!g_shutdownCalled)
+        {
+            if (g_printStatusInformation)
+            {
+                bool writeToConsole = false;
+                // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+                switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+                {
+                    // case 0: // nothing
+                    case 1: // status updates
+                        // case 2: // error info
+                        // case 3: // connection info
+                        // case 4: // connection info + error info
+                    case 5: // connection info + error info + status updates
+                    case 6: // above + debug info
+                    {
+                        writeToConsole = true;
+                    }
+                }
+
+                const auto lock = g_statusUpdateLock.try_lock();
+                if (lock)
+                {
+                    // capture the timeslices
+                    const ctsSignedLongLong lPrevioutimeslice = g_previousPrintTimeslice;
+                    const ctsSignedLongLong lCurrentTimeslice = ctTimer::SnapQpcInMillis() - g_configSettings->StartTimeMilliseconds;
+
+                    if (lCurrentTimeslice > lPrevioutimeslice)
+                    {
+                        // sampled once for the console and the status log to print the same TimeSlice period
+                        if (g_hostCounters)
+                        {
+                            g_hostCounters->Sample();
+                        }
+
+                        // write out the header to the console every 40 updates 
+                        if (writeToConsole)
+                        {
+                            if (g_printTimesliceCount != 0 && 0 == g_printTimesliceCount % 40)
+                            {
+                                PCWSTR const header = g_printStatusInformation->PrintHeader(StatusFormatting::ConsoleOutput);
+                                if (header != nullptr)
+                                {
+                                    fwprintf(stdout, L"%ws", header);
+                                }
+                            }
+                        }
+
+                        // need to indicate either print_status() or LogStatus() to reset the status info,
+                        // - the data *must* be reset once and *only once* in this function
+
+                        int statusCount = 0;
+                        if (writeToConsole)
+                        {
+                            ++statusCount;
+                        }
+                        if (g_statusLogger)
+                        {
+                            ++statusCount;
+                        }
+
+                        if (writeToConsole)
+                        {
+                            --statusCount;
+                            const bool clearStatus = 0 == statusCount;
+                            PCWSTR const printString = g_printStatusInformation->PrintStatus(
+                                StatusFormatting::ConsoleOutput,
+                                lCurrentTimeslice,
+                                clearStatus);
+                            if (printString != nullptr)
+                            {
+                                fwprintf(stdout, L"%ws", printString);
+                            }
+                        }
+
+                        if (g_statusLogger)
+                        {
+                            --statusCount;
+                            const bool clearStatus = 0 == statusCount;
+                            g_statusLogger->LogStatus(
+                                g_printStatusInformation,
+                                lCurrentTimeslice,
+                                clearStatus);
+
+                            if (g_configSettings->PrintThreadStatistics)
+                            {
+                                const auto threadStatus = ctsThreadStatistics::FormatStatus(lCurrentTimeslice);
+                                if (!threadStatus.empty())
+                                {
+                                    g_statusLogger->LogMessage(threadStatus.c_str());
+                                }
+                            }
+                        }
+
+                        if (g_configSettings->ConnectionLogAggregate)
+                        {
+                            WriteConnectionAggregate(lCurrentTimeslice);
+                        }
+
+                        if (g_configSettings->AccountConnectionMemory)
+                        {
+                            SampleProcessMemory(lCurrentTimeslice);
+                        }
+
+                        if (g_configSettings->InlineCompletionBudget > 0 || g_configSettings->InlineCompletionBudgetMicroseconds > 0)
+                        {
+                            WriteInlineCompletionStatus(lCurrentTimeslice);
+                        }
+
+                        if (g_configSettings->UdpBlast)
+                        {
+                            WriteBlastStatus(lCurrentTimeslice);
+                        }
+
+                        // update tracking values
+                        g_previousPrintTimeslice = lCurrentTimeslice;
+                        ++g_printTimesliceCount;
+                    }
+                }
+            }
+        }
+    }
+
+    void PrintJitterUpdate(const JitterFrameEntry& currentFrame, const JitterFrameEntry& previousFrame) noexcept
+    {
+        if (!g_shutdownCalled)
+        {
+            // the time from the stack timestamping the datagram to its receive completing - 0 when not timestamped
+            const double receiveDelayMs = currentFrame.m_receiverQpf != 0 && currentFrame.m_receiverCompletionQpc > currentFrame.m_receiverQpc ?
+                static_cast<double>(currentFrame.m_receiverCompletionQpc - currentFrame.m_receiverQpc) * 1000.0 / static_cast<double>(currentFrame.m_receiverQpf) :
+                0.0;
+            if (g_binaryJitterLogger)
+            {
+                ctsBinaryJitterRecord record{};
+                record.m_sequenceNumber = currentFrame.m_sequenceNumber;
+                record.m_senderQpc = currentFrame.m_senderQpc;
+                record.m_senderQpf = currentFrame.m_senderQpf;
+                record.m_receiverQpc = currentFrame.m_receiverQpc;
+                record.m_receiverQpf = currentFrame.m_receiverQpf;
+                record.m_estimatedTimeInFlightMs = currentFrame.m_estimatedTimeInFlightMs;
+                record.m_jitterMs = std::abs(previousFrame.m_estimatedTimeInFlightMs - currentFrame.m_estimatedTimeInFlightMs);
+                record.m_bytesReceived = currentFrame.m_bytesReceived;
+                record.m_receiveDelayMicroseconds = static_cast<unsigned long>(receiveDelayMs * 1000.0);
+                g_binaryJitterLogger->WriteRecord(record);
+            }
+            else if (g_jitterLogger)
+            {
+                const auto jitter = std::abs(previousFrame.m_estimatedTimeInFlightMs - currentFrame.m_estimatedTimeInFlightMs);
+                // long long ~= up to 20 characters long, 10 for each float, plus 10 for commas & CR
+                constexpr size_t formattedTextLength = 20 * 5 + 10 * 3 + 10;
+                wchar_t formattedText[formattedTextLength]{};
+                const auto converted = _snwprintf_s(
+                    formattedText,
+                    formattedTextLength,
+                    L"%lld,%lld,%lld,%lld,%lld,%.3f,%.3f,%.3f\r\n",
+                    currentFrame.m_sequenceNumber, currentFrame.m_senderQpc, currentFrame.m_senderQpf, currentFrame.m_receiverQpc, currentFrame.m_receiverQpf, currentFrame.m_estimatedTimeInFlightMs, jitter, receiveDelayMs);
+                FAIL_FAST_IF(-1 == converted);
+                g_jitterLogger->LogMessage(formattedText);
+            }
+        }
+    }
+
+    void PrintJitterSummary(const JitterSummaryEntry& summary) noexcept
+    {
+        if (!g_shutdownCalled && g_jitterSummaryLogger)
+        {
+            const double averageJitterMs = summary.m_successfulFrames > 0 ?
+                summary.m_jitterSumMs / static_cast<double>(summary.m_successfulFrames) :
+                0.0;
+            // long long ~= up to 20 characters long, 10 for each unsigned long and float, plus 10 for commas & CR
+            constexpr size_t formattedTextLength = 20 + 10 * 7 + 10;
+            wchar_t formattedText[formattedTextLength]{};
+            const auto converted = _snwprintf_s(
+                formattedText,
+                formattedTextLength,
+                L"%lld,%lu,%lu,%lu,%lu,%lu,%.3f,%.3f\r\n",
+                summary.m_second, summary.m_successfulFrames, summary.m_droppedFrames, summary.m_duplicateFrames,
+                summary.m_lateDatagrams, summary.m_startRequests, averageJitterMs, summary.m_maxJitterMs);
+            FAIL_FAST_IF(-1 == converted);
+            g_jitterSummaryLogger->LogMessage(formattedText);
+        }
+    }
+
+    void PrintNewConnection(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr) noexcept
+        try
+    {
+        ctsConfigInitOnce();
+
+        if (g_configSettings->ConnectionLogAggregate)
+        {
+            const auto lock = g_connectionAggregateLock.lock();
+            ++g_connectionAggregate.m_established;
+            return;
+        }
+
+        // write even after shutdown so can print the final summaries
+        bool writeToConsole = false;
+        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        {
+            // case 0: // nothing
+            // case 1: // status updates
+            // case 2: // error info
+            case 3: // connection info
+            case 4: // connection info + error info
+            case 5: // connection info + error info + status updates
+            case 6: // above + debug info
+            {
+                writeToConsole = true;
+            }
+        }
+
+        if (writeToConsole)
+        {
+            wprintf_s(
+                ProtocolType::TCP == g_configSettings->Protocol ?
+                L"[%.3f] TCP connection established [%ws - %ws]\n" :
+                L"[%.3f] UDP connection established [%ws - %ws]\n",
+                GetStatusTimeStamp(),
+                localAddr.WriteCompleteAddress().c_str(),
+                remoteAddr.WriteCompleteAddress().c_str());
+        }
+
+        if (g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+        {
+            g_connectionLogger->LogMessage(
+                wil::str_printf<std::wstring>(
+                    ProtocolType::TCP == g_configSettings->Protocol ?
+                    L"[%.3f] TCP connection established [%ws - %ws]\r\n" :
+                    L"[%.3f] UDP connection established [%ws - %ws]\r\n",
+                    GetStatusTimeStamp(),
+                    localAddr.WriteCompleteAddress().c_str(),
+                    remoteAddr.WriteCompleteAddress().c_str()).c_str());
+        }
+    }
+    catch (...)
+    {
+    }
+
+    // the fields common to the TCP and UDP binary connection records - the caller fills in the results
+    static ctsBinaryConnectionRecord MakeBinaryConnectionRecord(
+        float currentTime,
+        const ctSockaddr& localAddr,
+        const ctSockaddr& remoteAddr,
+        unsigned long error,
+        unsigned short protocol,
+        _In_z_ const char* connectionIdentifier) noexcept
+    {
+        ctsBinaryConnectionRecord record{};
+        record.m_timeSliceSeconds = currentTime;
+        record.m_localAddress = *localAddr.sockaddr_inet();
+        record.m_remoteAddress = *remoteAddr.sockaddr_inet();
+        record.m_error = error;
+        record.m_protocol = protocol;
+        record.m_tcpInfoEnabled = IPPROTO_TCP == protocol && g_configSettings->TcpInfoIntervalMilliseconds > 0 ? 1 : 0;
+        strncpy_s(record.m_connectionIdentifier, connectionIdentifier, _TRUNCATE);
+        return record;
+    }
+
+    static void WriteConnectionResults(float currentTime, unsigned long error) noexcept
+        try
+    {
+        // write even after shutdown so can print the final summaries
+        bool writeToConsole = false;
+        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        {
+            // case 0: // nothing
+            // case 1: // status updates
+            // case 2: // error info
+            case 3: // connection info
+            case 4: // connection info + error info
+            case 5: // connection info + error info + status updates
+            case 6: // above + debug info
+            {
+                writeToConsole = true;
+            }
+        }
+
+        enum class ErrorType
+        {
+            Success,
+            NetworkError,
+            ProtocolError
+        } errorType = ErrorType::Success;
+
+        if (0 == error)
+        {
+            errorType = ErrorType::Success;
+        }
+        else if (ctsIoPattern::IsProtocolError(error))
+        {
+            errorType = ErrorType::ProtocolError;
+        }
+        else
+        {
+            errorType = ErrorType::NetworkError;
+        }
+
+        static PCWSTR tcpNetworkFailureResultTextFormat = L"[%.3f] TCP connection failed with the error %ws : [%ws - %ws] [%hs] : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
+        // csv format : L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId"
+        static PCWSTR tcpResultCsvFormat = L"%.3f,%ws,%ws,%lld,%lld,%lld,%lld,%lld,%ws,%hs\r\n";
+
+        wstring csvString;
+        wstring textString;
+        wstring errorString;
+        if (ErrorType::ProtocolError != errorType)
+        {
+            if (0 == error)
+            {
+                errorString = L"Succeeded";
+            }
+            else
+            {
+                errorString = wil::str_printf<std::wstring>(
+                    L"%lu: %ws",
+                    error,
+                    ctString::ctFormatMessage(error).c_str());
+                // remove any commas from the formatted string - since that will mess up csv files
+                ctString::ctReplaceAll(errorString, L",", L" ");
+            }
+        }
+
+        if (g_binaryConnectionLogger)
+        {
+            auto record = MakeBinaryConnectionRecord(currentTime, ctSockaddr(), ctSockaddr(), error, IPPROTO_TCP, "");
+            g_binaryConnectionLogger->WriteRecord(record);
+        }
+        if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
+        {
+            csvString = wil::str_printf<std::wstring>(
+                tcpResultCsvFormat,
+                currentTime,
+                ctSockaddr().WriteCompleteAddress().c_str(),
+                ctSockaddr().WriteCompleteAddress().c_str(),
+                0LL,
+                0LL,
+                0LL,
+                0LL,
+                0LL,
+                errorString.c_str(),
+                L"");
+        }
+        // we'll never write csv format to the console so we'll need a text string in that case
+        // - and/or in the case the s_ConnectionLogger isn't writing to csv
+        if (writeToConsole || g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+        {
+            textString = wil::str_printf<std::wstring>(
+                tcpNetworkFailureResultTextFormat,
+                currentTime,
+                errorString.c_str(),
+                ctSockaddr().WriteCompleteAddress().c_str(),
+                ctSockaddr().WriteCompleteAddress().c_str(),
+                L"",
+                0LL,
+                0LL,
+                0LL,
+                0LL,
+                0LL);
+        }
 
-            case PrintUsageOption::Advanced:
-                usage.append(L"\n"
-                    L"----------------------------------------------------------------------\n"
-                    L"                        Advanced Options                              \n"
-                    L"                                                                      \n"
-                    L"  * these options target specific scenario requirements               \n"
-                    L"----------------------------------------------------------------------\n"
-                    L"-Acc:<accept,AcceptEx>\n"
-                    L"   - specifies the Winsock API to process accepting inbound connections\n"
-                    L"    the default is appropriate unless deliberately needing to test other APIs\n"
-                    L"\t- <default> == AcceptEx\n"
-                    L"\t- AcceptEx : uses OVERLAPPED AcceptEx with IO Completion ports\n"
-                    L"\t- accept : uses blocking calls to accept\n"
-                    L"\t         : be careful using this as it will not scale out well as each call blocks a thread\n"
-                    L"-Bind:<IP-address or *>\n"
-                    L"   - a client-side option used to control what IP address is used for outgoing connections\n"
-                    L"\t- <default> == *  (will implicitly bind to the correct IP to connect to the target IP)\n"
-                    L"\t  note : this is typically only necessary when wanting to distribute traffic\n"
-                    L"\t         over a specific interface for multi-homed configurations\n"
-                    L"\t  note : can specify multiple addresses by providing -Bind for each address\n"
-                    L"-Compartment:<ifAlias>\n"
-                    L"   - specifies the interface alias of the compartment to use for all sockets\n"
-                    L"    this is most commonly appropriate for servers configured with IP Compartments\n"
-                    L"\t- <default> == using the default IP compartment\n"
-                    L"\t  note : all systems use the default compartment unless explicitly configured otherwise\n"
-                    L"\t  note : the IP addresses specified through -Bind (for clients) and -Listen (for servers)\n"
-                    L"\t         will be directly affected by this Compartment value, including specifying '*'\n"
-                    L"-Conn:<connect,ConnectEx>\n"
-                    L"   - specifies the Winsock API to establish outbound connections\n"
-                    L"    the default is appropriate unless deliberately needing to test other APIs\n"
-                    L"\t- <default> == ConnectEx  (appropriate unless explicitly wanting to test other APIs)\n"
-                    L"\t- ConnectEx : uses OVERLAPPED ConnectEx with IO Completion ports\n"
-                    L"\t- connect : uses blocking calls to connect\n"
-                    L"\t          : be careful using this as it will not scale out well as each call blocks a thread\n"
-                    L"-IfIndex:####\n"
-                    L"   - the interface index which to use for outbound connectivity\n"
-                    L"     assigns the interface with IP_UNICAST_IF / IPV6_UNICAST_IF\n"
-                    L"\t- <default> == not set (will not restrict binding to any specific interface)\n"
-                    L"-InlineCompletions:<on,off>\n"
-                    L"   - will set the below option on all SOCKETS for OVERLAPPED I/O calls so inline successful\n"
-                    L"     completions will not be queued to the completion handler\n"
-                    L"     ::SetFileCompletionNotificationModes(FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)\n"
-                    L"\t- <default> == on for TCP 'iocp' -IO option, and is on for UDP client receivers\n"
-                    L"                 off for all other -IO options\n"
-                    L"-IO:<readwritefile>\n"
-                    L"   - an additional IO option beyond iocp and rioiocp\n"
-                    L"\t- readwritefile : leverages ReadFile/WriteFile using IOCP for async completions\n"
-                    L"-KeepAliveValue:####\n"
-                    L"   - the # of milliseconds to set KeepAlive for TCP connections\n"
-                    L"\t- <default> == not set\n"
-                    L"\t  note : This setting is a more specific setting than -Options:keepalive\n"
-                    L"\t         as -Options:keepalive will use the system default values for keep-alive timers\n"
-                    L"-LocalPort:####\n"
-                    L"   - the local port to bind to when initiating a connection\n"
-                    L"\t- <default> == 0  (an ephemeral port will be chosen when making a connection)\n"
-                    L"\t- supports range : [low,high] each new connection will sequentially choose a port within this range\n"
-                    L"\t  note : You must provide a sufficiently large range to support the number of connections\n"
-                    L"\t  note : Be very careful when using with TCP connections, as port values will not be immediately\n"
-                    L"\t         reusable; TCP will hold an closed IP:port in a TIME_WAIT statue for a period of time\n"
-                    L"\t         only after which will it be able to be reused (default is 4 minutes)\n"
-                    L"-MsgWaitAll:<on,off>\n"
-                    L"   - sets the MSG_WAITALL flag when calling WSARecv for receiving data over TCP connections\n"
-                    L"     this flag instructs TCP to not complete the receive request until the entire buffer is full\n"
-                    L"\t- <default> == on\n"
-                    L"\t  note : the default behavior when not specified is for TCP to indicate data up to the app per RFC\n"
-                    L"           thus apps generally only set this when they know precisely the number of bytes they are expecting\n"
-                    L"-OnError:<log,break>\n"
-                    L"   - policy to control how errors are handled at runtime\n"
-                    L"\t- <default> == log \n"
-                    L"\t- log : log error information only\n"
-                    L"\t- break : break into the debugger with error information\n"
-                    L"\t          useful when live-troubleshooting difficult failures\n"
-                    L"-Options:<keepalive,tcpfastpath>  [-Options:<...>] [-Options:<...>]\n"
-                    L"   - additional socket options and IOCTLS available to be set on connected sockets\n"
-                    L"\t- <default> == None\n"
-                    L"\t- keepalive : only for TCP sockets - enables default timeout Keep-Alive probes\n"
-                    L"\t            : ctsTraffic servers have this enabled by default\n"
-                    L"\t- tcpfastpath : a new option for Windows 8, only for TCP sockets over loopback\n"
-                    L"\t              : the firewall must be disabled for the option to take effect\n"
-                    L"-PrePostRecvs:#####\n"
-                    L"   - specifies the number of recv requests to issue concurrently within an IO Pattern\n"
-                    L"   - for example, with the default -pattern:pull, the client will post recv calls \n"
-                    L"\t     one after another, immediately posting a recv after the prior completed.\n"
-                    L"\t     with -pattern:pull -PrePostRecvs:2, clients will keep 2 recv calls in-flight at all times.\n"
-                    L"\t- <default> == 1 for TCP (one recv request at a time)\n"
-                    L"\t- <default> == 2 for UDP (two recv requests kept in-flight)\n"
-                    L"\t  note : with TCP patterns, -verify:connection must be specified in order to specify\n"
-                    L"\t         more than one -PrePostRecvs (UDP can always support any number)\n"
-                    L"-PrePostSends:#####\n"
-                    L"   - specifies the number of send requests to issue concurrently within an IO Pattern\n"
-                    L"   - for example, with the default -pattern:pull, the servers will post send calls \n"
-                    L"\t     one after another, immediately posting a send after the prior completed.\n"
-                    L"\t     With -pattern:pull -PrePostSends:2, servers will keep 2 send calls in-flight at all times.\n"
-                    L"   - The value of '0' has special meaning: it indicates for ctsTraffic to keep as many sends\n"
-                    L"\t     in flight as indicated by the Ideal Send Backlog (ISB) indicated by TCP. In this\n"
-                    L"\t     configuration, ctsTraffic will maintain send calls until the number of bytes being sent\n"
-                    L"\t     equals the number of byes indicates by ISB for that TCP connection.\n"
-                    L"\t- <default> == 1 for non-RIO TCP (Winsock will adjust automatically according to ISB)\n"
-                    L"\t- <default> == 0 (ISB) for RIO TCP (RIO doesn't user send buffers so callers must track ISB)\n"
-                    L"\t- <default> == 1 for UDP (one send request on each timer tick)\n"
-                    L"-RateLimitPeriod:#####\n"
-                    L"   - the # of milliseconds describing the granularity by which -RateLimit bytes/second is enforced\n"
-                    L"\t     the -RateLimit bytes/second will be evenly split across -RateLimitPeriod milliseconds\n"
-                    L"\t     For example, -RateLimit:1000 -RateLimitPeriod:50 will limit send rates to 100 bytes every 20 ms\n"
-                    L"\t- <default> == 100 (-RateLimit bytes/second will be split out across 100 ms. time slices)\n"
-                    L"\t  note : only applicable to TCP connections\n"
-                    L"\t  note : only applicable is -RateLimit is set (default is not to rate limit)\n"
-                    L"-RecvBufValue:#####\n"
-                    L"   - specifies the value to pass to the SO_RCVBUF socket option\n"
-                    L"\t     Note: this is only necessary to specify in carefully considered scenarios\n"
-                    L"\t     the default receive buffering is optimal for the majority of scenarios\n"
-                    L"\t- <default> == <not set>\n"
-                    L"-SendBufValue:#####\n"
-                    L"   - specifies the value to pass to the SO_SNDBUF socket option\n"
-                    L"\t     Note: this is only necessary to specify in carefully considered scenarios\n"
-                    L"\t     the default send buffering is optimal for the majority of scenarios\n"
-                    L"\t- <default> == <not set>\n"
-                    L"-ThrottleConnections:####\n"
-                    L"   - gates currently pended connection attempts\n"
-                    L"\t- <default> == 1000  (there will be at most 1000 sockets trying to connect at any one time)\n"
-                    L"\t  note : zero means no throttling  (will immediately try to connect all '-Connections')\n"
-                    L"\t       : this is a client-only option\n"
-                    L"-TimeLimit:#####\n"
-                    L"   - the maximum number of milliseconds to run before the application is aborted and terminated\n"
-                    L"\t- <default> == <no time limit>\n"
-                    L"\t  note : this is to be used only to cap the maximum time to run, as this will log an error\n"
-                    L"\t         if this timelimit is exceeded; predictable results should have the scenario finish\n"
-                    L"\t         before this time limit is hit\n"
-                    L"\n");
-                break;
+        if (writeToConsole)
+        {
+            // text strings always go to the console
+            wprintf(L"%ws\n", textString.c_str());
         }
 
-        fwprintf_s(stdout, L"%ws", usage.c_str());
+        if (g_connectionLogger)
+        {
+            if (g_connectionLogger->IsCsvFormat())
+            {
+                g_connectionLogger->LogMessage(csvString.c_str());
+            }
+            else
+            {
+                g_connectionLogger->LogMessage(
+                    wil::str_printf<std::wstring>(L"%ws\r\n", textString.c_str()).c_str());
+            }
+        }
+    }
+    catch (...)
+    {
     }
 
-    bool Startup(int argc, _In_reads_(argc) const wchar_t** argv)
+    static void WriteConnectionResults(float currentTime, const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsTcpStatistics& stats) noexcept
+        try
     {
-        ctsConfigInitOnce();
+        // write even after shutdown so can print the final summaries
+        bool writeToConsole = false;
+        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        {
+            // case 0: // nothing
+            // case 1: // status updates
+            // case 2: // error info
+            case 3: // connection info
+            case 4: // connection info + error info
+            case 5: // connection info + error info + status updates
+            case 6: // above + debug info
+            {
+                writeToConsole = true;
+            }
+        }
 
-        if (argc < 2)
+        enum class ErrorType
         {
-            PrintUsage();
-            return false;
+            Success,
+            NetworkError,
+            ProtocolError
+        } errorType = ErrorType::Success;
+
+        if (0 == error)
+        {
+            errorType = ErrorType::Success;
+        }
+        else if (ctsIoPattern::IsProtocolError(error))
+        {
+            errorType = ErrorType::ProtocolError;
+        }
+        else
+        {
+            errorType = ErrorType::NetworkError;
+        }
+
+        static PCWSTR tcpSuccessfulResultTextFormat = L"[%.3f] TCP connection succeeded : [%ws - %ws] [%hs]: SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
+        static PCWSTR tcpNetworkFailureResultTextFormat = L"[%.3f] TCP connection failed with the error %ws : [%ws - %ws] [%hs] : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
+        static PCWSTR tcpProtocolFailureResultTextFormat = L"[%.3f] TCP connection failed with the protocol error %ws : [%ws - %ws] [%hs] : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
+
+        // csv format : L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId"
+        static PCWSTR tcpResultCsvFormat = L"%.3f,%ws,%ws,%lld,%lld,%lld,%lld,%lld,%ws,%hs%ws%ws%ws%ws\r\n";
+
+        // SIO_TCP_INFO samples are appended to the results (and folded into the summary) when sampled
+        // csv format : L"MinRttUs,AvgRttUs,MaxRttUs,MinCwnd,AvgCwnd,MaxCwnd,AvgBytesInFlight,MaxBytesInFlight,BytesRetrans,FastRetrans,TimeoutEpisodes"
+        static PCWSTR tcpInfoCsvFormat = L",%lu,%llu,%lu,%lu,%llu,%lu,%llu,%lu,%llu,%llu,%llu";
+        static PCWSTR tcpInfoTextFormat = L"  RttUs[%lu / %llu / %lu]  Cwnd[%lu / %llu / %lu]  BytesInFlight[%llu / %lu]  BytesRetrans[%llu]  FastRetrans[%llu]  TimeoutEpisodes[%llu]";
+        const auto& tcpInfo = stats.m_tcpInfo;
+        const auto formatTcpInfo = [&tcpInfo](PCWSTR format) {
+            return wil::str_printf<std::wstring>(
+                format,
+                tcpInfo.m_rttMicroseconds.GetMinimum(),
+                tcpInfo.m_rttMicroseconds.GetAverage(tcpInfo.m_sampleCount),
+                tcpInfo.m_rttMicroseconds.m_maximum,
+                tcpInfo.m_congestionWindow.GetMinimum(),
+                tcpInfo.m_congestionWindow.GetAverage(tcpInfo.m_sampleCount),
+                tcpInfo.m_congestionWindow.m_maximum,
+                tcpInfo.m_bytesInFlight.GetAverage(tcpInfo.m_sampleCount),
+                tcpInfo.m_bytesInFlight.m_maximum,
+                tcpInfo.m_bytesRetransmitted,
+                tcpInfo.m_fastRetransmits,
+                tcpInfo.m_timeoutEpisodes);
+        };
+
+        // -ConnectionSamples : the interval reductions and the last intervals held (as bytes/second) are appended to the results
+        // csv format : L"Intervals,MinIntervalBps,MaxIntervalBps,Stalls,LongestStall,IntervalBps" - the intervals space-separated
+        static PCWSTR samplesCsvFormat = L",%lld,%lld,%lld,%lld,%lld,%ws";
+        static PCWSTR samplesTextFormat = L"  Intervals[%lld]  IntervalBps[%lld / %lld]  Stalls[%lld]  LongestStall[%lld]  LastIntervalsBps[%ws]";
+        const auto& samples = stats.m_samples;
+        const auto formatSamples = [&samples](PCWSTR format) {
+            const auto sampleInterval = static_cast<long long>(g_configSettings->ConnectionSampleIntervalMilliseconds);
+            wstring intervals;
+            for (long long index = 0; index < samples.GetSampleCount(); ++index)
+            {
+                intervals.append(wil::str_printf<std::wstring>(index > 0 ? L" %lld" : L"%lld", samples.GetSample(index) * 1000LL / sampleInterval));
+            }
+            return wil::str_printf<std::wstring>(
+                format,
+                samples.m_intervalCount,
+                samples.GetMinimumBytes() * 1000LL / sampleInterval,
+                samples.m_maximumBytes * 1000LL / sampleInterval,
+                samples.m_stallCount,
+                samples.m_longestStall,
+                intervals.c_str());
+        };
+        const bool printSamples = g_configSettings->ConnectionSampleIntervalMilliseconds > 0;
+
+        // -RecvBufValue:auto, -SendBufValue:auto : the measured BDP and the buffers sized from it are appended to the results
+        // csv format : L"BdpRttUs,BdpBps,BdpBytes,AutoRecvBuf,AutoSendBuf" - all zero if the connection closed before it was measured
+        static PCWSTR bufferSizingCsvFormat = L",%lu,%llu,%lu,%lu,%lu";
+        static PCWSTR bufferSizingTextFormat = L"  BDP[%lu us x %llu Bps = %lu bytes]  AutoRecvBuf[%lu]  AutoSendBuf[%lu]";
+        const auto& bufferSizing = stats.m_bufferSizing;
+        const auto formatBufferSizing = [&bufferSizing](PCWSTR format) {
+            return wil::str_printf<std::wstring>(
+                format,
+                bufferSizing.m_rttMicroseconds,
+                bufferSizing.m_bytesPerSecond,
+                bufferSizing.m_bdpBytes,
+                bufferSizing.m_recvBufBytes,
+                bufferSizing.m_sendBufBytes);
+        };
+        const bool printBufferSizing = g_configSettings->AutoRecvBuf || g_configSettings->AutoSendBuf;
+
+        // -PersistentTransfers : the time of the first (cold) transfer and of the (warm) transfers after it are appended to the results
+        // csv format : L"Transfers,FirstTransferUs,AvgWarmTransferUs,MaxWarmTransferUs" - the warm times are zero with a single transfer
+        static PCWSTR transferTimingsCsvFormat = L",%lu,%lld,%lld,%lld";
+        static PCWSTR transferTimingsTextFormat = L"  Transfers[%lu]  FirstTransfer[%lld us]  WarmTransfers[%lld us avg / %lld us max]";
+        const auto& transferTimings = stats.m_transferTimings;
+        const auto formatTransferTimings = [&transferTimings](PCWSTR format) {
+            return wil::str_printf<std::wstring>(
+                format,
+                transferTimings.m_transferCount,
+                transferTimings.m_firstTransferMicroseconds,
+                transferTimings.GetAverageWarmTransferMicroseconds(),
+                transferTimings.m_slowestWarmTransferMicroseconds);
+        };
+        const bool printTransferTimings = g_configSettings->PersistentTransfers > 1;
+
+        const long long totalTime = stats.m_endTime.GetValue() - stats.m_startTime.GetValue();
+        FAIL_FAST_IF_MSG(
+            totalTime < 0LL,
+            "end_time is less than start_time in this ctsTcpStatistics object (%p)", &stats);
+
+        wstring csvString;
+        wstring textString;
+        wstring errorString;
+        if (ErrorType::ProtocolError != errorType)
+        {
+            if (0 == error)
+            {
+                errorString = L"Succeeded";
+            }
+            else
+            {
+                errorString = wil::str_printf<std::wstring>(
+                    L"%lu: %ws",
+                    error,
+                    ctString::ctFormatMessage(error).c_str());
+                // remove any commas from the formatted string - since that will mess up csv files
+                ctString::ctReplaceAll(errorString, L",", L" ");
+            }
+        }
+
+        if (g_binaryConnectionLogger)
+        {
+            auto record = MakeBinaryConnectionRecord(currentTime, localAddr, remoteAddr, error, IPPROTO_TCP, stats.m_connectionIdentifier);
+            record.m_tcp.m_bytesSent = stats.m_bytesSent.GetValue();
+            record.m_tcp.m_bytesRecv = stats.m_bytesRecv.GetValue();
+            record.m_tcp.m_timeMs = totalTime;
+            if (tcpInfo.m_sampleCount > 0)
+            {
+                record.m_tcp.m_tcpInfoSampleCount = tcpInfo.m_sampleCount;
+                record.m_tcp.m_minRttUs = tcpInfo.m_rttMicroseconds.GetMinimum();
+                record.m_tcp.m_avgRttUs = tcpInfo.m_rttMicroseconds.GetAverage(tcpInfo.m_sampleCount);
+                record.m_tcp.m_maxRttUs = tcpInfo.m_rttMicroseconds.m_maximum;
+                record.m_tcp.m_minCwnd = tcpInfo.m_congestionWindow.GetMinimum();
+                record.m_tcp.m_avgCwnd = tcpInfo.m_congestionWindow.GetAverage(tcpInfo.m_sampleCount);
+                record.m_tcp.m_maxCwnd = tcpInfo.m_congestionWindow.m_maximum;
+                record.m_tcp.m_avgBytesInFlight = tcpInfo.m_bytesInFlight.GetAverage(tcpInfo.m_sampleCount);
+                record.m_tcp.m_maxBytesInFlight = tcpInfo.m_bytesInFlight.m_maximum;
+                record.m_tcp.m_bytesRetransmitted = tcpInfo.m_bytesRetransmitted;
+                record.m_tcp.m_fastRetransmits = tcpInfo.m_fastRetransmits;
+                record.m_tcp.m_timeoutEpisodes = tcpInfo.m_timeoutEpisodes;
+            }
+            g_binaryConnectionLogger->WriteRecord(record);
+        }
+        if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
+        {
+            csvString = wil::str_printf<std::wstring>(
+                tcpResultCsvFormat,
+                currentTime,
+                localAddr.WriteCompleteAddress().c_str(),
+                remoteAddr.WriteCompleteAddress().c_str(),
+                stats.m_bytesSent.GetValue(),
+                totalTime > 0LL ? static_cast<long long>(stats.m_bytesSent.GetValue() * 1000LL / totalTime) : 0LL,
+                stats.m_bytesRecv.GetValue(),
+                totalTime > 0LL ? static_cast<long long>(stats.m_bytesRecv.GetValue() * 1000LL / totalTime) : 0LL,
+                totalTime,
+                ErrorType::ProtocolError == errorType ?
+                ctsIoPattern::BuildProtocolErrorString(error) :
+                errorString.c_str(),
+                stats.m_connectionIdentifier,
+                tcpInfo.m_sampleCount > 0 ? formatTcpInfo(tcpInfoCsvFormat).c_str() :
+                // keeping the csv columns aligned for connections which never transmitted data
+                g_configSettings->TcpInfoIntervalMilliseconds > 0 ? L",,,,,,,,,,," : L"",
+                printSamples ? formatSamples(samplesCsvFormat).c_str() : L"",
+                printBufferSizing ? formatBufferSizing(bufferSizingCsvFormat).c_str() : L"",
+                printTransferTimings ? formatTransferTimings(transferTimingsCsvFormat).c_str() : L"");
         }
-
-        // ignore the first argv... the exe itself
-        const wchar_t** argBegin = argv + 1;
-        const wchar_t** argEnd = argv + argc;
-        vector<const wchar_t*> args(argBegin, argEnd);
-
-        //
-        // first check of they asked for help text
-        //
-        const auto foundHelp = find_if(
-            begin(args),
-            end(args),
-            [](const wchar_t* arg) -> bool {
-                return ctString::ctOrdinalStartsWithCaseInsensative(arg, L"-Help") ||
-                    ctString::ctOrdinalEqualsCaseInsensative(arg, L"-?");
-            });
-        if (foundHelp != end(args))
+        // we'll never write csv format to the console so we'll need a text string in that case
+        // - and/or in the case the s_ConnectionLogger isn't writing to csv
+        if (writeToConsole || g_connectionLogger && !g_connectionLogger->IsCsvFormat())
         {
-            PCWSTR const helpString = *foundHelp;
-            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Advanced"))
+            if (0 == error)
             {
-                PrintUsage(PrintUsageOption::Advanced);
-                return false;
+                textString = wil::str_printf<std::wstring>(
+                    tcpSuccessfulResultTextFormat,
+                    currentTime,
+                    localAddr.WriteCompleteAddress().c_str(),
+                    remoteAddr.WriteCompleteAddress().c_str(),
+                    stats.m_connectionIdentifier,
+                    stats.m_bytesSent.GetValue(),
+                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesSent.GetValue() * 1000LL / totalTime) : 0LL,
+                    stats.m_bytesRecv.GetValue(),
+                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesRecv.GetValue() * 1000LL / totalTime) : 0LL,
+                    totalTime);
             }
-            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Tcp"))
+            else
             {
-                PrintUsage(PrintUsageOption::Tcp);
-                return false;
+                textString = wil::str_printf<std::wstring>(
+                    ErrorType::ProtocolError == errorType ? tcpProtocolFailureResultTextFormat : tcpNetworkFailureResultTextFormat,
+                    currentTime,
+                    ErrorType::ProtocolError == errorType ? ctsIoPattern::BuildProtocolErrorString(error) : errorString.c_str(),
+                    localAddr.WriteCompleteAddress().c_str(),
+                    remoteAddr.WriteCompleteAddress().c_str(),
+                    stats.m_connectionIdentifier,
+                    stats.m_bytesSent.GetValue(),
+                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesSent.GetValue() * 1000LL / totalTime) : 0LL,
+                    stats.m_bytesRecv.GetValue(),
+                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesRecv.GetValue() * 1000LL / totalTime) : 0LL,
+                    totalTime);
             }
-            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Udp"))
+            if (tcpInfo.m_sampleCount > 0)
             {
-                PrintUsage(PrintUsageOption::Udp);
-                return false;
+                textString.append(formatTcpInfo(tcpInfoTextFormat));
             }
-            if (ctString::ctOrdinalEqualsCaseInsensative(helpString, L"-Help:Logging"))
+            if (printSamples)
             {
-                PrintUsage(PrintUsageOption::Logging);
-                return false;
+                textString.append(formatSamples(samplesTextFormat));
+            }
+            if (printBufferSizing)
+            {
+                textString.append(formatBufferSizing(bufferSizingTextFormat));
+            }
+            if (printTransferTimings)
+            {
+                textString.append(formatTransferTimings(transferTimingsTextFormat));
             }
-
-            PrintUsage();
-            return false;
         }
 
-        //
-        // create the handle for ctrl-c
-        //
-        g_configSettings->CtrlCHandle = CreateEventW(nullptr, TRUE, FALSE, nullptr);
-        if (!g_configSettings->CtrlCHandle)
+        if (writeToConsole)
         {
-            THROW_WIN32_MSG(GetLastError(), "CreateEvent");
+            // text strings always go to the console
+            wprintf(L"%ws\n", textString.c_str());
         }
 
-        //
-        // Many of the below settings must be made in a specified order - comments below help to explain this reasoning
-        // note: the IO function definitions must come after *all* other settings
-        //       since instantiations of those IO functions might reference global Settings values
-
-        //
-        // First:
-        // Establish logging settings including verbosity levels and error policies before any functional settings
-        // Create the threadpool before instantiating any other object
-        //
-        ParseForError(args);
-        ParseForLogging(args);
-
-        //
-        // Next: check for static machine configuration
-        // - note these are checking system settings, not user arguments
-        //
-        CheckSystemSettings();
-
-        //
-        // Next: establish the address and port # to be used
-        //
-        ParseForAddress(args);
-        ParseForPort(args);
-        ParseForLocalport(args);
-        ParseForIfIndex(args);
-
-        //
-        // ensure a Port is assigned to all listening addresses and target addresses
-        //
-        for (auto& addr : g_configSettings->ListenAddresses)
+        if (g_connectionLogger)
         {
-            if (addr.port() == 0x0000)
+            if (g_connectionLogger->IsCsvFormat())
             {
-                addr.SetPort(g_configSettings->Port);
+                g_connectionLogger->LogMessage(csvString.c_str());
             }
-        }
-        for (auto& addr : g_configSettings->TargetAddresses)
-        {
-            if (addr.port() == 0x0000)
+            else
             {
-                addr.SetPort(g_configSettings->Port);
+                g_connectionLogger->LogMessage(
+                    wil::str_printf<std::wstring>(L"%ws\r\n", textString.c_str()).c_str());
             }
         }
+    }
+    catch (...)
+    {
+    }
 
-        if (g_configSettings->OutgoingIfIndex != 0 && !g_configSettings->ListenAddresses.empty())
+    static void WriteConnectionResults(float currentTime, const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsUdpStatistics& stats) noexcept
+        try
+    {
+        // write even after shutdown so can print the final summaries
+        bool writeToConsole = false;
+        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
         {
-            throw invalid_argument("-IfIndex can only be used for outgoing connections, not listening sockets");
+            // case 0: // nothing
+            // case 1: // status updates
+            // case 2: // error info
+            case 3: // connection info
+            case 4: // connection info + error info
+            case 5: // connection info + error info + status updates
+            case 6: // above + debug info
+            {
+                writeToConsole = true;
+            }
         }
 
-        //
-        // Next: gather the protocol and Pattern to be used
-        // - set the threadpool value after identifying the pattern
-        ParseForProtocol(args);
-        // default to keep-alive on TCP servers
-        if (ProtocolType::TCP == g_configSettings->Protocol && !g_configSettings->ListenAddresses.empty())
+        enum class ErrorType
         {
-            g_configSettings->Options |= Keepalive;
-        }
+            Success,
+            NetworkError,
+            ProtocolError
+        } errorType{};
 
-        ParseForIoPattern(args);
-        ParseForThreadpool(args);
-        // validate protocol & pattern combinations
-        if (ProtocolType::UDP == g_configSettings->Protocol && IoPatternType::MediaStream != g_configSettings->IoPattern)
+        if (0 == error)
         {
-            throw invalid_argument("UDP only supports the MediaStream IO Pattern");
+            errorType = ErrorType::Success;
         }
-        if (ProtocolType::TCP == g_configSettings->Protocol && IoPatternType::MediaStream == g_configSettings->IoPattern)
+        else if (ctsIoPattern::IsProtocolError(error))
         {
-            throw invalid_argument("TCP does not support the MediaStream IO Pattern");
+            errorType = ErrorType::ProtocolError;
         }
-        // set appropriate defaults for # of connections for TCP vs. UDP
-        if (ProtocolType::UDP == g_configSettings->Protocol)
+        else
         {
-            g_configSettings->ConnectionLimit = c_defaultUdpConnectionLimit;
+            errorType = ErrorType::NetworkError;
         }
-        else
+
+        static PCWSTR udpSuccessfulResultTextFormat = L"[%.3f] UDP connection succeeded : [%ws - %ws] [%hs] : BitsPerSecond [%llu]  Completed [%llu]  Dropped [%llu]  Repeated [%llu]  Errors [%llu]";
+        static PCWSTR udpNetworkFailureResultTextFormat = L"[%.3f] UDP connection failed with the error %ws : [%ws - %ws] [%hs] : BitsPerSecond [%llu]  Completed [%llu]  Dropped [%llu]  Repeated [%llu]  Errors [%llu]";
+        static PCWSTR udpProtocolFailureResultTextFormat = L"[%.3f] UDP connection failed with the protocol error %ws : [%ws - %ws] [%hs] : BitsPerSecond [%llu]  Completed [%llu]  Dropped [%llu]  Repeated [%llu]  Errors [%llu]";
+
+        // csv format : "TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId"
+        static PCWSTR udpResultCsvFormat = L"%.3f,%ws,%ws,%llu,%llu,%llu,%llu,%llu,%ws,%hs\r\n";
+
+        const long long elapsedTime(stats.m_endTime.GetValue() - stats.m_startTime.GetValue());
+        const long long bitsPerSecond = elapsedTime > 0LL ? static_cast<long long>(stats.m_bitsReceived.GetValue() * 1000LL / elapsedTime) : 0LL;
+
+        wstring csvString;
+        wstring textString;
+        wstring errorString;
+        if (ErrorType::ProtocolError != errorType)
         {
-            g_configSettings->ConnectionLimit = c_defaultTcpConnectionLimit;
+            if (0 == error)
+            {
+                errorString = L"Succeeded";
+            }
+            else
+            {
+                errorString = wil::str_printf<std::wstring>(
+                    L"%lu: %ws",
+                    error,
+                    ctString::ctFormatMessage(error).c_str());
+                // remove any commas from the formatted string - since that will mess up csv files
+                ctString::ctReplaceAll(errorString, L",", L" ");
+            }
         }
 
-        //
-        // Next, set the ctsStatusInformation to be used to print status updates for this protocol
-        // - this must be called after both set_logging and set_protocol
-        //
-        if (ProtocolType::TCP == g_configSettings->Protocol)
+        if (g_binaryConnectionLogger)
         {
-            g_printStatusInformation = make_shared<ctsTcpStatusInformation>();
+            auto record = MakeBinaryConnectionRecord(currentTime, localAddr, remoteAddr, error, IPPROTO_UDP, stats.m_connectionIdentifier);
+            record.m_udp.m_bitsPerSecond = bitsPerSecond;
+            record.m_udp.m_successfulFrames = stats.m_successfulFrames.GetValue();
+            record.m_udp.m_droppedFrames = stats.m_droppedFrames.GetValue();
+            record.m_udp.m_duplicateFrames = stats.m_duplicateFrames.GetValue();
+            record.m_udp.m_errorFrames = stats.m_errorFrames.GetValue();
+            g_binaryConnectionLogger->WriteRecord(record);
         }
-        else
+        if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
         {
-            g_printStatusInformation = make_shared<ctsUdpStatusInformation>();
+            csvString = wil::str_printf<std::wstring>(
+                udpResultCsvFormat,
+                currentTime,
+                localAddr.WriteCompleteAddress().c_str(),
+                remoteAddr.WriteCompleteAddress().c_str(),
+                bitsPerSecond,
+                stats.m_successfulFrames.GetValue(),
+                stats.m_droppedFrames.GetValue(),
+                stats.m_duplicateFrames.GetValue(),
+                stats.m_errorFrames.GetValue(),
+                ErrorType::ProtocolError == errorType ?
+                ctsIoPattern::BuildProtocolErrorString(error) :
+                errorString.c_str(),
+                stats.m_connectionIdentifier);
         }
-
-        //
-        // Next: capture other various settings which do not have explicit dependencies
-        //
-        ParseForOptions(args);
-        ParseForKeepAlive(args);
-        ParseForCompartment(args);
-        ParseForConnections(args);
-        ParseForThrottleConnections(args);
-        ParseForBuffer(args);
-        ParseForTransfer(args);
-        ParseForIterations(args);
-        ParseForServerExitLimit(args);
-
-        ParseForRatelimit(args);
-        ParseForTimelimit(args);
-        const auto ratePerPeriod = g_rateLimitLow * g_configSettings->TcpBytesPerSecondPeriod / 1000LL;
-        if (g_configSettings->Protocol == ProtocolType::TCP && g_rateLimitLow > 0 && ratePerPeriod < 1)
+        // we'll never write csv format to the console so we'll need a text string in that case
+        // - and/or in the case the s_ConnectionLogger isn't writing to csv
+        if (writeToConsole || g_connectionLogger && !g_connectionLogger->IsCsvFormat())
         {
-            throw invalid_argument("RateLimit * RateLimitPeriod / 1000 must be greater than zero - meaning every period should send at least 1 byte");
+            if (0 == error)
+            {
+                textString = wil::str_printf<std::wstring>(
+                    udpSuccessfulResultTextFormat,
+                    currentTime,
+                    localAddr.WriteCompleteAddress().c_str(),
+                    remoteAddr.WriteCompleteAddress().c_str(),
+                    stats.m_connectionIdentifier,
+                    bitsPerSecond,
+                    stats.m_successfulFrames.GetValue(),
+                    stats.m_droppedFrames.GetValue(),
+                    stats.m_duplicateFrames.GetValue(),
+                    stats.m_errorFrames.GetValue());
+            }
+            else
+            {
+                textString = wil::str_printf<std::wstring>(
+                    ErrorType::ProtocolError == errorType ? udpProtocolFailureResultTextFormat : udpNetworkFailureResultTextFormat,
+                    currentTime,
+                    ErrorType::ProtocolError == errorType ?
+                    ctsIoPattern::BuildProtocolErrorString(error) :
+                    errorString.c_str(),
+                    localAddr.WriteCompleteAddress().c_str(),
+                    remoteAddr.WriteCompleteAddress().c_str(),
+                    stats.m_connectionIdentifier,
+                    bitsPerSecond,
+                    stats.m_successfulFrames.GetValue(),
+                    stats.m_droppedFrames.GetValue(),
+                    stats.m_duplicateFrames.GetValue(),
+                    stats.m_errorFrames.GetValue());
+            }
         }
 
-        //
-        // verify jitter logging requirements
-        //
-        if (g_jitterLogger && g_configSettings->Protocol != ProtocolType::UDP)
-        {
-            throw invalid_argument("Jitter can only be logged using UDP");
-        }
-        if (g_jitterLogger && !g_configSettings->ListenAddresses.empty())
-        {
-            throw invalid_argument("Jitter can only be logged on the client");
-        }
-        if (g_jitterLogger && g_configSettings->ConnectionLimit != 1)
+        if (writeToConsole)
         {
-            throw invalid_argument("Jitter can only be logged for a single UDP connection");
+            // text strings always go to the console
+            wprintf(L"%ws\n", textString.c_str());
         }
 
-        if (g_mediaStreamSettings.FrameSizeBytes > 0)
+        if (g_connectionLogger)
         {
-            // the buffersize is now effectively the frame size
-            g_bufferSizeHigh = 0;
-            g_bufferSizeLow = g_mediaStreamSettings.FrameSizeBytes;
-            if (g_bufferSizeLow < 20)
+            if (g_connectionLogger->IsCsvFormat())
             {
-                throw invalid_argument("The media stream frame size (buffer) must be at least 20 bytes");
+                g_connectionLogger->LogMessage(csvString.c_str());
+            }
+            else
+            {
+                g_connectionLogger->LogMessage(
+                    wil::str_printf<std::wstring>(L"%ws\r\n", textString.c_str()).c_str());
             }
         }
+    }
+    catch (...)
+    {
+    }
 
-        // validate localport usage
-        if (!g_configSettings->ListenAddresses.empty() && g_configSettings->LocalPortLow != 0)
+    // counts a completed connection into the current -ConnectionLog:aggregate interval
+    // - makeSample is only invoked when the connection is kept for the interval's -ConnectionLogSamples
+    template <typename MakeSample>
+    static void AggregateConnectionResults(unsigned long error, long long timeMs, long long bytes, MakeSample&& makeSample)
+    {
+        const auto lock = g_connectionAggregateLock.lock();
+        auto& aggregate = g_connectionAggregate;
+
+        ++aggregate.m_completed;
+        if (0 == error)
         {
-            throw invalid_argument("Cannot specify both -listen and -LocalPort. To listen on a specific port, use -Port:####");
+            ++aggregate.m_succeeded;
         }
-        if (g_configSettings->LocalPortLow != 0)
+        else
         {
-            const USHORT numberOfPorts = g_configSettings->LocalPortHigh == 0 ? 1 : static_cast<USHORT>(g_configSettings->LocalPortHigh - g_configSettings->LocalPortLow + 1);
-            if (numberOfPorts < g_configSettings->ConnectionLimit)
+            if (ctsIoPattern::IsProtocolError(error))
             {
-                throw invalid_argument(
-                    "Cannot specify more connections than specified local ports. "
-                    "Reduce the number of connections or increase the range of local ports.");
+                ++aggregate.m_protocolErrors;
+            }
+            else
+            {
+                ++aggregate.m_networkErrors;
             }
+            ++aggregate.m_errors[error];
         }
+        ++aggregate.m_timeMsBuckets[ConnectionAggregate::BucketIndex(timeMs)];
+        ++aggregate.m_bytesBuckets[ConnectionAggregate::BucketIndex(bytes)];
 
-        //
-        // Set the default buffer values as these settings are optional
-        //
-        g_configSettings->ShouldVerifyBuffers = true;
-        g_configSettings->UseSharedBuffer = false;
-        ParseForShouldVerifyBuffers(args);
-        if (ProtocolType::UDP == g_configSettings->Protocol)
+        // reservoir sampling : the first connections fill the sample, after which the Nth connection
+        // replaces a random member with probability (samples / N) - each is equally likely to be written
+        const size_t sampleCount = g_configSettings->ConnectionLogSamples;
+        if (aggregate.m_samples.size() < sampleCount)
         {
-            // UDP clients can never recv into the same shared buffer since it uses it for seq. numbers, etc
-            if (!IsListening())
+            aggregate.m_samples.emplace_back(makeSample());
+        }
+        else if (sampleCount > 0)
+        {
+            const auto replaced = t_randomGenerator.uniform_int(0LL, aggregate.m_completed - 1);
+            if (replaced < static_cast<long long>(sampleCount))
             {
-                g_configSettings->UseSharedBuffer = false;
+                aggregate.m_samples[static_cast<size_t>(replaced)] = makeSample();
             }
         }
+    }
 
-        //
-        // finally set the functions to use once all other settings are established
-        // set_ioFunction changes global options for socket operation for instance WSA_FLAG_REGISTERED_IO flag
-        // - hence it is requirement to invoke it prior to any socket operation
-        //
-        ParseForIoFunction(args);
-        ParseForInlineCompletions(args);
-        ParseForMsgWaitAll(args);
-        ParseForCreate(args);
-        ParseForConnect(args);
-        ParseForAccept(args);
-        if (!g_configSettings->ListenAddresses.empty())
+    void PrintConnectionResults(unsigned long error) noexcept
+        try
+    {
+        ctsConfigInitOnce();
+
+        const float currentTime = GetStatusTimeStamp();
+        if (g_configSettings->ConnectionLogAggregate)
         {
-            // servers 'create' connections when they accept them
-            g_configSettings->CreateFunction = g_configSettings->AcceptFunction;
-            g_configSettings->ConnectFunction = nullptr;
+            AggregateConnectionResults(error, 0LL, 0LL, [&] {
+                return make_unique<ConnectionAggregateSample>(currentTime, error);
+            });
+            return;
         }
 
-        g_configSettings->TcpShutdown = TcpShutdownType::GracefulShutdown;
-        ParseForShutdown(args);
+        WriteConnectionResults(currentTime, error);
+    }
+    catch (...)
+    {
+    }
 
-        ParseForPrepostrecvs(args);
-        if (ProtocolType::TCP == g_configSettings->Protocol && g_configSettings->ShouldVerifyBuffers && g_configSettings->PrePostRecvs > 1)
-        {
-            throw invalid_argument("-PrePostRecvs > 1 requires -Verify:connection when using TCP");
-        }
-        ParseForPrepostsends(args);
-        ParseForRecvbufvalue(args);
-        ParseForSendbufvalue(args);
+    void PrintConnectionResults(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsTcpStatistics& stats) noexcept
+        try
+    {
+        ctsConfigInitOnce();
 
-        if (!args.empty())
+        // SIO_TCP_INFO samples are folded into the summary whether or not this connection is written
+        if (stats.m_tcpInfo.m_sampleCount > 0)
         {
-            wstring errorString;
-            for (const auto& argString : args)
-            {
-                errorString.append(L" ");
-                errorString.append(argString);
-            }
-            errorString.append(L"\n");
-            PrintErrorInfoOverride(errorString.c_str());
-            throw invalid_argument(ctString::ctConvertToString(errorString).c_str());
+            g_configSettings->TcpStatusDetails.MergeTcpInfo(stats.m_tcpInfo);
         }
 
-        if (ProtocolType::UDP == g_configSettings->Protocol)
+        const float currentTime = GetStatusTimeStamp();
+        if (g_configSettings->ConnectionLogAggregate)
         {
-            const auto timerResult = timeBeginPeriod(1);
-            if (timerResult != TIMERR_NOERROR)
-            {
-                THROW_WIN32_MSG(timerResult, "timeBeginPeriod");
-            }
-            ++g_timePeriodRefCount;
+            const long long totalTime = stats.m_endTime.GetValue() - stats.m_startTime.GetValue();
+            AggregateConnectionResults(error, totalTime, stats.m_bytesSent.GetValue() + stats.m_bytesRecv.GetValue(), [&] {
+                return make_unique<ConnectionAggregateSample>(currentTime, localAddr, remoteAddr, error, stats);
+            });
+            return;
         }
 
-        return true;
+        WriteConnectionResults(currentTime, localAddr, remoteAddr, error, stats);
+    }
+    catch (...)
+    {
     }
 
-    void Shutdown() noexcept
+    void PrintConnectionResults(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsUdpStatistics& stats) noexcept
+        try
     {
         ctsConfigInitOnce();
 
-        const auto lock = g_shutdownLock.lock();
-        g_shutdownCalled = true;
-        if (g_configSettings->CtrlCHandle)
+        const float currentTime = GetStatusTimeStamp();
+        if (g_configSettings->ConnectionLogAggregate)
         {
-            if (!SetEvent(g_configSettings->CtrlCHandle))
-            {
-                FAIL_FAST_MSG(
-                    "SetEvent(%p) failed [%u] when trying to shutdown",
-                    g_configSettings->CtrlCHandle, GetLastError());
-            }
+            const long long elapsedTime = stats.m_endTime.GetValue() - stats.m_startTime.GetValue();
+            AggregateConnectionResults(error, elapsedTime, stats.GetBytesReceived(), [&] {
+                return make_unique<ConnectionAggregateSample>(currentTime, localAddr, remoteAddr, error, stats);
+            });
+            return;
         }
 
-        delete g_netAdapterAddresses;
-        g_netAdapterAddresses = nullptr;
-
-        while (g_timePeriodRefCount > 0)
-        {
-            timeEndPeriod(1);
-            --g_timePeriodRefCount;
-        }
+        WriteConnectionResults(currentTime, localAddr, remoteAddr, error, stats);
+    }
+    catch (...)
+    {
     }
 
-    // the Legend is to explain the fields for status updates
-    // - only print if status updates are going to be provided
-    void PrintLegend() noexcept
+    // writes the connection outcomes aggregated since the last status update (-ConnectionLog:aggregate)
+    // followed by the full results of the connections sampled from them (-ConnectionLogSamples)
+    static void WriteConnectionAggregate(long long currentTimeslice) noexcept
+        try
     {
-        ctsConfigInitOnce();
+        ConnectionAggregate interval;
+        {
+            const auto lock = g_connectionAggregateLock.lock();
+            swap(interval, g_connectionAggregate);
+        }
 
         bool writeToConsole = false;
         // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
         switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
         {
             // case 0: // nothing
-            case 1: // status updates
-                // case 2: // error info
-                // case 3: // connection info
-                // case 4: // connection info + error info
+            // case 1: // status updates
+            // case 2: // error info
+            case 3: // connection info
+            case 4: // connection info + error info
             case 5: // connection info + error info + status updates
             case 6: // above + debug info
             {
@@ -2801,252 +8697,382 @@ namespace ctsTraffic::ctsConfig
             }
         }
 
-        if (g_printStatusInformation)
+        // space-separated so the csv columns stay aligned
+        wstring errors;
+        for (const auto& [errorCode, count] : interval.m_errors)
         {
-            if (writeToConsole)
+            errors.append(wil::str_printf<std::wstring>(errors.empty() ? L"%lu:%lld" : L" %lu:%lld", errorCode, count));
+        }
+        const auto formatBuckets = [](const array<long long, ConnectionAggregate::c_bucketCount>& buckets) {
+            wstring formatted;
+            for (size_t bucket = 0; bucket < buckets.size(); ++bucket)
             {
-                PCWSTR const legend = g_printStatusInformation->PrintLegend(StatusFormatting::ConsoleOutput);
-                if (legend != nullptr)
-                {
-                    fwprintf(stdout, L"%ws\n", legend);
-                }
-                PCWSTR const header = g_printStatusInformation->PrintHeader(StatusFormatting::ConsoleOutput);
-                if (header != nullptr)
+                if (buckets[bucket] > 0)
                 {
-                    fwprintf(stdout, L"%ws\n", header);
+                    formatted.append(wil::str_printf<std::wstring>(
+                        formatted.empty() ? L"%llu:%lld" : L" %llu:%lld",
+                        ConnectionAggregate::BucketUpperBound(bucket),
+                        buckets[bucket]));
                 }
             }
-
-            if (g_statusLogger)
-            {
-                g_statusLogger->LogLegend(g_printStatusInformation);
-                g_statusLogger->LogHeader(g_printStatusInformation);
-            }
-        }
+            return formatted;
+        };
+        const wstring timeMsBuckets(formatBuckets(interval.m_timeMsBuckets));
+        const wstring bytesBuckets(formatBuckets(interval.m_bytesBuckets));
+        const auto timeSlice = static_cast<double>(currentTimeslice) / 1000.0;
 
         if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
         {
-            if (ProtocolType::UDP == g_configSettings->Protocol)
+            // csv format : L"TimeSlice,Established,Completed,Succeeded,NetworkErrors,ProtocolErrors,Errors,TimeMs,Bytes"
+            g_connectionLogger->LogMessage(
+                wil::str_printf<std::wstring>(
+                    L"%.3f,%lld,%lld,%lld,%lld,%lld,%ws,%ws,%ws\r\n",
+                    timeSlice,
+                    interval.m_established,
+                    interval.m_completed,
+                    interval.m_succeeded,
+                    interval.m_networkErrors,
+                    interval.m_protocolErrors,
+                    errors.c_str(),
+                    timeMsBuckets.c_str(),
+                    bytesBuckets.c_str()).c_str());
+        }
+        if (writeToConsole || g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+        {
+            const auto textString = wil::str_printf<std::wstring>(
+                L"[%.3f] %ws connections : Established[%lld]  Completed[%lld]  Succeeded[%lld]  NetworkErrors[%lld]  ProtocolErrors[%lld]  Errors[%ws]  TimeMs[%ws]  Bytes[%ws]",
+                timeSlice,
+                ProtocolType::TCP == g_configSettings->Protocol ? L"TCP" : L"UDP",
+                interval.m_established,
+                interval.m_completed,
+                interval.m_succeeded,
+                interval.m_networkErrors,
+                interval.m_protocolErrors,
+                errors.c_str(),
+                timeMsBuckets.c_str(),
+                bytesBuckets.c_str());
+            if (writeToConsole)
             {
-                g_connectionLogger->LogMessage(L"TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId\r\n");
+                wprintf(L"%ws\n", textString.c_str());
             }
-            else
-            { // TCP
-                g_connectionLogger->LogMessage(L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId\r\n");
+            if (g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+            {
+                g_connectionLogger->LogMessage(
+                    wil::str_printf<std::wstring>(L"%ws\r\n", textString.c_str()).c_str());
             }
         }
 
-        if (g_jitterLogger && g_jitterLogger->IsCsvFormat())
-        {
-            g_jitterLogger->LogMessage(L"SequenceNumber,SenderQpc,SenderQpf,ReceiverQpc,ReceiverQpf,RelativeInFlightTimeMs,PrevToCurrentInFlightTimeJitter\r\n");
-        }
-    }
-
-    // Always print to console if override
-    void PrintExceptionOverride(_In_ PCSTR exceptionText) noexcept
-    {
-        ctsConfigInitOnce();
-
-        FAIL_FAST_IF_MSG(g_breakOnError, "[ctsTraffic] >> exception - %hs\n", exceptionText);
-
-        try
+        for (const auto& sample : interval.m_samples)
         {
-            const auto formattedString(
-                wil::str_printf<std::wstring>(
-                    L"[%.3f] %hs",
-                    GetStatusTimeStamp(),
-                    exceptionText));
-
-            fwprintf(stderr, L"%ws\n", formattedString.c_str());
-            if (g_errorLogger)
+            if (sample->m_tcpStatistics)
             {
-                g_errorLogger->LogError(
-                    wil::str_printf<std::wstring>(L"%ws\r\n", formattedString.c_str()).c_str());
+                WriteConnectionResults(sample->m_timeSlice, sample->m_localAddr, sample->m_remoteAddr, sample->m_error, *sample->m_tcpStatistics);
             }
-        }
-        catch (...)
-        {
-            fwprintf(stderr, L"Error : failed to allocate memory\n");
-            if (g_errorLogger)
+            else if (sample->m_udpStatistics)
             {
-                g_errorLogger->LogError(L"Error : failed to allocate memory\r\n");
+                WriteConnectionResults(sample->m_timeSlice, sample->m_localAddr, sample->m_remoteAddr, sample->m_error, *sample->m_udpStatistics);
+            }
+            else
+            {
+                WriteConnectionResults(sample->m_timeSlice, sample->m_error);
             }
         }
-    }
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    /// Print* functions
-    /// - tracks what level of -verbose was specified
-    ///   and prints to console accordingly
-    ///
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
-    void PrintException(const wil::ResultException& e) noexcept
+    }
+    catch (...)
     {
-        ctsConfigInitOnce();
+    }
 
-        WCHAR errorString[1024]{};
-        GetFailureLogString(errorString, 1024, e.GetFailureInfo());
-        if (!g_shutdownCalled && g_breakOnError)
+    void PrintConnectionResults(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error) noexcept
+    {
+        if (ProtocolType::TCP == g_configSettings->Protocol)
         {
-            FAIL_FAST_MSG(
-                "Fatal exception: %ws", errorString);
+            PrintConnectionResults(localAddr, remoteAddr, error, ctsTcpStatistics());
+        }
+        else
+        {
+            PrintConnectionResults(localAddr, remoteAddr, error, ctsUdpStatistics());
         }
-
-        PrintErrorInfo(errorString);
     }
 
-    void PrintException(const std::exception& e) noexcept
+    void __cdecl PrintSummary(_In_z_ _Printf_format_string_ PCWSTR text, ...) noexcept
     {
         ctsConfigInitOnce();
-        try
+
+        // write even after shutdown so can print the final summaries
+        bool writeToConsole = false;
+        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
         {
-            PrintErrorInfo(ctString::ctConvertToWstring(e.what()).c_str());
+            // case 0: // nothing
+            case 1: // status updates
+            case 2: // error info
+            case 3: // connection info
+            case 4: // connection info + error info
+            case 5: // connection info + error info + status updates
+            case 6: // above + debug info
+            {
+                writeToConsole = true;
+            }
         }
-        catch (...)
+
+        va_list argptr;
+        va_start(argptr, text);
+        try
         {
-            const auto hr = wil::ResultFromCaughtException();
-            if (!g_shutdownCalled && g_breakOnError)
+            wstring formattedString;
+            if (writeToConsole)
             {
-                FAIL_FAST_MSG("Fatal exception: 0x%x", hr);
+                wil::details::str_vprintf_nothrow<std::wstring>(formattedString, text, argptr);
+                wprintf(L"%ws", formattedString.c_str());
             }
 
-            // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-            switch (g_consoleVerbosity) // NOLINT(hicpp-multiway-paths-covered)
+            if (g_connectionLogger && !g_connectionLogger->IsCsvFormat())
             {
-                // case 0: // nothing
-                // case 1: // status updates
-                case 2: // error info
-                // case 3: // connection info
-                case 4: // connection info + error info
-                case 5: // connection info + error info + status updates
-                case 6: // above + debug info
-                    wprintf(
-                        L"[%.3f] Exception thrown: %hs\n",
-                        GetStatusTimeStamp(),
-                        e.what());
+                if (formattedString.empty())
+                {
+                    wil::details::str_vprintf_nothrow<std::wstring>(formattedString, text, argptr);
+                }
+                g_connectionLogger->LogMessage(
+                    ctString::ctReplaceAllCopy(
+                        formattedString, L"\n", L"\r\n").c_str());
             }
         }
-    }
-    DWORD PrintThrownException() noexcept
-    {
-        try
-        {
-            throw;
-        }
-        catch (const wil::ResultException& e)
-        {
-            PrintException(e);
-            return Win32FromHresult(e.GetErrorCode());
-        }
-        catch (const std::exception& e)
-        {
-            PrintException(e);
-            return WSAENOBUFS;
-        }
         catch (...)
         {
-            FAIL_FAST();
         }
+        va_end(argptr);
     }
-    void PrintException(DWORD why, _In_ PCWSTR what, _In_ PCWSTR where) noexcept
-    {
+
+    void PrintLatencySummary() noexcept
         try
+    {
+        if (g_configSettings->LatencyPercentiles.empty())
         {
-            const auto translation = ctString::ctFormatMessage(why);
-            const auto formattedString = wil::str_printf<std::wstring>(
-                L"[exception] %ws%ws%ws%ws [%u / 0x%x - %ws]",
-                what ? L" " : L"",
-                what ? what : L"",
-                where ? L" at " : L"",
-                where ? where : L"",
-                why,
-                why,
-                !translation.empty() ? translation.c_str() : L"unknown error");
-            PrintErrorInfo(formattedString.c_str());
-        }
-        catch (...)
-        {
-            PrintErrorInfo(L"[exception] out of memory");
+            return;
         }
 
+        const auto formatPercentiles = [](const ctsLatencySnapshot& latencyData) {
+            wstring percentileString;
+            for (const auto percentile : g_configSettings->LatencyPercentiles)
+            {
+                percentileString.append(
+                    wil::str_printf<std::wstring>(
+                        L"p%g [%lld]  ",
+                        percentile,
+                        ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetPercentile(percentile))));
+            }
+            return percentileString;
+        };
+
+        const auto latencyData = g_configSettings->TcpStatusDetails.m_ioLatency.GetTotal();
+        PrintSummary(
+            L"  IO Latency (us) : %wsMax [%lld]  (%lld sends and recvs)\n",
+            formatPercentiles(latencyData).c_str(),
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetMaximum()),
+            latencyData.GetCount());
+
+        // only ConnectEx and AcceptEx connections are timed
+        const auto connectionLatencyData = g_configSettings->TcpStatusDetails.m_connectionLatency.GetTotal();
+        if (connectionLatencyData.GetCount() > 0)
+        {
+            PrintSummary(
+                L"  %ws Latency (us) : %wsMax [%lld]  (%lld connections)\n",
+                g_configSettings->ListenAddresses.empty() ? L"Connect" : L"Accept",
+                formatPercentiles(connectionLatencyData).c_str(),
+                ctsLatencySnapshot::ConvertTicksToMicroseconds(connectionLatencyData.GetMaximum()),
+                connectionLatencyData.GetCount());
+        }
+
+        // only clients using ConnectEx time their first byte
+        const auto firstByteLatencyData = g_configSettings->TcpStatusDetails.m_firstByteLatency.GetTotal();
+        if (firstByteLatencyData.GetCount() > 0)
+        {
+            PrintSummary(
+                L"  First Byte Latency (us) : %wsMax [%lld]  (%lld connections)\n",
+                formatPercentiles(firstByteLatencyData).c_str(),
+                ctsLatencySnapshot::ConvertTicksToMicroseconds(firstByteLatencyData.GetMaximum()),
+                firstByteLatencyData.GetCount());
+        }
+
+        // the hops from completing each state of a connection to running the next
+        const auto printTransitionLatency = [&formatPercentiles](PCWSTR transition, const ctsLatencySnapshot& latencyData) {
+            if (latencyData.GetCount() > 0)
+            {
+                PrintSummary(
+                    L"  %ws Transition Latency (us) : %wsMax [%lld]  (%lld transitions)\n",
+                    transition,
+                    formatPercentiles(latencyData).c_str(),
+                    ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetMaximum()),
+                    latencyData.GetCount());
+            }
+        };
+        const auto& transitionDetails = g_configSettings->StateTransitionDetails;
+        printTransitionLatency(L"Create", transitionDetails.m_createLatency.GetTotal());
+        printTransitionLatency(L"Connect", transitionDetails.m_connectLatency.GetTotal());
+        printTransitionLatency(L"InitiateIo", transitionDetails.m_initiateIoLatency.GetTotal());
+        printTransitionLatency(L"Close", transitionDetails.m_closeLatency.GetTotal());
     }
-    // Always print to console if override
-    void PrintErrorInfoOverride(_In_ PCWSTR text) noexcept try
+    catch (...)
     {
-        ctsConfigInitOnce();
+    }
 
-        if (g_breakOnError)
+    void PrintLatencyHistograms() noexcept
+        try
+    {
+        if (!g_histogramLogger)
         {
-            FAIL_FAST_MSG(ctString::ctConvertToString(text).c_str());
+            return;
         }
 
-        wprintf_s(L"%ws\n", text);
-        if (g_errorLogger)
-        {
-            g_errorLogger->LogError(
-                wil::str_printf<std::wstring>(
-                    L"[%.3f] %ws\r\n",
-                    GetStatusTimeStamp(), text).c_str());
-        }
+        // one line per non-zero bucket : histograms from different runs and machines merge by adding the counts of equal buckets
+        const auto logHistogram = [](PCWSTR name, const ctsLatencySnapshot& latencyData) {
+            for (unsigned long index = 0; index < ctsLatencySnapshot::c_bucketCount; ++index)
+            {
+                if (latencyData.m_counts[index] != 0)
+                {
+                    g_histogramLogger->LogMessage(
+                        wil::str_printf<std::wstring>(
+                            L"%ws,%lld,%lld\r\n",
+                            name,
+                            ctsLatencySnapshot::ConvertTicksToMicroseconds(ctsLatencySnapshot::BucketValue(index)),
+                            latencyData.m_counts[index]).c_str());
+                }
+            }
+        };
+
+        logHistogram(L"IO", g_configSettings->TcpStatusDetails.m_ioLatency.GetTotal());
+        logHistogram(g_configSettings->ListenAddresses.empty() ? L"Connect" : L"Accept", g_configSettings->TcpStatusDetails.m_connectionLatency.GetTotal());
+        logHistogram(L"FirstByte", g_configSettings->TcpStatusDetails.m_firstByteLatency.GetTotal());
+        logHistogram(L"Transaction", g_configSettings->TcpStatusDetails.m_transactionLatency.GetTotal());
+        logHistogram(L"Probe", g_configSettings->TcpStatusDetails.m_probeLatency.GetTotal());
+        logHistogram(L"CreateTransition", g_configSettings->StateTransitionDetails.m_createLatency.GetTotal());
+        logHistogram(L"ConnectTransition", g_configSettings->StateTransitionDetails.m_connectLatency.GetTotal());
+        logHistogram(L"InitiateIoTransition", g_configSettings->StateTransitionDetails.m_initiateIoLatency.GetTotal());
+        logHistogram(L"CloseTransition", g_configSettings->StateTransitionDetails.m_closeLatency.GetTotal());
     }
     catch (...)
     {
     }
 
-    void PrintErrorIfFailed(_In_ PCSTR what, unsigned long why) noexcept try
+    void PrintTargetSummary(long long totalTimeMilliseconds) noexcept
+        try
     {
-        ctsConfigInitOnce();
+        if (g_configSettings->TargetStatusDetails.empty())
+        {
+            return;
+        }
 
-        if (!g_shutdownCalled && why != 0)
+        PrintSummary(L"\n  Targets :\n");
+        WCHAR wsaddress[c_ipStringMaxLength]{};
+        for (size_t target = 0; target < g_configSettings->TargetStatusDetails.size(); ++target)
         {
-            if (g_breakOnError)
+            const auto& targetStatistics = *g_configSettings->TargetStatusDetails[target];
+            if (!g_configSettings->TargetAddresses[target].WriteCompleteAddress(wsaddress))
             {
-                FAIL_FAST_MSG("%hs failed (%u)\n", what, why);
+                wsaddress[0] = L'\0';
             }
+            const auto bytesSent = targetStatistics.m_bytesSent.GetValue();
+            const auto bytesRecv = targetStatistics.m_bytesRecv.GetValue();
+            PrintSummary(
+                L"  T%Iu %ws : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Successful[%lld]  NetworkErrors[%lld]  ProtocolErrors[%lld]\n",
+                target + 1,
+                wsaddress,
+                bytesSent,
+                totalTimeMilliseconds > 0 ? bytesSent * 1000LL / totalTimeMilliseconds : 0LL,
+                bytesRecv,
+                totalTimeMilliseconds > 0 ? bytesRecv * 1000LL / totalTimeMilliseconds : 0LL,
+                targetStatistics.m_successfulConnections.GetValue(),
+                targetStatistics.m_connectionErrors.GetValue(),
+                targetStatistics.m_protocolErrors.GetValue());
 
-            bool writeToConsole = false;
-            // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-            switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+            if (!g_configSettings->LatencyPercentiles.empty())
             {
-                // case 0: // nothing
-                // case 1: // status updates
-                case 2: // error info
-                    // case 3: // connection info
-                case 4: // connection info + error info
-                case 5: // connection info + error info + status updates
-                case 6: // above + debug info
+                const auto latencyData = targetStatistics.m_ioLatency.GetTotal();
+                wstring percentileString;
+                for (const auto percentile : g_configSettings->LatencyPercentiles)
                 {
-                    writeToConsole = true;
+                    percentileString.append(
+                        wil::str_printf<std::wstring>(
+                            L"p%g [%lld]  ",
+                            percentile,
+                            ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetPercentile(percentile))));
                 }
+                PrintSummary(
+                    L"     IO Latency (us) : %wsMax [%lld]  (%lld sends and recvs)\n",
+                    percentileString.c_str(),
+                    ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetMaximum()),
+                    latencyData.GetCount());
             }
+        }
+    }
+    catch (...)
+    {
+    }
 
-            wstring errorString;
-            if (ctsIoPattern::IsProtocolError(why))
-            {
-                errorString = wil::str_printf<std::wstring>(
-                    L"[%.3f] Connection aborted due to the protocol error %ws",
-                    GetStatusTimeStamp(),
-                    ctsIoPattern::BuildProtocolErrorString(why));
-            }
-            else
-            {
-                errorString = wil::str_printf<std::wstring>(
-                    L"[%.3f] %hs failed (%u) %ws",
-                    GetStatusTimeStamp(),
-                    what,
-                    why,
-                    ctString::ctFormatMessage(why).c_str());
-            }
+    void PrintTransactionSummary(long long totalTimeMilliseconds) noexcept
+        try
+    {
+        const bool heartbeat = g_configSettings->IoPattern == IoPatternType::Heartbeat;
+        if (g_configSettings->IoPattern != IoPatternType::RequestResponse && !heartbeat)
+        {
+            return;
+        }
 
-            if (writeToConsole)
-            {
-                fwprintf(stderr, L"%ws\n", errorString.c_str());
-            }
+        const auto transactions = g_configSettings->TcpStatusDetails.m_transactions.GetValue();
+        PrintSummary(
+            L"  Total %ws : %lld  (%lld per second)\n",
+            heartbeat ? L"Heartbeats" : L"Transactions",
+            transactions,
+            totalTimeMilliseconds > 0 ? transactions * 1000LL / totalTimeMilliseconds : 0LL);
 
-            if (g_errorLogger)
+        // round-trip latency is only measured by the client, which issues the requests
+        const auto latencyData = g_configSettings->TcpStatusDetails.m_transactionLatency.GetTotal();
+        if (latencyData.GetCount() > 0)
+        {
+            static constexpr double c_defaultPercentiles[]{ 50.0, 90.0, 99.0, 99.9 };
+            const std::vector<double> percentiles = g_configSettings->LatencyPercentiles.empty() ?
+                std::vector<double>(std::begin(c_defaultPercentiles), std::end(c_defaultPercentiles)) :
+                g_configSettings->LatencyPercentiles;
+
+            wstring percentileString;
+            for (const auto percentile : percentiles)
             {
-                g_errorLogger->LogError(
-                    wil::str_printf<std::wstring>(L"%ws\r\n", errorString.c_str()).c_str());
+                percentileString.append(
+                    wil::str_printf<std::wstring>(
+                        L"p%g [%lld]  ",
+                        percentile,
+                        ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetPercentile(percentile))));
+            }
+            PrintSummary(
+                L"  %ws Latency (us) : %wsMax [%lld]  (%lld %ws)\n",
+                heartbeat ? L"Heartbeat" : L"Transaction",
+                percentileString.c_str(),
+                ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetMaximum()),
+                latencyData.GetCount(),
+                heartbeat ? L"heartbeats" : L"transactions");
+        }
+
+        // the cost of holding the connections: CPU time is compared against the peak connection count
+        if (heartbeat)
+        {
+            PROCESS_MEMORY_COUNTERS_EX memoryCounters{};
+            memoryCounters.cb = sizeof memoryCounters;
+            FILETIME creationTime{};
+            FILETIME exitTime{};
+            FILETIME kernelTime{};
+            FILETIME userTime{};
+            if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof memoryCounters) &&
+                GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+            {
+                const auto peakConnections = std::max<long long>(1, g_configSettings->ConnectionStatusDetails.m_peakActiveConnectionCount.GetValue());
+                // FILETIME durations are in 100ns units
+                const auto cpuMicroseconds = (wil::filetime::to_int64(kernelTime) + wil::filetime::to_int64(userTime)) / 10LL;
+                PrintSummary(
+                    L"  Per Connection (%lld peak connections) : Peak Working Set [%llu bytes]  Committed [%llu bytes]  CPU [%lld us]\n",
+                    peakConnections,
+                    static_cast<unsigned long long>(memoryCounters.PeakWorkingSetSize) / peakConnections,
+                    static_cast<unsigned long long>(memoryCounters.PrivateUsage) / peakConnections,
+                    cpuMicroseconds / peakConnections);
             }
         }
     }
@@ -3054,649 +9080,1133 @@ namespace ctsTraffic::ctsConfig
     {
     }
 
-    void PrintStatusUpdate() noexcept
+    static const wchar_t* GetIoPatternName() noexcept
     {
-        if (!g_shutdownCalled)
+        switch (g_configSettings->IoPattern)
         {
-            if (g_printStatusInformation)
-            {
-                bool writeToConsole = false;
-                // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-                switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
-                {
-                    // case 0: // nothing
-                    case 1: // status updates
-                        // case 2: // error info
-                        // case 3: // connection info
-                        // case 4: // connection info + error info
-                    case 5: // connection info + error info + status updates
-                    case 6: // above + debug info
-                    {
-                        writeToConsole = true;
-                    }
-                }
-
-                const auto lock = g_statusUpdateLock.try_lock();
-                if (lock)
-                {
-                    // capture the timeslices
-                    const ctsSignedLongLong lPrevioutimeslice = g_previousPrintTimeslice;
-                    const ctsSignedLongLong lCurrentTimeslice = ctTimer::SnapQpcInMillis() - g_configSettings->StartTimeMilliseconds;
-
-                    if (lCurrentTimeslice > lPrevioutimeslice)
-                    {
-                        // write out the header to the console every 40 updates 
-                        if (writeToConsole)
-                        {
-                            if (g_printTimesliceCount != 0 && 0 == g_printTimesliceCount % 40)
-                            {
-                                PCWSTR const header = g_printStatusInformation->PrintHeader(StatusFormatting::ConsoleOutput);
-                                if (header != nullptr)
-                                {
-                                    fwprintf(stdout, L"%ws", header);
-                                }
-                            }
-                        }
-
-                        // need to indicate either print_status() or LogStatus() to reset the status info,
-                        // - the data *must* be reset once and *only once* in this function
-
-                        int statusCount = 0;
-                        if (writeToConsole)
-                        {
-                            ++statusCount;
-                        }
-                        if (g_statusLogger)
-                        {
-                            ++statusCount;
-                        }
+            case IoPatternType::Pull:
+                return L"Pull";
+            case IoPatternType::Push:
+                return L"Push";
+            case IoPatternType::PushPull:
+                return L"PushPull";
+            case IoPatternType::Duplex:
+                return L"Duplex";
+            case IoPatternType::MediaStream:
+                return g_configSettings->UdpBlast ? L"Blast" : L"MediaStream";
+            case IoPatternType::RequestResponse:
+                return L"RequestResponse";
+            case IoPatternType::Heartbeat:
+                return L"Heartbeat";
+            case IoPatternType::NoIoSet: // fall-through
+            default:
+                return L"";
+        }
+    }
 
-                        if (writeToConsole)
-                        {
-                            --statusCount;
-                            const bool clearStatus = 0 == statusCount;
-                            PCWSTR const printString = g_printStatusInformation->PrintStatus(
-                                StatusFormatting::ConsoleOutput,
-                                lCurrentTimeslice,
-                                clearStatus);
-                            if (printString != nullptr)
-                            {
-                                fwprintf(stdout, L"%ws", printString);
-                            }
-                        }
+    void PrintInlineCompletionSummary() noexcept
+        try
+    {
+        if (0 == g_configSettings->InlineCompletionBudget && 0 == g_configSettings->InlineCompletionBudgetMicroseconds)
+        {
+            return;
+        }
 
-                        if (g_statusLogger)
-                        {
-                            --statusCount;
-                            const bool clearStatus = 0 == statusCount;
-                            g_statusLogger->LogStatus(
-                                g_printStatusInformation,
-                                lCurrentTimeslice,
-                                clearStatus);
-                        }
+        const auto inlineCompletions = g_configSettings->TcpStatusDetails.m_inlineCompletions.GetValue();
+        const auto inlineYields = g_configSettings->TcpStatusDetails.m_inlineYields.GetValue();
+        const auto ioCompletions = g_configSettings->TcpStatusDetails.m_ioCompletions.GetValue();
+        PrintSummary(
+            L"\n"
+            L"  Inline Completions : %lld (%f of all sends and recvs)\n"
+            L"  Inline Budget Yields : %lld (%f inline completions per yield)\n",
+            inlineCompletions,
+            ioCompletions > 0 ? static_cast<double>(inlineCompletions) / static_cast<double>(ioCompletions) * 100.0 : 0.0,
+            inlineYields,
+            inlineYields > 0 ? static_cast<double>(inlineCompletions) / static_cast<double>(inlineYields) : 0.0);
+    }
+    catch (...)
+    {
+    }
 
-                        // update tracking values
-                        g_previousPrintTimeslice = lCurrentTimeslice;
-                        ++g_printTimesliceCount;
-                    }
-                }
-            }
+    void PrintStateTransitionSummary(long long totalTimeMilliseconds) noexcept
+        try
+    {
+        if (!g_configSettings->InlineStateTransitions && g_configSettings->LatencyPercentiles.empty())
+        {
+            return;
         }
+
+        const auto inlineTransitions = g_configSettings->StateTransitionDetails.m_inlineTransitions.GetValue();
+        const auto queuedTransitions = g_configSettings->StateTransitionDetails.m_queuedTransitions.GetValue();
+        const auto allTransitions = inlineTransitions + queuedTransitions;
+        // compare the connections per second of runs with and without -InlineStateTransitions
+        const auto connections =
+            g_configSettings->ConnectionStatusDetails.m_successfulCompletionCount.GetValue() +
+            g_configSettings->ConnectionStatusDetails.m_connectionErrorCount.GetValue() +
+            g_configSettings->ConnectionStatusDetails.m_protocolErrorCount.GetValue();
+        PrintSummary(
+            L"\n"
+            L"  State Transitions : %lld inline, %lld queued to the threadpool (%f inline)\n"
+            L"  Connections Completed : %lld (%.2f connections/sec)\n",
+            inlineTransitions,
+            queuedTransitions,
+            allTransitions > 0 ? static_cast<double>(inlineTransitions) / static_cast<double>(allTransitions) * 100.0 : 0.0,
+            connections,
+            totalTimeMilliseconds > 0 ? static_cast<double>(connections) * 1000.0 / static_cast<double>(totalTimeMilliseconds) : 0.0);
+    }
+    catch (...)
+    {
     }
 
-    void PrintJitterUpdate(const JitterFrameEntry& currentFrame, const JitterFrameEntry& previousFrame) noexcept
+    void PrintMessageSummary(long long totalTimeMilliseconds) noexcept
+        try
     {
-        if (!g_shutdownCalled)
+        if (0 == g_configSettings->MessageSize)
         {
-            if (g_jitterLogger)
-            {
-                const auto jitter = std::abs(previousFrame.m_estimatedTimeInFlightMs - currentFrame.m_estimatedTimeInFlightMs);
-                // long long ~= up to 20 characters long, 10 for each float, plus 10 for commas & CR
-                constexpr size_t formattedTextLength = 20 * 5 + 10 * 2 + 10;
-                wchar_t formattedText[formattedTextLength]{};
-                const auto converted = _snwprintf_s(
-                    formattedText,
-                    formattedTextLength,
-                    L"%lld,%lld,%lld,%lld,%lld,%.3f,%.3f\r\n",
-                    currentFrame.m_sequenceNumber, currentFrame.m_senderQpc, currentFrame.m_senderQpf, currentFrame.m_receiverQpc, currentFrame.m_receiverQpf, currentFrame.m_estimatedTimeInFlightMs, jitter);
-                FAIL_FAST_IF(-1 == converted);
-                g_jitterLogger->LogMessage(formattedText);
+            return;
+        }
+
+        const auto perSecond = [&](long long value) noexcept {
+            return totalTimeMilliseconds > 0 ? static_cast<double>(value) * 1000.0 / static_cast<double>(totalTimeMilliseconds) : 0.0;
+        };
+        const auto ratio = [](long long numerator, long long denominator) noexcept {
+            return denominator > 0 ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+        };
+
+        // every send (one WSASend call) is posted as a single message
+        // - each recv completing more than one message shows the sends were coalesced by the sender (Nagle) or the receiver
+        const auto messagesSent = g_configSettings->TcpStatusDetails.m_messagesSent.GetValue();
+        const auto messagesRecv = g_configSettings->TcpStatusDetails.m_messagesRecv.GetValue();
+        const auto messageSends = g_configSettings->TcpStatusDetails.m_messageSends.GetValue();
+        const auto messageRecvs = g_configSettings->TcpStatusDetails.m_messageRecvs.GetValue();
+        const auto splitRecvs = g_configSettings->TcpStatusDetails.m_splitMessageRecvs.GetValue();
+        PrintSummary(
+            L"\n"
+            L"  Messages (%lu bytes) : %lld sent (%.2f messages/sec), %lld received (%.2f messages/sec)\n"
+            L"  Calls per Message : %.3f sends, %.3f recvs\n"
+            L"  Coalescing : %.2f messages per recv, %lld recvs (%f) ended part way through a message\n",
+            g_configSettings->MessageSize,
+            messagesSent,
+            perSecond(messagesSent),
+            messagesRecv,
+            perSecond(messagesRecv),
+            ratio(messageSends, messagesSent),
+            ratio(messageRecvs, messagesRecv),
+            ratio(messagesRecv, messageRecvs),
+            splitRecvs,
+            ratio(splitRecvs, messageRecvs) * 100.0);
+
+        if (g_configSettings->TcpInfoIntervalMilliseconds > 0)
+        {
+            // the most messages a full-sized segment can carry when the sends are coalesced
+            const auto tcpInfo = g_configSettings->TcpStatusDetails.GetTcpInfo();
+            if (tcpInfo.m_mss.m_maximum > 0)
+            {
+                PrintSummary(
+                    L"  Segment Size : %lu bytes (up to %.2f messages per segment)\n",
+                    tcpInfo.m_mss.m_maximum,
+                    static_cast<double>(tcpInfo.m_mss.m_maximum) / static_cast<double>(g_configSettings->MessageSize));
             }
         }
     }
+    catch (...)
+    {
+    }
 
-    void PrintNewConnection(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr) noexcept
+    void PrintPersistentTransferSummary() noexcept
         try
     {
-        ctsConfigInitOnce();
+        if (g_configSettings->PersistentTransfers <= 1)
+        {
+            return;
+        }
 
-        // write even after shutdown so can print the final summaries
-        bool writeToConsole = false;
-        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        const auto& statusDetails = g_configSettings->TcpStatusDetails;
+        const auto printTransfers = [](PCWSTR name, long long transfers, long long bytes, long long microseconds) {
+            PrintSummary(
+                L"  %ws Transfers : %lld (%.3f ms avg, %.2f Bps)\n",
+                name,
+                transfers,
+                transfers > 0 ? static_cast<double>(microseconds) / static_cast<double>(transfers) / 1000.0 : 0.0,
+                microseconds > 0 ? static_cast<double>(bytes) * 1000000.0 / static_cast<double>(microseconds) : 0.0);
+        };
+
+        // the first transfer over each connection starts from the initial congestion window
+        PrintSummary(L"\n");
+        printTransfers(
+            L"Cold",
+            statusDetails.m_coldTransfers.GetValue(),
+            statusDetails.m_coldTransferBytes.GetValue(),
+            statusDetails.m_coldTransferMicroseconds.GetValue());
+        printTransfers(
+            L"Warm",
+            statusDetails.m_warmTransfers.GetValue(),
+            statusDetails.m_warmTransferBytes.GetValue(),
+            statusDetails.m_warmTransferMicroseconds.GetValue());
+    }
+    catch (...)
+    {
+    }
+
+    void PrintProbeSummary() noexcept
+        try
+    {
+        // round-trip latency is only measured by the client, which sends the pings
+        if (0 == g_configSettings->ProbeConnections || IsListening())
         {
-            // case 0: // nothing
-            // case 1: // status updates
-            // case 2: // error info
-            case 3: // connection info
-            case 4: // connection info + error info
-            case 5: // connection info + error info + status updates
-            case 6: // above + debug info
-            {
-                writeToConsole = true;
-            }
+            return;
         }
 
-        if (writeToConsole)
+        const auto latencyData = g_configSettings->TcpStatusDetails.m_probeLatency.GetTotal();
+        if (0 == latencyData.GetCount())
         {
-            wprintf_s(
-                ProtocolType::TCP == g_configSettings->Protocol ?
-                L"[%.3f] TCP connection established [%ws - %ws]\n" :
-                L"[%.3f] UDP connection established [%ws - %ws]\n",
-                GetStatusTimeStamp(),
-                localAddr.WriteCompleteAddress().c_str(),
-                remoteAddr.WriteCompleteAddress().c_str());
+            return;
         }
 
-        if (g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+        static constexpr double c_defaultPercentiles[]{ 50.0, 90.0, 99.0, 99.9 };
+        const std::vector<double> percentiles = g_configSettings->LatencyPercentiles.empty() ?
+            std::vector<double>(std::begin(c_defaultPercentiles), std::end(c_defaultPercentiles)) :
+            g_configSettings->LatencyPercentiles;
+
+        wstring percentileString;
+        for (const auto percentile : percentiles)
         {
-            g_connectionLogger->LogMessage(
+            percentileString.append(
                 wil::str_printf<std::wstring>(
-                    ProtocolType::TCP == g_configSettings->Protocol ?
-                    L"[%.3f] TCP connection established [%ws - %ws]\r\n" :
-                    L"[%.3f] UDP connection established [%ws - %ws]\r\n",
-                    GetStatusTimeStamp(),
-                    localAddr.WriteCompleteAddress().c_str(),
-                    remoteAddr.WriteCompleteAddress().c_str()).c_str());
-        }
+                    L"p%g [%lld]  ",
+                    percentile,
+                    ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetPercentile(percentile))));
+        }
+        // the minimum is the closest to the unloaded round trip : the percentiles above it are queueing delay
+        PrintSummary(
+            L"  Probe Latency (us) : Min [%lld]  %wsMax [%lld]  (%lld pings)\n",
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetPercentile(0.0)),
+            percentileString.c_str(),
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetMaximum()),
+            latencyData.GetCount());
     }
     catch (...)
     {
     }
 
-    void PrintConnectionResults(unsigned long error) noexcept
+    void PrintBlastSummary() noexcept
         try
     {
-        ctsConfigInitOnce();
+        if (!g_configSettings->UdpBlast)
+        {
+            return;
+        }
 
-        // write even after shutdown so can print the final summaries
-        bool writeToConsole = false;
-        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        const auto& udpDetails = g_configSettings->UdpStatusDetails;
+        const auto elapsedMilliseconds = ctTimer::SnapQpcInMillis() - g_configSettings->StartTimeMilliseconds;
+        const auto perSecond = [elapsedMilliseconds](long long datagrams) noexcept {
+            return elapsedMilliseconds > 0 ? static_cast<double>(datagrams) * 1000.0 / static_cast<double>(elapsedMilliseconds) : 0.0;
+        };
+
+        if (IsListening())
         {
-            // case 0: // nothing
-            // case 1: // status updates
-            // case 2: // error info
-            case 3: // connection info
-            case 4: // connection info + error info
-            case 5: // connection info + error info + status updates
-            case 6: // above + debug info
-            {
-                writeToConsole = true;
-            }
+            const auto datagramsSent = udpDetails.m_blastDatagramsSent.GetValue();
+            PrintSummary(
+                L"\n"
+                L"  Blast : %lld datagrams sent (%.1f datagrams/sec)\n",
+                datagramsSent,
+                perSecond(datagramsSent));
+        }
+        else
+        {
+            const auto datagramsReceived = udpDetails.m_blastDatagramsReceived.GetValue();
+            const auto datagramsExpected = udpDetails.m_blastDatagramsExpected.GetValue();
+            const auto datagramsLost = datagramsExpected > datagramsReceived ? datagramsExpected - datagramsReceived : 0LL;
+            PrintSummary(
+                L"\n"
+                L"  Blast : %lld datagrams received (%.1f datagrams/sec)\n"
+                L"  Blast : %lld datagrams lost (%f%% of %lld sent), %lld reordered, %lld duplicated\n",
+                datagramsReceived,
+                perSecond(datagramsReceived),
+                datagramsLost,
+                datagramsExpected > 0 ? static_cast<double>(datagramsLost) / static_cast<double>(datagramsExpected) * 100.0 : 0.0,
+                datagramsExpected,
+                udpDetails.m_blastDatagramsReordered.GetValue(),
+                udpDetails.m_duplicateFrames.GetValue());
         }
+    }
+    catch (...)
+    {
+    }
 
-        enum class ErrorType
+    void PrintMemorySummary() noexcept
+        try
+    {
+        if (!g_configSettings->AccountConnectionMemory)
         {
-            Success,
-            NetworkError,
-            ProtocolError
-        } errorType = ErrorType::Success;
+            return;
+        }
 
-        if (0 == error)
+        auto& memoryDetails = g_configSettings->ConnectionMemoryDetails;
+        const auto connections = memoryDetails.m_accountedConnections.GetValue();
+        // the run usually ends before the next status update : take a final sample
+        SampleProcessMemory(ctTimer::SnapQpcInMillis() - g_configSettings->StartTimeMilliseconds);
+
+        PrintSummary(
+            L"\n"
+            L"  Memory per connection (%ws, %ws) over %lld connections : %lld bytes\n"
+            L"    Socket [%lld]  Pattern [%lld]  Recv Buffers [%lld]  Send Buffers [%lld]  RIO Registered [%lld]  Tasks [%lld]  Timers [%lld]  ThreadIocp [%lld]\n"
+            L"  Process : Peak Private Bytes [%lld]  Peak NonPaged Pool [%lld]  (%lld bytes per peak connection)\n",
+            g_ioFunctionName,
+            GetIoPatternName(),
+            connections,
+            memoryDetails.GetBytesPerConnection(),
+            connections > 0 ? memoryDetails.m_socketBytes.GetValue() / connections : 0LL,
+            connections > 0 ? memoryDetails.m_patternBytes.GetValue() / connections : 0LL,
+            connections > 0 ? memoryDetails.m_recvBufferBytes.GetValue() / connections : 0LL,
+            connections > 0 ? memoryDetails.m_sendBufferBytes.GetValue() / connections : 0LL,
+            connections > 0 ? memoryDetails.m_rioRegisteredBytes.GetValue() / connections : 0LL,
+            connections > 0 ? memoryDetails.m_taskBytes.GetValue() / connections : 0LL,
+            connections > 0 ? memoryDetails.m_timerBytes.GetValue() / connections : 0LL,
+            connections > 0 ? memoryDetails.m_threadIocpBytes.GetValue() / connections : 0LL,
+            memoryDetails.m_peakPrivateBytes.GetValue(),
+            memoryDetails.m_peakNonPagedPoolBytes.GetValue(),
+            memoryDetails.m_peakPrivateBytes.GetValue() / std::max<long long>(1, g_configSettings->ConnectionStatusDetails.m_peakActiveConnectionCount.GetValue()));
+    }
+    catch (...)
+    {
+    }
+
+    void PrintConnectionThrottleSummary() noexcept
+        try
+    {
+        if (!g_configSettings->AdaptiveConnectionThrottle)
         {
-            errorType = ErrorType::Success;
+            return;
         }
-        else if (ctsIoPattern::IsProtocolError(error))
+
+        PrintSummary(
+            L"  Sustained Connection Rate : %.1f connections/sec  (with %lu pended connection attempts)\n",
+            g_configSettings->SustainedConnectionRate,
+            g_configSettings->SustainedConnectionThrottleLimit);
+    }
+    catch (...)
+    {
+    }
+
+    void PrintTcpInfoSummary() noexcept
+        try
+    {
+        if (0 == g_configSettings->TcpInfoIntervalMilliseconds)
         {
-            errorType = ErrorType::ProtocolError;
+            return;
         }
-        else
+
+        const auto tcpInfo = g_configSettings->TcpStatusDetails.GetTcpInfo();
+        PrintSummary(
+            L"  TCP_INFO (%llu samples)\n"
+            L"    RTT (us) : Min [%lu]  Avg [%llu]  Max [%lu]\n"
+            L"    Congestion Window (bytes) : Min [%lu]  Avg [%llu]  Max [%lu]\n"
+            L"    Bytes In Flight : Min [%lu]  Avg [%llu]  Max [%lu]\n"
+            L"    MSS (bytes) : Min [%lu]  Max [%lu]\n"
+            L"    Bytes Retransmitted [%llu]  Fast Retransmits [%llu]  Timeout Episodes [%llu]\n",
+            tcpInfo.m_sampleCount,
+            tcpInfo.m_rttMicroseconds.GetMinimum(),
+            tcpInfo.m_rttMicroseconds.GetAverage(tcpInfo.m_sampleCount),
+            tcpInfo.m_rttMicroseconds.m_maximum,
+            tcpInfo.m_congestionWindow.GetMinimum(),
+            tcpInfo.m_congestionWindow.GetAverage(tcpInfo.m_sampleCount),
+            tcpInfo.m_congestionWindow.m_maximum,
+            tcpInfo.m_bytesInFlight.GetMinimum(),
+            tcpInfo.m_bytesInFlight.GetAverage(tcpInfo.m_sampleCount),
+            tcpInfo.m_bytesInFlight.m_maximum,
+            tcpInfo.m_mss.GetMinimum(),
+            tcpInfo.m_mss.m_maximum,
+            tcpInfo.m_bytesRetransmitted,
+            tcpInfo.m_fastRetransmits,
+            tcpInfo.m_timeoutEpisodes);
+    }
+    catch (...)
+    {
+    }
+
+    static void SnapSteadyState(SteadyStateSnapshot& snapshot) noexcept
+    {
+        snapshot.m_timeMilliseconds = ctTimer::SnapQpcInMillis();
+        snapshot.m_bytesSent = g_configSettings->TcpStatusDetails.m_bytesSent.GetValue();
+        snapshot.m_bytesRecv = ProtocolType::TCP == g_configSettings->Protocol ?
+            g_configSettings->TcpStatusDetails.m_bytesRecv.GetValue() :
+            g_configSettings->UdpStatusDetails.m_bitsReceived.GetValue() / 8;
+        snapshot.m_transactions = g_configSettings->TcpStatusDetails.m_transactions.GetValue();
+        snapshot.m_successfulFrames = g_configSettings->UdpStatusDetails.m_successfulFrames.GetValue();
+        snapshot.m_droppedFrames = g_configSettings->UdpStatusDetails.m_droppedFrames.GetValue();
+        snapshot.m_successfulConnections = g_configSettings->ConnectionStatusDetails.m_successfulCompletionCount.GetValue();
+        snapshot.m_connectionErrors = g_configSettings->ConnectionStatusDetails.m_connectionErrorCount.GetValue();
+        snapshot.m_protocolErrors = g_configSettings->ConnectionStatusDetails.m_protocolErrorCount.GetValue();
+        snapshot.m_ioLatency = g_configSettings->TcpStatusDetails.m_ioLatency.GetTotal();
+        snapshot.m_transactionLatency = g_configSettings->TcpStatusDetails.m_transactionLatency.GetTotal();
+        snapshot.m_taken = true;
+    }
+
+    void SnapSteadyStateStart() noexcept
+    {
+        SnapSteadyState(g_steadyStateStart);
+    }
+
+    void SnapSteadyStateEnd() noexcept
+    {
+        SnapSteadyState(g_steadyStateEnd);
+    }
+
+    static long long EvaluateLoadProfileValue(const LoadProfileValue& value, long long offsetMilliseconds, long long durationMilliseconds) noexcept
+    {
+        if (value.m_periodMilliseconds > 0)
         {
-            errorType = ErrorType::NetworkError;
+            return 0 == offsetMilliseconds / (value.m_periodMilliseconds / 2) % 2 ? value.m_from : value.m_to;
+        }
+        if (value.m_ramp)
+        {
+            // a double as bytes/second times milliseconds can overflow a long long
+            return value.m_from + static_cast<long long>(
+                static_cast<double>(value.m_to - value.m_from) * static_cast<double>(offsetMilliseconds) / static_cast<double>(durationMilliseconds));
         }
+        return value.m_from;
+    }
 
-        static PCWSTR tcpNetworkFailureResultTextFormat = L"[%.3f] TCP connection failed with the error %ws : [%ws - %ws] [%hs] : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
-        // csv format : L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId"
-        static PCWSTR tcpResultCsvFormat = L"%.3f,%ws,%ws,%lld,%lld,%lld,%lld,%lld,%ws,%hs\r\n";
+    ctsLoadProfileSetpoint UpdateLoadProfile() noexcept
+    {
+        ctsConfigInitOnce();
 
-        const float currentTime = GetStatusTimeStamp();
+        ctsLoadProfileSetpoint setpoint;
+        if (!g_configSettings->LoadProfile)
+        {
+            return setpoint;
+        }
 
-        wstring csvString;
-        wstring textString;
-        wstring errorString;
-        if (ErrorType::ProtocolError != errorType)
+        // once past the end of the profile, the end of the last segment is held
+        auto offsetMilliseconds = ctTimer::SnapQpcInMillis() - g_configSettings->StartTimeMilliseconds;
+        const LoadProfileSegment* currentSegment = nullptr;
+        for (const auto& segment : g_loadProfile)
         {
-            if (0 == error)
-            {
-                errorString = L"Succeeded";
-            }
-            else
+            if (offsetMilliseconds < segment.m_durationMilliseconds)
             {
-                errorString = wil::str_printf<std::wstring>(
-                    L"%lu: %ws",
-                    error,
-                    ctString::ctFormatMessage(error).c_str());
-                // remove any commas from the formatted string - since that will mess up csv files
-                ctString::ctReplaceAll(errorString, L",", L" ");
+                currentSegment = &segment;
+                break;
             }
+            offsetMilliseconds -= segment.m_durationMilliseconds;
+        }
+        if (nullptr == currentSegment)
+        {
+            currentSegment = &g_loadProfile.back();
+            offsetMilliseconds = currentSegment->m_durationMilliseconds;
         }
 
-        if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
+        setpoint.m_connections = static_cast<unsigned long>(
+            EvaluateLoadProfileValue(currentSegment->m_connections, offsetMilliseconds, currentSegment->m_durationMilliseconds));
+        setpoint.m_bytesPerSecond = EvaluateLoadProfileValue(currentSegment->m_bytesPerSecond, offsetMilliseconds, currentSegment->m_durationMilliseconds);
+        if (setpoint.m_bytesPerSecond > 0)
         {
-            csvString = wil::str_printf<std::wstring>(
-                tcpResultCsvFormat,
-                currentTime,
-                ctSockaddr().WriteCompleteAddress().c_str(),
-                ctSockaddr().WriteCompleteAddress().c_str(),
-                0LL,
-                0LL,
-                0LL,
-                0LL,
-                0LL,
-                errorString.c_str(),
-                L"");
+            // every period must send at least 1 byte : a smaller rate would be unlimited
+            const auto minimumBytesPerSecond = (1000LL + g_configSettings->TcpBytesPerSecondPeriod - 1) / g_configSettings->TcpBytesPerSecondPeriod;
+            setpoint.m_bytesPerSecond = std::max<long long>(setpoint.m_bytesPerSecond, minimumBytesPerSecond);
         }
-        // we'll never write csv format to the console so we'll need a text string in that case
-        // - and/or in the case the s_ConnectionLogger isn't writing to csv
-        if (writeToConsole || g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+
+        ctMemoryGuardWrite(&g_loadProfileConnections, setpoint.m_connections);
+        ctMemoryGuardWrite(&g_loadProfileBytesPerSecond, setpoint.m_bytesPerSecond);
+        return setpoint;
+    }
+
+    ctsLoadProfileSetpoint GetLoadProfileSetpoint() noexcept
+    {
+        ctsLoadProfileSetpoint setpoint;
+        setpoint.m_connections = static_cast<unsigned long>(ctMemoryGuardRead(&g_loadProfileConnections));
+        setpoint.m_bytesPerSecond = ctMemoryGuardRead(&g_loadProfileBytesPerSecond);
+        return setpoint;
+    }
+
+    ctsHostCounterSample GetHostCounterSample() noexcept
+    {
+        // only read while formatting the status update which sampled it
+        return g_hostCounters ? g_hostCounters->GetSample() : ctsHostCounterSample{};
+    }
+
+    void RateSearchUpdate() noexcept
+        try
+    {
+        if (g_rateSearchComplete)
         {
-            textString = wil::str_printf<std::wstring>(
-                tcpNetworkFailureResultTextFormat,
-                currentTime,
-                errorString.c_str(),
-                ctSockaddr().WriteCompleteAddress().c_str(),
-                ctSockaddr().WriteCompleteAddress().c_str(),
-                L"",
-                0LL,
-                0LL,
-                0LL,
-                0LL,
-                0LL);
+            return;
+        }
+
+        ++g_rateSearchTicks;
+        if (1 == g_rateSearchTicks)
+        {
+            // connections have settled at the rate of this step
+            SnapSteadyState(g_rateSearchStepStart);
+            return;
+        }
+        if (g_rateSearchTicks < c_rateSearchTicksPerStep)
+        {
+            return;
         }
+        g_rateSearchTicks = 0;
+        ++g_rateSearchSteps;
 
-        if (writeToConsole)
+        SteadyStateSnapshot stepEnd;
+        SnapSteadyState(stepEnd);
+        const auto rate = ctMemoryGuardRead(&g_rateSearchBytesPerSecond);
+        const auto elapsedMs = stepEnd.m_timeMilliseconds - g_rateSearchStepStart.m_timeMilliseconds;
+        const auto errors = stepEnd.m_connectionErrors + stepEnd.m_protocolErrors - g_rateSearchStepStart.m_connectionErrors - g_rateSearchStepStart.m_protocolErrors;
+        const auto activeConnections = g_configSettings->ConnectionStatusDetails.m_activeConnectionCount.GetValue();
+        const auto achieved = elapsedMs > 0 ?
+            static_cast<double>(stepEnd.m_bytesSent - g_rateSearchStepStart.m_bytesSent) * 1000.0 / static_cast<double>(elapsedMs) :
+            0.0;
+        const auto expected = static_cast<double>(rate) * static_cast<double>(activeConnections);
+
+        long long latency = 0;
+        if (!g_configSettings->LatencyPercentiles.empty())
         {
-            // text strings always go to the console
-            wprintf(L"%ws\n", textString.c_str());
+            auto stepLatency = stepEnd.m_ioLatency;
+            stepLatency.Subtract(g_rateSearchStepStart.m_ioLatency);
+            latency = ctsLatencySnapshot::ConvertTicksToMicroseconds(stepLatency.GetPercentile(g_configSettings->LatencyPercentiles.back()));
         }
 
-        if (g_connectionLogger)
+        PCWSTR reason = nullptr;
+        if (errors > 0)
         {
-            if (g_connectionLogger->IsCsvFormat())
+            reason = L"connections failed";
+        }
+        else if (0 == activeConnections || achieved < c_rateSearchMinimumAchievedRatio * expected)
+        {
+            reason = L"the rate was not achieved";
+        }
+        else if (g_rateSearchLowestLatency > 0 && static_cast<double>(latency) > c_rateSearchMaxLatencyRatio * static_cast<double>(g_rateSearchLowestLatency))
+        {
+            reason = L"latency rose";
+        }
+
+        if (nullptr == reason)
+        {
+            g_rateSearchStableRate = rate;
+            g_rateSearchStableThroughput = achieved;
+            if (latency > 0 && (0 == g_rateSearchLowestLatency || latency < g_rateSearchLowestLatency))
             {
-                g_connectionLogger->LogMessage(csvString.c_str());
+                g_rateSearchLowestLatency = latency;
             }
-            else
+        }
+        else
+        {
+            g_rateSearchUnstableRate = rate;
+        }
+
+        PrintSummary(
+            L"  Rate Search step %lu : %lld bytes/sec per connection : %ws  (sent %.0f of %.0f bytes/sec, %lld errors, latency %lld us)\n",
+            g_rateSearchSteps,
+            rate,
+            nullptr == reason ? L"stable" : reason,
+            achieved,
+            expected,
+            errors,
+            latency);
+
+        // the next rate is the middle of the range still in question
+        const auto searchLow = g_rateSearchStableRate > 0 ? g_rateSearchStableRate : g_rateLimitLow;
+        const auto searchHigh = g_rateSearchUnstableRate > 0 ? g_rateSearchUnstableRate : g_rateLimitHigh;
+        const auto nextRate = searchLow + (searchHigh - searchLow) / 2;
+        if (g_rateSearchSteps >= c_rateSearchMaxSteps ||
+            static_cast<double>(searchHigh - searchLow) <= c_rateSearchResolution * static_cast<double>(searchHigh) ||
+            nextRate == rate)
+        {
+            g_rateSearchComplete = true;
+            // ends the run as if the time limit was reached
+            if (!SetEvent(g_configSettings->CtrlCHandle))
             {
-                g_connectionLogger->LogMessage(
-                    wil::str_printf<std::wstring>(L"%ws\r\n", textString.c_str()).c_str());
+                FAIL_FAST_MSG("SetEvent(%p) failed [%u] when trying to end the -RateSearch run", g_configSettings->CtrlCHandle, GetLastError());
             }
+            return;
         }
+        ctMemoryGuardWrite(&g_rateSearchBytesPerSecond, nextRate);
     }
     catch (...)
     {
     }
 
-    void PrintConnectionResults(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsTcpStatistics& stats) noexcept
+    // moves the connections to the next point of the grid, ending the run after the last
+    static void AdvanceSweep() noexcept
+    {
+        ++g_sweepCurrentPoint;
+        g_sweepTicks = 0;
+        g_sweepWaitTicks = 0;
+        if (g_sweepCurrentPoint == g_sweepPoints.size())
+        {
+            g_sweepComplete = true;
+            // ends the run as if the time limit was reached
+            if (!SetEvent(g_configSettings->CtrlCHandle))
+            {
+                FAIL_FAST_MSG("SetEvent(%p) failed [%u] when trying to end the -Sweep run", g_configSettings->CtrlCHandle, GetLastError());
+            }
+            return;
+        }
+        ApplySweepPoint(g_sweepCurrentPoint);
+    }
+
+    void SweepUpdate() noexcept
         try
     {
-        ctsConfigInitOnce();
+        if (g_sweepComplete)
+        {
+            return;
+        }
 
-        // write even after shutdown so can print the final summaries
-        bool writeToConsole = false;
-        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        auto& point = g_sweepPoints[g_sweepCurrentPoint];
+        if (0 == g_sweepTicks && g_sweepCurrentPoint > 0 && SweepPointChangesNewConnections(g_sweepCurrentPoint))
         {
-            // case 0: // nothing
-            // case 1: // status updates
-            // case 2: // error info
-            case 3: // connection info
-            case 4: // connection info + error info
-            case 5: // connection info + error info + status updates
-            case 6: // above + debug info
+            // the point is only measured once no connection created with the values of a prior point remains
+            long priorConnections = 0;
+            for (size_t priorPoint = 0; priorPoint < g_sweepCurrentPoint; ++priorPoint)
             {
-                writeToConsole = true;
+                priorConnections += ctMemoryGuardRead(&g_configSettings->SweepPointConnections[priorPoint]);
+            }
+            if (priorConnections > 0)
+            {
+                ++g_sweepWaitTicks;
+                if (g_sweepWaitTicks < c_sweepMaxWaitSteps * c_sweepTicksPerStep)
+                {
+                    return;
+                }
+
+                point.m_skipped = true;
+                PrintSummary(
+                    L"  Sweep point %Iu of %Iu : %ws : skipped (%ld connections of prior points were not replaced : reduce -Transfer)\n",
+                    g_sweepCurrentPoint + 1,
+                    g_sweepPoints.size(),
+                    SweepPointDescription(g_sweepCurrentPoint).c_str(),
+                    priorConnections);
+                AdvanceSweep();
+                return;
             }
         }
 
-        enum class ErrorType
+        ++g_sweepTicks;
+        if (1 == g_sweepTicks)
         {
-            Success,
-            NetworkError,
-            ProtocolError
-        } errorType = ErrorType::Success;
+            // connections have settled at the values of this point
+            SnapSteadyState(g_sweepStepStart);
+            g_sweepStepStartCpu = ctsCpuSnapshot::Snap();
+            return;
+        }
+        if (g_sweepTicks < c_sweepTicksPerStep)
+        {
+            return;
+        }
 
-        if (0 == error)
+        SteadyStateSnapshot stepEnd;
+        SnapSteadyState(stepEnd);
+        const auto cpu = ctsCpuSnapshot::Snap().Difference(g_sweepStepStartCpu);
+        const auto elapsedMs = stepEnd.m_timeMilliseconds - g_sweepStepStart.m_timeMilliseconds;
+        const auto bytes = stepEnd.m_bytesSent + stepEnd.m_bytesRecv - g_sweepStepStart.m_bytesSent - g_sweepStepStart.m_bytesRecv;
+        point.m_bytesPerSecond = elapsedMs > 0 ? static_cast<double>(bytes) * 1000.0 / static_cast<double>(elapsedMs) : 0.0;
+        point.m_cyclesPerByte = cpu.CyclesPer(bytes);
+        point.m_errors = stepEnd.m_connectionErrors + stepEnd.m_protocolErrors - g_sweepStepStart.m_connectionErrors - g_sweepStepStart.m_protocolErrors;
+        point.m_measured = true;
+
+        PrintSummary(
+            L"  Sweep point %Iu of %Iu : %ws : %.0f bytes/sec, %.2f cycles/byte, %lld errors\n",
+            g_sweepCurrentPoint + 1,
+            g_sweepPoints.size(),
+            SweepPointDescription(g_sweepCurrentPoint).c_str(),
+            point.m_bytesPerSecond,
+            point.m_cyclesPerByte,
+            point.m_errors);
+        AdvanceSweep();
+    }
+    catch (...)
+    {
+    }
+
+    // the two-sided 95% Student's t critical value for the degrees of freedom
+    static double StudentT95(unsigned long degreesOfFreedom) noexcept
+    {
+        constexpr double c_tTable[]{
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+        if (degreesOfFreedom >= 1 && degreesOfFreedom <= ARRAYSIZE(c_tTable))
         {
-            errorType = ErrorType::Success;
+            return c_tTable[degreesOfFreedom - 1];
         }
-        else if (ctsIoPattern::IsProtocolError(error))
+        return 1.960;
+    }
+
+    // returns the mean of the samples, and the 95% confidence half-width of the mean in *halfWidth
+    static double ConfidenceInterval(const vector<double>& samples, _Out_ double* halfWidth) noexcept
+    {
+        double mean = 0.0;
+        for (const auto sample : samples)
         {
-            errorType = ErrorType::ProtocolError;
+            mean += sample;
         }
-        else
+        mean /= static_cast<double>(samples.size());
+
+        double sumOfSquares = 0.0;
+        for (const auto sample : samples)
         {
-            errorType = ErrorType::NetworkError;
+            sumOfSquares += (sample - mean) * (sample - mean);
         }
+        const auto count = static_cast<unsigned long>(samples.size());
+        const auto standardDeviation = sqrt(sumOfSquares / static_cast<double>(count - 1));
+        *halfWidth = StudentT95(count - 1) * standardDeviation / sqrt(static_cast<double>(count));
+        return mean;
+    }
 
-        static PCWSTR tcpSuccessfulResultTextFormat = L"[%.3f] TCP connection succeeded : [%ws - %ws] [%hs]: SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
-        static PCWSTR tcpNetworkFailureResultTextFormat = L"[%.3f] TCP connection failed with the error %ws : [%ws - %ws] [%hs] : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
-        static PCWSTR tcpProtocolFailureResultTextFormat = L"[%.3f] TCP connection failed with the protocol error %ws : [%ws - %ws] [%hs] : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
+    void ConvergenceUpdate() noexcept
+        try
+    {
+        if (g_convergedMilliseconds > 0)
+        {
+            return;
+        }
 
-        // csv format : L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId"
-        static PCWSTR tcpResultCsvFormat = L"%.3f,%ws,%ws,%lld,%lld,%lld,%lld,%lld,%ws,%hs\r\n";
+        SteadyStateSnapshot current;
+        SnapSteadyState(current);
+        const auto prior = g_convergencePrior;
+        g_convergencePrior = current;
+        if (!prior.m_taken ||
+            current.m_timeMilliseconds - g_configSettings->StartTimeMilliseconds <= static_cast<long long>(g_configSettings->WarmUpMilliseconds))
+        {
+            return;
+        }
 
-        const long long totalTime = stats.m_endTime.GetValue() - stats.m_startTime.GetValue();
-        FAIL_FAST_IF_MSG(
-            totalTime < 0LL,
-            "end_time is less than start_time in this ctsTcpStatistics object (%p)", &stats);
-        const float currentTime = GetStatusTimeStamp();
+        const auto elapsedMs = current.m_timeMilliseconds - prior.m_timeMilliseconds;
+        if (elapsedMs <= 0)
+        {
+            return;
+        }
+        const auto bytes = current.m_bytesSent + current.m_bytesRecv - prior.m_bytesSent - prior.m_bytesRecv;
+        g_convergenceThroughput.push_back(static_cast<double>(bytes) * 1000.0 / static_cast<double>(elapsedMs));
 
-        wstring csvString;
-        wstring textString;
-        wstring errorString;
-        if (ErrorType::ProtocolError != errorType)
+        const bool trackLatency = ProtocolType::TCP == g_configSettings->Protocol && !g_configSettings->LatencyPercentiles.empty();
+        if (trackLatency)
         {
-            if (0 == error)
-            {
-                errorString = L"Succeeded";
-            }
-            else
-            {
-                errorString = wil::str_printf<std::wstring>(
-                    L"%lu: %ws",
-                    error,
-                    ctString::ctFormatMessage(error).c_str());
-                // remove any commas from the formatted string - since that will mess up csv files
-                ctString::ctReplaceAll(errorString, L",", L" ");
-            }
+            auto intervalLatency = current.m_ioLatency;
+            intervalLatency.Subtract(prior.m_ioLatency);
+            g_convergenceLatency.push_back(static_cast<double>(
+                ctsLatencySnapshot::ConvertTicksToMicroseconds(intervalLatency.GetPercentile(g_configSettings->LatencyPercentiles.back()))));
         }
 
-        if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
+        if (g_convergenceThroughput.size() > g_configSettings->ConvergenceWindow)
         {
-            csvString = wil::str_printf<std::wstring>(
-                tcpResultCsvFormat,
-                currentTime,
-                localAddr.WriteCompleteAddress().c_str(),
-                remoteAddr.WriteCompleteAddress().c_str(),
-                stats.m_bytesSent.GetValue(),
-                totalTime > 0LL ? static_cast<long long>(stats.m_bytesSent.GetValue() * 1000LL / totalTime) : 0LL,
-                stats.m_bytesRecv.GetValue(),
-                totalTime > 0LL ? static_cast<long long>(stats.m_bytesRecv.GetValue() * 1000LL / totalTime) : 0LL,
-                totalTime,
-                ErrorType::ProtocolError == errorType ?
-                ctsIoPattern::BuildProtocolErrorString(error) :
-                errorString.c_str(),
-                stats.m_connectionIdentifier);
+            g_convergenceThroughput.erase(g_convergenceThroughput.begin());
         }
-        // we'll never write csv format to the console so we'll need a text string in that case
-        // - and/or in the case the s_ConnectionLogger isn't writing to csv
-        if (writeToConsole || g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+        if (g_convergenceLatency.size() > g_configSettings->ConvergenceWindow)
         {
-            if (0 == error)
-            {
-                textString = wil::str_printf<std::wstring>(
-                    tcpSuccessfulResultTextFormat,
-                    currentTime,
-                    localAddr.WriteCompleteAddress().c_str(),
-                    remoteAddr.WriteCompleteAddress().c_str(),
-                    stats.m_connectionIdentifier,
-                    stats.m_bytesSent.GetValue(),
-                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesSent.GetValue() * 1000LL / totalTime) : 0LL,
-                    stats.m_bytesRecv.GetValue(),
-                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesRecv.GetValue() * 1000LL / totalTime) : 0LL,
-                    totalTime);
-            }
-            else
-            {
-                textString = wil::str_printf<std::wstring>(
-                    ErrorType::ProtocolError == errorType ? tcpProtocolFailureResultTextFormat : tcpNetworkFailureResultTextFormat,
-                    currentTime,
-                    ErrorType::ProtocolError == errorType ? ctsIoPattern::BuildProtocolErrorString(error) : errorString.c_str(),
-                    localAddr.WriteCompleteAddress().c_str(),
-                    remoteAddr.WriteCompleteAddress().c_str(),
-                    stats.m_connectionIdentifier,
-                    stats.m_bytesSent.GetValue(),
-                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesSent.GetValue() * 1000LL / totalTime) : 0LL,
-                    stats.m_bytesRecv.GetValue(),
-                    totalTime > 0LL ? static_cast<long long>(stats.m_bytesRecv.GetValue() * 1000LL / totalTime) : 0LL,
-                    totalTime);
-            }
+            g_convergenceLatency.erase(g_convergenceLatency.begin());
+        }
+        if (g_convergenceThroughput.size() < g_configSettings->ConvergenceWindow)
+        {
+            return;
         }
 
-        if (writeToConsole)
+        const auto tolerance = g_configSettings->ConvergenceTolerancePercent / 100.0;
+        double throughputHalfWidth = 0.0;
+        const auto throughput = ConfidenceInterval(g_convergenceThroughput, &throughputHalfWidth);
+        if (throughput <= 0.0 || throughputHalfWidth > tolerance * throughput)
         {
-            // text strings always go to the console
-            wprintf(L"%ws\n", textString.c_str());
+            return;
         }
 
-        if (g_connectionLogger)
+        double latencyHalfWidth = 0.0;
+        double latency = 0.0;
+        if (trackLatency)
         {
-            if (g_connectionLogger->IsCsvFormat())
-            {
-                g_connectionLogger->LogMessage(csvString.c_str());
-            }
-            else
+            latency = ConfidenceInterval(g_convergenceLatency, &latencyHalfWidth);
+            if (latencyHalfWidth > tolerance * latency)
             {
-                g_connectionLogger->LogMessage(
-                    wil::str_printf<std::wstring>(L"%ws\r\n", textString.c_str()).c_str());
+                return;
             }
         }
+
+        g_convergedMilliseconds = current.m_timeMilliseconds - g_configSettings->StartTimeMilliseconds;
+        g_convergedThroughput = throughput;
+        g_convergedThroughputHalfWidth = throughputHalfWidth;
+        g_convergedLatency = latency;
+        g_convergedLatencyHalfWidth = latencyHalfWidth;
+        // ends the run as if the time limit was reached
+        if (!SetEvent(g_configSettings->CtrlCHandle))
+        {
+            FAIL_FAST_MSG("SetEvent(%p) failed [%u] when trying to end the -Converge run", g_configSettings->CtrlCHandle, GetLastError());
+        }
     }
     catch (...)
     {
     }
 
-    void PrintConnectionResults(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error, const ctsUdpStatistics& stats) noexcept
+    void PrintConvergenceSummary() noexcept
         try
     {
-        ctsConfigInitOnce();
-
-        // write even after shutdown so can print the final summaries
-        bool writeToConsole = false;
-        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+        if (0.0 == g_configSettings->ConvergenceTolerancePercent)
         {
-            // case 0: // nothing
-            // case 1: // status updates
-            // case 2: // error info
-            case 3: // connection info
-            case 4: // connection info + error info
-            case 5: // connection info + error info + status updates
-            case 6: // above + debug info
-            {
-                writeToConsole = true;
-            }
+            return;
         }
 
-        enum class ErrorType
+        if (0 == g_convergedMilliseconds)
         {
-            Success,
-            NetworkError,
-            ProtocolError
-        } errorType{};
+            PrintSummary(
+                L"\n  Convergence : not converged to within +/- %.2f%% before the run ended\n",
+                g_configSettings->ConvergenceTolerancePercent);
+            return;
+        }
 
-        if (0 == error)
+        PrintSummary(
+            L"\n  Convergence : converged after %lld ms (the last %lu status intervals)\n"
+            L"    Throughput : %.0f bytes/sec  +/- %.0f (%.2f%%) at 95%% confidence\n",
+            g_convergedMilliseconds,
+            g_configSettings->ConvergenceWindow,
+            g_convergedThroughput,
+            g_convergedThroughputHalfWidth,
+            g_convergedThroughputHalfWidth * 100.0 / g_convergedThroughput);
+        if (!g_configSettings->LatencyPercentiles.empty() && ProtocolType::TCP == g_configSettings->Protocol)
         {
-            errorType = ErrorType::Success;
+            PrintSummary(
+                L"    IO Latency p%g : %.1f us  +/- %.1f at 95%% confidence\n",
+                g_configSettings->LatencyPercentiles.back(),
+                g_convergedLatency,
+                g_convergedLatencyHalfWidth);
         }
-        else if (ctsIoPattern::IsProtocolError(error))
+    }
+    catch (...)
+    {
+    }
+
+    void PrintRateSearchSummary() noexcept
+        try
+    {
+        if (0 == g_configSettings->RateSearchStepMilliseconds)
         {
-            errorType = ErrorType::ProtocolError;
+            return;
         }
-        else
+
+        PrintSummary(L"\n  Rate Search : %ws after %lu steps\n", g_rateSearchComplete ? L"completed" : L"incomplete (the run ended first)", g_rateSearchSteps);
+        if (0 == g_rateSearchStableRate)
         {
-            errorType = ErrorType::NetworkError;
+            PrintSummary(
+                L"    No stable rate was found : the limit is below %lld bytes/sec per connection\n",
+                g_rateSearchUnstableRate > 0 ? g_rateSearchUnstableRate : g_rateLimitLow);
+            return;
         }
 
-        static PCWSTR udpSuccessfulResultTextFormat = L"[%.3f] UDP connection succeeded : [%ws - %ws] [%hs] : BitsPerSecond [%llu]  Completed [%llu]  Dropped [%llu]  Repeated [%llu]  Errors [%llu]";
-        static PCWSTR udpNetworkFailureResultTextFormat = L"[%.3f] UDP connection failed with the error %ws : [%ws - %ws] [%hs] : BitsPerSecond [%llu]  Completed [%llu]  Dropped [%llu]  Repeated [%llu]  Errors [%llu]";
-        static PCWSTR udpProtocolFailureResultTextFormat = L"[%.3f] UDP connection failed with the protocol error %ws : [%ws - %ws] [%hs] : BitsPerSecond [%llu]  Completed [%llu]  Dropped [%llu]  Repeated [%llu]  Errors [%llu]";
-
-        // csv format : "TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId"
-        static PCWSTR udpResultCsvFormat = L"%.3f,%ws,%ws,%llu,%llu,%llu,%llu,%llu,%ws,%hs\r\n";
-
-        const float currentTime = GetStatusTimeStamp();
-        const long long elapsedTime(stats.m_endTime.GetValue() - stats.m_startTime.GetValue());
-        const long long bitsPerSecond = elapsedTime > 0LL ? static_cast<long long>(stats.m_bitsReceived.GetValue() * 1000LL / elapsedTime) : 0LL;
+        // the true limit lies between the highest stable rate and the lowest unstable rate tried
+        PrintSummary(
+            L"    Highest Stable Rate : %lld bytes/sec per connection  (%.0f bytes/sec across all connections)\n"
+            L"    The sustainable rate lies between %lld and %lld bytes/sec per connection%ws\n",
+            g_rateSearchStableRate,
+            g_rateSearchStableThroughput,
+            g_rateSearchStableRate,
+            g_rateSearchUnstableRate > 0 ? g_rateSearchUnstableRate : g_rateLimitHigh,
+            g_rateSearchUnstableRate > 0 ? L"" : L" (no rate tried was unstable : the high end of -RateLimit may be too low)");
+    }
+    catch (...)
+    {
+    }
 
-        wstring csvString;
-        wstring textString;
-        wstring errorString;
-        if (ErrorType::ProtocolError != errorType)
+    void PrintSweepSummary() noexcept
+        try
+    {
+        if (g_sweepPoints.empty())
         {
-            if (0 == error)
-            {
-                errorString = L"Succeeded";
-            }
-            else
+            return;
+        }
+
+        size_t measuredPoints = 0;
+        double highestBytesPerSecond = 0.0;
+        for (const auto& point : g_sweepPoints)
+        {
+            if (point.m_measured)
             {
-                errorString = wil::str_printf<std::wstring>(
-                    L"%lu: %ws",
-                    error,
-                    ctString::ctFormatMessage(error).c_str());
-                // remove any commas from the formatted string - since that will mess up csv files
-                ctString::ctReplaceAll(errorString, L",", L" ");
+                ++measuredPoints;
+                if (0 == point.m_errors)
+                {
+                    highestBytesPerSecond = max(highestBytesPerSecond, point.m_bytesPerSecond);
+                }
             }
         }
+        PrintSummary(
+            L"\n  Sweep : %ws : %Iu of %Iu points measured\n",
+            g_sweepComplete ? L"completed" : L"incomplete (the run ended first)",
+            measuredPoints,
+            g_sweepPoints.size());
 
-        if (g_connectionLogger && g_connectionLogger->IsCsvFormat())
+        // one row per point, one column per axis : the grid as a table
+        wstring header(L"    ");
+        for (const auto& axis : g_sweepAxes)
         {
-            csvString = wil::str_printf<std::wstring>(
-                udpResultCsvFormat,
-                currentTime,
-                localAddr.WriteCompleteAddress().c_str(),
-                remoteAddr.WriteCompleteAddress().c_str(),
-                bitsPerSecond,
-                stats.m_successfulFrames.GetValue(),
-                stats.m_droppedFrames.GetValue(),
-                stats.m_duplicateFrames.GetValue(),
-                stats.m_errorFrames.GetValue(),
-                ErrorType::ProtocolError == errorType ?
-                ctsIoPattern::BuildProtocolErrorString(error) :
-                errorString.c_str(),
-                stats.m_connectionIdentifier);
+            header.append(wil::str_printf<std::wstring>(L"%16ws", SweepParameterName(axis.m_parameter)));
         }
-        // we'll never write csv format to the console so we'll need a text string in that case
-        // - and/or in the case the s_ConnectionLogger isn't writing to csv
-        if (writeToConsole || g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+        header.append(L"        bytes/sec   cycles/byte    errors\n");
+        PrintSummary(L"%ws", header.c_str());
+
+        // the best point has no errors and is within tolerance of the highest throughput, at the lowest CPU cost
+        const SweepPointResult* best = nullptr;
+        size_t bestPoint = 0;
+        for (size_t pointIndex = 0; pointIndex < g_sweepPoints.size(); ++pointIndex)
         {
-            if (0 == error)
+            const auto& point = g_sweepPoints[pointIndex];
+            wstring row(L"    ");
+            for (const auto value : point.m_values)
             {
-                textString = wil::str_printf<std::wstring>(
-                    udpSuccessfulResultTextFormat,
-                    currentTime,
-                    localAddr.WriteCompleteAddress().c_str(),
-                    remoteAddr.WriteCompleteAddress().c_str(),
-                    stats.m_connectionIdentifier,
-                    bitsPerSecond,
-                    stats.m_successfulFrames.GetValue(),
-                    stats.m_droppedFrames.GetValue(),
-                    stats.m_duplicateFrames.GetValue(),
-                    stats.m_errorFrames.GetValue());
+                row.append(wil::str_printf<std::wstring>(L"%16lu", value));
+            }
+            if (point.m_measured)
+            {
+                row.append(wil::str_printf<std::wstring>(L"%17.0f %13.2f %9lld\n", point.m_bytesPerSecond, point.m_cyclesPerByte, point.m_errors));
             }
             else
             {
-                textString = wil::str_printf<std::wstring>(
-                    ErrorType::ProtocolError == errorType ? udpProtocolFailureResultTextFormat : udpNetworkFailureResultTextFormat,
-                    currentTime,
-                    ErrorType::ProtocolError == errorType ?
-                    ctsIoPattern::BuildProtocolErrorString(error) :
-                    errorString.c_str(),
-                    localAddr.WriteCompleteAddress().c_str(),
-                    remoteAddr.WriteCompleteAddress().c_str(),
-                    stats.m_connectionIdentifier,
-                    bitsPerSecond,
-                    stats.m_successfulFrames.GetValue(),
-                    stats.m_droppedFrames.GetValue(),
-                    stats.m_duplicateFrames.GetValue(),
-                    stats.m_errorFrames.GetValue());
+                row.append(point.m_skipped ? L"          skipped\n" : L"     not measured\n");
+            }
+            PrintSummary(L"%ws", row.c_str());
+
+            if (point.m_measured && 0 == point.m_errors && point.m_bytesPerSecond > 0.0 &&
+                point.m_bytesPerSecond >= (1.0 - c_sweepThroughputTolerance) * highestBytesPerSecond &&
+                (nullptr == best || point.m_cyclesPerByte < best->m_cyclesPerByte))
+            {
+                best = &point;
+                bestPoint = pointIndex;
             }
         }
 
-        if (writeToConsole)
+        if (nullptr == best)
         {
-            // text strings always go to the console
-            wprintf(L"%ws\n", textString.c_str());
+            PrintSummary(L"    No point was measured without failed connections\n");
+            return;
         }
+        PrintSummary(
+            L"    Best : %ws  (%.0f bytes/sec, %.2f cycles/byte : the fewest cycles per byte within 2%% of the highest throughput)\n",
+            SweepPointDescription(bestPoint).c_str(),
+            best->m_bytesPerSecond,
+            best->m_cyclesPerByte);
+    }
+    catch (...)
+    {
+    }
 
-        if (g_connectionLogger)
+    void PrintSteadyStateSummary(long long totalTimeMilliseconds) noexcept
+        try
+    {
+        if (0 == g_configSettings->WarmUpMilliseconds && 0 == g_configSettings->CoolDownMilliseconds)
         {
-            if (g_connectionLogger->IsCsvFormat())
+            return;
+        }
+
+        PrintSummary(
+            L"\n"
+            L"  Steady-State Statistics (excluding the first %lu ms and the last %lu ms)\n"
+            L"-------------------------------------------------------------------------------\n",
+            g_configSettings->WarmUpMilliseconds,
+            g_configSettings->CoolDownMilliseconds);
+
+        // without -WarmUp the steady-state starts with the run (all totals start at zero)
+        SteadyStateSnapshot start;
+        if (g_configSettings->WarmUpMilliseconds > 0)
+        {
+            if (!g_steadyStateStart.m_taken)
             {
-                g_connectionLogger->LogMessage(csvString.c_str());
+                PrintSummary(L"  The run completed before the end of the warm-up\n");
+                return;
             }
-            else
+            start = g_steadyStateStart;
+        }
+        else
+        {
+            start.m_timeMilliseconds = g_configSettings->StartTimeMilliseconds;
+        }
+
+        // the run can complete before the cool-down started : the steady-state then ends with the run
+        SteadyStateSnapshot end;
+        if (g_steadyStateEnd.m_taken)
+        {
+            end = g_steadyStateEnd;
+        }
+        else
+        {
+            SnapSteadyState(end);
+        }
+
+        const auto windowMilliseconds = end.m_timeMilliseconds - start.m_timeMilliseconds;
+        const auto perSecond = [](long long value, long long milliseconds) noexcept {
+            return milliseconds > 0 ? value * 1000LL / milliseconds : 0LL;
+        };
+
+        PrintSummary(
+            L"  Steady-State Time : %lld ms\n"
+            L"  SuccessfulConnections [%lld]   NetworkErrors [%lld]   ProtocolErrors [%lld]\n",
+            windowMilliseconds,
+            end.m_successfulConnections - start.m_successfulConnections,
+            end.m_connectionErrors - start.m_connectionErrors,
+            end.m_protocolErrors - start.m_protocolErrors);
+
+        if (ProtocolType::TCP == g_configSettings->Protocol)
+        {
+            PrintSummary(
+                L"  Send Rate (bytes/sec) : Steady-State [%lld]  Whole-Run [%lld]\n"
+                L"  Recv Rate (bytes/sec) : Steady-State [%lld]  Whole-Run [%lld]\n",
+                perSecond(end.m_bytesSent - start.m_bytesSent, windowMilliseconds),
+                perSecond(g_configSettings->TcpStatusDetails.m_bytesSent.GetValue(), totalTimeMilliseconds),
+                perSecond(end.m_bytesRecv - start.m_bytesRecv, windowMilliseconds),
+                perSecond(g_configSettings->TcpStatusDetails.m_bytesRecv.GetValue(), totalTimeMilliseconds));
+
+            const auto transactions = end.m_transactions - start.m_transactions;
+            if (transactions > 0)
             {
-                g_connectionLogger->LogMessage(
-                    wil::str_printf<std::wstring>(L"%ws\r\n", textString.c_str()).c_str());
+                PrintSummary(
+                    L"  Transactions (per second) : Steady-State [%lld]  Whole-Run [%lld]\n",
+                    perSecond(transactions, windowMilliseconds),
+                    perSecond(g_configSettings->TcpStatusDetails.m_transactions.GetValue(), totalTimeMilliseconds));
             }
+
+            const auto printLatency = [](PCWSTR name, ctsLatencySnapshot steadyState, const ctsLatencySnapshot& wholeRun) {
+                if (0 == steadyState.GetCount())
+                {
+                    return;
+                }
+                static constexpr double c_defaultPercentiles[]{ 50.0, 90.0, 99.0 };
+                const std::vector<double> percentiles = g_configSettings->LatencyPercentiles.empty() ?
+                    std::vector<double>(std::begin(c_defaultPercentiles), std::end(c_defaultPercentiles)) :
+                    g_configSettings->LatencyPercentiles;
+
+                wstring percentileString;
+                for (const auto percentile : percentiles)
+                {
+                    percentileString.append(
+                        wil::str_printf<std::wstring>(
+                            L"p%g [%lld / %lld]  ",
+                            percentile,
+                            ctsLatencySnapshot::ConvertTicksToMicroseconds(steadyState.GetPercentile(percentile)),
+                            ctsLatencySnapshot::ConvertTicksToMicroseconds(wholeRun.GetPercentile(percentile))));
+                }
+                PrintSummary(
+                    L"  %ws Latency (us, Steady-State / Whole-Run) : %wsMax [%lld / %lld]\n",
+                    name,
+                    percentileString.c_str(),
+                    ctsLatencySnapshot::ConvertTicksToMicroseconds(steadyState.GetMaximum()),
+                    ctsLatencySnapshot::ConvertTicksToMicroseconds(wholeRun.GetMaximum()));
+            };
+
+            auto ioLatency = end.m_ioLatency;
+            ioLatency.Subtract(start.m_ioLatency);
+            printLatency(L"IO", ioLatency, g_configSettings->TcpStatusDetails.m_ioLatency.GetTotal());
+
+            auto transactionLatency = end.m_transactionLatency;
+            transactionLatency.Subtract(start.m_transactionLatency);
+            printLatency(L"Transaction", transactionLatency, g_configSettings->TcpStatusDetails.m_transactionLatency.GetTotal());
+        }
+        else
+        {
+            const auto successfulFrames = end.m_successfulFrames - start.m_successfulFrames;
+            const auto droppedFrames = end.m_droppedFrames - start.m_droppedFrames;
+            PrintSummary(
+                L"  Recv Rate (bytes/sec) : Steady-State [%lld]  Whole-Run [%lld]\n"
+                L"  Successful Frames : %lld  Dropped Frames : %lld (%f)\n",
+                perSecond(end.m_bytesRecv - start.m_bytesRecv, windowMilliseconds),
+                perSecond(g_configSettings->UdpStatusDetails.m_bitsReceived.GetValue() / 8, totalTimeMilliseconds),
+                successfulFrames,
+                droppedFrames,
+                successfulFrames + droppedFrames > 0 ? static_cast<double>(droppedFrames) / static_cast<double>(successfulFrames + droppedFrames) * 100.0 : 0.0);
         }
     }
     catch (...)
     {
     }
 
-    void PrintConnectionResults(const ctSockaddr& localAddr, const ctSockaddr& remoteAddr, unsigned long error) noexcept
+    void PrintCpuSummary(long long totalTimeMilliseconds) noexcept
+        try
     {
+        if (!g_configSettings->PrintCpuEfficiency)
+        {
+            return;
+        }
+
+        const auto cpu = ctsCpuSnapshot::Snap().Difference(g_configSettings->StartCpu);
+        const auto& connectionDetails = g_configSettings->ConnectionStatusDetails;
+        const auto connections =
+            connectionDetails.m_successfulCompletionCount.GetValue() +
+            connectionDetails.m_connectionErrorCount.GetValue() +
+            connectionDetails.m_protocolErrorCount.GetValue();
+
         if (ProtocolType::TCP == g_configSettings->Protocol)
         {
-            PrintConnectionResults(localAddr, remoteAddr, error, ctsTcpStatistics());
+            const auto bytes = g_configSettings->TcpStatusDetails.m_bytesSent.GetValue() + g_configSettings->TcpStatusDetails.m_bytesRecv.GetValue();
+            PrintSummary(
+                L"  CPU : %llu cycles  (%.3f cycles/byte  %.0f cycles/IO  %.0f cycles/connection)\n",
+                cpu.m_cycles,
+                cpu.CyclesPer(bytes),
+                cpu.CyclesPer(g_configSettings->TcpStatusDetails.m_ioCompletions.GetValue()),
+                cpu.CyclesPer(connections));
+        }
+        else if (IsListening())
+        {
+            // MediaStream servers only track their send calls
+            PrintSummary(
+                L"  CPU : %llu cycles  (%.0f cycles/send  %.0f cycles/connection)\n",
+                cpu.m_cycles,
+                cpu.CyclesPer(g_configSettings->UdpStatusDetails.m_sendCalls.GetValue()),
+                cpu.CyclesPer(connections));
         }
         else
         {
-            PrintConnectionResults(localAddr, remoteAddr, error, ctsUdpStatistics());
+            PrintSummary(
+                L"  CPU : %llu cycles  (%.3f cycles/byte  %.0f cycles/frame  %.0f cycles/connection)\n",
+                cpu.m_cycles,
+                cpu.CyclesPer(g_configSettings->UdpStatusDetails.m_bitsReceived.GetValue() / 8),
+                cpu.CyclesPer(g_configSettings->UdpStatusDetails.m_successfulFrames.GetValue()),
+                cpu.CyclesPer(connections));
         }
-    }
 
-    void __cdecl PrintSummary(_In_z_ _Printf_format_string_ PCWSTR text, ...) noexcept
+        if (g_configSettings->PrintCpuTimes)
+        {
+            PrintSummary(
+                L"    Kernel [%.3f%%]  User [%.3f%%]  (of all processors)  Kernel Time (ms) [%lld]  User Time (ms) [%lld]\n",
+                ctsCpuSnapshot::PercentOfSystem(cpu.m_kernelTime, totalTimeMilliseconds),
+                ctsCpuSnapshot::PercentOfSystem(cpu.m_userTime, totalTimeMilliseconds),
+                cpu.m_kernelTime / 10000LL,
+                cpu.m_userTime / 10000LL);
+        }
+    }
+    catch (...)
     {
-        ctsConfigInitOnce();
+    }
 
-        // write even after shutdown so can print the final summaries
-        bool writeToConsole = false;
-        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-        switch (g_consoleVerbosity)  // NOLINT(hicpp-multiway-paths-covered)
+    void PrintDroppedLogMessages() noexcept
+    {
+        // the same logger can be shared across the connection, error and status output
+        unsigned long long droppedMessages = 0;
+        const ctsLogger* countedLoggers[6]{};
+        size_t countedLoggerCount = 0;
+        for (const auto* logger : { g_connectionLogger.get(), g_errorLogger.get(), g_statusLogger.get(), g_jitterLogger.get(), g_jitterSummaryLogger.get(), g_histogramLogger.get() })
         {
-            // case 0: // nothing
-            case 1: // status updates
-            case 2: // error info
-            case 3: // connection info
-            case 4: // connection info + error info
-            case 5: // connection info + error info + status updates
-            case 6: // above + debug info
+            if (logger && std::find(countedLoggers, countedLoggers + countedLoggerCount, logger) == countedLoggers + countedLoggerCount)
             {
-                writeToConsole = true;
+                countedLoggers[countedLoggerCount++] = logger;
+                droppedMessages += logger->GetDroppedMessageCount();
             }
         }
 
-        va_list argptr;
-        va_start(argptr, text);
-        try
+        if (droppedMessages > 0)
         {
-            wstring formattedString;
-            if (writeToConsole)
-            {
-                wil::details::str_vprintf_nothrow<std::wstring>(formattedString, text, argptr);
-                wprintf(L"%ws", formattedString.c_str());
-            }
+            PrintSummary(
+                L"  Dropped Log Messages : %llu (log files could not be written as fast as messages were logged)\n",
+                droppedMessages);
+        }
 
-            if (g_connectionLogger && !g_connectionLogger->IsCsvFormat())
+        unsigned long long droppedRecords = 0;
+        for (const auto* logger : { g_binaryConnectionLogger.get(), g_binaryJitterLogger.get() })
+        {
+            if (logger)
             {
-                if (formattedString.empty())
-                {
-                    wil::details::str_vprintf_nothrow<std::wstring>(formattedString, text, argptr);
-                }
-                g_connectionLogger->LogMessage(
-                    ctString::ctReplaceAllCopy(
-                        formattedString, L"\n", L"\r\n").c_str());
+                droppedRecords += logger->GetDroppedRecordCount();
             }
         }
-        catch (...)
+        if (droppedRecords > 0)
         {
+            PrintSummary(
+                L"  Dropped Binary Log Records : %llu (the binary log files could not be extended)\n",
+                droppedRecords);
         }
-        va_end(argptr);
     }
 
     void PrintErrorInfo(_In_z_ _Printf_format_string_ PCWSTR text, ...) noexcept
@@ -3768,19 +10278,21 @@ namespace ctsTraffic::ctsConfig
     /// - accessor functions made public to retrieve configuration details
     ///
     ////////////////////////////////////////////////////////////////////////////////////////////////////
+    // the Get*Size functions are called for every IO : they only read values fixed by Startup
+    // (or the -Sweep buffer size), so don't need the init-once check the other public functions make
     ctsUnsignedLong GetBufferSize() noexcept
     {
-        ctsConfigInitOnce();
-
+        if (g_frozenSettings.m_isBufferSweep)
+        {
+            return static_cast<unsigned long>(ctMemoryGuardRead(&g_sweepBufferSize));
+        }
         return 0 == g_bufferSizeHigh ?
             g_bufferSizeLow :
-            g_randomTwister.uniform_int(g_bufferSizeLow, g_bufferSizeHigh);
+            t_randomGenerator.uniform_int(g_bufferSizeLow, g_bufferSizeHigh);
     }
 
     ctsUnsignedLong GetMaxBufferSize() noexcept
     {
-        ctsConfigInitOnce();
-
         return g_bufferSizeHigh == 0 ?
             g_bufferSizeLow :
             g_bufferSizeHigh;
@@ -3788,28 +10300,31 @@ namespace ctsTraffic::ctsConfig
 
     ctsUnsignedLong GetMinBufferSize() noexcept
     {
-        ctsConfigInitOnce();
-
         return g_bufferSizeLow;
     }
 
 
     ctsUnsignedLongLong GetTransferSize() noexcept
     {
-        ctsConfigInitOnce();
-
         return 0 == g_transferSizeHigh ?
             g_transferSizeLow :
-            g_randomTwister.uniform_int(g_transferSizeLow, g_transferSizeHigh);
+            t_randomGenerator.uniform_int(g_transferSizeLow, g_transferSizeHigh);
     }
 
+    // only called once Startup has returned
     ctsSignedLongLong GetTcpBytesPerSecond() noexcept
     {
-        ctsConfigInitOnce();
-
+        if (g_frozenSettings.m_isRateSearch)
+        {
+            return ctMemoryGuardRead(&g_rateSearchBytesPerSecond);
+        }
+        if (g_frozenSettings.m_isLoadProfile)
+        {
+            return ctMemoryGuardRead(&g_loadProfileBytesPerSecond);
+        }
         return 0 == g_rateLimitHigh ?
             g_rateLimitLow :
-            g_randomTwister.uniform_int(g_rateLimitLow, g_rateLimitHigh);
+            t_randomGenerator.uniform_int(g_rateLimitLow, g_rateLimitHigh);
     }
 
     int GetListenBacklog() noexcept
@@ -3836,8 +10351,28 @@ namespace ctsTraffic::ctsConfig
         return g_mediaStreamSettings;
     }
 
+    // -io:memory : the role IsListening() reports on this thread while a ctsListeningRoleScope is alive
+    // - -1 when not overridden
+    static thread_local int t_listeningRoleOverride = -1;
+
+    ctsListeningRoleScope::ctsListeningRoleScope(bool listening) noexcept :
+        m_priorRole(t_listeningRoleOverride)
+    {
+        t_listeningRoleOverride = listening ? 1 : 0;
+    }
+
+    ctsListeningRoleScope::~ctsListeningRoleScope() noexcept
+    {
+        t_listeningRoleOverride = m_priorRole;
+    }
+
     bool IsListening() noexcept
     {
+        if (t_listeningRoleOverride != -1)
+        {
+            return 1 == t_listeningRoleOverride;
+        }
+
         ctsConfigInitOnce();
 
         return !g_configSettings->ListenAddresses.empty();
@@ -3953,6 +10488,68 @@ namespace ctsTraffic::ctsConfig
             }
         }
 
+        if (g_configSettings->Options & NoDelay)
+        {
+            // set on the listening socket for servers (accepted sockets inherit it), before connecting for clients
+            constexpr DWORD optval = 1; // BOOL
+            constexpr auto optlen = static_cast<int>(sizeof optval);
+
+            const auto error = setsockopt(
+                socket,
+                IPPROTO_TCP, // level
+                TCP_NODELAY, // optname
+                reinterpret_cast<const char*>(&optval),
+                optlen);
+            if (error != 0)
+            {
+                const auto gle = WSAGetLastError();
+                PrintErrorIfFailed("setsockopt(TCP_NODELAY)", gle);
+                return gle;
+            }
+        }
+
+        if (g_configSettings->AckFrequency > 0)
+        {
+            TCP_ACK_FREQUENCY_PARAMETERS ackFrequency{};
+            ackFrequency.TcpDelayedAckFrequency = static_cast<UCHAR>(g_configSettings->AckFrequency);
+            DWORD bytesReturned{};
+
+            const auto error = WSAIoctl(
+                socket,
+                SIO_TCP_SET_ACK_FREQUENCY,
+                &ackFrequency, static_cast<DWORD>(sizeof ackFrequency),
+                nullptr, 0,
+                &bytesReturned,
+                nullptr,
+                nullptr);
+            if (error != 0)
+            {
+                const auto gle = WSAGetLastError();
+                PrintErrorIfFailed("WSAIoctl(SIO_TCP_SET_ACK_FREQUENCY)", gle);
+                return gle;
+            }
+        }
+
+        if (g_configSettings->Options & TcpFastOpen)
+        {
+            // set on the listening socket for servers, before ConnectEx for clients
+            constexpr DWORD optval = 1; // BOOL
+            constexpr auto optlen = static_cast<int>(sizeof optval);
+
+            const auto error = setsockopt(
+                socket,
+                IPPROTO_TCP,  // level
+                TCP_FASTOPEN, // optname
+                reinterpret_cast<const char*>(&optval),
+                optlen);
+            if (error != 0)
+            {
+                const auto gle = WSAGetLastError();
+                PrintErrorIfFailed("setsockopt(TCP_FASTOPEN)", gle);
+                return gle;
+            }
+        }
+
         if (g_configSettings->Options & LoopbackFastPath)
         {
             DWORD inValue = 1;
@@ -4005,14 +10602,54 @@ namespace ctsTraffic::ctsConfig
 
             const auto error = setsockopt(
                 socket,
-                SOL_SOCKET,   // level
-                SO_KEEPALIVE, // optname
-                reinterpret_cast<const char*>(&optval),
-                optlen);
+                SOL_SOCKET,   // level
+                SO_KEEPALIVE, // optname
+                reinterpret_cast<const char*>(&optval),
+                optlen);
+            if (error != 0)
+            {
+                const auto gle = WSAGetLastError();
+                PrintErrorIfFailed("setsockopt(SO_KEEPALIVE)", gle);
+                return gle;
+            }
+        }
+
+        if (g_configSettings->UdpRecvOffload)
+        {
+            constexpr DWORD maxCoalescedSize = ctsConfigSettings::c_UdpRecvMaxCoalescedSize;
+            const auto error = setsockopt(
+                socket,
+                IPPROTO_UDP,
+                UDP_RECV_MAX_COALESCED_SIZE,
+                reinterpret_cast<const char*>(&maxCoalescedSize),
+                static_cast<int>(sizeof maxCoalescedSize));
+            if (error != 0)
+            {
+                const auto gle = WSAGetLastError();
+                PrintErrorIfFailed("setsockopt(UDP_RECV_MAX_COALESCED_SIZE)", gle);
+                return gle;
+            }
+        }
+
+        if (g_configSettings->UdpRecvTimestamps)
+        {
+            TIMESTAMPING_CONFIG timestampingConfig{};
+            timestampingConfig.Flags = TIMESTAMPING_FLAG_RX;
+            DWORD bytesReturned{};
+            const auto error = WSAIoctl(
+                socket,
+                SIO_TIMESTAMPING,
+                &timestampingConfig,
+                static_cast<DWORD>(sizeof timestampingConfig),
+                nullptr,
+                0,
+                &bytesReturned,
+                nullptr,
+                nullptr);
             if (error != 0)
             {
                 const auto gle = WSAGetLastError();
-                PrintErrorIfFailed("setsockopt(SO_KEEPALIVE)", gle);
+                PrintErrorIfFailed("WSAIoctl(SIO_TIMESTAMPING)", gle);
                 return gle;
             }
         }
@@ -4145,6 +10782,14 @@ namespace ctsTraffic::ctsConfig
             {
                 settingString.append(L" TCPFastPath");
             }
+            if (g_configSettings->Options & TcpFastOpen)
+            {
+                settingString.append(L" TCPFastOpen");
+            }
+            if (g_configSettings->Options & NoDelay)
+            {
+                settingString.append(L" NoDelay");
+            }
             if (g_configSettings->KeepAliveValue > 0)
             {
                 settingString.append(L" KeepAlive (");
@@ -4162,6 +10807,18 @@ namespace ctsTraffic::ctsConfig
             if (g_configSettings->Options & HandleInlineIocp)
             {
                 settingString.append(L" InlineIOCP");
+                if (g_configSettings->InlineCompletionBudget > 0)
+                {
+                    settingString.append(wil::str_printf<std::wstring>(L"(budget %lu IOs)", g_configSettings->InlineCompletionBudget));
+                }
+                else if (g_configSettings->InlineCompletionBudgetMicroseconds > 0)
+                {
+                    settingString.append(wil::str_printf<std::wstring>(L"(budget %lu us)", g_configSettings->InlineCompletionBudgetMicroseconds));
+                }
+            }
+            if (g_configSettings->InlineStateTransitions)
+            {
+                settingString.append(L" InlineStateTransitions");
             }
             if (g_configSettings->Options & ReuseUnicastPort)
             {
@@ -4171,18 +10828,111 @@ namespace ctsTraffic::ctsConfig
             {
                 settingString.append(wil::str_printf<std::wstring>(L" SO_RCVBUF(%lu)", static_cast<unsigned long>(g_configSettings->RecvBufValue)));
             }
+            if (g_configSettings->AutoRecvBuf)
+            {
+                settingString.append(L" SO_RCVBUF(auto)");
+            }
             if (g_configSettings->Options & SetSendBuf)
             {
                 settingString.append(wil::str_printf<std::wstring>(L" SO_SNDBUF(%lu)", static_cast<unsigned long>(g_configSettings->SendBufValue)));
             }
+            if (g_configSettings->AutoSendBuf)
+            {
+                settingString.append(L" SO_SNDBUF(auto)");
+            }
             if (g_configSettings->Options & MsgWaitAll)
             {
                 settingString.append(L" MsgWaitAll");
             }
+            if (g_configSettings->Options & ZeroByteRecv)
+            {
+                settingString.append(L" ZeroByteRecv");
+            }
+            if (g_configSettings->ExchangeConnectionIdOnConnect)
+            {
+                settingString.append(L" ConnectData");
+            }
+            if (g_configSettings->LeanProtocol)
+            {
+                settingString.append(L" LeanProtocol");
+            }
+            if (g_configSettings->ReuseSockets)
+            {
+                settingString.append(L" SocketReuse");
+            }
+            if (g_configSettings->PrecreateSockets)
+            {
+                settingString.append(L" PrecreateSockets");
+            }
+            if (g_configSettings->BufferSegments > 1)
+            {
+                settingString.append(wil::str_printf<std::wstring>(L" BufferSegments(%lu", g_configSettings->BufferSegments));
+                if (g_configSettings->BufferSegmentHeaderLength > 0)
+                {
+                    settingString.append(wil::str_printf<std::wstring>(L", header %lu", g_configSettings->BufferSegmentHeaderLength));
+                }
+                settingString.append(L")");
+            }
         }
         settingString.append(L"\n");
 
         settingString.append(wil::str_printf<std::wstring>(L"\tIO function: %ws\n", g_ioFunctionName));
+        if (g_configSettings->IoFunction == ctsTlsIocp)
+        {
+            const wchar_t* protocolName = L"system default";
+            if (TlsProtocolType::Tls12 == g_configSettings->TlsProtocol)
+            {
+                protocolName = L"1.2";
+            }
+            else if (TlsProtocolType::Tls13 == g_configSettings->TlsProtocol)
+            {
+                protocolName = L"1.3";
+            }
+
+            const wchar_t* cipherName = L"system default";
+            if (TlsCipherType::Aes128 == g_configSettings->TlsCipher)
+            {
+                cipherName = L"aes128";
+            }
+            else if (TlsCipherType::Aes256 == g_configSettings->TlsCipher)
+            {
+                cipherName = L"aes256";
+            }
+            else if (TlsCipherType::ChaCha20 == g_configSettings->TlsCipher)
+            {
+                cipherName = L"chacha20";
+            }
+
+            settingString.append(wil::str_printf<std::wstring>(
+                L"\t\tTLS: protocol %ws, cipher %ws, session resumption %ws, certificate %ws\n",
+                protocolName,
+                cipherName,
+                g_configSettings->TlsResumption ? L"on" : L"off",
+                g_configSettings->TlsCertificateName ? g_configSettings->TlsCertificateName : L"<not set>"));
+        }
+        if (g_configSettings->RioCompletionQueueCount > 0)
+        {
+            settingString.append(wil::str_printf<std::wstring>(L"\t\tRIO completion queues: %lu\n", g_configSettings->RioCompletionQueueCount));
+        }
+        if (WI_IsFlagSet(g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+        {
+            if (g_configSettings->RioDequeueBatchSize > 0)
+            {
+                settingString.append(wil::str_printf<std::wstring>(L"\t\tRIO dequeue batch size: %lu\n", g_configSettings->RioDequeueBatchSize));
+            }
+            else
+            {
+                settingString.append(L"\t\tRIO dequeue batch size: adaptive\n");
+            }
+        }
+        if (g_configSettings->RioPollCompletions)
+        {
+            settingString.append(wil::str_printf<std::wstring>(L"\t\tRIO poll spin count: %lu\n", g_configSettings->RioPollSpinCount));
+        }
+        if (g_configSettings->XdpSend)
+        {
+            settingString.append(wil::str_printf<std::wstring>(L"\t\tXDP queues: %lu\n", g_configSettings->XdpQueueCount));
+        }
 
         settingString.append(L"\tIoPattern: ");
         switch (g_configSettings->IoPattern)
@@ -4202,7 +10952,25 @@ namespace ctsTraffic::ctsConfig
                 settingString.append(L"Duplex <TCP client/server both sending and receiving>\n");
                 break;
             case IoPatternType::MediaStream:
-                settingString.append(L"MediaStream <UDP controlled stream from server to client>\n");
+                if (g_configSettings->UdpBlast)
+                {
+                    settingString.append(L"Blast <UDP datagrams sent unpaced from server to client>\n");
+                }
+                else
+                {
+                    settingString.append(L"MediaStream <UDP controlled stream from server to client>\n");
+                }
+                break;
+            case IoPatternType::RequestResponse:
+                settingString.append(L"RequestResponse <TCP client requests/server responds>\n");
+                settingString.append(wil::str_printf<std::wstring>(L"\t\tRequestBytes: %lu\n", g_configSettings->RequestBytes));
+                settingString.append(wil::str_printf<std::wstring>(L"\t\tResponseBytes: %lu\n", g_configSettings->ResponseBytes));
+                settingString.append(wil::str_printf<std::wstring>(L"\t\tPipelineDepth: %lu\n", g_configSettings->PipelineDepth));
+                break;
+            case IoPatternType::Heartbeat:
+                settingString.append(L"Heartbeat <TCP client heartbeats/server echoes>\n");
+                settingString.append(wil::str_printf<std::wstring>(L"\t\tHeartbeatBytes: %lu\n", g_configSettings->RequestBytes));
+                settingString.append(wil::str_printf<std::wstring>(L"\t\tHeartbeatInterval: %lu ms\n", g_configSettings->HeartbeatIntervalMilliseconds));
                 break;
 
             case IoPatternType::NoIoSet: // fall-through
@@ -4221,10 +10989,61 @@ namespace ctsTraffic::ctsConfig
             settingString.append(wil::str_printf<std::wstring>(L"\tPrePostSends: Following Ideal Send Backlog\n"));
         }
 
+        if (g_configSettings->PersistentTransfers > 1)
+        {
+            settingString.append(wil::str_printf<std::wstring>(L"\tPersistentTransfers: %lu per connection\n", g_configSettings->PersistentTransfers));
+        }
+
+        if (g_configSettings->ProbeConnections > 0)
+        {
+            if (IsListening())
+            {
+                settingString.append(wil::str_printf<std::wstring>(L"\tProbes: accepted on port %u\n", static_cast<unsigned>(g_configSettings->ProbePort)));
+            }
+            else
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\tProbes: %lu connections to port %u, pinging every %lu ms\n",
+                        g_configSettings->ProbeConnections,
+                        static_cast<unsigned>(g_configSettings->ProbePort),
+                        g_configSettings->ProbeIntervalMilliseconds));
+            }
+        }
+
         settingString.append(
             wil::str_printf<std::wstring>(
                 L"\tLevel of verification: %ws\n",
-                g_configSettings->ShouldVerifyBuffers ? L"Connections & Data" : L"Connections"));
+                g_configSettings->SeededPayload ? L"Connections & Per-Connection Seeded Data" :
+                g_configSettings->ShouldVerifyBuffers ? L"Connections & Data" :
+                g_configSettings->ShouldVerifyChecksums ? L"Connections & Data Checksums" : L"Connections"));
+
+        if (!g_configSettings->LatencyPercentiles.empty())
+        {
+            settingString.append(L"\tIO & Connection Latency Percentiles:");
+            for (const auto percentile : g_configSettings->LatencyPercentiles)
+            {
+                settingString.append(wil::str_printf<std::wstring>(L" p%g", percentile));
+            }
+            settingString.append(L"\n");
+        }
+
+        if (g_configSettings->TcpInfoIntervalMilliseconds > 0)
+        {
+            settingString.append(wil::str_printf<std::wstring>(L"\tTCP_INFO sampling interval (ms): %lu\n", g_configSettings->TcpInfoIntervalMilliseconds));
+        }
+        if (g_configSettings->ConnectionSampleIntervalMilliseconds > 0)
+        {
+            settingString.append(wil::str_printf<std::wstring>(L"\tConnection throughput sampling interval (ms): %lu\n", g_configSettings->ConnectionSampleIntervalMilliseconds));
+        }
+        if (g_configSettings->ConnectionLogAggregate)
+        {
+            settingString.append(wil::str_printf<std::wstring>(L"\tConnection log: aggregated per status update, %lu connections sampled per update\n", g_configSettings->ConnectionLogSamples));
+        }
+        if (g_configSettings->AccountConnectionMemory)
+        {
+            settingString.append(L"\tMemory accounting: per connection, process memory sampled per status update\n");
+        }
 
         settingString.append(wil::str_printf<std::wstring>(L"\tPort: %u\n", g_configSettings->Port));
 
@@ -4242,6 +11061,121 @@ namespace ctsTraffic::ctsConfig
                     L"\tBuffer used for each IO request: [%u, %u] bytes\n",
                     g_bufferSizeLow, g_bufferSizeHigh));
         }
+        if (g_configSettings->MessageSize > 0)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tMessage size for each send: %lu bytes\n",
+                    g_configSettings->MessageSize));
+        }
+        if (g_configSettings->AckFrequency > 0)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tDelayed-ACK frequency: %lu segments\n",
+                    g_configSettings->AckFrequency));
+        }
+
+        settingString.append(
+            wil::str_printf<std::wstring>(
+                L"\tRecv buffers: %ws (%Iu bytes per connection)\n",
+                ctsIoPattern::GetBufferPolicyDescription(),
+                ctsIoPattern::GetConnectionBufferFootprint()));
+        if (g_configSettings->UseLargePages || g_configSettings->UseNumaLocalBuffers)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tShared buffers:%ws%ws\n",
+                    g_configSettings->UseLargePages ? L" LargePages" : L"",
+                    g_configSettings->UseNumaLocalBuffers ? L" NumaLocalReplicas" : L""));
+        }
+        if (g_configSettings->WarmUpMilliseconds > 0 || g_configSettings->CoolDownMilliseconds > 0)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tSteady-State: excluding the first %lu ms (warm-up) and the last %lu ms (cool-down)\n",
+                    g_configSettings->WarmUpMilliseconds,
+                    g_configSettings->CoolDownMilliseconds));
+        }
+        if (!g_sweepAxes.empty())
+        {
+            wstring axes;
+            for (const auto& axis : g_sweepAxes)
+            {
+                axes.append(wil::str_printf<std::wstring>(L" %ws(%Iu)", SweepParameterName(axis.m_parameter), axis.m_values.size()));
+            }
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tSweep: %Iu points of%ws, measuring each for %lu ms\n",
+                    g_sweepPoints.size(),
+                    axes.c_str(),
+                    g_configSettings->SweepStepMilliseconds));
+        }
+        if (g_configSettings->ConvergenceTolerancePercent > 0.0)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tConverge: stopping once the last %lu status intervals are within +/- %.2f%% at 95%% confidence\n",
+                    g_configSettings->ConvergenceWindow,
+                    g_configSettings->ConvergenceTolerancePercent));
+        }
+        if (g_configSettings->HostCounters)
+        {
+            settingString.append(L"\tHostCounters: processor, network adapter and TCP counters sampled with each status update\n");
+        }
+        if (g_configSettings->PrintCpuEfficiency)
+        {
+            settingString.append(
+                g_configSettings->PrintCpuTimes ?
+                L"\tCpuEfficiency: cycles per byte, IO and connection, with kernel and user time\n" :
+                L"\tCpuEfficiency: cycles per byte, IO and connection\n");
+        }
+        if (g_configSettings->StatsSharedMemoryName)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tStats shared memory: %ws\n",
+                    g_configSettings->StatsSharedMemoryName));
+        }
+        if (g_configSettings->CheckpointFilename)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tCheckpoint file: %ws (every %lu ms)\n",
+                    g_configSettings->CheckpointFilename,
+                    g_configSettings->CheckpointIntervalMilliseconds));
+        }
+        if (g_configSettings->PayloadFilename)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tPayload: %ws (repeating every %lu bytes)\n",
+                    g_configSettings->PayloadFilename,
+                    g_configSettings->PayloadPatternSize));
+        }
+        if (g_completionEngine)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tCompletionEngine: dedicated (%Iu threads)\n",
+                    g_completionEngine->thread_count()));
+        }
+        if (g_configSettings->UseNumaThreadpools)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tThreadpools: one per NUMA node (%Iu nodes)\n",
+                    g_numaThreadpools.size()));
+        }
+        if (g_configSettings->WorkerProcesses > 0)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tWorker processes: %lu (ports %u through %u)\n",
+                    g_configSettings->WorkerProcesses,
+                    static_cast<unsigned>(g_configSettings->Port),
+                    static_cast<unsigned>(g_configSettings->Port + g_configSettings->WorkerProcesses - 1)));
+        }
 
         if (0 == g_transferSizeHigh)
         {
@@ -4260,32 +11194,74 @@ namespace ctsTraffic::ctsConfig
 
         if (ProtocolType::UDP == g_configSettings->Protocol)
         {
-            settingString.append(
-                wil::str_printf<std::wstring>(
-                    L"\t\tUDP Stream BitsPerSecond: %lld bits per second\n",
-                    static_cast<long long>(g_mediaStreamSettings.BitsPerSecond)));
-            settingString.append(
-                wil::str_printf<std::wstring>(
-                    L"\t\tUDP Stream FrameRate: %lu frames per second\n",
-                    static_cast<unsigned long>(g_mediaStreamSettings.FramesPerSecond)));
-
-            if (g_mediaStreamSettings.BufferDepthSeconds > 0)
+            if (g_configSettings->UdpBlast)
             {
                 settingString.append(
                     wil::str_printf<std::wstring>(
-                        L"\t\tUDP Stream BufferDepth: %lu seconds\n",
-                        static_cast<unsigned long>(g_mediaStreamSettings.BufferDepthSeconds)));
+                        L"\t\tUDP Blast StreamLength: %lu seconds\n",
+                        static_cast<unsigned long>(g_mediaStreamSettings.StreamLengthSeconds)));
             }
+            else
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\t\tUDP Stream BitsPerSecond: %lld bits per second\n",
+                        static_cast<long long>(g_mediaStreamSettings.BitsPerSecond)));
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\t\tUDP Stream FrameRate: %lu frames per second\n",
+                        static_cast<unsigned long>(g_mediaStreamSettings.FramesPerSecond)));
 
-            settingString.append(
-                wil::str_printf<std::wstring>(
-                    L"\t\tUDP Stream StreamLength: %lu seconds (%lu frames)\n",
-                    static_cast<unsigned long>(g_mediaStreamSettings.StreamLengthSeconds),
-                    static_cast<unsigned long>(g_mediaStreamSettings.StreamLengthFrames)));
-            settingString.append(
-                wil::str_printf<std::wstring>(
-                    L"\t\tUDP Stream FrameSize: %lu bytes\n",
-                    static_cast<unsigned long>(g_mediaStreamSettings.FrameSizeBytes)));
+                if (g_mediaStreamSettings.BufferDepthSeconds > 0)
+                {
+                    settingString.append(
+                        wil::str_printf<std::wstring>(
+                            L"\t\tUDP Stream BufferDepth: %lu seconds\n",
+                            static_cast<unsigned long>(g_mediaStreamSettings.BufferDepthSeconds)));
+                }
+
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\t\tUDP Stream StreamLength: %lu seconds (%lu frames)\n",
+                        static_cast<unsigned long>(g_mediaStreamSettings.StreamLengthSeconds),
+                        static_cast<unsigned long>(g_mediaStreamSettings.StreamLengthFrames)));
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\t\tUDP Stream FrameSize: %lu bytes\n",
+                        static_cast<unsigned long>(g_mediaStreamSettings.FrameSizeBytes)));
+                if (!g_mediaStreamSettings.FrameSizePattern.empty())
+                {
+                    settingString.append(
+                        wil::str_printf<std::wstring>(
+                            L"\t\tUDP Stream variable FrameSize: averaging %lu bytes, up to %lu bytes (a pattern of %Iu frames)\n",
+                            static_cast<unsigned long>(g_mediaStreamSettings.FrameSizeBytes),
+                            static_cast<unsigned long>(g_mediaStreamSettings.MaxFrameSizeBytes),
+                            g_mediaStreamSettings.FrameSizePattern.size()));
+                }
+            }
+            if (g_configSettings->UdpSendOffload)
+            {
+                settingString.append(L"\t\tUDP Send Offload: on\n");
+            }
+            if (g_configSettings->ContiguousDatagrams)
+            {
+                settingString.append(L"\t\tUDP Contiguous Datagrams: on (headers formatted in per-stream send slabs)\n");
+            }
+            if (g_configSettings->UdpRecvOffload)
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\t\tUDP Receive Offload: on (coalescing up to %lu bytes per receive)\n",
+                        ctsConfigSettings::c_UdpRecvMaxCoalescedSize));
+            }
+            if (g_configSettings->UdpRecvTimestamps)
+            {
+                settingString.append(L"\t\tUDP Receive Timestamps: on (jitter measured from the stack's receive timestamps)\n");
+            }
+            if (g_configSettings->MultiplexMediaStreams)
+            {
+                settingString.append(L"\t\tMultiplexed Streams: on (sharing one socket per processor to each server)\n");
+            }
         }
 
         if (ProtocolType::TCP == g_configSettings->Protocol && g_rateLimitLow > 0)
@@ -4304,6 +11280,29 @@ namespace ctsTraffic::ctsConfig
                         L"\tSending throughput rate limited down to a range of [%lld, %lld] bytes/second\n",
                         g_rateLimitLow, g_rateLimitHigh));
             }
+            if (g_configSettings->RateLimitPacing)
+            {
+                settingString.append(L"\t\tPacing each send evenly at the rate limit\n");
+            }
+            if (g_configSettings->RateSearchStepMilliseconds > 0)
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\t\tSearching the range for the highest sustainable rate (%lu ms per step)\n",
+                        g_configSettings->RateSearchStepMilliseconds));
+            }
+        }
+        if (g_configSettings->LoadProfile)
+        {
+            settingString.append(
+                wil::str_printf<std::wstring>(
+                    L"\tLoad profile: %Iu segments over %lld ms, the connections and the rate limit following each segment\n",
+                    g_loadProfile.size(),
+                    g_loadProfileDurationMilliseconds));
+            if (g_configSettings->RateLimitPacing)
+            {
+                settingString.append(L"\t\tPacing each send evenly at the rate limit\n");
+            }
         }
 
         if (g_netAdapterAddresses != nullptr)
@@ -4326,6 +11325,44 @@ namespace ctsTraffic::ctsConfig
                     settingString.append(L"\n");
                 }
             }
+            if (!g_configSettings->RelayAddresses.empty())
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\tRelaying connections to addresses (%lu buffers per direction):\n", g_configSettings->RelayBufferCount));
+                for (const auto& addr : g_configSettings->RelayAddresses)
+                {
+                    if (addr.WriteCompleteAddress(wsaddress))
+                    {
+                        settingString.append(L"\t\t");
+                        settingString.append(wsaddress);
+                        settingString.append(L"\n");
+                    }
+                }
+            }
+            if (g_configSettings->PrePostAcceptsHigh > g_configSettings->PrePostAcceptsLow)
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\tAcceptEx requests posted per listener: adapting within [%lu, %lu]\n",
+                        g_configSettings->PrePostAcceptsLow, g_configSettings->PrePostAcceptsHigh));
+            }
+            else if (g_configSettings->PrePostAcceptsLow > 0)
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        IoPatternType::MediaStream == g_configSettings->IoPattern ?
+                            L"\tWSARecvFrom requests posted per listener: %lu\n" :
+                            L"\tAcceptEx requests posted per listener: %lu\n",
+                        g_configSettings->PrePostAcceptsLow));
+            }
+            if (g_configSettings->AcceptQueueCount > 0)
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\tAccept queues: %lu (AcceptEx requests posted per listener are per queue)\n",
+                        g_configSettings->AcceptQueueCount));
+            }
 
         }
         else
@@ -4339,12 +11376,20 @@ namespace ctsTraffic::ctsConfig
 
             settingString.append(L"\tConnecting out to addresses:\n");
             WCHAR wsaddress[c_ipStringMaxLength]{};
-            for (const auto& addr : g_configSettings->TargetAddresses)
+            for (size_t target = 0; target < g_configSettings->TargetAddresses.size(); ++target)
             {
-                if (addr.WriteCompleteAddress(wsaddress))
+                if (g_configSettings->TargetAddresses[target].WriteCompleteAddress(wsaddress))
                 {
                     settingString.append(L"\t\t");
+                    if (!g_configSettings->TargetStatusDetails.empty())
+                    {
+                        settingString.append(wil::str_printf<std::wstring>(L"T%Iu: ", target + 1));
+                    }
                     settingString.append(wsaddress);
+                    if (!g_configSettings->TargetWeights.empty())
+                    {
+                        settingString.append(wil::str_printf<std::wstring>(L" (weight %lu)", g_configSettings->TargetWeights[target]));
+                    }
                     settingString.append(L"\n");
                 }
             }
@@ -4377,17 +11422,31 @@ namespace ctsTraffic::ctsConfig
                             g_configSettings->LocalPortLow, g_configSettings->LocalPortHigh));
                 }
             }
+            if (g_configSettings->PortReservationSize > 0)
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\tReserving %lu local ports for outgoing connections (SIO_ACQUIRE_PORT_RESERVATION)\n",
+                        g_configSettings->PortReservationSize));
+            }
 
             settingString.append(
                 wil::str_printf<std::wstring>(
                     L"\tConnection limit (maximum established connections): %u [0x%x]\n",
                     static_cast<unsigned long>(g_configSettings->ConnectionLimit),
                     static_cast<unsigned long>(g_configSettings->ConnectionLimit)));
-            settingString.append(
-                wil::str_printf<std::wstring>(
-                    L"\tConnection throttling rate (maximum pended connection attempts): %u [0x%x]\n",
-                    static_cast<unsigned long>(g_configSettings->ConnectionThrottleLimit),
-                    static_cast<unsigned long>(g_configSettings->ConnectionThrottleLimit)));
+            if (g_configSettings->AdaptiveConnectionThrottle)
+            {
+                settingString.append(L"\tConnection throttling rate (maximum pended connection attempts): adapting to the sustainable connection rate\n");
+            }
+            else
+            {
+                settingString.append(
+                    wil::str_printf<std::wstring>(
+                        L"\tConnection throttling rate (maximum pended connection attempts): %u [0x%x]\n",
+                        static_cast<unsigned long>(g_configSettings->ConnectionThrottleLimit),
+                        static_cast<unsigned long>(g_configSettings->ConnectionThrottleLimit)));
+            }
         }
         // calculate total connections
         if (g_configSettings->AcceptFunction)
@@ -4436,6 +11495,17 @@ namespace ctsTraffic::ctsConfig
             }
         }
 
+        if (!g_hostConfiguration.empty())
+        {
+            settingString.append(L"\n  Host Configuration  \n");
+            settingString.append(L"----------------------\n");
+            settingString.append(g_hostConfiguration);
+            for (const auto& warning : g_hostConfigurationWarnings)
+            {
+                settingString.append(wil::str_printf<std::wstring>(L"\tWARNING: %ws\n", warning.c_str()));
+            }
+        }
+
         settingString.append(L"\n");
 
         // immediately print the legend once we know the status info object
@@ -25,6 +25,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // ctl headers
 #include <ctTimer.hpp>
 #include <ctSockaddr.hpp>
+#include <ctThreadIocp.hpp>
 //
 // ** NOTE ** cannot include local project cts headers to avoid circular references
 // - with the below exceptions : these do not include any cts* headers
@@ -74,7 +75,26 @@ namespace ctsTraffic
             Pull,
             PushPull,
             Duplex,
-            MediaStream
+            MediaStream,
+            RequestResponse,
+            Heartbeat
+        };
+
+        // -TlsCipher : the cipher -io:tls sessions are restricted to
+        enum class TlsCipherType
+        {
+            NoCipherSet,
+            Aes128,
+            Aes256,
+            ChaCha20
+        };
+
+        // -TlsProtocol : the TLS version -io:tls sessions are restricted to
+        enum class TlsProtocolType
+        {
+            NoProtocolSet,
+            Tls12,
+            Tls13
         };
 
         enum class StatusFormatting
@@ -99,7 +119,14 @@ namespace ctsTraffic
             SetSendBuf = 0x0040,
             EnableCircularQueueing = 0x0080,
             MsgWaitAll = 0x0100,
-            // next enum  = 0x0200
+            ZeroByteRecv = 0x0200,
+            // -IO:transmitpackets : ctsSendRecvIocp sends with TransmitPackets instead of WSASend
+            TransmitPackets = 0x0400,
+            // -Options:TcpFastOpen : TCP_FASTOPEN is set on every TCP socket, the ConnectEx send data riding in the SYN
+            TcpFastOpen = 0x0800,
+            // -Options:NoDelay : TCP_NODELAY is set on every TCP socket, disabling Nagle's coalescing of small sends
+            NoDelay = 0x1000,
+            // next enum  = 0x2000
         };
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -174,14 +201,86 @@ namespace ctsTraffic
             long long m_sequenceNumber = 0LL;
             long long m_senderQpc = 0LL;
             long long m_senderQpf = 0LL;
+            // the stack's receive timestamp with -UdpRecvTimestamps, else the same as m_receiverCompletionQpc
             long long m_receiverQpc = 0LL;
+            // when the receive completed to the pattern (includes the time to schedule the completion)
+            long long m_receiverCompletionQpc = 0LL;
             long long m_receiverQpf = 0LL;
             double m_estimatedTimeInFlightMs = 0;
         };
         void PrintJitterUpdate(const JitterFrameEntry& currentFrame, const JitterFrameEntry& previousFrame) noexcept;
 
+        // the per-second totals written with -JitterSummaryFilename
+        struct JitterSummaryEntry
+        {
+            // seconds into the stream, from the frame sequence numbers
+            long long m_second = -1LL;
+            unsigned long m_successfulFrames = 0UL;
+            unsigned long m_droppedFrames = 0UL;
+            unsigned long m_duplicateFrames = 0UL;
+            // datagrams received after their frame was rendered
+            unsigned long m_lateDatagrams = 0UL;
+            // START requests re-sent while waiting for the server to begin streaming
+            unsigned long m_startRequests = 0UL;
+            double m_jitterSumMs = 0;
+            double m_maxJitterMs = 0;
+        };
+        void PrintJitterSummary(const JitterSummaryEntry& summary) noexcept;
+
         void PrintStatusUpdate() noexcept;
         void __cdecl PrintSummary(_In_z_ _Printf_format_string_ PCWSTR text, ...) noexcept;
+        // prints the IO latency percentiles over the complete lifetime - no-op without -LatencyPercentiles
+        void PrintLatencySummary() noexcept;
+        // writes every latency histogram bucket to the -HistogramFilename - no-op without it
+        void PrintLatencyHistograms() noexcept;
+        // prints the traffic, connection outcomes and IO latency of each target - no-op without -TargetStatistics
+        void PrintTargetSummary(long long totalTimeMilliseconds) noexcept;
+        // prints the SIO_TCP_INFO samples aggregated across all connections - no-op without -TcpInfo
+        void PrintTcpInfoSummary() noexcept;
+        // prints the transactions per second and round-trip latency percentiles - no-op unless -Pattern:RequestResponse or Heartbeat
+        void PrintTransactionSummary(long long totalTimeMilliseconds) noexcept;
+        // snap the totals at the end of -WarmUp and at the start of -CoolDown - scheduled from the status timer
+        void SnapSteadyStateStart() noexcept;
+        void SnapSteadyStateEnd() noexcept;
+        // prints the throughput and latency between the -WarmUp and -CoolDown boundaries next to the whole run
+        // - no-op without -WarmUp or -CoolDown
+        void PrintSteadyStateSummary(long long totalTimeMilliseconds) noexcept;
+        // -RateSearch : judges the rate of the current step and moves every connection to the next - scheduled from the status timer
+        void RateSearchUpdate() noexcept;
+        // prints the highest stable rate the search found - no-op without -RateSearch
+        void PrintRateSearchSummary() noexcept;
+        // -Sweep : measures the current point of the parameter grid and moves connections to the next - scheduled from the status timer
+        void SweepUpdate() noexcept;
+        // prints the throughput and CPU cost of every grid point and the best configuration - no-op without -Sweep
+        void PrintSweepSummary() noexcept;
+        // -Converge : adds the status interval just ended to the rolling window, ending the run once it converged
+        // - scheduled from the status timer
+        void ConvergenceUpdate() noexcept;
+        // prints how long the run took to converge, and the converged throughput and latency - no-op without -Converge
+        void PrintConvergenceSummary() noexcept;
+        // prints the process CPU cycles per byte, per IO and per connection over the run - no-op without -CpuEfficiency
+        void PrintCpuSummary(long long totalTimeMilliseconds) noexcept;
+        // prints the connection rate the adaptive connection throttling converged on - no-op without -ThrottleConnections:auto
+        void PrintConnectionThrottleSummary() noexcept;
+        // prints the memory held per connection and the peak process private bytes and non-paged pool - no-op without -MemoryAccounting
+        void PrintMemorySummary() noexcept;
+        // prints the sends and recvs completed inline and the number of times connections yielded - no-op without -InlineCompletionBudget
+        void PrintInlineCompletionSummary() noexcept;
+        // prints the state transitions run inline and queued, and the connections completed per second
+        // - no-op without -InlineStateTransitions or -LatencyPercentiles
+        void PrintStateTransitionSummary(long long totalTimeMilliseconds) noexcept;
+        // prints the messages per second, the send and recv calls per message and how the sends were coalesced
+        // - no-op without -MessageSize
+        void PrintMessageSummary(long long totalTimeMilliseconds) noexcept;
+        // prints the time and throughput of the first transfer over each connection against the transfers which followed it
+        // - no-op without -PersistentTransfers
+        void PrintPersistentTransferSummary() noexcept;
+        // prints the round-trip latency percentiles of the probe pings made alongside the bulk connections - no-op without -Probes
+        void PrintProbeSummary() noexcept;
+        // prints the datagrams sent, received, lost and reordered per second over the run - no-op without -Pattern:Blast
+        void PrintBlastSummary() noexcept;
+        // prints the number of messages the file loggers dropped when they could not keep up - no-op if none were dropped
+        void PrintDroppedLogMessages() noexcept;
 
         // Putting PrintDebugInfo as a macro to avoid running any code for debug printing if not necessary
 #define PRINT_DEBUG_INFO(fmt, ...)                                            \
@@ -218,6 +317,36 @@ namespace ctsTraffic
         void PrintConnectionResults(const ctl::ctSockaddr& localAddr, const ctl::ctSockaddr& remoteAddr, unsigned long error, const ctsUdpStatistics& stats) noexcept;
         void PrintConnectionResults(unsigned long error) noexcept;
 
+        // -LoadProfile : the connections to keep established and the rate limit of each, at a point in the run
+        struct ctsLoadProfileSetpoint
+        {
+            unsigned long m_connections = 0;
+            // zero is unlimited
+            long long m_bytesPerSecond = 0;
+        };
+        // evaluates the profile at the current time, publishing the rate read by GetTcpBytesPerSecond
+        // - scheduled from the ctsSocketBroker timer
+        ctsLoadProfileSetpoint UpdateLoadProfile() noexcept;
+        // the setpoint last published by UpdateLoadProfile
+        ctsLoadProfileSetpoint GetLoadProfileSetpoint() noexcept;
+
+        // -HostCounters : the host processor time, network adapter rates and TCP retransmissions over a TimeSlice period
+        struct ctsHostCounterSample
+        {
+            // percents of all processors
+            float m_processorPercent = 0.0f;
+            float m_dpcPercent = 0.0f;
+            float m_interruptPercent = 0.0f;
+            // summed across every network adapter
+            long long m_adapterBytesPerSecond = 0;
+            long long m_adapterPacketsPerSecond = 0;
+            // TCPv4 and TCPv6 segments retransmitted by the host, not only by this process
+            long long m_tcpRetransmitsPerSecond = 0;
+        };
+        // the counters sampled by the status update being printed
+        // - all zero without -HostCounters
+        ctsHostCounterSample GetHostCounterSample() noexcept;
+
         // Get* functions
         ctsSignedLongLong GetTcpBytesPerSecond() noexcept;
         ctsUnsignedLong GetMaxBufferSize() noexcept;
@@ -230,10 +359,30 @@ namespace ctsTraffic
         int  GetListenBacklog() noexcept;
         bool IsListening() noexcept;
 
+        // -io:memory : the server side of each connection runs its ctsIoPattern on the client's threads
+        // - IsListening() reports the given role on the calling thread while this scope is alive
+        class ctsListeningRoleScope
+        {
+        public:
+            explicit ctsListeningRoleScope(bool listening) noexcept;
+            ~ctsListeningRoleScope() noexcept;
+
+            ctsListeningRoleScope(const ctsListeningRoleScope&) = delete;
+            ctsListeningRoleScope& operator=(const ctsListeningRoleScope&) = delete;
+            ctsListeningRoleScope(ctsListeningRoleScope&&) = delete;
+            ctsListeningRoleScope& operator=(ctsListeningRoleScope&&) = delete;
+
+        private:
+            const int m_priorRole;
+        };
+
         // Set* functions
         int SetPreBindOptions(SOCKET socket, const ctl::ctSockaddr& localAddress) noexcept;
         int SetPreConnectOptions(SOCKET) noexcept;
 
+        // creates the ctThreadIocp on which IO for this socket completes (can throw)
+        std::shared_ptr<ctl::ctThreadIocp> CreateSocketThreadIocp(SOCKET socket);
+
         // for the MediaStream pattern
         struct MediaStreamSettings
         {
@@ -242,10 +391,27 @@ namespace ctsTraffic
             ctsUnsignedLong FramesPerSecond = 0;
             ctsUnsignedLong BufferDepthSeconds = 0;
             ctsUnsignedLong StreamLengthSeconds = 0;
+            // -GopPattern or -FrameTrace : the relative size of each frame in a pattern repeated across the stream
+            // - empty when every frame is the same size
+            std::vector<unsigned long> FrameSizeWeights;
             // internally calculated
+            // - with FrameSizeWeights, FrameSizeBytes is the average frame size
             ctsUnsignedLong FrameSizeBytes = 0;
+            ctsUnsignedLong MaxFrameSizeBytes = 0;
             ctsUnsignedLong StreamLengthFrames = 0;
             ctsUnsignedLong BufferedFrames = 0;
+            // the size of each frame in the repeated pattern : FrameSizeWeights scaled to the average FrameSizeBytes
+            std::vector<unsigned long> FrameSizePattern;
+
+            // frames are sequenced starting at 1
+            unsigned long GetFrameSizeBytes(long long sequenceNumber) const noexcept
+            {
+                if (FrameSizePattern.empty() || sequenceNumber < 1)
+                {
+                    return FrameSizeBytes;
+                }
+                return FrameSizePattern[static_cast<size_t>((sequenceNumber - 1) % static_cast<long long>(FrameSizePattern.size()))];
+            }
 
             ctsUnsignedLongLong CalculateTransferSize()
             {
@@ -303,6 +469,7 @@ namespace ctsTraffic
                     throw std::invalid_argument("The frame size is too small - it must be at least 40 bytes");
                 }
                 StreamLengthFrames = static_cast<unsigned long>(totalStreamLengthFrames);
+                MaxFrameSizeBytes = FrameSizeBytes;
 
                 // guarantee frame alignment
                 FAIL_FAST_IF_MSG(
@@ -310,6 +477,58 @@ namespace ctsTraffic
                     "FrameSizeBytes (%u) * StreamLengthFrames (%u) != TotalStreamLength (%llx)",
                     static_cast<unsigned long>(FrameSizeBytes), static_cast<unsigned long>(StreamLengthFrames), static_cast<unsigned long long>(totalStreamLengthBytes));
 
+                if (!FrameSizeWeights.empty())
+                {
+                    totalStreamLengthBytes = CalculateFrameSizePattern();
+                }
+
+                return totalStreamLengthBytes;
+            }
+
+            // scales FrameSizeWeights so the pattern averages FrameSizeBytes : returns the total bytes of the stream
+            ctsUnsignedLongLong CalculateFrameSizePattern()
+            {
+                ctsUnsignedLongLong totalWeight = 0ULL;
+                for (const auto weight : FrameSizeWeights)
+                {
+                    totalWeight += weight;
+                }
+                if (0ULL == totalWeight)
+                {
+                    throw std::invalid_argument("The frame sizes of -GopPattern or -FrameTrace cannot all be zero");
+                }
+
+                const ctsUnsignedLongLong patternBytes = static_cast<unsigned long long>(static_cast<unsigned long>(FrameSizeBytes)) * FrameSizeWeights.size();
+                FrameSizePattern.clear();
+                FrameSizePattern.reserve(FrameSizeWeights.size());
+                MaxFrameSizeBytes = 0UL;
+                for (const auto weight : FrameSizeWeights)
+                {
+                    const ctsUnsignedLongLong frameBytes = patternBytes * weight / totalWeight;
+                    if (frameBytes > MAXULONG32)
+                    {
+                        throw std::invalid_argument("The largest frame size in bytes exceeds the maximum allowed to be streamed (2^32)");
+                    }
+                    // every frame must still hold the datagram header
+                    FrameSizePattern.push_back(frameBytes < 40ULL ? 40UL : static_cast<unsigned long>(frameBytes));
+                    if (FrameSizePattern.back() > MaxFrameSizeBytes)
+                    {
+                        MaxFrameSizeBytes = FrameSizePattern.back();
+                    }
+                }
+
+                // whole repetitions of the pattern, then the frames of the last partial repetition
+                const auto patternFrames = static_cast<unsigned long>(FrameSizePattern.size());
+                ctsUnsignedLongLong totalPatternBytes = 0ULL;
+                for (const auto frameBytes : FrameSizePattern)
+                {
+                    totalPatternBytes += frameBytes;
+                }
+                ctsUnsignedLongLong totalStreamLengthBytes = totalPatternBytes * (static_cast<unsigned long>(StreamLengthFrames) / patternFrames);
+                for (unsigned long frame = 0; frame < static_cast<unsigned long>(StreamLengthFrames) % patternFrames; ++frame)
+                {
+                    totalStreamLengthBytes += FrameSizePattern[frame];
+                }
                 return totalStreamLengthBytes;
             }
         };
@@ -347,44 +566,225 @@ namespace ctsTraffic
             WORD  Port = 0;
 
             unsigned long long Iterations = 0;
+            // -PersistentTransfers : the back-to-back transfers of -Transfer bytes made over each TCP connection
+            unsigned long PersistentTransfers = 1;
             unsigned long long ServerExitLimit = 0;
             unsigned long AcceptLimit = 0;
+            // AcceptEx requests kept posted per listener - adapting within [low,high] to the accept rate
+            // - for MediaStream servers, the fixed number of WSARecvFrom requests kept posted per listening socket
+            // - zero unless listening with AcceptEx or MediaStream
+            unsigned long PrePostAcceptsLow = 0;
+            unsigned long PrePostAcceptsHigh = 0;
+            // -AcceptQueues : the AcceptEx requests on each listener are split across this many accept queues
+            // - 0 == a single accept queue shared by every processor
+            unsigned long AcceptQueueCount = 0;
             unsigned long ConnectionLimit = 0;
             unsigned long ConnectionThrottleLimit = 0;
+            // -ThrottleConnections:auto : the broker adapts the pending-connect window instead of the fixed ConnectionThrottleLimit
+            // - the broker saves the highest connection rate it sustained without backing off, and the window it was reached with
+            bool AdaptiveConnectionThrottle = false;
+            double SustainedConnectionRate = 0.0;
+            unsigned long SustainedConnectionThrottleLimit = 0;
 
             std::vector<ctl::ctSockaddr> ListenAddresses{};
             std::vector<ctl::ctSockaddr> TargetAddresses{};
             std::vector<ctl::ctSockaddr> BindAddresses{};
+            // -TargetWeights : the weight of each of the TargetAddresses (empty when connections are made round-robin)
+            // - TargetOrder holds the indexes of the TargetAddresses in the order new connections are made to them
+            std::vector<unsigned long> TargetWeights{};
+            std::vector<size_t> TargetOrder{};
+            // -TargetStatistics:on : the statistics of each of the TargetAddresses (empty when not tracked)
+            std::vector<std::unique_ptr<ctsTargetStatistics>> TargetStatusDetails{};
+
+            // TCP IO latency percentiles to print - latency is only tracked when not empty
+            std::vector<double> LatencyPercentiles{};
 
             // stats for status updates and summaries
             ctsConnectionStatistics ConnectionStatusDetails;
-            ctsTcpStatistics TcpStatusDetails;
-            ctsUdpStatistics UdpStatusDetails;
+            ctsStateTransitionStatistics StateTransitionDetails;
+            ctsTcpStatusStatistics TcpStatusDetails;
+            ctsUdpStatusStatistics UdpStatusDetails;
+            // -MemoryAccounting:on : the memory held by each connection and the process samples with each status update
+            bool AccountConnectionMemory = false;
+            ctsConnectionMemoryStatistics ConnectionMemoryDetails;
 
             unsigned long StatusUpdateFrequencyMilliseconds = 0;
+            // -StatsSharedMemory : the name of the shared-memory region the running totals are written to
+            const wchar_t* StatsSharedMemoryName = nullptr;
+            // -CheckpointFilename : the file the running totals and histograms are appended to every CheckpointIntervalMilliseconds
+            const wchar_t* CheckpointFilename = nullptr;
+            unsigned long CheckpointIntervalMilliseconds = 0;
+            // -Workers : the worker processes this process starts to run the connections (0 when running them itself)
+            // - each worker writes its running totals to the region named by its -WorkerStatsSharedMemory
+            unsigned long WorkerProcesses = 0;
+            const wchar_t* WorkerStatsSharedMemoryName = nullptr;
+            // -ThreadStatistics : per-thread completion counters are written to the status file with each status update
+            bool PrintThreadStatistics = false;
+            // -HostConfiguration : the adapter RSS/offload settings and power plan are recorded with the settings
+            bool RecordHostConfiguration = true;
+            // 0 == SIO_TCP_INFO is not sampled
+            unsigned long TcpInfoIntervalMilliseconds = 0;
+            // 0 == the throughput of each connection is not sampled (-ConnectionSamples)
+            unsigned long ConnectionSampleIntervalMilliseconds = 0;
+            // -ConnectionLog:aggregate : connection outcomes are written with each status update instead of per connection
+            bool ConnectionLogAggregate = false;
+            // -ConnectionLogSamples : the connections of each status update also written in full
+            unsigned long ConnectionLogSamples = 0;
 
             long long TcpBytesPerSecondPeriod = 100LL;
             long long StartTimeMilliseconds = 0;
 
             unsigned long TimeLimit = 0;
+            // -WarmUp and -CoolDown : the milliseconds at the start and the end of the run excluded from the steady-state summary
+            unsigned long WarmUpMilliseconds = 0;
+            unsigned long CoolDownMilliseconds = 0;
+            // -RateSearch : the milliseconds each rate is run for while searching the -RateLimit range (0 when not searching)
+            unsigned long RateSearchStepMilliseconds = 0;
+            // -LoadProfile : the connection target and rate limit follow the segments of a profile file through the run
+            bool LoadProfile = false;
+            // -Converge : the run ends once the throughput of the last ConvergenceWindow status intervals
+            // is known to within this percent (0 when not watching for convergence)
+            double ConvergenceTolerancePercent = 0.0;
+            unsigned long ConvergenceWindow = 10;
+            // -Sweep : the milliseconds each point of the parameter grid is measured for (0 when not sweeping)
+            unsigned long SweepStepMilliseconds = 0;
+            // -Sweep : the grid point new connections take their settings from, and the connections of each point not yet closed
+            // - empty when not sweeping
+            long SweepPoint = 0;
+            std::vector<long> SweepPointConnections;
             unsigned long PrePostRecvs = 0;
             unsigned long PrePostSends = 0;
             unsigned long RecvBufValue = 0;
             unsigned long SendBufValue = 0;
+            // -RecvBufValue:auto, -SendBufValue:auto : SO_RCVBUF and SO_SNDBUF are sized per connection to the
+            // bandwidth-delay product measured over its first IO (SO_SNDBUF also sizing the bytes of sends kept in flight)
+            bool AutoRecvBuf = false;
+            bool AutoSendBuf = false;
             unsigned long KeepAliveValue = 0;
 
             unsigned long PushBytes = 0;
             unsigned long PullBytes = 0;
 
+            // -Pattern:RequestResponse : the client keeps up to PipelineDepth requests outstanding
+            unsigned long RequestBytes = 0;
+            unsigned long ResponseBytes = 0;
+            unsigned long PipelineDepth = 0;
+            // -Pattern:Heartbeat : a RequestResponse exchange of one request-sized message at each interval
+            unsigned long HeartbeatIntervalMilliseconds = 0;
+            // -Probes : clients keep ProbeConnections open to the ProbePort alongside the bulk connections,
+            // each waiting ProbeIntervalMilliseconds after every echo before its next ping
+            // - servers also listen on the ProbePort when non-zero
+            unsigned long ProbeConnections = 0;
+            unsigned long ProbeIntervalMilliseconds = 0;
+            WORD ProbePort = 0;
+
             unsigned long OutgoingIfIndex = 0;
 
+            // 0 == a single RIO CQ shared across all RIO worker threads
+            unsigned long RioCompletionQueueCount = 0;
+            // consecutive empty polls before a RIO polling thread yields its processor (0 == never yield)
+            unsigned long RioPollSpinCount = 1000;
+            // 0 == adapt the RIORESULT batch dequeued from a RIO CQ to the completion rate
+            unsigned long RioDequeueBatchSize = 0;
+            // -XdpQueues : the RSS queues of the sending interface each bound to an AF_XDP socket with -io:xdp
+            unsigned long XdpQueueCount = 1;
+            // -BufferSegments : TCP sends and recvs are posted as a list of this many WSABUFs
+            // - the first being BufferSegmentHeaderLength bytes when set
+            unsigned long BufferSegments = 1;
+            unsigned long BufferSegmentHeaderLength = 0;
+            // -MessageSize : TCP sends are made one message of this many bytes at a time (0 == sized by -Buffer)
+            // - recvs are still posted with -Buffer so the messages each completes show how the sends were coalesced
+            unsigned long MessageSize = 0;
+            // -AckFrequency : set with SIO_TCP_SET_ACK_FREQUENCY on every TCP socket (0 == the system default)
+            unsigned long AckFrequency = 0;
+            // -InlineCompletionBudget : the sends and recvs, or the microseconds, a connection may complete inline
+            // before yielding its thread to the threadpool (0 == never yield)
+            unsigned long InlineCompletionBudget = 0;
+            unsigned long InlineCompletionBudgetMicroseconds = 0;
+            // -InlineStateTransitions : connecting and initiating IO run on the thread completing the prior state when it holds no locks
+            bool InlineStateTransitions = false;
+
             unsigned short LocalPortLow = 0;
             unsigned short LocalPortHigh = 0;
+            // -PortReservation : the number of ports reserved for outgoing connections (0 when not reserving ports)
+            unsigned long PortReservationSize = 0;
 
             bool UseSharedBuffer = false;
+            // -ConnectData : the connection ID is sent with ConnectEx and received with AcceptEx
+            bool ExchangeConnectionIdOnConnect = false;
+            // -LeanProtocol : clients send a binary connection ID ahead of their IO, and the transfer ends with the FIN
+            // instead of the server's completion message
+            bool LeanProtocol = false;
+            // -SocketReuse : closed TCP sockets are disconnected with DisconnectEx(TF_REUSE_SOCKET)
+            // and pooled with their IOCP association for the next ConnectEx or AcceptEx
+            bool ReuseSockets = false;
+            // -PrecreateSockets : client sockets are created, bound and associated with their IOCP before the run starts
+            bool PrecreateSockets = false;
+            // -Relay : servers forward each accepted connection over a connection they make to the next of these addresses
+            std::vector<ctl::ctSockaddr> RelayAddresses{};
+            // -RelayBuffers : the buffers (each the -Buffer size) forwarding each direction of a relayed connection
+            unsigned long RelayBufferCount = 2;
+            // -io:tls : the subject of the server's certificate, which clients also give as their target name
+            const wchar_t* TlsCertificateName = nullptr;
+            TlsCipherType TlsCipher = TlsCipherType::NoCipherSet;
+            TlsProtocolType TlsProtocol = TlsProtocolType::NoProtocolSet;
+            // -TlsResumption:off : every connection negotiates a full handshake
+            bool TlsResumption = true;
+            // the process-wide send and recv buffers are allocated on large pages (when the privilege is held)
+            // and replicated on every NUMA node so each IO uses the replica local to its processor
+            bool UseLargePages = false;
+            bool UseNumaLocalBuffers = false;
+            // -PayloadFile : the payload repeats the content of this file (every PayloadPatternSize bytes)
+            // instead of the synthetic buffer pattern
+            const wchar_t* PayloadFilename = nullptr;
+            unsigned long PayloadPatternSize = 0;
+            // socket IO completes on a per-NUMA-node threadpool chosen from the connection's RSS processor
+            bool UseNumaThreadpools = false;
+            // socket IO completes on dedicated threads, each draining its own completion port, instead of the threadpool
+            bool UseDedicatedCompletionThreads = false;
             bool ShouldVerifyBuffers = false;
+            // -verify:seeded : TCP connections send their own payload generated from their connection ID,
+            // which receivers regenerate to verify instead of comparing with the shared buffer pattern
+            bool SeededPayload = false;
+            // -CpuEfficiency : process CPU cycles per byte, per IO and per connection are added to the status and summary
+            // - with -CpuEfficiency:detailed the kernel and user time are also broken out
+            bool PrintCpuEfficiency = false;
+            bool PrintCpuTimes = false;
+            // the process CPU consumed when the engine was started - the baseline for the summary
+            ctsCpuSnapshot StartCpu{};
+            // -HostCounters : the host processor, network adapter and TCP counters are sampled with each TCP status update
+            bool HostCounters = false;
+            // TCP senders embed a CRC32C per block of the buffer pattern which receivers verify instead of the full pattern
+            bool ShouldVerifyChecksums = false;
+            bool RioPollCompletions = false;
+            // -io:xdp : MediaStream servers write every datagram directly into AF_XDP TX rings, bypassing the host stack
+            bool XdpSend = false;
+            // MediaStream servers send each frame with a single UDP_SEND_MSG_SIZE (USO) send
+            bool UdpSendOffload = false;
+            // -Pattern:Blast : the MediaStream protocol without pacing - servers send datagrams as fast as they complete
+            // and clients count the datagrams lost and reordered by their sequence numbers (IoPattern remains MediaStream)
+            bool UdpBlast = false;
+            // -ContiguousDatagrams:on : MediaStream servers send each datagram as one buffer, its header formatted in a send slab
+            bool ContiguousDatagrams = false;
+            // UDP sockets enable UDP_RECV_MAX_COALESCED_SIZE (URO) and clients split each coalesced receive into its datagrams
+            bool UdpRecvOffload = false;
+            // -UdpRecvTimestamps:on : MediaStream clients enable SIO_TIMESTAMPING receive timestamps to measure jitter from
+            bool UdpRecvTimestamps = false;
+            // -MultiplexStreams:on : MediaStream clients share UDP sockets across streams, demultiplexed by each stream's ID
+            bool MultiplexMediaStreams = false;
+            // -RateLimitPacing:on : each rate-limited send is delayed to its own departure time (microsecond resolution)
+            // instead of sending each -RateLimitPeriod quantum of bytes back to back
+            bool RateLimitPacing = false;
+            // -io:memory : connections are paired with an in-process server IO pattern instead of using sockets
+            bool MemoryTransport = false;
 
             static const DWORD c_CriticalSectionSpinlock = 500ul;
+            static const unsigned long c_RioMaxDequeueBatchSize = 1024ul;
+            // bounded by the width of the status output
+            static const unsigned long c_MaxLatencyPercentiles = 4ul;
+            static const unsigned long c_MaxTargetStatistics = 8ul;
+            // the largest UDP payload which can be coalesced into a single receive (64KB minus the UDP header)
+            static const unsigned long c_UdpRecvMaxCoalescedSize = 65527ul;
         };
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -395,6 +795,64 @@ namespace ctsTraffic
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         extern ctsConfigSettings* g_configSettings;
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// The settings read on every IO, with their flag tests already evaluated
+        /// - written once at the end of Startup and never again: a single cache line which stays shared
+        ///   across processors, unlike ctsConfigSettings which also holds the statistics written per IO
+        /// - IO functions hold the reference from GetFrozenSettings() instead of reading through g_configSettings
+        ///
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        struct alignas(64) ctsFrozenSettings
+        {
+            OptionType m_options = NoOptionSet;
+            DWORD m_socketFlags = 0;
+            ProtocolType m_protocol = ProtocolType::NoProtocolSet;
+            unsigned long m_prePostRecvs = 0;
+            unsigned long m_prePostSends = 0;
+            // -InlineCompletionBudget : the inline completions, or the QPC ticks, before a connection yields (0 == not budgeted)
+            unsigned long m_inlineCompletionBudget = 0;
+            long long m_inlineCompletionBudgetQpc = 0;
+
+            bool m_isTcp = false;
+            bool m_isUdp = false;
+            // WSA_FLAG_REGISTERED_IO
+            bool m_isRio = false;
+            // verifying the bytes received or their checksums
+            bool m_isVerify = false;
+            // a fixed -RateLimit, or one changed during the run by -RateSearch or -LoadProfile
+            bool m_isRateLimited = false;
+            bool m_isRateSearch = false;
+            bool m_isLoadProfile = false;
+            bool m_isInlineIocp = false;
+            bool m_isMsgWaitAll = false;
+            bool m_isZeroByteRecv = false;
+            bool m_isTransmitPackets = false;
+            // -Sweep:Buffer : the buffer size of every IO is changed during the run
+            bool m_isBufferSweep = false;
+        };
+        static_assert(sizeof(ctsFrozenSettings) == 64, "ctsFrozenSettings must fit within a single cache line");
+
+        extern ctsFrozenSettings g_frozenSettings;
+        // only valid once Startup has returned
+        inline const ctsFrozenSettings& GetFrozenSettings() noexcept
+        {
+            return g_frozenSettings;
+        }
+
+        // -TargetStatistics : the statistics tracked for connections to this target, nullptr when not tracked
+        inline ctsTargetStatistics* GetTargetStatistics(const ctl::ctSockaddr& targetAddress) noexcept
+        {
+            for (size_t index = 0; index < g_configSettings->TargetStatusDetails.size(); ++index)
+            {
+                if (g_configSettings->TargetAddresses[index] == targetAddress)
+                {
+                    return g_configSettings->TargetStatusDetails[index].get();
+                }
+            }
+            return nullptr;
+        }
+
         SOCKET CreateSocket(int af, int type, int protocol, DWORD dwFlags);
         bool ShutdownCalled() noexcept;
         unsigned long ConsoleVerbosity() noexcept;
@@ -22,6 +22,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <ctSockaddr.hpp>
 // project headers
 #include "ctsSocket.h"
+#include "ctsSocketState.h"
 
 namespace ctsTraffic
 {
@@ -29,7 +30,8 @@ namespace ctsTraffic
     static void ctsConnectExIoCompletionCallback(
         OVERLAPPED* overlapped,
         const std::weak_ptr<ctsSocket>& weakSocket,
-        const ctl::ctSockaddr& targetAddress) noexcept
+        const ctl::ctSockaddr& targetAddress,
+        long long connectInitiatedQpc) noexcept
     {
         auto sharedSocket(weakSocket.lock());
         if (!sharedSocket)
@@ -57,6 +59,12 @@ namespace ctsTraffic
                 {
                     gle = WSAGetLastError();
                 }
+                else if (ctsConfig::g_configSettings->ExchangeConnectionIdOnConnect && transferred != ctsStatistics::c_connectionIdLength)
+                {
+                    // the connection ID must be sent in full : the server requires all of it to start the pattern
+                    PRINT_DEBUG_INFO(L"\t\tConnectEx sent %u bytes of the connection ID\n", transferred);
+                    gle = WSAECONNABORTED;
+                }
             }
         }
         // update the socket context if completed successfully - necessary with ConnectEx
@@ -73,6 +81,12 @@ namespace ctsTraffic
 
         if (NO_ERROR == gle)
         {
+            if (connectInitiatedQpc != 0)
+            {
+                const auto completedQpc = ctl::ctTimer::SnapQpc();
+                ctsConfig::g_configSettings->TcpStatusDetails.m_connectionLatency.Record(completedQpc - connectInitiatedQpc);
+            }
+
             // store the local addr of the connection
             int localAddrLen = localAddr.length();
             if (0 == getsockname(socket, localAddr.sockaddr(), &localAddrLen))
@@ -81,7 +95,11 @@ namespace ctsTraffic
             }
         }
 
-        sharedSocket->CompleteState(gle);
+        {
+            // the connection can initiate its IO on this thread : no locks are held
+            const ctsSocketState::InlineTransitionScope inlineTransition;
+            sharedSocket->CompleteState(gle);
+        }
         // print results after completing state
         if (NO_ERROR == gle)
         {
@@ -108,12 +126,30 @@ namespace ctsTraffic
                 error = ctsConfig::SetPreConnectOptions(socket);
                 THROW_IF_WIN32_ERROR_MSG(error, "ctsConfig::SetPreConnectOptions");
 
+                // only taking the QPC when tracking connection latency
+                long long connectInitiatedQpc = 0LL;
+                if (!ctsConfig::g_configSettings->LatencyPercentiles.empty())
+                {
+                    connectInitiatedQpc = ctl::ctTimer::SnapQpc();
+                }
+                sharedSocket->SetConnectInitiatedQpc(connectInitiatedQpc);
+
+                // -ConnectData:on : the connection ID is sent within the ConnectEx request, as soon as the connection is established
+                const char* connectData = nullptr;
+                DWORD connectDataLength = 0;
+                DWORD connectDataSent = 0;
+                if (ctsConfig::g_configSettings->ExchangeConnectionIdOnConnect)
+                {
+                    connectData = sharedSocket->GenerateConnectDataId();
+                    connectDataLength = ctsStatistics::c_connectionIdLength;
+                }
+
                 // get a new IO request from the socket's TP
                 const std::shared_ptr<ctl::ctThreadIocp>& connectIocp = sharedSocket->GetIocpThreadpool();
                 OVERLAPPED* pOverlapped = connectIocp->new_request(
-                    [weakSocket, targetAddress](OVERLAPPED* pCallbackOverlapped) noexcept { ctsConnectExIoCompletionCallback(pCallbackOverlapped, weakSocket, targetAddress); });
+                    [weakSocket, targetAddress, connectInitiatedQpc](OVERLAPPED* pCallbackOverlapped) noexcept { ctsConnectExIoCompletionCallback(pCallbackOverlapped, weakSocket, targetAddress, connectInitiatedQpc); });
 
-                if (!ctl::ctConnectEx(socket, targetAddress.sockaddr(), targetAddress.length(), nullptr, 0, nullptr, pOverlapped))
+                if (!ctl::ctConnectEx(socket, targetAddress.sockaddr(), targetAddress.length(), const_cast<char*>(connectData), connectDataLength, &connectDataSent, pOverlapped))
                 {
                     error = WSAGetLastError();
                     if (ERROR_IO_PENDING == error)
@@ -134,7 +170,7 @@ namespace ctsTraffic
                     connectIocp->cancel_request(pOverlapped);
                     // directly invoke the callback to complete the IO
                     // - with a nullptr OVERLAPPED to indicate it's already completed
-                    ctsConnectExIoCompletionCallback(nullptr, weakSocket, targetAddress);
+                    ctsConnectExIoCompletionCallback(nullptr, weakSocket, targetAddress, connectInitiatedQpc);
                 }
 
                 ctsConfig::PrintErrorIfFailed("ConnectEx", error);
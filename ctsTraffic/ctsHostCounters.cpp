@@ -0,0 +1,51 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// declaration header
+#include "ctsHostCounters.h"
+// ctl headers
+#include <ctWmiPerformance.hpp>
+
+namespace ctsTraffic
+{
+    ctsHostCounters::ctsHostCounters()
+    {
+        // the processor counters of all processors together, as ctsPerf reports the _Total instance
+        m_processorTime = m_sampler.add_counter(ctl::ctWmiEnumClassName::Processor, L"PercentProcessorTime", L"_Total");
+        m_dpcTime = m_sampler.add_counter(ctl::ctWmiEnumClassName::Processor, L"PercentDPCTime", L"_Total");
+        m_interruptTime = m_sampler.add_counter(ctl::ctWmiEnumClassName::Processor, L"PercentInterruptTime", L"_Total");
+        // summed across every network adapter
+        m_adapterBytes = m_sampler.add_counter(ctl::ctWmiEnumClassName::NetworkAdapter, L"BytesTotalPersec");
+        m_adapterPackets = m_sampler.add_counter(ctl::ctWmiEnumClassName::NetworkAdapter, L"PacketsPersec");
+        m_tcpv4Retransmits = m_sampler.add_counter(ctl::ctWmiEnumClassName::TcpipTcpv4, L"SegmentsRetransmittedPersec");
+        m_tcpv6Retransmits = m_sampler.add_counter(ctl::ctWmiEnumClassName::TcpipTcpv6, L"SegmentsRetransmittedPersec");
+
+        // the first sample the rates of the first status update are calculated from
+        (void)m_sampler.collect();
+    }
+
+    void ctsHostCounters::Sample() noexcept
+    {
+        if (!m_sampler.collect())
+        {
+            return;
+        }
+
+        m_sample.m_processorPercent = static_cast<float>(m_sampler.value(m_processorTime));
+        m_sample.m_dpcPercent = static_cast<float>(m_sampler.value(m_dpcTime));
+        m_sample.m_interruptPercent = static_cast<float>(m_sampler.value(m_interruptTime));
+        m_sample.m_adapterBytesPerSecond = static_cast<long long>(m_sampler.value(m_adapterBytes));
+        m_sample.m_adapterPacketsPerSecond = static_cast<long long>(m_sampler.value(m_adapterPackets));
+        m_sample.m_tcpRetransmitsPerSecond = static_cast<long long>(m_sampler.value(m_tcpv4Retransmits) + m_sampler.value(m_tcpv6Retransmits));
+    }
+}
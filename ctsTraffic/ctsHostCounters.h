@@ -0,0 +1,66 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// ctl headers
+#include <ctPdhPerformance.hpp>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsHostCounters
+    ///
+    /// -HostCounters : samples the host processor, network adapter and TCP counters in-process
+    /// - the counters are the same PDH counters ctsPerf collects, named by their WMI class and property
+    /// - sampled from the status update itself, so each sample covers exactly the TimeSlice period
+    ///   of the status row it is printed with : no timestamps to line up with a separate ctsPerf capture
+    /// - throws if the PDH query cannot be created
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsHostCounters
+    {
+    public:
+        ctsHostCounters();
+        ~ctsHostCounters() noexcept = default;
+
+        // collects the counters for the TimeSlice period ending now
+        // - called from the status update under its lock; must not be called concurrently
+        void Sample() noexcept;
+
+        // the values collected by the last Sample()
+        [[nodiscard]] ctsConfig::ctsHostCounterSample GetSample() const noexcept
+        {
+            return m_sample;
+        }
+
+        ctsHostCounters(const ctsHostCounters&) = delete;
+        ctsHostCounters& operator=(const ctsHostCounters&) = delete;
+        ctsHostCounters(ctsHostCounters&&) = delete;
+        ctsHostCounters& operator=(ctsHostCounters&&) = delete;
+
+    private:
+        ctl::ctPdhPerformanceSampler m_sampler;
+        size_t m_processorTime = 0;
+        size_t m_dpcTime = 0;
+        size_t m_interruptTime = 0;
+        size_t m_adapterBytes = 0;
+        size_t m_adapterPackets = 0;
+        size_t m_tcpv4Retransmits = 0;
+        size_t m_tcpv6Retransmits = 0;
+        ctsConfig::ctsHostCounterSample m_sample{};
+    };
+}
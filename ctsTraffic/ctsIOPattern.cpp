@@ -17,6 +17,11 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsIOPattern.h"
 // cpp headers
 #include <vector>
+// os headers
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
 // wil headers
 #include <wil/stl.h>
 #include <wil/resource.h>
@@ -24,8 +29,10 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <ctSocketExtensions.hpp>
 #include <ctTimer.hpp>
 // project headers
+#include "ctsIOPatternBufferPolicy.hpp"
 #include "ctsMediaStreamProtocol.hpp"
 #include "ctsTCPFunctions.h"
+#include "ctsTraceLogging.h"
 
 namespace ctsTraffic
 {
@@ -33,7 +40,11 @@ namespace ctsTraffic
     using namespace std;
 
     constexpr unsigned long c_bufferPatternSize = 0xffff + 0x1; // fill from 0x0000 to 0xffff
-    static unsigned char g_bufferPattern[c_bufferPatternSize * 2]; // * 2 as unsigned short values are twice as large as unsigned char
+    static unsigned char g_defaultBufferPattern[c_bufferPatternSize * 2]; // * 2 as unsigned short values are twice as large as unsigned char
+    // the bytes sent repeat g_bufferPattern every g_bufferPatternSize bytes
+    // - the synthetic pattern above, or the read-only mapping of the file given with -PayloadFile
+    static const unsigned char* g_bufferPattern = g_defaultBufferPattern;
+    static unsigned long g_bufferPatternSize = c_bufferPatternSize;
 
     /// SharedBuffer is a larger buffer with many copies of BufferPattern in it. This is what the various IO patterns
     /// will be memcmp'ing against for validity checks.
@@ -42,48 +53,544 @@ namespace ctsTraffic
     /// need to wait for input parsing before we can set that.
 
     static INIT_ONCE g_ctsIoPatternInitializer = INIT_ONCE_STATIC_INIT;
-    static char* g_receiverSharedBuffer = nullptr;
-    static char* g_senderSharedBuffer = nullptr;
     static unsigned long g_maximumBufferSize = 0;
 
+    // with RIO, the shared buffers are registered once for the lifetime of the process
+    // - RIO requests can use the same RIO_BUFFERID concurrently as long as they address it with their own offset
+    struct ctsSharedBuffers
+    {
+        char* m_receiverBuffer = nullptr;
+        char* m_senderBuffer = nullptr;
+        RIO_BUFFERID m_receiverRioBufferId = RIO_INVALID_BUFFERID;
+        RIO_BUFFERID m_senderRioBufferId = RIO_INVALID_BUFFERID;
+    };
+    // one entry unless -NumaLocalBuffers:on, which replicates the shared buffers on every NUMA node (indexed by node number)
+    static vector<ctsSharedBuffers> g_sharedBuffers;
+    // the NUMA node of every processor, indexed by (group * 64 + number) - only built with -NumaLocalBuffers:on
+    static vector<unsigned short> g_numaNodeByProcessor;
+
     constexpr auto c_maxSupportedBytesInFlight = 0x1000000ul;
     static unsigned long g_maxNumberOfRioSendBuffers = 0;
 
+    // -RateLimitPacing:on : paced sends due sooner than this are sent immediately
+    // - arming a timer costs more than the time it would wait
+    constexpr long long c_minimumPacingDelayMicroseconds = 50LL;
+
+    // recv buffers are recycled across connections rather than allocated (and zeroed) for every new ctsIoPattern
+    // - every pattern in a run needs the same size : the cache is bounded by the peak number of concurrent connections
+    static wil::critical_section g_recycledRecvBuffersLock{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };
+    static vector<vector<char>> g_recycledRecvBuffers;
+
+    // with -ZeroByteRecv:on, recv buffers are leased only for the duration of a recv which has data to complete
+    // - the pool grows to the peak number of concurrent recvs; buffers are reused for the lifetime of the process
+    static wil::critical_section g_leasedRecvBuffersLock{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };
+    static vector<char*> g_leasedRecvBuffersFreeList;
+    static size_t g_leasedRecvBuffersAllocated = 0;
+
+    //
+    // Buffer verification compares received bytes against g_bufferPattern
+    // - each returns the number of leading bytes that match (the offset of the first mismatching byte)
+    // - the widest vector compare the CPU and OS support is selected once, in InitOnceIoPatternCallback
+    //
+    using CompareMemoryFunction = size_t (*)(const unsigned char* expected, const unsigned char* received, size_t length) noexcept;
+
+    static size_t CompareMemoryBytes(const unsigned char* expected, const unsigned char* received, size_t length) noexcept
+    {
+        size_t offset = 0;
+        while (offset < length && expected[offset] == received[offset])
+        {
+            ++offset;
+        }
+        return offset;
+    }
+
+#if defined(_M_IX86) || defined(_M_X64)
+    static size_t CompareMemorySse2(const unsigned char* expected, const unsigned char* received, size_t length) noexcept
+    {
+        size_t offset = 0;
+        for (; offset + sizeof(__m128i) <= length; offset += sizeof(__m128i))
+        {
+            const __m128i expectedBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(expected + offset));
+            const __m128i receivedBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(received + offset));
+            const auto matchMask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_cmpeq_epi8(expectedBytes, receivedBytes)));
+            if (matchMask != 0xffff)
+            {
+                unsigned long mismatchIndex;
+                _BitScanForward(&mismatchIndex, ~matchMask);
+                return offset + mismatchIndex;
+            }
+        }
+        return offset + CompareMemoryBytes(expected + offset, received + offset, length - offset);
+    }
+
+    static size_t CompareMemoryAvx2(const unsigned char* expected, const unsigned char* received, size_t length) noexcept
+    {
+        size_t offset = 0;
+        for (; offset + sizeof(__m256i) <= length; offset += sizeof(__m256i))
+        {
+            const __m256i expectedBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(expected + offset));
+            const __m256i receivedBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(received + offset));
+            const auto matchMask = static_cast<unsigned long>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(expectedBytes, receivedBytes)));
+            if (matchMask != 0xffffffff)
+            {
+                _mm256_zeroupper();
+                unsigned long mismatchIndex;
+                _BitScanForward(&mismatchIndex, ~matchMask);
+                return offset + mismatchIndex;
+            }
+        }
+        // avoid the AVX to SSE transition penalty in the tail
+        _mm256_zeroupper();
+        return offset + CompareMemorySse2(expected + offset, received + offset, length - offset);
+    }
+
+#if defined(_M_X64)
+    static size_t CompareMemoryAvx512(const unsigned char* expected, const unsigned char* received, size_t length) noexcept
+    {
+        size_t offset = 0;
+        for (; offset + sizeof(__m512i) <= length; offset += sizeof(__m512i))
+        {
+            const __m512i expectedBytes = _mm512_loadu_si512(expected + offset);
+            const __m512i receivedBytes = _mm512_loadu_si512(received + offset);
+            const __mmask64 mismatchMask = _mm512_cmpneq_epi8_mask(expectedBytes, receivedBytes);
+            if (mismatchMask != 0)
+            {
+                _mm256_zeroupper();
+                unsigned long mismatchIndex;
+                _BitScanForward64(&mismatchIndex, mismatchMask);
+                return offset + mismatchIndex;
+            }
+        }
+        _mm256_zeroupper();
+        return offset + CompareMemorySse2(expected + offset, received + offset, length - offset);
+    }
+#endif
+
+    static CompareMemoryFunction SelectCompareMemory() noexcept
+    {
+        int cpuInfo[4]{};
+        __cpuid(cpuInfo, 0);
+        const auto maximumLeaf = cpuInfo[0];
+
+        __cpuid(cpuInfo, 1);
+        const auto osUsesXsave = (cpuInfo[2] & (1 << 27)) != 0;
+        const auto cpuSupportsAvx = (cpuInfo[2] & (1 << 28)) != 0;
+        if (maximumLeaf < 7 || !osUsesXsave || !cpuSupportsAvx)
+        {
+            return CompareMemorySse2;
+        }
+
+        // the OS must also save the upper register state across context switches
+        // - XCR0 bits 1-2 for YMM, and bits 5-7 additionally for the AVX-512 opmask and ZMM registers
+        const auto enabledFeatures = _xgetbv(0);
+        __cpuidex(cpuInfo, 7, 0);
+#if defined(_M_X64)
+        const auto cpuSupportsAvx512 = (cpuInfo[1] & (1 << 16)) != 0 && (cpuInfo[1] & (1 << 30)) != 0; // AVX512F and AVX512BW
+        if (cpuSupportsAvx512 && (enabledFeatures & 0xe6) == 0xe6)
+        {
+            return CompareMemoryAvx512;
+        }
+#endif
+        const auto cpuSupportsAvx2 = (cpuInfo[1] & (1 << 5)) != 0;
+        if (cpuSupportsAvx2 && (enabledFeatures & 0x6) == 0x6)
+        {
+            return CompareMemoryAvx2;
+        }
+        return CompareMemorySse2;
+    }
+
+    static CompareMemoryFunction g_compareMemory = CompareMemorySse2;
+#else
+    static CompareMemoryFunction g_compareMemory = CompareMemoryBytes;
+#endif
+
+    //
+    // With -verify:checksum the last 4 bytes of every block of the buffer pattern are replaced with
+    // the (little-endian) CRC32C of the bytes before them in that block
+    // - the sender's shared buffer is built from the pattern so every send carries the checksums
+    // - the receiver only runs the CRC over the received bytes rather than comparing them to the pattern
+    // - blocks must evenly divide the pattern so block boundaries are the same on every pass of the pattern
+    //
+    constexpr unsigned long c_checksumBlockSize = 0x1000;
+    constexpr unsigned long c_checksumLength = sizeof(unsigned long);
+    constexpr unsigned long c_checksumDataLength = c_checksumBlockSize - c_checksumLength;
+    static_assert(c_bufferPatternSize % c_checksumBlockSize == 0, "checksum blocks must evenly divide the buffer pattern");
+
+    // CRC32C (Castagnoli) continuing from a prior (non-inverted) value
+    using UpdateCrc32cFunction = unsigned long (*)(unsigned long crc, const unsigned char* buffer, size_t length) noexcept;
+
+    static unsigned long g_crc32cTable[256];
+
+    static unsigned long UpdateCrc32cTable(unsigned long crc, const unsigned char* buffer, size_t length) noexcept
+    {
+        for (size_t offset = 0; offset < length; ++offset)
+        {
+            crc = g_crc32cTable[(crc ^ buffer[offset]) & 0xff] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+#if defined(_M_IX86) || defined(_M_X64)
+    static unsigned long UpdateCrc32cSse42(unsigned long crc, const unsigned char* buffer, size_t length) noexcept
+    {
+#if defined(_M_X64)
+        unsigned long long crc64 = crc;
+        for (; length >= sizeof(unsigned long long); buffer += sizeof(unsigned long long), length -= sizeof(unsigned long long))
+        {
+            unsigned long long value;
+            memcpy(&value, buffer, sizeof value);
+            crc64 = _mm_crc32_u64(crc64, value);
+        }
+        crc = static_cast<unsigned long>(crc64);
+#else
+        for (; length >= sizeof(unsigned int); buffer += sizeof(unsigned int), length -= sizeof(unsigned int))
+        {
+            unsigned int value;
+            memcpy(&value, buffer, sizeof value);
+            crc = _mm_crc32_u32(crc, value);
+        }
+#endif
+        for (; length > 0; ++buffer, --length)
+        {
+            crc = _mm_crc32_u8(crc, *buffer);
+        }
+        return crc;
+    }
+
+    static UpdateCrc32cFunction SelectUpdateCrc32c() noexcept
+    {
+        int cpuInfo[4]{};
+        __cpuid(cpuInfo, 1);
+        const auto cpuSupportsSse42 = (cpuInfo[2] & (1 << 20)) != 0;
+        return cpuSupportsSse42 ? UpdateCrc32cSse42 : UpdateCrc32cTable;
+    }
+#endif
+
+    static UpdateCrc32cFunction g_updateCrc32c = UpdateCrc32cTable;
+
+    //
+    // With -verify:seeded every connection sends its own payload instead of the shared buffer pattern
+    // - the payload is a stream of 32-bit words, each the murmur3 finalizer of the connection's seed and the word's index,
+    //   so any range of the stream can be generated (or checked) knowing only the seed and the offset into the stream
+    // - each direction of a connection has its own seed, derived from the connection ID both endpoints hold
+    // - senders fill a small ring of slots ahead of the sends, refilling each slot once all sends from it completed
+    // - receivers regenerate each received range a chunk at a time and compare it in place with g_compareMemory
+    //
+    constexpr size_t c_seededPayloadChunkSize = 0x400;
+    // the slots each connection sends from when the sends follow the ideal send backlog (-PrePostSends:0)
+    constexpr size_t c_seededPayloadIsbSlots = 8;
+
+    static uint32_t SeededPayloadMix(uint32_t value) noexcept
+    {
+        value ^= value >> 16;
+        value *= 0x85ebca6b;
+        value ^= value >> 13;
+        value *= 0xc2b2ae35;
+        value ^= value >> 16;
+        return value;
+    }
+
+    static uint32_t SeededPayloadWord(uint32_t key, uint32_t wordIndex) noexcept
+    {
+        return SeededPayloadMix(key ^ (wordIndex * 0x9e3779b9));
+    }
+
+    // fills the buffer with length bytes of the payload stream of seed, starting at streamOffset
+    static void FillSeededPayload(uint32_t seed, uint64_t streamOffset, _Out_writes_(length) char* buffer, size_t length) noexcept
+    {
+        while (length > 0)
+        {
+            // the words of every 16GB of the stream are keyed from the seed and the high bits of the word index
+            const uint64_t wordIndex = streamOffset / sizeof(uint32_t);
+            const auto byteInWord = static_cast<size_t>(streamOffset % sizeof(uint32_t));
+            const uint32_t key = SeededPayloadMix(seed ^ static_cast<uint32_t>(wordIndex >> 32));
+            const auto lowWordIndex = static_cast<uint32_t>(wordIndex);
+
+            size_t filled;
+            if (byteInWord != 0 || length < sizeof(uint32_t))
+            {
+                // a partial word at the start or the end of the range
+                const uint32_t word = SeededPayloadWord(key, lowWordIndex);
+                filled = min(sizeof(uint32_t) - byteInWord, length);
+                memcpy(buffer, reinterpret_cast<const char*>(&word) + byteInWord, filled);
+            }
+            else
+            {
+                // whole words up to where the key changes : a loop the compiler can vectorize
+                const auto wordCount = static_cast<size_t>(min<uint64_t>(length / sizeof(uint32_t), 0x100000000ull - lowWordIndex));
+                for (size_t word = 0; word < wordCount; ++word)
+                {
+                    const uint32_t value = SeededPayloadWord(key, lowWordIndex + static_cast<uint32_t>(word));
+                    memcpy(buffer + word * sizeof(uint32_t), &value, sizeof value);
+                }
+                filled = wordCount * sizeof(uint32_t);
+            }
+
+            buffer += filled;
+            streamOffset += filled;
+            length -= filled;
+        }
+    }
+
+    // the seed of the payload one direction of a connection carries : the FNV-1a hash of the connection ID and the sender's role
+    static uint32_t MakeSeededPayloadSeed(_In_reads_(ctsStatistics::c_connectionIdLength) const char* connectionId, bool serverSending) noexcept
+    {
+        uint32_t hash = 0x811c9dc5;
+        for (unsigned long idByte = 0; idByte < ctsStatistics::c_connectionIdLength; ++idByte)
+        {
+            hash ^= static_cast<unsigned char>(connectionId[idByte]);
+            hash *= 0x01000193;
+        }
+        hash ^= serverSending ? 'S' : 'C';
+        hash *= 0x01000193;
+        return SeededPayloadMix(hash);
+    }
+
+    // the shared buffers replicated on the NUMA node of the processor running the caller
+    static const ctsSharedBuffers& GetLocalSharedBuffers() noexcept
+    {
+        if (g_sharedBuffers.size() > 1)
+        {
+            PROCESSOR_NUMBER processor{};
+            GetCurrentProcessorNumberEx(&processor);
+            const size_t processorIndex = processor.Group * 64ull + processor.Number;
+            if (processorIndex < g_numaNodeByProcessor.size())
+            {
+                return g_sharedBuffers[g_numaNodeByProcessor[processorIndex]];
+            }
+        }
+        return g_sharedBuffers[0];
+    }
+
+    // large page allocations require SeLockMemoryPrivilege to be enabled in the process token (not only granted)
+    static void EnableLockMemoryPrivilege() noexcept
+    {
+        wil::unique_handle processToken;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, processToken.addressof()))
+        {
+            return;
+        }
+
+        TOKEN_PRIVILEGES privileges{};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid))
+        {
+            // fails with ERROR_NOT_ALL_ASSIGNED if the user was not granted the privilege : allocations fall back to regular pages
+            AdjustTokenPrivileges(processToken.get(), FALSE, &privileges, 0, nullptr, nullptr);
+        }
+    }
+
+    // allocates a shared buffer on the given NUMA node (or NUMA_NO_PREFERRED_NODE)
+    // - with -LargePages:on, first attempts large pages : returns if large pages were used in largePages
+    static char* AllocateSharedBuffer(DWORD numaNode, bool& largePages) noexcept
+    {
+        if (ctsConfig::g_configSettings->UseLargePages)
+        {
+            const SIZE_T largePageSize = GetLargePageMinimum();
+            if (largePageSize > 0)
+            {
+                const SIZE_T largeBufferSize = (g_maximumBufferSize + largePageSize - 1) / largePageSize * largePageSize;
+                auto* const buffer = static_cast<char*>(VirtualAllocExNuma(
+                    GetCurrentProcess(), nullptr, largeBufferSize, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE, numaNode));
+                if (buffer)
+                {
+                    largePages = true;
+                    return buffer;
+                }
+            }
+        }
+
+        auto* const buffer = static_cast<char*>(VirtualAllocExNuma(
+            GetCurrentProcess(), nullptr, g_maximumBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, numaNode));
+        FAIL_FAST_IF_MSG(!buffer, "VirtualAllocExNuma alloc failed: %u", GetLastError());
+        largePages = false;
+        return buffer;
+    }
+
+#ifndef MEM_RESERVE_PLACEHOLDER
+#define MEM_RESERVE_PLACEHOLDER 0x00040000
+#endif
+#ifndef MEM_REPLACE_PLACEHOLDER
+#define MEM_REPLACE_PLACEHOLDER 0x00004000
+#endif
+#ifndef MEM_PRESERVE_PLACEHOLDER
+#define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+
+    // placeholder APIs are only exported from kernelbase.dll on Windows 10 1803 and later
+    using VirtualAlloc2Function = PVOID (WINAPI*)(HANDLE, PVOID, SIZE_T, ULONG, ULONG, PVOID, ULONG);
+    using MapViewOfFile3Function = PVOID (WINAPI*)(HANDLE, HANDLE, PVOID, ULONG64, SIZE_T, ULONG, ULONG, PVOID, ULONG);
+
+    // maps the first patternSize bytes of the file read-only, twice, into adjacent address ranges
+    // - a send of up to patternSize bytes can then start from any offset in the pattern and still be contiguous
+    // - patternSize was validated to be a multiple of the allocation granularity when parsing -PayloadFile
+    // - the mappings are for the lifetime of the process
+    static unsigned char* MapPayloadFile(_In_ PCWSTR filename, unsigned long patternSize) noexcept
+    {
+        const auto kernelBase = GetModuleHandleW(L"kernelbase.dll");
+        FAIL_FAST_IF_MSG(!kernelBase, "GetModuleHandle(kernelbase.dll) failed: %u", GetLastError());
+        const auto virtualAlloc2 = reinterpret_cast<VirtualAlloc2Function>(GetProcAddress(kernelBase, "VirtualAlloc2"));
+        const auto mapViewOfFile3 = reinterpret_cast<MapViewOfFile3Function>(GetProcAddress(kernelBase, "MapViewOfFile3"));
+        FAIL_FAST_IF_MSG(!virtualAlloc2 || !mapViewOfFile3, "-PayloadFile requires VirtualAlloc2 and MapViewOfFile3 (Windows 10 1803 or later)");
+
+        const wil::unique_hfile payloadFile(CreateFileW(
+            filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+        FAIL_FAST_IF_MSG(!payloadFile, "CreateFile(%ws) failed: %u", filename, GetLastError());
+        const wil::unique_handle payloadSection(CreateFileMappingW(payloadFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        FAIL_FAST_IF_MSG(!payloadSection, "CreateFileMapping(%ws) failed: %u", filename, GetLastError());
+
+        // reserve both halves as one placeholder, then split it so each half can be replaced by a view
+        auto* const ringBase = static_cast<unsigned char*>(virtualAlloc2(
+            nullptr, nullptr, static_cast<SIZE_T>(patternSize) * 2, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, nullptr, 0));
+        FAIL_FAST_IF_MSG(!ringBase, "VirtualAlloc2(MEM_RESERVE_PLACEHOLDER) failed: %u", GetLastError());
+        FAIL_FAST_IF_MSG(
+            !VirtualFree(ringBase, patternSize, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER),
+            "VirtualFree(MEM_PRESERVE_PLACEHOLDER) failed: %u", GetLastError());
+
+        for (unsigned long half = 0; half < 2; ++half)
+        {
+            const auto* const view = mapViewOfFile3(
+                payloadSection.get(), GetCurrentProcess(), ringBase + static_cast<size_t>(half) * patternSize,
+                0, patternSize, MEM_REPLACE_PLACEHOLDER, PAGE_READONLY, nullptr, 0);
+            FAIL_FAST_IF_MSG(!view, "MapViewOfFile3(%ws) failed: %u", filename, GetLastError());
+        }
+
+        // the views keep the section referenced : the file and section handles can be closed
+        return ringBase;
+    }
+
     BOOL CALLBACK InitOnceIoPatternCallback(PINIT_ONCE, PVOID, PVOID*) noexcept  // NOLINT(bugprone-exception-escape)
     {
         // first create the buffer pattern
         for (unsigned long fillSlot = 0; fillSlot < c_bufferPatternSize; ++fillSlot)
         {
-            *reinterpret_cast<unsigned short*>(&g_bufferPattern[fillSlot * 2]) = static_cast<unsigned short>(fillSlot);
+            *reinterpret_cast<unsigned short*>(&g_defaultBufferPattern[fillSlot * 2]) = static_cast<unsigned short>(fillSlot);
         }
+#if defined(_M_IX86) || defined(_M_X64)
+        g_compareMemory = SelectCompareMemory();
+#endif
 
-        g_maximumBufferSize = c_bufferPatternSize + ctsConfig::GetMaxBufferSize();
-        g_maxNumberOfRioSendBuffers = c_maxSupportedBytesInFlight / ctsConfig::GetMinBufferSize() + 1;
+        if (ctsConfig::g_configSettings->ShouldVerifyChecksums)
+        {
+            // reflected CRC32C polynomial
+            for (unsigned long tableSlot = 0; tableSlot < 256; ++tableSlot)
+            {
+                auto crc = tableSlot;
+                for (auto bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 1) ? 0x82f63b78 ^ (crc >> 1) : crc >> 1;
+                }
+                g_crc32cTable[tableSlot] = crc;
+            }
+#if defined(_M_IX86) || defined(_M_X64)
+            g_updateCrc32c = SelectUpdateCrc32c();
+#endif
+
+            for (unsigned long blockOffset = 0; blockOffset < c_bufferPatternSize; blockOffset += c_checksumBlockSize)
+            {
+                const auto checksum = ~g_updateCrc32c(0xffffffff, &g_defaultBufferPattern[blockOffset], c_checksumDataLength);
+                for (unsigned long checksumByte = 0; checksumByte < c_checksumLength; ++checksumByte)
+                {
+                    g_defaultBufferPattern[blockOffset + c_checksumDataLength + checksumByte] = static_cast<unsigned char>(checksum >> (checksumByte * 8));
+                }
+            }
+        }
 
-        g_receiverSharedBuffer = static_cast<char*>(VirtualAlloc(nullptr, g_maximumBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
-        FAIL_FAST_IF_MSG(!g_receiverSharedBuffer, "VirtualAlloc alloc failed: %u", GetLastError());
+        // with -PayloadFile, sends are made directly from the mapping of the file (mapped twice back-to-back)
+        unsigned char* payloadMapping = nullptr;
+        if (ctsConfig::g_configSettings->PayloadFilename)
+        {
+            payloadMapping = MapPayloadFile(ctsConfig::g_configSettings->PayloadFilename, ctsConfig::g_configSettings->PayloadPatternSize);
+            g_bufferPattern = payloadMapping;
+            g_bufferPatternSize = ctsConfig::g_configSettings->PayloadPatternSize;
+        }
 
-        g_senderSharedBuffer = static_cast<char*>(VirtualAlloc(nullptr, g_maximumBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
-        FAIL_FAST_IF_MSG(!g_senderSharedBuffer, "VirtualAlloc alloc failed: %u", GetLastError());
+        g_maximumBufferSize = g_bufferPatternSize + ctsConfig::GetMaxBufferSize();
+        g_maxNumberOfRioSendBuffers = c_maxSupportedBytesInFlight / ctsConfig::GetMinBufferSize() + 1;
 
-        // fill in this allocated buffer while we can write to it
-        auto* protectedDestination = g_senderSharedBuffer;
-        auto writeSizeRemaining = g_maximumBufferSize;
-        while (writeSizeRemaining > 0)
+        if (ctsConfig::g_configSettings->UseLargePages)
         {
-            const auto bytesToWrite = writeSizeRemaining > c_bufferPatternSize ? c_bufferPatternSize : writeSizeRemaining;
-            const auto memerror = memcpy_s(protectedDestination, writeSizeRemaining, g_bufferPattern, bytesToWrite);
-            FAIL_FAST_IF(memerror != 0);
+            EnableLockMemoryPrivilege();
+        }
 
-            protectedDestination += bytesToWrite;
-            writeSizeRemaining -= bytesToWrite;
+        // with -NumaLocalBuffers:on, map every processor to its node and allocate a replica on each node
+        ULONG highestNumaNode = 0;
+        if (ctsConfig::g_configSettings->UseNumaLocalBuffers && GetNumaHighestNodeNumber(&highestNumaNode) && highestNumaNode > 0)
+        {
+            const auto groupCount = GetActiveProcessorGroupCount();
+            g_numaNodeByProcessor.resize(groupCount * 64ull, 0);
+            for (WORD group = 0; group < groupCount; ++group)
+            {
+                const auto processorCount = GetActiveProcessorCount(group);
+                for (DWORD number = 0; number < processorCount; ++number)
+                {
+                    PROCESSOR_NUMBER processor{};
+                    processor.Group = group;
+                    processor.Number = static_cast<BYTE>(number);
+                    USHORT numaNode = 0;
+                    if (GetNumaProcessorNodeEx(&processor, &numaNode) && numaNode <= highestNumaNode)
+                    {
+                        g_numaNodeByProcessor[group * 64ull + number] = numaNode;
+                    }
+                }
+            }
+        }
+        else
+        {
+            highestNumaNode = 0;
         }
 
-        // guarantee no one will write to our s_ProtectedSharedBuffer - but not if using RIO (can't register read-only buffers)
-        if (WI_IsFlagClear(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+        g_sharedBuffers.resize(static_cast<size_t>(highestNumaNode) + 1);
+        for (DWORD numaNode = 0; numaNode <= highestNumaNode; ++numaNode)
         {
-            DWORD oldSetting;
-            FAIL_FAST_IF_MSG(!VirtualProtect(g_senderSharedBuffer, g_maximumBufferSize, PAGE_READONLY, &oldSetting), "VirtualProtect failed: %u", GetLastError());
+            auto& sharedBuffers = g_sharedBuffers[numaNode];
+            const DWORD preferredNode = highestNumaNode > 0 ? numaNode : NUMA_NO_PREFERRED_NODE;
+
+            bool receiverLargePages = false;
+            sharedBuffers.m_receiverBuffer = AllocateSharedBuffer(preferredNode, receiverLargePages);
+            bool senderLargePages = false;
+            if (payloadMapping)
+            {
+                // every node sends from the one mapping of the file : it's already read-only, and is backed by the file cache
+                sharedBuffers.m_senderBuffer = reinterpret_cast<char*>(payloadMapping);
+            }
+            else
+            {
+                sharedBuffers.m_senderBuffer = AllocateSharedBuffer(preferredNode, senderLargePages);
+
+                // fill in this allocated buffer while we can write to it
+                auto* protectedDestination = sharedBuffers.m_senderBuffer;
+                auto writeSizeRemaining = g_maximumBufferSize;
+                while (writeSizeRemaining > 0)
+                {
+                    const auto bytesToWrite = writeSizeRemaining > c_bufferPatternSize ? c_bufferPatternSize : writeSizeRemaining;
+                    const auto memerror = memcpy_s(protectedDestination, writeSizeRemaining, g_defaultBufferPattern, bytesToWrite);
+                    FAIL_FAST_IF(memerror != 0);
+
+                    protectedDestination += bytesToWrite;
+                    writeSizeRemaining -= bytesToWrite;
+                }
+            }
+
+            // guarantee no one will write to our s_ProtectedSharedBuffer - but not if using RIO (can't register read-only buffers)
+            // - large pages are always read/write : their protection cannot be changed
+            if (WI_IsFlagClear(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+            {
+                if (!senderLargePages && !payloadMapping)
+                {
+                    DWORD oldSetting;
+                    FAIL_FAST_IF_MSG(!VirtualProtect(sharedBuffers.m_senderBuffer, g_maximumBufferSize, PAGE_READONLY, &oldSetting), "VirtualProtect failed: %u", GetLastError());
+                }
+            }
+            else
+            {
+                sharedBuffers.m_receiverRioBufferId = ctRIORegisterBuffer(sharedBuffers.m_receiverBuffer, g_maximumBufferSize);
+                FAIL_FAST_IF_MSG(RIO_INVALID_BUFFERID == sharedBuffers.m_receiverRioBufferId, "RIORegisterBuffer failed: %d", WSAGetLastError());
+
+                sharedBuffers.m_senderRioBufferId = ctRIORegisterBuffer(sharedBuffers.m_senderBuffer, g_maximumBufferSize);
+                FAIL_FAST_IF_MSG(RIO_INVALID_BUFFERID == sharedBuffers.m_senderRioBufferId, "RIORegisterBuffer failed: %d", WSAGetLastError());
+            }
         }
 
         return TRUE;
@@ -94,99 +601,268 @@ namespace ctsTraffic
     // - can throw exception on allocation failure
     shared_ptr<ctsIoPattern> ctsIoPattern::MakeIoPattern()
     {
+        // the size of the derived type is kept for -MemoryAccounting
+        shared_ptr<ctsIoPattern> pattern;
+        size_t patternBytes = 0;
         switch (ctsConfig::g_configSettings->IoPattern)
         {
             case ctsConfig::IoPatternType::Pull:
-                return make_shared<ctsIoPatternPull>();
+                pattern = make_shared<ctsIoPatternPull>();
+                patternBytes = sizeof(ctsIoPatternPull);
+                break;
 
             case ctsConfig::IoPatternType::Push:
-                return make_shared<ctsIoPatternPush>();
+                pattern = make_shared<ctsIoPatternPush>();
+                patternBytes = sizeof(ctsIoPatternPush);
+                break;
 
             case ctsConfig::IoPatternType::PushPull:
-                return make_shared<ctsIoPatternPushPull>();
+                pattern = make_shared<ctsIoPatternPushPull>();
+                patternBytes = sizeof(ctsIoPatternPushPull);
+                break;
 
             case ctsConfig::IoPatternType::Duplex:
-                return make_shared<ctsIoPatternDuplex>();
+                pattern = make_shared<ctsIoPatternDuplex>();
+                patternBytes = sizeof(ctsIoPatternDuplex);
+                break;
 
             case ctsConfig::IoPatternType::MediaStream:
-                if (ctsConfig::IsListening())
+                if (ctsConfig::g_configSettings->UdpBlast)
                 {
-                    return make_shared<ctsIoPatternMediaStreamServer>();
+                    // -Pattern:Blast runs over the MediaStream protocol, server, and client
+                    if (ctsConfig::IsListening())
+                    {
+                        pattern = make_shared<ctsIoPatternBlastServer>();
+                        patternBytes = sizeof(ctsIoPatternBlastServer);
+                    }
+                    else
+                    {
+                        pattern = make_shared<ctsIoPatternBlastClient>();
+                        patternBytes = sizeof(ctsIoPatternBlastClient);
+                    }
+                }
+                else if (ctsConfig::IsListening())
+                {
+                    pattern = make_shared<ctsIoPatternMediaStreamServer>();
+                    patternBytes = sizeof(ctsIoPatternMediaStreamServer);
                 }
-                return make_shared<ctsIoPatternMediaStreamClient>();
+                else
+                {
+                    pattern = make_shared<ctsIoPatternMediaStreamClient>();
+                    patternBytes = sizeof(ctsIoPatternMediaStreamClient);
+                }
+                break;
+
+            case ctsConfig::IoPatternType::RequestResponse: // fall through
+            case ctsConfig::IoPatternType::Heartbeat:
+                pattern = make_shared<ctsIoPatternRequestResponse>();
+                patternBytes = sizeof(ctsIoPatternRequestResponse);
+                break;
 
             case ctsConfig::IoPatternType::NoIoSet: // fall through
             default:  // NOLINT(clang-diagnostic-covered-switch-default)
                 FAIL_FAST_MSG("ctsIOPattern::MakeIOPattern - Unknown IoPattern specified (%d)", ctsConfig::g_configSettings->IoPattern);
         }
+
+        pattern->m_patternBytes = patternBytes;
+        return pattern;
+    }
+
+    // -Probes : probe connections exchange pings whatever the bulk -Pattern
+    // - can throw exception on allocation failure
+    shared_ptr<ctsIoPattern> ctsIoPattern::MakeProbePattern()
+    {
+        shared_ptr<ctsIoPattern> pattern = make_shared<ctsIoPatternRequestResponse>(true);
+        pattern->m_patternBytes = sizeof(ctsIoPatternRequestResponse);
+        return pattern;
+    }
+
+    void ctsIoPattern::AccountMemory(ctsConnectionMemoryStatistics& memoryDetails) const noexcept
+    {
+        memoryDetails.m_patternBytes.Add(static_cast<long long>(m_patternBytes));
+        memoryDetails.m_recvBufferBytes.Add(static_cast<long long>(
+            m_recvBufferContainer.capacity() + m_recvBufferFreeList.capacity() * sizeof(char*)));
+        memoryDetails.m_sendBufferBytes.Add(static_cast<long long>(
+            m_seededSlotContainer.capacity() + m_seededSlots.capacity() * sizeof(SeededPayloadSlot)));
+        memoryDetails.m_rioRegisteredBytes.Add(static_cast<long long>(m_rioBufferLease.Get().m_length));
+        memoryDetails.m_taskBytes.Add(static_cast<long long>(GetTaskAllocatedBytes()));
     }
 
     char* ctsIoPattern::AccessSharedBuffer() noexcept
     {
         // this init-once call is no-fail
         InitOnceExecuteOnce(&g_ctsIoPatternInitializer, InitOnceIoPatternCallback, nullptr, nullptr);
-        return g_senderSharedBuffer;
+        return g_sharedBuffers[0].m_senderBuffer;
+    }
+
+    char* ctsIoPattern::LeaseRecvBuffer()
+    {
+        // every recv lands in the same buffer when the user specified to recv into the shared buffer
+        if (ctsConfig::g_configSettings->UseSharedBuffer)
+        {
+            return GetLocalSharedBuffers().m_receiverBuffer;
+        }
+
+        const auto lock = g_leasedRecvBuffersLock.lock();
+        if (g_leasedRecvBuffersFreeList.empty())
+        {
+            // reserve for every buffer allocated so returning a buffer to the free list cannot reallocate
+            g_leasedRecvBuffersFreeList.reserve(g_leasedRecvBuffersAllocated + 1);
+            g_leasedRecvBuffersFreeList.push_back(new char[ctsConfig::GetMaxBufferSize()]);
+            ++g_leasedRecvBuffersAllocated;
+        }
+
+        char* const returnBuffer = *g_leasedRecvBuffersFreeList.rbegin();
+        g_leasedRecvBuffersFreeList.pop_back();
+        return returnBuffer;
+    }
+
+    static void ReturnLeasedRecvBuffer(_In_ char* buffer) noexcept
+    {
+        if (ctsConfig::g_configSettings->UseSharedBuffer)
+        {
+            return;
+        }
+
+        const auto lock = g_leasedRecvBuffersLock.lock();
+        g_leasedRecvBuffersFreeList.push_back(buffer);
+    }
+
+    //
+    // Invokes the functor with the ctsIOPatternBufferPolicy matching the settings for this run
+    // - the functor must return the same type for every policy
+    //
+    template <typename Functor>
+    static auto VisitBufferPolicy(Functor&& functor)
+    {
+        const auto useRio = WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO);
+        if (ctsConfig::g_configSettings->UseSharedBuffer)
+        {
+            return useRio ?
+                functor(ctsIOPatternBufferPolicy<ctsIOPatternAllocationTypeStatic, ctsIOPatternBufferTypeRegisteredIo>{}) :
+                functor(ctsIOPatternBufferPolicy<ctsIOPatternAllocationTypeStatic, ctsIOPatternBufferTypeHeap>{});
+        }
+        return useRio ?
+            functor(ctsIOPatternBufferPolicy<ctsIOPatternAllocationtypeDynamic, ctsIOPatternBufferTypeRegisteredIo>{}) :
+            functor(ctsIOPatternBufferPolicy<ctsIOPatternAllocationtypeDynamic, ctsIOPatternBufferTypeHeap>{});
+    }
+
+    // RIO connections also lease registered memory for the connection id and the completion message
+    // - the connection id slot also holds the shorter -LeanProtocol header
+    constexpr unsigned long c_rioControlBytes = ctsStatistics::c_connectionIdLength + c_completionMessageSize;
+    static_assert(c_leanProtocolHeaderSize <= ctsStatistics::c_connectionIdLength);
+
+    const wchar_t* ctsIoPattern::GetBufferPolicyDescription() noexcept
+    {
+        return VisitBufferPolicy([](auto policy) noexcept { return decltype(policy)::c_description; });
+    }
+
+    size_t ctsIoPattern::GetConnectionBufferFootprint() noexcept
+    {
+        // the number of recv buffers each pattern is constructed with
+        unsigned long recvCount = 0;
+        switch (ctsConfig::g_configSettings->IoPattern)
+        {
+            case ctsConfig::IoPatternType::Pull:
+                recvCount = ctsConfig::IsListening() ? 0 : ctsConfig::g_configSettings->PrePostRecvs;
+                break;
+            case ctsConfig::IoPatternType::Push:
+                recvCount = ctsConfig::IsListening() ? ctsConfig::g_configSettings->PrePostRecvs : 0;
+                break;
+            case ctsConfig::IoPatternType::PushPull: // fall through
+            case ctsConfig::IoPatternType::RequestResponse: // fall through
+            case ctsConfig::IoPatternType::Heartbeat:
+                recvCount = 1;
+                break;
+            case ctsConfig::IoPatternType::Duplex: // fall through
+            case ctsConfig::IoPatternType::MediaStream:
+                recvCount = ctsConfig::IsListening() && ctsConfig::IoPatternType::MediaStream == ctsConfig::g_configSettings->IoPattern ?
+                    1 :
+                    ctsConfig::g_configSettings->PrePostRecvs;
+                break;
+            case ctsConfig::IoPatternType::NoIoSet: // fall through
+            default:  // NOLINT(clang-diagnostic-covered-switch-default)
+                break;
+        }
+        // zero-byte recvs lease their buffers only while data is being received
+        if (ctsConfig::g_configSettings->Options & ctsConfig::OptionType::ZeroByteRecv)
+        {
+            recvCount = 0;
+        }
+
+        const unsigned long bufferSize = ctsConfig::GetMaxBufferSize();
+        return VisitBufferPolicy([&](auto policy) noexcept {
+            return decltype(policy)::GetConnectionFootprint(recvCount, bufferSize, c_rioControlBytes);
+        });
     }
 
     void ctsIoPattern::CreateRecvBuffers()
     {
         const auto recvCount = m_recvBufferFreeList.size();
-        if (recvCount > 0)
+        const unsigned long maxBufferSize = ctsConfig::GetMaxBufferSize();
+
+        // with RIO, lease one slice of registered memory for all recv buffers, the connection ID and the completion message
+        // - recv buffers are not included when the user specified to recv into the same shared buffer
+        if (m_useRio)
         {
-            // recv will only use the same shared buffer when the user specified to do so on the cmdline
+            const auto registeredBytes = VisitBufferPolicy([&](auto policy) noexcept {
+                return decltype(policy)::GetRegisteredBytes(recvCount, maxBufferSize, c_rioControlBytes);
+            });
+            const auto recvBufferBytes = static_cast<unsigned long>(registeredBytes - c_rioControlBytes);
+            m_rioBufferLease = ctsRioBufferLease(static_cast<unsigned long>(registeredBytes));
+
+            const auto& leasedSlice = m_rioBufferLease.Get();
+            m_rioConnectionIdBuffer = leasedSlice.m_buffer + recvBufferBytes;
+            m_rioCompletionMessageBuffer = m_rioConnectionIdBuffer + ctsStatistics::c_connectionIdLength;
+
             if (ctsConfig::g_configSettings->UseSharedBuffer)
             {
-                for (unsigned long bufferCount = 0; bufferCount < recvCount; ++bufferCount)
-                {
-                    m_recvBufferFreeList[bufferCount] = g_receiverSharedBuffer;
-                    if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
-                    {
-                        m_receivingRioBufferIds[bufferCount].m_bufferId = ctRIORegisterBuffer(g_receiverSharedBuffer, g_maximumBufferSize);
-                        if (m_receivingRioBufferIds[bufferCount].m_bufferId == RIO_INVALID_BUFFERID)
-                        {
-                            THROW_WIN32_MSG(WSAGetLastError(), "RIORegisterBuffer");
-                        }
-                    }
-                }
+                const auto& sharedBuffers = GetLocalSharedBuffers();
+                m_rioRecvBufferId = sharedBuffers.m_receiverRioBufferId;
+                m_rioRecvBufferBase = sharedBuffers.m_receiverBuffer;
+                m_rioRecvBufferBaseOffset = 0;
             }
             else
             {
-                // every recv will need their own buffer to use
-                // we must keep track of the raw buffers even with RIO as we need the backing buffers to compare against
-                m_recvBufferContainer.resize(ctsConfig::GetMaxBufferSize() * recvCount);
-                auto* const rawRecvBuffer = &m_recvBufferContainer[0];
+                m_rioRecvBufferId = leasedSlice.m_bufferId;
+                m_rioRecvBufferBase = leasedSlice.m_buffer;
+                m_rioRecvBufferBaseOffset = leasedSlice.m_offset;
+            }
+        }
 
-                for (unsigned long bufferCount = 0; bufferCount < recvCount; ++bufferCount)
+        // zero-byte recvs leave every entry in the free list as nullptr : buffers are leased as data arrives
+        if (recvCount > 0 && !m_zeroByteRecvs)
+        {
+            // recv will only use the same shared buffer when the user specified to do so on the cmdline
+            // every other recv will need their own buffer to use
+            // - we must keep track of the raw buffers even with RIO as we need the backing buffers to compare against
+            VisitBufferPolicy([&](auto policy) {
+                using BufferPolicy = decltype(policy);
+                char* rawRecvBuffer = m_rioRecvBufferBase;
+                const auto recvBufferBytes = BufferPolicy::GetRecvBufferBytes(recvCount, maxBufferSize);
+                if (!rawRecvBuffer && recvBufferBytes > 0)
                 {
-                    auto* const nextBuffer = rawRecvBuffer + static_cast<size_t>(bufferCount * ctsConfig::GetMaxBufferSize());
-                    m_recvBufferFreeList[bufferCount] = nextBuffer;
-
-                    if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
                     {
-                        m_receivingRioBufferIds[bufferCount].m_bufferId = ctRIORegisterBuffer(nextBuffer, ctsConfig::GetMaxBufferSize());
-                        if (m_receivingRioBufferIds[bufferCount].m_bufferId == RIO_INVALID_BUFFERID)
+                        const auto lock = g_recycledRecvBuffersLock.lock();
+                        if (!g_recycledRecvBuffers.empty() && g_recycledRecvBuffers.rbegin()->size() == recvBufferBytes)
                         {
-                            THROW_WIN32_MSG(WSAGetLastError(), "RIORegisterBuffer");
+                            m_recvBufferContainer = std::move(*g_recycledRecvBuffers.rbegin());
+                            g_recycledRecvBuffers.pop_back();
                         }
                     }
+                    if (m_recvBufferContainer.empty())
+                    {
+                        m_recvBufferContainer.resize(recvBufferBytes);
+                    }
+                    rawRecvBuffer = &m_recvBufferContainer[0];
                 }
-            }
-        }
-
-        // register buffers for the connection ID and the completion message
-        if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
-        {
-            m_rioConnectionId.m_bufferId = ctRIORegisterBuffer(GetConnectionIdentifier(), ctsStatistics::c_connectionIdLength);
-            if (m_rioConnectionId.m_bufferId == RIO_INVALID_BUFFERID)
-            {
-                THROW_WIN32_MSG(WSAGetLastError(), "RIORegisterBuffer");
-            }
 
-            m_rioCompletionMessage.m_bufferId = ctRIORegisterBuffer(m_completionMessageBuffer.data(), static_cast<DWORD>(m_completionMessageBuffer.size()));
-            if (m_rioCompletionMessage.m_bufferId == RIO_INVALID_BUFFERID)
-            {
-                THROW_WIN32_MSG(WSAGetLastError(), "RIORegisterBuffer");
-            }
+                for (size_t bufferCount = 0; bufferCount < recvCount; ++bufferCount)
+                {
+                    m_recvBufferFreeList[bufferCount] = BufferPolicy::GetRecvBuffer(GetLocalSharedBuffers().m_receiverBuffer, rawRecvBuffer, bufferCount, maxBufferSize);
+                }
+                return 0;
+            });
         }
     }
 
@@ -195,32 +871,39 @@ namespace ctsTraffic
         memcpy_s(m_completionMessageBuffer.data(), m_completionMessageBuffer.size(), c_completionMessage, c_completionMessageSize);
 
         // if not using RIO, will just use the same global read-only buffer
-        // if using RIO, we must have a unique RIO_BUFFERID for each concurrent RIOSend
+        // if using RIO, every send uses the process-wide registration of that same buffer
+        // - but still limiting how many sends can be in flight at once
         if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
         {
-            m_sendingRioBufferIds.resize(g_maxNumberOfRioSendBuffers);
-            for (auto& sendingBuffer : m_sendingRioBufferIds)
-            {
-                sendingBuffer.m_bufferId = ctRIORegisterBuffer(g_senderSharedBuffer, g_maximumBufferSize);
-                if (sendingBuffer.m_bufferId == RIO_INVALID_BUFFERID)
-                {
-                    THROW_WIN32_MSG(WSAGetLastError(), "RIORegisterBuffer");
-                }
-            }
+            m_rioSendsAvailable = g_maxNumberOfRioSendBuffers;
 
-            // CreateRecvBuffers should have already created these 2 RIO Buffers
-            FAIL_FAST_IF(m_rioConnectionId.m_bufferId == RIO_INVALID_BUFFERID);
-            FAIL_FAST_IF(m_rioCompletionMessage.m_bufferId == RIO_INVALID_BUFFERID);
+            // CreateRecvBuffers should have already leased the RIO buffer for these
+            FAIL_FAST_IF(m_rioConnectionIdBuffer == nullptr);
+            FAIL_FAST_IF(m_rioCompletionMessageBuffer == nullptr);
+            memcpy_s(m_rioCompletionMessageBuffer, c_completionMessageSize, c_completionMessage, c_completionMessageSize);
         }
     }
 
     ctsIoPattern::ctsIoPattern(unsigned long recvCount) :
+        m_useRio(WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO)),
+        m_verifyRecvs(
+            ctsConfig::g_configSettings->Protocol == ctsConfig::ProtocolType::TCP &&
+            (ctsConfig::g_configSettings->ShouldVerifyBuffers || ctsConfig::g_configSettings->ShouldVerifyChecksums)),
+        m_verifyChecksums(ctsConfig::g_configSettings->ShouldVerifyChecksums),
+        m_seededPayload(ctsConfig::g_configSettings->SeededPayload),
+        m_timestampIo(!ctsConfig::g_configSettings->LatencyPercentiles.empty()),
+        m_zeroByteRecvs(ctsConfig::g_configSettings->Options & ctsConfig::OptionType::ZeroByteRecv),
+        m_tcpBytesPerSecondPeriod(ctsConfig::g_configSettings->TcpBytesPerSecondPeriod),
+        m_liveRateLimit(ctsConfig::g_configSettings->RateSearchStepMilliseconds > 0 || ctsConfig::g_configSettings->LoadProfile),
+        m_bytesSendingPerSecond(ctsConfig::GetTcpBytesPerSecond()),
         // (bytes/sec) * (1 sec/1000 ms) * (x ms/Quantum) == (bytes/quantum)
-        m_bytesSendingPerQuantum(ctsConfig::GetTcpBytesPerSecond()* static_cast<unsigned long long>(ctsConfig::g_configSettings->TcpBytesPerSecondPeriod) / 1000LL),
-        m_quantumStartTimeMs(ctTimer::SnapQpcInMillis())
+        m_bytesSendingPerQuantum(m_bytesSendingPerSecond * static_cast<unsigned long long>(m_tcpBytesPerSecondPeriod) / 1000LL),
+        m_quantumStartTimeMs(ctTimer::SnapQpcInMillis()),
+        m_paceSends(ctsConfig::g_configSettings->RateLimitPacing && (m_bytesSendingPerSecond > 0 || m_liveRateLimit))
     {
         FAIL_FAST_IF_MSG(
-            ctsConfig::g_configSettings->UseSharedBuffer && ctsConfig::g_configSettings->ShouldVerifyBuffers,
+            (ctsConfig::g_configSettings->ShouldVerifyBuffers || ctsConfig::g_configSettings->ShouldVerifyChecksums) &&
+            !VisitBufferPolicy([](auto policy) noexcept { return decltype(policy)::CanVerifyBuffer(); }),
             "Cannot use a shared buffer across connections and still verify buffers");
 
         // this init-once call is no-fail
@@ -234,10 +917,19 @@ namespace ctsTraffic
         {
             // we don't store recvCount : but we'll know it based on the size of m_recvBufferFreeList
             m_recvBufferFreeList.resize(recvCount);
-            if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+        }
+    }
+
+    ctsIoPattern::~ctsIoPattern() noexcept
+    {
+        if (!m_recvBufferContainer.empty())
+        {
+            try
             {
-                m_receivingRioBufferIds.resize(recvCount);
+                const auto lock = g_recycledRecvBuffersLock.lock();
+                g_recycledRecvBuffers.push_back(std::move(m_recvBufferContainer));
             }
+            CATCH_LOG()
         }
     }
 
@@ -253,6 +945,10 @@ namespace ctsTraffic
         switch (m_patternState.GetNextPatternType())
         {
             case ctsIoPatternType::MoreIo:
+                if (0 == m_transferStartQpc && ctsConfig::g_configSettings->PersistentTransfers > 1)
+                {
+                    m_transferStartQpc = ctTimer::SnapQpc();
+                }
                 returnTask = GetNextTaskFromPattern();
                 break;
 
@@ -262,8 +958,23 @@ namespace ctsTraffic
             case ctsIoPatternType::SendConnectionId: {
                 returnTask.m_ioAction = ctsTaskAction::Send;
                 returnTask.m_buffer = GetConnectionIdentifier();
-                returnTask.m_rioBufferid = m_rioConnectionId.m_bufferId;
                 returnTask.m_bufferLength = ctsStatistics::c_connectionIdLength;
+                if (ctsConfig::g_configSettings->LeanProtocol)
+                {
+                    // clients send the marker and the 16 bytes of the ID they generated
+                    memcpy_s(m_leanProtocolHeader.data(), m_leanProtocolHeader.size(), c_leanProtocolMarker, c_leanProtocolMarkerSize);
+                    FAIL_FAST_IF(!ctsStatistics::ReadConnectionId(
+                        reinterpret_cast<unsigned char*>(m_leanProtocolHeader.data() + c_leanProtocolMarkerSize),
+                        GetConnectionIdentifier()));
+                    returnTask.m_buffer = m_leanProtocolHeader.data();
+                    returnTask.m_bufferLength = c_leanProtocolHeaderSize;
+                }
+                if (m_rioConnectionIdBuffer)
+                {
+                    // RIO must send from registered memory
+                    memcpy_s(m_rioConnectionIdBuffer, ctsStatistics::c_connectionIdLength, returnTask.m_buffer, returnTask.m_bufferLength);
+                    SetRioLeasedBuffer(returnTask, m_rioConnectionIdBuffer);
+                }
                 returnTask.m_bufferOffset = 0;
                 returnTask.m_bufferType = ctsTask::BufferType::TcpConnectionId;
                 returnTask.m_trackIo = false;
@@ -273,8 +984,18 @@ namespace ctsTraffic
             case ctsIoPatternType::RecvConnectionId:
                 returnTask.m_ioAction = ctsTaskAction::Recv;
                 returnTask.m_buffer = GetConnectionIdentifier();
-                returnTask.m_rioBufferid = m_rioConnectionId.m_bufferId;
                 returnTask.m_bufferLength = ctsStatistics::c_connectionIdLength;
+                if (ctsConfig::g_configSettings->LeanProtocol)
+                {
+                    // servers receive the client's header - its ID is written to the connection identifier when completed
+                    returnTask.m_buffer = m_leanProtocolHeader.data();
+                    returnTask.m_bufferLength = c_leanProtocolHeaderSize;
+                }
+                if (m_rioConnectionIdBuffer)
+                {
+                    // RIO must recv into registered memory - copied to the connection identifier when completed
+                    SetRioLeasedBuffer(returnTask, m_rioConnectionIdBuffer);
+                }
                 returnTask.m_bufferOffset = 0;
                 returnTask.m_bufferType = ctsTask::BufferType::TcpConnectionId;
                 returnTask.m_trackIo = false;
@@ -282,11 +1003,14 @@ namespace ctsTraffic
 
             case ctsIoPatternType::SendCompletion:
                 // end-stats as early as possible after the actual IO finished
-                EndStatistics();
+                CompleteTransfer();
 
                 returnTask.m_ioAction = ctsTaskAction::Send;
                 returnTask.m_buffer = m_completionMessageBuffer.data();
-                returnTask.m_rioBufferid = m_rioCompletionMessage.m_bufferId;
+                if (m_rioCompletionMessageBuffer)
+                {
+                    SetRioLeasedBuffer(returnTask, m_rioCompletionMessageBuffer);
+                }
                 returnTask.m_bufferLength = c_completionMessageSize;
                 returnTask.m_bufferOffset = 0;
                 returnTask.m_bufferType = ctsTask::BufferType::CompletionMessage;
@@ -295,11 +1019,14 @@ namespace ctsTraffic
 
             case ctsIoPatternType::RecvCompletion:
                 // end-stats as early as possible after the actual IO finished
-                EndStatistics();
+                CompleteTransfer();
 
                 returnTask.m_ioAction = ctsTaskAction::Recv;
                 returnTask.m_buffer = m_completionMessageBuffer.data();
-                returnTask.m_rioBufferid = m_rioCompletionMessage.m_bufferId;
+                if (m_rioCompletionMessageBuffer)
+                {
+                    SetRioLeasedBuffer(returnTask, m_rioCompletionMessageBuffer);
+                }
                 returnTask.m_bufferLength = c_completionMessageSize;
                 returnTask.m_bufferOffset = 0;
                 returnTask.m_bufferType = ctsTask::BufferType::CompletionMessage;
@@ -329,7 +1056,10 @@ namespace ctsTraffic
 
                 returnTask.m_ioAction = ctsTaskAction::Recv;
                 returnTask.m_buffer = m_completionMessageBuffer.data();
-                returnTask.m_rioBufferid = m_rioCompletionMessage.m_bufferId;
+                if (m_rioCompletionMessageBuffer)
+                {
+                    SetRioLeasedBuffer(returnTask, m_rioCompletionMessageBuffer);
+                }
                 returnTask.m_bufferLength = c_completionMessageSize;
                 returnTask.m_bufferOffset = 0;
                 returnTask.m_trackIo = false;
@@ -340,7 +1070,32 @@ namespace ctsTraffic
                 FAIL_FAST_MSG("ctsIOPattern::initiate_io was called in an invalid state: dt %p ctsTraffic!ctsTraffic::ctsIOPattern", this);
         }
 
+        // timestamp TCP sends and recvs for the IO latency histogram
+        // - a task delayed by the rate limit is timestamped from when it's scheduled to be initiated
+        if (m_timestampIo &&
+            (ctsTaskAction::Send == returnTask.m_ioAction || ctsTaskAction::Recv == returnTask.m_ioAction))
+        {
+            returnTask.m_ioInitiatedQpc = ctTimer::SnapQpc();
+            if (returnTask.m_timeOffsetMicroseconds > 0)
+            {
+                returnTask.m_ioInitiatedQpc += ctTimer::ConvertMicrosecondsToQpc(returnTask.m_timeOffsetMicroseconds);
+            }
+            else if (returnTask.m_timeOffsetMilliseconds > 0)
+            {
+                returnTask.m_ioInitiatedQpc += ctTimer::ConvertMillisToQpc(returnTask.m_timeOffsetMilliseconds);
+            }
+        }
+
         m_patternState.NotifyNextTask(returnTask);
+        TraceLoggingWrite(
+            g_ctsTraceLoggingProvider,
+            "InitiateIo",
+            TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+            TraceLoggingKeyword(CTS_TRACE_KEYWORD_IO),
+            TraceLoggingPointer(this, "IoPattern"),
+            TraceLoggingUInt32(static_cast<UINT32>(returnTask.m_ioAction), "IoAction"),
+            TraceLoggingUInt32(returnTask.m_bufferLength, "BufferLength"),
+            TraceLoggingInt64(returnTask.m_timeOffsetMilliseconds, "TimeOffsetMs"));
         return returnTask;
     }
 
@@ -364,6 +1119,31 @@ namespace ctsTraffic
     {
         // preserve the initial state for the prior task
         const bool wasIoRequestedFromPattern = m_patternState.IsCurrentStateMoreIo();
+        TraceLoggingWrite(
+            g_ctsTraceLoggingProvider,
+            "CompleteIo",
+            TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+            TraceLoggingKeyword(CTS_TRACE_KEYWORD_IO),
+            TraceLoggingPointer(this, "IoPattern"),
+            TraceLoggingUInt32(static_cast<UINT32>(originalTask.m_ioAction), "IoAction"),
+            TraceLoggingUInt32(currentTransfer, "BytesTransferred"),
+            TraceLoggingUInt32(statusCode, "StatusCode"));
+
+        // a leased recv buffer goes back to the pool only once its received data has been verified
+        char* leasedRecvBuffer = nullptr;
+        const auto returnLeasedRecvBuffer = wil::scope_exit([&]() noexcept {
+            if (leasedRecvBuffer)
+            {
+                ReturnLeasedRecvBuffer(leasedRecvBuffer);
+            }
+        });
+
+        // the first bytes received since ConnectEx was posted - including a connection ID sent by the server
+        if (m_connectInitiatedQpc != 0 && ctsTaskAction::Recv == originalTask.m_ioAction && NO_ERROR == statusCode && currentTransfer > 0)
+        {
+            ctsConfig::g_configSettings->TcpStatusDetails.m_firstByteLatency.Record(ctTimer::SnapQpc() - m_connectInitiatedQpc);
+            m_connectInitiatedQpc = 0LL;
+        }
 
         // add the recv buffer back if it was one of our dynamically allocated recv buffers
         // add back the RIO BufferId if it was a RIO request
@@ -371,20 +1151,27 @@ namespace ctsTraffic
         {
             if (originalTask.m_ioAction == ctsTaskAction::Recv)
             {
-                m_recvBufferFreeList.push_back(originalTask.m_buffer);
-            }
-
-            if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
-            {
-                if (originalTask.m_ioAction == ctsTaskAction::Send)
+                if (m_zeroByteRecvs)
                 {
-                    m_sendingRioBufferIds.emplace_back(originalTask.m_rioBufferid);
+                    // the buffer is null if the zero-byte recv failed before a buffer was leased
+                    leasedRecvBuffer = originalTask.m_buffer;
+                    m_recvBufferFreeList.push_back(nullptr);
                 }
                 else
                 {
-                    m_receivingRioBufferIds.emplace_back(originalTask.m_rioBufferid);
+                    m_recvBufferFreeList.push_back(originalTask.m_buffer);
                 }
             }
+
+            if (m_useRio && originalTask.m_ioAction == ctsTaskAction::Send)
+            {
+                ++m_rioSendsAvailable;
+            }
+
+            if (m_seededPayload && originalTask.m_ioAction == ctsTaskAction::Send)
+            {
+                CompleteSeededPayloadSend(originalTask);
+            }
         }
 
         switch (originalTask.m_ioAction)
@@ -425,8 +1212,34 @@ namespace ctsTraffic
                     }
                     else
                     {
+                        // RIO received the connection id into its registered buffer
+                        if (ctsTask::BufferType::TcpConnectionId == originalTask.m_bufferType &&
+                            ctsTaskAction::Recv == originalTask.m_ioAction &&
+                            originalTask.m_buffer == m_rioConnectionIdBuffer &&
+                            !ctsConfig::g_configSettings->LeanProtocol)
+                        {
+                            memcpy_s(GetConnectionIdentifier(), ctsStatistics::c_connectionIdLength, m_rioConnectionIdBuffer, ctsStatistics::c_connectionIdLength);
+                        }
+
                         // process the TCP protocol state machine in pattern_state after receiving the connection id
-                        UpdateLastPatternError(m_patternState.CompletedTask(originalTask, currentTransfer));
+                        const auto completedTransfers = m_patternState.GetCompletedTransfers();
+                        const auto patternStatus = m_patternState.CompletedTask(originalTask, currentTransfer);
+                        UpdateLastPatternError(patternStatus);
+                        if (ctsConfig::g_configSettings->LeanProtocol &&
+                            ctsTask::BufferType::TcpConnectionId == originalTask.m_bufferType &&
+                            ctsTaskAction::Recv == originalTask.m_ioAction &&
+                            ctsIoPatternError::NoError == patternStatus)
+                        {
+                            // the state machine verified the marker : the client's ID follows it
+                            ctsStatistics::WriteConnectionId(
+                                GetConnectionIdentifier(),
+                                reinterpret_cast<const unsigned char*>(originalTask.m_buffer + c_leanProtocolMarkerSize));
+                        }
+                        if (m_patternState.GetCompletedTransfers() != completedTransfers)
+                        {
+                            // -PersistentTransfers : the completion message ended a transfer and the next one begins
+                            ResetForNextTransfer();
+                        }
                     }
                 }
                 else if (statusCode != NO_ERROR)
@@ -461,11 +1274,10 @@ namespace ctsTraffic
                     //
                     // if this is a TCP receive completion
                     // and no IO or protocol errors
-                    // and the user requested to verify buffers
+                    // and the user requested to verify buffers (or their checksums)
                     // then actually validate the received completion
                     //
-                    if (ctsConfig::g_configSettings->Protocol == ctsConfig::ProtocolType::TCP &&
-                        ctsConfig::g_configSettings->ShouldVerifyBuffers &&
+                    if (m_verifyRecvs &&
                         originalTask.m_ioAction == ctsTaskAction::Recv &&
                         originalTask.m_trackIo &&
                         (ctsIoPatternError::SuccessfullyCompleted == patternStatus || ctsIoPatternError::NoError == patternStatus))
@@ -476,13 +1288,19 @@ namespace ctsTraffic
                             "ctsIOPattern::complete_io() : ctsIOTask (%p) expected_pattern_offset (%lu) does not match the current pattern_offset (%Iu)",
                             &originalTask, originalTask.m_expectedPatternOffset, static_cast<size_t>(m_recvPatternOffset));
 
-                        if (!VerifyBuffer(originalTask, currentTransfer))
+                        const auto verified = m_verifyChecksums ?
+                            VerifyChecksums(originalTask, currentTransfer) :
+                            m_seededPayload ?
+                            VerifySeededPayload(originalTask, currentTransfer) :
+                            VerifyBuffer(originalTask, currentTransfer);
+                        if (!verified)
                         {
                             UpdateLastError(c_statusErrorDataDidNotMatchBitPattern);
                         }
 
                         m_recvPatternOffset += currentTransfer;
-                        m_recvPatternOffset %= c_bufferPatternSize;
+                        m_recvPatternOffset %= g_bufferPatternSize;
+                        m_recvStreamOffset += currentTransfer;
                     }
                 }
                 break;
@@ -501,13 +1319,55 @@ namespace ctsTraffic
             if (ctsTaskAction::Send == originalTask.m_ioAction)
             {
                 ctsConfig::g_configSettings->TcpStatusDetails.m_bytesSent.Add(currentTransfer);
+                if (m_targetStatistics)
+                {
+                    m_targetStatistics->m_bytesSent.Add(currentTransfer);
+                }
             }
             else
             {
                 ctsConfig::g_configSettings->TcpStatusDetails.m_bytesRecv.Add(currentTransfer);
+                if (m_targetStatistics)
+                {
+                    m_targetStatistics->m_bytesRecv.Add(currentTransfer);
+                }
+            }
+            ctsConfig::g_configSettings->TcpStatusDetails.m_ioCompletions.Increment();
+            if (ctsConfig::g_configSettings->MessageSize > 0 && originalTask.m_trackIo && currentTransfer > 0)
+            {
+                bool endedMidMessage{};
+                const auto messages = m_patternState.CompletedMessages(originalTask.m_ioAction, currentTransfer, endedMidMessage);
+                if (ctsTaskAction::Send == originalTask.m_ioAction)
+                {
+                    ctsConfig::g_configSettings->TcpStatusDetails.m_messagesSent.Add(messages);
+                    ctsConfig::g_configSettings->TcpStatusDetails.m_messageSends.Increment();
+                }
+                else
+                {
+                    ctsConfig::g_configSettings->TcpStatusDetails.m_messagesRecv.Add(messages);
+                    ctsConfig::g_configSettings->TcpStatusDetails.m_messageRecvs.Increment();
+                    if (endedMidMessage)
+                    {
+                        ctsConfig::g_configSettings->TcpStatusDetails.m_splitMessageRecvs.Increment();
+                    }
+                }
+            }
+            if (ctsConfig::g_configSettings->ConnectionSampleIntervalMilliseconds > 0)
+            {
+                AddConnectionSample(currentTransfer);
+            }
+            if (originalTask.m_ioInitiatedQpc != 0)
+            {
+                const auto completedQpc = ctTimer::SnapQpc();
+                ctsConfig::g_configSettings->TcpStatusDetails.m_ioLatency.Record(completedQpc - originalTask.m_ioInitiatedQpc);
+                if (m_targetStatistics)
+                {
+                    m_targetStatistics->m_ioLatency.Record(completedQpc - originalTask.m_ioInitiatedQpc);
+                }
             }
             // only complete tasks that were requested
-            if (wasIoRequestedFromPattern)
+            // - a -LeanProtocol connection ID can complete after the pattern already started its IO
+            if (wasIoRequestedFromPattern && ctsTask::BufferType::TcpConnectionId != originalTask.m_bufferType)
             {
                 UpdateLastPatternError(CompleteTaskBackToPattern(originalTask, currentTransfer));
             }
@@ -526,6 +1386,36 @@ namespace ctsTraffic
         return GetCurrentStatus();
     }
 
+    void ctsIoPattern::CompleteTransfer() noexcept
+    {
+        if (m_transferStartQpc != 0)
+        {
+            const auto microseconds = ctTimer::ConvertQpcToMicroseconds(ctTimer::SnapQpc() - m_transferStartQpc);
+            m_transferStartQpc = 0LL;
+            AddTransferTiming(microseconds);
+
+            auto& statusDetails = ctsConfig::g_configSettings->TcpStatusDetails;
+            if (0 == m_patternState.GetCompletedTransfers())
+            {
+                statusDetails.m_coldTransfers.Increment();
+                statusDetails.m_coldTransferBytes.Add(static_cast<long long>(GetTotalTransfer()));
+                statusDetails.m_coldTransferMicroseconds.Add(microseconds);
+            }
+            else
+            {
+                statusDetails.m_warmTransfers.Increment();
+                statusDetails.m_warmTransferBytes.Add(static_cast<long long>(GetTotalTransfer()));
+                statusDetails.m_warmTransferMicroseconds.Add(microseconds);
+            }
+        }
+
+        // the connection stays open for its next transfer
+        if (m_patternState.IsLastTransfer())
+        {
+            EndStatistics();
+        }
+    }
+
     ctsTask ctsIoPattern::CreateTrackedTask(ctsTaskAction action, unsigned long maxTransfer) noexcept
     {
         ctsTask returnTask(CreateNewTask(action, maxTransfer));
@@ -548,8 +1438,11 @@ namespace ctsTraffic
         //
 
         // first: calculate the next buffer size assuming no max ceiling specified by the protocol
+        // - with -MessageSize, each send is a single message while recvs are still sized by -Buffer
         const auto remainingTransfer = m_patternState.GetRemainingTransfer();
-        const auto nextBufferSize = ctsConfig::GetBufferSize();
+        const auto nextBufferSize = ctsTaskAction::Send == action && ctsConfig::g_configSettings->MessageSize > 0 ?
+            ctsConfig::g_configSettings->MessageSize :
+            static_cast<unsigned long>(ctsConfig::GetBufferSize());
         const auto minBufferSize = min<uint64_t>(remainingTransfer, nextBufferSize);
         uint64_t newBufferSize = minBufferSize;
 
@@ -573,15 +1466,64 @@ namespace ctsTraffic
         {
             // with RIO, we have preallocated only so many pre-pinned buffers for data to keep in flight
             // if that's exhausted, return no-IO yet
-            if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO) && m_sendingRioBufferIds.empty())
+            if (m_useRio && 0 == m_rioSendsAvailable)
             {
                 return ctsTask();
             }
 
+            // with -verify:seeded, sends are taken from the connection's ring of payload slots
+            // - a send doesn't span slots, and if the next slot is still waiting on its sends to complete, return no-IO yet
+            SeededPayloadSlot* seededSlot = nullptr;
+            if (m_seededPayload)
+            {
+                seededSlot = NextSeededPayloadSlot();
+                if (!seededSlot)
+                {
+                    return ctsTask();
+                }
+                newBufferSize = min<uint64_t>(newBufferSize, m_seededSlotSize - seededSlot->m_consumed);
+            }
+
+            if (m_liveRateLimit)
+            {
+                const auto currentRate = ctsConfig::GetTcpBytesPerSecond();
+                if (currentRate != m_bytesSendingPerSecond)
+                {
+                    m_bytesSendingPerSecond = currentRate;
+                    m_bytesSendingPerQuantum = m_bytesSendingPerSecond * static_cast<unsigned long long>(m_tcpBytesPerSecondPeriod) / 1000LL;
+                }
+            }
+
             //
             // check to see if the send needs to be deferred into the future
             //
-            if (m_bytesSendingPerQuantum > 0)
+            // - a -LoadProfile rate of zero is unlimited
+            if (m_paceSends && m_bytesSendingPerSecond > 0)
+            {
+                // a token bucket holding a single send: spreading sends evenly instead of bursting each quantum
+                // - a send departs once the bytes sent before it have drained at the limited rate
+                // - if sends fell behind (e.g. the send buffer was full), the debt isn't carried forward as a burst
+                const auto currentQpc = ctTimer::SnapQpc();
+                if (m_nextPacedSendQpc < currentQpc)
+                {
+                    m_nextPacedSendQpc = currentQpc;
+                }
+
+                const auto delayMicroseconds = ctTimer::ConvertQpcToMicroseconds(m_nextPacedSendQpc - currentQpc);
+                if (delayMicroseconds >= c_minimumPacingDelayMicroseconds)
+                {
+                    returnTask.m_timeOffsetMicroseconds = delayMicroseconds;
+                    returnTask.m_timeOffsetMilliseconds = (delayMicroseconds + 999LL) / 1000LL;
+                }
+                else
+                {
+                    returnTask.m_timeOffsetMicroseconds = 0LL;
+                    returnTask.m_timeOffsetMilliseconds = 0LL;
+                }
+
+                m_nextPacedSendQpc += static_cast<long long>(newBufferSize) * ctTimer::SnapQpf() / static_cast<long long>(m_bytesSendingPerSecond);
+            }
+            else if (m_bytesSendingPerQuantum > 0)
             {
                 const auto currentTimeMs(ctTimer::SnapQpcInMillis());
                 if (m_bytesSendingThisQuantum < m_bytesSendingPerQuantum)
@@ -592,13 +1534,13 @@ namespace ctsTraffic
                     // no need to adjust quantum_start_time_ms unless we skipped into a new quantum
                     // (meaning the previous quantum had not filled the max bytes for that quantum)
                     // ReSharper disable once CppRedundantParentheses
-                    if (currentTimeMs > (m_quantumStartTimeMs + ctsConfig::g_configSettings->TcpBytesPerSecondPeriod))
+                    if (currentTimeMs > (m_quantumStartTimeMs + m_tcpBytesPerSecondPeriod))
                     {
                         // current time shows it's now beyond this quantum timeframe
                         // - once we see how many quantums we have skipped forward, move our quantum start time to the quantum we are actually in
                         // - then adjust the number of bytes we are to send this quantum by how many quantum we just skipped
-                        const auto quantumsSkippedSinceLastSend = (currentTimeMs - m_quantumStartTimeMs) / ctsConfig::g_configSettings->TcpBytesPerSecondPeriod;
-                        m_quantumStartTimeMs += quantumsSkippedSinceLastSend * ctsConfig::g_configSettings->TcpBytesPerSecondPeriod;
+                        const auto quantumsSkippedSinceLastSend = (currentTimeMs - m_quantumStartTimeMs) / m_tcpBytesPerSecondPeriod;
+                        m_quantumStartTimeMs += quantumsSkippedSinceLastSend * m_tcpBytesPerSecondPeriod;
 
                         // we have to be careful making this adjustment since the remainingbytes this quantum could be very small
                         // - we only subtract out if the number of bytes skipped is >= bytes actually skipped
@@ -623,7 +1565,7 @@ namespace ctsTraffic
 
                     // ms_for_quantums_to_skip = the # of quantum beyond the current quantum that will be skipped
                     // - when we have already sent at least 1 additional quantum of bytes
-                    const ctsSignedLongLong msForQuantumsToSkip = (quantumAheadToSchedule - 1) * ctsConfig::g_configSettings->TcpBytesPerSecondPeriod;
+                    const ctsSignedLongLong msForQuantumsToSkip = (quantumAheadToSchedule - 1) * m_tcpBytesPerSecondPeriod;
 
                     // carry forward extra bytes from quantums that will be filled by the bytes we have already sent
                     // (including the current quantum)
@@ -634,15 +1576,15 @@ namespace ctsTraffic
                     // update the return task for when to schedule the send
                     // first, calculate the time to get to the end of this time quantum
                     // - only adjust if the current time isn't already outside this quantum
-                    if (currentTimeMs < m_quantumStartTimeMs + ctsConfig::g_configSettings->TcpBytesPerSecondPeriod)
+                    if (currentTimeMs < m_quantumStartTimeMs + m_tcpBytesPerSecondPeriod)
                     {
-                        returnTask.m_timeOffsetMilliseconds = m_quantumStartTimeMs + ctsConfig::g_configSettings->TcpBytesPerSecondPeriod - currentTimeMs;
+                        returnTask.m_timeOffsetMilliseconds = m_quantumStartTimeMs + m_tcpBytesPerSecondPeriod - currentTimeMs;
                     }
                     // then add in any quantum we need to skip
                     returnTask.m_timeOffsetMilliseconds += msForQuantumsToSkip;
 
                     // finally, adjust quantum_start_time_ms to the next quantum which IO will complete
-                    m_quantumStartTimeMs += msForQuantumsToSkip + ctsConfig::g_configSettings->TcpBytesPerSecondPeriod;
+                    m_quantumStartTimeMs += msForQuantumsToSkip + m_tcpBytesPerSecondPeriod;
                 }
             }
             else
@@ -654,29 +1596,50 @@ namespace ctsTraffic
             returnTask.m_bufferType = ctsTask::BufferType::Static;
             returnTask.m_bufferLength = static_cast<unsigned long>(newBufferSize);
             returnTask.m_bufferOffset = static_cast<unsigned long>(m_sendPatternOffset);
+            returnTask.m_bufferSegments = ctsConfig::g_configSettings->BufferSegments;
+            returnTask.m_segmentHeaderLength = ctsConfig::g_configSettings->BufferSegmentHeaderLength;
             returnTask.m_expectedPatternOffset = 0;
-            returnTask.m_buffer = g_senderSharedBuffer;
+            // every replica holds the same pattern : send from the one local to the processor initiating the send
+            const auto& sharedBuffers = GetLocalSharedBuffers();
+            returnTask.m_buffer = sharedBuffers.m_senderBuffer;
 
-            // every RIOSend must have unique RIO buffer IDs - it can't reuse buffers ID's like WSASend can use the same m_buffer
-            if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+            // every RIOSend uses the process-wide registration of the shared send buffer at the pattern offset
+            // - tracked as Dynamic so CompleteIo returns the in-flight send back to m_rioSendsAvailable
+            if (m_useRio)
             {
                 FAIL_FAST_IF_MSG(
-                    m_sendingRioBufferIds.empty(),
-                    "m_sendingRioBufferIds is empty for a new Send task  (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
+                    0 == m_rioSendsAvailable,
+                    "m_rioSendsAvailable is zero for a new Send task  (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
+                returnTask.m_bufferType = ctsTask::BufferType::Dynamic;
+                returnTask.m_rioBufferid = sharedBuffers.m_senderRioBufferId;
+                returnTask.m_rioBufferOffset = 0;
+                --m_rioSendsAvailable;
+            }
+
+            // the send is made from this connection's own payload in the slot
+            // - tracked as Dynamic so CompleteIo returns the send to its slot
+            if (seededSlot)
+            {
                 returnTask.m_bufferType = ctsTask::BufferType::Dynamic;
-                // Release successfully hands off the RIO_BUFFERID - safe to pop this object now
-                returnTask.m_rioBufferid = m_sendingRioBufferIds.rbegin()->Release();
-                m_sendingRioBufferIds.pop_back();
+                returnTask.m_buffer = seededSlot->m_buffer;
+                returnTask.m_bufferOffset = seededSlot->m_consumed;
+                ++seededSlot->m_sendsInFlight;
+                seededSlot->m_consumed += static_cast<unsigned long>(newBufferSize);
+                if (seededSlot->m_consumed == m_seededSlotSize)
+                {
+                    // the next send continues the stream from the slot after this one
+                    m_seededSendSlot = (m_seededSendSlot + 1) % m_seededSlots.size();
+                }
             }
 
             // now that we are indicating this buffer to send, increment the offset for the next send request
             m_sendPatternOffset += newBufferSize;
-            m_sendPatternOffset %= c_bufferPatternSize;
+            m_sendPatternOffset %= g_bufferPatternSize;
 
             FAIL_FAST_IF_MSG(
-                m_sendPatternOffset >= c_bufferPatternSize,
+                m_sendPatternOffset >= g_bufferPatternSize,
                 "pattern_offset being too large (larger than BufferPatternSize %lu) means we might walk off the end of our shared buffer (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)",
-                c_bufferPatternSize, this);
+                g_bufferPatternSize, this);
             FAIL_FAST_IF_MSG(
                 returnTask.m_bufferLength + returnTask.m_bufferOffset > g_maximumBufferSize,
                 "return_task (%p) for a Send request is specifying a buffer that is larger than the static SharedBufferSize (%lu) (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)",
@@ -689,6 +1652,8 @@ namespace ctsTraffic
             returnTask.m_bufferType = ctsTask::BufferType::Dynamic;
             returnTask.m_bufferLength = static_cast<unsigned long>(newBufferSize);
             returnTask.m_bufferOffset = 0; // always recv to the beginning of the buffer
+            returnTask.m_bufferSegments = ctsConfig::g_configSettings->BufferSegments;
+            returnTask.m_segmentHeaderLength = ctsConfig::g_configSettings->BufferSegmentHeaderLength;
             returnTask.m_expectedPatternOffset = static_cast<unsigned long>(m_recvPatternOffset);
 
             FAIL_FAST_IF_MSG(
@@ -697,19 +1662,15 @@ namespace ctsTraffic
             returnTask.m_buffer = *m_recvBufferFreeList.rbegin();
             m_recvBufferFreeList.pop_back();
 
-            if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+            // the recv buffer was carved from the leased RIO buffer (or is the shared recv buffer)
+            if (m_useRio)
             {
-                FAIL_FAST_IF_MSG(
-                    m_receivingRioBufferIds.empty(),
-                    "m_receivingRioBufferIds is empty for a new Recv task  (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
-                returnTask.m_rioBufferid = m_receivingRioBufferIds.rbegin()->m_bufferId;
-                // successfully handed off the RIO_BUFFERID - don't deregister it when we pop it
-                m_receivingRioBufferIds.rbegin()->m_bufferId = RIO_INVALID_BUFFERID;
-                m_receivingRioBufferIds.pop_back();
+                returnTask.m_rioBufferid = m_rioRecvBufferId;
+                returnTask.m_rioBufferOffset = m_rioRecvBufferBaseOffset + static_cast<unsigned long>(returnTask.m_buffer - m_rioRecvBufferBase);
             }
 
             FAIL_FAST_IF_MSG(
-                m_recvPatternOffset >= c_bufferPatternSize,
+                m_recvPatternOffset >= g_bufferPatternSize,
                 "pattern_offset being too large means we might walk off the end of our shared buffer (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
             FAIL_FAST_IF_MSG(
                 returnTask.m_bufferLength + returnTask.m_bufferOffset > newBufferSize,
@@ -729,30 +1690,207 @@ namespace ctsTraffic
             return true;
         }
         //
-        // We're using RtlCompareMemory instead of memcmp because it returns the first offset at which the buffers differ,
-        // which is more useful than memcmp's "sign of the difference between the first two differing elements"
+        // The sent bytes repeat g_bufferPattern every g_bufferPatternSize bytes
+        // - compare directly against the pattern, a piece at a time, wrapping back to the start of the pattern
+        //   rather than against a larger (or allocated) buffer of repeated copies
+        // - the compare returns the first offset at which the buffers differ,
+        //   which is more useful than memcmp's "sign of the difference between the first two differing elements"
         //
-        const auto* const patternBuffer = g_senderSharedBuffer + originalTask.m_expectedPatternOffset;
-        const size_t lengthMatched = RtlCompareMemory(
-            patternBuffer,
-            originalTask.m_buffer + originalTask.m_bufferOffset,
-            transferredBytes);
+        const auto* const receivedBuffer = reinterpret_cast<const unsigned char*>(originalTask.m_buffer + originalTask.m_bufferOffset);
+        size_t patternOffset = originalTask.m_expectedPatternOffset % g_bufferPatternSize;
+        size_t lengthMatched = 0;
+        while (lengthMatched < transferredBytes)
+        {
+            const size_t bytesRemaining = transferredBytes - lengthMatched;
+            const size_t patternRemaining = g_bufferPatternSize - patternOffset;
+            const size_t compareLength = bytesRemaining < patternRemaining ? bytesRemaining : patternRemaining;
+
+            const size_t compareMatched = g_compareMemory(g_bufferPattern + patternOffset, receivedBuffer + lengthMatched, compareLength);
+            lengthMatched += compareMatched;
+            if (compareMatched != compareLength)
+            {
+                break;
+            }
+            patternOffset = 0;
+        }
+
         if (lengthMatched != transferredBytes)
         {
+            const size_t mismatchedPatternOffset = (originalTask.m_expectedPatternOffset + lengthMatched) % g_bufferPatternSize;
             ctsConfig::PrintErrorInfo(
                 L"ctsIOPattern found data corruption: detected an invalid byte pattern in the returned buffer (length %u): "
-                L"buffer received (%p), expected buffer pattern (%p) - mismatch from expected pattern at offset (%Iu) [expected 32-bit value '0x%x' didn't match '0x%x']",
+                L"buffer received (%p), expected buffer pattern offset (%lu) - mismatch from expected pattern at offset (%Iu) [expected byte value '0x%x' didn't match '0x%x']",
                 transferredBytes,
-                originalTask.m_buffer + originalTask.m_bufferOffset,
-                patternBuffer,
+                receivedBuffer,
+                originalTask.m_expectedPatternOffset,
                 lengthMatched,
-                patternBuffer[lengthMatched],
-                *(originalTask.m_buffer + originalTask.m_bufferOffset + lengthMatched));
+                g_bufferPattern[mismatchedPatternOffset],
+                receivedBuffer[lengthMatched]);
         }
 
         return lengthMatched == transferredBytes;
     }
 
+    void ctsIoPattern::CreateSeededPayloadSeeds() noexcept
+    {
+        // the connection ID was exchanged before any data : both endpoints derive the same seed for each direction
+        const bool isServer = ctsConfig::IsListening();
+        m_seededSendSeed = MakeSeededPayloadSeed(GetConnectionIdentifier(), isServer);
+        m_seededRecvSeed = MakeSeededPayloadSeed(GetConnectionIdentifier(), !isServer);
+        m_seededSeedsCreated = true;
+    }
+
+    ctsIoPattern::SeededPayloadSlot* ctsIoPattern::NextSeededPayloadSlot() noexcept
+    {
+        if (m_seededSlots.empty())
+        {
+            if (!m_seededSeedsCreated)
+            {
+                CreateSeededPayloadSeeds();
+            }
+
+            // enough slots to keep -PrePostSends full-sized sends in flight while the next slot is filled
+            const auto slotCount = ctsConfig::g_configSettings->PrePostSends > 0 ?
+                static_cast<size_t>(ctsConfig::g_configSettings->PrePostSends) + 1 :
+                c_seededPayloadIsbSlots;
+            m_seededSlotSize = ctsConfig::GetMaxBufferSize();
+            try
+            {
+                m_seededSlotContainer.resize(slotCount * m_seededSlotSize);
+                m_seededSlots.resize(slotCount);
+            }
+            catch (...)
+            {
+                FAIL_FAST_MSG("ctsIOPattern: failed to allocate the -verify:seeded send slots (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
+            }
+
+            for (auto& slot : m_seededSlots)
+            {
+                slot.m_buffer = m_seededSlotContainer.data() + (&slot - m_seededSlots.data()) * m_seededSlotSize;
+                FillSeededPayloadSlot(slot);
+            }
+        }
+
+        auto& sendSlot = m_seededSlots[m_seededSendSlot];
+        return sendSlot.m_consumed < m_seededSlotSize ? &sendSlot : nullptr;
+    }
+
+    void ctsIoPattern::FillSeededPayloadSlot(SeededPayloadSlot& slot) noexcept
+    {
+        FillSeededPayload(m_seededSendSeed, m_seededFillOffset, slot.m_buffer, m_seededSlotSize);
+        m_seededFillOffset += m_seededSlotSize;
+        slot.m_consumed = 0;
+    }
+
+    void ctsIoPattern::CompleteSeededPayloadSend(const ctsTask& originalTask) noexcept
+    {
+        const auto slotIndex = static_cast<size_t>(originalTask.m_buffer - m_seededSlotContainer.data()) / m_seededSlotSize;
+        auto& completedSlot = m_seededSlots[slotIndex];
+        FAIL_FAST_IF_MSG(
+            0 == completedSlot.m_sendsInFlight,
+            "ctsIOPattern: a -verify:seeded send completed from slot %Iu which had no sends in flight (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)",
+            slotIndex, this);
+        --completedSlot.m_sendsInFlight;
+
+        // refill the slots in ring order once every send from them completed, so the ring always holds the stream in order
+        // - this fills the payload of the coming sends here, ahead of when they are initiated
+        for (;;)
+        {
+            auto& oldestSlot = m_seededSlots[m_seededRefillSlot];
+            if (oldestSlot.m_consumed < m_seededSlotSize || oldestSlot.m_sendsInFlight > 0)
+            {
+                break;
+            }
+            FillSeededPayloadSlot(oldestSlot);
+            m_seededRefillSlot = (m_seededRefillSlot + 1) % m_seededSlots.size();
+        }
+    }
+
+    bool ctsIoPattern::VerifySeededPayload(const ctsTask& originalTask, unsigned long transferredBytes) noexcept
+    {
+        if (!m_seededSeedsCreated)
+        {
+            CreateSeededPayloadSeeds();
+        }
+
+        const auto* const receivedBuffer = reinterpret_cast<const unsigned char*>(originalTask.m_buffer + originalTask.m_bufferOffset);
+        unsigned char expectedBuffer[c_seededPayloadChunkSize];
+        size_t lengthMatched = 0;
+        while (lengthMatched < transferredBytes)
+        {
+            const size_t compareLength = min(transferredBytes - lengthMatched, c_seededPayloadChunkSize);
+            FillSeededPayload(m_seededRecvSeed, m_recvStreamOffset + lengthMatched, reinterpret_cast<char*>(expectedBuffer), compareLength);
+
+            const size_t compareMatched = g_compareMemory(expectedBuffer, receivedBuffer + lengthMatched, compareLength);
+            if (compareMatched != compareLength)
+            {
+                ctsConfig::PrintErrorInfo(
+                    L"ctsIOPattern found data corruption: the returned buffer (length %u) did not match this connection's seeded payload: "
+                    L"buffer received (%p), expected payload offset (%llu) - mismatch at offset (%Iu) [expected byte value '0x%x' didn't match '0x%x']",
+                    transferredBytes,
+                    receivedBuffer,
+                    m_recvStreamOffset,
+                    lengthMatched + compareMatched,
+                    expectedBuffer[compareMatched],
+                    receivedBuffer[lengthMatched + compareMatched]);
+                return false;
+            }
+            lengthMatched += compareLength;
+        }
+
+        return true;
+    }
+
+    bool ctsIoPattern::VerifyChecksums(const ctsTask& originalTask, unsigned long transferredBytes) noexcept
+    {
+        //
+        // Recvs complete in order, so the running CRC carries over from one recv to the next
+        // - the data bytes of each block are fed to the CRC as they arrive
+        // - the trailing checksum bytes are compared as they arrive, then the CRC restarts for the next block
+        //
+        const auto* const receivedBuffer = reinterpret_cast<const unsigned char*>(originalTask.m_buffer + originalTask.m_bufferOffset);
+        auto blockOffset = originalTask.m_expectedPatternOffset % c_checksumBlockSize;
+        unsigned long bytesVerified = 0;
+        while (bytesVerified < transferredBytes)
+        {
+            const auto bytesRemaining = transferredBytes - bytesVerified;
+            if (blockOffset < c_checksumDataLength)
+            {
+                const auto dataRemaining = c_checksumDataLength - blockOffset;
+                const auto updateLength = bytesRemaining < dataRemaining ? bytesRemaining : dataRemaining;
+                m_recvChecksum = g_updateCrc32c(m_recvChecksum, receivedBuffer + bytesVerified, updateLength);
+                bytesVerified += updateLength;
+                blockOffset += updateLength;
+                continue;
+            }
+
+            const auto expectedChecksum = ~m_recvChecksum;
+            const auto checksumByte = blockOffset - c_checksumDataLength;
+            if (receivedBuffer[bytesVerified] != static_cast<unsigned char>(expectedChecksum >> (checksumByte * 8)))
+            {
+                ctsConfig::PrintErrorInfo(
+                    L"ctsIOPattern found data corruption: the CRC32C checksum of a received block did not match (length %u): "
+                    L"buffer received (%p), expected buffer pattern offset (%lu) - checksum mismatch at offset (%lu) [computed CRC32C '0x%x']",
+                    transferredBytes,
+                    receivedBuffer,
+                    originalTask.m_expectedPatternOffset,
+                    bytesVerified,
+                    expectedChecksum);
+                return false;
+            }
+
+            ++bytesVerified;
+            ++blockOffset;
+            if (c_checksumBlockSize == blockOffset)
+            {
+                m_recvChecksum = 0xffffffff;
+                blockOffset = 0;
+            }
+        }
+
+        return true;
+    }
+
     [[nodiscard]] wil::cs_leave_scope_exit ctsIoPattern::AcquireIoPatternLock() const noexcept
     {
         const auto sharedSocket = m_parentSocket.lock();
@@ -994,6 +2132,14 @@ namespace ctsTraffic
         return ctsIoPatternError::NoError;
     }
 
+    void ctsIoPatternPushPull::ResetForNextTransfer() noexcept
+    {
+        // the last segment of the prior transfer could have been cut short by the end of the transfer
+        m_intraSegmentTransfer = 0;
+        m_ioNeeded = true;
+        m_sending = !m_listening;
+    }
+
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1111,6 +2257,193 @@ namespace ctsTraffic
         return ctsIoPatternError::NoError;
     }
 
+    void ctsIoPatternDuplex::ResetForNextTransfer() noexcept
+    {
+        // the total was already made even when the pattern was constructed
+        m_remainingSendBytes = GetTotalTransfer() / 2;
+        m_remainingRecvBytes = m_remainingSendBytes;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///     - RequestResponse Pattern
+    ///    -- TCP-only
+    ///    -- The client sends fixed-size requests, keeping up to PipelineDepth outstanding
+    ///    -- The server sends a fixed-size response for every complete request it receives
+    ///    -- Message boundaries are only tracked by byte counts: TCP can split or coalesce them freely
+    ///    -- Probe connections echo one c_probeMessageBytes ping at a time, c_probePingsPerConnection times
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ctsIoPatternRequestResponse::ctsIoPatternRequestResponse() : ctsIoPatternRequestResponse(false)
+    {
+    }
+
+    ctsIoPatternRequestResponse::ctsIoPatternRequestResponse(bool probe) :
+        ctsIoPatternStatistics(1), // a single recv is kept in flight
+        m_sendMessageBytes(probe ? c_probeMessageBytes : (ctsConfig::IsListening() ? ctsConfig::g_configSettings->ResponseBytes : ctsConfig::g_configSettings->RequestBytes)),
+        m_recvMessageBytes(probe ? c_probeMessageBytes : (ctsConfig::IsListening() ? ctsConfig::g_configSettings->RequestBytes : ctsConfig::g_configSettings->ResponseBytes)),
+        m_pipelineDepth(probe ? 1UL : ctsConfig::g_configSettings->PipelineDepth),
+        m_requestIntervalMilliseconds(probe ? ctsConfig::g_configSettings->ProbeIntervalMilliseconds : ctsConfig::g_configSettings->HeartbeatIntervalMilliseconds),
+        m_listening(ctsConfig::IsListening()),
+        m_probe(probe),
+        m_totalTransactions(0),
+        m_messagesStarted(0),
+        m_messagesReceived(0),
+        m_sendBytesAvailable(0),
+        m_remainingRecvBytes(0),
+        m_intraMessageRecvBytes(0),
+        m_sendInflight(false),
+        m_recvInflight(false),
+        m_pendingSendDelayMilliseconds(0)
+    {
+        // max transfer bytes must be a whole number of transactions so both sides agree when the connection is done
+        // - probes are a fixed number of pings, not sized by -Transfer
+        const uint64_t transactionBytes = static_cast<uint64_t>(static_cast<unsigned long>(m_sendMessageBytes)) + static_cast<unsigned long>(m_recvMessageBytes);
+        uint64_t transactionCount = m_probe ? c_probePingsPerConnection : GetTotalTransfer() / transactionBytes;
+        if (0 == transactionCount)
+        {
+            transactionCount = 1;
+        }
+        SetTotalTransfer(transactionCount * transactionBytes);
+
+        m_totalTransactions = transactionCount;
+        m_remainingRecvBytes = transactionCount * static_cast<uint64_t>(static_cast<unsigned long>(m_recvMessageBytes));
+
+        if (!m_listening)
+        {
+            m_requestStartQpc.resize(m_pipelineDepth);
+        }
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// virtual methods from the base class:
+    /// - assumes will be called under a CS from the base class
+    ///
+    /// keeps one recv in flight while response bytes remain
+    /// keeps one send in flight while bytes of started messages remain unsent
+    ///
+    /// Return an empty task when no more IO is needed
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ctsTask ctsIoPatternRequestResponse::GetNextTaskFromPattern() noexcept
+    {
+        // the client starts new requests while fewer than PipelineDepth are awaiting their response
+        if (!m_listening)
+        {
+            while (m_messagesStarted < m_totalTransactions && m_messagesStarted - m_messagesReceived < m_pipelineDepth)
+            {
+                auto startQpc = ctTimer::SnapQpc();
+                // heartbeats after the first are sent an interval after the prior echo was received
+                // - the round-trip time is measured from when the send is scheduled to be initiated
+                if (m_requestIntervalMilliseconds > 0 && m_messagesStarted > 0)
+                {
+                    m_pendingSendDelayMilliseconds = m_requestIntervalMilliseconds;
+                    startQpc += ctTimer::ConvertMillisToQpc(m_requestIntervalMilliseconds);
+                }
+                m_requestStartQpc[static_cast<size_t>(static_cast<ULONGLONG>(m_messagesStarted) % static_cast<unsigned long>(m_pipelineDepth))] = startQpc;
+                m_sendBytesAvailable += m_sendMessageBytes;
+                ++m_messagesStarted;
+            }
+        }
+
+        ctsTask returnTask;
+        if (!m_recvInflight && m_remainingRecvBytes > 0)
+        {
+            // for very large transfers, we need to ensure our SafeInt<long long> doesn't overflow when it's cast 
+            // to unsigned long when passed to tracked_task()
+            const ctsUnsignedLong maxRemainingBytes = m_remainingRecvBytes > MAXLONG ?
+                MAXLONG :
+                static_cast<unsigned long>(m_remainingRecvBytes);
+            returnTask = CreateTrackedTask(ctsTaskAction::Recv, maxRemainingBytes);
+            m_recvInflight = returnTask.m_ioAction != ctsTaskAction::None;
+        }
+        else if (!m_sendInflight && m_sendBytesAvailable > 0)
+        {
+            // coalesces every started message into one send, bounded by the buffer size
+            const ctsUnsignedLong maxAvailableBytes = m_sendBytesAvailable > MAXLONG ?
+                MAXLONG :
+                static_cast<unsigned long>(m_sendBytesAvailable);
+            returnTask = CreateTrackedTask(ctsTaskAction::Send, maxAvailableBytes);
+            m_sendInflight = returnTask.m_ioAction != ctsTaskAction::None;
+            if (m_sendInflight && m_pendingSendDelayMilliseconds > 0)
+            {
+                returnTask.m_timeOffsetMilliseconds = m_pendingSendDelayMilliseconds;
+                m_pendingSendDelayMilliseconds = 0;
+            }
+        }
+        else
+        {
+            // no IO needed now: return the default task
+        }
+
+        return returnTask;
+    }
+    ctsIoPatternError ctsIoPatternRequestResponse::CompleteTaskBackToPattern(const ctsTask& task, unsigned long completedBytes) noexcept
+    {
+        // ReSharper disable once CppIncompleteSwitchStatement
+        switch (task.m_ioAction)
+        {
+            case ctsTaskAction::Send:
+                m_statistics.m_bytesSent.Add(completedBytes);
+                m_sendBytesAvailable -= completedBytes;
+                m_sendInflight = false;
+                break;
+
+            case ctsTaskAction::Recv:
+                m_statistics.m_bytesRecv.Add(completedBytes);
+                m_remainingRecvBytes -= completedBytes;
+                m_recvInflight = false;
+
+                // a single recv can complete the tail of one message and any number of following messages
+                m_intraMessageRecvBytes += completedBytes;
+                while (m_intraMessageRecvBytes >= m_recvMessageBytes)
+                {
+                    m_intraMessageRecvBytes -= m_recvMessageBytes;
+
+                    if (m_listening)
+                    {
+                        // the server owes a response for every complete request
+                        m_sendBytesAvailable += m_sendMessageBytes;
+                        ++m_messagesStarted;
+                    }
+                    else
+                    {
+                        // responses arrive in the order their requests were sent
+                        const auto completedQpc = ctTimer::SnapQpc();
+                        const auto startQpc = m_requestStartQpc[static_cast<size_t>(static_cast<ULONGLONG>(m_messagesReceived) % static_cast<unsigned long>(m_pipelineDepth))];
+                        if (m_probe)
+                        {
+                            ctsConfig::g_configSettings->TcpStatusDetails.m_probeLatency.Record(completedQpc - startQpc);
+                        }
+                        else
+                        {
+                            ctsConfig::g_configSettings->TcpStatusDetails.m_transactionLatency.Record(completedQpc - startQpc);
+                        }
+                    }
+
+                    ++m_messagesReceived;
+                    if (!m_probe)
+                    {
+                        ctsConfig::g_configSettings->TcpStatusDetails.m_transactions.Increment();
+                    }
+                }
+                break;
+
+            case ctsTaskAction::None:
+            case ctsTaskAction::GracefulShutdown:
+            case ctsTaskAction::HardShutdown:
+            case ctsTaskAction::Abort:
+            case ctsTaskAction::FatalAbort:
+            default:;  // NOLINT(clang-diagnostic-covered-switch-default)
+                // fall through to return NoError
+        }
+
+        return ctsIoPatternError::NoError;
+    }
+
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1126,7 +2459,7 @@ namespace ctsTraffic
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     ctsIoPatternMediaStreamServer::ctsIoPatternMediaStreamServer() :
         ctsIoPatternStatistics(1), // the pattern will use the recv writeable-buffer for sending a connection ID
-        m_frameSizeBytes(ctsConfig::GetMediaStream().FrameSizeBytes),
+        m_frameSizeBytes(ctsConfig::GetMediaStream().GetFrameSizeBytes(1)),
         m_currentFrameRequested(0UL),
         m_currentFrameCompleted(0UL),
         m_frameRateFps(ctsConfig::GetMediaStream().FramesPerSecond),
@@ -1184,6 +2517,8 @@ namespace ctsTraffic
             if (m_currentFrameCompleted == m_frameSizeBytes)
             {
                 ++m_currentFrame;
+                // frames vary in size with -GopPattern or -FrameTrace
+                m_frameSizeBytes = ctsConfig::GetMediaStream().GetFrameSizeBytes(static_cast<unsigned long>(m_currentFrame));
                 m_currentFrameRequested = 0UL;
                 m_currentFrameCompleted = 0UL;
             }
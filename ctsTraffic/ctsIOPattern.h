@@ -15,14 +15,18 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 // cpp headers
 #include <array>
+#include <atomic>
 #include <memory>
 #include <algorithm>
+#include <type_traits>
+#include <vector>
 // os headers
 #include <Windows.h>
 // project headers
 #include "ctsConfig.h"
 #include "ctsIOPatternState.hpp"
 #include "ctsIOTask.hpp"
+#include "ctsRioBufferPool.h"
 #include "ctsSafeInt.hpp"
 #include "ctsStatistics.hpp"
 #include "ctSocketExtensions.hpp"
@@ -83,13 +87,24 @@ namespace ctsTraffic
         ///
         static std::shared_ptr<ctsIoPattern> MakeIoPattern();
         ///
+        /// -Probes : the ping exchange run over probe connections in place of the bulk pattern
+        ///
+        static std::shared_ptr<ctsIoPattern> MakeProbePattern();
+        ///
         /// Making available the shared buffer used for sends and recvs
         ///
         static char* AccessSharedBuffer() noexcept;
         ///
+        /// With -ZeroByteRecv:on, recv tasks are created without a buffer (m_buffer is nullptr)
+        /// - the IO function leases a buffer from a process-wide pool once its zero-byte recv completes
+        /// - CompleteIo returns the buffer to the pool
+        ///
+        static char* LeaseRecvBuffer();
+        ///
         /// d'tor must be virtual as this is a base pure virtual class
+        /// - recycles the recv buffers for the next ctsIoPattern instance
         ///
-        virtual ~ctsIoPattern() noexcept = default;
+        virtual ~ctsIoPattern() noexcept;
 
         ///
         /// Exposing statistics members publicly to ctsSocket
@@ -115,11 +130,83 @@ namespace ctsTraffic
             m_parentSocket = parentSocket;
         }
 
+        // -TargetStatistics : the statistics of the target this connection was made to (nullptr when not tracked)
+        void SetTargetStatistics(ctsTargetStatistics* targetStatistics) noexcept
+        {
+            m_targetStatistics = targetStatistics;
+        }
+
+        // the QPC when ConnectEx was posted, to time the first bytes received (zero when not tracked)
+        void SetConnectInitiatedQpc(long long connectInitiatedQpc) noexcept
+        {
+            m_connectInitiatedQpc = connectInitiatedQpc;
+        }
+
         void SetIdealSendBacklog(const ctsUnsignedLong& newIsb) noexcept
         {
             m_patternState.SetIdealSendBacklog(newIsb);
         }
 
+        // the connection ID was already exchanged with ConnectEx and AcceptEx (-ConnectData)
+        // - must be called before the first InitiateIo : the pattern then starts directly with its own IO
+        void SetExchangedConnectionId(_In_reads_(ctsStatistics::c_connectionIdLength) const char* connectionId) noexcept
+        {
+            memcpy_s(GetConnectionIdentifier(), ctsStatistics::c_connectionIdLength, connectionId, ctsStatistics::c_connectionIdLength);
+            m_patternState.SkipConnectionIdExchange();
+        }
+
+        // folds a SIO_TCP_INFO sample into the connection statistics - a no-op for UDP patterns
+        virtual void AddTcpInfoSample(const TCP_INFO_v0&) noexcept
+        {
+        }
+
+        // -ConnectionSamples : adds the bytes of a completed send or recv to the current interval - a no-op for UDP patterns
+        virtual void AddConnectionSample(unsigned long) noexcept
+        {
+        }
+
+        // -RecvBufValue:auto, -SendBufValue:auto : stores the buffers sized for the connection to write with its results
+        // - a no-op for UDP patterns
+        virtual void SetBufferSizing(const ctsBufferSizing&) noexcept
+        {
+        }
+
+        // -Relay : adds the bytes forwarded from (received) and to (sent) the accepted connection - a no-op for UDP patterns
+        // - the relay doesn't drive the pattern : this is what its statistics are made from
+        virtual void AddRelayedBytes(unsigned long, unsigned long) noexcept
+        {
+        }
+
+        // -Relay : records the result of the relayed connection once its last IO completed
+        // - the relay never drives the pattern to completion, so its state would otherwise remain c_statusIoRunning
+        void CompleteRelayedIo(unsigned long error) noexcept
+        {
+            if (c_statusIoRunning == m_lastError)
+            {
+                m_lastError = error;
+            }
+        }
+
+        // -PersistentTransfers : adds the time the transfer just completed over the connection took - a no-op for UDP patterns
+        virtual void AddTransferTiming(long long) noexcept
+        {
+        }
+
+        // -MemoryAccounting : the bytes the derived pattern allocated to track its outstanding tasks - none by default
+        [[nodiscard]] virtual size_t GetTaskAllocatedBytes() const noexcept
+        {
+            return 0;
+        }
+
+        // -MemoryAccounting : adds the memory held by this pattern to the totals
+        // - must be called before the pattern's recv buffers are recycled
+        void AccountMemory(ctsConnectionMemoryStatistics& memoryDetails) const noexcept;
+
+        // the ctsIOPatternBufferPolicy selected for recv buffers this run (-Buffer:shared, -IO:rioiocp)
+        // and the buffer memory each connection holds with it, as reported with the settings
+        static const wchar_t* GetBufferPolicyDescription() noexcept;
+        static size_t GetConnectionBufferFootprint() noexcept;
+
         [[nodiscard]] size_t GetRioBufferIdCount() const noexcept
         {
             if (WI_IsFlagClear(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
@@ -127,8 +214,8 @@ namespace ctsTraffic
                 return 0;
             }
 
-            // add 2 to count 1 for m_rioConnectionId and one for m_rioCompletionMessages
-            return m_receivingRioBufferIds.size() + m_sendingRioBufferIds.size() + 2;
+            // add 2 to count 1 for the connection Id and one for the completion message
+            return m_recvBufferFreeList.size() + m_rioSendsAvailable + 2;
         }
 
         ///
@@ -181,6 +268,29 @@ namespace ctsTraffic
         // - *not* setting the private ctsIOTask::tracked_io property
         ctsTask CreateNewTask(ctsTaskAction action, unsigned long maxTransfer) noexcept;
 
+        // Verifies the block checksums embedded in the received bytes with -verify:checksum
+        // - must be called for every tracked recv completion, in order
+        bool VerifyChecksums(const ctsTask& originalTask, unsigned long transferredBytes) noexcept;
+
+        // -verify:seeded : every connection sends its own payload, generated from a seed of its connection ID
+        // - sends are taken in order from a ring of slots, each refilled with the next range of the payload
+        //   once all the sends taken from it completed
+        struct SeededPayloadSlot
+        {
+            char* m_buffer = nullptr;
+            // the bytes of the slot already taken by sends, and the number of those sends not yet completed
+            unsigned long m_consumed = 0;
+            unsigned long m_sendsInFlight = 0;
+        };
+        void CreateSeededPayloadSeeds() noexcept;
+        // returns the slot the next send is taken from, or nullptr if it's still waiting on its prior sends to complete
+        SeededPayloadSlot* NextSeededPayloadSlot() noexcept;
+        void FillSeededPayloadSlot(SeededPayloadSlot& slot) noexcept;
+        void CompleteSeededPayloadSend(const ctsTask& originalTask) noexcept;
+        // Verifies the received bytes against the peer's payload, regenerated from its seed at the offset received so far
+        // - must be called for every tracked recv completion, in order
+        bool VerifySeededPayload(const ctsTask& originalTask, unsigned long transferredBytes) noexcept;
+
         ///////////////////////////////////////////////////////////////////////////////////////////////////
         ///
         /// Private method which must be implemented by the derived interface (the IO pattern)
@@ -198,11 +308,29 @@ namespace ctsTraffic
         ///////////////////////////////////////////////////////////////////////////////////////////////////
         virtual ctsTask GetNextTaskFromPattern() = 0;
         virtual ctsIoPatternError CompleteTaskBackToPattern(const ctsTask&, unsigned long currentTransfer) noexcept = 0;
+        // -PersistentTransfers : called once the completion message of a transfer completed and the next transfer begins
+        // - the derived pattern must return its tracking to how it started the connection's first transfer
+        virtual void ResetForNextTransfer() noexcept
+        {
+        }
+
+        // -PersistentTransfers : times the transfer whose last IO just finished
+        // - and ends the statistics once the last transfer over the connection finished
+        void CompleteTransfer() noexcept;
 
         // holding a weak reference to the parent socket object
         // since these will share the same locking requirements
         std::weak_ptr<ctsSocket> m_parentSocket;
 
+        // not owned : the per-target statistics live in ctsConfig for the life of the run
+        ctsTargetStatistics* m_targetStatistics = nullptr;
+        // reset once the first bytes are received
+        long long m_connectInitiatedQpc = 0LL;
+        // -PersistentTransfers : the QPC of the first IO of the current transfer (zero until it's initiated)
+        long long m_transferStartQpc = 0LL;
+        // the size of the derived pattern type MakeIoPattern created
+        size_t m_patternBytes = 0;
+
         // track the state of the L4 protocol (TCP or UDP)
         ctsIoPatternState m_patternState;
 
@@ -213,6 +341,21 @@ namespace ctsTraffic
         // these are separate as we could have both sends and receive operations on the same connection
         ctsSizeT m_sendPatternOffset = 0;
         ctsSizeT m_recvPatternOffset = 0;
+        // running CRC32C of the current block of received data with -verify:checksum
+        unsigned long m_recvChecksum = 0xffffffff;
+
+        // -verify:seeded : the payload slots sends are taken from, the seed of each direction,
+        // the offset into the payload of the next slot filled, and of the next byte received
+        std::vector<SeededPayloadSlot> m_seededSlots;
+        std::vector<char> m_seededSlotContainer;
+        size_t m_seededSendSlot = 0;
+        size_t m_seededRefillSlot = 0;
+        unsigned long m_seededSlotSize = 0;
+        uint32_t m_seededSendSeed = 0;
+        uint32_t m_seededRecvSeed = 0;
+        bool m_seededSeedsCreated = false;
+        uint64_t m_seededFillOffset = 0;
+        uint64_t m_recvStreamOffset = 0;
 
         // recv buffers to return to the caller
         // - tracking sending buffers separate from receiving buffers
@@ -223,59 +366,53 @@ namespace ctsTraffic
         std::vector<char*> m_recvBufferFreeList;
         std::vector<char> m_recvBufferContainer;
         std::array<char, c_completionMessageSize> m_completionMessageBuffer{};
-
-        struct RioBufferId
+        // -LeanProtocol : the marker and binary connection ID clients send, and servers receive
+        std::array<char, c_leanProtocolHeaderSize> m_leanProtocolHeader{};
+
+        // RIO registered memory is leased from the process-wide ctsRioBufferPool
+        // - a single slice per connection holds the recv buffers, then the connection Id, then the completion message
+        // - sends all use the process-wide registration of the shared send buffer
+        //   m_rioSendsAvailable still limits the number of sends in flight on this connection
+        ctsRioBufferLease m_rioBufferLease;
+        RIO_BUFFERID m_rioRecvBufferId = RIO_INVALID_BUFFERID;
+        char* m_rioRecvBufferBase = nullptr;
+        unsigned long m_rioRecvBufferBaseOffset = 0;
+        char* m_rioConnectionIdBuffer = nullptr;
+        char* m_rioCompletionMessageBuffer = nullptr;
+        unsigned long m_rioSendsAvailable = 0;
+
+        // updates the task to use a buffer within m_rioBufferLease (the connection Id or completion message)
+        void SetRioLeasedBuffer(ctsTask& task, _In_ char* leasedBuffer) const noexcept
         {
-            RIO_BUFFERID m_bufferId = RIO_INVALID_BUFFERID;
-
-            RioBufferId() = default;
-            explicit RioBufferId(RIO_BUFFERID bufferId) : m_bufferId(bufferId)
-            {
-            }
-            ~RioBufferId() noexcept
-            {
-                if (m_bufferId != RIO_INVALID_BUFFERID)
-                {
-                    ctl::ctRIODeregisterBuffer(m_bufferId);
-                    m_bufferId = RIO_INVALID_BUFFERID;
-                }
-            }
-
-            // only movable to guarantee destruction
-            RioBufferId(const RioBufferId&) = delete;
-            RioBufferId& operator=(const RioBufferId&) = delete;
-
-            RioBufferId(RioBufferId&& rhs) noexcept
-            {
-                this->m_bufferId = rhs.m_bufferId;
-                rhs.m_bufferId = RIO_INVALID_BUFFERID;
-            }
-            RioBufferId& operator=(RioBufferId&& rhs) noexcept
-            {
-                this->m_bufferId = rhs.m_bufferId;
-                rhs.m_bufferId = RIO_INVALID_BUFFERID;
-                return *this;
-            }
-
-            RIO_BUFFERID Release() noexcept
-            {
-                const RIO_BUFFERID returnId = m_bufferId;  // NOLINT(misc-misplaced-const)
-                m_bufferId = RIO_INVALID_BUFFERID;
-                return returnId;
-            }
-        };
+            task.m_buffer = leasedBuffer;
+            task.m_rioBufferid = m_rioBufferLease.Get().m_bufferId;
+            task.m_rioBufferOffset = m_rioBufferLease.Get().m_offset + static_cast<unsigned long>(leasedBuffer - m_rioBufferLease.Get().m_buffer);
+        }
 
-        // RIO buffer Id for sends and recv's
-        // cannot use the same RIO_BUFFERID concurrently (not supported by RIO)
-        std::vector<RioBufferId> m_receivingRioBufferIds;
-        std::vector<RioBufferId> m_sendingRioBufferIds;
-        RioBufferId m_rioConnectionId;
-        RioBufferId m_rioCompletionMessage;
+        // the per-connection counterpart of ctsConfig::ctsFrozenSettings : settings tested on every IO, captured once at construction
+        // - read from g_configSettings rather than GetFrozenSettings(), as the unit tests build patterns without running Startup
+        const bool m_useRio;
+        // TCP recv completions are verified with -verify:data or -verify:checksum
+        const bool m_verifyRecvs;
+        const bool m_verifyChecksums;
+        // TCP sends are made from per-connection seeded payload slots with -verify:seeded
+        const bool m_seededPayload;
+        // sends and recvs are timestamped for the latency histogram with -LatencyPercentiles
+        const bool m_timestampIo;
+        // recv buffers are leased per-recv instead of owned by the connection with -ZeroByteRecv:on
+        const bool m_zeroByteRecvs;
+        const long long m_tcpBytesPerSecondPeriod;
 
         // tracking time information for scheduling IO at time offsets
-        const ctsSignedLongLong m_bytesSendingPerQuantum;
+        // - -RateSearch and -LoadProfile : the rate is re-read before every send, as it changes while connections run
+        const bool m_liveRateLimit;
+        ctsSignedLongLong m_bytesSendingPerSecond;
+        ctsSignedLongLong m_bytesSendingPerQuantum;
         ctsSignedLongLong m_bytesSendingThisQuantum = 0LL;
         ctsSignedLongLong m_quantumStartTimeMs;
+        // -RateLimitPacing:on : the QPC when the next send departs, once the bytes before it drained at the limited rate
+        const bool m_paceSends;
+        long long m_nextPacedSendQpc = 0LL;
 
         unsigned long m_lastError = c_statusIoRunning;
 
@@ -438,7 +575,8 @@ namespace ctsTraffic
         explicit ctsIoPatternStatistics(unsigned long recvCount) : ctsIoPattern(recvCount)
         {
             // servers need to generate a unique connection ID
-            if (ctsConfig::IsListening())
+            // - with -LeanProtocol, clients generate the ID they send to the server
+            if (ctsConfig::IsListening() || ctsConfig::g_configSettings->LeanProtocol)
             {
                 ctsStatistics::GenerateConnectionId(m_statistics);
             }
@@ -498,6 +636,53 @@ namespace ctsTraffic
             return m_statistics.m_connectionIdentifier;
         }
 
+        void AddTcpInfoSample(const TCP_INFO_v0& tcpInfo) noexcept override
+        {
+            if constexpr (std::is_same_v<S, ctsTcpStatistics>)
+            {
+                m_statistics.m_tcpInfo.AddSample(tcpInfo);
+            }
+        }
+
+        void SetBufferSizing(const ctsBufferSizing& bufferSizing) noexcept override
+        {
+            if constexpr (std::is_same_v<S, ctsTcpStatistics>)
+            {
+                m_statistics.m_bufferSizing = bufferSizing;
+            }
+        }
+
+        void AddRelayedBytes(unsigned long bytesReceived, unsigned long bytesSent) noexcept override
+        {
+            if constexpr (std::is_same_v<S, ctsTcpStatistics>)
+            {
+                StartStatistics();
+                m_statistics.m_bytesRecv.Add(bytesReceived);
+                m_statistics.m_bytesSent.Add(bytesSent);
+                // the pattern never completes : the connection ends with the last bytes forwarded
+                m_statistics.m_endTime.SetValue(ctl::ctTimer::SnapQpcInMillis());
+            }
+        }
+
+        void AddTransferTiming(long long microseconds) noexcept override
+        {
+            if constexpr (std::is_same_v<S, ctsTcpStatistics>)
+            {
+                m_statistics.m_transferTimings.AddTransfer(microseconds);
+            }
+        }
+
+        void AddConnectionSample(unsigned long bytes) noexcept override
+        {
+            if constexpr (std::is_same_v<S, ctsTcpStatistics>)
+            {
+                const auto elapsed = ctl::ctTimer::SnapQpcInMillis() - m_statistics.m_startTime.GetValue();
+                m_statistics.m_samples.AddBytes(
+                    elapsed > 0 ? elapsed / ctsConfig::g_configSettings->ConnectionSampleIntervalMilliseconds : 0LL,
+                    bytes);
+            }
+        }
+
         // Statistics type is controlled by the caller as the class template type
         S m_statistics;
         bool m_started = false;
@@ -584,6 +769,7 @@ namespace ctsTraffic
 
         ctsTask GetNextTaskFromPattern() noexcept override;
         ctsIoPatternError CompleteTaskBackToPattern(const ctsTask& task, unsigned long currentTransfer) noexcept override;
+        void ResetForNextTransfer() noexcept override;
 
     private:
         const unsigned long m_pushSegmentSize;
@@ -618,6 +804,7 @@ namespace ctsTraffic
         // required virtual functions
         ctsTask GetNextTaskFromPattern() noexcept override;
         ctsIoPatternError CompleteTaskBackToPattern(const ctsTask& task, unsigned long completedBytes) noexcept override;
+        void ResetForNextTransfer() noexcept override;
 
     private:
         // need to know when to stop sending
@@ -627,6 +814,71 @@ namespace ctsTraffic
         ctsUnsignedLong m_sendBytesInflight;
     };
 
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///  - RequestResponse Pattern
+    ///    -- TCP-only
+    ///    -- The client sends RequestBytes-sized requests, keeping up to PipelineDepth outstanding
+    ///    -- The server replies to each complete request with a ResponseBytes-sized response
+    ///    -- The client records the round-trip time of each transaction
+    ///    -- With -Pattern:Heartbeat, the client waits HeartbeatInterval after each response before its next request
+    ///    -- With -Probes, probe connections exchange fixed-size pings the same way, ProbeInterval apart
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsIoPatternRequestResponse final : public ctsIoPatternStatistics<ctsTcpStatistics>
+    {
+    public:
+        // -Probes : the ping size and the pings exchanged before the probe connection is replaced
+        // - both sides must agree on these to know when the connection is done
+        static constexpr unsigned long c_probeMessageBytes = 64UL;
+        static constexpr unsigned long c_probePingsPerConnection = 1000UL;
+
+        ctsIoPatternRequestResponse();
+        explicit ctsIoPatternRequestResponse(bool probe);
+        ~ctsIoPatternRequestResponse() noexcept override = default;
+
+        ctsIoPatternRequestResponse(const ctsIoPatternRequestResponse&) = delete;
+        ctsIoPatternRequestResponse& operator=(const ctsIoPatternRequestResponse&) = delete;
+        ctsIoPatternRequestResponse(ctsIoPatternRequestResponse&&) = delete;
+        ctsIoPatternRequestResponse& operator=(ctsIoPatternRequestResponse&&) = delete;
+
+        // required virtual functions
+        ctsTask GetNextTaskFromPattern() noexcept override;
+        ctsIoPatternError CompleteTaskBackToPattern(const ctsTask& task, unsigned long completedBytes) noexcept override;
+
+        [[nodiscard]] size_t GetTaskAllocatedBytes() const noexcept override
+        {
+            return m_requestStartQpc.capacity() * sizeof(long long);
+        }
+
+    private:
+        // the client sends requests and receives responses - the server is the opposite
+        const ctsUnsignedLong m_sendMessageBytes;
+        const ctsUnsignedLong m_recvMessageBytes;
+        const ctsUnsignedLong m_pipelineDepth;
+        const unsigned long m_requestIntervalMilliseconds;
+        const bool m_listening;
+        // probe round trips are tracked apart from the transactions of -Pattern:RequestResponse
+        const bool m_probe;
+
+        ctsUnsignedLongLong m_totalTransactions;
+        // messages (requests on the client, responses on the server) which have been made available to send
+        ctsUnsignedLongLong m_messagesStarted;
+        // messages (responses on the client, requests on the server) which have been completely received
+        ctsUnsignedLongLong m_messagesReceived;
+        // bytes of started messages not yet sent
+        ctsUnsignedLongLong m_sendBytesAvailable;
+        ctsUnsignedLongLong m_remainingRecvBytes;
+        ctsUnsignedLong m_intraMessageRecvBytes;
+        bool m_sendInflight;
+        bool m_recvInflight;
+        // client only: the delay to apply to the send of the request just started
+        unsigned long m_pendingSendDelayMilliseconds;
+
+        // client only: the QPC when each outstanding request was started, indexed by request # % PipelineDepth
+        std::vector<long long> m_requestStartQpc;
+    };
+
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     ///
@@ -653,6 +905,7 @@ namespace ctsTraffic
         ctsIoPatternError CompleteTaskBackToPattern(const ctsTask& task, unsigned long currentTransfer) noexcept override;
 
     private:
+        // the size of m_currentFrame
         ctsUnsignedLong m_frameSizeBytes;
         ctsUnsignedLong m_currentFrameRequested;
         ctsUnsignedLong m_currentFrameCompleted;
@@ -694,6 +947,11 @@ namespace ctsTraffic
         ctsTask GetNextTaskFromPattern() noexcept override;
         ctsIoPatternError CompleteTaskBackToPattern(const ctsTask& task, unsigned long completedBytes) noexcept override;
 
+        [[nodiscard]] size_t GetTaskAllocatedBytes() const noexcept override
+        {
+            return m_jitterRingSize * sizeof(JitterSlot);
+        }
+
     private:
         // private member variables
         PTP_TIMER m_rendererTimer = nullptr;
@@ -701,34 +959,87 @@ namespace ctsTraffic
 
         long long m_baseTimeMilliseconds = 0LL;
         const double m_frameRateMsPerFrame = 0LL;
-        const unsigned long m_frameSizeBytes = ctsConfig::GetMediaStream().FrameSizeBytes;
+        // frames vary in size with -GopPattern or -FrameTrace : each frame's size is ctsConfig::GetMediaStream().GetFrameSizeBytes()
+        const unsigned long m_maxFrameSizeBytes = ctsConfig::GetMediaStream().MaxFrameSizeBytes;
         const unsigned long m_finalFrame = ctsConfig::GetMediaStream().StreamLengthFrames;
 
         unsigned long m_initialBufferFrames = ctsConfig::GetMediaStream().BufferedFrames;
         unsigned long m_timerWheelOffsetFrames = 0UL;
         unsigned long m_recvNeeded = ctsConfig::g_configSettings->PrePostRecvs;
 
-        // these must be protected by the base class cs
-        // - the base lock is always taken before our virtual functions are called
-        // - so this is most important to know in our timer callback
-
-        // member variables that require the base lock
-        _Requires_lock_held_(m_lock)
-            std::vector<ctsConfig::JitterFrameEntry> m_frameEntries;
+        // one frame of the jitter buffer
+        // - m_state packs the sequence number this slot currently holds (high 32 bits) with the bytes received for it (low 32 bits)
+        // - receives credit bytes with a compare-exchange that only succeeds while the slot still holds their sequence number
+        // - the renderer claims the frame and hands the slot to its next sequence number with a single exchange
+        // - so receives (under the base lock) and the renderer (without it) never block each other
+        struct alignas(64) JitterSlot
+        {
+            std::atomic<unsigned long long> m_state{0ULL};
+            std::atomic<long long> m_senderQpc{0LL};
+            std::atomic<long long> m_senderQpf{0LL};
+            std::atomic<long long> m_receiverQpc{0LL};
+            std::atomic<long long> m_receiverCompletionQpc{0LL};
+        };
 
-        _Requires_lock_held_(m_lock)
-            std::vector<ctsConfig::JitterFrameEntry>::iterator m_headEntry;
+        // the jitter buffer is a power-of-two ring indexed directly by sequence number: (sequenceNumber - 1) & m_jitterRingMask
+        std::unique_ptr<JitterSlot[]> m_jitterRing;
+        unsigned long m_jitterRingSize = 0UL;
+        unsigned long m_jitterRingMask = 0UL;
 
+        // the renderer timer callbacks are serialized: these are only accessed from the renderer
+        long long m_headSequenceNumber = 1LL;
         // tracking for jitter information
         ctsConfig::JitterFrameEntry m_firstFrame;
         ctsConfig::JitterFrameEntry m_previousFrame;
 
-        bool m_finishedStream = false;
+        // per-second totals for -JitterSummaryFilename, kept for only the last few seconds of the stream
+        // - each second is written once the renderer moves c_jitterSummaryWindowSeconds past it
+        //   so datagrams arriving late for recently rendered frames are still counted against their second
+        struct JitterSummarySlot
+        {
+            // only updated by the renderer
+            ctsConfig::JitterSummaryEntry m_summary;
+            // the second this slot is counting: read by receives to count late datagrams
+            std::atomic<long long> m_second{-1LL};
+            std::atomic<unsigned long> m_lateDatagrams{0UL};
+        };
+        static constexpr long long c_jitterSummaryWindowSeconds = 4;
+        std::array<JitterSummarySlot, c_jitterSummaryWindowSeconds> m_summaryWindow;
+        const unsigned long m_framesPerSecond = ctsConfig::GetMediaStream().FramesPerSecond;
+        // the second of the most recently rendered frame
+        long long m_summarySecond = -1LL;
+        std::atomic<unsigned long> m_startRequests{0UL};
+
+        std::atomic<bool> m_receivedFrames{false};
+        std::atomic<bool> m_finishedStream{false};
+
+        static constexpr unsigned long long PackSlotState(long long sequenceNumber, unsigned long bytesReceived) noexcept
+        {
+            return static_cast<unsigned long long>(sequenceNumber) << 32 | bytesReceived;
+        }
+
+        static constexpr long long SlotSequenceNumber(unsigned long long slotState) noexcept
+        {
+            return static_cast<long long>(slotState >> 32);
+        }
+
+        static constexpr unsigned long SlotBytesReceived(unsigned long long slotState) noexcept
+        {
+            return static_cast<unsigned long>(slotState & 0xffffffffULL);
+        }
 
-        // member functions - all require the base lock
-        std::vector<ctsConfig::JitterFrameEntry>::iterator FindSequenceNumber(long long sequenceNumber) noexcept;
+        [[nodiscard]] JitterSlot& FindSlot(long long sequenceNumber) const noexcept
+        {
+            return m_jitterRing[static_cast<size_t>(sequenceNumber - 1) & m_jitterRingMask];
+        }
+
+        // member functions
+        [[nodiscard]] bool ReceivedBufferedFrames() const noexcept
+        {
+            return m_receivedFrames.load(std::memory_order_acquire);
+        }
 
-        bool ReceivedBufferedFrames() noexcept;
+        ctsIoPatternError ProcessReceivedDatagram(const ctsTask& task, unsigned long completedBytes, const LARGE_INTEGER& qpc) noexcept;
 
         [[nodiscard]] bool SetNextTimer(bool initialTimer) const noexcept;
 
@@ -736,10 +1047,118 @@ namespace ctsTraffic
 
         void RenderFrame() noexcept;
 
+        [[nodiscard]] JitterSummarySlot& FindSummarySlot(long long second) noexcept
+        {
+            return m_summaryWindow[static_cast<size_t>(second % c_jitterSummaryWindowSeconds)];
+        }
+
+        void AdvanceJitterSummary(long long second) noexcept;
+
+        void FlushJitterSummaries() noexcept;
+
         /// The "Renderer" processes frames at the specified frame rate
         static VOID CALLBACK TimerCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID pContext, PTP_TIMER) noexcept;
         /// Callback to track when the server has actually started sending
         static VOID CALLBACK StartCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID pContext, PTP_TIMER) noexcept;
     };
 
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///  - UDP Blast server
+    ///    -- Receives a START message from a client to establish a 'connection' (as the Media server)
+    ///    -- Sends datagrams of -Buffer bytes (each a frame with its own sequence number) without pacing:
+    ///       the MediaStream server keeps -PrePostSends sends in flight, sending the next as each completes
+    ///    -- With -UdpSendOffload:on, each send is a burst of datagrams of the same size
+    ///    -- Completes once it has sent for -StreamLength seconds
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsIoPatternBlastServer final : public ctsIoPatternStatistics<ctsUdpStatistics>
+    {
+    public:
+        ctsIoPatternBlastServer();
+        ~ctsIoPatternBlastServer() noexcept override = default;
+
+        ctsIoPatternBlastServer(const ctsIoPatternBlastServer&) = delete;
+        ctsIoPatternBlastServer& operator=(const ctsIoPatternBlastServer&) = delete;
+        ctsIoPatternBlastServer(ctsIoPatternBlastServer&&) = delete;
+        ctsIoPatternBlastServer& operator=(ctsIoPatternBlastServer&&) = delete;
+
+        // required virtual functions
+        ctsTask GetNextTaskFromPattern() noexcept override;
+        ctsIoPatternError CompleteTaskBackToPattern(const ctsTask& task, unsigned long currentTransfer) noexcept override;
+
+    private:
+        // the datagrams of each send: more than one only with -UdpSendOffload:on
+        const unsigned long m_datagramsPerSend;
+        const long long m_streamLengthMilliseconds;
+        long long m_endTimeMilliseconds = 0LL;
+        ctsUnsignedLongLong m_bytesRequested = 0ULL;
+        bool m_finalSendRequested = false;
+        enum class ServerState
+        {
+            NotStarted,
+            IdSent,
+            IoStarted
+        } m_state = ServerState::NotStarted;
+    };
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///  - UDP Blast client
+    ///    -- Sends a START message to the server to establish a 'connection' (as the Media client)
+    ///    -- Receives datagrams for -StreamLength seconds, with no jitter buffer and no renderer
+    ///    -- Counts each sequence number once, telling datagrams received out of order from duplicates
+    ///       by the sequence numbers received within c_sequenceWindow of the highest
+    ///    -- Datagrams never received up to the highest sequence number are counted as lost (dropped frames)
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsIoPatternBlastClient final : public ctsIoPatternStatistics<ctsUdpStatistics>
+    {
+    public:
+        ctsIoPatternBlastClient();
+        ~ctsIoPatternBlastClient() noexcept override;
+
+        ctsIoPatternBlastClient(const ctsIoPatternBlastClient&) = delete;
+        ctsIoPatternBlastClient& operator=(const ctsIoPatternBlastClient&) = delete;
+        ctsIoPatternBlastClient(ctsIoPatternBlastClient&&) = delete;
+        ctsIoPatternBlastClient& operator=(ctsIoPatternBlastClient&&) = delete;
+
+        // required virtual functions
+        ctsTask GetNextTaskFromPattern() noexcept override;
+        ctsIoPatternError CompleteTaskBackToPattern(const ctsTask& task, unsigned long completedBytes) noexcept override;
+
+        static constexpr long long c_sequenceWindow = 4096LL;
+
+    private:
+        PTP_TIMER m_startTimer = nullptr;
+        PTP_TIMER m_endTimer = nullptr;
+
+        const long long m_streamLengthMilliseconds;
+        unsigned long m_recvNeeded = ctsConfig::g_configSettings->PrePostRecvs;
+        bool m_timersStarted = false;
+
+        // receives are serialized by the base lock, as are the timer callbacks which read these
+        long long m_highestSequenceNumber = 0LL;
+        long long m_datagramsReceived = 0LL;
+        // one bit per sequence number, indexed by sequence number % c_sequenceWindow:
+        // set for the sequence numbers received within c_sequenceWindow of the highest
+        std::array<unsigned long long, c_sequenceWindow / 64> m_receivedSequences{};
+
+        bool m_receivedDatagrams = false;
+        bool m_finishedStream = false;
+
+        ctsIoPatternError ProcessReceivedDatagram(const ctsTask& task, unsigned long completedBytes) noexcept;
+
+        [[nodiscard]] bool TestAndSetReceived(long long sequenceNumber) noexcept;
+
+        void SetNextStartTimer() const noexcept;
+
+        /// Callback to resend START until the server has started sending
+        static VOID CALLBACK StartCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID pContext, PTP_TIMER) noexcept;
+        /// Callback to end the stream once it has received for -StreamLength seconds
+        static VOID CALLBACK EndCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID pContext, PTP_TIMER) noexcept;
+    };
+
 } //namespace
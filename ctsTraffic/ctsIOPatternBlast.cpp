@@ -0,0 +1,425 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// cpp headers
+#include <cstring>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctTimer.hpp>
+// project headers
+#include "ctsIOPattern.h"
+#include "ctsStatistics.hpp"
+#include "ctsConfig.h"
+#include "ctsIOTask.hpp"
+#include "ctsSafeInt.hpp"
+#include "ctsMediaStreamProtocol.hpp"
+// wil headers
+#include <wil/resource.h>
+
+using namespace ctl;
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///     - ctsIOPatternBlast (Server) Pattern
+    ///    -- UDP-only, using the MediaStream protocol and server
+    ///    -- The server sends datagrams as fast as the MediaStream server completes them
+    ///    -- Each datagram is sized from -Buffer (fixed or a range) and carries its own sequence number
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ctsIoPatternBlastServer::ctsIoPatternBlastServer() :
+        ctsIoPatternStatistics(1), // the pattern will use the recv writeable-buffer for sending a connection ID
+        // UDP Send Offload sends a burst of -Buffer sized datagrams (-Buffer is then a fixed size) in each send
+        m_datagramsPerSend(
+            ctsConfig::g_configSettings->UdpSendOffload && ctsConfig::GetMaxBufferSize() <= c_udpDatagramMaximumSizeBytes / 2 ?
+            c_udpDatagramMaximumSizeBytes / ctsConfig::GetMaxBufferSize() :
+            1UL),
+        m_streamLengthMilliseconds(static_cast<long long>(ctsConfig::GetMediaStream().StreamLengthSeconds) * 1000LL)
+    {
+        // the stream is bounded by time, not by bytes: the total is set once the final send is requested
+        SetTotalTransfer(MAXULONGLONG);
+
+        PRINT_DEBUG_INFO(L"\t\tctsIOPatternBlastServer - sending %lu datagrams per send\n", m_datagramsPerSend);
+    }
+
+    ctsTask ctsIoPatternBlastServer::GetNextTaskFromPattern() noexcept
+    {
+        ctsTask returnTask;
+        switch (m_state)
+        {
+            case ServerState::NotStarted:
+                // get a writable buffer (ie. Recv), then update the fields in the task for the connection_id
+                returnTask = ctsMediaStreamMessage::MakeConnectionIdTask(
+                    CreateUntrackedTask(ctsTaskAction::Recv, c_udpDatagramConnectionIdHeaderLength),
+                    GetConnectionIdentifier());
+                m_state = ServerState::IdSent;
+                break;
+
+            case ServerState::IdSent:
+                m_endTimeMilliseconds = ctTimer::SnapQpcInMillis() + m_streamLengthMilliseconds;
+                m_state = ServerState::IoStarted;
+                // fall-through
+            case ServerState::IoStarted:
+                if (!m_finalSendRequested)
+                {
+                    // every send is requested immediately: the MediaStream server is only limited by its sends in flight
+                    returnTask = CreateTrackedTask(ctsTaskAction::Send);
+                    if (m_datagramsPerSend > 1)
+                    {
+                        // the MediaStream server gives each datagram of the burst its own header and sequence number
+                        // - each datagram sends the same m_coalescedSegmentSize bytes from the start of the buffer
+                        returnTask.m_coalescedSegmentSize = returnTask.m_bufferLength;
+                        returnTask.m_bufferLength *= m_datagramsPerSend;
+                    }
+                    m_bytesRequested += returnTask.m_bufferLength;
+
+                    if (ctTimer::SnapQpcInMillis() >= m_endTimeMilliseconds)
+                    {
+                        // the pattern completes once this send completes
+                        SetTotalTransfer(m_bytesRequested);
+                        m_finalSendRequested = true;
+                    }
+                }
+                break;
+        }
+        return returnTask;
+    }
+
+    ctsIoPatternError ctsIoPatternBlastServer::CompleteTaskBackToPattern(const ctsTask& task, unsigned long currentTransfer) noexcept
+    {
+        if (task.m_bufferType != ctsTask::BufferType::UdpConnectionId)
+        {
+            const ctsUnsignedLong currentTransferBits = currentTransfer * 8UL;
+
+            ctsConfig::g_configSettings->UdpStatusDetails.m_bitsReceived.Add(currentTransferBits);
+            m_statistics.m_bitsReceived.Add(currentTransferBits);
+
+            const unsigned long datagramsSent = task.m_coalescedSegmentSize > 0 ?
+                (currentTransfer + task.m_coalescedSegmentSize - 1) / task.m_coalescedSegmentSize :
+                1UL;
+            ctsConfig::g_configSettings->UdpStatusDetails.m_blastDatagramsSent.Add(datagramsSent);
+        }
+        return ctsIoPatternError::NoError;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///     - ctsIOPatternBlast (Client) Pattern
+    ///    -- UDP-only, using the MediaStream protocol and client
+    ///    -- The client receives continuously for -StreamLength seconds, then closes the stream
+    ///    -- As there is no renderer, datagrams are only counted as they are received:
+    ///       the highest sequence number received is how many the server sent to this client
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ctsIoPatternBlastClient::ctsIoPatternBlastClient() :
+        ctsIoPatternStatistics(ctsConfig::g_configSettings->PrePostRecvs),
+        m_streamLengthMilliseconds(static_cast<long long>(ctsConfig::GetMediaStream().StreamLengthSeconds) * 1000LL)
+    {
+        m_endTimer = CreateThreadpoolTimer(EndCallback, this, nullptr);
+        THROW_LAST_ERROR_IF(!m_endTimer);
+
+        auto deleteTimerCallbackOnError = wil::scope_exit([&]() noexcept {
+            SetThreadpoolTimer(m_endTimer, nullptr, 0, 0);
+            WaitForThreadpoolTimerCallbacks(m_endTimer, FALSE);
+            CloseThreadpoolTimer(m_endTimer);
+            });
+
+        m_startTimer = CreateThreadpoolTimer(StartCallback, this, nullptr);
+        THROW_LAST_ERROR_IF(!m_startTimer);
+        // no errors, dismiss the scope guard
+        deleteTimerCallbackOnError.release();
+    }
+
+    ctsIoPatternBlastClient::~ctsIoPatternBlastClient() noexcept
+    {
+        // stop both timers
+        SetThreadpoolTimer(m_startTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(m_startTimer, FALSE);
+        CloseThreadpoolTimer(m_startTimer);
+
+        SetThreadpoolTimer(m_endTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(m_endTimer, FALSE);
+        CloseThreadpoolTimer(m_endTimer);
+    }
+
+    ctsTask ctsIoPatternBlastClient::GetNextTaskFromPattern() noexcept
+    {
+        if (!m_timersStarted)
+        {
+            // initiate the timers the first time the object is used
+            m_timersStarted = true;
+            SetNextStartTimer();
+
+            FILETIME relativeFileTime(ctTimer::ConvertMillisToRelativeFiletime(m_streamLengthMilliseconds));
+            SetThreadpoolTimer(m_endTimer, &relativeFileTime, 0, 0);
+        }
+
+        // defaulting to an empty task (do nothing)
+        ctsTask returnTask;
+        if (m_recvNeeded > 0 && !m_finishedStream)
+        {
+            // ctsConfig sizes client buffers for the largest datagram (or the largest coalesced receive)
+            returnTask = CreateUntrackedTask(ctsTaskAction::Recv, ctsConfig::GetMaxBufferSize());
+            // always write in a zero for the seq number to initialize the buffer
+            *reinterpret_cast<long long*>(returnTask.m_buffer) = 0LL;
+            --m_recvNeeded;
+        }
+        return returnTask;
+    }
+
+    ctsIoPatternError ctsIoPatternBlastClient::CompleteTaskBackToPattern(const ctsTask& task, unsigned long completedBytes) noexcept
+    {
+        if (task.m_ioAction == ctsTaskAction::Abort)
+        {
+            // the stream should now be done
+            FAIL_FAST_IF_MSG(
+                !m_finishedStream,
+                "ctsIOPatternBlastClient (dt %p ctsTraffic!ctsTraffic::ctsIOPatternBlastClient) processed an Abort before the stream was finished", this);
+            return ctsIoPatternError::SuccessfullyCompleted;
+        }
+
+        if (task.m_ioAction == ctsTaskAction::Recv)
+        {
+            if (m_finishedStream)
+            {
+                // datagrams still arriving after the stream ended were not counted against it
+                return ctsIoPatternError::NoError;
+            }
+
+            if (0 == completedBytes)
+            {
+                ctsConfig::PrintErrorInfo(L"ctsIOPatternBlastClient received a zero-byte datagram");
+                return ctsIoPatternError::TooFewBytes;
+            }
+
+            // a coalesced (URO) receive holds back-to-back datagrams of m_coalescedSegmentSize bytes
+            // - only the last datagram can be shorter : each is processed exactly as if it had been received on its own
+            const unsigned long datagramSize = task.m_coalescedSegmentSize > 0 ? task.m_coalescedSegmentSize : completedBytes;
+            for (unsigned long datagramOffset = 0; datagramOffset < completedBytes; datagramOffset += datagramSize)
+            {
+                const unsigned long remainingBytes = completedBytes - datagramOffset;
+                const unsigned long datagramBytes = remainingBytes < datagramSize ? remainingBytes : datagramSize;
+                ctsTask datagramTask(task);
+                datagramTask.m_buffer = task.m_buffer + datagramOffset;
+                datagramTask.m_bufferLength = datagramBytes;
+                datagramTask.m_coalescedSegmentSize = 0;
+
+                const auto datagramError = ProcessReceivedDatagram(datagramTask, datagramBytes);
+                if (datagramError != ctsIoPatternError::NoError)
+                {
+                    return datagramError;
+                }
+            }
+
+            // since a recv completed successfully, will need to request another
+            ++m_recvNeeded;
+        }
+        // else this is the completion of the START request
+
+        return ctsIoPatternError::NoError;
+    }
+
+    // processes a single datagram received into the task's buffer
+    // _Requires_lock_held_(m_lock)
+    ctsIoPatternError ctsIoPatternBlastClient::ProcessReceivedDatagram(const ctsTask& task, unsigned long completedBytes) noexcept
+    {
+        if (!ctsMediaStreamMessage::ValidateBufferLengthFromTask(task, completedBytes))
+        {
+            ctsConfig::PrintErrorInfo(L"ctsIoPatternBlastClient received an invalid datagram trying to parse the protocol header");
+            return ctsIoPatternError::TooFewBytes;
+        }
+
+        if (ctsMediaStreamMessage::GetProtocolHeaderFromTask(task) == c_udpDatagramProtocolHeaderFlagId)
+        {
+            // save off the connection ID when we receive it
+            ctsMediaStreamMessage::SetConnectionIdFromTask(GetConnectionIdentifier(), task);
+            return ctsIoPatternError::NoError;
+        }
+
+        // validate the buffer contents
+        ctsTask validationTask(task);
+        validationTask.m_bufferOffset = c_udpDatagramDataHeaderLength; // skip the UdpDatagramDataHeaderLength since we use them for our own stuff
+        validationTask.m_bufferLength -= c_udpDatagramDataHeaderLength;
+        if (!VerifyBuffer(validationTask, completedBytes - c_udpDatagramDataHeaderLength))
+        {
+            // exit early if the buffers don't match
+            return ctsIoPatternError::CorruptedBytes;
+        }
+
+        // track the # of *bits* received
+        ctsConfig::g_configSettings->UdpStatusDetails.m_bitsReceived.Add(completedBytes * 8);
+        m_statistics.m_bitsReceived.Add(completedBytes * 8);
+        m_receivedDatagrams = true;
+
+        auto& statusDetails = ctsConfig::g_configSettings->UdpStatusDetails;
+        const long long sequenceNumber = ctsMediaStreamMessage::GetSequenceNumberFromTask(task);
+        if (sequenceNumber < 1)
+        {
+            statusDetails.m_errorFrames.Increment();
+            m_statistics.m_errorFrames.Increment();
+
+            PRINT_DEBUG_INFO(L"\t\tctsIOPatternBlastClient received **an invalid** seq number (%lld)\n", sequenceNumber);
+        }
+        else if (sequenceNumber > m_highestSequenceNumber)
+        {
+            // every sequence number skipped over is expected : each is lost unless it's later received out of order
+            const long long advance = sequenceNumber - m_highestSequenceNumber;
+            if (advance >= c_sequenceWindow)
+            {
+                m_receivedSequences.fill(0ULL);
+            }
+            else
+            {
+                for (auto skipped = m_highestSequenceNumber + 1; skipped < sequenceNumber; ++skipped)
+                {
+                    m_receivedSequences[static_cast<size_t>(skipped % c_sequenceWindow / 64)] &= ~(1ULL << (skipped % 64));
+                }
+            }
+            m_highestSequenceNumber = sequenceNumber;
+            (void)TestAndSetReceived(sequenceNumber);
+            ++m_datagramsReceived;
+
+            statusDetails.m_blastDatagramsExpected.Add(advance);
+            statusDetails.m_blastDatagramsReceived.Increment();
+            statusDetails.m_successfulFrames.Increment();
+            m_statistics.m_successfulFrames.Increment();
+        }
+        else if (m_highestSequenceNumber - sequenceNumber >= c_sequenceWindow)
+        {
+            // too far behind the highest to tell whether it was already received
+            statusDetails.m_errorFrames.Increment();
+            m_statistics.m_errorFrames.Increment();
+
+            PRINT_DEBUG_INFO(
+                L"\t\tctsIOPatternBlastClient received **a stale** seq number (%lld) - the highest received is (%lld)\n",
+                sequenceNumber,
+                m_highestSequenceNumber);
+        }
+        else if (TestAndSetReceived(sequenceNumber))
+        {
+            statusDetails.m_duplicateFrames.Increment();
+            m_statistics.m_duplicateFrames.Increment();
+
+            PRINT_DEBUG_INFO(L"\t\tctsIOPatternBlastClient received **a duplicate** seq number (%lld)\n", sequenceNumber);
+        }
+        else
+        {
+            // received after a higher sequence number
+            ++m_datagramsReceived;
+
+            statusDetails.m_blastDatagramsReordered.Increment();
+            statusDetails.m_blastDatagramsReceived.Increment();
+            statusDetails.m_successfulFrames.Increment();
+            m_statistics.m_successfulFrames.Increment();
+        }
+
+        return ctsIoPatternError::NoError;
+    }
+
+    // returns if the sequence number was already marked received
+    // - the caller guarantees it's within c_sequenceWindow of the highest sequence number
+    bool ctsIoPatternBlastClient::TestAndSetReceived(long long sequenceNumber) noexcept
+    {
+        auto& receivedBits = m_receivedSequences[static_cast<size_t>(sequenceNumber % c_sequenceWindow / 64)];
+        const unsigned long long sequenceBit = 1ULL << (sequenceNumber % 64);
+        const bool alreadyReceived = (receivedBits & sequenceBit) != 0;
+        receivedBits |= sequenceBit;
+        return alreadyReceived;
+    }
+
+    // _Requires_lock_held_(m_lock)
+    void ctsIoPatternBlastClient::SetNextStartTimer() const noexcept
+    {
+        if (m_startTimer != nullptr)
+        {
+            // convert to filetime from milliseconds
+            // - make a 'relative' for SetThreadpoolTimer
+            FILETIME relativeFileTime(ctTimer::ConvertMillisToRelativeFiletime(500LL));
+            // TP Timer APIs work off of the UTC time
+            SetThreadpoolTimer(m_startTimer, &relativeFileTime, 0, 0);
+        }
+    }
+
+    VOID CALLBACK ctsIoPatternBlastClient::StartCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID pContext, PTP_TIMER) noexcept
+    {
+        static const char c_startBuffer[] = "START";
+
+        auto* thisPtr = static_cast<ctsIoPatternBlastClient*>(pContext);
+        // take the base lock before touching any internal members
+        const auto lock = thisPtr->AcquireIoPatternLock();
+
+        if (thisPtr->m_finishedStream)
+        {
+            return;
+        }
+
+        if (!thisPtr->m_receivedDatagrams)
+        {
+            // send another start message
+            PRINT_DEBUG_INFO(L"\t\tctsIOPatternBlastClient re-requesting START\n");
+
+            ctsTask resendTask;
+            resendTask.m_ioAction = ctsTaskAction::Send;
+            resendTask.m_trackIo = false;
+            resendTask.m_buffer = const_cast<char*>(c_startBuffer);
+            resendTask.m_bufferOffset = 0;
+            resendTask.m_bufferLength = static_cast<unsigned long>(strlen(c_startBuffer));
+            resendTask.m_bufferType = ctsTask::BufferType::Static; // this is our own buffer: the base class should not mess with it
+
+            thisPtr->SetNextStartTimer();
+            thisPtr->SendTaskToCallback(resendTask);
+        }
+        // else, don't schedule this timer anymore
+    }
+
+    VOID CALLBACK ctsIoPatternBlastClient::EndCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID pContext, PTP_TIMER) noexcept
+    {
+        auto* thisPtr = static_cast<ctsIoPatternBlastClient*>(pContext);
+        // take the base lock before touching any internal members
+        const auto lock = thisPtr->AcquireIoPatternLock();
+
+        if (thisPtr->m_finishedStream)
+        {
+            return;
+        }
+        thisPtr->m_finishedStream = true;
+
+        ctsTask abortTask;
+        if (!thisPtr->m_receivedDatagrams)
+        {
+            // if we haven't yet received *anything* from the server, abort this connection
+            ctsConfig::PrintErrorInfo(L"ctsIOPatternBlastClient - issuing a FATALABORT to close the connection - have received nothing from the server");
+            abortTask.m_ioAction = ctsTaskAction::FatalAbort;
+        }
+        else
+        {
+            // every sequence number up to the highest which was never received was lost
+            const auto lostDatagrams = thisPtr->m_highestSequenceNumber - thisPtr->m_datagramsReceived;
+            ctsConfig::g_configSettings->UdpStatusDetails.m_droppedFrames.Add(lostDatagrams);
+            thisPtr->m_statistics.m_droppedFrames.Add(lostDatagrams);
+
+            thisPtr->EndStatistics();
+            abortTask.m_ioAction = ctsTaskAction::Abort;
+            PRINT_DEBUG_INFO(L"\t\tctsIOPatternBlastClient - issuing an ABORT to cleanly close the connection\n");
+        }
+        thisPtr->SendTaskToCallback(abortTask);
+    }
+}
@@ -13,9 +13,33 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 #pragma once
 
+// cpp headers
+#include <cstddef>
+
+// ** NOTE ** should not include any local project cts headers - to avoid circular references
+
 namespace ctsTraffic
 {
-
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsIOPatternBufferPolicy
+    ///
+    /// The recv buffer strategies a connection can use, selected once per run:
+    /// - AllocationType : Static == one process-wide buffer shared by every connection (-Buffer:shared)
+    ///                    Dynamic == per-connection buffers (recycled across connections)
+    /// - BufferType : Heap == buffers used with the Winsock APIs
+    ///                RegisteredIo == buffers leased from the RIO registered memory pool
+    ///
+    /// Every policy is stateless and exposes:
+    /// - GetRecvBuffer : the buffer for the recv at recvIndex, given the shared and connection buffers
+    /// - CanVerifyBuffer : if the bytes received into that buffer can be verified against the pattern
+    ///   (a buffer shared across connections is overwritten by concurrent recvs)
+    /// - GetRecvBufferBytes : the recv buffer bytes allocated for each connection
+    /// - GetRegisteredBytes : the RIO registered bytes leased for each connection
+    ///   (its recv buffers plus the controlBytes for the connection id and completion message)
+    /// - GetConnectionFootprint : all buffer memory held by each connection
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
     typedef struct ctsIOPatternAllocationTypeStatic_t   ctsIOPatternAllocationTypeStatic;
     typedef struct ctsIOPatternAllocationtypeDynamic_t  ctsIOPatternAllocationtypeDynamic;
 
@@ -24,12 +48,7 @@ namespace ctsTraffic
 
 
     template <typename AllocationType, typename BufferType>
-    class ctsIOPatternBufferPolicy
-    {
-    public:
-        char* get_buffer(size_t _size) noexcept;
-        bool  verify_buffer(const char* _buffer) noexcept;
-    };
+    class ctsIOPatternBufferPolicy;
 
 
     //
@@ -41,42 +60,132 @@ namespace ctsTraffic
         ctsIOPatternAllocationTypeStatic,
         ctsIOPatternBufferTypeHeap>
     {
-
+    public:
+        static constexpr const wchar_t* c_description = L"shared heap buffer";
+
+        static char* GetRecvBuffer(char* sharedBuffer, char*, size_t, unsigned long) noexcept
+        {
+            return sharedBuffer;
+        }
+        static constexpr bool CanVerifyBuffer() noexcept
+        {
+            return false;
+        }
+        static constexpr size_t GetRecvBufferBytes(size_t, unsigned long) noexcept
+        {
+            return 0;
+        }
+        static constexpr size_t GetRegisteredBytes(size_t, unsigned long, unsigned long) noexcept
+        {
+            return 0;
+        }
+        static constexpr size_t GetConnectionFootprint(size_t, unsigned long, unsigned long) noexcept
+        {
+            return 0;
+        }
     };
 
     //
     // Static RIO buffers
     // - won't be verified
+    // - each connection still leases registered memory for its connection id and completion message
     //
     template<>
     class ctsIOPatternBufferPolicy<
         ctsIOPatternAllocationTypeStatic,
         ctsIOPatternBufferTypeRegisteredIo>
     {
-
+    public:
+        static constexpr const wchar_t* c_description = L"shared RIO registered buffer";
+
+        static char* GetRecvBuffer(char* sharedBuffer, char*, size_t, unsigned long) noexcept
+        {
+            return sharedBuffer;
+        }
+        static constexpr bool CanVerifyBuffer() noexcept
+        {
+            return false;
+        }
+        static constexpr size_t GetRecvBufferBytes(size_t, unsigned long) noexcept
+        {
+            return 0;
+        }
+        static constexpr size_t GetRegisteredBytes(size_t, unsigned long, unsigned long controlBytes) noexcept
+        {
+            return controlBytes;
+        }
+        static constexpr size_t GetConnectionFootprint(size_t recvCount, unsigned long bufferSize, unsigned long controlBytes) noexcept
+        {
+            return GetRegisteredBytes(recvCount, bufferSize, controlBytes);
+        }
     };
 
     //
     // Dynamic heap buffers
-    // - won't be verified
+    // - can be verified
     //
     template<>
     class ctsIOPatternBufferPolicy<
         ctsIOPatternAllocationtypeDynamic,
         ctsIOPatternBufferTypeHeap>
     {
-
+    public:
+        static constexpr const wchar_t* c_description = L"per-connection heap buffers";
+
+        static char* GetRecvBuffer(char*, char* connectionBuffer, size_t recvIndex, unsigned long bufferSize) noexcept
+        {
+            return connectionBuffer + recvIndex * bufferSize;
+        }
+        static constexpr bool CanVerifyBuffer() noexcept
+        {
+            return true;
+        }
+        static constexpr size_t GetRecvBufferBytes(size_t recvCount, unsigned long bufferSize) noexcept
+        {
+            return recvCount * bufferSize;
+        }
+        static constexpr size_t GetRegisteredBytes(size_t, unsigned long, unsigned long) noexcept
+        {
+            return 0;
+        }
+        static constexpr size_t GetConnectionFootprint(size_t recvCount, unsigned long bufferSize, unsigned long) noexcept
+        {
+            return GetRecvBufferBytes(recvCount, bufferSize);
+        }
     };
 
     //
-    // Static RIO buffers
-    // - won't be verified
+    // Dynamic RIO buffers
+    // - can be verified
+    // - the recv buffers are carved from the same leased slice as the connection id and completion message
     //
     template<>
     class ctsIOPatternBufferPolicy<
         ctsIOPatternAllocationtypeDynamic,
         ctsIOPatternBufferTypeRegisteredIo>
     {
-
+    public:
+        static constexpr const wchar_t* c_description = L"per-connection RIO registered buffers";
+
+        static char* GetRecvBuffer(char*, char* connectionBuffer, size_t recvIndex, unsigned long bufferSize) noexcept
+        {
+            return connectionBuffer + recvIndex * bufferSize;
+        }
+        static constexpr bool CanVerifyBuffer() noexcept
+        {
+            return true;
+        }
+        static constexpr size_t GetRecvBufferBytes(size_t recvCount, unsigned long bufferSize) noexcept
+        {
+            return recvCount * bufferSize;
+        }
+        static constexpr size_t GetRegisteredBytes(size_t recvCount, unsigned long bufferSize, unsigned long controlBytes) noexcept
+        {
+            return GetRecvBufferBytes(recvCount, bufferSize) + controlBytes;
+        }
+        static constexpr size_t GetConnectionFootprint(size_t recvCount, unsigned long bufferSize, unsigned long controlBytes) noexcept
+        {
+            return GetRegisteredBytes(recvCount, bufferSize, controlBytes);
+        }
     };
 }
@@ -13,6 +13,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 
 // cpp headers
+#include <cmath>
 #include <vector>
 // os headers
 #include <Windows.h>
@@ -25,6 +26,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsIOTask.hpp"
 #include "ctsSafeInt.hpp"
 #include "ctsMediaStreamProtocol.hpp"
+#include "ctsTraceLogging.h"
 // wil headers
 #include <wil/stl.h>
 #include <wil/resource.h>
@@ -72,18 +74,23 @@ namespace ctsTraffic
                 "BufferDepth & FrameSize don't allow for enough buffered stream");
         }
 
-        PRINT_DEBUG_INFO(L"\t\tctsIOPatternMediaStreamClient - queue size for this new connection is %d\n", static_cast<long>(queueSize));
-        PRINT_DEBUG_INFO(L"\t\tctsIOPatternMediaStreamClient - frame rate in milliseconds per frame : %f\n", m_frameRateMsPerFrame);
+        // round the ring up to a power of two so a sequence number maps to its slot with a mask
+        ctsUnsignedLong ringSize = 1UL;
+        while (ringSize < static_cast<unsigned long>(static_cast<long>(queueSize)))
+        {
+            ringSize *= 2UL;
+        }
+        m_jitterRingSize = ringSize;
+        m_jitterRingMask = m_jitterRingSize - 1;
 
-        m_frameEntries.resize(queueSize);
-        m_headEntry = m_frameEntries.begin();
+        PRINT_DEBUG_INFO(L"\t\tctsIOPatternMediaStreamClient - queue size for this new connection is %lu\n", m_jitterRingSize);
+        PRINT_DEBUG_INFO(L"\t\tctsIOPatternMediaStreamClient - frame rate in milliseconds per frame : %f\n", m_frameRateMsPerFrame);
 
-        // pre-populate the queue of frames with the initial seq numbers
-        ctsSignedLong lastUsedSequenceNumber = 1;
-        for (auto& entry : m_frameEntries)
+        // pre-populate the ring of frames with the initial seq numbers
+        m_jitterRing = std::make_unique<JitterSlot[]>(m_jitterRingSize);
+        for (unsigned long slot = 0; slot < m_jitterRingSize; ++slot)
         {
-            entry.m_sequenceNumber = lastUsedSequenceNumber;
-            ++lastUsedSequenceNumber;
+            m_jitterRing[slot].m_state.store(PackSlotState(slot + 1LL, 0UL), std::memory_order_relaxed);
         }
 
         // after creating, refer to the timers under the lock
@@ -129,14 +136,19 @@ namespace ctsTraffic
         if (m_recvNeeded > 0)
         {
             // don't try posting more than UdpDatagramMaximumSizeBytes at a time
+            // - unless receives can coalesce datagrams, which need room for the largest coalesced receive
             unsigned long maxSizeBuffer;
-            if (m_frameSizeBytes > c_udpDatagramMaximumSizeBytes)
+            if (ctsConfig::g_configSettings->UdpRecvOffload)
+            {
+                maxSizeBuffer = ctsConfig::ctsConfigSettings::c_UdpRecvMaxCoalescedSize;
+            }
+            else if (m_maxFrameSizeBytes > c_udpDatagramMaximumSizeBytes)
             {
                 maxSizeBuffer = c_udpDatagramMaximumSizeBytes;
             }
             else
             {
-                maxSizeBuffer = m_frameSizeBytes;
+                maxSizeBuffer = m_maxFrameSizeBytes;
             }
 
             returnTask = CreateUntrackedTask(ctsTaskAction::Recv, maxSizeBuffer);
@@ -176,101 +188,22 @@ namespace ctsTraffic
                 return ctsIoPatternError::TooFewBytes;
             }
 
-            if (!ctsMediaStreamMessage::ValidateBufferLengthFromTask(task, completedBytes))
-            {
-                ctsConfig::PrintErrorInfo(L"ctsIoPatternMediaStreamClient received an invalid datagram trying to parse the protocol header");
-                return ctsIoPatternError::TooFewBytes;
-            }
-
-            if (ctsMediaStreamMessage::GetProtocolHeaderFromTask(task) == c_udpDatagramProtocolHeaderFlagId)
-            {
-                // save off the connection ID when we receive it
-                ctsMediaStreamMessage::SetConnectionIdFromTask(GetConnectionIdentifier(), task);
-                // since a recv completed, will need to request another
-                ++m_recvNeeded;
-                return ctsIoPatternError::NoError;
-            }
-
-            // validate the buffer contents
-            ctsTask validationTask(task);
-            validationTask.m_bufferOffset = c_udpDatagramDataHeaderLength; // skip the UdpDatagramDataHeaderLength since we use them for our own stuff
-            validationTask.m_bufferLength -= c_udpDatagramDataHeaderLength;
-            if (!VerifyBuffer(validationTask, completedBytes - c_udpDatagramDataHeaderLength))
-            {
-                // exit early if the buffers don't match
-                return ctsIoPatternError::CorruptedBytes;
-            }
-
-            // track the # of *bits* received
-            ctsConfig::g_configSettings->UdpStatusDetails.m_bitsReceived.Add(completedBytes * 8);
-            m_statistics.m_bitsReceived.Add(completedBytes * 8);
-
-            const long long receivedsequenceNumber = ctsMediaStreamMessage::GetSequenceNumberFromTask(task);
-            if (receivedsequenceNumber > m_finalFrame)
-            {
-                ctsConfig::g_configSettings->UdpStatusDetails.m_errorFrames.Increment();
-                m_statistics.m_errorFrames.Increment();
-
-                PRINT_DEBUG_INFO(
-                    L"\t\tctsIOPatternMediaStreamClient recevieved **an unknown** seq number (%lld) (outside the final frame %lu)\n",
-                    receivedsequenceNumber,
-                    m_finalFrame);
-            }
-            else
+            // a coalesced (URO) receive holds back-to-back datagrams of m_coalescedSegmentSize bytes
+            // - only the last datagram can be shorter : each is processed exactly as if it had been received on its own
+            const unsigned long datagramSize = task.m_coalescedSegmentSize > 0 ? task.m_coalescedSegmentSize : completedBytes;
+            for (unsigned long datagramOffset = 0; datagramOffset < completedBytes; datagramOffset += datagramSize)
             {
-                //
-                // search our circular queue (starting at the head_entry)
-                // for the seq number we just received, and if found, tag as received
-                //
-                const auto foundSlot = FindSequenceNumber(receivedsequenceNumber);
-                if (foundSlot != m_frameEntries.end())
-                {
-                    const long long bufferedQpc = *reinterpret_cast<long long*>(task.m_buffer + 8);
-                    const long long bufferedQpf = *reinterpret_cast<long long*>(task.m_buffer + 16);
-
-                    // always overwrite qpc & qpf values with the latest datagram details
-                    foundSlot->m_senderQpc = bufferedQpc;
-                    foundSlot->m_senderQpf = bufferedQpf;
-                    foundSlot->m_receiverQpc = qpc.QuadPart;
-                    foundSlot->m_receiverQpf = ctTimer::SnapQpf();
-                    foundSlot->m_bytesReceived += completedBytes;
-
-                    PRINT_DEBUG_INFO(
-                        L"\t\tctsIOPatternMediaStreamClient received seq number %lld (%lu received-bytes, %lu frame-bytes)\n",
-                        foundSlot->m_sequenceNumber,
-                        completedBytes,
-                        foundSlot->m_bytesReceived);
-
-                    // stop the timer once we receive the last frame
-                    // - it's not perfect (e.g. might have received them out of order)
-                    // - but it will be very close for tracking the total bits/sec
-                    if (static_cast<unsigned long>(receivedsequenceNumber) == m_finalFrame)
-                    {
-                        EndStatistics();
-                    }
-
-                }
-                else
+                const unsigned long remainingBytes = completedBytes - datagramOffset;
+                const unsigned long datagramBytes = remainingBytes < datagramSize ? remainingBytes : datagramSize;
+                ctsTask datagramTask(task);
+                datagramTask.m_buffer = task.m_buffer + datagramOffset;
+                datagramTask.m_bufferLength = datagramBytes;
+                datagramTask.m_coalescedSegmentSize = 0;
+
+                const auto datagramError = ProcessReceivedDatagram(datagramTask, datagramBytes, qpc);
+                if (datagramError != ctsIoPatternError::NoError)
                 {
-                    // didn't find a slot for the received seq. number
-                    ctsConfig::g_configSettings->UdpStatusDetails.m_errorFrames.Increment();
-                    m_statistics.m_errorFrames.Increment();
-
-                    if (receivedsequenceNumber < m_headEntry->m_sequenceNumber)
-                    {
-                        PRINT_DEBUG_INFO(
-                            L"\t\tctsIOPatternMediaStreamClient received **a stale** seq number (%lld) - current seq number (%lld)\n",
-                            receivedsequenceNumber,
-                            static_cast<long long>(m_headEntry->m_sequenceNumber));
-                    }
-                    else
-                    {
-                        PRINT_DEBUG_INFO(
-                            L"\t\tctsIOPatternMediaStreamClient recevieved **a future** seq number (%lld) - head of queue (%lld) tail of queue (%lld)\n",
-                            receivedsequenceNumber,
-                            static_cast<long long>(m_headEntry->m_sequenceNumber),
-                            static_cast<long long>(m_headEntry->m_sequenceNumber + m_frameEntries.size() - 1));
-                    }
+                    return datagramError;
                 }
             }
 
@@ -282,50 +215,147 @@ namespace ctsTraffic
         return ctsIoPatternError::NoError;
     }
 
-    // Returns an iterator within frame_entries pointing to the FrameEntry
-    //   matching the specified sequence number.
-    // If the sequence number was not found, will return end(frame_entries)
-    //
+    // processes a single datagram received into the task's buffer
     // _Requires_lock_held_(m_lock)
-    vector<ctsConfig::JitterFrameEntry>::iterator ctsIoPatternMediaStreamClient::FindSequenceNumber(long long sequenceNumber) noexcept
+    ctsIoPatternError ctsIoPatternMediaStreamClient::ProcessReceivedDatagram(const ctsTask& task, unsigned long completedBytes, const LARGE_INTEGER& qpc) noexcept
     {
-        const ctsSignedLongLong headSequenceNumber = m_headEntry->m_sequenceNumber;
-        const ctsSignedLongLong tailSequenceNumber = headSequenceNumber + m_frameEntries.size() - 1;
-        const ctsSignedLongLong vectorEndSequenceNumber = m_frameEntries.rbegin()->m_sequenceNumber;
+        if (!ctsMediaStreamMessage::ValidateBufferLengthFromTask(task, completedBytes))
+        {
+            ctsConfig::PrintErrorInfo(L"ctsIoPatternMediaStreamClient received an invalid datagram trying to parse the protocol header");
+            return ctsIoPatternError::TooFewBytes;
+        }
 
-        if (sequenceNumber > tailSequenceNumber || sequenceNumber < headSequenceNumber)
+        if (ctsMediaStreamMessage::GetProtocolHeaderFromTask(task) == c_udpDatagramProtocolHeaderFlagId)
         {
-            // sequence number was out of range of our circular queue
-            // - return end(frame_entries) to indicate it could not be found
-            return end(m_frameEntries);
+            // save off the connection ID when we receive it
+            ctsMediaStreamMessage::SetConnectionIdFromTask(GetConnectionIdentifier(), task);
+            return ctsIoPatternError::NoError;
         }
 
-        if (sequenceNumber <= vectorEndSequenceNumber)
+        // validate the buffer contents
+        ctsTask validationTask(task);
+        validationTask.m_bufferOffset = c_udpDatagramDataHeaderLength; // skip the UdpDatagramDataHeaderLength since we use them for our own stuff
+        validationTask.m_bufferLength -= c_udpDatagramDataHeaderLength;
+        if (!VerifyBuffer(validationTask, completedBytes - c_udpDatagramDataHeaderLength))
         {
-            // offset just from the head since it hasn't wrapped around the end
-            const auto offset = static_cast<size_t>(sequenceNumber - headSequenceNumber);
-            return m_headEntry + offset;
+            // exit early if the buffers don't match
+            return ctsIoPatternError::CorruptedBytes;
         }
-        // offset from the beginning since it wrapped around from the end
-        const auto offset = static_cast<size_t>(sequenceNumber - vectorEndSequenceNumber - 1LL);
-        return m_frameEntries.begin() + offset;
-    }
 
-    // _Requires_lock_held_(m_lock)
-    bool ctsIoPatternMediaStreamClient::ReceivedBufferedFrames() noexcept
-    {
-        if (m_frameEntries[0].m_sequenceNumber > 1)
+        // track the # of *bits* received
+        ctsConfig::g_configSettings->UdpStatusDetails.m_bitsReceived.Add(completedBytes * 8);
+        m_statistics.m_bitsReceived.Add(completedBytes * 8);
+
+        const long long receivedsequenceNumber = ctsMediaStreamMessage::GetSequenceNumberFromTask(task);
+        if (receivedsequenceNumber > m_finalFrame)
         {
-            // we've already received enough datagrams to fill one buffer
-            return true;
+            ctsConfig::g_configSettings->UdpStatusDetails.m_errorFrames.Increment();
+            m_statistics.m_errorFrames.Increment();
+
+            PRINT_DEBUG_INFO(
+                L"\t\tctsIOPatternMediaStreamClient recevieved **an unknown** seq number (%lld) (outside the final frame %lu)\n",
+                receivedsequenceNumber,
+                m_finalFrame);
         }
-        if (m_headEntry != m_frameEntries.begin())
+        else
         {
-            // we've already moved the head entry after processing a frame
-            return true;
+            //
+            // the ring slot for this seq number either holds it (tag as received),
+            // holds an older seq number (this is a future frame), or a newer one (this frame was already rendered)
+            //
+            auto& foundSlot = FindSlot(receivedsequenceNumber);
+            auto slotState = foundSlot.m_state.load(std::memory_order_acquire);
+            bool credited = false;
+            while (SlotSequenceNumber(slotState) == receivedsequenceNumber)
+            {
+                // always overwrite qpc & qpf values with the latest datagram details
+                // - written before crediting the bytes so the renderer sees them once it sees the bytes
+                const auto receiverQpf = ctTimer::SnapQpf();
+                foundSlot.m_senderQpc.store(*reinterpret_cast<long long*>(task.m_buffer + 8), std::memory_order_relaxed);
+                foundSlot.m_senderQpf.store(*reinterpret_cast<long long*>(task.m_buffer + 16), std::memory_order_relaxed);
+                foundSlot.m_receiverCompletionQpc.store(qpc.QuadPart, std::memory_order_relaxed);
+                // prefer the stack's receive timestamp (-UdpRecvTimestamps) so the time to schedule the completion isn't measured as jitter
+                // - a timestamp not taken from the QPC clock (e.g. a NIC's hardware clock) falls outside this last second and is ignored
+                const auto receiveTimestampQpc = task.m_receiveTimestampQpc;
+                if (receiveTimestampQpc > 0 && receiveTimestampQpc <= qpc.QuadPart && qpc.QuadPart - receiveTimestampQpc < receiverQpf)
+                {
+                    foundSlot.m_receiverQpc.store(receiveTimestampQpc, std::memory_order_relaxed);
+                }
+                else
+                {
+                    foundSlot.m_receiverQpc.store(qpc.QuadPart, std::memory_order_relaxed);
+                }
+
+                // saturate the byte count rather than carry into the sequence number
+                const unsigned long long frameBytes = SlotBytesReceived(slotState) + static_cast<unsigned long long>(completedBytes);
+                const auto updatedState = PackSlotState(
+                    receivedsequenceNumber,
+                    frameBytes > 0xffffffffULL ? 0xffffffffUL : static_cast<unsigned long>(frameBytes));
+                // only the renderer races with us (receives are serialized by the base lock)
+                // - if it claimed this frame first, the reloaded state no longer holds our seq number
+                if (foundSlot.m_state.compare_exchange_weak(slotState, updatedState, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    slotState = updatedState;
+                    credited = true;
+                    break;
+                }
+            }
+
+            if (credited)
+            {
+                m_receivedFrames.store(true, std::memory_order_release);
+
+                PRINT_DEBUG_INFO(
+                    L"\t\tctsIOPatternMediaStreamClient received seq number %lld (%lu received-bytes, %lu frame-bytes)\n",
+                    receivedsequenceNumber,
+                    completedBytes,
+                    SlotBytesReceived(slotState));
+
+                // stop the timer once we receive the last frame
+                // - it's not perfect (e.g. might have received them out of order)
+                // - but it will be very close for tracking the total bits/sec
+                if (static_cast<unsigned long>(receivedsequenceNumber) == m_finalFrame)
+                {
+                    EndStatistics();
+                }
+
+            }
+            else
+            {
+                // didn't find a slot for the received seq. number
+                ctsConfig::g_configSettings->UdpStatusDetails.m_errorFrames.Increment();
+                m_statistics.m_errorFrames.Increment();
+
+                const auto slotSequenceNumber = SlotSequenceNumber(slotState);
+                if (receivedsequenceNumber < slotSequenceNumber)
+                {
+                    // count it against its frame's second if that second hasn't yet been written
+                    if (receivedsequenceNumber > 0)
+                    {
+                        const long long lateSecond = (receivedsequenceNumber - 1) / m_framesPerSecond;
+                        auto& summarySlot = FindSummarySlot(lateSecond);
+                        if (summarySlot.m_second.load(std::memory_order_acquire) == lateSecond)
+                        {
+                            summarySlot.m_lateDatagrams.fetch_add(1UL, std::memory_order_relaxed);
+                        }
+                    }
+
+                    PRINT_DEBUG_INFO(
+                        L"\t\tctsIOPatternMediaStreamClient received **a stale** seq number (%lld) - its slot now holds seq number (%lld)\n",
+                        receivedsequenceNumber,
+                        slotSequenceNumber);
+                }
+                else
+                {
+                    PRINT_DEBUG_INFO(
+                        L"\t\tctsIOPatternMediaStreamClient recevieved **a future** seq number (%lld) - its slot still holds seq number (%lld)\n",
+                        receivedsequenceNumber,
+                        slotSequenceNumber);
+                }
+            }
         }
 
-        return std::any_of(m_frameEntries.begin(), m_frameEntries.end(), [](const auto udpFrame) { return udpFrame.m_bytesReceived > 0UL; });
+        return ctsIoPatternError::NoError;
     }
 
     // _Requires_lock_held_(m_lock)
@@ -372,78 +402,156 @@ namespace ctsTraffic
     }
 
     // "render the current frame"
-    // - update the current frame as "read" and move the head to the next frame
-    // _Requires_lock_held_(m_lock)
+    // - claim the head frame from its ring slot, hand the slot to the frame one ring-length later, and move the head to the next frame
+    // - only called from the renderer timer callback: does not require the base lock
     void ctsIoPatternMediaStreamClient::RenderFrame() noexcept
     {
+        const long long second = (m_headSequenceNumber - 1) / m_framesPerSecond;
+        if (second != m_summarySecond)
+        {
+            AdvanceJitterSummary(second);
+        }
+        auto& summary = FindSummarySlot(second).m_summary;
+
+        auto& headSlot = FindSlot(m_headSequenceNumber);
+        const auto renderedState = headSlot.m_state.exchange(
+            PackSlotState(m_headSequenceNumber + m_jitterRingSize, 0UL),
+            std::memory_order_acq_rel);
+
+        ctsConfig::JitterFrameEntry headEntry;
+        headEntry.m_sequenceNumber = m_headSequenceNumber;
+        headEntry.m_bytesReceived = SlotBytesReceived(renderedState);
+        if (headEntry.m_bytesReceived > 0)
+        {
+            headEntry.m_senderQpc = headSlot.m_senderQpc.load(std::memory_order_relaxed);
+            headEntry.m_senderQpf = headSlot.m_senderQpf.load(std::memory_order_relaxed);
+            headEntry.m_receiverQpc = headSlot.m_receiverQpc.load(std::memory_order_relaxed);
+            headEntry.m_receiverCompletionQpc = headSlot.m_receiverCompletionQpc.load(std::memory_order_relaxed);
+            headEntry.m_receiverQpf = ctTimer::SnapQpf();
+        }
+
         // estimating time in flight for this frame by determining how much time since the first send was just 'waiting' to send this frame
         // and subtracing that from how much time since the first receive - since time between receives should at least be time between sends
-        if (m_headEntry->m_receiverQpf != 0 && m_firstFrame.m_receiverQpf != 0)
+        if (headEntry.m_receiverQpf != 0 && m_firstFrame.m_receiverQpf != 0)
         {
             const double msSinceFirstReceive =
-                (static_cast<double>(m_headEntry->m_receiverQpc) * 1000.0f / static_cast<double>(m_headEntry->m_receiverQpf)) -
+                (static_cast<double>(headEntry.m_receiverQpc) * 1000.0f / static_cast<double>(headEntry.m_receiverQpf)) -
                 (static_cast<double>(m_firstFrame.m_receiverQpc) * 1000.0f / static_cast<double>(m_firstFrame.m_receiverQpf));
             const double msSinceFirstSend =
-                (static_cast<double>(m_headEntry->m_senderQpc) * 1000.0f / static_cast<double>(m_headEntry->m_senderQpf)) -
+                (static_cast<double>(headEntry.m_senderQpc) * 1000.0f / static_cast<double>(headEntry.m_senderQpf)) -
                 (static_cast<double>(m_firstFrame.m_senderQpc) * 1000.0f / static_cast<double>(m_firstFrame.m_senderQpf));
-            m_headEntry->m_estimatedTimeInFlightMs = msSinceFirstReceive - msSinceFirstSend;
+            headEntry.m_estimatedTimeInFlightMs = msSinceFirstReceive - msSinceFirstSend;
         }
 
-        if (m_headEntry->m_bytesReceived == m_frameSizeBytes)
+        const unsigned long frameSizeBytes = ctsConfig::GetMediaStream().GetFrameSizeBytes(headEntry.m_sequenceNumber);
+        TraceLoggingWrite(
+            g_ctsTraceLoggingProvider,
+            "MediaStreamFrame",
+            TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+            TraceLoggingKeyword(CTS_TRACE_KEYWORD_MEDIA_STREAM),
+            TraceLoggingPointer(this, "IoPattern"),
+            TraceLoggingInt64(headEntry.m_sequenceNumber, "SequenceNumber"),
+            TraceLoggingUInt32(headEntry.m_bytesReceived, "BytesReceived"),
+            TraceLoggingUInt32(frameSizeBytes, "FrameSizeBytes"),
+            TraceLoggingFloat64(headEntry.m_estimatedTimeInFlightMs, "EstimatedTimeInFlightMs"));
+        if (headEntry.m_bytesReceived == frameSizeBytes)
         {
             ctsConfig::g_configSettings->UdpStatusDetails.m_successfulFrames.Increment();
             m_statistics.m_successfulFrames.Increment();
 
+            const double jitterMs = std::abs(m_previousFrame.m_estimatedTimeInFlightMs - headEntry.m_estimatedTimeInFlightMs);
+            ++summary.m_successfulFrames;
+            summary.m_jitterSumMs += jitterMs;
+            if (jitterMs > summary.m_maxJitterMs)
+            {
+                summary.m_maxJitterMs = jitterMs;
+            }
+
             PRINT_DEBUG_INFO(
                 L"\t\tctsIOPatternMediaStreamClient rendered frame %lld\n",
-                static_cast<long long>(m_headEntry->m_sequenceNumber));
+                headEntry.m_sequenceNumber);
 
             // Directly write this status update if jitter is enabled
-            PrintJitterUpdate(*m_headEntry, m_previousFrame);
+            PrintJitterUpdate(headEntry, m_previousFrame);
 
             // if this is the first frame, capture it
             if (m_firstFrame.m_receiverQpc == 0)
             {
-                m_firstFrame = *m_headEntry;
+                m_firstFrame = headEntry;
             }
             // always keep the most recently received frame for jitter
-            m_previousFrame = *m_headEntry;
+            m_previousFrame = headEntry;
 
         }
-        else if (m_headEntry->m_bytesReceived < m_frameSizeBytes)
+        else if (headEntry.m_bytesReceived < frameSizeBytes)
         {
             ctsConfig::g_configSettings->UdpStatusDetails.m_droppedFrames.Increment();
             m_statistics.m_droppedFrames.Increment();
+            ++summary.m_droppedFrames;
 
             PRINT_DEBUG_INFO(
                 L"\t\tctsIOPatternMediaStreamClient **dropped** frame for seq number (%lld)\n",
-                m_headEntry->m_sequenceNumber);
+                headEntry.m_sequenceNumber);
 
             // track the dropped frame
             // indicate zero's for the other values so we won't calculate jitter for a dropped datagram
             ctsConfig::JitterFrameEntry droppedFrame;
-            droppedFrame.m_sequenceNumber = m_headEntry->m_sequenceNumber;
+            droppedFrame.m_sequenceNumber = headEntry.m_sequenceNumber;
             PrintJitterUpdate(droppedFrame, ctsConfig::JitterFrameEntry());
         }
-        else // m_headEntry->bytes_received > m_frameSizeBytes
+        else // headEntry.m_bytesReceived > frameSizeBytes
         {
             ctsConfig::g_configSettings->UdpStatusDetails.m_duplicateFrames.Increment();
             m_statistics.m_duplicateFrames.Increment();
+            ++summary.m_duplicateFrames;
 
             PRINT_DEBUG_INFO(
                 L"\t\tctsIOPatternMediaStreamClient **a duplicate** frame for seq number (%lld)\n",
-                m_headEntry->m_sequenceNumber);
+                headEntry.m_sequenceNumber);
+        }
+
+        // move the head to the next sequence number
+        ++m_headSequenceNumber;
+    }
+
+    // starts counting the given second in its summary slot, first writing out the older second that slot was counting
+    // - only called from the renderer timer callback
+    void ctsIoPatternMediaStreamClient::AdvanceJitterSummary(long long second) noexcept
+    {
+        m_summarySecond = second;
+
+        auto& summarySlot = FindSummarySlot(second);
+        // swap in the new second first so receives stop counting late datagrams against the second being written
+        const auto previousSecond = summarySlot.m_second.exchange(second, std::memory_order_acq_rel);
+        const auto lateDatagrams = summarySlot.m_lateDatagrams.exchange(0UL, std::memory_order_acq_rel);
+        if (previousSecond >= 0)
+        {
+            summarySlot.m_summary.m_lateDatagrams = lateDatagrams;
+            ctsConfig::PrintJitterSummary(summarySlot.m_summary);
         }
 
-        // update the current sequence number so it's now the "end" sequence number of the queue (the new max value)
-        m_headEntry->m_sequenceNumber = m_headEntry->m_sequenceNumber + static_cast<long long>(m_frameEntries.size());
-        m_headEntry->m_bytesReceived = 0;
+        summarySlot.m_summary = ctsConfig::JitterSummaryEntry();
+        summarySlot.m_summary.m_second = second;
+        summarySlot.m_summary.m_startRequests = m_startRequests.exchange(0UL, std::memory_order_relaxed);
+    }
 
-        // move the head entry to the next sequence number
-        ++m_headEntry;
-        if (m_headEntry == m_frameEntries.end())
+    // writes out the seconds still being counted once the final frame has been rendered
+    // - only called from the renderer timer callback
+    void ctsIoPatternMediaStreamClient::FlushJitterSummaries() noexcept
+    {
+        for (auto second = m_summarySecond - c_jitterSummaryWindowSeconds + 1; second <= m_summarySecond; ++second)
         {
-            m_headEntry = m_frameEntries.begin();
+            if (second < 0)
+            {
+                continue;
+            }
+
+            auto& summarySlot = FindSummarySlot(second);
+            if (summarySlot.m_second.exchange(-1LL, std::memory_order_acq_rel) == second)
+            {
+                summarySlot.m_summary.m_lateDatagrams = summarySlot.m_lateDatagrams.exchange(0UL, std::memory_order_acq_rel);
+                ctsConfig::PrintJitterSummary(summarySlot.m_summary);
+            }
         }
     }
 
@@ -473,6 +581,7 @@ namespace ctsTraffic
             resendTask.m_bufferLength = static_cast<unsigned long>(strlen(c_startBuffer));
             resendTask.m_bufferType = ctsTask::BufferType::Static; // this is our own buffer: the base class should not mess with it
 
+            thisPtr->m_startRequests.fetch_add(1UL, std::memory_order_relaxed);
             thisPtr->SetNextStartTimer();
             thisPtr->SendTaskToCallback(resendTask);
         }
@@ -487,9 +596,8 @@ namespace ctsTraffic
         bool timerScheduled = false;
         while (!timerScheduled)
         {
-            // take the base lock before touching any internal members
-            const auto lock = thisPtr->AcquireIoPatternLock();
-
+            // the renderer does not take the base lock to process frames: receives complete concurrently into the jitter ring
+            // - the base lock is only taken to send an abort task back to the IO callback
             if (thisPtr->m_finishedStream)
             {
                 return;
@@ -499,7 +607,7 @@ namespace ctsTraffic
 
             bool fatalAborted = false;
             if (thisPtr->m_timerWheelOffsetFrames >= thisPtr->m_initialBufferFrames &&
-                thisPtr->m_headEntry->m_sequenceNumber <= thisPtr->m_finalFrame)
+                thisPtr->m_headSequenceNumber <= thisPtr->m_finalFrame)
             {
                 // if we haven't yet received *anything* from the server, abort this connection
                 if (!thisPtr->ReceivedBufferedFrames())
@@ -513,6 +621,7 @@ namespace ctsTraffic
                     thisPtr->m_finishedStream = true;
                     ctsTask abortTask;
                     abortTask.m_ioAction = ctsTaskAction::FatalAbort;
+                    const auto lock = thisPtr->AcquireIoPatternLock();
                     thisPtr->SendTaskToCallback(abortTask);
                     fatalAborted = true;
 
@@ -527,16 +636,19 @@ namespace ctsTraffic
             if (!fatalAborted)
             {
                 // wait for the precise number of milliseconds for the next frame
-                if (thisPtr->m_headEntry->m_sequenceNumber <= thisPtr->m_finalFrame)
+                if (thisPtr->m_headSequenceNumber <= thisPtr->m_finalFrame)
                 {
                     timerScheduled = thisPtr->SetNextTimer(false);
 
                 }
                 else
                 {
+                    thisPtr->FlushJitterSummaries();
+
                     thisPtr->m_finishedStream = true;
                     ctsTask abortTask;
                     abortTask.m_ioAction = ctsTaskAction::Abort;
+                    const auto lock = thisPtr->AcquireIoPatternLock();
                     thisPtr->SendTaskToCallback(abortTask);
                     PRINT_DEBUG_INFO(L"\t\tctsIOPatternMediaStreamClient - issuing an ABORT to cleanly close the connection\n");
                 }
@@ -24,6 +24,11 @@ namespace ctsTraffic
 {
     constexpr auto* const c_completionMessage = "DONE";
     constexpr uint32_t c_completionMessageSize = 4;
+    // -LeanProtocol : clients start the connection with this marker followed by the 16 bytes of their connection ID
+    // - the marker lets the server fail the connection if the client was not also given -LeanProtocol
+    constexpr auto* const c_leanProtocolMarker = "LEAN";
+    constexpr uint32_t c_leanProtocolMarkerSize = 4;
+    constexpr uint32_t c_leanProtocolHeaderSize = c_leanProtocolMarkerSize + ctsStatistics::c_connectionIdBinaryLength;
 
     enum class ctsIoPatternType
     {
@@ -55,6 +60,8 @@ namespace ctsTraffic
             MoreIo,
             ServerSendConnectionId,
             ClientRecvConnectionId,
+            ClientSendConnectionId,  // -LeanProtocol : the client doesn't wait for its connection ID to be sent
+            ServerRecvConnectionId,  // -LeanProtocol
             ServerSendCompletion,
             ClientRecvCompletion,
             GracefulShutdown,  // TCP: instruct the function to call shutdown(SD_SEND) on the socket
@@ -71,14 +78,24 @@ namespace ctsTraffic
         // need to know in-flight bytes
         uint64_t m_inflightBytes = 0UL;
         // ideal send backlog value
+        // - with -MessageSize, PrePostSends is the number of messages kept in flight
         uint32_t m_idealSendbacklog = ctsConfig::g_configSettings->PrePostSends == 0 ?
             ctsConfig::GetMaxBufferSize() :
-            ctsConfig::GetMaxBufferSize() * ctsConfig::g_configSettings->PrePostSends;
+            (ctsConfig::g_configSettings->MessageSize > 0 ? ctsConfig::g_configSettings->MessageSize : ctsConfig::GetMaxBufferSize()) *
+            ctsConfig::g_configSettings->PrePostSends;
+        // -MessageSize : the bytes already sent and received of the message each direction is part way through
+        uint32_t m_sendMessageOffset = 0UL;
+        uint32_t m_recvMessageOffset = 0UL;
+        // -PersistentTransfers : the transfers completed over this connection before the current one
+        uint32_t m_completedTransfers = 0UL;
 
         InternalPatternState m_internalState = InternalPatternState::Initialized;
         // track if waiting for the prior state to complete
         bool m_pendedState = false;
 
+        // -PersistentTransfers : returns to MoreIo with nothing yet transferred, keeping the connection and its buffers
+        void StartNextTransfer() noexcept;
+
     public:
         ctsIoPatternState() noexcept;
 
@@ -98,6 +115,18 @@ namespace ctsTraffic
         ctsIoPatternError CompletedTask(const ctsTask& completedTask, uint32_t completedTransferBytes) noexcept;
 
         ctsIoPatternError UpdateError(DWORD error) noexcept;
+
+        // the connection ID was already exchanged while the connection was established (-ConnectData)
+        void SkipConnectionIdExchange() noexcept;
+
+        // -PersistentTransfers : the transfers already completed over the connection, and whether the current one is its last
+        // - once the completion message of a transfer completes, the next transfer begins (if any) instead of the shutdown
+        [[nodiscard]] uint32_t GetCompletedTransfers() const noexcept;
+        [[nodiscard]] bool IsLastTransfer() const noexcept;
+
+        // -MessageSize : returns the number of messages whose last byte the completed send or recv transferred
+        // - endedMidMessage is set when the IO ended part way through a message
+        uint32_t CompletedMessages(ctsTaskAction action, uint32_t completedTransferBytes, bool& endedMidMessage) noexcept;
     };
 
 
@@ -170,6 +199,21 @@ namespace ctsTraffic
         switch (m_internalState)
         {
             case InternalPatternState::Initialized:
+                if (ctsConfig::g_configSettings->LeanProtocol)
+                {
+                    if (ctsConfig::IsListening())
+                    {
+                        PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::GetNextPatternType : RecvConnectionId (LeanProtocol)\n");
+                        m_pendedState = true;
+                        m_internalState = InternalPatternState::ServerRecvConnectionId;
+                        return ctsIoPatternType::RecvConnectionId;
+                    }
+
+                    // not pended : the client's IO is posted immediately behind its connection ID
+                    PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::GetNextPatternType : SendConnectionId (LeanProtocol)\n");
+                    m_internalState = InternalPatternState::ClientSendConnectionId;
+                    return ctsIoPatternType::SendConnectionId;
+                }
                 if (ctsConfig::IsListening())
                 {
                     PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::GetNextPatternType : SendConnectionId\n");
@@ -188,6 +232,8 @@ namespace ctsTraffic
             // both client and server start IO after the connection ID is shared
             case InternalPatternState::ServerSendConnectionId:
             case InternalPatternState::ClientRecvConnectionId:
+            case InternalPatternState::ClientSendConnectionId:
+            case InternalPatternState::ServerRecvConnectionId:
                 PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::GetNextPatternType : MoreIo\n");
                 m_internalState = InternalPatternState::MoreIo;
                 return ctsIoPatternType::MoreIo;
@@ -283,6 +329,45 @@ namespace ctsTraffic
         return ctsIoPatternError::NoError;
     }
 
+    inline void ctsIoPatternState::SkipConnectionIdExchange() noexcept
+    {
+        if (InternalPatternState::Initialized == m_internalState)
+        {
+            PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::SkipConnectionIdExchange : MoreIo\n");
+            m_internalState = InternalPatternState::MoreIo;
+        }
+    }
+
+    inline uint32_t ctsIoPatternState::GetCompletedTransfers() const noexcept
+    {
+        return m_completedTransfers;
+    }
+
+    inline bool ctsIoPatternState::IsLastTransfer() const noexcept
+    {
+        return m_completedTransfers + 1 >= ctsConfig::g_configSettings->PersistentTransfers;
+    }
+
+    inline void ctsIoPatternState::StartNextTransfer() noexcept
+    {
+        PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::StartNextTransfer : MoreIo (completed %u transfers)\n", m_completedTransfers + 1);
+        ++m_completedTransfers;
+        m_confirmedBytes = 0;
+        m_internalState = InternalPatternState::MoreIo;
+        m_pendedState = false;
+    }
+
+    inline uint32_t ctsIoPatternState::CompletedMessages(ctsTaskAction action, uint32_t completedTransferBytes, bool& endedMidMessage) noexcept
+    {
+        const uint32_t messageSize = ctsConfig::g_configSettings->MessageSize;
+        auto& messageOffset = ctsTaskAction::Send == action ? m_sendMessageOffset : m_recvMessageOffset;
+
+        const uint64_t totalBytes = static_cast<uint64_t>(messageOffset) + completedTransferBytes;
+        messageOffset = static_cast<uint32_t>(totalBytes % messageSize);
+        endedMidMessage = messageOffset != 0;
+        return static_cast<uint32_t>(totalBytes / messageSize);
+    }
+
     inline ctsIoPatternError ctsIoPatternState::CompletedTask(const ctsTask& completedTask, uint32_t completedTransferBytes) noexcept
     {
         // If already failed, don't continue processing
@@ -291,21 +376,51 @@ namespace ctsTraffic
             return ctsIoPatternError::ErrorIoFailed;
         }
 
+        // -LeanProtocol : the client's connection ID can complete in any state, as its IO was started without waiting for it
+        if (ctsConfig::g_configSettings->LeanProtocol &&
+            ctsTask::BufferType::TcpConnectionId == completedTask.m_bufferType &&
+            ctsTaskAction::Send == completedTask.m_ioAction)
+        {
+            if (completedTransferBytes != c_leanProtocolHeaderSize)
+            {
+                PRINT_DEBUG_INFO(
+                    L"\t\tctsIOPatternState::CompletedTask : ErrorIOFailed (TooFewBytes) [transfered %llu, Expected ConnectionID (%u)]\n",
+                    static_cast<uint64_t>(completedTransferBytes),
+                    c_leanProtocolHeaderSize);
+
+                m_internalState = InternalPatternState::ErrorIoFailed;
+                return ctsIoPatternError::TooFewBytes;
+            }
+            return ctsIoPatternError::NoError;
+        }
+
         // if completed our connection id request, immediately return
         // (not validating IO below)
-        if (InternalPatternState::ServerSendConnectionId == m_internalState || InternalPatternState::ClientRecvConnectionId == m_internalState)
+        if (InternalPatternState::ServerSendConnectionId == m_internalState ||
+            InternalPatternState::ClientRecvConnectionId == m_internalState ||
+            InternalPatternState::ServerRecvConnectionId == m_internalState)
         {
             // must have received the full id
-            if (completedTransferBytes != ctsStatistics::c_connectionIdLength)
+            const auto connectionIdLength = InternalPatternState::ServerRecvConnectionId == m_internalState ?
+                c_leanProtocolHeaderSize :
+                ctsStatistics::c_connectionIdLength;
+            if (completedTransferBytes != connectionIdLength)
             {
                 PRINT_DEBUG_INFO(
                     L"\t\tctsIOPatternState::CompletedTask : ErrorIOFailed (TooFewBytes) [transfered %llu, Expected ConnectionID (%u)]\n",
                     static_cast<uint64_t>(completedTransferBytes),
-                    ctsStatistics::c_connectionIdLength);
+                    connectionIdLength);
 
                 m_internalState = InternalPatternState::ErrorIoFailed;
                 return ctsIoPatternError::TooFewBytes;
             }
+            if (InternalPatternState::ServerRecvConnectionId == m_internalState &&
+                memcmp(completedTask.m_buffer, c_leanProtocolMarker, c_leanProtocolMarkerSize) != 0)
+            {
+                PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::CompletedTask : ErrorIOFailed (CorruptedBytes) [the client didn't start with the LeanProtocol marker]\n");
+                m_internalState = InternalPatternState::ErrorIoFailed;
+                return ctsIoPatternError::CorruptedBytes;
+            }
 
             m_pendedState = false;
         }
@@ -373,12 +488,26 @@ namespace ctsTraffic
                     switch (m_internalState)
                     {
                         case InternalPatternState::MoreIo:
+                            if (ctsConfig::g_configSettings->LeanProtocol)
+                            {
+                                // the client's FIN confirms it also finished the transfer
+                                PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::CompletedTask (MoreIo) : RequestFIN (LeanProtocol)\n");
+                                m_internalState = InternalPatternState::RequestFin;
+                                m_pendedState = false;
+                                break;
+                            }
                             PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::CompletedTask (MoreIo) : ServerSendCompletion\n");
                             m_internalState = InternalPatternState::ServerSendCompletion;
                             m_pendedState = false;
                             break;
 
                         case InternalPatternState::ServerSendCompletion:
+                            if (!IsLastTransfer())
+                            {
+                                // the client starts its next transfer once it receives the completion message
+                                StartNextTransfer();
+                                break;
+                            }
                             PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::CompletedTask (ServerSendCompletion) : RequestFIN\n");
                             m_internalState = InternalPatternState::RequestFin;
                             m_pendedState = false;
@@ -410,6 +539,14 @@ namespace ctsTraffic
                     switch (m_internalState)
                     {
                         case InternalPatternState::MoreIo:
+                            if (ctsConfig::g_configSettings->LeanProtocol)
+                            {
+                                // the server only returns its FIN once it received the client's FIN after the full transfer
+                                PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::CompletedTask (MoreIo) : GracefulShutdown (LeanProtocol)\n");
+                                m_internalState = InternalPatternState::GracefulShutdown;
+                                m_pendedState = false;
+                                break;
+                            }
                             PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::CompletedTask (MoreIo) : ClientRecvCompletion\n");
                             m_internalState = InternalPatternState::ClientRecvCompletion;
                             m_pendedState = false;
@@ -434,6 +571,12 @@ namespace ctsTraffic
                                 return ctsIoPatternError::TooFewBytes;
                             }
 
+                            if (!IsLastTransfer())
+                            {
+                                StartNextTransfer();
+                                break;
+                            }
+
                             if (ctsConfig::TcpShutdownType::GracefulShutdown == ctsConfig::g_configSettings->TcpShutdown)
                             {
                                 PRINT_DEBUG_INFO(L"\t\tctsIOPatternState::CompletedTask (ClientRecvCompletion) : GracefulShutdown\n");
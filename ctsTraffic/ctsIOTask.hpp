@@ -35,15 +35,36 @@ namespace ctsTraffic
         FatalAbort
     };
 
+    // the most WSABUFs a single send or recv task is posted with (-BufferSegments)
+    constexpr unsigned long c_maxTaskBufferSegments = 64UL;
+
     struct ctsTask
     {
         long long m_timeOffsetMilliseconds = 0LL;
+        // -RateLimitPacing:on : the precise delay of a paced send
+        // - m_timeOffsetMilliseconds is rounded up from this, so is still non-zero whenever the task is delayed
+        long long m_timeOffsetMicroseconds = 0LL;
         RIO_BUFFERID m_rioBufferid = RIO_INVALID_BUFFERID;
 
         _Field_size_full_(buffer_length) char* m_buffer = nullptr;
         unsigned long m_bufferLength = 0UL;
         unsigned long m_bufferOffset = 0UL;
+        // the offset of m_buffer within the registered RIO buffer m_rioBufferid
+        // - RIO requests use (m_rioBufferOffset + m_bufferOffset)
+        unsigned long m_rioBufferOffset = 0UL;
         unsigned long m_expectedPatternOffset = 0UL;
+        // the length of each datagram within a completed UDP receive that coalesced several datagrams (URO)
+        // - only the last datagram can be shorter; 0 when the receive completed with a single datagram
+        unsigned long m_coalescedSegmentSize = 0UL;
+        // the QPC the stack timestamped a completed UDP receive with (-UdpRecvTimestamps) - 0 if not timestamped
+        long long m_receiveTimestampQpc = 0LL;
+        // the number of WSABUFs the buffer is posted with as a gather (send) or scatter (recv) list
+        // - the first segment is m_segmentHeaderLength bytes when set (modeling header+payload framing),
+        //   and the (remaining) buffer is split evenly across the (remaining) segments
+        unsigned long m_bufferSegments = 1UL;
+        unsigned long m_segmentHeaderLength = 0UL;
+        // the QPC when the IO is scheduled to be initiated - only set when tracking IO latency (-LatencyPercentiles)
+        long long m_ioInitiatedQpc = 0LL;
         ctsTaskAction m_ioAction = ctsTaskAction::None;
 
         // (internal) flag identifying the type of buffer
@@ -59,6 +80,44 @@ namespace ctsTraffic
         // (internal) flag if this IO request is tracked and verified
         bool m_trackIo = false;
 
+        // describes [m_buffer + m_bufferOffset, m_bufferLength) as the WSABUF list to post : returns the number of WSABUFs
+        // - segments never have a zero length, so fewer than m_bufferSegments are returned for very short buffers
+        unsigned long BuildBufferList(_Out_writes_to_(c_maxTaskBufferSegments, return) WSABUF* buffers) const noexcept
+        {
+            char* const buffer = m_buffer + m_bufferOffset;
+            const unsigned long segments = m_bufferSegments > c_maxTaskBufferSegments ? c_maxTaskBufferSegments : m_bufferSegments;
+            if (segments <= 1 || m_bufferLength <= 1)
+            {
+                buffers[0].buf = buffer;
+                buffers[0].len = m_bufferLength;
+                return 1;
+            }
+
+            unsigned long bufferCount = 0;
+            unsigned long offset = 0;
+            unsigned long payloadSegments = segments;
+            if (m_segmentHeaderLength > 0 && m_segmentHeaderLength < m_bufferLength)
+            {
+                buffers[0].buf = buffer;
+                buffers[0].len = m_segmentHeaderLength;
+                bufferCount = 1;
+                offset = m_segmentHeaderLength;
+                --payloadSegments;
+            }
+
+            const unsigned long payloadLength = m_bufferLength - offset;
+            const unsigned long segmentLength = (payloadLength + payloadSegments - 1) / payloadSegments;
+            while (offset < m_bufferLength)
+            {
+                const unsigned long remaining = m_bufferLength - offset;
+                buffers[bufferCount].buf = buffer + offset;
+                buffers[bufferCount].len = remaining < segmentLength ? remaining : segmentLength;
+                offset += buffers[bufferCount].len;
+                ++bufferCount;
+            }
+            return bufferCount;
+        }
+
         static PCWSTR PrintTaskAction(const ctsTaskAction& action) noexcept
         {
             switch (action)
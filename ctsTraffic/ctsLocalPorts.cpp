@@ -0,0 +1,276 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// parent header
+#include "ctsLocalPorts.h"
+// cpp headers
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+#include <mstcpip.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include <ctTimer.hpp>
+#include <ctMemoryGuard.hpp>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    namespace ctsLocalPorts
+    {
+        // TIME_WAIT lasts TcpTimedWaitDelay seconds - 120 seconds when not configured
+        constexpr DWORD c_defaultTimeWaitSeconds = 120;
+        // reservations are split across processors only while each keeps at least this many ports
+        constexpr unsigned long c_minimumReservationPorts = 64;
+        // the release time of a port which is bound to a socket
+        constexpr long long c_portInUse = -1LL;
+
+        struct PortBlock
+        {
+            unsigned long m_firstIndex = 0;
+            unsigned long m_portCount = 0;
+            long long m_cursor = 0;
+        };
+
+        struct PortReservation
+        {
+            // the reservation is released when the socket which acquired it is closed
+            wil::unique_socket m_socket;
+            ULONG64 m_token = 0;
+        };
+
+        static long long g_timeWaitMilliseconds = c_defaultTimeWaitSeconds * 1000LL;
+        // indexed by port - LocalPortLow : when the port was last closed, zero if it can be used right away
+        static std::vector<long long> g_portReleaseTimes;
+        static std::vector<PortBlock> g_portBlocks;
+        static std::vector<PortReservation> g_portReservations;
+        // used once every port was found to be in use
+        static long long g_portCounter = 0LL;
+
+        static size_t CurrentProcessorIndex(size_t count) noexcept
+        {
+            PROCESSOR_NUMBER processor{};
+            GetCurrentProcessorNumberEx(&processor);
+            return (processor.Group * 64ull + processor.Number) % count;
+        }
+
+        static unsigned long CountBlocks(unsigned long portCount, unsigned long minimumPortsPerBlock) noexcept
+        {
+            const auto processorCount = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+            const auto blockCount = portCount / minimumPortsPerBlock;
+            return blockCount == 0 ? 1 : blockCount < processorCount ? blockCount : processorCount;
+        }
+
+        static void ReadTimeWaitDelay() noexcept
+        {
+            DWORD timeWaitSeconds = 0;
+            DWORD valueSize = sizeof timeWaitSeconds;
+            if (ERROR_SUCCESS == RegGetValueW(
+                HKEY_LOCAL_MACHINE,
+                L"SYSTEM\\CurrentControlSet\\Services\\Tcpip\\Parameters",
+                L"TcpTimedWaitDelay",
+                RRF_RT_REG_DWORD,
+                nullptr,
+                &timeWaitSeconds,
+                &valueSize))
+            {
+                g_timeWaitMilliseconds = timeWaitSeconds * 1000LL;
+            }
+        }
+
+        static void AcquireReservations()
+        {
+            const auto localPortHigh = ctsConfig::g_configSettings->LocalPortHigh;
+            const auto localPortLow = ctsConfig::g_configSettings->LocalPortLow;
+            // a -LocalPort range is reserved as given, otherwise the stack chooses where each reservation starts
+            const auto portCount = ctsConfig::g_configSettings->PortReservationSize;
+            const auto blockCount = CountBlocks(portCount, c_minimumReservationPorts);
+
+            const auto& bindAddress = ctsConfig::g_configSettings->BindAddresses[0];
+            const auto isTcp = ctsConfig::ProtocolType::TCP == ctsConfig::g_configSettings->Protocol;
+            unsigned long portsReserved = 0;
+            for (unsigned long block = 0; block < blockCount; ++block)
+            {
+                // the last block takes the remainder
+                const auto blockPorts = block + 1 == blockCount ? portCount - portsReserved : portCount / blockCount;
+
+                PortReservation reservation;
+                reservation.m_socket.reset(ctsConfig::CreateSocket(
+                    bindAddress.family(),
+                    isTcp ? SOCK_STREAM : SOCK_DGRAM,
+                    isTcp ? IPPROTO_TCP : IPPROTO_UDP,
+                    WSA_FLAG_OVERLAPPED));
+
+                // the start port is in network byte order
+                INET_PORT_RANGE portRange{};
+                portRange.StartPort = localPortHigh != 0 ? htons(static_cast<USHORT>(localPortLow + portsReserved)) : 0;
+                portRange.NumberOfPorts = static_cast<USHORT>(blockPorts);
+                INET_PORT_RESERVATION_INSTANCE reservationInstance{};
+                DWORD bytesReturned{};
+                if (0 != WSAIoctl(
+                    reservation.m_socket.get(),
+                    SIO_ACQUIRE_PORT_RESERVATION,
+                    &portRange,
+                    sizeof portRange,
+                    &reservationInstance,
+                    sizeof reservationInstance,
+                    &bytesReturned,
+                    nullptr,
+                    nullptr))
+                {
+                    THROW_WIN32_MSG(WSAGetLastError(), "WSAIoctl(SIO_ACQUIRE_PORT_RESERVATION) for %lu ports", blockPorts);
+                }
+                reservation.m_token = reservationInstance.Token;
+
+                PRINT_DEBUG_INFO(
+                    L"\t\tctsLocalPorts : reserved ports [%u, %u]\n",
+                    ntohs(reservationInstance.Reservation.StartPort),
+                    ntohs(reservationInstance.Reservation.StartPort) + reservationInstance.Reservation.NumberOfPorts - 1);
+                g_portReservations.push_back(std::move(reservation));
+                portsReserved += blockPorts;
+            }
+        }
+
+        void Initialize()
+        {
+            if (ctsConfig::g_configSettings->PortReservationSize > 0)
+            {
+                AcquireReservations();
+                return;
+            }
+
+            if (0 == ctsConfig::g_configSettings->LocalPortHigh)
+            {
+                // either no local port or a single local port
+                return;
+            }
+
+            ReadTimeWaitDelay();
+            const auto portCount = static_cast<unsigned long>(ctsConfig::g_configSettings->LocalPortHigh - ctsConfig::g_configSettings->LocalPortLow + 1);
+            g_portReleaseTimes.assign(portCount, 0LL);
+
+            const auto blockCount = CountBlocks(portCount, 1);
+            unsigned long firstIndex = 0;
+            for (unsigned long block = 0; block < blockCount; ++block)
+            {
+                PortBlock portBlock;
+                portBlock.m_firstIndex = firstIndex;
+                portBlock.m_portCount = block + 1 == blockCount ? portCount - firstIndex : portCount / blockCount;
+                g_portBlocks.push_back(portBlock);
+                firstIndex += portBlock.m_portCount;
+            }
+        }
+
+        unsigned short Acquire() noexcept
+        {
+            if (g_portBlocks.empty())
+            {
+                // zero with -PortReservation, as the stack chooses the port from the reservation at bind
+                return ctsConfig::g_configSettings->PortReservationSize > 0 ? 0 : ctsConfig::g_configSettings->LocalPortLow;
+            }
+
+            // starting with the current processor's block, moving to the others once it's exhausted
+            const auto currentTime = ctl::ctTimer::SnapQpcInMillis();
+            const auto firstBlock = CurrentProcessorIndex(g_portBlocks.size());
+            long long oldestReleaseTime = MAXLONGLONG;
+            unsigned long oldestIndex = 0;
+            for (size_t blockOffset = 0; blockOffset < g_portBlocks.size(); ++blockOffset)
+            {
+                auto& block = g_portBlocks[(firstBlock + blockOffset) % g_portBlocks.size()];
+                for (unsigned long scanned = 0; scanned < block.m_portCount; ++scanned)
+                {
+                    const auto cursor = ctl::ctMemoryGuardIncrement(&block.m_cursor);
+                    const auto index = block.m_firstIndex + static_cast<unsigned long>(cursor % block.m_portCount);
+                    const auto releaseTime = ctl::ctMemoryGuardRead(&g_portReleaseTimes[index]);
+                    if (c_portInUse == releaseTime)
+                    {
+                        continue;
+                    }
+                    if (0 == releaseTime || currentTime - releaseTime >= g_timeWaitMilliseconds)
+                    {
+                        // another socket may have taken the port since it was read
+                        if (releaseTime == ctl::ctMemoryGuardWriteConditionally(&g_portReleaseTimes[index], c_portInUse, releaseTime))
+                        {
+                            return static_cast<unsigned short>(ctsConfig::g_configSettings->LocalPortLow + index);
+                        }
+                    }
+                    else if (releaseTime < oldestReleaseTime)
+                    {
+                        oldestReleaseTime = releaseTime;
+                        oldestIndex = index;
+                    }
+                }
+            }
+
+            if (oldestReleaseTime != MAXLONGLONG)
+            {
+                // every port is in use or in TIME_WAIT : the port closed longest ago is the first to leave TIME_WAIT
+                ctl::ctMemoryGuardWrite(&g_portReleaseTimes[oldestIndex], c_portInUse);
+                PRINT_DEBUG_INFO(
+                    L"\t\tctsLocalPorts : all local ports are in use or in TIME_WAIT - reusing port %u closed %lld ms ago\n",
+                    ctsConfig::g_configSettings->LocalPortLow + oldestIndex, currentTime - oldestReleaseTime);
+                return static_cast<unsigned short>(ctsConfig::g_configSettings->LocalPortLow + oldestIndex);
+            }
+
+            // every port is bound to a socket : the range is too small for the connections, as before port tracking
+            const auto portCounter = ctl::ctMemoryGuardIncrement(&g_portCounter);
+            return static_cast<unsigned short>(ctsConfig::g_configSettings->LocalPortLow + portCounter % g_portReleaseTimes.size());
+        }
+
+        int AssociateReservation(SOCKET socket) noexcept
+        {
+            if (g_portReservations.empty())
+            {
+                return NO_ERROR;
+            }
+
+            auto& reservation = g_portReservations[CurrentProcessorIndex(g_portReservations.size())];
+            DWORD bytesReturned{};
+            if (0 != WSAIoctl(
+                socket,
+                SIO_ASSOCIATE_PORT_RESERVATION,
+                &reservation.m_token,
+                sizeof reservation.m_token,
+                nullptr,
+                0,
+                &bytesReturned,
+                nullptr,
+                nullptr))
+            {
+                return WSAGetLastError();
+            }
+            return NO_ERROR;
+        }
+
+        void Release(unsigned short port, bool enteredTimeWait) noexcept
+        {
+            if (g_portReleaseTimes.empty() ||
+                port < ctsConfig::g_configSettings->LocalPortLow ||
+                port > ctsConfig::g_configSettings->LocalPortHigh)
+            {
+                return;
+            }
+
+            // UDP ports never enter TIME_WAIT
+            const bool timeWait = enteredTimeWait && ctsConfig::ProtocolType::TCP == ctsConfig::g_configSettings->Protocol;
+            ctl::ctMemoryGuardWrite(
+                &g_portReleaseTimes[port - ctsConfig::g_configSettings->LocalPortLow],
+                timeWait ? ctl::ctTimer::SnapQpcInMillis() : 0LL);
+        }
+    }
+}
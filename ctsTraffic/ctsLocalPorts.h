@@ -0,0 +1,48 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+
+namespace ctsTraffic
+{
+    //
+    // Local ports for outgoing connections
+    // - a -LocalPort range is split into one block per processor: each port records when it was last closed,
+    //   so a port is only chosen again once TIME_WAIT (TcpTimedWaitDelay) has passed
+    // - -PortReservation acquires a runtime port reservation per processor (SIO_ACQUIRE_PORT_RESERVATION):
+    //   each socket is associated with its processor's reservation and bound to port zero, the stack choosing a free port from it
+    //
+    namespace ctsLocalPorts
+    {
+        // Splits the -LocalPort range into blocks or acquires the -PortReservation reservations
+        // - can throw std::bad_alloc or wil::ResultException, must be called before outgoing sockets are created
+        void Initialize();
+
+        // The local port to bind the next outgoing socket to : zero lets the stack choose
+        // - from a -LocalPort range, the next port out of TIME_WAIT within the current processor's block, then the other blocks,
+        //   else the port closed longest ago (bind retries while it's still in use)
+        unsigned short Acquire() noexcept;
+
+        // -PortReservation : associates the socket with the current processor's reservation before it's bound
+        // - returns the Winsock error, NO_ERROR without -PortReservation
+        int AssociateReservation(SOCKET socket) noexcept;
+
+        // Records that a port from the -LocalPort range was closed
+        // - enteredTimeWait is false when the connection was reset or never made: the port can be chosen again right away
+        void Release(unsigned short port, bool enteredTimeWait) noexcept;
+    }
+}
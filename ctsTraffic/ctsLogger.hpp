@@ -14,6 +14,10 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 // os headers
 #include <Windows.h>
 // wil headers
@@ -90,6 +94,12 @@ namespace ctsTraffic
             return ctsConfig::StatusFormatting::Csv == m_format;
         }
 
+        // loggers which can drop messages rather than block their callers report how many were dropped
+        [[nodiscard]] virtual unsigned long long GetDroppedMessageCount() const noexcept
+        {
+            return 0;
+        }
+
         // not copyable
         ctsLogger(const ctsLogger&) = delete;
         ctsLogger& operator=(const ctsLogger&) = delete;
@@ -104,33 +114,61 @@ namespace ctsTraffic
         virtual void LogErrorImpl(_In_ PCWSTR message) noexcept = 0;
     };
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Writes log messages to a file from a dedicated writer thread
+    /// - callers (often IO completion threads) copy the message into a bounded lock-free MPSC queue
+    ///   and return : they never wait on the disk
+    /// - the writer thread drains the queue in batches into large buffers, writing them with overlapped
+    ///   WriteFile calls so one buffer is filled while the other is being written
+    /// - if the queue is full the message is dropped and counted : memory is bounded by the queue depth
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
     class ctsTextLogger : public ctsLogger
     {
     public:
         ctsTextLogger(_In_ PCWSTR file_name, ctsConfig::StatusFormatting format) :
-            ctsLogger(format)
+            ctsLogger(format),
+            m_queue(std::make_unique<QueueEntry[]>(c_queueDepth))
         {
+            for (size_t entry = 0; entry < c_queueDepth; ++entry)
+            {
+                m_queue[entry].m_sequence.store(entry, std::memory_order_relaxed);
+            }
+
             m_fileHandle.reset(CreateFileW(
                 file_name,
                 GENERIC_WRITE,
                 FILE_SHARE_READ, // allow others to read the file while we write to it
                 nullptr,
                 CREATE_ALWAYS,
-                FILE_ATTRIBUTE_NORMAL,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
                 nullptr));
-            THROW_LAST_ERROR_IF_NULL(m_fileHandle.get());
+            THROW_LAST_ERROR_IF(!m_fileHandle);
+
+            for (auto& writeBuffer : m_writeBuffers)
+            {
+                writeBuffer.m_text.reserve(c_writeBufferLength);
+                writeBuffer.m_writeComplete.create(wil::EventOptions::ManualReset);
+                writeBuffer.m_overlapped.hEvent = writeBuffer.m_writeComplete.get();
+            }
 
-            // write the UTF16 Byte order mark
+            // the UTF16 Byte order mark is the first write
             constexpr WCHAR bom_utf16 = 0xFEFF;
-            DWORD bytesWritten{};
-            THROW_LAST_ERROR_IF(!WriteFile(
-                m_fileHandle.get(),
-                &bom_utf16,
-                static_cast<DWORD>(sizeof WCHAR),
-                &bytesWritten,
-                nullptr));
+            m_writeBuffers[0].m_text.push_back(bom_utf16);
+
+            m_wakeWriter.create(wil::EventOptions::None);
+            m_writerThread.reset(CreateThread(nullptr, 0, WriterThreadProc, this, 0, nullptr));
+            THROW_LAST_ERROR_IF(!m_writerThread);
+        }
+
+        // the writer thread drains all queued messages before exiting
+        ~ctsTextLogger() noexcept override
+        {
+            m_exitWriter.store(true, std::memory_order_release);
+            m_wakeWriter.SetEvent();
+            WaitForSingleObject(m_writerThread.get(), INFINITE);
         }
-        ~ctsTextLogger() noexcept override = default;
 
         void LogMessageImpl(_In_ PCWSTR message) noexcept override
         {
@@ -142,25 +180,199 @@ namespace ctsTraffic
             WriteImpl(message);
         }
 
+        [[nodiscard]] unsigned long long GetDroppedMessageCount() const noexcept override
+        {
+            return m_droppedMessages.load(std::memory_order_relaxed);
+        }
+
         ctsTextLogger(const ctsTextLogger&) = delete;
         ctsTextLogger& operator=(const ctsTextLogger&) = delete;
         ctsTextLogger(ctsTextLogger&&) = delete;
         ctsTextLogger& operator=(ctsTextLogger&&) = delete;
 
     private:
-        wil::critical_section m_fileLock{ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
+        // each entry's sequence tracks which lap of the ring it's ready for
+        // - sequence == position : free for the producer enqueuing at that position
+        // - sequence == position + 1 : holds the message for the writer to dequeue
+        // - the message capacity is reused as entries are recycled
+        struct QueueEntry
+        {
+            std::atomic<size_t> m_sequence{0};
+            std::wstring m_message;
+        };
+
+        struct WriteBuffer
+        {
+            std::vector<WCHAR> m_text;
+            OVERLAPPED m_overlapped{};
+            wil::unique_event m_writeComplete;
+            bool m_writePending = false;
+        };
+
+        // must be a power of 2
+        static constexpr size_t c_queueDepth = 8192;
+        // producers only wake the writer once this many messages are queued - otherwise it batches over the flush interval
+        static constexpr size_t c_wakeWriterDepth = c_queueDepth / 2;
+        static constexpr DWORD c_flushIntervalMilliseconds = 100;
+        static constexpr size_t c_writeBufferLength = 0x80000; // 1MB of WCHARs
+
+        const std::unique_ptr<QueueEntry[]> m_queue;
+        alignas(64) std::atomic<size_t> m_enqueuePosition{0};
+        // only the writer thread updates the dequeue position - producers read it to decide to wake the writer
+        alignas(64) std::atomic<size_t> m_dequeuePosition{0};
+        std::atomic<unsigned long long> m_droppedMessages{0};
+        std::atomic<bool> m_exitWriter{false};
+
+        // only accessed by the writer thread (and the c'tor before it's created)
         wil::unique_hfile m_fileHandle;
+        WriteBuffer m_writeBuffers[2];
+        unsigned long m_currentWriteBuffer = 0;
+        unsigned long long m_fileOffset = 0;
+
+        wil::unique_event m_wakeWriter;
+        wil::unique_handle m_writerThread;
 
         void WriteImpl(_In_ PCWSTR message) noexcept
         {
-            const auto lock = m_fileLock.lock();
-            DWORD bytesWritten{};
-            THROW_LAST_ERROR_IF(!WriteFile(
-                m_fileHandle.get(),
-                message,
-                static_cast<DWORD>(wcslen(message) * sizeof(WCHAR)),
-                &bytesWritten,
-                nullptr));
+            size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+            QueueEntry* entry = nullptr;
+            for (;;)
+            {
+                entry = &m_queue[position & (c_queueDepth - 1)];
+                const auto sequence = entry->m_sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (0 == difference)
+                {
+                    if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // the queue is full - the writer hasn't dequeued this entry from the prior lap
+                    m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+                    m_wakeWriter.SetEvent();
+                    return;
+                }
+                else
+                {
+                    position = m_enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            try
+            {
+                entry->m_message.assign(message);
+            }
+            catch (...)
+            {
+                // still must publish the entry so the writer can advance past it
+                entry->m_message.clear();
+                m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            }
+            entry->m_sequence.store(position + 1, std::memory_order_release);
+
+            if (position - m_dequeuePosition.load(std::memory_order_relaxed) >= c_wakeWriterDepth)
+            {
+                m_wakeWriter.SetEvent();
+            }
+        }
+
+        static DWORD WINAPI WriterThreadProc(LPVOID pContext) noexcept
+        {
+            auto* pThis = static_cast<ctsTextLogger*>(pContext);
+            for (;;)
+            {
+                WaitForSingleObject(pThis->m_wakeWriter.get(), c_flushIntervalMilliseconds);
+                const bool exiting = pThis->m_exitWriter.load(std::memory_order_acquire);
+
+                pThis->DrainQueue();
+                pThis->WriteCurrentBuffer();
+
+                if (exiting)
+                {
+                    for (auto& writeBuffer : pThis->m_writeBuffers)
+                    {
+                        pThis->WaitForWrite(writeBuffer);
+                    }
+                    return 0;
+                }
+            }
+        }
+
+        void DrainQueue() noexcept
+        {
+            auto position = m_dequeuePosition.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                auto& entry = m_queue[position & (c_queueDepth - 1)];
+                if (entry.m_sequence.load(std::memory_order_acquire) != position + 1)
+                {
+                    break;
+                }
+
+                auto* currentBuffer = &m_writeBuffers[m_currentWriteBuffer];
+                if (currentBuffer->m_text.size() + entry.m_message.size() > c_writeBufferLength)
+                {
+                    WriteCurrentBuffer();
+                    currentBuffer = &m_writeBuffers[m_currentWriteBuffer];
+                }
+                // a single message larger than the buffer will grow it: a rare, one-time allocation
+                try
+                {
+                    currentBuffer->m_text.insert(currentBuffer->m_text.end(), entry.m_message.begin(), entry.m_message.end());
+                }
+                catch (...)
+                {
+                    m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                // free the entry for the producer on the next lap of the ring
+                entry.m_sequence.store(position + c_queueDepth, std::memory_order_release);
+                ++position;
+                m_dequeuePosition.store(position, std::memory_order_relaxed);
+            }
+        }
+
+        // issues the overlapped write of the current buffer, then switches to the other buffer
+        // - after waiting for that buffer's prior write to complete
+        void WriteCurrentBuffer() noexcept
+        {
+            auto& writeBuffer = m_writeBuffers[m_currentWriteBuffer];
+            if (writeBuffer.m_text.empty())
+            {
+                return;
+            }
+
+            const auto bytesToWrite = static_cast<DWORD>(writeBuffer.m_text.size() * sizeof(WCHAR));
+            writeBuffer.m_overlapped.Offset = static_cast<DWORD>(m_fileOffset);
+            writeBuffer.m_overlapped.OffsetHigh = static_cast<DWORD>(m_fileOffset >> 32);
+            if (!WriteFile(m_fileHandle.get(), writeBuffer.m_text.data(), bytesToWrite, nullptr, &writeBuffer.m_overlapped))
+            {
+                const auto gle = GetLastError();
+                FAIL_FAST_IF_MSG(
+                    gle != ERROR_IO_PENDING,
+                    "WriteFile failed [%u] writing %u bytes to the log file", gle, bytesToWrite);
+            }
+            writeBuffer.m_writePending = true;
+            m_fileOffset += bytesToWrite;
+
+            m_currentWriteBuffer = (m_currentWriteBuffer + 1) % 2;
+            WaitForWrite(m_writeBuffers[m_currentWriteBuffer]);
+        }
+
+        void WaitForWrite(WriteBuffer& writeBuffer) const noexcept
+        {
+            if (writeBuffer.m_writePending)
+            {
+                DWORD bytesWritten{};
+                FAIL_FAST_IF_MSG(
+                    !GetOverlappedResult(m_fileHandle.get(), &writeBuffer.m_overlapped, &bytesWritten, TRUE),
+                    "WriteFile failed [%u] writing to the log file", GetLastError());
+                writeBuffer.m_writePending = false;
+            }
+            writeBuffer.m_text.clear();
         }
     };
 
@@ -24,6 +24,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // project headers
 #include "ctsMediaStreamProtocol.hpp"
 #include "ctsMediaStreamClient.h"
+#include "ctsMediaStreamClientMultiplexedSocket.h"
 #include "ctsWinsockLayer.h"
 #include "ctsIOTask.hpp"
 #include "ctsIOPattern.h"
@@ -62,6 +63,44 @@ namespace ctsTraffic
         const ctl::ctSockaddr& targetAddress
     ) noexcept;
 
+    void ctsMediaStreamClientMultiplexedCompletionCallback(
+        const std::weak_ptr<ctsSocket>& weakSocket,
+        const ctsTask& task,
+        unsigned long bytesTransferred,
+        int error
+    ) noexcept;
+
+    void ctsMediaStreamClientMultiplexedConnectionCompletionCallback(
+        const std::weak_ptr<ctsSocket>& weakSocket,
+        int error
+    ) noexcept;
+
+    void ctsMediaStreamClientCompleteIo(
+        const std::shared_ptr<ctsSocket>& sharedSocket,
+        SOCKET socket,
+        const std::shared_ptr<ctsIoPattern>& lockedPattern,
+        const ctsTask& task,
+        DWORD transferred,
+        int gle
+    ) noexcept;
+
+    // closes the stream's socket - or with -MultiplexStreams:on removes the stream from the socket it shares,
+    // aborting its pended receives (as closing its own socket would)
+    static void ctsMediaStreamClientCloseStream(const std::shared_ptr<ctsSocket>& sharedSocket) noexcept
+    {
+        sharedSocket->CloseSocket();
+        if (ctsConfig::g_configSettings->MultiplexMediaStreams)
+        {
+            ctsMediaStreamClientMultiplexer::RemoveStream(*sharedSocket);
+        }
+    }
+
+    // multiplexed streams have no socket of their own : they are closed once removed from their shared socket
+    static bool ctsMediaStreamClientIsClosed(const ctsSocket::SocketReference& lockedSocket) noexcept
+    {
+        return lockedSocket.GetSocket() == INVALID_SOCKET && !ctsConfig::g_configSettings->MultiplexMediaStreams;
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///
     /// The function that is registered with ctsTraffic to run Winsock IO using IO Completion Ports
@@ -80,7 +119,7 @@ namespace ctsTraffic
         // hold a reference on the socket
         const auto lockedSocket = sharedSocket->AcquireSocketLock();
         auto lockedPattern = lockedSocket.GetPattern();
-        if (!lockedPattern || lockedSocket.GetSocket() == INVALID_SOCKET)
+        if (!lockedPattern || ctsMediaStreamClientIsClosed(lockedSocket))
         {
             return;
         }
@@ -99,7 +138,7 @@ namespace ctsTraffic
                 // hold a reference on the socket
                 const auto lambdaLockedSocket = lambdaSharedSocket->AcquireSocketLock();
                 const auto lambdaLockedPattern = lambdaLockedSocket.GetPattern();
-                if (!lambdaLockedPattern || lambdaLockedSocket.GetSocket() == INVALID_SOCKET)
+                if (!lambdaLockedPattern || ctsMediaStreamClientIsClosed(lambdaLockedSocket))
                 {
                     return;
                 }
@@ -219,6 +258,101 @@ namespace ctsTraffic
         }
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// The function that is registered with ctsTraffic to 'connect' to the target server with -MultiplexStreams:on
+    /// - adds the stream to the socket it shares with other streams to the target, then sends START with its stream ID
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsMediaStreamClientMultiplexedConnect(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        // attempt to get a reference to the socket
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        int error = NO_ERROR;
+        try
+        {
+            sharedSocket->GenerateMultiplexedStreamId();
+            const auto streamId = ctsMediaStreamClientMultiplexer::GetStreamId(*sharedSocket);
+            const auto multiplexedSocket = ctsMediaStreamClientMultiplexer::AddStream(
+                sharedSocket->GetLocalSockaddr(),
+                sharedSocket->GetRemoteSockaddr(),
+                streamId);
+            // every stream reports the address of the socket it shares as its local address
+            sharedSocket->SetLocalSockaddr(multiplexedSocket->GetLocalAddress());
+
+            error = multiplexedSocket->SendStart(
+                streamId,
+                [weakSocket](unsigned long, int sendError) noexcept {
+                    ctsMediaStreamClientMultiplexedConnectionCompletionCallback(weakSocket, sendError);
+                });
+            if (WSA_IO_PENDING == error)
+            {
+                PRINT_DEBUG_INFO(
+                    L"\t\tctsMediaStreamClient sent its START message for stream %hs to %ws\n",
+                    streamId.data(),
+                    sharedSocket->GetRemoteSockaddr().WriteCompleteAddress().c_str());
+                // will complete in the callback
+                return;
+            }
+        }
+        catch (...)
+        {
+            error = static_cast<int>(ctsConfig::PrintThrownException());
+        }
+
+        ctsConfig::PrintErrorIfFailed("\tWSASendTo (START request)", error);
+        sharedSocket->CompleteState(error);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// The function that is registered with ctsTraffic to remove a closing stream from its shared socket
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsMediaStreamClientMultiplexedClose(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        const auto sharedSocket(weakSocket.lock());
+        if (sharedSocket)
+        {
+            ctsMediaStreamClientMultiplexer::RemoveStream(*sharedSocket);
+        }
+    }
+
+    // -MultiplexStreams:on : the stream's IO is posted to the socket it shares
+    // - START is the only datagram the client pattern sends, which is resent with the stream's ID
+    static wsIOResult ctsMediaStreamClientMultiplexedIo(const std::shared_ptr<ctsSocket>& sharedSocket, const ctsTask& task) noexcept
+    {
+        const auto multiplexedSocket = ctsMediaStreamClientMultiplexer::FindSocket(*sharedSocket);
+        if (!multiplexedSocket)
+        {
+            return wsIOResult(WSAECONNABORTED);
+        }
+
+        try
+        {
+            const auto streamId = ctsMediaStreamClientMultiplexer::GetStreamId(*sharedSocket);
+            ctsMediaStreamMultiplexedCallback callback(
+                [weak_reference = std::weak_ptr<ctsSocket>(sharedSocket), task](unsigned long bytesTransferred, int error) noexcept {
+                    ctsMediaStreamClientMultiplexedCompletionCallback(weak_reference, task, bytesTransferred, error);
+                });
+
+            if (ctsTaskAction::Send == task.m_ioAction)
+            {
+                return wsIOResult(multiplexedSocket->SendStart(streamId, std::move(callback)));
+            }
+            return multiplexedSocket->PostRecv(streamId, task, std::move(callback));
+        }
+        catch (...)
+        {
+            return wsIOResult(static_cast<int>(ctsConfig::PrintThrownException()));
+        }
+    }
+
     IoImplStatus ctsMediaStreamClientIoImpl(const std::shared_ptr<ctsSocket>& sharedSocket, SOCKET socket, const std::shared_ptr<ctsIoPattern>& lockedPattern, const ctsTask& task) noexcept
     {
         IoImplStatus returnStatus;
@@ -236,11 +370,37 @@ namespace ctsTraffic
 
                 PCSTR functionName{};
                 wsIOResult result;
-                if (ctsTaskAction::Send == task.m_ioAction)
+                // the coalesced datagram length and receive timestamp are only known once the receive completes
+                ctsTask completedTask(task);
+                if (ctsConfig::g_configSettings->MultiplexMediaStreams)
+                {
+                    functionName = ctsTaskAction::Send == task.m_ioAction ? "WSASendTo" : "WSARecvFrom";
+                    result = ctsMediaStreamClientMultiplexedIo(sharedSocket, task);
+                }
+                else if (ctsTaskAction::Send == task.m_ioAction)
                 {
                     functionName = "WSASendTo";
                     result = ctsWSASendTo(sharedSocket, socket, task, std::move(callback));
                 }
+                else if (ctsTaskAction::Recv == task.m_ioAction &&
+                    (ctsConfig::g_configSettings->UdpRecvOffload || ctsConfig::g_configSettings->UdpRecvTimestamps))
+                {
+                    functionName = "WSARecvMsg";
+                    ctsRecvMsgInfo recvMsgInfo;
+                    result = ctsWSARecvMsg(
+                        sharedSocket,
+                        socket,
+                        task,
+                        [weak_reference = std::weak_ptr<ctsSocket>(sharedSocket), task](OVERLAPPED* ov, const ctsRecvMsgInfo& completedRecvMsgInfo) noexcept {
+                            ctsTask completedRecvTask(task);
+                            completedRecvTask.m_coalescedSegmentSize = completedRecvMsgInfo.m_coalescedSegmentSize;
+                            completedRecvTask.m_receiveTimestampQpc = completedRecvMsgInfo.m_receiveTimestamp;
+                            ctsMediaStreamClientIoCompletionCallback(ov, weak_reference, completedRecvTask);
+                        },
+                        &recvMsgInfo);
+                    completedTask.m_coalescedSegmentSize = recvMsgInfo.m_coalescedSegmentSize;
+                    completedTask.m_receiveTimestampQpc = recvMsgInfo.m_receiveTimestamp;
+                }
                 else if (ctsTaskAction::Recv == task.m_ioAction)
                 {
                     functionName = "WSARecvFrom";
@@ -264,8 +424,16 @@ namespace ctsTraffic
                     // - or the IO failed
                     if (result.m_errorCode != 0) PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%d) [ctsMediaStreamClient]\n", functionName, result.m_errorCode);
 
+                    if (WSAEMSGSIZE == result.m_errorCode)
+                    {
+                        // as in the completion callback: pass the truncated datagram to the protocol to track it
+                        ctsConfig::PrintErrorInfo(L"MediaStream Client: %hs failed with WSAEMSGSIZE: received [%u bytes] - expected [%u bytes]",
+                            functionName, result.m_bytesTransferred, task.m_bufferLength);
+                        result.m_errorCode = NO_ERROR;
+                    }
+
                     const auto protocolStatus = lockedPattern->CompleteIo(
-                        task,
+                        completedTask,
                         result.m_bytesTransferred,
                         result.m_errorCode);
 
@@ -279,7 +447,7 @@ namespace ctsTraffic
 
                         case ctsIoStatus::CompletedIo:
                             // the protocol wants to ignore the error but is done with IO
-                            sharedSocket->CloseSocket();
+                            ctsMediaStreamClientCloseStream(sharedSocket);
                             returnStatus.m_errorCode = NO_ERROR;
                             returnStatus.m_continueIo = false;
                             break;
@@ -288,7 +456,7 @@ namespace ctsTraffic
                             // write out the error
                             ctsConfig::PrintErrorIfFailed(functionName, result.m_errorCode);
                             // the protocol acknoledged the failure - socket is done with IO
-                            sharedSocket->CloseSocket();
+                            ctsMediaStreamClientCloseStream(sharedSocket);
                             returnStatus.m_errorCode = static_cast<int>(lockedPattern->GetLastPatternError());
                             returnStatus.m_continueIo = false;
                             break;
@@ -321,7 +489,7 @@ namespace ctsTraffic
             {
                 // the protocol signaled to immediately stop the stream
                 lockedPattern->CompleteIo(task, 0, 0);
-                sharedSocket->CloseSocket();
+                ctsMediaStreamClientCloseStream(sharedSocket);
 
                 returnStatus.m_errorCode = NO_ERROR;
                 returnStatus.m_continueIo = false;
@@ -332,7 +500,7 @@ namespace ctsTraffic
             {
                 // the protocol indicated to rudely abort the connection
                 lockedPattern->CompleteIo(task, 0, 0);
-                sharedSocket->CloseSocket();
+                ctsMediaStreamClientCloseStream(sharedSocket);
 
                 returnStatus.m_errorCode = static_cast<int>(lockedPattern->GetLastPatternError());
                 returnStatus.m_continueIo = false;
@@ -396,6 +564,60 @@ namespace ctsTraffic
             }
         }
 
+        ctsMediaStreamClientCompleteIo(sharedSocket, socket, lockedPattern, task, transferred, gle);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Completion callback for IO posted to a socket shared by multiplexed streams
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsMediaStreamClientMultiplexedCompletionCallback(
+        const std::weak_ptr<ctsSocket>& weakSocket,
+        const ctsTask& task,
+        unsigned long bytesTransferred,
+        int error) noexcept
+    {
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        // hold a reference on the socket
+        const auto lockedSocket = sharedSocket->AcquireSocketLock();
+        auto lockedPattern = lockedSocket.GetPattern();
+        if (!lockedPattern)
+        {
+            sharedSocket->DecrementIo();
+            sharedSocket->CompleteState(WSAECONNABORTED);
+            return;
+        }
+
+        if (WSA_OPERATION_ABORTED == error)
+        {
+            // we're intentionally ignoring the error when the stream was removed early
+            // - as when closing a socket of its own after processing all frames
+            error = NO_ERROR;
+        }
+
+        ctsMediaStreamClientCompleteIo(sharedSocket, lockedSocket.GetSocket(), lockedPattern, task, bytesTransferred, error);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Processes a completed IO: hands it to the protocol, then continues IO or completes the state
+    /// - invoked while holding the socket lock
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsMediaStreamClientCompleteIo(
+        const std::shared_ptr<ctsSocket>& sharedSocket,
+        SOCKET socket,
+        const std::shared_ptr<ctsIoPattern>& lockedPattern,
+        const ctsTask& task,
+        DWORD transferred,
+        int gle) noexcept
+    {
         if (gle == WSAEMSGSIZE)
         {
             // something truncated the datagram - don't treat it as a hard-error
@@ -416,7 +638,7 @@ namespace ctsTraffic
                 do
                 {
                     // invoke the new IO call while holding a refcount to the prior IO in a tight loop
-                    status = ctsMediaStreamClientIoImpl(sharedSocket, lockedSocket.GetSocket(), lockedPattern, lockedPattern->InitiateIo());
+                    status = ctsMediaStreamClientIoImpl(sharedSocket, socket, lockedPattern, lockedPattern->InitiateIo());
                 }
                 while (status.m_continueIo);
 
@@ -425,7 +647,7 @@ namespace ctsTraffic
             }
 
             case ctsIoStatus::CompletedIo:
-                sharedSocket->CloseSocket();
+                ctsMediaStreamClientCloseStream(sharedSocket);
                 gle = NO_ERROR;
                 break;
 
@@ -445,7 +667,7 @@ namespace ctsTraffic
                         lockedPattern->GetLastPatternError());
                 }
 
-                sharedSocket->CloseSocket();
+                ctsMediaStreamClientCloseStream(sharedSocket);
                 gle = static_cast<int>(lockedPattern->GetLastPatternError());
                 break;
 
@@ -514,4 +736,30 @@ namespace ctsTraffic
         sharedSocket->CompleteState(gle);
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Completion callback for the 'connect' request of a multiplexed stream
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsMediaStreamClientMultiplexedConnectionCompletionCallback(
+        const std::weak_ptr<ctsSocket>& weakSocket,
+        int error) noexcept
+    {
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        ctsConfig::PrintErrorIfFailed("\tWSASendTo (START request)", error);
+
+        if (NO_ERROR == error)
+        {
+            // the local and remote addresses were set before sending START
+            ctsConfig::PrintNewConnection(sharedSocket->GetLocalSockaddr(), sharedSocket->GetRemoteSockaddr());
+        }
+
+        sharedSocket->CompleteState(error);
+    }
+
 } // namespace
\ No newline at end of file
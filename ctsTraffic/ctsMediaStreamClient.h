@@ -25,4 +25,11 @@ namespace ctsTraffic
 
     // The function that is registered to 'connect' to the target server by sending a START command using IO Completion Ports
     void ctsMediaStreamClientConnect(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+
+    // -MultiplexStreams:on : the 'connect' function adding the stream to a UDP socket shared with other streams to the target
+    // - then sending START with the stream's ID
+    void ctsMediaStreamClientMultiplexedConnect(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+
+    // -MultiplexStreams:on : the 'closing' function removing the stream from its shared socket
+    void ctsMediaStreamClientMultiplexedClose(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
 } // namespace
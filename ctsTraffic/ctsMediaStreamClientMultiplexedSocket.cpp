@@ -0,0 +1,496 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// cpp headers
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include <ctSockaddr.hpp>
+#include <ctThreadIocp.hpp>
+// project headers
+#include "ctsMediaStreamClientMultiplexedSocket.h"
+#include "ctsMediaStreamProtocol.hpp"
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    ctsMediaStreamClientMultiplexedSocket::ctsMediaStreamClientMultiplexedSocket(const ctl::ctSockaddr& localAddr, const ctl::ctSockaddr& targetAddr) :
+        m_targetAddr(targetAddr)
+    {
+        FAIL_FAST_IF_MSG(
+            !!(ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp),
+            "ctsMediaStream sockets must not have HANDLE_INLINE_IOCP set on its datagram sockets");
+
+        wil::unique_socket socket(ctsConfig::CreateSocket(localAddr.family(), SOCK_DGRAM, IPPROTO_UDP, ctsConfig::g_configSettings->SocketFlags));
+
+        auto error = ctsConfig::SetPreBindOptions(socket.get(), localAddr);
+        if (error != NO_ERROR)
+        {
+            THROW_WIN32_MSG(error, "SetPreBindOptions (ctsMediaStreamClientMultiplexedSocket)");
+        }
+
+        if (SOCKET_ERROR == bind(socket.get(), localAddr.sockaddr(), localAddr.length()))
+        {
+            THROW_WIN32_MSG(WSAGetLastError(), "bind (ctsMediaStreamClientMultiplexedSocket)");
+        }
+
+        error = ctsConfig::SetPreConnectOptions(socket.get());
+        if (error != NO_ERROR)
+        {
+            THROW_WIN32_MSG(error, "SetPreConnectOptions (ctsMediaStreamClientMultiplexedSocket)");
+        }
+
+        // every stream sharing this socket reports the port it was assigned as its local address
+        auto localAddrLen = m_localAddr.length();
+        if (0 != getsockname(socket.get(), m_localAddr.sockaddr(), &localAddrLen))
+        {
+            THROW_WIN32_MSG(WSAGetLastError(), "getsockname (ctsMediaStreamClientMultiplexedSocket)");
+        }
+
+        m_threadIocp = ctsConfig::CreateSocketThreadIocp(socket.get());
+        m_socket = std::move(socket);
+
+        PRINT_DEBUG_INFO(
+            L"\t\tctsMediaStreamClientMultiplexedSocket - multiplexing streams to %ws over %ws (%Iu)\n",
+            m_targetAddr.WriteCompleteAddress().c_str(),
+            m_localAddr.WriteCompleteAddress().c_str(),
+            m_socket.get());
+
+        for (auto& recvContext : m_recvContexts)
+        {
+            InitiateRecv(recvContext);
+        }
+    }
+
+    ctsMediaStreamClientMultiplexedSocket::~ctsMediaStreamClientMultiplexedSocket() noexcept
+    {
+        // close the socket, then end the TP
+        {
+            const auto lock = m_lock.lock();
+            m_socket.reset();
+        }
+        m_threadIocp.reset();
+    }
+
+    void ctsMediaStreamClientMultiplexedSocket::AddStream(const ctsMediaStreamId& streamId)
+    {
+        const auto lock = m_lock.lock();
+        m_streams.try_emplace(streamId);
+    }
+
+    void ctsMediaStreamClientMultiplexedSocket::RemoveStream(const ctsMediaStreamId& streamId) noexcept
+    {
+        // the callbacks are invoked outside the lock, as they will call back into this object
+        std::deque<PendingRecv> abortedRecvs;
+        {
+            const auto lock = m_lock.lock();
+            const auto foundStream = m_streams.find(streamId);
+            if (foundStream == m_streams.end())
+            {
+                return;
+            }
+
+            abortedRecvs = std::move(foundStream->second.m_pendingRecvs);
+            m_streams.erase(foundStream);
+        }
+
+        for (auto& abortedRecv : abortedRecvs)
+        {
+            abortedRecv.m_callback(0, WSA_OPERATION_ABORTED);
+        }
+    }
+
+    int ctsMediaStreamClientMultiplexedSocket::SendStart(const ctsMediaStreamId& streamId, ctsMediaStreamMultiplexedCallback&& callback) noexcept
+    {
+        try
+        {
+            // the START must remain valid until the send completes
+            const auto startBuffer = std::make_shared<std::array<char, c_udpDatagramMultiplexedStartLength>>();
+            const ctsTask startTask = ctsMediaStreamMessage::ConstructMultiplexedStart(startBuffer->data(), streamId.data());
+
+            const auto lock = m_lock.lock();
+            if (!m_socket)
+            {
+                return WSAECONNABORTED;
+            }
+
+            OVERLAPPED* pOverlapped = m_threadIocp->new_request(
+                [this, startBuffer, callback = std::move(callback)](OVERLAPPED* pCallbackOverlapped) noexcept {
+                    DWORD bytesSent{};
+                    DWORD flags{};
+                    int error = NO_ERROR;
+                    {
+                        const auto callbackLock = m_lock.lock();
+                        if (!m_socket)
+                        {
+                            error = WSAECONNABORTED;
+                        }
+                        else if (!WSAGetOverlappedResult(m_socket.get(), pCallbackOverlapped, &bytesSent, FALSE, &flags))
+                        {
+                            error = WSAGetLastError();
+                        }
+                    }
+                    // the stream ID is not part of the START sent on a stream's own socket
+                    callback(NO_ERROR == error ? c_udpDatagramStartStringLength : 0, error);
+                });
+
+            WSABUF wsabuffer;
+            wsabuffer.buf = startTask.m_buffer;
+            wsabuffer.len = startTask.m_bufferLength;
+            if (WSASendTo(m_socket.get(), &wsabuffer, 1, nullptr, 0, m_targetAddr.sockaddr(), m_targetAddr.length(), pOverlapped, nullptr) != 0)
+            {
+                const auto error = WSAGetLastError();
+                if (error != WSA_IO_PENDING)
+                {
+                    m_threadIocp->cancel_request(pOverlapped);
+                    return error;
+                }
+            }
+
+            // without FILE_SKIP_COMPLETION_PORT_ON_SUCCESS, sends completed inline are still queued to the IOCP
+            return WSA_IO_PENDING;
+        }
+        catch (...)
+        {
+            return static_cast<int>(ctsConfig::PrintThrownException());
+        }
+    }
+
+    wsIOResult ctsMediaStreamClientMultiplexedSocket::PostRecv(const ctsMediaStreamId& streamId, const ctsTask& task, ctsMediaStreamMultiplexedCallback&& callback) noexcept
+    {
+        try
+        {
+            std::vector<char> queuedDatagram;
+            {
+                const auto lock = m_lock.lock();
+                const auto foundStream = m_streams.find(streamId);
+                if (foundStream == m_streams.end())
+                {
+                    return wsIOResult(WSAECONNABORTED);
+                }
+
+                auto& stream = foundStream->second;
+                if (stream.m_queuedDatagrams.empty())
+                {
+                    stream.m_pendingRecvs.push_back({task, std::move(callback)});
+                    return wsIOResult(WSA_IO_PENDING);
+                }
+
+                queuedDatagram = std::move(stream.m_queuedDatagrams.front());
+                stream.m_queuedDatagrams.pop_front();
+            }
+
+            return DeliverDatagram(task, queuedDatagram.data(), static_cast<unsigned long>(queuedDatagram.size()));
+        }
+        catch (...)
+        {
+            return wsIOResult(static_cast<int>(ctsConfig::PrintThrownException()));
+        }
+    }
+
+    wsIOResult ctsMediaStreamClientMultiplexedSocket::DeliverDatagram(const ctsTask& task, _In_reads_bytes_(payloadLength) const char* payload, unsigned long payloadLength) noexcept
+    {
+        wsIOResult returnResult;
+        returnResult.m_bytesTransferred = payloadLength;
+        if (payloadLength > task.m_bufferLength)
+        {
+            // truncated, as receiving into a buffer too small for the datagram
+            returnResult.m_errorCode = WSAEMSGSIZE;
+            returnResult.m_bytesTransferred = task.m_bufferLength;
+        }
+
+        memcpy(task.m_buffer + task.m_bufferOffset, payload, returnResult.m_bytesTransferred);
+        return returnResult;
+    }
+
+    void ctsMediaStreamClientMultiplexedSocket::InitiateRecv(RecvContext& recvContext) noexcept
+    {
+        // continue to try to post a recv if the call fails
+        int error = SOCKET_ERROR;
+        unsigned long failureCounter = 0;
+        while (error != NO_ERROR)
+        {
+            try
+            {
+                const auto lock = m_lock.lock();
+                if (!m_socket)
+                {
+                    // if we no longer have a socket exit the loop
+                    break;
+                }
+
+                WSABUF wsabuffer;
+                wsabuffer.buf = recvContext.m_buffer.data();
+                wsabuffer.len = static_cast<ULONG>(recvContext.m_buffer.size());
+
+                recvContext.m_flags = 0;
+                recvContext.m_remoteAddr.set(m_targetAddr.family(), ctl::ctSockaddr::AddressType::Any);
+                recvContext.m_remoteAddrLen = recvContext.m_remoteAddr.length();
+                OVERLAPPED* pOverlapped = m_threadIocp->new_request(
+                    [this, &recvContext](OVERLAPPED* pCallbackOverlapped) noexcept {
+                        RecvCompletion(recvContext, pCallbackOverlapped); });
+
+                error = WSARecvFrom(
+                    m_socket.get(),
+                    &wsabuffer,
+                    1,
+                    nullptr,
+                    &recvContext.m_flags,
+                    recvContext.m_remoteAddr.sockaddr(),
+                    &recvContext.m_remoteAddrLen,
+                    pOverlapped,
+                    nullptr);
+                if (SOCKET_ERROR == error)
+                {
+                    error = WSAGetLastError();
+                    if (WSA_IO_PENDING == error)
+                    {
+                        // pending is not an error
+                        error = NO_ERROR;
+                    }
+                    else
+                    {
+                        m_threadIocp->cancel_request(pOverlapped);
+                    }
+                }
+                else
+                {
+                    error = NO_ERROR;
+                }
+            }
+            catch (...)
+            {
+                error = ctsConfig::PrintThrownException();
+            }
+
+            // a prior WSASendTo from this socket silently failed with port unreachable : just try again
+            if (error != NO_ERROR && error != WSAECONNRESET)
+            {
+                ctsConfig::g_configSettings->UdpStatusDetails.m_errorFrames.Increment();
+                ++failureCounter;
+
+                ctsConfig::PrintErrorInfo(
+                    L"MediaStream Client : WSARecvFrom failed (%d) %u times in a row trying to get another recv posted on a multiplexed socket",
+                    error, failureCounter);
+
+                FAIL_FAST_IF_MSG(
+                    0 == failureCounter % 10,
+                    "ctsMediaStreamClientMultiplexedSocket has failed to post another recv - it cannot receive any more datagrams for its streams");
+
+                Sleep(10);
+            }
+        }
+    }
+
+    void ctsMediaStreamClientMultiplexedSocket::RecvCompletion(RecvContext& recvContext, OVERLAPPED* pOverlapped) noexcept
+    {
+        // the stream's callback is invoked outside the lock, as it will post its next receive
+        PendingRecv completedRecv;
+        wsIOResult completedResult;
+        {
+            const auto lock = m_lock.lock();
+            if (!m_socket)
+            {
+                // the socket was closed - just exit
+                return;
+            }
+
+            DWORD bytesReceived{};
+            if (!WSAGetOverlappedResult(m_socket.get(), pOverlapped, &bytesReceived, FALSE, &recvContext.m_flags))
+            {
+                const auto gle = WSAGetLastError();
+                if (WSAECONNRESET == gle)
+                {
+                    if (!m_priorFailureWasConnectionReset)
+                    {
+                        ctsConfig::PrintErrorInfo(L"ctsMediaStreamClient - WSARecvFrom failed on a multiplexed socket as a prior WSASendTo from this socket silently failed with port unreachable");
+                    }
+                    m_priorFailureWasConnectionReset = true;
+                }
+                else
+                {
+                    ctsConfig::PrintErrorInfo(L"ctsMediaStreamClient - WSARecvFrom failed on a multiplexed socket [%d]", gle);
+                    ctsConfig::g_configSettings->UdpStatusDetails.m_errorFrames.Increment();
+                    m_priorFailureWasConnectionReset = false;
+                }
+            }
+            else
+            {
+                m_priorFailureWasConnectionReset = false;
+
+                const char* datagram = recvContext.m_buffer.data();
+                if (bytesReceived < c_udpDatagramMultiplexedHeaderLength ||
+                    *reinterpret_cast<const unsigned short*>(datagram) != c_udpDatagramProtocolHeaderFlagMultiplexed ||
+                    datagram[c_udpDatagramMultiplexedHeaderLength - 1] != '\0')
+                {
+                    ctsConfig::PrintErrorInfo(
+                        L"ctsMediaStreamClient - rejecting a datagram of %u bytes from %ws without a multiplexed stream header",
+                        bytesReceived,
+                        recvContext.m_remoteAddr.WriteCompleteAddress().c_str());
+                    ctsConfig::g_configSettings->UdpStatusDetails.m_errorFrames.Increment();
+                }
+                else
+                {
+                    ctsMediaStreamId streamId;
+                    memcpy(streamId.data(), datagram + c_udpDatagramProtocolHeaderFlagLength, streamId.size());
+                    const char* payload = datagram + c_udpDatagramMultiplexedHeaderLength;
+                    const unsigned long payloadLength = bytesReceived - c_udpDatagramMultiplexedHeaderLength;
+
+                    const auto foundStream = m_streams.find(streamId);
+                    if (foundStream == m_streams.end())
+                    {
+                        // the stream has already completed : as datagrams arriving after its socket was closed
+                        PRINT_DEBUG_INFO(L"\t\tctsMediaStreamClientMultiplexedSocket - dropping a datagram for stream %hs no longer receiving\n", streamId.data());
+                    }
+                    else if (foundStream->second.m_pendingRecvs.empty())
+                    {
+                        auto& queuedDatagrams = foundStream->second.m_queuedDatagrams;
+                        if (queuedDatagrams.size() < c_queuedDatagramLimit)
+                        {
+                            try
+                            {
+                                queuedDatagrams.emplace_back(payload, payload + payloadLength);
+                            }
+                            catch (...)
+                            {
+                                ctsConfig::PrintThrownException();
+                            }
+                        }
+                        // else dropped, as a socket's receive buffer overflowing
+                    }
+                    else
+                    {
+                        completedRecv = std::move(foundStream->second.m_pendingRecvs.front());
+                        foundStream->second.m_pendingRecvs.pop_front();
+                        completedResult = DeliverDatagram(completedRecv.m_task, payload, payloadLength);
+                    }
+                }
+            }
+        }
+
+        // post another recv before handing the datagram to the stream
+        InitiateRecv(recvContext);
+
+        if (completedRecv.m_callback)
+        {
+            completedRecv.m_callback(completedResult.m_bytesTransferred, completedResult.m_errorCode);
+        }
+    }
+
+    namespace ctsMediaStreamClientMultiplexer
+    {
+        // the shared sockets bound to a local address carrying streams to one target
+        struct TargetSockets
+        {
+            ctl::ctSockaddr m_bindAddr;
+            ctl::ctSockaddr m_targetAddr;
+            std::vector<std::shared_ptr<ctsMediaStreamClientMultiplexedSocket>> m_sockets;
+        };
+
+        wil::srwlock g_targetSocketsGuard;  // NOLINT(cppcoreguidelines-interfaces-global-init, clang-diagnostic-exit-time-destructors)
+        _Guarded_by_(g_targetSocketsGuard) std::vector<TargetSockets> g_targetSockets;  // NOLINT(clang-diagnostic-exit-time-destructors)
+
+        static size_t SocketIndex(const ctsMediaStreamId& streamId, size_t socketCount) noexcept
+        {
+            return std::hash<std::string_view>{}(std::string_view(streamId.data())) % socketCount;
+        }
+
+        std::shared_ptr<ctsMediaStreamClientMultiplexedSocket> AddStream(
+            const ctl::ctSockaddr& localAddr,
+            const ctl::ctSockaddr& targetAddr,
+            const ctsMediaStreamId& streamId)
+        {
+            std::shared_ptr<ctsMediaStreamClientMultiplexedSocket> sharedSocket;
+            {
+                const auto lock = g_targetSocketsGuard.lock_exclusive();
+                auto foundTarget = std::find_if(
+                    g_targetSockets.begin(),
+                    g_targetSockets.end(),
+                    [&](const TargetSockets& targetSockets) noexcept {
+                        return targetSockets.m_bindAddr == localAddr && targetSockets.m_targetAddr == targetAddr;
+                    });
+                if (foundTarget == g_targetSockets.end())
+                {
+                    SYSTEM_INFO systemInfo;
+                    GetSystemInfo(&systemInfo);
+
+                    TargetSockets newTarget{localAddr, targetAddr, {}};
+                    for (auto processor = 0ul; processor < systemInfo.dwNumberOfProcessors; ++processor)
+                    {
+                        newTarget.m_sockets.emplace_back(std::make_shared<ctsMediaStreamClientMultiplexedSocket>(localAddr, targetAddr));
+                    }
+                    g_targetSockets.emplace_back(std::move(newTarget));
+                    foundTarget = g_targetSockets.end() - 1;
+                }
+
+                sharedSocket = foundTarget->m_sockets[SocketIndex(streamId, foundTarget->m_sockets.size())];
+            }
+
+            sharedSocket->AddStream(streamId);
+            return sharedSocket;
+        }
+
+        std::shared_ptr<ctsMediaStreamClientMultiplexedSocket> FindSocket(const ctsSocket& socket) noexcept
+        {
+            const auto streamId = GetStreamId(socket);
+            if (streamId[0] == '\0')
+            {
+                return nullptr;
+            }
+
+            // once connected, a stream's local address is the address its shared socket is bound to
+            const auto lock = g_targetSocketsGuard.lock_shared();
+            for (const auto& targetSockets : g_targetSockets)
+            {
+                if (targetSockets.m_targetAddr == socket.GetRemoteSockaddr())
+                {
+                    const auto& sharedSocket = targetSockets.m_sockets[SocketIndex(streamId, targetSockets.m_sockets.size())];
+                    if (sharedSocket->GetLocalAddress() == socket.GetLocalSockaddr())
+                    {
+                        return sharedSocket;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        void RemoveStream(const ctsSocket& socket) noexcept
+        {
+            const auto sharedSocket = FindSocket(socket);
+            if (sharedSocket)
+            {
+                sharedSocket->RemoveStream(GetStreamId(socket));
+            }
+        }
+
+        ctsMediaStreamId GetStreamId(const ctsSocket& socket) noexcept
+        {
+            ctsMediaStreamId streamId{};
+            const char* multiplexedStreamId = socket.GetMultiplexedStreamId();
+            if (multiplexedStreamId)
+            {
+                memcpy(streamId.data(), multiplexedStreamId, streamId.size());
+            }
+            return streamId;
+        }
+    }
+}
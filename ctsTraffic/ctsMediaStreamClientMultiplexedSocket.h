@@ -0,0 +1,157 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/resource.h>
+// ctl headers
+#include <ctSockaddr.hpp>
+#include <ctThreadIocp.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsIOTask.hpp"
+#include "ctsMediaStreamProtocol.hpp"
+#include "ctsSocket.h"
+#include "ctsWinsockLayer.h"
+
+// -MultiplexStreams:on : many MediaStream client streams share one UDP socket to each server
+// - each stream keeps its own ctsSocket and ctsIOPatternMediaStreamClient, but no socket of its own
+// - each stream sends START with its own stream ID, which the server prefixes to every datagram it sends that stream
+// - the shared socket keeps receives posted at all times, handing each datagram to the stream its prefix names
+
+namespace ctsTraffic
+{
+    // invoked as a stream's IO completes: with the bytes given to the stream and the Win32 error
+    typedef std::function<void(unsigned long, int)> ctsMediaStreamMultiplexedCallback;
+
+    class ctsMediaStreamClientMultiplexedSocket
+    {
+    private:
+        static constexpr size_t c_postedRecvCount = 8;
+        // datagrams received for a stream with no receive posted are queued, as a socket's receive buffer would
+        static constexpr size_t c_queuedDatagramLimit = 64;
+
+        struct PendingRecv
+        {
+            ctsTask m_task;
+            ctsMediaStreamMultiplexedCallback m_callback;
+        };
+
+        struct Stream
+        {
+            std::deque<PendingRecv> m_pendingRecvs;
+            std::deque<std::vector<char>> m_queuedDatagrams;
+        };
+
+        struct RecvContext
+        {
+            std::vector<char> m_buffer = std::vector<char>(c_udpDatagramMultiplexedHeaderLength + c_udpDatagramMaximumSizeBytes);
+            DWORD m_flags{};
+            ctl::ctSockaddr m_remoteAddr;
+            int m_remoteAddrLen{};
+        };
+
+        struct StreamIdHash
+        {
+            size_t operator()(const ctsMediaStreamId& streamId) const noexcept
+            {
+                return std::hash<std::string_view>{}(std::string_view(streamId.data()));
+            }
+        };
+
+        mutable wil::critical_section m_lock{ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
+        _Guarded_by_(m_lock) wil::unique_socket m_socket;
+        _Guarded_by_(m_lock) std::unordered_map<ctsMediaStreamId, Stream, StreamIdHash> m_streams;
+        std::shared_ptr<ctl::ctThreadIocp> m_threadIocp;
+
+        ctl::ctSockaddr m_localAddr;
+        const ctl::ctSockaddr m_targetAddr;
+        std::array<RecvContext, c_postedRecvCount> m_recvContexts{};
+        bool m_priorFailureWasConnectionReset = false;
+
+        void InitiateRecv(RecvContext& recvContext) noexcept;
+        void RecvCompletion(RecvContext& recvContext, OVERLAPPED* pOverlapped) noexcept;
+
+        // copies a received datagram's payload into the stream's task buffer
+        static wsIOResult DeliverDatagram(const ctsTask& task, _In_reads_bytes_(payloadLength) const char* payload, unsigned long payloadLength) noexcept;
+
+    public:
+        // creates and binds the socket, and posts its receives (throws on failure)
+        ctsMediaStreamClientMultiplexedSocket(const ctl::ctSockaddr& localAddr, const ctl::ctSockaddr& targetAddr);
+        ~ctsMediaStreamClientMultiplexedSocket() noexcept;
+
+        // the bound address : the local address of every stream sharing this socket
+        const ctl::ctSockaddr& GetLocalAddress() const noexcept
+        {
+            return m_localAddr;
+        }
+
+        const ctl::ctSockaddr& GetTargetAddress() const noexcept
+        {
+            return m_targetAddr;
+        }
+
+        void AddStream(const ctsMediaStreamId& streamId);
+
+        // pended receives of the stream are completed with WSA_OPERATION_ABORTED before returning
+        void RemoveStream(const ctsMediaStreamId& streamId) noexcept;
+
+        // sends START with the stream ID to the server
+        // - returns WSA_IO_PENDING once posted : the callback is then always invoked
+        int SendStart(const ctsMediaStreamId& streamId, ctsMediaStreamMultiplexedCallback&& callback) noexcept;
+
+        // hands the next datagram received for the stream to the task's buffer
+        // - returns an already-queued datagram inline, else WSA_IO_PENDING as the callback will be invoked once one arrives
+        // - fails with WSAECONNABORTED if the stream was removed
+        wsIOResult PostRecv(const ctsMediaStreamId& streamId, const ctsTask& task, ctsMediaStreamMultiplexedCallback&& callback) noexcept;
+
+        // non-copyable
+        ctsMediaStreamClientMultiplexedSocket(const ctsMediaStreamClientMultiplexedSocket&) = delete;
+        ctsMediaStreamClientMultiplexedSocket& operator=(const ctsMediaStreamClientMultiplexedSocket&) = delete;
+        ctsMediaStreamClientMultiplexedSocket(ctsMediaStreamClientMultiplexedSocket&&) = delete;
+        ctsMediaStreamClientMultiplexedSocket& operator=(ctsMediaStreamClientMultiplexedSocket&&) = delete;
+    };
+
+    namespace ctsMediaStreamClientMultiplexer
+    {
+        // adds the stream to the shared socket bound to localAddr carrying streams to the target
+        // - creates the sockets to the target on first use (throws on failure)
+        // - one socket per processor to each target, streams are spread across them by their stream ID
+        std::shared_ptr<ctsMediaStreamClientMultiplexedSocket> AddStream(
+            const ctl::ctSockaddr& localAddr,
+            const ctl::ctSockaddr& targetAddr,
+            const ctsMediaStreamId& streamId);
+
+        // the shared socket carrying the ctsSocket's stream, once connected
+        // - returns nullptr if the stream was never added
+        std::shared_ptr<ctsMediaStreamClientMultiplexedSocket> FindSocket(const ctsSocket& socket) noexcept;
+
+        // removes the ctsSocket's stream from its shared socket, if it was multiplexed
+        void RemoveStream(const ctsSocket& socket) noexcept;
+
+        // the ID of a ctsSocket's stream - all zeros if it was not multiplexed
+        ctsMediaStreamId GetStreamId(const ctsSocket& socket) noexcept;
+    }
+}
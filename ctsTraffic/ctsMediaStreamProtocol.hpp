@@ -39,12 +39,18 @@ namespace ctsTraffic
     //
     //   REQUEST_ID
     //   START
+    //   START STREAM_ID   (-MultiplexStreams:on : the NUL-terminated ID of one of many streams sharing the client's socket)
+    //
+    // With -MultiplexStreams:on every datagram the server sends to that stream is prefixed with
+    // the Multiplexed flag and its STREAM_ID, ahead of the usual Data or Id header
     //
     constexpr unsigned short c_udpDatagramProtocolHeaderFlagData = 0x0000;
     constexpr unsigned short c_udpDatagramProtocolHeaderFlagId = 0x1000;
+    constexpr unsigned short c_udpDatagramProtocolHeaderFlagMultiplexed = 0x2000;
 
     constexpr unsigned long c_udpDatagramProtocolHeaderFlagLength = 2;
     constexpr unsigned long c_udpDatagramConnectionIdHeaderLength = c_udpDatagramProtocolHeaderFlagLength + ctsStatistics::c_connectionIdLength;
+    constexpr unsigned long c_udpDatagramMultiplexedHeaderLength = c_udpDatagramProtocolHeaderFlagLength + ctsStatistics::c_connectionIdLength;
 
     constexpr unsigned long c_udpDatagramSequenceNumberLength = 8; // 64-bit value
     constexpr unsigned long c_udpDatagramQpcLength = 8; // 64-bit value
@@ -55,6 +61,10 @@ namespace ctsTraffic
 
     static const char* g_udpDatagramStartString = "START";
     constexpr unsigned long c_udpDatagramStartStringLength = 5;
+    constexpr unsigned long c_udpDatagramMultiplexedStartLength = c_udpDatagramStartStringLength + ctsStatistics::c_connectionIdLength;
+
+    // identifies one stream multiplexed over a shared client socket - all zeros when the stream is not multiplexed
+    using ctsMediaStreamId = std::array<char, ctsStatistics::c_connectionIdLength>;
 
     enum class MediaStreamAction : char
     {
@@ -285,6 +295,8 @@ namespace ctsTraffic
     {
         long long m_sequenceNumber = 0ll;
         MediaStreamAction m_action{};
+        // set when a multiplexed START carried the ID of the stream to start
+        ctsMediaStreamId m_streamId{};
 
         explicit ctsMediaStreamMessage(MediaStreamAction action) noexcept : m_action(action)
         {
@@ -439,6 +451,33 @@ namespace ctsTraffic
             return returnTask;
         }
 
+        // the START is written into the caller's buffer, which must remain valid until the send completes
+        static ctsTask ConstructMultiplexedStart(
+            _Out_writes_(c_udpDatagramMultiplexedStartLength) char* startBuffer,
+            _In_reads_(ctsStatistics::c_connectionIdLength) const char* streamId) noexcept
+        {
+            memcpy(startBuffer, g_udpDatagramStartString, c_udpDatagramStartStringLength);
+            memcpy(startBuffer + c_udpDatagramStartStringLength, streamId, ctsStatistics::c_connectionIdLength);
+            startBuffer[c_udpDatagramMultiplexedStartLength - 1] = '\0';
+
+            ctsTask returnTask;
+            returnTask.m_ioAction = ctsTaskAction::Send;
+            returnTask.m_bufferType = ctsTask::BufferType::Static;
+            returnTask.m_trackIo = false;
+            returnTask.m_buffer = startBuffer;
+            returnTask.m_bufferLength = c_udpDatagramMultiplexedStartLength;
+            return returnTask;
+        }
+
+        // true if the buffer starts with a START carrying a (NUL-terminated) stream ID
+        static bool IsMultiplexedStart(_In_reads_bytes_(inputLength) const char* inputBuffer, unsigned inputLength) noexcept
+        {
+            return inputLength >= c_udpDatagramMultiplexedStartLength &&
+                   0 == memcmp(inputBuffer, g_udpDatagramStartString, c_udpDatagramStartStringLength) &&
+                   inputBuffer[c_udpDatagramStartStringLength] != '\0' &&
+                   inputBuffer[c_udpDatagramMultiplexedStartLength - 1] == '\0';
+        }
+
         static ctsMediaStreamMessage Extract(_In_reads_bytes_(inputLength) const char* inputBuffer, unsigned inputLength)
         {
             if (inputLength == c_udpDatagramStartStringLength)
@@ -449,6 +488,13 @@ namespace ctsTraffic
                 }
             }
 
+            if (inputLength == c_udpDatagramMultiplexedStartLength && IsMultiplexedStart(inputBuffer, inputLength))
+            {
+                ctsMediaStreamMessage returnMessage(MediaStreamAction::START);
+                memcpy(returnMessage.m_streamId.data(), inputBuffer + c_udpDatagramStartStringLength, ctsStatistics::c_connectionIdLength);
+                return returnMessage;
+            }
+
             THROW_HR_MSG(HRESULT_FROM_WIN32(ERROR_INVALID_DATA),
                 "Invalid MediaStream message: %hs",
                 std::string(inputBuffer, inputLength).c_str());
@@ -12,21 +12,32 @@ See the Apache Version 2.0 License for specific language governing permissions a
 */
 
 // cpp headers
+#include <atomic>
 #include <memory>
 #include <vector>
+#include <unordered_map>
+#include <string_view>
 #include <algorithm>
+#include <array>
+#include <deque>
+#include <optional>
+#include <functional>
 // os headers
 #include <Windows.h>
 #include <WinSock2.h>
+#include <ws2tcpip.h>
 // wil headers
 #include <wil/stl.h>
 #include <wil/resource.h>
 // ctl headers
 #include <ctSockaddr.hpp>
+#include <ctThreadIocp.hpp>
+#include <ctTimer.hpp>
 // project headers
 #include "ctsConfig.h"
 #include "ctsSocket.h"
 #include "ctsIOTask.hpp"
+#include "ctsTCPFunctions.h"
 #include "ctsWinsockLayer.h"
 #include "ctsMediaStreamServer.h"
 #include "ctsMediaStreamServerConnectedSocket.h"
@@ -113,7 +124,7 @@ namespace ctsTraffic
         const auto sharedSocket(weakSocket.lock());
         if (sharedSocket)
         {
-            ctsMediaStreamServerImpl::RemoveSocket(sharedSocket->GetRemoteSockaddr());
+            ctsMediaStreamServerImpl::RemoveSocket(sharedSocket->GetRemoteSockaddr(), sharedSocket->GetMultiplexedStreamId());
         }
     }
     catch (...)
@@ -128,12 +139,67 @@ namespace ctsTraffic
 
         std::vector<std::unique_ptr<ctsMediaStreamServerListeningSocket>> g_listeningSockets;  // NOLINT(clang-diagnostic-exit-time-destructors)
 
-        wil::critical_section g_socketVectorGuard{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };  // NOLINT(cppcoreguidelines-interfaces-global-init, clang-diagnostic-exit-time-destructors)
-        _Guarded_by_(g_socketVectorGuard) std::vector<std::shared_ptr<ctsMediaStreamServerConnectedSocket>> g_connectedSockets;  // NOLINT(clang-diagnostic-exit-time-destructors)
+        // the listening sockets are only added to while initializing, so are searched without taking a lock
+        // - returns nullptr if the socket is not (or is no longer) one of our listening sockets
+        static const ctsMediaStreamServerListeningSocket* FindListeningSocket(SOCKET socket) noexcept
+        {
+            const auto foundSocket = std::find_if(
+                g_listeningSockets.begin(),
+                g_listeningSockets.end(),
+                [socket](const std::unique_ptr<ctsMediaStreamServerListeningSocket>& listener) noexcept {
+                    return listener->GetSocket() == socket;
+                });
+            return foundSocket == g_listeningSockets.end() ? nullptr : foundSocket->get();
+        }
+
+        // a stream is identified by the client's remote address
+        // - and with -MultiplexStreams:on, by the stream ID sent with START as many streams share that address
+        struct ctsMediaStreamEndpoint
+        {
+            ctl::ctSockaddr m_remoteAddr;
+            ctsMediaStreamId m_streamId{};
+
+            ctsMediaStreamEndpoint(const ctl::ctSockaddr& remoteAddr, _In_opt_z_ const char* streamId) noexcept :
+                m_remoteAddr(remoteAddr)
+            {
+                if (streamId)
+                {
+                    memcpy(m_streamId.data(), streamId, m_streamId.size());
+                    m_streamId[m_streamId.size() - 1] = '\0';
+                }
+            }
+
+            [[nodiscard]] bool IsMultiplexed() const noexcept
+            {
+                return m_streamId[0] != '\0';
+            }
+
+            bool operator==(const ctsMediaStreamEndpoint& rhs) const noexcept
+            {
+                return m_remoteAddr == rhs.m_remoteAddr && m_streamId == rhs.m_streamId;
+            }
+        };
+
+        // ctSockaddr::operator== compares the entire SOCKADDR_INET - so the hash covers the same bytes, then the stream ID
+        struct ctsMediaStreamEndpointHash
+        {
+            size_t operator()(const ctsMediaStreamEndpoint& endpoint) const noexcept
+            {
+                const auto addressHash = std::hash<std::string_view>{}(
+                    std::string_view(reinterpret_cast<const char*>(endpoint.m_remoteAddr.sockaddr_inet()), sizeof(SOCKADDR_INET)));
+                const auto streamHash = std::hash<std::string_view>{}(std::string_view(endpoint.m_streamId.data()));
+                return addressHash ^ (streamHash << 1);
+            }
+        };
+
+        // scheduling IO for a connected socket only needs a shared lock to find it by its remote address
+        // - adding and removing sockets, and the accepting/awaiting vectors, require the exclusive lock
+        wil::srwlock g_socketVectorGuard;  // NOLINT(cppcoreguidelines-interfaces-global-init, clang-diagnostic-exit-time-destructors)
+        _Guarded_by_(g_socketVectorGuard) std::unordered_map<ctsMediaStreamEndpoint, std::shared_ptr<ctsMediaStreamServerConnectedSocket>, ctsMediaStreamEndpointHash> g_connectedSockets;  // NOLINT(clang-diagnostic-exit-time-destructors)
         // weak_ptr<> to ctsSocket objects ready to accept a connection
         _Guarded_by_(g_socketVectorGuard) std::vector<std::weak_ptr<ctsSocket>> g_acceptingSockets;  // NOLINT(clang-diagnostic-exit-time-destructors)
         // endpoints that have been received from clients not yet matched to ctsSockets
-        _Guarded_by_(g_socketVectorGuard) std::vector<std::pair<SOCKET, ctl::ctSockaddr>> g_awaitingEndpoints;  // NOLINT(clang-diagnostic-exit-time-destructors)
+        _Guarded_by_(g_socketVectorGuard) std::vector<std::pair<SOCKET, ctsMediaStreamEndpoint>> g_awaitingEndpoints;  // NOLINT(clang-diagnostic-exit-time-destructors)
 
 
         // Singleton values used as the actual implementation for every 'connection'
@@ -160,6 +226,17 @@ namespace ctsTraffic
                         THROW_WIN32_MSG(WSAGetLastError(), "bind (ctsMediaStreamServer)");
                     }
 
+                    // with -IO:rioiocp and -IO:riopoll, every datagram is sent from the listening socket with RIOSendEx
+                    if (WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+                    {
+                        ctsRioRegisterDatagramSocket(listening.get());
+                    }
+                    // with -IO:xdp, every datagram is written into the TX rings of AF_XDP sockets on the interface bound to
+                    else if (ctsConfig::g_configSettings->XdpSend)
+                    {
+                        ctsXdpRegisterDatagramSocket(listening.get(), addr);
+                    }
+
                     // capture the socket value before moved into the vector
                     const SOCKET listeningSocketToPrint(listening.get());
                     g_listeningSockets.emplace_back(
@@ -208,18 +285,12 @@ namespace ctsTraffic
 
             std::shared_ptr<ctsMediaStreamServerConnectedSocket> sharedConnectedSocket;
             {
-                // must guard connected_sockets since we need to add it
-                const auto lockConnectedObject = g_socketVectorGuard.lock();
+                // only reading connected_sockets
+                const auto lockConnectedObject = g_socketVectorGuard.lock_shared();
 
                 // find the matching connected_socket
-                const auto foundSocket = std::find_if(
-                    std::begin(g_connectedSockets),
-                    std::end(g_connectedSockets),
-                    [&sharedSocket](const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& connectedSocket) noexcept {
-                        return sharedSocket->GetRemoteSockaddr() == connectedSocket->GetRemoteAddress();
-                    }
-                );
-
+                const auto foundSocket = g_connectedSockets.find(
+                    ctsMediaStreamEndpoint(sharedSocket->GetRemoteSockaddr(), sharedSocket->GetMultiplexedStreamId()));
                 if (foundSocket == std::end(g_connectedSockets))
                 {
                     ctsConfig::PrintErrorInfo(
@@ -228,7 +299,7 @@ namespace ctsTraffic
                     THROW_WIN32_MSG(ERROR_INVALID_DATA, "ctsSocket was not found in the connected sockets to continue sending datagrams");
                 }
 
-                sharedConnectedSocket = *foundSocket;
+                sharedConnectedSocket = foundSocket->second;
             }
             // must call into connected socket without holding a lock
             // and without maintaining an iterator into the list
@@ -244,7 +315,7 @@ namespace ctsTraffic
             auto sharedSocket(weakSocket.lock());
             if (sharedSocket)
             {
-                const auto lockAwaitingObject = g_socketVectorGuard.lock();
+                const auto lockAwaitingObject = g_socketVectorGuard.lock_exclusive();
 
                 if (g_awaitingEndpoints.empty())
                 {
@@ -255,47 +326,42 @@ namespace ctsTraffic
                 {
                     auto waitingEndpoint = g_awaitingEndpoints.rbegin();
 
-                    const auto existingSocket = std::find_if(
-                        std::begin(g_connectedSockets),
-                        std::end(g_connectedSockets),
-                        [&](const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& connectedSocket) noexcept {
-                            return waitingEndpoint->second == connectedSocket->GetRemoteAddress();
-                        });
-
+                    const auto existingSocket = g_connectedSockets.find(waitingEndpoint->second);
                     if (existingSocket != std::end(g_connectedSockets))
                     {
                         ctsConfig::g_configSettings->UdpStatusDetails.m_duplicateFrames.Increment();
                         PRINT_DEBUG_INFO(L"ctsMediaStreamServer::accept_socket - socket with remote address %ws asked to be Started but was already established",
-                            waitingEndpoint->second.WriteCompleteAddress().c_str());
+                            waitingEndpoint->second.m_remoteAddr.WriteCompleteAddress().c_str());
                         // return early if this was a duplicate request: this can happen if there is latency or drops
                         // between the client and server as they attempt to negotiating starting a new stream
                         return;
                     }
 
-                    g_connectedSockets.emplace_back(
+                    g_connectedSockets.emplace(
+                        waitingEndpoint->second,
                         std::make_shared<ctsMediaStreamServerConnectedSocket>(
                             weakSocket,
                             waitingEndpoint->first,
-                            waitingEndpoint->second,
-                            ConnectedSocketIo));
+                            waitingEndpoint->second.m_remoteAddr,
+                            ConnectedSocketIo,
+                            waitingEndpoint->second.m_streamId));
 
                     PRINT_DEBUG_INFO(L"ctsMediaStreamServer::accept_socket - socket with remote address %ws added to connected_sockets",
-                        waitingEndpoint->second.WriteCompleteAddress().c_str());
+                        waitingEndpoint->second.m_remoteAddr.WriteCompleteAddress().c_str());
 
                     // now complete the ctsSocket 'Create' request
-                    const auto foundSocket = std::find_if(
-                        g_listeningSockets.begin(),
-                        g_listeningSockets.end(),
-                        [&waitingEndpoint](const std::unique_ptr<ctsMediaStreamServerListeningSocket>& listener) noexcept {
-                            return listener->GetSocket() == waitingEndpoint->first;
-                        });
+                    const auto* foundSocket = FindListeningSocket(waitingEndpoint->first);
                     FAIL_FAST_IF_MSG(
-                        foundSocket == g_listeningSockets.end(),
+                        !foundSocket,
                         "Could not find the socket (%Iu) in the waiting_endpoint from our listening sockets (%p)\n",
                         waitingEndpoint->first, &g_listeningSockets);
 
-                    sharedSocket->SetLocalSockaddr((*foundSocket)->GetListeningAddress());
-                    sharedSocket->SetRemoteSockaddr(waitingEndpoint->second);
+                    sharedSocket->SetLocalSockaddr(foundSocket->GetListeningAddress());
+                    sharedSocket->SetRemoteSockaddr(waitingEndpoint->second.m_remoteAddr);
+                    if (waitingEndpoint->second.IsMultiplexed())
+                    {
+                        sharedSocket->SetMultiplexedStreamId(waitingEndpoint->second.m_streamId.data());
+                    }
                     sharedSocket->CompleteState(NO_ERROR);
 
                     ctsConfig::PrintNewConnection(sharedSocket->GetLocalSockaddr(), sharedSocket->GetRemoteSockaddr());
@@ -306,20 +372,18 @@ namespace ctsTraffic
         }
 
         // Process the removal of a connected socket once it is completed
-        // - remove_socket takes the remote address to find the socket
-        void RemoveSocket(const ctl::ctSockaddr& targetAddr)
+        // - remove_socket takes the remote address (and stream ID for multiplexed streams) to find the socket
+        void RemoveSocket(const ctl::ctSockaddr& targetAddr, _In_opt_z_ const char* streamId)
         {
-            const auto lockConnectedObject = g_socketVectorGuard.lock();
+            // the removed socket is deleted outside the lock
+            std::shared_ptr<ctsMediaStreamServerConnectedSocket> removedSocket;
 
-            const auto foundSocket = std::find_if(
-                std::begin(g_connectedSockets),
-                std::end(g_connectedSockets),
-                [&targetAddr](const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& connectedSocket) noexcept {
-                    return targetAddr == connectedSocket->GetRemoteAddress();
-                });
+            const auto lockConnectedObject = g_socketVectorGuard.lock_exclusive();
 
+            const auto foundSocket = g_connectedSockets.find(ctsMediaStreamEndpoint(targetAddr, streamId));
             if (foundSocket != std::end(g_connectedSockets))
             {
+                removedSocket = std::move(foundSocket->second);
                 g_connectedSockets.erase(foundSocket);
             }
         }
@@ -327,16 +391,12 @@ namespace ctsTraffic
         // Processes the incoming START request from the client
         // - if we have a waiting ctsSocket to accept it, will add it to connected_sockets
         // - else we'll queue it to awaiting_endpoints
-        void Start(SOCKET socket, const ctl::ctSockaddr& localAddr, const ctl::ctSockaddr& targetAddr)
+        void Start(SOCKET socket, const ctl::ctSockaddr& localAddr, const ctl::ctSockaddr& targetAddr, _In_opt_z_ const char* streamId)
         {
-            const auto lockAwaitingObject = g_socketVectorGuard.lock();
+            const ctsMediaStreamEndpoint targetEndpoint(targetAddr, streamId);
+            const auto lockAwaitingObject = g_socketVectorGuard.lock_exclusive();
 
-            const auto existingSocket = std::find_if(
-                std::begin(g_connectedSockets),
-                std::end(g_connectedSockets),
-                [&targetAddr](const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& connectedSocket) noexcept {
-                    return targetAddr == connectedSocket->GetRemoteAddress();
-                });
+            const auto existingSocket = g_connectedSockets.find(targetEndpoint);
             if (existingSocket != std::end(g_connectedSockets))
             {
                 ctsConfig::g_configSettings->UdpStatusDetails.m_duplicateFrames.Increment();
@@ -349,8 +409,8 @@ namespace ctsTraffic
             const auto awaitingEndpoint = std::find_if(
                 std::begin(g_awaitingEndpoints),
                 std::end(g_awaitingEndpoints),
-                [&targetAddr](const std::pair<SOCKET, ctl::ctSockaddr>& endpoint) noexcept {
-                    return targetAddr == endpoint.second;
+                [&targetEndpoint](const std::pair<SOCKET, ctsMediaStreamEndpoint>& endpoint) noexcept {
+                    return targetEndpoint == endpoint.second;
                 });
             if (awaitingEndpoint != std::end(g_awaitingEndpoints))
             {
@@ -371,8 +431,9 @@ namespace ctsTraffic
                 if (sharedInstance)
                 {
                     // 'move' the accepting socket to connected
-                    g_connectedSockets.emplace_back(
-                        std::make_shared<ctsMediaStreamServerConnectedSocket>(weakInstance, socket, targetAddr, ConnectedSocketIo));
+                    g_connectedSockets.emplace(
+                        targetEndpoint,
+                        std::make_shared<ctsMediaStreamServerConnectedSocket>(weakInstance, socket, targetAddr, ConnectedSocketIo, targetEndpoint.m_streamId));
 
                     PRINT_DEBUG_INFO(L"ctsMediaStreamServer::start - socket with remote address %ws added to connected_sockets",
                         targetAddr.WriteCompleteAddress().c_str());
@@ -384,6 +445,10 @@ namespace ctsTraffic
                     // now complete the accepted ctsSocket back to the ctsSocketState
                     sharedInstance->SetLocalSockaddr(localAddr);
                     sharedInstance->SetRemoteSockaddr(targetAddr);
+                    if (targetEndpoint.IsMultiplexed())
+                    {
+                        sharedInstance->SetMultiplexedStreamId(targetEndpoint.m_streamId.data());
+                    }
                     sharedInstance->CompleteState(NO_ERROR);
 
                     ctsConfig::PrintNewConnection(localAddr, targetAddr);
@@ -398,7 +463,575 @@ namespace ctsTraffic
                     targetAddr.WriteCompleteAddress().c_str());
 
                 // only queue it if we aren't already waiting on this address
-                g_awaitingEndpoints.emplace_back(socket, targetAddr);
+                g_awaitingEndpoints.emplace_back(socket, targetEndpoint);
+            }
+        }
+
+        //
+        // Everything the overlapped sends of one frame reference until the last of them completes
+        // - the datagram headers and the Connection-ID are copied here instead of pointing into the timer callback's stack
+        //   or the ctsIOPattern, as a send that pends references them until it completes
+        // - ctsMediaStreamSendRequests refreshes a single QPC value for each datagram, so each datagram sends its own copy
+        // - the data itself is sent from the shared send buffer, which is never freed
+        // - every posted send holds a shared_ptr to the frame
+        // - the frame only holds a weak reference on its stream: the last reference to a stream must never be released
+        //   from its own timer callback, as its destructor waits for those callbacks
+        //
+        struct ctsMediaStreamServerFrame
+        {
+            ctsMediaStreamServerFrame(
+                std::weak_ptr<ctsMediaStreamServerConnectedSocket> stream,
+                const ctl::ctSockaddr& remoteAddr,
+                SOCKET socket,
+                const ctl::ctThreadIocp& threadIocp,
+                long long sequenceNumber) noexcept :
+                m_stream(std::move(stream)),
+                m_remoteAddr(remoteAddr),
+                m_socket(socket),
+                m_threadIocp(threadIocp),
+                m_sequenceNumber(sequenceNumber)
+            {
+            }
+
+            const std::weak_ptr<ctsMediaStreamServerConnectedSocket> m_stream;
+            const ctl::ctSockaddr m_remoteAddr;
+            const SOCKET m_socket;
+            // owned by the listening socket, which outlives every stream sending from it
+            const ctl::ctThreadIocp& m_threadIocp;
+            const long long m_sequenceNumber;
+
+            // sending one datagram at a time: the sequence number and QPF of every datagram point into m_sendRequests
+            std::optional<ctsMediaStreamSendRequests> m_sendRequests;
+            std::deque<long long> m_datagramQpc;
+
+            // UDP Send Offload: the one header shared by every datagram, the WSABUF array, and the control message
+            char m_datagramHeader[c_udpDatagramDataHeaderLength]{};
+            std::vector<WSABUF> m_offloadBuffers;
+            alignas(WSACMSGHDR) char m_controlBuffer[WSA_CMSG_SPACE(sizeof(DWORD))]{};
+            WSAMSG m_sendMessage{};
+
+            // -Pattern:Blast : the header of each datagram of a burst, each with its own sequence number
+            std::vector<char> m_burstHeaders;
+
+            char m_connectionId[c_udpDatagramConnectionIdHeaderLength]{};
+
+            // -MultiplexStreams:on : the Multiplexed flag and stream ID sent ahead of every datagram
+            char m_streamPrefix[c_udpDatagramMultiplexedHeaderLength]{};
+            bool m_multiplexed = false;
+
+            // -ContiguousDatagrams:on : every datagram is laid out in m_sendSlab, taken from and returned to its stream's pool
+            std::shared_ptr<ctsMediaStreamSendSlabPool> m_sendSlabPool;
+            ctsMediaStreamSendSlab m_sendSlab;
+
+            ~ctsMediaStreamServerFrame() noexcept
+            {
+                if (m_sendSlabPool && !m_sendSlab.empty())
+                {
+                    m_sendSlabPool->Release(std::move(m_sendSlab));
+                }
+            }
+
+            ctsMediaStreamServerFrame(const ctsMediaStreamServerFrame&) = delete;
+            ctsMediaStreamServerFrame& operator=(const ctsMediaStreamServerFrame&) = delete;
+            ctsMediaStreamServerFrame(ctsMediaStreamServerFrame&&) = delete;
+            ctsMediaStreamServerFrame& operator=(ctsMediaStreamServerFrame&&) = delete;
+        };
+
+        //
+        // Writes the data header in front of each datagram - header#, seq. number, qpc, qpf - matching ctsMediaStreamSendRequests
+        //
+        static void FormatDatagramHeader(_Out_writes_bytes_(c_udpDatagramDataHeaderLength) char* header, long long sequenceNumber, long long qpc, long long qpf) noexcept
+        {
+            memcpy(header, &c_udpDatagramProtocolHeaderFlagData, c_udpDatagramProtocolHeaderFlagLength);
+            header += c_udpDatagramProtocolHeaderFlagLength;
+            memcpy(header, &sequenceNumber, c_udpDatagramSequenceNumberLength);
+            header += c_udpDatagramSequenceNumberLength;
+            memcpy(header, &qpc, c_udpDatagramQpcLength);
+            header += c_udpDatagramQpcLength;
+            memcpy(header, &qpf, c_udpDatagramQpfLength);
+        }
+
+        //
+        // Invoked on the listening socket's ctThreadIocp as each overlapped send completes
+        // - the bytes were reported to the ctsIOPattern when the send was posted, so failures are only printed
+        //   (matching datagrams sent with RIOSendEx)
+        //
+        static void SendCompletion(const ctsMediaStreamServerFrame& frame, OVERLAPPED* pOverlapped) noexcept
+        {
+            DWORD bytesSent{};
+            DWORD flags{};
+            if (!WSAGetOverlappedResult(frame.m_socket, pOverlapped, &bytesSent, FALSE, &flags))
+            {
+                const auto error = WSAGetLastError();
+                // sends still pended when the listening socket is closed are aborted
+                if (error != WSA_OPERATION_ABORTED && error != WSAENOTSOCK)
+                {
+                    ctsConfig::PrintErrorInfo(
+                        L"WSASendTo(%Iu, seq %lld, %ws) failed after it was pended [%d]",
+                        frame.m_socket,
+                        frame.m_sequenceNumber,
+                        frame.m_remoteAddr.WriteCompleteAddress().c_str(),
+                        error);
+                }
+            }
+
+            const auto stream = frame.m_stream.lock();
+            if (stream)
+            {
+                stream->SendCompleted();
+                stream->ResumeSends();
+            }
+        }
+
+        //
+        // Posts one overlapped send from the listening socket, completing on its ctThreadIocp
+        // - WSASendMsg when given a WSAMSG (UDP Send Offload), else WSASendTo
+        // - the calling timer thread never blocks: a send that pends is counted as one that would have blocked
+        // Returns NO_ERROR once posted (setting bytesSent to the bytes posted), or a Win32 error on failure
+        //
+        static int PostSend(
+            ctsMediaStreamServerConnectedSocket& connectedSocket,
+            const std::shared_ptr<ctsMediaStreamServerFrame>& frame,
+            _In_reads_(bufferCount) WSABUF* buffers,
+            DWORD bufferCount,
+            _In_opt_ WSAMSG* sendMessage,
+            _Out_ DWORD* bytesSent) noexcept
+        {
+            *bytesSent = 0;
+
+            OVERLAPPED* pOverlapped = nullptr;
+            try
+            {
+                pOverlapped = frame->m_threadIocp.new_request(
+                    [frame](OVERLAPPED* pCallbackOverlapped) noexcept {
+                        SendCompletion(*frame, pCallbackOverlapped); });
+            }
+            catch (...)
+            {
+                return static_cast<int>(ctsConfig::PrintThrownException());
+            }
+
+            connectedSocket.SendPosted();
+            ctsConfig::g_configSettings->UdpStatusDetails.m_sendCalls.Increment();
+
+            const ctl::ctSockaddr& remoteAddr = frame->m_remoteAddr;
+            const auto result = sendMessage ?
+                WSASendMsg(frame->m_socket, sendMessage, 0, nullptr, pOverlapped, nullptr) :
+                WSASendTo(frame->m_socket, buffers, bufferCount, nullptr, 0, remoteAddr.sockaddr(), remoteAddr.length(), pOverlapped, nullptr);
+            if (SOCKET_ERROR == result)
+            {
+                const auto error = WSAGetLastError();
+                if (error != WSA_IO_PENDING)
+                {
+                    frame->m_threadIocp.cancel_request(pOverlapped);
+                    connectedSocket.SendCompleted();
+                    return error;
+                }
+
+                // the send buffer is full - a synchronous send would have blocked this timer thread
+                ctsConfig::g_configSettings->UdpStatusDetails.m_pendedSends.Increment();
+            }
+
+            for (DWORD buffer = 0; buffer < bufferCount; ++buffer)
+            {
+                *bytesSent += buffers[buffer].len;
+            }
+            return NO_ERROR;
+        }
+
+        //
+        // Sends one datagram of the frame to the remote address
+        // - posted with RIOSendEx when using registered IO, which copies the datagram into registered memory
+        //   (registered IO sends complete once copied into registered memory : failures are printed as they are dequeued)
+        // - written into an AF_XDP TX ring with -IO:xdp, which completes once the NIC has sent it
+        // - otherwise posted with an overlapped WSASendTo
+        // - datagrams to multiplexed streams are sent behind the frame's stream prefix,
+        //   which is not counted in bytesSent as the ctsIOPattern never sees it
+        //
+        static int SendBuffers(
+            ctsMediaStreamServerConnectedSocket& connectedSocket,
+            const std::shared_ptr<ctsMediaStreamServerFrame>& frame,
+            _In_reads_(bufferCount) WSABUF* buffers,
+            DWORD bufferCount,
+            _Out_ DWORD* bytesSent) noexcept
+        {
+            const bool xdpSend = ctsConfig::g_configSettings->XdpSend;
+            if (xdpSend || WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO))
+            {
+                ctsConfig::g_configSettings->UdpStatusDetails.m_sendCalls.Increment();
+                if (!ctsConfig::g_configSettings->UdpBlast)
+                {
+                    return xdpSend ?
+                        ctsXdpSendDatagram(frame->m_socket, frame->m_remoteAddr, buffers, bufferCount, bytesSent) :
+                        ctsRioSendDatagram(frame->m_socket, frame->m_remoteAddr, buffers, bufferCount, bytesSent);
+                }
+
+                // -Pattern:Blast : the send window is only opened again as RIOSendEx (or XDP TX) completions are dequeued
+                std::function<void()> sendCompleted;
+                try
+                {
+                    sendCompleted = [weakStream = frame->m_stream]() noexcept {
+                        const auto stream = weakStream.lock();
+                        if (stream)
+                        {
+                            stream->SendCompleted();
+                            stream->ResumeSends();
+                        }
+                    };
+                }
+                catch (...)
+                {
+                    return static_cast<int>(ctsConfig::PrintThrownException());
+                }
+
+                connectedSocket.SendPosted();
+                const auto error = xdpSend ?
+                    ctsXdpSendDatagram(frame->m_socket, frame->m_remoteAddr, buffers, bufferCount, bytesSent, std::move(sendCompleted)) :
+                    ctsRioSendDatagram(frame->m_socket, frame->m_remoteAddr, buffers, bufferCount, bytesSent, std::move(sendCompleted));
+                if (error != NO_ERROR)
+                {
+                    connectedSocket.SendCompleted();
+                }
+                return error;
+            }
+            return PostSend(connectedSocket, frame, buffers, bufferCount, nullptr, bytesSent);
+        }
+
+        static int SendDatagram(
+            ctsMediaStreamServerConnectedSocket& connectedSocket,
+            const std::shared_ptr<ctsMediaStreamServerFrame>& frame,
+            _In_reads_(bufferCount) WSABUF* buffers,
+            DWORD bufferCount,
+            _Out_ DWORD* bytesSent) noexcept
+        {
+            std::array<WSABUF, ctsMediaStreamSendRequests::c_bufferArraySize + 1> prefixedBuffers{};
+            if (frame->m_multiplexed)
+            {
+                FAIL_FAST_IF_MSG(
+                    bufferCount > ctsMediaStreamSendRequests::c_bufferArraySize,
+                    "ctsMediaStreamServer was given %lu buffers to send to a multiplexed stream", bufferCount);
+
+                prefixedBuffers[0].buf = frame->m_streamPrefix;
+                prefixedBuffers[0].len = c_udpDatagramMultiplexedHeaderLength;
+                std::copy_n(buffers, bufferCount, prefixedBuffers.begin() + 1);
+                buffers = prefixedBuffers.data();
+                ++bufferCount;
+            }
+
+            const auto error = SendBuffers(connectedSocket, frame, buffers, bufferCount, bytesSent);
+            if (NO_ERROR == error && frame->m_multiplexed)
+            {
+                *bytesSent -= c_udpDatagramMultiplexedHeaderLength;
+            }
+            return error;
+        }
+
+        // set once WSASendMsg rejects UDP_SEND_MSG_SIZE : all later frames are sent one datagram at a time
+        std::atomic<bool> g_sendOffloadUnavailable{false};
+
+        //
+        // Formats the frame's WSAMSG to send its m_offloadBuffers with UDP_SEND_MSG_SIZE, returning the WSAMSG
+        //
+        static WSAMSG* FormatOffloadMessage(ctsMediaStreamServerFrame& frame, unsigned long datagramSize) noexcept
+        {
+            auto* const controlMessage = reinterpret_cast<WSACMSGHDR*>(frame.m_controlBuffer);
+            controlMessage->cmsg_len = WSA_CMSG_LEN(sizeof(DWORD));
+            controlMessage->cmsg_level = IPPROTO_UDP;
+            controlMessage->cmsg_type = UDP_SEND_MSG_SIZE;
+            *reinterpret_cast<DWORD*>(WSA_CMSG_DATA(controlMessage)) = datagramSize;
+
+            WSAMSG& sendMessage = frame.m_sendMessage;
+            sendMessage.name = const_cast<SOCKADDR*>(frame.m_remoteAddr.sockaddr());
+            sendMessage.namelen = frame.m_remoteAddr.length();
+            sendMessage.lpBuffers = frame.m_offloadBuffers.data();
+            sendMessage.dwBufferCount = static_cast<ULONG>(frame.m_offloadBuffers.size());
+            sendMessage.Control.buf = frame.m_controlBuffer;
+            sendMessage.Control.len = sizeof frame.m_controlBuffer;
+            return &sendMessage;
+        }
+
+        //
+        // Returns true if the WSASendMsg error shows UDP_SEND_MSG_SIZE isn't supported, setting g_sendOffloadUnavailable
+        // - older stacks either reject the control message or try to send one oversized datagram
+        //
+        static bool IsSendOffloadUnavailable(SOCKET socket, unsigned long datagramSize, int error) noexcept
+        {
+            if (WSAEINVAL == error || WSAEOPNOTSUPP == error || WSAENOPROTOOPT == error || WSAEMSGSIZE == error)
+            {
+                if (!g_sendOffloadUnavailable.exchange(true))
+                {
+                    ctsConfig::PrintErrorInfo(
+                        L"WSASendMsg(%Iu, UDP_SEND_MSG_SIZE %lu) failed [%d] - UDP Send Offload is not available, sending one datagram at a time",
+                        socket,
+                        datagramSize,
+                        error);
+                }
+                return true;
+            }
+            return false;
+        }
+
+        //
+        // Sends every datagram of the frame with a single WSASendMsg call using UDP Send Offload (UDP_SEND_MSG_SIZE)
+        // - the stack (or NIC) splits the buffer into datagrams of the size passed in the control message,
+        //   so the frame is divided into equally sized datagrams with only the last one allowed to be shorter
+        // - every datagram of a frame carries the same header, so the WSABUF array alternates between
+        //   that one header and the start of the send buffer, exactly as ctsMediaStreamSendRequests lays them out
+        //   (with -ContiguousDatagrams:on the datagrams are instead copied back to back into one buffer in a send slab)
+        // - returns false if the frame was not sent : the caller must then send one datagram at a time
+        //
+        static bool TrySendFrameWithOffload(
+            ctsMediaStreamServerConnectedSocket& connectedSocket,
+            const std::shared_ptr<ctsMediaStreamServerFrame>& frame,
+            const ctsTask& nextTask,
+            wsIOResult& sendResults) noexcept
+        {
+            const unsigned long frameBytes = nextTask.m_bufferLength;
+            const unsigned long datagramCount = (frameBytes + c_udpDatagramMaximumSizeBytes - 1) / c_udpDatagramMaximumSizeBytes;
+            if (datagramCount < 2)
+            {
+                // nothing to coalesce
+                return false;
+            }
+
+            const unsigned long datagramSize = (frameBytes + datagramCount - 1) / datagramCount;
+            const unsigned long lastDatagramSize = frameBytes - (datagramCount - 1) * datagramSize;
+            if (lastDatagramSize <= c_udpDatagramDataHeaderLength)
+            {
+                return false;
+            }
+
+            const SOCKET socket = frame->m_socket;
+            const ctl::ctSockaddr& remoteAddr = frame->m_remoteAddr;
+            try
+            {
+                auto& sendBuffers = frame->m_offloadBuffers;
+
+                FormatDatagramHeader(frame->m_datagramHeader, frame->m_sequenceNumber, ctl::ctTimer::SnapQpc(), ctl::ctTimer::SnapQpf());
+
+                if (frame->m_sendSlabPool)
+                {
+                    // -ContiguousDatagrams:on : the stack segments one buffer, so each datagram is laid out behind its header
+                    // - back to back, without aligning each datagram, as the segments must be contiguous
+                    frame->m_sendSlab = frame->m_sendSlabPool->Acquire(frameBytes);
+                    char* datagramOffset = frame->m_sendSlab.front().m_bytes;
+                    for (unsigned long datagram = 0; datagram < datagramCount; ++datagram)
+                    {
+                        const unsigned long dataLength = (datagram == datagramCount - 1 ? lastDatagramSize : datagramSize) - c_udpDatagramDataHeaderLength;
+                        memcpy(datagramOffset, frame->m_datagramHeader, c_udpDatagramDataHeaderLength);
+                        memcpy(datagramOffset + c_udpDatagramDataHeaderLength, nextTask.m_buffer, dataLength);
+                        datagramOffset += c_udpDatagramDataHeaderLength + dataLength;
+                    }
+
+                    sendBuffers.resize(1);
+                    sendBuffers[0].buf = frame->m_sendSlab.front().m_bytes;
+                    sendBuffers[0].len = frameBytes;
+                }
+                else
+                {
+                    sendBuffers.resize(static_cast<size_t>(datagramCount) * 2);
+                    for (unsigned long datagram = 0; datagram < datagramCount; ++datagram)
+                    {
+                        auto& headerBuffer = sendBuffers[static_cast<size_t>(datagram) * 2];
+                        headerBuffer.buf = frame->m_datagramHeader;
+                        headerBuffer.len = c_udpDatagramDataHeaderLength;
+
+                        auto& dataBuffer = sendBuffers[static_cast<size_t>(datagram) * 2 + 1];
+                        dataBuffer.buf = nextTask.m_buffer;
+                        dataBuffer.len = (datagram == datagramCount - 1 ? lastDatagramSize : datagramSize) - c_udpDatagramDataHeaderLength;
+                    }
+                }
+
+                DWORD bytesSent{};
+                const auto error = PostSend(
+                    connectedSocket,
+                    frame,
+                    sendBuffers.data(),
+                    static_cast<DWORD>(sendBuffers.size()),
+                    FormatOffloadMessage(*frame, datagramSize),
+                    &bytesSent);
+                if (error != NO_ERROR)
+                {
+                    if (IsSendOffloadUnavailable(socket, datagramSize, error))
+                    {
+                        return false;
+                    }
+
+                    ctsConfig::PrintErrorInfo(
+                        L"WSASendMsg(%Iu, seq %lld, %ws) failed [%d]",
+                        socket,
+                        frame->m_sequenceNumber,
+                        remoteAddr.WriteCompleteAddress().c_str(),
+                        error);
+                    sendResults = wsIOResult(error);
+                    return true;
+                }
+
+                // successfully posted
+                sendResults.m_bytesTransferred = bytesSent;
+                return true;
+            }
+            catch (...)
+            {
+                ctsConfig::PrintThrownException();
+                return false;
+            }
+        }
+
+        //
+        // -ContiguousDatagrams:on : sends each datagram of the frame as a single buffer from a send slab
+        // - datagrams are sized exactly as ctsMediaStreamSendRequests sizes them, each laid out from the start of a cache line:
+        //   the stream prefix (multiplexed streams), the header, then the data
+        // - the QPC is still written into each header just before its datagram is sent
+        // Returns NO_ERROR once every datagram is posted (adding the bytes posted to bytesSent), or the error of the failed send
+        //
+        static int SendFrameFromSlab(
+            ctsMediaStreamServerConnectedSocket& connectedSocket,
+            const std::shared_ptr<ctsMediaStreamServerFrame>& frame,
+            const ctsTask& nextTask,
+            _Inout_ unsigned long* bytesSent) noexcept
+        {
+            const SOCKET socket = frame->m_socket;
+            const ctl::ctSockaddr& remoteAddr = frame->m_remoteAddr;
+            const unsigned long prefixLength = frame->m_multiplexed ? c_udpDatagramMultiplexedHeaderLength : 0UL;
+            try
+            {
+                std::vector<unsigned long> datagramLengths;
+                size_t slabBytes = 0;
+                ctsMediaStreamSendRequests sendRequests(nextTask.m_bufferLength, frame->m_sequenceNumber, nextTask.m_buffer);
+                for (const auto& sendRequest : sendRequests)
+                {
+                    unsigned long datagramLength = 0;
+                    for (const auto& buffer : sendRequest)
+                    {
+                        datagramLength += buffer.len;
+                    }
+                    datagramLengths.push_back(datagramLength);
+                    // each datagram starts on its own cache line
+                    slabBytes += (prefixLength + datagramLength + sizeof(ctsMediaStreamSlabLine) - 1) / sizeof(ctsMediaStreamSlabLine) * sizeof(ctsMediaStreamSlabLine);
+                }
+
+                frame->m_sendSlab = frame->m_sendSlabPool->Acquire(slabBytes);
+                const long long qpf = ctl::ctTimer::SnapQpf();
+                auto* slabLine = frame->m_sendSlab.data();
+                for (const auto datagramLength : datagramLengths)
+                {
+                    char* const datagram = slabLine->m_bytes;
+                    if (prefixLength > 0)
+                    {
+                        memcpy(datagram, frame->m_streamPrefix, prefixLength);
+                    }
+                    memcpy(datagram + prefixLength + c_udpDatagramDataHeaderLength, nextTask.m_buffer, datagramLength - c_udpDatagramDataHeaderLength);
+
+                    // refresh the QPC at the last possible moment before sending
+                    FormatDatagramHeader(datagram + prefixLength, frame->m_sequenceNumber, ctl::ctTimer::SnapQpc(), qpf);
+
+                    WSABUF wsabuffer{};
+                    wsabuffer.buf = datagram;
+                    wsabuffer.len = prefixLength + datagramLength;
+                    DWORD datagramBytesSent{};
+                    const auto error = SendBuffers(connectedSocket, frame, &wsabuffer, 1, &datagramBytesSent);
+                    if (error != NO_ERROR)
+                    {
+                        ctsConfig::PrintErrorInfo(
+                            L"WSASendTo(%Iu, seq %lld, %ws) failed [%d] : attempted to send datagram of size %u bytes",
+                            socket,
+                            frame->m_sequenceNumber,
+                            remoteAddr.WriteCompleteAddress().c_str(),
+                            error,
+                            wsabuffer.len);
+                        return error;
+                    }
+
+                    // the stream prefix is not counted, as the ctsIOPattern never sees it
+                    *bytesSent += datagramBytesSent - prefixLength;
+                    slabLine += (wsabuffer.len + sizeof(ctsMediaStreamSlabLine) - 1) / sizeof(ctsMediaStreamSlabLine);
+                }
+                return NO_ERROR;
+            }
+            catch (...)
+            {
+                return static_cast<int>(ctsConfig::PrintThrownException());
+            }
+        }
+
+        //
+        // -Pattern:Blast with -UdpSendOffload:on : sends a burst of equally sized datagrams, each with its own sequence number
+        // - the task holds m_bufferLength / m_coalescedSegmentSize datagrams, each sending the same bytes from the start of the buffer
+        // - posted with a single WSASendMsg using UDP_SEND_MSG_SIZE, the WSABUF array alternating between
+        //   the header of each datagram and the data
+        // - sent one datagram at a time if UDP Send Offload is not available, or to multiplexed streams
+        // Returns NO_ERROR once every datagram is posted (setting bytesSent to the bytes posted), or the error of the failed send
+        //
+        static int SendBurst(
+            ctsMediaStreamServerConnectedSocket& connectedSocket,
+            const std::shared_ptr<ctsMediaStreamServerFrame>& frame,
+            const ctsTask& nextTask,
+            _Out_ unsigned long* bytesSent) noexcept
+        {
+            *bytesSent = 0;
+
+            const unsigned long datagramSize = nextTask.m_coalescedSegmentSize;
+            const unsigned long datagramCount = nextTask.m_bufferLength / datagramSize;
+            try
+            {
+                auto& headers = frame->m_burstHeaders;
+                headers.resize(static_cast<size_t>(datagramCount) * c_udpDatagramDataHeaderLength);
+                const long long qpc = ctl::ctTimer::SnapQpc();
+                const long long qpf = ctl::ctTimer::SnapQpf();
+
+                auto& sendBuffers = frame->m_offloadBuffers;
+                sendBuffers.resize(static_cast<size_t>(datagramCount) * 2);
+                for (unsigned long datagram = 0; datagram < datagramCount; ++datagram)
+                {
+                    char* const header = headers.data() + static_cast<size_t>(datagram) * c_udpDatagramDataHeaderLength;
+                    FormatDatagramHeader(header, frame->m_sequenceNumber + datagram, qpc, qpf);
+
+                    auto& headerBuffer = sendBuffers[static_cast<size_t>(datagram) * 2];
+                    headerBuffer.buf = header;
+                    headerBuffer.len = c_udpDatagramDataHeaderLength;
+
+                    auto& dataBuffer = sendBuffers[static_cast<size_t>(datagram) * 2 + 1];
+                    dataBuffer.buf = nextTask.m_buffer;
+                    dataBuffer.len = datagramSize - c_udpDatagramDataHeaderLength;
+                }
+
+                if (!g_sendOffloadUnavailable.load() && !frame->m_multiplexed)
+                {
+                    DWORD burstBytesSent{};
+                    const auto error = PostSend(
+                        connectedSocket,
+                        frame,
+                        sendBuffers.data(),
+                        static_cast<DWORD>(sendBuffers.size()),
+                        FormatOffloadMessage(*frame, datagramSize),
+                        &burstBytesSent);
+                    if (NO_ERROR == error)
+                    {
+                        *bytesSent = burstBytesSent;
+                        return NO_ERROR;
+                    }
+                    if (!IsSendOffloadUnavailable(frame->m_socket, datagramSize, error))
+                    {
+                        return error;
+                    }
+                }
+
+                for (unsigned long datagram = 0; datagram < datagramCount; ++datagram)
+                {
+                    DWORD datagramBytesSent{};
+                    const auto error = SendDatagram(connectedSocket, frame, &sendBuffers[static_cast<size_t>(datagram) * 2], 2, &datagramBytesSent);
+                    if (error != NO_ERROR)
+                    {
+                        return error;
+                    }
+                    *bytesSent += datagramBytesSent;
+                }
+                return NO_ERROR;
+            }
+            catch (...)
+            {
+                return static_cast<int>(ctsConfig::PrintThrownException());
             }
         }
 
@@ -410,99 +1043,161 @@ namespace ctsTraffic
                 return wsIOResult(WSA_OPERATION_ABORTED);
             }
 
+            // the listening socket is only gone once the server is shutting down
+            const auto* listeningSocket = FindListeningSocket(socket);
+            if (!listeningSocket)
+            {
+                return wsIOResult(WSA_OPERATION_ABORTED);
+            }
+
             const ctl::ctSockaddr& remoteAddr(connectedSocket->GetRemoteAddress());
             const ctsTask nextTask = connectedSocket->GetNextTask();
+            const bool sendingConnectionId = ctsTask::BufferType::UdpConnectionId == nextTask.m_bufferType;
+            // -Pattern:Blast bursts reserve a sequence number for each of their datagrams
+            const bool sendingBurst = !sendingConnectionId && nextTask.m_coalescedSegmentSize > 0;
+            const auto sequenceNumber =
+                sendingConnectionId ? 0LL :
+                sendingBurst ? connectedSocket->ReserveSequence(nextTask.m_bufferLength / nextTask.m_coalescedSegmentSize) :
+                connectedSocket->IncrementSequence();
 
             wsIOResult returnResults;
-            if (ctsTask::BufferType::UdpConnectionId == nextTask.m_bufferType)
+            try
             {
-                // making a synchronous call
-                WSABUF wsabuffer{};
-                wsabuffer.buf = nextTask.m_buffer;
-                wsabuffer.len = nextTask.m_bufferLength;
-
-                const auto sendResult = WSASendTo(
+                const auto frame = std::make_shared<ctsMediaStreamServerFrame>(
+                    connectedSocket->weak_from_this(),
+                    remoteAddr,
                     socket,
-                    &wsabuffer,
-                    1,
-                    &returnResults.m_bytesTransferred,
-                    0,
-                    remoteAddr.sockaddr(),
-                    remoteAddr.length(),
-                    nullptr,
-                    nullptr);
-
-                if (SOCKET_ERROR == sendResult)
+                    listeningSocket->GetThreadIocp(),
+                    sequenceNumber);
+                if (connectedSocket->IsMultiplexed())
                 {
-                    const auto error = WSAGetLastError();
-                    ctsConfig::PrintErrorInfo(
-                        L"WSASendTo(%Iu, %ws) for the Connection-ID failed [%d]",
-                        socket,
-                        remoteAddr.WriteCompleteAddress().c_str(),
-                        error);
-                    return wsIOResult(error);
+                    memcpy(frame->m_streamPrefix, &c_udpDatagramProtocolHeaderFlagMultiplexed, c_udpDatagramProtocolHeaderFlagLength);
+                    memcpy(frame->m_streamPrefix + c_udpDatagramProtocolHeaderFlagLength, connectedSocket->GetStreamId().data(), ctsStatistics::c_connectionIdLength);
+                    frame->m_multiplexed = true;
                 }
-            }
-            else
-            {
-                const auto sequenceNumber = connectedSocket->IncrementSequence();
-                PRINT_DEBUG_INFO(
-                    L"\t\tctsMediaStreamServer sending seq number %lld (%lu bytes)\n",
-                    sequenceNumber,
-                    nextTask.m_bufferLength);
+                frame->m_sendSlabPool = connectedSocket->GetSendSlabPool();
 
-                ctsMediaStreamSendRequests sendingRequests(
-                    nextTask.m_bufferLength, // total bytes to send
-                    sequenceNumber,
-                    nextTask.m_buffer);
-                for (auto& sendRequest : sendingRequests)
+                if (sendingConnectionId)
                 {
-                    // making a synchronous call
-                    DWORD bytesSent{};
-                    const auto sendResult = WSASendTo(
-                        socket,
-                        sendRequest.data(),
-                        static_cast<DWORD>(sendRequest.size()),
-                        &bytesSent,
-                        0,
-                        remoteAddr.sockaddr(),
-                        remoteAddr.length(),
-                        nullptr,
-                        nullptr);
-                    if (SOCKET_ERROR == sendResult)
+                    // the Connection-ID is owned by the ctsIOPattern, which can be freed before a pended send completes
+                    FAIL_FAST_IF_MSG(
+                        nextTask.m_bufferLength > sizeof frame->m_connectionId,
+                        "ctsMediaStreamServer was given a Connection-ID of %lu bytes to send (ctsTask %p)",
+                        nextTask.m_bufferLength, &nextTask);
+                    memcpy(frame->m_connectionId, nextTask.m_buffer, nextTask.m_bufferLength);
+
+                    WSABUF wsabuffer{};
+                    wsabuffer.buf = frame->m_connectionId;
+                    wsabuffer.len = nextTask.m_bufferLength;
+
+                    const auto error = SendDatagram(*connectedSocket, frame, &wsabuffer, 1, &returnResults.m_bytesTransferred);
+                    if (error != NO_ERROR)
                     {
-                        const auto error = WSAGetLastError();
-                        if (WSAEMSGSIZE == error)
+                        ctsConfig::PrintErrorInfo(
+                            L"WSASendTo(%Iu, %ws) for the Connection-ID failed [%d]",
+                            socket,
+                            remoteAddr.WriteCompleteAddress().c_str(),
+                            error);
+                        return wsIOResult(error);
+                    }
+                }
+                else
+                {
+                    PRINT_DEBUG_INFO(
+                        L"\t\tctsMediaStreamServer sending seq number %lld (%lu bytes)\n",
+                        sequenceNumber,
+                        nextTask.m_bufferLength);
+
+                    if (sendingBurst)
+                    {
+                        const auto error = SendBurst(*connectedSocket, frame, nextTask, &returnResults.m_bytesTransferred);
+                        if (error != NO_ERROR)
                         {
-                            unsigned long bytesRequested = 0;
-                            // iterate across each WSABUF* in the array
-                            for (auto& wasbuffer : sendRequest)
-                            {
-                                bytesRequested += wasbuffer.len;
-                            }
                             ctsConfig::PrintErrorInfo(
-                                L"WSASendTo(%Iu, seq %lld, %ws) failed with WSAEMSGSIZE : attempted to send datagram of size %u bytes",
+                                L"WSASendMsg(%Iu, seq %lld, %ws) failed [%d] : attempted to send a burst of %lu datagrams",
                                 socket,
                                 sequenceNumber,
                                 remoteAddr.WriteCompleteAddress().c_str(),
-                                bytesRequested);
+                                error,
+                                nextTask.m_bufferLength / nextTask.m_coalescedSegmentSize);
+                            return wsIOResult(error);
                         }
-                        else
+                        return returnResults;
+                    }
+
+                    // offloaded frames are laid out without the stream prefix : multiplexed streams send one datagram at a time
+                    if (ctsConfig::g_configSettings->UdpSendOffload && !g_sendOffloadUnavailable.load() && !frame->m_multiplexed &&
+                        TrySendFrameWithOffload(*connectedSocket, frame, nextTask, returnResults))
+                    {
+                        return returnResults;
+                    }
+
+                    if (frame->m_sendSlabPool)
+                    {
+                        const auto error = SendFrameFromSlab(*connectedSocket, frame, nextTask, &returnResults.m_bytesTransferred);
+                        if (error != NO_ERROR)
                         {
-                            ctsConfig::PrintErrorInfo(
-                                L"WSASendTo(%Iu, seq %lld, %ws) failed [%d]",
-                                socket,
-                                sequenceNumber,
-                                remoteAddr.WriteCompleteAddress().c_str(),
-                                error);
+                            return wsIOResult(error);
                         }
-                        return wsIOResult(error);
+                        return returnResults;
                     }
 
-                    // successfully completed synchronously
-                    returnResults.m_bytesTransferred += bytesSent;
+                    frame->m_sendRequests.emplace(
+                        nextTask.m_bufferLength, // total bytes to send
+                        sequenceNumber,
+                        nextTask.m_buffer);
+                    for (auto& sendRequest : *frame->m_sendRequests)
+                    {
+                        // the QPC was just refreshed for this datagram : send it from a copy kept until the send completes
+                        auto datagram = sendRequest;
+                        auto& datagramQpc = frame->m_datagramQpc.emplace_back(*reinterpret_cast<const long long*>(datagram[2].buf));
+                        datagram[2].buf = reinterpret_cast<char*>(&datagramQpc);
+
+                        DWORD bytesSent{};
+                        const auto error = SendDatagram(
+                            *connectedSocket,
+                            frame,
+                            datagram.data(),
+                            static_cast<DWORD>(datagram.size()),
+                            &bytesSent);
+                        if (error != NO_ERROR)
+                        {
+                            if (WSAEMSGSIZE == error)
+                            {
+                                unsigned long bytesRequested = 0;
+                                // iterate across each WSABUF* in the array
+                                for (auto& wasbuffer : datagram)
+                                {
+                                    bytesRequested += wasbuffer.len;
+                                }
+                                ctsConfig::PrintErrorInfo(
+                                    L"WSASendTo(%Iu, seq %lld, %ws) failed with WSAEMSGSIZE : attempted to send datagram of size %u bytes",
+                                    socket,
+                                    sequenceNumber,
+                                    remoteAddr.WriteCompleteAddress().c_str(),
+                                    bytesRequested);
+                            }
+                            else
+                            {
+                                ctsConfig::PrintErrorInfo(
+                                    L"WSASendTo(%Iu, seq %lld, %ws) failed [%d]",
+                                    socket,
+                                    sequenceNumber,
+                                    remoteAddr.WriteCompleteAddress().c_str(),
+                                    error);
+                            }
+                            return wsIOResult(error);
+                        }
+
+                        // successfully posted
+                        returnResults.m_bytesTransferred += bytesSent;
+                    }
                 }
             }
+            catch (...)
+            {
+                return wsIOResult(static_cast<int>(ctsConfig::PrintThrownException()));
+            }
 
             return returnResults;
         }
@@ -25,6 +25,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // - ctsMediaStreamServerListener is the "Accepting" function
 //   - it will complete 'Create' ctsSocket requests as clients send in START requests
 //     it will be assumed that a client is unique when its IP:PORT are unique
+//     (or its IP:PORT and stream ID, when the client multiplexes streams over one socket)
 //
 // - ctsMediaStreamServerIo is the 'IO' function
 //   - it queues up IO to a central prioritized queue of work
@@ -45,16 +46,17 @@ namespace ctsTraffic
         void AcceptSocket(const std::weak_ptr<ctsSocket>& weakSocket);
 
         // Process the removal of a connected socket once it is completed
-        // - remove_socket takes the remote address to find the socket
+        // - remove_socket takes the remote address (and stream ID for multiplexed streams) to find the socket
         // - cannot be called from a TP callback from ctsMediaStreamServerConnectedSocket
         //   as remove_socket will deadlock as it tries to delete the ctsMediaStreamServerConnectedSocket instance
         //   (which will wait for all TP threads to complete in the d'tor)
-        void RemoveSocket(const ctl::ctSockaddr& targetAddr);
+        void RemoveSocket(const ctl::ctSockaddr& targetAddr, _In_opt_z_ const char* streamId);
 
         // Processes the incoming START request from the client
         // - if we have a waiting ctsSocket to accept it, will add it to connected_sockets
         // - else we'll queue it to awaiting_endpoints
-        void Start(SOCKET socket, const ctl::ctSockaddr& localAddr, const ctl::ctSockaddr& targetAddr);
+        // - streamId is only given when the client multiplexes streams over one socket
+        void Start(SOCKET socket, const ctl::ctSockaddr& localAddr, const ctl::ctSockaddr& targetAddr, _In_opt_z_ const char* streamId);
     }
 
     // Called to 'accept' incoming connections
@@ -31,25 +31,63 @@ using namespace ctl;
 
 namespace ctsTraffic
 {
+    ctsMediaStreamSendSlab ctsMediaStreamSendSlabPool::Acquire(size_t bytes)
+    {
+        ctsMediaStreamSendSlab slab;
+        {
+            const auto lock = m_lock.lock();
+            if (!m_slabs.empty())
+            {
+                slab = std::move(m_slabs.back());
+                m_slabs.pop_back();
+            }
+        }
+
+        const size_t slabLines = (bytes + sizeof(ctsMediaStreamSlabLine) - 1) / sizeof(ctsMediaStreamSlabLine);
+        if (slab.size() < slabLines)
+        {
+            slab.resize(slabLines);
+        }
+        return slab;
+    }
+
+    void ctsMediaStreamSendSlabPool::Release(ctsMediaStreamSendSlab&& slab) noexcept
+    {
+        const auto lock = m_lock.lock();
+        if (m_slabs.size() < c_maxPooledSlabs)
+        {
+            try
+            {
+                m_slabs.push_back(std::move(slab));
+            }
+            catch (...)
+            {
+                // the slab is just freed if it can't be kept
+            }
+        }
+    }
+
     ctsMediaStreamServerConnectedSocket::ctsMediaStreamServerConnectedSocket(
         std::weak_ptr<ctsSocket> weakSocket,
         SOCKET sendingSocket,
         ctSockaddr remoteAddr,
-        ctsMediaStreamConnectedSocketIoFunctor ioFunctor) :
+        ctsMediaStreamConnectedSocketIoFunctor ioFunctor,
+        const ctsMediaStreamId& streamId) :
         m_weakSocket(std::move(weakSocket)),
         m_ioFunctor(std::move(ioFunctor)),
         m_sendingSocket(sendingSocket),
         m_remoteAddr(std::move(remoteAddr)),
-        m_connectTime(ctTimer::SnapQpcInMillis())
+        m_streamId(streamId),
+        m_sendSlabPool(ctsConfig::g_configSettings->ContiguousDatagrams ? std::make_shared<ctsMediaStreamSendSlabPool>() : nullptr),
+        m_connectTime(ctTimer::SnapQpcInMillis()),
+        m_sendWindow(ctsConfig::g_configSettings->UdpBlast ? static_cast<long>(ctsConfig::g_configSettings->PrePostSends) : 0L)
     {
-        m_taskTimer.reset(CreateThreadpoolTimer(MediaStreamTimerCallback, this, ctsConfig::g_configSettings->pTpEnvironment));
-        THROW_LAST_ERROR_IF(!m_taskTimer);
     }
 
     ctsMediaStreamServerConnectedSocket::~ctsMediaStreamServerConnectedSocket() noexcept
     {
-        // stop the TP before letting the d'tor delete any member objects
-        m_taskTimer.reset();
+        // stop the scheduler dispatching this stream before letting the d'tor delete any member objects
+        ctsTimerWheel::Cancel(m_timerEntry);
     }
 
     void ctsMediaStreamServerConnectedSocket::ScheduleTask(const ctsTask& task) noexcept
@@ -63,15 +101,24 @@ namespace ctsTraffic
             {
                 // in this case, immediately schedule the WSASendTo
                 m_nextTask = task;
-                MediaStreamTimerCallback(nullptr, this, nullptr);
+                ScheduledTaskCallback(this);
 
             }
             else
             {
-                FILETIME ftDueTime(ctTimer::ConvertMillisToRelativeFiletime(task.m_timeOffsetMilliseconds));
-                // assign the next task *and* schedule the timer while in *this object lock
+                // assign the next task *and* schedule it while in *this object lock
                 m_nextTask = task;
-                SetThreadpoolTimer(m_taskTimer.get(), &ftDueTime, 0, 0);
+                try
+                {
+                    ctsTimerWheel::Schedule(m_timerEntry, task.m_timeOffsetMilliseconds);
+                }
+                catch (...)
+                {
+                    ctsConfig::PrintErrorInfo(
+                        L"MediaStream Server socket (%ws) failed to schedule its next frame - aborting this stream",
+                        m_remoteAddr.WriteCompleteAddress().c_str());
+                    CompleteState(WSAENOBUFS);
+                }
             }
             _Analysis_assume_lock_released_(m_objectGuard);
         }
@@ -86,7 +133,32 @@ namespace ctsTraffic
         }
     }
 
-    VOID CALLBACK ctsMediaStreamServerConnectedSocket::MediaStreamTimerCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) noexcept
+    bool ctsMediaStreamServerConnectedSocket::SendWindowFull() noexcept
+    {
+        if (0 == m_sendWindow || GetOutstandingSends() < m_sendWindow)
+        {
+            return false;
+        }
+
+        // flag the held task before checking again, so a send completing in between either sees the flag or is seen here
+        m_sendsBlocked.store(true);
+        if (GetOutstandingSends() < m_sendWindow && m_sendsBlocked.exchange(false))
+        {
+            return false;
+        }
+        return true;
+    }
+
+    void ctsMediaStreamServerConnectedSocket::ResumeSends() noexcept
+    {
+        // only the one completion which clears the flag resumes sending
+        if (m_sendWindow != 0 && m_sendsBlocked.exchange(false))
+        {
+            ScheduledTaskCallback(this);
+        }
+    }
+
+    void ctsMediaStreamServerConnectedSocket::ScheduledTaskCallback(PVOID context) noexcept
     {
         auto* thisPtr = static_cast<ctsMediaStreamServerConnectedSocket*>(context);
 
@@ -128,6 +200,13 @@ namespace ctsTraffic
                     // - post the sendto immediately instead of scheduling for later
                     if (thisPtr->m_nextTask.m_timeOffsetMilliseconds < 2)
                     {
+                        if (thisPtr->SendWindowFull())
+                        {
+                            // m_nextTask is sent once ResumeSends is called from a send completion
+                            currentTask.m_ioAction = ctsTaskAction::None;
+                            break;
+                        }
+
                         sendResults = thisPtr->m_ioFunctor(thisPtr);
                         status = lockedPattern->CompleteIo(
                             thisPtr->m_nextTask,
@@ -177,8 +256,9 @@ namespace ctsTraffic
         else if (ctsIoStatus::CompletedIo == status)
         {
             PRINT_DEBUG_INFO(
-                L"\t\tctsMediaStreamServerConnectedSocket socket (%ws) has completed its stream - closing this 'connection'\n",
-                thisPtr->m_remoteAddr.WriteCompleteAddress().c_str());
+                L"\t\tctsMediaStreamServerConnectedSocket socket (%ws) has completed its stream (%ld sends still pended) - closing this 'connection'\n",
+                thisPtr->m_remoteAddr.WriteCompleteAddress().c_str(),
+                thisPtr->GetOutstandingSends());
             thisPtr->CompleteState(sendResults.m_errorCode);
         }
         _Analysis_assume_lock_released_(thisPtr->m_objectGuard);
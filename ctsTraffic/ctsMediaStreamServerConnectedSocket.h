@@ -14,7 +14,9 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <atomic>
 #include <memory>
+#include <vector>
 // os headers
 #include <Windows.h>
 #include <WinSock2.h>
@@ -22,24 +24,55 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <wil/resource.h>
 // ctl headers
 #include <ctSockaddr.hpp>
+#include <ctMemoryGuard.hpp>
 // project headers
 #include "ctsIOTask.hpp"
+#include "ctsMediaStreamProtocol.hpp"
+#include "ctsTimerWheel.h"
 #include "ctsSocket.h"
 #include "ctsWinsockLayer.h"
 
 namespace ctsTraffic
 {
+    // -ContiguousDatagrams:on : the datagrams of a frame are laid out, headers included, in a slab of cache lines
+    struct alignas(64) ctsMediaStreamSlabLine
+    {
+        char m_bytes[64];
+    };
+    using ctsMediaStreamSendSlab = std::vector<ctsMediaStreamSlabLine>;
+
+    //
+    // The send slabs of one stream
+    // - a frame takes a slab while its sends are pended and returns it once the last completes,
+    //   so a stream reuses the same few slabs from frame to frame
+    // - shared by the stream and its frames, as a frame's sends can complete after the stream is gone
+    //
+    class ctsMediaStreamSendSlabPool
+    {
+    public:
+        // returns a slab of at least the requested bytes : its contents are not initialized
+        ctsMediaStreamSendSlab Acquire(size_t bytes);
+        void Release(ctsMediaStreamSendSlab&& slab) noexcept;
+
+    private:
+        static constexpr size_t c_maxPooledSlabs = 4;
+
+        wil::critical_section m_lock{ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
+        _Guarded_by_(m_lock) std::vector<ctsMediaStreamSendSlab> m_slabs;
+    };
+
     class ctsMediaStreamServerConnectedSocket;
     typedef std::function<wsIOResult(ctsMediaStreamServerConnectedSocket*)> ctsMediaStreamConnectedSocketIoFunctor;
 
-    class ctsMediaStreamServerConnectedSocket
+    class ctsMediaStreamServerConnectedSocket : public std::enable_shared_from_this<ctsMediaStreamServerConnectedSocket>
     {
     private:
         // the CS is mutable so we can take a lock / release a lock in const methods
         mutable wil::critical_section m_objectGuard{ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
         _Guarded_by_(object_guard) ctsTask m_nextTask;
 
-        wil::unique_threadpool_timer m_taskTimer;
+        // paces each frame from the shared ctsTimerWheel instead of a threadpool timer per stream
+        ctsTimerWheelEntry m_timerEntry{ScheduledTaskCallback, this};
 
         // this weak_socket is the weak reference to the ctsSocket tracked by ctsSocketState & ctsSocketBroker
         // used to complete the state when finished and take a shared_ptr when needing to take a reference
@@ -53,16 +86,27 @@ namespace ctsTraffic
         // thus it's not owned by this class
         const SOCKET m_sendingSocket;
         const ctl::ctSockaddr m_remoteAddr;
+        // -MultiplexStreams:on : the client shares its socket across streams, each datagram is prefixed with this ID
+        const ctsMediaStreamId m_streamId;
+        // -ContiguousDatagrams:on : the slabs each frame formats its datagrams in
+        const std::shared_ptr<ctsMediaStreamSendSlabPool> m_sendSlabPool;
 
         long long m_sequenceNumber = 0LL;
         const long long m_connectTime = 0LL;
+        // overlapped sends posted by the IO functor that have not yet completed
+        long m_outstandingSends = 0L;
+        // -Pattern:Blast : no more than -PrePostSends sends are outstanding (zero when not limited)
+        const long m_sendWindow = 0L;
+        // set while m_nextTask is held back waiting for a send to complete
+        std::atomic<bool> m_sendsBlocked{false};
 
     public:
         ctsMediaStreamServerConnectedSocket(
             std::weak_ptr<ctsSocket> weakSocket,
             SOCKET sendingSocket,
             ctl::ctSockaddr remoteAddr,
-            ctsMediaStreamConnectedSocketIoFunctor ioFunctor);
+            ctsMediaStreamConnectedSocketIoFunctor ioFunctor,
+            const ctsMediaStreamId& streamId = {});
 
         ~ctsMediaStreamServerConnectedSocket() noexcept;
 
@@ -71,6 +115,22 @@ namespace ctsTraffic
             return m_remoteAddr;
         }
 
+        const ctsMediaStreamId& GetStreamId() const noexcept
+        {
+            return m_streamId;
+        }
+
+        bool IsMultiplexed() const noexcept
+        {
+            return m_streamId[0] != '\0';
+        }
+
+        // null unless -ContiguousDatagrams:on
+        const std::shared_ptr<ctsMediaStreamSendSlabPool>& GetSendSlabPool() const noexcept
+        {
+            return m_sendSlabPool;
+        }
+
         SOCKET GetSendingSocket() const noexcept
         {
             return m_sendingSocket;
@@ -91,6 +151,31 @@ namespace ctsTraffic
             return InterlockedIncrement64(&m_sequenceNumber);
         }
 
+        // reserves the sequence numbers of a burst of datagrams, returning the first
+        long long ReserveSequence(long long count) noexcept
+        {
+            return InterlockedAdd64(&m_sequenceNumber, count) - count + 1;
+        }
+
+        // the IO functor tracks each overlapped send from when it's posted until its completion is processed
+        void SendPosted() noexcept
+        {
+            InterlockedIncrement(&m_outstandingSends);
+        }
+
+        void SendCompleted() noexcept
+        {
+            InterlockedDecrement(&m_outstandingSends);
+        }
+
+        long GetOutstandingSends() const noexcept
+        {
+            return ctl::ctMemoryGuardRead(&m_outstandingSends);
+        }
+
+        // called as each send completes : sends the task held back when the send window was full
+        void ResumeSends() noexcept;
+
         void ScheduleTask(const ctsTask& task) noexcept;
 
         void CompleteState(unsigned long errorCode) const noexcept;
@@ -102,6 +187,9 @@ namespace ctsTraffic
         ctsMediaStreamServerConnectedSocket& operator=(ctsMediaStreamServerConnectedSocket&&) = delete;
 
     private:
-        static VOID CALLBACK MediaStreamTimerCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) noexcept;
+        static void ScheduledTaskCallback(PVOID context) noexcept;
+
+        // returns true if the send window is full : m_nextTask is then held until ResumeSends
+        bool SendWindowFull() noexcept;
     };
 }
\ No newline at end of file
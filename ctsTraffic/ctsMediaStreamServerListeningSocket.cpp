@@ -15,6 +15,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <exception>
 #include <memory>
 #include <utility>
+#include <vector>
 // os headers
 #include <Windows.h>
 #include <WinSock2.h>
@@ -35,7 +36,8 @@ namespace ctsTraffic
     ctsMediaStreamServerListeningSocket::ctsMediaStreamServerListeningSocket(wil::unique_socket&& listeningSocket, ctl::ctSockaddr listeningAddr) :
         m_threadIocp(std::make_shared<ctl::ctThreadIocp>(listeningSocket.get(), ctsConfig::g_configSettings->pTpEnvironment)),
         m_listeningSocket(std::move(listeningSocket)),
-        m_listeningAddr(std::move(listeningAddr))
+        m_listeningAddr(std::move(listeningAddr)),
+        m_recvContexts(ctsConfig::g_configSettings->PrePostAcceptsLow > 0 ? ctsConfig::g_configSettings->PrePostAcceptsLow : 1)
     {
         FAIL_FAST_IF_MSG(
             !!(ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp),
@@ -63,7 +65,20 @@ namespace ctsTraffic
         return m_listeningAddr;
     }
 
+    const ctl::ctThreadIocp& ctsMediaStreamServerListeningSocket::GetThreadIocp() const noexcept
+    {
+        return *m_threadIocp;
+    }
+
     void ctsMediaStreamServerListeningSocket::InitiateRecv() noexcept
+    {
+        for (auto& recvContext : m_recvContexts)
+        {
+            InitiateRecv(recvContext);
+        }
+    }
+
+    void ctsMediaStreamServerListeningSocket::InitiateRecv(RecvContext& recvContext) noexcept
     {
         // continue to try to post a recv if the call fails
         int error = SOCKET_ERROR;
@@ -76,25 +91,25 @@ namespace ctsTraffic
                 if (m_listeningSocket)
                 {
                     WSABUF wsabuffer;
-                    wsabuffer.buf = m_recvBuffer.data();
-                    wsabuffer.len = static_cast<ULONG>(m_recvBuffer.size());
-                    ::ZeroMemory(m_recvBuffer.data(), m_recvBuffer.size());
+                    wsabuffer.buf = recvContext.m_recvBuffer.data();
+                    wsabuffer.len = static_cast<ULONG>(recvContext.m_recvBuffer.size());
+                    ::ZeroMemory(recvContext.m_recvBuffer.data(), recvContext.m_recvBuffer.size());
 
-                    m_recvFlags = 0;
-                    m_remoteAddr.set(m_remoteAddr.family(), ctl::ctSockaddr::AddressType::Any);
-                    m_remoteAddrLen = m_remoteAddr.length();
+                    recvContext.m_recvFlags = 0;
+                    recvContext.m_remoteAddr.set(recvContext.m_remoteAddr.family(), ctl::ctSockaddr::AddressType::Any);
+                    recvContext.m_remoteAddrLen = recvContext.m_remoteAddr.length();
                     OVERLAPPED* pOverlapped = m_threadIocp->new_request(
-                        [this](OVERLAPPED* pCallbackOverlapped) noexcept {
-                            RecvCompletion(pCallbackOverlapped); });
+                        [this, &recvContext](OVERLAPPED* pCallbackOverlapped) noexcept {
+                            RecvCompletion(recvContext, pCallbackOverlapped); });
 
                     error = WSARecvFrom(
                         m_listeningSocket.get(),
                         &wsabuffer,
                         1,
                         nullptr,
-                        &m_recvFlags,
-                        m_remoteAddr.sockaddr(),
-                        &m_remoteAddrLen,
+                        &recvContext.m_recvFlags,
+                        recvContext.m_remoteAddr.sockaddr(),
+                        &recvContext.m_remoteAddrLen,
                         pOverlapped,
                         nullptr);
                     if (SOCKET_ERROR == error)
@@ -155,7 +170,7 @@ namespace ctsTraffic
         }
     }
 
-    void ctsMediaStreamServerListeningSocket::RecvCompletion(OVERLAPPED* pOverlapped) noexcept
+    void ctsMediaStreamServerListeningSocket::RecvCompletion(RecvContext& recvContext, OVERLAPPED* pOverlapped) noexcept
     {
         // Cannot be holding the object_guard when calling into any pimpl-> methods
         // - will risk deadlocking the server
@@ -175,7 +190,7 @@ namespace ctsTraffic
                 }
 
                 DWORD bytesReceived;
-                if (!WSAGetOverlappedResult(m_listeningSocket.get(), pOverlapped, &bytesReceived, FALSE, &m_recvFlags))
+                if (!WSAGetOverlappedResult(m_listeningSocket.get(), pOverlapped, &bytesReceived, FALSE, &recvContext.m_recvFlags))
                 {
                     // recvfrom failed
                     const auto gle = WSAGetLastError();
@@ -200,23 +215,60 @@ namespace ctsTraffic
                 else
                 {
                     m_priorFailureWasConectionReset = false;
-                    const ctsMediaStreamMessage message(ctsMediaStreamMessage::Extract(m_recvBuffer.data(), bytesReceived));
-                    switch (message.m_action)
+
+                    // with -UdpRecvOffload the stack can coalesce a client's repeated START messages into one receive
+                    // - START is the only (fixed-length) message sent to this socket, so each copy is validated
+                    //   and the client is started once, as the duplicates would have been ignored
+                    // - a client multiplexing streams over one socket sends a START for each stream, so each is started
+                    unsigned long messageLength = bytesReceived;
+                    if (ctsConfig::g_configSettings->UdpRecvOffload && bytesReceived > c_udpDatagramStartStringLength)
+                    {
+                        messageLength = ctsMediaStreamMessage::IsMultiplexedStart(recvContext.m_recvBuffer.data(), bytesReceived) ?
+                            c_udpDatagramMultiplexedStartLength :
+                            c_udpDatagramStartStringLength;
+                    }
+
+                    // Extract throws for an empty or invalid message, so at least one START is always returned
+                    std::vector<ctsMediaStreamMessage> startMessages;
+                    unsigned long messageOffset = 0;
+                    do
+                    {
+                        const auto remainingLength = bytesReceived - messageOffset;
+                        const ctsMediaStreamMessage message(ctsMediaStreamMessage::Extract(
+                            recvContext.m_recvBuffer.data() + messageOffset,
+                            remainingLength < messageLength ? remainingLength : messageLength));
+                        if (startMessages.empty() || message.m_streamId[0] != '\0')
+                        {
+                            startMessages.push_back(message);
+                        }
+                        messageOffset += messageLength;
+                    }
+                    while (messageOffset < bytesReceived);
+
+                    switch (startMessages.front().m_action)
                     {
                         case MediaStreamAction::START:
                             PRINT_DEBUG_INFO(
                                 L"\t\tctsMediaStreamServer - processing START from %ws\n",
-                                m_remoteAddr.WriteCompleteAddress().c_str());
+                                recvContext.m_remoteAddr.WriteCompleteAddress().c_str());
 #ifndef TESTING_IGNORE_START
                             // Cannot be holding the object_guard when calling into any pimpl-> methods
-                            pimplOperation = [this]() {
-                                ctsMediaStreamServerImpl::Start(m_listeningSocket.get(), m_listeningAddr, m_remoteAddr);
+                            // - the remote address is copied as other receives can complete on this socket concurrently
+                            pimplOperation = [this, remoteAddr = recvContext.m_remoteAddr, startMessages = std::move(startMessages)]() {
+                                for (const auto& message : startMessages)
+                                {
+                                    ctsMediaStreamServerImpl::Start(
+                                        m_listeningSocket.get(),
+                                        m_listeningAddr,
+                                        remoteAddr,
+                                        message.m_streamId[0] != '\0' ? message.m_streamId.data() : nullptr);
+                                }
                             };
 #endif
                             break;
 
                         default:  // NOLINT(clang-diagnostic-covered-switch-default)
-                            FAIL_FAST_MSG("ctsMediaStreamServer - received an unexpected Action: %d (%p)\n", message.m_action, m_recvBuffer.data());
+                            FAIL_FAST_MSG("ctsMediaStreamServer - received an unexpected Action: %d (%p)\n", startMessages.front().m_action, recvContext.m_recvBuffer.data());
                     }
                 }
             }
@@ -232,8 +284,8 @@ namespace ctsTraffic
             ctsConfig::PrintThrownException();
         }
 
-        // finally post another recv
-        InitiateRecv();
+        // finally post another recv in place of the one that completed
+        InitiateRecv(recvContext);
     }
 
 } // namespace
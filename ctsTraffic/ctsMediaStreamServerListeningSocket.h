@@ -16,6 +16,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // cpp headers
 #include <array>
 #include <memory>
+#include <vector>
 // os headers
 #include <Windows.h>
 // ctl headers
@@ -37,14 +38,21 @@ namespace ctsTraffic
             ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
         _Requires_lock_held_(listeningsocket_lock) wil::unique_socket m_listeningSocket;
 
+        // each WSARecvFrom kept posted on the listening socket (-PrePostAccepts) owns its buffer and remote address
+        struct RecvContext
+        {
+            std::array<char, c_recvBufferSize> m_recvBuffer{};
+            DWORD m_recvFlags{};
+            ctl::ctSockaddr m_remoteAddr;
+            int m_remoteAddrLen{};
+        };
+
         const ctl::ctSockaddr m_listeningAddr;
-        std::array<char, c_recvBufferSize> m_recvBuffer{};
-        DWORD m_recvFlags{};
-        ctl::ctSockaddr m_remoteAddr;
-        int m_remoteAddrLen{};
+        std::vector<RecvContext> m_recvContexts;
         bool m_priorFailureWasConectionReset = false;
 
-        void RecvCompletion(OVERLAPPED* pOverlapped) noexcept;
+        void InitiateRecv(RecvContext& recvContext) noexcept;
+        void RecvCompletion(RecvContext& recvContext, OVERLAPPED* pOverlapped) noexcept;
 
     public:
         ctsMediaStreamServerListeningSocket(
@@ -57,6 +65,10 @@ namespace ctsTraffic
 
         ctl::ctSockaddr GetListeningAddress() const noexcept;
 
+        // the ctThreadIocp the MediaStream server also posts its overlapped sends to
+        const ctl::ctThreadIocp& GetThreadIocp() const noexcept;
+
+        // posts every receive kept on the listening socket
         void InitiateRecv() noexcept;
 
         // non-copyable
@@ -0,0 +1,478 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// cpp headers
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/result.h>
+// ctl headers
+#include <ctMemoryGuard.hpp>
+#include <ctSockaddr.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsIOTask.hpp"
+#include "ctsIOPattern.h"
+
+//
+// In-process memory transport (-IO:memory)
+//
+// Each client connection is paired with a server IO pattern created inside this process
+// - the two patterns exchange their buffers over a pair of in-memory ring channels : no Winsock, no kernel
+// - what remains is the cost of the ctsTraffic engine itself (IO patterns, buffer management, verification, statistics)
+//
+// Both patterns of a connection are driven from a single threadpool callback at a time, under the client socket lock
+// - so the channels need no synchronization of their own
+// - each callback runs a bounded burst of rounds, then resubmits itself so connections share the threadpool fairly
+// - the server pattern's calls are made within a ctsListeningRoleScope so it sees itself as the listening side
+//
+// Rate limiting delays (m_timeOffsetMilliseconds) are ignored : this transport measures the engine's ceiling
+//
+namespace ctsTraffic
+{
+    namespace MemoryIo
+    {
+        // the number of rounds (each side initiating and completing all it can) per threadpool callback
+        constexpr unsigned long c_roundsPerBurst = 64UL;
+        // every channel can hold at least this much, and at least 2 of the largest buffers
+        constexpr unsigned long c_minimumChannelCapacity = 4UL * 1024UL * 1024UL;
+
+        static long long g_targetCounter = 0LL;
+        static ctsStatsTracking g_connectionsCompleted;
+
+        // one direction of the connection : a ring buffer with monotonically increasing read and write offsets
+        class ctsMemoryChannel
+        {
+        public:
+            explicit ctsMemoryChannel(unsigned long capacity) :
+                m_buffer(capacity)
+            {
+            }
+
+            [[nodiscard]] unsigned long long Available() const noexcept
+            {
+                return m_writeOffset - m_readOffset;
+            }
+
+            [[nodiscard]] unsigned long long Free() const noexcept
+            {
+                return m_buffer.size() - Available();
+            }
+
+            [[nodiscard]] bool Write(_In_reads_bytes_(length) const char* buffer, unsigned long length) noexcept
+            {
+                if (Free() < length)
+                {
+                    return false;
+                }
+                Copy(m_writeOffset, const_cast<char*>(buffer), length, true);
+                m_writeOffset += length;
+                return true;
+            }
+
+            [[nodiscard]] unsigned long Read(_Out_writes_bytes_(length) char* buffer, unsigned long length) noexcept
+            {
+                const auto toRead = static_cast<unsigned long>(std::min<unsigned long long>(Available(), length));
+                Copy(m_readOffset, buffer, toRead, false);
+                m_readOffset += toRead;
+                return toRead;
+            }
+
+            // the writing side called shutdown(SD_SEND) : recvs complete with 0 bytes once all data is read
+            bool m_fin = false;
+            // the writing side was hard-closed : recvs fail with WSAECONNRESET
+            bool m_reset = false;
+
+        private:
+            void Copy(unsigned long long offset, char* buffer, unsigned long length, bool toChannel) noexcept
+            {
+                const auto capacity = m_buffer.size();
+                const auto start = static_cast<size_t>(offset % capacity);
+                const auto firstLength = std::min<size_t>(length, capacity - start);
+                if (toChannel)
+                {
+                    memcpy(m_buffer.data() + start, buffer, firstLength);
+                    memcpy(m_buffer.data(), buffer + firstLength, length - firstLength);
+                }
+                else
+                {
+                    memcpy(buffer, m_buffer.data() + start, firstLength);
+                    memcpy(buffer + firstLength, m_buffer.data(), length - firstLength);
+                }
+            }
+
+            std::vector<char> m_buffer;
+            unsigned long long m_readOffset = 0ULL;
+            unsigned long long m_writeOffset = 0ULL;
+        };
+
+        // one end of the connection : its IO pattern and the tasks it has outstanding
+        struct ctsMemoryEndpoint
+        {
+            std::shared_ptr<ctsIoPattern> m_pattern;
+            ctsMemoryChannel* m_outbound = nullptr;
+            ctsMemoryChannel* m_inbound = nullptr;
+            std::deque<ctsTask> m_pendingSends;
+            std::deque<ctsTask> m_pendingRecvs;
+            unsigned long m_error = NO_ERROR;
+            bool m_listening = false;
+            bool m_done = false;
+        };
+
+        class ctsMemoryConnection
+        {
+        public:
+            ctsMemoryConnection(std::weak_ptr<ctsSocket> weakSocket, std::shared_ptr<ctsIoPattern> clientPattern, std::shared_ptr<ctsIoPattern> serverPattern, unsigned long channelCapacity) :
+                m_weakSocket(std::move(weakSocket)),
+                m_clientToServer(channelCapacity),
+                m_serverToClient(channelCapacity)
+            {
+                m_client.m_pattern = std::move(clientPattern);
+                m_client.m_outbound = &m_clientToServer;
+                m_client.m_inbound = &m_serverToClient;
+                m_client.m_listening = false;
+
+                m_server.m_pattern = std::move(serverPattern);
+                m_server.m_outbound = &m_serverToClient;
+                m_server.m_inbound = &m_clientToServer;
+                m_server.m_listening = true;
+            }
+
+            ~ctsMemoryConnection() noexcept
+            {
+                // the server pattern can reference the role it was created under while being destroyed
+                const ctsConfig::ctsListeningRoleScope serverRole(true);
+                m_server.m_pattern.reset();
+            }
+
+            ctsMemoryConnection(const ctsMemoryConnection&) = delete;
+            ctsMemoryConnection& operator=(const ctsMemoryConnection&) = delete;
+            ctsMemoryConnection(ctsMemoryConnection&&) = delete;
+            ctsMemoryConnection& operator=(ctsMemoryConnection&&) = delete;
+
+            [[nodiscard]] std::shared_ptr<ctsSocket> LockSocket() const noexcept
+            {
+                return m_weakSocket.lock();
+            }
+
+            // runs one burst of rounds : returns true if the connection has completed
+            // - on completion, the error to complete the client's ctsSocket with is written to *completionError
+            bool RunBurst(_Out_ unsigned long* completionError) noexcept
+            {
+                *completionError = NO_ERROR;
+                for (auto round = 0UL; round < c_roundsPerBurst; ++round)
+                {
+                    if (ctsConfig::ShutdownCalled())
+                    {
+                        *completionError = m_client.m_done ? m_client.m_error : static_cast<unsigned long>(WSAECONNABORTED);
+                        return true;
+                    }
+
+                    auto progress = false;
+                    if (!m_client.m_done)
+                    {
+                        progress |= Step(m_client);
+                    }
+                    if (!m_server.m_done)
+                    {
+                        progress |= Step(m_server);
+                    }
+
+                    // the server finishing is not reported : the client pattern fails a connection whose server did not complete
+                    if (m_client.m_done && (m_server.m_done || !progress))
+                    {
+                        *completionError = m_client.m_error;
+                        return true;
+                    }
+                    if (!progress)
+                    {
+                        // both sides are blocked on the other : as a real connection would stall
+                        *completionError = WSAECONNABORTED;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+        private:
+            // initiates and completes all the IO the endpoint can : returns true if any progress was made
+            static bool Step(ctsMemoryEndpoint& endpoint) noexcept
+            {
+                const ctsConfig::ctsListeningRoleScope role(endpoint.m_listening);
+
+                auto progress = false;
+                while (!endpoint.m_done)
+                {
+                    const ctsTask nextTask = endpoint.m_pattern->InitiateIo();
+                    if (ctsTaskAction::None == nextTask.m_ioAction)
+                    {
+                        break;
+                    }
+
+                    progress = true;
+                    switch (nextTask.m_ioAction)
+                    {
+                        case ctsTaskAction::Send:
+                            endpoint.m_pendingSends.push_back(nextTask);
+                            break;
+
+                        case ctsTaskAction::Recv:
+                            endpoint.m_pendingRecvs.push_back(nextTask);
+                            break;
+
+                        case ctsTaskAction::GracefulShutdown:
+                            endpoint.m_outbound->m_fin = true;
+                            Complete(endpoint, nextTask, 0, NO_ERROR);
+                            break;
+
+                        case ctsTaskAction::HardShutdown:
+                        case ctsTaskAction::Abort:
+                        case ctsTaskAction::FatalAbort:
+                            endpoint.m_outbound->m_fin = true;
+                            endpoint.m_outbound->m_reset = true;
+                            Complete(endpoint, nextTask, 0, NO_ERROR);
+                            break;
+
+                        default:
+                            FAIL_FAST_MSG("ctsMemoryIo : unknown ctsTaskAction (%u)", static_cast<unsigned>(nextTask.m_ioAction));
+                    }
+                }
+
+                // sends complete, in order, once the whole buffer fits in the channel
+                while (!endpoint.m_done && !endpoint.m_pendingSends.empty())
+                {
+                    const ctsTask& sendTask = endpoint.m_pendingSends.front();
+                    if (!endpoint.m_outbound->Write(sendTask.m_buffer + sendTask.m_bufferOffset, sendTask.m_bufferLength))
+                    {
+                        break;
+                    }
+
+                    const ctsTask completedTask = sendTask;
+                    endpoint.m_pendingSends.pop_front();
+                    Complete(endpoint, completedTask, completedTask.m_bufferLength, NO_ERROR);
+                    progress = true;
+                }
+
+                // recvs complete, in order, with whatever is available (as a stream socket would)
+                while (!endpoint.m_done && !endpoint.m_pendingRecvs.empty())
+                {
+                    const ctsTask& recvTask = endpoint.m_pendingRecvs.front();
+                    unsigned long transferred = 0;
+                    unsigned long status = NO_ERROR;
+                    if (endpoint.m_inbound->Available() > 0)
+                    {
+                        transferred = endpoint.m_inbound->Read(recvTask.m_buffer + recvTask.m_bufferOffset, recvTask.m_bufferLength);
+                    }
+                    else if (endpoint.m_inbound->m_reset)
+                    {
+                        status = WSAECONNRESET;
+                    }
+                    else if (!endpoint.m_inbound->m_fin)
+                    {
+                        break;
+                    }
+
+                    const ctsTask completedTask = recvTask;
+                    endpoint.m_pendingRecvs.pop_front();
+                    Complete(endpoint, completedTask, transferred, status);
+                    progress = true;
+                }
+
+                return progress;
+            }
+
+            static void Complete(ctsMemoryEndpoint& endpoint, const ctsTask& task, unsigned long transferred, unsigned long status) noexcept
+            {
+                switch (endpoint.m_pattern->CompleteIo(task, transferred, status))
+                {
+                    case ctsIoStatus::ContinueIo:
+                        break;
+
+                    case ctsIoStatus::CompletedIo:
+                        endpoint.m_done = true;
+                        endpoint.m_error = NO_ERROR;
+                        break;
+
+                    case ctsIoStatus::FailedIo:
+                        endpoint.m_done = true;
+                        endpoint.m_error = endpoint.m_pattern->GetLastPatternError();
+                        break;
+
+                    default:
+                        FAIL_FAST_MSG("ctsMemoryIo : unknown ctsSocket::IOStatus");
+                }
+            }
+
+            const std::weak_ptr<ctsSocket> m_weakSocket;
+            ctsMemoryChannel m_clientToServer;
+            ctsMemoryChannel m_serverToClient;
+            ctsMemoryEndpoint m_client;
+            ctsMemoryEndpoint m_server;
+        };
+
+        // threadpool callback running one burst of a connection
+        // - owns the ctsMemoryConnection : released back to the threadpool while the connection continues
+        static void NTAPI ctsMemoryIoCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID context) noexcept
+        {
+            std::unique_ptr<ctsMemoryConnection> connection(static_cast<ctsMemoryConnection*>(context));
+
+            const auto sharedSocket(connection->LockSocket());
+            if (!sharedSocket)
+            {
+                return;
+            }
+
+            unsigned long completionError = NO_ERROR;
+            {
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                if (!lockedSocket.GetPattern())
+                {
+                    // the socket was closed underneath this connection
+                    completionError = WSAECONNABORTED;
+                }
+                else if (!connection->RunBurst(&completionError))
+                {
+                    if (TrySubmitThreadpoolCallback(ctsMemoryIoCallback, connection.get(), ctsConfig::g_configSettings->pTpEnvironment))
+                    {
+                        connection.release();
+                        return;
+                    }
+                    completionError = GetLastError();
+                    ctsConfig::PrintErrorIfFailed("TrySubmitThreadpoolCallback", completionError);
+                }
+            }
+
+            // the server pattern is released before the client's ctsSocket completes
+            connection.reset();
+            g_connectionsCompleted.Increment();
+            if (sharedSocket->DecrementIo() == 0)
+            {
+                sharedSocket->CompleteState(completionError);
+            }
+        }
+    }
+
+    void ctsMemorySocket(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        // ctsConfig guarantees at least one -Target : only displayed, as nothing is sent over the network
+        const auto targetSize = ctsConfig::g_configSettings->TargetAddresses.size();
+        const auto targetCounter = ctl::ctMemoryGuardIncrement(&MemoryIo::g_targetCounter);
+        const ctl::ctSockaddr targetAddr(ctsConfig::g_configSettings->TargetAddresses[targetCounter % targetSize]);
+        const ctl::ctSockaddr localAddr(targetAddr.family(), ctl::ctSockaddr::AddressType::Loopback);
+
+        sharedSocket->SetLocalSockaddr(localAddr);
+        sharedSocket->SetRemoteSockaddr(targetAddr);
+        sharedSocket->CompleteState(NO_ERROR);
+    }
+
+    void ctsMemoryConnect(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        ctsConfig::PrintNewConnection(sharedSocket->GetLocalSockaddr(), sharedSocket->GetRemoteSockaddr());
+        sharedSocket->CompleteState(NO_ERROR);
+    }
+
+    void ctsMemoryIo(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        unsigned long error = NO_ERROR;
+        // hold a reference on the socket across the lifetime of the connection
+        sharedSocket->IncrementIo();
+        try
+        {
+            const auto lockedSocket = sharedSocket->AcquireSocketLock();
+            auto clientPattern = lockedSocket.GetPattern();
+            if (!clientPattern)
+            {
+                error = WSAECONNABORTED;
+            }
+            else
+            {
+                std::shared_ptr<ctsIoPattern> serverPattern;
+                {
+                    const ctsConfig::ctsListeningRoleScope serverRole(true);
+                    serverPattern = ctsIoPattern::MakeIoPattern();
+                }
+                // the server pattern shares the client socket (and so its lock)
+                serverPattern->SetParent(sharedSocket);
+
+                const unsigned long channelCapacity = std::max<unsigned long>(MemoryIo::c_minimumChannelCapacity, ctsConfig::GetMaxBufferSize() * 2UL);
+                auto connection = std::make_unique<MemoryIo::ctsMemoryConnection>(weakSocket, std::move(clientPattern), std::move(serverPattern), channelCapacity);
+                if (TrySubmitThreadpoolCallback(MemoryIo::ctsMemoryIoCallback, connection.get(), ctsConfig::g_configSettings->pTpEnvironment))
+                {
+                    connection.release();
+                    return;
+                }
+                error = GetLastError();
+                ctsConfig::PrintErrorIfFailed("TrySubmitThreadpoolCallback", error);
+            }
+        }
+        catch (...)
+        {
+            error = ctsConfig::PrintThrownException();
+        }
+
+        if (sharedSocket->DecrementIo() == 0)
+        {
+            sharedSocket->CompleteState(error);
+        }
+    }
+
+    void ctsMemoryPrintSummary(long long totalTimeMilliseconds) noexcept
+    {
+        if (!ctsConfig::g_configSettings->MemoryTransport)
+        {
+            return;
+        }
+
+        const auto& tcpStatus = ctsConfig::g_configSettings->TcpStatusDetails;
+        // both patterns of every connection count their bytes : the bytes sent by either side is the total moved
+        const auto bytesMoved = tcpStatus.m_bytesSent.GetValue();
+        const auto ioCompletions = tcpStatus.m_ioCompletions.GetValue();
+        const auto seconds = totalTimeMilliseconds > 0 ? static_cast<double>(totalTimeMilliseconds) / 1000.0 : 0.0;
+        ctsConfig::PrintSummary(
+            L"\n"
+            L"  Memory Transport (engine ceiling, no network) :\n"
+            L"    Bytes Moved : %lld (%.3f MB/sec)\n"
+            L"    IO Completions : %lld (%.0f per sec, client and server combined)\n"
+            L"    Connections : %lld\n",
+            bytesMoved,
+            seconds > 0.0 ? static_cast<double>(bytesMoved) / 1048576.0 / seconds : 0.0,
+            ioCompletions,
+            seconds > 0.0 ? static_cast<double>(ioCompletions) / seconds : 0.0,
+            MemoryIo::g_connectionsCompleted.GetValue());
+    }
+}
@@ -0,0 +1,155 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// declaration header
+#include "ctsPerfCounters.h"
+// cpp headers
+#include <string>
+// wil headers
+#include <wil/result.h>
+#include <wil/stl.h>
+#include <wil/win32_helpers.h>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    namespace
+    {
+        // these must match the providerGuid and counterSet guid in ctsTrafficCounters.man
+        // {6d4b1f3e-2a9c-4e57-8b0d-7c3a5e1f9b24}
+        constexpr GUID c_providerGuid{ 0x6d4b1f3e, 0x2a9c, 0x4e57, { 0x8b, 0x0d, 0x7c, 0x3a, 0x5e, 0x1f, 0x9b, 0x24 } };
+        // {b8e27c51-94d3-4f06-a1e9-3c5d7b2f0a68}
+        constexpr GUID c_counterSetGuid{ 0xb8e27c51, 0x94d3, 0x4f06, { 0xa1, 0xe9, 0x3c, 0x5d, 0x7b, 0x2f, 0x0a, 0x68 } };
+
+        // the counter ids match the counter ids in ctsTrafficCounters.man
+        enum CounterId : ULONG
+        {
+            BytesSentPerSecond = 1,
+            BytesReceivedPerSecond = 2,
+            ActiveConnections = 3,
+            SuccessfulConnections = 4,
+            ConnectionErrors = 5,
+            ProtocolErrors = 6,
+            DroppedFrames = 7,
+            RioCompletionQueueUsed = 8
+        };
+        constexpr ULONG c_counterCount = 8;
+
+        // every counter is a ULONGLONG laid out in CounterId order in the instance data block
+        constexpr PERF_COUNTER_INFO MakeCounterInfo(ULONG counterId, ULONG type) noexcept
+        {
+            return PERF_COUNTER_INFO{
+                counterId,
+                type,
+                PERF_ATTRIB_BY_VALUE,
+                sizeof(ULONGLONG),
+                PERF_DETAIL_NOVICE,
+                0,
+                (counterId - 1) * static_cast<ULONG>(sizeof(ULONGLONG)) };
+        }
+
+        // PerfSetCounterSetInfo requires the counter infos to directly follow the counter set info
+        struct ctsCounterSetTemplate
+        {
+            PERF_COUNTERSET_INFO m_counterSet;
+            PERF_COUNTER_INFO m_counters[c_counterCount];
+        };
+
+        const ctsCounterSetTemplate c_counterSetTemplate{
+            PERF_COUNTERSET_INFO{ c_counterSetGuid, c_providerGuid, c_counterCount, PERF_COUNTERSET_MULTI_INSTANCES },
+            {
+                // per-second rates are computed by the consumer from the running totals
+                MakeCounterInfo(BytesSentPerSecond, PERF_COUNTER_BULK_COUNT),
+                MakeCounterInfo(BytesReceivedPerSecond, PERF_COUNTER_BULK_COUNT),
+                MakeCounterInfo(ActiveConnections, PERF_COUNTER_LARGE_RAWCOUNT),
+                MakeCounterInfo(SuccessfulConnections, PERF_COUNTER_LARGE_RAWCOUNT),
+                MakeCounterInfo(ConnectionErrors, PERF_COUNTER_LARGE_RAWCOUNT),
+                MakeCounterInfo(ProtocolErrors, PERF_COUNTER_LARGE_RAWCOUNT),
+                MakeCounterInfo(DroppedFrames, PERF_COUNTER_LARGE_RAWCOUNT),
+                MakeCounterInfo(RioCompletionQueueUsed, PERF_COUNTER_LARGE_RAWCOUNT)
+            }
+        };
+    }
+
+    ctsPerfCounters::ctsPerfCounters() noexcept
+    {
+        try
+        {
+            THROW_IF_WIN32_ERROR(PerfStartProviderEx(const_cast<GUID*>(&c_providerGuid), nullptr, &m_provider));
+
+            auto stopProviderOnError = wil::scope_exit([&]() noexcept {
+                PerfStopProvider(m_provider);
+                m_provider = nullptr;
+            });
+
+            THROW_IF_WIN32_ERROR(PerfSetCounterSetInfo(
+                m_provider,
+                const_cast<PPERF_COUNTERSET_INFO>(&c_counterSetTemplate.m_counterSet),
+                sizeof c_counterSetTemplate));
+
+            const auto instanceName = wil::str_printf<std::wstring>(L"ctsTraffic_%lu", GetCurrentProcessId());
+            m_instance = PerfCreateInstance(m_provider, &c_counterSetGuid, instanceName.c_str(), GetCurrentProcessId());
+            THROW_LAST_ERROR_IF_NULL(m_instance);
+
+            stopProviderOnError.release();
+        }
+        CATCH_LOG()
+    }
+
+    ctsPerfCounters::~ctsPerfCounters() noexcept
+    {
+        if (m_instance)
+        {
+            LOG_IF_WIN32_ERROR(PerfDeleteInstance(m_provider, m_instance));
+        }
+        if (m_provider)
+        {
+            LOG_IF_WIN32_ERROR(PerfStopProvider(m_provider));
+        }
+    }
+
+    void ctsPerfCounters::Update() const noexcept
+    {
+        if (!m_instance)
+        {
+            return;
+        }
+
+        const auto setCounter = [&](ULONG counterId, long long value) noexcept {
+            PerfSetULongLongCounterValue(m_provider, m_instance, counterId, static_cast<ULONGLONG>(value));
+        };
+
+        auto& connectionStatus = ctsConfig::g_configSettings->ConnectionStatusDetails;
+        setCounter(ActiveConnections, connectionStatus.m_activeConnectionCount.GetValue());
+        setCounter(SuccessfulConnections, connectionStatus.m_successfulCompletionCount.GetValue());
+        setCounter(ConnectionErrors, connectionStatus.m_connectionErrorCount.GetValue());
+        setCounter(ProtocolErrors, connectionStatus.m_protocolErrorCount.GetValue());
+
+        if (ctsConfig::ProtocolType::TCP == ctsConfig::g_configSettings->Protocol)
+        {
+            auto& tcpStatus = ctsConfig::g_configSettings->TcpStatusDetails;
+            setCounter(BytesSentPerSecond, tcpStatus.m_bytesSent.GetValue());
+            setCounter(BytesReceivedPerSecond, tcpStatus.m_bytesRecv.GetValue());
+            setCounter(RioCompletionQueueUsed, tcpStatus.m_rioCompletionQueueUsed.GetValue());
+        }
+        else
+        {
+            // MediaStream only tracks what the client received
+            auto& udpStatus = ctsConfig::g_configSettings->UdpStatusDetails;
+            setCounter(BytesReceivedPerSecond, udpStatus.GetBytesReceived());
+            setCounter(DroppedFrames, udpStatus.m_droppedFrames.GetValue());
+        }
+    }
+}
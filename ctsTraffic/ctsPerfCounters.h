@@ -0,0 +1,58 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// os headers
+#include <Windows.h>
+#include <perflib.h>
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsPerfCounters
+    ///
+    /// Publishes the running ctsConfigSettings statistics as a PerfLib V2 counter set
+    /// - so perfmon, ctsPerf and other PDH consumers can collect them alongside OS and NIC counters
+    /// - one instance per process, named "ctsTraffic_<pid>", so concurrent runs can be told apart
+    /// - consumers only see the counter set once ctsTrafficCounters.man is registered:
+    ///     lodctr /m:ctsTrafficCounters.man [path to ctsTraffic.exe]
+    ///   the counter values are still published (and ignored) if the manifest isn't registered
+    /// - failing to start the provider is not fatal: ctsTraffic runs without the counters
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsPerfCounters
+    {
+    public:
+        ctsPerfCounters() noexcept;
+        ~ctsPerfCounters() noexcept;
+
+        // snaps the current statistics into the counter set instance
+        // - called from the perf counter timer; must not be called concurrently
+        void Update() const noexcept;
+
+        ctsPerfCounters(const ctsPerfCounters&) = delete;
+        ctsPerfCounters& operator=(const ctsPerfCounters&) = delete;
+        ctsPerfCounters(ctsPerfCounters&&) = delete;
+        ctsPerfCounters& operator=(ctsPerfCounters&&) = delete;
+
+        // the sample interval matches the default perfmon sample interval
+        static constexpr unsigned long c_updateFrequencyMilliseconds = 1000UL;
+
+    private:
+        HANDLE m_provider = nullptr;
+        PPERF_COUNTERSET_INSTANCE m_instance = nullptr;
+    };
+}
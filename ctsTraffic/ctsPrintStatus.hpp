@@ -14,9 +14,16 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <array>
 #include <cwchar>
+#include <string>
+#include <vector>
 // os headers
 #include <Windows.h>
+#include <Psapi.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
 // project headers
 #include "ctsConfig.h"
 
@@ -32,10 +39,12 @@ namespace ctsTraffic
             NoPrint
         };
 
+        // expanded beyond 80 to handle very long IPv6 address strings and TCP latency, heartbeat, CPU and host counter columns
+        // - derived classes static_assert their widest row fits
+        static const unsigned long c_outputBufferSize = 1024;
+
     private:
-        // expanded beyond 80 to handle very long IPv6 address strings
-        // - buffer is expected to be protected by only a single caller at a time
-        static const unsigned long c_outputBufferSize = 128;
+        // buffer is expected to be protected by only a single caller at a time
         // one more for the null terminator
         wchar_t m_outputBuffer[c_outputBufferSize + 1]{};
 
@@ -356,6 +365,20 @@ namespace ctsTraffic
         {
             if (ctsConfig::StatusFormatting::ConsoleOutput == format)
             {
+                if (IsPrintingSendCalls())
+                {
+                    return
+                        L"Legend:\n"
+                        L"* TimeSlice - (seconds) cumulative runtime\n"
+                        L"* Streams - count of current number of UDP streams\n"
+                        L"* Bits/Sec - bits streamed within the TimeSlice period\n"
+                        L"* Completed Frames - count of frames successfully processed within the TimeSlice\n"
+                        L"* Dropped Frames - count of frames that were never seen within the TimeSlice\n"
+                        L"* Repeated Frames - count of frames received multiple times within the TimeSlice\n"
+                        L"* Stream Errors - count of invalid frames or buffers within the TimeSlice\n"
+                        L"* Sends/Sec - send calls made per second within the TimeSlice period\n"
+                        L"\n";
+                }
                 return
                     L"Legend:\n"
                     L"* TimeSlice - (seconds) cumulative runtime\n"
@@ -367,6 +390,20 @@ namespace ctsTraffic
                     L"* Stream Errors - count of invalid frames or buffers within the TimeSlice\n"
                     L"\n";
             }
+            if (IsPrintingSendCalls())
+            {
+                return
+                    L"Legend:\r\n"
+                    L"* TimeSlice - (seconds) cumulative runtime\r\n"
+                    L"* Streams - count of current number of UDP streams\r\n"
+                    L"* Bits/Sec - bits streamed within the TimeSlice period\r\n"
+                    L"* Completed Frames - count of frames successfully processed within the TimeSlice\r\n"
+                    L"* Dropped Frames - count of frames that were never seen within the TimeSlice\r\n"
+                    L"* Repeated Frames - count of frames received multiple times within the TimeSlice\r\n"
+                    L"* Stream Errors - count of invalid frames or buffers within the TimeSlice\r\n"
+                    L"* Sends/Sec - send calls made per second within the TimeSlice period\r\n"
+                    L"\r\n";
+            }
             else
             {
                 return
@@ -386,11 +423,24 @@ namespace ctsTraffic
         {
             if (ctsConfig::StatusFormatting::Csv == format)
             {
+                if (IsPrintingSendCalls())
+                {
+                    return
+                        L"TimeSlice,Bits/Sec,Streams,Completed,Dropped,Repeated,Errors,Sends/Sec\r\n";
+                }
                 return
                     L"TimeSlice,Bits/Sec,Streams,Completed,Dropped,Repeated,Errors\r\n";
 
             }
 
+            if (IsPrintingSendCalls())
+            {
+                // the send calls column extends the line to 90 columns
+                return format == ctsConfig::StatusFormatting::ConsoleOutput ?
+                    L" TimeSlice       Bits/Sec    Streams   Completed   Dropped   Repeated    Errors  Sends/Sec \n" :
+                    L" TimeSlice       Bits/Sec    Streams   Completed   Dropped   Repeated    Errors  Sends/Sec \r\n";
+            }
+
             if (ctsConfig::StatusFormatting::ConsoleOutput == format)
             {
                 // Formatted to fit on an 80-column command shell
@@ -409,14 +459,18 @@ namespace ctsTraffic
         {
             const ctsUdpStatistics udpData(ctsConfig::g_configSettings->UdpStatusDetails.SnapView(clearStatus));
             const ctsConnectionStatistics connectionData(ctsConfig::g_configSettings->ConnectionStatusDetails.SnapView(clearStatus));
+            const bool printSendCalls = IsPrintingSendCalls();
+            const long long sendCalls = printSendCalls ? ctsConfig::g_configSettings->UdpStatusDetails.SnapSendCalls(clearStatus) : 0LL;
+
+            // calculating # of bytes that were received between the previous format() and current call to format()
+            const long long timeElapsed = udpData.m_endTime.GetValue() - udpData.m_startTime.GetValue();
+            const long long sendCallsPerSecond = timeElapsed > 0LL ? sendCalls * 1000LL / timeElapsed : 0LL;
 
             if (ctsConfig::StatusFormatting::Csv == format)
             {
                 unsigned long charactersWritten = 0;
                 // converting milliseconds to seconds before printing
                 charactersWritten += AppendCsvOutput(charactersWritten, c_timeSliceLength, static_cast<float>(currentTime) / 1000.0f);
-                // calculating # of bytes that were received between the previous format() and current call to format()
-                const long long timeElapsed = udpData.m_endTime.GetValue() - udpData.m_startTime.GetValue();
                 charactersWritten += AppendCsvOutput(
                     charactersWritten,
                     c_bitsPerSecondLength,
@@ -426,15 +480,17 @@ namespace ctsTraffic
                 charactersWritten += AppendCsvOutput(charactersWritten, c_competedFramesLength, udpData.m_successfulFrames.GetValue());
                 charactersWritten += AppendCsvOutput(charactersWritten, c_droppedFramesLength, udpData.m_droppedFrames.GetValue());
                 charactersWritten += AppendCsvOutput(charactersWritten, c_duplicatedFramesLength, udpData.m_duplicateFrames.GetValue());
-                charactersWritten += AppendCsvOutput(charactersWritten, c_errorFramesLength, udpData.m_errorFrames.GetValue(), false); // no comma at the end
+                charactersWritten += AppendCsvOutput(charactersWritten, c_errorFramesLength, udpData.m_errorFrames.GetValue(), printSendCalls); // no comma at the end unless printing send calls
+                if (printSendCalls)
+                {
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_sendCallsPerSecondLength, sendCallsPerSecond, false); // no comma at the end
+                }
                 TerminateFileString(charactersWritten);
             }
             else
             {
                 // converting milliseconds to seconds before printing
                 RightJustifyOutput(c_timeSliceOffset, c_timeSliceLength, static_cast<float>(currentTime) / 1000.0f);
-                // calculating # of bytes that were received between the previous format() and current call to format()
-                const long long timeElapsed = udpData.m_endTime.GetValue() - udpData.m_startTime.GetValue();
                 RightJustifyOutput(
                     c_bitsPerSecondOffset,
                     c_bitsPerSecondLength,
@@ -445,13 +501,19 @@ namespace ctsTraffic
                 RightJustifyOutput(c_droppedFramesOffset, c_droppedFramesLength, udpData.m_droppedFrames.GetValue());
                 RightJustifyOutput(c_duplicatedFramesOffset, c_duplicatedFramesLength, udpData.m_duplicateFrames.GetValue());
                 RightJustifyOutput(c_errorFramesOffset, c_errorFramesLength, udpData.m_errorFrames.GetValue());
+                if (printSendCalls)
+                {
+                    RightJustifyOutput(c_sendCallsPerSecondOffset, c_sendCallsPerSecondLength, sendCallsPerSecond);
+                }
+
+                const auto lastOffset = printSendCalls ? c_sendCallsPerSecondOffset : c_errorFramesOffset;
                 if (format == ctsConfig::StatusFormatting::ConsoleOutput)
                 {
-                    TerminateString(c_errorFramesOffset);
+                    TerminateString(lastOffset);
                 }
                 else
                 {
-                    TerminateFileString(c_errorFramesOffset);
+                    TerminateFileString(lastOffset);
                 }
             }
             return PrintingStatus::PrintComplete;
@@ -459,6 +521,12 @@ namespace ctsTraffic
 
 
     private:
+        // send calls are only made by MediaStream servers - showing the effect of -UdpSendOffload
+        static bool IsPrintingSendCalls() noexcept
+        {
+            return !ctsConfig::g_configSettings->ListenAddresses.empty();
+        }
+
         // constant offsets for each numeric value to print
         static const unsigned long c_timeSliceOffset = 10;
         static const unsigned long c_timeSliceLength = 10;
@@ -480,6 +548,9 @@ namespace ctsTraffic
 
         static const unsigned long c_errorFramesOffset = 79;
         static const unsigned long c_errorFramesLength = 7;
+
+        static const unsigned long c_sendCallsPerSecondOffset = 90;
+        static const unsigned long c_sendCallsPerSecondLength = 10;
     };
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -504,9 +575,66 @@ namespace ctsTraffic
         {
             const ctsTcpStatistics tcpData(ctsConfig::g_configSettings->TcpStatusDetails.SnapView(clearStatus));
             const ctsConnectionStatistics connectionData(ctsConfig::g_configSettings->ConnectionStatusDetails.SnapView(clearStatus));
+            const bool printRio = IsPrintingRio();
+            const double rioCompletionsPerDequeue = printRio ? ctsConfig::g_configSettings->TcpStatusDetails.SnapRioCompletionsPerDequeue(clearStatus) : 0.0;
+            const double rioPostsPerCommit = printRio ? ctsConfig::g_configSettings->TcpStatusDetails.SnapRioPostsPerCommit(clearStatus) : 0.0;
+            const bool printLatency = IsPrintingLatency();
+            // only snapping the latency histograms when printing them (each snapshot is a few KB)
+            ctsLatencySnapshot latencyData;
+            ctsLatencySnapshot connectionLatencyData;
+            if (printLatency)
+            {
+                latencyData = ctsConfig::g_configSettings->TcpStatusDetails.m_ioLatency.SnapView(clearStatus);
+                connectionLatencyData = ctsConfig::g_configSettings->TcpStatusDetails.m_connectionLatency.SnapView(clearStatus);
+            }
+            const bool printHeartbeat = IsPrintingHeartbeat();
+            ctsLatencySnapshot heartbeatLatencyData;
+            long long workingSetPerConnection = 0;
+            long long committedMegabytes = 0;
+            if (printHeartbeat)
+            {
+                heartbeatLatencyData = ctsConfig::g_configSettings->TcpStatusDetails.m_transactionLatency.SnapView(clearStatus);
+                SnapProcessMemory(connectionData.m_activeConnectionCount.GetValue(), workingSetPerConnection, committedMegabytes);
+            }
+            const bool printProbes = IsPrintingProbes();
+            ctsLatencySnapshot probeLatencyData;
+            if (printProbes)
+            {
+                probeLatencyData = ctsConfig::g_configSettings->TcpStatusDetails.m_probeLatency.SnapView(clearStatus);
+            }
+            const bool printAcceptEx = IsPrintingAcceptEx();
+            const long long acceptExPosted = printAcceptEx ? ctsConfig::g_configSettings->TcpStatusDetails.m_acceptExPosted.GetValue() : 0LL;
+            const long long acceptExQueued = printAcceptEx ? ctsConfig::g_configSettings->TcpStatusDetails.m_acceptExQueued.GetValue() : 0LL;
 
             const long long timeElapsed = tcpData.m_endTime.GetValue() - tcpData.m_startTime.GetValue();
 
+            const bool printCpu = IsPrintingCpu();
+            const bool printCpuTimes = printCpu && ctsConfig::g_configSettings->PrintCpuTimes;
+            ctsCpuSnapshot cpuData;
+            long long ioCompletions = 0;
+            if (printCpu)
+            {
+                const auto currentCpu = ctsCpuSnapshot::Snap();
+                cpuData = currentCpu.Difference(0 == m_priorCpu.m_cycles ? ctsConfig::g_configSettings->StartCpu : m_priorCpu);
+                if (clearStatus)
+                {
+                    m_priorCpu = currentCpu;
+                }
+                ioCompletions = ctsConfig::g_configSettings->TcpStatusDetails.SnapIoCompletions(clearStatus);
+            }
+            const bool printHost = IsPrintingHost();
+            const auto hostData = printHost ? ctsConfig::GetHostCounterSample() : ctsConfig::ctsHostCounterSample{};
+            const bool printProfile = IsPrintingProfile();
+            const auto profileSetpoint = printProfile ? ctsConfig::GetLoadProfileSetpoint() : ctsConfig::ctsLoadProfileSetpoint{};
+            const bool printTargets = IsPrintingTargets();
+            std::array<TargetSlice, ctsConfig::ctsConfigSettings::c_MaxTargetStatistics> targetData{};
+            const size_t targetCount = printTargets ? SnapTargets(targetData, timeElapsed, clearStatus) : 0;
+
+            const float cyclesPerByte = static_cast<float>(cpuData.CyclesPer(tcpData.m_bytesSent.GetValue() + tcpData.m_bytesRecv.GetValue()));
+            const auto cyclesPerIo = static_cast<long long>(cpuData.CyclesPer(ioCompletions));
+            const auto kernelPercent = static_cast<float>(ctsCpuSnapshot::PercentOfSystem(cpuData.m_kernelTime, timeElapsed));
+            const auto userPercent = static_cast<float>(ctsCpuSnapshot::PercentOfSystem(cpuData.m_userTime, timeElapsed));
+
             if (format == ctsConfig::StatusFormatting::Csv)
             {
                 unsigned long charactersWritten = 0;
@@ -527,7 +655,66 @@ namespace ctsTraffic
                 charactersWritten += AppendCsvOutput(charactersWritten, c_currentTransactionsLength, connectionData.m_activeConnectionCount.GetValue());
                 charactersWritten += AppendCsvOutput(charactersWritten, c_completedTransactionsLength, connectionData.m_successfulCompletionCount.GetValue());
                 charactersWritten += AppendCsvOutput(charactersWritten, c_connectionErrorsLength, connectionData.m_connectionErrorCount.GetValue());
-                charactersWritten += AppendCsvOutput(charactersWritten, c_protocolErrorsLength, connectionData.m_protocolErrorCount.GetValue(), false); // no comma at the end
+                charactersWritten += AppendCsvOutput(charactersWritten, c_protocolErrorsLength, connectionData.m_protocolErrorCount.GetValue(), printRio || printLatency || printHeartbeat || printProbes || printAcceptEx || printCpu || printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                if (printRio)
+                {
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_rioCompletionsPerDequeueLength, static_cast<float>(rioCompletionsPerDequeue));
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_rioPostsPerCommitLength, static_cast<float>(rioPostsPerCommit), printLatency || printHeartbeat || printProbes || printAcceptEx || printCpu || printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                }
+                if (printLatency)
+                {
+                    charactersWritten = AppendCsvLatency(charactersWritten, latencyData, ctsConfig::g_configSettings->LatencyPercentiles, true);
+                    charactersWritten = AppendCsvLatency(charactersWritten, connectionLatencyData, ctsConfig::g_configSettings->LatencyPercentiles, printHeartbeat || printProbes || printAcceptEx || printCpu || printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                }
+                if (printHeartbeat)
+                {
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, workingSetPerConnection);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, committedMegabytes);
+                    charactersWritten = AppendCsvLatency(charactersWritten, heartbeatLatencyData, GetHeartbeatPercentiles(), printProbes || printAcceptEx || printCpu || printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                }
+                if (printProbes)
+                {
+                    charactersWritten = AppendCsvLatency(charactersWritten, probeLatencyData, GetHeartbeatPercentiles(), printAcceptEx || printCpu || printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                }
+                if (printAcceptEx)
+                {
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, acceptExPosted);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, acceptExQueued, printCpu || printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                }
+                if (printCpu)
+                {
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, cyclesPerByte);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, cyclesPerIo, printCpuTimes || printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                    if (printCpuTimes)
+                    {
+                        charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, kernelPercent);
+                        charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, userPercent, printHost || printProfile || printTargets); // no comma at the end unless printing more columns
+                    }
+                }
+                if (printHost)
+                {
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, hostData.m_processorPercent);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, hostData.m_dpcPercent);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, hostData.m_interruptPercent);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, hostData.m_adapterBytesPerSecond);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, hostData.m_adapterPacketsPerSecond);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, hostData.m_tcpRetransmitsPerSecond, printProfile || printTargets); // no comma at the end unless printing more columns
+                }
+                if (printProfile)
+                {
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, static_cast<long long>(profileSetpoint.m_connections));
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, profileSetpoint.m_bytesPerSecond, printTargets); // no comma at the end unless printing more columns
+                }
+                for (size_t target = 0; target < targetCount; ++target)
+                {
+                    const bool lastTarget = target + 1 == targetCount;
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, targetData[target].m_bytesPerSecond);
+                    charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, targetData[target].m_errors, printLatency || !lastTarget);
+                    if (printLatency)
+                    {
+                        charactersWritten += AppendCsvOutput(charactersWritten, c_latencyLength, targetData[target].m_latency, !lastTarget); // no comma at the end
+                    }
+                }
                 TerminateFileString(charactersWritten);
             }
             else
@@ -550,13 +737,100 @@ namespace ctsTraffic
                 RightJustifyOutput(c_completedTransactionsOffset, c_completedTransactionsLength, connectionData.m_successfulCompletionCount.GetValue());
                 RightJustifyOutput(c_connectionErrorsOffset, c_connectionErrorsLength, connectionData.m_connectionErrorCount.GetValue());
                 RightJustifyOutput(c_protocolErrorsOffset, c_protocolErrorsLength, connectionData.m_protocolErrorCount.GetValue());
+                if (printRio)
+                {
+                    RightJustifyOutput(c_rioCompletionsPerDequeueOffset, c_rioCompletionsPerDequeueLength, static_cast<float>(rioCompletionsPerDequeue));
+                    RightJustifyOutput(c_rioPostsPerCommitOffset, c_rioPostsPerCommitLength, static_cast<float>(rioPostsPerCommit));
+                }
+
+                auto lastOffset = printRio ? c_rioPostsPerCommitOffset : c_protocolErrorsOffset;
+                if (printLatency)
+                {
+                    // IO latency and then connection latency are printed in successive columns past the fixed columns
+                    lastOffset = RightJustifyLatency(lastOffset, latencyData, ctsConfig::g_configSettings->LatencyPercentiles);
+                    lastOffset = RightJustifyLatency(lastOffset, connectionLatencyData, ctsConfig::g_configSettings->LatencyPercentiles);
+                }
+                if (printHeartbeat)
+                {
+                    // memory and then heartbeat latency are printed in successive columns past the latency columns
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, workingSetPerConnection);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, committedMegabytes);
+                    lastOffset = RightJustifyLatency(lastOffset, heartbeatLatencyData, GetHeartbeatPercentiles());
+                }
+                if (printProbes)
+                {
+                    // probe latency is printed next to the throughput and latency columns of the bulk connections
+                    lastOffset = RightJustifyLatency(lastOffset, probeLatencyData, GetHeartbeatPercentiles());
+                }
+                if (printAcceptEx)
+                {
+                    // posted and then queued AcceptEx counts are printed in successive columns past all other columns
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, acceptExPosted);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, acceptExQueued);
+                }
+                if (printCpu)
+                {
+                    // cycles per byte and per IO (then kernel and user time) are printed in successive columns past all other columns
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, cyclesPerByte);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, cyclesPerIo);
+                    if (printCpuTimes)
+                    {
+                        lastOffset += c_latencyLength + 1;
+                        RightJustifyOutput(lastOffset, c_latencyLength, kernelPercent);
+                        lastOffset += c_latencyLength + 1;
+                        RightJustifyOutput(lastOffset, c_latencyLength, userPercent);
+                    }
+                }
+                if (printHost)
+                {
+                    // the host processor, adapter and TCP counters are printed in successive columns past all other columns
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, hostData.m_processorPercent);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, hostData.m_dpcPercent);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, hostData.m_interruptPercent);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, hostData.m_adapterBytesPerSecond);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, hostData.m_adapterPacketsPerSecond);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, hostData.m_tcpRetransmitsPerSecond);
+                }
+                if (printProfile)
+                {
+                    // the -LoadProfile connection and rate targets are printed in successive columns past all other columns
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, static_cast<long long>(profileSetpoint.m_connections));
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, profileSetpoint.m_bytesPerSecond);
+                }
+                for (size_t target = 0; target < targetCount; ++target)
+                {
+                    // each target's throughput, errors (and latency) are printed in successive columns past all other columns
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, targetData[target].m_bytesPerSecond);
+                    lastOffset += c_latencyLength + 1;
+                    RightJustifyOutput(lastOffset, c_latencyLength, targetData[target].m_errors);
+                    if (printLatency)
+                    {
+                        lastOffset += c_latencyLength + 1;
+                        RightJustifyOutput(lastOffset, c_latencyLength, targetData[target].m_latency);
+                    }
+                }
                 if (format == ctsConfig::StatusFormatting::ConsoleOutput)
                 {
-                    TerminateString(c_protocolErrorsOffset);
+                    TerminateString(lastOffset);
                 }
                 else
                 {
-                    TerminateFileString(c_protocolErrorsOffset);
+                    TerminateFileString(lastOffset);
                 }
             }
 
@@ -564,9 +838,302 @@ namespace ctsTraffic
         }
 
         PCWSTR FormatLegend(const ctsConfig::StatusFormatting& format) noexcept override
+        {
+            PCWSTR const legend = FormatBaseLegend(format);
+            if (!IsPrintingLatency() && !IsPrintingHeartbeat() && !IsPrintingProbes() && !IsPrintingAcceptEx() && !IsPrintingCpu() && !IsPrintingHost() && !IsPrintingProfile() && !IsPrintingTargets())
+            {
+                return legend;
+            }
+
+            try
+            {
+                // insert the latency and heartbeat legends before the trailing blank line
+                const auto* const lineEnding = ctsConfig::StatusFormatting::ConsoleOutput == format ? L"\n" : L"\r\n";
+                m_latencyLegend.assign(legend);
+                m_latencyLegend.resize(m_latencyLegend.size() - wcslen(lineEnding));
+                if (IsPrintingLatency())
+                {
+                    m_latencyLegend.append(L"* p##(us) & Max(us) - send and recv latency percentiles and maximum within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                    m_latencyLegend.append(IsListening() ?
+                        L"* Conn p## & Conn Max - (us) AcceptEx post to completion latency percentiles and maximum within the TimeSlice period" :
+                        L"* Conn p## & Conn Max - (us) ConnectEx latency percentiles and maximum within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                }
+                if (IsPrintingHeartbeat())
+                {
+                    m_latencyLegend.append(L"* WS/Conn - (bytes) process working set divided by the In-Flight connections");
+                    m_latencyLegend.append(lineEnding);
+                    m_latencyLegend.append(L"* Commit(MB) - process committed (private) memory");
+                    m_latencyLegend.append(lineEnding);
+                    m_latencyLegend.append(L"* HB p## & HB Max - (us) heartbeat round-trip latency percentiles and maximum within the TimeSlice period (clients only)");
+                    m_latencyLegend.append(lineEnding);
+                }
+                if (IsPrintingProbes())
+                {
+                    m_latencyLegend.append(L"* Probe p## & Probe Max - (us) probe ping round-trip latency percentiles and maximum within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                }
+                if (IsPrintingAcceptEx())
+                {
+                    m_latencyLegend.append(L"* Posted - AcceptEx requests currently posted across all listeners");
+                    m_latencyLegend.append(lineEnding);
+                    m_latencyLegend.append(L"* Queued - accepted connections waiting to be handed to a new connection");
+                    m_latencyLegend.append(lineEnding);
+                }
+                if (IsPrintingCpu())
+                {
+                    m_latencyLegend.append(L"* Cyc/Byte & Cyc/IO - process CPU cycles per byte sent and received, and per completed send or recv, within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                    if (ctsConfig::g_configSettings->PrintCpuTimes)
+                    {
+                        m_latencyLegend.append(L"* Kernel% & User% - process kernel and user time as a percent of all processors within the TimeSlice period");
+                        m_latencyLegend.append(lineEnding);
+                    }
+                }
+                if (IsPrintingHost())
+                {
+                    m_latencyLegend.append(L"* Host CPU%, DPC% & Intr% - host processor, DPC and interrupt time as a percent of all processors within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                    m_latencyLegend.append(L"* Adapter Bps & Pps - bytes/sec and packets/sec sent and received across all network adapters within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                    m_latencyLegend.append(L"* Retrans/s - TCP segments retransmitted/sec by the host within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                }
+                if (IsPrintingProfile())
+                {
+                    m_latencyLegend.append(L"* Target Conn & Target Rate - the -LoadProfile connections and bytes/second/connection (0 is unlimited) at the end of the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                }
+                if (IsPrintingTargets())
+                {
+                    m_latencyLegend.append(L"* T# Bps & T# Err - bytes/second sent and received and failed connections for each -TargetStatistics target within the TimeSlice period");
+                    m_latencyLegend.append(lineEnding);
+                    if (IsPrintingLatency())
+                    {
+                        m_latencyLegend.append(L"* T# p## - (us) the highest -LatencyPercentiles send and recv latency for each target within the TimeSlice period");
+                        m_latencyLegend.append(lineEnding);
+                    }
+                }
+                m_latencyLegend.append(lineEnding);
+                return m_latencyLegend.c_str();
+            }
+            catch (...)
+            {
+                return legend;
+            }
+        }
+
+        PCWSTR FormatHeader(const ctsConfig::StatusFormatting& format) noexcept override
+        {
+            PCWSTR const header = FormatBaseHeader(format);
+            if (!IsPrintingLatency() && !IsPrintingHeartbeat() && !IsPrintingProbes() && !IsPrintingAcceptEx() && !IsPrintingCpu() && !IsPrintingHost() && !IsPrintingProfile() && !IsPrintingTargets())
+            {
+                return header;
+            }
+
+            try
+            {
+                // append a column for each percentile and the maximum past the fixed columns
+                const auto* const lineEnding = ctsConfig::StatusFormatting::ConsoleOutput == format ? L"\n" : L"\r\n";
+                m_latencyHeader.assign(header);
+                m_latencyHeader.resize(m_latencyHeader.size() - wcslen(lineEnding));
+                if (ctsConfig::StatusFormatting::Csv == format)
+                {
+                    if (IsPrintingLatency())
+                    {
+                        for (const auto percentile : ctsConfig::g_configSettings->LatencyPercentiles)
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L",p%gus", percentile));
+                        }
+                        m_latencyHeader.append(L",MaxUs");
+                        for (const auto percentile : ctsConfig::g_configSettings->LatencyPercentiles)
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L",ConnP%gus", percentile));
+                        }
+                        m_latencyHeader.append(L",ConnMaxUs");
+                    }
+                    if (IsPrintingHeartbeat())
+                    {
+                        m_latencyHeader.append(L",WorkingSetPerConn,CommitMB");
+                        for (const auto percentile : GetHeartbeatPercentiles())
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L",HbP%gus", percentile));
+                        }
+                        m_latencyHeader.append(L",HbMaxUs");
+                    }
+                    if (IsPrintingProbes())
+                    {
+                        for (const auto percentile : GetHeartbeatPercentiles())
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L",ProbeP%gus", percentile));
+                        }
+                        m_latencyHeader.append(L",ProbeMaxUs");
+                    }
+                    if (IsPrintingAcceptEx())
+                    {
+                        m_latencyHeader.append(L",AcceptExPosted,AcceptExQueued");
+                    }
+                    if (IsPrintingCpu())
+                    {
+                        m_latencyHeader.append(L",CyclesPerByte,CyclesPerIO");
+                        if (ctsConfig::g_configSettings->PrintCpuTimes)
+                        {
+                            m_latencyHeader.append(L",KernelPercent,UserPercent");
+                        }
+                    }
+                    if (IsPrintingHost())
+                    {
+                        m_latencyHeader.append(L",HostCpuPercent,HostDpcPercent,HostInterruptPercent,AdapterBps,AdapterPps,TcpRetransmitsPerSec");
+                    }
+                    if (IsPrintingProfile())
+                    {
+                        m_latencyHeader.append(L",TargetConnections,TargetRate");
+                    }
+                    for (size_t target = 1; IsPrintingTargets() && target <= ctsConfig::g_configSettings->TargetStatusDetails.size(); ++target)
+                    {
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L",Target%IuBps,Target%IuErrors", target, target));
+                        if (IsPrintingLatency())
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L",Target%IuP%gus", target, ctsConfig::g_configSettings->LatencyPercentiles.back()));
+                        }
+                    }
+                }
+                else
+                {
+                    // remove the trailing space to right-justify each column header
+                    m_latencyHeader.pop_back();
+                    if (IsPrintingLatency())
+                    {
+                        for (const auto percentile : ctsConfig::g_configSettings->LatencyPercentiles)
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), wil::str_printf<std::wstring>(L"p%g(us)", percentile).c_str()));
+                        }
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Max(us)"));
+                        for (const auto percentile : ctsConfig::g_configSettings->LatencyPercentiles)
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), wil::str_printf<std::wstring>(L"Conn p%g", percentile).c_str()));
+                        }
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Conn Max"));
+                    }
+                    if (IsPrintingHeartbeat())
+                    {
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"WS/Conn"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Commit(MB)"));
+                        for (const auto percentile : GetHeartbeatPercentiles())
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), wil::str_printf<std::wstring>(L"HB p%g", percentile).c_str()));
+                        }
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"HB Max"));
+                    }
+                    if (IsPrintingProbes())
+                    {
+                        for (const auto percentile : GetHeartbeatPercentiles())
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), wil::str_printf<std::wstring>(L"Probe p%g", percentile).c_str()));
+                        }
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Probe Max"));
+                    }
+                    if (IsPrintingAcceptEx())
+                    {
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Posted"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Queued"));
+                    }
+                    if (IsPrintingCpu())
+                    {
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Cyc/Byte"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Cyc/IO"));
+                        if (ctsConfig::g_configSettings->PrintCpuTimes)
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Kernel%"));
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"User%"));
+                        }
+                    }
+                    if (IsPrintingHost())
+                    {
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Host CPU%"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"DPC%"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Intr%"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Adapter Bps"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Adapter Pps"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Retrans/s"));
+                    }
+                    if (IsPrintingProfile())
+                    {
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Target Conn"));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), L"Target Rate"));
+                    }
+                    for (size_t target = 1; IsPrintingTargets() && target <= ctsConfig::g_configSettings->TargetStatusDetails.size(); ++target)
+                    {
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), wil::str_printf<std::wstring>(L"T%Iu Bps", target).c_str()));
+                        m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), wil::str_printf<std::wstring>(L"T%Iu Err", target).c_str()));
+                        if (IsPrintingLatency())
+                        {
+                            m_latencyHeader.append(wil::str_printf<std::wstring>(L"%*ws", static_cast<int>(c_latencyLength + 1), wil::str_printf<std::wstring>(L"T%Iu p%g", target, ctsConfig::g_configSettings->LatencyPercentiles.back()).c_str()));
+                        }
+                    }
+                    m_latencyHeader.append(L" ");
+                }
+                m_latencyHeader.append(lineEnding);
+                return m_latencyHeader.c_str();
+            }
+            catch (...)
+            {
+                return header;
+            }
+        }
+
+    private:
+        // writes each configured percentile and then the maximum (in microseconds) as csv values
+        unsigned long AppendCsvLatency(unsigned long charactersWritten, const ctsLatencySnapshot& latencyData, const std::vector<double>& percentiles, bool addComma) noexcept
+        {
+            for (const auto percentile : percentiles)
+            {
+                charactersWritten += AppendCsvOutput(
+                    charactersWritten,
+                    c_latencyLength,
+                    ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetPercentile(percentile)));
+            }
+            charactersWritten += AppendCsvOutput(
+                charactersWritten,
+                c_latencyLength,
+                ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetMaximum()),
+                addComma);
+            return charactersWritten;
+        }
+
+        // right-justifies each configured percentile and then the maximum (in microseconds) in successive columns
+        // - returns the offset of the last column written
+        unsigned long RightJustifyLatency(unsigned long lastOffset, const ctsLatencySnapshot& latencyData, const std::vector<double>& percentiles) noexcept
+        {
+            for (const auto percentile : percentiles)
+            {
+                lastOffset += c_latencyLength + 1;
+                RightJustifyOutput(lastOffset, c_latencyLength, ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetPercentile(percentile)));
+            }
+            lastOffset += c_latencyLength + 1;
+            RightJustifyOutput(lastOffset, c_latencyLength, ctsLatencySnapshot::ConvertTicksToMicroseconds(latencyData.GetMaximum()));
+            return lastOffset;
+        }
+
+        static PCWSTR FormatBaseLegend(const ctsConfig::StatusFormatting& format) noexcept
         {
             if (ctsConfig::StatusFormatting::ConsoleOutput == format)
             {
+                if (IsPrintingRio())
+                {
+                    return
+                        L"Legend:\n"
+                        L"* TimeSlice - (seconds) cumulative runtime\n"
+                        L"* Send & Recv Rates - bytes/sec that were transferred within the TimeSlice period\n"
+                        L"* In-Flight - count of established connections transmitting IO pattern data\n"
+                        L"* Completed - cumulative count of successfully completed IO patterns\n"
+                        L"* Network Errors - cumulative count of failed IO patterns due to Winsock errors\n"
+                        L"* Data Errors - cumulative count of failed IO patterns due to data errors\n"
+                        L"* Cmp/Deq - average RIO completions returned per dequeue within the TimeSlice period\n"
+                        L"* Post/Cmt - average RIO sends and recvs posted per RQ notification (commit) within the TimeSlice period\n"
+                        L"\n";
+                }
                 return
                     L"Legend:\n"
                     L"* TimeSlice - (seconds) cumulative runtime\n"
@@ -577,6 +1144,20 @@ namespace ctsTraffic
                     L"* Data Errors - cumulative count of failed IO patterns due to data errors\n"
                     L"\n";
             }
+            if (IsPrintingRio())
+            {
+                return
+                    L"Legend:\r\n"
+                    L"* TimeSlice - (seconds) cumulative runtime\r\n"
+                    L"* Send & Recv Rates - bytes/sec that were transferred within the TimeSlice period\r\n"
+                    L"* In-Flight - count of established connections transmitting IO pattern data\r\n"
+                    L"* Completed - cumulative count of successfully completed IO patterns\r\n"
+                    L"* Network Errors - cumulative count of failed IO patterns due to Winsock errors\r\n"
+                    L"* Data Errors - cumulative count of failed IO patterns due to data errors\r\n"
+                    L"* Cmp/Deq - average RIO completions returned per dequeue within the TimeSlice period\r\n"
+                    L"* Post/Cmt - average RIO sends and recvs posted per RQ notification (commit) within the TimeSlice period\r\n"
+                    L"\r\n";
+            }
             else
             {
                 return
@@ -591,14 +1172,26 @@ namespace ctsTraffic
             }
         }
 
-        PCWSTR FormatHeader(const ctsConfig::StatusFormatting& format) noexcept override
+        static PCWSTR FormatBaseHeader(const ctsConfig::StatusFormatting& format) noexcept
         {
             if (format == ctsConfig::StatusFormatting::Csv)
             {
+                if (IsPrintingRio())
+                {
+                    return
+                        L"TimeSlice,SendBps,RecvBps,In-Flight,Completed,NetError,DataError,Cmp/Deq,Post/Cmt\r\n";
+                }
                 return
                     L"TimeSlice,SendBps,RecvBps,In-Flight,Completed,NetError,DataError\r\n";
 
             }
+            if (IsPrintingRio())
+            {
+                // the RIO completions/dequeue and posts/commit columns extend the line to 101 columns
+                return format == ctsConfig::StatusFormatting::ConsoleOutput ?
+                    L" TimeSlice      SendBps      RecvBps  In-Flight  Completed  NetError  DataError    Cmp/Deq   Post/Cmt \n" :
+                    L" TimeSlice      SendBps      RecvBps  In-Flight  Completed  NetError  DataError    Cmp/Deq   Post/Cmt \r\n";
+            }
             if (format == ctsConfig::StatusFormatting::ConsoleOutput)
             {
                 return
@@ -610,7 +1203,124 @@ namespace ctsTraffic
             return L" TimeSlice      SendBps      RecvBps  In-Flight  Completed  NetError  DataError \r\n";
         }
 
-    private:
+        // RIO completion batching is only shown when using -IO:rioiocp or -IO:riopoll
+        // - evaluated on each call: this object is created before the IO function is parsed
+        static bool IsPrintingRio() noexcept
+        {
+            return WI_IsFlagSet(ctsConfig::g_configSettings->SocketFlags, WSA_FLAG_REGISTERED_IO);
+        }
+
+        // IO and connection latency percentiles are only shown when using -LatencyPercentiles
+        static bool IsPrintingLatency() noexcept
+        {
+            return !ctsConfig::g_configSettings->LatencyPercentiles.empty();
+        }
+
+        // working set, committed memory and heartbeat latency are only shown with -Pattern:Heartbeat
+        static bool IsPrintingHeartbeat() noexcept
+        {
+            return ctsConfig::IoPatternType::Heartbeat == ctsConfig::g_configSettings->IoPattern;
+        }
+
+        // probe latency is only shown by clients making -Probes connections
+        static bool IsPrintingProbes() noexcept
+        {
+            return ctsConfig::g_configSettings->ProbeConnections > 0 && !IsListening();
+        }
+
+        // posted and queued AcceptEx counts are only shown when accepting with AcceptEx
+        static bool IsPrintingAcceptEx() noexcept
+        {
+            return ctsConfig::g_configSettings->PrePostAcceptsHigh > 0;
+        }
+
+        // CPU efficiency is only shown with -CpuEfficiency
+        static bool IsPrintingCpu() noexcept
+        {
+            return ctsConfig::g_configSettings->PrintCpuEfficiency;
+        }
+
+        // the host processor, network adapter and TCP counters are only shown with -HostCounters
+        static bool IsPrintingHost() noexcept
+        {
+            return ctsConfig::g_configSettings->HostCounters;
+        }
+
+        static bool IsPrintingProfile() noexcept
+        {
+            return ctsConfig::g_configSettings->LoadProfile;
+        }
+
+        // the throughput, errors and latency of each target are only shown with -TargetStatistics
+        static bool IsPrintingTargets() noexcept
+        {
+            return !ctsConfig::g_configSettings->TargetStatusDetails.empty();
+        }
+
+        struct TargetSlice
+        {
+            long long m_bytesPerSecond = 0;
+            long long m_errors = 0;
+            long long m_latency = 0;
+        };
+
+        // snaps each target's values within the TimeSlice period, returning the number of targets
+        static size_t SnapTargets(std::array<TargetSlice, ctsConfig::ctsConfigSettings::c_MaxTargetStatistics>& targetData, long long timeElapsed, bool clearStatus) noexcept
+        {
+            const auto& targets = ctsConfig::g_configSettings->TargetStatusDetails;
+            size_t target = 0;
+            for (; target < targets.size() && target < targetData.size(); ++target)
+            {
+                auto& statistics = *targets[target];
+                const long long bytes = clearStatus ?
+                    statistics.m_bytesSent.SnapValueDifference() + statistics.m_bytesRecv.SnapValueDifference() :
+                    statistics.m_bytesSent.ReadValueDifference() + statistics.m_bytesRecv.ReadValueDifference();
+                targetData[target].m_bytesPerSecond = timeElapsed > 0LL ? bytes * 1000LL / timeElapsed : 0LL;
+                targetData[target].m_errors = clearStatus ?
+                    statistics.m_connectionErrors.SnapValueDifference() + statistics.m_protocolErrors.SnapValueDifference() :
+                    statistics.m_connectionErrors.ReadValueDifference() + statistics.m_protocolErrors.ReadValueDifference();
+                if (IsPrintingLatency())
+                {
+                    targetData[target].m_latency = ctsLatencySnapshot::ConvertTicksToMicroseconds(
+                        statistics.m_ioLatency.SnapView(clearStatus).GetPercentile(ctsConfig::g_configSettings->LatencyPercentiles.back()));
+                }
+            }
+            return target;
+        }
+
+        // heartbeat and probe latency use the -LatencyPercentiles when given, p50 and p99 otherwise
+        static const std::vector<double>& GetHeartbeatPercentiles() noexcept
+        {
+            static const std::vector<double> c_defaultPercentiles{ 50.0, 99.0 };
+            return ctsConfig::g_configSettings->LatencyPercentiles.empty() ?
+                c_defaultPercentiles :
+                ctsConfig::g_configSettings->LatencyPercentiles;
+        }
+
+        // the process working set divided across the active connections, and the committed (private) bytes in MB
+        static void SnapProcessMemory(long long activeConnections, long long& workingSetPerConnection, long long& committedMegabytes) noexcept
+        {
+            PROCESS_MEMORY_COUNTERS_EX memoryCounters{};
+            memoryCounters.cb = sizeof memoryCounters;
+            if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof memoryCounters))
+            {
+                workingSetPerConnection = static_cast<long long>(memoryCounters.WorkingSetSize) / (activeConnections > 0 ? activeConnections : 1);
+                committedMegabytes = static_cast<long long>(memoryCounters.PrivateUsage / (1024 * 1024));
+            }
+        }
+
+        // servers track AcceptEx latency, clients track ConnectEx latency
+        static bool IsListening() noexcept
+        {
+            return !ctsConfig::g_configSettings->ListenAddresses.empty();
+        }
+
+        // the legend and header with the latency and heartbeat columns appended - built when first printed
+        std::wstring m_latencyLegend;
+        std::wstring m_latencyHeader;
+        // the process CPU at the last cleared status update - the baseline for the next TimeSlice
+        ctsCpuSnapshot m_priorCpu{};
+
         // constant offsets for each numeric value to print
         static const unsigned long c_timeSliceOffset = 10;
         static const unsigned long c_timeSliceLength = 10;
@@ -633,6 +1343,28 @@ namespace ctsTraffic
         static const unsigned long c_protocolErrorsOffset = 79;
         static const unsigned long c_protocolErrorsLength = 7;
 
+        static const unsigned long c_rioCompletionsPerDequeueOffset = 90;
+        static const unsigned long c_rioCompletionsPerDequeueLength = 10;
+
+        static const unsigned long c_rioPostsPerCommitOffset = 101;
+        static const unsigned long c_rioPostsPerCommitLength = 10;
+
+        // latency columns follow the last fixed column, each (c_latencyLength + 1) wide
+        static const unsigned long c_latencyLength = 11;
+
+        // the widest row: every optional column with the most -LatencyPercentiles and -Target statistics accepted
+        // - IO and connection latency, memory and heartbeat latency, probe latency, AcceptEx, CPU times, host counters, load profile, then each target
+        static const unsigned long c_maxOptionalColumns =
+            2 * (ctsConfig::ctsConfigSettings::c_MaxLatencyPercentiles + 1) +
+            2 + (ctsConfig::ctsConfigSettings::c_MaxLatencyPercentiles + 1) +
+            (ctsConfig::ctsConfigSettings::c_MaxLatencyPercentiles + 1) +
+            2 + 4 + 6 + 2 +
+            3 * ctsConfig::ctsConfigSettings::c_MaxTargetStatistics;
+        // CSV rows pack the same values without padding, so the text row (plus the \r\n and null terminator) is the longest
+        static_assert(
+            c_rioPostsPerCommitOffset + c_maxOptionalColumns * (c_latencyLength + 1) + 2 <= c_outputBufferSize,
+            "the output buffer must fit every optional status column");
+
         static const unsigned long c_detailedSentOffset = 23;
         static const unsigned long c_detailedSentLength = 10;
 
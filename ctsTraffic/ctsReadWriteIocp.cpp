@@ -23,104 +23,100 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsConfig.h"
 #include "ctsSocket.h"
 #include "ctsIOTask.hpp"
+#include "ctsThreadStatistics.h"
 
 namespace ctsTraffic
 {
-    void ctsReadWriteIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    static void ctsReadWriteRequestIo(ctsSocket* pSocket) noexcept;
 
     // IO Threadpool completion callback 
+    // - the IO count held for this IO keeps the ctsSocket alive, as ctsReadWriteIocp had it hold its IO reference
     static void ctsReadWriteIocpIoCompletionCallback(
         _In_ OVERLAPPED* pOverlapped,
-        const std::weak_ptr<ctsSocket>& weakSocket,
+        ctsSocket* const pSocket,
         const ctsTask& task) noexcept
     {
-        auto sharedSocket(weakSocket.lock());
-        if (!sharedSocket)
-        {
-            return;
-        }
-
+        const ctsThreadStatistics::ctsCallbackScope callbackScope;
         unsigned long gle = NO_ERROR;
 
-        // hold a reference on the socket
-        const auto lockedSocket = sharedSocket->AcquireSocketLock();
-        const auto lockedPattern = lockedSocket.GetPattern();
-        if (!lockedPattern)
+        // the socket lock must be released before the IO count : CompleteState can delete the ctsSocket
         {
-            gle = WSAECONNABORTED;
-        }
+            // hold a reference on the socket
+            const auto lockedSocket = pSocket->AcquireSocketLock();
+            auto* const lockedPattern = lockedSocket.GetPatternPointer();
+            if (!lockedPattern)
+            {
+                gle = WSAECONNABORTED;
+            }
 
-        DWORD transferred = 0;
-        const SOCKET socket = lockedSocket.GetSocket();
-        if (INVALID_SOCKET == socket)
-        {
-            gle = WSAECONNABORTED;
-        }
-        else
-        {
-            DWORD flags;
-            if (!WSAGetOverlappedResult(socket, pOverlapped, &transferred, FALSE, &flags))
+            DWORD transferred = 0;
+            const SOCKET socket = lockedSocket.GetSocket();
+            if (INVALID_SOCKET == socket)
             {
-                gle = WSAGetLastError();
+                gle = WSAECONNABORTED;
+            }
+            else
+            {
+                DWORD flags;
+                if (!WSAGetOverlappedResult(socket, pOverlapped, &transferred, FALSE, &flags))
+                {
+                    gle = WSAGetLastError();
+                }
             }
-        }
 
-        const char* functionName = ctsTaskAction::Send == task.m_ioAction ? "WriteFile" : "ReadFile";
-        if (gle != 0) PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%u) [ctsReadWriteIocp]\n", functionName, gle);
+            const char* functionName = ctsTaskAction::Send == task.m_ioAction ? "WriteFile" : "ReadFile";
+            if (gle != 0) PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%u) [ctsReadWriteIocp]\n", functionName, gle);
 
-        if (lockedPattern)
-        {
-            // see if complete_io requests more IO
-            DWORD readwriteStatus = NO_ERROR;
-            const ctsIoStatus protocolStatus = lockedPattern->CompleteIo(task, transferred, gle);
-            switch (protocolStatus)
+            if (lockedPattern)
             {
-                case ctsIoStatus::ContinueIo:
-                    // more IO is requested from the protocol
-                    // - invoke the new IO call while holding a refcount to the prior IO
-                    ctsReadWriteIocp(weakSocket);
-                    break;
-
-                case ctsIoStatus::CompletedIo:
-                    // protocol didn't fail this IO: no more IO is requested from the protocol
-                    readwriteStatus = NO_ERROR;
-                    break;
-
-                case ctsIoStatus::FailedIo:
-                    // write out the error
-                    ctsConfig::PrintErrorIfFailed(functionName, gle);
-                    // protocol sees this as a failure - capture the error the protocol recorded
-                    readwriteStatus = lockedPattern->GetLastPatternError();
-                    break;
-
-                default:
-                    FAIL_FAST_MSG("ctsReadWriteIocp: unknown ctsSocket::IOStatus - %u\n", static_cast<unsigned>(protocolStatus));
-            }
+                // see if complete_io requests more IO
+                DWORD readwriteStatus = NO_ERROR;
+                ctsThreadStatistics::RecordCompletion(transferred, false);
+                const ctsIoStatus protocolStatus = lockedPattern->CompleteIo(task, transferred, gle);
+                switch (protocolStatus)
+                {
+                    case ctsIoStatus::ContinueIo:
+                        // more IO is requested from the protocol
+                        // - invoke the new IO call while holding a refcount to the prior IO
+                        ctsReadWriteRequestIo(pSocket);
+                        break;
+
+                    case ctsIoStatus::CompletedIo:
+                        // protocol didn't fail this IO: no more IO is requested from the protocol
+                        readwriteStatus = NO_ERROR;
+                        break;
+
+                    case ctsIoStatus::FailedIo:
+                        // write out the error
+                        ctsConfig::PrintErrorIfFailed(functionName, gle);
+                        // protocol sees this as a failure - capture the error the protocol recorded
+                        readwriteStatus = lockedPattern->GetLastPatternError();
+                        break;
+
+                    default:
+                        FAIL_FAST_MSG("ctsReadWriteIocp: unknown ctsSocket::IOStatus - %u\n", static_cast<unsigned>(protocolStatus));
+                }
 
-            gle = readwriteStatus;
+                gle = readwriteStatus;
+            }
         }
 
         // always decrement *after* attempting new IO - the prior IO is now formally "done"
-        if (sharedSocket->DecrementIo() == 0)
+        if (pSocket->DecrementIo() == 0)
         {
             // if we have no more IO pended, complete the state
-            sharedSocket->CompleteState(gle);
+            pSocket->CompleteState(gle);
         }
     }
 
-    // The registered function with ctsConfig
-    void ctsReadWriteIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    // Requests IO from the pattern until it has none, it's done, or IO fails
+    // - callers must be holding either an IO count or a reference on the ctsSocket
+    //   as the IO count can fall to zero while this function holds the socket lock
+    static void ctsReadWriteRequestIo(ctsSocket* const pSocket) noexcept
     {
-        // must get a reference to the socket and the IO pattern
-        auto sharedSocket(weakSocket.lock());
-        if (!sharedSocket)
-        {
-            return;
-        }
-
         // hold a reference on the socket
-        const auto lockedSocket = sharedSocket->AcquireSocketLock();
-        const auto lockedPattern = lockedSocket.GetPattern();
+        const auto lockedSocket = pSocket->AcquireSocketLock();
+        auto* const lockedPattern = lockedSocket.GetPatternPointer();
         if (!lockedPattern)
         {
             return;
@@ -159,7 +155,7 @@ namespace ctsTraffic
                 if (ctsTaskAction::HardShutdown == nextIo.m_ioAction)
                 {
                     // pass through -1 to force an RST with the closesocket
-                    ioError = sharedSocket->CloseSocket(-1);
+                    ioError = pSocket->CloseSocket(-1);
                     socket = INVALID_SOCKET;
 
                     ioDone = lockedPattern->CompleteIo(nextIo, 0, ioError) != ctsIoStatus::ContinueIo;
@@ -168,16 +164,18 @@ namespace ctsTraffic
 
                 // else we need to initiate another IO
                 // add-ref the IO about to start
-                ioCount = sharedSocket->IncrementIo();
+                ioCount = pSocket->IncrementIo();
 
                 std::shared_ptr<ctl::ctThreadIocp> ioThreadPool;
                 OVERLAPPED* pOverlapped = nullptr;
                 try
                 {
                     // these are the only calls which can throw in this function
-                    ioThreadPool = sharedSocket->GetIocpThreadpool();
-                    pOverlapped = ioThreadPool->new_request(
-                        [weakSocket, nextIo](OVERLAPPED* pCallbackOverlapped) noexcept { ctsReadWriteIocpIoCompletionCallback(pCallbackOverlapped, weakSocket, nextIo); });
+                    ioThreadPool = pSocket->GetIocpThreadpool();
+                    auto callback = [pSocket, nextIo](OVERLAPPED* pCallbackOverlapped) noexcept { ctsReadWriteIocpIoCompletionCallback(pCallbackOverlapped, pSocket, nextIo); };
+                    // every ReadFile and WriteFile constructs this callback : it must stay in place so IO never allocates it
+                    static_assert(ctl::ctThreadIocpCallbackInfo::stored_in_place<decltype(callback)>, "the ctsTask captured per IO must fit in ctThreadIocpCallbackInfo::c_callbackStorageSize");
+                    pOverlapped = ioThreadPool->new_request(std::move(callback));
                 }
                 catch (...)
                 {
@@ -187,7 +185,7 @@ namespace ctsTraffic
                 // if an exception prevented this IO from initiating,
                 if (ioError != NO_ERROR)
                 {
-                    ioCount = sharedSocket->DecrementIo();
+                    ioCount = pSocket->DecrementIo();
                     ioDone = lockedPattern->CompleteIo(nextIo, 0, ioError) != ctsIoStatus::ContinueIo;
                     continue;
                 }
@@ -220,7 +218,7 @@ namespace ctsTraffic
                     // must cancel the IOCP TP if the IO call fails
                     ioThreadPool->cancel_request(pOverlapped);
                     // decrement the IO count since it was not pended
-                    ioCount = sharedSocket->DecrementIo();
+                    ioCount = pSocket->DecrementIo();
 
                     const char* functionName = ctsTaskAction::Send == nextIo.m_ioAction ? "WriteFile" : "ReadFile";
                     PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%d) [ctsReadWriteIocp]\n", functionName, ioError);
@@ -263,7 +261,30 @@ namespace ctsTraffic
         if (0 == ioCount)
         {
             // complete the ctsSocket if we have no IO pended
-            sharedSocket->CompleteState(ioError);
+            pSocket->CompleteState(ioError);
+        }
+    }
+
+    // The registered function with ctsConfig
+    void ctsReadWriteIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        // must get a reference to the socket
+        const auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        // IO callbacks refer to the ctsSocket by raw pointer instead of locking a weak_ptr with every completion
+        // - the ctsSocket keeps itself alive until CompleteState, which is only called once all its IO has completed
+        sharedSocket->HoldIoReference();
+        // hold an IO count across the first request : if it starts no IO (or there's no pattern)
+        // - the socket is completed here, releasing that reference (CompleteState reports the pattern's last error)
+        sharedSocket->IncrementIo();
+        ctsReadWriteRequestIo(sharedSocket.get());
+        if (0 == sharedSocket->DecrementIo())
+        {
+            sharedSocket->CompleteState(NO_ERROR);
         }
     }
 } // namespace
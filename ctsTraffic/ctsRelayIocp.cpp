@@ -0,0 +1,606 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// cpp headers
+#include <deque>
+#include <memory>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/resource.h>
+// ctl headers
+#include <ctMemoryGuard.hpp>
+#include <ctSocketExtensions.hpp>
+#include <ctSockaddr.hpp>
+#include <ctThreadIocp.hpp>
+#include <ctTimer.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsStatistics.hpp"
+#include "ctsTCPFunctions.h"
+
+//
+// TCP relay (-Relay)
+//
+// Each accepted connection is paired with an upstream connection made with ConnectEx to the next -Relay address
+// - bytes are forwarded in both directions through -RelayBuffers buffers per direction, each the -Buffer size
+// - the buffer a WSARecv completed into is the buffer then posted with WSASend on the other connection : nothing is copied
+// - each direction keeps one recv and one send in flight : the next free buffer is received into while the prior is sent
+// - a FIN is forwarded with shutdown(SD_SEND) once everything received before it was sent
+// - the first failure cancels the IO on both connections
+//
+// All IO of the pair is posted and processed under the accepted ctsSocket's lock
+// - the ctsSocket's IO count keeps the accepted connection open until the IO on both connections has completed
+// - the ctsIOPattern of the accepted connection is not driven : it's only given the bytes forwarded to print its results
+//
+namespace ctsTraffic
+{
+    namespace RelayIo
+    {
+        static long long g_targetCounter = 0LL;
+        static ctsStatsTracking g_pairsConnected;
+        static ctsStatsTracking g_upstreamFailures;
+        static ctsShardedStatsTracking g_bytesForwarded;
+        // QPC ticks from a recv completing to the send of that buffer completing on the other connection
+        static ctsLatencyHistogram g_forwardLatency;
+
+        struct ctsRelayBuffer
+        {
+            char* m_buffer = nullptr;
+            // the bytes received into the buffer, and how many of those were sent
+            unsigned long m_length = 0;
+            unsigned long m_sent = 0;
+            long long m_recvCompletedQpc = 0;
+        };
+
+        struct ctsRelayDirection
+        {
+            // received from the accepted connection and sent upstream, or received upstream and sent to the accepted connection
+            bool m_fromDownstream = false;
+            std::vector<ctsRelayBuffer> m_buffers;
+            std::vector<size_t> m_freeBuffers;
+            // received and not yet (fully) sent, in the order they were received
+            std::deque<size_t> m_receivedBuffers;
+            bool m_recvPending = false;
+            bool m_sendPending = false;
+            bool m_finReceived = false;
+            bool m_finForwarded = false;
+        };
+
+        class ctsRelayPair : public std::enable_shared_from_this<ctsRelayPair>
+        {
+        public:
+            // the ctsSocket must be holding its IO reference : it's referred to by raw pointer until CompleteState
+            // - can throw std::bad_alloc
+            explicit ctsRelayPair(ctsSocket* pSocket) :
+                m_pSocket(pSocket),
+                m_bufferSize(ctsConfig::GetMaxBufferSize()),
+                m_retiredIocp(std::make_unique<std::shared_ptr<ctl::ctThreadIocp>>())
+            {
+                const auto bufferCount = ctsConfig::g_configSettings->RelayBufferCount;
+                m_bufferMemory = std::make_unique<char[]>(static_cast<size_t>(m_bufferSize) * bufferCount * 2);
+
+                auto* nextBuffer = m_bufferMemory.get();
+                for (auto* direction : {&m_toUpstream, &m_toDownstream})
+                {
+                    direction->m_buffers.resize(bufferCount);
+                    direction->m_freeBuffers.reserve(bufferCount);
+                    for (size_t index = 0; index < bufferCount; ++index)
+                    {
+                        direction->m_buffers[index].m_buffer = nextBuffer;
+                        direction->m_freeBuffers.push_back(index);
+                        nextBuffer += m_bufferSize;
+                    }
+                }
+                m_toUpstream.m_fromDownstream = true;
+            }
+
+            ~ctsRelayPair() noexcept = default;
+
+            ctsRelayPair(const ctsRelayPair&) = delete;
+            ctsRelayPair& operator=(const ctsRelayPair&) = delete;
+            ctsRelayPair(ctsRelayPair&&) = delete;
+            ctsRelayPair& operator=(ctsRelayPair&&) = delete;
+
+            // creates, binds and connects the upstream socket
+            // - returns the error if the ConnectEx could not be posted (the caller's IO count is still held)
+            // - can throw wil::ResultException or std::bad_alloc before the ConnectEx is posted
+            DWORD Connect()
+            {
+                const auto& relayAddresses = ctsConfig::g_configSettings->RelayAddresses;
+                const auto targetCounter = ctl::ctMemoryGuardIncrement(&g_targetCounter);
+                const ctl::ctSockaddr targetAddress(relayAddresses[targetCounter % relayAddresses.size()]);
+                const ctl::ctSockaddr localAddress(targetAddress.family(), ctl::ctSockaddr::AddressType::Any);
+
+                m_upstream.reset(ctsConfig::CreateSocket(targetAddress.family(), SOCK_STREAM, IPPROTO_TCP, ctsConfig::g_configSettings->SocketFlags));
+
+                DWORD error = ctsConfig::SetPreBindOptions(m_upstream.get(), localAddress);
+                if (NO_ERROR == error && SOCKET_ERROR == bind(m_upstream.get(), localAddress.sockaddr(), localAddress.length()))
+                {
+                    error = WSAGetLastError();
+                    ctsConfig::PrintErrorIfFailed("bind", error);
+                }
+                if (NO_ERROR == error)
+                {
+                    error = ctsConfig::SetPreConnectOptions(m_upstream.get());
+                }
+                if (error != NO_ERROR)
+                {
+                    g_upstreamFailures.Increment();
+                    return error;
+                }
+
+                m_upstreamIocp = ctsConfig::CreateSocketThreadIocp(m_upstream.get());
+                OVERLAPPED* pOverlapped = m_upstreamIocp->new_request(
+                    [pair = shared_from_this()](OVERLAPPED* pCallbackOverlapped) noexcept { pair->ConnectCompleted(pCallbackOverlapped); });
+
+                m_pSocket->IncrementIo();
+                DWORD bytesSent = 0;
+                if (!ctl::ctConnectEx(m_upstream.get(), targetAddress.sockaddr(), targetAddress.length(), nullptr, 0, &bytesSent, pOverlapped))
+                {
+                    error = WSAGetLastError();
+                    if (ERROR_IO_PENDING == error)
+                    {
+                        return NO_ERROR;
+                    }
+
+                    // must call cancel() on the IOCP TP if the IO call fails
+                    m_upstreamIocp->cancel_request(pOverlapped);
+                    m_pSocket->DecrementIo();
+                    ctsConfig::PrintErrorIfFailed("ConnectEx", error);
+                    g_upstreamFailures.Increment();
+                    return error;
+                }
+
+                if (ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp)
+                {
+                    // the completion won't be queued to the IOCP
+                    m_upstreamIocp->cancel_request(pOverlapped);
+                    ConnectCompleted(nullptr);
+                }
+                return NO_ERROR;
+            }
+
+            // releases an IO count on the accepted ctsSocket : the last completes its state
+            // - the caller must not touch the ctsSocket (nor hold its lock) once this is called
+            void ReleaseIo(DWORD error = NO_ERROR) noexcept
+            {
+                if (m_pSocket->DecrementIo() == 0)
+                {
+                    // no IO remains : the first failure recorded is the result of the connection
+                    if (m_error != NO_ERROR)
+                    {
+                        error = m_error;
+                    }
+                    RetireUpstream();
+                    {
+                        // ctsSocket::CompleteState reports the pattern's result : it must be the relay's
+                        const auto lockedSocket = m_pSocket->AcquireSocketLock();
+                        if (auto* const pattern = lockedSocket.GetPatternPointer())
+                        {
+                            pattern->CompleteRelayedIo(error);
+                        }
+                    }
+                    m_pSocket->CompleteState(error);
+                }
+            }
+
+        private:
+            // a null OVERLAPPED* means the ConnectEx completed inline
+            void ConnectCompleted(OVERLAPPED* pOverlapped) noexcept
+            {
+                {
+                    const auto lockedSocket = m_pSocket->AcquireSocketLock();
+
+                    DWORD error = NO_ERROR;
+                    if (pOverlapped)
+                    {
+                        DWORD transferred{};
+                        DWORD flags{};
+                        if (!WSAGetOverlappedResult(m_upstream.get(), pOverlapped, &transferred, FALSE, &flags))
+                        {
+                            error = WSAGetLastError();
+                        }
+                    }
+                    // update the socket context if completed successfully - necessary with ConnectEx
+                    if (NO_ERROR == error && setsockopt(m_upstream.get(), SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0) != 0)
+                    {
+                        error = WSAGetLastError();
+                    }
+
+                    if (error != NO_ERROR)
+                    {
+                        g_upstreamFailures.Increment();
+                        Fail(lockedSocket, error, "ConnectEx");
+                    }
+                    else if (INVALID_SOCKET == lockedSocket.GetSocket())
+                    {
+                        // the accepted connection was closed while connecting upstream
+                        Fail(lockedSocket, WSAECONNABORTED, nullptr);
+                    }
+                    else
+                    {
+                        g_pairsConnected.Increment();
+                        Pump(lockedSocket, m_toUpstream);
+                        Pump(lockedSocket, m_toDownstream);
+                    }
+                }
+
+                ReleaseIo();
+            }
+
+            void IoCompleted(OVERLAPPED* pOverlapped, bool fromDownstream, size_t bufferIndex, bool isSend) noexcept
+            {
+                {
+                    const auto lockedSocket = m_pSocket->AcquireSocketLock();
+                    auto& direction = fromDownstream ? m_toUpstream : m_toDownstream;
+
+                    // recvs are made from the direction's source, sends to the other connection
+                    const bool onDownstream = fromDownstream != isSend;
+                    const SOCKET socket = onDownstream ? lockedSocket.GetSocket() : m_upstream.get();
+
+                    DWORD transferred = 0;
+                    DWORD error = NO_ERROR;
+                    if (INVALID_SOCKET == socket)
+                    {
+                        error = WSAECONNABORTED;
+                    }
+                    else
+                    {
+                        DWORD flags{};
+                        if (!WSAGetOverlappedResult(socket, pOverlapped, &transferred, FALSE, &flags))
+                        {
+                            error = WSAGetLastError();
+                        }
+                    }
+
+                    ProcessCompletion(lockedSocket, direction, bufferIndex, isSend, transferred, error);
+                    Pump(lockedSocket, direction);
+                }
+
+                ReleaseIo();
+            }
+
+            // posts all the IO the direction can take, processing inline completions until its IO pends
+            // - must be called with the socket lock held, while holding an IO count
+            void Pump(const ctsSocket::SocketReference& lockedSocket, ctsRelayDirection& direction) noexcept
+            {
+                auto completedInline = true;
+                while (completedInline && NO_ERROR == m_error)
+                {
+                    completedInline = false;
+                    if (!direction.m_sendPending && !direction.m_receivedBuffers.empty())
+                    {
+                        completedInline |= PostIo(lockedSocket, direction, direction.m_receivedBuffers.front(), true);
+                    }
+                    if (NO_ERROR == m_error && !direction.m_recvPending && !direction.m_finReceived && !direction.m_freeBuffers.empty())
+                    {
+                        const auto bufferIndex = direction.m_freeBuffers.back();
+                        direction.m_freeBuffers.pop_back();
+                        completedInline |= PostIo(lockedSocket, direction, bufferIndex, false);
+                    }
+                }
+
+                if (NO_ERROR == m_error &&
+                    direction.m_finReceived && !direction.m_finForwarded &&
+                    !direction.m_sendPending && direction.m_receivedBuffers.empty())
+                {
+                    direction.m_finForwarded = true;
+                    const SOCKET target = direction.m_fromDownstream ? m_upstream.get() : lockedSocket.GetSocket();
+                    if (INVALID_SOCKET == target)
+                    {
+                        Fail(lockedSocket, WSAECONNABORTED, nullptr);
+                    }
+                    else if (shutdown(target, SD_SEND) != 0)
+                    {
+                        Fail(lockedSocket, WSAGetLastError(), "shutdown");
+                    }
+                }
+            }
+
+            // returns true if the IO completed inline and its completion was processed
+            bool PostIo(const ctsSocket::SocketReference& lockedSocket, ctsRelayDirection& direction, size_t bufferIndex, bool isSend) noexcept
+            try
+            {
+                const bool onDownstream = direction.m_fromDownstream != isSend;
+                const SOCKET socket = onDownstream ? lockedSocket.GetSocket() : m_upstream.get();
+                if (INVALID_SOCKET == socket)
+                {
+                    if (!isSend)
+                    {
+                        direction.m_freeBuffers.push_back(bufferIndex);
+                    }
+                    Fail(lockedSocket, WSAECONNABORTED, nullptr);
+                    return false;
+                }
+
+                auto& buffer = direction.m_buffers[bufferIndex];
+                WSABUF wsabuf{};
+                if (isSend)
+                {
+                    wsabuf.buf = buffer.m_buffer + buffer.m_sent;
+                    wsabuf.len = buffer.m_length - buffer.m_sent;
+                }
+                else
+                {
+                    wsabuf.buf = buffer.m_buffer;
+                    wsabuf.len = m_bufferSize;
+                }
+
+                const std::shared_ptr<ctl::ctThreadIocp>& iocp = onDownstream ? m_pSocket->GetIocpThreadpool() : m_upstreamIocp;
+                OVERLAPPED* pOverlapped = iocp->new_request(
+                    [pair = shared_from_this(), fromDownstream = direction.m_fromDownstream, bufferIndex, isSend](OVERLAPPED* pCallbackOverlapped) noexcept {
+                        pair->IoCompleted(pCallbackOverlapped, fromDownstream, bufferIndex, isSend);
+                    });
+
+                m_pSocket->IncrementIo();
+                DWORD transferred = 0;
+                DWORD flags = 0;
+                const auto result = isSend ?
+                    WSASend(socket, &wsabuf, 1, &transferred, 0, pOverlapped, nullptr) :
+                    WSARecv(socket, &wsabuf, 1, &transferred, &flags, pOverlapped, nullptr);
+                if (SOCKET_ERROR == result)
+                {
+                    const auto error = WSAGetLastError();
+                    if (WSA_IO_PENDING == error)
+                    {
+                        (isSend ? direction.m_sendPending : direction.m_recvPending) = true;
+                        return false;
+                    }
+
+                    // must call cancel() on the IOCP TP if the IO call fails
+                    iocp->cancel_request(pOverlapped);
+                    // never the last IO count : the caller holds its own
+                    m_pSocket->DecrementIo();
+                    if (!isSend)
+                    {
+                        direction.m_freeBuffers.push_back(bufferIndex);
+                    }
+                    Fail(lockedSocket, error, isSend ? "WSASend" : "WSARecv");
+                    return false;
+                }
+
+                if (ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp)
+                {
+                    // the completion won't be queued to the IOCP
+                    iocp->cancel_request(pOverlapped);
+                    m_pSocket->DecrementIo();
+                    (isSend ? direction.m_sendPending : direction.m_recvPending) = true;
+                    ProcessCompletion(lockedSocket, direction, bufferIndex, isSend, transferred, NO_ERROR);
+                    return true;
+                }
+
+                (isSend ? direction.m_sendPending : direction.m_recvPending) = true;
+                return false;
+            }
+            catch (...)
+            {
+                if (!isSend)
+                {
+                    direction.m_freeBuffers.push_back(bufferIndex);
+                }
+                Fail(lockedSocket, ctsConfig::PrintThrownException(), nullptr);
+                return false;
+            }
+
+            // must be called with the socket lock held
+            void ProcessCompletion(const ctsSocket::SocketReference& lockedSocket, ctsRelayDirection& direction, size_t bufferIndex, bool isSend, DWORD transferred, DWORD error) noexcept
+            {
+                auto& buffer = direction.m_buffers[bufferIndex];
+                if (isSend)
+                {
+                    direction.m_sendPending = false;
+                }
+                else
+                {
+                    direction.m_recvPending = false;
+                }
+
+                if (error != NO_ERROR || m_error != NO_ERROR)
+                {
+                    if (!isSend)
+                    {
+                        direction.m_freeBuffers.push_back(bufferIndex);
+                    }
+                    Fail(lockedSocket, error, isSend ? "WSASend" : "WSARecv");
+                    return;
+                }
+
+                ctsConfig::g_configSettings->TcpStatusDetails.m_ioCompletions.Increment();
+                if (!isSend)
+                {
+                    if (0 == transferred)
+                    {
+                        // the FIN is forwarded once the buffers received before it are sent
+                        direction.m_finReceived = true;
+                        direction.m_freeBuffers.push_back(bufferIndex);
+                        return;
+                    }
+
+                    buffer.m_length = transferred;
+                    buffer.m_sent = 0;
+                    buffer.m_recvCompletedQpc = ctl::ctTimer::SnapQpc();
+                    direction.m_receivedBuffers.push_back(bufferIndex);
+                    return;
+                }
+
+                buffer.m_sent += transferred;
+                if (buffer.m_sent < buffer.m_length)
+                {
+                    // the remainder is sent with the next Pump : the buffer stays at the front
+                    return;
+                }
+
+                g_forwardLatency.Record(ctl::ctTimer::SnapQpc() - buffer.m_recvCompletedQpc);
+                g_bytesForwarded.Add(buffer.m_length);
+                auto* const pattern = lockedSocket.GetPatternPointer();
+                if (direction.m_fromDownstream)
+                {
+                    ctsConfig::g_configSettings->TcpStatusDetails.m_bytesRecv.Add(buffer.m_length);
+                    if (pattern)
+                    {
+                        pattern->AddRelayedBytes(buffer.m_length, 0);
+                    }
+                }
+                else
+                {
+                    ctsConfig::g_configSettings->TcpStatusDetails.m_bytesSent.Add(buffer.m_length);
+                    if (pattern)
+                    {
+                        pattern->AddRelayedBytes(0, buffer.m_length);
+                    }
+                }
+
+                direction.m_receivedBuffers.pop_front();
+                direction.m_freeBuffers.push_back(bufferIndex);
+            }
+
+            // records the first failure and cancels the IO still pended on either connection
+            // - a null functionName records the error without printing it
+            void Fail(const ctsSocket::SocketReference& lockedSocket, DWORD error, _In_opt_ PCSTR functionName) noexcept
+            {
+                if (m_error != NO_ERROR || NO_ERROR == error)
+                {
+                    return;
+                }
+
+                if (functionName)
+                {
+                    ctsConfig::PrintErrorIfFailed(functionName, error);
+                }
+                m_error = error;
+
+                if (lockedSocket.GetSocket() != INVALID_SOCKET)
+                {
+                    CancelIoEx(reinterpret_cast<HANDLE>(lockedSocket.GetSocket()), nullptr);
+                }
+                if (m_upstream)
+                {
+                    CancelIoEx(reinterpret_cast<HANDLE>(m_upstream.get()), nullptr);
+                }
+            }
+
+            // closes the upstream socket once its IO has completed
+            // - its ctThreadIocp is destroyed on another threadpool thread : this is usually called from one of its callbacks,
+            //   and it waits for its callbacks to complete as it's destroyed
+            void RetireUpstream() noexcept
+            {
+                m_upstream.reset();
+                if (!m_upstreamIocp)
+                {
+                    return;
+                }
+
+                *m_retiredIocp = std::move(m_upstreamIocp);
+                if (TrySubmitThreadpoolCallback(RetireCallback, m_retiredIocp.get(), ctsConfig::g_configSettings->pTpEnvironment))
+                {
+                    m_retiredIocp.release();
+                    return;
+                }
+
+                ctsConfig::PrintErrorIfFailed("TrySubmitThreadpoolCallback", GetLastError());
+                // leaked rather than waiting on the callback this is (usually) being called from
+                m_retiredIocp.release();
+            }
+
+            static void NTAPI RetireCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID context) noexcept
+            {
+                const std::unique_ptr<std::shared_ptr<ctl::ctThreadIocp>> retired(static_cast<std::shared_ptr<ctl::ctThreadIocp>*>(context));
+            }
+
+            ctsSocket* const m_pSocket;
+            const unsigned long m_bufferSize;
+            // allocated up front : retiring the ctThreadIocp can't fail for lack of memory
+            std::unique_ptr<std::shared_ptr<ctl::ctThreadIocp>> m_retiredIocp;
+            std::unique_ptr<char[]> m_bufferMemory;
+            wil::unique_socket m_upstream;
+            std::shared_ptr<ctl::ctThreadIocp> m_upstreamIocp;
+            ctsRelayDirection m_toUpstream;
+            ctsRelayDirection m_toDownstream;
+            // the first failure on either connection - guarded by the socket lock
+            DWORD m_error = NO_ERROR;
+        };
+    }
+
+    void ctsRelayIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        const auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        // IO callbacks refer to the ctsSocket by raw pointer : it keeps itself alive until CompleteState
+        sharedSocket->HoldIoReference();
+        // hold an IO count while the upstream connection is started
+        sharedSocket->IncrementIo();
+
+        std::shared_ptr<RelayIo::ctsRelayPair> pair;
+        DWORD error = NO_ERROR;
+        try
+        {
+            pair = std::make_shared<RelayIo::ctsRelayPair>(sharedSocket.get());
+            error = pair->Connect();
+        }
+        catch (...)
+        {
+            error = ctsConfig::PrintThrownException();
+            RelayIo::g_upstreamFailures.Increment();
+        }
+
+        if (pair)
+        {
+            pair->ReleaseIo(error);
+        }
+        else if (sharedSocket->DecrementIo() == 0)
+        {
+            sharedSocket->CompleteState(error);
+        }
+    }
+
+    void ctsRelayPrintSummary(long long totalTimeMilliseconds) noexcept
+    {
+        if (ctsConfig::g_configSettings->IoFunction != ctsRelayIocp)
+        {
+            return;
+        }
+
+        const auto bytesForwarded = RelayIo::g_bytesForwarded.GetValue();
+        const auto seconds = totalTimeMilliseconds > 0 ? static_cast<double>(totalTimeMilliseconds) / 1000.0 : 0.0;
+        const auto forwardLatency = RelayIo::g_forwardLatency.GetTotal();
+        // the whole process : every thread forwarding bytes, and the accepts and connects pairing them
+        const auto cpu = ctsCpuSnapshot::Snap().Difference(ctsConfig::g_configSettings->StartCpu);
+        // 10 100ns units per microsecond
+        const auto cpuMicroseconds = static_cast<double>(cpu.m_kernelTime + cpu.m_userTime) / 10.0;
+        ctsConfig::PrintSummary(
+            L"\n"
+            L"  Relay :\n"
+            L"    Pairs Connected : %lld  Upstream Connects Failed [%lld]\n"
+            L"    Forwarded Throughput : %.3f MB/sec  (%lld bytes forwarded in both directions)\n"
+            L"    Added Latency (us) : Median [%lld]  99th [%lld]  Max [%lld]  (from each recv completing to its forwarded send completing)\n"
+            L"    Forwarding CPU : %.3f cycles/byte  %.1f CPU us/MB\n",
+            RelayIo::g_pairsConnected.GetValue(),
+            RelayIo::g_upstreamFailures.GetValue(),
+            seconds > 0.0 ? static_cast<double>(bytesForwarded) / 1048576.0 / seconds : 0.0,
+            bytesForwarded,
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(forwardLatency.GetPercentile(50.0)),
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(forwardLatency.GetPercentile(99.0)),
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(forwardLatency.GetMaximum()),
+            cpu.CyclesPer(bytesForwarded),
+            bytesForwarded > 0 ? cpuMicroseconds / (static_cast<double>(bytesForwarded) / 1048576.0) : 0.0);
+    }
+}
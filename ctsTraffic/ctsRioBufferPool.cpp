@@ -0,0 +1,142 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// ReSharper disable CppClangTidyClangDiagnosticExitTimeDestructors
+
+// parent header
+#include "ctsRioBufferPool.h"
+// cpp headers
+#include <algorithm>
+#include <vector>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include <ctSocketExtensions.hpp>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic::ctsRioBufferPool
+{
+    // slices are cache-line aligned so IO into adjacent slices never shares a cache line
+    constexpr unsigned long c_sliceAlignment = 64;
+    // each registered region is at least this large (rounded up to the large page size when used)
+    constexpr SIZE_T c_minimumRegionSize = 0x1000000; // 16MB
+
+    // all slices of the same (aligned) length are tracked together
+    // - in practice there are very few size classes: every connection in a run requests the same sizes
+    struct ctsRioBufferSizeClass
+    {
+        unsigned long m_sliceLength = 0;
+        std::vector<ctsRioBufferSlice> m_freeSlices;
+    };
+
+    static wil::critical_section g_poolLock{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };
+    static std::vector<ctsRioBufferSizeClass> g_sizeClasses;
+
+    //
+    // Allocates and registers a new region, carving it into slices of the size class
+    // - regions are never deregistered or freed : they are reused for the lifetime of the process
+    // - requires g_poolLock to be held
+    //
+    static void AddRegion(ctsRioBufferSizeClass& sizeClass)
+    {
+        SIZE_T regionSize = std::max<SIZE_T>(c_minimumRegionSize, sizeClass.m_sliceLength);
+
+        // large pages require SeLockMemoryPrivilege - fall back to regular pages when not granted
+        char* region = nullptr;
+        const SIZE_T largePageSize = GetLargePageMinimum();
+        if (largePageSize > 0)
+        {
+            const SIZE_T largeRegionSize = (regionSize + largePageSize - 1) / largePageSize * largePageSize;
+            region = static_cast<char*>(VirtualAlloc(nullptr, largeRegionSize, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE));
+            if (region)
+            {
+                regionSize = largeRegionSize;
+            }
+        }
+        if (!region)
+        {
+            region = static_cast<char*>(VirtualAlloc(nullptr, regionSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+            THROW_LAST_ERROR_IF_NULL_MSG(region, "VirtualAlloc (RIO buffer pool region)");
+        }
+        auto freeRegionOnError = wil::scope_exit([&]() noexcept { VirtualFree(region, 0, MEM_RELEASE); });
+
+        // RIO registration is limited to a DWORD length
+        regionSize = std::min<SIZE_T>(regionSize, MAXDWORD / sizeClass.m_sliceLength * sizeClass.m_sliceLength);
+        const RIO_BUFFERID bufferId = ctl::ctRIORegisterBuffer(region, static_cast<DWORD>(regionSize));
+        if (RIO_INVALID_BUFFERID == bufferId)
+        {
+            THROW_WIN32_MSG(WSAGetLastError(), "RIORegisterBuffer (RIO buffer pool region)");
+        }
+        auto deregisterOnError = wil::scope_exit([&]() noexcept { ctl::ctRIODeregisterBuffer(bufferId); });
+
+        // push slices in reverse so the lowest addresses are leased first
+        const auto sliceCount = static_cast<unsigned long>(regionSize / sizeClass.m_sliceLength);
+        sizeClass.m_freeSlices.reserve(sizeClass.m_freeSlices.size() + sliceCount);
+        for (auto slice = sliceCount; slice > 0; --slice)
+        {
+            ctsRioBufferSlice newSlice;
+            newSlice.m_offset = (slice - 1) * sizeClass.m_sliceLength;
+            newSlice.m_buffer = region + newSlice.m_offset;
+            newSlice.m_bufferId = bufferId;
+            newSlice.m_length = sizeClass.m_sliceLength;
+            sizeClass.m_freeSlices.push_back(newSlice);
+        }
+
+        deregisterOnError.release();
+        freeRegionOnError.release();
+    }
+
+    ctsRioBufferSlice Lease(unsigned long length)
+    {
+        FAIL_FAST_IF_MSG(0 == length, "ctsRioBufferPool::Lease requires a non-zero length");
+        const unsigned long sliceLength = (length + c_sliceAlignment - 1) / c_sliceAlignment * c_sliceAlignment;
+
+        const auto lock = g_poolLock.lock();
+        auto foundClass = std::find_if(
+            std::begin(g_sizeClasses),
+            std::end(g_sizeClasses),
+            [&](const ctsRioBufferSizeClass& sizeClass) noexcept { return sizeClass.m_sliceLength == sliceLength; });
+        if (foundClass == std::end(g_sizeClasses))
+        {
+            g_sizeClasses.emplace_back();
+            g_sizeClasses.rbegin()->m_sliceLength = sliceLength;
+            foundClass = g_sizeClasses.end() - 1;
+        }
+
+        if (foundClass->m_freeSlices.empty())
+        {
+            AddRegion(*foundClass);
+        }
+
+        const auto returnSlice = *foundClass->m_freeSlices.rbegin();
+        foundClass->m_freeSlices.pop_back();
+        return returnSlice;
+    }
+
+    void Return(const ctsRioBufferSlice& slice) noexcept
+    {
+        const auto lock = g_poolLock.lock();
+        const auto foundClass = std::find_if(
+            std::begin(g_sizeClasses),
+            std::end(g_sizeClasses),
+            [&](const ctsRioBufferSizeClass& sizeClass) noexcept { return sizeClass.m_sliceLength == slice.m_length; });
+        FAIL_FAST_IF_MSG(
+            foundClass == std::end(g_sizeClasses),
+            "ctsRioBufferPool::Return was given a slice (%p) of an unknown length (%lu)", slice.m_buffer, slice.m_length);
+
+        // the free list was reserved for every slice of the region when it was carved - this cannot reallocate
+        foundClass->m_freeSlices.push_back(slice);
+    }
+}
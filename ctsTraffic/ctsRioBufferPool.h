@@ -0,0 +1,105 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+#include <MSWSock.h>
+
+// ** NOTE ** should not include any local project cts headers - to avoid circular references
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsRioBufferPool
+    ///
+    /// Process-wide pool of RIO registered memory
+    /// - a few large regions are registered once (with large pages when the process is allowed to)
+    ///   and carved into fixed-size slices : a slice is the RIO_BUFFERID of its region plus its offset
+    /// - connections lease slices when they create their buffers and return them when destroyed
+    ///   so connection setup never calls RIORegisterBuffer, and registered memory is bounded by
+    ///   the peak number of concurrent connections rather than the total number of connections
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    struct ctsRioBufferSlice
+    {
+        char* m_buffer = nullptr;
+        RIO_BUFFERID m_bufferId = RIO_INVALID_BUFFERID;
+        unsigned long m_offset = 0;
+        unsigned long m_length = 0;
+    };
+
+    namespace ctsRioBufferPool
+    {
+        // Returns a slice of at least the requested length
+        // - can throw wil::ResultException on a Win32 error (failing to allocate or register a new region)
+        // - can throw std::bad_alloc
+        ctsRioBufferSlice Lease(unsigned long length);
+
+        // Makes the slice available to be leased again - the region stays registered
+        void Return(const ctsRioBufferSlice& slice) noexcept;
+    }
+
+    // RAII wrapper returning the slice to the pool on destruction
+    class ctsRioBufferLease
+    {
+    public:
+        ctsRioBufferLease() noexcept = default;
+        explicit ctsRioBufferLease(unsigned long length) : m_slice(ctsRioBufferPool::Lease(length))
+        {
+        }
+        ~ctsRioBufferLease() noexcept
+        {
+            Reset();
+        }
+
+        // only movable to guarantee the slice is returned exactly once
+        ctsRioBufferLease(const ctsRioBufferLease&) = delete;
+        ctsRioBufferLease& operator=(const ctsRioBufferLease&) = delete;
+
+        ctsRioBufferLease(ctsRioBufferLease&& rhs) noexcept : m_slice(rhs.m_slice)
+        {
+            rhs.m_slice = ctsRioBufferSlice();
+        }
+        ctsRioBufferLease& operator=(ctsRioBufferLease&& rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                Reset();
+                m_slice = rhs.m_slice;
+                rhs.m_slice = ctsRioBufferSlice();
+            }
+            return *this;
+        }
+
+        void Reset() noexcept
+        {
+            if (m_slice.m_buffer != nullptr)
+            {
+                ctsRioBufferPool::Return(m_slice);
+                m_slice = ctsRioBufferSlice();
+            }
+        }
+
+        [[nodiscard]] const ctsRioBufferSlice& Get() const noexcept
+        {
+            return m_slice;
+        }
+
+    private:
+        ctsRioBufferSlice m_slice;
+    };
+}
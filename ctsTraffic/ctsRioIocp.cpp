@@ -12,10 +12,14 @@ See the Apache Version 2.0 License for specific language governing permissions a
 */
 
 // cpp headers
+#include <algorithm>
 #include <atomic>
 #include <array>
+#include <functional>
 #include <memory>
+#include <new>
 #include <utility>
+#include <vector>
 // os headers
 #include <Windows.h>
 #include <WinSock2.h>
@@ -26,10 +30,15 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // ctl headers
 #include <ctSocketExtensions.hpp>
 #include <ctSockaddr.hpp>
+#include <ctTimer.hpp>
 // local headers
 #include "ctsConfig.h"
 #include "ctsSocket.h"
 #include "ctsIOTask.hpp"
+#include "ctsMediaStreamProtocol.hpp"
+#include "ctsRioBufferPool.h"
+#include "ctsTraceLogging.h"
+#include "ctsThreadStatistics.h"
 
 namespace ctsTraffic
 {
@@ -38,19 +47,49 @@ namespace ctsTraffic
         //
         // constants for everything related to ctsRioIocp
         //
+        // the adaptive dequeue batch starts at (and never shrinks below) c_rioResultArrayLength
+        // - and grows up to c_RioMaxDequeueBatchSize while the CQ keeps returning full batches
         constexpr uint32_t c_rioResultArrayLength = 20;
+        constexpr uint32_t c_rioMaxResultArrayLength = ctsConfig::ctsConfigSettings::c_RioMaxDequeueBatchSize;
         constexpr ULONG_PTR c_exitCompletionKey = 0xffffffff;
+        constexpr uint32_t c_rioDefaultCqSize = 1000;
+
+        //
+        // Each RIO_CQ is tracked with its own lock, notification IOCP, and sizing
+        // - by default there is a single CQ shared by one worker thread per processor
+        // - with -RioCompletionQueues, there is one CQ per worker thread (each affinitized to a processor)
+        //   so dequeue, notify and resize are never serialized across CQs
+        //
+        struct RioCompletionQueue
+        {
+            // CRITICAL_SECTION not deleted on exit - not racing during process exit
+            CRITICAL_SECTION m_queueLock{};
+            RIO_NOTIFICATION_COMPLETION m_rioNotifySettings{};
+            // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
+            RIO_CQ m_rioCompletionQueue = RIO_INVALID_CQ;
+            uint32_t m_rioCompletionQueueSize = 0;
+            uint32_t m_rioCompletionQueueUsed = 0;
+            HANDLE* m_pRioWorkerThreads = nullptr;
+            uint32_t m_rioWorkerThreadCount = 0;
+        };
+
         //
         // forward-declaring CQ-functions leveraging the below variables
         //
-        static DWORD MakeRoomInCq(uint32_t newSlots) noexcept;
-        static void ReleaseRoomInCompletionQueue(uint32_t slots) noexcept;
-        static ULONG DequeFromCompletionQueue(_Out_writes_(RioResultArrayLength) RIORESULT* rioResults) noexcept;
+        static DWORD MakeRoomInCq(RioCompletionQueue* pQueue, uint32_t newSlots) noexcept;
+        static void ReleaseRoomInCompletionQueue(RioCompletionQueue* pQueue, uint32_t slots) noexcept;
+        static ULONG DequeFromCompletionQueue(RioCompletionQueue* pQueue, _Out_writes_(resultLength) RIORESULT* rioResults, ULONG resultLength) noexcept;
+        static ULONG InitialDequeueBatchSize() noexcept;
+        static ULONG NextDequeueBatchSize(ULONG currentBatchSize, ULONG dequeuedCount) noexcept;
+        static RioCompletionQueue* AssignCompletionQueue() noexcept;
+        static void DeleteCompletionQueue(RioCompletionQueue* pQueue) noexcept;
         static void DeleteAllCompletionQueues() noexcept;
+        static void ProcessCompletions(_In_reads_(completionCount) const RIORESULT* rioResults, ULONG completionCount) noexcept;
         //
-        // Forward-declaring the IOCP threadpool function
+        // Forward-declaring the IOCP threadpool function and the polling thread function
         //
         static DWORD WINAPI RioIocpThreadProc(LPVOID) noexcept;  // NOLINT(bugprone-exception-escape)
+        static DWORD WINAPI RioPollThreadProc(LPVOID) noexcept;  // NOLINT(bugprone-exception-escape)
         //
         // Management of the CQ and its corresponding threadpool implemented in this unnamed namespace
         // - initialized with InitOneExecuteOnce
@@ -59,26 +98,33 @@ namespace ctsTraffic
         // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
         static INIT_ONCE g_sharedbufferInitializer = INIT_ONCE_STATIC_INIT;
 
-        // global CRITICAL_SECTION no deleting on exit - not racing during process exit
-        static CRITICAL_SECTION g_queueLock {};  // NOLINT(cppcoreguidelines-interfaces-global-init, clang-diagnostic-exit-time-destructors)
-        static RIO_NOTIFICATION_COMPLETION g_rioNotifySettings;
-        // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
-        static RIO_CQ g_rioCompletionQueue = RIO_INVALID_CQ;
-        static uint32_t g_rioComplectionQueueSize = 0;
-        static uint32_t g_rioCompletionQueueUsed = 0;
-        static HANDLE* g_pRioWorkerThreads = nullptr;
-        static uint32_t g_rioWorkerThreadCount = 0;
+        static RioCompletionQueue* g_pRioCompletionQueues = nullptr;
+        static uint32_t g_rioCompletionQueueCount = 0;
+        // sockets are assigned to CQs round-robin
+        static std::atomic<uint32_t> g_nextRioCompletionQueue{ 0 };
+        // polling threads exit once this is set
+        static std::atomic<bool> g_rioPollExit{ false };
 
-        static DWORD MakeRoomInCq(uint32_t newSlots) noexcept
+        //
+        // completion statistics to compare the IOCP-notified and polling models
+        // - latency is the QPC delta between posting the IO and processing its dequeued completion
+        // - completion and dequeue counts are tracked in TcpStatusDetails to be shown in the status output
+        //
+        static ctsShardedStatsTracking g_rioCompletionLatencyQpc;
+        static ctsShardedStatsTracking g_rioEmptyPollCount;
+        // RIOResizeRequestQueue calls made as connections pended more IO than their RQ was sized for
+        static ctsShardedStatsTracking g_rioRequestQueueResizes;
+
+        static DWORD MakeRoomInCq(RioCompletionQueue* pQueue, uint32_t newSlots) noexcept
         {
-            const auto lock = wil::EnterCriticalSection(&g_queueLock);
+            const auto lock = wil::EnterCriticalSection(&pQueue->m_queueLock);
 
-            const ULONG newCqUsed = g_rioCompletionQueueUsed + newSlots;
-            if (g_rioComplectionQueueSize < newCqUsed)
+            const ULONG newCqUsed = pQueue->m_rioCompletionQueueUsed + newSlots;
+            if (pQueue->m_rioCompletionQueueSize < newCqUsed)
             {
                 // fail hard if we are already at the max CQ size and can't grow it for more IO
                 FAIL_FAST_IF_MSG(
-                    (RIO_MAX_CQ_SIZE == g_rioComplectionQueueSize) || (newCqUsed > RIO_MAX_CQ_SIZE),
+                    (RIO_MAX_CQ_SIZE == pQueue->m_rioCompletionQueueSize) || (newCqUsed > RIO_MAX_CQ_SIZE),
                     "ctsRioIocp: attempting to grow the CQ beyond RIO_MAX_CQ_SIZE");
 
                 // multiply new_cq_used by 1.25 for bettery growth patterns
@@ -90,23 +136,34 @@ namespace ctsTraffic
                 }
 
                 PRINT_DEBUG_INFO(
-                    L"\t\tctsRioIocp: Resizing the CQ from %u to %u (used slots = %u increasing used slots to %u)\n",
-                    g_rioComplectionQueueSize,
+                    L"\t\tctsRioIocp: Resizing the CQ (%p) from %u to %u (used slots = %u increasing used slots to %u)\n",
+                    pQueue->m_rioCompletionQueue,
+                    pQueue->m_rioCompletionQueueSize,
                     newCqSize,
-                    g_rioCompletionQueueUsed,
+                    pQueue->m_rioCompletionQueueUsed,
                     newCqUsed);
 
-                if (!ctl::ctRIOResizeCompletionQueue(g_rioCompletionQueue, newCqSize))
+                if (!ctl::ctRIOResizeCompletionQueue(pQueue->m_rioCompletionQueue, newCqSize))
                 {
                     const auto gle = WSAGetLastError();
                     ctsConfig::PrintErrorIfFailed("ctRIOResizeCompletionQueue", gle);
                     return gle;
                 }
 
-                g_rioComplectionQueueSize = newCqSize;
+                TraceLoggingWrite(
+                    g_ctsTraceLoggingProvider,
+                    "RioCqResize",
+                    TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+                    TraceLoggingKeyword(CTS_TRACE_KEYWORD_RIO),
+                    TraceLoggingPointer(pQueue->m_rioCompletionQueue, "CompletionQueue"),
+                    TraceLoggingUInt32(pQueue->m_rioCompletionQueueSize, "OldSize"),
+                    TraceLoggingUInt32(newCqSize, "NewSize"),
+                    TraceLoggingUInt32(newCqUsed, "UsedSlots"));
+                pQueue->m_rioCompletionQueueSize = newCqSize;
             }
 
-            g_rioCompletionQueueUsed = newCqUsed;
+            pQueue->m_rioCompletionQueueUsed = newCqUsed;
+            ctsConfig::g_configSettings->TcpStatusDetails.m_rioCompletionQueueUsed.Add(newSlots);
             return ERROR_SUCCESS;
         }
 
@@ -115,21 +172,23 @@ namespace ctsTraffic
         /// Release slots in the CQ
         ///
         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        static void ReleaseRoomInCompletionQueue(uint32_t slots) noexcept
+        static void ReleaseRoomInCompletionQueue(RioCompletionQueue* pQueue, uint32_t slots) noexcept
         {
-            const auto lock = wil::EnterCriticalSection(&g_queueLock);
+            const auto lock = wil::EnterCriticalSection(&pQueue->m_queueLock);
 
             FAIL_FAST_IF_MSG(
-                g_rioCompletionQueueUsed < slots,
+                pQueue->m_rioCompletionQueueUsed < slots,
                 "ctsRioIocp::release_room_in_cq(%u): underflow - current rio_cq_used value (%u)",
-                slots, g_rioCompletionQueueUsed);
+                slots, pQueue->m_rioCompletionQueueUsed);
 
             PRINT_DEBUG_INFO(
-                L"\t\tctsRioIocp: Reducing the CQ used slots from %u to %u\n",
-                g_rioCompletionQueueUsed,
-                g_rioCompletionQueueUsed - slots);
+                L"\t\tctsRioIocp: Reducing the CQ (%p) used slots from %u to %u\n",
+                pQueue->m_rioCompletionQueue,
+                pQueue->m_rioCompletionQueueUsed,
+                pQueue->m_rioCompletionQueueUsed - slots);
 
-            g_rioCompletionQueueUsed -= slots;
+            pQueue->m_rioCompletionQueueUsed -= slots;
+            ctsConfig::g_configSettings->TcpStatusDetails.m_rioCompletionQueueUsed.Subtract(slots);
         }
 
         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -138,11 +197,11 @@ namespace ctsTraffic
         /// - will always post a Notify with proper synchronization
         ///
         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        static ULONG DequeFromCompletionQueue(_Out_writes_(RioResultArrayLength) RIORESULT* rioResults) noexcept
+        static ULONG DequeFromCompletionQueue(RioCompletionQueue* pQueue, _Out_writes_(resultLength) RIORESULT* rioResults, ULONG resultLength) noexcept
         {
-            const auto lock = wil::EnterCriticalSection(&g_queueLock);
+            const auto lock = wil::EnterCriticalSection(&pQueue->m_queueLock);
 
-            const auto dequeResultCount = ctl::ctRIODequeueCompletion(g_rioCompletionQueue, rioResults, c_rioResultArrayLength);
+            const auto dequeResultCount = ctl::ctRIODequeueCompletion(pQueue->m_rioCompletionQueue, rioResults, resultLength);
 
             // We were notified there were completions, but we can't dequeue any IO
             // - something has gone horribly wrong - likely our CQ is corrupt
@@ -151,47 +210,98 @@ namespace ctsTraffic
                 // ReSharper disable once CppRedundantParentheses
                 (0 == dequeResultCount) || (RIO_CORRUPT_CQ == dequeResultCount),
                 "ctRIODequeueCompletion on(%p) returned [%u] : expected to have dequeued IO after being signaled",
-                g_rioCompletionQueue, dequeResultCount);
+                pQueue->m_rioCompletionQueue, dequeResultCount);
 
             // Immediately after invoking Dequeue, post another Notify
-            const auto notifyResult = ctl::ctRIONotify(g_rioCompletionQueue);
+            const auto notifyResult = ctl::ctRIONotify(pQueue->m_rioCompletionQueue);
 
             // if notify fails, we can't reliably know when the next IO completes
             // - this will cause everything to come to a grinding halt
             // Will kill the test into the debugger to investigate
             FAIL_FAST_IF_MSG(
                 notifyResult != 0,
-                "RIONotify(%p) failed [%d]", g_rioCompletionQueue, notifyResult);
+                "RIONotify(%p) failed [%d]", pQueue->m_rioCompletionQueue, notifyResult);
 
             return dequeResultCount;
         }
 
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Dequeue batch sizing
+        /// - a fixed -RioDequeueBatch size is always used as-is
+        /// - otherwise the batch adapts per worker thread:
+        ///   - doubling when a dequeue fills the entire batch (the CQ is still backed up)
+        ///   - halving when a dequeue returns less than a quarter of the batch (the CQ is mostly idle)
+        ///
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        static ULONG InitialDequeueBatchSize() noexcept
+        {
+            const auto configuredBatchSize = ctsConfig::g_configSettings->RioDequeueBatchSize;
+            return configuredBatchSize > 0 ? configuredBatchSize : c_rioResultArrayLength;
+        }
+
+        static ULONG NextDequeueBatchSize(ULONG currentBatchSize, ULONG dequeuedCount) noexcept
+        {
+            if (ctsConfig::g_configSettings->RioDequeueBatchSize > 0)
+            {
+                return currentBatchSize;
+            }
+
+            if (dequeuedCount >= currentBatchSize)
+            {
+                return std::min<ULONG>(currentBatchSize * 2, c_rioMaxResultArrayLength);
+            }
+
+            if (dequeuedCount < currentBatchSize / 4)
+            {
+                return std::max<ULONG>(currentBatchSize / 2, c_rioResultArrayLength);
+            }
+
+            return currentBatchSize;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Returns the CQ the next RIO socket should use for its RQ
+        ///
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        static RioCompletionQueue* AssignCompletionQueue() noexcept
+        {
+            if (1 == g_rioCompletionQueueCount)
+            {
+                return &g_pRioCompletionQueues[0];
+            }
+            const auto nextQueue = g_nextRioCompletionQueue.fetch_add(1, std::memory_order_relaxed);
+            return &g_pRioCompletionQueues[nextQueue % g_rioCompletionQueueCount];
+        }
+
         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
         ///
         /// Shutdown all IOCP threads and close the CQ
         ///
         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        static void DeleteAllCompletionQueues() noexcept
+        static void DeleteCompletionQueue(RioCompletionQueue* pQueue) noexcept
         {
             unsigned threadsAlive = 0;
 
             // send an exit key to all threads, then wait on all threads to exit
-            for (auto loopWorkers = 0ul; loopWorkers < g_rioWorkerThreadCount; ++loopWorkers)
+            for (auto loopWorkers = 0ul; loopWorkers < pQueue->m_rioWorkerThreadCount; ++loopWorkers)
             {
                 // queue an exit key to the worker thread
-                if (g_pRioWorkerThreads[loopWorkers] != nullptr)
+                // - polling threads have no IOCP, they exit once g_rioPollExit is set
+                if (pQueue->m_pRioWorkerThreads[loopWorkers] != nullptr)
                 {
                     ++threadsAlive;
-                    if (!PostQueuedCompletionStatus(
-                        g_rioNotifySettings.Iocp.IocpHandle,
+                    if (pQueue->m_rioNotifySettings.Iocp.IocpHandle != nullptr && !PostQueuedCompletionStatus(
+                        pQueue->m_rioNotifySettings.Iocp.IocpHandle,
                         0,
                         c_exitCompletionKey,
-                        static_cast<OVERLAPPED*>(g_rioNotifySettings.Iocp.Overlapped)))
+                        static_cast<OVERLAPPED*>(pQueue->m_rioNotifySettings.Iocp.Overlapped)))
                     {
                         // if can't indicate to exit, kill the process to see why
                         FAIL_FAST_MSG(
                             "PostQueuedCompletionStatus(%p) failed [%u] to tear down the threadpool",
-                            g_rioNotifySettings.Iocp.IocpHandle, GetLastError());
+                            pQueue->m_rioNotifySettings.Iocp.IocpHandle, GetLastError());
                     }
                 }
             }
@@ -201,159 +311,260 @@ namespace ctsTraffic
             {
                 if (WaitForMultipleObjects(
                     threadsAlive,
-                    &g_pRioWorkerThreads[0],
+                    &pQueue->m_pRioWorkerThreads[0],
                     TRUE,
                     INFINITE) != WAIT_OBJECT_0)
                 {
                     // if can't wait for the worker threads, kill the process to see why
                     FAIL_FAST_MSG(
                         "WaitForMultipleObjects(%p) failed [%u] to wait on the threadpool",
-                        &g_pRioWorkerThreads[0], GetLastError());
+                        &pQueue->m_pRioWorkerThreads[0], GetLastError());
                 }
             }
 
             // now can close the thread handles
-            for (auto loopWorkers = 0ul; loopWorkers < g_rioWorkerThreadCount; ++loopWorkers)
+            for (auto loopWorkers = 0ul; loopWorkers < pQueue->m_rioWorkerThreadCount; ++loopWorkers)
             {
-                if (g_pRioWorkerThreads[loopWorkers] != nullptr)
+                if (pQueue->m_pRioWorkerThreads[loopWorkers] != nullptr)
                 {
-                    CloseHandle(g_pRioWorkerThreads[loopWorkers]);
+                    CloseHandle(pQueue->m_pRioWorkerThreads[loopWorkers]);
                 }
             }
 
-            free(g_pRioWorkerThreads);
-            g_pRioWorkerThreads = nullptr;
-            g_rioWorkerThreadCount = 0;
+            free(pQueue->m_pRioWorkerThreads);
+            pQueue->m_pRioWorkerThreads = nullptr;
+            pQueue->m_rioWorkerThreadCount = 0;
 
             // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
-            if (g_rioCompletionQueue != RIO_INVALID_CQ)
+            if (pQueue->m_rioCompletionQueue != RIO_INVALID_CQ)
             {
-                ctl::ctRIOCloseCompletionQueue(g_rioCompletionQueue);
+                ctl::ctRIOCloseCompletionQueue(pQueue->m_rioCompletionQueue);
                 // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
-                g_rioCompletionQueue = RIO_INVALID_CQ;
+                pQueue->m_rioCompletionQueue = RIO_INVALID_CQ;
             }
 
-            if (g_rioNotifySettings.Iocp.IocpHandle != nullptr)
+            if (pQueue->m_rioNotifySettings.Iocp.IocpHandle != nullptr)
             {
-                CloseHandle(g_rioNotifySettings.Iocp.IocpHandle);
-                g_rioNotifySettings.Iocp.IocpHandle = nullptr;
+                CloseHandle(pQueue->m_rioNotifySettings.Iocp.IocpHandle);
+                pQueue->m_rioNotifySettings.Iocp.IocpHandle = nullptr;
             }
 
-            free(g_rioNotifySettings.Iocp.Overlapped);
-            g_rioNotifySettings.Iocp.Overlapped = nullptr;
+            free(pQueue->m_rioNotifySettings.Iocp.Overlapped);
+            pQueue->m_rioNotifySettings.Iocp.Overlapped = nullptr;
 
-            g_rioComplectionQueueSize = 0;
-            g_rioCompletionQueueUsed = 0;
+            pQueue->m_rioCompletionQueueSize = 0;
+            pQueue->m_rioCompletionQueueUsed = 0;
         }
 
+        static void DeleteAllCompletionQueues() noexcept
+        {
+            g_rioPollExit = true;
+            for (auto loopQueues = 0ul; loopQueues < g_rioCompletionQueueCount; ++loopQueues)
+            {
+                DeleteCompletionQueue(&g_pRioCompletionQueues[loopQueues]);
+            }
+            // not deleting the CRITICAL_SECTIONs or the array - not racing during process exit
+        }
 
         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
         ///
-        /// Singleton initialization routine for the global CQ and its corresponding IOCP thread pool
+        /// Creates the CQ, its notification IOCP, and the worker threads dequeuing from it
+        /// - when processorNumber is >= 0, the single worker thread is affinitized to that processor
+        /// - when polling, no IOCP is created and the CQ is created without notifications
+        /// - on failure, sets the last error and returns FALSE (the caller cleans up with DeleteCompletionQueue)
         ///
         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        static BOOL CALLBACK InitOnceRioiocp(PINIT_ONCE, PVOID, PVOID*) noexcept
+        static BOOL CreateCompletionQueue(RioCompletionQueue* pQueue, uint32_t workerThreadCount, long processorNumber, bool polling) noexcept
         {
-            FAIL_FAST_IF(!InitializeCriticalSectionEx(&g_queueLock, ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock, 0));
-
-            // delete all cq's on error
-            auto deleteAllCqsOnError = wil::scope_exit([&]() noexcept { DeleteAllCompletionQueues(); });
-
-            ::ZeroMemory(&g_rioNotifySettings, sizeof g_rioNotifySettings);
-            // completion key for RioNotify IOCP is the ctsRioIocpImpl*
-            g_rioNotifySettings.Type = RIO_IOCP_COMPLETION;
-            g_rioNotifySettings.Iocp.CompletionKey = nullptr;
-            g_rioNotifySettings.Iocp.Overlapped = nullptr;
-            g_rioNotifySettings.Iocp.IocpHandle = nullptr;
-
-            g_rioNotifySettings.Iocp.Overlapped = calloc(1, sizeof OVERLAPPED);
-            if (!g_rioNotifySettings.Iocp.Overlapped)
+            ::ZeroMemory(&pQueue->m_rioNotifySettings, sizeof pQueue->m_rioNotifySettings);
+            if (polling)
             {
-                ctsConfig::PrintException(WSAENOBUFS, L"calloc (OVERLAPPED)", L"ctsRioIocp");
-                SetLastError(WSAENOBUFS);
-                return FALSE;
+                pQueue->m_rioCompletionQueue = ctl::ctRIOCreateCompletionQueue(c_rioDefaultCqSize, nullptr);
+                // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
+                if (RIO_INVALID_CQ == pQueue->m_rioCompletionQueue)
+                {
+                    const auto gle = WSAGetLastError();
+                    ctsConfig::PrintException(gle, L"ctRIOCreateCompletionQueue", L"ctsRioIocp");
+                    SetLastError(gle);
+                    return FALSE;
+                }
             }
-            // free the OVERLAPPED on error
-            auto freeOverlappedOnError = wil::scope_exit([&]() noexcept { free(g_rioNotifySettings.Iocp.Overlapped); });
-
-            g_rioNotifySettings.Iocp.IocpHandle = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
-            if (!g_rioNotifySettings.Iocp.IocpHandle)
+            else
             {
-                const auto gle = GetLastError();
-                ctsConfig::PrintException(gle, L"CreateIoCompletionPort", L"ctsRioIocp");
-                SetLastError(gle);
-                return FALSE;
-            }
-            // close the IOCP handle on error
-            auto deleteIocpOnError = wil::scope_exit([&]() noexcept { CloseHandle(g_rioNotifySettings.Iocp.IocpHandle); });
+                // completion key for RioNotify IOCP is the ctsRioIocpImpl*
+                pQueue->m_rioNotifySettings.Type = RIO_IOCP_COMPLETION;
+                pQueue->m_rioNotifySettings.Iocp.CompletionKey = nullptr;
+                pQueue->m_rioNotifySettings.Iocp.Overlapped = nullptr;
+                pQueue->m_rioNotifySettings.Iocp.IocpHandle = nullptr;
+
+                pQueue->m_rioNotifySettings.Iocp.Overlapped = calloc(1, sizeof OVERLAPPED);
+                if (!pQueue->m_rioNotifySettings.Iocp.Overlapped)
+                {
+                    ctsConfig::PrintException(WSAENOBUFS, L"calloc (OVERLAPPED)", L"ctsRioIocp");
+                    SetLastError(WSAENOBUFS);
+                    return FALSE;
+                }
 
-            constexpr uint32_t rioDefaultCqSize = 1000;
-            // with RIO, we don't associate the IOCP handle with the socket like 'typical' sockets
-            // - instead we directly pass the IOCP handle through RIOCreateCompletionQueue
-            g_rioCompletionQueue = ctl::ctRIOCreateCompletionQueue(rioDefaultCqSize, &g_rioNotifySettings);
-            // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
-            if (RIO_INVALID_CQ == g_rioCompletionQueue)
-            {
-                const auto gle = WSAGetLastError();
-                ctsConfig::PrintException(gle, L"ctRIOCreateCompletionQueue", L"ctsRioIocp");
-                SetLastError(gle);
-                return FALSE;
+                pQueue->m_rioNotifySettings.Iocp.IocpHandle = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+                if (!pQueue->m_rioNotifySettings.Iocp.IocpHandle)
+                {
+                    const auto gle = GetLastError();
+                    ctsConfig::PrintException(gle, L"CreateIoCompletionPort", L"ctsRioIocp");
+                    SetLastError(gle);
+                    return FALSE;
+                }
+
+                // with RIO, we don't associate the IOCP handle with the socket like 'typical' sockets
+                // - instead we directly pass the IOCP handle through RIOCreateCompletionQueue
+                pQueue->m_rioCompletionQueue = ctl::ctRIOCreateCompletionQueue(c_rioDefaultCqSize, &pQueue->m_rioNotifySettings);
+                // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
+                if (RIO_INVALID_CQ == pQueue->m_rioCompletionQueue)
+                {
+                    const auto gle = WSAGetLastError();
+                    ctsConfig::PrintException(gle, L"ctRIOCreateCompletionQueue", L"ctsRioIocp");
+                    SetLastError(gle);
+                    return FALSE;
+                }
             }
-            // close the RIO CQ on error
-            auto closeCompletionQueueOnError = wil::scope_exit([&]() noexcept { ctl::ctRIOCloseCompletionQueue(g_rioCompletionQueue); });
 
             // now that the CQ is created, update info
-            g_rioComplectionQueueSize = rioDefaultCqSize;
-            g_rioCompletionQueueUsed = 0;
+            pQueue->m_rioCompletionQueueSize = c_rioDefaultCqSize;
+            pQueue->m_rioCompletionQueueUsed = 0;
 
             // reserve space for handles
-            SYSTEM_INFO systemInfo;
-            GetSystemInfo(&systemInfo);
-            g_pRioWorkerThreads = static_cast<HANDLE*>(calloc(systemInfo.dwNumberOfProcessors, sizeof HANDLE));
-            if (!g_pRioWorkerThreads)
+            pQueue->m_pRioWorkerThreads = static_cast<HANDLE*>(calloc(workerThreadCount, sizeof HANDLE));
+            if (!pQueue->m_pRioWorkerThreads)
             {
                 ctsConfig::PrintException(ERROR_OUTOFMEMORY, L"calloc", L"ctsRioIocp");
                 SetLastError(WSAENOBUFS);
                 return FALSE;
             }
-            // free the handle array on error
-            auto freeHandleArrayOnError = wil::scope_exit([&]() noexcept { free(g_pRioWorkerThreads); });
-
-            g_rioWorkerThreadCount = systemInfo.dwNumberOfProcessors;
+            pQueue->m_rioWorkerThreadCount = workerThreadCount;
 
             // now that we are ready to go, kick off our thread-pool
-            for (auto loopWorkers = 0ul; loopWorkers < g_rioWorkerThreadCount; ++loopWorkers)
+            for (auto loopWorkers = 0ul; loopWorkers < pQueue->m_rioWorkerThreadCount; ++loopWorkers)
             {
-                g_pRioWorkerThreads[loopWorkers] = CreateThread(nullptr, 0, RioIocpThreadProc, nullptr, 0, nullptr);
-                if (!g_pRioWorkerThreads[loopWorkers])
+                pQueue->m_pRioWorkerThreads[loopWorkers] = CreateThread(nullptr, 0, polling ? RioPollThreadProc : RioIocpThreadProc, pQueue, CREATE_SUSPENDED, nullptr);
+                if (!pQueue->m_pRioWorkerThreads[loopWorkers])
                 {
                     const auto gle = GetLastError();
                     ctsConfig::PrintException(gle, L"CreateThread", L"ctsRioIocp");
                     SetLastError(gle);
                     return FALSE;
                 }
+
+                if (processorNumber >= 0)
+                {
+                    const auto affinityMask = static_cast<DWORD_PTR>(1) << processorNumber;
+                    if (0 == SetThreadAffinityMask(pQueue->m_pRioWorkerThreads[loopWorkers], affinityMask))
+                    {
+                        // not fatal - the worker will still only dequeue from its own CQ
+                        PRINT_DEBUG_INFO(L"\t\tctsRioIocp: SetThreadAffinityMask(%ld) failed (%u)\n", processorNumber, GetLastError());
+                    }
+                }
+
+                ResumeThread(pQueue->m_pRioWorkerThreads[loopWorkers]);
             }
-            // scopedDeleteAllCqs will take care of cleaning up these threads on failure
 
             // if everything succeeds, post a Notify to catch the first set of IO
-            const auto notify = ctl::ctRIONotify(g_rioCompletionQueue);
-            if (notify != NO_ERROR)
+            if (!polling)
             {
-                ctsConfig::PrintException(notify, L"ctRIONotify", L"ctsRioIocp");
-                SetLastError(notify);
+                const auto notify = ctl::ctRIONotify(pQueue->m_rioCompletionQueue);
+                if (notify != NO_ERROR)
+                {
+                    ctsConfig::PrintException(notify, L"ctRIONotify", L"ctsRioIocp");
+                    SetLastError(notify);
+                    return FALSE;
+                }
+            }
+
+            return TRUE;
+        }
+
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Singleton initialization routine for the global CQ(s) and the corresponding IOCP thread pool
+        ///
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        static BOOL CALLBACK InitOnceRioiocp(PINIT_ONCE, PVOID, PVOID*) noexcept
+        {
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+            const uint32_t processorCount = systemInfo.dwNumberOfProcessors;
+
+            // 0 == a single CQ shared across one worker thread per processor
+            // otherwise, one CQ per worker thread, up to the number of processors
+            // - polling always uses one (spinning) thread per CQ, defaulting to a single CQ
+            const auto polling = ctsConfig::g_configSettings->RioPollCompletions;
+            uint32_t completionQueueCount = 1;
+            uint32_t workerThreadsPerQueue = polling ? 1 : processorCount;
+            if (ctsConfig::g_configSettings->RioCompletionQueueCount > 0)
+            {
+                completionQueueCount = std::min<uint32_t>(ctsConfig::g_configSettings->RioCompletionQueueCount, processorCount);
+                workerThreadsPerQueue = 1;
+            }
+
+            g_pRioCompletionQueues = new(std::nothrow) RioCompletionQueue[completionQueueCount];
+            if (!g_pRioCompletionQueues)
+            {
+                ctsConfig::PrintException(ERROR_OUTOFMEMORY, L"new (RioCompletionQueue)", L"ctsRioIocp");
+                SetLastError(WSAENOBUFS);
                 return FALSE;
             }
+            g_rioCompletionQueueCount = completionQueueCount;
 
-            // dismiss all scope guards - successfully initialized
-            freeHandleArrayOnError.release();
-            closeCompletionQueueOnError.release();
-            deleteIocpOnError.release();
-            freeOverlappedOnError.release();
+            for (auto loopQueues = 0ul; loopQueues < g_rioCompletionQueueCount; ++loopQueues)
+            {
+                FAIL_FAST_IF(!InitializeCriticalSectionEx(&g_pRioCompletionQueues[loopQueues].m_queueLock, ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock, 0));
+            }
+
+            // delete all cq's on error
+            auto deleteAllCqsOnError = wil::scope_exit([&]() noexcept { DeleteAllCompletionQueues(); });
+
+            for (auto loopQueues = 0ul; loopQueues < g_rioCompletionQueueCount; ++loopQueues)
+            {
+                // only affinitize worker threads when each has its own CQ
+                const long processorNumber = workerThreadsPerQueue == 1 ? static_cast<long>(loopQueues) : -1;
+                if (!CreateCompletionQueue(&g_pRioCompletionQueues[loopQueues], workerThreadsPerQueue, processorNumber, polling))
+                {
+                    return FALSE;
+                }
+            }
+
+            // dismiss the scope guard - successfully initialized
             deleteAllCqsOnError.release();
             return TRUE;
         }
     }
 
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// RioRequestQueueContext
+    ///
+    /// The SOCKET context of every RQ created on the shared CQs
+    /// - ProcessCompletions dispatches each dequeued RIORESULT through this interface
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class RioRequestQueueContext
+    {
+    public:
+        RioRequestQueueContext() noexcept = default;
+        virtual ~RioRequestQueueContext() noexcept = default;
+
+        RioRequestQueueContext(const RioRequestQueueContext&) = delete;
+        RioRequestQueueContext(RioRequestQueueContext&&) = delete;
+        RioRequestQueueContext& operator=(const RioRequestQueueContext&) = delete;
+        RioRequestQueueContext& operator=(RioRequestQueueContext&&) = delete;
+
+        // 
+        // Should be called once for every IO that was completed
+        // Returns true once no more IO is outstanding and the context must be deleted
+        // - commitRequests is false when the next RIORESULT of the dequeued batch is for this same RQ:
+        //   the requests posted with RIO_MSG_DEFER are then left for that completion to commit with its own
+        //
+        virtual bool CompleteRequest(ULONG_PTR requestContext, ULONG transferred, LONG status, bool commitRequests) noexcept = 0;
+    };
+
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///
     /// RioSocketContext
@@ -362,29 +573,72 @@ namespace ctsTraffic
     /// 
     /// This stores all relevant information with regards to the RIO SOCKET
     /// Including encapsulating the RIO_RQ associated with the socket
+    ///
+    /// With UDP this is the MediaStream client
+    /// - datagrams are sent to the registered address of the server with RIOSendEx
+    /// - the pattern's out-of-band tasks (START requests and the end of the stream) are taken through its callback
     /// 
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    class RioSocketContext
+    class RioSocketContext final : public RioRequestQueueContext
     {
         wil::critical_section m_lock{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };
-        std::weak_ptr<ctsSocket> m_weakSocket;
+        // the ctsSocket holds its IO reference : the IO pended through this context keeps it alive
+        ctsSocket* const m_socket;
+        Rioiocp::RioCompletionQueue* const m_completionQueue = Rioiocp::AssignCompletionQueue();
         ctl::ctSockaddr m_remoteSockaddr;
         RIO_BUF m_rioRemoteAddress{};
         RIO_RQ m_rioRequestQueue = RIO_INVALID_RQ;
-
-        const uint32_t m_rioRqGrowthFactor = 4;
-        uint32_t m_requestQueueSendSize = m_rioRqGrowthFactor / 2;
-        uint32_t m_requestQueueRecvSize = m_rioRqGrowthFactor / 2;
+        const bool m_isDatagram = ctsConfig::GetFrozenSettings().m_isUdp;
+        // the MediaStream client sends its own START buffer, which is not registered memory
+        // - a copy is sent from this registered buffer, only one at a time
+        ctsRioBufferLease m_datagramSendLease;
+        bool m_datagramSendInFlight = false;
+
+        // the RQ is sized up front by InitialRequestQueueSizes, then doubled when more IO is pended
+        // - neither side grows beyond the number of tasks : the most IO the pattern can ever pend
+        uint32_t m_requestQueueSendSize = 0;
+        uint32_t m_requestQueueRecvSize = 0;
         uint32_t m_outstandingSends = 0;
         uint32_t m_outstandingRecvs = 0;
         // pre-allocate all ctsTasks needed so we don't alloc/free with each IO request
         std::vector<ctsTask> m_tasks;
+        // the QPC when each of the above tasks was posted to RIO
+        std::vector<long long> m_taskPostQpc;
+        // the sends and recvs posted with RIO_MSG_DEFER which have not yet been committed
+        uint32_t m_deferredSends = 0;
+        uint32_t m_deferredRecvs = 0;
+
+        // The RQ sizes expected to hold all the IO this connection pends
+        // - recvs : -PrePostRecvs, sends : -PrePostSends or the sends of a c_expectedIdealSendBacklog ISB
+        // - plus one each for the connection ID and the completion message
+        static std::tuple<uint32_t, uint32_t> InitialRequestQueueSizes(uint32_t taskCount) noexcept
+        {
+            // the ISB expected without -PrePostSends : sends are only pended for the ISB the stack indicates
+            constexpr unsigned long c_expectedIdealSendBacklog = 0x20000ul;
+
+            const unsigned long maxBufferSize = ctsConfig::GetMaxBufferSize();
+            const unsigned long expectedSends = ctsConfig::g_configSettings->PrePostSends > 0 ?
+                ctsConfig::g_configSettings->PrePostSends :
+                c_expectedIdealSendBacklog / (maxBufferSize > 0 ? maxBufferSize : 1) + 1;
+            const unsigned long expectedRecvs = ctsConfig::g_configSettings->PrePostRecvs;
+
+            const auto boundedSize = [taskCount](unsigned long expected) noexcept {
+                const auto size = expected + 1;
+                return static_cast<uint32_t>(size < taskCount ? size : taskCount);
+            };
+            return std::make_tuple(boundedSize(expectedSends), boundedSize(expectedRecvs));
+        }
 
         // Guarantees that there is roon in the RQ for the next IO request
+        // - the full side of the RQ is doubled, bounded by the number of tasks
         // Returns NO_ERROR for success, or a Win32 error on failure
         // Requires m_lock to be held
         std::tuple<DWORD, ctsTask*> MakeRoomInRequestQueue(const ctsTask& nextTask) noexcept
         {
+            const auto taskCount = static_cast<uint32_t>(m_tasks.size());
+            const auto doubledSize = [taskCount](uint32_t size) noexcept {
+                return size * 2 < taskCount ? size * 2 : taskCount;
+            };
             auto newSendSize = m_requestQueueSendSize;
             auto newRecvSize = m_requestQueueRecvSize;
 
@@ -393,13 +647,13 @@ namespace ctsTraffic
                 case ctsTaskAction::Send:
                     if (m_outstandingSends >= m_requestQueueSendSize)
                     {
-                        newSendSize = m_requestQueueSendSize + m_rioRqGrowthFactor;
+                        newSendSize = doubledSize(m_requestQueueSendSize);
                     }
                     break;
                 case ctsTaskAction::Recv:
                     if (m_outstandingRecvs >= m_requestQueueRecvSize)
                     {
-                        newRecvSize = m_requestQueueRecvSize + m_rioRqGrowthFactor;
+                        newRecvSize = doubledSize(m_requestQueueRecvSize);
                     }
                     break;
                 default:
@@ -409,7 +663,8 @@ namespace ctsTraffic
             // guarantee room in the RQ for this next IO
             if (newSendSize > m_requestQueueSendSize || newRecvSize > m_requestQueueRecvSize)
             {
-                const auto error = Rioiocp::MakeRoomInCq(m_rioRqGrowthFactor);
+                const uint32_t newSlots = newSendSize - m_requestQueueSendSize + newRecvSize - m_requestQueueRecvSize;
+                const auto error = Rioiocp::MakeRoomInCq(m_completionQueue, newSlots);
                 if (error != NO_ERROR)
                 {
                     return std::make_tuple(error, nullptr);
@@ -422,9 +677,10 @@ namespace ctsTraffic
                 {
                     const auto gle = WSAGetLastError();
                     ctsConfig::PrintErrorIfFailed("RIOResizeRequestQueue", gle);
-                    Rioiocp::ReleaseRoomInCompletionQueue(m_rioRqGrowthFactor);
+                    Rioiocp::ReleaseRoomInCompletionQueue(m_completionQueue, newSlots);
                     return std::make_tuple(gle, nullptr);
                 }
+                Rioiocp::g_rioRequestQueueResizes.Increment();
 
                 // since it succeeded, update members with the new sizes
                 m_requestQueueSendSize = newSendSize;
@@ -475,6 +731,10 @@ namespace ctsTraffic
             {
                 case ctsTaskAction::Send:
                     --m_outstandingSends;
+                    if (m_isDatagram && ctsTask::BufferType::Static == pCompletedTask->m_bufferType)
+                    {
+                        m_datagramSendInFlight = false;
+                    }
                     break;
                 case ctsTaskAction::Recv:
                     --m_outstandingRecvs;
@@ -489,19 +749,13 @@ namespace ctsTraffic
         }
 
     public:
-        explicit RioSocketContext(std::weak_ptr<ctsSocket> weakSocket)
-            : m_weakSocket(std::move(weakSocket))
+        explicit RioSocketContext(const std::shared_ptr<ctsSocket>& sharedSocket)
+            : m_socket(sharedSocket.get())
         {
             m_rioRemoteAddress.BufferId = RIO_INVALID_BUFFERID;
             m_rioRemoteAddress.Length = 0;
             m_rioRemoteAddress.Offset = 0;
 
-            const auto sharedSocket = m_weakSocket.lock();
-            if (!sharedSocket)
-            {
-                THROW_WIN32_MSG(WSAECONNABORTED, "ctsRioIocp: null socket given to RioSocketContext");
-            }
-
             // lock the socket when doing IO on it
             const auto lockedSocket(sharedSocket->AcquireSocketLock());
             const SOCKET socket = lockedSocket.GetSocket();
@@ -511,7 +765,7 @@ namespace ctsTraffic
             }
 
             // hold a reference on the iopattern to ask for the RIO IO count
-            auto lockedPattern(lockedSocket.GetPattern());
+            auto* const lockedPattern = lockedSocket.GetPatternPointer();
             if (!lockedPattern)
             {
                 THROW_WIN32_MSG(WSAECONNABORTED, "ctsRioIocp: failed to get a lock on the ctsIoPatter");
@@ -519,13 +773,16 @@ namespace ctsTraffic
 
             // guarantee we have the maximum number of possible IOs that could be sent or received
             m_tasks.resize(lockedPattern->GetRioBufferIdCount());
+            m_taskPostQpc.resize(m_tasks.size());
 
-            const auto error = Rioiocp::MakeRoomInCq(m_rioRqGrowthFactor);
+            // sizing the RQ for the IO expected up front so connections don't resize it (and the CQ) as they ramp up
+            std::tie(m_requestQueueSendSize, m_requestQueueRecvSize) = InitialRequestQueueSizes(static_cast<uint32_t>(m_tasks.size()));
+            const auto error = Rioiocp::MakeRoomInCq(m_completionQueue, m_requestQueueSendSize + m_requestQueueRecvSize);
             if (error != NO_ERROR)
             {
                 THROW_WIN32_MSG(WSAENOBUFS, "ctsRioIocp: failed to make room in the cq");
             }
-            auto releaseRoomInCqOnFailure = wil::scope_exit([&]() noexcept { Rioiocp::ReleaseRoomInCompletionQueue(m_rioRqGrowthFactor); });
+            auto releaseRoomInCqOnFailure = wil::scope_exit([&]() noexcept { Rioiocp::ReleaseRoomInCompletionQueue(m_completionQueue, m_requestQueueSendSize + m_requestQueueRecvSize); });
 
             constexpr uint32_t rioMaxDataBuffers = 1; // this is the only value accepted as of Win8
             // create the RQ for this socket
@@ -534,17 +791,17 @@ namespace ctsTraffic
                 socket,
                 m_requestQueueRecvSize, rioMaxDataBuffers,
                 m_requestQueueSendSize, rioMaxDataBuffers,
-                Rioiocp::g_rioCompletionQueue,
-                Rioiocp::g_rioCompletionQueue,
-                this);
+                m_completionQueue->m_rioCompletionQueue,
+                m_completionQueue->m_rioCompletionQueue,
+                static_cast<RioRequestQueueContext*>(this));
             // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
             if (RIO_INVALID_RQ == m_rioRequestQueue)
             {
                 THROW_WIN32_MSG(WSAGetLastError(), "RIOCreateRequestQueue");
             }
 
-            // now register the target remote address for UDP for RIOSendTo
-            if (ctsConfig::ProtocolType::UDP == ctsConfig::g_configSettings->Protocol)
+            // now register the target remote address for UDP for RIOSendEx
+            if (m_isDatagram)
             {
                 m_remoteSockaddr = sharedSocket->GetRemoteSockaddr();
                 m_rioRemoteAddress.Length = static_cast<ULONG>(sizeof SOCKADDR_INET);
@@ -556,6 +813,16 @@ namespace ctsTraffic
                 {
                     THROW_WIN32_MSG(WSAGetLastError(), "RIORegisterBuffer");
                 }
+
+                m_datagramSendLease = ctsRioBufferLease(c_udpDatagramStartStringLength);
+
+                // the MediaStream client pattern sends its START requests and ends the stream from its own timers
+                // - 'this' is only used while IO is pended, which guarantees this context has not been deleted
+                // - these can run after the final IO completed : they are given a weak_ptr to the ctsSocket
+                lockedPattern->RegisterCallback(
+                    [weakSocket = std::weak_ptr<ctsSocket>(sharedSocket), context = this](const ctsTask& task) noexcept {
+                        InitiateOobRequest(context, weakSocket, task);
+                    });
             }
 
             // no failures
@@ -565,7 +832,7 @@ namespace ctsTraffic
         ~RioSocketContext() noexcept
         {
             // release all the space in the CQ for this RQ
-            Rioiocp::ReleaseRoomInCompletionQueue(static_cast<ULONG>(m_requestQueueSendSize + m_requestQueueRecvSize));
+            Rioiocp::ReleaseRoomInCompletionQueue(m_completionQueue, static_cast<ULONG>(m_requestQueueSendSize + m_requestQueueRecvSize));
 
             if (m_rioRemoteAddress.BufferId != RIO_INVALID_BUFFERID)
             {
@@ -578,108 +845,341 @@ namespace ctsTraffic
         RioSocketContext& operator=(const RioSocketContext&) = delete;
         RioSocketContext& operator=(RioSocketContext&&) = delete;
 
+        bool CompleteRequest(ULONG_PTR requestContext, ULONG transferred, LONG status, bool commitRequests) noexcept override
+        {
+            return 0 == CompleteTask(reinterpret_cast<ctsTask*>(requestContext), transferred, status, commitRequests);
+        }
+
+    private:
         // 
         // Should be called once for every IO that was completed
         // Returns the current # of outstanding IO on the socket
+        // - the recvs reposted into the same registered buffers the completed recvs were verified in
+        //   are committed with those of the rest of this RQ's completions in the dequeued batch
         //
-        LONG CompleteRequest(ctsTask* const pTask, ULONG transferred, LONG status) noexcept
+        LONG CompleteTask(ctsTask* const pTask, ULONG transferred, LONG status, bool commitRequests) noexcept
         {
-            // get a reference on the ctsSocket and IOPattern
-            const auto sharedSocket(m_weakSocket.lock());
-            if (!sharedSocket)
+            const auto completedQpc = ctl::ctTimer::SnapQpc();
+            // only written under m_lock when the IO was posted, and not reused until released below
+            Rioiocp::g_rioCompletionLatencyQpc.Add(completedQpc - m_taskPostQpc[pTask - m_tasks.data()]);
+            ctsConfig::g_configSettings->TcpStatusDetails.m_rioCompletions.Increment();
+
+            DWORD error;
+            LONG currentIo;
+            // the socket lock must be released before CompleteState : it can delete the ctsSocket
             {
+                // Must lock the socket before doing anything on it
+                const auto lockedSocket(m_socket->AcquireSocketLock());
+                auto* const lockedPattern = lockedSocket.GetPatternPointer();
+                if (!lockedPattern)
+                {
+                    const auto lock = m_lock.lock();
+                    // release the RQ and the ctsTask back to the RioSocketContext object before returning
+                    ReleaseRoomInRequestQueue(pTask);
+                    return m_outstandingRecvs + m_outstandingSends;
+                }
+
+                // take a lock on our RioSocketContext before evaluating changes
                 const auto lock = m_lock.lock();
+
+                // decrement the counter in our RQ for the completed IO
+                const auto* const functionName = pTask->m_ioAction == ctsTaskAction::Recv ?
+                    "RIOReceive" : m_isDatagram ? "RIOSendEx" : "RIOSend";
+
+                if (m_isDatagram && WSAEMSGSIZE == status)
+                {
+                    // something truncated the datagram - don't treat it as a hard-error
+                    // pass the count to the protocol to track it at their layer
+                    ctsConfig::PrintErrorInfo(L"MediaStream Client: %hs failed with WSAEMSGSIZE: received [%lu bytes] - expected [%lu bytes]",
+                        functionName, transferred, pTask->m_bufferLength);
+                    status = NO_ERROR;
+                }
+
+                if (status != NO_ERROR)
+                {
+                    PRINT_DEBUG_INFO(
+                        L"\t\tIO Failed: %hs (%d) [ctsRioIocp]\n", functionName, status);
+                }
+
+                // CompleteIo() to see if the protocol needs to issue more IO
+                // - will return this error unless the protocol wants more IO 
+                // - if the protocol wants more IO even though this failed, 
+                //   will return the error from the next IO
+                const auto protocolStatus = lockedPattern->CompleteIo(*pTask, transferred, status);
+                switch (protocolStatus)
+                {
+                    case ctsIoStatus::ContinueIo:
+                        // more IO is requested from the protocol
+                        // launch the next IO while holding the socket lock in complete_io
+                        error = InitiateRequest(commitRequests);
+                        break;
+
+                    case ctsIoStatus::CompletedIo:
+                        // no more IO is requested from the protocol
+                        error = NO_ERROR;
+                        if (m_isDatagram)
+                        {
+                            // closing the socket completes the receives still pended back through the CQ
+                            m_socket->CloseSocket();
+                        }
+                        break;
+
+                    case ctsIoStatus::FailedIo:
+                        // write out the error
+                        ctsConfig::PrintErrorIfFailed(functionName, status);
+
+                        // protocol sees this as a failure - capture the error the protocol recorded
+                        error = lockedPattern->GetLastPatternError();
+                        if (m_isDatagram)
+                        {
+                            m_socket->CloseSocket();
+                        }
+                        break;
+
+                    default:
+                        FAIL_FAST_MSG("ctsSendRecvIocp: unknown ctsSocket::IOStatus - %u\n", static_cast<unsigned>(protocolStatus));
+                }
+
+                // commit the requests earlier completions of this batch left deferred, even if this one posted none
+                if (commitRequests)
+                {
+                    CommitDeferredRequests(lockedSocket.GetSocket());
+                }
+
                 // release the RQ and the ctsTask back to the RioSocketContext object before returning
                 ReleaseRoomInRequestQueue(pTask);
-                return m_outstandingRecvs + m_outstandingSends;
+
+                // finally decrement the IO counter for the completed IO that triggered this complete_io function call
+                currentIo = m_socket->DecrementIo();
+                FAIL_FAST_IF(currentIo != static_cast<long>(m_outstandingRecvs + m_outstandingSends));
             }
 
-            // Must lock the socket before doing anything on it
-            const auto lockedSocket(sharedSocket->AcquireSocketLock());
-            auto lockedPattern(lockedSocket.GetPattern());
-            if (!lockedPattern)
+            if (0 == currentIo)
             {
-                const auto lock = m_lock.lock();
-                // release the RQ and the ctsTask back to the RioSocketContext object before returning
-                ReleaseRoomInRequestQueue(pTask);
-                return m_outstandingRecvs + m_outstandingSends;
+                m_socket->CompleteState(error);
             }
+            return currentIo;
+        }
 
-            // take a lock on our RioSocketContext before evaluating changes
-            const auto lock = m_lock.lock();
+        // Executes the next task on the socket : shutdowns, the end of a MediaStream, or a RIO request
+        // Returns true if the caller can continue asking the protocol for more IO
+        // - deferPost posts the RIO request with RIO_MSG_DEFER : the caller must then CommitDeferredRequests
+        // Requires the socket lock and m_lock to be held
+        bool ExecuteTask(
+            ctsSocket* const pSocket,
+            SOCKET& rioSocket,
+            ctsIoPattern* const lockedPattern,
+            ctsTask nextTask,
+            long& ioRefcount,
+            bool deferPost) noexcept
+        {
+            if (ctsTaskAction::GracefulShutdown == nextTask.m_ioAction)
+            {
+                auto error = NO_ERROR;
+                if (0 != shutdown(rioSocket, SD_SEND))
+                {
+                    error = WSAGetLastError();
+                }
+                return lockedPattern->CompleteIo(nextTask, 0, error) == ctsIoStatus::ContinueIo;
+            }
 
-            // decrement the counter in our RQ for the completed IO
-            const auto* const functionName = pTask->m_ioAction == ctsTaskAction::Recv ?
-                "RIOReceive" : "RIOSend";
+            if (ctsTaskAction::HardShutdown == nextTask.m_ioAction)
+            {
+                // pass through -1 to force an RST with the closesocket
+                const auto error = pSocket->CloseSocket(-1);
+                rioSocket = INVALID_SOCKET;
+
+                return lockedPattern->CompleteIo(nextTask, 0, error) == ctsIoStatus::ContinueIo;
+            }
 
-            if (status != NO_ERROR)
+            if (ctsTaskAction::Abort == nextTask.m_ioAction || ctsTaskAction::FatalAbort == nextTask.m_ioAction)
             {
-                PRINT_DEBUG_INFO(
-                    L"\t\tIO Failed: %hs (%d) [ctsRioIocp]\n", functionName, status);
+                // the MediaStream client signaled to stop the stream
+                // - closing the socket completes the receives still pended back through the CQ
+                lockedPattern->CompleteIo(nextTask, 0, NO_ERROR);
+                pSocket->CloseSocket();
+                rioSocket = INVALID_SOCKET;
+                return false;
             }
 
-            // CompleteIo() to see if the protocol needs to issue more IO
-            // - will return this error unless the protocol wants more IO 
-            // - if the protocol wants more IO even though this failed, 
-            //   will return the error from the next IO
-            DWORD error;
-            const auto protocolStatus = lockedPattern->CompleteIo(*pTask, transferred, status);
-            switch (protocolStatus)
+            bool sendingDatagramCopy = false;
+            if (m_isDatagram && ctsTaskAction::Send == nextTask.m_ioAction && RIO_INVALID_BUFFERID == nextTask.m_rioBufferid)
             {
-                case ctsIoStatus::ContinueIo:
-                    // more IO is requested from the protocol
-                    // launch the next IO while holding the socket lock in complete_io
-                    error = InitiateRequest();
-                    break;
+                const auto& sendSlice = m_datagramSendLease.Get();
+                const auto sendLength = nextTask.m_bufferOffset + nextTask.m_bufferLength;
+                if (m_datagramSendInFlight || sendLength > sendSlice.m_length)
+                {
+                    // the prior START is still in flight : the client keeps re-requesting START from its timer
+                    return lockedPattern->CompleteIo(nextTask, 0, NO_ERROR) == ctsIoStatus::ContinueIo;
+                }
 
-                case ctsIoStatus::CompletedIo:
-                    // no more IO is requested from the protocol
-                    error = NO_ERROR;
-                    break;
+                memcpy_s(sendSlice.m_buffer, sendSlice.m_length, nextTask.m_buffer, sendLength);
+                nextTask.m_rioBufferid = sendSlice.m_bufferId;
+                nextTask.m_rioBufferOffset = sendSlice.m_offset;
+                m_datagramSendInFlight = true;
+                sendingDatagramCopy = true;
+            }
 
-                case ctsIoStatus::FailedIo:
-                    // write out the error
-                    ctsConfig::PrintErrorIfFailed(functionName, status);
+            // if we're here, we're attempting IO
+            // pre-incremenet IO tracking on the socket before issuing the IO
+            ioRefcount = pSocket->IncrementIo();
 
-                    // protocol sees this as a failure - capture the error the protocol recorded
-                    error = lockedPattern->GetLastPatternError();
-                    break;
+            // must ensure we have room in the RQ & CQ before initiating the IO
+            // as well as getting a ctsTask* that we'll be using for this IO
+            // it can't be nextTask because that's on the stack, and the ctsTask
+            // is used for the per-Request context pointer for each IO request
+            PCSTR pRioFunction = "RIOResizeRequestQueue";
+            auto [error, pNextTask] = MakeRoomInRequestQueue(nextTask);
 
-                default:
-                    FAIL_FAST_MSG("ctsSendRecvIocp: unknown ctsSocket::IOStatus - %u\n", static_cast<unsigned>(protocolStatus));
+            if (NO_ERROR == error)
+            {
+                // with the IOTask, we can construct the RIO_BUF to send/recv
+                RIO_BUF rioBuffer{};
+                rioBuffer.BufferId = pNextTask->m_rioBufferid;
+                rioBuffer.Length = pNextTask->m_bufferLength;
+                rioBuffer.Offset = pNextTask->m_rioBufferOffset + pNextTask->m_bufferOffset;
+
+                m_taskPostQpc[pNextTask - m_tasks.data()] = ctl::ctTimer::SnapQpc();
+                const DWORD deferFlag = deferPost ? RIO_MSG_DEFER : 0;
+
+                // invoke the requested IO now that we have room in our queues
+                switch (pNextTask->m_ioAction)
+                {
+                    case ctsTaskAction::Recv:
+                    {
+                        pRioFunction = "RIOReceive";
+                        const DWORD flags = ctsConfig::GetFrozenSettings().m_isMsgWaitAll ? RIO_MSG_WAITALL : 0;
+                        if (!ctl::ctRIOReceive(m_rioRequestQueue, &rioBuffer, 1, flags | deferFlag, pNextTask))
+                        {
+                            error = WSAGetLastError();
+                        }
+                        else if (deferPost)
+                        {
+                            ++m_deferredRecvs;
+                        }
+                        break;
+                    }
+                    case ctsTaskAction::Send:
+                    {
+                        if (m_isDatagram)
+                        {
+                            // the socket is not connected : every datagram is sent to the registered server address
+                            pRioFunction = "RIOSendEx";
+                            if (!ctl::ctRIOSendEx(m_rioRequestQueue, &rioBuffer, 1, nullptr, &m_rioRemoteAddress, nullptr, nullptr, deferFlag, pNextTask))
+                            {
+                                error = WSAGetLastError();
+                            }
+                            else if (deferPost)
+                            {
+                                ++m_deferredSends;
+                            }
+                            break;
+                        }
+
+                        pRioFunction = "RIOSend";
+                        if (!ctl::ctRIOSend(m_rioRequestQueue, &rioBuffer, 1, deferFlag, pNextTask))
+                        {
+                            error = WSAGetLastError();
+                        }
+                        else if (deferPost)
+                        {
+                            ++m_deferredSends;
+                        }
+                        break;
+                    }
+                    default: FAIL_FAST();
+                }
+
+                if (error != NO_ERROR)
+                {
+                    // IO failed so release the task back to the RQ
+                    ReleaseRoomInRequestQueue(pNextTask);
+                }
+                else
+                {
+                    ctsConfig::g_configSettings->TcpStatusDetails.m_rioPosts.Increment();
+                    if (!deferPost)
+                    {
+                        ctsConfig::g_configSettings->TcpStatusDetails.m_rioCommits.Increment();
+                    }
+                }
+            }
+            else if (sendingDatagramCopy)
+            {
+                m_datagramSendInFlight = false;
             }
 
-            // release the RQ and the ctsTask back to the RioSocketContext object before returning
-            ReleaseRoomInRequestQueue(pTask);
+            // if IO was not initiated, complete the IO back the IO pattern
+            if (error != NO_ERROR)
+            {
+                ctsConfig::PrintErrorIfFailed(pRioFunction, error);
 
-            // finally decrement the IO counter for the completed IO that triggered this complete_io function call
-            const auto currentIo = sharedSocket->DecrementIo();
-            if (0 == currentIo)
+                const auto continueIo = lockedPattern->CompleteIo(nextTask, 0, error) == ctsIoStatus::ContinueIo;
+                ioRefcount = pSocket->DecrementIo();
+                return continueIo;
+            }
+
+            return true;
+        }
+
+        // Invoked out-of-band from the MediaStream client pattern's timers
+        // - only executes the task while other IO is pended : that IO is what keeps this context alive
+        //   (exactly as ctsMediaStreamClient only executes out-of-band tasks with IO in flight)
+        static void InitiateOobRequest(_In_ RioSocketContext* const context, const std::weak_ptr<ctsSocket>& weakSocket, const ctsTask& task) noexcept
+        {
+            const auto sharedSocket(weakSocket.lock());
+            if (!sharedSocket)
             {
-                sharedSocket->CompleteState(error);
+                return;
             }
 
-            FAIL_FAST_IF(currentIo != static_cast<long>(m_outstandingRecvs + m_outstandingSends));
-            return currentIo;
+            // taking the socket lock before our RioSocketContext lock, as InitiateRequest does
+            const auto lockedSocket(sharedSocket->AcquireSocketLock());
+            SOCKET rioSocket = lockedSocket.GetSocket();
+            auto* const lockedPattern = lockedSocket.GetPatternPointer();
+            if (!lockedPattern || INVALID_SOCKET == rioSocket)
+            {
+                return;
+            }
+
+            if (sharedSocket->IncrementIo() > 1)
+            {
+                long ioRefcount = -1;
+                {
+                    const auto lock = context->m_lock.lock();
+                    (void)context->ExecuteTask(sharedSocket.get(), rioSocket, lockedPattern, task, ioRefcount, false);
+                }
+
+                // decrement the IO count that we added before executing the task
+                // - complete_state if this happened to be the final IO refcount
+                if (0 == sharedSocket->DecrementIo())
+                {
+                    const auto patternError = lockedPattern->GetLastPatternError();
+                    sharedSocket->CompleteState(c_statusIoRunning == patternError ? WSAECONNABORTED : patternError);
+                    delete context;
+                }
+            }
+            else
+            {
+                // the io_count in the ctsSocket was zero : the final IO is completing this socket
+                sharedSocket->DecrementIo();
+            }
         }
 
+    public:
         // Attempts to send/recv IO on the socket
         // Returns the counter of pended IO on the socket
-        LONG InitiateRequest() noexcept
+        // - commitRequests is false to leave the deferred requests for the caller's next completion to commit
+        LONG InitiateRequest(bool commitRequests = true) noexcept
         {
-            auto sharedSocket(m_weakSocket.lock());
-            FAIL_FAST_IF_MSG(
-                !sharedSocket,
-                "RioSocketContext::execute_io (this == %p): the ctsSocket should always be valid - it's now nullshared_socket, get() should always return a valid ptr", this);
-
             // hold onto the RIO socket lock while posting IO on it
-            const auto lockedSocket(sharedSocket->AcquireSocketLock());
+            const auto lockedSocket(m_socket->AcquireSocketLock());
             SOCKET rioSocket = lockedSocket.GetSocket();
             if (INVALID_SOCKET == rioSocket)
             {
                 return WSAECONNABORTED;
             }
-            auto lockedPattern(lockedSocket.GetPattern());
+            auto* const lockedPattern = lockedSocket.GetPatternPointer();
             if (!lockedPattern)
             {
                 return WSAECONNABORTED;
@@ -700,92 +1200,282 @@ namespace ctsTraffic
                     break;
                 }
 
-                if (ctsTaskAction::GracefulShutdown == nextTask.m_ioAction)
+                // every request is deferred : all those posted by this loop are committed together below
+                continueIo = ExecuteTask(m_socket, rioSocket, lockedPattern, nextTask, ioRefcount, true);
+            } // while (...)
+
+            if (commitRequests)
+            {
+                CommitDeferredRequests(rioSocket);
+            }
+            return ioRefcount;
+        }
+
+    private:
+        // Rings the RQ doorbell once for all sends and once for all recvs posted with RIO_MSG_DEFER
+        // - if a commit fails, closing the socket completes the requests left uncommitted in the RQ
+        // Requires the socket lock and m_lock to be held
+        void CommitDeferredRequests(SOCKET rioSocket) noexcept
+        {
+            if (INVALID_SOCKET == rioSocket)
+            {
+                // the socket was closed by the pattern : closing it completed the deferred requests
+                m_deferredSends = 0;
+                m_deferredRecvs = 0;
+                return;
+            }
+
+            auto error = NO_ERROR;
+            PCSTR pRioFunction = nullptr;
+            if (m_deferredSends > 0)
+            {
+                ctsConfig::g_configSettings->TcpStatusDetails.m_rioCommits.Increment();
+                if (!ctl::ctRIOSend(m_rioRequestQueue, nullptr, 0, RIO_MSG_COMMIT_ONLY, nullptr))
                 {
-                    auto error = NO_ERROR;
-                    if (0 != shutdown(rioSocket, SD_SEND))
-                    {
-                        error = WSAGetLastError();
-                    }
-                    continueIo = lockedPattern->CompleteIo(nextTask, 0, error) == ctsIoStatus::ContinueIo;
-                    continue;
+                    error = WSAGetLastError();
+                    pRioFunction = "RIOSend(RIO_MSG_COMMIT_ONLY)";
                 }
-
-                if (ctsTaskAction::HardShutdown == nextTask.m_ioAction)
+                m_deferredSends = 0;
+            }
+            if (m_deferredRecvs > 0)
+            {
+                ctsConfig::g_configSettings->TcpStatusDetails.m_rioCommits.Increment();
+                if (!ctl::ctRIOReceive(m_rioRequestQueue, nullptr, 0, RIO_MSG_COMMIT_ONLY, nullptr) && NO_ERROR == error)
                 {
-                    // pass through -1 to force an RST with the closesocket
-                    const auto error = sharedSocket->CloseSocket(-1);
-                    rioSocket = INVALID_SOCKET;
-
-                    continueIo = lockedPattern->CompleteIo(nextTask, 0, error) == ctsIoStatus::ContinueIo;
-                    continue;
+                    error = WSAGetLastError();
+                    pRioFunction = "RIOReceive(RIO_MSG_COMMIT_ONLY)";
                 }
+                m_deferredRecvs = 0;
+            }
+
+            if (error != NO_ERROR)
+            {
+                ctsConfig::PrintErrorIfFailed(pRioFunction, error);
+                m_socket->CloseSocket(error);
+            }
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// RioDatagramSocketContext
+    ///
+    /// The SOCKET context of a MediaStream server listening socket, shared by every 'connection' sending from it
+    /// - sends are not tracked by any IO pattern : each datagram is copied with its target address into
+    ///   a registered send slot and posted with RIOSendEx, and the slot is reused once its completion is dequeued
+    /// - only the send side of the RQ is used : START requests are still received with WSARecvFrom
+    /// - never deleted : the listening sockets (and their RQs) live until the process exits
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class RioDatagramSocketContext final : public RioRequestQueueContext
+    {
+        // each send slot holds the SOCKADDR_INET target (padded to a cache line) followed by the datagram
+        static constexpr unsigned long c_sendSlotAddressLength = 64;
+        static constexpr unsigned long c_sendSlotLength = c_sendSlotAddressLength + c_udpDatagramMaximumSizeBytes;
 
-                // if we're here, we're attempting IO
-                // pre-incremenet IO tracking on the socket before issuing the IO
-                ioRefcount = sharedSocket->IncrementIo();
+        wil::critical_section m_lock{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };
+        const SOCKET m_socket;
+        Rioiocp::RioCompletionQueue* const m_completionQueue = Rioiocp::AssignCompletionQueue();
+        RIO_RQ m_rioRequestQueue = RIO_INVALID_RQ;
 
-                // must ensure we have room in the RQ & CQ before initiating the IO
-                // as well as getting a ctsTask* that we'll be using for this IO
-                // it can't be nextTask because that's on the stack, and the ctsTask
-                // is used for the per-Request context pointer for each IO request
-                PCSTR pRioFunction = "RIOResizeRequestQueue";
-                auto [error, pNextTask] = MakeRoomInRequestQueue(nextTask);
+        const uint32_t m_requestQueueRecvSize = 1;
+        // doubled by AddSendSlots as more sends are in flight
+        uint32_t m_requestQueueSendSize = 4;
+        // the request context of each send is its index into m_sendSlots
+        std::vector<ctsRioBufferLease> m_sendSlots;
+        std::vector<ULONG_PTR> m_freeSendSlots;
+        // invoked as the send posted from each slot completes
+        std::vector<std::function<void()>> m_sendCompletions;
+
+        // Leases a send slot for every send the RQ has room for
+        // - can throw wil::ResultException or std::bad_alloc
+        void LeaseSendSlots()
+        {
+            // the free list is reserved for every slot so completions never allocate
+            m_sendSlots.reserve(m_requestQueueSendSize);
+            m_freeSendSlots.reserve(m_requestQueueSendSize);
+            while (m_sendSlots.size() < m_requestQueueSendSize)
+            {
+                m_sendSlots.emplace_back(c_sendSlotLength);
+                m_freeSendSlots.push_back(m_sendSlots.size() - 1);
+            }
+            m_sendCompletions.resize(m_sendSlots.size());
+        }
 
-                if (NO_ERROR == error)
-                {
-                    // with the IOTask, we can construct the RIO_BUF to send/recv
-                    RIO_BUF rioBuffer{};
-                    rioBuffer.BufferId = pNextTask->m_rioBufferid;
-                    rioBuffer.Length = pNextTask->m_bufferLength;
-                    rioBuffer.Offset = pNextTask->m_bufferOffset;
+        // Doubles the RQ (and the room it needs in the CQ) along with the send slots
+        // Returns NO_ERROR for success, or a Win32 error on failure
+        // Requires m_lock to be held
+        DWORD AddSendSlots() noexcept try
+        {
+            const auto newSlots = m_requestQueueSendSize;
+            const auto error = Rioiocp::MakeRoomInCq(m_completionQueue, newSlots);
+            if (error != NO_ERROR)
+            {
+                return error;
+            }
 
-                    // invoke the requested IO now that we have room in our queues
-                    switch (pNextTask->m_ioAction)
-                    {
-                        case ctsTaskAction::Recv:
-                        {
-                            pRioFunction = "RIOReceive";
-                            const DWORD flags = ctsConfig::g_configSettings->Options & ctsConfig::OptionType::MsgWaitAll ? RIO_MSG_WAITALL : 0;
-                            if (!ctl::ctRIOReceive(m_rioRequestQueue, &rioBuffer, 1, flags, pNextTask))
-                            {
-                                error = WSAGetLastError();
-                            }
-                            break;
-                        }
-                        case ctsTaskAction::Send:
-                        {
-                            pRioFunction = "RIOSend";
-                            if (!ctl::ctRIOSend(m_rioRequestQueue, &rioBuffer, 1, 0, pNextTask))
-                            {
-                                error = WSAGetLastError();
-                            }
-                            break;
-                        }
-                        default: FAIL_FAST();
-                    }
+            if (!ctl::ctRIOResizeRequestQueue(
+                m_rioRequestQueue,
+                m_requestQueueRecvSize,
+                m_requestQueueSendSize + newSlots))
+            {
+                const auto gle = WSAGetLastError();
+                ctsConfig::PrintErrorIfFailed("RIOResizeRequestQueue", gle);
+                Rioiocp::ReleaseRoomInCompletionQueue(m_completionQueue, newSlots);
+                return gle;
+            }
+            Rioiocp::g_rioRequestQueueResizes.Increment();
+            m_requestQueueSendSize += newSlots;
 
-                    if (error != NO_ERROR)
-                    {
-                        // IO failed so release the task back to the RQ
-                        ReleaseRoomInRequestQueue(pNextTask);
-                    }
-                }
+            LeaseSendSlots();
+            return NO_ERROR;
+        }
+        catch (...)
+        {
+            return ctsConfig::PrintThrownException();
+        }
+
+    public:
+        explicit RioDatagramSocketContext(SOCKET socket) : m_socket(socket)
+        {
+            const auto error = Rioiocp::MakeRoomInCq(m_completionQueue, m_requestQueueRecvSize + m_requestQueueSendSize);
+            if (error != NO_ERROR)
+            {
+                THROW_WIN32_MSG(WSAENOBUFS, "ctsRioIocp: failed to make room in the cq");
+            }
+            auto releaseRoomInCqOnFailure = wil::scope_exit([&]() noexcept { Rioiocp::ReleaseRoomInCompletionQueue(m_completionQueue, m_requestQueueRecvSize + m_requestQueueSendSize); });
+
+            constexpr uint32_t rioMaxDataBuffers = 1; // this is the only value accepted as of Win8
+            // don't need a scope guard to close the RQ on error - the RQ is freed when the RIO socket is closed
+            m_rioRequestQueue = ctl::ctRIOCreateRequestQueue(
+                m_socket,
+                m_requestQueueRecvSize, rioMaxDataBuffers,
+                m_requestQueueSendSize, rioMaxDataBuffers,
+                m_completionQueue->m_rioCompletionQueue,
+                m_completionQueue->m_rioCompletionQueue,
+                static_cast<RioRequestQueueContext*>(this));
+            // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
+            if (RIO_INVALID_RQ == m_rioRequestQueue)
+            {
+                THROW_WIN32_MSG(WSAGetLastError(), "RIOCreateRequestQueue");
+            }
 
-                // if IO was not initiated, complete the IO back the IO pattern
+            LeaseSendSlots();
+
+            // no failures
+            releaseRoomInCqOnFailure.release();
+        }
+
+        ~RioDatagramSocketContext() noexcept override
+        {
+            Rioiocp::ReleaseRoomInCompletionQueue(m_completionQueue, m_requestQueueSendSize + m_requestQueueRecvSize);
+        }
+
+        RioDatagramSocketContext(const RioDatagramSocketContext&) = delete;
+        RioDatagramSocketContext(RioDatagramSocketContext&&) = delete;
+        RioDatagramSocketContext& operator=(const RioDatagramSocketContext&) = delete;
+        RioDatagramSocketContext& operator=(RioDatagramSocketContext&&) = delete;
+
+        [[nodiscard]] SOCKET GetSocket() const noexcept
+        {
+            return m_socket;
+        }
+
+        // Copies the datagram and its target address into a send slot and posts it with RIOSendEx
+        // Returns NO_ERROR once posted, or a Win32 error on failure
+        int SendDatagram(
+            const ctl::ctSockaddr& targetAddress,
+            _In_reads_(bufferCount) const WSABUF* buffers,
+            DWORD bufferCount,
+            _Out_ DWORD* bytesPosted,
+            std::function<void()>&& sendCompleted) noexcept
+        {
+            *bytesPosted = 0;
+
+            unsigned long datagramLength = 0;
+            for (DWORD buffer = 0; buffer < bufferCount; ++buffer)
+            {
+                datagramLength += buffers[buffer].len;
+            }
+            if (datagramLength > c_udpDatagramMaximumSizeBytes)
+            {
+                return WSAEMSGSIZE;
+            }
+
+            const auto lock = m_lock.lock();
+            if (m_freeSendSlots.empty())
+            {
+                // every send slot is still posted - a synchronous send would have blocked
+                ctsConfig::g_configSettings->UdpStatusDetails.m_pendedSends.Increment();
+                const auto error = AddSendSlots();
                 if (error != NO_ERROR)
                 {
-                    ctsConfig::PrintErrorIfFailed(pRioFunction, error);
-
-                    continueIo = lockedPattern->CompleteIo(nextTask, 0, error) == ctsIoStatus::ContinueIo;
-                    ioRefcount = sharedSocket->DecrementIo();
+                    return static_cast<int>(error);
                 }
-            } // while (...)
+            }
 
-            return ioRefcount;
+            const auto sendSlotIndex = *m_freeSendSlots.rbegin();
+            m_freeSendSlots.pop_back();
+            const auto& sendSlot = m_sendSlots[sendSlotIndex].Get();
+
+            memcpy_s(sendSlot.m_buffer, c_sendSlotAddressLength, targetAddress.sockaddr_inet(), sizeof SOCKADDR_INET);
+            char* datagram = sendSlot.m_buffer + c_sendSlotAddressLength;
+            for (DWORD buffer = 0; buffer < bufferCount; ++buffer)
+            {
+                // already verified the total length fits within the slot
+                memcpy(datagram, buffers[buffer].buf, buffers[buffer].len);
+                datagram += buffers[buffer].len;
+            }
+
+            RIO_BUF rioAddress{};
+            rioAddress.BufferId = sendSlot.m_bufferId;
+            rioAddress.Offset = sendSlot.m_offset;
+            rioAddress.Length = static_cast<ULONG>(sizeof SOCKADDR_INET);
+
+            RIO_BUF rioBuffer{};
+            rioBuffer.BufferId = sendSlot.m_bufferId;
+            rioBuffer.Offset = sendSlot.m_offset + c_sendSlotAddressLength;
+            rioBuffer.Length = datagramLength;
+
+            if (!ctl::ctRIOSendEx(m_rioRequestQueue, &rioBuffer, 1, nullptr, &rioAddress, nullptr, nullptr, 0, reinterpret_cast<PVOID>(sendSlotIndex)))
+            {
+                const auto gle = WSAGetLastError();
+                m_freeSendSlots.push_back(sendSlotIndex);
+                return gle;
+            }
+            m_sendCompletions[sendSlotIndex] = std::move(sendCompleted);
+            ctsConfig::g_configSettings->TcpStatusDetails.m_rioPosts.Increment();
+            ctsConfig::g_configSettings->TcpStatusDetails.m_rioCommits.Increment();
+
+            *bytesPosted = datagramLength;
+            return NO_ERROR;
+        }
+
+        bool CompleteRequest(ULONG_PTR requestContext, ULONG, LONG status, bool) noexcept override
+        {
+            ctsConfig::PrintErrorIfFailed("RIOSendEx (ctsMediaStreamServer)", status);
+
+            std::function<void()> sendCompleted;
+            {
+                const auto lock = m_lock.lock();
+                sendCompleted = std::move(m_sendCompletions[requestContext]);
+                m_sendCompletions[requestContext] = nullptr;
+                // reserved for every slot in AddSendSlots
+                m_freeSendSlots.push_back(requestContext);
+            }
+            // invoked outside the lock, as it can post more sends from this socket
+            if (sendCompleted)
+            {
+                sendCompleted();
+            }
+            return false;
         }
     };
 
+    // the MediaStream server listening sockets sending with RIOSendEx - only added to while the server initializes
+    static wil::srwlock g_rioDatagramContextsLock;  // NOLINT(cppcoreguidelines-interfaces-global-init, clang-diagnostic-exit-time-destructors)
+    static std::vector<RioDatagramSocketContext*> g_rioDatagramContexts;  // NOLINT(clang-diagnostic-exit-time-destructors)
+
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///
@@ -796,9 +1486,11 @@ namespace ctsTraffic
     ///   - subsequently taking the CS
     ///
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    static DWORD WINAPI Rioiocp::RioIocpThreadProc(LPVOID) noexcept  // NOLINT(bugprone-exception-escape)
+    static DWORD WINAPI Rioiocp::RioIocpThreadProc(LPVOID pContext) noexcept  // NOLINT(bugprone-exception-escape)
     {
-        std::array<RIORESULT, c_rioResultArrayLength> rioResultArray{};
+        auto* const pQueue = static_cast<RioCompletionQueue*>(pContext);
+        std::array<RIORESULT, c_rioMaxResultArrayLength> rioResultArray{};
+        ULONG batchSize = InitialDequeueBatchSize();
 
         for (;;)
         {
@@ -809,7 +1501,7 @@ namespace ctsTraffic
             // Wait for the IOCP to be queued from RIO that we have results in our CQ
             //
             if (!GetQueuedCompletionStatus(
-                g_rioNotifySettings.Iocp.IocpHandle,
+                pQueue->m_rioNotifySettings.Iocp.IocpHandle,
                 &transferred,
                 &pKey,
                 &pOverlapped,
@@ -827,7 +1519,7 @@ namespace ctsTraffic
                 FAIL_FAST_IF_MSG(
                     nullptr != pOverlapped,
                     "GetQueuedCompletionStatus(%p) dequeued a failed IO [%u] - OVERLAPPED [%p]",
-                    Rioiocp::g_rioNotifySettings.Iocp.IocpHandle, gle, pOverlapped);
+                    pQueue->m_rioNotifySettings.Iocp.IocpHandle, gle, pOverlapped);
             }
 
             if (c_exitCompletionKey == pKey)
@@ -839,35 +1531,162 @@ namespace ctsTraffic
             // Dequeue from the RIO socket under our locks
             // - note: Dequeue will invoke a RIONotify
             //
-            const ULONG completionCount = DequeFromCompletionQueue(rioResultArray.data());
-
-            // Now that we have dequeued the IO
-            // - iterate through each one and take next steps:
-            //   - once we have no more IO on that socket (returned from complete_io)
-            //   - delete the socket context
-            //   - note: interactions with the ctsSocket* are all contained in the socket_context
-            //           never directly interacting with the ctsSocket* here
-            for (ULONG iterResults = 0; iterResults < completionCount; ++iterResults)
-            {
-                const auto bytesTransferred = rioResultArray[iterResults].BytesTransferred;
-                const auto status = rioResultArray[iterResults].Status;
-                auto* const requestContext = reinterpret_cast<ctsTask*>(rioResultArray[iterResults].RequestContext);
-                auto* const socketContext = reinterpret_cast<RioSocketContext*>(rioResultArray[iterResults].SocketContext);
-
-                // Complete the dequeued IO to track the IO
-                // - will kick off another IO if required
-                // Returns the # of IO outstanding on that socket
-                // - if zero, we're done with it
-                if (0 == socketContext->CompleteRequest(requestContext, bytesTransferred, status))
-                {
-                    delete socketContext;
-                }
-            } // for (iter_results)
+            const ULONG completionCount = DequeFromCompletionQueue(pQueue, rioResultArray.data(), batchSize);
+            batchSize = NextDequeueBatchSize(batchSize, completionCount);
+
+            ctsConfig::g_configSettings->TcpStatusDetails.m_rioDequeues.Increment();
+            ProcessCompletions(rioResultArray.data(), completionCount);
         } // for (;;)
 
         return 0;
     } // RioIocpThreadProc
 
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Logic for the polling thread function (-IO:riopoll)
+    ///
+    /// - Spin on RIODequeueCompletion without ever calling RIONotify
+    /// - after RioPollSpinCount consecutive empty polls, yield the processor on each further empty poll
+    ///   (a spin count of zero never yields)
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static DWORD WINAPI Rioiocp::RioPollThreadProc(LPVOID pContext) noexcept  // NOLINT(bugprone-exception-escape)
+    {
+        auto* const pQueue = static_cast<RioCompletionQueue*>(pContext);
+        const auto spinCount = ctsConfig::g_configSettings->RioPollSpinCount;
+        std::array<RIORESULT, c_rioMaxResultArrayLength> rioResultArray{};
+        ULONG batchSize = InitialDequeueBatchSize();
+
+        unsigned long emptyPolls = 0;
+        long long totalEmptyPolls = 0;
+        while (!g_rioPollExit)
+        {
+            ULONG completionCount;
+            {
+                // must still serialize with RIOResizeCompletionQueue
+                const auto lock = wil::EnterCriticalSection(&pQueue->m_queueLock);
+                completionCount = ctl::ctRIODequeueCompletion(pQueue->m_rioCompletionQueue, rioResultArray.data(), batchSize);
+            }
+            FAIL_FAST_IF_MSG(
+                RIO_CORRUPT_CQ == completionCount,
+                "ctRIODequeueCompletion on(%p) returned RIO_CORRUPT_CQ", pQueue->m_rioCompletionQueue);
+
+            if (0 == completionCount)
+            {
+                ++totalEmptyPolls;
+                if (spinCount > 0 && ++emptyPolls >= spinCount)
+                {
+                    SwitchToThread();
+                }
+                else
+                {
+                    YieldProcessor();
+                }
+                continue;
+            }
+
+            emptyPolls = 0;
+            batchSize = NextDequeueBatchSize(batchSize, completionCount);
+            ctsConfig::g_configSettings->TcpStatusDetails.m_rioDequeues.Increment();
+            ProcessCompletions(rioResultArray.data(), completionCount);
+        }
+
+        g_rioEmptyPollCount.Add(totalEmptyPolls);
+        return 0;
+    } // RioPollThreadProc
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Now that we have dequeued the IO
+    /// - iterate through each one and take next steps:
+    ///   - once we have no more IO on that socket (returned from complete_io)
+    ///   - delete the socket context
+    ///   - note: interactions with the ctsSocket* are all contained in the socket_context
+    ///           never directly interacting with the ctsSocket* here
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void Rioiocp::ProcessCompletions(_In_reads_(completionCount) const RIORESULT* rioResults, ULONG completionCount) noexcept
+    {
+        const ctsThreadStatistics::ctsCallbackScope callbackScope;
+        for (ULONG iterResults = 0; iterResults < completionCount; ++iterResults)
+        {
+            const auto bytesTransferred = rioResults[iterResults].BytesTransferred;
+            ctsThreadStatistics::RecordCompletion(bytesTransferred, false);
+            const auto status = rioResults[iterResults].Status;
+            const auto requestContext = rioResults[iterResults].RequestContext;
+            auto* const socketContext = reinterpret_cast<RioRequestQueueContext*>(rioResults[iterResults].SocketContext);
+            // the IO reposted for consecutive completions of the same RQ is committed once, with the last of them
+            const bool commitRequests =
+                iterResults + 1 == completionCount ||
+                rioResults[iterResults + 1].SocketContext != rioResults[iterResults].SocketContext;
+
+            // Complete the dequeued IO to track the IO
+            // - will kick off another IO if required
+            // Returns true once there is no IO outstanding on that socket
+            // - then we're done with it
+            if (socketContext->CompleteRequest(requestContext, bytesTransferred, status, commitRequests))
+            {
+                delete socketContext;
+            }
+        } // for (iter_results)
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Prints the RIO completion statistics and the CPU time consumed by the RIO worker threads
+    /// - no-op if RIO was never used
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsRioPrintSummary() noexcept
+    {
+        if (0 == Rioiocp::g_rioCompletionQueueCount)
+        {
+            return;
+        }
+
+        long long workerKernelTime = 0;
+        long long workerUserTime = 0;
+        for (auto loopQueues = 0ul; loopQueues < Rioiocp::g_rioCompletionQueueCount; ++loopQueues)
+        {
+            const auto& queue = Rioiocp::g_pRioCompletionQueues[loopQueues];
+            for (auto loopWorkers = 0ul; loopWorkers < queue.m_rioWorkerThreadCount; ++loopWorkers)
+            {
+                FILETIME creationTime{};
+                FILETIME exitTime{};
+                FILETIME kernelTime{};
+                FILETIME userTime{};
+                if (queue.m_pRioWorkerThreads[loopWorkers] &&
+                    GetThreadTimes(queue.m_pRioWorkerThreads[loopWorkers], &creationTime, &exitTime, &kernelTime, &userTime))
+                {
+                    workerKernelTime += ctl::ctTimer::ConvertFiletimeToMillis(kernelTime);
+                    workerUserTime += ctl::ctTimer::ConvertFiletimeToMillis(userTime);
+                }
+            }
+        }
+
+        const auto completionCount = ctsConfig::g_configSettings->TcpStatusDetails.m_rioCompletions.GetValue();
+        const auto dequeueCount = ctsConfig::g_configSettings->TcpStatusDetails.m_rioDequeues.GetValue();
+        const auto postCount = ctsConfig::g_configSettings->TcpStatusDetails.m_rioPosts.GetValue();
+        const auto commitCount = ctsConfig::g_configSettings->TcpStatusDetails.m_rioCommits.GetValue();
+        const auto latencyQpc = Rioiocp::g_rioCompletionLatencyQpc.GetValue();
+        ctsConfig::PrintSummary(
+            L"\n"
+            L"  RIO Posts : %lld (%.2f per commit)\n"
+            L"  RIO Request Queue Resizes : %lld\n"
+            L"  RIO Completions : %lld (%.2f per dequeue)\n"
+            L"  RIO Average Completion Latency : %.3f us\n"
+            L"  RIO Worker CPU Time : %lld ms (kernel %lld ms, user %lld ms)\n",
+            postCount,
+            commitCount > 0 ? static_cast<double>(postCount) / static_cast<double>(commitCount) : 0.0,
+            Rioiocp::g_rioRequestQueueResizes.GetValue(),
+            completionCount,
+            dequeueCount > 0 ? static_cast<double>(completionCount) / static_cast<double>(dequeueCount) : 0.0,
+            completionCount > 0 ? static_cast<double>(latencyQpc) * 1000000.0 / static_cast<double>(ctl::ctTimer::SnapQpf()) / static_cast<double>(completionCount) : 0.0,
+            workerKernelTime + workerUserTime,
+            workerKernelTime,
+            workerUserTime);
+    }
+
 
     void ctsRioIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
     {
@@ -903,8 +1722,11 @@ namespace ctsTraffic
         RioSocketContext* socketContext = nullptr;
         try
         {
+            // the socket context refers to the ctsSocket by raw pointer instead of locking a weak_ptr with every completion
+            // - the ctsSocket keeps itself alive until CompleteState, which is only called once all its IO has completed
+            sharedSocket->HoldIoReference();
             // Allocate the socket context to pass through every IO on this socket
-            socketContext = new RioSocketContext(weakSocket);
+            socketContext = new RioSocketContext(sharedSocket);
             // kick off IO on this RIO socket
             ioCount = socketContext->InitiateRequest();
         }
@@ -920,4 +1742,53 @@ namespace ctsTraffic
             delete socketContext;
         }
     }
+
+    void ctsRioRegisterDatagramSocket(SOCKET socket)
+    {
+        //
+        // guarantee fully initialized
+        //
+        if (!InitOnceExecuteOnce(&Rioiocp::g_sharedbufferInitializer, Rioiocp::InitOnceRioiocp, nullptr, nullptr))
+        {
+            auto gle = GetLastError();
+            if (0 == gle)
+            {
+                gle = WSAENOBUFS;
+            }
+            THROW_WIN32_MSG(gle, "ctsRioIocp: failed to initialize the RIO completion queues");
+        }
+
+        auto datagramContext = std::make_unique<RioDatagramSocketContext>(socket);
+        const auto lock = g_rioDatagramContextsLock.lock_exclusive();
+        g_rioDatagramContexts.push_back(datagramContext.get());
+        // ownership is now held by g_rioDatagramContexts for the lifetime of the process
+        datagramContext.release();
+    }
+
+    int ctsRioSendDatagram(
+        SOCKET socket,
+        const ctl::ctSockaddr& targetAddress,
+        _In_reads_(bufferCount) const WSABUF* buffers,
+        DWORD bufferCount,
+        _Out_ DWORD* bytesPosted,
+        std::function<void()> sendCompleted) noexcept
+    {
+        RioDatagramSocketContext* datagramContext = nullptr;
+        {
+            const auto lock = g_rioDatagramContextsLock.lock_shared();
+            const auto foundContext = std::find_if(
+                std::begin(g_rioDatagramContexts),
+                std::end(g_rioDatagramContexts),
+                [socket](const RioDatagramSocketContext* context) noexcept { return context->GetSocket() == socket; });
+            if (foundContext != std::end(g_rioDatagramContexts))
+            {
+                datagramContext = *foundContext;
+            }
+        }
+
+        FAIL_FAST_IF_MSG(
+            nullptr == datagramContext,
+            "ctsRioSendDatagram: the socket (%Iu) was never registered with ctsRioRegisterDatagramSocket", socket);
+        return datagramContext->SendDatagram(targetAddress, buffers, bufferCount, bytesPosted, std::move(sendCompleted));
+    }
 }
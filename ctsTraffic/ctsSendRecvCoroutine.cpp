@@ -0,0 +1,678 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// cpp headers
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+#include <malloc.h>
+// ctl headers
+#include <ctThreadIocp.hpp>
+// local headers
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsIOTask.hpp"
+#include "ctsThreadStatistics.h"
+
+//
+// -io:coroutine : each TCP connection is driven by a single C++20 coroutine
+// ** this file is compiled as C++20 (set on its ClCompile item in ctsTraffic.vcxproj) : the rest of ctsTraffic is C++17
+//
+// The coroutine asks the pattern for tasks and posts them with WSASend/WSARecv, then co_awaits the next event of the connection:
+// an overlapped request completing through ctThreadIocp, or a task scheduled with ctsSocket::SetTimer coming due
+// - a completion only queues its event : if the coroutine is waiting it's resumed on that thread, otherwise it's running
+//   and takes the event before it waits again
+// - every event queued is processed, and the next tasks posted, under a single acquisition of the socket lock
+//   (ctsSendRecvIocp re-enters the IO function and takes the socket lock for each completion)
+// - requests are reused from a free list kept per connection, and the coroutine frames from a process-wide pool
+//
+// The coroutine holds one IO count on the ctsSocket : the connection completes once the pattern has no more tasks
+// and every request the coroutine posted has completed
+//
+namespace ctsTraffic
+{
+    namespace CoroutineIo
+    {
+        //
+        // Coroutine frames are cached in a process-wide free list
+        // - every connection runs the same coroutine, so every frame is the same size : frames of the first size allocated are cached
+        //
+        class ctsCoroutineFramePool
+        {
+        public:
+            static constexpr USHORT c_maxCachedFrames = 4096;
+
+            // returns nullptr when out of memory
+            static void* Allocate(size_t size) noexcept
+            {
+                auto& pool = Instance();
+                size_t frameSize = 0;
+                if (pool.m_frameSize.compare_exchange_strong(frameSize, size) || frameSize == size)
+                {
+                    auto* const cachedFrame = InterlockedPopEntrySList(&pool.m_freeList);
+                    if (cachedFrame)
+                    {
+                        return cachedFrame;
+                    }
+                }
+                return _aligned_malloc(size, MEMORY_ALLOCATION_ALIGNMENT);
+            }
+
+            static void Free(_In_ void* frame, size_t size) noexcept
+            {
+                auto& pool = Instance();
+                if (size == pool.m_frameSize && QueryDepthSList(&pool.m_freeList) < c_maxCachedFrames)
+                {
+                    InterlockedPushEntrySList(&pool.m_freeList, static_cast<PSLIST_ENTRY>(frame));
+                    return;
+                }
+                _aligned_free(frame);
+            }
+
+        private:
+            ctsCoroutineFramePool() noexcept
+            {
+                InitializeSListHead(&m_freeList);
+            }
+
+            static ctsCoroutineFramePool& Instance() noexcept
+            {
+                static ctsCoroutineFramePool s_pool;
+                return s_pool;
+            }
+
+            SLIST_HEADER m_freeList{};
+            std::atomic<size_t> m_frameSize{0};
+        };
+
+        //
+        // The coroutine runs from the call until the connection is done
+        // - nothing is returned to the caller but whether its frame could be allocated
+        //
+        struct ctsConnectionCoroutine
+        {
+            struct promise_type
+            {
+                static void* operator new(size_t size) noexcept
+                {
+                    return ctsCoroutineFramePool::Allocate(size);
+                }
+
+                static void operator delete(void* frame, size_t size) noexcept
+                {
+                    ctsCoroutineFramePool::Free(frame, size);
+                }
+
+                // the caller completes the connection when the frame could not be allocated
+                static ctsConnectionCoroutine get_return_object_on_allocation_failure() noexcept
+                {
+                    return ctsConnectionCoroutine{false};
+                }
+
+                ctsConnectionCoroutine get_return_object() noexcept
+                {
+                    return ctsConnectionCoroutine{true};
+                }
+
+                // runs inline until the first co_await, and frees its frame once it returns
+                std::suspend_never initial_suspend() noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never final_suspend() noexcept
+                {
+                    return {};
+                }
+
+                void return_void() noexcept
+                {
+                }
+
+                void unhandled_exception() noexcept
+                {
+                    FAIL_FAST_MSG("ctsSendRecvCoroutine : an exception escaped the connection coroutine");
+                }
+            };
+
+            bool m_started = false;
+        };
+
+        // an overlapped request posted by the coroutine, or a task scheduled with ctsSocket::SetTimer
+        struct ctsCoroutineRequest
+        {
+            ctsTask m_task{};
+            // nullptr for a scheduled task : it's posted once it's due
+            OVERLAPPED* m_overlapped = nullptr;
+            // the OVERLAPPED is returned to ctThreadIocp once the callback returns : the result is copied for the coroutine
+            OVERLAPPED m_completion{};
+            bool m_zeroByteRecv = false;
+            ctsCoroutineRequest* m_nextEvent = nullptr;
+        };
+
+        //
+        // The state of a connection, held in its coroutine frame
+        // - events are queued from the completion and timer callbacks onto a lock-free stack
+        //   which also records if the coroutine is waiting on it (c_waiting)
+        // - all other members are only accessed from the coroutine
+        //
+        class ctsCoroutineConnection
+        {
+        public:
+            ctsCoroutineConnection() noexcept = default;
+            ~ctsCoroutineConnection() noexcept = default;
+
+            ctsCoroutineConnection(const ctsCoroutineConnection&) = delete;
+            ctsCoroutineConnection& operator=(const ctsCoroutineConnection&) = delete;
+            ctsCoroutineConnection(ctsCoroutineConnection&&) = delete;
+            ctsCoroutineConnection& operator=(ctsCoroutineConnection&&) = delete;
+
+            // resumes the coroutine on this thread if it was waiting
+            // - the connection is not touched once the event is queued : the coroutine can complete (freeing its frame) right after
+            void QueueEvent(_In_ ctsCoroutineRequest* request) noexcept
+            {
+                auto events = m_events.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    if (c_waiting == events)
+                    {
+                        request->m_nextEvent = nullptr;
+                        if (m_events.compare_exchange_weak(events, reinterpret_cast<std::uintptr_t>(request), std::memory_order_acq_rel))
+                        {
+                            // only this thread can resume it : the queue is no longer marked as waited on
+                            m_waitingCoroutine.resume();
+                            return;
+                        }
+                    }
+                    else
+                    {
+                        request->m_nextEvent = reinterpret_cast<ctsCoroutineRequest*>(events);
+                        if (m_events.compare_exchange_weak(events, reinterpret_cast<std::uintptr_t>(request), std::memory_order_release))
+                        {
+                            return;
+                        }
+                    }
+                }
+            }
+
+            // returns the events queued since they were last taken, in the order they were queued
+            [[nodiscard]] ctsCoroutineRequest* TakeEvents() noexcept
+            {
+                auto* event = reinterpret_cast<ctsCoroutineRequest*>(m_events.exchange(0, std::memory_order_acquire));
+                ctsCoroutineRequest* orderedEvents = nullptr;
+                while (event)
+                {
+                    auto* const nextEvent = event->m_nextEvent;
+                    event->m_nextEvent = orderedEvents;
+                    orderedEvents = event;
+                    event = nextEvent;
+                }
+                return orderedEvents;
+            }
+
+            // co_await'ed by the coroutine : only suspends if no event was queued since they were last taken
+            struct EventAwaiter
+            {
+                ctsCoroutineConnection* m_connection;
+
+                [[nodiscard]] bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                [[nodiscard]] bool await_suspend(std::coroutine_handle<> coroutine) const noexcept
+                {
+                    m_connection->m_waitingCoroutine = coroutine;
+                    std::uintptr_t noEvents = 0;
+                    return m_connection->m_events.compare_exchange_strong(noEvents, c_waiting, std::memory_order_acq_rel);
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            [[nodiscard]] EventAwaiter NextEvent() noexcept
+            {
+                return EventAwaiter{this};
+            }
+
+            // can throw std::bad_alloc
+            ctsCoroutineRequest* AcquireRequest()
+            {
+                if (m_freeRequests.empty())
+                {
+                    m_requests.emplace_back(std::make_unique<ctsCoroutineRequest>());
+                    // the free list can hold every request : ReleaseRequest never reallocates
+                    m_freeRequests.reserve(m_requests.size());
+                    ++m_outstandingRequests;
+                    return m_requests.rbegin()->get();
+                }
+
+                auto* const request = *m_freeRequests.rbegin();
+                m_freeRequests.pop_back();
+                ++m_outstandingRequests;
+                return request;
+            }
+
+            void ReleaseRequest(_In_ ctsCoroutineRequest* request) noexcept
+            {
+                request->m_overlapped = nullptr;
+                request->m_zeroByteRecv = false;
+                m_freeRequests.push_back(request);
+                --m_outstandingRequests;
+            }
+
+            // releases the events taken without processing them : the connection is closing
+            void ReleaseEvents(_In_opt_ ctsCoroutineRequest* events) noexcept
+            {
+                while (events)
+                {
+                    auto* const nextEvent = events->m_nextEvent;
+                    ReleaseRequest(events);
+                    events = nextEvent;
+                }
+            }
+
+            [[nodiscard]] unsigned long GetOutstandingRequests() const noexcept
+            {
+                return m_outstandingRequests;
+            }
+
+        private:
+            static constexpr std::uintptr_t c_waiting = 1;
+
+            std::atomic<std::uintptr_t> m_events{0};
+            std::coroutine_handle<> m_waitingCoroutine;
+
+            std::vector<std::unique_ptr<ctsCoroutineRequest>> m_requests;
+            std::vector<ctsCoroutineRequest*> m_freeRequests;
+            unsigned long m_outstandingRequests = 0;
+        };
+
+        // a completed OVERLAPPED holds the NTSTATUS and the bytes transferred : only failures need WSAGetOverlappedResult
+        static bool ReadSuccessfulCompletion(_In_ const OVERLAPPED* pOverlapped, _Out_ DWORD* transferred) noexcept
+        {
+            constexpr ULONG_PTR statusSuccess = 0; // STATUS_SUCCESS
+            if (statusSuccess == pOverlapped->Internal)
+            {
+                *transferred = static_cast<DWORD>(pOverlapped->InternalHigh);
+                return true;
+            }
+            *transferred = 0;
+            return false;
+        }
+
+        // completes the task back to the pattern : returns true if the pattern can be asked for more tasks
+        static bool CompleteTask(const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& task, DWORD transferred, unsigned long error, PCSTR functionName, unsigned long& lastError) noexcept
+        {
+            const ctsIoStatus protocolStatus = pattern->CompleteIo(task, transferred, error);
+            switch (protocolStatus)
+            {
+                case ctsIoStatus::ContinueIo:
+                    // if the IO failed, the protocol wants to ignore the error
+                    lastError = NO_ERROR;
+                    return true;
+
+                case ctsIoStatus::CompletedIo:
+                    // the protocol has successfully completed all IO on this connection
+                    lastError = NO_ERROR;
+                    return false;
+
+                case ctsIoStatus::FailedIo:
+                    // write out the error to the error log since the protocol sees this as a hard error
+                    ctsConfig::PrintErrorIfFailed(functionName, error);
+                    lastError = pattern->GetLastPatternError();
+                    return false;
+
+                default:
+                    FAIL_FAST_MSG("ctsSendRecvCoroutine : unknown ctsSocket::IOStatus (%u)", static_cast<unsigned>(protocolStatus));
+            }
+        }
+
+        static bool PostLeasedRecv(ctsCoroutineConnection& connection, const std::shared_ptr<ctsSocket>& sharedSocket, SOCKET socket, const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& zeroByteTask, unsigned long& lastError) noexcept;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Posts the task on the socket, handling the completion here if it's not queued as an event
+        /// - returns true if the pattern can be asked for more tasks
+        ///
+        /// ** the socket lock must be held
+        ///
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        static bool PostTask(ctsCoroutineConnection& connection, const std::shared_ptr<ctsSocket>& sharedSocket, SOCKET socket, const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& task, unsigned long& lastError) noexcept
+        {
+            if (INVALID_SOCKET == socket)
+            {
+                lastError = WSAECONNABORTED;
+                // even if the socket was closed we still must complete the IO request
+                pattern->CompleteIo(task, 0, lastError);
+                return false;
+            }
+
+            if (ctsTaskAction::GracefulShutdown == task.m_ioAction)
+            {
+                lastError = shutdown(socket, SD_SEND) != 0 ? WSAGetLastError() : NO_ERROR;
+                return pattern->CompleteIo(task, 0, lastError) == ctsIoStatus::ContinueIo;
+            }
+
+            if (ctsTaskAction::HardShutdown == task.m_ioAction)
+            {
+                // pass through -1 to force an RST with the closesocket
+                lastError = sharedSocket->CloseSocket(-1);
+                return pattern->CompleteIo(task, 0, lastError) == ctsIoStatus::ContinueIo;
+            }
+
+            ctsCoroutineRequest* request = nullptr;
+            try
+            {
+                request = connection.AcquireRequest();
+                request->m_task = task;
+                // a recv without a buffer waits for data to be indicated before a buffer is leased for it
+                request->m_zeroByteRecv = ctsTaskAction::Recv == task.m_ioAction && nullptr == task.m_buffer;
+
+                const std::shared_ptr<ctl::ctThreadIocp>& ioThreadPool(sharedSocket->GetIocpThreadpool());
+                request->m_overlapped = ioThreadPool->new_request(
+                    [pConnection = &connection, request](OVERLAPPED* pCallbackOverlapped) noexcept
+                {
+                    const ctsThreadStatistics::ctsCallbackScope callbackScope;
+                    request->m_completion = *pCallbackOverlapped;
+                    pConnection->QueueEvent(request);
+                });
+
+                // -BufferSegments : the task's buffer is posted as a gather/scatter list of WSABUFs
+                WSABUF wsabuffers[c_maxTaskBufferSegments];
+                DWORD wsabufferCount = 1;
+                if (request->m_zeroByteRecv)
+                {
+                    wsabuffers[0].buf = nullptr;
+                    wsabuffers[0].len = 0;
+                }
+                else
+                {
+                    wsabufferCount = task.BuildBufferList(wsabuffers);
+                }
+
+                PCSTR functionName;
+                unsigned long error = NO_ERROR;
+                if (ctsTaskAction::Send == task.m_ioAction)
+                {
+                    functionName = "WSASend";
+                    if (WSASend(socket, wsabuffers, wsabufferCount, nullptr, 0, request->m_overlapped, nullptr) != 0)
+                    {
+                        error = WSAGetLastError();
+                    }
+                }
+                else
+                {
+                    functionName = "WSARecv";
+                    DWORD flags = !request->m_zeroByteRecv && ctsConfig::GetFrozenSettings().m_isMsgWaitAll ? MSG_WAITALL : 0;
+                    if (WSARecv(socket, wsabuffers, wsabufferCount, nullptr, &flags, request->m_overlapped, nullptr) != 0)
+                    {
+                        error = WSAGetLastError();
+                    }
+                }
+
+                // the completion is queued as an event if the request pended, or if it succeeded but inline completions aren't handled
+                if (WSA_IO_PENDING == error ||
+                    // ReSharper disable once CppRedundantParentheses
+                    (NO_ERROR == error && !ctsConfig::GetFrozenSettings().m_isInlineIocp))
+                {
+                    return true;
+                }
+
+                // the API call failed, or it succeeded and the completion is handled inline
+                DWORD transferred = 0;
+                if (NO_ERROR == error && !ReadSuccessfulCompletion(request->m_overlapped, &transferred))
+                {
+                    DWORD flags;
+                    if (!WSAGetOverlappedResult(socket, request->m_overlapped, &transferred, FALSE, &flags))
+                    {
+                        FAIL_FAST_MSG(
+                            "WSAGetOverlappedResult failed (%d) after the IO request (%hs) succeeded", WSAGetLastError(), functionName);
+                    }
+                }
+                // must cancel the IOCP TP since IO is not pended
+                ioThreadPool->cancel_request(request->m_overlapped);
+                const bool zeroByteRecv = request->m_zeroByteRecv;
+                connection.ReleaseRequest(request);
+
+                if (zeroByteRecv && NO_ERROR == error)
+                {
+                    // data was already indicated : recv it into a leased buffer
+                    return PostLeasedRecv(connection, sharedSocket, socket, pattern, task, lastError);
+                }
+
+                ctsThreadStatistics::RecordCompletion(transferred, true);
+                return CompleteTask(pattern, task, transferred, error, functionName, lastError);
+            }
+            catch (...)
+            {
+                // only thrown before the request was posted
+                if (request)
+                {
+                    connection.ReleaseRequest(request);
+                }
+                lastError = ctsConfig::PrintThrownException();
+                return pattern->CompleteIo(task, 0, lastError) == ctsIoStatus::ContinueIo;
+            }
+        }
+
+        // -ZeroByteRecv:on : leases a buffer for the recv task whose zero-byte WSARecv completed, and posts the WSARecv for the data
+        // - the leased buffer is returned to the pool by ctsIoPattern::CompleteIo
+        static bool PostLeasedRecv(ctsCoroutineConnection& connection, const std::shared_ptr<ctsSocket>& sharedSocket, SOCKET socket, const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& zeroByteTask, unsigned long& lastError) noexcept
+        {
+            ctsTask leasedTask(zeroByteTask);
+            try
+            {
+                leasedTask.m_buffer = ctsIoPattern::LeaseRecvBuffer();
+            }
+            catch (...)
+            {
+                lastError = ctsConfig::PrintThrownException();
+                return pattern->CompleteIo(zeroByteTask, 0, lastError) == ctsIoStatus::ContinueIo;
+            }
+
+            return PostTask(connection, sharedSocket, socket, pattern, leasedTask, lastError);
+        }
+
+        // processes an event taken from the queue : returns true if the pattern can be asked for more tasks
+        // ** the socket lock must be held
+        static bool ProcessEvent(ctsCoroutineConnection& connection, const std::shared_ptr<ctsSocket>& sharedSocket, SOCKET socket, const std::shared_ptr<ctsIoPattern>& pattern, _In_ ctsCoroutineRequest* request, unsigned long& lastError) noexcept
+        {
+            const ctsTask task(request->m_task);
+            if (!request->m_overlapped)
+            {
+                // the scheduled task is now due
+                connection.ReleaseRequest(request);
+                return PostTask(connection, sharedSocket, socket, pattern, task, lastError);
+            }
+
+            DWORD transferred = 0;
+            unsigned long error = NO_ERROR;
+            const bool completedSuccessfully = ReadSuccessfulCompletion(&request->m_completion, &transferred);
+            if (INVALID_SOCKET == socket)
+            {
+                error = WSAECONNABORTED;
+                transferred = 0;
+            }
+            else if (!completedSuccessfully)
+            {
+                DWORD flags;
+                if (!WSAGetOverlappedResult(socket, &request->m_completion, &transferred, FALSE, &flags))
+                {
+                    error = WSAGetLastError();
+                }
+            }
+
+            const bool zeroByteRecv = request->m_zeroByteRecv;
+            connection.ReleaseRequest(request);
+
+            if (zeroByteRecv && NO_ERROR == error)
+            {
+                // data (or a FIN) has been indicated : the recv holding the leased buffer should complete promptly
+                return PostLeasedRecv(connection, sharedSocket, socket, pattern, task, lastError);
+            }
+
+            const char* functionName = ctsTaskAction::Send == task.m_ioAction ? "WSASend" : "WSARecv";
+            if (error != NO_ERROR) { PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%u) [ctsSendRecvCoroutine]\n", functionName, error); }
+
+            ctsThreadStatistics::RecordCompletion(transferred, false);
+            return CompleteTask(pattern, task, transferred, error, functionName, lastError);
+        }
+
+        // asks the pattern for tasks until it has none, it's done, or a task is scheduled
+        // ** the socket lock must be held
+        static void RequestTasks(ctsCoroutineConnection& connection, const std::shared_ptr<ctsSocket>& sharedSocket, SOCKET socket, const std::shared_ptr<ctsIoPattern>& pattern, unsigned long& lastError) noexcept
+        {
+            for (;;)
+            {
+                const ctsTask nextIo = pattern->InitiateIo();
+                if (ctsTaskAction::None == nextIo.m_ioAction)
+                {
+                    // nothing failed, just no more IO right now
+                    return;
+                }
+
+                if (nextIo.m_timeOffsetMilliseconds > 0)
+                {
+                    ctsCoroutineRequest* request = nullptr;
+                    try
+                    {
+                        request = connection.AcquireRequest();
+                        request->m_task = nextIo;
+                        sharedSocket->SetTimer(
+                            nextIo,
+                            [pConnection = &connection, request](const std::weak_ptr<ctsSocket>&, const ctsTask&) noexcept
+                        {
+                            pConnection->QueueEvent(request);
+                        });
+                        // the pattern is asked for more once the task is due
+                        return;
+                    }
+                    catch (...)
+                    {
+                        if (request)
+                        {
+                            connection.ReleaseRequest(request);
+                        }
+                        lastError = ctsConfig::PrintThrownException();
+                        if (pattern->CompleteIo(nextIo, 0, lastError) != ctsIoStatus::ContinueIo)
+                        {
+                            return;
+                        }
+                        continue;
+                    }
+                }
+
+                if (!PostTask(connection, sharedSocket, socket, pattern, nextIo, lastError))
+                {
+                    return;
+                }
+            }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Processes every event queued since the coroutine last ran, then posts the tasks the pattern has ready
+        /// - all under a single acquisition of the socket lock
+        ///
+        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        static void ProcessEvents(const std::weak_ptr<ctsSocket>& weakSocket, ctsCoroutineConnection& connection, bool requestTasks, unsigned long& lastError) noexcept
+        {
+            auto* event = connection.TakeEvents();
+
+            const auto sharedSocket(weakSocket.lock());
+            if (!sharedSocket)
+            {
+                // the coroutine only waits for the requests still pended to complete
+                lastError = WSAECONNABORTED;
+                connection.ReleaseEvents(event);
+                return;
+            }
+
+            const auto lockedSocket = sharedSocket->AcquireSocketLock();
+            const auto lockedPattern = lockedSocket.GetPattern();
+            if (!lockedPattern)
+            {
+                lastError = WSAECONNABORTED;
+                connection.ReleaseEvents(event);
+                return;
+            }
+
+            // if lockedSocket has an INVALID_SOCKET, the tasks are completed back to the pattern with WSAECONNABORTED
+            const SOCKET socket = lockedSocket.GetSocket();
+            while (event)
+            {
+                auto* const nextEvent = event->m_nextEvent;
+                if (ProcessEvent(connection, sharedSocket, socket, lockedPattern, event, lastError))
+                {
+                    requestTasks = true;
+                }
+                event = nextEvent;
+            }
+
+            if (requestTasks)
+            {
+                RequestTasks(connection, sharedSocket, socket, lockedPattern, lastError);
+            }
+        }
+
+        // the coroutine of a connection : the socket lock is never held across a co_await
+        static ctsConnectionCoroutine RunConnection(std::weak_ptr<ctsSocket> weakSocket) noexcept
+        {
+            ctsCoroutineConnection connection;
+            unsigned long lastError = NO_ERROR;
+
+            ProcessEvents(weakSocket, connection, true, lastError);
+            while (connection.GetOutstandingRequests() > 0)
+            {
+                co_await connection.NextEvent();
+                ProcessEvents(weakSocket, connection, false, lastError);
+            }
+
+            // every request posted has completed : release the IO count held for the coroutine
+            const auto sharedSocket(weakSocket.lock());
+            if (sharedSocket && 0 == sharedSocket->DecrementIo())
+            {
+                sharedSocket->CompleteState(lastError);
+            }
+        }
+    }
+
+    // The function registered with ctsConfig
+    void ctsSendRecvCoroutine(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        const auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        // the coroutine holds this IO count until the pattern is done and every request it posted has completed
+        sharedSocket->IncrementIo();
+        if (!CoroutineIo::RunConnection(weakSocket).m_started)
+        {
+            if (0 == sharedSocket->DecrementIo())
+            {
+                sharedSocket->CompleteState(ERROR_NOT_ENOUGH_MEMORY);
+            }
+        }
+    }
+
+} // namespace
@@ -18,17 +18,20 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <WinSock2.h>
 // ctl headers
 #include <ctThreadIocp.hpp>
+#include <ctTimer.hpp>
 #include <ctSockaddr.hpp>
+#include <ctSocketExtensions.hpp>
 // local headers
 #include "ctsConfig.h"
 #include "ctsSocket.h"
 #include "ctsIOTask.hpp"
+#include "ctsThreadStatistics.h"
 
 namespace ctsTraffic
 {
 
     /// forward delcaration
-    void ctsSendRecvIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    static void ctsSendRecvRequestIo(ctsSocket* pSocket) noexcept;
 
     struct ctsSendRecvStatus
     {
@@ -38,87 +41,134 @@ namespace ctsTraffic
         bool m_ioDone = false;
         // returns if IO was started (since can return !io_done, but I/O wasn't started yet)
         bool m_ioStarted = false;
+        // the request succeeded synchronously and its completion was processed inline (-InlineCompletions)
+        bool m_completedInline = false;
     };
 
-    // IO Threadpool completion callback 
-    static void ctsSendRecvCompletionCallback(
-        _In_ OVERLAPPED* pOverlapped,
-        const std::weak_ptr<ctsSocket>& weakSocket,
-        const ctsTask& task) noexcept
+    // -ZeroByteRecv:on : recv tasks arrive without a buffer and are first posted as a zero-byte WSARecv
+    static ctsSendRecvStatus ctsSendRecvPostLeasedRecv(SOCKET socket, ctsSocket* pSocket, ctsIoPattern* pPattern, const ctsTask& zeroByteTask) noexcept;
+    static void ctsSendRecvZeroByteCompletionCallback(_In_ OVERLAPPED* pOverlapped, ctsSocket* pSocket, const ctsTask& task) noexcept;
+
+    // -IO:transmitpackets describes each send buffer as up to this many memory elements of at least c_transmitPacketsElementLength
+    constexpr DWORD c_transmitPacketsMaxElements = 64;
+    constexpr DWORD c_transmitPacketsElementLength = 0x10000;
+
+    // the element array is captured by the TransmitPackets call : it need not outlive the IO request
+    static BOOL ctsSendRecvTransmitPackets(SOCKET socket, _In_reads_bytes_(bufferLength) char* buffer, DWORD bufferLength, _In_ OVERLAPPED* pOverlapped) noexcept
     {
-        auto sharedSocket(weakSocket.lock());
-        if (!sharedSocket)
+        TRANSMIT_PACKETS_ELEMENT elements[c_transmitPacketsMaxElements]{};
+        DWORD elementLength = (bufferLength + c_transmitPacketsMaxElements - 1) / c_transmitPacketsMaxElements;
+        if (elementLength < c_transmitPacketsElementLength)
         {
-            return;
+            elementLength = c_transmitPacketsElementLength;
         }
 
-        int gle = NO_ERROR;
+        DWORD elementCount = 0;
+        for (DWORD offset = 0; offset < bufferLength; offset += elementLength)
+        {
+            auto& element = elements[elementCount];
+            element.dwElFlags = TP_ELEMENT_MEMORY;
+            element.cLength = bufferLength - offset < elementLength ? bufferLength - offset : elementLength;
+            element.pBuffer = buffer + offset;
+            ++elementCount;
+        }
 
-        // hold a reference on the socket
-        const auto lockedSocket = sharedSocket->AcquireSocketLock();
-        const auto lockedPattern = lockedSocket.GetPattern();
-        if (!lockedPattern)
+        return ctl::ctTransmitPackets(socket, elements, elementCount, 0, pOverlapped, 0);
+    }
+
+    // a completed OVERLAPPED holds the NTSTATUS and the bytes transferred
+    // - lets the zero-byte recv completion tell success from failure before it takes the socket lock
+    static bool ctsSendRecvReadSuccessfulCompletion(_In_ const OVERLAPPED* pOverlapped, _Out_ DWORD* transferred) noexcept
+    {
+        constexpr ULONG_PTR statusSuccess = 0; // STATUS_SUCCESS
+        if (statusSuccess == pOverlapped->Internal)
         {
-            gle = WSAECONNABORTED;
+            *transferred = static_cast<DWORD>(pOverlapped->InternalHigh);
+            return true;
         }
+        *transferred = 0;
+        return false;
+    }
 
-        const SOCKET socket = lockedSocket.GetSocket();
-        DWORD transferred = 0;
-        if (gle == NO_ERROR)
+    // IO Threadpool completion callback 
+    // - the IO count held for this IO keeps the ctsSocket alive, as ctsSendRecvIocp had it hold its IO reference
+    static void ctsSendRecvCompletionCallback(
+        _In_ OVERLAPPED* pOverlapped,
+        ctsSocket* const pSocket,
+        const ctsTask& task) noexcept
+    {
+        const ctsThreadStatistics::ctsCallbackScope callbackScope;
+        int gle = NO_ERROR;
+
+        // the socket lock must be released before the IO count : CompleteState can delete the ctsSocket
         {
-            // try to get the success/error code and bytes transferred (under the socket lock)
-            // if we no longer have a valid socket or the pattern was destroyed, return early
-            if (INVALID_SOCKET == socket)
+            // hold a reference on the socket
+            const auto lockedSocket = pSocket->AcquireSocketLock();
+            auto* const lockedPattern = lockedSocket.GetPatternPointer();
+            if (!lockedPattern)
             {
                 gle = WSAECONNABORTED;
             }
-            else
+
+            const SOCKET socket = lockedSocket.GetSocket();
+            DWORD transferred = 0;
+            if (gle == NO_ERROR)
             {
-                DWORD flags;
-                if (!WSAGetOverlappedResult(socket, pOverlapped, &transferred, FALSE, &flags))
+                // try to get the success/error code and bytes transferred (under the socket lock)
+                // if we no longer have a valid socket or the pattern was destroyed, return early
+                if (INVALID_SOCKET == socket)
+                {
+                    gle = WSAECONNABORTED;
+                }
+                else
                 {
-                    gle = WSAGetLastError();
+                    DWORD flags;
+                    if (!WSAGetOverlappedResult(socket, pOverlapped, &transferred, FALSE, &flags))
+                    {
+                        gle = WSAGetLastError();
+                    }
                 }
             }
-        }
 
-        // write to PrintError if the IO failed
-        const char* functionName = ctsTaskAction::Send == task.m_ioAction ? "WSASend" : "WSARecv";
-        if (gle != NO_ERROR) { PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%d) [ctsSendRecvIocp]\n", functionName, gle); }
+            // write to PrintError if the IO failed
+            const char* functionName = ctsTaskAction::Send == task.m_ioAction ? "WSASend" : "WSARecv";
+            if (gle != NO_ERROR) { PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%d) [ctsSendRecvIocp]\n", functionName, gle); }
 
-        if (lockedPattern)
-        {
-            // see if complete_io requests more IO
-            const ctsIoStatus protocolStatus = lockedPattern->CompleteIo(task, transferred, gle);
-            switch (protocolStatus)
+            if (lockedPattern)
             {
-                case ctsIoStatus::ContinueIo:
-                    // more IO is requested from the protocol : invoke the new IO call while holding a refcount to the prior IO
-                    ctsSendRecvIocp(weakSocket);
-                    break;
-
-                case ctsIoStatus::CompletedIo:
-                    // no more IO is requested from the protocol : indicate success
-                    gle = NO_ERROR;
-                    break;
-
-                case ctsIoStatus::FailedIo:
-                    // write out the error to the error log since the protocol sees this as a hard error
-                    ctsConfig::PrintErrorIfFailed(functionName, gle);
-                    // protocol sees this as a failure : capture the error the protocol recorded
-                    gle = static_cast<int>(lockedPattern->GetLastPatternError());
-                    break;
-
-                default:
-                    FAIL_FAST_MSG("ctsSendRecvIocp : unknown ctsSocket::IOStatus (%u)", static_cast<unsigned>(protocolStatus));
+                ctsThreadStatistics::RecordCompletion(transferred, false);
+                // see if complete_io requests more IO
+                const ctsIoStatus protocolStatus = lockedPattern->CompleteIo(task, transferred, gle);
+                switch (protocolStatus)
+                {
+                    case ctsIoStatus::ContinueIo:
+                        // more IO is requested from the protocol : invoke the new IO call while holding a refcount to the prior IO
+                        ctsSendRecvRequestIo(pSocket);
+                        break;
+
+                    case ctsIoStatus::CompletedIo:
+                        // no more IO is requested from the protocol : indicate success
+                        gle = NO_ERROR;
+                        break;
+
+                    case ctsIoStatus::FailedIo:
+                        // write out the error to the error log since the protocol sees this as a hard error
+                        ctsConfig::PrintErrorIfFailed(functionName, gle);
+                        // protocol sees this as a failure : capture the error the protocol recorded
+                        gle = static_cast<int>(lockedPattern->GetLastPatternError());
+                        break;
+
+                    default:
+                        FAIL_FAST_MSG("ctsSendRecvIocp : unknown ctsSocket::IOStatus (%u)", static_cast<unsigned>(protocolStatus));
+                }
             }
         }
 
         // always decrement *after* attempting new IO : the prior IO is now formally "done"
-        if (sharedSocket->DecrementIo() == 0)
+        if (pSocket->DecrementIo() == 0)
         {
             // if we have no more IO pended, complete the state
-            sharedSocket->CompleteState(gle);
+            pSocket->CompleteState(gle);
         }
     }
 
@@ -129,7 +179,7 @@ namespace ctsTraffic
     /// ** ctsSocket::increment_io must have been called before this function was invoked
     ///
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    static ctsSendRecvStatus ctsSendRecvProcessTask(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& sharedPattern, const ctsTask& nextIo) noexcept
+    static ctsSendRecvStatus ctsSendRecvProcessTask(SOCKET socket, ctsSocket* const pSocket, ctsIoPattern* const pPattern, const ctsTask& nextIo) noexcept
     {
         ctsSendRecvStatus returnStatus;
 
@@ -140,7 +190,7 @@ namespace ctsTraffic
             returnStatus.m_ioStarted = false;
             returnStatus.m_ioDone = true;
             // even if the socket was closed we still must complete the IO request
-            sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode);
+            pPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode);
             return returnStatus;
         }
 
@@ -150,15 +200,15 @@ namespace ctsTraffic
             {
                 returnStatus.m_ioErrorcode = WSAGetLastError();
             }
-            returnStatus.m_ioDone = sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
+            returnStatus.m_ioDone = pPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
             returnStatus.m_ioStarted = false;
 
         }
         else if (ctsTaskAction::HardShutdown == nextIo.m_ioAction)
         {
             // pass through -1 to force an RST with the closesocket
-            returnStatus.m_ioErrorcode = sharedSocket->CloseSocket(-1);
-            returnStatus.m_ioDone = sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
+            returnStatus.m_ioErrorcode = pSocket->CloseSocket(-1);
+            returnStatus.m_ioDone = pPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
             returnStatus.m_ioStarted = false;
 
         }
@@ -166,23 +216,52 @@ namespace ctsTraffic
         {
             try
             {
+                // a recv without a buffer waits for data to be indicated before a buffer is leased for it
+                const bool zeroByteRecv = ctsTaskAction::Recv == nextIo.m_ioAction && nullptr == nextIo.m_buffer;
+
                 // attempt to allocate an IO thread-pool object
-                const std::shared_ptr<ctl::ctThreadIocp>& ioThreadPool(sharedSocket->GetIocpThreadpool());
-                OVERLAPPED* const pOverlapped = ioThreadPool->new_request(
-                    [weak_reference = std::weak_ptr<ctsSocket>(sharedSocket), nextIo](OVERLAPPED* pCallbackOverlapped) noexcept
+                const std::shared_ptr<ctl::ctThreadIocp>& ioThreadPool(pSocket->GetIocpThreadpool());
+                auto callback = [pSocket, nextIo, zeroByteRecv](OVERLAPPED* pCallbackOverlapped) noexcept
                 {
-                    ctsSendRecvCompletionCallback(pCallbackOverlapped, weak_reference, nextIo);
-                });
-
-                WSABUF wsabuffer;
-                wsabuffer.buf = nextIo.m_buffer + nextIo.m_bufferOffset;
-                wsabuffer.len = nextIo.m_bufferLength;
+                    if (zeroByteRecv)
+                    {
+                        ctsSendRecvZeroByteCompletionCallback(pCallbackOverlapped, pSocket, nextIo);
+                    }
+                    else
+                    {
+                        ctsSendRecvCompletionCallback(pCallbackOverlapped, pSocket, nextIo);
+                    }
+                };
+                // every send and recv constructs this callback : it must stay in place so IO never allocates it
+                static_assert(ctl::ctThreadIocpCallbackInfo::stored_in_place<decltype(callback)>, "the ctsTask captured per IO must fit in ctThreadIocpCallbackInfo::c_callbackStorageSize");
+                OVERLAPPED* const pOverlapped = ioThreadPool->new_request(std::move(callback));
+
+                // -BufferSegments : the task's buffer is posted as a gather/scatter list of WSABUFs
+                WSABUF wsabuffers[c_maxTaskBufferSegments];
+                DWORD wsabufferCount = 1;
+                if (zeroByteRecv)
+                {
+                    wsabuffers[0].buf = nullptr;
+                    wsabuffers[0].len = 0;
+                }
+                else
+                {
+                    wsabufferCount = nextIo.BuildBufferList(wsabuffers);
+                }
 
                 PCSTR functionName;
-                if (ctsTaskAction::Send == nextIo.m_ioAction)
+                if (ctsTaskAction::Send == nextIo.m_ioAction && ctsConfig::GetFrozenSettings().m_isTransmitPackets)
+                {
+                    functionName = "TransmitPackets";
+                    if (!ctsSendRecvTransmitPackets(socket, nextIo.m_buffer + nextIo.m_bufferOffset, nextIo.m_bufferLength, pOverlapped))
+                    {
+                        returnStatus.m_ioErrorcode = WSAGetLastError();
+                    }
+                }
+                else if (ctsTaskAction::Send == nextIo.m_ioAction)
                 {
                     functionName = "WSASend";
-                    if (WSASend(socket, &wsabuffer, 1, nullptr, 0, pOverlapped, nullptr) != 0)
+                    if (WSASend(socket, wsabuffers, wsabufferCount, nullptr, 0, pOverlapped, nullptr) != 0)
                     {
                         returnStatus.m_ioErrorcode = WSAGetLastError();
                     }
@@ -190,8 +269,8 @@ namespace ctsTraffic
                 else
                 {
                     functionName = "WSARecv";
-                    DWORD flags = ctsConfig::g_configSettings->Options & ctsConfig::OptionType::MsgWaitAll ? MSG_WAITALL : 0;
-                    if (WSARecv(socket, &wsabuffer, 1, nullptr, &flags, pOverlapped, nullptr) != 0)
+                    DWORD flags = !zeroByteRecv && ctsConfig::GetFrozenSettings().m_isMsgWaitAll ? MSG_WAITALL : 0;
+                    if (WSARecv(socket, wsabuffers, wsabufferCount, nullptr, &flags, pOverlapped, nullptr) != 0)
                     {
                         returnStatus.m_ioErrorcode = WSAGetLastError();
                     }
@@ -202,13 +281,19 @@ namespace ctsTraffic
                 //
                 if (WSA_IO_PENDING == returnStatus.m_ioErrorcode ||
                     // ReSharper disable once CppRedundantParentheses
-                    (NO_ERROR == returnStatus.m_ioErrorcode && !(ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp)))
+                    (NO_ERROR == returnStatus.m_ioErrorcode && !ctsConfig::GetFrozenSettings().m_isInlineIocp))
                 {
                     returnStatus.m_ioErrorcode = NO_ERROR;
                     returnStatus.m_ioStarted = true;
                     returnStatus.m_ioDone = false;
 
                 }
+                else if (zeroByteRecv && NO_ERROR == returnStatus.m_ioErrorcode)
+                {
+                    // data was already indicated : must cancel the IOCP TP since IO is not pended, then recv the data
+                    ioThreadPool->cancel_request(pOverlapped);
+                    returnStatus = ctsSendRecvPostLeasedRecv(socket, pSocket, pPattern, nextIo);
+                }
                 else
                 {
                     // process the completion if the API call failed, or if it succeeded and we're handling the completion inline, 
@@ -226,8 +311,10 @@ namespace ctsTraffic
                     }
                     // must cancel the IOCP TP since IO is not pended
                     ioThreadPool->cancel_request(pOverlapped);
+                    ctsThreadStatistics::RecordCompletion(bytesTransferred, true);
+                    returnStatus.m_completedInline = NO_ERROR == returnStatus.m_ioErrorcode;
                     // call back to the socket to see if wants more IO
-                    const ctsIoStatus protocolStatus = sharedPattern->CompleteIo(nextIo, bytesTransferred, returnStatus.m_ioErrorcode);
+                    const ctsIoStatus protocolStatus = pPattern->CompleteIo(nextIo, bytesTransferred, returnStatus.m_ioErrorcode);
                     switch (protocolStatus)
                     {
                         case ctsIoStatus::ContinueIo:
@@ -246,9 +333,9 @@ namespace ctsTraffic
 
                         case ctsIoStatus::FailedIo:
                             // write out the error
-                            ctsConfig::PrintErrorIfFailed(functionName, sharedPattern->GetLastPatternError());
+                            ctsConfig::PrintErrorIfFailed(functionName, pPattern->GetLastPatternError());
                             // the protocol acknoledged the failure - socket is done with IO
-                            returnStatus.m_ioErrorcode = sharedPattern->GetLastPatternError();
+                            returnStatus.m_ioErrorcode = pPattern->GetLastPatternError();
                             returnStatus.m_ioDone = true;
                             break;
 
@@ -260,7 +347,7 @@ namespace ctsTraffic
             catch (...)
             {
                 returnStatus.m_ioErrorcode = ctsConfig::PrintThrownException();
-                returnStatus.m_ioDone = sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
+                returnStatus.m_ioDone = pPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
                 returnStatus.m_ioStarted = false;
             }
         }
@@ -268,6 +355,88 @@ namespace ctsTraffic
         return returnStatus;
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Leases a buffer for a recv task whose zero-byte WSARecv completed, and posts the WSARecv for the data
+    /// - the leased buffer is returned to the pool by ctsIoPattern::CompleteIo
+    ///
+    /// ** ctsSocket::increment_io must have been called before this function was invoked
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static ctsSendRecvStatus ctsSendRecvPostLeasedRecv(SOCKET socket, ctsSocket* const pSocket, ctsIoPattern* const pPattern, const ctsTask& zeroByteTask) noexcept
+    {
+        ctsTask leasedTask(zeroByteTask);
+        try
+        {
+            leasedTask.m_buffer = ctsIoPattern::LeaseRecvBuffer();
+        }
+        catch (...)
+        {
+            ctsSendRecvStatus returnStatus;
+            returnStatus.m_ioErrorcode = ctsConfig::PrintThrownException();
+            returnStatus.m_ioDone = pPattern->CompleteIo(zeroByteTask, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
+            returnStatus.m_ioStarted = false;
+            return returnStatus;
+        }
+
+        return ctsSendRecvProcessTask(socket, pSocket, pPattern, leasedTask);
+    }
+
+    // IO Threadpool completion callback for the zero-byte WSARecv of a recv task
+    static void ctsSendRecvZeroByteCompletionCallback(
+        _In_ OVERLAPPED* pOverlapped,
+        ctsSocket* const pSocket,
+        const ctsTask& task) noexcept
+    {
+        DWORD transferred = 0;
+        if (!ctsSendRecvReadSuccessfulCompletion(pOverlapped, &transferred))
+        {
+            // the zero-byte recv failed : complete the task back to the pattern like any other failed recv
+            ctsSendRecvCompletionCallback(pOverlapped, pSocket, task);
+            return;
+        }
+
+        ctsSendRecvStatus status{};
+
+        // the socket lock must be released before the IO count : CompleteState can delete the ctsSocket
+        {
+            // hold a reference on the socket
+            const auto lockedSocket = pSocket->AcquireSocketLock();
+            auto* const lockedPattern = lockedSocket.GetPatternPointer();
+            if (!lockedPattern)
+            {
+                status.m_ioErrorcode = WSAECONNABORTED;
+            }
+            else
+            {
+                // data (or a FIN) has been indicated : the recv holding the leased buffer should complete promptly
+                // - if lockedSocket has an INVALID_SOCKET, ctsSendRecvProcessTask handles it appropriately
+                pSocket->IncrementIo();
+                status = ctsSendRecvPostLeasedRecv(lockedSocket.GetSocket(), pSocket, lockedPattern, task);
+                if (!status.m_ioStarted)
+                {
+                    if (0 == pSocket->DecrementIo())
+                    {
+                        // this should never be zero since we should be holding a refcount for this callback
+                        FAIL_FAST_MSG(
+                            "The refcount of the ctsSocket object (%p) fell to zero during a zero-byte recv callback", pSocket);
+                    }
+                }
+                if (!status.m_ioDone)
+                {
+                    ctsSendRecvRequestIo(pSocket);
+                }
+            }
+        }
+
+        // always decrement *after* attempting new IO : the zero-byte IO is now formally "done"
+        if (pSocket->DecrementIo() == 0)
+        {
+            // if we have no more IO pended, complete the state
+            pSocket->CompleteState(status.m_ioErrorcode);
+        }
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///
     /// This is the callback for the threadpool timer.
@@ -277,63 +446,89 @@ namespace ctsTraffic
     static void ctsSendRecvTimerCallback(const std::weak_ptr<ctsSocket>& weakSocket, const ctsTask& nextIo) noexcept
     {
         // attempt to get a reference to the socket
-        auto sharedSocket(weakSocket.lock());
+        // - timers are given a weak_ptr : this reference is held through CompleteState
+        const auto sharedSocket(weakSocket.lock());
         if (!sharedSocket)
         {
             return;
         }
+        ctsSocket* const pSocket = sharedSocket.get();
 
         // hold a reference on the socket
-        const auto lockedSocket = sharedSocket->AcquireSocketLock();
-        const auto lockedPattern = lockedSocket.GetPattern();
+        const auto lockedSocket = pSocket->AcquireSocketLock();
+        auto* const lockedPattern = lockedSocket.GetPatternPointer();
         if (!lockedPattern)
         {
+            // the scheduled task won't run : release the IO count taken when it was scheduled
+            if (pSocket->DecrementIo() == 0)
+            {
+                pSocket->CompleteState(WSAECONNABORTED);
+            }
             return;
         }
         // if lockedSocket has an INVALID_SOCKET, continue below to ctsSendRecvProcessTask
         // where it's handled appropriately
 
         // increment IO for this IO request
-        sharedSocket->IncrementIo();
+        pSocket->IncrementIo();
 
         // run the ctsIOTask (next_io) that was scheduled through the TP timer
-        const ctsSendRecvStatus status = ctsSendRecvProcessTask(lockedSocket.GetSocket(), sharedSocket, lockedPattern, nextIo);
+        const ctsSendRecvStatus status = ctsSendRecvProcessTask(lockedSocket.GetSocket(), pSocket, lockedPattern, nextIo);
         // if no IO was started, decrement the IO counter
         if (!status.m_ioStarted)
         {
-            if (0 == sharedSocket->DecrementIo())
+            if (0 == pSocket->DecrementIo())
             {
                 // this should never be zero since we should be holding a refcount for this callback
                 FAIL_FAST_MSG(
-                    "The refcount of the ctsSocket object (%p) fell to zero during a scheduled callback", sharedSocket.get());
+                    "The refcount of the ctsSocket object (%p) fell to zero during a scheduled callback", pSocket);
             }
         }
         // continue requesting IO if this connection still isn't done with all IO after scheduling the prior IO
         if (!status.m_ioDone)
         {
-            ctsSendRecvIocp(weakSocket);
+            ctsSendRecvRequestIo(pSocket);
         }
         // finally decrement the IO that was counted for this IO that was completed async
-        if (sharedSocket->DecrementIo() == 0)
+        if (pSocket->DecrementIo() == 0)
         {
             // if we have no more IO pended, complete the state
-            sharedSocket->CompleteState(status.m_ioErrorcode);
+            pSocket->CompleteState(status.m_ioErrorcode);
         }
     }
 
-    // The function registered with ctsConfig
-    void ctsSendRecvIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// -InlineCompletionBudget : a connection which used up its budget of inline completions continues here
+    /// - on a threadpool thread, behind the completions already queued for other connections
+    ///
+    /// ** the IO count taken when this callback was submitted holds the ctsSocket
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void NTAPI ctsSendRecvYieldCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID context) noexcept
     {
-        // attempt to get a reference to the socket
-        auto sharedSocket(weakSocket.lock());
-        if (!sharedSocket)
+        auto* const pSocket = static_cast<ctsSocket*>(context);
+        ctsSendRecvRequestIo(pSocket);
+
+        if (0 == pSocket->DecrementIo())
         {
-            return;
+            pSocket->CompleteState(NO_ERROR);
         }
+    }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Requests IO from the pattern until it has none or it's done
+    ///
+    /// ** callers must be holding either an IO count or a reference on the ctsSocket
+    ///    as the IO count taken by this function can fall to zero while it holds the socket lock
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    static void ctsSendRecvRequestIo(ctsSocket* const pSocket) noexcept
+    {
         // hold a reference on the socket
-        const auto lockedSocket = sharedSocket->AcquireSocketLock();
-        const auto lockedPattern = lockedSocket.GetPattern();
+        const auto lockedSocket = pSocket->AcquireSocketLock();
+        auto* const lockedPattern = lockedSocket.GetPatternPointer();
         if (!lockedPattern)
         {
             return;
@@ -350,7 +545,13 @@ namespace ctsTraffic
         // The IO refcount must be incremented here to hold an IO count on the socket
         // - so that we won't inadvertently call complete_state() while IO is still being scheduled
         //
-        sharedSocket->IncrementIo();
+        pSocket->IncrementIo();
+
+        // -InlineCompletionBudget : the inline completions this call may process before yielding the thread
+        const auto& frozenSettings = ctsConfig::GetFrozenSettings();
+        const bool budgeted = frozenSettings.m_inlineCompletionBudget > 0 || frozenSettings.m_inlineCompletionBudgetQpc > 0;
+        long long budgetEndQpc = frozenSettings.m_inlineCompletionBudgetQpc > 0 ? ctl::ctTimer::SnapQpc() + frozenSettings.m_inlineCompletionBudgetQpc : 0LL;
+        unsigned long inlineCompletions = 0;
 
         ctsSendRecvStatus status{};
         while (!status.m_ioDone)
@@ -363,14 +564,15 @@ namespace ctsTraffic
             }
 
             // increment IO for each individual request
-            sharedSocket->IncrementIo();
+            pSocket->IncrementIo();
 
             if (nextIo.m_timeOffsetMilliseconds > 0)
             {
+                status.m_completedInline = false;
                 // set_timer can throw
                 try
                 {
-                    sharedSocket->SetTimer(nextIo, ctsSendRecvTimerCallback);
+                    pSocket->SetTimer(nextIo, ctsSendRecvTimerCallback);
                     status.m_ioStarted = true; // IO started in the context of keeping the count incremented
                     status.m_ioDone = true;
                 }
@@ -383,25 +585,75 @@ namespace ctsTraffic
             }
             else
             {
-                status = ctsSendRecvProcessTask(lockedSocket.GetSocket(), sharedSocket, lockedPattern, nextIo);
+                status = ctsSendRecvProcessTask(lockedSocket.GetSocket(), pSocket, lockedPattern, nextIo);
             }
 
             // if no IO was started, decrement the IO counter
             if (!status.m_ioStarted)
             {
                 // since IO is not pended, remove the refcount
-                if (0 == sharedSocket->DecrementIo())
+                if (0 == pSocket->DecrementIo())
                 {
                     // this should never be zero as we are holding a reference outside the loop
                     FAIL_FAST_MSG(
-                        "The ctsSocket (%p) refcount fell to zero while this function was holding a reference", sharedSocket.get());
+                        "The ctsSocket (%p) refcount fell to zero while this function was holding a reference", pSocket);
+                }
+            }
+
+            if (budgeted && status.m_completedInline)
+            {
+                ctsConfig::g_configSettings->TcpStatusDetails.m_inlineCompletions.Increment();
+                ++inlineCompletions;
+                const bool budgetSpent = frozenSettings.m_inlineCompletionBudget > 0 ?
+                    inlineCompletions >= frozenSettings.m_inlineCompletionBudget :
+                    ctl::ctTimer::SnapQpc() >= budgetEndQpc;
+                if (budgetSpent && !status.m_ioDone)
+                {
+                    // continue from the threadpool, the IO count holding the socket until the callback runs
+                    pSocket->IncrementIo();
+                    if (TrySubmitThreadpoolCallback(ctsSendRecvYieldCallback, pSocket, ctsConfig::g_configSettings->pTpEnvironment))
+                    {
+                        ctsConfig::g_configSettings->TcpStatusDetails.m_inlineYields.Increment();
+                        break;
+                    }
+                    // couldn't yield : keep completing inline with a fresh budget
+                    ctsConfig::PrintErrorIfFailed("TrySubmitThreadpoolCallback", GetLastError());
+                    pSocket->DecrementIo();
+                    inlineCompletions = 0;
+                    if (budgetEndQpc > 0)
+                    {
+                        budgetEndQpc = ctl::ctTimer::SnapQpc() + frozenSettings.m_inlineCompletionBudgetQpc;
+                    }
                 }
             }
         }
         // decrement IO at the end to release the refcount held before the loop
+        if (0 == pSocket->DecrementIo())
+        {
+            pSocket->CompleteState(status.m_ioErrorcode);
+        }
+    }
+
+    // The function registered with ctsConfig
+    void ctsSendRecvIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        // attempt to get a reference to the socket
+        const auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        // IO callbacks refer to the ctsSocket by raw pointer instead of locking a weak_ptr with every completion
+        // - the ctsSocket keeps itself alive until CompleteState, which is only called once all its IO has completed
+        sharedSocket->HoldIoReference();
+        // hold an IO count across the first request : if it starts no IO (or there's no pattern)
+        // - the socket is completed here, releasing that reference (CompleteState reports the pattern's last error)
+        sharedSocket->IncrementIo();
+        ctsSendRecvRequestIo(sharedSocket.get());
         if (0 == sharedSocket->DecrementIo())
         {
-            sharedSocket->CompleteState(status.m_ioErrorcode);
+            sharedSocket->CompleteState(NO_ERROR);
         }
     }
 
@@ -0,0 +1,126 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// declaration header
+#include "ctsSharedStats.h"
+// ctl headers
+#include <ctTimer.hpp>
+// wil headers
+#include <wil/result.h>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    ctsSharedStatsWriter::ctsSharedStatsWriter(_In_z_ PCWSTR name, bool openExisting)
+    {
+        if (openExisting)
+        {
+            m_mapping = OpenFileMappingW(FILE_MAP_WRITE, FALSE, name);
+            if (!m_mapping)
+            {
+                THROW_WIN32_MSG(GetLastError(), "OpenFileMappingW(%ws)", name);
+            }
+        }
+        else
+        {
+            m_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(ctsSharedStats), name);
+            if (!m_mapping)
+            {
+                THROW_WIN32_MSG(GetLastError(), "CreateFileMappingW(%ws)", name);
+            }
+        }
+        if (!openExisting && ERROR_ALREADY_EXISTS == GetLastError())
+        {
+            CloseHandle(m_mapping);
+            THROW_WIN32_MSG(ERROR_ALREADY_EXISTS, "CreateFileMappingW(%ws) - the name is already in use", name);
+        }
+
+        m_stats = static_cast<ctsSharedStats*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, sizeof(ctsSharedStats)));
+        if (!m_stats)
+        {
+            const auto gle = GetLastError();
+            CloseHandle(m_mapping);
+            THROW_WIN32_MSG(gle, "MapViewOfFile(%ws)", name);
+        }
+
+        // the new pages are zero-filled: only the header and the fixed values need to be written
+        // - the signature is written last so samplers never see a partial header
+        m_stats->m_version = ctsSharedStats::c_version;
+        m_stats->m_size = sizeof(ctsSharedStats);
+        m_stats->m_processId = GetCurrentProcessId();
+        m_stats->m_qpf = ctl::ctTimer::SnapQpf();
+        MemoryBarrier();
+        m_stats->m_signature = ctsSharedStats::c_signature;
+    }
+
+    ctsSharedStatsWriter::~ctsSharedStatsWriter() noexcept
+    {
+        UnmapViewOfFile(m_stats);
+        CloseHandle(m_mapping);
+    }
+
+    void ctsSharedStatsWriter::Update() const noexcept
+    {
+        const auto& settings = *ctsConfig::g_configSettings;
+        const bool isTcp = ctsConfig::ProtocolType::TCP == settings.Protocol;
+
+        // odd while writing: the interlocked increments are full barriers around the updates
+        InterlockedIncrement64(&m_stats->m_sequence);
+
+        m_stats->m_updateQpc = ctl::ctTimer::SnapQpc();
+        m_stats->m_startTimeMs = settings.StartTimeMilliseconds;
+        m_stats->m_updateTimeMs = ctl::ctTimer::SnapQpcInMillis();
+
+        m_stats->m_activeConnections = settings.ConnectionStatusDetails.m_activeConnectionCount.GetValue();
+        m_stats->m_peakActiveConnections = settings.ConnectionStatusDetails.m_peakActiveConnectionCount.GetValue();
+        m_stats->m_successfulConnections = settings.ConnectionStatusDetails.m_successfulCompletionCount.GetValue();
+        m_stats->m_connectionErrors = settings.ConnectionStatusDetails.m_connectionErrorCount.GetValue();
+        m_stats->m_protocolErrors = settings.ConnectionStatusDetails.m_protocolErrorCount.GetValue();
+
+        if (isTcp)
+        {
+            m_stats->m_bytesSent = settings.TcpStatusDetails.m_bytesSent.GetValue();
+            m_stats->m_bytesReceived = settings.TcpStatusDetails.m_bytesRecv.GetValue();
+            m_stats->m_transactions = settings.TcpStatusDetails.m_transactions.GetValue();
+            m_stats->m_rioCompletions = settings.TcpStatusDetails.m_rioCompletions.GetValue();
+        }
+        else
+        {
+            m_stats->m_bitsReceived = settings.UdpStatusDetails.m_bitsReceived.GetValue();
+            m_stats->m_successfulFrames = settings.UdpStatusDetails.m_successfulFrames.GetValue();
+            m_stats->m_droppedFrames = settings.UdpStatusDetails.m_droppedFrames.GetValue();
+            m_stats->m_duplicateFrames = settings.UdpStatusDetails.m_duplicateFrames.GetValue();
+            m_stats->m_errorFrames = settings.UdpStatusDetails.m_errorFrames.GetValue();
+        }
+
+        static_assert(ctsSharedStats::c_processorCount == ctsShardedStatsTracking::c_shardCount,
+            "the per-processor slots mirror the sharded statistics");
+        for (unsigned long processor = 0; processor < ctsSharedStats::c_processorCount; ++processor)
+        {
+            auto& processorStats = m_stats->m_processors[processor];
+            if (isTcp)
+            {
+                processorStats.m_bytesSent = settings.TcpStatusDetails.m_bytesSent.GetShardValue(processor);
+                processorStats.m_bytesReceived = settings.TcpStatusDetails.m_bytesRecv.GetShardValue(processor);
+            }
+            else
+            {
+                processorStats.m_bytesReceived = settings.UdpStatusDetails.m_bitsReceived.GetShardValue(processor) / 8;
+            }
+        }
+
+        InterlockedIncrement64(&m_stats->m_sequence);
+    }
+}
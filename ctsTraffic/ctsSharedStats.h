@@ -0,0 +1,154 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// cpp headers
+#include <cstring>
+// os headers
+#include <Windows.h>
+
+// ** NOTE ** should not include any local project cts headers - external samplers include this header directly
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsSharedStats
+    ///
+    /// The layout of the named shared-memory region written with -StatsSharedMemory:<name>
+    /// - ctsTraffic refreshes it in place every 100ms from the status statistics,
+    ///   so external samplers can read it at any rate without touching the process or its IO threads
+    /// - all counters are running totals since the start of the run: samplers take the difference between reads
+    /// - m_sequence is a seqlock: it is odd while ctsTraffic is updating the region
+    ///   readers should use ctsReadSharedStats to copy a consistent snapshot
+    /// - open with OpenFileMappingW(FILE_MAP_READ, FALSE, name) and MapViewOfFile(..., FILE_MAP_READ, ...)
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    struct ctsSharedStatsProcessor
+    {
+        // the totals recorded on this processor (TCP bytes, or MediaStream bytes received)
+        long long m_bytesSent;
+        long long m_bytesReceived;
+    };
+
+    struct ctsSharedStats
+    {
+        static constexpr unsigned long c_signature = 0x53535443; // "CTSS"
+        static constexpr unsigned long c_version = 1;
+        static constexpr unsigned long c_processorCount = 64;
+
+        unsigned long m_signature;
+        unsigned long m_version;
+        unsigned long m_size;
+        unsigned long m_processId;
+        volatile LONG64 m_sequence;
+
+        // QueryPerformanceCounter at the last update, and the QPF to convert it
+        long long m_updateQpc;
+        long long m_qpf;
+        // milliseconds (QPC-based) when the run started and when the region was last updated
+        long long m_startTimeMs;
+        long long m_updateTimeMs;
+
+        long long m_activeConnections;
+        long long m_peakActiveConnections;
+        long long m_successfulConnections;
+        long long m_connectionErrors;
+        long long m_protocolErrors;
+
+        // TCP
+        long long m_bytesSent;
+        long long m_bytesReceived;
+        long long m_transactions;
+        long long m_rioCompletions;
+
+        // UDP (MediaStream clients)
+        long long m_bitsReceived;
+        long long m_successfulFrames;
+        long long m_droppedFrames;
+        long long m_duplicateFrames;
+        long long m_errorFrames;
+
+        // indexed by the processor number (within the processor group) the IO completed on
+        ctsSharedStatsProcessor m_processors[c_processorCount];
+    };
+
+    //
+    // Copies a consistent snapshot of the shared region
+    // - returns false if the region is not a ctsSharedStats of this version,
+    //   or if the writer was updating it on every attempt
+    //
+    inline bool ctsReadSharedStats(_In_ const ctsSharedStats* shared, _Out_ ctsSharedStats* snapshot) noexcept
+    {
+        constexpr unsigned long c_maxAttempts = 100;
+
+        if (shared->m_signature != ctsSharedStats::c_signature ||
+            shared->m_version != ctsSharedStats::c_version ||
+            shared->m_size != sizeof(ctsSharedStats))
+        {
+            return false;
+        }
+
+        for (unsigned long attempt = 0; attempt < c_maxAttempts; ++attempt)
+        {
+            const LONG64 startSequence = ReadAcquire64(&shared->m_sequence);
+            if (startSequence & 1)
+            {
+                YieldProcessor();
+                continue;
+            }
+
+            memcpy(snapshot, const_cast<const ctsSharedStats*>(shared), sizeof(ctsSharedStats));
+            MemoryBarrier();
+
+            if (ReadAcquire64(&shared->m_sequence) == startSequence)
+            {
+                snapshot->m_sequence = startSequence;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsSharedStatsWriter
+    ///
+    /// Creates the named region and writes the ctsConfigSettings status statistics into it
+    /// - throws if the region cannot be created, or if another process already created it
+    /// - -Workers : a worker opens the region its front end created instead (openExisting)
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsSharedStatsWriter
+    {
+    public:
+        explicit ctsSharedStatsWriter(_In_z_ PCWSTR name, bool openExisting = false);
+        ~ctsSharedStatsWriter() noexcept;
+
+        // called from the status timer; must not be called concurrently
+        void Update() const noexcept;
+
+        ctsSharedStatsWriter(const ctsSharedStatsWriter&) = delete;
+        ctsSharedStatsWriter& operator=(const ctsSharedStatsWriter&) = delete;
+        ctsSharedStatsWriter(ctsSharedStatsWriter&&) = delete;
+        ctsSharedStatsWriter& operator=(ctsSharedStatsWriter&&) = delete;
+
+        static constexpr unsigned long c_updateFrequencyMilliseconds = 100UL;
+
+    private:
+        HANDLE m_mapping = nullptr;
+        ctsSharedStats* m_stats = nullptr;
+    };
+}
@@ -13,6 +13,9 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 // parent header
 #include "ctsSocket.h"
+// cpp headers
+#include <algorithm>
+#include <atomic>
 // OS headers
 #include <Windows.h>
 // ctl headers
@@ -20,9 +23,13 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // ctl headers
 #include <ctThreadPoolTimer.hpp>
 #include <ctMemoryGuard.hpp>
+#include <ctTimer.hpp>
 // project headers
 #include "ctsConfig.h"
+#include "ctsLocalPorts.h"
+#include "ctsSocketPool.h"
 #include "ctsSocketState.h"
+#include "ctsTimerWheel.h"
 #include "ctsWinsockLayer.h"
 
 namespace ctsTraffic
@@ -30,6 +37,25 @@ namespace ctsTraffic
     using namespace ctl;
     using namespace std;
 
+    // SIO_TCP_INFO is a synchronous query of the TCP control block - it never waits on the network
+    // - returns false if the query failed, printing the error unless the socket is being closed
+    static bool QueryTcpInfo(SOCKET socket, TCP_INFO_v0& tcpInfo) noexcept
+    {
+        DWORD tcpInfoVersion = 0;
+        DWORD bytesReturned{};
+        if (0 != WSAIoctl(socket, SIO_TCP_INFO, &tcpInfoVersion, sizeof tcpInfoVersion, &tcpInfo, sizeof tcpInfo, &bytesReturned, nullptr, nullptr))
+        {
+            const auto gle = WSAGetLastError();
+            if (gle != WSAENOTSOCK && gle != WSAEINTR)
+            {
+                // not-a-socket is expected if the socket is closed while sampling
+                ctsConfig::PrintErrorIfFailed("WSAIoctl(SIO_TCP_INFO)", gle);
+            }
+            return false;
+        }
+        return true;
+    }
+
     // default values are assigned in the class declaration
     ctsSocket::ctsSocket(weak_ptr<ctsSocketState> parent) noexcept : m_parent(move(parent))
     {
@@ -79,6 +105,27 @@ namespace ctsTraffic
         m_socket.reset(socket);
     }
 
+    void ctsSocket::SetRecyclable(const ctSockaddr& address, shared_ptr<ctThreadIocp> tpIocp) noexcept
+    {
+        const auto lock = m_lock.lock();
+
+        m_recycleSockaddr = address;
+        m_recyclable = true;
+        if (tpIocp)
+        {
+            // a recycled socket can't be associated with another completion port
+            m_tpIocp = std::move(tpIocp);
+        }
+    }
+
+    void ctsSocket::SetIocpThreadpool(shared_ptr<ctThreadIocp> tpIocp) noexcept
+    {
+        const auto lock = m_lock.lock();
+
+        // a socket can't be associated with another completion port
+        m_tpIocp = std::move(tpIocp);
+    }
+
     int ctsSocket::CloseSocket(int errorCode) noexcept
     {
         const auto lock = m_lock.lock();
@@ -86,6 +133,15 @@ namespace ctsTraffic
         int error = 0;
         if (m_socket)
         {
+            // only a socket with no IO left outstanding can be disconnected for reuse
+            if (0 == errorCode && m_recyclable && 0 == ctMemoryGuardRead(&m_ioCount) &&
+                ctsSocketPool::Recycle(m_socket.get(), m_tpIocp, m_recycleSockaddr))
+            {
+                // the pool now owns the socket
+                m_socket.release();
+                return error;
+            }
+
             if (errorCode != 0)
             {
                 // always try to RST if we are closing due to an error
@@ -94,6 +150,8 @@ namespace ctsTraffic
                 error = result.m_errorCode;
             }
             m_socket.reset();
+            // a reset connection doesn't enter TIME_WAIT
+            ctsLocalPorts::Release(m_localSockaddr.port(), 0 == errorCode);
         }
         return error;
     }
@@ -105,7 +163,7 @@ namespace ctsTraffic
         // must verify a valid socket first to avoid racing destrying the iocp shared_ptr as we try to create it here
         if (m_socket && !m_tpIocp)
         {
-            m_tpIocp = make_shared<ctThreadIocp>(m_socket.get(), ctsConfig::g_configSettings->pTpEnvironment); // can throw
+            m_tpIocp = ctsConfig::CreateSocketThreadIocp(m_socket.get()); // can throw
         }
         return m_tpIocp;
     }
@@ -127,6 +185,33 @@ namespace ctsTraffic
         }
     }
 
+    void ctsSocket::AccountMemory() const noexcept
+    {
+        auto& memoryDetails = ctsConfig::g_configSettings->ConnectionMemoryDetails;
+
+        constexpr auto timerBytes =
+            sizeof m_timerEntry +
+            sizeof m_highResolutionTimer +
+            sizeof m_tpHighResolutionWait +
+            sizeof m_timerTask +
+            sizeof m_timerCallback +
+            sizeof m_tcpInfoTimer +
+            sizeof m_bufferSizingTimer;
+        memoryDetails.m_socketBytes.Add(static_cast<long long>(sizeof(ctsSocket) - timerBytes));
+        memoryDetails.m_timerBytes.Add(static_cast<long long>(timerBytes));
+
+        const auto lock = m_lock.lock();
+        if (m_tpIocp)
+        {
+            memoryDetails.m_threadIocpBytes.Add(static_cast<long long>(sizeof(ctl::ctThreadIocp)));
+        }
+        if (m_pattern)
+        {
+            m_pattern->AccountMemory(memoryDetails);
+        }
+        memoryDetails.m_accountedConnections.Increment();
+    }
+
     void ctsSocket::CompleteState(DWORD errorCode) noexcept
     {
         const auto currentIoCount = ctMemoryGuardRead(&m_ioCount);
@@ -134,14 +219,19 @@ namespace ctsTraffic
             currentIoCount != 0,
             "ctsSocket::complete_state is called with outstanding IO (%d)", currentIoCount);
 
+        // declared first so it's destroyed last : this can be the final reference to this object
+        std::shared_ptr<ctsSocket> ioReference;
         DWORD recordedError = errorCode;
-        if (m_pattern)
         {
             const auto lock = m_lock.lock();
-            // get the pattern's last_error
-            recordedError = m_pattern->GetLastPatternError();
-            // no longer allow any more callbacks
-            m_pattern->RegisterCallback(nullptr);
+            ioReference = std::move(m_ioReference);
+            if (m_pattern)
+            {
+                // get the pattern's last_error
+                recordedError = m_pattern->GetLastPatternError();
+                // no longer allow any more callbacks
+                m_pattern->RegisterCallback(nullptr);
+            }
         }
 
         auto refParent(m_parent.lock());
@@ -151,6 +241,12 @@ namespace ctsTraffic
         }
     }
 
+    void ctsSocket::HoldIoReference() noexcept
+    {
+        const auto lock = m_lock.lock();
+        m_ioReference = shared_from_this();
+    }
+
     const ctSockaddr& ctsSocket::GetLocalSockaddr() const noexcept
     {
         return m_localSockaddr;
@@ -171,9 +267,57 @@ namespace ctsTraffic
         m_targetSockaddr = targetAddress;
     }
 
+    bool ctsSocket::IsProbe() const noexcept
+    {
+        if (0 == ctsConfig::g_configSettings->ProbeConnections)
+        {
+            return false;
+        }
+        if (ctsConfig::IsListening())
+        {
+            return m_localSockaddr.port() == ctsConfig::g_configSettings->ProbePort;
+        }
+        const auto parent = m_parent.lock();
+        return parent && parent->IsProbe();
+    }
+
+    const char* ctsSocket::GenerateConnectDataId()
+    {
+        ctsStatistics::GenerateConnectionId(m_connectData);
+        m_hasConnectDataId = true;
+        return m_connectData.m_connectionIdentifier;
+    }
+
+    void ctsSocket::SetConnectDataId(_In_reads_(ctsStatistics::c_connectionIdLength) const char* connectionId) noexcept
+    {
+        memcpy_s(m_connectData.m_connectionIdentifier, ctsStatistics::c_connectionIdLength, connectionId, ctsStatistics::c_connectionIdLength);
+        // the ID is carried as a string : guarantee it's terminated whatever the peer sent
+        m_connectData.m_connectionIdentifier[ctsStatistics::c_connectionIdLength - 1] = '\0';
+        m_hasConnectDataId = true;
+    }
+
+    const char* ctsSocket::GenerateMultiplexedStreamId()
+    {
+        ctsStatistics::GenerateConnectionId(m_multiplexedStream);
+        m_hasMultiplexedStreamId = true;
+        return m_multiplexedStream.m_connectionIdentifier;
+    }
+
+    void ctsSocket::SetMultiplexedStreamId(_In_reads_(ctsStatistics::c_connectionIdLength) const char* streamId) noexcept
+    {
+        memcpy_s(m_multiplexedStream.m_connectionIdentifier, ctsStatistics::c_connectionIdLength, streamId, ctsStatistics::c_connectionIdLength);
+        m_multiplexedStream.m_connectionIdentifier[ctsStatistics::c_connectionIdLength - 1] = '\0';
+        m_hasMultiplexedStreamId = true;
+    }
+
+    const char* ctsSocket::GetMultiplexedStreamId() const noexcept
+    {
+        return m_hasMultiplexedStreamId ? m_multiplexedStream.m_connectionIdentifier : nullptr;
+    }
+
     void ctsSocket::SetIoPattern() noexcept
     {
-        m_pattern = ctsIoPattern::MakeIoPattern();
+        m_pattern = IsProbe() ? ctsIoPattern::MakeProbePattern() : ctsIoPattern::MakeIoPattern();
         if (!m_pattern)
         {
             // in test scenarios
@@ -181,6 +325,12 @@ namespace ctsTraffic
         }
 
         m_pattern->SetParent(shared_from_this());
+        m_pattern->SetTargetStatistics(ctsConfig::GetTargetStatistics(m_targetSockaddr));
+        m_pattern->SetConnectInitiatedQpc(m_connectInitiatedQpc);
+        if (m_hasConnectDataId)
+        {
+            m_pattern->SetExchangedConnectionId(m_connectData.m_connectionIdentifier);
+        }
 
         if (ctsConfig::g_configSettings->PrePostSends == 0)
         {
@@ -188,6 +338,16 @@ namespace ctsTraffic
             // start ISB notifications (best effort)
             InitiateIsbNotification();
         }
+
+        if (ctsConfig::g_configSettings->TcpInfoIntervalMilliseconds > 0)
+        {
+            InitiateTcpInfoSampling();
+        }
+
+        if (ctsConfig::g_configSettings->AutoRecvBuf || ctsConfig::g_configSettings->AutoSendBuf)
+        {
+            InitiateBufferSizing();
+        }
     }
 
     void ctsSocket::InitiateIsbNotification() noexcept
@@ -235,7 +395,7 @@ namespace ctsTraffic
                 {
                     const auto lock = lambdaSharedThis->m_lock.lock();
                     PRINT_DEBUG_INFO(L"\t\tctsSocket::process_isb_notification : setting ISB to %u bytes\n", isb);
-                    lambdaSharedThis->m_pattern->SetIdealSendBacklog(isb);
+                    lambdaSharedThis->m_pattern->SetIdealSendBacklog(max(isb, lambdaSharedThis->m_bufferSizingSendBacklog));
                 }
                 else
                 {
@@ -280,6 +440,158 @@ namespace ctsTraffic
         ctsConfig::PrintThrownException();
     }
 
+    void ctsSocket::InitiateTcpInfoSampling() noexcept
+    {
+        const auto lock = m_lock.lock();
+        if (!m_tcpInfoTimer)
+        {
+            m_tcpInfoTimer.reset(CreateThreadpoolTimer(TcpInfoTimerCallback, this, ctsConfig::g_configSettings->pTpEnvironment));
+            if (!m_tcpInfoTimer)
+            {
+                // best effort - the connection is still valid without the samples
+                ctsConfig::PrintErrorIfFailed("CreateThreadpoolTimer (SIO_TCP_INFO)", GetLastError());
+                return;
+            }
+        }
+
+        const auto interval = ctsConfig::g_configSettings->TcpInfoIntervalMilliseconds;
+        FILETIME relativeTimeout = wil::filetime::from_int64(-1 * wil::filetime_duration::one_millisecond * interval);
+        SetThreadpoolTimer(m_tcpInfoTimer.get(), &relativeTimeout, interval, 0);
+    }
+
+    //
+    // the socket lock is only held for the SIO_TCP_INFO query, and the sample is folded into the pattern's statistics
+    // under that same lock (which also guards printing the connection results)
+    //
+    void NTAPI ctsSocket::TcpInfoTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER) noexcept
+    {
+        const auto* pThis = static_cast<ctsSocket*>(pContext);
+        const auto lockedSocket(pThis->AcquireSocketLock());
+        const auto socket = lockedSocket.GetSocket();
+        if (INVALID_SOCKET == socket)
+        {
+            return;
+        }
+
+        TCP_INFO_v0 tcpInfo{};
+        if (!QueryTcpInfo(socket, tcpInfo))
+        {
+            return;
+        }
+
+        if (pThis->m_pattern)
+        {
+            pThis->m_pattern->AddTcpInfoSample(tcpInfo);
+        }
+    }
+
+    //
+    // -RecvBufValue:auto, -SendBufValue:auto : the bytes SIO_TCP_INFO has counted as IO starts are the baseline
+    // BufferSizingTimerCallback measures the throughput from, once c_bufferSizingWindowMilliseconds have elapsed
+    //
+    void ctsSocket::InitiateBufferSizing() noexcept
+    {
+        const auto lockedSocket(AcquireSocketLock());
+        const auto socket = lockedSocket.GetSocket();
+        if (INVALID_SOCKET == socket)
+        {
+            return;
+        }
+
+        TCP_INFO_v0 tcpInfo{};
+        if (!QueryTcpInfo(socket, tcpInfo))
+        {
+            // best effort - the connection keeps its default buffers
+            return;
+        }
+        m_bufferSizingBaselineBytesIn = tcpInfo.BytesIn;
+        m_bufferSizingBaselineBytesOut = tcpInfo.BytesOut;
+        m_bufferSizingBaselineMilliseconds = ctTimer::SnapQpcInMillis();
+
+        if (!m_bufferSizingTimer)
+        {
+            m_bufferSizingTimer.reset(CreateThreadpoolTimer(BufferSizingTimerCallback, this, ctsConfig::g_configSettings->pTpEnvironment));
+            if (!m_bufferSizingTimer)
+            {
+                ctsConfig::PrintErrorIfFailed("CreateThreadpoolTimer (-RecvBufValue:auto, -SendBufValue:auto)", GetLastError());
+                return;
+            }
+        }
+
+        FILETIME relativeTimeout = wil::filetime::from_int64(-1 * wil::filetime_duration::one_millisecond * c_bufferSizingWindowMilliseconds);
+        SetThreadpoolTimer(m_bufferSizingTimer.get(), &relativeTimeout, 0, 0);
+    }
+
+    //
+    // the BDP is the larger of the bytes delivered (in whichever direction moved more) per RTT,
+    // and the cwnd : the delivery rate underestimates it while the window is still opening
+    // - SO_RCVBUF and SO_SNDBUF are set to twice the BDP, leaving the window room to grow past what was measured
+    // - with -SendBufValue:auto the bytes of sends the pattern keeps in flight are raised to cover the BDP
+    //   (the number of recvs kept posted is fixed when the pattern creates its buffers)
+    //
+    void NTAPI ctsSocket::BufferSizingTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER) noexcept
+    {
+        auto* pThis = static_cast<ctsSocket*>(pContext);
+        const auto lockedSocket(pThis->AcquireSocketLock());
+        const auto socket = lockedSocket.GetSocket();
+        if (INVALID_SOCKET == socket || !pThis->m_pattern)
+        {
+            return;
+        }
+
+        TCP_INFO_v0 tcpInfo{};
+        if (!QueryTcpInfo(socket, tcpInfo))
+        {
+            return;
+        }
+
+        const auto elapsedMilliseconds = ctTimer::SnapQpcInMillis() - pThis->m_bufferSizingBaselineMilliseconds;
+        const auto deliveredBytes = max(
+            tcpInfo.BytesIn - pThis->m_bufferSizingBaselineBytesIn,
+            tcpInfo.BytesOut - pThis->m_bufferSizingBaselineBytesOut);
+
+        ctsBufferSizing bufferSizing;
+        bufferSizing.m_rttMicroseconds = tcpInfo.RttUs;
+        bufferSizing.m_bytesPerSecond = elapsedMilliseconds > 0 ? deliveredBytes * 1000ULL / static_cast<unsigned long long>(elapsedMilliseconds) : 0ULL;
+        const auto bdpBytes = max(
+            bufferSizing.m_bytesPerSecond * tcpInfo.RttUs / 1000000ULL,
+            static_cast<unsigned long long>(tcpInfo.Cwnd));
+        bufferSizing.m_bdpBytes = static_cast<unsigned long>(min<unsigned long long>(bdpBytes, c_maximumBufferSizingBytes));
+        const auto bufferBytes = static_cast<unsigned long>(
+            clamp<unsigned long long>(bdpBytes * 2ULL, c_minimumBufferSizingBytes, c_maximumBufferSizingBytes));
+
+        const int bufferValue = static_cast<int>(bufferBytes);
+        if (ctsConfig::g_configSettings->AutoRecvBuf)
+        {
+            if (0 != setsockopt(socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferValue), static_cast<int>(sizeof bufferValue)))
+            {
+                ctsConfig::PrintErrorIfFailed("setsockopt(SO_RCVBUF)", WSAGetLastError());
+            }
+            else
+            {
+                bufferSizing.m_recvBufBytes = bufferBytes;
+            }
+        }
+        if (ctsConfig::g_configSettings->AutoSendBuf)
+        {
+            if (0 != setsockopt(socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bufferValue), static_cast<int>(sizeof bufferValue)))
+            {
+                ctsConfig::PrintErrorIfFailed("setsockopt(SO_SNDBUF)", WSAGetLastError());
+            }
+            else
+            {
+                bufferSizing.m_sendBufBytes = bufferBytes;
+                pThis->m_bufferSizingSendBacklog = max(bufferSizing.m_bdpBytes, c_minimumBufferSizingBytes);
+                pThis->m_pattern->SetIdealSendBacklog(pThis->m_bufferSizingSendBacklog);
+            }
+        }
+
+        PRINT_DEBUG_INFO(
+            L"\t\tctsSocket::BufferSizingTimerCallback : RTT %lu us, %llu bytes/sec, BDP %lu bytes : sizing buffers to %lu bytes\n",
+            bufferSizing.m_rttMicroseconds, bufferSizing.m_bytesPerSecond, bufferSizing.m_bdpBytes, bufferBytes);
+        pThis->m_pattern->SetBufferSizing(bufferSizing);
+    }
+
     long ctsSocket::IncrementIo() noexcept
     {
         return ctMemoryGuardIncrement(&m_ioCount);
@@ -301,6 +613,8 @@ namespace ctsTraffic
 
     void ctsSocket::Shutdown() noexcept
     {
+        // declared first so it's destroyed last : this can be the final reference to this object
+        std::shared_ptr<ctsSocket> ioReference;
         // close the socket to trigger IO to complete/shutdown
         CloseSocket();
         // Must destroy these threadpool objects outside the CS to prevent a deadlock
@@ -310,7 +624,27 @@ namespace ctsTraffic
         //   to this ctsSocket might be from a TP thread - in which case this d'tor will deadlock
         //   (it will wait for all TP threads to exit, but it is using/blocking on of those TP threads)
         m_tpIocp.reset();
-        m_tpTimer.reset();
+        // waits if the timer is being dispatched on its wheel's thread
+        ctsTimerWheel::Cancel(m_timerEntry);
+        // the wait must stop before the waitable timer it waits on is closed
+        m_tpHighResolutionWait.reset();
+        m_highResolutionTimer.reset();
+        m_tcpInfoTimer.reset();
+        m_bufferSizingTimer.reset();
+        // the HoldIoReference reference is not released just because the socket is closed : IO completions
+        // - (and RIO completions dequeued later) can still be pending, and they refer to this object by raw pointer
+        // - the last of them to complete calls CompleteState, which releases it
+        // a task still scheduled once its timers are cancelled will never run though
+        // - ctsSendRecvIocp counted an IO for it : release that count, and the reference when it was the last IO
+        const auto lock = m_lock.lock();
+        if (m_timerCallback && m_ioReference)
+        {
+            m_timerCallback = nullptr;
+            if (0 == DecrementIo())
+            {
+                ioReference = std::move(m_ioReference);
+            }
+        }
     }
 
     ///
@@ -324,29 +658,83 @@ namespace ctsTraffic
         m_timerTask = task;
         m_timerCallback = std::move(func);
 
-        if (!m_tpTimer)
+        // threadpool timers expire on the system timer tick (~1ms at best)
+        // - paced sends need their sub-millisecond delays to avoid bursting
+        if (task.m_timeOffsetMicroseconds > 0 && SetHighResolutionTimer(task.m_timeOffsetMicroseconds))
         {
-            m_tpTimer.reset(CreateThreadpoolTimer(ThreadPoolTimerCallback, this, ctsConfig::g_configSettings->pTpEnvironment));
-            THROW_LAST_ERROR_IF(!m_tpTimer);
+            return;
         }
 
-        FILETIME relativeTimeout = wil::filetime::from_int64(-1 * wil::filetime_duration::one_millisecond * task.m_timeOffsetMilliseconds);
-        SetThreadpoolTimer(m_tpTimer.get(), &relativeTimeout, 0, 0);
+        // every socket's delayed IO shares the per-processor timer wheels
+        // - all the timers expiring in the same 1 ms tick are dispatched as one batch from the wheel's thread,
+        //   instead of arming and firing a threadpool timer per socket
+        ctsTimerWheel::Schedule(m_timerEntry, task.m_timeOffsetMilliseconds);
     }
 
-    void NTAPI ctsSocket::ThreadPoolTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER)
+    ///
+    /// requires m_lock to be held
+    ///
+    bool ctsSocket::SetHighResolutionTimer(long long microseconds)
     {
-        auto* pThis = static_cast<ctsSocket*>(pContext);
+        // set once if CreateWaitableTimerExW doesn't support CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+        static std::atomic<bool> s_highResolutionTimersUnsupported{false};
+        if (s_highResolutionTimersUnsupported)
+        {
+            return false;
+        }
 
+        if (!m_highResolutionTimer)
+        {
+            m_highResolutionTimer.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+            if (!m_highResolutionTimer)
+            {
+                const auto gle = GetLastError();
+                if (ERROR_INVALID_PARAMETER == gle)
+                {
+                    s_highResolutionTimersUnsupported = true;
+                    return false;
+                }
+                THROW_WIN32_MSG(gle, "CreateWaitableTimerExW(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)");
+            }
+
+            m_tpHighResolutionWait.reset(CreateThreadpoolWait(HighResolutionTimerCallback, this, ctsConfig::g_configSettings->pTpEnvironment));
+            if (!m_tpHighResolutionWait)
+            {
+                const auto gle = GetLastError();
+                m_highResolutionTimer.reset();
+                THROW_WIN32_MSG(gle, "CreateThreadpoolWait");
+            }
+        }
+
+        // negative == relative, in 100ns units
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -10LL * microseconds;
+        THROW_IF_WIN32_BOOL_FALSE(SetWaitableTimer(m_highResolutionTimer.get(), &dueTime, 0, nullptr, nullptr, FALSE));
+        SetThreadpoolWait(m_tpHighResolutionWait.get(), m_highResolutionTimer.get(), nullptr);
+        return true;
+    }
+
+    void ctsSocket::TimerWheelCallback(PVOID pContext) noexcept
+    {
+        static_cast<ctsSocket*>(pContext)->InvokeTimerCallback();
+    }
+
+    void NTAPI ctsSocket::HighResolutionTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_WAIT, TP_WAIT_RESULT)
+    {
+        static_cast<ctsSocket*>(pContext)->InvokeTimerCallback();
+    }
+
+    void ctsSocket::InvokeTimerCallback()
+    {
         ctsTask task{};
         function<void(weak_ptr<ctsSocket>, const ctsTask&)> callback;
         {
-            const auto lock = pThis->m_lock.lock();
-            task = pThis->m_timerTask;
-            callback = std::move(pThis->m_timerCallback);
+            const auto lock = m_lock.lock();
+            task = m_timerTask;
+            callback = std::move(m_timerCallback);
         }
 
         // invoke the callback outside the lock
-        callback(pThis->weak_from_this(), task);
+        callback(weak_from_this(), task);
     }
 } // namespace
@@ -29,6 +29,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // project headers
 #include "ctsIOPattern.h"
 #include "ctsIOTask.hpp"
+#include "ctsTimerWheel.h"
 
 namespace ctsTraffic
 {
@@ -60,19 +61,25 @@ namespace ctsTraffic
             }
             [[nodiscard]] std::shared_ptr<ctsIoPattern> GetPattern() const noexcept
             {
-                return m_patternWeakRef.lock();
+                return m_pattern;
+            }
+            // the pattern is only deleted in the ctsSocket d'tor : the pointer is valid as long as the caller keeps the ctsSocket alive
+            // - avoids the refcount traffic of GetPattern for callers which don't keep the pattern beyond this SocketReference
+            [[nodiscard]] ctsIoPattern* GetPatternPointer() const noexcept
+            {
+                return m_pattern.get();
             }
 
         private:
             friend class ctsSocket;
-            SocketReference(wil::cs_leave_scope_exit&& socketLock, SOCKET socket, std::weak_ptr<ctsIoPattern> patternWeakRef) noexcept :
-                m_socketLock(std::move(socketLock)), m_socket(socket), m_patternWeakRef(std::move(patternWeakRef))
+            SocketReference(wil::cs_leave_scope_exit&& socketLock, SOCKET socket, const std::shared_ptr<ctsIoPattern>& pattern) noexcept :
+                m_socketLock(std::move(socketLock)), m_socket(socket), m_pattern(pattern)
             {
             }
 
             const wil::cs_leave_scope_exit m_socketLock;
             const SOCKET m_socket = INVALID_SOCKET;
-            const std::weak_ptr<ctsIoPattern> m_patternWeakRef;
+            const std::shared_ptr<ctsIoPattern>& m_pattern;
         };
 
         [[nodiscard]] SocketReference AcquireSocketLock() const noexcept;
@@ -96,6 +103,20 @@ namespace ctsTraffic
         //
         void SetSocket(SOCKET socket) noexcept;
 
+        //
+        // -SocketReuse:on : the socket is recycled through ctsSocketPool when it closes without error
+        // - address is the pool's key : the address the socket was bound to (clients) or accepted on (servers)
+        // - tpIocp is the ctThreadIocp a recycled socket is already associated with (null for a new socket)
+        // Must be called after SetSocket
+        //
+        void SetRecyclable(const ctl::ctSockaddr& address, std::shared_ptr<ctl::ctThreadIocp> tpIocp) noexcept;
+
+        //
+        // -PrecreateSockets : the ctThreadIocp a pre-created socket was associated with before the run started
+        // Must be called after SetSocket
+        //
+        void SetIocpThreadpool(std::shared_ptr<ctl::ctThreadIocp> tpIocp) noexcept;
+
         //
         // Safely closes the encapsulated socket 
         // - this is not necessary nor recommended for typical usage patterns
@@ -123,6 +144,15 @@ namespace ctsTraffic
         //
         void CompleteState(DWORD errorCode) noexcept;
 
+        //
+        // Keeps this ctsSocket alive until CompleteState is called
+        // - IO functions can then refer to this ctsSocket by raw pointer from their IO callbacks
+        //   as every pended IO holds an IO count, and CompleteState is only called once the IO count falls to zero
+        // - CompleteState releases this reference as its last step : callers must not touch this ctsSocket after calling it
+        //   (nor hold the SocketReference while calling it)
+        //
+        void HoldIoReference() noexcept;
+
         //
         // Gets/Sets the local address of the SOCKET
         //
@@ -135,11 +165,45 @@ namespace ctsTraffic
         const ctl::ctSockaddr& GetRemoteSockaddr() const noexcept;
         void SetRemoteSockaddr(const ctl::ctSockaddr& targetAddress) noexcept;
 
+        //
+        // -Probes : true for connections exchanging probe pings instead of running the bulk IO pattern
+        // - clients are told by their ctsSocketState, servers by the -ProbePort the connection was accepted on
+        //
+        bool IsProbe() const noexcept;
+
         //
         // Get/Set the ctsIOPattern
         //
         void SetIoPattern() noexcept;
 
+        //
+        // -ConnectData:on : the connection ID exchanged while the connection is established
+        // - clients generate it to send with ConnectEx (can throw wil::ResultException)
+        // - servers store the ID received with AcceptEx
+        // - applied to the ctsIOPattern when it's created, which then skips its own connection ID exchange
+        //
+        const char* GenerateConnectDataId();
+        void SetConnectDataId(_In_reads_(ctsStatistics::c_connectionIdLength) const char* connectionId) noexcept;
+
+        //
+        // The QPC when ConnectEx was posted : the ctsIOPattern records the latency to the first bytes it receives from it
+        // - zero when not tracking latency
+        //
+        void SetConnectInitiatedQpc(long long connectInitiatedQpc) noexcept
+        {
+            m_connectInitiatedQpc = connectInitiatedQpc;
+        }
+
+        //
+        // -MultiplexStreams:on : the ID demultiplexing this stream's datagrams over a UDP socket shared with other streams
+        // - clients generate it to send with START (can throw wil::ResultException)
+        // - servers store the ID received with START
+        // - returns nullptr if this stream is not multiplexed
+        //
+        const char* GenerateMultiplexedStreamId();
+        void SetMultiplexedStreamId(_In_reads_(ctsStatistics::c_connectionIdLength) const char* streamId) noexcept;
+        [[nodiscard]] const char* GetMultiplexedStreamId() const noexcept;
+
         //
         // methods for functors to use for refcounting the # of IO they have issued on this socket
         //
@@ -153,6 +217,12 @@ namespace ctsTraffic
         //
         void PrintPatternResults(unsigned long lastError) const noexcept;
 
+        //
+        // -MemoryAccounting : adds the memory this socket and its ctsIOPattern hold to ctsConfig::ConnectionMemoryDetails
+        // - must be called before CloseSocket, which can hand the ctThreadIocp to the socket pool
+        //
+        void AccountMemory() const noexcept;
+
         //
         // Function to register a task for completion at the future point in time referenced
         // - by ctsIOTask::time_offset_milliseconds
@@ -182,6 +252,14 @@ namespace ctsTraffic
         }
 
         void InitiateIsbNotification()  noexcept;
+        void InitiateTcpInfoSampling() noexcept;
+        void InitiateBufferSizing() noexcept;
+
+        // -RecvBufValue:auto, -SendBufValue:auto : the BDP is measured over this much IO,
+        // the buffers sized from it bounded to these sizes
+        static constexpr unsigned long c_bufferSizingWindowMilliseconds = 200UL;
+        static constexpr unsigned long c_minimumBufferSizingBytes = 64UL * 1024UL;
+        static constexpr unsigned long c_maximumBufferSizingBytes = 16UL * 1024UL * 1024UL;
 
         // private members for this socket instance
         // mutable is requred to EnterCS/LeaveCS in const methods
@@ -194,16 +272,57 @@ namespace ctsTraffic
         std::weak_ptr<ctsSocketState> m_parent;
         // maintain a shared_ptr to the pattern
         std::shared_ptr<ctsIoPattern> m_pattern;
+        // HoldIoReference : the reference IO functions keep on this object while their IO is in flight
+        _Guarded_by_(m_lock) std::shared_ptr<ctsSocket> m_ioReference;
 
         /// only guarded when returning to the caller
         std::shared_ptr<ctl::ctThreadIocp> m_tpIocp;
-        wil::unique_threadpool_timer m_tpTimer;
+        // SetTimer schedules delayed IO on the process-wide ctsTimerWheel
+        ctsTimerWheelEntry m_timerEntry{TimerWheelCallback, this};
+        // -RateLimitPacing:on : sub-millisecond delays wait on a high-resolution waitable timer through a threadpool wait
+        wil::unique_handle m_highResolutionTimer;
+        wil::unique_threadpool_wait m_tpHighResolutionWait;
         ctsTask m_timerTask{};
         std::function<void(std::weak_ptr<ctsSocket>, const ctsTask&)> m_timerCallback;
+        // periodic timer sampling SIO_TCP_INFO with -TcpInfo
+        wil::unique_threadpool_timer m_tcpInfoTimer;
+        // one-shot timer measuring the BDP with -RecvBufValue:auto or -SendBufValue:auto
+        // - from the bytes SIO_TCP_INFO had counted, and the time, when IO started
+        wil::unique_threadpool_timer m_bufferSizingTimer;
+        unsigned long long m_bufferSizingBaselineBytesIn = 0ULL;
+        unsigned long long m_bufferSizingBaselineBytesOut = 0ULL;
+        long long m_bufferSizingBaselineMilliseconds = 0LL;
+        // -SendBufValue:auto : the bytes of sends kept in flight sized from the BDP - ISB notifications can only raise it
+        _Guarded_by_(m_lock) unsigned long m_bufferSizingSendBacklog = 0UL;
 
         ctl::ctSockaddr m_localSockaddr;
         ctl::ctSockaddr m_targetSockaddr;
+        // -SocketReuse : the ctsSocketPool key, set when the socket is recyclable
+        ctl::ctSockaddr m_recycleSockaddr;
+        bool m_recyclable = false;
+
+        // the ConnectEx send buffer must remain valid until the connect completes
+        struct ConnectData
+        {
+            char m_connectionIdentifier[ctsStatistics::c_connectionIdLength]{};
+        } m_connectData;
+        bool m_hasConnectDataId = false;
+        long long m_connectInitiatedQpc = 0LL;
 
-        static void NTAPI ThreadPoolTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER);
+        // kept apart from m_connectData : the MediaStream patterns exchange their own connection ID
+        struct MultiplexedStream
+        {
+            char m_connectionIdentifier[ctsStatistics::c_connectionIdLength]{};
+        } m_multiplexedStream;
+        bool m_hasMultiplexedStreamId = false;
+
+        static void TimerWheelCallback(PVOID pContext) noexcept;
+        static void NTAPI HighResolutionTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_WAIT, TP_WAIT_RESULT);
+        // invokes the callback set by SetTimer - from either timer callback
+        void InvokeTimerCallback();
+        // returns false if high-resolution timers aren't supported (before Windows 10 1803) : the caller falls back to the timer wheel
+        bool SetHighResolutionTimer(long long microseconds);
+        static void NTAPI TcpInfoTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER) noexcept;
+        static void NTAPI BufferSizingTimerCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_TIMER) noexcept;
     };
 } // namespace
@@ -14,6 +14,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // parent header
 #include "ctsSocketBroker.h"
 // cpp headers
+#include <algorithm>
 #include <memory>
 #include <iterator>
 // os headers
@@ -26,6 +27,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // project headers
 #include "ctsConfig.h"
 #include "ctsSocketState.h"
+#include "ctsTraceLogging.h"
 
 namespace ctsTraffic
 {
@@ -38,6 +40,15 @@ namespace ctsTraffic
     // - create new sockets
     unsigned long ctsSocketBroker::m_timerCallbackTimeoutMs = 333; // millseconds
 
+    // -ThrottleConnections:auto
+    // - the pended connection attempts start small and are adjusted once per control period
+    constexpr unsigned long c_adaptiveThrottleInitialLimit = 8UL;
+    constexpr ULONGLONG c_adaptiveThrottlePeriodMs = 1000ULL;
+    // backing off when more than 1% of the connection attempts failed within the period
+    // - or when the connect latency grew to more than twice the lowest seen
+    constexpr double c_adaptiveThrottleMaxFailureRatio = 0.01;
+    constexpr double c_adaptiveThrottleMaxLatencyRatio = 2.0;
+
     ctsSocketBroker::ctsSocketBroker()
     {
         if (ctsConfig::g_configSettings->AcceptFunction)
@@ -59,6 +70,10 @@ namespace ctsTraffic
                 m_totalConnectionsRemaining = ctsConfig::g_configSettings->Iterations * static_cast<ULONGLONG>(ctsConfig::g_configSettings->ConnectionLimit);
             }
             m_pendingLimit = ctsConfig::g_configSettings->ConnectionLimit;
+            m_connectionTarget = ctsConfig::g_configSettings->ConnectionLimit;
+            m_connectionThrottleLimit = ctsConfig::g_configSettings->AdaptiveConnectionThrottle ?
+                std::min<unsigned long>(c_adaptiveThrottleInitialLimit, ctsConfig::g_configSettings->ConnectionLimit) :
+                ctsConfig::g_configSettings->ConnectionThrottleLimit;
         }
 
         // make sure pending_limit cannot be larger than total_connections_remaining
@@ -69,17 +84,23 @@ namespace ctsTraffic
 
         // create our manual-reset notification event
         m_doneEvent.create(wil::EventOptions::ManualReset, nullptr);
+
+        m_refillWork.reset(CreateThreadpoolWork(RefillWorker, this, ctsConfig::g_configSettings->pTpEnvironment));
+        THROW_LAST_ERROR_IF_NULL(m_refillWork.get());
     }
 
     ctsSocketBroker::~ctsSocketBroker() noexcept
     {
-        // first, turn off the timer to stop creating/tearing down the socket pool
+        // first, turn off the timer and the refill work to stop creating/tearing down the socket pool
         m_wakeupTimer.stop_all_timers();
+        m_refillWork.reset();
 
         // now delete all children, guaranteeing they stop processing
         // - must do this explicitly before deleting the CS
         //   in case they were calling back while we called detach
+        m_probeSockets.clear();
         m_socketPool.clear();
+        m_recycledSockets.clear();
     }
 
     void ctsSocketBroker::Start()
@@ -91,6 +112,11 @@ namespace ctsTraffic
         // must always guard access to the vector
         const auto lock = m_lock.lock();
 
+        if (ctsConfig::g_configSettings->LoadProfile)
+        {
+            m_connectionTarget = ctsConfig::UpdateLoadProfile().m_connections;
+        }
+
         // only loop to pending_limit
         while (m_totalConnectionsRemaining > 0 && m_pendingSockets < m_pendingLimit)
         {
@@ -98,17 +124,28 @@ namespace ctsTraffic
             // - to prevent killing the box with DPCs with too many concurrent connect attempts
             // checking first since TimerCallback might have already established connections
             if (!ctsConfig::g_configSettings->AcceptFunction &&
-                m_pendingSockets >= ctsConfig::g_configSettings->ConnectionThrottleLimit)
+                (m_pendingSockets >= m_connectionThrottleLimit || m_pendingSockets + m_activeSockets >= m_connectionTarget))
             {
                 break;
             }
 
-            m_socketPool.push_back(make_shared<ctsSocketState>(shared_from_this()));
-            (*m_socketPool.rbegin())->Start();
+            StartSocketState();
             ++m_pendingSockets;
             --m_totalConnectionsRemaining;
         }
 
+        // -Probes : clients start their probe connections with the first of the bulk connections
+        if (!ctsConfig::g_configSettings->AcceptFunction)
+        {
+            for (unsigned long probe = 0; probe < ctsConfig::g_configSettings->ProbeConnections; ++probe)
+            {
+                m_probeSockets.push_back(make_shared<ctsSocketState>(shared_from_this(), true));
+                (*m_probeSockets.rbegin())->Start();
+            }
+        }
+
+        m_throttlePeriodStartMs = GetTickCount64();
+
         // intiate the threadpool timer
         m_wakeupTimer.schedule_reoccuring(
             [this]() noexcept { TimerCallback(this); },
@@ -118,44 +155,66 @@ namespace ctsTraffic
     //
     // SocketState is indicating the socket is now 'connected'
     // - and will be pumping IO
-    // Update pending and active counts under guard
+    // Update pending and active counts without the broker lock
+    // - incrementing active before decrementing pending so pending + active never transiently reads as zero
     //
     void ctsSocketBroker::InitiatingIo() noexcept
     {
-        const auto lock = m_lock.lock();
-
+        ++m_connectsSucceeded;
+        ++m_activeSockets;
+        const auto priorPendingSockets = m_pendingSockets--;
         FAIL_FAST_IF_MSG(
-            m_pendingSockets == 0,
+            priorPendingSockets == 0,
             "ctsSocketBroker::initiating_io - About to decrement pending_sockets, but pending_sockets == 0 (active_sockets == %u)",
-            m_activeSockets);
+            m_activeSockets.load());
 
-        --m_pendingSockets;
-        ++m_activeSockets;
+        // a pending slot just opened up
+        QueueRefill();
     }
     //
     // SocketState is indicating the socket is now 'closed'
-    // Update pending or active counts (depending on prior state) under guard
+    // Update pending or active counts (depending on prior state) without the broker lock
     //
     void ctsSocketBroker::Closing(bool wasActive) noexcept
     {
-        const auto lock = m_lock.lock();
-
         if (wasActive)
         {
+            const auto priorActiveSockets = m_activeSockets--;
             FAIL_FAST_IF_MSG(
-                m_activeSockets == 0,
+                priorActiveSockets == 0,
                 "ctsSocketBroker::closing - About to decrement active_sockets, but active_sockets == 0 (pending_sockets == %u)",
-                m_pendingSockets);
-            --m_activeSockets;
+                m_pendingSockets.load());
         }
         else
         {
+            ++m_connectsFailed;
+            const auto priorPendingSockets = m_pendingSockets--;
             FAIL_FAST_IF_MSG(
-                m_pendingSockets == 0,
+                priorPendingSockets == 0,
                 "ctsSocketBroker::closing - About to decrement pending_sockets, but pending_sockets == 0 (active_sockets == %u)",
-                m_activeSockets);
-            --m_pendingSockets;
+                m_activeSockets.load());
         }
+
+        // refill now rather than waiting for the timer to scavenge this socket
+        ++m_closedSockets;
+        QueueRefill();
+    }
+
+    //
+    // requires the broker lock to be held
+    //
+    void ctsSocketBroker::StartSocketState()
+    {
+        if (m_recycledSockets.empty())
+        {
+            m_socketPool.push_back(make_shared<ctsSocketState>(shared_from_this()));
+        }
+        else
+        {
+            m_socketPool.push_back(std::move(*m_recycledSockets.rbegin()));
+            m_recycledSockets.pop_back();
+        }
+        (*m_socketPool.rbegin())->Start();
     }
 
     bool ctsSocketBroker::Wait(DWORD milliseconds) const noexcept
@@ -190,10 +249,221 @@ namespace ctsTraffic
     //
     void ctsSocketBroker::TimerCallback(_In_ ctsSocketBroker* pBroker) noexcept
     {
-        // removed_objects will delete the closed objects outside of the broker lock
-        vector<shared_ptr<ctsSocketState>> removedObjects;
+        if (ctsConfig::g_configSettings->AdaptiveConnectionThrottle)
         {
+            // if the lock is contended, the control period is extended to the next timer callback
             const auto lock = pBroker->m_lock.try_lock();
+            if (lock)
+            {
+                pBroker->AdaptConnectionThrottle();
+            }
+        }
+        if (ctsConfig::g_configSettings->LoadProfile)
+        {
+            // if the lock is contended, the setpoint is followed from the next timer callback
+            const auto lock = pBroker->m_lock.try_lock();
+            if (lock)
+            {
+                pBroker->FollowLoadProfile();
+            }
+        }
+
+        RefreshSocketPool(pBroker, false);
+    }
+
+    //
+    // requires the broker lock to be held
+    //
+    void ctsSocketBroker::FollowLoadProfile() noexcept
+    {
+        const auto priorTarget = m_connectionTarget;
+        m_connectionTarget = ctsConfig::UpdateLoadProfile().m_connections;
+        if (m_connectionTarget != priorTarget)
+        {
+            PRINT_DEBUG_INFO(
+                L"\t\tctsSocketBroker : -LoadProfile moving the connection target from %lu to %lu\n",
+                priorTarget, m_connectionTarget);
+        }
+        if (m_connectionTarget > priorTarget)
+        {
+            QueueRefill();
+        }
+    }
+
+    //
+    // requires the broker lock to be held
+    //
+    void ctsSocketBroker::AdaptConnectionThrottle() noexcept
+    {
+        m_pendingSocketsSampled += m_pendingSockets;
+        ++m_pendingSocketSamples;
+
+        const auto currentTimeMs = GetTickCount64();
+        const auto elapsedMs = currentTimeMs - m_throttlePeriodStartMs;
+        if (elapsedMs < c_adaptiveThrottlePeriodMs)
+        {
+            return;
+        }
+
+        const auto succeeded = m_connectsSucceeded.exchange(0UL);
+        const auto failed = m_connectsFailed.exchange(0UL);
+        const auto averagePending = static_cast<double>(m_pendingSocketsSampled) / static_cast<double>(m_pendingSocketSamples);
+        m_throttlePeriodStartMs = currentTimeMs;
+        m_pendingSocketsSampled = 0ULL;
+        m_pendingSocketSamples = 0UL;
+
+        if (0 == succeeded + failed)
+        {
+            // nothing completed to measure - e.g. all connections are established and transferring data
+            return;
+        }
+
+        bool backOff = 0 == succeeded ||
+            static_cast<double>(failed) > c_adaptiveThrottleMaxFailureRatio * static_cast<double>(succeeded + failed);
+        const auto connectionRate = static_cast<double>(succeeded) * 1000.0 / static_cast<double>(elapsedMs);
+        if (succeeded > 0)
+        {
+            const auto connectLatencyMs = averagePending * 1000.0 / connectionRate;
+            if (m_lowestConnectLatencyMs == 0.0 || connectLatencyMs < m_lowestConnectLatencyMs)
+            {
+                m_lowestConnectLatencyMs = connectLatencyMs;
+            }
+            else if (connectLatencyMs > m_lowestConnectLatencyMs * c_adaptiveThrottleMaxLatencyRatio)
+            {
+                backOff = true;
+            }
+        }
+
+        const auto priorLimit = m_connectionThrottleLimit;
+        if (backOff)
+        {
+            m_throttleSlowStart = false;
+            m_connectionThrottleLimit = std::max<unsigned long>(1UL, m_connectionThrottleLimit / 2);
+        }
+        else
+        {
+            if (connectionRate > ctsConfig::g_configSettings->SustainedConnectionRate)
+            {
+                ctsConfig::g_configSettings->SustainedConnectionRate = connectionRate;
+                ctsConfig::g_configSettings->SustainedConnectionThrottleLimit = m_connectionThrottleLimit;
+            }
+
+            // only growing when the limit was what held back connection attempts (not -Connections)
+            if (averagePending >= static_cast<double>(m_connectionThrottleLimit) / 2.0)
+            {
+                const auto increase = m_throttleSlowStart ? m_connectionThrottleLimit : std::max<unsigned long>(1UL, m_connectionThrottleLimit / 8);
+                m_connectionThrottleLimit = std::min<unsigned long>(m_connectionThrottleLimit + increase, ctsConfig::g_configSettings->ConnectionLimit);
+            }
+        }
+
+        if (m_connectionThrottleLimit != priorLimit)
+        {
+            PRINT_DEBUG_INFO(
+                L"\t\tctsSocketBroker : %.1f connections/sec, %lu failed : %ws pended connection attempts from %lu to %lu\n",
+                connectionRate, failed, backOff ? L"reducing" : L"increasing", priorLimit, m_connectionThrottleLimit);
+        }
+        if (m_connectionThrottleLimit > priorLimit)
+        {
+            QueueRefill();
+        }
+    }
+
+    VOID NTAPI ctsSocketBroker::RefillWorker(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) noexcept
+    {
+        auto* pBroker = static_cast<ctsSocketBroker*>(context);
+        // clear before refreshing so a state change racing this callback will queue another refill
+        pBroker->m_refillQueued = false;
+        RefreshSocketPool(pBroker, true);
+    }
+
+    void ctsSocketBroker::QueueRefill() noexcept
+    {
+        if (!m_refillQueued.exchange(true))
+        {
+            SubmitThreadpoolWork(m_refillWork.get());
+        }
+    }
+
+    void ctsSocketBroker::RefreshSocketPool(_In_ ctsSocketBroker* pBroker, bool waitForLock) noexcept
+    {
+        // removed_objects will delete (or reset) the closed objects outside of the broker lock
+        vector<shared_ptr<ctsSocketState>> removedObjects;
+        // closed probe connections are never recycled as bulk connections
+        vector<shared_ptr<ctsSocketState>> removedProbes;
+        bool recycleRemovedObjects = false;
+        {
+            const auto lock = waitForLock ? pBroker->m_lock.lock() : pBroker->m_lock.try_lock();
+            if (!lock)
+            {
+                return;
+            }
+
+            try
+            {
+                recycleRemovedObjects = pBroker->m_totalConnectionsRemaining > 0;
+
+                // the timer always scans as the backstop
+                // - the refill only needs to scan if a socket closed since the last scan
+                const bool socketsClosed = pBroker->m_closedSockets.exchange(0UL) > 0;
+                if (socketsClosed || !waitForLock)
+                {
+                    for (auto& socketPoolEntry : pBroker->m_socketPool)
+                    {
+                        if (ctsSocketState::InternalState::Closed == socketPoolEntry->GetCurrentState())
+                        {
+                            removedObjects.push_back(socketPoolEntry);
+                            socketPoolEntry.reset();
+                        }
+                    }
+
+                    pBroker->m_socketPool.erase(
+                        remove(
+                            begin(pBroker->m_socketPool),
+                            end(pBroker->m_socketPool),
+                            nullptr),
+                        end(pBroker->m_socketPool));
+                }
+
+                // -Probes : the timer replaces each closed probe connection while the bulk connections are still running
+                if (!waitForLock && WAIT_OBJECT_0 != WaitForSingleObject(pBroker->m_doneEvent.get(), 0))
+                {
+                    for (auto& probeSocket : pBroker->m_probeSockets)
+                    {
+                        if (ctsSocketState::InternalState::Closed == probeSocket->GetCurrentState())
+                        {
+                            auto replacement = make_shared<ctsSocketState>(pBroker->shared_from_this(), true);
+                            removedProbes.push_back(probeSocket);
+                            probeSocket = std::move(replacement);
+                            probeSocket->Start();
+                        }
+                    }
+                }
+                TraceLoggingWrite(
+                    g_ctsTraceLoggingProvider,
+                    "BrokerScavenge",
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                    TraceLoggingKeyword(CTS_TRACE_KEYWORD_BROKER),
+                    TraceLoggingUInt64(removedObjects.size(), "RemovedSockets"),
+                    TraceLoggingUInt64(pBroker->m_socketPool.size(), "PoolSize"),
+                    TraceLoggingBool(!waitForLock, "FromTimer"));
+            }
+            CATCH_LOG()
+        }
+
+        // reset closed objects for reuse only when more connections will be made
+        // - Reset waits for the ctsSocketState callbacks which call back into the broker: can't hold the broker lock
+        // - the remaining count only ever decreases: the refill below releases any recycled objects that aren't needed
+        if (recycleRemovedObjects)
+        {
+            for (const auto& removedObject : removedObjects)
+            {
+                removedObject->Reset();
+            }
+        }
+
+        {
+            // if the timer finds the lock contended, the closed objects are just deleted and the refill waits for the next timer
+            const auto lock = waitForLock ? pBroker->m_lock.lock() : pBroker->m_lock.try_lock();
             if (!lock)
             {
                 return;
@@ -207,21 +477,26 @@ namespace ctsTraffic
                 // - touching the socket_pool
                 // - touching the socket / connection counters
                 //
-                for (auto& socketPoolEntry : pBroker->m_socketPool)
+                if (pBroker->m_totalConnectionsRemaining > 0)
                 {
-                    if (ctsSocketState::InternalState::Closed == socketPoolEntry->GetCurrentState())
+                    for (auto& removedObject : removedObjects)
                     {
-                        removedObjects.push_back(socketPoolEntry);
-                        socketPoolEntry.reset();
+                        if (pBroker->m_recycledSockets.size() >= pBroker->m_pendingLimit)
+                        {
+                            break;
+                        }
+                        if (ctsSocketState::InternalState::Creating == removedObject->GetCurrentState())
+                        {
+                            pBroker->m_recycledSockets.push_back(std::move(removedObject));
+                        }
                     }
                 }
-
-                pBroker->m_socketPool.erase(
-                    remove(
-                        begin(pBroker->m_socketPool),
-                        end(pBroker->m_socketPool),
-                        nullptr),
-                    end(pBroker->m_socketPool));
+                else
+                {
+                    // no more connections to create - release the recycled objects outside the lock
+                    move(begin(pBroker->m_recycledSockets), end(pBroker->m_recycledSockets), back_inserter(removedObjects));
+                    pBroker->m_recycledSockets.clear();
+                }
 
                 if (0 == pBroker->m_totalConnectionsRemaining &&
                     0 == pBroker->m_pendingSockets &&
@@ -244,19 +519,18 @@ namespace ctsTraffic
                             if (!ctsConfig::g_configSettings->AcceptFunction)
                             {
                                 // ReSharper disable once CppRedundantParentheses
-                                if ((pBroker->m_pendingSockets + pBroker->m_activeSockets) >= ctsConfig::g_configSettings->ConnectionLimit)
+                                if ((pBroker->m_pendingSockets + pBroker->m_activeSockets) >= pBroker->m_connectionTarget)
                                 {
                                     break;
                                 }
                                 // throttle pending connection attempts as specified
-                                if (pBroker->m_pendingSockets >= ctsConfig::g_configSettings->ConnectionThrottleLimit)
+                                if (pBroker->m_pendingSockets >= pBroker->m_connectionThrottleLimit)
                                 {
                                     break;
                                 }
                             }
 
-                            pBroker->m_socketPool.push_back(make_shared<ctsSocketState>(pBroker->shared_from_this()));
-                            (*pBroker->m_socketPool.rbegin())->Start();
+                            pBroker->StartSocketState();
                             ++pBroker->m_pendingSockets;
                             --pBroker->m_totalConnectionsRemaining;
                         }
@@ -14,6 +14,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <atomic>
 #include <vector>
 #include <memory>
 // os headers
@@ -68,20 +69,95 @@ namespace ctsTraffic
         // must be shared_ptr since ctsSocketState derives from enable_shared_from_this
         // - and thus there must be at least one refcount on that object to call shared_from_this()
         std::vector<std::shared_ptr<ctsSocketState>> m_socketPool;
+        // closed ctsSocketState objects which have been Reset() to be reused for new connections
+        // - bounded by the pending limit, as that's the most that will be created at once
+        std::vector<std::shared_ptr<ctsSocketState>> m_recycledSockets;
+        // -Probes : the probe connections kept open alongside the socket pool
+        // - not counted as pending or active sockets : each is replaced by the timer once closed
+        std::vector<std::shared_ptr<ctsSocketState>> m_probeSockets;
         // timer to initiate the savenge routine TimerCallback()
+        // - a backstop to the refill work queued as sockets change state
         ctl::ctThreadpoolTimer m_wakeupTimer;
+        // work queued to refresh the socket pool as soon as a socket stops pending
+        // - not refreshing inline since the notification comes from the ctsSocketState callback
+        //   and the refresh may need to wait for or delete that very ctsSocketState
+        wil::unique_threadpool_work m_refillWork;
+        // coalesces state changes into a single queued refill
+        std::atomic<bool> m_refillQueued{false};
         // keep a burn-down count as connections are made to know when to be 'done'
         ULONGLONG m_totalConnectionsRemaining = 0ULL;
         // track what's pended and what's active
+        // - the counts are atomic so socket state changes never take the broker lock
+        // - sockets are only added (to pending) under the broker lock
         unsigned long m_pendingLimit = 0UL;
-        unsigned long m_pendingSockets = 0UL;
-        unsigned long m_activeSockets = 0UL;
+        std::atomic<unsigned long> m_pendingSockets{0UL};
+        std::atomic<unsigned long> m_activeSockets{0UL};
+        // sockets which have closed since the socket pool was last scanned for closed sockets
+        // - lets the refill skip scanning the socket pool when it was only queued for a pending socket starting IO
+        std::atomic<unsigned long> m_closedSockets{0UL};
+        // the most outgoing connection attempts to have pended at once
+        // - fixed at ConnectionThrottleLimit unless -ThrottleConnections:auto, guarded by the broker lock
+        unsigned long m_connectionThrottleLimit = 0UL;
+        // the most outgoing connections to have pending or established at once
+        // - fixed at ConnectionLimit unless -LoadProfile, guarded by the broker lock
+        unsigned long m_connectionTarget = 0UL;
+
+        // -ThrottleConnections:auto : counts of connection attempts which completed since the last control period
+        // - updated without the broker lock as sockets change state
+        std::atomic<unsigned long> m_connectsSucceeded{0UL};
+        std::atomic<unsigned long> m_connectsFailed{0UL};
+        // the below are guarded by the broker lock
+        ULONGLONG m_throttlePeriodStartMs = 0ULL;
+        // the pending socket count sampled each timer callback within the control period
+        ULONGLONG m_pendingSocketsSampled = 0ULL;
+        unsigned long m_pendingSocketSamples = 0UL;
+        // the average connect latency is derived from the pending count and connection rate (Little's law)
+        double m_lowestConnectLatencyMs = 0.0;
+        // doubling the limit until the first back off
+        bool m_throttleSlowStart = true;
 
         //
         // Callback for the threadpool timer to scavenge closed sockets and recreate new ones
         // - this allows destroying ctsSockets outside of an inline path from ctsSocket
         //
         static void TimerCallback(_In_ ctsSocketBroker* pBroker) noexcept;
+
+        //
+        // Callback for the threadpool work queued by QueueRefill
+        //
+        static VOID NTAPI RefillWorker(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) noexcept;
+
+        //
+        // Scavenges closed sockets and creates new ones to catch up to the pending limit
+        // - the timer only tries the lock : the refill work waits for it
+        //
+        static void RefreshSocketPool(_In_ ctsSocketBroker* pBroker, bool waitForLock) noexcept;
+
+        //
+        // -ThrottleConnections:auto : adjusts m_connectionThrottleLimit once per control period
+        // - additive increase while connections complete without errors or a growing latency, multiplicative decrease otherwise
+        // - requires the broker lock to be held
+        //
+        void AdaptConnectionThrottle() noexcept;
+
+        //
+        // -LoadProfile : moves m_connectionTarget to the profile's current setpoint
+        // - more connections are started right away, fewer are reached as connections complete
+        // - requires the broker lock to be held
+        //
+        void FollowLoadProfile() noexcept;
+
+        //
+        // Queues RefillWorker if not already queued
+        //
+        void QueueRefill() noexcept;
+
+        //
+        // Adds a new ctsSocketState to the socket pool and starts it
+        // - reusing a recycled ctsSocketState when one is available
+        // - requires the broker lock to be held
+        //
+        void StartSocketState();
     };
 
 } // namespace
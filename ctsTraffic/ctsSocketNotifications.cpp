@@ -0,0 +1,668 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// ReSharper disable CppClangTidyClangDiagnosticExitTimeDestructors
+
+// cpp headers
+#include <deque>
+#include <memory>
+#include <unordered_map>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/resource.h>
+// local headers
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsIOTask.hpp"
+
+//
+// Readiness-based IO using ProcessSocketNotifications
+//
+// Every socket is registered with one process-wide completion port for one-shot, level-triggered notifications
+// - IO is attempted directly with non-blocking send/recv : only when a call would block is the task queued
+//   and the socket (re)armed for the events of the queued tasks
+// - worker threads dequeue notifications in batches and retry the queued tasks, in order, from the notification
+//
+// The ctsSocketNotificationContext of each socket is the completion key of its registration
+// - contexts are tracked in g_notificationContexts until the registration is removed (SOCK_NOTIFY_EVENT_REMOVE),
+//   so a notification dequeued for a context that was already removed is safely ignored
+//
+namespace ctsTraffic
+{
+    namespace SocketNotifications
+    {
+        // ProcessSocketNotifications is only exported from ws2_32.dll on newer Windows builds
+        // - resolved at runtime so ctsTraffic still runs on builds without it
+        typedef DWORD (WINAPI* ProcessSocketNotificationsFunction)(HANDLE, UINT32, SOCK_NOTIFY_REGISTRATION*, UINT32, ULONG, OVERLAPPED_ENTRY*, UINT32*);
+
+        constexpr ULONG c_notificationBatchSize = 64;
+
+        static INIT_ONCE g_notificationInitializer = INIT_ONCE_STATIC_INIT;
+        static ProcessSocketNotificationsFunction g_processSocketNotifications = nullptr;
+        static HANDLE g_notificationPort = nullptr;
+
+        struct ctsNotificationStatus
+        {
+            // Winsock error code
+            unsigned long m_ioErrorcode = NO_ERROR;
+            // flag if to request another ctsIOTask
+            bool m_ioDone = false;
+            // returns if IO was started (it was either queued waiting for readiness or scheduled on a timer)
+            bool m_ioStarted = false;
+        };
+
+        // a task waiting for the socket to be ready - sends track how much was sent by prior partial sends
+        struct ctsPendingTask
+        {
+            ctsTask m_task;
+            DWORD m_transferred = 0;
+        };
+
+        class ctsSocketNotificationContext;
+        static wil::srwlock g_notificationContextsLock;
+        static std::unordered_map<ctsSocketNotificationContext*, std::shared_ptr<ctsSocketNotificationContext>> g_notificationContexts;
+
+        class ctsSocketNotificationContext : public std::enable_shared_from_this<ctsSocketNotificationContext>
+        {
+        public:
+            explicit ctsSocketNotificationContext(std::weak_ptr<ctsSocket> weakSocket) noexcept :
+                m_weakSocket(std::move(weakSocket))
+            {
+            }
+
+            ~ctsSocketNotificationContext() noexcept = default;
+            ctsSocketNotificationContext(const ctsSocketNotificationContext&) = delete;
+            ctsSocketNotificationContext& operator=(const ctsSocketNotificationContext&) = delete;
+            ctsSocketNotificationContext(ctsSocketNotificationContext&&) = delete;
+            ctsSocketNotificationContext& operator=(ctsSocketNotificationContext&&) = delete;
+
+            // requests IO from the pattern until it has none, it fails, or the IO would block
+            void InitiateIo() noexcept
+            {
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    RetireIfUnregistered();
+                    return;
+                }
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                if (!lockedPattern)
+                {
+                    RetireIfUnregistered();
+                    return;
+                }
+                // if lockedSocket has an INVALID_SOCKET, continue below to ProcessTask where it's handled appropriately
+
+                // hold an IO count so we won't inadvertently call CompleteState() while IO is still being requested
+                sharedSocket->IncrementIo();
+                const auto error = RequestIo(lockedSocket.GetSocket(), sharedSocket, lockedPattern);
+                ReleaseIo(sharedSocket, error);
+            }
+
+            // invoked by the notification workers with the events dequeued for this socket
+            void ProcessNotification(UINT32 events) noexcept
+            {
+                if (events & SOCK_NOTIFY_EVENT_REMOVE)
+                {
+                    ProcessRemoval();
+                    return;
+                }
+
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    // the socket was closed : the removal notification will follow
+                    return;
+                }
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                if (!lockedPattern)
+                {
+                    return;
+                }
+
+                sharedSocket->IncrementIo();
+                const SOCKET socket = lockedSocket.GetSocket();
+
+                // errors and hang-ups are retried on both queues so the failure is reported to each queued task
+                constexpr UINT32 recvEvents = SOCK_NOTIFY_EVENT_IN | SOCK_NOTIFY_EVENT_HANGUP | SOCK_NOTIFY_EVENT_ERR;
+                constexpr UINT32 sendEvents = SOCK_NOTIFY_EVENT_OUT | SOCK_NOTIFY_EVENT_HANGUP | SOCK_NOTIFY_EVENT_ERR;
+                unsigned long error = NO_ERROR;
+                if (events & recvEvents)
+                {
+                    error = RetryPendingTasks(socket, sharedSocket, lockedPattern, m_pendingRecvs);
+                }
+                if (NO_ERROR == error && events & sendEvents)
+                {
+                    error = RetryPendingTasks(socket, sharedSocket, lockedPattern, m_pendingSends);
+                }
+                if (NO_ERROR == error)
+                {
+                    // completed tasks may have made more IO available from the pattern
+                    error = RequestIo(socket, sharedSocket, lockedPattern);
+                }
+                ReleaseIo(sharedSocket, error);
+            }
+
+        private:
+            const std::weak_ptr<ctsSocket> m_weakSocket;
+            // tasks are queued in the order they were requested : a task is only attempted once all before it completed
+            std::deque<ctsPendingTask> m_pendingSends;
+            std::deque<ctsPendingTask> m_pendingRecvs;
+            // once registered, the context must remain until the registration is removed
+            bool m_registered = false;
+
+            void Retire() noexcept
+            {
+                const auto lock = g_notificationContextsLock.lock_exclusive();
+                g_notificationContexts.erase(this);
+            }
+
+            void RetireIfUnregistered() noexcept
+            {
+                if (!m_registered)
+                {
+                    Retire();
+                }
+            }
+
+            // releases the IO count held while processing - completing the socket state if no IO remains queued
+            // - the context can be retired here : callers must not touch the context afterwards
+            void ReleaseIo(const std::shared_ptr<ctsSocket>& sharedSocket, unsigned long error) noexcept
+            {
+                if (0 == sharedSocket->DecrementIo())
+                {
+                    sharedSocket->CompleteState(error);
+                    RetireIfUnregistered();
+                }
+            }
+
+            //
+            // Loops requesting IO from the pattern, arming the registration if any task is left waiting for readiness
+            //
+            // ** ctsSocket::IncrementIo must have been called before this function was invoked
+            //
+            unsigned long RequestIo(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& sharedPattern) noexcept
+            {
+                ctsNotificationStatus status{};
+                while (!status.m_ioDone)
+                {
+                    const ctsTask nextIo = sharedPattern->InitiateIo();
+                    if (ctsTaskAction::None == nextIo.m_ioAction)
+                    {
+                        // nothing failed, just no more IO right now
+                        break;
+                    }
+
+                    // increment IO for each individual request
+                    sharedSocket->IncrementIo();
+
+                    if (nextIo.m_timeOffsetMilliseconds > 0)
+                    {
+                        // set_timer can throw
+                        try
+                        {
+                            sharedSocket->SetTimer(
+                                nextIo,
+                                [context = shared_from_this()](const std::weak_ptr<ctsSocket>&, const ctsTask& scheduledIo) noexcept { context->ProcessScheduledTask(scheduledIo); });
+                            status.m_ioStarted = true; // IO started in the context of keeping the count incremented
+                            status.m_ioDone = true;
+                        }
+                        catch (...)
+                        {
+                            status.m_ioErrorcode = ctsConfig::PrintThrownException();
+                            status.m_ioStarted = false;
+                        }
+                    }
+                    else
+                    {
+                        status = ProcessTask(socket, sharedSocket, sharedPattern, nextIo);
+                    }
+
+                    // if no IO was started, decrement the IO counter
+                    if (!status.m_ioStarted)
+                    {
+                        if (0 == sharedSocket->DecrementIo())
+                        {
+                            // this should never be zero as we are holding a reference outside the loop
+                            FAIL_FAST_MSG(
+                                "The ctsSocket (%p) refcount fell to zero while this function was holding a reference", sharedSocket.get());
+                        }
+                    }
+                }
+
+                if (NO_ERROR == status.m_ioErrorcode)
+                {
+                    status.m_ioErrorcode = ArmRegistration(socket, sharedSocket, sharedPattern);
+                }
+                else
+                {
+                    // the pattern failed : nothing is left to wait for readiness
+                    FailPendingTasks(sharedSocket, sharedPattern, status.m_ioErrorcode);
+                }
+                return status.m_ioErrorcode;
+            }
+
+            //
+            // Attempts the IO specified in the ctsIOTask, queueing it if the socket is not ready for it
+            //
+            // ** ctsSocket::IncrementIo must have been called before this function was invoked
+            //
+            ctsNotificationStatus ProcessTask(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& sharedPattern, const ctsTask& nextIo) noexcept
+            {
+                ctsNotificationStatus returnStatus;
+
+                // if we no longer have a valid socket return early
+                if (INVALID_SOCKET == socket)
+                {
+                    returnStatus.m_ioErrorcode = WSAECONNABORTED;
+                    returnStatus.m_ioStarted = false;
+                    returnStatus.m_ioDone = true;
+                    // even if the socket was closed we still must complete the IO request
+                    sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode);
+                    return returnStatus;
+                }
+
+                if (ctsTaskAction::GracefulShutdown == nextIo.m_ioAction)
+                {
+                    if (shutdown(socket, SD_SEND) != 0)
+                    {
+                        returnStatus.m_ioErrorcode = WSAGetLastError();
+                    }
+                    returnStatus.m_ioDone = sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
+                    returnStatus.m_ioStarted = false;
+                    return returnStatus;
+                }
+
+                if (ctsTaskAction::HardShutdown == nextIo.m_ioAction)
+                {
+                    // pass through -1 to force an RST with the closesocket
+                    returnStatus.m_ioErrorcode = sharedSocket->CloseSocket(-1);
+                    returnStatus.m_ioDone = sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
+                    returnStatus.m_ioStarted = false;
+                    return returnStatus;
+                }
+
+                try
+                {
+                    auto& pendingTasks = ctsTaskAction::Send == nextIo.m_ioAction ? m_pendingSends : m_pendingRecvs;
+                    ctsPendingTask pendingTask;
+                    pendingTask.m_task = nextIo;
+
+                    // can't be attempted before the tasks already waiting : that would reorder the data
+                    const int error = pendingTasks.empty() ? AttemptTask(socket, pendingTask) : WSAEWOULDBLOCK;
+                    if (WSAEWOULDBLOCK == error)
+                    {
+                        // this can throw std::bad_alloc
+                        pendingTasks.push_back(pendingTask);
+                        returnStatus.m_ioStarted = true;
+                        returnStatus.m_ioDone = false;
+                        return returnStatus;
+                    }
+
+                    returnStatus = CompleteTask(sharedPattern, pendingTask, error);
+                }
+                catch (...)
+                {
+                    returnStatus.m_ioErrorcode = ctsConfig::PrintThrownException();
+                    returnStatus.m_ioDone = sharedPattern->CompleteIo(nextIo, 0, returnStatus.m_ioErrorcode) != ctsIoStatus::ContinueIo;
+                    returnStatus.m_ioStarted = false;
+                }
+
+                return returnStatus;
+            }
+
+            // makes one non-blocking attempt at the task
+            // - returns WSAEWOULDBLOCK if the task must wait for readiness, including after a partial send
+            static int AttemptTask(SOCKET socket, ctsPendingTask& pendingTask) noexcept
+            {
+                const ctsTask& task = pendingTask.m_task;
+                char* const ioBuffer = task.m_buffer + task.m_bufferOffset + pendingTask.m_transferred;
+                const auto ioLength = static_cast<int>(task.m_bufferLength - pendingTask.m_transferred);
+
+                if (ctsTaskAction::Send == task.m_ioAction)
+                {
+                    const int sent = send(socket, ioBuffer, ioLength, 0);
+                    if (SOCKET_ERROR == sent)
+                    {
+                        return WSAGetLastError();
+                    }
+                    pendingTask.m_transferred += static_cast<DWORD>(sent);
+                    return pendingTask.m_transferred < task.m_bufferLength ? WSAEWOULDBLOCK : NO_ERROR;
+                }
+
+                // MSG_WAITALL is not supported on non-blocking sockets
+                const int received = recv(socket, ioBuffer, ioLength, 0);
+                if (SOCKET_ERROR == received)
+                {
+                    return WSAGetLastError();
+                }
+                pendingTask.m_transferred = static_cast<DWORD>(received);
+                return NO_ERROR;
+            }
+
+            // reports the finished task back to the pattern
+            static ctsNotificationStatus CompleteTask(const std::shared_ptr<ctsIoPattern>& sharedPattern, const ctsPendingTask& pendingTask, int error) noexcept
+            {
+                const char* functionName = ctsTaskAction::Send == pendingTask.m_task.m_ioAction ? "send" : "recv";
+                if (error != NO_ERROR) { PRINT_DEBUG_INFO(L"\t\tIO Failed: %hs (%d) [ctsSocketNotifications]\n", functionName, error); }
+
+                ctsNotificationStatus returnStatus;
+                returnStatus.m_ioStarted = false;
+                const ctsIoStatus protocolStatus = sharedPattern->CompleteIo(pendingTask.m_task, pendingTask.m_transferred, error);
+                switch (protocolStatus)
+                {
+                    case ctsIoStatus::ContinueIo:
+                        // The protocol layer wants to transfer more data
+                        // if prior IO failed, the protocol wants to ignore the error
+                        returnStatus.m_ioErrorcode = NO_ERROR;
+                        returnStatus.m_ioDone = false;
+                        break;
+
+                    case ctsIoStatus::CompletedIo:
+                        // The protocol layer has successfully complete all IO on this connection
+                        // if prior IO failed, the protocol wants to ignore the error
+                        returnStatus.m_ioErrorcode = NO_ERROR;
+                        returnStatus.m_ioDone = true;
+                        break;
+
+                    case ctsIoStatus::FailedIo:
+                        // write out the error
+                        ctsConfig::PrintErrorIfFailed(functionName, sharedPattern->GetLastPatternError());
+                        // the protocol acknoledged the failure - socket is done with IO
+                        returnStatus.m_ioErrorcode = sharedPattern->GetLastPatternError();
+                        returnStatus.m_ioDone = true;
+                        break;
+
+                    default:
+                        FAIL_FAST_MSG("ctsSocketNotifications: unknown ctsSocket::IOStatus - %u\n", static_cast<unsigned>(protocolStatus));
+                }
+                return returnStatus;
+            }
+
+            //
+            // Retries the queued tasks in order until one would block
+            // - on a failure the pattern reported, every task still queued is completed with that error
+            //
+            // ** ctsSocket::IncrementIo must have been called before this function was invoked
+            //
+            unsigned long RetryPendingTasks(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& sharedPattern, std::deque<ctsPendingTask>& pendingTasks) noexcept
+            {
+                while (!pendingTasks.empty())
+                {
+                    const int error = INVALID_SOCKET == socket ? WSAECONNABORTED : AttemptTask(socket, pendingTasks.front());
+                    if (WSAEWOULDBLOCK == error)
+                    {
+                        break;
+                    }
+
+                    const ctsPendingTask completedTask(pendingTasks.front());
+                    pendingTasks.pop_front();
+                    const auto status = CompleteTask(sharedPattern, completedTask, error);
+                    // the queued IO is now formally "done"
+                    if (0 == sharedSocket->DecrementIo())
+                    {
+                        // this should never be zero as we are holding a reference while processing the notification
+                        FAIL_FAST_MSG(
+                            "The ctsSocket (%p) refcount fell to zero while processing a socket notification", sharedSocket.get());
+                    }
+
+                    if (status.m_ioErrorcode != NO_ERROR)
+                    {
+                        FailPendingTasks(sharedSocket, sharedPattern, status.m_ioErrorcode);
+                        return status.m_ioErrorcode;
+                    }
+                }
+                return NO_ERROR;
+            }
+
+            // ** ctsSocket::IncrementIo must have been called before this function was invoked
+            void FailPendingTasks(const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& sharedPattern, unsigned long error) noexcept
+            {
+                for (auto* pendingTasks : { &m_pendingRecvs, &m_pendingSends })
+                {
+                    while (!pendingTasks->empty())
+                    {
+                        const ctsPendingTask failedTask(pendingTasks->front());
+                        pendingTasks->pop_front();
+                        sharedPattern->CompleteIo(failedTask.m_task, 0, error);
+                        if (0 == sharedSocket->DecrementIo())
+                        {
+                            FAIL_FAST_MSG(
+                                "The ctsSocket (%p) refcount fell to zero while failing its queued IO", sharedSocket.get());
+                        }
+                    }
+                }
+            }
+
+            // arms a one-shot notification for the events the queued tasks are waiting on
+            // - level-triggered, so readiness reached before arming is still notified
+            unsigned long ArmRegistration(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& sharedPattern) noexcept
+            {
+                if (m_pendingRecvs.empty() && m_pendingSends.empty())
+                {
+                    return NO_ERROR;
+                }
+
+                SOCK_NOTIFY_REGISTRATION registration{};
+                registration.socket = socket;
+                registration.completionKey = this;
+                registration.eventFilter = SOCK_NOTIFY_REGISTER_EVENT_HANGUP;
+                if (!m_pendingRecvs.empty())
+                {
+                    registration.eventFilter |= SOCK_NOTIFY_REGISTER_EVENT_IN;
+                }
+                if (!m_pendingSends.empty())
+                {
+                    registration.eventFilter |= SOCK_NOTIFY_REGISTER_EVENT_OUT;
+                }
+                registration.operation = SOCK_NOTIFY_OP_ENABLE;
+                registration.triggerFlags = SOCK_NOTIFY_TRIGGER_ONESHOT | SOCK_NOTIFY_TRIGGER_LEVEL;
+
+                unsigned long error = g_processSocketNotifications(g_notificationPort, 1, &registration, 0, 0, nullptr, nullptr);
+                if (NO_ERROR == error)
+                {
+                    error = registration.registrationResult;
+                }
+                if (error != NO_ERROR)
+                {
+                    ctsConfig::PrintErrorIfFailed("ProcessSocketNotifications", error);
+                    FailPendingTasks(sharedSocket, sharedPattern, error);
+                    return error;
+                }
+
+                m_registered = true;
+                return NO_ERROR;
+            }
+
+            // the registration was removed - the final notification for this socket
+            void ProcessRemoval() noexcept
+            {
+                const auto sharedSocket(m_weakSocket.lock());
+                if (sharedSocket)
+                {
+                    const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                    const auto lockedPattern = lockedSocket.GetPattern();
+                    if (lockedPattern && (!m_pendingRecvs.empty() || !m_pendingSends.empty()))
+                    {
+                        // tasks can no longer be notified : the socket was closed underneath them
+                        sharedSocket->IncrementIo();
+                        FailPendingTasks(sharedSocket, lockedPattern, WSAECONNABORTED);
+                        if (0 == sharedSocket->DecrementIo())
+                        {
+                            sharedSocket->CompleteState(WSAECONNABORTED);
+                        }
+                    }
+                }
+                Retire();
+            }
+
+            // This is the callback for the threadpool timer
+            // - processes the given task and then requests any additional tasks
+            // ** ctsSocket::IncrementIo must have been called (when the timer was scheduled) before this function is invoked
+            void ProcessScheduledTask(const ctsTask& nextIo) noexcept
+            {
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    return;
+                }
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                if (!lockedPattern)
+                {
+                    return;
+                }
+
+                // run the ctsIOTask (next_io) that was scheduled through the TP timer
+                const SOCKET socket = lockedSocket.GetSocket();
+                auto status = ProcessTask(socket, sharedSocket, lockedPattern, nextIo);
+                // if the task was not queued, the scheduled IO is now formally "done"
+                if (!status.m_ioStarted)
+                {
+                    if (0 == sharedSocket->DecrementIo())
+                    {
+                        // this should never be zero since we should be holding a refcount for this callback
+                        FAIL_FAST_MSG(
+                            "The refcount of the ctsSocket object (%p) fell to zero during a scheduled callback", sharedSocket.get());
+                    }
+                }
+                // continue requesting IO if this connection still isn't done with all IO after scheduling the prior IO
+                if (!status.m_ioDone)
+                {
+                    status.m_ioErrorcode = RequestIo(socket, sharedSocket, lockedPattern);
+                }
+                // finally release the reference that was held for the scheduled IO
+                ReleaseIo(sharedSocket, status.m_ioErrorcode);
+            }
+        };
+
+        static std::shared_ptr<ctsSocketNotificationContext> FindContext(ULONG_PTR completionKey) noexcept
+        {
+            const auto lock = g_notificationContextsLock.lock_shared();
+            const auto foundContext = g_notificationContexts.find(reinterpret_cast<ctsSocketNotificationContext*>(completionKey));
+            if (foundContext == g_notificationContexts.end())
+            {
+                return nullptr;
+            }
+            return foundContext->second;
+        }
+
+        static DWORD WINAPI NotificationWorker(LPVOID) noexcept
+        {
+            OVERLAPPED_ENTRY notifications[c_notificationBatchSize];
+            for (;;)
+            {
+                UINT32 notificationCount = 0;
+                const auto error = g_processSocketNotifications(g_notificationPort, 0, nullptr, INFINITE, c_notificationBatchSize, notifications, &notificationCount);
+                if (error != NO_ERROR)
+                {
+                    ctsConfig::PrintErrorIfFailed("ProcessSocketNotifications", error);
+                    return error;
+                }
+
+                for (UINT32 notification = 0; notification < notificationCount; ++notification)
+                {
+                    const auto context = FindContext(notifications[notification].lpCompletionKey);
+                    if (context)
+                    {
+                        context->ProcessNotification(SocketNotificationRetrieveEvents(&notifications[notification]));
+                    }
+                }
+            }
+        }
+
+        static BOOL CALLBACK InitOnceSocketNotifications(PINIT_ONCE, PVOID, PVOID*) noexcept
+        {
+            auto* const ws2Module = GetModuleHandleW(L"ws2_32.dll");
+            if (ws2Module)
+            {
+                g_processSocketNotifications = reinterpret_cast<ProcessSocketNotificationsFunction>(GetProcAddress(ws2Module, "ProcessSocketNotifications"));
+            }
+            if (!g_processSocketNotifications)
+            {
+                SetLastError(ERROR_NOT_SUPPORTED);
+                return FALSE;
+            }
+
+            g_notificationPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+            if (!g_notificationPort)
+            {
+                return FALSE;
+            }
+
+            // the workers run for the lifetime of the process
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+            for (DWORD worker = 0; worker < systemInfo.dwNumberOfProcessors; ++worker)
+            {
+                const wil::unique_handle workerThread(CreateThread(nullptr, 0, NotificationWorker, nullptr, 0, nullptr));
+                if (!workerThread)
+                {
+                    return FALSE;
+                }
+            }
+            return TRUE;
+        }
+    }
+
+    // The function registered with ctsConfig
+    void ctsSocketNotifications(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        // attempt to get a reference to the socket
+        const auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        //
+        // guarantee fully initialized
+        //
+        if (!InitOnceExecuteOnce(&SocketNotifications::g_notificationInitializer, SocketNotifications::InitOnceSocketNotifications, nullptr, nullptr))
+        {
+            auto gle = GetLastError();
+            if (0 == gle)
+            {
+                gle = WSAENOBUFS;
+            }
+            ctsConfig::PrintException(gle, L"InitOnceExecuteOnce", L"ctsSocketNotifications");
+            sharedSocket->CompleteState(gle);
+            return;
+        }
+
+        std::shared_ptr<SocketNotifications::ctsSocketNotificationContext> context;
+        try
+        {
+            context = std::make_shared<SocketNotifications::ctsSocketNotificationContext>(weakSocket);
+            const auto lock = SocketNotifications::g_notificationContextsLock.lock_exclusive();
+            SocketNotifications::g_notificationContexts.emplace(context.get(), context);
+        }
+        catch (...)
+        {
+            sharedSocket->CompleteState(ctsConfig::PrintThrownException());
+            return;
+        }
+
+        context->InitiateIo();
+    }
+} // namespace
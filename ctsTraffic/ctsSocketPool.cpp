@@ -0,0 +1,321 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// parent header
+#include "ctsSocketPool.h"
+// cpp headers
+#include <algorithm>
+#include <execution>
+#include <memory>
+#include <utility>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include <ctSocketExtensions.hpp>
+#include <ctTimer.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsStatistics.hpp"
+
+namespace ctsTraffic
+{
+    namespace ctsSocketPool
+    {
+        struct PooledSocket
+        {
+            ctl::ctSockaddr m_address;
+            ctsRecycledSocket m_recycled;
+        };
+
+        // the DisconnectEx request : owning the socket only once the disconnect succeeds
+        struct DisconnectRequest
+        {
+            ctl::ctSockaddr m_address;
+            std::shared_ptr<ctl::ctThreadIocp> m_tpIocp;
+            SOCKET m_socket = INVALID_SOCKET;
+        };
+
+        struct PoolState
+        {
+            wil::critical_section m_lock{ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock};
+            std::vector<PooledSocket> m_available;
+            // -PrecreateSockets : the sockets created before the run started, not yet taken by a connection
+            std::vector<PooledSocket> m_precreated;
+            // a ctThreadIocp can't be destroyed from within its own callback (it waits for its callbacks to complete)
+            // - the ctThreadIocp of a failed disconnect is destroyed by the next Acquire
+            std::vector<std::shared_ptr<ctl::ctThreadIocp>> m_retired;
+        };
+
+        // never destroyed : pooled ctThreadIocp objects must not wait on threadpool callbacks while the process exits
+        static PoolState* g_pool = new PoolState;  // NOLINT(cppcoreguidelines-owning-memory)
+        static ctsShardedStatsTracking g_reusedCount;
+        static ctsShardedStatsTracking g_failedCount;
+        static ctsStatsTracking g_precreatedCount;
+        static ctsShardedStatsTracking g_precreatedUsedCount;
+        static ctsStatsTracking g_precreateMilliseconds;
+
+        static void CompleteDisconnect(DisconnectRequest* pRequest, OVERLAPPED* pOverlapped) noexcept
+        {
+            std::unique_ptr<DisconnectRequest> request(pRequest);
+            wil::unique_socket socket(request->m_socket);
+
+            // a null OVERLAPPED* means the DisconnectEx completed inline
+            DWORD error = NO_ERROR;
+            if (pOverlapped)
+            {
+                DWORD transferred{};
+                DWORD flags{};
+                if (!WSAGetOverlappedResult(socket.get(), pOverlapped, &transferred, FALSE, &flags))
+                {
+                    error = WSAGetLastError();
+                }
+            }
+
+            if (error != NO_ERROR)
+            {
+                ctsConfig::PrintErrorIfFailed("DisconnectEx", error);
+                g_failedCount.Increment();
+                socket.reset();
+            }
+
+            const auto lock = g_pool->m_lock.lock();
+            try
+            {
+                // reserving first : the push_back can't throw once the ctThreadIocp is moved out of the request
+                if (socket)
+                {
+                    g_pool->m_available.reserve(g_pool->m_available.size() + 1);
+                }
+                else
+                {
+                    g_pool->m_retired.reserve(g_pool->m_retired.size() + 1);
+                }
+            }
+            catch (...)
+            {
+                // the ctThreadIocp can't be destroyed within its own callback : the request is leaked instead
+                g_failedCount.Increment();
+                (void)request.release();
+                return;
+            }
+
+            if (socket)
+            {
+                g_pool->m_available.push_back(PooledSocket{request->m_address, ctsRecycledSocket{std::move(socket), std::move(request->m_tpIocp)}});
+            }
+            else
+            {
+                g_pool->m_retired.push_back(std::move(request->m_tpIocp));
+            }
+        }
+
+        ctsRecycledSocket Acquire(const ctl::ctSockaddr& address) noexcept
+        {
+            ctsRecycledSocket recycled;
+            std::vector<std::shared_ptr<ctl::ctThreadIocp>> retired;
+            {
+                const auto lock = g_pool->m_lock.lock();
+                retired.swap(g_pool->m_retired);
+
+                // the most recently disconnected socket is the most likely to still be in cache
+                auto& available = g_pool->m_available;
+                for (auto entry = available.rbegin(); entry != available.rend(); ++entry)
+                {
+                    if (entry->m_address == address)
+                    {
+                        recycled = std::move(entry->m_recycled);
+                        *entry = std::move(available.back());
+                        available.pop_back();
+                        break;
+                    }
+                }
+            }
+
+            if (recycled.m_socket)
+            {
+                g_reusedCount.Increment();
+            }
+            // retired ctThreadIocp objects are destroyed here, outside the lock
+            return recycled;
+        }
+
+        bool Recycle(SOCKET socket, std::shared_ptr<ctl::ctThreadIocp> tpIocp, const ctl::ctSockaddr& address) noexcept
+        {
+            try
+            {
+                if (!tpIocp)
+                {
+                    tpIocp = ctsConfig::CreateSocketThreadIocp(socket);
+                }
+
+                // requests still outstanding on the socket (ISB notifications, SIO_TCP_INFO) must not outlive this connection
+                CancelIoEx(reinterpret_cast<HANDLE>(socket), nullptr);  // NOLINT(performance-no-int-to-ptr)
+
+                auto request = std::make_unique<DisconnectRequest>(DisconnectRequest{address, std::move(tpIocp), socket});
+                auto* const pRequest = request.get();
+                OVERLAPPED* pOverlapped = pRequest->m_tpIocp->new_request(
+                    [pRequest](OVERLAPPED* pCallbackOverlapped) noexcept { CompleteDisconnect(pRequest, pCallbackOverlapped); });
+
+                if (!ctl::ctDisconnectEx(socket, pOverlapped, TF_REUSE_SOCKET, 0))
+                {
+                    const auto error = WSAGetLastError();
+                    if (error != ERROR_IO_PENDING)
+                    {
+                        // the caller still holds the ctThreadIocp unless it was created above : it's safe to release here
+                        pRequest->m_tpIocp->cancel_request(pOverlapped);
+                        ctsConfig::PrintErrorIfFailed("DisconnectEx", error);
+                        g_failedCount.Increment();
+                        return false;
+                    }
+                    // the callback now owns the request
+                    request.release();
+                }
+                else if (ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp)
+                {
+                    pRequest->m_tpIocp->cancel_request(pOverlapped);
+                    CompleteDisconnect(request.release(), nullptr);
+                }
+                else
+                {
+                    // the completion is still queued to the callback
+                    request.release();
+                }
+                return true;
+            }
+            catch (...)
+            {
+                ctsConfig::PrintThrownException();
+                g_failedCount.Increment();
+                return false;
+            }
+        }
+
+        long long GetReusedCount() noexcept
+        {
+            return g_reusedCount.GetValue();
+        }
+
+        long long GetFailedCount() noexcept
+        {
+            return g_failedCount.GetValue();
+        }
+
+        unsigned long Precreate(unsigned long count) noexcept
+        try
+        {
+            const auto startTime = ctl::ctTimer::SnapQpcInMillis();
+
+            // the same address ctsWSASocket binds to : with neither -LocalPort nor -PortReservation the port is always 0
+            const auto& bindAddresses = ctsConfig::g_configSettings->BindAddresses;
+            std::vector<PooledSocket> precreated(count);
+            for (unsigned long index = 0; index < count; ++index)
+            {
+                precreated[index].m_address = bindAddresses[index % bindAddresses.size()];
+                precreated[index].m_address.SetPort(0);
+            }
+
+            std::for_each(std::execution::par, precreated.begin(), precreated.end(), [](PooledSocket& entry) noexcept {
+                try
+                {
+                    wil::unique_socket socket(ctsConfig::CreateSocket(entry.m_address.family(), SOCK_STREAM, IPPROTO_TCP, ctsConfig::g_configSettings->SocketFlags));
+                    PCSTR functionName = "SetPreBindOptions";
+                    auto error = ctsConfig::SetPreBindOptions(socket.get(), entry.m_address);
+                    if (NO_ERROR == error)
+                    {
+                        functionName = "bind";
+                        if (SOCKET_ERROR == bind(socket.get(), entry.m_address.sockaddr(), entry.m_address.length()))
+                        {
+                            error = WSAGetLastError();
+                        }
+                    }
+                    if (error != NO_ERROR)
+                    {
+                        ctsConfig::PrintErrorIfFailed(functionName, error);
+                        return;
+                    }
+
+                    entry.m_recycled.m_tpIocp = ctsConfig::CreateSocketThreadIocp(socket.get());
+                    entry.m_recycled.m_socket = std::move(socket);
+                }
+                catch (...)
+                {
+                    ctsConfig::PrintThrownException();
+                }
+            });
+
+            precreated.erase(
+                std::remove_if(precreated.begin(), precreated.end(), [](const PooledSocket& entry) noexcept { return !entry.m_recycled.m_socket; }),
+                precreated.end());
+            const auto createdCount = static_cast<unsigned long>(precreated.size());
+            {
+                const auto lock = g_pool->m_lock.lock();
+                g_pool->m_precreated = std::move(precreated);
+            }
+
+            g_precreatedCount.Add(createdCount);
+            g_precreateMilliseconds.Add(ctl::ctTimer::SnapQpcInMillis() - startTime);
+            return createdCount;
+        }
+        catch (...)
+        {
+            ctsConfig::PrintThrownException();
+            return 0;
+        }
+
+        ctsRecycledSocket AcquirePrecreated(const ctl::ctSockaddr& address) noexcept
+        {
+            ctsRecycledSocket precreated;
+            {
+                const auto lock = g_pool->m_lock.lock();
+                auto& available = g_pool->m_precreated;
+                for (auto entry = available.rbegin(); entry != available.rend(); ++entry)
+                {
+                    if (entry->m_address == address)
+                    {
+                        precreated = std::move(entry->m_recycled);
+                        *entry = std::move(available.back());
+                        available.pop_back();
+                        break;
+                    }
+                }
+            }
+
+            if (precreated.m_socket)
+            {
+                g_precreatedUsedCount.Increment();
+            }
+            return precreated;
+        }
+
+        long long GetPrecreatedCount() noexcept
+        {
+            return g_precreatedCount.GetValue();
+        }
+
+        long long GetPrecreatedUsedCount() noexcept
+        {
+            return g_precreatedUsedCount.GetValue();
+        }
+
+        long long GetPrecreateMilliseconds() noexcept
+        {
+            return g_precreateMilliseconds.GetValue();
+        }
+    }
+}
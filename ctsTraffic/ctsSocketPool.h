@@ -0,0 +1,71 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// cpp headers
+#include <memory>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/resource.h>
+// ctl headers
+#include <ctThreadIocp.hpp>
+#include <ctSockaddr.hpp>
+
+namespace ctsTraffic
+{
+    //
+    // Recycled sockets for -SocketReuse
+    // - sockets of successful connections are disconnected with DisconnectEx(TF_REUSE_SOCKET) instead of being closed,
+    //   then pooled with their ctThreadIocp (a socket can only be associated with one completion port)
+    // - pooled sockets are keyed by the address they were bound to (clients) or accepted on (servers)
+    //
+    namespace ctsSocketPool
+    {
+        struct ctsRecycledSocket
+        {
+            wil::unique_socket m_socket;
+            std::shared_ptr<ctl::ctThreadIocp> m_tpIocp;
+        };
+
+        // Takes a recycled socket for this address : the socket is empty when none is available
+        // - a client socket is still bound, a server socket is ready to pass to AcceptEx
+        ctsRecycledSocket Acquire(const ctl::ctSockaddr& address) noexcept;
+
+        // Disconnects the socket with DisconnectEx(TF_REUSE_SOCKET) : it returns to the pool once the disconnect completes
+        // - tpIocp is null if the socket was never associated with a completion port
+        // - returns false if the socket can't be recycled: the caller still owns it and must close it
+        bool Recycle(SOCKET socket, std::shared_ptr<ctl::ctThreadIocp> tpIocp, const ctl::ctSockaddr& address) noexcept;
+
+        // Counts of the sockets reused and the recycle attempts which failed
+        long long GetReusedCount() noexcept;
+        long long GetFailedCount() noexcept;
+
+        // -PrecreateSockets : creates count client sockets before the run starts, in parallel across processors
+        // - each is bound to the next -Bind address (as ctsWSASocket assigns them) and associated with its ctThreadIocp
+        // - sockets which fail are left for ctsWSASocket to create when the connection starts
+        // - returns the number of sockets created
+        unsigned long Precreate(unsigned long count) noexcept;
+
+        // Takes a pre-created socket bound to this address : the socket is empty once none are left
+        ctsRecycledSocket AcquirePrecreated(const ctl::ctSockaddr& address) noexcept;
+
+        // Counts of the sockets pre-created and those taken by connections, and the time taken to create them
+        long long GetPrecreatedCount() noexcept;
+        long long GetPrecreatedUsedCount() noexcept;
+        long long GetPrecreateMilliseconds() noexcept;
+    }
+}
@@ -17,16 +17,37 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <memory>
 // os headers
 #include <Windows.h>
+// ctl headers
+#include <ctMemoryGuard.hpp>
 // project headers
 #include "ctsSocket.h"
 #include "ctsSocketBroker.h"
 #include "ctsConfig.h"
 #include "ctsIOPattern.h"
+#include "ctsTraceLogging.h"
 
 
 namespace ctsTraffic
 {
-    ctsSocketState::ctsSocketState(std::weak_ptr<ctsSocketBroker> pBroker) : m_broker(move(pBroker))
+    // -InlineStateTransitions : whether a CompleteState made on this thread may run the next state inline,
+    // and the states already running inline on this thread's stack
+    static thread_local bool t_allowInlineTransition = false;
+    static thread_local unsigned long t_inlineTransitionDepth = 0;
+    // bounds the stack when each state completes inline within the functor of the prior state
+    constexpr unsigned long c_maxInlineTransitionDepth = 4;
+
+    ctsSocketState::InlineTransitionScope::InlineTransitionScope(bool allowInline) noexcept :
+        m_priorAllowInline(t_allowInlineTransition)
+    {
+        t_allowInlineTransition = allowInline;
+    }
+
+    ctsSocketState::InlineTransitionScope::~InlineTransitionScope() noexcept
+    {
+        t_allowInlineTransition = m_priorAllowInline;
+    }
+
+    ctsSocketState::ctsSocketState(std::weak_ptr<ctsSocketBroker> pBroker, bool probe) : m_broker(move(pBroker)), m_probe(probe)
     {
         m_threadPoolWorker.reset(CreateThreadpoolWork(ThreadPoolWorker, this, ctsConfig::g_configSettings->pTpEnvironment));
         THROW_LAST_ERROR_IF_NULL(m_threadPoolWorker.get());
@@ -54,9 +75,40 @@ namespace ctsTraffic
         FAIL_FAST_IF_MSG(
             m_state != InternalState::Creating,
             "ctsSocketState::start must only be called once at the initial state of the object (this == %p)", this);
+        if (!ctsConfig::g_configSettings->LatencyPercentiles.empty())
+        {
+            m_transitionQpc = ctl::ctTimer::SnapQpc();
+        }
+        ctsConfig::g_configSettings->StateTransitionDetails.m_queuedTransitions.Increment();
         SubmitThreadpoolWork(m_threadPoolWorker.get());
     }
 
+    void ctsSocketState::Reset() noexcept
+    {
+        FAIL_FAST_IF_MSG(
+            GetCurrentState() != InternalState::Closed,
+            "ctsSocketState::Reset must only be called once the object is Closed (this == %p)", this);
+
+        // the Closed state is set before the TP callback notifies the broker
+        // - must wait for that callback to return before this object can be reused
+        WaitForThreadpoolWorkCallbacks(m_threadPoolWorker.get(), FALSE);
+
+        // tear down the ctsSocket the same way as the d'tor
+        // - the next connection will create its own ctsSocket instance
+        if (m_socket)
+        {
+            m_socket->Shutdown();
+            m_socket.reset();
+        }
+
+        const auto lock = m_stateGuard.lock();
+        m_state = InternalState::Creating;
+        m_lastError = 0;
+        m_initiatedIo = false;
+        m_sweepPoint = -1;
+        m_transitionQpc = 0;
+    }
+
     void ctsSocketState::CompleteState(DWORD error) noexcept
     {
         //
@@ -78,7 +130,7 @@ namespace ctsTraffic
                     else
                     {
                         m_state = InternalState::InitiatingIo;
-                        ctsConfig::g_configSettings->ConnectionStatusDetails.m_activeConnectionCount.Increment();
+                        ctsConfig::g_configSettings->ConnectionStatusDetails.IncrementActiveConnections();
                     }
                     break;
                 }
@@ -86,7 +138,7 @@ namespace ctsTraffic
                 case InternalState::Connected:
                 {
                     m_state = InternalState::InitiatingIo;
-                    ctsConfig::g_configSettings->ConnectionStatusDetails.m_activeConnectionCount.Increment();
+                    ctsConfig::g_configSettings->ConnectionStatusDetails.IncrementActiveConnections();
                     break;
                 }
 
@@ -127,9 +179,40 @@ namespace ctsTraffic
             m_lastError = error;
             m_state = InternalState::Closing;
         }
+        TraceLoggingWrite(
+            g_ctsTraceLoggingProvider,
+            "SocketState",
+            TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+            TraceLoggingKeyword(CTS_TRACE_KEYWORD_CONNECTION),
+            TraceLoggingPointer(this, "SocketState"),
+            TraceLoggingUInt32(static_cast<UINT32>(m_state), "NextState"),
+            TraceLoggingUInt32(error, "Error"));
+        if (!ctsConfig::g_configSettings->LatencyPercentiles.empty())
+        {
+            m_transitionQpc = ctl::ctTimer::SnapQpc();
+        }
+
+        //
+        // -InlineStateTransitions : connecting and initiating IO run on this thread when its caller declared it holds no locks
+        // - closing is always queued : it waits for the callbacks of the socket, and this is usually one of them
+        //
+        if (ctsConfig::g_configSettings->InlineStateTransitions &&
+            t_allowInlineTransition &&
+            t_inlineTransitionDepth < c_maxInlineTransitionDepth &&
+            (InternalState::Connecting == m_state || InternalState::InitiatingIo == m_state))
+        {
+            lock.reset();
+            ctsConfig::g_configSettings->StateTransitionDetails.m_inlineTransitions.Increment();
+            ++t_inlineTransitionDepth;
+            ThreadPoolWorker(nullptr, this, nullptr);
+            --t_inlineTransitionDepth;
+            return;
+        }
+
         //
         // schedule the next functor to run when not closing down the socket
         //
+        ctsConfig::g_configSettings->StateTransitionDetails.m_queuedTransitions.Increment();
         SubmitThreadpoolWork(m_threadPoolWorker.get());
     }
 
@@ -139,6 +222,11 @@ namespace ctsTraffic
         return m_state;
     }
 
+    bool ctsSocketState::IsProbe() const noexcept
+    {
+        return m_probe;
+    }
+
     VOID NTAPI ctsSocketState::ThreadPoolWorker(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) noexcept
     {
         //
@@ -150,18 +238,51 @@ namespace ctsTraffic
         //   needs to know that we already tried to run the functor for this state
         //
         auto* thisPtr = static_cast<ctsSocketState*>(context);
+        if (thisPtr->m_transitionQpc != 0)
+        {
+            const auto transitionTicks = ctl::ctTimer::SnapQpc() - thisPtr->m_transitionQpc;
+            thisPtr->m_transitionQpc = 0;
+            auto& transitionDetails = ctsConfig::g_configSettings->StateTransitionDetails;
+            switch (thisPtr->m_state)
+            {
+                case InternalState::Creating:
+                    transitionDetails.m_createLatency.Record(transitionTicks);
+                    break;
+                case InternalState::Connecting:
+                    transitionDetails.m_connectLatency.Record(transitionTicks);
+                    break;
+                case InternalState::InitiatingIo:
+                    transitionDetails.m_initiateIoLatency.Record(transitionTicks);
+                    break;
+                case InternalState::Closing:
+                    transitionDetails.m_closeLatency.Record(transitionTicks);
+                    break;
+                default:
+                    break;
+            }
+        }
+
         switch (thisPtr->m_state)
         {
             case InternalState::Creating:
             {
                 try
                 {
+                    // -Sweep : the connection is counted against the grid point whose settings it is created with
+                    if (!ctsConfig::g_configSettings->SweepPointConnections.empty())
+                    {
+                        thisPtr->m_sweepPoint = ctl::ctMemoryGuardRead(&ctsConfig::g_configSettings->SweepPoint);
+                        InterlockedIncrement(&ctsConfig::g_configSettings->SweepPointConnections[thisPtr->m_sweepPoint]);
+                    }
+
                     thisPtr->m_socket = std::make_shared<ctsSocket>(thisPtr->shared_from_this());
 
                     auto lock = thisPtr->m_stateGuard.lock();
                     thisPtr->m_state = InternalState::Created;
                     lock.reset();
 
+                    // socket creation completes without the caller holding locks
+                    const InlineTransitionScope inlineTransition;
                     ctsConfig::g_configSettings->CreateFunction(thisPtr->m_socket);
                     PRINT_DEBUG_INFO(L"\t\tctsSocketState Created\n");
                 }
@@ -178,6 +299,7 @@ namespace ctsTraffic
                 thisPtr->m_state = InternalState::Connected;
                 lock.reset();
 
+                const InlineTransitionScope inlineTransition;
                 ctsConfig::g_configSettings->ConnectFunction(thisPtr->m_socket);
                 PRINT_DEBUG_INFO(L"\t\tctsSocketState Connected\n");
                 break;
@@ -187,7 +309,7 @@ namespace ctsTraffic
             {
                 // notify the broker when initiating IO
                 auto parent = thisPtr->m_broker.lock();
-                if (parent)
+                if (parent && !thisPtr->m_probe)
                 {
                     parent->InitiatingIo();
                 }
@@ -200,6 +322,8 @@ namespace ctsTraffic
                     thisPtr->m_state = InternalState::InitiatedIo;
                     lock.reset();
 
+                    // IO functions complete other connections - and this one - with their own locks held
+                    const InlineTransitionScope noInlineTransition(false);
                     ctsConfig::g_configSettings->IoFunction(thisPtr->m_socket);
                     PRINT_DEBUG_INFO(L"\t\tctsSocketState InitiatedIO\n");
                 }
@@ -216,6 +340,7 @@ namespace ctsTraffic
             //   on a threadpool thread - in which case it would deadlock on itself
             case InternalState::Closing:
             {
+                const InlineTransitionScope noInlineTransition(false);
                 if (thisPtr->m_initiatedIo)
                 {
                     // Update the status counter if we previously tracked this connection as active
@@ -246,6 +371,30 @@ namespace ctsTraffic
 
                 if (thisPtr->m_socket)
                 {
+                    // -TargetStatistics : the same outcome is tracked for the target this socket connected to
+                    auto* const targetStatistics = ctsConfig::GetTargetStatistics(thisPtr->m_socket->GetRemoteSockaddr());
+                    if (targetStatistics)
+                    {
+                        if (thisPtr->m_initiatedIo && 0 == thisPtr->m_lastError)
+                        {
+                            targetStatistics->m_successfulConnections.Increment();
+                        }
+                        else if (thisPtr->m_initiatedIo && ctsIoPattern::IsProtocolError(thisPtr->m_lastError))
+                        {
+                            targetStatistics->m_protocolErrors.Increment();
+                        }
+                        else
+                        {
+                            targetStatistics->m_connectionErrors.Increment();
+                        }
+                    }
+
+                    if (ctsConfig::g_configSettings->AccountConnectionMemory)
+                    {
+                        ctsConfig::g_configSettings->ConnectionMemoryDetails.m_socketBytes.Add(static_cast<long long>(sizeof(ctsSocketState)));
+                        thisPtr->m_socket->AccountMemory();
+                    }
+
                     thisPtr->m_socket->CloseSocket(thisPtr->m_lastError);
                     thisPtr->m_socket->PrintPatternResults(thisPtr->m_lastError);
 
@@ -255,14 +404,21 @@ namespace ctsTraffic
                     }
                 }
 
+                if (thisPtr->m_sweepPoint >= 0)
+                {
+                    InterlockedDecrement(&ctsConfig::g_configSettings->SweepPointConnections[thisPtr->m_sweepPoint]);
+                    thisPtr->m_sweepPoint = -1;
+                }
+
                 // update the state last, since ctsBroker looks for this state value
                 // - to know when to delete the ctsSocketState instance
                 auto lock = thisPtr->m_stateGuard.lock();
                 thisPtr->m_state = InternalState::Closed;
                 lock.reset();
 
+                // probe connections are restarted by the broker's timer instead
                 auto parent = thisPtr->m_broker.lock();
-                if (parent)
+                if (parent && !thisPtr->m_probe)
                 {
                     parent->Closing(thisPtr->m_initiatedIo);
                 }
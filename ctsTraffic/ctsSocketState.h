@@ -59,8 +59,9 @@ namespace ctsTraffic
 
         //
         // c'tor requiring a parent ctsSocketBroker
+        // - -Probes : probe connections are not counted against the broker's pending and active connections
         //
-        explicit ctsSocketState(std::weak_ptr<ctsSocketBroker> pBroker);
+        explicit ctsSocketState(std::weak_ptr<ctsSocketBroker> pBroker, bool probe = false);
 
         ~ctsSocketState() noexcept;
 
@@ -71,6 +72,14 @@ namespace ctsTraffic
         //
         void Start() noexcept;
 
+        //
+        // Returns a Closed object to its initial state so it can be Start()'d again for a new connection
+        // - avoids allocating a new object and threadpool work item for every connection
+        // - waits for all callbacks on this object to complete: must not be called from one of those callbacks
+        //   nor while holding a lock those callbacks take (e.g. the broker lock)
+        //
+        void Reset() noexcept;
+
         //
         // Completes the current socket state
         //
@@ -80,6 +89,27 @@ namespace ctsTraffic
         // Accessor to current state information
         //
         InternalState GetCurrentState() const noexcept;
+        bool IsProbe() const noexcept;
+
+        //
+        // -InlineStateTransitions : declares the calling thread holds no locks, so a CompleteState made within the scope
+        // may run the next state inline on this thread instead of queueing it to the threadpool
+        // - a scope constructed with false withdraws that for functors which must not run a state inline
+        //
+        class InlineTransitionScope
+        {
+        public:
+            explicit InlineTransitionScope(bool allowInline = true) noexcept;
+            ~InlineTransitionScope() noexcept;
+
+            InlineTransitionScope(const InlineTransitionScope&) = delete;
+            InlineTransitionScope& operator=(const InlineTransitionScope&) = delete;
+            InlineTransitionScope(InlineTransitionScope&&) = delete;
+            InlineTransitionScope& operator=(InlineTransitionScope&&) = delete;
+
+        private:
+            bool m_priorAllowInline;
+        };
 
         //
         // copy c'tor and assignment
@@ -101,6 +131,11 @@ namespace ctsTraffic
         InternalState m_state = InternalState::Creating;
         int m_lastError = 0UL;
         bool m_initiatedIo = false;
+        const bool m_probe;
+        // -Sweep : the grid point this connection was created with (-1 when not counted against one)
+        long m_sweepPoint = -1;
+        // the QPC the current state was completed (0 when transitions are not timed)
+        long long m_transitionQpc = 0;
 
         //
         // static threadpool callback function
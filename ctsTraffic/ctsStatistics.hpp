@@ -13,9 +13,14 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 #pragma once
 // cpp headers
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <cstring>
 // os headers
 #include <Windows.h>
+#include <WinSock2.h>
+#include <mstcpip.h>
 #include <rpc.h>
 // ctl headers
 #include <ctTimer.hpp>
@@ -27,36 +32,144 @@ namespace ctsTraffic
     namespace ctsStatistics
     {
         constexpr unsigned long c_connectionIdLength = 36 + 1; // UUID strings are 36 chars
+        // -LeanProtocol : the connection ID sent as the 16 bytes of its UUID
+        constexpr unsigned long c_connectionIdBinaryLength = 16;
 
-        template <typename T>
-        void GenerateConnectionId(_In_ T& statisticsObject)
+        namespace details
         {
-            UUID connectionId;
-            RPC_STATUS status = UuidCreate(&connectionId);
-            if (status != RPC_S_OK)
+            // connection IDs are the 16 bytes of a UUID, in the same string form as UuidToStringA
+            // - the first 9 bytes are from one UuidCreate per process (keeping its version and variant bits)
+            // - the last 7 bytes are a per-process counter, so IDs are unique without calling UuidCreate per connection
+            constexpr size_t c_connectionIdPrefixLength = 9;
+            constexpr size_t c_connectionIdCounterLength = c_connectionIdBinaryLength - c_connectionIdPrefixLength;
+
+            struct ConnectionIdPrefix
+            {
+                unsigned char m_bytes[c_connectionIdPrefixLength]{};
+            };
+
+            // throws a wil::ResultException if UuidCreate fails - will be retried on the next call
+            inline const ConnectionIdPrefix& GetConnectionIdPrefix()
+            {
+                static const ConnectionIdPrefix s_prefix = [] {
+                    UUID uuid;
+                    const RPC_STATUS status = UuidCreate(&uuid);
+                    if (status != RPC_S_OK)
+                    {
+                        THROW_WIN32_MSG(status, "UuidCreate (ctsStatistics)");
+                    }
+
+                    // in the order the bytes are written in the UUID string
+                    ConnectionIdPrefix prefix;
+                    prefix.m_bytes[0] = static_cast<unsigned char>(uuid.Data1 >> 24);
+                    prefix.m_bytes[1] = static_cast<unsigned char>(uuid.Data1 >> 16);
+                    prefix.m_bytes[2] = static_cast<unsigned char>(uuid.Data1 >> 8);
+                    prefix.m_bytes[3] = static_cast<unsigned char>(uuid.Data1);
+                    prefix.m_bytes[4] = static_cast<unsigned char>(uuid.Data2 >> 8);
+                    prefix.m_bytes[5] = static_cast<unsigned char>(uuid.Data2);
+                    prefix.m_bytes[6] = static_cast<unsigned char>(uuid.Data3 >> 8);
+                    prefix.m_bytes[7] = static_cast<unsigned char>(uuid.Data3);
+                    prefix.m_bytes[8] = uuid.Data4[0];
+                    return prefix;
+                }();
+                return s_prefix;
+            }
+
+            inline std::atomic<unsigned long long> g_connectionIdCounter{0ULL};
+
+            // writes 2 lower-case hex characters per byte with a table lookup (no branches per character)
+            inline char* WriteHex(_Out_writes_(byteCount * 2) char* output, _In_reads_(byteCount) const unsigned char* bytes, size_t byteCount) noexcept
             {
-                THROW_WIN32_MSG(status, "UuidCreate (ctsStatistics)");
+                static constexpr char c_hexCharacters[] = "0123456789abcdef";
+                for (size_t index = 0; index < byteCount; ++index)
+                {
+                    *output++ = c_hexCharacters[bytes[index] >> 4];
+                    *output++ = c_hexCharacters[bytes[index] & 0x0f];
+                }
+                return output;
             }
 
-            RPC_CSTR connectionIdString = nullptr;
-            status = UuidToStringA(&connectionId, &connectionIdString);
-            if (status != RPC_S_OK)
+            // returns the value of a lower or upper-case hex character, or -1 if it's not one
+            inline int ReadHex(char character) noexcept
             {
-                THROW_WIN32_MSG(status, "UuidToStringA (ctsStatistics)");
+                if (character >= '0' && character <= '9')
+                {
+                    return character - '0';
+                }
+                if (character >= 'a' && character <= 'f')
+                {
+                    return character - 'a' + 10;
+                }
+                if (character >= 'A' && character <= 'F')
+                {
+                    return character - 'A' + 10;
+                }
+                return -1;
             }
-            FAIL_FAST_IF_MSG(
-                // ReSharper disable once CppRedundantParentheses
-                strlen(reinterpret_cast<LPSTR>(connectionIdString)) != (c_connectionIdLength - 1),
-                "UuidToString returned a string not 36 characters long (%Iu)",
-                strlen(reinterpret_cast<LPSTR>(connectionIdString)));
+        }
 
-            const auto copyError = ::memcpy_s(statisticsObject.m_connectionIdentifier, c_connectionIdLength, connectionIdString, c_connectionIdLength);
-            FAIL_FAST_IF_MSG(
-                copyError != 0,
-                "memcpy_s failed trying to copy a UUID string (%d)", copyError);
+        // writes the 36-character string form of the 16 bytes of a connection ID into the (c_connectionIdLength) buffer
+        inline void WriteConnectionId(
+            _Out_writes_(c_connectionIdLength) char* connectionIdentifier,
+            _In_reads_(c_connectionIdBinaryLength) const unsigned char* bytes) noexcept
+        {
+            // 8-4-4-4-12 hex characters, as UuidToStringA
+            char* output = connectionIdentifier;
+            output = details::WriteHex(output, bytes, 4);
+            *output++ = '-';
+            output = details::WriteHex(output, bytes + 4, 2);
+            *output++ = '-';
+            output = details::WriteHex(output, bytes + 6, 2);
+            *output++ = '-';
+            output = details::WriteHex(output, bytes + 8, 2);
+            *output++ = '-';
+            output = details::WriteHex(output, bytes + 10, 6);
+            *output = '\0';
+        }
+
+        // reads the 16 bytes of a connection ID back from its 36-character string form
+        // - returns false if the string is not in the 8-4-4-4-12 form written by WriteConnectionId
+        inline bool ReadConnectionId(
+            _Out_writes_(c_connectionIdBinaryLength) unsigned char* bytes,
+            _In_reads_(c_connectionIdLength) const char* connectionIdentifier) noexcept
+        {
+            const char* input = connectionIdentifier;
+            for (unsigned long index = 0; index < c_connectionIdBinaryLength; ++index)
+            {
+                // the dashes follow the 4th, 6th, 8th and 10th bytes
+                if ((4 == index || 6 == index || 8 == index || 10 == index) && *input++ != '-')
+                {
+                    return false;
+                }
+                const int high = details::ReadHex(*input++);
+                const int low = high < 0 ? -1 : details::ReadHex(*input++);
+                if (low < 0)
+                {
+                    return false;
+                }
+                bytes[index] = static_cast<unsigned char>(high << 4 | low);
+            }
+            return '\0' == *input;
+        }
+
+        // formats a unique 36-character ID into the (c_connectionIdLength) buffer
+        // - can throw a wil::ResultException the first time it's called if UuidCreate fails
+        inline void FormatConnectionId(_Out_writes_(c_connectionIdLength) char* connectionIdentifier)
+        {
+            unsigned char bytes[c_connectionIdBinaryLength];
+            memcpy(bytes, details::GetConnectionIdPrefix().m_bytes, details::c_connectionIdPrefixLength);
+            const auto counter = details::g_connectionIdCounter.fetch_add(1ULL, std::memory_order_relaxed);
+            for (size_t index = 0; index < details::c_connectionIdCounterLength; ++index)
+            {
+                bytes[c_connectionIdBinaryLength - 1 - index] = static_cast<unsigned char>(counter >> (index * 8));
+            }
+            WriteConnectionId(connectionIdentifier, bytes);
+        }
 
-            RpcStringFreeA(&connectionIdString);
-            statisticsObject.m_connectionIdentifier[c_connectionIdLength - 1] = '\0';
+        template <typename T>
+        void GenerateConnectionId(_In_ T& statisticsObject)
+        {
+            FormatConnectionId(statisticsObject.m_connectionIdentifier);
         }
 
         template <typename T>
@@ -184,6 +297,336 @@ namespace ctsTraffic
     };
 
 
+    //
+    // ctsShardedStatsTracking spreads a single process-wide counter across cache-line-aligned slots
+    // - writers only touch the slot for the processor they are currently running on,
+    //   so the interlocked add on the hot IO path no longer bounces one cache line across all cores
+    // - readers sum all slots; this is only done when taking a status snapshot or printing a summary
+    //
+    struct ctsShardedStatsTracking
+    {
+        static constexpr unsigned long c_shardCount = 64; // max processors in a single processor group
+
+    private:
+        struct alignas(64) ctsStatsShard
+        {
+            long long m_value = 0ll;
+        };
+        ctsStatsShard m_shards[c_shardCount]{};
+        long long m_previousValue = 0ll;
+
+        [[nodiscard]] long long* GetCurrentShard() noexcept
+        {
+            // the thread can be rescheduled after reading the processor number
+            // - that's fine: the shard is still updated with an interlocked operation,
+            //   it's just the (rare) case where the cache line is not local
+            return &m_shards[GetCurrentProcessorNumber() % c_shardCount].m_value;
+        }
+
+    public:
+        ctsShardedStatsTracking() noexcept = default;
+        ~ctsShardedStatsTracking() noexcept = default;
+        // a sharded counter is never copied: callers snap a ctsStatsTracking-based view instead
+        ctsShardedStatsTracking(const ctsShardedStatsTracking&) = delete;
+        ctsShardedStatsTracking& operator=(const ctsShardedStatsTracking&) = delete;
+        ctsShardedStatsTracking(ctsShardedStatsTracking&&) = delete;
+        ctsShardedStatsTracking& operator=(ctsShardedStatsTracking&&) = delete;
+
+        [[nodiscard]] long long GetValue() const noexcept
+        {
+            long long sum = 0ll;
+            for (const auto& shard : m_shards)
+            {
+                sum += ctl::ctMemoryGuardRead(&shard.m_value);
+            }
+            return sum;
+        }
+        //
+        // Reads a single processor's slot - for exporting per-processor totals
+        //
+        [[nodiscard]] long long GetShardValue(unsigned long shard) const noexcept
+        {
+            return ctl::ctMemoryGuardRead(&m_shards[shard % c_shardCount].m_value);
+        }
+        //
+        // Adds 1 to the current processor's slot
+        //
+        void Increment() noexcept
+        {
+            ctl::ctMemoryGuardIncrement(GetCurrentShard());
+        }
+        //
+        // Adds the [in] value to the current processor's slot
+        //
+        void Add(long long value) noexcept
+        {
+            ctl::ctMemoryGuardAdd(GetCurrentShard(), value);
+        }
+        //
+        // Updates the previous value with the current (summed) value
+        // - returning the difference (current_value - previous_value)
+        //
+        [[nodiscard]] long long SnapValueDifference() noexcept
+        {
+            const auto captureCurrentValue = GetValue();
+            const auto capturePriorValue = ctl::ctMemoryGuardWrite(&m_previousValue, captureCurrentValue);
+            return captureCurrentValue - capturePriorValue;
+        }
+        //
+        // Returns the difference (current_value - previous_value)
+        // - without modifying either value
+        //
+        [[nodiscard]] long long ReadValueDifference() const noexcept
+        {
+            const auto captureCurrentValue = GetValue();
+            const auto capturePriorValue = ctl::ctMemoryGuardRead(&m_previousValue);
+            return captureCurrentValue - capturePriorValue;
+        }
+    };
+
+    //
+    // ctsLatencySnapshot holds the counts of a log-linear (HDR-style) histogram of QPC tick durations
+    // - durations below 16 ticks each have their own bucket; above that every power of 2 is split into 16 buckets,
+    //   so a bucket's value is within 1/16th (6.25%) of every duration it counts
+    // - durations are clamped to 2^41 ticks (more than 2 days at a 10MHz QPC)
+    //
+    struct ctsLatencySnapshot
+    {
+        static constexpr unsigned long c_subBucketBits = 4;
+        static constexpr unsigned long c_subBucketCount = 1ul << c_subBucketBits;
+        static constexpr unsigned long c_maxMagnitude = 40;
+        static constexpr unsigned long c_bucketCount = (c_maxMagnitude - c_subBucketBits + 2) * c_subBucketCount;
+
+        long long m_counts[c_bucketCount]{};
+
+        static unsigned long BucketIndex(long long ticks) noexcept
+        {
+            if (ticks < static_cast<long long>(c_subBucketCount))
+            {
+                return ticks < 0 ? 0 : static_cast<unsigned long>(ticks);
+            }
+
+            constexpr long long maxTicks = (2LL << c_maxMagnitude) - 1;
+            const auto value = static_cast<unsigned long long>(ticks > maxTicks ? maxTicks : ticks);
+            // _BitScanReverse64 is not available to 32-bit builds
+            unsigned long magnitude;
+            const auto highBits = static_cast<unsigned long>(value >> 32);
+            if (highBits != 0)
+            {
+                _BitScanReverse(&magnitude, highBits);
+                magnitude += 32;
+            }
+            else
+            {
+                _BitScanReverse(&magnitude, static_cast<unsigned long>(value));
+            }
+            const auto subBucket = static_cast<unsigned long>(value >> (magnitude - c_subBucketBits)) & (c_subBucketCount - 1);
+            return (magnitude - c_subBucketBits + 1) * c_subBucketCount + subBucket;
+        }
+
+        static long long ConvertTicksToMicroseconds(long long ticks) noexcept
+        {
+            return ctl::ctTimer::ConvertQpcToMicroseconds(ticks);
+        }
+
+        // the highest duration counted in the bucket
+        static long long BucketValue(unsigned long index) noexcept
+        {
+            if (index < c_subBucketCount)
+            {
+                return index;
+            }
+            const auto magnitude = index / c_subBucketCount + c_subBucketBits - 1;
+            const auto subBucket = index % c_subBucketCount;
+            return static_cast<long long>(((c_subBucketCount + subBucket + 1ull) << (magnitude - c_subBucketBits)) - 1);
+        }
+
+        [[nodiscard]] long long GetCount() const noexcept
+        {
+            long long count = 0;
+            for (const auto& bucketCount : m_counts)
+            {
+                count += bucketCount;
+            }
+            return count;
+        }
+
+        // returns the duration (in QPC ticks) which the percentile [0.0 - 100.0] of durations are at or below
+        [[nodiscard]] long long GetPercentile(double percentile) const noexcept
+        {
+            const auto count = GetCount();
+            if (0 == count)
+            {
+                return 0;
+            }
+
+            auto threshold = static_cast<long long>(std::ceil(percentile / 100.0 * static_cast<double>(count)));
+            if (threshold < 1)
+            {
+                threshold = 1;
+            }
+            long long cumulativeCount = 0;
+            for (unsigned long index = 0; index < c_bucketCount; ++index)
+            {
+                cumulativeCount += m_counts[index];
+                if (cumulativeCount >= threshold)
+                {
+                    return BucketValue(index);
+                }
+            }
+            return GetMaximum();
+        }
+
+        [[nodiscard]] long long GetMaximum() const noexcept
+        {
+            for (auto index = c_bucketCount; index > 0; --index)
+            {
+                if (m_counts[index - 1] != 0)
+                {
+                    return BucketValue(index - 1);
+                }
+            }
+            return 0;
+        }
+
+        // removes the counts of an earlier snapshot of the same histogram - leaving the durations recorded since
+        void Subtract(const ctsLatencySnapshot& prior) noexcept
+        {
+            for (unsigned long index = 0; index < c_bucketCount; ++index)
+            {
+                m_counts[index] -= prior.m_counts[index];
+            }
+        }
+    };
+
+    //
+    // ctsLatencyHistogram is a process-wide ctsLatencySnapshot updated on every IO completion
+    // - sharded by processor like ctsShardedStatsTracking: recording a duration is one interlocked increment
+    //   on a cache line local to the current processor, without any locks
+    // - readers merge all shards; this is only done when taking a status snapshot or printing a summary
+    //
+    struct ctsLatencyHistogram
+    {
+    private:
+        static constexpr unsigned long c_shardCount = 64; // max processors in a single processor group
+        struct alignas(64) ctsLatencyShard
+        {
+            long long m_counts[ctsLatencySnapshot::c_bucketCount]{};
+        };
+        ctsLatencyShard m_shards[c_shardCount]{};
+        // the merged counts as of the last SnapView(true) - only the status thread snaps views
+        ctsLatencySnapshot m_priorCounts;
+
+    public:
+        ctsLatencyHistogram() noexcept = default;
+        ~ctsLatencyHistogram() noexcept = default;
+        ctsLatencyHistogram(const ctsLatencyHistogram&) = delete;
+        ctsLatencyHistogram& operator=(const ctsLatencyHistogram&) = delete;
+        ctsLatencyHistogram(ctsLatencyHistogram&&) = delete;
+        ctsLatencyHistogram& operator=(ctsLatencyHistogram&&) = delete;
+
+        void Record(long long ticks) noexcept
+        {
+            auto& shard = m_shards[GetCurrentProcessorNumber() % c_shardCount];
+            ctl::ctMemoryGuardIncrement(&shard.m_counts[ctsLatencySnapshot::BucketIndex(ticks)]);
+        }
+
+        // the counts of every duration recorded
+        [[nodiscard]] ctsLatencySnapshot GetTotal() const noexcept
+        {
+            ctsLatencySnapshot total;
+            for (const auto& shard : m_shards)
+            {
+                for (unsigned long index = 0; index < ctsLatencySnapshot::c_bucketCount; ++index)
+                {
+                    total.m_counts[index] += ctl::ctMemoryGuardRead(&shard.m_counts[index]);
+                }
+            }
+            return total;
+        }
+
+        //
+        // returns the counts of durations recorded since the last snap
+        // - resetting the baseline if the _In_ bool is true, matching the other status SnapView functions
+        //
+        ctsLatencySnapshot SnapView(bool clear_settings) noexcept
+        {
+            auto returnCounts = GetTotal();
+            for (unsigned long index = 0; index < ctsLatencySnapshot::c_bucketCount; ++index)
+            {
+                const auto currentCount = returnCounts.m_counts[index];
+                returnCounts.m_counts[index] -= m_priorCounts.m_counts[index];
+                if (clear_settings)
+                {
+                    m_priorCounts.m_counts[index] = currentCount;
+                }
+            }
+            return returnCounts;
+        }
+    };
+
+    //
+    // ctsCpuSnapshot captures the CPU consumed by the whole process since it started
+    // - cycles are from QueryProcessCycleTime, which sums the cycle time of every thread (including exited threads),
+    //   so threadpool and dedicated completion threads are all accounted without tracking each thread
+    // - kernel and user times are in 100ns units from GetProcessTimes
+    // - intervals are measured by taking the Difference between two snapshots
+    //
+    struct ctsCpuSnapshot
+    {
+        unsigned long long m_cycles = 0ULL;
+        long long m_kernelTime = 0LL;
+        long long m_userTime = 0LL;
+
+        [[nodiscard]] static ctsCpuSnapshot Snap() noexcept
+        {
+            ctsCpuSnapshot snapshot;
+            ULONG64 cycles = 0;
+            if (QueryProcessCycleTime(GetCurrentProcess(), &cycles))
+            {
+                snapshot.m_cycles = cycles;
+            }
+
+            FILETIME creationTime{};
+            FILETIME exitTime{};
+            FILETIME kernelTime{};
+            FILETIME userTime{};
+            if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+            {
+                snapshot.m_kernelTime = static_cast<long long>(ULARGE_INTEGER{ { kernelTime.dwLowDateTime, kernelTime.dwHighDateTime } }.QuadPart);
+                snapshot.m_userTime = static_cast<long long>(ULARGE_INTEGER{ { userTime.dwLowDateTime, userTime.dwHighDateTime } }.QuadPart);
+            }
+            return snapshot;
+        }
+
+        [[nodiscard]] ctsCpuSnapshot Difference(const ctsCpuSnapshot& prior) const noexcept
+        {
+            ctsCpuSnapshot difference;
+            difference.m_cycles = m_cycles - prior.m_cycles;
+            difference.m_kernelTime = m_kernelTime - prior.m_kernelTime;
+            difference.m_userTime = m_userTime - prior.m_userTime;
+            return difference;
+        }
+
+        // returns the percent of all processors' time the [in] 100ns units were over the [in] milliseconds
+        [[nodiscard]] static double PercentOfSystem(long long time, long long elapsedMilliseconds) noexcept
+        {
+            static const unsigned long c_processorCount = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+            if (elapsedMilliseconds <= 0 || 0 == c_processorCount)
+            {
+                return 0.0;
+            }
+            // 10,000 100ns units per millisecond
+            return static_cast<double>(time) * 100.0 / (static_cast<double>(elapsedMilliseconds) * 10000.0 * c_processorCount);
+        }
+
+        // returns the cycles per [in] unit, or 0 if no units were counted
+        [[nodiscard]] double CyclesPer(long long count) const noexcept
+        {
+            return count > 0 ? static_cast<double>(m_cycles) / static_cast<double>(count) : 0.0;
+        }
+    };
+
     struct ctsConnectionStatistics
     {
         ctsStatsTracking m_startTime;
@@ -192,6 +635,8 @@ namespace ctsTraffic
         ctsStatsTracking m_successfulCompletionCount;
         ctsStatsTracking m_connectionErrorCount;
         ctsStatsTracking m_protocolErrorCount;
+        // the most connections concurrently active over the lifetime (not captured by SnapView)
+        ctsStatsTracking m_peakActiveConnectionCount;
 
         explicit ctsConnectionStatistics(long long start_time = 0LL) noexcept :
             m_startTime(start_time)
@@ -229,6 +674,112 @@ namespace ctsTraffic
 
             return returnStats;
         }
+
+        //
+        // increments the active connection count, raising the peak count if it was exceeded
+        //
+        void IncrementActiveConnections() noexcept
+        {
+            const auto activeCount = m_activeConnectionCount.Increment();
+            auto peakCount = m_peakActiveConnectionCount.GetValue();
+            while (activeCount > peakCount)
+            {
+                const auto priorPeakCount = m_peakActiveConnectionCount.SetConditionally(activeCount, peakCount);
+                if (priorPeakCount == peakCount)
+                {
+                    break;
+                }
+                peakCount = priorPeakCount;
+            }
+        }
+    };
+
+    //
+    // the hops each ctsSocketState makes from completing one state of a connection to running the next
+    // - with -InlineStateTransitions, connecting and initiating IO can run inline on the completing thread
+    // - the QPC ticks from completing a state (or starting the connection) to running the next are only
+    //   recorded with -LatencyPercentiles
+    //
+    struct ctsStateTransitionStatistics
+    {
+        ctsShardedStatsTracking m_inlineTransitions;
+        ctsShardedStatsTracking m_queuedTransitions;
+        ctsLatencyHistogram m_createLatency;
+        ctsLatencyHistogram m_connectLatency;
+        ctsLatencyHistogram m_initiateIoLatency;
+        ctsLatencyHistogram m_closeLatency;
+
+        ctsStateTransitionStatistics() noexcept = default;
+        ~ctsStateTransitionStatistics() noexcept = default;
+        ctsStateTransitionStatistics(const ctsStateTransitionStatistics&) = delete;
+        ctsStateTransitionStatistics& operator=(const ctsStateTransitionStatistics&) = delete;
+        ctsStateTransitionStatistics(ctsStateTransitionStatistics&&) = delete;
+        ctsStateTransitionStatistics& operator=(ctsStateTransitionStatistics&&) = delete;
+    };
+
+    //
+    // -MemoryAccounting:on : the memory each connection held, added up as each connection closes
+    // - plus the process private bytes and non-paged pool sampled with each status update
+    //
+    struct ctsConnectionMemoryStatistics
+    {
+        ctsStatsTracking m_accountedConnections;
+        // the ctsSocketState and ctsSocket objects, less the timer members counted in m_timerBytes
+        ctsStatsTracking m_socketBytes;
+        // the ctsIoPattern object of the type created for the -Pattern
+        ctsStatsTracking m_patternBytes;
+        // the recv buffer container and its free list of recv buffers
+        ctsStatsTracking m_recvBufferBytes;
+        // the -verify:seeded payload slots sends are made from (sends otherwise share the process-wide buffer)
+        ctsStatsTracking m_sendBufferBytes;
+        // the slice of RIO registered memory leased by the connection
+        ctsStatsTracking m_rioRegisteredBytes;
+        // allocations made by the pattern to track its outstanding tasks (request timestamps, the jitter buffer)
+        ctsStatsTracking m_taskBytes;
+        // the timer wheel entry, the scheduled task and its callback, and the high-resolution timer objects
+        ctsStatsTracking m_timerBytes;
+        // the ctThreadIocp object the socket's IO completes through
+        ctsStatsTracking m_threadIocpBytes;
+
+        // the process-wide samples taken with each status update
+        ctsStatsTracking m_privateBytes;
+        ctsStatsTracking m_nonPagedPoolBytes;
+        ctsStatsTracking m_peakPrivateBytes;
+        ctsStatsTracking m_peakNonPagedPoolBytes;
+
+        // the bytes accounted to each connection closed so far, 0 if none were
+        [[nodiscard]] long long GetBytesPerConnection() const noexcept
+        {
+            const auto connections = m_accountedConnections.GetValue();
+            if (0 == connections)
+            {
+                return 0LL;
+            }
+            return (m_socketBytes.GetValue() +
+                    m_patternBytes.GetValue() +
+                    m_recvBufferBytes.GetValue() +
+                    m_sendBufferBytes.GetValue() +
+                    m_rioRegisteredBytes.GetValue() +
+                    m_taskBytes.GetValue() +
+                    m_timerBytes.GetValue() +
+                    m_threadIocpBytes.GetValue()) / connections;
+        }
+
+        // updates the current process samples, raising the peaks if they were exceeded
+        // - only called from the status update, so the peaks have a single writer
+        void SampleProcess(long long privateBytes, long long nonPagedPoolBytes) noexcept
+        {
+            m_privateBytes.SetValue(privateBytes);
+            m_nonPagedPoolBytes.SetValue(nonPagedPoolBytes);
+            if (privateBytes > m_peakPrivateBytes.GetValue())
+            {
+                m_peakPrivateBytes.SetValue(privateBytes);
+            }
+            if (nonPagedPoolBytes > m_peakNonPagedPoolBytes.GetValue())
+            {
+                m_peakNonPagedPoolBytes.SetValue(nonPagedPoolBytes);
+            }
+        }
     };
 
     struct ctsUdpStatistics
@@ -296,6 +847,220 @@ namespace ctsTraffic
         }
     };
 
+    //
+    // the minimum, maximum, and sum of one value across SIO_TCP_INFO samples
+    //
+    struct ctsTcpInfoValue
+    {
+        unsigned long m_minimum = ULONG_MAX;
+        unsigned long m_maximum = 0;
+        unsigned long long m_sum = 0;
+
+        void Add(unsigned long value) noexcept
+        {
+            m_minimum = value < m_minimum ? value : m_minimum;
+            m_maximum = value > m_maximum ? value : m_maximum;
+            m_sum += value;
+        }
+
+        void Merge(const ctsTcpInfoValue& rhs) noexcept
+        {
+            m_minimum = rhs.m_minimum < m_minimum ? rhs.m_minimum : m_minimum;
+            m_maximum = rhs.m_maximum > m_maximum ? rhs.m_maximum : m_maximum;
+            m_sum += rhs.m_sum;
+        }
+
+        [[nodiscard]] unsigned long GetMinimum() const noexcept
+        {
+            return ULONG_MAX == m_minimum ? 0 : m_minimum;
+        }
+
+        [[nodiscard]] unsigned long long GetAverage(unsigned long long sampleCount) const noexcept
+        {
+            return sampleCount > 0 ? m_sum / sampleCount : 0;
+        }
+    };
+
+    //
+    // transport state sampled with SIO_TCP_INFO while a connection is transmitting data (-TcpInfo)
+    // - RTT, cwnd, bytes in flight and the MSS track every sample
+    // - the retransmit counters are cumulative for a connection, so only the latest sample is kept
+    //   (Merge sums them across connections)
+    // - not thread safe: the per-connection object is guarded by the ctsSocket lock
+    //
+    struct ctsTcpInfoStatistics
+    {
+        unsigned long long m_sampleCount = 0;
+        ctsTcpInfoValue m_rttMicroseconds;
+        ctsTcpInfoValue m_congestionWindow;
+        ctsTcpInfoValue m_bytesInFlight;
+        ctsTcpInfoValue m_mss;
+        unsigned long long m_bytesRetransmitted = 0;
+        unsigned long long m_fastRetransmits = 0;
+        unsigned long long m_timeoutEpisodes = 0;
+
+        void AddSample(const TCP_INFO_v0& tcpInfo) noexcept
+        {
+            ++m_sampleCount;
+            m_rttMicroseconds.Add(tcpInfo.RttUs);
+            m_congestionWindow.Add(tcpInfo.Cwnd);
+            m_bytesInFlight.Add(tcpInfo.BytesInFlight);
+            m_mss.Add(tcpInfo.Mss);
+            m_bytesRetransmitted = tcpInfo.BytesRetrans;
+            m_fastRetransmits = tcpInfo.FastRetrans;
+            m_timeoutEpisodes = tcpInfo.TimeoutEpisodes;
+        }
+
+        void Merge(const ctsTcpInfoStatistics& rhs) noexcept
+        {
+            m_sampleCount += rhs.m_sampleCount;
+            m_rttMicroseconds.Merge(rhs.m_rttMicroseconds);
+            m_congestionWindow.Merge(rhs.m_congestionWindow);
+            m_bytesInFlight.Merge(rhs.m_bytesInFlight);
+            m_mss.Merge(rhs.m_mss);
+            m_bytesRetransmitted += rhs.m_bytesRetransmitted;
+            m_fastRetransmits += rhs.m_fastRetransmits;
+            m_timeoutEpisodes += rhs.m_timeoutEpisodes;
+        }
+    };
+
+    //
+    // the socket buffers sized to one connection's bandwidth-delay product (-RecvBufValue:auto, -SendBufValue:auto)
+    // - measured once over the first IO of the connection : all zero if the connection closed before it was measured
+    // - a buffer not auto-sized stays zero
+    // - not thread safe: the per-connection object is guarded by the ctsSocket lock
+    //
+    struct ctsBufferSizing
+    {
+        unsigned long m_rttMicroseconds = 0;
+        unsigned long long m_bytesPerSecond = 0;
+        unsigned long m_bdpBytes = 0;
+        unsigned long m_recvBufBytes = 0;
+        unsigned long m_sendBufBytes = 0;
+    };
+
+    //
+    // the time each transfer over one connection took (-PersistentTransfers)
+    // - the first transfer starts with a cold connection : the transfers after it reuse the open congestion window
+    // - timed from the first IO of a transfer to the end of its last IO (before its completion message)
+    // - not thread safe: the per-connection object is guarded by the ctsSocket lock
+    //
+    struct ctsTransferTimings
+    {
+        unsigned long m_transferCount = 0;
+        long long m_firstTransferMicroseconds = 0;
+        long long m_warmTransferMicroseconds = 0;
+        long long m_slowestWarmTransferMicroseconds = 0;
+
+        void AddTransfer(long long microseconds) noexcept
+        {
+            if (0 == m_transferCount)
+            {
+                m_firstTransferMicroseconds = microseconds;
+            }
+            else
+            {
+                m_warmTransferMicroseconds += microseconds;
+                m_slowestWarmTransferMicroseconds = microseconds > m_slowestWarmTransferMicroseconds ? microseconds : m_slowestWarmTransferMicroseconds;
+            }
+            ++m_transferCount;
+        }
+
+        [[nodiscard]] long long GetAverageWarmTransferMicroseconds() const noexcept
+        {
+            return m_transferCount > 1 ? m_warmTransferMicroseconds / (m_transferCount - 1) : 0LL;
+        }
+    };
+
+    //
+    // the bytes sent and received by one connection within each -ConnectionSamples interval
+    // - the most recent c_ringSize intervals are kept in a preallocated ring to be written with the connection's results
+    // - the minimum, maximum and stall counts are reduced over every completed interval
+    //   (a stall is an interval without a single byte sent or received)
+    // - the final, partial interval is not counted
+    // - not thread safe: the per-connection object is guarded by the ctsSocket lock
+    //
+    struct ctsConnectionSamples
+    {
+        static constexpr long long c_ringSize = 32;
+
+        std::array<long long, c_ringSize> m_ring{};
+        long long m_intervalCount = 0;
+        long long m_currentInterval = 0;
+        long long m_currentBytes = 0;
+        long long m_minimumBytes = LLONG_MAX;
+        long long m_maximumBytes = 0;
+        long long m_stallCount = 0;
+        long long m_longestStall = 0;
+        long long m_currentStall = 0;
+
+        // interval is the zero-based interval since the connection started in which these bytes completed
+        void AddBytes(long long interval, long long bytes) noexcept
+        {
+            if (interval > m_currentInterval)
+            {
+                CompleteInterval(m_currentBytes);
+
+                // every interval skipped over had no bytes : only the last c_ringSize of them can be in the ring
+                const long long skippedIntervals = interval - m_currentInterval - 1;
+                if (skippedIntervals > 0)
+                {
+                    const long long ringIntervals = skippedIntervals < c_ringSize ? skippedIntervals : c_ringSize;
+                    m_intervalCount += skippedIntervals - ringIntervals;
+                    for (long long skipped = 0; skipped < ringIntervals; ++skipped)
+                    {
+                        m_ring[m_intervalCount % c_ringSize] = 0;
+                        ++m_intervalCount;
+                    }
+                    m_minimumBytes = 0;
+                    m_stallCount += skippedIntervals;
+                    m_currentStall += skippedIntervals;
+                    m_longestStall = m_currentStall > m_longestStall ? m_currentStall : m_longestStall;
+                }
+
+                m_currentInterval = interval;
+                m_currentBytes = 0;
+            }
+            m_currentBytes += bytes;
+        }
+
+        [[nodiscard]] long long GetMinimumBytes() const noexcept
+        {
+            return LLONG_MAX == m_minimumBytes ? 0 : m_minimumBytes;
+        }
+
+        // the number of intervals held in the ring
+        [[nodiscard]] long long GetSampleCount() const noexcept
+        {
+            return m_intervalCount < c_ringSize ? m_intervalCount : c_ringSize;
+        }
+
+        // index 0 is the oldest interval held in the ring
+        [[nodiscard]] long long GetSample(long long index) const noexcept
+        {
+            return m_ring[(m_intervalCount - GetSampleCount() + index) % c_ringSize];
+        }
+
+    private:
+        void CompleteInterval(long long bytes) noexcept
+        {
+            m_ring[m_intervalCount % c_ringSize] = bytes;
+            ++m_intervalCount;
+            m_minimumBytes = bytes < m_minimumBytes ? bytes : m_minimumBytes;
+            m_maximumBytes = bytes > m_maximumBytes ? bytes : m_maximumBytes;
+            if (0 == bytes)
+            {
+                ++m_stallCount;
+                ++m_currentStall;
+                m_longestStall = m_currentStall > m_longestStall ? m_currentStall : m_longestStall;
+            }
+            else
+            {
+                m_currentStall = 0;
+            }
+        }
+    };
+
     struct ctsTcpStatistics
     {
         ctsStatsTracking m_startTime;
@@ -304,6 +1069,14 @@ namespace ctsTraffic
         ctsStatsTracking m_bytesRecv;
         // unique connection identifier
         char m_connectionIdentifier[ctsStatistics::c_connectionIdLength]{};
+        // SIO_TCP_INFO samples - only taken with -TcpInfo
+        ctsTcpInfoStatistics m_tcpInfo;
+        // bytes per interval - only sampled with -ConnectionSamples
+        ctsConnectionSamples m_samples;
+        // the buffers sized to the measured BDP - only with -RecvBufValue:auto or -SendBufValue:auto
+        ctsBufferSizing m_bufferSizing;
+        // the time taken by each transfer over the connection - only with -PersistentTransfers
+        ctsTransferTimings m_transferTimings;
 
         explicit ctsTcpStatistics(long long current_time = 0LL) noexcept :
             m_startTime(current_time)
@@ -355,4 +1128,232 @@ namespace ctsTraffic
             return returnStats;
         }
     };
+
+    //
+    // process-wide aggregates updated on every IO completion for status updates
+    // - the counters are sharded to avoid cross-core contention
+    // - SnapView returns the same ctsUdpStatistics / ctsTcpStatistics view as the per-connection types
+    //   so the status formatting is unchanged
+    //
+    struct ctsUdpStatusStatistics
+    {
+        ctsStatsTracking m_startTime;
+        ctsShardedStatsTracking m_bitsReceived;
+        ctsShardedStatsTracking m_successfulFrames;
+        ctsShardedStatsTracking m_droppedFrames;
+        ctsShardedStatsTracking m_duplicateFrames;
+        ctsShardedStatsTracking m_errorFrames;
+        // send calls made by MediaStream servers (one per datagram, or one per frame with UDP Send Offload)
+        ctsShardedStatsTracking m_sendCalls;
+        // MediaStream server sends that pended because the send buffer was full - a synchronous send would have blocked
+        ctsShardedStatsTracking m_pendedSends;
+        // -Pattern:Blast : datagrams posted by servers, and the datagrams clients received (each sequence number once),
+        // the datagrams clients expected (up to the highest sequence number each received), and those received out of order
+        ctsShardedStatsTracking m_blastDatagramsSent;
+        ctsShardedStatsTracking m_blastDatagramsReceived;
+        ctsShardedStatsTracking m_blastDatagramsExpected;
+        ctsShardedStatsTracking m_blastDatagramsReordered;
+
+        ctsUdpStatusStatistics() noexcept = default;
+        ~ctsUdpStatusStatistics() noexcept = default;
+        ctsUdpStatusStatistics(const ctsUdpStatusStatistics&) = delete;
+        ctsUdpStatusStatistics& operator=(const ctsUdpStatusStatistics&) = delete;
+        ctsUdpStatusStatistics(ctsUdpStatusStatistics&&) = delete;
+        ctsUdpStatusStatistics& operator=(ctsUdpStatusStatistics&&) = delete;
+
+        [[nodiscard]] long long GetBytesReceived() const noexcept
+        {
+            return m_bitsReceived.GetValue() / 8;
+        }
+
+        ctsUdpStatistics SnapView(bool clear_settings) noexcept
+        {
+            const long long currentTime = ctl::ctTimer::SnapQpcInMillis();
+            const long long priorTimeRead = clear_settings ?
+                m_startTime.SetPriorValue(currentTime) :
+                m_startTime.GetPriorValue();
+
+            ctsUdpStatistics returnStats(priorTimeRead);
+            returnStats.m_endTime.SetValue(currentTime);
+
+            if (clear_settings)
+            {
+                returnStats.m_bitsReceived.SetValue(m_bitsReceived.SnapValueDifference());
+                returnStats.m_successfulFrames.SetValue(m_successfulFrames.SnapValueDifference());
+                returnStats.m_droppedFrames.SetValue(m_droppedFrames.SnapValueDifference());
+                returnStats.m_duplicateFrames.SetValue(m_duplicateFrames.SnapValueDifference());
+                returnStats.m_errorFrames.SetValue(m_errorFrames.SnapValueDifference());
+            }
+            else
+            {
+                returnStats.m_bitsReceived.SetValue(m_bitsReceived.ReadValueDifference());
+                returnStats.m_successfulFrames.SetValue(m_successfulFrames.ReadValueDifference());
+                returnStats.m_droppedFrames.SetValue(m_droppedFrames.ReadValueDifference());
+                returnStats.m_duplicateFrames.SetValue(m_duplicateFrames.ReadValueDifference());
+                returnStats.m_errorFrames.SetValue(m_errorFrames.ReadValueDifference());
+            }
+
+            return returnStats;
+        }
+
+        //
+        // returns the number of send calls made since the last snap
+        // - resetting the baseline if the _In_ bool is true, matching SnapView
+        //
+        [[nodiscard]] long long SnapSendCalls(bool clear_settings) noexcept
+        {
+            return clear_settings ? m_sendCalls.SnapValueDifference() : m_sendCalls.ReadValueDifference();
+        }
+    };
+
+    struct ctsTcpStatusStatistics
+    {
+        ctsStatsTracking m_startTime;
+        ctsShardedStatsTracking m_bytesSent;
+        ctsShardedStatsTracking m_bytesRecv;
+        // RIO completions and the number of RIODequeueCompletion calls which returned them
+        ctsShardedStatsTracking m_rioCompletions;
+        ctsShardedStatsTracking m_rioDequeues;
+        // RIO sends and recvs posted, and the number of times the RQ was notified of them
+        // - a request posted without RIO_MSG_DEFER commits itself, deferred requests are committed together
+        ctsShardedStatsTracking m_rioPosts;
+        ctsShardedStatsTracking m_rioCommits;
+        // successfully completed sends and recvs - the denominator of the -CpuEfficiency cycles per IO
+        ctsShardedStatsTracking m_ioCompletions;
+        // -InlineCompletionBudget : sends and recvs completed inline, and the times a connection used up its budget
+        // and yielded its thread by continuing on the threadpool - only counted with a budget
+        ctsShardedStatsTracking m_inlineCompletions;
+        ctsShardedStatsTracking m_inlineYields;
+        // -MessageSize : the messages sent and received, the send and recv completions which carried them,
+        // and the recvs which completed part way through a message
+        ctsShardedStatsTracking m_messagesSent;
+        ctsShardedStatsTracking m_messagesRecv;
+        ctsShardedStatsTracking m_messageSends;
+        ctsShardedStatsTracking m_messageRecvs;
+        ctsShardedStatsTracking m_splitMessageRecvs;
+        // QPC ticks from InitiateIo to CompleteIo for every send and recv - only recorded with -LatencyPercentiles
+        ctsLatencyHistogram m_ioLatency;
+        // QPC ticks from posting ConnectEx or AcceptEx to its successful completion - only recorded with -LatencyPercentiles
+        ctsLatencyHistogram m_connectionLatency;
+        // QPC ticks from posting ConnectEx to the first bytes received on the connection - only recorded with -LatencyPercentiles
+        ctsLatencyHistogram m_firstByteLatency;
+        // -Pattern:RequestResponse : completed transactions and the QPC ticks from issuing each request to receiving its full response
+        ctsShardedStatsTracking m_transactions;
+        ctsLatencyHistogram m_transactionLatency;
+        // -Probes : the QPC ticks from scheduling each probe ping to receiving its echo
+        ctsLatencyHistogram m_probeLatency;
+        // -PersistentTransfers : the first transfer over each connection (cold) and the transfers which followed it (warm)
+        // - the count of each, and the sum of their bytes and microseconds
+        ctsShardedStatsTracking m_coldTransfers;
+        ctsShardedStatsTracking m_coldTransferBytes;
+        ctsShardedStatsTracking m_coldTransferMicroseconds;
+        ctsShardedStatsTracking m_warmTransfers;
+        ctsShardedStatsTracking m_warmTransferBytes;
+        ctsShardedStatsTracking m_warmTransferMicroseconds;
+        // -acc:AcceptEx : AcceptEx requests currently posted across all listeners,
+        // and accepted connections queued waiting for a ctsSocket to be handed to (not captured by SnapView)
+        ctsStatsTracking m_acceptExPosted;
+        ctsStatsTracking m_acceptExQueued;
+        // -IO:RIO : CQ slots currently reserved for outstanding IO across all CQs (not captured by SnapView)
+        ctsStatsTracking m_rioCompletionQueueUsed;
+
+        ctsTcpStatusStatistics() noexcept = default;
+        ~ctsTcpStatusStatistics() noexcept = default;
+        ctsTcpStatusStatistics(const ctsTcpStatusStatistics&) = delete;
+        ctsTcpStatusStatistics& operator=(const ctsTcpStatusStatistics&) = delete;
+        ctsTcpStatusStatistics(ctsTcpStatusStatistics&&) = delete;
+        ctsTcpStatusStatistics& operator=(ctsTcpStatusStatistics&&) = delete;
+
+        ctsTcpStatistics SnapView(bool clear_settings) noexcept
+        {
+            const long long currentTime = ctl::ctTimer::SnapQpcInMillis();
+            const long long priorTimeRead = clear_settings ?
+                m_startTime.SetPriorValue(currentTime) :
+                m_startTime.GetPriorValue();
+
+            ctsTcpStatistics returnStats(priorTimeRead);
+            returnStats.m_endTime.SetValue(currentTime);
+
+            if (clear_settings)
+            {
+                returnStats.m_bytesSent.SetValue(m_bytesSent.SnapValueDifference());
+                returnStats.m_bytesRecv.SetValue(m_bytesRecv.SnapValueDifference());
+            }
+            else
+            {
+                returnStats.m_bytesSent.SetValue(m_bytesSent.ReadValueDifference());
+                returnStats.m_bytesRecv.SetValue(m_bytesRecv.ReadValueDifference());
+            }
+
+            return returnStats;
+        }
+
+        //
+        // returns the average number of RIO completions returned per dequeue since the last snap
+        // - resetting the baseline if the _In_ bool is true, matching SnapView
+        //
+        //
+        // returns the number of sends and recvs completed since the last snap
+        // - resetting the baseline if the _In_ bool is true, matching SnapView
+        //
+        [[nodiscard]] long long SnapIoCompletions(bool clear_settings) noexcept
+        {
+            return clear_settings ? m_ioCompletions.SnapValueDifference() : m_ioCompletions.ReadValueDifference();
+        }
+
+        [[nodiscard]] double SnapRioCompletionsPerDequeue(bool clear_settings) noexcept
+        {
+            const auto completions = clear_settings ? m_rioCompletions.SnapValueDifference() : m_rioCompletions.ReadValueDifference();
+            const auto dequeues = clear_settings ? m_rioDequeues.SnapValueDifference() : m_rioDequeues.ReadValueDifference();
+            return dequeues > 0 ? static_cast<double>(completions) / static_cast<double>(dequeues) : 0.0;
+        }
+
+        [[nodiscard]] double SnapRioPostsPerCommit(bool clear_settings) noexcept
+        {
+            const auto posts = clear_settings ? m_rioPosts.SnapValueDifference() : m_rioPosts.ReadValueDifference();
+            const auto commits = clear_settings ? m_rioCommits.SnapValueDifference() : m_rioCommits.ReadValueDifference();
+            return commits > 0 ? static_cast<double>(posts) / static_cast<double>(commits) : 0.0;
+        }
+
+        //
+        // SIO_TCP_INFO samples are folded in once per connection as it completes - only taken with -TcpInfo
+        //
+        void MergeTcpInfo(const ctsTcpInfoStatistics& tcpInfo) noexcept
+        {
+            const auto lock = m_tcpInfoLock.lock();
+            m_tcpInfo.Merge(tcpInfo);
+        }
+
+        [[nodiscard]] ctsTcpInfoStatistics GetTcpInfo() const noexcept
+        {
+            const auto lock = m_tcpInfoLock.lock();
+            return m_tcpInfo;
+        }
+
+    private:
+        mutable wil::critical_section m_tcpInfoLock;
+        ctsTcpInfoStatistics m_tcpInfo;
+    };
+
+    //
+    // -TargetStatistics : the traffic and connection outcomes of the connections made to one -Target address
+    // - updated alongside the process-wide counters
+    //
+    struct ctsTargetStatistics
+    {
+        ctsShardedStatsTracking m_bytesSent;
+        ctsShardedStatsTracking m_bytesRecv;
+        ctsStatsTracking m_successfulConnections;
+        ctsStatsTracking m_connectionErrors;
+        ctsStatsTracking m_protocolErrors;
+        // QPC ticks from InitiateIo to CompleteIo for every send and recv - only recorded with -LatencyPercentiles
+        ctsLatencyHistogram m_ioLatency;
+
+        ctsTargetStatistics() noexcept = default;
+        ~ctsTargetStatistics() noexcept = default;
+        ctsTargetStatistics(const ctsTargetStatistics&) = delete;
+        ctsTargetStatistics& operator=(const ctsTargetStatistics&) = delete;
+        ctsTargetStatistics(ctsTargetStatistics&&) = delete;
+        ctsTargetStatistics& operator=(ctsTargetStatistics&&) = delete;
+    };
 }
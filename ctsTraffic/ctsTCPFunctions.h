@@ -14,7 +14,12 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <functional>
 #include <memory>
+// os headers
+#include <WinSock2.h>
+// ctl headers
+#include <ctSockaddr.hpp>
 // project headers
 #include "ctsSocket.h"
 
@@ -32,5 +37,56 @@ namespace ctsTraffic
 
     void ctsReadWriteIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
     void ctsSendRecvIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    // -io:coroutine : each connection is a single coroutine posting WSASend/WSARecv and awaiting their completions
+    void ctsSendRecvCoroutine(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
     void ctsRioIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    void ctsSocketNotifications(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    // -io:tls : negotiates a Schannel TLS session on the connection, then runs the IO pattern over its records
+    void ctsTlsIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    // -Relay : pairs the accepted connection with a connection to the next -Relay address, forwarding bytes in both directions
+    void ctsRelayIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    // -io:memory : assigns the addresses of a connection with no SOCKET, and 'connects' it in-process
+    void ctsMemorySocket(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    void ctsMemoryConnect(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    // -io:memory : pairs the connection's IO pattern with a server IO pattern over in-memory channels
+    void ctsMemoryIo(const std::weak_ptr<ctsSocket>& weakSocket) noexcept;
+    // creates the RQ for sending datagrams with RIOSendEx from a socket shared across MediaStream 'connections'
+    // - can throw wil::ResultException on a Win32 error
+    void ctsRioRegisterDatagramSocket(SOCKET socket);
+    // copies the datagram into registered memory and posts it with RIOSendEx to the target
+    // - returns NO_ERROR once posted : failures are printed as their completions are dequeued
+    // - sendCompleted (if given) is invoked once the completion is dequeued, and only if posted
+    int ctsRioSendDatagram(
+        SOCKET socket,
+        const ctl::ctSockaddr& targetAddress,
+        _In_reads_(bufferCount) const WSABUF* buffers,
+        DWORD bufferCount,
+        _Out_ DWORD* bytesPosted,
+        std::function<void()> sendCompleted = {}) noexcept;
+    // -io:xdp : false if ctsTraffic was built without the XDP for Windows headers
+    bool ctsXdpIsSupported() noexcept;
+    // binds an AF_XDP socket to each of the first -XdpQueues RSS queues of the interface owning localAddr
+    // - every datagram sent from the socket is then written directly into their TX rings
+    // - can throw wil::ResultException on a Win32 error
+    void ctsXdpRegisterDatagramSocket(SOCKET socket, const ctl::ctSockaddr& localAddr);
+    // writes the datagram with its Ethernet, IP and UDP headers (IP fragmented to the MTU) into an AF_XDP TX ring
+    // - returns NO_ERROR once posted
+    // - sendCompleted (if given) is invoked once the completion of its last packet is reaped, and only if posted
+    int ctsXdpSendDatagram(
+        SOCKET socket,
+        const ctl::ctSockaddr& targetAddress,
+        _In_reads_(bufferCount) const WSABUF* buffers,
+        DWORD bufferCount,
+        _Out_ DWORD* bytesPosted,
+        std::function<void()> sendCompleted = {}) noexcept;
+    // prints RIO completion statistics if RIO was used
+    void ctsRioPrintSummary() noexcept;
+    // prints the packets sent and the CPU time reaping their completions if -io:xdp was used
+    void ctsXdpPrintSummary() noexcept;
+    // prints the engine throughput ceiling measured with -io:memory
+    void ctsMemoryPrintSummary(long long totalTimeMilliseconds) noexcept;
+    // prints the TLS handshake rate, encrypted throughput and cycles per byte if -io:tls was used
+    void ctsTlsPrintSummary(long long totalTimeMilliseconds) noexcept;
+    // prints the forwarded throughput, the latency added by forwarding and the CPU per forwarded byte if -Relay was used
+    void ctsRelayPrintSummary(long long totalTimeMilliseconds) noexcept;
 }
@@ -0,0 +1,156 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// declaration header
+#include "ctsThreadStatistics.h"
+// cpp headers
+#include <memory>
+#include <vector>
+// wil headers
+#include <wil/resource.h>
+#include <wil/stl.h>
+#include <wil/win32_helpers.h>
+// project headers
+#include "ctsStatistics.hpp"
+
+namespace ctsTraffic::ctsThreadStatistics
+{
+    namespace
+    {
+        struct ctsThreadCounters
+        {
+            explicit ctsThreadCounters(DWORD threadId) noexcept :
+                m_threadId(threadId)
+            {
+            }
+
+            const DWORD m_threadId;
+            ctsStatsTracking m_completions;
+            ctsStatsTracking m_inlineCompletions;
+            ctsStatsTracking m_bytes;
+            ctsStatsTracking m_callbackQpc;
+        };
+
+        // counters are never removed: threadpool threads can exit and be recreated,
+        // so the list is bounded by the threads created over the run
+        wil::critical_section g_threadCountersLock{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };
+        std::vector<std::unique_ptr<ctsThreadCounters>> g_threadCounters;
+        long long g_priorStatusTimeMilliseconds = 0LL;
+
+        thread_local ctsThreadCounters* t_threadCounters = nullptr;
+
+        ctsThreadCounters* GetThreadCounters() noexcept
+        {
+            if (!t_threadCounters)
+            {
+                try
+                {
+                    auto newCounters = std::make_unique<ctsThreadCounters>(GetCurrentThreadId());
+                    const auto lock = g_threadCountersLock.lock();
+                    g_threadCounters.push_back(std::move(newCounters));
+                    t_threadCounters = g_threadCounters.back().get();
+                }
+                catch (...)
+                {
+                    // not tracking this thread if out of memory
+                }
+            }
+            return t_threadCounters;
+        }
+    }
+
+    namespace Details
+    {
+        void RecordCompletion(unsigned long bytes, bool inlineCompletion) noexcept
+        {
+            auto* const counters = GetThreadCounters();
+            if (counters)
+            {
+                // only this thread writes its counters: interlocked only to publish them to the status update
+                counters->m_completions.Increment();
+                if (inlineCompletion)
+                {
+                    counters->m_inlineCompletions.Increment();
+                }
+                counters->m_bytes.Add(bytes);
+            }
+        }
+
+        void RecordCallbackTime(long long callbackQpc) noexcept
+        {
+            auto* const counters = GetThreadCounters();
+            if (counters)
+            {
+                counters->m_callbackQpc.Add(callbackQpc);
+            }
+        }
+    }
+
+    std::wstring FormatStatus(long long currentTimeMilliseconds) noexcept
+        try
+    {
+        const long long intervalMilliseconds = currentTimeMilliseconds - g_priorStatusTimeMilliseconds;
+        g_priorStatusTimeMilliseconds = currentTimeMilliseconds;
+
+        std::wstring status;
+        long long totalCompletions = 0;
+        long long maxCompletions = 0;
+        size_t threadCount = 0;
+        {
+            const auto lock = g_threadCountersLock.lock();
+            for (const auto& counters : g_threadCounters)
+            {
+                const auto completions = counters->m_completions.SnapValueDifference();
+                const auto inlineCompletions = counters->m_inlineCompletions.SnapValueDifference();
+                const auto bytes = counters->m_bytes.SnapValueDifference();
+                const auto callbackMilliseconds = ctl::ctTimer::ConvertQpcToMillis(counters->m_callbackQpc.SnapValueDifference());
+                const auto idleMilliseconds = intervalMilliseconds > callbackMilliseconds ? intervalMilliseconds - callbackMilliseconds : 0LL;
+
+                status.append(
+                    wil::str_printf<std::wstring>(
+                        L"  Thread [%lu] Completions [%lld] Inline [%lld] Bytes [%lld] Callback(ms) [%lld] Idle(ms) [%lld] Busy [%.1f%%]\r\n",
+                        counters->m_threadId,
+                        completions,
+                        inlineCompletions,
+                        bytes,
+                        callbackMilliseconds,
+                        idleMilliseconds,
+                        intervalMilliseconds > 0 ? static_cast<double>(callbackMilliseconds) * 100.0 / static_cast<double>(intervalMilliseconds) : 0.0));
+
+                totalCompletions += completions;
+                maxCompletions = completions > maxCompletions ? completions : maxCompletions;
+                ++threadCount;
+            }
+        }
+
+        if (0 == threadCount)
+        {
+            return {};
+        }
+
+        // a max/mean near 1.0 means completions are spread evenly : near the thread count means one thread is doing all the work
+        const double meanCompletions = static_cast<double>(totalCompletions) / static_cast<double>(threadCount);
+        status.append(
+            wil::str_printf<std::wstring>(
+                L"  Threads [%Iu] Completions [%lld] Max/Mean [%.2f]\r\n",
+                threadCount,
+                totalCompletions,
+                meanCompletions > 0.0 ? static_cast<double>(maxCompletions) / meanCompletions : 0.0));
+        return status;
+    }
+    catch (...)
+    {
+        return {};
+    }
+}
@@ -0,0 +1,91 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// cpp headers
+#include <string>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctTimer.hpp>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsThreadStatistics
+    ///
+    /// Per-thread completion counters written to the status file with -ThreadStatistics
+    /// - each thread processing IO completions (threadpool, dedicated completion and RIO worker threads)
+    ///   registers its own counters on its first completion; only that thread writes them
+    /// - counts completions, inline completions (-InlineCompletions), bytes, and the time spent in the completion callbacks
+    ///   the time idle is the rest of each status interval
+    /// - the checks are a single branch when -ThreadStatistics is not given
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    namespace ctsThreadStatistics
+    {
+        namespace Details
+        {
+            void RecordCompletion(unsigned long bytes, bool inlineCompletion) noexcept;
+            void RecordCallbackTime(long long callbackQpc) noexcept;
+        }
+
+        inline bool IsEnabled() noexcept
+        {
+            return ctsConfig::g_configSettings->PrintThreadStatistics;
+        }
+
+        inline void RecordCompletion(unsigned long bytes, bool inlineCompletion) noexcept
+        {
+            if (IsEnabled())
+            {
+                Details::RecordCompletion(bytes, inlineCompletion);
+            }
+        }
+
+        // adds the time from construction to destruction to the current thread's callback time
+        class ctsCallbackScope
+        {
+        public:
+            ctsCallbackScope() noexcept :
+                m_startQpc(IsEnabled() ? ctl::ctTimer::SnapQpc() : 0LL)
+            {
+            }
+            ~ctsCallbackScope() noexcept
+            {
+                if (m_startQpc != 0)
+                {
+                    Details::RecordCallbackTime(ctl::ctTimer::SnapQpc() - m_startQpc);
+                }
+            }
+
+            ctsCallbackScope(const ctsCallbackScope&) = delete;
+            ctsCallbackScope& operator=(const ctsCallbackScope&) = delete;
+            ctsCallbackScope(ctsCallbackScope&&) = delete;
+            ctsCallbackScope& operator=(ctsCallbackScope&&) = delete;
+
+        private:
+            const long long m_startQpc;
+        };
+
+        // formats one line per thread for the interval since the prior call, followed by a line summarizing the balance
+        // - must only be called from the status update (which is serialized)
+        // - returns an empty string if no thread has completed IO
+        std::wstring FormatStatus(long long currentTimeMilliseconds) noexcept;
+    }
+}
@@ -0,0 +1,444 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+// parent header
+#include "ctsTimerWheel.h"
+// cpp headers
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+// os headers
+#include <Windows.h>
+// wil headers
+#include <wil/resource.h>
+// ctl headers
+#include <ctTimer.hpp>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    namespace ctsTimerWheel
+    {
+        // level 0 : 1 ms ticks covering just over one second
+        constexpr long long c_level0Shift = 10;
+        constexpr long long c_level0SlotCount = 1LL << c_level0Shift;
+        // level 1 : slots of 1024 ticks covering just under 4.5 minutes - entries further out wait in their slot for another rotation
+        constexpr long long c_level1SlotCount = 256;
+
+        // the wheels always read the real clock (not the SnapQpcInMillis stub in unit tests)
+        static long long SnapTick() noexcept
+        {
+            return ctl::ctTimer::ConvertQpcToMillis(ctl::ctTimer::SnapQpc());
+        }
+
+        static void LinkEntry(ctsTimerWheelEntry*& listHead, ctsTimerWheelEntry& entry) noexcept
+        {
+            entry.m_next = listHead;
+            if (listHead)
+            {
+                listHead->m_prevNext = &entry.m_next;
+            }
+            listHead = &entry;
+            entry.m_prevNext = &listHead;
+        }
+
+        static void UnlinkEntry(ctsTimerWheelEntry& entry) noexcept
+        {
+            *entry.m_prevNext = entry.m_next;
+            if (entry.m_next)
+            {
+                entry.m_next->m_prevNext = entry.m_prevNext;
+            }
+            entry.m_next = nullptr;
+            entry.m_prevNext = nullptr;
+        }
+
+        class TimerWheel
+        {
+        public:
+            // the wheel's thread runs for the lifetime of the process
+            // - can throw wil::ResultException
+            explicit TimerWheel(unsigned long processorNumber);
+
+            ~TimerWheel() noexcept = default;
+            TimerWheel(const TimerWheel&) = delete;
+            TimerWheel& operator=(const TimerWheel&) = delete;
+            TimerWheel(TimerWheel&&) = delete;
+            TimerWheel& operator=(TimerWheel&&) = delete;
+
+            void Schedule(ctsTimerWheelEntry& entry, long long dueInMilliseconds);
+            void Cancel(ctsTimerWheelEntry& entry) noexcept;
+
+        private:
+            static DWORD WINAPI WheelThreadProc(LPVOID context) noexcept;
+            void ProcessTick() noexcept;
+            _Requires_lock_held_(m_lock) void LinkToSlot(ctsTimerWheelEntry& entry) noexcept;
+            _Requires_lock_held_(m_lock) void CollectDue(ctsTimerWheelEntry*& listHead, long long currentTick) noexcept;
+            _Requires_lock_held_(m_lock) void Cascade(long long tick, long long currentTick) noexcept;
+            _Requires_lock_held_(m_lock) void Resweep(long long currentTick) noexcept;
+
+            wil::srwlock m_lock;
+            wil::condition_variable m_dispatchCompleted;
+            _Guarded_by_(m_lock) std::array<ctsTimerWheelEntry*, c_level0SlotCount> m_level0Slots{};
+            _Guarded_by_(m_lock) std::array<ctsTimerWheelEntry*, c_level1SlotCount> m_level1Slots{};
+            // the entries due in the tick being dispatched
+            _Guarded_by_(m_lock) ctsTimerWheelEntry* m_batch = nullptr;
+            _Guarded_by_(m_lock) ctsTimerWheelEntry* m_dispatching = nullptr;
+            _Guarded_by_(m_lock) size_t m_scheduledCount = 0;
+            _Guarded_by_(m_lock) long long m_lastTick = 0LL;
+            _Guarded_by_(m_lock) bool m_timerArmed = false;
+
+            wil::unique_handle m_timer;
+            DWORD m_threadId = 0;
+        };
+
+        TimerWheel::TimerWheel(unsigned long processorNumber) :
+            m_lastTick(SnapTick())
+        {
+            m_timer.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+            if (!m_timer)
+            {
+                // high-resolution timers are not supported before Windows 10 1803 : fall back to the system timer resolution
+                const auto gle = GetLastError();
+                if (gle != ERROR_INVALID_PARAMETER)
+                {
+                    THROW_WIN32_MSG(gle, "CreateWaitableTimerExW(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)");
+                }
+
+                m_timer.reset(CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+                THROW_LAST_ERROR_IF_MSG(!m_timer, "CreateWaitableTimerExW");
+            }
+
+            const wil::unique_handle wheelThread(CreateThread(nullptr, 0, WheelThreadProc, this, CREATE_SUSPENDED, &m_threadId));
+            THROW_LAST_ERROR_IF_MSG(!wheelThread, "CreateThread (ctsTimerWheel)");
+
+            if (processorNumber < sizeof(DWORD_PTR) * 8)
+            {
+                const auto affinityMask = static_cast<DWORD_PTR>(1) << processorNumber;
+                if (0 == SetThreadAffinityMask(wheelThread.get(), affinityMask))
+                {
+                    // not fatal - the wheel's entries are still all dispatched from its one thread
+                    PRINT_DEBUG_INFO(L"\t\tctsTimerWheel: SetThreadAffinityMask(%lu) failed (%u)\n", processorNumber, GetLastError());
+                }
+            }
+
+            ResumeThread(wheelThread.get());
+        }
+
+        void TimerWheel::Schedule(ctsTimerWheelEntry& entry, long long dueInMilliseconds)
+        {
+            const long long currentTick = SnapTick();
+
+            const auto lock = m_lock.lock_exclusive();
+            if (!m_timerArmed)
+            {
+                // a periodic 1 ms timer while the wheel has any entries scheduled
+                LARGE_INTEGER dueTime{};
+                dueTime.QuadPart = -10000LL; // negative == relative, in 100ns units
+                THROW_IF_WIN32_BOOL_FALSE(SetWaitableTimer(m_timer.get(), &dueTime, 1, nullptr, nullptr, FALSE));
+                m_timerArmed = true;
+            }
+
+            if (entry.m_prevNext)
+            {
+                // still scheduled, or collected in the batch and not yet dispatched
+                if (entry.m_scheduled)
+                {
+                    entry.m_scheduled = false;
+                    --m_scheduledCount;
+                }
+                UnlinkEntry(entry);
+            }
+
+            if (0 == m_scheduledCount)
+            {
+                // the slots are empty : catch up the ticks not visited while the timer was canceled
+                m_lastTick = std::max<long long>(m_lastTick, currentTick - 1);
+            }
+
+            // a tick already processed won't be visited again
+            entry.m_dueTick = std::max<long long>(currentTick + dueInMilliseconds, m_lastTick + 1);
+            LinkToSlot(entry);
+        }
+
+        void TimerWheel::Cancel(ctsTimerWheelEntry& entry) noexcept
+        {
+            const auto lock = m_lock.lock_exclusive();
+            for (;;)
+            {
+                // it might be scheduled, or already collected in the batch being dispatched
+                if (entry.m_prevNext)
+                {
+                    if (entry.m_scheduled)
+                    {
+                        entry.m_scheduled = false;
+                        --m_scheduledCount;
+                    }
+                    UnlinkEntry(entry);
+                }
+
+                // an entry canceled from its own dispatch is already on the only thread that could be dispatching it
+                if (m_dispatching != &entry || GetCurrentThreadId() == m_threadId)
+                {
+                    break;
+                }
+
+                // the dispatch can schedule the entry again, so check again once it returns
+                m_dispatchCompleted.wait(lock);
+            }
+        }
+
+        void TimerWheel::LinkToSlot(ctsTimerWheelEntry& entry) noexcept
+        {
+            // level 0 slots within one rotation of the last tick processed are visited exactly at their due tick
+            // - entries further out are held in level 1 until the start of their 1024 tick window cascades them to level 0
+            if (entry.m_dueTick - m_lastTick < c_level0SlotCount)
+            {
+                LinkEntry(m_level0Slots[static_cast<size_t>(entry.m_dueTick % c_level0SlotCount)], entry);
+            }
+            else
+            {
+                LinkEntry(m_level1Slots[static_cast<size_t>((entry.m_dueTick >> c_level0Shift) % c_level1SlotCount)], entry);
+            }
+
+            if (!entry.m_scheduled)
+            {
+                entry.m_scheduled = true;
+                ++m_scheduledCount;
+            }
+        }
+
+        void TimerWheel::CollectDue(ctsTimerWheelEntry*& listHead, long long currentTick) noexcept
+        {
+            auto* entry = listHead;
+            while (entry)
+            {
+                auto* const nextEntry = entry->m_next;
+                if (entry->m_dueTick <= currentTick)
+                {
+                    UnlinkEntry(*entry);
+                    entry->m_scheduled = false;
+                    --m_scheduledCount;
+                    LinkEntry(m_batch, *entry);
+                }
+                entry = nextEntry;
+            }
+        }
+
+        void TimerWheel::Cascade(long long tick, long long currentTick) noexcept
+        {
+            // the level 1 slot for the 1024 tick window starting at this tick
+            const long long window = tick >> c_level0Shift;
+            auto& level1Slot = m_level1Slots[static_cast<size_t>(window % c_level1SlotCount)];
+
+            auto* entry = level1Slot;
+            while (entry)
+            {
+                auto* const nextEntry = entry->m_next;
+                // entries due in a later rotation of level 1 stay in this slot
+                if ((entry->m_dueTick >> c_level0Shift) <= window)
+                {
+                    UnlinkEntry(*entry);
+                    if (entry->m_dueTick <= currentTick)
+                    {
+                        entry->m_scheduled = false;
+                        --m_scheduledCount;
+                        LinkEntry(m_batch, *entry);
+                    }
+                    else
+                    {
+                        LinkEntry(m_level0Slots[static_cast<size_t>(entry->m_dueTick % c_level0SlotCount)], *entry);
+                    }
+                }
+                entry = nextEntry;
+            }
+        }
+
+        void TimerWheel::Resweep(long long currentTick) noexcept
+        {
+            // more than a full level 0 rotation passed since the last tick processed (e.g. the system was suspended)
+            // - collect everything now due, then relink whatever remains relative to the current tick
+            ctsTimerWheelEntry* remaining = nullptr;
+            const auto sweepSlot = [&](ctsTimerWheelEntry*& slot) noexcept {
+                while (slot)
+                {
+                    auto& entry = *slot;
+                    UnlinkEntry(entry);
+                    if (entry.m_dueTick <= currentTick)
+                    {
+                        entry.m_scheduled = false;
+                        --m_scheduledCount;
+                        LinkEntry(m_batch, entry);
+                    }
+                    else
+                    {
+                        LinkEntry(remaining, entry);
+                    }
+                }
+            };
+            for (auto& slot : m_level0Slots)
+            {
+                sweepSlot(slot);
+            }
+            for (auto& slot : m_level1Slots)
+            {
+                sweepSlot(slot);
+            }
+
+            m_lastTick = currentTick;
+            while (remaining)
+            {
+                auto& entry = *remaining;
+                UnlinkEntry(entry);
+                LinkToSlot(entry);
+            }
+        }
+
+        DWORD WINAPI TimerWheel::WheelThreadProc(LPVOID context) noexcept
+        {
+            auto* const wheel = static_cast<TimerWheel*>(context);
+            for (;;)
+            {
+                if (WaitForSingleObject(wheel->m_timer.get(), INFINITE) != WAIT_OBJECT_0)
+                {
+                    FAIL_FAST_MSG(
+                        "WaitForSingleObject(%p) failed [%u] waiting on the ctsTimerWheel timer",
+                        wheel->m_timer.get(), GetLastError());
+                }
+                wheel->ProcessTick();
+            }
+        }
+
+        void TimerWheel::ProcessTick() noexcept
+        {
+            const long long currentTick = SnapTick();
+            {
+                const auto lock = m_lock.lock_exclusive();
+
+                if (currentTick - m_lastTick >= c_level0SlotCount)
+                {
+                    Resweep(currentTick);
+                }
+                else
+                {
+                    // visit every tick since the last one processed
+                    for (auto tick = m_lastTick + 1; tick <= currentTick; ++tick)
+                    {
+                        if (0 == tick % c_level0SlotCount)
+                        {
+                            Cascade(tick, currentTick);
+                        }
+                        CollectDue(m_level0Slots[static_cast<size_t>(tick % c_level0SlotCount)], currentTick);
+                    }
+                    m_lastTick = std::max<long long>(m_lastTick, currentTick);
+                }
+
+                if (0 == m_scheduledCount && m_timerArmed)
+                {
+                    // nothing left scheduled : don't wake this thread every tick until another entry is scheduled
+                    CancelWaitableTimer(m_timer.get());
+                    m_timerArmed = false;
+                }
+            }
+
+            // dispatch outside the lock: the callbacks take their own locks and schedule their next timer while dispatched
+            for (;;)
+            {
+                ctsTimerWheelEntry* entry = nullptr;
+                {
+                    const auto lock = m_lock.lock_exclusive();
+                    if (m_dispatching)
+                    {
+                        m_dispatching = nullptr;
+                        m_dispatchCompleted.notify_all();
+                    }
+
+                    // entries canceled or rescheduled while the batch is dispatched are already unlinked from it
+                    if (!m_batch)
+                    {
+                        break;
+                    }
+
+                    entry = m_batch;
+                    UnlinkEntry(*entry);
+                    m_dispatching = entry;
+                }
+
+                entry->m_dispatch(entry->m_context);
+            }
+        }
+
+        // the wheels are deliberately never deleted: their threads run for the lifetime of the process
+        static INIT_ONCE g_timerWheelsInitializer = INIT_ONCE_STATIC_INIT;
+        static TimerWheel** g_timerWheels = nullptr;
+        static unsigned long g_timerWheelCount = 0;
+        static std::atomic<unsigned long> g_nextTimerWheel{0};
+
+        static BOOL CALLBACK InitOnceTimerWheels(PINIT_ONCE, PVOID, PVOID*) noexcept
+        {
+            try
+            {
+                // one wheel per processor
+                SYSTEM_INFO systemInfo;
+                GetSystemInfo(&systemInfo);
+
+                auto timerWheels = std::make_unique<TimerWheel*[]>(systemInfo.dwNumberOfProcessors);
+                for (auto processor = 0ul; processor < systemInfo.dwNumberOfProcessors; ++processor)
+                {
+                    timerWheels[processor] = new TimerWheel(processor);
+                }
+
+                g_timerWheels = timerWheels.release();
+                g_timerWheelCount = systemInfo.dwNumberOfProcessors;
+                return TRUE;
+            }
+            catch (const wil::ResultException& e)
+            {
+                SetLastError(HRESULT_CODE(e.GetErrorCode()));
+                return FALSE;
+            }
+            catch (...)
+            {
+                SetLastError(ERROR_OUTOFMEMORY);
+                return FALSE;
+            }
+        }
+
+        void Schedule(ctsTimerWheelEntry& entry, long long dueInMilliseconds)
+        {
+            if (!InitOnceExecuteOnce(&g_timerWheelsInitializer, InitOnceTimerWheels, nullptr, nullptr))
+            {
+                THROW_WIN32_MSG(GetLastError(), "ctsTimerWheel could not be initialized");
+            }
+
+            if (ULONG_MAX == entry.m_wheel)
+            {
+                entry.m_wheel = g_nextTimerWheel++ % g_timerWheelCount;
+            }
+            g_timerWheels[entry.m_wheel]->Schedule(entry, dueInMilliseconds);
+        }
+
+        void Cancel(ctsTimerWheelEntry& entry) noexcept
+        {
+            // never scheduled
+            if (ULONG_MAX == entry.m_wheel)
+            {
+                return;
+            }
+            g_timerWheels[entry.m_wheel]->Cancel(entry);
+        }
+    }
+}
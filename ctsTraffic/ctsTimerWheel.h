@@ -0,0 +1,76 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// cpp headers
+#include <climits>
+// os headers
+#include <Windows.h>
+
+namespace ctsTraffic
+{
+    //
+    // The state ctsTimerWheel tracks for each object it schedules
+    // - owned by that object, only read or written by ctsTimerWheel under the lock of its wheel
+    //   (other than m_wheel, assigned by the first Schedule call - callers serialize scheduling each entry)
+    //
+    struct ctsTimerWheelEntry
+    {
+        typedef void (*DispatchFunction)(PVOID context) noexcept;
+
+        ctsTimerWheelEntry(DispatchFunction dispatch, PVOID context) noexcept :
+            m_dispatch(dispatch),
+            m_context(context)
+        {
+        }
+
+        const DispatchFunction m_dispatch;
+        const PVOID m_context;
+
+        // the wheel is assigned the first time the entry is scheduled
+        unsigned long m_wheel = ULONG_MAX;
+        long long m_dueTick = 0LL;
+        // intrusive links into the wheel slot (or the batch being dispatched) holding the entry
+        // - linking never allocates, so entries can be moved between slots as the wheel turns
+        ctsTimerWheelEntry* m_next = nullptr;
+        ctsTimerWheelEntry** m_prevNext = nullptr;
+        // set while linked into a wheel slot, cleared once collected to be dispatched
+        bool m_scheduled = false;
+
+        // non-copyable : the wheel tracks its address
+        ctsTimerWheelEntry(const ctsTimerWheelEntry&) = delete;
+        ctsTimerWheelEntry& operator=(const ctsTimerWheelEntry&) = delete;
+        ctsTimerWheelEntry(ctsTimerWheelEntry&&) = delete;
+        ctsTimerWheelEntry& operator=(ctsTimerWheelEntry&&) = delete;
+    };
+
+    //
+    // Process-wide timers for delayed IO, replacing a threadpool timer per socket or stream
+    // - one hierarchical timing wheel per processor: 1024 slots of 1 ms ticks, cascaded from 256 slots of 1024 ticks
+    // - each wheel is driven by its own thread waiting on a high-resolution waitable timer while it has entries scheduled
+    // - every entry due in a tick is dispatched on that thread as one batch
+    // - entries are assigned a wheel round-robin, so an entry is always dispatched from the same processor
+    //
+    namespace ctsTimerWheel
+    {
+        // Dispatches the entry once dueInMilliseconds has elapsed, replacing any prior schedule
+        // - can throw std::bad_alloc or wil::ResultException creating the wheels or arming its timer
+        void Schedule(ctsTimerWheelEntry& entry, long long dueInMilliseconds);
+
+        // Removes any schedule of the entry
+        // - waits if the entry is being dispatched on another thread, so its owner can then be safely deleted
+        void Cancel(ctsTimerWheelEntry& entry) noexcept;
+    }
+}
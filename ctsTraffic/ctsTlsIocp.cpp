@@ -0,0 +1,1286 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// ReSharper disable CppClangTidyClangDiagnosticExitTimeDestructors
+
+// cpp headers
+#include <algorithm>
+#include <memory>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+#include <wincrypt.h>
+#include <intrin.h>
+#define SECURITY_WIN32
+#define SCHANNEL_USE_BLACKLISTS
+#include <SubAuth.h>
+#include <security.h>
+#include <schannel.h>
+#include <bcrypt.h>
+// wil headers
+#include <wil/resource.h>
+// ctl headers
+#include <ctThreadIocp.hpp>
+#include <ctTimer.hpp>
+// local headers
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsIOTask.hpp"
+#include "ctsStatistics.hpp"
+#include "ctsThreadStatistics.h"
+
+//
+// -io:tls : every TCP connection is wrapped in a Schannel TLS session
+//
+// The handshake is negotiated once the connection is established, before the IO pattern sees the connection
+// - the pattern's send buffers are encrypted into TLS records in a send buffer kept per connection (reused across sends),
+//   as the pattern's buffers are shared across connections they cannot be encrypted in place
+// - ciphertext is received into a recv buffer kept per connection, decrypted in place, and the plaintext copied into the
+//   pattern's recv buffer (as many bytes as the recv task requested : the remainder completes the next recv task)
+//
+// All state of a session is guarded by the socket lock, as is all IO with ctsSendRecvIocp
+// - sends are encrypted and posted in the order the pattern initiates them, so the TLS records are sent in sequence
+// - records must be decrypted in the order received, so only one recv is kept pended (-PrePostRecvs:1)
+//
+namespace ctsTraffic
+{
+    namespace TlsIo
+    {
+        // the client's target name when -TlsCertificate is not given : Schannel keys its client session cache on it
+        constexpr const wchar_t* c_defaultTargetName = L"ctsTraffic";
+        // handshake messages are received into a buffer of this size, grown if a message is larger
+        constexpr DWORD c_handshakeBufferLength = 0x4000;
+        // once negotiated, ciphertext is received in blocks of up to this many full TLS records
+        constexpr DWORD c_recvRecordCount = 4;
+        // named directly as BCRYPT_CHACHA20_POLY1305_ALGORITHM is missing from older SDKs
+        constexpr const wchar_t* c_chaCha20AlgorithmName = L"CHACHA20_POLY1305";
+
+        constexpr ULONG c_initializeFlags =
+            ISC_REQ_SEQUENCE_DETECT | ISC_REQ_REPLAY_DETECT | ISC_REQ_CONFIDENTIALITY | ISC_REQ_EXTENDED_ERROR | ISC_REQ_ALLOCATE_MEMORY | ISC_REQ_STREAM;
+        constexpr ULONG c_acceptFlags =
+            ASC_REQ_SEQUENCE_DETECT | ASC_REQ_REPLAY_DETECT | ASC_REQ_CONFIDENTIALITY | ASC_REQ_EXTENDED_ERROR | ASC_REQ_ALLOCATE_MEMORY | ASC_REQ_STREAM;
+
+        // the Schannel credentials shared by every connection : acquired with the first connection
+        static INIT_ONCE g_credentialsInitializer = INIT_ONCE_STATIC_INIT;
+        static CredHandle g_credentials{};
+
+        static ctsStatsTracking g_handshakes;
+        static ctsStatsTracking g_resumedHandshakes;
+        static ctsStatsTracking g_failedHandshakes;
+        static ctsLatencyHistogram g_handshakeLatency;
+        // bulk data after the handshake : the cycles are the TSC around each EncryptMessage and DecryptMessage
+        static ctsShardedStatsTracking g_plaintextBytes;
+        static ctsShardedStatsTracking g_ciphertextBytes;
+        static ctsShardedStatsTracking g_records;
+        static ctsShardedStatsTracking g_cryptoCycles;
+
+        static PCWSTR TargetName() noexcept
+        {
+            return ctsConfig::g_configSettings->TlsCertificateName ? ctsConfig::g_configSettings->TlsCertificateName : c_defaultTargetName;
+        }
+
+        // finds the server certificate by its subject in the local machine's, then the current user's, personal store
+        static wil::unique_cert_context FindCertificate(_In_ PCWSTR subject)
+        {
+            for (const DWORD storeLocation : {CERT_SYSTEM_STORE_LOCAL_MACHINE, CERT_SYSTEM_STORE_CURRENT_USER})
+            {
+                const wil::unique_hcertstore store(CertOpenStore(
+                    CERT_STORE_PROV_SYSTEM_W, 0, 0, storeLocation | CERT_STORE_READONLY_FLAG | CERT_STORE_OPEN_EXISTING_FLAG, L"My"));
+                if (!store)
+                {
+                    continue;
+                }
+
+                wil::unique_cert_context certificate(CertFindCertificateInStore(
+                    store.get(), X509_ASN_ENCODING | PKCS_7_ASN_ENCODING, 0, CERT_FIND_SUBJECT_STR_W, subject, nullptr));
+                if (certificate)
+                {
+                    return certificate;
+                }
+            }
+            THROW_HR_MSG(CRYPT_E_NOT_FOUND, "CertFindCertificateInStore(%ws)", subject);
+        }
+
+        static CRYPTO_SETTINGS DisabledCipher(_In_ PCWSTR algorithmName, DWORD minBitLength, DWORD maxBitLength) noexcept
+        {
+            CRYPTO_SETTINGS settings{};
+            settings.eAlgorithmUsage = TlsParametersCngAlgUsageCipher;
+            settings.strCngAlgId.Buffer = const_cast<PWSTR>(algorithmName);
+            settings.strCngAlgId.Length = static_cast<USHORT>(wcslen(algorithmName) * sizeof(wchar_t));
+            settings.strCngAlgId.MaximumLength = settings.strCngAlgId.Length;
+            settings.dwMinBitLength = minBitLength;
+            settings.dwMaxBitLength = maxBitLength;
+            return settings;
+        }
+
+        // -TlsCipher : the ciphers Schannel may not negotiate
+        // - an AES entry with a bit length range restricts AES to those key lengths, else the cipher is disabled
+        static DWORD BuildDisabledCiphers(_Out_writes_(2) CRYPTO_SETTINGS* settings) noexcept
+        {
+            switch (ctsConfig::g_configSettings->TlsCipher)
+            {
+                case ctsConfig::TlsCipherType::Aes128:
+                    settings[0] = DisabledCipher(c_chaCha20AlgorithmName, 0, 0);
+                    settings[1] = DisabledCipher(BCRYPT_AES_ALGORITHM, 128, 128);
+                    return 2;
+
+                case ctsConfig::TlsCipherType::Aes256:
+                    settings[0] = DisabledCipher(c_chaCha20AlgorithmName, 0, 0);
+                    settings[1] = DisabledCipher(BCRYPT_AES_ALGORITHM, 256, 256);
+                    return 2;
+
+                case ctsConfig::TlsCipherType::ChaCha20:
+                    settings[0] = DisabledCipher(BCRYPT_AES_ALGORITHM, 0, 0);
+                    return 1;
+
+                case ctsConfig::TlsCipherType::NoCipherSet:
+                default:
+                    return 0;
+            }
+        }
+
+        // -TlsProtocol : the protocols disabled to negotiate only the one given (0 leaves the system defaults)
+        static DWORD DisabledProtocols() noexcept
+        {
+            constexpr DWORD legacyProtocols = SP_PROT_SSL3 | SP_PROT_TLS1_0 | SP_PROT_TLS1_1;
+            switch (ctsConfig::g_configSettings->TlsProtocol)
+            {
+                case ctsConfig::TlsProtocolType::Tls12:
+                    return legacyProtocols | SP_PROT_TLS1_3;
+
+                case ctsConfig::TlsProtocolType::Tls13:
+                    return legacyProtocols | SP_PROT_TLS1_2;
+
+                case ctsConfig::TlsProtocolType::NoProtocolSet:
+                default:
+                    return 0;
+            }
+        }
+
+        static BOOL CALLBACK InitOnceCredentials(PINIT_ONCE, PVOID, PVOID*) noexcept
+        try
+        {
+            const bool listening = ctsConfig::IsListening();
+            wil::unique_cert_context certificate;
+            if (listening)
+            {
+                certificate = FindCertificate(ctsConfig::g_configSettings->TlsCertificateName);
+            }
+
+            CRYPTO_SETTINGS disabledCiphers[2]{};
+            TLS_PARAMETERS tlsParameters{};
+            tlsParameters.grbitDisabledProtocols = DisabledProtocols();
+            tlsParameters.cDisabledCrypto = BuildDisabledCiphers(disabledCiphers);
+            tlsParameters.pDisabledCrypto = tlsParameters.cDisabledCrypto > 0 ? disabledCiphers : nullptr;
+
+            SCH_CREDENTIALS credentials{};
+            credentials.dwVersion = SCH_CREDENTIALS_VERSION;
+            credentials.dwFlags = SCH_USE_STRONG_CRYPTO;
+            credentials.cTlsParameters = 1;
+            credentials.pTlsParameters = &tlsParameters;
+            if (!ctsConfig::g_configSettings->TlsResumption)
+            {
+                credentials.dwFlags |= SCH_CRED_DISABLE_RECONNECTS;
+            }
+
+            PCCERT_CONTEXT certificateContext = certificate.get();
+            if (listening)
+            {
+                credentials.cCreds = 1;
+                credentials.paCred = &certificateContext;
+            }
+            else
+            {
+                // the server certificate is not validated : this measures the cost of TLS, not a PKI
+                credentials.dwFlags |= SCH_CRED_MANUAL_CRED_VALIDATION | SCH_CRED_NO_DEFAULT_CREDS;
+            }
+
+            // Schannel holds its own reference on the certificate
+            TimeStamp expiry{};
+            const auto status = AcquireCredentialsHandleW(
+                nullptr,
+                const_cast<LPWSTR>(UNISP_NAME_W),
+                listening ? SECPKG_CRED_INBOUND : SECPKG_CRED_OUTBOUND,
+                nullptr,
+                &credentials,
+                nullptr,
+                nullptr,
+                &g_credentials,
+                &expiry);
+            if (status != SEC_E_OK)
+            {
+                ctsConfig::PrintErrorIfFailed("AcquireCredentialsHandle", static_cast<unsigned long>(status));
+                SetLastError(static_cast<DWORD>(status));
+                return FALSE;
+            }
+            return TRUE;
+        }
+        catch (...)
+        {
+            SetLastError(ctsConfig::PrintThrownException());
+            return FALSE;
+        }
+
+        // a completed OVERLAPPED holds the NTSTATUS and the bytes transferred : only failures need WSAGetOverlappedResult
+        static bool ReadSuccessfulCompletion(_In_ const OVERLAPPED* pOverlapped, _Out_ DWORD* transferred) noexcept
+        {
+            constexpr ULONG_PTR statusSuccess = 0; // STATUS_SUCCESS
+            if (statusSuccess == pOverlapped->Internal)
+            {
+                *transferred = static_cast<DWORD>(pOverlapped->InternalHigh);
+                return true;
+            }
+            *transferred = 0;
+            return false;
+        }
+
+        struct ctsTlsStatus
+        {
+            // Winsock or SECURITY_STATUS error code
+            unsigned long m_ioErrorcode = NO_ERROR;
+            // flag if to request another ctsIOTask
+            bool m_ioDone = false;
+        };
+
+        // completes the task back to the pattern : the same handling as an inline completion with ctsSendRecvIocp
+        static ctsTlsStatus CompleteTask(const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& task, DWORD bytesTransferred, DWORD error, PCSTR functionName) noexcept
+        {
+            ctsTlsStatus status;
+            const ctsIoStatus protocolStatus = pattern->CompleteIo(task, bytesTransferred, error);
+            switch (protocolStatus)
+            {
+                case ctsIoStatus::ContinueIo:
+                    // if the IO failed, the protocol wants to ignore the error
+                    status.m_ioDone = false;
+                    break;
+
+                case ctsIoStatus::CompletedIo:
+                    status.m_ioDone = true;
+                    break;
+
+                case ctsIoStatus::FailedIo:
+                    ctsConfig::PrintErrorIfFailed(functionName, pattern->GetLastPatternError());
+                    status.m_ioErrorcode = pattern->GetLastPatternError();
+                    status.m_ioDone = true;
+                    break;
+
+                default:
+                    FAIL_FAST_MSG("ctsTlsIocp: unknown ctsSocket::IOStatus - %u\n", static_cast<unsigned>(protocolStatus));
+            }
+            return status;
+        }
+
+        //
+        // The TLS session of one connection
+        // - every IO holds a reference on the session through its completion (or timer) callback
+        // - every IO also holds an IO count on the socket, taken as it's posted and released as it completes
+        //
+        class ctsTlsSocketContext : public std::enable_shared_from_this<ctsTlsSocketContext>
+        {
+        public:
+            explicit ctsTlsSocketContext(std::weak_ptr<ctsSocket> weakSocket) noexcept :
+                m_weakSocket(std::move(weakSocket))
+            {
+            }
+
+            ~ctsTlsSocketContext() noexcept
+            {
+                if (m_hasContext)
+                {
+                    DeleteSecurityContext(&m_context);
+                }
+            }
+
+            ctsTlsSocketContext(const ctsTlsSocketContext&) = delete;
+            ctsTlsSocketContext& operator=(const ctsTlsSocketContext&) = delete;
+            ctsTlsSocketContext(ctsTlsSocketContext&&) = delete;
+            ctsTlsSocketContext& operator=(ctsTlsSocketContext&&) = delete;
+
+            // the client sends its ClientHello, the server waits for it
+            void StartHandshake() noexcept
+            {
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    return;
+                }
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                if (!lockedPattern)
+                {
+                    return;
+                }
+
+                // hold an IO count so we won't inadvertently call CompleteState() while the handshake is started
+                sharedSocket->IncrementIo();
+                m_handshakeStartQpc = ctl::ctTimer::SnapQpc();
+
+                DWORD error = NO_ERROR;
+                const SOCKET socket = lockedSocket.GetSocket();
+                if (INVALID_SOCKET == socket)
+                {
+                    error = WSAECONNABORTED;
+                }
+                else
+                {
+                    try
+                    {
+                        m_recvBuffer.resize(c_handshakeBufferLength);
+                        error = ctsConfig::IsListening() ?
+                            PostRecv(socket, sharedSocket, ctsTask{}, true) :
+                            ContinueHandshake(socket, sharedSocket);
+                    }
+                    catch (...)
+                    {
+                        error = ctsConfig::PrintThrownException();
+                    }
+                }
+
+                if (error != NO_ERROR)
+                {
+                    FailHandshake(error);
+                }
+                ReleaseIo(sharedSocket, error);
+            }
+
+            // requests IO from the pattern until it has none or it's done : the same loop as ctsSendRecvIocp
+            void RequestIo() noexcept
+            {
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    return;
+                }
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                if (!lockedPattern)
+                {
+                    return;
+                }
+                // if lockedSocket has an INVALID_SOCKET, continue below to ProcessTask where it's handled appropriately
+
+                // hold an IO count so we won't inadvertently call CompleteState() while IO is still being requested
+                // - each IO posted takes its own IO count, released as it completes
+                sharedSocket->IncrementIo();
+
+                ctsTlsStatus status{};
+                while (!status.m_ioDone)
+                {
+                    const ctsTask nextIo = lockedPattern->InitiateIo();
+                    if (ctsTaskAction::None == nextIo.m_ioAction)
+                    {
+                        // nothing failed, just no more IO right now
+                        break;
+                    }
+
+                    if (nextIo.m_timeOffsetMilliseconds > 0)
+                    {
+                        // the timer holds an IO count until its callback runs
+                        sharedSocket->IncrementIo();
+                        try
+                        {
+                            sharedSocket->SetTimer(
+                                nextIo,
+                                [self = shared_from_this()](std::weak_ptr<ctsSocket>, const ctsTask& task) noexcept { self->ProcessScheduledTask(task); });
+                            status.m_ioDone = true;
+                        }
+                        catch (...)
+                        {
+                            const auto error = ctsConfig::PrintThrownException();
+                            sharedSocket->DecrementIo();
+                            status = CompleteTask(lockedPattern, nextIo, 0, error, "SetTimer");
+                        }
+                    }
+                    else
+                    {
+                        status = ProcessTask(lockedSocket.GetSocket(), sharedSocket, lockedPattern, nextIo);
+                    }
+                }
+
+                ReleaseIo(sharedSocket, status.m_ioErrorcode);
+            }
+
+        private:
+            std::weak_ptr<ctsSocket> m_weakSocket;
+
+            CtxtHandle m_context{};
+            bool m_hasContext = false;
+            bool m_handshakeComplete = false;
+            // TLS 1.3 post-handshake messages (session tickets, key updates) are waiting to be given to Schannel
+            bool m_postHandshakePending = false;
+            // the peer's close_notify or FIN was received : recvs complete as a FIN would complete them
+            bool m_peerClosed = false;
+            long long m_handshakeStartQpc = 0LL;
+            SecPkgContext_StreamSizes m_streamSizes{};
+            // the first error which ended IO on the connection : given to CompleteState with the last IO count
+            DWORD m_lastError = NO_ERROR;
+
+            // ciphertext not yet decrypted is m_cipherBytes at m_cipherOffset in m_recvBuffer
+            // - plaintext decrypted but not yet given to the pattern is m_plaintextBytes at m_plaintext (also within m_recvBuffer)
+            std::vector<char> m_recvBuffer;
+            DWORD m_cipherOffset = 0;
+            DWORD m_cipherBytes = 0;
+            char* m_plaintext = nullptr;
+            DWORD m_plaintextBytes = 0;
+
+            // send buffers not being sent, reused for the next send
+            std::vector<std::shared_ptr<std::vector<char>>> m_sendBuffers;
+
+            // releases an IO count : its error is kept if it was the first to end IO on the connection
+            // ** must be called holding the socket lock
+            void ReleaseIo(const std::shared_ptr<ctsSocket>& sharedSocket, DWORD error) noexcept
+            {
+                if (error != NO_ERROR && NO_ERROR == m_lastError)
+                {
+                    m_lastError = error;
+                }
+                if (0 == sharedSocket->DecrementIo())
+                {
+                    // if we have no more IO pended, complete the state
+                    sharedSocket->CompleteState(m_lastError);
+                }
+            }
+
+            void FailHandshake(DWORD error) noexcept
+            {
+                g_failedHandshakes.Increment();
+                ctsConfig::PrintErrorIfFailed("TLS handshake", error);
+            }
+
+            // consumes the ciphertext given to Schannel as an input token : leaving any SECBUFFER_EXTRA bytes buffered
+            void ConsumeInputToken(const SecBuffer& extraBuffer) noexcept
+            {
+                if (SECBUFFER_EXTRA == extraBuffer.BufferType && extraBuffer.cbBuffer <= m_cipherBytes)
+                {
+                    m_cipherOffset += m_cipherBytes - extraBuffer.cbBuffer;
+                    m_cipherBytes = extraBuffer.cbBuffer;
+                }
+                else
+                {
+                    m_cipherOffset = 0;
+                    m_cipherBytes = 0;
+                }
+            }
+
+            // gives the buffered handshake messages to InitializeSecurityContext or AcceptSecurityContext
+            // - sends the token produced, if any
+            SECURITY_STATUS HandshakeStep(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket) noexcept
+            {
+                SecBuffer inBuffers[2]{};
+                inBuffers[0].BufferType = SECBUFFER_TOKEN;
+                inBuffers[0].pvBuffer = m_recvBuffer.data() + m_cipherOffset;
+                inBuffers[0].cbBuffer = m_cipherBytes;
+                inBuffers[1].BufferType = SECBUFFER_EMPTY;
+                SecBufferDesc inDesc{SECBUFFER_VERSION, 2, inBuffers};
+
+                SecBuffer outBuffer{0, SECBUFFER_TOKEN, nullptr};
+                SecBufferDesc outDesc{SECBUFFER_VERSION, 1, &outBuffer};
+
+                ULONG attributes = 0;
+                SECURITY_STATUS status;
+                if (ctsConfig::IsListening())
+                {
+                    status = AcceptSecurityContext(
+                        &g_credentials, m_hasContext ? &m_context : nullptr, &inDesc, c_acceptFlags, 0, &m_context, &outDesc, &attributes, nullptr);
+                }
+                else
+                {
+                    // the ClientHello is created without an input token
+                    status = InitializeSecurityContextW(
+                        &g_credentials,
+                        m_hasContext ? &m_context : nullptr,
+                        const_cast<SEC_WCHAR*>(TargetName()),
+                        c_initializeFlags,
+                        0,
+                        0,
+                        m_hasContext ? &inDesc : nullptr,
+                        0,
+                        &m_context,
+                        &outDesc,
+                        &attributes,
+                        nullptr);
+                }
+
+                if (status >= 0)
+                {
+                    m_hasContext = true;
+                }
+                if (status != SEC_E_INCOMPLETE_MESSAGE)
+                {
+                    ConsumeInputToken(inBuffers[1]);
+                }
+
+                if (FAILED(status))
+                {
+                    // not sending the alert Schannel may have created with ISC_REQ_EXTENDED_ERROR
+                    if (outBuffer.pvBuffer)
+                    {
+                        FreeContextBuffer(outBuffer.pvBuffer);
+                    }
+                    return status;
+                }
+
+                const auto error = PostTokenSend(socket, sharedSocket, outBuffer);
+                return NO_ERROR == error ? status : static_cast<SECURITY_STATUS>(error);
+            }
+
+            // runs the handshake over the buffered messages until it needs more from the peer, completes, or fails
+            DWORD ContinueHandshake(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket)
+            {
+                for (;;)
+                {
+                    const auto bufferedBytes = m_cipherBytes;
+                    const auto status = HandshakeStep(socket, sharedSocket);
+                    if (SEC_E_OK == status)
+                    {
+                        return CompleteHandshake();
+                    }
+
+                    if (SEC_I_CONTINUE_NEEDED == status || SEC_I_INCOMPLETE_CREDENTIALS == status)
+                    {
+                        // continue while Schannel consumes what's buffered (no client certificate is ever given)
+                        if (m_cipherBytes > 0 && m_cipherBytes < bufferedBytes)
+                        {
+                            continue;
+                        }
+                        if (SEC_I_INCOMPLETE_CREDENTIALS == status)
+                        {
+                            continue;
+                        }
+                    }
+                    else if (status != SEC_E_INCOMPLETE_MESSAGE)
+                    {
+                        return static_cast<DWORD>(status);
+                    }
+
+                    return PostRecv(socket, sharedSocket, ctsTask{}, true);
+                }
+            }
+
+            DWORD CompleteHandshake()
+            {
+                const auto status = QueryContextAttributesW(&m_context, SECPKG_ATTR_STREAM_SIZES, &m_streamSizes);
+                if (status != SEC_E_OK)
+                {
+                    return static_cast<DWORD>(status);
+                }
+
+                SecPkgContext_SessionInfo sessionInfo{};
+                if (SEC_E_OK == QueryContextAttributesW(&m_context, SECPKG_ATTR_SESSION_INFO, &sessionInfo) &&
+                    WI_IsFlagSet(sessionInfo.dwFlags, SSL_SESSION_RECONNECT))
+                {
+                    g_resumedHandshakes.Increment();
+                }
+                g_handshakes.Increment();
+                g_handshakeLatency.Record(ctl::ctTimer::SnapQpc() - m_handshakeStartQpc);
+
+                // any bytes after the handshake are the first records : keeping them at their offset
+                const DWORD recordLength = m_streamSizes.cbHeader + m_streamSizes.cbMaximumMessage + m_streamSizes.cbTrailer;
+                if (m_recvBuffer.size() < recordLength * c_recvRecordCount)
+                {
+                    m_recvBuffer.resize(recordLength * c_recvRecordCount);
+                }
+                m_handshakeComplete = true;
+                return NO_ERROR;
+            }
+
+            // posts a WSARecv for more ciphertext after the bytes already buffered
+            // - returns NO_ERROR once the recv is pended : its completion releases the IO count taken here
+            DWORD PostRecv(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const ctsTask& task, bool handshake) noexcept
+            {
+                try
+                {
+                    // no plaintext is outstanding when more ciphertext is needed : the buffered ciphertext can be moved to the front
+                    if (m_cipherOffset > 0)
+                    {
+                        memmove(m_recvBuffer.data(), m_recvBuffer.data() + m_cipherOffset, m_cipherBytes);
+                        m_cipherOffset = 0;
+                    }
+                    if (m_cipherBytes == m_recvBuffer.size())
+                    {
+                        m_recvBuffer.resize(m_recvBuffer.size() * 2);
+                    }
+                }
+                catch (...)
+                {
+                    return ctsConfig::PrintThrownException();
+                }
+
+                sharedSocket->IncrementIo();
+                DWORD error = NO_ERROR;
+                try
+                {
+                    const std::shared_ptr<ctl::ctThreadIocp>& ioThreadPool(sharedSocket->GetIocpThreadpool());
+                    auto callback = [self = shared_from_this(), task, handshake](OVERLAPPED* pCallbackOverlapped) noexcept {
+                        self->RecvCompletion(pCallbackOverlapped, task, handshake);
+                    };
+                    // every recv of ciphertext constructs this callback : it must stay in place so IO never allocates it
+                    static_assert(ctl::ctThreadIocpCallbackInfo::stored_in_place<decltype(callback)>, "the ctsTask captured per IO must fit in ctThreadIocpCallbackInfo::c_callbackStorageSize");
+                    OVERLAPPED* const pOverlapped = ioThreadPool->new_request(std::move(callback));
+
+                    WSABUF wsabuffer{};
+                    wsabuffer.buf = m_recvBuffer.data() + m_cipherBytes;
+                    wsabuffer.len = static_cast<ULONG>(m_recvBuffer.size() - m_cipherBytes);
+                    DWORD flags = 0;
+                    if (WSARecv(socket, &wsabuffer, 1, nullptr, &flags, pOverlapped, nullptr) != 0)
+                    {
+                        error = WSAGetLastError();
+                        if (error != WSA_IO_PENDING)
+                        {
+                            // must cancel the IOCP TP since IO is not pended
+                            ioThreadPool->cancel_request(pOverlapped);
+                        }
+                        else
+                        {
+                            error = NO_ERROR;
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    error = ctsConfig::PrintThrownException();
+                }
+
+                if (error != NO_ERROR)
+                {
+                    // the caller holds its own IO count : this never reaches zero
+                    sharedSocket->DecrementIo();
+                }
+                return error;
+            }
+
+            // posts a WSASend of the ciphertext in the send buffer
+            // - returns NO_ERROR once the send is pended : its completion releases the IO count taken here
+            DWORD PostSend(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const ctsTask& task, std::shared_ptr<std::vector<char>>&& sendBuffer, DWORD sendLength) noexcept
+            {
+                sharedSocket->IncrementIo();
+                DWORD error = NO_ERROR;
+                try
+                {
+                    WSABUF wsabuffer{};
+                    wsabuffer.buf = sendBuffer->data();
+                    wsabuffer.len = sendLength;
+
+                    const std::shared_ptr<ctl::ctThreadIocp>& ioThreadPool(sharedSocket->GetIocpThreadpool());
+                    auto callback = [self = shared_from_this(), task, sendBuffer = std::move(sendBuffer), sendLength](OVERLAPPED* pCallbackOverlapped) noexcept {
+                        self->SendCompletion(pCallbackOverlapped, task, sendBuffer, sendLength);
+                    };
+                    // every send of ciphertext constructs this callback : it must stay in place so IO never allocates it
+                    static_assert(ctl::ctThreadIocpCallbackInfo::stored_in_place<decltype(callback)>, "the ctsTask captured per IO must fit in ctThreadIocpCallbackInfo::c_callbackStorageSize");
+                    OVERLAPPED* const pOverlapped = ioThreadPool->new_request(std::move(callback));
+
+                    if (WSASend(socket, &wsabuffer, 1, nullptr, 0, pOverlapped, nullptr) != 0)
+                    {
+                        error = WSAGetLastError();
+                        if (error != WSA_IO_PENDING)
+                        {
+                            // must cancel the IOCP TP since IO is not pended
+                            ioThreadPool->cancel_request(pOverlapped);
+                        }
+                        else
+                        {
+                            error = NO_ERROR;
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    error = ctsConfig::PrintThrownException();
+                }
+
+                if (error != NO_ERROR)
+                {
+                    // the caller holds its own IO count : this never reaches zero
+                    sharedSocket->DecrementIo();
+                }
+                return error;
+            }
+
+            // sends a token from Schannel (handshake messages, close_notify) : freed once the send completes
+            DWORD PostTokenSend(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const SecBuffer& token) noexcept
+            {
+                if (nullptr == token.pvBuffer)
+                {
+                    return NO_ERROR;
+                }
+                if (0 == token.cbBuffer)
+                {
+                    FreeContextBuffer(token.pvBuffer);
+                    return NO_ERROR;
+                }
+
+                sharedSocket->IncrementIo();
+                DWORD error = NO_ERROR;
+                void* const tokenBuffer = token.pvBuffer;
+                try
+                {
+                    const std::shared_ptr<ctl::ctThreadIocp>& ioThreadPool(sharedSocket->GetIocpThreadpool());
+                    OVERLAPPED* const pOverlapped = ioThreadPool->new_request(
+                        [self = shared_from_this(), tokenBuffer](OVERLAPPED* pCallbackOverlapped) noexcept {
+                            self->TokenSendCompletion(pCallbackOverlapped, tokenBuffer);
+                        });
+
+                    WSABUF wsabuffer{};
+                    wsabuffer.buf = static_cast<char*>(token.pvBuffer);
+                    wsabuffer.len = token.cbBuffer;
+                    if (WSASend(socket, &wsabuffer, 1, nullptr, 0, pOverlapped, nullptr) != 0)
+                    {
+                        error = WSAGetLastError();
+                        if (error != WSA_IO_PENDING)
+                        {
+                            // must cancel the IOCP TP since IO is not pended
+                            ioThreadPool->cancel_request(pOverlapped);
+                        }
+                        else
+                        {
+                            error = NO_ERROR;
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    error = ctsConfig::PrintThrownException();
+                }
+
+                if (error != NO_ERROR)
+                {
+                    FreeContextBuffer(tokenBuffer);
+                    // the caller holds its own IO count : this never reaches zero
+                    sharedSocket->DecrementIo();
+                }
+                return error;
+            }
+
+            // -io:tls graceful shutdown : the TLS close_notify alert is sent ahead of the FIN
+            DWORD SendCloseNotify(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket) noexcept
+            {
+                DWORD shutdownToken = SCHANNEL_SHUTDOWN;
+                SecBuffer tokenBuffer{static_cast<unsigned long>(sizeof shutdownToken), SECBUFFER_TOKEN, &shutdownToken};
+                SecBufferDesc tokenDesc{SECBUFFER_VERSION, 1, &tokenBuffer};
+                auto status = ApplyControlToken(&m_context, &tokenDesc);
+                if (status != SEC_E_OK)
+                {
+                    return static_cast<DWORD>(status);
+                }
+
+                SecBuffer outBuffer{0, SECBUFFER_TOKEN, nullptr};
+                SecBufferDesc outDesc{SECBUFFER_VERSION, 1, &outBuffer};
+                ULONG attributes = 0;
+                if (ctsConfig::IsListening())
+                {
+                    status = AcceptSecurityContext(
+                        &g_credentials, &m_context, nullptr, c_acceptFlags, 0, nullptr, &outDesc, &attributes, nullptr);
+                }
+                else
+                {
+                    status = InitializeSecurityContextW(
+                        &g_credentials, &m_context, const_cast<SEC_WCHAR*>(TargetName()), c_initializeFlags, 0, 0, nullptr, 0, &m_context, &outDesc, &attributes, nullptr);
+                }
+                if (FAILED(status))
+                {
+                    if (outBuffer.pvBuffer)
+                    {
+                        FreeContextBuffer(outBuffer.pvBuffer);
+                    }
+                    return static_cast<DWORD>(status);
+                }
+                return PostTokenSend(socket, sharedSocket, outBuffer);
+            }
+
+            // decrypts the record at the front of the buffered ciphertext in place
+            SECURITY_STATUS DecryptRecord() noexcept
+            {
+                SecBuffer buffers[4]{};
+                buffers[0].BufferType = SECBUFFER_DATA;
+                buffers[0].pvBuffer = m_recvBuffer.data() + m_cipherOffset;
+                buffers[0].cbBuffer = m_cipherBytes;
+                buffers[1].BufferType = SECBUFFER_EMPTY;
+                buffers[2].BufferType = SECBUFFER_EMPTY;
+                buffers[3].BufferType = SECBUFFER_EMPTY;
+                SecBufferDesc desc{SECBUFFER_VERSION, 4, buffers};
+
+                const auto startCycles = __rdtsc();
+                const auto status = DecryptMessage(&m_context, &desc, 0, nullptr);
+                g_cryptoCycles.Add(static_cast<long long>(__rdtsc() - startCycles));
+                if (status != SEC_E_OK && status != SEC_I_RENEGOTIATE && status != SEC_I_CONTEXT_EXPIRED)
+                {
+                    return status;
+                }
+
+                SecBuffer extraBuffer{};
+                for (const auto& buffer : buffers)
+                {
+                    if (SECBUFFER_DATA == buffer.BufferType)
+                    {
+                        m_plaintext = static_cast<char*>(buffer.pvBuffer);
+                        m_plaintextBytes = buffer.cbBuffer;
+                    }
+                    else if (SECBUFFER_EXTRA == buffer.BufferType)
+                    {
+                        extraBuffer = buffer;
+                    }
+                }
+                ConsumeInputToken(extraBuffer);
+                g_plaintextBytes.Add(m_plaintextBytes);
+                g_records.Increment();
+
+                if (SEC_I_CONTEXT_EXPIRED == status)
+                {
+                    m_peerClosed = true;
+                    m_cipherBytes = 0;
+                }
+                else if (SEC_I_RENEGOTIATE == status)
+                {
+                    // TLS 1.3 : the remaining ciphertext starts with a post-handshake message for Schannel
+                    m_postHandshakePending = true;
+                }
+                return SEC_E_OK;
+            }
+
+            // gives the recv task buffered plaintext, decrypting buffered records for it, else posts a recv for more ciphertext
+            ctsTlsStatus DeliverOrRecv(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& task) noexcept
+            {
+                for (;;)
+                {
+                    if (m_plaintextBytes > 0)
+                    {
+                        const DWORD copied = std::min(m_plaintextBytes, task.m_bufferLength);
+                        memcpy(task.m_buffer + task.m_bufferOffset, m_plaintext, copied);
+                        m_plaintext += copied;
+                        m_plaintextBytes -= copied;
+                        return CompleteTask(pattern, task, copied, NO_ERROR, "DecryptMessage");
+                    }
+                    if (0 == m_cipherBytes && !m_postHandshakePending)
+                    {
+                        break;
+                    }
+
+                    const auto bufferedBytes = m_cipherBytes;
+                    SECURITY_STATUS status;
+                    if (m_postHandshakePending)
+                    {
+                        status = HandshakeStep(socket, sharedSocket);
+                        if (SEC_E_OK == status)
+                        {
+                            m_postHandshakePending = false;
+                            continue;
+                        }
+                        if (SEC_I_CONTINUE_NEEDED == status && m_cipherBytes > 0 && m_cipherBytes < bufferedBytes)
+                        {
+                            continue;
+                        }
+                        if (SEC_I_CONTINUE_NEEDED == status || SEC_E_INCOMPLETE_MESSAGE == status)
+                        {
+                            break;
+                        }
+                        return CompleteTask(pattern, task, 0, static_cast<DWORD>(status), "TLS post-handshake");
+                    }
+
+                    status = DecryptRecord();
+                    if (SEC_E_INCOMPLETE_MESSAGE == status)
+                    {
+                        break;
+                    }
+                    if (status != SEC_E_OK)
+                    {
+                        return CompleteTask(pattern, task, 0, static_cast<DWORD>(status), "DecryptMessage");
+                    }
+                }
+
+                if (m_peerClosed)
+                {
+                    return CompleteTask(pattern, task, 0, NO_ERROR, "WSARecv");
+                }
+
+                const auto error = PostRecv(socket, sharedSocket, task, false);
+                if (error != NO_ERROR)
+                {
+                    return CompleteTask(pattern, task, 0, error, "WSARecv");
+                }
+                return {};
+            }
+
+            // encrypts the send task's buffer into as many records as it needs, and posts them as a single WSASend
+            ctsTlsStatus EncryptAndSend(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& task) noexcept
+            {
+                const DWORD maxMessage = m_streamSizes.cbMaximumMessage;
+                const DWORD recordLength = m_streamSizes.cbHeader + maxMessage + m_streamSizes.cbTrailer;
+                const DWORD recordCount = (task.m_bufferLength + maxMessage - 1) / maxMessage;
+
+                std::shared_ptr<std::vector<char>> sendBuffer;
+                try
+                {
+                    if (m_sendBuffers.empty())
+                    {
+                        sendBuffer = std::make_shared<std::vector<char>>();
+                    }
+                    else
+                    {
+                        sendBuffer = std::move(m_sendBuffers.back());
+                        m_sendBuffers.pop_back();
+                    }
+                    if (sendBuffer->size() < static_cast<size_t>(recordLength) * recordCount)
+                    {
+                        sendBuffer->resize(static_cast<size_t>(recordLength) * recordCount);
+                    }
+                }
+                catch (...)
+                {
+                    return CompleteTask(pattern, task, 0, ctsConfig::PrintThrownException(), "EncryptMessage");
+                }
+
+                const char* plaintext = task.m_buffer + task.m_bufferOffset;
+                DWORD remaining = task.m_bufferLength;
+                DWORD sendLength = 0;
+                const auto startCycles = __rdtsc();
+                while (remaining > 0)
+                {
+                    const DWORD messageLength = std::min(remaining, maxMessage);
+                    char* const record = sendBuffer->data() + sendLength;
+                    memcpy(record + m_streamSizes.cbHeader, plaintext, messageLength);
+
+                    SecBuffer buffers[4]{};
+                    buffers[0] = {m_streamSizes.cbHeader, SECBUFFER_STREAM_HEADER, record};
+                    buffers[1] = {messageLength, SECBUFFER_DATA, record + m_streamSizes.cbHeader};
+                    buffers[2] = {m_streamSizes.cbTrailer, SECBUFFER_STREAM_TRAILER, record + m_streamSizes.cbHeader + messageLength};
+                    buffers[3] = {0, SECBUFFER_EMPTY, nullptr};
+                    SecBufferDesc desc{SECBUFFER_VERSION, 4, buffers};
+                    const auto status = EncryptMessage(&m_context, 0, &desc, 0);
+                    if (status != SEC_E_OK)
+                    {
+                        return CompleteTask(pattern, task, 0, static_cast<DWORD>(status), "EncryptMessage");
+                    }
+
+                    // the trailer written can be shorter than cbTrailer
+                    sendLength += buffers[0].cbBuffer + buffers[1].cbBuffer + buffers[2].cbBuffer;
+                    plaintext += messageLength;
+                    remaining -= messageLength;
+                    g_records.Increment();
+                }
+                g_cryptoCycles.Add(static_cast<long long>(__rdtsc() - startCycles));
+                g_plaintextBytes.Add(task.m_bufferLength);
+
+                const auto error = PostSend(socket, sharedSocket, task, std::move(sendBuffer), sendLength);
+                if (error != NO_ERROR)
+                {
+                    return CompleteTask(pattern, task, 0, error, "WSASend");
+                }
+                g_ciphertextBytes.Add(sendLength);
+                return {};
+            }
+
+            ctsTlsStatus ProcessTask(SOCKET socket, const std::shared_ptr<ctsSocket>& sharedSocket, const std::shared_ptr<ctsIoPattern>& pattern, const ctsTask& task) noexcept
+            {
+                // if we no longer have a valid socket return early
+                if (INVALID_SOCKET == socket)
+                {
+                    // even if the socket was closed we still must complete the IO request
+                    pattern->CompleteIo(task, 0, WSAECONNABORTED);
+                    return {WSAECONNABORTED, true};
+                }
+
+                switch (task.m_ioAction)
+                {
+                    case ctsTaskAction::GracefulShutdown:
+                    {
+                        // the FIN is queued behind the close_notify send
+                        auto error = SendCloseNotify(socket, sharedSocket);
+                        if (shutdown(socket, SD_SEND) != 0 && NO_ERROR == error)
+                        {
+                            error = WSAGetLastError();
+                        }
+                        return CompleteTask(pattern, task, 0, error, "shutdown");
+                    }
+
+                    case ctsTaskAction::HardShutdown:
+                        // pass through -1 to force an RST with the closesocket
+                        return CompleteTask(pattern, task, 0, sharedSocket->CloseSocket(-1), "closesocket");
+
+                    case ctsTaskAction::Send:
+                        return EncryptAndSend(socket, sharedSocket, pattern, task);
+
+                    default:
+                        return DeliverOrRecv(socket, sharedSocket, pattern, task);
+                }
+            }
+
+            // the timer callback for a task the pattern delayed
+            void ProcessScheduledTask(const ctsTask& task) noexcept
+            {
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    return;
+                }
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                if (!lockedPattern)
+                {
+                    return;
+                }
+
+                const auto status = ProcessTask(lockedSocket.GetSocket(), sharedSocket, lockedPattern, task);
+                // continue requesting IO if this connection still isn't done with all IO after the scheduled IO
+                if (!status.m_ioDone)
+                {
+                    RequestIo();
+                }
+                // finally release the IO count held for the timer
+                ReleaseIo(sharedSocket, status.m_ioErrorcode);
+            }
+
+            // reads the result of a completed WSASend or WSARecv under the socket lock
+            static DWORD ReadCompletion(SOCKET socket, bool patternIsValid, _In_ OVERLAPPED* pOverlapped, bool completedSuccessfully, _Inout_ DWORD* transferred) noexcept
+            {
+                if (!patternIsValid || INVALID_SOCKET == socket)
+                {
+                    *transferred = 0;
+                    return WSAECONNABORTED;
+                }
+                if (!completedSuccessfully)
+                {
+                    DWORD flags;
+                    if (!WSAGetOverlappedResult(socket, pOverlapped, transferred, FALSE, &flags))
+                    {
+                        return WSAGetLastError();
+                    }
+                }
+                return NO_ERROR;
+            }
+
+            void RecvCompletion(_In_ OVERLAPPED* pOverlapped, const ctsTask& task, bool handshake) noexcept
+            {
+                const ctsThreadStatistics::ctsCallbackScope callbackScope;
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    return;
+                }
+
+                DWORD transferred = 0;
+                const bool completedSuccessfully = ReadSuccessfulCompletion(pOverlapped, &transferred);
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                const SOCKET socket = lockedSocket.GetSocket();
+                const DWORD gle = ReadCompletion(socket, !!lockedPattern, pOverlapped, completedSuccessfully, &transferred);
+                if (gle != NO_ERROR) { PRINT_DEBUG_INFO(L"\t\tIO Failed: WSARecv (%u) [ctsTlsIocp]\n", gle); }
+                ctsThreadStatistics::RecordCompletion(transferred, false);
+
+                if (NO_ERROR == gle)
+                {
+                    if (0 == transferred)
+                    {
+                        m_peerClosed = true;
+                    }
+                    else
+                    {
+                        m_cipherBytes += transferred;
+                    }
+                }
+
+                DWORD error = gle;
+                if (handshake)
+                {
+                    if (NO_ERROR == error)
+                    {
+                        try
+                        {
+                            error = m_peerClosed ? WSAECONNRESET : ContinueHandshake(socket, sharedSocket);
+                        }
+                        catch (...)
+                        {
+                            error = ctsConfig::PrintThrownException();
+                        }
+                    }
+
+                    if (error != NO_ERROR)
+                    {
+                        FailHandshake(error);
+                    }
+                    else if (m_handshakeComplete)
+                    {
+                        RequestIo();
+                    }
+                }
+                else if (lockedPattern)
+                {
+                    g_ciphertextBytes.Add(transferred);
+                    const auto status = NO_ERROR == gle ?
+                        DeliverOrRecv(socket, sharedSocket, lockedPattern, task) :
+                        CompleteTask(lockedPattern, task, 0, gle, "WSARecv");
+                    if (!status.m_ioDone)
+                    {
+                        RequestIo();
+                    }
+                    error = status.m_ioErrorcode;
+                }
+
+                // always release *after* attempting new IO : the prior IO is now formally "done"
+                ReleaseIo(sharedSocket, error);
+            }
+
+            void SendCompletion(_In_ OVERLAPPED* pOverlapped, const ctsTask& task, const std::shared_ptr<std::vector<char>>& sendBuffer, DWORD sendLength) noexcept
+            {
+                const ctsThreadStatistics::ctsCallbackScope callbackScope;
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    return;
+                }
+
+                DWORD transferred = 0;
+                const bool completedSuccessfully = ReadSuccessfulCompletion(pOverlapped, &transferred);
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const auto lockedPattern = lockedSocket.GetPattern();
+                DWORD gle = ReadCompletion(lockedSocket.GetSocket(), !!lockedPattern, pOverlapped, completedSuccessfully, &transferred);
+                if (NO_ERROR == gle && transferred != sendLength)
+                {
+                    gle = WSAECONNABORTED;
+                }
+                if (gle != NO_ERROR) { PRINT_DEBUG_INFO(L"\t\tIO Failed: WSASend (%u) [ctsTlsIocp]\n", gle); }
+                ctsThreadStatistics::RecordCompletion(transferred, false);
+
+                try
+                {
+                    m_sendBuffers.push_back(sendBuffer);
+                }
+                catch (...)
+                {
+                    // the buffer is just not reused
+                }
+
+                DWORD error = gle;
+                if (lockedPattern)
+                {
+                    // the pattern sees the plaintext bytes of its task as sent
+                    const auto status = CompleteTask(lockedPattern, task, NO_ERROR == gle ? task.m_bufferLength : 0, gle, "WSASend");
+                    if (!status.m_ioDone)
+                    {
+                        RequestIo();
+                    }
+                    error = status.m_ioErrorcode;
+                }
+
+                // always release *after* attempting new IO : the prior IO is now formally "done"
+                ReleaseIo(sharedSocket, error);
+            }
+
+            void TokenSendCompletion(_In_ OVERLAPPED* pOverlapped, _In_ void* tokenBuffer) noexcept
+            {
+                FreeContextBuffer(tokenBuffer);
+
+                const auto sharedSocket(m_weakSocket.lock());
+                if (!sharedSocket)
+                {
+                    return;
+                }
+
+                DWORD transferred = 0;
+                const bool completedSuccessfully = ReadSuccessfulCompletion(pOverlapped, &transferred);
+
+                // hold a reference on the socket
+                const auto lockedSocket = sharedSocket->AcquireSocketLock();
+                const DWORD gle = completedSuccessfully ? NO_ERROR : ReadCompletion(lockedSocket.GetSocket(), true, pOverlapped, false, &transferred);
+                if (gle != NO_ERROR) { PRINT_DEBUG_INFO(L"\t\tIO Failed: WSASend of a TLS token (%u) [ctsTlsIocp]\n", gle); }
+
+                // once negotiated, a failed token (a close_notify or a post-handshake message) is also seen by the pattern's own IO
+                ReleaseIo(sharedSocket, m_handshakeComplete ? NO_ERROR : gle);
+            }
+        };
+    }
+
+    // The function registered with ctsConfig
+    void ctsTlsIocp(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        // attempt to get a reference to the socket
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        //
+        // guarantee the credentials are acquired
+        //
+        if (!InitOnceExecuteOnce(&TlsIo::g_credentialsInitializer, TlsIo::InitOnceCredentials, nullptr, nullptr))
+        {
+            auto gle = GetLastError();
+            if (0 == gle)
+            {
+                gle = static_cast<DWORD>(SEC_E_NO_CREDENTIALS);
+            }
+            sharedSocket->CompleteState(gle);
+            return;
+        }
+
+        std::shared_ptr<TlsIo::ctsTlsSocketContext> socketContext;
+        try
+        {
+            socketContext = std::make_shared<TlsIo::ctsTlsSocketContext>(weakSocket);
+        }
+        catch (...)
+        {
+            sharedSocket->CompleteState(ctsConfig::PrintThrownException());
+            return;
+        }
+
+        // the pattern's IO is requested once the handshake completes
+        socketContext->StartHandshake();
+    }
+
+    void ctsTlsPrintSummary(long long totalTimeMilliseconds) noexcept
+    {
+        if (ctsConfig::g_configSettings->IoFunction != ctsTlsIocp)
+        {
+            return;
+        }
+
+        const auto handshakes = TlsIo::g_handshakes.GetValue();
+        const auto resumedHandshakes = TlsIo::g_resumedHandshakes.GetValue();
+        const auto plaintextBytes = TlsIo::g_plaintextBytes.GetValue();
+        const auto ciphertextBytes = TlsIo::g_ciphertextBytes.GetValue();
+        const auto seconds = totalTimeMilliseconds > 0 ? static_cast<double>(totalTimeMilliseconds) / 1000.0 : 0.0;
+        const auto handshakeLatency = TlsIo::g_handshakeLatency.GetTotal();
+        ctsConfig::PrintSummary(
+            L"\n"
+            L"  TLS (Schannel) :\n"
+            L"    Handshakes : %lld (%.1f per sec)  Resumed [%lld] (%.1f%%)  Failed [%lld]\n"
+            L"    Handshake Latency (us) : Median [%lld]  99th [%lld]  Max [%lld]\n"
+            L"    Encrypted Throughput : %.3f MB/sec  (%lld plaintext bytes in %lld records, %lld ciphertext bytes)\n"
+            L"    Encrypt/Decrypt : %.3f cycles/byte  (the TSC around EncryptMessage and DecryptMessage)\n",
+            handshakes,
+            seconds > 0.0 ? static_cast<double>(handshakes) / seconds : 0.0,
+            resumedHandshakes,
+            handshakes > 0 ? static_cast<double>(resumedHandshakes) / static_cast<double>(handshakes) * 100.0 : 0.0,
+            TlsIo::g_failedHandshakes.GetValue(),
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(handshakeLatency.GetPercentile(50.0)),
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(handshakeLatency.GetPercentile(99.0)),
+            ctsLatencySnapshot::ConvertTicksToMicroseconds(handshakeLatency.GetMaximum()),
+            seconds > 0.0 ? static_cast<double>(plaintextBytes) / 1048576.0 / seconds : 0.0,
+            plaintextBytes,
+            TlsIo::g_records.GetValue(),
+            ciphertextBytes,
+            plaintextBytes > 0 ? static_cast<double>(TlsIo::g_cryptoCycles.GetValue()) / static_cast<double>(plaintextBytes) : 0.0);
+    }
+} // namespace
@@ -0,0 +1,34 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// declaration header
+#include "ctsTraceLogging.h"
+// wil headers
+#include <wil/result.h>
+
+namespace ctsTraffic
+{
+    // {c21cae82-e297-59c9-6224-fc821b28bc71} is the ETW name-hashed GUID for "ctsTraffic"
+    TRACELOGGING_DEFINE_PROVIDER(
+        g_ctsTraceLoggingProvider,
+        "ctsTraffic",
+        (0xc21cae82, 0xe297, 0x59c9, 0x62, 0x24, 0xfc, 0x82, 0x1b, 0x28, 0xbc, 0x71));
+
+    void ctsTraceLoggingRegister() noexcept
+    {
+        // tracing is optional: the process continues without the provider if registration fails
+        // - never unregistered: ETW releases the registration at process exit,
+        //   and IO threads can still be writing events while ctsTraffic shuts down
+        LOG_IF_FAILED(TraceLoggingRegister(g_ctsTraceLoggingProvider));
+    }
+}
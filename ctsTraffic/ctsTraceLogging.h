@@ -0,0 +1,56 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// os headers
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+// ** NOTE ** should not include any local project cts headers - to avoid circular references
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// ctsTraffic TraceLogging (ETW) provider
+///
+/// - provider name "ctsTraffic" : {c21cae82-e297-59c9-6224-fc821b28bc71} (the name-hashed GUID)
+///   e.g. capturing with the kernel network events into one trace:
+///     xperf -on PROC_THREAD+LOADER+NETWORKTRACE -start cts -on *ctsTraffic
+///     xperf -stop cts -stop -d ctsTraffic.etl
+/// - TraceLoggingWrite only tests the provider's enabled level and keywords when no session is listening,
+///   so instrumenting hot paths costs a single branch when not tracing
+/// - events are timestamped by ETW with QPC, so they line up with kernel events on the same timeline
+///
+/// Keywords select the area to trace:
+///
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// InitiateIo / CompleteIo for every IO request
+#define CTS_TRACE_KEYWORD_IO 0x1
+// ctsSocketState transitions
+#define CTS_TRACE_KEYWORD_CONNECTION 0x2
+// ctsSocketBroker scavenging closed sockets
+#define CTS_TRACE_KEYWORD_BROKER 0x4
+// RIO completion queue resizes
+#define CTS_TRACE_KEYWORD_RIO 0x8
+// MediaStream frames rendered by the client
+#define CTS_TRACE_KEYWORD_MEDIA_STREAM 0x10
+
+namespace ctsTraffic
+{
+    TRACELOGGING_DECLARE_PROVIDER(g_ctsTraceLoggingProvider);
+
+    // registered once with the ctsConfig settings - events written before or after registration are dropped
+    void ctsTraceLoggingRegister() noexcept;
+}
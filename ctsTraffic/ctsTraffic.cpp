@@ -26,7 +26,15 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <wil/resource.h>
 // local headers
 #include "ctsConfig.h"
+#include "ctsBinaryLog.h"
+#include "ctsCheckpoint.h"
+#include "ctsLocalPorts.h"
+#include "ctsSocketPool.h"
+#include "ctsPerfCounters.h"
+#include "ctsSharedStats.h"
 #include "ctsSocketBroker.h"
+#include "ctsTCPFunctions.h"
+#include "ctsWorkerProcesses.h"
 
 using namespace ctsTraffic;
 using namespace ctl;
@@ -53,6 +61,50 @@ int __cdecl wmain(int argc, _In_reads_z_(argc) const wchar_t** argv)
         return wsError;
     }
 
+    // -ConvertLog:<filename>.ctsb converts a binary log from a prior run to csv - it is not run with other options
+    constexpr wchar_t convertLogArgument[] = L"-ConvertLog:";
+    constexpr size_t convertLogArgumentLength = ARRAYSIZE(convertLogArgument) - 1;
+    if (2 == argc && 0 == _wcsnicmp(argv[1], convertLogArgument, convertLogArgumentLength))
+    {
+        try
+        {
+            ctsConvertBinaryLog(argv[1] + convertLogArgumentLength);
+            return 0;
+        }
+        catch (const invalid_argument& e)
+        {
+            ctsConfig::PrintErrorInfoOverride(wil::str_printf<std::wstring>(L"Invalid argument specified: %hs", e.what()).c_str());
+            return ERROR_INVALID_DATA;
+        }
+        catch (...)
+        {
+            const auto error = ctsConfig::PrintThrownException();
+            return static_cast<int>(error);
+        }
+    }
+
+    // -RebuildSummary:<filename> prints the summary from the latest checkpoint of a prior run - it is not run with other options
+    constexpr wchar_t rebuildSummaryArgument[] = L"-RebuildSummary:";
+    constexpr size_t rebuildSummaryArgumentLength = ARRAYSIZE(rebuildSummaryArgument) - 1;
+    if (2 == argc && 0 == _wcsnicmp(argv[1], rebuildSummaryArgument, rebuildSummaryArgumentLength))
+    {
+        try
+        {
+            ctsRebuildSummary(argv[1] + rebuildSummaryArgumentLength);
+            return 0;
+        }
+        catch (const invalid_argument& e)
+        {
+            ctsConfig::PrintErrorInfoOverride(wil::str_printf<std::wstring>(L"Invalid argument specified: %hs", e.what()).c_str());
+            return ERROR_INVALID_DATA;
+        }
+        catch (...)
+        {
+            const auto error = ctsConfig::PrintThrownException();
+            return static_cast<int>(error);
+        }
+    }
+
     DWORD err = ERROR_SUCCESS;
     try
     {
@@ -106,14 +158,93 @@ int __cdecl wmain(int argc, _In_reads_z_(argc) const wchar_t** argv)
         ctsConfig::PrintSettings();
         ctsConfig::PrintLegend();
 
+        // -PrecreateSockets : the sockets are created before the clock starts (by each worker with -Workers)
+        if (ctsConfig::g_configSettings->PrecreateSockets && 0 == ctsConfig::g_configSettings->WorkerProcesses)
+        {
+            ctsSocketPool::Precreate(ctsConfig::g_configSettings->ConnectionLimit);
+        }
+
         // set the start timer as close as possible to the start of the engine
         ctsConfig::g_configSettings->StartTimeMilliseconds = ctTimer::SnapQpcInMillis();
-        std::shared_ptr<ctsSocketBroker> broker(std::make_shared<ctsSocketBroker>());
-        g_socketBroker = broker.get();
-        broker->Start();
+        // -Relay reports the CPU per forwarded byte
+        if (ctsConfig::g_configSettings->PrintCpuEfficiency || !ctsConfig::g_configSettings->RelayAddresses.empty())
+        {
+            ctsConfig::g_configSettings->StartCpu = ctsCpuSnapshot::Snap();
+        }
+        // the counters, the shared stats and the checkpoints must outlive the timer updating them
+        ctsPerfCounters perfCounters;
+        std::unique_ptr<ctsCheckpointWriter> checkpoints;
+        if (ctsConfig::g_configSettings->CheckpointFilename)
+        {
+            checkpoints = std::make_unique<ctsCheckpointWriter>(ctsConfig::g_configSettings->CheckpointFilename);
+        }
+        std::unique_ptr<ctsSharedStatsWriter> sharedStats;
+        if (ctsConfig::g_configSettings->StatsSharedMemoryName)
+        {
+            sharedStats = std::make_unique<ctsSharedStatsWriter>(ctsConfig::g_configSettings->StatsSharedMemoryName);
+        }
+        else if (ctsConfig::g_configSettings->WorkerStatsSharedMemoryName)
+        {
+            sharedStats = std::make_unique<ctsSharedStatsWriter>(ctsConfig::g_configSettings->WorkerStatsSharedMemoryName, true);
+        }
+        // -Workers : the worker processes run the connections, their totals are folded into this process' statistics
+        std::unique_ptr<ctsWorkerProcesses> workers;
+        std::shared_ptr<ctsSocketBroker> broker;
+        if (ctsConfig::g_configSettings->WorkerProcesses > 0)
+        {
+            workers = std::make_unique<ctsWorkerProcesses>();
+        }
+        else
+        {
+            // the local ports must be ready before the broker creates the first outgoing socket
+            ctsLocalPorts::Initialize();
+            broker = std::make_shared<ctsSocketBroker>();
+            g_socketBroker = broker.get();
+            broker->Start();
+        }
 
         ctThreadpoolTimer statusTimer;
         statusTimer.schedule_reoccuring(ctsConfig::PrintStatusUpdate, 0LL, ctsConfig::g_configSettings->StatusUpdateFrequencyMilliseconds);
+        statusTimer.schedule_reoccuring([&perfCounters]() noexcept { perfCounters.Update(); }, 0LL, ctsPerfCounters::c_updateFrequencyMilliseconds);
+        // a period of 0 fires once : snapping the totals at the steady-state boundaries
+        if (ctsConfig::g_configSettings->WarmUpMilliseconds > 0)
+        {
+            statusTimer.schedule_reoccuring(ctsConfig::SnapSteadyStateStart, ctsConfig::g_configSettings->WarmUpMilliseconds, 0);
+        }
+        if (ctsConfig::g_configSettings->CoolDownMilliseconds > 0)
+        {
+            statusTimer.schedule_reoccuring(
+                ctsConfig::SnapSteadyStateEnd,
+                static_cast<long long>(ctsConfig::g_configSettings->TimeLimit) - ctsConfig::g_configSettings->CoolDownMilliseconds,
+                0);
+        }
+        if (ctsConfig::g_configSettings->ConvergenceTolerancePercent > 0.0)
+        {
+            statusTimer.schedule_reoccuring(ctsConfig::ConvergenceUpdate, 0LL, ctsConfig::g_configSettings->StatusUpdateFrequencyMilliseconds);
+        }
+        if (ctsConfig::g_configSettings->RateSearchStepMilliseconds > 0)
+        {
+            const auto tickMilliseconds = ctsConfig::g_configSettings->RateSearchStepMilliseconds / 4;
+            statusTimer.schedule_reoccuring(ctsConfig::RateSearchUpdate, tickMilliseconds, tickMilliseconds);
+        }
+        if (ctsConfig::g_configSettings->SweepStepMilliseconds > 0)
+        {
+            const auto tickMilliseconds = ctsConfig::g_configSettings->SweepStepMilliseconds / 4;
+            statusTimer.schedule_reoccuring(ctsConfig::SweepUpdate, tickMilliseconds, tickMilliseconds);
+        }
+        if (sharedStats)
+        {
+            statusTimer.schedule_reoccuring([&sharedStats]() noexcept { sharedStats->Update(); }, 0LL, ctsSharedStatsWriter::c_updateFrequencyMilliseconds);
+        }
+        if (checkpoints)
+        {
+            const auto checkpointMilliseconds = static_cast<long long>(ctsConfig::g_configSettings->CheckpointIntervalMilliseconds);
+            statusTimer.schedule_reoccuring([&checkpoints]() noexcept { checkpoints->Update(); }, checkpointMilliseconds, checkpointMilliseconds);
+        }
+        if (workers)
+        {
+            statusTimer.schedule_reoccuring([&workers]() noexcept { workers->Update(); }, 0LL, ctsWorkerProcesses::c_updateFrequencyMilliseconds);
+        }
 
 // define this is testing the shutdown path to force a clean shutdown while running
 // #define DEBUGGING_CTSTRAFFIC
@@ -121,11 +252,34 @@ int __cdecl wmain(int argc, _In_reads_z_(argc) const wchar_t** argv)
 #ifdef  DEBUGGING_CTSTRAFFIC
         getchar();
 #else
-        if (!broker->Wait(ctsConfig::g_configSettings->TimeLimit > 0 ? ctsConfig::g_configSettings->TimeLimit : INFINITE))
+        const DWORD timeLimit = ctsConfig::g_configSettings->TimeLimit > 0 ? ctsConfig::g_configSettings->TimeLimit : INFINITE;
+        if (!(workers ? workers->Wait(timeLimit) : broker->Wait(timeLimit)))
         {
             ctsConfig::PrintSummary(L"\n ** Time-limit of %lu reached **\n", static_cast<unsigned long>(ctsConfig::g_configSettings->TimeLimit));
         }
 #endif
+        if (workers)
+        {
+            workers->Stop();
+        }
+        // the final totals : once the timers are stopped, so the last updates aren't made concurrently with theirs
+        if (workers || sharedStats || checkpoints)
+        {
+            statusTimer.stop_all_timers();
+            if (workers)
+            {
+                workers->Update();
+            }
+            if (sharedStats)
+            {
+                sharedStats->Update();
+            }
+            // the last checkpoint holds the final totals : a rebuilt summary of a completed run matches its printed summary
+            if (checkpoints)
+            {
+                checkpoints->Update();
+            }
+        }
     }
     catch (const ctsSafeIntException& e)
     {
@@ -176,6 +330,30 @@ int __cdecl wmain(int argc, _In_reads_z_(argc) const wchar_t** argv)
             L"  Total Bytes Sent : %lld\n",
             ctsConfig::g_configSettings->TcpStatusDetails.m_bytesRecv.GetValue(),
             ctsConfig::g_configSettings->TcpStatusDetails.m_bytesSent.GetValue());
+        ctsConfig::PrintLatencySummary();
+        ctsConfig::PrintLatencyHistograms();
+        ctsConfig::PrintTransactionSummary(totalTimeRun);
+        ctsConfig::PrintTargetSummary(totalTimeRun);
+        ctsConfig::PrintRateSearchSummary();
+        ctsConfig::PrintSweepSummary();
+        ctsConfig::PrintTcpInfoSummary();
+        if (ctsConfig::g_configSettings->ReuseSockets)
+        {
+            ctsConfig::PrintSummary(
+                L"\n"
+                L"  Sockets Reused : %lld (recycling failed for %lld sockets)\n",
+                ctsSocketPool::GetReusedCount(),
+                ctsSocketPool::GetFailedCount());
+        }
+        if (ctsConfig::g_configSettings->PrecreateSockets && 0 == ctsConfig::g_configSettings->WorkerProcesses)
+        {
+            ctsConfig::PrintSummary(
+                L"\n"
+                L"  Sockets Pre-created : %lld in %lld ms (%lld used by connections)\n",
+                ctsSocketPool::GetPrecreatedCount(),
+                ctsSocketPool::GetPrecreateMilliseconds(),
+                ctsSocketPool::GetPrecreatedUsedCount());
+        }
     }
     else
     {
@@ -209,10 +387,45 @@ int __cdecl wmain(int argc, _In_reads_z_(argc) const wchar_t** argv)
                 errorFrames,
                 totalFrames > 0 ? static_cast<double>(errorFrames) / static_cast<double>(totalFrames) * 100.0 : 0.0);
         }
+        else
+        {
+            const auto sendCalls = ctsConfig::g_configSettings->UdpStatusDetails.m_sendCalls.GetValue();
+            const auto pendedSends = ctsConfig::g_configSettings->UdpStatusDetails.m_pendedSends.GetValue();
+            ctsConfig::PrintSummary(
+                L"\n"
+                L"  Total Send Calls : %lld\n"
+                L"  Total Sends Pended (send buffer full) : %lld (%f)\n",
+                sendCalls,
+                pendedSends,
+                sendCalls > 0 ? static_cast<double>(pendedSends) / static_cast<double>(sendCalls) * 100.0 : 0.0);
+        }
     }
+    ctsConfig::PrintConnectionThrottleSummary();
+    ctsConfig::PrintSteadyStateSummary(totalTimeRun);
+    ctsConfig::PrintConvergenceSummary();
+    ctsConfig::PrintCpuSummary(totalTimeRun);
+    ctsConfig::PrintMemorySummary();
+    ctsConfig::PrintInlineCompletionSummary();
+    ctsConfig::PrintStateTransitionSummary(totalTimeRun);
+    ctsConfig::PrintMessageSummary(totalTimeRun);
+    ctsConfig::PrintPersistentTransferSummary();
+    ctsConfig::PrintProbeSummary();
+    ctsConfig::PrintBlastSummary();
     ctsConfig::PrintSummary(
         L"  Total Time : %lld ms.\n",
         static_cast<long long>(totalTimeRun));
+    if (ctsConfig::g_configSettings->Protocol == ctsConfig::ProtocolType::TCP)
+    {
+        ctsRioPrintSummary();
+        ctsMemoryPrintSummary(totalTimeRun);
+        ctsTlsPrintSummary(totalTimeRun);
+        ctsRelayPrintSummary(totalTimeRun);
+    }
+    else
+    {
+        ctsXdpPrintSummary();
+    }
+    ctsConfig::PrintDroppedLogMessages();
 
     long long errorCount =
         ctsConfig::g_configSettings->ConnectionStatusDetails.m_connectionErrorCount.GetValue() +
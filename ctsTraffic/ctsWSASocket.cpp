@@ -1,172 +1,238 @@
-/*
-
-Copyright (c) Microsoft Corporation
-All rights reserved.
-
-Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
-
-THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
-
-See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
-
-*/
-
-// cpp headers
-#include <memory>
-// os headers
-#include <Windows.h>
-#include <WinSock2.h>
-// wil headers
-#include <wil/stl.h>
-#include <wil/resource.h>
-// ctl headers
-#include <ctString.hpp>
-// project headers
-#include "ctsSocket.h"
-#include "ctsConfig.h"
-
-namespace ctsTraffic
-{
-    static long long g_bindCounter = 0LL;
-    static long long g_targetCounter = 0LL;
-    static long long g_portCounter = 0LL;
-
-    // ReSharper disable once CppInconsistentNaming
-    void ctsWSASocket(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
-    {
-        auto sharedSocket(weakSocket.lock());
-        if (!sharedSocket)
-        {
-            return;
-        }
-
-        USHORT nextPort = 0;
-        if (ctsConfig::g_configSettings->LocalPortHigh != 0 && ctsConfig::g_configSettings->LocalPortLow != 0)
-        {
-            const auto portCounter = ctl::ctMemoryGuardIncrement(&g_portCounter);
-            nextPort = static_cast<USHORT>(portCounter % (ctsConfig::g_configSettings->LocalPortHigh - ctsConfig::g_configSettings->LocalPortLow + 1)) + ctsConfig::g_configSettings->LocalPortLow;
-        }
-        else
-        {
-            nextPort = ctsConfig::g_configSettings->LocalPortLow;
-        }
-
-        //
-        // Find a bind and target address by moving to the next address in the respective vectors
-        //
-        const auto bindSize = ctsConfig::g_configSettings->BindAddresses.size();
-        auto socketCounter = ctl::ctMemoryGuardIncrement(&g_bindCounter);
-        ctl::ctSockaddr localAddr(ctsConfig::g_configSettings->BindAddresses[socketCounter % bindSize]);
-        localAddr.SetPort(nextPort);
-
-        ctl::ctSockaddr targetAddr;
-        if (!ctsConfig::g_configSettings->TargetAddresses.empty())
-        {
-            //
-            // the target address family must match the bind address family
-            // - ctsConfig guarantees that at least address families will match with at least one address in bind and target vectors
-            //
-            const auto targetSize = ctsConfig::g_configSettings->TargetAddresses.size();
-            socketCounter = ctl::ctMemoryGuardIncrement(&g_targetCounter);
-            targetAddr = ctsConfig::g_configSettings->TargetAddresses[socketCounter % targetSize];
-            while (targetAddr.family() != localAddr.family())
-            {
-                socketCounter = ctl::ctMemoryGuardIncrement(&g_targetCounter);
-                targetAddr = ctsConfig::g_configSettings->TargetAddresses[socketCounter % targetSize];
-            }
-        }
-
-        auto socket = INVALID_SOCKET;
-        int gle = 0;
-        PCSTR functionName = "CreateSocket";
-        try
-        {
-            switch (ctsConfig::g_configSettings->Protocol)
-            {
-                case ctsConfig::ProtocolType::TCP:
-                    socket = ctsConfig::CreateSocket(localAddr.family(), SOCK_STREAM, IPPROTO_TCP, ctsConfig::g_configSettings->SocketFlags);
-                    break;
-
-                case ctsConfig::ProtocolType::UDP:
-                    socket = ctsConfig::CreateSocket(localAddr.family(), SOCK_DGRAM, IPPROTO_UDP, ctsConfig::g_configSettings->SocketFlags);
-                    break;
-
-                case ctsConfig::ProtocolType::NoProtocolSet: // fall-through
-                default:  // NOLINT(clang-diagnostic-covered-switch-default)
-                    ctsConfig::PrintErrorInfo(
-                        L"Unknown socket protocol (%u)",
-                        static_cast<unsigned>(ctsConfig::g_configSettings->Protocol));
-                    gle = WSAEINVAL;
-            }
-        }
-        catch (const wil::ResultException& e)
-        {
-            gle = ctsConfig::Win32FromHresult(e.GetErrorCode());
-        }
-        catch (...)
-        {
-            gle = WSAENOBUFS;
-        }
-
-        if (NO_ERROR == gle)
-        {
-            functionName = "SetPreBindOptions";
-            gle = ctsConfig::SetPreBindOptions(socket, localAddr);
-        }
-
-        if (NO_ERROR == gle)
-        {
-            functionName = "bind";
-
-            if (0 == nextPort)
-            {
-                if (SOCKET_ERROR == bind(socket, localAddr.sockaddr(), localAddr.length()))
-                {
-                    gle = WSAGetLastError();
-                }
-            }
-            else
-            {
-                // sleep up to 5 seconds to allow TCP to cleanup its internal state
-                constexpr unsigned long bindRetryCount = 5;
-                constexpr unsigned long bindRetrySleepMs = 1000;
-
-                for (unsigned long bindRetry = 0; bindRetry < bindRetryCount; ++bindRetry)
-                {
-                    if (SOCKET_ERROR == bind(socket, localAddr.sockaddr(), localAddr.length()))
-                    {
-                        gle = WSAGetLastError();
-                        if (WSAEADDRINUSE == gle)
-                        {
-                            PRINT_DEBUG_INFO(L"\t\tctsWSASocket : bind failed on attempt %lu, sleeping %lu ms.\n", bindRetry + 1, bindRetrySleepMs);
-                            Sleep(bindRetrySleepMs);
-                        }
-                    }
-                    else
-                    {
-                        // succeeded - exit the loop
-                        gle = NO_ERROR;
-                        PRINT_DEBUG_INFO(L"\t\tctsWSASocket : bind succeeded on attempt %lu\n", bindRetry + 1);
-                        break;
-                    }
-                }
-            }
-        }
-
-        // store whatever values we have: for accurate logging
-        sharedSocket->SetSocket(socket);
-        sharedSocket->SetLocalSockaddr(localAddr);
-        sharedSocket->SetRemoteSockaddr(targetAddr);
-
-        if (0 == gle)
-        {
-            sharedSocket->CompleteState(NO_ERROR);
-        }
-        else
-        {
-            ctsConfig::PrintErrorIfFailed(functionName, gle);
-            sharedSocket->CompleteState(gle);
-        }
-    }
-
-} // namespace
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// cpp headers
+#include <memory>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include <ctString.hpp>
+// project headers
+#include "ctsSocket.h"
+#include "ctsConfig.h"
+#include "ctsLocalPorts.h"
+#include "ctsSocketPool.h"
+
+namespace ctsTraffic
+{
+    static long long g_bindCounter = 0LL;
+    static long long g_targetCounter = 0LL;
+
+    // ReSharper disable once CppInconsistentNaming
+    void ctsWSASocket(const std::weak_ptr<ctsSocket>& weakSocket) noexcept
+    {
+        auto sharedSocket(weakSocket.lock());
+        if (!sharedSocket)
+        {
+            return;
+        }
+
+        const USHORT nextPort = ctsLocalPorts::Acquire();
+
+        //
+        // Find a bind and target address by moving to the next address in the respective vectors
+        //
+        const auto bindSize = ctsConfig::g_configSettings->BindAddresses.size();
+        auto socketCounter = ctl::ctMemoryGuardIncrement(&g_bindCounter);
+        ctl::ctSockaddr localAddr(ctsConfig::g_configSettings->BindAddresses[socketCounter % bindSize]);
+        localAddr.SetPort(nextPort);
+
+        ctl::ctSockaddr targetAddr;
+        if (!ctsConfig::g_configSettings->TargetAddresses.empty())
+        {
+            //
+            // the target address family must match the bind address family
+            // - ctsConfig guarantees that at least address families will match with at least one address in bind and target vectors
+            //
+            // - with -TargetWeights, the counter walks the weighted order of target indexes instead
+            const auto& targetOrder = ctsConfig::g_configSettings->TargetOrder;
+            const auto nextTarget = [&targetOrder](long long counter) -> const ctl::ctSockaddr& {
+                const auto& targets = ctsConfig::g_configSettings->TargetAddresses;
+                return targetOrder.empty() ?
+                    targets[counter % targets.size()] :
+                    targets[targetOrder[counter % targetOrder.size()]];
+            };
+            socketCounter = ctl::ctMemoryGuardIncrement(&g_targetCounter);
+            targetAddr = nextTarget(socketCounter);
+            while (targetAddr.family() != localAddr.family())
+            {
+                socketCounter = ctl::ctMemoryGuardIncrement(&g_targetCounter);
+                targetAddr = nextTarget(socketCounter);
+            }
+
+            // -Probes : probe connections are made to the same targets on the -ProbePort
+            if (sharedSocket->IsProbe())
+            {
+                targetAddr.SetPort(ctsConfig::g_configSettings->ProbePort);
+            }
+        }
+
+        if (ctsConfig::g_configSettings->MultiplexMediaStreams)
+        {
+            // multiplexed streams share sockets to each target: created when the stream connects
+            sharedSocket->SetLocalSockaddr(localAddr);
+            sharedSocket->SetRemoteSockaddr(targetAddr);
+            sharedSocket->CompleteState(NO_ERROR);
+            return;
+        }
+
+        if (ctsConfig::g_configSettings->ReuseSockets)
+        {
+            // a recycled socket is still bound to this address and associated with its completion port
+            auto recycled = ctsSocketPool::Acquire(localAddr);
+            if (recycled.m_socket)
+            {
+                sharedSocket->SetSocket(recycled.m_socket.release());
+                sharedSocket->SetRecyclable(localAddr, std::move(recycled.m_tpIocp));
+                sharedSocket->SetLocalSockaddr(localAddr);
+                sharedSocket->SetRemoteSockaddr(targetAddr);
+                sharedSocket->CompleteState(NO_ERROR);
+                return;
+            }
+        }
+
+        if (ctsConfig::g_configSettings->PrecreateSockets)
+        {
+            // a pre-created socket is already bound to this address and associated with its completion port
+            auto precreated = ctsSocketPool::AcquirePrecreated(localAddr);
+            if (precreated.m_socket)
+            {
+                sharedSocket->SetSocket(precreated.m_socket.release());
+                if (ctsConfig::g_configSettings->ReuseSockets)
+                {
+                    sharedSocket->SetRecyclable(localAddr, std::move(precreated.m_tpIocp));
+                }
+                else
+                {
+                    sharedSocket->SetIocpThreadpool(std::move(precreated.m_tpIocp));
+                }
+                sharedSocket->SetLocalSockaddr(localAddr);
+                sharedSocket->SetRemoteSockaddr(targetAddr);
+                sharedSocket->CompleteState(NO_ERROR);
+                return;
+            }
+        }
+
+        auto socket = INVALID_SOCKET;
+        int gle = 0;
+        PCSTR functionName = "CreateSocket";
+        try
+        {
+            switch (ctsConfig::g_configSettings->Protocol)
+            {
+                case ctsConfig::ProtocolType::TCP:
+                    socket = ctsConfig::CreateSocket(localAddr.family(), SOCK_STREAM, IPPROTO_TCP, ctsConfig::g_configSettings->SocketFlags);
+                    break;
+
+                case ctsConfig::ProtocolType::UDP:
+                    socket = ctsConfig::CreateSocket(localAddr.family(), SOCK_DGRAM, IPPROTO_UDP, ctsConfig::g_configSettings->SocketFlags);
+                    break;
+
+                case ctsConfig::ProtocolType::NoProtocolSet: // fall-through
+                default:  // NOLINT(clang-diagnostic-covered-switch-default)
+                    ctsConfig::PrintErrorInfo(
+                        L"Unknown socket protocol (%u)",
+                        static_cast<unsigned>(ctsConfig::g_configSettings->Protocol));
+                    gle = WSAEINVAL;
+            }
+        }
+        catch (const wil::ResultException& e)
+        {
+            gle = ctsConfig::Win32FromHresult(e.GetErrorCode());
+        }
+        catch (...)
+        {
+            gle = WSAENOBUFS;
+        }
+
+        if (NO_ERROR == gle)
+        {
+            functionName = "SetPreBindOptions";
+            gle = ctsConfig::SetPreBindOptions(socket, localAddr);
+        }
+
+        if (NO_ERROR == gle)
+        {
+            functionName = "SIO_ASSOCIATE_PORT_RESERVATION";
+            gle = ctsLocalPorts::AssociateReservation(socket);
+        }
+
+        if (NO_ERROR == gle)
+        {
+            functionName = "bind";
+
+            if (0 == nextPort)
+            {
+                if (SOCKET_ERROR == bind(socket, localAddr.sockaddr(), localAddr.length()))
+                {
+                    gle = WSAGetLastError();
+                }
+            }
+            else
+            {
+                // sleep up to 5 seconds to allow TCP to cleanup its internal state
+                constexpr unsigned long bindRetryCount = 5;
+                constexpr unsigned long bindRetrySleepMs = 1000;
+
+                for (unsigned long bindRetry = 0; bindRetry < bindRetryCount; ++bindRetry)
+                {
+                    if (SOCKET_ERROR == bind(socket, localAddr.sockaddr(), localAddr.length()))
+                    {
+                        gle = WSAGetLastError();
+                        if (WSAEADDRINUSE == gle)
+                        {
+                            PRINT_DEBUG_INFO(L"\t\tctsWSASocket : bind failed on attempt %lu, sleeping %lu ms.\n", bindRetry + 1, bindRetrySleepMs);
+                            Sleep(bindRetrySleepMs);
+                        }
+                    }
+                    else
+                    {
+                        // succeeded - exit the loop
+                        gle = NO_ERROR;
+                        PRINT_DEBUG_INFO(L"\t\tctsWSASocket : bind succeeded on attempt %lu\n", bindRetry + 1);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // store whatever values we have: for accurate logging
+        sharedSocket->SetSocket(socket);
+        sharedSocket->SetLocalSockaddr(localAddr);
+        sharedSocket->SetRemoteSockaddr(targetAddr);
+
+        if (0 == gle)
+        {
+            if (ctsConfig::g_configSettings->ReuseSockets)
+            {
+                sharedSocket->SetRecyclable(localAddr, nullptr);
+            }
+            sharedSocket->CompleteState(NO_ERROR);
+        }
+        else
+        {
+            if (INVALID_SOCKET == socket)
+            {
+                // the port never reached a socket for ctsSocket to release when it closes
+                ctsLocalPorts::Release(nextPort, false);
+            }
+            ctsConfig::PrintErrorIfFailed(functionName, gle);
+            sharedSocket->CompleteState(gle);
+        }
+    }
+
+} // namespace
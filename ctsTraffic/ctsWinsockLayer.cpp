@@ -17,8 +17,11 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // os headers
 #include <Windows.h>
 #include <WinSock2.h>
+#include <ws2tcpip.h>
+#include <mstcpip.h>
 // ctl headers
 #include <ctSockaddr.hpp>
+#include <ctSocketExtensions.hpp>
 #include <ctThreadIocp.hpp>
 // project headers
 #include "ctsWinsockLayer.h"
@@ -69,7 +72,7 @@ namespace ctsTraffic
             }
             else
             {
-                if (ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp)
+                if (ctsConfig::GetFrozenSettings().m_isInlineIocp)
                 {
                     returnResult.m_errorCode = ERROR_SUCCESS;
                     // OVERLAPPED.InternalHigh == the number of bytes transferred for the I/O request.
@@ -95,6 +98,109 @@ namespace ctsTraffic
         return returnResult;
     }
 
+    namespace details
+    {
+        // the WSAMSG, its WSABUF and the control buffer must stay valid until the WSARecvMsg completes
+        // - the stack writes the UDP_COALESCED_INFO and SO_TIMESTAMP control messages with the completion
+        struct ctsRecvMsgRequest
+        {
+            WSAMSG m_message{};
+            WSABUF m_wsabuf{};
+            alignas(WSACMSGHDR) char m_control[WSA_CMSG_SPACE(sizeof(DWORD)) + WSA_CMSG_SPACE(sizeof(UINT64))]{};
+
+            ctsRecvMsgInfo GetRecvMsgInfo() noexcept
+            {
+                ctsRecvMsgInfo recvMsgInfo;
+                for (auto* controlMessage = WSA_CMSG_FIRSTHDR(&m_message);
+                     controlMessage != nullptr;
+                     controlMessage = WSA_CMSG_NXTHDR(&m_message, controlMessage))
+                {
+                    if (IPPROTO_UDP == controlMessage->cmsg_level && UDP_COALESCED_INFO == controlMessage->cmsg_type)
+                    {
+                        recvMsgInfo.m_coalescedSegmentSize = *reinterpret_cast<const DWORD*>(WSA_CMSG_DATA(controlMessage));
+                    }
+                    else if (SOL_SOCKET == controlMessage->cmsg_level && SO_TIMESTAMP == controlMessage->cmsg_type)
+                    {
+                        recvMsgInfo.m_receiveTimestamp = static_cast<long long>(*reinterpret_cast<const UINT64*>(WSA_CMSG_DATA(controlMessage)));
+                    }
+                }
+                return recvMsgInfo;
+            }
+        };
+    }
+
+    // ReSharper disable once CppInconsistentNaming
+    wsIOResult ctsWSARecvMsg(
+        const std::shared_ptr<ctsSocket>& sharedSocket,
+        SOCKET socket,
+        const ctsTask& task,
+        std::function<void(OVERLAPPED*, const ctsRecvMsgInfo&)>&& callback,
+        _Out_ ctsRecvMsgInfo* recvMsgInfo) noexcept
+    {
+        *recvMsgInfo = ctsRecvMsgInfo{};
+        if (INVALID_SOCKET == socket)
+        {
+            return wsIOResult(WSAECONNABORTED);
+        }
+
+        wsIOResult returnResult;
+        try
+        {
+            // the request is owned by the callback so it lives until the IO completes
+            auto request = std::make_shared<details::ctsRecvMsgRequest>();
+            request->m_wsabuf.buf = task.m_buffer + task.m_bufferOffset;
+            request->m_wsabuf.len = task.m_bufferLength;
+            request->m_message.lpBuffers = &request->m_wsabuf;
+            request->m_message.dwBufferCount = 1;
+            request->m_message.Control.buf = request->m_control;
+            request->m_message.Control.len = sizeof request->m_control;
+
+            const auto& ioThreadPool = sharedSocket->GetIocpThreadpool();
+            OVERLAPPED* pOverlapped = ioThreadPool->new_request(
+                [request, callback = std::move(callback)](OVERLAPPED* pCallbackOverlapped) noexcept {
+                    callback(pCallbackOverlapped, request->GetRecvMsgInfo());
+                });
+
+            if (ctl::ctWSARecvMsg(socket, &request->m_message, nullptr, pOverlapped, nullptr) != 0)
+            {
+                returnResult.m_errorCode = WSAGetLastError();
+                // IO pended == successfully initiating the IO
+                if (returnResult.m_errorCode != WSA_IO_PENDING)
+                {
+                    // must cancel the IOCP TP if the IO call fails
+                    ioThreadPool->cancel_request(pOverlapped);
+                }
+                // will return WSA_IO_PENDING transparently to the caller
+            }
+            else
+            {
+                if (ctsConfig::GetFrozenSettings().m_isInlineIocp)
+                {
+                    returnResult.m_errorCode = ERROR_SUCCESS;
+                    // OVERLAPPED.InternalHigh == the number of bytes transferred for the I/O request.
+                    // - this member is set when the request is completed inline
+                    returnResult.m_bytesTransferred = static_cast<unsigned long>(pOverlapped->InternalHigh);
+                    *recvMsgInfo = request->GetRecvMsgInfo();
+                    // completed inline, so the TP won't be notified
+                    ioThreadPool->cancel_request(pOverlapped);
+                }
+                else
+                {
+                    // WSARecvMsg returned success, but inline completions is not enabled
+                    // so the IOCP callback will be invoked - thus will return WSA_IO_PENDING
+                    returnResult.m_errorCode = WSA_IO_PENDING;
+                }
+            }
+        }
+        catch (...)
+        {
+            const auto error = ctsConfig::PrintThrownException();
+            return wsIOResult(error);
+        }
+
+        return returnResult;
+    }
+
     // ReSharper disable once CppInconsistentNaming
     wsIOResult ctsWSASendTo(
         const std::shared_ptr<ctsSocket>& sharedSocket,
@@ -131,7 +237,7 @@ namespace ctsTraffic
             }
             else
             {
-                if (ctsConfig::g_configSettings->Options & ctsConfig::OptionType::HandleInlineIocp)
+                if (ctsConfig::GetFrozenSettings().m_isInlineIocp)
                 {
                     returnResult.m_errorCode = ERROR_SUCCESS;
                     // OVERLAPPED.InternalHigh == the number of bytes transferred for the I/O request.
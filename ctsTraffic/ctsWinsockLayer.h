@@ -50,6 +50,26 @@ namespace ctsTraffic
         const ctsTask& task,
         std::function<void(OVERLAPPED*)>&& callback) noexcept;
 
+    // the control messages returned with a completed UDP receive
+    struct ctsRecvMsgInfo
+    {
+        // the UDP_COALESCED_INFO datagram length of a receive which coalesced several datagrams (URO) - 0 if not coalesced
+        unsigned long m_coalescedSegmentSize = 0;
+        // the SO_TIMESTAMP receive timestamp the stack (or NIC) took of the datagram (SIO_TIMESTAMPING) - 0 if not returned
+        long long m_receiveTimestamp = 0;
+    };
+
+    // Posts a WSARecvMsg so a UDP receive reports its control messages: the coalesced datagram length and receive timestamp
+    // - the callback is given the control messages of the completed receive
+    // - recvMsgInfo is set the same way when the receive completes inline
+    // ReSharper disable once CppInconsistentNaming
+    wsIOResult ctsWSARecvMsg(
+        const std::shared_ptr<ctsSocket>& sharedSocket,
+        SOCKET socket,
+        const ctsTask& task,
+        std::function<void(OVERLAPPED*, const ctsRecvMsgInfo&)>&& callback,
+        _Out_ ctsRecvMsgInfo* recvMsgInfo) noexcept;
+
     // ReSharper disable once CppInconsistentNaming
     wsIOResult ctsWSASendTo(
         const std::shared_ptr<ctsSocket>& sharedSocket,
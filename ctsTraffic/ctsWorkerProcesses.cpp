@@ -0,0 +1,366 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// declaration header
+#include "ctsWorkerProcesses.h"
+// cpp headers
+#include <algorithm>
+#include <string>
+// os headers
+#include <shellapi.h>
+// ctl headers
+#include <ctString.hpp>
+// wil headers
+#include <wil/result.h>
+#include <wil/stl.h>
+#include <wil/win32_helpers.h>
+// project headers
+#include "ctsConfig.h"
+
+namespace ctsTraffic
+{
+    // the options replaced on each worker's command line
+    static bool IsWorkerReplacedArgument(const std::wstring& argument)
+    {
+        const auto delimiter = argument.find(L':');
+        const auto name = argument.substr(0, delimiter);
+        return ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-Workers") ||
+            ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-Port") ||
+            ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-Connections") ||
+            ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-ServerExitLimit") ||
+            ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-LocalPort") ||
+            ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-ConsoleVerbosity") ||
+            ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-StatsSharedMemory") ||
+            ctl::ctString::ctOrdinalEqualsCaseInsensative(name, L"-CheckpointInterval") ||
+            ctl::ctString::ctOrdinalEndsWithCaseInsensative(name, L"Filename");
+    }
+
+    // quoted following the CommandLineToArgvW rules : backslashes are only escaped ahead of a quote
+    static void AppendArgument(std::wstring& commandLine, const std::wstring& argument)
+    {
+        if (!commandLine.empty())
+        {
+            commandLine.push_back(L' ');
+        }
+        if (!argument.empty() && std::wstring::npos == argument.find_first_of(L" \t\""))
+        {
+            commandLine.append(argument);
+            return;
+        }
+
+        commandLine.push_back(L'"');
+        size_t backslashes = 0;
+        for (const auto character : argument)
+        {
+            if (L'\\' == character)
+            {
+                ++backslashes;
+                continue;
+            }
+            commandLine.append(L'"' == character ? backslashes * 2 + 1 : backslashes, L'\\');
+            commandLine.push_back(character);
+            backslashes = 0;
+        }
+        commandLine.append(backslashes * 2, L'\\');
+        commandLine.push_back(L'"');
+    }
+
+    // the processors of each NUMA node with any : workers are assigned to them round-robin
+    static std::vector<GROUP_AFFINITY> GetNumaNodeAffinities()
+    {
+        std::vector<GROUP_AFFINITY> affinities;
+        ULONG highestNode = 0;
+        if (GetNumaHighestNodeNumber(&highestNode))
+        {
+            for (ULONG node = 0; node <= highestNode; ++node)
+            {
+                GROUP_AFFINITY affinity{};
+                if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity) && affinity.Mask != 0)
+                {
+                    affinities.push_back(affinity);
+                }
+            }
+        }
+        return affinities;
+    }
+
+    // the share of total given to the worker at index: the remainder is spread across the first workers
+    static unsigned long long WorkerSlice(unsigned long long total, unsigned long workerCount, unsigned long index) noexcept
+    {
+        return total / workerCount + (index < total % workerCount ? 1 : 0);
+    }
+
+    ctsWorkerProcesses::ctsWorkerProcesses()
+    {
+        const auto& settings = *ctsConfig::g_configSettings;
+        const auto workerCount = settings.WorkerProcesses;
+
+        // the original command line : Startup rewrites some values in place as it parses them
+        int argumentCount = 0;
+        const wil::unique_hlocal_ptr<PWSTR> arguments(CommandLineToArgvW(GetCommandLineW(), &argumentCount));
+        if (!arguments)
+        {
+            THROW_WIN32_MSG(GetLastError(), "CommandLineToArgvW");
+        }
+        std::wstring sharedArguments;
+        for (int argument = 1; argument < argumentCount; ++argument)
+        {
+            const std::wstring currentArgument(arguments.get()[argument]);
+            if (!IsWorkerReplacedArgument(currentArgument))
+            {
+                AppendArgument(sharedArguments, currentArgument);
+            }
+        }
+
+        const auto modulePath = wil::GetModuleFileNameW<std::wstring>(nullptr);
+        const auto affinities = GetNumaNodeAffinities();
+
+        // the workers are closed with this process
+        m_job.reset(CreateJobObjectW(nullptr, nullptr));
+        if (!m_job)
+        {
+            THROW_WIN32_MSG(GetLastError(), "CreateJobObjectW");
+        }
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION jobLimits{};
+        jobLimits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+        if (!SetInformationJobObject(m_job.get(), JobObjectExtendedLimitInformation, &jobLimits, sizeof jobLimits))
+        {
+            THROW_WIN32_MSG(GetLastError(), "SetInformationJobObject(JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE)");
+        }
+
+        const unsigned long localPorts = settings.LocalPortLow != 0 ? settings.LocalPortHigh - settings.LocalPortLow + 1UL : 0UL;
+        unsigned long nextLocalPort = settings.LocalPortLow;
+
+        m_workers.resize(workerCount);
+        for (unsigned long index = 0; index < workerCount; ++index)
+        {
+            auto& worker = m_workers[index];
+
+            const auto statsName = wil::str_printf<std::wstring>(L"ctsTraffic.%lu.Worker%lu", GetCurrentProcessId(), index);
+            worker.m_mapping.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(ctsSharedStats), statsName.c_str()));
+            if (!worker.m_mapping)
+            {
+                THROW_WIN32_MSG(GetLastError(), "CreateFileMappingW(%ws)", statsName.c_str());
+            }
+            worker.m_stats.reset(static_cast<ctsSharedStats*>(MapViewOfFile(worker.m_mapping.get(), FILE_MAP_READ, 0, 0, sizeof(ctsSharedStats))));
+            if (!worker.m_stats)
+            {
+                THROW_WIN32_MSG(GetLastError(), "MapViewOfFile(%ws)", statsName.c_str());
+            }
+
+            std::wstring commandLine;
+            AppendArgument(commandLine, modulePath);
+            commandLine.append(L" ");
+            commandLine.append(sharedArguments);
+            commandLine.append(wil::str_printf<std::wstring>(L" -Port:%u", static_cast<unsigned>(settings.Port + index)));
+            if (!ctsConfig::IsListening())
+            {
+                commandLine.append(wil::str_printf<std::wstring>(L" -Connections:%llu", WorkerSlice(settings.ConnectionLimit, workerCount, index)));
+            }
+            else if (settings.ServerExitLimit != MAXULONGLONG)
+            {
+                commandLine.append(wil::str_printf<std::wstring>(L" -ServerExitLimit:%llu", WorkerSlice(settings.ServerExitLimit, workerCount, index)));
+            }
+            if (localPorts > 0)
+            {
+                const auto workerPorts = static_cast<unsigned long>(WorkerSlice(localPorts, workerCount, index));
+                commandLine.append(wil::str_printf<std::wstring>(L" -LocalPort:[%lu,%lu]", nextLocalPort, nextLocalPort + workerPorts - 1));
+                nextLocalPort += workerPorts;
+            }
+            commandLine.append(L" -ConsoleVerbosity:0");
+            commandLine.append(L" -WorkerStatsSharedMemory:");
+            commandLine.append(statsName);
+
+            // started suspended : it must join the job and be pinned to its node before it creates any threads
+            STARTUPINFOEXW startupInfo{};
+            startupInfo.StartupInfo.cb = sizeof startupInfo;
+            std::vector<BYTE> attributeList;
+            GROUP_AFFINITY affinity{};
+            auto deleteAttributeList = wil::scope_exit([&]() noexcept {
+                if (startupInfo.lpAttributeList)
+                {
+                    DeleteProcThreadAttributeList(startupInfo.lpAttributeList);
+                }
+            });
+            if (!affinities.empty())
+            {
+                affinity = affinities[index % affinities.size()];
+                SIZE_T attributeListSize = 0;
+                InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeListSize);
+                attributeList.resize(attributeListSize);
+                if (!InitializeProcThreadAttributeList(reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeList.data()), 1, 0, &attributeListSize))
+                {
+                    THROW_WIN32_MSG(GetLastError(), "InitializeProcThreadAttributeList");
+                }
+                startupInfo.lpAttributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeList.data());
+                // the primary group of the worker is the group of its node
+                if (!UpdateProcThreadAttribute(startupInfo.lpAttributeList, 0, PROC_THREAD_ATTRIBUTE_GROUP_AFFINITY, &affinity, sizeof affinity, nullptr, nullptr))
+                {
+                    THROW_WIN32_MSG(GetLastError(), "UpdateProcThreadAttribute(PROC_THREAD_ATTRIBUTE_GROUP_AFFINITY)");
+                }
+            }
+
+            if (!CreateProcessW(
+                modulePath.c_str(),
+                commandLine.data(),
+                nullptr,
+                nullptr,
+                FALSE,
+                CREATE_SUSPENDED | (startupInfo.lpAttributeList ? EXTENDED_STARTUPINFO_PRESENT : 0),
+                nullptr,
+                nullptr,
+                &startupInfo.StartupInfo,
+                worker.m_process.addressof()))
+            {
+                THROW_WIN32_MSG(GetLastError(), "CreateProcessW(%ws)", commandLine.c_str());
+            }
+            if (!AssignProcessToJobObject(m_job.get(), worker.m_process.hProcess))
+            {
+                const auto gle = GetLastError();
+                TerminateProcess(worker.m_process.hProcess, gle);
+                THROW_WIN32_MSG(gle, "AssignProcessToJobObject");
+            }
+            // the threads the worker creates are limited to the processors of its node
+            if (affinity.Mask != 0 && !SetProcessAffinityMask(worker.m_process.hProcess, affinity.Mask))
+            {
+                ctsConfig::PrintErrorIfFailed("SetProcessAffinityMask", GetLastError());
+            }
+            ResumeThread(worker.m_process.hThread);
+        }
+    }
+
+    void ctsWorkerProcesses::Update() noexcept
+    {
+        auto& settings = *ctsConfig::g_configSettings;
+        const bool isTcp = ctsConfig::ProtocolType::TCP == settings.Protocol;
+
+        long long activeConnections = 0;
+        long long successfulConnections = 0;
+        long long connectionErrors = 0;
+        long long protocolErrors = 0;
+        for (auto& worker : m_workers)
+        {
+            // a worker which hasn't written its header yet, or was updating it on every attempt, is folded in next time
+            ctsSharedStats current{};
+            if (ctsReadSharedStats(worker.m_stats.get(), &current))
+            {
+                if (isTcp)
+                {
+                    settings.TcpStatusDetails.m_bytesSent.Add(current.m_bytesSent - worker.m_prior.m_bytesSent);
+                    settings.TcpStatusDetails.m_bytesRecv.Add(current.m_bytesReceived - worker.m_prior.m_bytesReceived);
+                    settings.TcpStatusDetails.m_transactions.Add(current.m_transactions - worker.m_prior.m_transactions);
+                    settings.TcpStatusDetails.m_rioCompletions.Add(current.m_rioCompletions - worker.m_prior.m_rioCompletions);
+                }
+                else
+                {
+                    settings.UdpStatusDetails.m_bitsReceived.Add(current.m_bitsReceived - worker.m_prior.m_bitsReceived);
+                    settings.UdpStatusDetails.m_successfulFrames.Add(current.m_successfulFrames - worker.m_prior.m_successfulFrames);
+                    settings.UdpStatusDetails.m_droppedFrames.Add(current.m_droppedFrames - worker.m_prior.m_droppedFrames);
+                    settings.UdpStatusDetails.m_duplicateFrames.Add(current.m_duplicateFrames - worker.m_prior.m_duplicateFrames);
+                    settings.UdpStatusDetails.m_errorFrames.Add(current.m_errorFrames - worker.m_prior.m_errorFrames);
+                }
+                worker.m_prior = current;
+            }
+
+            activeConnections += worker.m_prior.m_activeConnections;
+            successfulConnections += worker.m_prior.m_successfulConnections;
+            connectionErrors += worker.m_prior.m_connectionErrors;
+            protocolErrors += worker.m_prior.m_protocolErrors;
+        }
+
+        // the connection counts are always displayed as totals
+        settings.ConnectionStatusDetails.m_activeConnectionCount.SetValue(activeConnections);
+        settings.ConnectionStatusDetails.m_successfulCompletionCount.SetValue(successfulConnections);
+        settings.ConnectionStatusDetails.m_connectionErrorCount.SetValue(connectionErrors);
+        settings.ConnectionStatusDetails.m_protocolErrorCount.SetValue(protocolErrors);
+        if (activeConnections > settings.ConnectionStatusDetails.m_peakActiveConnectionCount.GetValue())
+        {
+            settings.ConnectionStatusDetails.m_peakActiveConnectionCount.SetValue(activeConnections);
+        }
+    }
+
+    bool ctsWorkerProcesses::Wait(DWORD milliseconds) noexcept
+    {
+        const ULONGLONG endTime = INFINITE == milliseconds ? 0 : GetTickCount64() + milliseconds;
+        for (;;)
+        {
+            HANDLE waitHandles[MAXIMUM_WAIT_OBJECTS]{ ctsConfig::g_configSettings->CtrlCHandle };
+            Worker* waitWorkers[MAXIMUM_WAIT_OBJECTS]{};
+            DWORD waitCount = 1;
+            for (auto& worker : m_workers)
+            {
+                if (!worker.m_exited)
+                {
+                    waitWorkers[waitCount] = &worker;
+                    waitHandles[waitCount] = worker.m_process.hProcess;
+                    ++waitCount;
+                }
+            }
+            if (1 == waitCount)
+            {
+                return true;
+            }
+
+            DWORD waitTime = INFINITE;
+            if (endTime != 0)
+            {
+                const auto currentTime = GetTickCount64();
+                waitTime = currentTime < endTime ? static_cast<DWORD>(endTime - currentTime) : 0;
+            }
+
+            const auto waitResult = WaitForMultipleObjects(waitCount, waitHandles, FALSE, waitTime);
+            if (WAIT_OBJECT_0 == waitResult)
+            {
+                // ctrl-c : the workers share this console and are completing as well
+                return true;
+            }
+            if (WAIT_TIMEOUT == waitResult)
+            {
+                return false;
+            }
+            if (waitResult > WAIT_OBJECT_0 && waitResult < WAIT_OBJECT_0 + waitCount)
+            {
+                waitWorkers[waitResult - WAIT_OBJECT_0]->m_exited = true;
+                continue;
+            }
+            FAIL_FAST_MSG(
+                "ctsWorkerProcesses - WaitForMultipleObjects(%p) failed [%u]",
+                waitHandles, GetLastError());
+        }
+    }
+
+    void ctsWorkerProcesses::Stop() noexcept
+    {
+        const ULONGLONG endTime = GetTickCount64() + c_exitGraceMilliseconds;
+        for (auto& worker : m_workers)
+        {
+            if (!worker.m_exited)
+            {
+                const auto currentTime = GetTickCount64();
+                const DWORD waitTime = currentTime < endTime ? static_cast<DWORD>(endTime - currentTime) : 0;
+                worker.m_exited = WAIT_OBJECT_0 == WaitForSingleObject(worker.m_process.hProcess, waitTime);
+            }
+        }
+
+        const auto runningWorkers = std::count_if(m_workers.cbegin(), m_workers.cend(), [](const Worker& worker) { return !worker.m_exited; });
+        if (runningWorkers > 0)
+        {
+            ctsConfig::PrintErrorInfoOverride(
+                wil::str_printf<std::wstring>(
+                    L"ctsTraffic terminated %Iu worker processes which did not exit within %lu milliseconds",
+                    static_cast<size_t>(runningWorkers),
+                    c_exitGraceMilliseconds).c_str());
+            TerminateJobObject(m_job.get(), ERROR_TIMEOUT);
+        }
+    }
+}
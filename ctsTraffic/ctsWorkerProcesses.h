@@ -0,0 +1,81 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <vector>
+// os headers
+#include <Windows.h>
+// wil headers
+#include <wil/resource.h>
+// project headers
+#include "ctsSharedStats.h"
+
+namespace ctsTraffic
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsWorkerProcesses
+    ///
+    /// -Workers : starts the worker processes which run the connections of this process
+    /// - each worker is started suspended with this process' command line, then assigned to a job
+    ///   (closing this process closes the workers) and pinned to a NUMA node before it's resumed
+    /// - worker N is given -Port + N, its slice of -Connections (or -ServerExitLimit) and of the -LocalPort range,
+    ///   -ConsoleVerbosity:0 and none of the -*Filename logs: this process prints and logs for all of them
+    /// - each worker writes its running totals into a ctsSharedStats region created here before it's started,
+    ///   so its final totals can still be read once it has exited
+    /// - throws if a region cannot be created or a worker cannot be started
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsWorkerProcesses
+    {
+    public:
+        ctsWorkerProcesses();
+        ~ctsWorkerProcesses() noexcept = default;
+
+        // folds the totals the workers wrote since the prior call into the ctsConfigSettings status statistics
+        // - called from the status timer; must not be called concurrently
+        void Update() noexcept;
+
+        // waits for every worker to exit or for ctrl-c
+        // - returns false if the milliseconds passed first
+        [[nodiscard]] bool Wait(DWORD milliseconds) noexcept;
+
+        // gives the workers still running c_exitGraceMilliseconds to complete (they receive the same ctrl-c and -TimeLimit)
+        // before terminating them
+        void Stop() noexcept;
+
+        ctsWorkerProcesses(const ctsWorkerProcesses&) = delete;
+        ctsWorkerProcesses& operator=(const ctsWorkerProcesses&) = delete;
+        ctsWorkerProcesses(ctsWorkerProcesses&&) = delete;
+        ctsWorkerProcesses& operator=(ctsWorkerProcesses&&) = delete;
+
+        static constexpr unsigned long c_updateFrequencyMilliseconds = ctsSharedStatsWriter::c_updateFrequencyMilliseconds;
+        static constexpr DWORD c_exitGraceMilliseconds = 10000UL;
+
+    private:
+        struct Worker
+        {
+            wil::unique_process_information m_process;
+            wil::unique_handle m_mapping;
+            wil::unique_mapview_ptr<ctsSharedStats> m_stats;
+            // the totals folded in by the prior Update()
+            ctsSharedStats m_prior{};
+            bool m_exited = false;
+        };
+
+        wil::unique_handle m_job;
+        std::vector<Worker> m_workers;
+    };
+}
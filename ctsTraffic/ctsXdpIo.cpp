@@ -0,0 +1,907 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// ReSharper disable CppClangTidyClangDiagnosticExitTimeDestructors
+// cpp headers
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+// XDP for Windows headers : -io:xdp is only built when its headers are available
+#if __has_include(<afxdp_helper.h>)
+#include <xdpapi.h>
+#include <afxdp_helper.h>
+#define CTSTRAFFIC_XDP_SUPPORTED 1
+#endif
+// wil headers
+#include <wil/stl.h>
+#include <wil/resource.h>
+// ctl headers
+#include <ctSockaddr.hpp>
+#include <ctTimer.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsMediaStreamProtocol.hpp"
+#include "ctsRioBufferPool.h"
+#include "ctsTCPFunctions.h"
+
+///
+/// -io:xdp : MediaStream and Blast servers send every datagram through AF_XDP sockets (XDP for Windows)
+/// - each listening socket still receives START and resends through Winsock : only its transmit path bypasses the host stack
+/// - one XSK is bound to each of the first -XdpQueues RSS queues of the interface owning the -listen address
+/// - each XSK's UMEM is leased from ctsRioBufferPool and carved into one frame-sized chunk per TX ring descriptor
+/// - Ethernet, IP and UDP headers are written in user space : datagrams larger than the MTU are IP fragmented
+///   here exactly as the host stack would fragment them, so clients see the same packets on the wire
+///
+namespace ctsTraffic
+{
+#if defined(CTSTRAFFIC_XDP_SUPPORTED)
+    namespace Xdp
+    {
+        // the number of descriptors in each TX and completion ring, and so the number of chunks in each UMEM
+        constexpr UINT32 c_ringSize = 4096;
+        // the longest a completion thread waits for TX completions before checking again
+        constexpr DWORD c_completionWaitMilliseconds = 100;
+        // the longest a send waits for completions to free enough chunks, as a blocking send would
+        constexpr DWORD c_sendWaitMilliseconds = 1000;
+        constexpr unsigned char c_defaultHopLimit = 128;
+
+#pragma pack(push, 1)
+        struct EthernetHeader
+        {
+            unsigned char m_destination[6];
+            unsigned char m_source[6];
+            unsigned short m_etherType;
+        };
+
+        struct Ipv4Header
+        {
+            unsigned char m_versionAndLength;
+            unsigned char m_typeOfService;
+            unsigned short m_totalLength;
+            unsigned short m_identification;
+            unsigned short m_flagsAndOffset;
+            unsigned char m_timeToLive;
+            unsigned char m_protocol;
+            unsigned short m_checksum;
+            IN_ADDR m_source;
+            IN_ADDR m_destination;
+        };
+
+        struct Ipv6Header
+        {
+            unsigned long m_versionClassAndFlow;
+            unsigned short m_payloadLength;
+            unsigned char m_nextHeader;
+            unsigned char m_hopLimit;
+            IN6_ADDR m_source;
+            IN6_ADDR m_destination;
+        };
+
+        struct Ipv6FragmentHeader
+        {
+            unsigned char m_nextHeader;
+            unsigned char m_reserved;
+            unsigned short m_offsetAndFlags;
+            unsigned long m_identification;
+        };
+
+        struct UdpHeader
+        {
+            unsigned short m_sourcePort;
+            unsigned short m_destinationPort;
+            unsigned short m_length;
+            unsigned short m_checksum;
+        };
+#pragma pack(pop)
+
+        constexpr unsigned short c_etherTypeIpv4 = 0x0800;
+        constexpr unsigned short c_etherTypeIpv6 = 0x86dd;
+        constexpr unsigned char c_ipv6FragmentNextHeader = 44;
+        constexpr unsigned short c_ipv4MoreFragments = 0x2000;
+        constexpr unsigned short c_ipv6MoreFragments = 0x0001;
+
+        static HMODULE g_xdpApiModule = nullptr;
+        static const XDP_API_TABLE* g_xdpApi = nullptr;
+        // ReSharper disable once CppZeroConstantCanBeReplacedWithNullptr
+        static INIT_ONCE g_xdpApiInitializer = INIT_ONCE_STATIC_INIT;
+
+        static ctsShardedStatsTracking g_xdpDatagramsSent;
+        static ctsShardedStatsTracking g_xdpPacketsSent;
+        static ctsShardedStatsTracking g_xdpFragmentedDatagrams;
+        // sends which found too few free chunks and had to wait for completions
+        static ctsShardedStatsTracking g_xdpTxRingWaits;
+        static ctsShardedStatsTracking g_xdpPokes;
+
+        // xdpapi.dll is loaded at runtime so ctsTraffic still runs where XDP for Windows isn't installed
+        static BOOL CALLBACK InitOnceXdpApi(PINIT_ONCE, PVOID, PVOID*) noexcept
+        {
+            g_xdpApiModule = LoadLibraryExW(L"xdpapi.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+            if (!g_xdpApiModule)
+            {
+                return FALSE;
+            }
+
+            const auto xdpOpenApi = reinterpret_cast<XDP_OPEN_API_FN*>(GetProcAddress(g_xdpApiModule, "XdpOpenApi"));
+            if (!xdpOpenApi)
+            {
+                return FALSE;
+            }
+
+            const auto hr = xdpOpenApi(XDP_API_VERSION_1, &g_xdpApi);
+            if (FAILED(hr))
+            {
+                SetLastError(HRESULT_CODE(hr));
+                return FALSE;
+            }
+            return TRUE;
+        }
+
+        //
+        // Accumulates the 16-bit one's complement sum of consecutive byte ranges as if they were one buffer
+        //
+        class ChecksumAccumulator
+        {
+            unsigned long long m_sum = 0;
+            bool m_oddByte = false;
+
+        public:
+            void Add(_In_reads_bytes_(length) const void* bytes, size_t length) noexcept
+            {
+                const auto* data = static_cast<const unsigned char*>(bytes);
+                if (m_oddByte && length > 0)
+                {
+                    // the prior range ended mid-word : this byte is the low byte of that word
+                    m_sum += *data;
+                    ++data;
+                    --length;
+                    m_oddByte = false;
+                }
+                while (length > 1)
+                {
+                    m_sum += static_cast<unsigned long long>(data[0]) << 8 | data[1];
+                    data += 2;
+                    length -= 2;
+                }
+                if (length > 0)
+                {
+                    m_sum += static_cast<unsigned long long>(data[0]) << 8;
+                    m_oddByte = true;
+                }
+            }
+
+            // the one's complement of the folded sum, in network byte order
+            [[nodiscard]] unsigned short Finish() const noexcept
+            {
+                auto sum = m_sum;
+                while (sum >> 16)
+                {
+                    sum = (sum & 0xffff) + (sum >> 16);
+                }
+                return htons(static_cast<unsigned short>(~sum & 0xffff));
+            }
+        };
+
+        //
+        // Reads the UDP header followed by the datagram's buffers as one contiguous stream of bytes
+        // - fragments are copied in order, so each copy continues where the last one stopped
+        //
+        class DatagramReader
+        {
+            const UdpHeader& m_udpHeader;
+            const WSABUF* const m_buffers;
+            const DWORD m_bufferCount;
+            unsigned long m_headerOffset = 0;
+            DWORD m_buffer = 0;
+            unsigned long m_bufferOffset = 0;
+
+        public:
+            DatagramReader(const UdpHeader& udpHeader, _In_reads_(bufferCount) const WSABUF* buffers, DWORD bufferCount) noexcept :
+                m_udpHeader(udpHeader), m_buffers(buffers), m_bufferCount(bufferCount)
+            {
+            }
+
+            void CopyTo(_Out_writes_bytes_(length) char* destination, unsigned long length) noexcept
+            {
+                if (m_headerOffset < sizeof(UdpHeader))
+                {
+                    const auto headerBytes = std::min<unsigned long>(length, sizeof(UdpHeader) - m_headerOffset);
+                    memcpy(destination, reinterpret_cast<const char*>(&m_udpHeader) + m_headerOffset, headerBytes);
+                    m_headerOffset += headerBytes;
+                    destination += headerBytes;
+                    length -= headerBytes;
+                }
+                while (length > 0 && m_buffer < m_bufferCount)
+                {
+                    const auto bufferBytes = std::min<unsigned long>(length, m_buffers[m_buffer].len - m_bufferOffset);
+                    memcpy(destination, m_buffers[m_buffer].buf + m_bufferOffset, bufferBytes);
+                    destination += bufferBytes;
+                    length -= bufferBytes;
+                    m_bufferOffset += bufferBytes;
+                    if (m_bufferOffset == m_buffers[m_buffer].len)
+                    {
+                        ++m_buffer;
+                        m_bufferOffset = 0;
+                    }
+                }
+            }
+        };
+
+        //
+        // One AF_XDP socket bound to an RSS queue of the interface, with its TX and completion rings
+        // - every chunk of the UMEM is either free or referenced by exactly one posted TX descriptor
+        //   so the TX ring can never be full while a chunk is free
+        // - a dedicated thread reaps the completion ring, freeing chunks and invoking their send callbacks
+        //
+        class XdpTxQueue
+        {
+            wil::critical_section m_lock{ ctsConfig::ctsConfigSettings::c_CriticalSectionSpinlock };
+            wil::unique_handle m_socket;
+            ctsRioBufferLease m_umem;
+            const UINT32 m_chunkSize;
+            _Guarded_by_(m_lock) XSK_RING m_txRing{};
+            // only the completion thread consumes the completion ring
+            XSK_RING m_completionRing{};
+            _Guarded_by_(m_lock) std::vector<UINT32> m_freeChunks;
+            // invoked as the datagram whose last packet was sent from the chunk completes
+            _Guarded_by_(m_lock) std::vector<std::function<void()>> m_sendCompletions;
+            // set by the completion thread as it frees chunks, waking sends waiting for them
+            wil::unique_event m_chunksFreed{ wil::EventOptions::None };
+            wil::unique_handle m_completionThread;
+            _Guarded_by_(m_lock) unsigned long m_nextIdentification = 0;
+
+            static DWORD WINAPI CompletionThreadProc(LPVOID context) noexcept
+            {
+                static_cast<XdpTxQueue*>(context)->ProcessCompletions();
+                return 0;
+            }
+
+            void ProcessCompletions() noexcept
+            {
+                std::vector<std::function<void()>> completedCallbacks;
+                completedCallbacks.reserve(c_ringSize);
+                for (;;)
+                {
+                    XSK_NOTIFY_RESULT_FLAGS notifyResult{};
+                    const auto hr = g_xdpApi->XskNotifySocket(m_socket.get(), XSK_NOTIFY_FLAG_WAIT_TX, c_completionWaitMilliseconds, &notifyResult);
+                    if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_TIMEOUT))
+                    {
+                        ctsConfig::PrintErrorInfo(L"XskNotifySocket(XSK_NOTIFY_FLAG_WAIT_TX) failed [0x%x]", hr);
+                        return;
+                    }
+
+                    UINT32 ringIndex{};
+                    const auto completionCount = XskRingConsumerReserve(&m_completionRing, c_ringSize, &ringIndex);
+                    if (0 == completionCount)
+                    {
+                        continue;
+                    }
+
+                    {
+                        const auto lock = m_lock.lock();
+                        for (UINT32 completion = 0; completion < completionCount; ++completion)
+                        {
+                            const auto address = *static_cast<const UINT64*>(XskRingGetElement(&m_completionRing, ringIndex + completion));
+                            const auto chunk = static_cast<UINT32>(address / m_chunkSize);
+                            m_freeChunks.push_back(chunk);
+                            if (m_sendCompletions[chunk])
+                            {
+                                completedCallbacks.push_back(std::move(m_sendCompletions[chunk]));
+                                m_sendCompletions[chunk] = nullptr;
+                            }
+                        }
+                    }
+                    XskRingConsumerRelease(&m_completionRing, completionCount);
+                    m_chunksFreed.SetEvent();
+
+                    // callbacks can post further sends : invoked once the lock is released
+                    for (const auto& callback : completedCallbacks)
+                    {
+                        callback();
+                    }
+                    completedCallbacks.clear();
+                }
+            }
+
+        public:
+            XdpTxQueue(NET_IFINDEX ifIndex, UINT32 queueId, UINT32 chunkSize) :
+                m_umem(c_ringSize * chunkSize),
+                m_chunkSize(chunkSize)
+            {
+                THROW_IF_FAILED_MSG(g_xdpApi->XskCreate(&m_socket), "XskCreate");
+
+                XSK_UMEM_REG umemRegistration{};
+                umemRegistration.TotalSize = static_cast<UINT64>(c_ringSize) * m_chunkSize;
+                umemRegistration.ChunkSize = m_chunkSize;
+                umemRegistration.Headroom = 0;
+                umemRegistration.Address = m_umem.Get().m_buffer;
+                THROW_IF_FAILED_MSG(
+                    g_xdpApi->XskSetSockopt(m_socket.get(), XSK_SOCKOPT_UMEM_REG, &umemRegistration, sizeof umemRegistration),
+                    "XskSetSockopt(XSK_SOCKOPT_UMEM_REG)");
+
+                THROW_IF_FAILED_MSG(
+                    g_xdpApi->XskBind(m_socket.get(), ifIndex, queueId, XSK_BIND_FLAG_TX),
+                    "XskBind(IfIndex %lu, QueueId %u)", ifIndex, queueId);
+
+                const UINT32 ringSize = c_ringSize;
+                THROW_IF_FAILED_MSG(
+                    g_xdpApi->XskSetSockopt(m_socket.get(), XSK_SOCKOPT_TX_RING_SIZE, &ringSize, sizeof ringSize),
+                    "XskSetSockopt(XSK_SOCKOPT_TX_RING_SIZE)");
+                THROW_IF_FAILED_MSG(
+                    g_xdpApi->XskSetSockopt(m_socket.get(), XSK_SOCKOPT_TX_COMPLETION_RING_SIZE, &ringSize, sizeof ringSize),
+                    "XskSetSockopt(XSK_SOCKOPT_TX_COMPLETION_RING_SIZE)");
+
+                THROW_IF_FAILED_MSG(g_xdpApi->XskActivate(m_socket.get(), XSK_ACTIVATE_FLAG_NONE), "XskActivate");
+
+                XSK_RING_INFO_SET ringInfo{};
+                UINT32 ringInfoLength = sizeof ringInfo;
+                THROW_IF_FAILED_MSG(
+                    g_xdpApi->XskGetSockopt(m_socket.get(), XSK_SOCKOPT_RING_INFO, &ringInfo, &ringInfoLength),
+                    "XskGetSockopt(XSK_SOCKOPT_RING_INFO)");
+                XskRingInitialize(&m_txRing, &ringInfo.Tx);
+                XskRingInitialize(&m_completionRing, &ringInfo.Completion);
+
+                m_freeChunks.reserve(c_ringSize);
+                for (UINT32 chunk = c_ringSize; chunk > 0; --chunk)
+                {
+                    m_freeChunks.push_back(chunk - 1);
+                }
+                m_sendCompletions.resize(c_ringSize);
+
+                m_completionThread.reset(CreateThread(nullptr, 0, CompletionThreadProc, this, 0, nullptr));
+                THROW_LAST_ERROR_IF_MSG(!m_completionThread, "CreateThread (XDP TX completions)");
+            }
+
+            // the queue lives for the lifetime of the process, as does its completion thread
+            ~XdpTxQueue() noexcept = default;
+            XdpTxQueue(const XdpTxQueue&) = delete;
+            XdpTxQueue& operator=(const XdpTxQueue&) = delete;
+            XdpTxQueue(XdpTxQueue&&) = delete;
+            XdpTxQueue& operator=(XdpTxQueue&&) = delete;
+
+            [[nodiscard]] HANDLE GetCompletionThread() const noexcept
+            {
+                return m_completionThread.get();
+            }
+
+            //
+            // Takes the chunks for a datagram's packets, waiting up to c_sendWaitMilliseconds for completions to free them
+            // Returns with m_lock held once the chunks are available, or an empty lock if they never were
+            //
+            [[nodiscard]] wil::cs_leave_scope_exit AcquireChunks(UINT32 chunkCount) noexcept
+            {
+                const auto startTime = ctl::ctTimer::SnapQpcInMillis();
+                auto lock = m_lock.lock();
+                while (m_freeChunks.size() < chunkCount)
+                {
+                    g_xdpTxRingWaits.Increment();
+                    // make certain the packets already posted are being sent before waiting for them
+                    XSK_NOTIFY_RESULT_FLAGS notifyResult{};
+                    (void)g_xdpApi->XskNotifySocket(m_socket.get(), XSK_NOTIFY_FLAG_POKE_TX, 0, &notifyResult);
+                    lock.reset();
+
+                    const auto waitedMilliseconds = ctl::ctTimer::SnapQpcInMillis() - startTime;
+                    if (waitedMilliseconds >= c_sendWaitMilliseconds)
+                    {
+                        return {};
+                    }
+                    WaitForSingleObject(m_chunksFreed.get(), c_sendWaitMilliseconds - static_cast<DWORD>(waitedMilliseconds));
+                    lock = m_lock.lock();
+                }
+                return lock;
+            }
+
+            // the identification shared by every fragment of the next datagram
+            [[nodiscard]] unsigned long NextIdentification() noexcept
+            {
+                return ++m_nextIdentification;
+            }
+
+            // Returns the address of a free chunk for the next packet - requires m_lock held after AcquireChunks
+            [[nodiscard]] char* TakeChunk(_Out_ UINT32* chunk) noexcept
+            {
+                *chunk = *m_freeChunks.rbegin();
+                m_freeChunks.pop_back();
+                return m_umem.Get().m_buffer + static_cast<size_t>(*chunk) * m_chunkSize;
+            }
+
+            //
+            // Posts the packets written into the chunks, the callback invoked once the last of them completes
+            // - requires m_lock held after AcquireChunks
+            //
+            void PostPackets(
+                _In_reads_(packetCount) const UINT32* chunks,
+                _In_reads_(packetCount) const UINT32* packetLengths,
+                UINT32 packetCount,
+                std::function<void()>&& sendCompleted) noexcept
+            {
+                UINT32 ringIndex{};
+                const auto reserved = XskRingProducerReserve(&m_txRing, packetCount, &ringIndex);
+                FAIL_FAST_IF_MSG(
+                    reserved < packetCount,
+                    "XdpTxQueue: the TX ring had %u descriptors free for %u packets with chunks free", reserved, packetCount);
+
+                for (UINT32 packet = 0; packet < packetCount; ++packet)
+                {
+                    auto* const descriptor = static_cast<XSK_BUFFER_DESCRIPTOR*>(XskRingGetElement(&m_txRing, ringIndex + packet));
+                    descriptor->Address.AddressAndOffset = static_cast<UINT64>(chunks[packet]) * m_chunkSize;
+                    descriptor->Length = packetLengths[packet];
+                }
+                m_sendCompletions[chunks[packetCount - 1]] = std::move(sendCompleted);
+                XskRingProducerSubmit(&m_txRing, packetCount);
+
+                if (XskRingProducerNeedPoke(&m_txRing))
+                {
+                    g_xdpPokes.Increment();
+                    XSK_NOTIFY_RESULT_FLAGS notifyResult{};
+                    (void)g_xdpApi->XskNotifySocket(m_socket.get(), XSK_NOTIFY_FLAG_POKE_TX, 0, &notifyResult);
+                }
+            }
+        };
+
+        //
+        // The interface a listening socket is bound to, and the XSK sending on each of its RSS queues
+        //
+        class XdpDatagramSocketContext
+        {
+            const SOCKET m_socket;
+            const ctl::ctSockaddr m_localAddr;
+            NET_IFINDEX m_ifIndex = 0;
+            unsigned long m_mtu = 0;
+            std::array<unsigned char, 6> m_sourceMac{};
+            std::vector<std::unique_ptr<XdpTxQueue>> m_queues;
+
+            wil::srwlock m_neighborLock;
+            // the MAC address of the next hop to each remote address (with its port cleared)
+            _Guarded_by_(m_neighborLock) std::map<ctl::ctSockaddr, std::array<unsigned char, 6>> m_neighbors;
+
+            void FindInterface()
+            {
+                PMIB_UNICASTIPADDRESS_TABLE addressTable{};
+                THROW_IF_WIN32_ERROR_MSG(GetUnicastIpAddressTable(m_localAddr.family(), &addressTable), "GetUnicastIpAddressTable");
+                const auto freeTable = wil::scope_exit([&]() noexcept { FreeMibTable(addressTable); });
+
+                ctl::ctSockaddr localAddress(m_localAddr);
+                localAddress.SetPort(0);
+                for (ULONG row = 0; row < addressTable->NumEntries; ++row)
+                {
+                    ctl::ctSockaddr rowAddress(&addressTable->Table[row].Address);
+                    rowAddress.SetPort(0);
+                    rowAddress.SetScopeId(localAddress.scope_id());
+                    if (rowAddress == localAddress)
+                    {
+                        m_ifIndex = addressTable->Table[row].InterfaceIndex;
+                        break;
+                    }
+                }
+                if (0 == m_ifIndex)
+                {
+                    THROW_WIN32_MSG(ERROR_NOT_FOUND, "ctsXdp: %ws is not assigned to a local interface", m_localAddr.WriteAddress().c_str());
+                }
+
+                MIB_IF_ROW2 interfaceRow{};
+                interfaceRow.InterfaceIndex = m_ifIndex;
+                THROW_IF_WIN32_ERROR_MSG(GetIfEntry2(&interfaceRow), "GetIfEntry2");
+                if (interfaceRow.PhysicalAddressLength != m_sourceMac.size())
+                {
+                    THROW_WIN32_MSG(ERROR_NOT_SUPPORTED, "ctsXdp: interface %lu is not an Ethernet interface", m_ifIndex);
+                }
+                std::copy_n(interfaceRow.PhysicalAddress, m_sourceMac.size(), m_sourceMac.begin());
+
+                MIB_IPINTERFACE_ROW ipInterfaceRow{};
+                InitializeIpInterfaceEntry(&ipInterfaceRow);
+                ipInterfaceRow.Family = m_localAddr.family();
+                ipInterfaceRow.InterfaceIndex = m_ifIndex;
+                THROW_IF_WIN32_ERROR_MSG(GetIpInterfaceEntry(&ipInterfaceRow), "GetIpInterfaceEntry");
+                m_mtu = ipInterfaceRow.NlMtu;
+            }
+
+            // Resolves the MAC address of the next hop to the remote address, caching it for later datagrams
+            // Returns NO_ERROR or the Win32 error of the failed resolution
+            DWORD FindNeighbor(const ctl::ctSockaddr& remoteAddr, _Out_ std::array<unsigned char, 6>* mac) noexcept try
+            {
+                ctl::ctSockaddr remoteAddress(remoteAddr);
+                remoteAddress.SetPort(0);
+                {
+                    const auto lock = m_neighborLock.lock_shared();
+                    const auto foundNeighbor = m_neighbors.find(remoteAddress);
+                    if (foundNeighbor != m_neighbors.end())
+                    {
+                        *mac = foundNeighbor->second;
+                        return NO_ERROR;
+                    }
+                }
+
+                MIB_IPFORWARD_ROW2 route{};
+                SOCKADDR_INET bestSource{};
+                auto error = GetBestRoute2(nullptr, m_ifIndex, m_localAddr.sockaddr_inet(), remoteAddress.sockaddr_inet(), 0, &route, &bestSource);
+                if (error != NO_ERROR)
+                {
+                    ctsConfig::PrintErrorIfFailed("GetBestRoute2", error);
+                    return error;
+                }
+
+                // on-link destinations have no next hop : resolve the destination itself
+                MIB_IPNET_ROW2 neighbor{};
+                neighbor.InterfaceIndex = m_ifIndex;
+                neighbor.Address = ctl::ctSockaddr(&route.NextHop).IsAddressAny() ? *remoteAddress.sockaddr_inet() : route.NextHop;
+                error = ResolveIpNetEntry2(&neighbor, m_localAddr.sockaddr_inet());
+                if (error != NO_ERROR)
+                {
+                    ctsConfig::PrintErrorIfFailed("ResolveIpNetEntry2", error);
+                    return error;
+                }
+                if (neighbor.PhysicalAddressLength != mac->size())
+                {
+                    return ERROR_INVALID_DATA;
+                }
+
+                std::copy_n(neighbor.PhysicalAddress, mac->size(), mac->begin());
+                const auto lock = m_neighborLock.lock_exclusive();
+                m_neighbors.emplace(remoteAddress, *mac);
+                return NO_ERROR;
+            }
+            catch (...)
+            {
+                return ctsConfig::PrintThrownException();
+            }
+
+            // the datagrams to each remote address are always sent from the same queue so they are never reordered
+            [[nodiscard]] XdpTxQueue& AssignQueue(const ctl::ctSockaddr& remoteAddr) const noexcept
+            {
+                ChecksumAccumulator hash;
+                hash.Add(remoteAddr.sockaddr(), remoteAddr.length());
+                return *m_queues[hash.Finish() % m_queues.size()];
+            }
+
+        public:
+            XdpDatagramSocketContext(SOCKET socket, const ctl::ctSockaddr& localAddr) :
+                m_socket(socket),
+                m_localAddr(localAddr)
+            {
+                FindInterface();
+
+                // each chunk holds one full-size packet behind its Ethernet header, aligned to a cache line
+                const auto chunkSize = static_cast<UINT32>((sizeof(EthernetHeader) + m_mtu + 63) / 64 * 64);
+                for (UINT32 queueId = 0; queueId < ctsConfig::g_configSettings->XdpQueueCount; ++queueId)
+                {
+                    m_queues.emplace_back(std::make_unique<XdpTxQueue>(m_ifIndex, queueId, chunkSize));
+                }
+
+                PRINT_DEBUG_INFO(
+                    L"\t\tctsXdp - sending from %ws on interface %lu (MTU %lu) over %Iu XDP queues\n",
+                    m_localAddr.WriteCompleteAddress().c_str(),
+                    m_ifIndex,
+                    m_mtu,
+                    m_queues.size());
+            }
+
+            ~XdpDatagramSocketContext() noexcept = default;
+            XdpDatagramSocketContext(const XdpDatagramSocketContext&) = delete;
+            XdpDatagramSocketContext& operator=(const XdpDatagramSocketContext&) = delete;
+            XdpDatagramSocketContext(XdpDatagramSocketContext&&) = delete;
+            XdpDatagramSocketContext& operator=(XdpDatagramSocketContext&&) = delete;
+
+            [[nodiscard]] SOCKET GetSocket() const noexcept
+            {
+                return m_socket;
+            }
+
+            [[nodiscard]] const std::vector<std::unique_ptr<XdpTxQueue>>& GetQueues() const noexcept
+            {
+                return m_queues;
+            }
+
+            //
+            // Writes the datagram into one packet per IP fragment and posts them to the remote address's queue
+            // - the UDP checksum (mandatory over IPv6) covers the whole datagram so it is summed before fragmenting
+            //   (it is left zero over IPv4, as RFC 768 allows, to keep the per-byte cost to the copy alone)
+            // Returns NO_ERROR once posted, or a Win32 error on failure
+            //
+            int SendDatagram(
+                const ctl::ctSockaddr& remoteAddr,
+                _In_reads_(bufferCount) const WSABUF* buffers,
+                DWORD bufferCount,
+                _Out_ DWORD* bytesPosted,
+                std::function<void()>&& sendCompleted) noexcept
+            {
+                *bytesPosted = 0;
+                if (remoteAddr.family() != m_localAddr.family())
+                {
+                    return WSAEAFNOSUPPORT;
+                }
+
+                unsigned long datagramLength = 0;
+                for (DWORD buffer = 0; buffer < bufferCount; ++buffer)
+                {
+                    datagramLength += buffers[buffer].len;
+                }
+                if (datagramLength > c_udpDatagramMaximumSizeBytes)
+                {
+                    return WSAEMSGSIZE;
+                }
+
+                std::array<unsigned char, 6> destinationMac{};
+                const auto error = FindNeighbor(remoteAddr, &destinationMac);
+                if (error != NO_ERROR)
+                {
+                    return static_cast<int>(error);
+                }
+
+                const bool ipv4 = AF_INET == m_localAddr.family();
+                UdpHeader udpHeader{};
+                udpHeader.m_sourcePort = htons(m_localAddr.port());
+                udpHeader.m_destinationPort = htons(remoteAddr.port());
+                udpHeader.m_length = htons(static_cast<unsigned short>(sizeof(UdpHeader) + datagramLength));
+                if (!ipv4)
+                {
+                    // the IPv6 pseudo-header : source, destination, upper-layer length and next header
+                    ChecksumAccumulator checksum;
+                    checksum.Add(m_localAddr.in6_addr(), sizeof(IN6_ADDR));
+                    checksum.Add(remoteAddr.in6_addr(), sizeof(IN6_ADDR));
+                    const unsigned long upperLayerLength = htonl(static_cast<unsigned long>(sizeof(UdpHeader) + datagramLength));
+                    checksum.Add(&upperLayerLength, sizeof upperLayerLength);
+                    const unsigned long nextHeader = htonl(IPPROTO_UDP);
+                    checksum.Add(&nextHeader, sizeof nextHeader);
+                    checksum.Add(&udpHeader, sizeof udpHeader);
+                    for (DWORD buffer = 0; buffer < bufferCount; ++buffer)
+                    {
+                        checksum.Add(buffers[buffer].buf, buffers[buffer].len);
+                    }
+                    udpHeader.m_checksum = checksum.Finish();
+                    if (0 == udpHeader.m_checksum)
+                    {
+                        udpHeader.m_checksum = 0xffff;
+                    }
+                }
+
+                // fragments other than the last must carry a multiple of 8 bytes
+                const unsigned long ipHeaderLength = ipv4 ? sizeof(Ipv4Header) : sizeof(Ipv6Header);
+                const unsigned long udpLength = sizeof(UdpHeader) + datagramLength;
+                const bool fragmented = udpLength > m_mtu - ipHeaderLength;
+                const unsigned long fragmentHeaderLength = fragmented && !ipv4 ? sizeof(Ipv6FragmentHeader) : 0;
+                const unsigned long fragmentCapacity = fragmented ?
+                    (m_mtu - ipHeaderLength - fragmentHeaderLength) / 8 * 8 :
+                    udpLength;
+                const auto packetCount = static_cast<UINT32>((udpLength + fragmentCapacity - 1) / fragmentCapacity);
+
+                auto& queue = AssignQueue(remoteAddr);
+                const auto lock = queue.AcquireChunks(packetCount);
+                if (!lock)
+                {
+                    // every chunk stayed posted : the NIC is not draining the TX ring
+                    return WSAENOBUFS;
+                }
+
+                const auto identification = queue.NextIdentification();
+                std::array<UINT32, c_udpDatagramMaximumSizeBytes / 512 + 1> chunks{};
+                std::array<UINT32, c_udpDatagramMaximumSizeBytes / 512 + 1> packetLengths{};
+                FAIL_FAST_IF_MSG(packetCount > chunks.size(), "ctsXdp: a %lu byte datagram needs %u fragments at MTU %lu", datagramLength, packetCount, m_mtu);
+
+                DatagramReader reader(udpHeader, buffers, bufferCount);
+                for (UINT32 packet = 0; packet < packetCount; ++packet)
+                {
+                    const unsigned long fragmentOffset = packet * fragmentCapacity;
+                    const unsigned long fragmentLength = std::min(fragmentCapacity, udpLength - fragmentOffset);
+                    const bool moreFragments = packet + 1 < packetCount;
+
+                    char* const frame = queue.TakeChunk(&chunks[packet]);
+                    auto* const ethernetHeader = reinterpret_cast<EthernetHeader*>(frame);
+                    std::copy(destinationMac.begin(), destinationMac.end(), ethernetHeader->m_destination);
+                    std::copy(m_sourceMac.begin(), m_sourceMac.end(), ethernetHeader->m_source);
+                    ethernetHeader->m_etherType = htons(ipv4 ? c_etherTypeIpv4 : c_etherTypeIpv6);
+
+                    char* payload = frame + sizeof(EthernetHeader) + ipHeaderLength;
+                    if (ipv4)
+                    {
+                        auto* const ipHeader = reinterpret_cast<Ipv4Header*>(frame + sizeof(EthernetHeader));
+                        ipHeader->m_versionAndLength = 0x45;
+                        ipHeader->m_typeOfService = 0;
+                        ipHeader->m_totalLength = htons(static_cast<unsigned short>(sizeof(Ipv4Header) + fragmentLength));
+                        ipHeader->m_identification = htons(static_cast<unsigned short>(identification));
+                        ipHeader->m_flagsAndOffset = htons(static_cast<unsigned short>(fragmentOffset / 8 | (moreFragments ? c_ipv4MoreFragments : 0)));
+                        ipHeader->m_timeToLive = c_defaultHopLimit;
+                        ipHeader->m_protocol = IPPROTO_UDP;
+                        ipHeader->m_checksum = 0;
+                        ipHeader->m_source = *m_localAddr.in_addr();
+                        ipHeader->m_destination = *remoteAddr.in_addr();
+                        ChecksumAccumulator checksum;
+                        checksum.Add(ipHeader, sizeof(Ipv4Header));
+                        ipHeader->m_checksum = checksum.Finish();
+                    }
+                    else
+                    {
+                        auto* const ipHeader = reinterpret_cast<Ipv6Header*>(frame + sizeof(EthernetHeader));
+                        ipHeader->m_versionClassAndFlow = htonl(0x60000000);
+                        ipHeader->m_payloadLength = htons(static_cast<unsigned short>(fragmentHeaderLength + fragmentLength));
+                        ipHeader->m_nextHeader = fragmented ? c_ipv6FragmentNextHeader : static_cast<unsigned char>(IPPROTO_UDP);
+                        ipHeader->m_hopLimit = c_defaultHopLimit;
+                        ipHeader->m_source = *m_localAddr.in6_addr();
+                        ipHeader->m_destination = *remoteAddr.in6_addr();
+                        if (fragmented)
+                        {
+                            auto* const fragmentHeader = reinterpret_cast<Ipv6FragmentHeader*>(payload);
+                            fragmentHeader->m_nextHeader = IPPROTO_UDP;
+                            fragmentHeader->m_reserved = 0;
+                            fragmentHeader->m_offsetAndFlags = htons(static_cast<unsigned short>(fragmentOffset | (moreFragments ? c_ipv6MoreFragments : 0)));
+                            fragmentHeader->m_identification = htonl(identification);
+                            payload += sizeof(Ipv6FragmentHeader);
+                        }
+                    }
+
+                    reader.CopyTo(payload, fragmentLength);
+                    packetLengths[packet] = sizeof(EthernetHeader) + ipHeaderLength + fragmentHeaderLength + fragmentLength;
+                }
+
+                queue.PostPackets(chunks.data(), packetLengths.data(), packetCount, std::move(sendCompleted));
+
+                g_xdpDatagramsSent.Increment();
+                g_xdpPacketsSent.Add(packetCount);
+                if (fragmented)
+                {
+                    g_xdpFragmentedDatagrams.Increment();
+                }
+                *bytesPosted = datagramLength;
+                return NO_ERROR;
+            }
+        };
+
+        static wil::srwlock g_xdpDatagramContextsLock;
+        // every registered socket is sent from until the process exits
+        static std::vector<XdpDatagramSocketContext*> g_xdpDatagramContexts;  // NOLINT(clang-diagnostic-exit-time-destructors)
+    }
+
+    bool ctsXdpIsSupported() noexcept
+    {
+        return true;
+    }
+
+    void ctsXdpRegisterDatagramSocket(SOCKET socket, const ctl::ctSockaddr& localAddr)
+    {
+        if (!InitOnceExecuteOnce(&Xdp::g_xdpApiInitializer, Xdp::InitOnceXdpApi, nullptr, nullptr))
+        {
+            auto gle = GetLastError();
+            if (0 == gle)
+            {
+                gle = ERROR_MOD_NOT_FOUND;
+            }
+            THROW_WIN32_MSG(gle, "ctsXdp: failed to open the XDP for Windows API (xdpapi.dll)");
+        }
+
+        auto datagramContext = std::make_unique<Xdp::XdpDatagramSocketContext>(socket, localAddr);
+        const auto lock = Xdp::g_xdpDatagramContextsLock.lock_exclusive();
+        Xdp::g_xdpDatagramContexts.push_back(datagramContext.get());
+        // ownership is now held by g_xdpDatagramContexts for the lifetime of the process
+        datagramContext.release();
+    }
+
+    int ctsXdpSendDatagram(
+        SOCKET socket,
+        const ctl::ctSockaddr& targetAddress,
+        _In_reads_(bufferCount) const WSABUF* buffers,
+        DWORD bufferCount,
+        _Out_ DWORD* bytesPosted,
+        std::function<void()> sendCompleted) noexcept
+    {
+        Xdp::XdpDatagramSocketContext* datagramContext = nullptr;
+        {
+            const auto lock = Xdp::g_xdpDatagramContextsLock.lock_shared();
+            const auto foundContext = std::find_if(
+                std::begin(Xdp::g_xdpDatagramContexts),
+                std::end(Xdp::g_xdpDatagramContexts),
+                [socket](const Xdp::XdpDatagramSocketContext* context) noexcept { return context->GetSocket() == socket; });
+            if (foundContext != std::end(Xdp::g_xdpDatagramContexts))
+            {
+                datagramContext = *foundContext;
+            }
+        }
+
+        FAIL_FAST_IF_MSG(
+            nullptr == datagramContext,
+            "ctsXdpSendDatagram: the socket (%Iu) was never registered with ctsXdpRegisterDatagramSocket", socket);
+        return datagramContext->SendDatagram(targetAddress, buffers, bufferCount, bytesPosted, std::move(sendCompleted));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Prints the packets sent through XDP and the CPU time consumed by the TX completion threads
+    /// - no-op if XDP was never used
+    ///
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ctsXdpPrintSummary() noexcept
+    {
+        long long completionKernelTime = 0;
+        long long completionUserTime = 0;
+        size_t queueCount = 0;
+        {
+            const auto lock = Xdp::g_xdpDatagramContextsLock.lock_shared();
+            for (const auto* datagramContext : Xdp::g_xdpDatagramContexts)
+            {
+                for (const auto& queue : datagramContext->GetQueues())
+                {
+                    FILETIME creationTime{};
+                    FILETIME exitTime{};
+                    FILETIME kernelTime{};
+                    FILETIME userTime{};
+                    if (GetThreadTimes(queue->GetCompletionThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+                    {
+                        completionKernelTime += ctl::ctTimer::ConvertFiletimeToMillis(kernelTime);
+                        completionUserTime += ctl::ctTimer::ConvertFiletimeToMillis(userTime);
+                    }
+                    ++queueCount;
+                }
+            }
+        }
+        if (0 == queueCount)
+        {
+            return;
+        }
+
+        const auto datagramCount = Xdp::g_xdpDatagramsSent.GetValue();
+        const auto packetCount = Xdp::g_xdpPacketsSent.GetValue();
+        ctsConfig::PrintSummary(
+            L"\n"
+            L"  XDP Queues : %Iu\n"
+            L"  XDP Datagrams Sent : %lld (%lld fragmented)\n"
+            L"  XDP Packets Sent : %lld (%.2f per datagram)\n"
+            L"  XDP TX Ring Waits : %lld\n"
+            L"  XDP TX Pokes : %lld\n"
+            L"  XDP Completion CPU Time : %lld ms (kernel %lld ms, user %lld ms)\n",
+            queueCount,
+            datagramCount,
+            Xdp::g_xdpFragmentedDatagrams.GetValue(),
+            packetCount,
+            datagramCount > 0 ? static_cast<double>(packetCount) / static_cast<double>(datagramCount) : 0.0,
+            Xdp::g_xdpTxRingWaits.GetValue(),
+            Xdp::g_xdpPokes.GetValue(),
+            completionKernelTime + completionUserTime,
+            completionKernelTime,
+            completionUserTime);
+    }
+#else
+    bool ctsXdpIsSupported() noexcept
+    {
+        return false;
+    }
+
+    void ctsXdpRegisterDatagramSocket(SOCKET, const ctl::ctSockaddr&)
+    {
+        THROW_WIN32_MSG(ERROR_NOT_SUPPORTED, "ctsXdp: ctsTraffic was not built with the XDP for Windows headers");
+    }
+
+    int ctsXdpSendDatagram(
+        SOCKET,
+        const ctl::ctSockaddr&,
+        _In_reads_(bufferCount) const WSABUF*,
+        DWORD bufferCount,
+        _Out_ DWORD* bytesPosted,
+        std::function<void()>) noexcept
+    {
+        UNREFERENCED_PARAMETER(bufferCount);
+        *bytesPosted = 0;
+        return WSAEOPNOTSUPP;
+    }
+
+    void ctsXdpPrintSummary() noexcept
+    {
+    }
+#endif
+}